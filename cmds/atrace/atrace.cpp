@@ -30,8 +30,14 @@
 #include <unistd.h>
 #include <zlib.h>
 
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <binder/IBinder.h>
 #include <binder/IServiceManager.h>
@@ -891,8 +897,139 @@ static void stopTrace()
     setTracingEnabled(false);
 }
 
-// Read data from the tracing pipe and forward to stdout
-static void streamTrace()
+// Size of the uncompressed chunks that are compressed independently when streaming with -z.
+static const size_t k_streamChunkSize = 1024 * 1024;
+// Number of threads compressing streamed chunks.
+static const size_t k_streamCompressThreads = 2;
+// Maximum number of chunks read but not yet written, which bounds memory use when the output is
+// slower than the trace.
+static const size_t k_streamMaxPendingChunks = 8;
+
+// Compresses |in| into a self-contained gzip member. Concatenated members form a valid gzip
+// file, and each one can be decompressed on its own starting at its offset.
+static bool gzipChunk(const std::string& in, std::string* out)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // 15 window bits plus 16 selects the gzip wrapper.
+    int result = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                              Z_DEFAULT_STRATEGY);
+    if (result != Z_OK) {
+        fprintf(stderr, "error initializing zlib: %d\n", result);
+        return false;
+    }
+    out->resize(deflateBound(&zs, in.size()));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = in.size();
+    zs.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+    zs.avail_out = out->size();
+    result = deflate(&zs, Z_FINISH);
+    if (result != Z_STREAM_END) {
+        fprintf(stderr, "error deflating trace: %s\n", zs.msg);
+    }
+    out->resize(zs.total_out);
+    deflateEnd(&zs);
+    return result == Z_STREAM_END;
+}
+
+// Groups streamed trace data into chunks, compresses them on a small pool of threads and writes
+// the results to outFd in the order the data was read.
+class CompressedTraceStream {
+public:
+    explicit CompressedTraceStream(int outFd) : mOutFd(outFd) {
+        mCurrent.reserve(k_streamChunkSize);
+        for (size_t i = 0; i < k_streamCompressThreads; i++) {
+            mThreads.emplace_back([this] { compressLoop(); });
+        }
+    }
+
+    ~CompressedTraceStream() { finish(); }
+
+    void write(const char* data, size_t size) {
+        mCurrent.append(data, size);
+        if (mCurrent.size() >= k_streamChunkSize) {
+            submit();
+        }
+    }
+
+    // Compresses and writes any buffered data and stops the workers. Returns false if any chunk
+    // could not be compressed or written.
+    bool finish() {
+        if (!mCurrent.empty()) {
+            submit();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mFinishing = true;
+        }
+        mCondition.notify_all();
+        for (auto& thread : mThreads) {
+            thread.join();
+        }
+        mThreads.clear();
+        return !mFailed;
+    }
+
+private:
+    void submit() {
+        std::unique_lock<std::mutex> lock(mLock);
+        mCondition.wait(lock, [this] { return mPending < k_streamMaxPendingChunks; });
+        mQueue.emplace_back(mNextSeq++, std::move(mCurrent));
+        mPending++;
+        mCurrent = std::string();
+        mCurrent.reserve(k_streamChunkSize);
+        mCondition.notify_all();
+    }
+
+    void compressLoop() {
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mCondition.wait(lock, [this] { return !mQueue.empty() || mFinishing; });
+            if (mQueue.empty()) {
+                return;
+            }
+            auto chunk = std::move(mQueue.front());
+            mQueue.pop_front();
+            lock.unlock();
+            std::string compressed;
+            bool ok = gzipChunk(chunk.second, &compressed);
+            lock.lock();
+            mFailed |= !ok;
+            mDone.emplace(chunk.first, std::move(compressed));
+            // Write out every finished chunk that is next in order.
+            for (auto it = mDone.find(mNextWrite); it != mDone.end();
+                 it = mDone.find(mNextWrite)) {
+                if (!mFailed &&
+                    !android::base::WriteFully(mOutFd, it->second.data(), it->second.size())) {
+                    fprintf(stderr, "error writing deflated trace: %s (%d)\n",
+                            strerror(errno), errno);
+                    mFailed = true;
+                }
+                mDone.erase(it);
+                mNextWrite++;
+                mPending--;
+            }
+            mCondition.notify_all();
+        }
+    }
+
+    const int mOutFd;
+    std::string mCurrent;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<std::pair<uint64_t, std::string>> mQueue;
+    std::map<uint64_t, std::string> mDone;
+    uint64_t mNextSeq = 0;
+    uint64_t mNextWrite = 0;
+    size_t mPending = 0;
+    bool mFinishing = false;
+    bool mFailed = false;
+};
+
+// Read data from the tracing pipe and forward to outFd, compressing it if requested.
+static void streamTrace(int outFd)
 {
     char trace_data[4096];
     int traceFD = open((g_traceFolder + k_traceStreamPath).c_str(), O_RDWR);
@@ -901,11 +1038,19 @@ static void streamTrace()
                 strerror(errno), errno);
         return;
     }
+    std::unique_ptr<CompressedTraceStream> compressedStream;
+    if (g_compress) {
+        compressedStream = std::make_unique<CompressedTraceStream>(outFd);
+    }
     while (!g_traceAborted) {
         ssize_t bytes_read = read(traceFD, trace_data, 4096);
         if (bytes_read > 0) {
-            write(STDOUT_FILENO, trace_data, bytes_read);
-            fflush(stdout);
+            if (compressedStream) {
+                compressedStream->write(trace_data, bytes_read);
+            } else {
+                write(outFd, trace_data, bytes_read);
+                fflush(stdout);
+            }
         } else {
             if (!g_traceAborted) {
                 fprintf(stderr, "read returned %zd bytes err %d (%s)\n",
@@ -914,6 +1059,10 @@ static void streamTrace()
             break;
         }
     }
+    if (compressedStream && !compressedStream->finish()) {
+        fprintf(stderr, "compressed trace stream is incomplete\n");
+    }
+    close(traceFD);
 }
 
 // Read the current kernel trace and write it to stdout.
@@ -1072,7 +1221,9 @@ static void showHelp(const char *cmd)
                     "  --async_dump    dump the current contents of circular trace buffer\n"
                     "  --async_stop    stop tracing and dump the current contents of circular\n"
                     "                    trace buffer\n"
-                    "  --stream        stream trace to stdout as it enters the trace buffer\n"
+                    "  --stream        stream trace to stdout as it enters the trace buffer;\n"
+                    "                    with -z it is written as a series of gzip members\n"
+                    "                    compressed on background threads\n"
                     "                    Note: this can take significant CPU time, and is best\n"
                     "                    used for measuring things that are not affected by\n"
                     "                    CPU performance, like pagecache usage.\n"
@@ -1354,7 +1505,18 @@ int main(int argc, char **argv)
         }
 
         if (traceStream) {
-            streamTrace();
+            int outFd = STDOUT_FILENO;
+            if (g_outputFile) {
+                outFd = open(g_outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            }
+            if (outFd == -1) {
+                printf("Failed to open '%s', err=%d", g_outputFile, errno);
+            } else {
+                streamTrace(outFd);
+                if (g_outputFile) {
+                    close(outFd);
+                }
+            }
         }
     }
 
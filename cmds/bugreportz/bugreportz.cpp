@@ -73,3 +73,27 @@ int bugreportz(int s, bool show_progress) {
 
     return EXIT_SUCCESS;
 }
+
+int bugreportz_stream(int s) {
+    while (1) {
+        char buffer[65536];
+        ssize_t bytes_read = TEMP_FAILURE_RETRY(read(s, buffer, sizeof(buffer)));
+        if (bytes_read == 0) {
+            break;
+        } else if (bytes_read == -1) {
+            // EAGAIN really means time out, so change the errno.
+            if (errno == EAGAIN) {
+                errno = ETIMEDOUT;
+            }
+            fprintf(stderr, "FAIL:Bugreport read terminated abnormally (%s)\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        // The zip is binary, so it is copied as is; errors go to stderr instead.
+        if (!android::base::WriteFully(STDOUT_FILENO, buffer, bytes_read)) {
+            fprintf(stderr, "FAIL:Failed to write bugreport to stdout (%s)\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
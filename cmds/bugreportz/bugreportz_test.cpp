@@ -70,12 +70,13 @@ class BugreportzTest : public ::testing::Test {
     // Tests must call WriteToSocket() to set what's written prior to calling it, since the writing
     // end of the pipe will be closed before calling bugreportz() (otherwise that function would
     // hang).
-    void Bugreportz(bool show_progress) {
+    void Bugreportz(bool show_progress, bool stream_data = false) {
         close(write_fd_);
         write_fd_ = -1;
 
         CaptureStdout();
-        int status = bugreportz(read_fd_, show_progress);
+        int status =
+                stream_data ? bugreportz_stream(read_fd_) : bugreportz(read_fd_, show_progress);
 
         close(read_fd_);
         read_fd_ = -1;
@@ -126,3 +127,14 @@ TEST_F(BugreportzTest, WithProgress) {
         "PROGRESS:IS NOT AUTOMATIC\n"
         "Newline is optional");
 }
+
+// Tests 'bugreportz -s' - it will copy dumpstate's output to stdout as is.
+TEST_F(BugreportzTest, StreamData) {
+    const std::string data("PK\x03\x04\0\0\0BEGIN:NOT A LINE\n\x01PROGRESS:NEITHER", 41);
+    WriteToSocket(data.substr(0, 10));
+    WriteToSocket(data.substr(10));
+
+    Bugreportz(false, true);
+
+    AssertStdoutEquals(data);
+}
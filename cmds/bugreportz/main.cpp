@@ -26,13 +26,14 @@
 
 #include "bugreportz.h"
 
-static constexpr char VERSION[] = "1.1";
+static constexpr char VERSION[] = "1.2";
 
 static void show_usage() {
     fprintf(stderr,
             "usage: bugreportz [-h | -v]\n"
             "  -h: to display this help message\n"
             "  -p: display progress\n"
+            "  -s: stream the zipped bugreport to stdout while it is generated\n"
             "  -v: to display the version\n"
             "  or no arguments to generate a zipped bugreport\n");
 }
@@ -43,10 +44,11 @@ static void show_version() {
 
 int main(int argc, char* argv[]) {
     bool show_progress = false;
+    bool stream_data = false;
     if (argc > 1) {
         /* parse arguments */
         int c;
-        while ((c = getopt(argc, argv, "hpv")) != -1) {
+        while ((c = getopt(argc, argv, "hpsv")) != -1) {
             switch (c) {
                 case 'h':
                     show_usage();
@@ -54,6 +56,9 @@ int main(int argc, char* argv[]) {
                 case 'p':
                     show_progress = true;
                     break;
+                case 's':
+                    stream_data = true;
+                    break;
                 case 'v':
                     show_version();
                     return EXIT_SUCCESS;
@@ -69,7 +74,7 @@ int main(int argc, char* argv[]) {
     // should be reused instead.
 
     // Start the dumpstatez service.
-    property_set("ctl.start", "dumpstatez");
+    property_set("ctl.start", stream_data ? "dumpstatez_stream" : "dumpstatez");
 
     // Socket will not be available until service starts.
     int s = -1;
@@ -97,7 +102,7 @@ int main(int argc, char* argv[]) {
                 strerror(errno));
     }
 
-    int ret = bugreportz(s, show_progress);
+    int ret = stream_data ? bugreportz_stream(s) : bugreportz(s, show_progress);
 
     if (close(s) == -1) {
         fprintf(stderr, "WARNING: error closing socket: %s\n", strerror(errno));
@@ -24,6 +24,7 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <vector>
 
 #include <android-base/file.h>
@@ -43,6 +44,11 @@ namespace {
 
 static constexpr const char* kSuPath = "/system/xbin/su";
 
+// Longest time to sleep in sigtimedwait() before checking on the child again. SIGCHLD is delivered
+// to the process rather than to the thread that forked the child, so when several commands run
+// concurrently one thread may consume the signal meant for another.
+static constexpr int kChildPollIntervalMs = 50;
+
 static bool waitpid_with_timeout(pid_t pid, int timeout_ms, int* status) {
     sigset_t child_mask, old_mask;
     sigemptyset(&child_mask);
@@ -53,36 +59,40 @@ static bool waitpid_with_timeout(pid_t pid, int timeout_ms, int* status) {
         return false;
     }
 
-    timespec ts;
-    ts.tv_sec = MSEC_TO_SEC(timeout_ms);
-    ts.tv_nsec = (timeout_ms % 1000) * 1000000;
-    int ret = TEMP_FAILURE_RETRY(sigtimedwait(&child_mask, nullptr, &ts));
-    int saved_errno = errno;
+    const uint64_t deadline = Nanotime() + static_cast<uint64_t>(timeout_ms) * 1000000;
+    pid_t child_pid = 0;
+    int saved_errno = 0;
+    while ((child_pid = waitpid(pid, status, WNOHANG)) == 0) {
+        const uint64_t now = Nanotime();
+        if (now >= deadline) {
+            saved_errno = ETIMEDOUT;
+            break;
+        }
+        const uint64_t wait_ms =
+                std::min<uint64_t>((deadline - now + 999999) / 1000000, kChildPollIntervalMs);
+        timespec ts;
+        ts.tv_sec = MSEC_TO_SEC(wait_ms);
+        ts.tv_nsec = (wait_ms % 1000) * 1000000;
+        if (TEMP_FAILURE_RETRY(sigtimedwait(&child_mask, nullptr, &ts)) == -1 && errno != EAGAIN) {
+            saved_errno = errno;
+            printf("*** sigtimedwait failed: %s\n", strerror(errno));
+            break;
+        }
+    }
+    if (child_pid == -1) {
+        saved_errno = errno;
+        printf("*** waitpid failed: %s\n", strerror(errno));
+    }
 
     // Set the signals back the way they were.
     if (sigprocmask(SIG_SETMASK, &old_mask, nullptr) == -1) {
         printf("*** sigprocmask failed: %s\n", strerror(errno));
-        if (ret == 0) {
+        if (child_pid != pid) {
             return false;
         }
     }
-    if (ret == -1) {
-        errno = saved_errno;
-        if (errno == EAGAIN) {
-            errno = ETIMEDOUT;
-        } else {
-            printf("*** sigtimedwait failed: %s\n", strerror(errno));
-        }
-        return false;
-    }
-
-    pid_t child_pid = waitpid(pid, status, WNOHANG);
     if (child_pid != pid) {
-        if (child_pid != -1) {
-            printf("*** Waiting for pid %d, got pid %d instead\n", pid, child_pid);
-        } else {
-            printf("*** waitpid failed: %s\n", strerror(errno));
-        }
+        errno = saved_errno;
         return false;
     }
     return true;
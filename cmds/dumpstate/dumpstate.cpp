@@ -43,6 +43,8 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <fstream>
@@ -53,6 +55,7 @@
 #include <regex>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -328,6 +331,9 @@ static constexpr char PROPERTY_VERSION[] = "dumpstate.version";
 
 static const CommandOptions AS_ROOT_20 = CommandOptions::WithTimeout(20).AsRoot().Build();
 
+// Number of HALs whose debug output is collected at the same time.
+static constexpr size_t kMaxHalDebugThreads = 4;
+
 /*
  * Returns a vector of dump fds under |dir_path| with a given |file_prefix|.
  * The returned vector is sorted by the mtimes of the dumps with descending
@@ -764,6 +770,39 @@ static const std::set<std::string> PROBLEMATIC_FILE_EXTENSIONS = {
       ".shb", ".sys", ".vb",  ".vbe", ".vbs", ".vxd", ".wsc", ".wsf", ".wsh"
 };
 
+// Entries whose contents are already compressed gain nothing from another deflate pass, so they
+// are stored as-is unless dumpstate.store_compressed_inputs is set to false.
+static const std::set<std::string> COMPRESSED_FILE_EXTENSIONS = {
+      ".apk", ".br", ".bz2", ".gz", ".jpeg", ".jpg", ".lz4", ".png", ".webp", ".xz", ".zip",
+      ".zst"
+};
+
+static bool ShouldStoreCompressedInputs() {
+    static const bool store =
+        android::base::GetBoolProperty("dumpstate.store_compressed_inputs", true);
+    return store;
+}
+
+// Returns true if |data| starts with the magic of a common compressed container format.
+static bool HasCompressedMagic(const uint8_t* data, size_t size) {
+    static const std::vector<std::vector<uint8_t>> kMagics = {
+        {0x1f, 0x8b},                          // gzip
+        {0x50, 0x4b, 0x03, 0x04},              // zip
+        {0x89, 0x50, 0x4e, 0x47},              // png
+        {0xff, 0xd8, 0xff},                    // jpeg
+        {0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00},  // xz
+        {0x28, 0xb5, 0x2f, 0xfd},              // zstd
+        {0x04, 0x22, 0x4d, 0x18},              // lz4
+        {0x42, 0x5a, 0x68},                    // bzip2
+    };
+    for (const auto& magic : kMagics) {
+        if (size >= magic.size() && std::equal(magic.begin(), magic.end(), data)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
                                       std::chrono::milliseconds timeout = 0ms) {
     if (!IsZipping()) {
@@ -772,6 +811,7 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
         return INVALID_OPERATION;
     }
     std::string valid_name = entry_name;
+    bool compressed_input = false;
 
     // Rename extension if necessary.
     size_t idx = entry_name.rfind('.');
@@ -782,20 +822,34 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
             valid_name = entry_name + ".renamed";
             MYLOGI("Renaming entry %s to %s\n", entry_name.c_str(), valid_name.c_str());
         }
-    }
-
-    // Logging statement  below is useful to time how long each entry takes, but it's too verbose.
-    // MYLOGD("Adding zip entry %s\n", entry_name.c_str());
-    int32_t err = zip_writer_->StartEntryWithTime(valid_name.c_str(), ZipWriter::kCompress,
-                                                  get_mtime(fd, ds.now_));
-    if (err != 0) {
-        MYLOGE("zip_writer_->StartEntryWithTime(%s): %s\n", valid_name.c_str(),
-               ZipWriter::ErrorCodeString(err));
-        return UNKNOWN_ERROR;
-    }
+        compressed_input = COMPRESSED_FILE_EXTENSIONS.count(extension) != 0;
+    }
+
+    // The entry is started lazily once the first chunk has been read, so that inputs which are
+    // already compressed can be detected by their contents and stored instead of deflated.
+    int32_t err = 0;
+    bool started_entry = false;
+    auto start_entry = [&](const uint8_t* data, size_t size) {
+        if (ShouldStoreCompressedInputs() && !compressed_input) {
+            compressed_input = HasCompressedMagic(data, size);
+        }
+        size_t flags = (ShouldStoreCompressedInputs() && compressed_input) ? 0
+                                                                           : ZipWriter::kCompress;
+        // Logging statement below is useful to time how long each entry takes, but it's too
+        // verbose.
+        // MYLOGD("Adding zip entry %s\n", entry_name.c_str());
+        err = zip_writer_->StartEntryWithTime(valid_name.c_str(), flags, get_mtime(fd, ds.now_));
+        if (err != 0) {
+            MYLOGE("zip_writer_->StartEntryWithTime(%s): %s\n", valid_name.c_str(),
+                   ZipWriter::ErrorCodeString(err));
+            return false;
+        }
+        started_entry = true;
+        return true;
+    };
     bool finished_entry = false;
-    auto finish_entry = [this, &finished_entry] {
-        if (!finished_entry) {
+    auto finish_entry = [this, &started_entry, &finished_entry] {
+        if (started_entry && !finished_entry) {
             // This should only be called when we're going to return an earlier error,
             // which would've been logged. This may imply the file is already corrupt
             // and any further logging from FinishEntry is more likely to mislead than
@@ -831,12 +885,16 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
         }
 
         ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, buffer.data(), buffer.size()));
-        if (bytes_read == 0) {
-            break;
-        } else if (bytes_read == -1) {
+        if (bytes_read == -1) {
             MYLOGE("read(%s): %s\n", entry_name.c_str(), strerror(errno));
             return -errno;
         }
+        if (!started_entry && !start_entry(buffer.data(), bytes_read)) {
+            return UNKNOWN_ERROR;
+        }
+        if (bytes_read == 0) {
+            break;
+        }
         err = zip_writer_->WriteBytes(buffer.data(), bytes_read);
         if (err) {
             MYLOGE("zip_writer_->WriteBytes(): %s\n", ZipWriter::ErrorCodeString(err));
@@ -1162,6 +1220,24 @@ static Dumpstate::RunStatus RunDumpsysTextByPriority(const std::string& title, i
     Vector<String16> args;
     Dumpsys::setServiceArgs(args, /* asProto = */ false, priority);
     Vector<String16> services = dumpsys.listServices(priority, /* supports_proto = */ false);
+    // Services are dumped one at a time unless dumpstate.dumpsys_parallel_jobs asks for more. In
+    // parallel mode each service is still bounded by service_timeout, but the overall timeout
+    // cannot cut the run short.
+    int parallel_jobs = android::base::GetIntProperty("dumpstate.dumpsys_parallel_jobs", 1);
+    if (parallel_jobs > 1 && services.size() > 1) {
+        RETURN_IF_USER_DENIED_CONSENT();
+        auto stats = dumpsys.dumpServicesInParallel(
+            STDOUT_FILENO, Dumpsys::Type::DUMP, services, args, priority, service_timeout,
+            /* as_proto = */ false, /* add_separator = */ true, parallel_jobs);
+        for (const auto& service_stats : stats) {
+            if (service_stats.elapsedDuration > service_timeout / 2) {
+                MYLOGD("%s - %s took %.3fs\n", title.c_str(),
+                       String8(service_stats.serviceName).c_str(),
+                       service_stats.elapsedDuration.count());
+            }
+        }
+        return Dumpstate::RunStatus::OK;
+    }
     for (const String16& service : services) {
         RETURN_IF_USER_DENIED_CONSENT();
         std::string path(title);
@@ -1313,9 +1389,24 @@ static void DumpHals() {
         return;
     }
 
-    auto ret = sm->list([&](const auto& interfaces) {
-        for (const std::string& interface : interfaces) {
-            std::string cleanName = interface;
+    std::vector<std::string> interfaces;
+    auto ret = sm->list([&](const auto& list) {
+        interfaces.assign(list.begin(), list.end());
+    });
+    if (!ret.isOk()) {
+        MYLOGE("Could not list hals from hwservicemanager.\n");
+        return;
+    }
+
+    // Each HAL is debugged into its own file, so that slow HALs can be waited on concurrently. The
+    // files are then added to the zip in the order the HALs were listed.
+    std::vector<std::string> clean_names(interfaces.size());
+    std::vector<std::string> paths(interfaces.size());
+    std::vector<int> dumped(interfaces.size(), false);
+    std::atomic<size_t> next(0);
+    auto dump_hals = [&]() {
+        for (size_t i = next++; i < interfaces.size(); i = next++) {
+            std::string cleanName = interfaces[i];
             std::replace_if(cleanName.begin(),
                             cleanName.end(),
                             [](char c) {
@@ -1323,33 +1414,44 @@ static void DumpHals() {
                                     std::string("@-_:.").find(c) == std::string::npos;
                             }, '_');
             const std::string path = ds.bugreport_internal_dir_ + "/lshal_debug_" + cleanName;
+            clean_names[i] = cleanName;
+            paths[i] = path;
 
-            {
-                auto fd = android::base::unique_fd(
-                    TEMP_FAILURE_RETRY(open(path.c_str(),
-                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
-                    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)));
-                if (fd < 0) {
-                    MYLOGE("Could not open %s to dump additional hal information.\n", path.c_str());
-                    continue;
-                }
-                RunCommandToFd(fd,
-                        "",
-                        {"lshal", "debug", "-E", interface},
-                        CommandOptions::WithTimeout(2).AsRootIfAvailable().Build());
-
-                bool empty = 0 == lseek(fd, 0, SEEK_END);
-                if (!empty) {
-                    ds.AddZipEntry("lshal-debug/" + cleanName + ".txt", path);
-                }
+            auto fd = android::base::unique_fd(
+                TEMP_FAILURE_RETRY(open(path.c_str(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)));
+            if (fd < 0) {
+                MYLOGE("Could not open %s to dump additional hal information.\n", path.c_str());
+                continue;
             }
+            RunCommandToFd(fd,
+                    "",
+                    {"lshal", "debug", "-E", interfaces[i]},
+                    CommandOptions::WithTimeout(2).AsRootIfAvailable().Build());
 
-            unlink(path.c_str());
+            dumped[i] = 0 != lseek(fd, 0, SEEK_END);
         }
-    });
+    };
 
-    if (!ret.isOk()) {
-        MYLOGE("Could not list hals from hwservicemanager.\n");
+    std::vector<std::thread> threads;
+    const size_t num_threads = std::min(interfaces.size(), kMaxHalDebugThreads);
+    for (size_t i = 1; i < num_threads; i++) {
+        threads.emplace_back(dump_hals);
+    }
+    dump_hals();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < interfaces.size(); i++) {
+        if (paths[i].empty()) {
+            continue;
+        }
+        if (dumped[i]) {
+            ds.AddZipEntry("lshal-debug/" + clean_names[i] + ".txt", paths[i]);
+        }
+        unlink(paths[i].c_str());
     }
 }
 
@@ -1980,24 +2082,43 @@ Dumpstate::RunStatus Dumpstate::DumpTraces(const char** path) {
     return RunStatus::OK;
 }
 
-void Dumpstate::DumpstateBoard() {
-    DurationReporter duration_reporter("dumpstate_board()");
-    printf("========================================================\n");
-    printf("== Board\n");
-    printf("========================================================\n");
+// A call to the dumpstate HAL and the board files it writes. It is shared with the thread that
+// makes the call, which outlives DumpstateBoard() if the HAL does not return in time.
+struct Dumpstate::DumpstateBoardCall {
+    using ScopedNativeHandle =
+            std::unique_ptr<native_handle_t, std::function<void(native_handle_t*)>>;
 
-    if (!IsZipping()) {
-        MYLOGD("Not dumping board info because it's not a zipped bugreport\n");
+    std::vector<std::string> paths;
+    std::vector<android::base::ScopeGuard<std::function<void()>>> remover;
+    ScopedNativeHandle handle{nullptr, [](native_handle_t* handle) {
+                                  native_handle_close(handle);
+                                  native_handle_delete(handle);
+                              }};
+    const char* descriptor_to_kill = nullptr;
+    std::chrono::steady_clock::time_point deadline;
+    // Not valid if the HAL could not be called.
+    std::future<bool> result;
+};
+
+// Given that bugreport is required to diagnose failures, it's better to set an arbitrary amount
+// of timeout for IDumpstateDevice than to block the rest of bugreport. In the timeout case, we
+// will kill the HAL and grab whatever it dumped in time.
+static constexpr size_t kDumpstateBoardTimeoutSec = 30;
+
+void Dumpstate::StartDumpstateBoard() {
+    if (!IsZipping() || dumpstate_board_call_ != nullptr) {
         return;
     }
+    DurationReporter duration_reporter("START DUMPSTATE BOARD", true);
+    auto call = std::make_shared<DumpstateBoardCall>();
+    dumpstate_board_call_ = call;
 
-    std::vector<std::string> paths;
-    std::vector<android::base::ScopeGuard<std::function<void()>>> remover;
     for (int i = 0; i < NUM_OF_DUMPS; i++) {
-        paths.emplace_back(StringPrintf("%s/%s", ds.bugreport_internal_dir_.c_str(),
-                                        kDumpstateBoardFiles[i].c_str()));
-        remover.emplace_back(android::base::make_scope_guard(
-            std::bind([](std::string path) { android::os::UnlinkAndLogOnError(path); }, paths[i])));
+        call->paths.emplace_back(StringPrintf("%s/%s", ds.bugreport_internal_dir_.c_str(),
+                                              kDumpstateBoardFiles[i].c_str()));
+        call->remover.emplace_back(android::base::make_scope_guard(
+            std::bind([](std::string path) { android::os::UnlinkAndLogOnError(path); },
+                      call->paths[i])));
     }
 
     sp<IDumpstateDevice_1_0> dumpstate_device_1_0(IDumpstateDevice_1_0::getService());
@@ -2006,50 +2127,40 @@ void Dumpstate::DumpstateBoard() {
         return;
     }
 
-    using ScopedNativeHandle =
-            std::unique_ptr<native_handle_t, std::function<void(native_handle_t*)>>;
-    ScopedNativeHandle handle(native_handle_create(static_cast<int>(paths.size()), 0),
-                              [](native_handle_t* handle) {
-                                  native_handle_close(handle);
-                                  native_handle_delete(handle);
-                              });
-    if (handle == nullptr) {
+    call->handle.reset(native_handle_create(static_cast<int>(call->paths.size()), 0));
+    if (call->handle == nullptr) {
         MYLOGE("Could not create native_handle\n");
         return;
     }
 
     // TODO(128270426): Check for consent in between?
-    for (size_t i = 0; i < paths.size(); i++) {
-        MYLOGI("Calling IDumpstateDevice implementation using path %s\n", paths[i].c_str());
+    for (size_t i = 0; i < call->paths.size(); i++) {
+        MYLOGI("Calling IDumpstateDevice implementation using path %s\n", call->paths[i].c_str());
 
         android::base::unique_fd fd(TEMP_FAILURE_RETRY(
-            open(paths[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
+            open(call->paths[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
                  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)));
         if (fd < 0) {
-            MYLOGE("Could not open file %s: %s\n", paths[i].c_str(), strerror(errno));
+            MYLOGE("Could not open file %s: %s\n", call->paths[i].c_str(), strerror(errno));
             return;
         }
-        handle.get()->data[i] = fd.release();
+        call->handle.get()->data[i] = fd.release();
     }
 
-    // Given that bugreport is required to diagnose failures, it's better to set an arbitrary amount
-    // of timeout for IDumpstateDevice than to block the rest of bugreport. In the timeout case, we
-    // will kill the HAL and grab whatever it dumped in time.
-    constexpr size_t timeout_sec = 30;
     // Prefer version 1.1 if available. New devices launching with R are no longer allowed to
     // implement just 1.0.
-    const char* descriptor_to_kill;
     using DumpstateBoardTask = std::packaged_task<bool()>;
     DumpstateBoardTask dumpstate_board_task;
     sp<IDumpstateDevice_1_1> dumpstate_device_1_1(
         IDumpstateDevice_1_1::castFrom(dumpstate_device_1_0));
     if (dumpstate_device_1_1 != nullptr) {
         MYLOGI("Using IDumpstateDevice v1.1");
-        descriptor_to_kill = IDumpstateDevice_1_1::descriptor;
-        dumpstate_board_task = DumpstateBoardTask([this, dumpstate_device_1_1, &handle]() -> bool {
+        call->descriptor_to_kill = IDumpstateDevice_1_1::descriptor;
+        dumpstate_board_task = DumpstateBoardTask([dumpstate_device_1_1, call,
+                                                   mode = options_->dumpstate_hal_mode]() -> bool {
             ::android::hardware::Return<DumpstateStatus> status =
-                dumpstate_device_1_1->dumpstateBoard_1_1(handle.get(), options_->dumpstate_hal_mode,
-                                                         SEC_TO_MSEC(timeout_sec));
+                dumpstate_device_1_1->dumpstateBoard_1_1(call->handle.get(), mode,
+                                                         SEC_TO_MSEC(kDumpstateBoardTimeoutSec));
             if (!status.isOk()) {
                 MYLOGE("dumpstateBoard failed: %s\n", status.description().c_str());
                 return false;
@@ -2061,10 +2172,10 @@ void Dumpstate::DumpstateBoard() {
         });
     } else {
         MYLOGI("Using IDumpstateDevice v1.0");
-        descriptor_to_kill = IDumpstateDevice_1_0::descriptor;
-        dumpstate_board_task = DumpstateBoardTask([dumpstate_device_1_0, &handle]() -> bool {
+        call->descriptor_to_kill = IDumpstateDevice_1_0::descriptor;
+        dumpstate_board_task = DumpstateBoardTask([dumpstate_device_1_0, call]() -> bool {
             ::android::hardware::Return<void> status =
-                dumpstate_device_1_0->dumpstateBoard(handle.get());
+                dumpstate_device_1_0->dumpstateBoard(call->handle.get());
             if (!status.isOk()) {
                 MYLOGE("dumpstateBoard failed: %s\n", status.description().c_str());
                 return false;
@@ -2072,45 +2183,62 @@ void Dumpstate::DumpstateBoard() {
             return true;
         });
     }
-    auto result = dumpstate_board_task.get_future();
+    call->deadline = std::chrono::steady_clock::now() +
+            std::chrono::seconds(kDumpstateBoardTimeoutSec);
+    call->result = dumpstate_board_task.get_future();
     std::thread(std::move(dumpstate_board_task)).detach();
+}
 
-    if (result.wait_for(std::chrono::seconds(timeout_sec)) != std::future_status::ready) {
-        MYLOGE("dumpstateBoard timed out after %zus, killing dumpstate vendor HAL\n", timeout_sec);
+void Dumpstate::DumpstateBoard() {
+    DurationReporter duration_reporter("dumpstate_board()");
+    printf("========================================================\n");
+    printf("== Board\n");
+    printf("========================================================\n");
+
+    if (!IsZipping()) {
+        MYLOGD("Not dumping board info because it's not a zipped bugreport\n");
+        return;
+    }
+
+    // The HAL is normally started early, so that it runs while the rest of the bugreport is taken
+    // and its timeout only delays the bugreport by however much the HAL is slower than the rest.
+    StartDumpstateBoard();
+    std::shared_ptr<DumpstateBoardCall> call = std::move(dumpstate_board_call_);
+    // Removes the board files when this returns, even if the HAL is still writing them.
+    auto remover = std::move(call->remover);
+    if (!call->result.valid()) {
+        return;
+    }
+
+    if (call->result.wait_until(call->deadline) != std::future_status::ready) {
+        MYLOGE("dumpstateBoard timed out after %zus, killing dumpstate vendor HAL\n",
+               kDumpstateBoardTimeoutSec);
         if (!android::base::SetProperty(
                 "ctl.interface_restart",
-                android::base::StringPrintf("%s/default", descriptor_to_kill))) {
+                android::base::StringPrintf("%s/default", call->descriptor_to_kill))) {
             MYLOGE("Couldn't restart dumpstate HAL\n");
         }
     }
     // Wait some time for init to kill dumpstate vendor HAL
     constexpr size_t killing_timeout_sec = 10;
-    if (result.wait_for(std::chrono::seconds(killing_timeout_sec)) != std::future_status::ready) {
+    if (call->result.wait_for(std::chrono::seconds(killing_timeout_sec)) !=
+        std::future_status::ready) {
         MYLOGE("killing dumpstateBoard timed out after %zus, continue and "
                "there might be racing in content\n", killing_timeout_sec);
     }
 
-    auto file_sizes = std::make_unique<ssize_t[]>(paths.size());
-    for (size_t i = 0; i < paths.size(); i++) {
+    for (size_t i = 0; i < call->paths.size(); i++) {
         struct stat s;
-        if (fstat(handle.get()->data[i], &s) == -1) {
+        if (fstat(call->handle.get()->data[i], &s) == -1) {
             MYLOGE("Failed to fstat %s: %s\n", kDumpstateBoardFiles[i].c_str(),
                    strerror(errno));
-            file_sizes[i] = -1;
-            continue;
-        }
-        file_sizes[i] = s.st_size;
-    }
-
-    for (size_t i = 0; i < paths.size(); i++) {
-        if (file_sizes[i] == -1) {
             continue;
         }
-        if (file_sizes[i] == 0) {
+        if (s.st_size == 0) {
             MYLOGE("Ignoring empty %s\n", kDumpstateBoardFiles[i].c_str());
             continue;
         }
-        AddZipEntry(kDumpstateBoardFiles[i], paths[i]);
+        AddZipEntry(kDumpstateBoardFiles[i], call->paths[i]);
         printf("*** See %s entry ***\n", kDumpstateBoardFiles[i].c_str());
     }
 }
@@ -2118,7 +2246,7 @@ void Dumpstate::DumpstateBoard() {
 static void ShowUsage() {
     fprintf(stderr,
             "usage: dumpstate [-h] [-b soundfile] [-e soundfile] [-o directory] [-d] [-p] "
-            "[-z] [-s] [-S] [-q] [-P] [-R] [-L] [-V version]\n"
+            "[-z] [-s] [-S] [-Z] [-q] [-P] [-R] [-L] [-V version]\n"
             "  -h: display this help message\n"
             "  -b: play sound file instead of vibrate, at beginning of job\n"
             "  -e: play sound file instead of vibrate, at end of job\n"
@@ -2128,6 +2256,8 @@ static void ShowUsage() {
             "  -z: generate zipped file\n"
             "  -s: write output to control socket (for init)\n"
             "  -S: write file location to control socket (for init; requires -z)\n"
+            "  -Z: stream zipped file to control socket as it is generated (for init; "
+            "requires -z)\n"
             "  -q: disable vibrate\n"
             "  -P: send broadcast when started and do progress updates\n"
             "  -R: take bugreport in remote mode (requires -z and -d, shouldn't be used with -P)\n"
@@ -2265,7 +2395,13 @@ static void PrepareToWriteToFile() {
         destination.c_str(), ds.base_name_.c_str(), ds.name_.c_str(), ds.log_path_.c_str(),
         ds.tmp_path_.c_str(), ds.screenshot_path_.c_str());
 
-    if (ds.options_->do_zip_file) {
+    if (ds.options_->stream_to_socket) {
+        // The socket was opened by RunInternal(); ZipWriter writes data descriptors and the central
+        // directory after the entries, so it never needs to seek back.
+        MYLOGD("Streaming .zip file to the control socket\n");
+        ds.zip_writer_.reset(new ZipWriter(ds.zip_file.get()));
+        ds.AddTextZipEntry("version.txt", ds.version_);
+    } else if (ds.options_->do_zip_file) {
         ds.path_ = ds.GetPath(ds.CalledByApi() ? "-zip.tmp" : ".zip");
         MYLOGD("Creating initial .zip file (%s)\n", ds.path_.c_str());
         create_parent_dirs(ds.path_.c_str());
@@ -2382,12 +2518,14 @@ static void SetOptionsFromMode(Dumpstate::BugreportMode mode, Dumpstate::DumpOpt
 
 static void LogDumpOptions(const Dumpstate::DumpOptions& options) {
     MYLOGI(
-        "do_zip_file: %d do_vibrate: %d use_socket: %d use_control_socket: %d do_screenshot: %d "
+        "do_zip_file: %d do_vibrate: %d use_socket: %d use_control_socket: %d "
+        "stream_to_socket: %d do_screenshot: %d "
         "is_remote_mode: %d show_header_only: %d do_start_service: %d telephony_only: %d "
         "wifi_only: %d do_progress_updates: %d fd: %d bugreport_mode: %s dumpstate_hal_mode: %s "
         "limited_only: %d args: %s\n",
         options.do_zip_file, options.do_vibrate, options.use_socket, options.use_control_socket,
-        options.do_screenshot, options.is_remote_mode, options.show_header_only,
+        options.stream_to_socket, options.do_screenshot, options.is_remote_mode,
+        options.show_header_only,
         options.do_start_service, options.telephony_only, options.wifi_only,
         options.do_progress_updates, options.bugreport_fd.get(), options.bugreport_mode.c_str(),
         toString(options.dumpstate_hal_mode).c_str(), options.limited_only, options.args.c_str());
@@ -2412,7 +2550,7 @@ void Dumpstate::DumpOptions::Initialize(BugreportMode bugreport_mode,
 Dumpstate::RunStatus Dumpstate::DumpOptions::Initialize(int argc, char* argv[]) {
     RunStatus status = RunStatus::OK;
     int c;
-    while ((c = getopt(argc, argv, "dho:svqzpLPBRSV:w")) != -1) {
+    while ((c = getopt(argc, argv, "dho:svqzpLPBRSZV:w")) != -1) {
         switch (c) {
             // clang-format off
             case 'd': do_add_date = true;            break;
@@ -2420,6 +2558,7 @@ Dumpstate::RunStatus Dumpstate::DumpOptions::Initialize(int argc, char* argv[])
             case 'o': out_dir = optarg;              break;
             case 's': use_socket = true;             break;
             case 'S': use_control_socket = true;     break;
+            case 'Z': stream_to_socket = true;       break;
             case 'v': show_header_only = true;       break;
             case 'q': do_vibrate = false;            break;
             case 'p': do_screenshot = true;          break;
@@ -2467,6 +2606,13 @@ bool Dumpstate::DumpOptions::ValidateOptions() const {
         return false;
     }
 
+    // The streamed zip is the only thing written to the socket, and it is not staged in a file that
+    // could be copied elsewhere.
+    if (stream_to_socket && (!do_zip_file || use_socket || use_control_socket ||
+                             bugreport_fd.get() != -1 || !out_dir.empty())) {
+        return false;
+    }
+
     if (is_remote_mode && (do_progress_updates || !do_zip_file || !do_add_date)) {
         return false;
     }
@@ -2638,6 +2784,21 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         options_->do_progress_updates = 1;
     }
 
+    if (options_->stream_to_socket) {
+        MYLOGD("Opening control socket to stream the zipped bugreport\n");
+        int fd = open_socket("dumpstate");
+        if (fd == -1) {
+            return ERROR;
+        }
+        // The zip file owns the socket, which is closed once the zip is finished.
+        zip_file.reset(fdopen(fd, "wb"));
+        if (zip_file == nullptr) {
+            MYLOGE("fdopen(control socket): %s\n", strerror(errno));
+            close(fd);
+            return ERROR;
+        }
+    }
+
     if (is_redirecting) {
         PrepareToWriteToFile();
 
@@ -2666,7 +2827,7 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         Vibrate(150);
     }
 
-    if (options_->do_zip_file && zip_file != nullptr) {
+    if (options_->do_zip_file && !options_->stream_to_socket && zip_file != nullptr) {
         if (chown(path_.c_str(), AID_SHELL, AID_SHELL)) {
             MYLOGE("Unable to change ownership of zip file %s: %s\n", path_.c_str(),
                    strerror(errno));
@@ -2715,6 +2876,7 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         MaybeTakeEarlyScreenshot();
         onUiIntensiveBugreportDumpsFinished(calling_uid, calling_package);
         MaybeCheckUserConsent(calling_uid, calling_package);
+        StartDumpstateBoard();
         DumpstateTelephonyOnly(calling_package);
         DumpstateBoard();
     } else if (options_->wifi_only) {
@@ -2735,6 +2897,7 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         MaybeTakeEarlyScreenshot();
         onUiIntensiveBugreportDumpsFinished(calling_uid, calling_package);
         MaybeCheckUserConsent(calling_uid, calling_package);
+        StartDumpstateBoard();
 
         // Dump state for the default case. This also drops root.
         RunStatus s = DumpstateDefaultAfterCritical();
@@ -2874,6 +3037,7 @@ void Dumpstate::CleanupTmpFiles() {
 Dumpstate::RunStatus Dumpstate::HandleUserConsentDenied() {
     MYLOGD("User denied consent; deleting files and returning\n");
     CleanupTmpFiles();
+    dumpstate_board_call_.reset();
     return USER_CONSENT_DENIED;
 }
 
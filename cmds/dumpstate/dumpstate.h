@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -304,6 +305,11 @@ class Dumpstate {
     // Returns OK in all other cases.
     RunStatus DumpTraces(const char** path);
 
+    // Starts calling the dumpstate HAL on a background thread, so that it runs concurrently with
+    // the rest of the bugreport.
+    void StartDumpstateBoard();
+
+    // Waits for the dumpstate HAL, starting it first if needed, and adds the board files to the zip.
     void DumpstateBoard();
 
     /*
@@ -370,6 +376,9 @@ class Dumpstate {
         // Writes bugreport content to a socket; only flatfile format is supported.
         bool use_socket = false;
         bool use_control_socket = false;
+        // Streams the zipped bugreport through a socket as entries are added, instead of staging it
+        // in a file; the text content is still written to a file until it is zipped.
+        bool stream_to_socket = false;
         bool do_screenshot = false;
         bool is_screenshot_copied = false;
         bool is_remote_mode = false;
@@ -539,6 +548,10 @@ class Dumpstate {
 
     android::sp<ConsentCallback> consent_callback_;
 
+    struct DumpstateBoardCall;
+    // The dumpstate HAL call started by StartDumpstateBoard(), until DumpstateBoard() collects it.
+    std::shared_ptr<DumpstateBoardCall> dumpstate_board_call_;
+
     DISALLOW_COPY_AND_ASSIGN(Dumpstate);
 };
 
@@ -15,8 +15,11 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <iomanip>
+#include <mutex>
 #include <thread>
 
 #include <android-base/file.h>
@@ -35,6 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -60,17 +64,22 @@ static void usage() {
             "usage: dumpsys\n"
             "         To dump all services.\n"
             "or:\n"
-            "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--pid] [--help | -l | --skip SERVICES "
+            "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--pid] [--binder-stats] "
+            "[--parallel JOBS] [--help | -l | --skip SERVICES "
             "| SERVICE [ARGS]]\n"
             "         --help: shows this help\n"
             "         -l: only list services, do not dump them\n"
             "         -t TIMEOUT_SEC: TIMEOUT to use in seconds instead of default 10 seconds\n"
             "         -T TIMEOUT_MS: TIMEOUT to use in milliseconds instead of default 10 seconds\n"
             "         --pid: dump PID instead of usual dump\n"
+            "         --binder-stats: dump binder transaction latency histograms of the\n"
+            "               service's process instead of usual dump\n"
             "         --proto: filter services that support dumping data in proto format. Dumps\n"
             "               will be in proto format.\n"
             "         --priority LEVEL: filter services based on specified priority\n"
             "               LEVEL must be one of CRITICAL | HIGH | NORMAL\n"
+            "         --parallel JOBS: dumps up to JOBS services at the same time, keeping the\n"
+            "               output in the usual order\n"
             "         --skip SERVICES: dumps all services but SERVICES (comma-separated list)\n"
             "         SERVICE [ARGS]: dumps only service SERVICE, optionally passing ARGS to it\n");
 }
@@ -125,9 +134,12 @@ int Dumpsys::main(int argc, char* const argv[]) {
     Type type = Type::DUMP;
     int timeoutArgMs = 10000;
     int priorityFlags = IServiceManager::DUMP_FLAG_PRIORITY_ALL;
+    int parallelJobs = 1;
     static struct option longOptions[] = {{"pid", no_argument, 0, 0},
+                                          {"binder-stats", no_argument, 0, 0},
                                           {"priority", required_argument, 0, 0},
                                           {"proto", no_argument, 0, 0},
+                                          {"parallel", required_argument, 0, 0},
                                           {"skip", no_argument, 0, 0},
                                           {"help", no_argument, 0, 0},
                                           {0, 0, 0, 0}};
@@ -163,6 +175,15 @@ int Dumpsys::main(int argc, char* const argv[]) {
                 }
             } else if (!strcmp(longOptions[optionIndex].name, "pid")) {
                 type = Type::PID;
+            } else if (!strcmp(longOptions[optionIndex].name, "binder-stats")) {
+                type = Type::BINDER_STATS;
+            } else if (!strcmp(longOptions[optionIndex].name, "parallel")) {
+                char* endptr;
+                parallelJobs = strtol(optarg, &endptr, 10);
+                if (*endptr != '\0' || parallelJobs <= 0) {
+                    fprintf(stderr, "Error: invalid number of parallel jobs: '%s'\n", optarg);
+                    return -1;
+                }
             }
             break;
 
@@ -248,6 +269,34 @@ int Dumpsys::main(int argc, char* const argv[]) {
         return 0;
     }
 
+    if (parallelJobs > 1 && N > 1) {
+        Vector<String16> dumpedServices;
+        for (const auto& serviceName : services) {
+            if (!IsSkipped(skippedServices, serviceName)) {
+                dumpedServices.add(serviceName);
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto stats = dumpServicesInParallel(STDOUT_FILENO, type, dumpedServices, args,
+                                            priorityFlags, std::chrono::milliseconds(timeoutArgMs),
+                                            asProto, /* addSeparator = */ true,
+                                            static_cast<size_t>(parallelJobs));
+        std::chrono::duration<double> elapsedDuration = std::chrono::steady_clock::now() - start;
+        auto slowest = std::max_element(stats.begin(), stats.end(),
+                                        [](const ServiceDumpStats& a, const ServiceDumpStats& b) {
+                                            return a.elapsedDuration < b.elapsedDuration;
+                                        });
+        if (!asProto && slowest != stats.end()) {
+            std::cout << StringPrintf("--------- %.3fs was the duration of dumpsys for %zu "
+                                      "services with %d parallel jobs, slowest: %s (%.3fs)",
+                                      elapsedDuration.count(), stats.size(), parallelJobs,
+                                      String8(slowest->serviceName).c_str(),
+                                      slowest->elapsedDuration.count())
+                      << std::endl;
+        }
+        return 0;
+    }
+
     for (size_t i = 0; i < N; i++) {
         const String16& serviceName = services[i];
         if (IsSkipped(skippedServices, serviceName)) continue;
@@ -329,6 +378,16 @@ static status_t dumpPidToFd(const sp<IBinder>& service, const unique_fd& fd) {
      return OK;
 }
 
+static status_t dumpBinderStatsToFd(const sp<IBinder>& service, const unique_fd& fd) {
+     String16 stats;
+     status_t status = service->getDebugBinderStats(&stats);
+     if (status != OK) {
+         return status;
+     }
+     WriteStringToFd(String8(stats).c_str(), fd.get());
+     return OK;
+}
+
 status_t Dumpsys::startDumpThread(Type type, const String16& serviceName,
                                   const Vector<String16>& args) {
     sp<IBinder> service = sm_->checkService(serviceName);
@@ -359,6 +418,9 @@ status_t Dumpsys::startDumpThread(Type type, const String16& serviceName,
         case Type::PID:
             err = dumpPidToFd(service, remote_end);
             break;
+        case Type::BINDER_STATS:
+            err = dumpBinderStatsToFd(service, remote_end);
+            break;
         default:
             std::cerr << "Unknown dump type" << static_cast<int>(type) << std::endl;
             return;
@@ -372,6 +434,99 @@ status_t Dumpsys::startDumpThread(Type type, const String16& serviceName,
     return OK;
 }
 
+static bool copyFdFromStart(int srcFd, int dstFd) {
+    if (lseek(srcFd, 0, SEEK_SET) == -1) {
+        return false;
+    }
+    char buf[4096];
+    while (true) {
+        ssize_t rc = TEMP_FAILURE_RETRY(read(srcFd, buf, sizeof(buf)));
+        if (rc < 0) {
+            return false;
+        } else if (rc == 0) {
+            return true;
+        }
+        if (!WriteFully(dstFd, buf, rc)) {
+            return false;
+        }
+    }
+}
+
+std::vector<Dumpsys::ServiceDumpStats> Dumpsys::dumpServicesInParallel(
+        int fd, Type type, const Vector<String16>& services, const Vector<String16>& args,
+        int priorityFlags, std::chrono::milliseconds timeout, bool asProto, bool addSeparator,
+        size_t maxThreads) const {
+    struct Result {
+        bool done = false;
+        unique_fd bufferFd;
+        ServiceDumpStats stats;
+    };
+    const size_t count = services.size();
+    std::vector<Result> results(count);
+    std::mutex lock;
+    std::condition_variable condition;
+    std::atomic<size_t> nextService{0};
+
+    auto dumpServices = [&]() {
+        // Each worker owns its own dump thread and pipe.
+        Dumpsys dumpsys(sm_);
+        for (size_t i = nextService++; i < count; i = nextService++) {
+            const String16& serviceName = services[i];
+            ServiceDumpStats stats{serviceName, OK, std::chrono::duration<double>(0), 0};
+            unique_fd bufferFd(memfd_create("dumpsys", MFD_CLOEXEC));
+            if (bufferFd == -1) {
+                std::cerr << "Failed to create buffer to dump service " << serviceName << ": "
+                          << strerror(errno) << std::endl;
+                stats.status = -errno;
+            } else {
+                stats.status = dumpsys.startDumpThread(type, serviceName, args);
+                if (stats.status == OK) {
+                    if (addSeparator) {
+                        writeDumpHeader(bufferFd.get(), serviceName, priorityFlags);
+                    }
+                    stats.status = dumpsys.writeDump(bufferFd.get(), serviceName, timeout, asProto,
+                                                     stats.elapsedDuration, stats.bytesWritten);
+                    if (addSeparator) {
+                        writeDumpFooter(bufferFd.get(), serviceName, stats.elapsedDuration);
+                    }
+                    dumpsys.stopDumpThread(stats.status == OK);
+                }
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            results[i].bufferFd = std::move(bufferFd);
+            results[i].stats = stats;
+            results[i].done = true;
+            condition.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(maxThreads, count); i++) {
+        workers.emplace_back(dumpServices);
+    }
+
+    std::vector<ServiceDumpStats> stats;
+    stats.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        unique_fd bufferFd;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            condition.wait(guard, [&]() { return results[i].done; });
+            bufferFd = std::move(results[i].bufferFd);
+            stats.push_back(results[i].stats);
+        }
+        if (bufferFd != -1 && !copyFdFromStart(bufferFd.get(), fd)) {
+            std::cerr << "Failed to write while dumping service " << services[i] << ": "
+                      << strerror(errno) << std::endl;
+        }
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return stats;
+}
+
 void Dumpsys::stopDumpThread(bool dumpComplete) {
     if (dumpComplete) {
         activeThread_.join();
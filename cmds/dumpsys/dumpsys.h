@@ -18,6 +18,7 @@
 #define FRAMEWORK_NATIVE_CMD_DUMPSYS_H_
 
 #include <thread>
+#include <vector>
 
 #include <android-base/unique_fd.h>
 #include <binder/IServiceManager.h>
@@ -54,6 +55,7 @@ class Dumpsys {
     enum class Type {
         DUMP,  // dump using `dump` function
         PID,   // dump pid of server only
+        BINDER_STATS, // dump binder transaction histograms of the server process
     };
 
     /**
@@ -106,6 +108,37 @@ class Dumpsys {
     void writeDumpFooter(int fd, const String16& serviceName,
                          const std::chrono::duration<double>& elapsedDuration) const;
 
+    struct ServiceDumpStats {
+        String16 serviceName;
+        status_t status;
+        std::chrono::duration<double> elapsedDuration;
+        size_t bytesWritten;
+    };
+
+    /**
+     * Dumps several services concurrently. Each service is dumped by one of up to
+     * {@code maxThreads} workers into its own in-memory buffer, and the buffers are copied to
+     * {@code fd} in the order of {@code services} as soon as they are complete, so the output is
+     * identical to dumping the services one after another.
+     * @param fd file descriptor to write data
+     * @param services services to dump, in output order
+     * @param args list of arguments to pass to each service dump method.
+     * @param priorityFlags dump priority specified, used for the section headers
+     * @param timeout timeout to terminate each service dump if not completed
+     * @param asProto used to supresses additional output to the fd such as timeout
+     * error messages
+     * @param addSeparator writes a section header and footer around each service dump
+     * @param maxThreads maximum number of services dumped at the same time
+     * @return per-service results, in the order of {@code services}
+     */
+    std::vector<ServiceDumpStats> dumpServicesInParallel(int fd, Type type,
+                                                         const Vector<String16>& services,
+                                                         const Vector<String16>& args,
+                                                         int priorityFlags,
+                                                         std::chrono::milliseconds timeout,
+                                                         bool asProto, bool addSeparator,
+                                                         size_t maxThreads) const;
+
     /**
      * Terminates dump thread.
      * @param dumpComplete If {@code true}, indicates the dump was successfully completed and
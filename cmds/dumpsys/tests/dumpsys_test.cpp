@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 
 #include <android-base/file.h>
+#include <binder/BinderStats.h>
 #include <serviceutils/PriorityDumper.h>
 #include <utils/String16.h>
 #include <utils/String8.h>
@@ -237,6 +238,15 @@ class DumpsysTest : public Test {
         EXPECT_THAT(stdout_, HasSubstr("was the duration of dumpsys " + service + ", ending at: "));
     }
 
+    void AssertDumpOrder(const std::vector<std::string>& services) {
+        size_t position = 0;
+        for (const std::string& service : services) {
+            size_t next = stdout_.find("DUMP OF SERVICE " + service + ":\n", position);
+            EXPECT_THAT(next, Not(Eq(std::string::npos))) << service << " is out of order";
+            position = next;
+        }
+    }
+
     void AssertNotDumped(const std::string& dump) {
         EXPECT_THAT(stdout_, Not(HasSubstr(dump)));
     }
@@ -426,6 +436,27 @@ TEST_F(DumpsysTest, DumpMultipleServices) {
     AssertDumped("running3", "dump3");
 }
 
+// Tests 'dumpsys --parallel 3', which should keep the output in service order even when the first
+// service finishes last
+TEST_F(DumpsysTest, DumpMultipleServicesInParallel) {
+    ExpectListServices({"running1", "stopped2", "running3", "running4"});
+    ExpectDumpAndHang("running1", 1, "dump1");
+    ExpectCheckService("stopped2", false);
+    ExpectDump("running3", "dump3");
+    ExpectDump("running4", "dump4");
+
+    CallMain({"--parallel", "3"});
+
+    AssertRunningServices({"running1", "running3", "running4"});
+    AssertDumped("running1", "dump1");
+    AssertStopped("stopped2");
+    AssertDumped("running3", "dump3");
+    AssertDumped("running4", "dump4");
+    AssertOutputContains("was the duration of dumpsys for 3 services with 3 parallel jobs, "
+                         "slowest: running1");
+    AssertDumpOrder({"running1", "running3", "running4"});
+}
+
 // Tests 'dumpsys --skip skipped3 skipped5', which should skip these services
 TEST_F(DumpsysTest, DumpWithSkip) {
     ExpectListServices({"running1", "stopped2", "skipped3", "running4", "skipped5"});
@@ -561,6 +592,17 @@ TEST_F(DumpsysTest, ListServiceWithPid) {
     AssertOutput(std::to_string(getpid()) + "\n");
 }
 
+// Tests 'dumpsys --binder-stats service_name'
+TEST_F(DumpsysTest, ListServiceWithBinderStats) {
+    ExpectCheckService("Locksmith");
+
+    BinderStats::setEnabled(true);
+    CallMain({"--binder-stats", "Locksmith"});
+    BinderStats::setEnabled(false);
+
+    AssertOutputContains("Binder stats for pid " + std::to_string(getpid()));
+}
+
 TEST_F(DumpsysTest, GetBytesWritten) {
     const char* serviceName = "service2";
     const char* dumpContents = "dump1";
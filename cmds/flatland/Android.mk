@@ -6,6 +6,7 @@ LOCAL_SRC_FILES:=   \
     Composers.cpp   \
     GLHelper.cpp    \
     Renderers.cpp   \
+    Scenarios.cpp   \
     Main.cpp        \
 
 LOCAL_CFLAGS := -Wall -Werror
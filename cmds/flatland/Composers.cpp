@@ -25,13 +25,17 @@ namespace android {
 class Blitter {
 public:
 
-    bool setUp(GLHelper* helper) {
+    // Programs other than "Blit" must share its attributes and uniforms, and
+    // may add their own through program().
+    bool setUp(GLHelper* helper, const char* pgmName = "Blit",
+            GLenum texTarget = GL_TEXTURE_EXTERNAL_OES) {
         bool result;
 
-        result = helper->getShaderProgram("Blit", &mBlitPgm);
+        result = helper->getShaderProgram(pgmName, &mBlitPgm);
         if (!result) {
             return false;
         }
+        mTexTarget = texTarget;
 
         mPosAttribLoc = glGetAttribLocation(mBlitPgm, "position");
         mUVAttribLoc = glGetAttribLocation(mBlitPgm, "uv");
@@ -84,7 +88,7 @@ public:
         glUniform4fv(mModColorUniformLoc, 1, modColor);
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_EXTERNAL_OES, texName);
+        glBindTexture(mTexTarget, texName);
         glUniform1i(mBlitSrcSamplerLoc, 0);
 
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
@@ -99,8 +103,13 @@ public:
         return true;
     }
 
+    GLuint program() const {
+        return mBlitPgm;
+    }
+
 private:
     GLuint mBlitPgm;
+    GLenum mTexTarget;
     GLint mPosAttribLoc;
     GLint mUVAttribLoc;
     GLint mUVToTexUniformLoc;
@@ -282,4 +291,227 @@ Composer* blendShrink() {
     return new BlendShrinkComp();
 }
 
+// An opaque layer clipped to a rounded rectangle, as for windows in recents or
+// with display cutouts.
+Composer* roundedCorners() {
+    class RoundedCornersComp : public ComposerBase {
+        virtual bool setUp(GLHelper* helper) {
+            bool result;
+
+            result = mBlitter.setUp(helper, "RoundedBlit");
+            if (!result) {
+                return false;
+            }
+
+            GLuint pgm = mBlitter.program();
+            mCropCenterUniformLoc = glGetUniformLocation(pgm, "cropCenter");
+            mCropHalfSizeUniformLoc = glGetUniformLocation(pgm, "cropHalfSize");
+            mCornerRadiusUniformLoc = glGetUniformLocation(pgm, "cornerRadius");
+
+            return true;
+        }
+
+        virtual bool compose(GLuint texName, const sp<GLConsumer>& glc) {
+            bool result;
+
+            float texMatrix[16];
+            glc->getTransformMatrix(texMatrix);
+
+            int32_t x = mLayerDesc.x;
+            int32_t y = mLayerDesc.y;
+            int32_t w = mLayerDesc.width;
+            int32_t h = mLayerDesc.height;
+
+            glUseProgram(mBlitter.program());
+            glUniform2f(mCropCenterUniformLoc, float(x) + float(w) * 0.5f,
+                    float(y) + float(h) * 0.5f);
+            glUniform2f(mCropHalfSizeUniformLoc, float(w) * 0.5f,
+                    float(h) * 0.5f);
+            glUniform1f(mCornerRadiusUniformLoc, mLayerDesc.cornerRadius);
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+            result = mBlitter.blit(texName, texMatrix, x, y, w, h);
+            if (!result) {
+                return false;
+            }
+
+            glDisable(GL_BLEND);
+
+            return true;
+        }
+
+        Blitter mBlitter;
+        GLint mCropCenterUniformLoc;
+        GLint mCropHalfSizeUniformLoc;
+        GLint mCornerRadiusUniformLoc;
+    };
+    return new RoundedCornersComp();
+}
+
+// A translucent layer over a blurred copy of whatever was composed behind it,
+// as for the notification shade or dialogs with background blur.
+Composer* backgroundBlur() {
+    class BackgroundBlurComp : public ComposerBase {
+        virtual bool setUp(GLHelper* helper) {
+            bool result;
+
+            result = mBlitter.setUp(helper);
+            if (!result) {
+                return false;
+            }
+
+            result = mBlurBlitter.setUp(helper, "Blur", GL_TEXTURE_2D);
+            if (!result) {
+                return false;
+            }
+
+            mTexelStepUniformLoc = glGetUniformLocation(mBlurBlitter.program(),
+                    "texelStep");
+
+            glGenTextures(1, &mBlurTexName);
+            glBindTexture(GL_TEXTURE_2D, mBlurTexName);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mLayerDesc.width,
+                    mLayerDesc.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+            if (glGetError() != GL_NO_ERROR) {
+                fprintf(stderr, "error creating blur texture\n");
+                return false;
+            }
+
+            return true;
+        }
+
+        virtual void tearDown() {
+            glDeleteTextures(1, &mBlurTexName);
+        }
+
+        virtual bool compose(GLuint texName, const sp<GLConsumer>& glc) {
+            bool result;
+
+            result = blurBackground();
+            if (!result) {
+                return false;
+            }
+
+            float texMatrix[16];
+            glc->getTransformMatrix(texMatrix);
+
+            float modColor[4] = { .75f, .75f, .75f, .75f };
+
+            int32_t x = mLayerDesc.x;
+            int32_t y = mLayerDesc.y;
+            int32_t w = mLayerDesc.width;
+            int32_t h = mLayerDesc.height;
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+            result = mBlitter.modBlit(texName, texMatrix, modColor,
+                    x, y, w, h);
+            if (!result) {
+                return false;
+            }
+
+            glDisable(GL_BLEND);
+
+            return true;
+        }
+
+        // Copies the part of the framebuffer under the layer and draws it
+        // back blurred.
+        bool blurBackground() {
+            GLint vp[4];
+            glGetIntegerv(GL_VIEWPORT, vp);
+
+            int32_t x0 = mLayerDesc.x > 0 ? mLayerDesc.x : 0;
+            int32_t y0 = mLayerDesc.y > 0 ? mLayerDesc.y : 0;
+            int32_t x1 = mLayerDesc.x + int32_t(mLayerDesc.width);
+            int32_t y1 = mLayerDesc.y + int32_t(mLayerDesc.height);
+            x1 = x1 < vp[2] ? x1 : vp[2];
+            y1 = y1 < vp[3] ? y1 : vp[3];
+            if (x1 <= x0 || y1 <= y0) {
+                return true;
+            }
+            uint32_t w = x1 - x0;
+            uint32_t h = y1 - y0;
+
+            // The framebuffer origin is at the bottom left, so the copy is
+            // flipped relative to the screen space the blitter draws in.
+            glBindTexture(GL_TEXTURE_2D, mBlurTexName);
+            glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, x0, vp[3] - y1, w, h);
+
+            float sx = float(w) / float(mLayerDesc.width);
+            float sy = float(h) / float(mLayerDesc.height);
+            float texMatrix[16] = {
+                sx,     0.0f,   0.0f,   0.0f,
+                0.0f,   -sy,    0.0f,   0.0f,
+                0.0f,   0.0f,   1.0f,   0.0f,
+                0.0f,   sy,     0.0f,   1.0f,
+            };
+
+            glUseProgram(mBlurBlitter.program());
+            glUniform2f(mTexelStepUniformLoc,
+                    mLayerDesc.blurRadius / float(mLayerDesc.width),
+                    mLayerDesc.blurRadius / float(mLayerDesc.height));
+
+            return mBlurBlitter.blit(mBlurTexName, texMatrix, x0, y0, w, h);
+        }
+
+        Blitter mBlitter;
+        Blitter mBlurBlitter;
+        GLint mTexelStepUniformLoc;
+        GLuint mBlurTexName;
+    };
+    return new BackgroundBlurComp();
+}
+
+// An opaque PQ encoded layer tone mapped to an SDR display, as for HDR video.
+Composer* hdrToneMap() {
+    class HdrToneMapComp : public ComposerBase {
+        virtual bool setUp(GLHelper* helper) {
+            bool result;
+
+            result = mBlitter.setUp(helper, "HdrBlit");
+            if (!result) {
+                return false;
+            }
+
+            GLuint pgm = mBlitter.program();
+            mInputMaxLuminanceUniformLoc = glGetUniformLocation(pgm,
+                    "inputMaxLuminance");
+            mDisplayMaxLuminanceUniformLoc = glGetUniformLocation(pgm,
+                    "displayMaxLuminance");
+
+            return true;
+        }
+
+        virtual bool compose(GLuint texName, const sp<GLConsumer>& glc) {
+            float texMatrix[16];
+            glc->getTransformMatrix(texMatrix);
+
+            int32_t x = mLayerDesc.x;
+            int32_t y = mLayerDesc.y;
+            int32_t w = mLayerDesc.width;
+            int32_t h = mLayerDesc.height;
+
+            glUseProgram(mBlitter.program());
+            glUniform1f(mInputMaxLuminanceUniformLoc, 1000.0f);
+            glUniform1f(mDisplayMaxLuminanceUniformLoc, 500.0f);
+
+            return mBlitter.blit(texName, texMatrix, x, y, w, h);
+        }
+
+        Blitter mBlitter;
+        GLint mInputMaxLuminanceUniformLoc;
+        GLint mDisplayMaxLuminanceUniformLoc;
+    };
+    return new HdrToneMapComp();
+}
+
 } // namespace android
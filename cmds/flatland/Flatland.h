@@ -20,6 +20,11 @@
 #include <GLES2/gl2.h>
 
 #include <gui/GLConsumer.h>
+#include <gui/Surface.h>
+
+#include <deque>
+#include <string>
+#include <vector>
 
 namespace android {
 
@@ -40,6 +45,43 @@ struct LayerDesc {
     int32_t y;
     uint32_t width;
     uint32_t height;
+
+    // Parameters for the composers that use them, in the same units as the
+    // layer position.
+    float cornerRadius;
+    float blurRadius;
+};
+
+struct BenchmarkDesc {
+    // The name of the test.
+    const char* name;
+
+    // The dimensions of the space in which window layers are specified.
+    uint32_t width;
+    uint32_t height;
+
+    // The screen heights at which to run the test.
+    uint32_t runHeights[MAX_TEST_RUNS];
+
+    // The list of window layers.
+    LayerDesc layers[MAX_NUM_LAYERS];
+};
+
+// A set of benchmarks loaded from a scenario config file.  See README.txt for
+// the file format.
+class ScenarioConfig {
+public:
+    // Loads the scenarios in the file at |path|, printing any parse errors to
+    // stderr.  Returns false if the file could not be read or has errors.
+    bool load(const char* path);
+
+    const BenchmarkDesc* benchmarks() const { return mBenchmarks.data(); }
+    size_t numBenchmarks() const { return mBenchmarks.size(); }
+
+private:
+    // Backing storage for the benchmark names.
+    std::deque<std::string> mNames;
+    std::vector<BenchmarkDesc> mBenchmarks;
 };
 
 void resetColorGenerator();
@@ -57,6 +99,9 @@ Composer* opaque();
 Composer* opaqueShrink();
 Composer* blend();
 Composer* blendShrink();
+Composer* roundedCorners();
+Composer* backgroundBlur();
+Composer* hdrToneMap();
 
 class Renderer {
 public:
@@ -64,8 +109,15 @@ public:
     virtual bool setUp(GLHelper* helper) = 0;
     virtual void tearDown() = 0;
     virtual bool render(EGLSurface surface) = 0;
+
+    // Renderers that fill their buffers on the CPU return the HAL pixel
+    // format they write.  They are given the layer's window through
+    // renderWindow() instead of an EGL surface through render().
+    virtual int cpuBufferFormat() const { return 0; }
+    virtual bool renderWindow(const sp<Surface>& /*window*/) { return false; }
 };
 
 Renderer* staticGradient();
+Renderer* staticYuv();
 
 } // namespace android
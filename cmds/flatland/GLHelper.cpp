@@ -164,6 +164,44 @@ bool GLHelper::createSurfaceTexture(uint32_t w, uint32_t h,
     return createNamedSurfaceTexture(*name, w, h, glConsumer, surface);
 }
 
+bool GLHelper::createCpuSurfaceTexture(uint32_t w, uint32_t h, int format,
+        sp<GLConsumer>* glConsumer, sp<Surface>* window, GLuint* name) {
+    if (!makeCurrent(mDummySurface)) {
+        return false;
+    }
+
+    *name = 0;
+    glGenTextures(1, name);
+    if (*name == 0) {
+        fprintf(stderr, "glGenTextures error: %#x\n", glGetError());
+        return false;
+    }
+
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    sp<GLConsumer> glc = new GLConsumer(consumer, *name,
+            GL_TEXTURE_EXTERNAL_OES, false, true);
+    glc->setDefaultBufferSize(w, h);
+    glc->setDefaultBufferFormat(format);
+    producer->setMaxDequeuedBufferCount(2);
+    glc->setConsumerUsageBits(GRALLOC_USAGE_HW_COMPOSER);
+
+    sp<Surface> s = new Surface(producer);
+    int err = native_window_set_usage(s.get(), GRALLOC_USAGE_SW_WRITE_OFTEN);
+    if (err == NO_ERROR) {
+        err = native_window_set_buffers_format(s.get(), format);
+    }
+    if (err != NO_ERROR) {
+        fprintf(stderr, "error configuring CPU surface: %d\n", err);
+        return false;
+    }
+
+    *glConsumer = glc;
+    *window = s;
+    return true;
+}
+
 void GLHelper::destroySurface(EGLSurface* surface) {
     if (eglGetCurrentSurface(EGL_READ) == *surface ||
             eglGetCurrentSurface(EGL_DRAW) == *surface) {
@@ -54,6 +54,12 @@ public:
             sp<GLConsumer>* surfaceTexture, EGLSurface* surface,
             GLuint* name);
 
+    // Creates a surface texture whose buffers are filled on the CPU in the
+    // given HAL pixel format rather than rendered with GL.
+    bool createCpuSurfaceTexture(uint32_t w, uint32_t h, int format,
+            sp<GLConsumer>* surfaceTexture, sp<Surface>* window,
+            GLuint* name);
+
     bool createWindowSurface(uint32_t w, uint32_t h,
             sp<SurfaceControl>* surfaceControl, EGLSurface* surface);
 
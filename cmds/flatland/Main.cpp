@@ -26,8 +26,14 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 
+#include <errno.h>
 #include <math.h>
 #include <getopt.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
 
 #include "Flatland.h"
 #include "GLHelper.h"
@@ -37,21 +43,16 @@ using namespace ::android;
 static uint32_t g_SleepBetweenSamplesMs = 0;
 static bool     g_PresentToWindow       = false;
 static size_t   g_BenchmarkNameLen      = 0;
+static uint32_t g_Repeats               = 1;
+static FILE*    g_TableOut              = stdout;
 
-struct BenchmarkDesc {
-    // The name of the test.
-    const char* name;
-
-    // The dimensions of the space in which window layers are specified.
-    uint32_t width;
-    uint32_t height;
-
-    // The screen heights at which to run the test.
-    uint32_t runHeights[MAX_TEST_RUNS];
+// Where to write the JSON results, if anywhere.
+static std::string g_JsonPath;
 
-    // The list of window layers.
-    LayerDesc layers[MAX_NUM_LAYERS];
-};
+// The GL implementation the results were measured on.
+static std::string g_GLVendor;
+static std::string g_GLRenderer;
+static std::string g_GLVersion;
 
 static const BenchmarkDesc benchmarks[] = {
     { "16:10 Single Static Window",
@@ -203,6 +204,11 @@ static const BenchmarkDesc benchmarks[] = {
     },
 };
 
+// The benchmarks to run, either the built-in ones above or those loaded from a
+// scenario config file.
+static const BenchmarkDesc* g_Benchmarks = benchmarks;
+static size_t g_NumBenchmarks = NELEMS(benchmarks);
+
 static const ShaderDesc shaders[] = {
     {
         .name="Blit",
@@ -277,6 +283,160 @@ static const ShaderDesc shaders[] = {
             "}",
         },
     },
+
+    {
+        .name="RoundedBlit",
+        .vertexShader={
+            "precision mediump float;",
+            "",
+            "attribute vec4 position;",
+            "attribute vec4 uv;",
+            "",
+            "varying vec4 texCoords;",
+            "varying vec2 screenPos;",
+            "",
+            "uniform mat4 objToNdc;",
+            "uniform mat4 uvToTex;",
+            "",
+            "void main() {",
+            "    gl_Position = objToNdc * position;",
+            "    texCoords = uvToTex * uv;",
+            "    screenPos = position.xy;",
+            "}",
+        },
+        .fragmentShader={
+            "#extension GL_OES_EGL_image_external : require",
+            "precision mediump float;",
+            "",
+            "varying vec4 texCoords;",
+            "varying vec2 screenPos;",
+            "",
+            "uniform samplerExternalOES blitSrc;",
+            "uniform vec4 modColor;",
+            "uniform vec2 cropCenter;",
+            "uniform vec2 cropHalfSize;",
+            "uniform float cornerRadius;",
+            "",
+            "void main() {",
+            "    vec2 d = abs(screenPos - cropCenter) - cropHalfSize + cornerRadius;",
+            "    float dist = length(max(d, 0.0)) - cornerRadius;",
+            "    float coverage = clamp(0.5 - dist, 0.0, 1.0);",
+            "    gl_FragColor = texture2D(blitSrc, texCoords.xy);",
+            "    gl_FragColor *= modColor * coverage;",
+            "}",
+        },
+    },
+
+    {
+        .name="Blur",
+        .vertexShader={
+            "precision mediump float;",
+            "",
+            "attribute vec4 position;",
+            "attribute vec4 uv;",
+            "",
+            "varying vec4 texCoords;",
+            "",
+            "uniform mat4 objToNdc;",
+            "uniform mat4 uvToTex;",
+            "",
+            "void main() {",
+            "    gl_Position = objToNdc * position;",
+            "    texCoords = uvToTex * uv;",
+            "}",
+        },
+        .fragmentShader={
+            "precision mediump float;",
+            "",
+            "varying vec4 texCoords;",
+            "",
+            "uniform sampler2D blitSrc;",
+            "uniform vec4 modColor;",
+            "uniform vec2 texelStep;",
+            "",
+            "void main() {",
+            "    vec2 tc = texCoords.xy;",
+            "    vec2 s = texelStep;",
+            "    vec2 h = texelStep * 0.5;",
+            "    vec4 sum = texture2D(blitSrc, tc);",
+            "    sum += texture2D(blitSrc, tc + vec2(s.x, 0.0));",
+            "    sum += texture2D(blitSrc, tc - vec2(s.x, 0.0));",
+            "    sum += texture2D(blitSrc, tc + vec2(0.0, s.y));",
+            "    sum += texture2D(blitSrc, tc - vec2(0.0, s.y));",
+            "    sum += texture2D(blitSrc, tc + h);",
+            "    sum += texture2D(blitSrc, tc - h);",
+            "    sum += texture2D(blitSrc, tc + vec2(h.x, -h.y));",
+            "    sum += texture2D(blitSrc, tc + vec2(-h.x, h.y));",
+            "    sum += texture2D(blitSrc, tc + s);",
+            "    sum += texture2D(blitSrc, tc - s);",
+            "    sum += texture2D(blitSrc, tc + vec2(s.x, -s.y));",
+            "    sum += texture2D(blitSrc, tc + vec2(-s.x, s.y));",
+            "    gl_FragColor = sum * (1.0 / 13.0) * modColor;",
+            "}",
+        },
+    },
+
+    {
+        .name="HdrBlit",
+        .vertexShader={
+            "precision mediump float;",
+            "",
+            "attribute vec4 position;",
+            "attribute vec4 uv;",
+            "",
+            "varying vec4 texCoords;",
+            "",
+            "uniform mat4 objToNdc;",
+            "uniform mat4 uvToTex;",
+            "",
+            "void main() {",
+            "    gl_Position = objToNdc * position;",
+            "    texCoords = uvToTex * uv;",
+            "}",
+        },
+        .fragmentShader={
+            "#extension GL_OES_EGL_image_external : require",
+            "precision highp float;",
+            "",
+            "varying vec4 texCoords;",
+            "",
+            "uniform samplerExternalOES blitSrc;",
+            "uniform vec4 modColor;",
+            "uniform float inputMaxLuminance;",
+            "uniform float displayMaxLuminance;",
+            "",
+            "// SMPTE ST 2084 EOTF, normalized to 10000 nits.",
+            "vec3 pqToLinear(vec3 color) {",
+            "    const float m1 = 1305.0 / 8192.0;",
+            "    const float m2 = 2523.0 / 32.0;",
+            "    const float c1 = 107.0 / 128.0;",
+            "    const float c2 = 2413.0 / 128.0;",
+            "    const float c3 = 2392.0 / 128.0;",
+            "    vec3 p = pow(color, vec3(1.0 / m2));",
+            "    p = max(p - c1, vec3(0.0)) / (c2 - c3 * p);",
+            "    return pow(p, vec3(1.0 / m1));",
+            "}",
+            "",
+            "void main() {",
+            "    const mat3 bt2020ToBt709 = mat3(",
+            "            1.6605, -0.1246, -0.0182,",
+            "            -0.5876, 1.1329, -0.1006,",
+            "            -0.0728, -0.0083, 1.1187);",
+            "    vec4 src = texture2D(blitSrc, texCoords.xy);",
+            "    vec3 nits = pqToLinear(src.rgb) * 10000.0;",
+            "",
+            "    // Extended Reinhard on luminance.",
+            "    float l = dot(nits, vec3(0.2627, 0.6780, 0.0593)) /",
+            "            displayMaxLuminance;",
+            "    float w = inputMaxLuminance / displayMaxLuminance;",
+            "    float ld = l * (1.0 + l / (w * w)) / (1.0 + l);",
+            "    vec3 rgb = nits / displayMaxLuminance * (ld / max(l, 1e-6));",
+            "",
+            "    rgb = clamp(bt2020ToBt709 * rgb, 0.0, 1.0);",
+            "    gl_FragColor = vec4(pow(rgb, vec3(1.0 / 2.2)), src.a) * modColor;",
+            "}",
+        },
+    },
 };
 
 class Layer {
@@ -285,7 +445,9 @@ public:
 
     Layer() :
         mGLHelper(nullptr),
-        mSurface(EGL_NO_SURFACE) {
+        mSurface(EGL_NO_SURFACE),
+        mRenderer(nullptr),
+        mComposer(nullptr) {
     }
 
     bool setUp(const LayerDesc& desc, GLHelper* helper) {
@@ -294,13 +456,19 @@ public:
         mDesc = desc;
         mGLHelper = helper;
 
-        result = mGLHelper->createSurfaceTexture(mDesc.width, mDesc.height,
-                &mGLConsumer, &mSurface, &mTexName);
+        mRenderer = desc.rendererFactory();
+        int cpuFormat = mRenderer->cpuBufferFormat();
+        if (cpuFormat != 0) {
+            result = mGLHelper->createCpuSurfaceTexture(mDesc.width,
+                    mDesc.height, cpuFormat, &mGLConsumer, &mWindow, &mTexName);
+        } else {
+            result = mGLHelper->createSurfaceTexture(mDesc.width, mDesc.height,
+                    &mGLConsumer, &mSurface, &mTexName);
+        }
         if (!result) {
             return false;
         }
 
-        mRenderer = desc.rendererFactory();
         result = mRenderer->setUp(helper);
         if (!result) {
             return false;
@@ -330,13 +498,19 @@ public:
 
         if (mSurface != EGL_NO_SURFACE) {
             mGLHelper->destroySurface(&mSurface);
+        }
+        if (mGLConsumer != nullptr) {
             mGLConsumer->abandon();
         }
         mGLHelper = nullptr;
         mGLConsumer.clear();
+        mWindow.clear();
     }
 
     bool render() {
+        if (mWindow != nullptr) {
+            return mRenderer->renderWindow(mWindow);
+        }
         return mRenderer->render(mSurface);
     }
 
@@ -365,6 +539,9 @@ private:
     sp<GLConsumer> mGLConsumer;
     EGLSurface mSurface;
 
+    // Set instead of mSurface for renderers that fill buffers on the CPU.
+    sp<Surface> mWindow;
+
     Renderer* mRenderer;
     Composer* mComposer;
 };
@@ -412,6 +589,8 @@ public:
             ld.y = int32_t(scaleFactor * float(ld.y));
             ld.width = uint32_t(scaleFactor * float(ld.width));
             ld.height = uint32_t(scaleFactor * float(ld.height));
+            ld.cornerRadius *= scaleFactor;
+            ld.blurRadius *= scaleFactor;
 
             // Set up the layer.
             result = mLayers[i].setUp(ld, mGLHelper);
@@ -586,17 +765,91 @@ static int cmpDouble(const double* lhs, const double* rhs) {
     return 0;
 }
 
-// Run a single benchmark and print the result.
-static bool runTest(const BenchmarkDesc b, size_t run) {
+enum RunStatus {
+    RUN_OK,
+    RUN_FAST,
+    RUN_SLOW,
+    RUN_VARIES,
+};
+
+static const char* runStatusName(RunStatus status) {
+    switch (status) {
+        case RUN_OK:        return "ok";
+        case RUN_FAST:      return "fast";
+        case RUN_SLOW:      return "slow";
+        case RUN_VARIES:    return "varies";
+    }
+    return "unknown";
+}
+
+// The results of all the repeats of one scenario at one resolution.
+struct ScenarioResult {
+    const char* name;
+    uint32_t width;
+    uint32_t height;
+
+    // RUN_OK if any repeat produced a frame time, otherwise the status of the
+    // first repeat.
+    RunStatus status;
+
+    // The frame time of each repeat that produced one, in ms.
+    std::vector<double> frameTimesMs;
+};
+
+static std::vector<ScenarioResult> g_Results;
+
+struct ResultStats {
+    double mean;
+    double stddev;
+    double min;
+    double median;
+    double max;
+};
+
+static ResultStats computeStats(std::vector<double> samples) {
+    ResultStats stats = {};
+    size_t n = samples.size();
+    if (n == 0) {
+        return stats;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    stats.min = samples[0];
+    stats.max = samples[n - 1];
+    stats.median = (n % 2) ? samples[n / 2] :
+            (samples[n / 2 - 1] + samples[n / 2]) * 0.5;
+
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    stats.mean = sum / double(n);
+
+    if (n > 1) {
+        double sumSq = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            double d = samples[i] - stats.mean;
+            sumSq += d * d;
+        }
+        stats.stddev = sqrt(sumSq / double(n - 1));
+    }
+    return stats;
+}
+
+static std::string glString(GLenum name) {
+    const GLubyte* str = glGetString(name);
+    return str != nullptr ? reinterpret_cast<const char*>(str) : "";
+}
+
+// Run a single benchmark once, storing its time per frame in ms.
+static bool runTest(const BenchmarkDesc& b, size_t run, RunStatus* status,
+        double* frameTimeMs) {
     bool success = true;
     double prevResult = 0.0, result = 0.0;
     Vector<double> samples;
 
-    uint32_t runHeight = b.runHeights[run];
-    uint32_t runWidth = b.width * runHeight / b.height;
-    printf(" %-*s | %4d x %4d | ", static_cast<int>(g_BenchmarkNameLen), b.name,
-            runWidth, runHeight);
-    fflush(stdout);
+    *status = RUN_OK;
+    *frameTimeMs = 0.0;
 
     BenchmarkRunner r(b, run);
     if (!r.setUp()) {
@@ -604,6 +857,12 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
         return false;
     }
 
+    if (g_GLRenderer.empty()) {
+        g_GLVendor = glString(GL_VENDOR);
+        g_GLRenderer = glString(GL_RENDERER);
+        g_GLVersion = glString(GL_VERSION);
+    }
+
     // The slowest 1/outlierFraction sample results are ignored as potential
     // outliers.
     const uint32_t outlierFraction = 16;
@@ -627,11 +886,11 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
 
     if (totalFrames - warmUpFrames > 16) {
         // The test runs too fast to get a stable result.  Skip it.
-        printf("  fast");
+        *status = RUN_FAST;
         goto done;
     } else if (totalFrames == 5 && runTime > 200e6) {
         // The test runs too slow to be very useful.  Skip it.
-        printf("  slow");
+        *status = RUN_SLOW;
         goto done;
     }
 
@@ -642,7 +901,7 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
         }
 
         if (newSamples > 512) {
-            printf("varies");
+            *status = RUN_VARIES;
             goto done;
         }
 
@@ -668,35 +927,85 @@ static bool runTest(const BenchmarkDesc b, size_t run) {
         result = (samples[elem-1] + samples[elem]) * 0.5;
     } while (fabs(result - prevResult) > threshold * result);
 
-    printf("%6.3f", result / double(totalFrames - warmUpFrames) / 1e6);
+    *frameTimeMs = result / double(totalFrames - warmUpFrames) / 1e6;
 
 done:
 
-    printf("\n");
-    fflush(stdout);
     r.tearDown();
 
     return success;
 }
 
+// Run a benchmark g_Repeats times and print the result.
+static bool runScenario(const BenchmarkDesc& b, size_t run) {
+    ScenarioResult sr;
+    sr.name = b.name;
+    sr.height = b.runHeights[run];
+    sr.width = b.width * sr.height / b.height;
+    sr.status = RUN_OK;
+
+    fprintf(g_TableOut, " %-*s | %4d x %4d | ",
+            static_cast<int>(g_BenchmarkNameLen), b.name, sr.width, sr.height);
+    fflush(g_TableOut);
+
+    for (uint32_t i = 0; i < g_Repeats; i++) {
+        RunStatus status;
+        double frameTimeMs;
+        if (!runTest(b, run, &status, &frameTimeMs)) {
+            fprintf(g_TableOut, "\n");
+            return false;
+        }
+
+        if (status == RUN_OK) {
+            sr.frameTimesMs.push_back(frameTimeMs);
+        } else if (i == 0) {
+            sr.status = status;
+        }
+    }
+    if (!sr.frameTimesMs.empty()) {
+        sr.status = RUN_OK;
+    }
+
+    if (sr.status != RUN_OK) {
+        fprintf(g_TableOut, "%6s", runStatusName(sr.status));
+    } else if (g_Repeats == 1) {
+        fprintf(g_TableOut, "%6.3f", sr.frameTimesMs[0]);
+    } else {
+        ResultStats stats = computeStats(sr.frameTimesMs);
+        fprintf(g_TableOut, "%9.3f | %6.3f | %6.3f | %6.3f | %6.3f | %zu/%u",
+                stats.mean, stats.stddev, stats.min, stats.median, stats.max,
+                sr.frameTimesMs.size(), g_Repeats);
+    }
+    fprintf(g_TableOut, "\n");
+    fflush(g_TableOut);
+
+    g_Results.push_back(sr);
+    return true;
+}
+
 static void printResultsTableHeader() {
     const char* scenario = "Scenario";
     size_t len = strlen(scenario);
     size_t leftPad = (g_BenchmarkNameLen - len) / 2;
     size_t rightPad = g_BenchmarkNameLen - len - leftPad;
-    printf(" %*s%s%*s | Resolution  | Time (ms)\n",
+    fprintf(g_TableOut, " %*s%s%*s | Resolution  | ",
             static_cast<int>(leftPad), "",
             "Scenario", static_cast<int>(rightPad), "");
+    if (g_Repeats == 1) {
+        fprintf(g_TableOut, "Time (ms)\n");
+    } else {
+        fprintf(g_TableOut, "Mean (ms) | Stddev | Min    | Median | Max    | Runs\n");
+    }
 }
 
 // Run ALL the benchmarks!
 static bool runTests() {
     printResultsTableHeader();
 
-    for (size_t i = 0; i < NELEMS(benchmarks); i++) {
-        const BenchmarkDesc& b = benchmarks[i];
+    for (size_t i = 0; i < g_NumBenchmarks; i++) {
+        const BenchmarkDesc& b = g_Benchmarks[i];
         for (size_t j = 0; j < MAX_TEST_RUNS && b.runHeights[j]; j++) {
-            if (!runTest(b, j)) {
+            if (!runScenario(b, j)) {
                 return false;
             }
         }
@@ -707,8 +1016,8 @@ static bool runTests() {
 // Return the length longest benchmark name.
 static size_t maxBenchmarkNameLen() {
     size_t maxLen = 0;
-    for (size_t i = 0; i < NELEMS(benchmarks); i++) {
-        const BenchmarkDesc& b = benchmarks[i];
+    for (size_t i = 0; i < g_NumBenchmarks; i++) {
+        const BenchmarkDesc& b = g_Benchmarks[i];
         size_t len = strlen(b.name);
         if (len > maxLen) {
             maxLen = len;
@@ -717,12 +1026,85 @@ static size_t maxBenchmarkNameLen() {
     return maxLen;
 }
 
+static void writeJsonString(FILE* f, const char* str) {
+    fputc('"', f);
+    for (const char* c = str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(f, "\\%c", *c);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            fprintf(f, "\\u%04x", *c);
+        } else {
+            fputc(*c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+// Write the results of all the benchmarks that were run to g_JsonPath, or to
+// stdout if it is "-".
+static bool writeJsonResults(const std::string& cmdline) {
+    bool toStdout = g_JsonPath == "-";
+    FILE* f = toStdout ? stdout : fopen(g_JsonPath.c_str(), "w");
+    if (f == nullptr) {
+        fprintf(stderr, "error opening %s: %s\n", g_JsonPath.c_str(),
+                strerror(errno));
+        return false;
+    }
+
+    fprintf(f, "{\n  \"cmdline\": ");
+    writeJsonString(f, cmdline.c_str());
+    fprintf(f, ",\n  \"gl_vendor\": ");
+    writeJsonString(f, g_GLVendor.c_str());
+    fprintf(f, ",\n  \"gl_renderer\": ");
+    writeJsonString(f, g_GLRenderer.c_str());
+    fprintf(f, ",\n  \"gl_version\": ");
+    writeJsonString(f, g_GLVersion.c_str());
+    fprintf(f, ",\n  \"repeats\": %u,\n  \"results\": [", g_Repeats);
+
+    for (size_t i = 0; i < g_Results.size(); i++) {
+        const ScenarioResult& sr = g_Results[i];
+        fprintf(f, "%s\n    {\n      \"scenario\": ", i ? "," : "");
+        writeJsonString(f, sr.name);
+        fprintf(f, ",\n      \"width\": %u,\n      \"height\": %u,\n"
+                "      \"status\": \"%s\",\n      \"frame_times_ms\": [",
+                sr.width, sr.height, runStatusName(sr.status));
+        for (size_t j = 0; j < sr.frameTimesMs.size(); j++) {
+            fprintf(f, "%s%.4f", j ? ", " : "", sr.frameTimesMs[j]);
+        }
+        fprintf(f, "]");
+        if (!sr.frameTimesMs.empty()) {
+            ResultStats stats = computeStats(sr.frameTimesMs);
+            fprintf(f, ",\n      \"mean_ms\": %.4f,\n"
+                    "      \"stddev_ms\": %.4f,\n"
+                    "      \"min_ms\": %.4f,\n"
+                    "      \"median_ms\": %.4f,\n"
+                    "      \"max_ms\": %.4f",
+                    stats.mean, stats.stddev, stats.min, stats.median,
+                    stats.max);
+        }
+        fprintf(f, "\n    }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    if (toStdout) {
+        fflush(f);
+        return true;
+    }
+    return fclose(f) == 0;
+}
+
 // Print the command usage help to stderr.
 static void showHelp(const char *cmd) {
     fprintf(stderr, "usage: %s [options]\n", cmd);
     fprintf(stderr, "options include:\n"
                     "  -s N            sleep for N ms between samples\n"
                     "  -d              display the test frame to a window\n"
+                    "  -c FILE         run the scenarios in FILE instead of the\n"
+                    "                  built-in ones\n"
+                    "  -r N            run each scenario N times and report\n"
+                    "                  statistics across the runs\n"
+                    "  -j FILE         also write the results as JSON to FILE,\n"
+                    "                  or to stdout if FILE is -\n"
                     "  --help          print this helpful message and exit\n"
             );
 }
@@ -733,6 +1115,8 @@ int main(int argc, char** argv) {
         exit(0);
     }
 
+    const char* configPath = nullptr;
+
     for (;;) {
         int ret;
         int option_index = 0;
@@ -741,7 +1125,7 @@ int main(int argc, char** argv) {
             {     0,               0, 0,  0 }
         };
 
-        ret = getopt_long(argc, argv, "ds:",
+        ret = getopt_long(argc, argv, "ds:c:r:j:",
                           long_options, &option_index);
 
         if (ret < 0) {
@@ -757,6 +1141,24 @@ int main(int argc, char** argv) {
                 g_SleepBetweenSamplesMs = atoi(optarg);
             break;
 
+            case 'c':
+                configPath = optarg;
+            break;
+
+            case 'r': {
+                int repeats = atoi(optarg);
+                if (repeats < 1) {
+                    showHelp(argv[0]);
+                    exit(2);
+                }
+                g_Repeats = repeats;
+            }
+            break;
+
+            case 'j':
+                g_JsonPath = optarg;
+            break;
+
             case 0:
                 if (strcmp(long_options[option_index].name, "help")) {
                     showHelp(argv[0]);
@@ -770,16 +1172,40 @@ int main(int argc, char** argv) {
         }
     }
 
+    ScenarioConfig config;
+    if (configPath != nullptr) {
+        if (!config.load(configPath)) {
+            fprintf(stderr, "exiting due to error.\n");
+            return 1;
+        }
+        g_Benchmarks = config.benchmarks();
+        g_NumBenchmarks = config.numBenchmarks();
+    }
+
     g_BenchmarkNameLen = maxBenchmarkNameLen();
 
-    printf(" cmdline:");
+    // Keep stdout clean for the JSON when it goes there.
+    if (g_JsonPath == "-") {
+        g_TableOut = stderr;
+    }
+
+    std::string cmdline;
     for (int i = 0; i < argc; i++) {
-        printf(" %s", argv[i]);
+        cmdline += i ? " " : "";
+        cmdline += argv[i];
     }
-    printf("\n");
 
-    if (!runTests()) {
+    fprintf(g_TableOut, " cmdline: %s\n", cmdline.c_str());
+
+    bool success = runTests();
+    if (!success) {
         fprintf(stderr, "exiting due to error.\n");
+    }
+
+    // Write whatever results were gathered, even after an error.
+    if (!g_JsonPath.empty() && !writeJsonResults(cmdline)) {
         return 1;
     }
+
+    return success ? 0 : 1;
 }
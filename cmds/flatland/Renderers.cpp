@@ -193,5 +193,70 @@ Renderer* staticGradient() {
     return new NoRenderer;
 }
 
+// Fills a single YV12 buffer on the CPU, as a video decoder would, so that
+// composers sample it through the external YUV texture path.
+Renderer* staticYuv() {
+    class YuvRenderer : public Renderer {
+        virtual bool setUp(GLHelper* /*helper*/) {
+            mIsFirstFrame = true;
+            return true;
+        }
+
+        virtual void tearDown() {
+        }
+
+        virtual bool render(EGLSurface /*surface*/) {
+            return false;
+        }
+
+        virtual int cpuBufferFormat() const {
+            return HAL_PIXEL_FORMAT_YV12;
+        }
+
+        virtual bool renderWindow(const sp<Surface>& window) {
+            if (!mIsFirstFrame) {
+                return true;
+            }
+            mIsFirstFrame = false;
+
+            ANativeWindow_Buffer buffer;
+            status_t err = window->lock(&buffer, nullptr);
+            if (err != NO_ERROR) {
+                fprintf(stderr, "Surface::lock error: %d\n", err);
+                return false;
+            }
+
+            // YV12 is a full size Y plane followed by the Cr and Cb planes at
+            // half resolution, with their strides aligned to 16 bytes.
+            const float* color = genColor();
+            uint8_t* yPlane = static_cast<uint8_t*>(buffer.bits);
+            size_t yStride = buffer.stride;
+            size_t cStride = ((yStride / 2) + 15) & ~15;
+            uint8_t* crPlane = yPlane + yStride * buffer.height;
+            uint8_t* cbPlane = crPlane + cStride * (buffer.height / 2);
+
+            for (int32_t y = 0; y < buffer.height; y++) {
+                uint8_t luma = uint8_t(16 + 219 * y / buffer.height);
+                memset(yPlane + y * yStride, luma, buffer.width);
+            }
+            uint8_t cr = uint8_t(128.0f + 112.0f * (color[0] - color[1]));
+            uint8_t cb = uint8_t(128.0f + 112.0f * (color[2] - color[1]));
+            for (int32_t y = 0; y < buffer.height / 2; y++) {
+                memset(crPlane + y * cStride, cr, buffer.width / 2);
+                memset(cbPlane + y * cStride, cb, buffer.width / 2);
+            }
+
+            err = window->unlockAndPost();
+            if (err != NO_ERROR) {
+                fprintf(stderr, "Surface::unlockAndPost error: %d\n", err);
+                return false;
+            }
+            return true;
+        }
+
+        bool mIsFirstFrame;
+    };
+    return new YuvRenderer;
+}
 
 } // namespace android
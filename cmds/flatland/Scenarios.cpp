@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Flatland.h"
+
+namespace android {
+
+struct RendererDesc {
+    const char* name;
+    Renderer* (*factory)();
+};
+
+struct ComposerDesc {
+    const char* name;
+    Composer* (*factory)();
+};
+
+static const RendererDesc renderers[] = {
+    { "staticGradient", staticGradient },
+    { "staticYuv",      staticYuv },
+};
+
+static const ComposerDesc composers[] = {
+    { "nocomp",         nocomp },
+    { "opaque",         opaque },
+    { "opaqueShrink",   opaqueShrink },
+    { "blend",          blend },
+    { "blendShrink",    blendShrink },
+    { "roundedCorners", roundedCorners },
+    { "backgroundBlur", backgroundBlur },
+    { "hdrToneMap",     hdrToneMap },
+};
+
+static Renderer* (*findRenderer(const char* name))() {
+    for (size_t i = 0; i < NELEMS(renderers); i++) {
+        if (strcmp(renderers[i].name, name) == 0) {
+            return renderers[i].factory;
+        }
+    }
+    return nullptr;
+}
+
+static Composer* (*findComposer(const char* name))() {
+    for (size_t i = 0; i < NELEMS(composers); i++) {
+        if (strcmp(composers[i].name, name) == 0) {
+            return composers[i].factory;
+        }
+    }
+    return nullptr;
+}
+
+// Parses "<width> <height> <run heights> <name>" into |b| and |name|.
+static bool parseScenario(char* args, BenchmarkDesc* b, std::string* name,
+        const char** error) {
+    char heights[256];
+    int end = 0;
+    if (sscanf(args, "%u %u %255s %n", &b->width, &b->height, heights,
+            &end) != 3 || b->width == 0 || b->height == 0) {
+        *error = "expected: scenario <width> <height> <run heights> <name>";
+        return false;
+    }
+
+    *name = args + end;
+    if (name->empty()) {
+        *error = "missing scenario name";
+        return false;
+    }
+
+    size_t numRuns = 0;
+    char* saveptr = nullptr;
+    for (char* tok = strtok_r(heights, ",", &saveptr); tok != nullptr;
+            tok = strtok_r(nullptr, ",", &saveptr)) {
+        if (numRuns == MAX_TEST_RUNS) {
+            *error = "too many run heights";
+            return false;
+        }
+        int height = atoi(tok);
+        if (height <= 0) {
+            *error = "invalid run height";
+            return false;
+        }
+        b->runHeights[numRuns++] = height;
+    }
+    return true;
+}
+
+// Parses "<renderer> <composer> <x> <y> <width> <height> [key=value...]" into
+// |ld|.
+static bool parseLayer(char* args, LayerDesc* ld, const char** error) {
+    char renderer[64], composer[64];
+    int end = 0;
+    if (sscanf(args, "%63s %63s %d %d %u %u%n", renderer, composer, &ld->x,
+            &ld->y, &ld->width, &ld->height, &end) != 6 ||
+            ld->width == 0 || ld->height == 0) {
+        *error = "expected: layer <renderer> <composer> <x> <y> <width> "
+                "<height> [key=value...]";
+        return false;
+    }
+
+    ld->rendererFactory = findRenderer(renderer);
+    if (ld->rendererFactory == nullptr) {
+        *error = "unknown renderer";
+        return false;
+    }
+    ld->composerFactory = findComposer(composer);
+    if (ld->composerFactory == nullptr) {
+        *error = "unknown composer";
+        return false;
+    }
+
+    char* saveptr = nullptr;
+    for (char* tok = strtok_r(args + end, " \t", &saveptr); tok != nullptr;
+            tok = strtok_r(nullptr, " \t", &saveptr)) {
+        if (sscanf(tok, "cornerRadius=%f", &ld->cornerRadius) == 1 ||
+                sscanf(tok, "blurRadius=%f", &ld->blurRadius) == 1) {
+            continue;
+        }
+        *error = "unknown layer parameter";
+        return false;
+    }
+    return true;
+}
+
+bool ScenarioConfig::load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) {
+        fprintf(stderr, "error opening %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    bool success = true;
+    size_t numLayers = 0;
+    char line[1024];
+    for (int lineNum = 1; fgets(line, sizeof(line), f) != nullptr; lineNum++) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* p = line + strspn(line, " \t");
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        const char* error = nullptr;
+        char keyword[16];
+        int end = 0;
+        sscanf(p, "%15s %n", keyword, &end);
+
+        if (strcmp(keyword, "scenario") == 0) {
+            BenchmarkDesc b = {};
+            std::string name;
+            if (parseScenario(p + end, &b, &name, &error)) {
+                mNames.push_back(name);
+                b.name = mNames.back().c_str();
+                mBenchmarks.push_back(b);
+                numLayers = 0;
+            }
+        } else if (strcmp(keyword, "layer") == 0) {
+            if (mBenchmarks.empty()) {
+                error = "layer before the first scenario";
+            } else if (numLayers == MAX_NUM_LAYERS) {
+                error = "too many layers";
+            } else {
+                LayerDesc* ld = &mBenchmarks.back().layers[numLayers];
+                if (parseLayer(p + end, ld, &error)) {
+                    numLayers++;
+                } else {
+                    *ld = LayerDesc();
+                }
+            }
+        } else {
+            error = "unknown keyword";
+        }
+
+        if (error != nullptr) {
+            fprintf(stderr, "%s:%d: %s\n", path, lineNum, error);
+            success = false;
+        }
+    }
+    fclose(f);
+
+    if (success && mBenchmarks.empty()) {
+        fprintf(stderr, "%s: no scenarios\n", path);
+        success = false;
+    }
+    return success;
+}
+
+} // namespace android
@@ -18,12 +18,15 @@
 
 #include "CacheTracker.h"
 
+#include <algorithm>
+
 #include <fts.h>
 #include <sys/xattr.h>
 #include <utils/Trace.h>
 
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
+#include <diskusage/tree_size.h>
 
 #include "QuotaUtils.h"
 #include "utils.h"
@@ -124,20 +127,18 @@ void CacheTracker::loadItemsFrom(const std::string& path) {
             item->group |= (getxattr(p->fts_path, kXattrCacheGroup, nullptr, 0) >= 0);
             item->tombstone |= (getxattr(p->fts_path, kXattrCacheTombstone, nullptr, 0) >= 0);
 
-            // When group, immediately collect all files under tree
+            // When group, immediately collect all files under tree. Skipping it makes the next
+            // fts_read() return the same entry as FTS_DP.
             if (item->group) {
-                while ((p = fts_read(fts)) != nullptr) {
-                    if (p->fts_info == FTS_DP && p->fts_level == item->level) break;
-                    switch (p->fts_info) {
-                    case FTS_D:
-                    case FTS_DEFAULT:
-                    case FTS_F:
-                    case FTS_SL:
-                    case FTS_SLNONE:
-                        item->size += p->fts_statp->st_blocks * 512;
-                        item->modified = std::max(item->modified, p->fts_statp->st_mtime);
-                    }
+                android::diskusage::TreeOptions options;
+                options.want_modified = true;
+                android::diskusage::TreeStats stats;
+                if (android::diskusage::calculate_tree_stats(p->fts_path, &stats, options) == 0) {
+                    item->size = stats.size;
+                    item->modified = std::max<time_t>(item->modified, stats.modified);
                 }
+                fts_set(fts, p, FTS_SKIP);
+                p = fts_read(fts);
             }
         }
         }
@@ -171,22 +172,36 @@ void CacheTracker::loadItems() {
     }
     ATRACE_END();
 
-    ATRACE_BEGIN("sortItems");
-    auto cmp = [](std::shared_ptr<CacheItem> left, std::shared_ptr<CacheItem> right) {
-        // TODO: sort dotfiles last
-        // TODO: sort code_cache last
-        if (left->modified != right->modified) {
-            return (left->modified > right->modified);
-        }
-        if (left->level != right->level) {
-            return (left->level < right->level);
-        }
-        return left->directory;
-    };
-    std::stable_sort(items.begin(), items.end(), cmp);
+    // Only a handful of items are usually purged before enough space is
+    // freed, so heapify instead of sorting everything up front
+    ATRACE_BEGIN("heapifyItems");
+    std::make_heap(items.begin(), items.end(), purgesAfter);
     ATRACE_END();
 }
 
+bool CacheTracker::purgesAfter(const std::shared_ptr<CacheItem>& left,
+        const std::shared_ptr<CacheItem>& right) {
+    // TODO: sort dotfiles last
+    // TODO: sort code_cache last
+    if (left->modified != right->modified) {
+        return (left->modified > right->modified);
+    }
+    if (left->level != right->level) {
+        return (left->level < right->level);
+    }
+    return left->directory && !right->directory;
+}
+
+std::shared_ptr<CacheItem> CacheTracker::popItem() {
+    if (items.empty()) {
+        return nullptr;
+    }
+    std::pop_heap(items.begin(), items.end(), purgesAfter);
+    auto item = items.back();
+    items.pop_back();
+    return item;
+}
+
 void CacheTracker::ensureItems() {
     if (mItemsLoaded) {
         return;
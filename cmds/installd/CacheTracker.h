@@ -51,11 +51,18 @@ public:
 
     void ensureItems();
 
+    /**
+     * Removes and returns the item that should be purged next, or nullptr
+     * once no items remain.
+     */
+    std::shared_ptr<CacheItem> popItem();
+
     int getCacheRatio();
 
     int64_t cacheUsed;
     int64_t cacheQuota;
 
+    /** Loaded items, kept as a heap with the next item to purge on top. */
     std::vector<std::shared_ptr<CacheItem>> items;
 
 private:
@@ -69,6 +76,9 @@ private:
     bool loadQuotaStats();
     void loadItemsFrom(const std::string& path);
 
+    static bool purgesAfter(const std::shared_ptr<CacheItem>& left,
+            const std::shared_ptr<CacheItem>& right);
+
     DISALLOW_COPY_AND_ASSIGN(CacheTracker);
 };
 
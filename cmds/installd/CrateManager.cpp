@@ -27,9 +27,12 @@
 #include <stdint.h>
 #include <string.h>
 #include <sys/xattr.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <string>
 #include <utils.h>
 
@@ -40,6 +43,25 @@ using android::base::StringPrintf;
 namespace android {
 namespace installd {
 
+/**
+ * The crates found in a crates directory, and the state of that directory when they were found.
+ * A crate is a child directory, so creating or removing one changes the directory mtime.
+ */
+struct CrateScan {
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    std::vector<CrateMetadata> crates;
+};
+
+static std::mutex sCrateScansLock;
+static std::map<std::string, CrateScan> sCrateScans;
+
+static bool isSameDir(const CrateScan& scan, const struct stat& s) {
+    return scan.dev == s.st_dev && scan.ino == s.st_ino && scan.mtime.tv_sec == s.st_mtim.tv_sec &&
+            scan.mtime.tv_nsec == s.st_mtim.tv_nsec;
+}
+
 CrateManager::CrateManager(const char* uuid, userid_t userId, const std::string& packageName) {
     mPackageName = packageName;
     mRoot = create_data_user_ce_package_path(uuid, userId, (const char*)packageName.c_str());
@@ -117,6 +139,45 @@ void CrateManager::traverseAllCrates(std::function<void(CratedFolder, std::uniqu
     traverseChildDir(mCratedFoldersRoot, onVisitCrateDir);
 }
 
+void CrateManager::collectAllCrates(std::vector<std::unique_ptr<CrateMetadata>>* crates) {
+    struct stat s;
+    if (stat(mCratedFoldersRoot.c_str(), &s) != 0) {
+        std::lock_guard<std::mutex> lock(sCrateScansLock);
+        sCrateScans.erase(mCratedFoldersRoot);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sCrateScansLock);
+        auto scan = sCrateScans.find(mCratedFoldersRoot);
+        if (scan != sCrateScans.end() && isSameDir(scan->second, s)) {
+            for (const auto& crate : scan->second.crates) {
+                crates->push_back(std::make_unique<CrateMetadata>(crate));
+            }
+            return;
+        }
+    }
+
+    CrateScan scan = {s.st_dev, s.st_ino, s.st_mtim, {}};
+    std::function<void(CratedFolder, std::unique_ptr<CrateMetadata>&)> onCreateCrate =
+            [&](CratedFolder cratedFolder, std::unique_ptr<CrateMetadata>& crateMetadata) -> void {
+        if (cratedFolder == nullptr) {
+            return;
+        }
+        scan.crates.push_back(*crateMetadata);
+        crates->push_back(std::move(crateMetadata));
+    };
+    traverseAllCrates(onCreateCrate);
+
+    // The mtime has a coarse granularity on most filesystems, so a crate created right after the
+    // traversal might not change it. Only remember directories that have been stable for a while.
+    std::lock_guard<std::mutex> lock(sCrateScansLock);
+    if (s.st_mtime < time(nullptr) - 1) {
+        sCrateScans[mCratedFoldersRoot] = std::move(scan);
+    } else {
+        sCrateScans.erase(mCratedFoldersRoot);
+    }
+}
+
 #if CRATE_DEBUG
 void CrateManager::dump(std::unique_ptr<CrateMetadata>& CrateMetadata) {
     LOG(DEBUG) << "CrateMetadata = {"
@@ -57,6 +57,13 @@ public:
 
     void traverseAllCrates(std::function<void(CratedFolder, std::unique_ptr<CrateMetadata>&)>& onCreateCrate);
 
+    /**
+     * Collects the metadata of all the crates of the package. The crated folders are only traversed
+     * again when the crates directory has been modified since the last time they were collected,
+     * so this may be called concurrently for different packages.
+     */
+    void collectAllCrates(std::vector<std::unique_ptr<CrateMetadata>>* crates);
+
     static void traverseChildDir(const std::string& targetDir,
             std::function<void(FTSENT*)>& onVisitChildDir);
 
@@ -19,6 +19,7 @@
 #define ATRACE_TAG ATRACE_TAG_PACKAGE_MANAGER
 
 #include <algorithm>
+#include <atomic>
 #include <errno.h>
 #include <fstream>
 #include <fts.h>
@@ -38,6 +39,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/xattr.h>
+#include <thread>
 #include <unistd.h>
 
 #include <android-base/file.h>
@@ -58,6 +60,7 @@
 #include <private/android_projectid_config.h>
 #include <selinux/android.h>
 #include <system/thread_defs.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 
 #include "dexopt.h"
@@ -100,6 +103,12 @@ static constexpr const char* PKG_LIB_POSTFIX = "/lib";
 static constexpr const char* CACHE_DIR_POSTFIX = "/cache";
 static constexpr const char* CODE_CACHE_DIR_POSTFIX = "/code_cache";
 
+// Maximum number of threads used to walk directory trees when measuring apps.
+static constexpr const size_t kMaxMeasureThreads = 4;
+
+// Maximum number of threads used to prepare app data directories in a batch.
+static constexpr const size_t kMaxCreateAppDataThreads = 4;
+
 // fsverity assumes the page size is always 4096. If not, the feature can not be
 // enabled.
 static constexpr int kVerityPageSize = 4096;
@@ -111,11 +120,23 @@ static constexpr const char* kFuseProp = "persist.sys.fuse";
  * Property to control if app data isolation is enabled.
  */
 static constexpr const char* kAppDataIsolationEnabledProperty = "persist.zygote.app_data_isolation";
+
+/**
+ * Property controlling how many dexopt calls may compile at the same time. With the default of
+ * 1, dexopt holds the installd lock for the whole compile like every other mutating call. Larger
+ * values rely on the caller not mutating a package while it is being compiled.
+ */
+static constexpr const char* kDexoptMaxParallelJobsProperty = "dalvik.vm.dexopt-parallel-jobs";
 static constexpr const char* kMntSdcardfs = "/mnt/runtime/default/";
 static constexpr const char* kMntFuse = "/mnt/pass_through/0/";
 
 static std::atomic<bool> sAppDataIsolationEnabled(false);
 
+/* Number of package directory restorecons, how many of them were recursive, and their cost */
+static std::atomic<uint64_t> sRestoreconCount(0);
+static std::atomic<uint64_t> sRecursiveRestoreconCount(0);
+static std::atomic<int64_t> sRestoreconTimeNs(0);
+
 namespace {
 
 constexpr const char* kDump = "android.permission.DUMP";
@@ -307,12 +328,44 @@ status_t InstalldNativeService::dump(int fd, const Vector<String16> & /* args */
         }
     }
 
+    out << endl << "Restorecon:" << endl;
+    out << "    " << sRestoreconCount << " package dirs, " << sRecursiveRestoreconCount
+            << " recursive, " << ns2ms(sRestoreconTimeNs) << " ms total" << endl;
+
+    {
+        std::lock_guard<std::mutex> lock(mDexoptJobsLock);
+        const DexoptJobStats& stats = mDexoptJobStats;
+        out << endl << "Dexopt jobs:" << endl;
+        out << "    " << stats.count << " run, " << stats.failed << " failed, "
+                << mDexoptJobsRunning << " running" << endl;
+        if (stats.count > 0) {
+            out << "    average " << ns2ms(stats.totalTimeNs / stats.count) << " ms, max "
+                    << ns2ms(stats.maxTimeNs) << " ms (" << stats.slowestPackage << ")" << endl;
+        }
+    }
+
     out << endl;
     out.flush();
 
     return NO_ERROR;
 }
 
+/**
+ * Wrapper around selinux_android_restorecon_pkgdir that keeps the restorecon
+ * counters reported by dump().
+ */
+static int restorecon_pkgdir(const std::string& path, const std::string& seInfo, uid_t uid,
+        unsigned int flags) {
+    const nsecs_t start = systemTime();
+    int res = selinux_android_restorecon_pkgdir(path.c_str(), seInfo.c_str(), uid, flags);
+    sRestoreconTimeNs += systemTime() - start;
+    sRestoreconCount++;
+    if (flags & SELINUX_ANDROID_RESTORECON_RECURSE) {
+        sRecursiveRestoreconCount++;
+    }
+    return res;
+}
+
 /**
  * Perform restorecon of the given path, but only perform recursive restorecon
  * if the label of that top-level file actually changed.  This can save us
@@ -331,7 +384,7 @@ static int restorecon_app_data_lazy(const std::string& path, const std::string&
         PLOG(ERROR) << "Failed before getfilecon for " << path;
         goto fail;
     }
-    if (selinux_android_restorecon_pkgdir(path.c_str(), seInfo.c_str(), uid, 0) < 0) {
+    if (restorecon_pkgdir(path, seInfo, uid, 0) < 0) {
         PLOG(ERROR) << "Failed top-level restorecon for " << path;
         goto fail;
     }
@@ -347,8 +400,7 @@ static int restorecon_app_data_lazy(const std::string& path, const std::string&
             LOG(DEBUG) << "Detected label change from " << before << " to " << after << " at "
                     << path << "; running recursive restorecon";
         }
-        if (selinux_android_restorecon_pkgdir(path.c_str(), seInfo.c_str(), uid,
-                SELINUX_ANDROID_RESTORECON_RECURSE) < 0) {
+        if (restorecon_pkgdir(path, seInfo, uid, SELINUX_ANDROID_RESTORECON_RECURSE) < 0) {
             PLOG(ERROR) << "Failed recursive restorecon for " << path;
             goto fail;
         }
@@ -420,45 +472,37 @@ static bool prepare_app_profile_dir(const std::string& packageName, int32_t appI
     return true;
 }
 
-binder::Status InstalldNativeService::createAppDataBatched(
-        const std::unique_ptr<std::vector<std::unique_ptr<std::string>>>& uuids,
-        const std::unique_ptr<std::vector<std::unique_ptr<std::string>>>& packageNames,
-        int32_t userId, int32_t flags, const std::vector<int32_t>& appIds,
-        const std::vector<std::string>& seInfos, const std::vector<int32_t>& targetSdkVersions,
-        int64_t* _aidl_return) {
-    ENFORCE_UID(AID_SYSTEM);
-    std::lock_guard<std::recursive_mutex> lock(mLock);
-
-    ATRACE_BEGIN("createAppDataBatched");
-    binder::Status ret;
-    for (size_t i = 0; i < uuids->size(); i++) {
-        if (!packageNames->at(i)) {
-            continue;
-        }
-        ret = createAppData(uuids->at(i), *packageNames->at(i), userId, flags, appIds[i],
-                seInfos[i], targetSdkVersions[i], _aidl_return);
-        if (!ret.isOk()) {
-            ATRACE_END();
-            return ret;
+// Runs the given tasks on up to maxThreads threads, including the calling
+// one, and waits for all of them to finish.
+static void runInParallel(const std::vector<std::function<void()>>& tasks, size_t maxThreads) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < tasks.size(); i = next++) {
+            tasks[i]();
         }
+    };
+
+    std::vector<std::thread> threads;
+    const size_t numThreads = std::min(tasks.size(), maxThreads);
+    for (size_t i = 1; i < numThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
     }
-    ATRACE_END();
-    return ok();
 }
 
-binder::Status InstalldNativeService::createAppData(const std::unique_ptr<std::string>& uuid,
-        const std::string& packageName, int32_t userId, int32_t flags, int32_t appId,
-        const std::string& seInfo, int32_t targetSdkVersion, int64_t* _aidl_return) {
-    ENFORCE_UID(AID_SYSTEM);
-    CHECK_ARGUMENT_UUID(uuid);
-    CHECK_ARGUMENT_PACKAGE_NAME(packageName);
-    std::lock_guard<std::recursive_mutex> lock(mLock);
-
-    const char* uuid_ = uuid ? uuid->c_str() : nullptr;
+// Prepares the CE and/or DE data directories of a single package. This only
+// touches directories owned by that package, so different packages may be
+// prepared concurrently.
+static binder::Status create_app_data(const char* uuid_, const std::string& packageName,
+        int32_t userId, int32_t flags, int32_t appId, const std::string& seInfo,
+        int32_t targetSdkVersion, int64_t* ceDataInode) {
     const char* pkgname = packageName.c_str();
 
     // Assume invalid inode unless filled in below
-    if (_aidl_return != nullptr) *_aidl_return = -1;
+    if (ceDataInode != nullptr) *ceDataInode = -1;
 
     int32_t uid = multiuser_get_uid(userId, appId);
     int32_t cacheGid = multiuser_get_cache_gid(userId, appId);
@@ -495,12 +539,12 @@ binder::Status InstalldNativeService::createAppData(const std::unique_ptr<std::s
 
         // And return the CE inode of the top-level data directory so we can
         // clear contents while CE storage is locked
-        if (_aidl_return != nullptr) {
+        if (ceDataInode != nullptr) {
             ino_t result;
             if (get_path_inode(path, &result) != 0) {
                 return error("Failed to get_path_inode for " + path);
             }
-            *_aidl_return = static_cast<uint64_t>(result);
+            *ceDataInode = static_cast<uint64_t>(result);
         }
     }
     if (flags & FLAG_STORAGE_DE) {
@@ -527,6 +571,69 @@ binder::Status InstalldNativeService::createAppData(const std::unique_ptr<std::s
     return ok();
 }
 
+binder::Status InstalldNativeService::createAppDataBatched(
+        const std::unique_ptr<std::vector<std::unique_ptr<std::string>>>& uuids,
+        const std::unique_ptr<std::vector<std::unique_ptr<std::string>>>& packageNames,
+        int32_t userId, int32_t flags, const std::vector<int32_t>& appIds,
+        const std::vector<std::string>& seInfos, const std::vector<int32_t>& targetSdkVersions,
+        int64_t* _aidl_return) {
+    ENFORCE_UID(AID_SYSTEM);
+    for (size_t i = 0; i < uuids->size(); i++) {
+        if (!packageNames->at(i)) {
+            continue;
+        }
+        CHECK_ARGUMENT_UUID(uuids->at(i));
+        CHECK_ARGUMENT_PACKAGE_NAME(*packageNames->at(i));
+    }
+    std::lock_guard<std::recursive_mutex> lock(mLock);
+
+    ATRACE_BEGIN("createAppDataBatched");
+    std::vector<binder::Status> results(uuids->size());
+    std::vector<int64_t> ceDataInodes(uuids->size(), -1);
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < uuids->size(); i++) {
+        if (!packageNames->at(i)) {
+            continue;
+        }
+        tasks.push_back([&, i]() {
+            const auto& uuid = uuids->at(i);
+            results[i] = create_app_data(uuid ? uuid->c_str() : nullptr, *packageNames->at(i),
+                    userId, flags, appIds[i], seInfos[i], targetSdkVersions[i],
+                    &ceDataInodes[i]);
+        });
+    }
+    runInParallel(tasks, kMaxCreateAppDataThreads);
+    ATRACE_END();
+
+    // Report the first failure, or the inode of the last package like a
+    // sequence of createAppData calls would
+    for (size_t i = 0; i < uuids->size(); i++) {
+        if (!packageNames->at(i)) {
+            continue;
+        }
+        if (!results[i].isOk()) {
+            return results[i];
+        }
+        if (_aidl_return != nullptr) {
+            *_aidl_return = ceDataInodes[i];
+        }
+    }
+    return ok();
+}
+
+binder::Status InstalldNativeService::createAppData(const std::unique_ptr<std::string>& uuid,
+        const std::string& packageName, int32_t userId, int32_t flags, int32_t appId,
+        const std::string& seInfo, int32_t targetSdkVersion, int64_t* _aidl_return) {
+    ENFORCE_UID(AID_SYSTEM);
+    CHECK_ARGUMENT_UUID(uuid);
+    CHECK_ARGUMENT_PACKAGE_NAME(packageName);
+    std::lock_guard<std::recursive_mutex> lock(mLock);
+
+    const char* uuid_ = uuid ? uuid->c_str() : nullptr;
+    return create_app_data(uuid_, packageName, userId, flags, appId, seInfo, targetSdkVersion,
+            _aidl_return);
+}
+
 binder::Status InstalldNativeService::migrateAppData(const std::unique_ptr<std::string>& uuid,
         const std::string& packageName, int32_t userId, int32_t flags) {
     ENFORCE_UID(AID_SYSTEM);
@@ -1458,13 +1565,11 @@ binder::Status InstalldNativeService::freeCache(const std::unique_ptr<std::strin
             }
 
             // If no items remain, go find another tracker
-            if (active->items.empty()) {
+            auto item = active->popItem();
+            if (item == nullptr) {
                 active = nullptr;
                 continue;
             } else {
-                auto item = active->items.back();
-                active->items.pop_back();
-
                 LOG(DEBUG) << "Purging " << item->toString() << " from " << active->toString();
                 if (!noop) {
                     item->purge();
@@ -1736,6 +1841,12 @@ static void collectManualExternalStatsForUser(const std::string& path, struct st
     fts_close(fts);
 }
 
+static void addStats(struct stats* stats, const struct stats& other) {
+    stats->codeSize += other.codeSize;
+    stats->dataSize += other.dataSize;
+    stats->cacheSize += other.cacheSize;
+}
+
 binder::Status InstalldNativeService::getAppSize(const std::unique_ptr<std::string>& uuid,
         const std::vector<std::string>& packageNames, int32_t userId, int32_t flags,
         int32_t appId, const std::vector<int64_t>& ceDataInodes,
@@ -1782,62 +1893,83 @@ binder::Status InstalldNativeService::getAppSize(const std::unique_ptr<std::stri
     if (!IsQuotaSupported(uuidString)) {
         flags &= ~FLAG_USE_QUOTA;
     }
-
-    ATRACE_BEGIN("obb");
-    for (const auto& packageName : packageNames) {
-        auto obbCodePath = create_data_media_package_path(uuid_, userId,
-                "obb", packageName.c_str());
-        calculate_tree_size(obbCodePath, &extStats.codeSize);
+    const bool useQuota = flags & FLAG_USE_QUOTA && appId >= AID_APP_START;
+
+    // Every code path and package is walked as a separate task into its own
+    // stats, which are summed once all walks are done.
+    std::vector<struct stats> codeStats(codePaths.size());
+    std::vector<struct stats> packageStats(packageNames.size());
+    std::vector<struct stats> packageExtStats(packageNames.size());
+    std::vector<std::function<void()>> tasks;
+
+    for (size_t i = 0; i < codePaths.size(); i++) {
+        tasks.push_back([&, i]() {
+            ATRACE_NAME("code");
+            if (useQuota) {
+                calculate_tree_size(codePaths[i], &codeStats[i].codeSize, -1,
+                        multiuser_get_shared_gid(0, appId));
+            } else {
+                calculate_tree_size(codePaths[i], &codeStats[i].codeSize);
+            }
+        });
     }
-    ATRACE_END();
 
-    if (flags & FLAG_USE_QUOTA && appId >= AID_APP_START) {
-        ATRACE_BEGIN("code");
-        for (const auto& codePath : codePaths) {
-            calculate_tree_size(codePath, &stats.codeSize, -1,
-                    multiuser_get_shared_gid(0, appId));
-        }
-        ATRACE_END();
+    for (size_t i = 0; i < packageNames.size(); i++) {
+        tasks.push_back([&, i]() {
+            const char* pkgname = packageNames[i].c_str();
+            struct stats* pkgStats = &packageStats[i];
+            struct stats* pkgExtStats = &packageExtStats[i];
 
-        ATRACE_BEGIN("quota");
-        collectQuotaStats(uuidString, userId, appId, &stats, &extStats);
-        ATRACE_END();
-    } else {
-        ATRACE_BEGIN("code");
-        for (const auto& codePath : codePaths) {
-            calculate_tree_size(codePath, &stats.codeSize);
-        }
-        ATRACE_END();
+            ATRACE_BEGIN("obb");
+            auto obbCodePath = create_data_media_package_path(uuid_, userId, "obb", pkgname);
+            calculate_tree_size(obbCodePath, &pkgExtStats->codeSize);
+            ATRACE_END();
 
-        for (size_t i = 0; i < packageNames.size(); i++) {
-            const char* pkgname = packageNames[i].c_str();
+            if (useQuota) {
+                return;
+            }
 
             ATRACE_BEGIN("data");
             auto cePath = create_data_user_ce_package_path(uuid_, userId, pkgname, ceDataInodes[i]);
-            collectManualStats(cePath, &stats);
+            collectManualStats(cePath, pkgStats);
             auto dePath = create_data_user_de_package_path(uuid_, userId, pkgname);
-            collectManualStats(dePath, &stats);
+            collectManualStats(dePath, pkgStats);
             ATRACE_END();
 
             if (!uuid) {
                 ATRACE_BEGIN("profiles");
                 calculate_tree_size(
                         create_primary_current_profile_package_dir_path(userId, pkgname),
-                        &stats.dataSize);
+                        &pkgStats->dataSize);
                 calculate_tree_size(
                         create_primary_reference_profile_package_dir_path(pkgname),
-                        &stats.codeSize);
+                        &pkgStats->codeSize);
                 ATRACE_END();
             }
 
             ATRACE_BEGIN("external");
             auto extPath = create_data_media_package_path(uuid_, userId, "data", pkgname);
-            collectManualStats(extPath, &extStats);
+            collectManualStats(extPath, pkgExtStats);
             auto mediaPath = create_data_media_package_path(uuid_, userId, "media", pkgname);
-            calculate_tree_size(mediaPath, &extStats.dataSize);
+            calculate_tree_size(mediaPath, &pkgExtStats->dataSize);
             ATRACE_END();
-        }
+        });
+    }
 
+    runInParallel(tasks, kMaxMeasureThreads);
+    for (const auto& codeStat : codeStats) {
+        addStats(&stats, codeStat);
+    }
+    for (size_t i = 0; i < packageNames.size(); i++) {
+        addStats(&stats, packageStats[i]);
+        addStats(&extStats, packageExtStats[i]);
+    }
+
+    if (useQuota) {
+        ATRACE_BEGIN("quota");
+        collectQuotaStats(uuidString, userId, appId, &stats, &extStats);
+        ATRACE_END();
+    } else {
         if (!uuid) {
             ATRACE_BEGIN("dalvik");
             int32_t sharedGid = multiuser_get_shared_gid(0, appId);
@@ -2211,6 +2343,35 @@ binder::Status InstalldNativeService::getExternalSize(const std::unique_ptr<std:
     return ok();
 }
 
+#ifdef ENABLE_STORAGE_CRATES
+// Maximum number of threads used to collect the crates of several packages.
+static constexpr const size_t kMaxCrateScanThreads = 4;
+
+// Collects the crates of the given packages concurrently, keeping them in package order.
+static void collectCrates(const char* uuid_, int32_t userId,
+        const std::vector<std::string>& packageNames,
+        std::vector<std::unique_ptr<CrateMetadata>>* crates) {
+    std::vector<std::vector<std::unique_ptr<CrateMetadata>>> packageCrates(packageNames.size());
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < packageNames.size(); i++) {
+        tasks.push_back([&, i]() {
+#if CRATE_DEBUG
+            LOG(DEBUG) << "packageName = " << packageNames[i];
+#endif
+            CrateManager crateManager(uuid_, userId, packageNames[i]);
+            crateManager.collectAllCrates(&packageCrates[i]);
+        });
+    }
+    runInParallel(tasks, kMaxCrateScanThreads);
+
+    for (auto& crateList : packageCrates) {
+        for (auto& crate : crateList) {
+            crates->push_back(std::move(crate));
+        }
+    }
+}
+#endif // ENABLE_STORAGE_CRATES
+
 binder::Status InstalldNativeService::getAppCrates(
         const std::unique_ptr<std::string>& uuid,
         const std::vector<std::string>& packageNames, int32_t userId,
@@ -2226,21 +2387,7 @@ binder::Status InstalldNativeService::getAppCrates(
     auto retVector = std::make_unique<std::vector<std::unique_ptr<CrateMetadata>>>();
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
 
-    std::function<void(CratedFolder, std::unique_ptr<CrateMetadata> &)> onCreateCrate =
-            [&](CratedFolder cratedFolder, std::unique_ptr<CrateMetadata> &crateMetadata) -> void {
-        if (cratedFolder == nullptr) {
-            return;
-        }
-        retVector->push_back(std::move(crateMetadata));
-    };
-
-    for (const auto& packageName : packageNames) {
-#if CRATE_DEBUG
-        LOG(DEBUG) << "packageName = " << packageName;
-#endif
-        auto crateManager = std::make_unique<CrateManager>(uuid_, userId, packageName);
-        crateManager->traverseAllCrates(onCreateCrate);
-    }
+    collectCrates(uuid_, userId, packageNames, retVector.get());
 
 #if CRATE_DEBUG
     LOG(WARNING) << "retVector->size() =" << retVector->size();
@@ -2272,19 +2419,12 @@ binder::Status InstalldNativeService::getUserCrates(
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     auto retVector = std::make_unique<std::vector<std::unique_ptr<CrateMetadata>>>();
 
-    std::function<void(CratedFolder, std::unique_ptr<CrateMetadata> &)> onCreateCrate =
-            [&](CratedFolder cratedFolder, std::unique_ptr<CrateMetadata> &crateMetadata) -> void {
-        if (cratedFolder == nullptr) {
-            return;
-        }
-        retVector->push_back(std::move(crateMetadata));
-    };
-
+    std::vector<std::string> packageNames;
     std::function<void(FTSENT*)> onHandingPackage = [&](FTSENT* packageDir) -> void {
-        auto crateManager = std::make_unique<CrateManager>(uuid_, userId, packageDir->fts_name);
-        crateManager->traverseAllCrates(onCreateCrate);
+        packageNames.push_back(packageDir->fts_name);
     };
     CrateManager::traverseAllPackagesForUser(uuid, userId, onHandingPackage);
+    collectCrates(uuid_, userId, packageNames, retVector.get());
 
 #if CRATE_DEBUG
     LOG(DEBUG) << "retVector->size() =" << retVector->size();
@@ -2397,7 +2537,7 @@ binder::Status InstalldNativeService::dexopt(const std::string& apkPath, int32_t
     }
     CHECK_ARGUMENT_PATH(outputPath);
     CHECK_ARGUMENT_PATH(dexMetadataPath);
-    std::lock_guard<std::recursive_mutex> lock(mLock);
+    std::unique_lock<std::recursive_mutex> lock(mLock);
 
     const char* oat_dir = getCStr(outputPath);
     const char* instruction_set = instructionSet.c_str();
@@ -2406,6 +2546,19 @@ binder::Status InstalldNativeService::dexopt(const std::string& apkPath, int32_t
         oat_dir = nullptr;
     }
 
+    // When parallel compiles are allowed, only the setup above is serialized
+    // against other installd calls; the compile itself waits for a job slot.
+    const int32_t maxJobs = android::base::GetIntProperty(kDexoptMaxParallelJobsProperty, 1);
+    {
+        std::unique_lock<std::mutex> jobsLock(mDexoptJobsLock);
+        if (maxJobs > 1) {
+            lock.unlock();
+            mDexoptJobsCondition.wait(jobsLock, [&]() { return mDexoptJobsRunning < maxJobs; });
+        }
+        mDexoptJobsRunning++;
+    }
+    const nsecs_t startTime = systemTime();
+
     const char* apk_path = apkPath.c_str();
     const char* pkgname = getCStr(packageName, "*");
     const char* compiler_filter = compilerFilter.c_str();
@@ -2419,6 +2572,26 @@ binder::Status InstalldNativeService::dexopt(const std::string& apkPath, int32_t
     int res = android::installd::dexopt(apk_path, uid, pkgname, instruction_set, dexoptNeeded,
             oat_dir, dexFlags, compiler_filter, volume_uuid, class_loader_context, se_info,
             downgrade, targetSdkVersion, profile_name, dm_path, compilation_reason, &error_msg);
+
+    const nsecs_t duration = systemTime() - startTime;
+    LOG(DEBUG) << "dexopt of " << pkgname << " (" << instruction_set << ", " << compiler_filter
+            << ") took " << ns2ms(duration) << " ms";
+    {
+        std::lock_guard<std::mutex> jobsLock(mDexoptJobsLock);
+        mDexoptJobsRunning--;
+        DexoptJobStats& stats = mDexoptJobStats;
+        stats.count++;
+        if (res != 0) {
+            stats.failed++;
+        }
+        stats.totalTimeNs += duration;
+        if (duration > stats.maxTimeNs) {
+            stats.maxTimeNs = duration;
+            stats.slowestPackage = pkgname;
+        }
+    }
+    mDexoptJobsCondition.notify_one();
+
     return res ? error(res, error_msg) : ok();
 }
 
@@ -2533,25 +2706,34 @@ binder::Status InstalldNativeService::restoreconAppData(const std::unique_ptr<st
     CHECK_ARGUMENT_PACKAGE_NAME(packageName);
     std::lock_guard<std::recursive_mutex> lock(mLock);
 
-    binder::Status res = ok();
-
     // SELINUX_ANDROID_RESTORECON_DATADATA flag is set by libselinux. Not needed here.
     unsigned int seflags = SELINUX_ANDROID_RESTORECON_RECURSE;
     const char* uuid_ = uuid ? uuid->c_str() : nullptr;
     const char* pkgName = packageName.c_str();
-    const char* seinfo = seInfo.c_str();
 
-    uid_t uid = multiuser_get_uid(userId, appId);
+    std::vector<std::string> paths;
     if (flags & FLAG_STORAGE_CE) {
-        auto path = create_data_user_ce_package_path(uuid_, userId, pkgName);
-        if (selinux_android_restorecon_pkgdir(path.c_str(), seinfo, uid, seflags) < 0) {
-            res = error("restorecon failed for " + path);
-        }
+        paths.push_back(create_data_user_ce_package_path(uuid_, userId, pkgName));
     }
     if (flags & FLAG_STORAGE_DE) {
-        auto path = create_data_user_de_package_path(uuid_, userId, pkgName);
-        if (selinux_android_restorecon_pkgdir(path.c_str(), seinfo, uid, seflags) < 0) {
-            res = error("restorecon failed for " + path);
+        paths.push_back(create_data_user_de_package_path(uuid_, userId, pkgName));
+    }
+
+    // The CE and DE trees are independent, so label them concurrently
+    uid_t uid = multiuser_get_uid(userId, appId);
+    std::vector<int> results(paths.size());
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < paths.size(); i++) {
+        tasks.push_back([&, i]() {
+            results[i] = restorecon_pkgdir(paths[i], seInfo, uid, seflags);
+        });
+    }
+    runInParallel(tasks, paths.size());
+
+    binder::Status res = ok();
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (results[i] < 0) {
+            res = error("restorecon failed for " + paths[i]);
         }
     }
     return res;
@@ -21,6 +21,8 @@
 #include <inttypes.h>
 #include <unistd.h>
 
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
@@ -184,6 +186,21 @@ private:
     /* Map from UID to cache quota size */
     std::unordered_map<uid_t, int64_t> mCacheQuotas;
 
+    /* Bounds the number of dexopt calls compiling at once */
+    std::mutex mDexoptJobsLock;
+    std::condition_variable mDexoptJobsCondition;
+    int32_t mDexoptJobsRunning = 0;
+
+    /* Timing of finished dexopt calls, guarded by mDexoptJobsLock */
+    struct DexoptJobStats {
+        uint64_t count = 0;
+        uint64_t failed = 0;
+        int64_t totalTimeNs = 0;
+        int64_t maxTimeNs = 0;
+        std::string slowestPackage;
+    };
+    DexoptJobStats mDexoptJobStats;
+
     std::string findDataMediaPath(const std::unique_ptr<std::string>& uuid, userid_t userid);
 };
 
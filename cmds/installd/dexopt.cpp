@@ -37,6 +37,7 @@
 #include <android-base/strings.h>
 #include <android-base/unique_fd.h>
 #include <cutils/fs.h>
+#include <cutils/iosched_policy.h>
 #include <cutils/properties.h>
 #include <cutils/sched_policy.h>
 #include <dex2oat_return_codes.h>
@@ -662,6 +663,11 @@ static void SetDex2OatScheduling(bool set_to_bg) {
             PLOG(ERROR) << "setpriority failed";
             exit(DexoptReturnCodes::kSetPriority);
         }
+        // Keep background compiles from competing with foreground I/O. This is
+        // best effort, so a failure doesn't abort the compile.
+        if (android_set_ioprio(0, IoSchedClass_BE, 7) < 0) {
+            PLOG(WARNING) << "android_set_ioprio failed";
+        }
     }
 }
 
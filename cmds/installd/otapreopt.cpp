@@ -27,6 +27,7 @@
 #include <sys/prctl.h>
 #include <sys/stat.h>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/macros.h>
 #include <android-base/stringprintf.h>
@@ -37,6 +38,7 @@
 #include <dex2oat_return_codes.h>
 #include <log/log.h>
 #include <private/android_filesystem_config.h>
+#include <utils/Timers.h>
 
 #include "dexopt.h"
 #include "file_parsing.h"
@@ -500,20 +502,75 @@ private:
             return 0;
         }
 
-        int dexopt_result = Dexopt();
-        if (dexopt_result == 0) {
+        if (HasCheckpoint()) {
+            LOG(INFO) << "Skipping " << parameters_.apk_path
+                    << ", already compiled for this update";
             return 0;
         }
 
+        const nsecs_t start_time = systemTime();
+        int dexopt_result = Dexopt();
+
         // If this was a profile-guided run, we may have profile version issues. Try to downgrade,
         // if possible.
-        if ((parameters_.dexopt_flags & DEXOPT_PROFILE_GUIDED) == 0) {
-            return dexopt_result;
+        if (dexopt_result != 0 && (parameters_.dexopt_flags & DEXOPT_PROFILE_GUIDED) != 0) {
+            LOG(WARNING) << "Downgrading compiler filter in an attempt to progress compilation";
+            parameters_.dexopt_flags &= ~DEXOPT_PROFILE_GUIDED;
+            dexopt_result = Dexopt();
         }
 
-        LOG(WARNING) << "Downgrading compiler filter in an attempt to progress compilation";
-        parameters_.dexopt_flags &= ~DEXOPT_PROFILE_GUIDED;
-        return Dexopt();
+        const nsecs_t duration = systemTime() - start_time;
+        LOG(INFO) << "Compiling " << parameters_.apk_path << " (" << parameters_.compiler_filter
+                << ") took " << ns2ms(duration) << " ms, result " << dexopt_result;
+        if (dexopt_result == 0) {
+            WriteCheckpoint(duration);
+        }
+        return dexopt_result;
+    }
+
+    // Packages compiled for this update are checkpointed in the OTA data
+    // directory, so that a run that gets interrupted (e.g. by a reboot that
+    // resets the OTA service's state) does not compile them again. The file
+    // also records how long the compile took.
+    std::string GetCheckpointPath() const {
+        std::string name = StringPrintf("%s@%s@%s", parameters_.apk_path,
+                parameters_.instruction_set, parameters_.compiler_filter);
+        std::replace(name.begin(), name.end(), '/', '@');
+        return StringPrintf("%s/preopt_checkpoints/%s", GetOTADataDirectory().c_str(),
+                name.c_str());
+    }
+
+    // A checkpoint is only valid for the build it was written for.
+    std::string GetTargetFingerprint() const {
+        const std::string* fingerprint = system_properties_.GetProperty("ro.build.fingerprint");
+        return fingerprint != nullptr ? *fingerprint : "";
+    }
+
+    bool HasCheckpoint() const {
+        const std::string fingerprint = GetTargetFingerprint();
+        std::string content;
+        if (fingerprint.empty() ||
+                !android::base::ReadFileToString(GetCheckpointPath(), &content)) {
+            return false;
+        }
+        return Split(content, "\n")[0] == fingerprint;
+    }
+
+    void WriteCheckpoint(nsecs_t duration) const {
+        const std::string fingerprint = GetTargetFingerprint();
+        if (fingerprint.empty()) {
+            return;
+        }
+        const std::string path = GetCheckpointPath();
+        const std::string dir = path.substr(0, path.rfind('/'));
+        if (access(dir.c_str(), F_OK) != 0 && !CreatePath(dir)) {
+            return;
+        }
+        const std::string content =
+                StringPrintf("%s\n%" PRId64 "\n", fingerprint.c_str(), ns2ms(duration));
+        if (!android::base::WriteStringToFile(content, path)) {
+            PLOG(WARNING) << "Could not write checkpoint " << path;
+        }
     }
 
     ////////////////////////////////////
@@ -638,5 +638,36 @@ TEST_F(UtilsTest, TestCreateDirIfNeeded) {
     ASSERT_NE(0, create_dir_if_needed("/data/local/tmp/user/0/bar/baz", 0700));
 }
 
+TEST_F(UtilsTest, TestCalculateTreeSize) {
+    system("mkdir -p /data/local/tmp/user/0/tree/a/b /data/local/tmp/user/0/tree/c");
+    system("echo hello > /data/local/tmp/user/0/tree/a/b/file");
+    system("dd if=/dev/zero of=/data/local/tmp/user/0/tree/c/file bs=4096 count=4");
+
+    auto deleter = [&]() {
+        delete_dir_contents_and_dir("/data/local/tmp/user/0", true /* ignore_if_missing */);
+    };
+    auto scope_guard = android::base::make_scope_guard(deleter);
+
+    int64_t expected = 0;
+    for (const char* path : {"", "/a", "/a/b", "/a/b/file", "/c", "/c/file"}) {
+        struct stat st;
+        ASSERT_EQ(0, lstat((std::string("/data/local/tmp/user/0/tree") + path).c_str(), &st));
+        expected += st.st_blocks * 512;
+    }
+
+    int64_t size = 0;
+    ASSERT_EQ(0, calculate_tree_size("/data/local/tmp/user/0/tree", &size));
+    EXPECT_EQ(expected, size);
+
+    // Everything is owned by the same gid, so excluding it measures nothing.
+    struct stat st;
+    ASSERT_EQ(0, stat("/data/local/tmp/user/0/tree", &st));
+    size = 0;
+    ASSERT_EQ(0, calculate_tree_size("/data/local/tmp/user/0/tree", &size, -1, st.st_gid));
+    EXPECT_EQ(0, size);
+
+    ASSERT_EQ(-1, calculate_tree_size("/data/local/tmp/user/0/missing", &size));
+}
+
 }  // namespace installd
 }  // namespace android
@@ -32,6 +32,7 @@
 #include <android-base/stringprintf.h>
 #include <android-base/unique_fd.h>
 #include <cutils/fs.h>
+#include <diskusage/tree_size.h>
 #include <cutils/properties.h>
 #include <log/log.h>
 #include <private/android_filesystem_config.h>
@@ -378,45 +379,35 @@ std::vector<userid_t> get_known_users(const char* volume_uuid) {
 
 int calculate_tree_size(const std::string& path, int64_t* size,
         int32_t include_gid, int32_t exclude_gid, bool exclude_apps) {
-    FTS *fts;
-    FTSENT *p;
-    int64_t matchedSize = 0;
-    char *argv[] = { (char*) path.c_str(), nullptr };
-    if (!(fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, nullptr))) {
-        if (errno != ENOENT) {
-            PLOG(ERROR) << "Failed to fts_open " << path;
-        }
-        return -1;
-    }
-    while ((p = fts_read(fts)) != nullptr) {
-        switch (p->fts_info) {
-        case FTS_D:
-        case FTS_DEFAULT:
-        case FTS_F:
-        case FTS_SL:
-        case FTS_SLNONE:
-            int32_t uid = p->fts_statp->st_uid;
-            int32_t gid = p->fts_statp->st_gid;
+    using android::diskusage::TreeVisit;
+    android::diskusage::TreeOptions options;
+    if (exclude_apps || include_gid != -1 || exclude_gid != -1) {
+        options.filter = [=](uid_t uid, gid_t gid) {
             int32_t user_uid = multiuser_get_app_id(uid);
             int32_t user_gid = multiuser_get_app_id(gid);
             if (exclude_apps && ((user_uid >= AID_APP_START && user_uid <= AID_APP_END)
                     || (user_gid >= AID_CACHE_GID_START && user_gid <= AID_CACHE_GID_END)
                     || (user_gid >= AID_SHARED_GID_START && user_gid <= AID_SHARED_GID_END))) {
                 // Don't traverse inside or measure
-                fts_set(fts, p, FTS_SKIP);
-                break;
+                return TreeVisit::SKIP_TREE;
             }
-            if (include_gid != -1 && gid != include_gid) {
-                break;
+            if (include_gid != -1 && static_cast<int32_t>(gid) != include_gid) {
+                return TreeVisit::IGNORE;
             }
-            if (exclude_gid != -1 && gid == exclude_gid) {
-                break;
+            if (exclude_gid != -1 && static_cast<int32_t>(gid) == exclude_gid) {
+                return TreeVisit::IGNORE;
             }
-            matchedSize += (p->fts_statp->st_blocks * 512);
-            break;
+            return TreeVisit::MEASURE;
+        };
+    }
+    android::diskusage::TreeStats stats;
+    if (android::diskusage::calculate_tree_stats(path, &stats, options) != 0) {
+        if (errno != ENOENT) {
+            PLOG(ERROR) << "Failed to measure " << path;
         }
+        return -1;
     }
-    fts_close(fts);
+    int64_t matchedSize = stats.size;
 #if MEASURE_DEBUG
     if ((include_gid == -1) && (exclude_gid == -1)) {
         LOG(DEBUG) << "Measured " << path << " size " << matchedSize;
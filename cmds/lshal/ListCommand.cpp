@@ -53,6 +53,9 @@ using ::android::hidl::manager::V1_0::IServiceManager;
 namespace android {
 namespace lshal {
 
+// Maximum number of HAL instances queried at the same time when fetching entries or debug info.
+static constexpr size_t kMaxFetchThreads = 8;
+
 vintf::SchemaType toSchemaType(Partition p) {
     return (p == Partition::SYSTEM) ? vintf::SchemaType::FRAMEWORK : vintf::SchemaType::DEVICE;
 }
@@ -293,6 +296,7 @@ bool ListCommand::getPidInfo(
 }
 
 const PidInfo* ListCommand::getPidInfoCached(pid_t serverPid) {
+    std::lock_guard<std::mutex> lock(mCachedPidInfosLock);
     auto pair = mCachedPidInfos.insert({serverPid, PidInfo{}});
     if (pair.second /* did insertion take place? */) {
         if (!getPidInfo(serverPid, &pair.first->second)) {
@@ -550,14 +554,29 @@ void ListCommand::dumpTable(const NullableOStream<std::ostream>& out) const {
         // debug info for a service we create on the fly, so we only operate
         // on the "mServicesTable".
         std::function<std::string(const std::string&)> emitDebugInfo = nullptr;
+        std::map<std::string, std::string> debugInfos;
         if (mEmitDebugInfo && &table == &mServicesTable) {
-            emitDebugInfo = [this](const auto& iName) {
+            // Collect debug info from all instances up front, several at a time; each call is
+            // bounded by the PipeRelay read timeout.
+            std::vector<std::string> names;
+            for (const auto& entry : table) {
+                names.push_back(entry.interfaceName);
+            }
+            std::vector<std::string> infos(names.size());
+            forEachInParallel(names.size(), kMaxFetchThreads, [&](size_t i) {
                 std::stringstream ss;
-                auto pair = splitFirst(iName, '/');
+                auto pair = splitFirst(names[i], '/');
                 mLshal.emitDebugInfo(pair.first, pair.second, {},
                                      false /* excludesParentInstances */, ss,
                                      NullableOStream<std::ostream>(nullptr));
-                return ss.str();
+                infos[i] = ss.str();
+            });
+            for (size_t i = 0; i < names.size(); ++i) {
+                debugInfos.emplace(names[i], std::move(infos[i]));
+            }
+            emitDebugInfo = [&debugInfos](const auto& iName) {
+                auto it = debugInfos.find(iName);
+                return it == debugInfos.end() ? std::string() : it->second;
             };
         }
         table.createTextTable(mNeat, emitDebugInfo).dump(out.buf());
@@ -671,14 +690,26 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
 
     Status status = OK;
     std::map<std::string, TableEntry> allTableEntries;
+    std::vector<TableEntry*> entries;
     for (const auto &fqInstanceName : fqInstanceNames) {
         // create entry and default assign all fields.
         TableEntry& entry = allTableEntries[fqInstanceName];
         entry.interfaceName = fqInstanceName;
         entry.transport = mode;
         entry.serviceStatus = ServiceStatus::NON_RESPONSIVE;
+        entries.push_back(&entry);
+    }
 
-        status |= fetchBinderizedEntry(manager, &entry);
+    // Instances are queried concurrently; every IPC is still bounded by timeoutIPC. Results and
+    // warnings are kept per instance and reported in instance order.
+    std::vector<Status> statuses(entries.size(), OK);
+    std::vector<std::string> warnings(entries.size());
+    forEachInParallel(entries.size(), kMaxFetchThreads, [&](size_t i) {
+        statuses[i] = fetchBinderizedEntry(manager, entries[i], &warnings[i]);
+    });
+    for (size_t i = 0; i < entries.size(); ++i) {
+        err() << warnings[i];
+        status |= statuses[i];
     }
 
     for (auto& pair : allTableEntries) {
@@ -688,10 +719,10 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
 }
 
 Status ListCommand::fetchBinderizedEntry(const sp<IServiceManager> &manager,
-                                         TableEntry *entry) {
+                                         TableEntry *entry, std::string *warnings) {
     Status status = OK;
     const auto handleError = [&](Status additionalError, const std::string& msg) {
-        err() << "Warning: Skipping \"" << entry->interfaceName << "\": " << msg << std::endl;
+        warnings->append("Warning: Skipping \"" + entry->interfaceName + "\": " + msg + "\n");
         status |= DUMP_BINDERIZED_ERROR | additionalError;
     };
 
@@ -20,6 +20,7 @@
 #include <stdint.h>
 
 #include <fstream>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -101,8 +102,10 @@ protected:
     Status fetchManifestHals();
     Status fetchLazyHals();
 
+    // Fills in *entry. May be called concurrently for different entries; warnings are appended
+    // to *warnings instead of err() so that callers can emit them in a stable order.
     Status fetchBinderizedEntry(const sp<::android::hidl::manager::V1_0::IServiceManager> &manager,
-                                TableEntry *entry);
+                                TableEntry *entry, std::string *warnings);
 
     // Get relevant information for a PID by parsing files under
     // /dev/binderfs/binder_logs or /d/binder.
@@ -188,6 +191,7 @@ protected:
     std::map<pid_t, std::string> mCmdlines;
 
     // Cache for getPidInfo.
+    std::mutex mCachedPidInfosLock;
     std::map<pid_t, PidInfo> mCachedPidInfos;
 
     // Cache for getPartition.
@@ -17,6 +17,7 @@
 #define LOG_TAG "Lshal"
 #include <android-base/logging.h>
 
+#include <atomic>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -883,6 +884,18 @@ TEST_F(HelpTest, UnknownOptionHelp2) {
     EXPECT_EQ("", out.str());
 }
 
+TEST(UtilsTest, ForEachInParallel) {
+    std::vector<std::atomic<int>> calls(100);
+    forEachInParallel(calls.size(), 8, [&](size_t i) { ++calls[i]; });
+    for (size_t i = 0; i < calls.size(); ++i) {
+        EXPECT_EQ(1, calls[i]) << "index " << i;
+    }
+
+    bool called = false;
+    forEachInParallel(0, 8, [&](size_t) { called = true; });
+    EXPECT_FALSE(called);
+}
+
 } // namespace lshal
 } // namespace android
 
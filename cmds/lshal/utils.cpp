@@ -16,6 +16,10 @@
 
 #include "utils.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 namespace android {
 namespace lshal {
 
@@ -48,6 +52,27 @@ void replaceAll(std::string *s, char from, char to) {
     }
 }
 
+void forEachInParallel(size_t count, size_t maxThreads, const std::function<void(size_t)> &func) {
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < count; i = next++) {
+            func(i);
+        }
+    };
+    size_t threadCount = std::min(maxThreads, count);
+    if (threadCount <= 1) {
+        worker();
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
 }  // namespace lshal
 }  // namespace android
 
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <string>
@@ -85,5 +86,10 @@ std::vector<std::string> split(const std::string &s, char c);
 
 void replaceAll(std::string *s, char from, char to);
 
+// Calls func(0) ... func(count - 1) on up to maxThreads threads and returns when all calls are
+// done. Calls may run in any order, so func must only touch state owned by its index or
+// protected by a lock.
+void forEachInParallel(size_t count, size_t maxThreads, const std::function<void(size_t)> &func);
+
 }  // namespace lshal
 }  // namespace android
@@ -24,6 +24,7 @@
 #include <binder/Stability.h>
 #include <cutils/android_filesystem_config.h>
 #include <cutils/multiuser.h>
+#include <utils/SystemClock.h>
 #include <thread>
 
 #ifndef VENDORSERVICEMANAGER
@@ -128,9 +129,27 @@ Status ServiceManager::checkService(const std::string& name, sp<IBinder>* outBin
     return Status::ok();
 }
 
-sp<IBinder> ServiceManager::tryGetService(const std::string& name, bool startIfNotFound) {
+Status ServiceManager::getServices(const std::vector<std::string>& names,
+                                   std::vector<sp<IBinder>>* outBinders) {
+    // Resolve the caller's SELinux context once for the whole batch rather
+    // than once per name.
     auto ctx = mAccess->getCallingContext();
 
+    outBinders->clear();
+    outBinders->reserve(names.size());
+    for (const std::string& name : names) {
+        outBinders->push_back(tryGetService(ctx, name, true));
+    }
+    // like getService, missing or inaccessible services are just null
+    return Status::ok();
+}
+
+sp<IBinder> ServiceManager::tryGetService(const std::string& name, bool startIfNotFound) {
+    return tryGetService(mAccess->getCallingContext(), name, startIfNotFound);
+}
+
+sp<IBinder> ServiceManager::tryGetService(const Access::CallingContext& ctx,
+                                          const std::string& name, bool startIfNotFound) {
     sp<IBinder> out;
     Service* service = nullptr;
     if (auto it = mNameToService.find(name); it != mNameToService.end()) {
@@ -159,6 +178,7 @@ sp<IBinder> ServiceManager::tryGetService(const std::string& name, bool startIfN
         // Setting this guarantee each time we hand out a binder ensures that the client-checking
         // loop knows about the event even if the client immediately drops the service
         service->guaranteeClient = true;
+        scheduleClientCallbackCheck(name, service);
     }
 
     return out;
@@ -214,6 +234,9 @@ Status ServiceManager::addService(const std::string& name, const sp<IBinder>& bi
     }
 
     // Overwrite the old service if it exists
+    if (auto it = mNameToService.find(name); it != mNameToService.end()) {
+        unscheduleClientCallbackCheck(name, &it->second);
+    }
     mNameToService[name] = Service {
         .binder = binder,
         .allowIsolated = allowIsolated,
@@ -228,6 +251,7 @@ Status ServiceManager::addService(const std::string& name, const sp<IBinder>& bi
             // permission checked in registerForNotifications
             cb->onRegistration(name, binder);
         }
+        scheduleClientCallbackCheck(name, &mNameToService[name]);
     }
 
     return Status::ok();
@@ -355,6 +379,7 @@ void ServiceManager::removeRegistrationCallback(const wp<IBinder>& who,
 void ServiceManager::binderDied(const wp<IBinder>& who) {
     for (auto it = mNameToService.begin(); it != mNameToService.end();) {
         if (who == it->second.binder) {
+            unscheduleClientCallbackCheck(it->first, &it->second);
             it = mNameToService.erase(it);
         } else {
             ++it;
@@ -414,6 +439,9 @@ Status ServiceManager::registerClientCallback(const std::string& name, const sp<
 
     mNameToClientCallback[name].push_back(cb);
 
+    // pick up the current client state, which may already have clients
+    scheduleClientCallbackCheck(name, &serviceIt->second);
+
     return Status::ok();
 }
 
@@ -443,9 +471,53 @@ ssize_t ServiceManager::Service::getNodeStrongRefCount() {
     return ProcessState::self()->getStrongRefCountForNodeByHandle(bpBinder->handle());
 }
 
+void ServiceManager::scheduleClientCallbackCheck(const std::string& name, Service* service) {
+    if (mNameToClientCallback.count(name) < 1) return;
+
+    int64_t deadline = uptimeMillis() + kClientCallbackIntervalMs;
+    if (service->nextClientCheckMs != 0) {
+        if (service->nextClientCheckMs <= deadline) return;
+        unscheduleClientCallbackCheck(name, service);
+    }
+
+    service->nextClientCheckMs = deadline;
+    mClientCallbackChecks.emplace(deadline, name);
+}
+
+void ServiceManager::unscheduleClientCallbackCheck(const std::string& name, Service* service) {
+    if (service->nextClientCheckMs == 0) return;
+
+    mClientCallbackChecks.erase({service->nextClientCheckMs, name});
+    service->nextClientCheckMs = 0;
+}
+
+int64_t ServiceManager::nextClientCallbackCheckMs() const {
+    if (mClientCallbackChecks.empty()) return -1;
+    return mClientCallbackChecks.begin()->first;
+}
+
 void ServiceManager::handleClientCallbacks() {
-    for (const auto& [name, service] : mNameToService) {
-        handleServiceClientCallback(name, true);
+    const int64_t now = uptimeMillis();
+
+    while (!mClientCallbackChecks.empty() && mClientCallbackChecks.begin()->first <= now) {
+        const std::string name = mClientCallbackChecks.begin()->second;
+        mClientCallbackChecks.erase(mClientCallbackChecks.begin());
+
+        auto serviceIt = mNameToService.find(name);
+        if (serviceIt == mNameToService.end()) continue;
+        Service& service = serviceIt->second;
+        service.nextClientCheckMs = 0;
+
+        // -1: no callbacks, or the driver can't report refcounts, so there is
+        // nothing to poll for
+        if (handleServiceClientCallback(name, true) < 0) continue;
+
+        // The driver does not notify us when the last client goes away, so
+        // keep polling while there are clients. Without clients, the next
+        // getService or tryUnregisterService schedules a check again.
+        if (service.hasClients) {
+            scheduleClientCallbackCheck(name, &service);
+        }
     }
 }
 
@@ -561,9 +633,11 @@ Status ServiceManager::tryUnregisterService(const std::string& name, const sp<IB
         LOG(INFO) << "Tried to unregister " << name << ", but there are clients: " << clients;
         // Set this flag to ensure the clients are acknowledged in the next callback
         serviceIt->second.guaranteeClient = true;
+        scheduleClientCallbackCheck(name, &serviceIt->second);
         return Status::fromExceptionCode(Status::EX_ILLEGAL_STATE);
     }
 
+    unscheduleClientCallbackCheck(name, &serviceIt->second);
     mNameToService.erase(name);
 
     return Status::ok();
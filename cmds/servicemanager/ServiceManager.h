@@ -20,6 +20,8 @@
 #include <android/os/IClientCallback.h>
 #include <android/os/IServiceCallback.h>
 
+#include <set>
+
 #include "Access.h"
 
 namespace android {
@@ -35,6 +37,8 @@ public:
     // getService will try to start any services it cannot find
     binder::Status getService(const std::string& name, sp<IBinder>* outBinder) override;
     binder::Status checkService(const std::string& name, sp<IBinder>* outBinder) override;
+    binder::Status getServices(const std::vector<std::string>& names,
+                               std::vector<sp<IBinder>>* outBinders) override;
     binder::Status addService(const std::string& name, const sp<IBinder>& binder,
                               bool allowIsolated, int32_t dumpPriority) override;
     binder::Status listServices(int32_t dumpPriority, std::vector<std::string>* outList) override;
@@ -48,7 +52,17 @@ public:
                                           const sp<IClientCallback>& cb) override;
     binder::Status tryUnregisterService(const std::string& name, const sp<IBinder>& binder) override;
     void binderDied(const wp<IBinder>& who) override;
+
+    // Checks the services whose client-callback checks are due. Only services
+    // that have client callbacks and may change state are scheduled, so an
+    // idle device with only unused lazy services schedules nothing.
     void handleClientCallbacks();
+    // uptimeMillis() at which handleClientCallbacks() next has work to do, or
+    // -1 if no check is scheduled.
+    int64_t nextClientCallbackCheckMs() const;
+
+    // how often a service with clients is checked for losing them
+    static constexpr int64_t kClientCallbackIntervalMs = 5000;
 
 protected:
     virtual void tryStartService(const std::string& name);
@@ -61,6 +75,7 @@ private:
         bool hasClients = false; // notifications sent on true -> false.
         bool guaranteeClient = false; // forces the client check to true
         pid_t debugPid = 0; // the process in which this service runs
+        int64_t nextClientCheckMs = 0; // key in mClientCallbackChecks, 0 if unscheduled
 
         // the number of clients of the service, including servicemanager itself
         ssize_t getNodeStrongRefCount();
@@ -69,6 +84,8 @@ private:
     using ServiceCallbackMap = std::map<std::string, std::vector<sp<IServiceCallback>>>;
     using ClientCallbackMap = std::map<std::string, std::vector<sp<IClientCallback>>>;
     using ServiceMap = std::map<std::string, Service>;
+    // (deadline in uptimeMillis(), service name), earliest first
+    using ClientCallbackSchedule = std::set<std::pair<int64_t, std::string>>;
 
     // removes a callback from mNameToRegistrationCallback, removing it if the vector is empty
     // this updates iterator to the next location
@@ -81,12 +98,19 @@ private:
     // removes a callback from mNameToClientCallback, deleting the entry if the vector is empty
     // this updates the iterator to the next location
     void removeClientCallback(const wp<IBinder>& who, ClientCallbackMap::iterator* it);
+    // schedules a client check for a service with client callbacks, keeping
+    // an earlier deadline if one is already scheduled
+    void scheduleClientCallbackCheck(const std::string& name, Service* service);
+    void unscheduleClientCallbackCheck(const std::string& name, Service* service);
 
     sp<IBinder> tryGetService(const std::string& name, bool startIfNotFound);
+    sp<IBinder> tryGetService(const Access::CallingContext& ctx, const std::string& name,
+                              bool startIfNotFound);
 
     ServiceMap mNameToService;
     ServiceCallbackMap mNameToRegistrationCallback;
     ClientCallbackMap mNameToClientCallback;
+    ClientCallbackSchedule mClientCallbackChecks;
 
     std::unique_ptr<Access> mAccess;
 };
@@ -22,6 +22,8 @@
 #include <utils/Looper.h>
 #include <utils/StrongPointer.h>
 
+#include <algorithm>
+
 #include "Access.h"
 #include "ServiceManager.h"
 
@@ -36,57 +38,17 @@ using ::android::ServiceManager;
 using ::android::os::IServiceManager;
 using ::android::sp;
 
-class BinderCallback : public LooperCallback {
-public:
-    static sp<BinderCallback> setupTo(const sp<Looper>& looper) {
-        sp<BinderCallback> cb = new BinderCallback;
-
-        int binder_fd = -1;
-        IPCThreadState::self()->setupPolling(&binder_fd);
-        LOG_ALWAYS_FATAL_IF(binder_fd < 0, "Failed to setupPolling: %d", binder_fd);
-
-        // Flush after setupPolling(), to make sure the binder driver
-        // knows about this thread handling commands.
-        IPCThreadState::self()->flushCommands();
-
-        int ret = looper->addFd(binder_fd,
-                                Looper::POLL_CALLBACK,
-                                Looper::EVENT_INPUT,
-                                cb,
-                                nullptr /*data*/);
-        LOG_ALWAYS_FATAL_IF(ret != 1, "Failed to add binder FD to Looper");
-
-        return cb;
-    }
-
-    int handleEvent(int /* fd */, int /* events */, void* /* data */) override {
-        IPCThreadState::self()->handlePolledCommands();
-        return 1;  // Continue receiving callbacks.
-    }
-};
-
 // LooperCallback for IClientCallback
+//
+// The timer is one-shot and only armed while ServiceManager has a client check
+// scheduled, so servicemanager does not wake up when nothing can change.
 class ClientCallbackCallback : public LooperCallback {
 public:
     static sp<ClientCallbackCallback> setupTo(const sp<Looper>& looper, const sp<ServiceManager>& manager) {
-        sp<ClientCallbackCallback> cb = new ClientCallbackCallback(manager);
-
-        int fdTimer = timerfd_create(CLOCK_MONOTONIC, 0 /*flags*/);
+        int fdTimer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
         LOG_ALWAYS_FATAL_IF(fdTimer < 0, "Failed to timerfd_create: fd: %d err: %d", fdTimer, errno);
 
-        itimerspec timespec {
-            .it_interval = {
-                .tv_sec = 5,
-                .tv_nsec = 0,
-            },
-            .it_value = {
-                .tv_sec = 5,
-                .tv_nsec = 0,
-            },
-        };
-
-        int timeRes = timerfd_settime(fdTimer, 0 /*flags*/, &timespec, nullptr);
-        LOG_ALWAYS_FATAL_IF(timeRes < 0, "Failed to timerfd_settime: res: %d err: %d", timeRes, errno);
+        sp<ClientCallbackCallback> cb = new ClientCallbackCallback(manager, fdTimer);
 
         int addRes = looper->addFd(fdTimer,
                                    Looper::POLL_CALLBACK,
@@ -95,6 +57,7 @@ public:
                                    nullptr);
         LOG_ALWAYS_FATAL_IF(addRes != 1, "Failed to add client callback FD to Looper");
 
+        cb->rearm();
         return cb;
     }
 
@@ -105,12 +68,78 @@ public:
             ALOGE("Read failed to callback FD: ret: %d err: %d", ret, errno);
         }
 
+        mArmedAtMs = -1;
         mManager->handleClientCallbacks();
+        rearm();
         return 1;  // Continue receiving callbacks.
     }
+
+    // Arms the timer for the next scheduled check. Called after every batch of
+    // binder commands, so it only touches the timer when the deadline moved.
+    void rearm() {
+        int64_t deadlineMs = mManager->nextClientCallbackCheckMs();
+        if (deadlineMs == mArmedAtMs) return;
+
+        // it_value of zero disarms the timer
+        itimerspec timespec {
+            .it_interval = { .tv_sec = 0, .tv_nsec = 0 },
+            .it_value = { .tv_sec = 0, .tv_nsec = 0 },
+        };
+        if (deadlineMs >= 0) {
+            // a zero absolute time would disarm rather than fire immediately
+            int64_t when = std::max<int64_t>(deadlineMs, 1);
+            timespec.it_value.tv_sec = when / 1000;
+            timespec.it_value.tv_nsec = (when % 1000) * 1000000;
+        }
+
+        int timeRes = timerfd_settime(mFdTimer, TFD_TIMER_ABSTIME, &timespec, nullptr);
+        LOG_ALWAYS_FATAL_IF(timeRes < 0, "Failed to timerfd_settime: res: %d err: %d", timeRes, errno);
+        mArmedAtMs = deadlineMs;
+    }
+
 private:
-    ClientCallbackCallback(const sp<ServiceManager>& manager) : mManager(manager) {}
+    ClientCallbackCallback(const sp<ServiceManager>& manager, int fdTimer)
+          : mManager(manager), mFdTimer(fdTimer) {}
     sp<ServiceManager> mManager;
+    int mFdTimer;
+    int64_t mArmedAtMs = -1;
+};
+
+class BinderCallback : public LooperCallback {
+public:
+    static sp<BinderCallback> setupTo(const sp<Looper>& looper,
+                                      const sp<ClientCallbackCallback>& clientCallbacks) {
+        sp<BinderCallback> cb = new BinderCallback(clientCallbacks);
+
+        int binder_fd = -1;
+        IPCThreadState::self()->setupPolling(&binder_fd);
+        LOG_ALWAYS_FATAL_IF(binder_fd < 0, "Failed to setupPolling: %d", binder_fd);
+
+        // Flush after setupPolling(), to make sure the binder driver
+        // knows about this thread handling commands.
+        IPCThreadState::self()->flushCommands();
+
+        int ret = looper->addFd(binder_fd,
+                                Looper::POLL_CALLBACK,
+                                Looper::EVENT_INPUT,
+                                cb,
+                                nullptr /*data*/);
+        LOG_ALWAYS_FATAL_IF(ret != 1, "Failed to add binder FD to Looper");
+
+        return cb;
+    }
+
+    int handleEvent(int /* fd */, int /* events */, void* /* data */) override {
+        IPCThreadState::self()->handlePolledCommands();
+        // getService, registerClientCallback, etc. may have scheduled checks
+        mClientCallbacks->rearm();
+        return 1;  // Continue receiving callbacks.
+    }
+
+private:
+    BinderCallback(const sp<ClientCallbackCallback>& clientCallbacks)
+          : mClientCallbacks(clientCallbacks) {}
+    sp<ClientCallbackCallback> mClientCallbacks;
 };
 
 int main(int argc, char** argv) {
@@ -134,8 +163,8 @@ int main(int argc, char** argv) {
 
     sp<Looper> looper = Looper::prepare(false /*allowNonCallbacks*/);
 
-    BinderCallback::setupTo(looper);
-    ClientCallbackCallback::setupTo(looper, manager);
+    sp<ClientCallbackCallback> clientCallbacks = ClientCallbackCallback::setupTo(looper, manager);
+    BinderCallback::setupTo(looper, clientCallbacks);
 
     while(true) {
         looper->pollAll(-1);
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <android/os/BnClientCallback.h>
 #include <android/os/BnServiceCallback.h>
 #include <binder/Binder.h>
 #include <binder/ProcessState.h>
@@ -31,6 +32,7 @@ using android::BBinder;
 using android::IBinder;
 using android::ServiceManager;
 using android::binder::Status;
+using android::os::BnClientCallback;
 using android::os::BnServiceCallback;
 using android::os::IServiceManager;
 using testing::_;
@@ -255,6 +257,49 @@ TEST(GetService, NotAllowedFromIsolated) {
     EXPECT_EQ(nullptr, out.get());
 }
 
+TEST(GetServices, ResultsInOrder) {
+    auto sm = getPermissiveServiceManager();
+    sp<IBinder> foo = getBinder();
+    sp<IBinder> baz = getBinder();
+
+    EXPECT_TRUE(sm->addService("foo", foo, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+    EXPECT_TRUE(sm->addService("baz", baz, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    std::vector<sp<IBinder>> out;
+    EXPECT_TRUE(sm->getServices({"foo", "bar", "baz"}, &out).isOk());
+    ASSERT_EQ(3u, out.size());
+    EXPECT_EQ(foo, out[0]);
+    EXPECT_EQ(nullptr, out[1].get());
+    EXPECT_EQ(baz, out[2]);
+}
+
+TEST(GetServices, SingleCallingContextLookup) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext())
+        // something adds it
+        .WillOnce(Return(Access::CallingContext{}))
+        // the whole batch is resolved against one context
+        .WillOnce(Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, canAdd(_, _)).WillOnce(Return(true));
+    EXPECT_CALL(*access, canFind(_, _)).WillOnce(Return(true)).WillOnce(Return(false));
+
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    sp<IBinder> service = getBinder();
+    EXPECT_TRUE(sm->addService("foo", service, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    std::vector<sp<IBinder>> out;
+    // denied lookups return nullptr with OK status, as getService does
+    EXPECT_TRUE(sm->getServices({"foo", "foo"}, &out).isOk());
+    ASSERT_EQ(2u, out.size());
+    EXPECT_EQ(service, out[0]);
+    EXPECT_EQ(nullptr, out[1].get());
+}
+
 TEST(ListServices, NoPermissions) {
     std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
 
@@ -447,3 +492,60 @@ TEST(ServiceNotifications, GetMultipleNotification) {
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
 }
+
+class ClientCallbackHistorian : public BnClientCallback {
+    Status onClients(const sp<IBinder>& /*registered*/, bool hasClients) override {
+        clients.push_back(hasClients);
+        return Status::ok();
+    }
+
+    android::status_t linkToDeath(const sp<DeathRecipient>&, void*, uint32_t) override {
+        // let SM linkToDeath
+        return android::OK;
+    }
+
+public:
+    std::vector<bool> clients;
+};
+
+TEST(ClientCallbacks, NothingScheduledWithoutCallbacks) {
+    auto sm = getPermissiveServiceManager();
+
+    EXPECT_TRUE(sm->addService("foo", getBinder(), false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    sp<IBinder> out;
+    EXPECT_TRUE(sm->getService("foo", &out).isOk());
+    EXPECT_NE(out, nullptr);
+
+    EXPECT_EQ(sm->nextClientCallbackCheckMs(), -1);
+}
+
+TEST(ClientCallbacks, CheckScheduledOnlyWhileStateCanChange) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+    // registerClientCallback is only allowed from the process hosting the service
+    ON_CALL(*access, getCallingContext()).WillByDefault(Return(Access::CallingContext{
+        .debugPid = getpid(),
+    }));
+    ON_CALL(*access, canAdd(_, _)).WillByDefault(Return(true));
+    ON_CALL(*access, canFind(_, _)).WillByDefault(Return(true));
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    sp<IBinder> service = getBinder();
+    EXPECT_TRUE(sm->addService("foo", service, false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+
+    sp<ClientCallbackHistorian> cb = new ClientCallbackHistorian;
+    EXPECT_TRUE(sm->registerClientCallback("foo", service, cb).isOk());
+    EXPECT_GT(sm->nextClientCallbackCheckMs(), 0);
+
+    // Not due yet: nothing is checked and the deadline stays put.
+    int64_t deadline = sm->nextClientCallbackCheckMs();
+    sm->handleClientCallbacks();
+    EXPECT_EQ(sm->nextClientCallbackCheckMs(), deadline);
+
+    // After the service is gone there is nothing left to wake up for.
+    sm->binderDied(service);
+    EXPECT_EQ(sm->nextClientCallbackCheckMs(), -1);
+    EXPECT_THAT(cb->clients, ElementsAre());
+}
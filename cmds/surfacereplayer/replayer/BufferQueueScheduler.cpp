@@ -19,12 +19,17 @@
 
 #include <android/native_window.h>
 #include <gui/Surface.h>
+#include <system/window.h>
 
 using namespace android;
 
 BufferQueueScheduler::BufferQueueScheduler(
-        const sp<SurfaceControl>& surfaceControl, const HSV& color, int id)
-      : mSurfaceControl(surfaceControl), mColor(color), mSurfaceId(id), mContinueScheduling(true) {}
+        const sp<SurfaceControl>& surfaceControl, const HSV& color, int id, bool measureLatency)
+      : mSurfaceControl(surfaceControl),
+        mColor(color),
+        mSurfaceId(id),
+        mContinueScheduling(true),
+        mMeasureLatency(measureLatency) {}
 
 void BufferQueueScheduler::startScheduling() {
     ALOGV("Starting Scheduler for %d Layer", mSurfaceId);
@@ -81,6 +86,11 @@ void BufferQueueScheduler::fillSurface(const std::shared_ptr<Event>& event) {
     ANativeWindow_Buffer outBuffer;
     sp<Surface> s = mSurfaceControl->getSurface();
 
+    if (mMeasureLatency && !mFrameTimestampsEnabled) {
+        s->enableFrameTimestamps(true);
+        mFrameTimestampsEnabled = true;
+    }
+
     status_t status = s->lock(&outBuffer, nullptr);
 
     if (status != NO_ERROR) {
@@ -103,7 +113,66 @@ void BufferQueueScheduler::fillSurface(const std::shared_ptr<Event>& event) {
 
     event->readyToExecute();
 
+    const uint64_t frameNumber = s->getNextFrameNumber();
     status = s->unlockAndPost();
 
     ALOGE_IF(status != NO_ERROR, "fillSurface: failed to unlock and post buffer, (%d)", status);
+
+    if (mMeasureLatency && status == NO_ERROR) {
+        FrameLatency frame;
+        frame.layerId = mSurfaceId;
+        frame.frameNumber = frameNumber;
+        frame.queueTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
+        std::lock_guard<std::mutex> lock(mLatencyMutex);
+        mPendingFrames.push_back(frame);
+        updateFrameLatenciesLocked();
+    }
+}
+
+void BufferQueueScheduler::updateFrameLatenciesLocked() {
+    sp<Surface> s = mSurfaceControl->getSurface();
+
+    auto it = mPendingFrames.begin();
+    while (it != mPendingFrames.end()) {
+        nsecs_t latchTime = NATIVE_WINDOW_TIMESTAMP_PENDING;
+        nsecs_t presentTime = NATIVE_WINDOW_TIMESTAMP_PENDING;
+        status_t status = s->getFrameTimestamps(it->frameNumber, nullptr, nullptr, &latchTime,
+                nullptr, nullptr, nullptr, &presentTime, nullptr, nullptr);
+        if (status == BAD_VALUE) {
+            // The display does not report present fences; measure latching only.
+            presentTime = NATIVE_WINDOW_TIMESTAMP_INVALID;
+            status = s->getFrameTimestamps(it->frameNumber, nullptr, nullptr, &latchTime,
+                    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+        }
+
+        if (status == NO_ERROR) {
+            it->latchTime = latchTime;
+            it->presentTime = presentTime;
+        }
+
+        // Frames that dropped out of the event history will never be reported.
+        const bool done = status != NO_ERROR ||
+                (latchTime != NATIVE_WINDOW_TIMESTAMP_PENDING &&
+                 presentTime != NATIVE_WINDOW_TIMESTAMP_PENDING);
+        if (done) {
+            mCompletedFrames.push_back(*it);
+            it = mPendingFrames.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<FrameLatency> BufferQueueScheduler::takeFrameLatencies() {
+    std::lock_guard<std::mutex> lock(mLatencyMutex);
+    if (!mPendingFrames.empty()) {
+        updateFrameLatenciesLocked();
+    }
+
+    std::vector<FrameLatency> frames = std::move(mCompletedFrames);
+    frames.insert(frames.end(), mPendingFrames.begin(), mPendingFrames.end());
+    mCompletedFrames.clear();
+    mPendingFrames.clear();
+    return frames;
 }
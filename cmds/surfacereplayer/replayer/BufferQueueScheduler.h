@@ -23,12 +23,14 @@
 #include <gui/SurfaceControl.h>
 
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
 #include <utility>
+#include <vector>
 
 namespace android {
 
@@ -50,9 +52,20 @@ struct BufferEvent {
     Dimensions dimensions;
 };
 
+// SurfaceFlinger timing of one replayed buffer. Times are CLOCK_MONOTONIC; latch and present
+// times stay negative when SurfaceFlinger did not report them.
+struct FrameLatency {
+    int layerId = 0;
+    uint64_t frameNumber = 0;
+    nsecs_t queueTime = 0;
+    nsecs_t latchTime = -1;
+    nsecs_t presentTime = -1;
+};
+
 class BufferQueueScheduler {
   public:
-    BufferQueueScheduler(const sp<SurfaceControl>& surfaceControl, const HSV& color, int id);
+    BufferQueueScheduler(const sp<SurfaceControl>& surfaceControl, const HSV& color, int id,
+            bool measureLatency = false);
 
     void startScheduling();
     void addEvent(const BufferEvent&);
@@ -60,6 +73,10 @@ class BufferQueueScheduler {
 
     void setSurfaceControl(const sp<SurfaceControl>& surfaceControl, const HSV& color);
 
+    // Collects the timing of every buffer posted so far. Frames SurfaceFlinger has not finished
+    // with yet are returned with their missing timestamps left negative.
+    std::vector<FrameLatency> takeFrameLatencies();
+
   private:
     void bufferUpdate(const Dimensions& dimensions);
 
@@ -67,6 +84,10 @@ class BufferQueueScheduler {
     // then unlock and post the buffer.
     void fillSurface(const std::shared_ptr<Event>& event);
 
+    // Fetches SurfaceFlinger timestamps for posted frames. Must be polled regularly since the
+    // producer only keeps a short history of frame events. Called with mLatencyMutex held.
+    void updateFrameLatenciesLocked();
+
     sp<SurfaceControl> mSurfaceControl;
     HSV mColor;
     const int mSurfaceId;
@@ -76,6 +97,12 @@ class BufferQueueScheduler {
     std::queue<BufferEvent> mBufferEvents;
     std::mutex mMutex;
     std::condition_variable mCondition;
+
+    const bool mMeasureLatency;
+    bool mFrameTimestampsEnabled = false;
+    std::mutex mLatencyMutex;
+    std::vector<FrameLatency> mPendingFrames;
+    std::vector<FrameLatency> mCompletedFrames;
 };
 
 }  // namespace android
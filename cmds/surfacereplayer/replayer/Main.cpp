@@ -47,7 +47,13 @@ void printHelpMenu() {
     std::cout << "\n  -s [Timestamp]  Specify at what timestamp should the replayer switch "
                  "to manual replay\n";
 
-    std::cout << "  -n  Ignore timestamps and run through trace as fast as possible\n";
+    std::cout << "  -n  Ignore timestamps and replay as fast as possible, as a stress test\n";
+
+    std::cout << "  -r [Rate]  Replay the trace at the given multiple of its recorded speed\n";
+
+    std::cout << "  -b  Report SurfaceFlinger latch and present latency of replayed buffers\n";
+
+    std::cout << "  -o [File]  Also write per-frame latencies as CSV to the given file\n";
 
     std::cout << "  -l  Indefinitely loop the replayer\n";
 
@@ -63,9 +69,12 @@ int main(int argc, char** argv) {
     bool pauseBeginning = false;
     int numThreads = DEFAULT_THREADS;
     long stopHere = -1;
+    double speed = 1.0;
+    bool measureLatency = false;
+    std::string latencyPath;
 
     int opt = 0;
-    while ((opt = getopt(argc, argv, "mt:s:nlh?")) != -1) {
+    while ((opt = getopt(argc, argv, "mt:s:nr:bo:lh?")) != -1) {
         switch (opt) {
             case 'm':
                 pauseBeginning = true;
@@ -79,6 +88,19 @@ int main(int argc, char** argv) {
             case 'n':
                 wait = false;
                 break;
+            case 'r':
+                speed = atof(optarg);
+                if (speed <= 0) {
+                    std::cerr << "Replay rate must be positive...exiting" << std::endl;
+                    exit(0);
+                }
+                break;
+            case 'b':
+                measureLatency = true;
+                break;
+            case 'o':
+                latencyPath.assign(optarg);
+                break;
             case 'l':
                 loop = true;
                 break;
@@ -102,7 +124,8 @@ int main(int argc, char** argv) {
 
     status_t status = NO_ERROR;
     do {
-        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere);
+        android::Replayer r(filename, pauseBeginning, numThreads, wait, stopHere, speed,
+                measureLatency, latencyPath);
         status = r.replay();
     } while(loop);
 
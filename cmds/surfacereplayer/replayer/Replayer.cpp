@@ -20,6 +20,8 @@
 
 #include <android/native_window.h>
 
+#include <time.h>
+
 #include <android-base/file.h>
 
 #include <gui/BufferQueue.h>
@@ -40,6 +42,7 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -51,12 +54,15 @@ using namespace android;
 std::atomic_bool Replayer::sReplayingManually(false);
 
 Replayer::Replayer(const std::string& filename, bool replayManually, int numThreads, bool wait,
-        nsecs_t stopHere)
+        nsecs_t stopHere, double speed, bool measureLatency, const std::string& latencyPath)
       : mTrace(),
         mLoaded(false),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
+        mSpeed(speed > 0 ? speed : 1.0),
+        mMeasureLatency(measureLatency || !latencyPath.empty()),
+        mLatencyPath(latencyPath),
         mWaitForTimeStamps(wait),
         mStopTimeStamp(stopHere) {
     srand(RAND_COLOR_SEED);
@@ -74,6 +80,7 @@ Replayer::Replayer(const std::string& filename, bool replayManually, int numThre
     }
 
     mCurrentTime = mTrace.increment(0).time_stamp();
+    mTraceStartTime = mCurrentTime;
 
     sReplayingManually.store(replayManually);
 
@@ -82,16 +89,21 @@ Replayer::Replayer(const std::string& filename, bool replayManually, int numThre
     }
 }
 
-Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere)
+Replayer::Replayer(const Trace& t, bool replayManually, int numThreads, bool wait, nsecs_t stopHere,
+        double speed, bool measureLatency, const std::string& latencyPath)
       : mTrace(t),
         mLoaded(true),
         mIncrementIndex(0),
         mCurrentTime(0),
         mNumThreads(numThreads),
+        mSpeed(speed > 0 ? speed : 1.0),
+        mMeasureLatency(measureLatency || !latencyPath.empty()),
+        mLatencyPath(latencyPath),
         mWaitForTimeStamps(wait),
         mStopTimeStamp(stopHere) {
     srand(RAND_COLOR_SEED);
     mCurrentTime = mTrace.increment(0).time_stamp();
+    mTraceStartTime = mCurrentTime;
 
     sReplayingManually.store(replayManually);
 
@@ -117,6 +129,7 @@ status_t Replayer::replay() {
     initReplay();
 
     ALOGV("Starting actual Replay!");
+    rebaseReplayClock(mTraceStartTime);
     while (!mPendingIncrements.empty()) {
         mCurrentIncrement = mTrace.increment(mIncrementIndex);
 
@@ -125,7 +138,12 @@ status_t Replayer::replay() {
             sReplayingManually.store(true);
         }
 
+        const bool pausedForConsole = sReplayingManually && !mWaitingForNextVSync;
         waitForConsoleCommmand();
+        if (pausedForConsole) {
+            // Time spent at the prompt is not part of the trace.
+            rebaseReplayClock(mCurrentIncrement.time_stamp());
+        }
 
         if (mWaitForTimeStamps) {
             waitUntilTimestamp(mCurrentIncrement.time_stamp());
@@ -155,9 +173,98 @@ status_t Replayer::replay() {
 
     SurfaceComposerClient::enableVSyncInjections(false);
 
+    if (mMeasureLatency) {
+        reportLatency();
+    }
+
     return status;
 }
 
+namespace {
+
+// Returns the |percentile| of |values|, which must be sorted and not empty.
+nsecs_t percentileOf(const std::vector<nsecs_t>& values, int percentile) {
+    return values[(values.size() - 1) * percentile / 100];
+}
+
+void printLatencySummary(const std::string& name, std::vector<nsecs_t> latencies) {
+    if (latencies.empty()) {
+        std::cout << "    " << name << ": not reported\n";
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "    " << name << ": p50=" << ns2us(percentileOf(latencies, 50))
+              << "us p90=" << ns2us(percentileOf(latencies, 90))
+              << "us p99=" << ns2us(percentileOf(latencies, 99))
+              << "us max=" << ns2us(latencies.back()) << "us\n";
+}
+
+void printFrameLatencies(const std::string& name, const std::vector<FrameLatency>& frames) {
+    std::vector<nsecs_t> latchLatencies;
+    std::vector<nsecs_t> presentLatencies;
+    size_t unlatched = 0;
+    for (const auto& frame : frames) {
+        if (frame.latchTime >= 0) {
+            latchLatencies.push_back(frame.latchTime - frame.queueTime);
+        } else {
+            unlatched++;
+        }
+        if (frame.presentTime >= 0) {
+            presentLatencies.push_back(frame.presentTime - frame.queueTime);
+        }
+    }
+
+    std::cout << "  " << name << ": " << frames.size() << " frames, " << unlatched
+              << " not latched\n";
+    printLatencySummary("queue to latch", std::move(latchLatencies));
+    printLatencySummary("queue to present", std::move(presentLatencies));
+}
+
+}  // namespace
+
+void Replayer::reportLatency() {
+    // Give SurfaceFlinger a chance to latch and present the last buffers.
+    std::this_thread::sleep_for(std::chrono::nanoseconds(LATENCY_DRAIN_TIME_NS));
+
+    std::vector<FrameLatency> frames;
+    std::map<layer_id, std::vector<FrameLatency>> framesByLayer;
+    {
+        std::lock_guard<std::mutex> lock(mBufferQueueSchedulerLock);
+        for (auto& bqs : mBufferQueueSchedulers) {
+            auto layerFrames = bqs.second->takeFrameLatencies();
+            frames.insert(frames.end(), layerFrames.begin(), layerFrames.end());
+            framesByLayer[bqs.first] = std::move(layerFrames);
+        }
+    }
+
+    std::cout << "Replay latency report\n";
+    if (mWaitForTimeStamps && mPacedIncrements > 0) {
+        std::cout << "  pacing: " << mPacedIncrements << " increments, mean late "
+                  << ns2us(mTotalLateness / mPacedIncrements) << "us, max late "
+                  << ns2us(mMaxLateness) << "us\n";
+    }
+    printFrameLatencies("all layers", frames);
+    for (const auto& layer : framesByLayer) {
+        printFrameLatencies("layer " + std::to_string(layer.first), layer.second);
+    }
+    std::cout << std::endl;
+
+    if (mLatencyPath.empty()) {
+        return;
+    }
+
+    std::ofstream csv(mLatencyPath);
+    if (!csv) {
+        std::cerr << "Could not write latency report to " << mLatencyPath << std::endl;
+        return;
+    }
+    csv << "layer,frame,queue_ns,latch_ns,present_ns\n";
+    for (const auto& frame : frames) {
+        csv << frame.layerId << "," << frame.frameNumber << "," << frame.queueTime << ","
+            << frame.latchTime << "," << frame.presentTime << "\n";
+    }
+}
+
 status_t Replayer::initReplay() {
     for (int i = 0; i < mNumThreads && i < mTrace.increment_size(); i++) {
         status_t status = dispatchEvent(i);
@@ -296,7 +403,7 @@ status_t Replayer::dispatchEvent(int index) {
             auto layerId = increment.buffer_update().id();
             if (mBufferQueueSchedulers.count(layerId) == 0) {
                 mBufferQueueSchedulers[layerId] = std::make_shared<BufferQueueScheduler>(
-                        mLayers[layerId], mColors[layerId], layerId);
+                        mLayers[layerId], mColors[layerId], layerId, mMeasureLatency);
                 mBufferQueueSchedulers[layerId]->addEvent(bufferEvent);
 
                 std::thread(&BufferQueueScheduler::startScheduling,
@@ -687,9 +794,36 @@ void Replayer::updatePowerMode(const PowerModeUpdate& pmu, const std::shared_ptr
     SurfaceComposerClient::setDisplayPowerMode(mDisplays[pmu.id()], pmu.mode());
 }
 
+void Replayer::rebaseReplayClock(int64_t timestamp) {
+    mTraceStartTime = timestamp;
+    mReplayStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
 void Replayer::waitUntilTimestamp(int64_t timestamp) {
-    ALOGV("Waiting for %lld nanoseconds...", static_cast<int64_t>(timestamp - mCurrentTime));
-    std::this_thread::sleep_for(std::chrono::nanoseconds(timestamp - mCurrentTime));
+    const nsecs_t target = mReplayStartTime +
+            static_cast<nsecs_t>((timestamp - mTraceStartTime) / mSpeed);
+    ALOGV("Waiting for %lld nanoseconds...",
+            static_cast<int64_t>(target - systemTime(SYSTEM_TIME_MONOTONIC)));
+
+    const nsecs_t sleepTarget = target - SPIN_THRESHOLD_NS;
+    if (systemTime(SYSTEM_TIME_MONOTONIC) < sleepTarget) {
+        const timespec wakeup = {
+                .tv_sec = static_cast<time_t>(sleepTarget / 1000000000),
+                .tv_nsec = static_cast<long>(sleepTarget % 1000000000),
+        };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, nullptr) == EINTR) {
+        }
+    }
+
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    while (now < target) {
+        now = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+
+    const nsecs_t lateness = now - target;
+    mPacedIncrements++;
+    mTotalLateness += lateness;
+    mMaxLateness = std::max(mMaxLateness, lateness);
 }
 
 void Replayer::waitUntilDeferredTransactionLayerExists(
@@ -52,18 +52,34 @@ typedef int32_t display_id;
 typedef google::protobuf::RepeatedPtrField<SurfaceChange> SurfaceChanges;
 typedef google::protobuf::RepeatedPtrField<DisplayChange> DisplayChanges;
 
+// The replayer sleeps until this long before an increment's time and spins for the rest, since
+// sleeps alone routinely overshoot by more than that.
+const nsecs_t SPIN_THRESHOLD_NS = 200000;
+// How long to wait after the last increment for SurfaceFlinger to present the final frames
+// before collecting their timestamps.
+const nsecs_t LATENCY_DRAIN_TIME_NS = 200000000;
+
 class Replayer {
   public:
+    // |speed| scales the pace of the trace; 2.0 replays it twice as fast. When |measureLatency|
+    // is set, SurfaceFlinger latch and present times are collected for every replayed buffer and
+    // summarized once the replay finishes; a per-frame CSV is also written to |latencyPath| if it
+    // is not empty.
     Replayer(const std::string& filename, bool replayManually = false,
-            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1);
+            int numThreads = DEFAULT_THREADS, bool wait = true, nsecs_t stopHere = -1,
+            double speed = 1.0, bool measureLatency = false,
+            const std::string& latencyPath = "");
     Replayer(const Trace& trace, bool replayManually = false, int numThreads = DEFAULT_THREADS,
-            bool wait = true, nsecs_t stopHere = -1);
+            bool wait = true, nsecs_t stopHere = -1, double speed = 1.0,
+            bool measureLatency = false, const std::string& latencyPath = "");
 
     status_t replay();
 
   private:
     status_t initReplay();
 
+    void reportLatency();
+
     void waitForConsoleCommmand();
     static void stopAutoReplayHandler(int signal);
 
@@ -132,7 +148,11 @@ class Replayer {
     void setDisplayProjection(SurfaceComposerClient::Transaction& t,
             display_id id, const ProjectionChange& pc);
 
+    // Waits until the replay time corresponding to trace time |timestamp|. The replay is paced
+    // against absolute times so that dispatch overhead does not accumulate as drift.
     void waitUntilTimestamp(int64_t timestamp);
+    // Restarts the replay clock so that |timestamp| corresponds to now, e.g. after a pause.
+    void rebaseReplayClock(int64_t timestamp);
     void waitUntilDeferredTransactionLayerExists(
             const DeferredTransactionChange& dtc, std::unique_lock<std::mutex>& lock);
     status_t loadSurfaceComposerClient();
@@ -143,12 +163,24 @@ class Replayer {
     int64_t mCurrentTime = 0;
     int32_t mNumThreads = DEFAULT_THREADS;
 
+    double mSpeed = 1.0;
+    int64_t mTraceStartTime = 0;
+    nsecs_t mReplayStartTime = 0;
+
+    // How late increments were dispatched relative to their scheduled replay time.
+    int64_t mPacedIncrements = 0;
+    nsecs_t mTotalLateness = 0;
+    nsecs_t mMaxLateness = 0;
+
+    bool mMeasureLatency = false;
+    std::string mLatencyPath;
+
     Increment mCurrentIncrement;
 
     std::string mLastInput;
 
     static atomic_bool sReplayingManually;
-    bool mWaitingForNextVSync;
+    bool mWaitingForNextVSync = false;
     bool mWaitForTimeStamps;
     nsecs_t mStopTimeStamp;
     bool mHasStopped;
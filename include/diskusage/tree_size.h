@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIBDISKUSAGE_TREE_SIZE_H
+#define __LIBDISKUSAGE_TREE_SIZE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <functional>
+#include <string>
+
+namespace android {
+namespace diskusage {
+
+struct TreeStats {
+    // Allocated size of the measured entries, in bytes.
+    int64_t size = 0;
+    // Latest modification time of the measured entries, in seconds. Only filled in when
+    // TreeOptions::want_modified is set.
+    int64_t modified = 0;
+};
+
+enum class TreeVisit {
+    // Count the entry, and descend into it if it is a directory.
+    MEASURE,
+    // Do not count the entry, but still descend into it if it is a directory.
+    IGNORE,
+    // Neither count the entry nor descend into it.
+    SKIP_TREE,
+};
+
+struct TreeOptions {
+    // Called for every entry, including the root, with its owner. May be called concurrently from
+    // several threads. Every entry is measured when not set.
+    std::function<TreeVisit(uid_t uid, gid_t gid)> filter;
+    // Whether TreeStats::modified is needed; otherwise modification times are not requested.
+    bool want_modified = false;
+    // Maximum number of threads used to read directories, including the calling one.
+    size_t max_threads = 4;
+};
+
+/*
+ * Measures the tree rooted at |path|, including |path| itself. Like fts(3) with FTS_PHYSICAL and
+ * FTS_XDEV, symlinks are not followed and mount points are counted but not descended into.
+ * Directories that cannot be read are counted but skipped.
+ *
+ * Returns 0 and adds the totals to |stats| on success, or returns -1 with errno set if |path|
+ * itself cannot be measured.
+ */
+int calculate_tree_stats(const std::string& path, TreeStats* stats,
+                         const TreeOptions& options = TreeOptions());
+
+}  // namespace diskusage
+}  // namespace android
+
+#endif /* __LIBDISKUSAGE_TREE_SIZE_H */
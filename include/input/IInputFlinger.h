@@ -23,6 +23,7 @@
 #include <binder/IInterface.h>
 
 #include <input/InputWindow.h>
+#include <input/InputWindowsUpdate.h>
 #include <input/ISetInputWindowsListener.h>
 
 namespace android {
@@ -37,6 +38,9 @@ public:
 
     virtual void setInputWindows(const std::vector<InputWindowInfo>& inputHandles,
             const sp<ISetInputWindowsListener>& setInputWindowsListener) = 0;
+    // Same as setInputWindows, but only sends the changes since the previous update.
+    virtual void updateInputWindows(const InputWindowsUpdate& update,
+            const sp<ISetInputWindowsListener>& setInputWindowsListener) = 0;
     virtual void registerInputChannel(const sp<InputChannel>& channel) = 0;
     virtual void unregisterInputChannel(const sp<InputChannel>& channel) = 0;
 };
@@ -50,7 +54,8 @@ public:
     enum {
         SET_INPUT_WINDOWS_TRANSACTION = IBinder::FIRST_CALL_TRANSACTION,
         REGISTER_INPUT_CHANNEL_TRANSACTION,
-        UNREGISTER_INPUT_CHANNEL_TRANSACTION
+        UNREGISTER_INPUT_CHANNEL_TRANSACTION,
+        UPDATE_INPUT_WINDOWS_TRANSACTION,
     };
 
     virtual status_t onTransact(uint32_t code, const Parcel& data,
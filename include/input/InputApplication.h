@@ -38,6 +38,12 @@ struct InputApplicationInfo {
 
     status_t write(Parcel& output) const;
     static InputApplicationInfo read(const Parcel& from);
+
+    bool operator==(const InputApplicationInfo& other) const {
+        return token == other.token && name == other.name &&
+                dispatchingTimeout == other.dispatchingTimeout;
+    }
+    bool operator!=(const InputApplicationInfo& other) const { return !(*this == other); }
 };
 
 
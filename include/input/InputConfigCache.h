@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LIBINPUT_INPUT_CONFIG_CACHE_H
+#define _LIBINPUT_INPUT_CONFIG_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace android {
+
+/*
+ * Cache of compiled key layout and key character map files, so that opening an input device
+ * does not tokenize the same text files again. Disabled until a directory is set.
+ *
+ * A compiled file is an array of int32 words written and read by the map type itself, behind
+ * a header naming the source file and its modification time, size and content hash. Any
+ * mismatch is a miss, and the caller falls back to the text parser.
+ */
+class InputConfigCache {
+public:
+    // Bump when the layout of the header or of any kind's words changes.
+    static constexpr uint32_t VERSION = 1;
+
+    enum class Kind : uint32_t {
+        KEY_LAYOUT = 1,
+        KEY_CHARACTER_MAP = 2,
+    };
+
+    // Identity of a source file at the time it was looked up.
+    struct Source {
+        std::string path;
+        int64_t mtime = 0; // seconds
+        int64_t size = 0;
+        uint64_t contentHash = 0;
+        // False if the cache is disabled or the source could not be read.
+        bool valid = false;
+    };
+
+    // A compiled file mapped read-only into memory.
+    class Entry {
+    public:
+        Entry(void* mapping, size_t mappingSize, const int32_t* words, size_t wordCount);
+        ~Entry();
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        const int32_t* getWords() const { return mWords; }
+        size_t getWordCount() const { return mWordCount; }
+
+    private:
+        void* const mMapping;
+        const size_t mMappingSize;
+        const int32_t* const mWords;
+        const size_t mWordCount;
+    };
+
+    // Bounds-checked cursor over the words of an entry.
+    class Reader {
+    public:
+        explicit Reader(const Entry& entry)
+              : mWords(entry.getWords()), mWordCount(entry.getWordCount()) {}
+
+        bool read(int32_t* outValue) {
+            if (mPosition >= mWordCount) {
+                return false;
+            }
+            *outValue = mWords[mPosition++];
+            return true;
+        }
+        // Reads the number of items that follow, each wordsPerItem words long. Fails if they
+        // would run past the end.
+        bool readCount(size_t wordsPerItem, size_t* outCount);
+        bool isAtEnd() const { return mPosition == mWordCount; }
+
+    private:
+        const int32_t* const mWords;
+        const size_t mWordCount;
+        size_t mPosition = 0;
+    };
+
+    // Sets the directory compiled files are kept in. An empty directory disables the cache.
+    static void setDirectory(const std::string& directory);
+    static std::string getDirectory();
+
+    // Returns the compiled form of path if it is cached and current, otherwise nullptr.
+    // Fills in outSource, which is needed to store the compiled form after a miss.
+    static std::unique_ptr<Entry> find(const std::string& path, Kind kind, Source* outSource);
+
+    // Stores the compiled form of a source file. Does nothing if source is not valid.
+    static void store(const Source& source, Kind kind, const std::vector<int32_t>& words);
+};
+
+} // namespace android
+
+#endif // _LIBINPUT_INPUT_CONFIG_CACHE_H
@@ -29,6 +29,7 @@
  * The InputConsumer is used by the application to receive events from the input dispatcher.
  */
 
+#include <memory>
 #include <string>
 
 #include <android-base/chrono_utils.h>
@@ -178,6 +179,11 @@ struct InputMessage {
  * An input channel consists of a local unix domain socket used to send and receive
  * input messages across processes.  Each channel has a descriptive name for debugging purposes.
  *
+ * Optionally, a channel pair can instead carry messages through a pair of single-producer,
+ * single-consumer rings in shared memory, one per direction. The socket is then only used to
+ * wake up a reader that found its ring empty and to detect that the peer has gone away, so a
+ * burst of messages costs at most one send and one receive syscall.
+ *
  * Each endpoint has its own InputChannel object that specifies its file descriptor.
  *
  * The input channel is closed when all references to it are released.
@@ -200,6 +206,22 @@ public:
     static status_t openInputChannelPair(const std::string& name,
             sp<InputChannel>& outServerChannel, sp<InputChannel>& outClientChannel);
 
+    enum class Transport {
+        SOCKET,
+        SHARED_MEMORY,
+    };
+
+    /**
+     * Like openInputChannelPair() above, but lets the caller pick the transport.
+     * SHARED_MEMORY falls back to SOCKET if the shared memory cannot be set up.
+     */
+    static status_t openInputChannelPair(const std::string& name,
+            sp<InputChannel>& outServerChannel, sp<InputChannel>& outClientChannel,
+            Transport transport);
+
+    /* Return the transport that sendMessage() and receiveMessage() use. */
+    Transport getTransport() const;
+
     inline std::string getName() const { return mName; }
     inline int getFd() const { return mFd.get(); }
 
@@ -249,11 +271,23 @@ public:
     sp<IBinder> getConnectionToken() const;
 
 private:
-    InputChannel(const std::string& name, android::base::unique_fd fd, sp<IBinder> token);
+    // The mapped rings of one endpoint; defined in InputTransport.cpp.
+    struct SharedRings;
+
+    InputChannel(const std::string& name, android::base::unique_fd fd, sp<IBinder> token,
+                 std::shared_ptr<SharedRings> rings);
     std::string mName;
     android::base::unique_fd mFd;
 
     sp<IBinder> mToken;
+
+    // null when messages are sent over the socket; shared by dup()ed channels
+    std::shared_ptr<SharedRings> mRings;
+
+    status_t sendSocketMessage(const InputMessage* msg);
+    status_t receiveSocketMessage(InputMessage* msg);
+    status_t sendRingMessage(const InputMessage* msg);
+    status_t receiveRingMessage(InputMessage* msg);
 };
 
 /*
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LIBINPUT_INPUT_WINDOWS_UPDATE_H
+#define _LIBINPUT_INPUT_WINDOWS_UPDATE_H
+
+#include <binder/Parcel.h>
+#include <input/InputWindow.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+
+/*
+ * Changes to the list of input windows since the previous update from the same sender.
+ * Windows are identified by InputWindowInfo::id, which is unique per window; the token is not,
+ * and may be null.
+ */
+struct InputWindowsUpdate {
+    // Incremented by one for every non-empty update; an empty update repeats the sequence of the
+    // previous one. An update that does not follow the last one applied is dropped by the
+    // receiver, as is everything after it until the next full sync.
+    uint64_t sequence = 0;
+    // The receiver discards its state first, and changed holds every window.
+    bool fullSync = false;
+    // Windows that were added or changed in any field, with their complete info.
+    std::vector<InputWindowInfo> changed;
+    std::vector<int32_t> removed;
+    // Ids of all windows in z order, front to back. Only sent when fullSync or orderChanged.
+    bool orderChanged = false;
+    std::vector<int32_t> order;
+
+    bool isEmpty() const {
+        return !fullSync && changed.empty() && removed.empty() && !orderChanged;
+    }
+
+    status_t write(Parcel& output) const;
+    status_t read(const Parcel& from);
+};
+
+/*
+ * Sender side: turns successive full window lists into updates.
+ */
+class InputWindowsUpdateWriter {
+public:
+    // A full sync is forced after this many updates, so a receiver that lost its state or
+    // dropped an update recovers within a few seconds of animation.
+    static constexpr uint32_t FULL_SYNC_INTERVAL = 300;
+
+    // Returns the changes from the previous call to windows, which are in z order. An empty
+    // update does not need to be sent.
+    InputWindowsUpdate update(const std::vector<InputWindowInfo>& windows);
+    // Makes the next update a full sync.
+    void requestFullSync() { mFullSyncRequested = true; }
+
+private:
+    std::unordered_map<int32_t, InputWindowInfo> mWindows;
+    std::vector<int32_t> mOrder;
+    uint64_t mSequence = 0;
+    uint32_t mUpdatesSinceFullSync = 0;
+    bool mFullSyncRequested = true;
+};
+
+/*
+ * Receiver side: the window list rebuilt from updates.
+ */
+class InputWindowsState {
+public:
+    // Applies update, adding the displays whose window list changed to outChangedDisplays.
+    // Returns false if the update was out of sequence and has been dropped.
+    bool apply(const InputWindowsUpdate& update, std::unordered_set<int32_t>* outChangedDisplays);
+
+    const std::vector<int32_t>& getOrder() const { return mOrder; }
+    // Returns nullptr if there is no window with this id.
+    const InputWindowInfo* getWindow(int32_t id) const;
+
+private:
+    std::unordered_map<int32_t, InputWindowInfo> mWindows;
+    std::vector<int32_t> mOrder;
+    uint64_t mSequence = 0;
+    bool mSynced = false;
+};
+
+} // namespace android
+
+#endif // _LIBINPUT_INPUT_WINDOWS_UPDATE_H
@@ -24,6 +24,7 @@
 #endif
 
 #include <input/Input.h>
+#include <input/InputConfigCache.h>
 #include <utils/Errors.h>
 #include <utils/KeyedVector.h>
 #include <utils/Tokenizer.h>
@@ -244,6 +245,10 @@ private:
 
     static status_t load(Tokenizer* tokenizer, Format format, sp<KeyCharacterMap>* outMap);
 
+    // Compiled form kept by InputConfigCache.
+    std::vector<int32_t> compile() const;
+    status_t readCompiled(InputConfigCache::Reader& reader);
+
     static void addKey(Vector<KeyEvent>& outEvents,
             int32_t deviceId, int32_t keyCode, int32_t metaState, bool down, nsecs_t time);
     static void addMetaKeys(Vector<KeyEvent>& outEvents,
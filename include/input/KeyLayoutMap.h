@@ -17,6 +17,7 @@
 #ifndef _LIBINPUT_KEY_LAYOUT_MAP_H
 #define _LIBINPUT_KEY_LAYOUT_MAP_H
 
+#include <input/InputConfigCache.h>
 #include <stdint.h>
 #include <utils/Errors.h>
 #include <utils/KeyedVector.h>
@@ -96,6 +97,10 @@ private:
 
     const Key* getKey(int32_t scanCode, int32_t usageCode) const;
 
+    // Compiled form kept by InputConfigCache.
+    std::vector<int32_t> compile() const;
+    status_t readCompiled(InputConfigCache::Reader& reader);
+
     class Parser {
         KeyLayoutMap* mMap;
         Tokenizer* mTokenizer;
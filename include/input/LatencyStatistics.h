@@ -20,6 +20,9 @@
 #include <android-base/chrono_utils.h>
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include <array>
 
 namespace android {
 
@@ -54,6 +57,38 @@ public:
     size_t getCount();
 };
 
+/*
+ * Distribution of latency samples in microseconds, for percentiles. Values below 16us are
+ * counted exactly, larger ones in 8 buckets per power of two, so a percentile is accurate to
+ * within 12.5%. Values above about 18 minutes are counted as that.
+ */
+class LatencyHistogram {
+public:
+    void addValue(int64_t micros);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    size_t getCount() const { return mCount; }
+    int64_t getMax() const { return mMax; }
+    /* Upper bound of the bucket holding the given percentile, in [0, 100]. 0 if empty. */
+    int64_t getPercentile(float percentile) const;
+
+private:
+    static constexpr size_t EXACT_BUCKETS = 16;
+    static constexpr uint32_t SUB_BUCKET_BITS = 3;
+    static constexpr uint32_t MIN_EXPONENT = 4; // log2(EXACT_BUCKETS)
+    static constexpr uint32_t MAX_EXPONENT = 30;
+    static constexpr size_t BUCKET_COUNT =
+            EXACT_BUCKETS + (MAX_EXPONENT - MIN_EXPONENT + 1) * (1 << SUB_BUCKET_BITS);
+
+    static size_t bucketIndex(int64_t micros);
+    static int64_t bucketUpperBound(size_t index);
+
+    std::array<uint32_t, BUCKET_COUNT> mCounts{};
+    size_t mCount = 0;
+    int64_t mMax = 0;
+};
+
 } // namespace android
 
 #endif // _UI_INPUT_STATISTICS_H
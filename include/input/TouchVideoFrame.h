@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include <sys/time.h>
+#include <memory>
 #include <vector>
 
 namespace android {
@@ -27,11 +28,21 @@ namespace android {
  * Represents data from a single scan of the touchscreen device.
  * Similar in concept to a video frame, but the touch strength is used as
  * the values instead.
+ *
+ * The data is shared between copies of a frame and never modified in place, so frames can be
+ * passed along by value without copying the data.
  */
 class TouchVideoFrame {
 public:
     TouchVideoFrame(uint32_t height, uint32_t width, std::vector<int16_t> data,
             const struct timeval& timestamp);
+    /**
+     * Create a frame that points at size values owned by someone else, such as a buffer mapped
+     * from the driver. The buffer is released through the deleter of data when the last copy of
+     * the frame is destroyed or rotated.
+     */
+    TouchVideoFrame(uint32_t height, uint32_t width, std::shared_ptr<const int16_t> data,
+            size_t size, const struct timeval& timestamp);
 
     bool operator==(const TouchVideoFrame& rhs) const;
 
@@ -49,7 +60,11 @@ public:
      * Total size of the array should equal getHeight() * getWidth().
      * Data is allowed to be negative.
      */
-    const std::vector<int16_t>& getData() const;
+    const int16_t* getData() const;
+    /**
+     * Number of values in getData().
+     */
+    size_t getSize() const;
     /**
      * Time at which the heatmap was taken.
      */
@@ -64,9 +79,12 @@ public:
 private:
     uint32_t mHeight;
     uint32_t mWidth;
-    std::vector<int16_t> mData;
+    std::shared_ptr<const int16_t> mData;
+    size_t mSize;
     struct timeval mTimestamp;
 
+    void setData(std::vector<int16_t> data);
+
     /**
      * Common method for 90 degree and 270 degree rotation
      */
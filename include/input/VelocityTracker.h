@@ -172,22 +172,24 @@ private:
     // Number of samples to keep.
     static const uint32_t HISTORY_SIZE = 20;
 
-    struct Movement {
-        nsecs_t eventTime;
-        BitSet32 idBits;
-        VelocityTracker::Position positions[MAX_POINTERS];
-
-        inline const VelocityTracker::Position& getPosition(uint32_t id) const {
-            return positions[idBits.getIndexOfBit(id)];
-        }
+    // The samples of one pointer since it went down, as a fixed-capacity ring laid out as
+    // separate arrays so that the fit reads them without walking every movement.
+    struct alignas(64) PointerHistory {
+        nsecs_t eventTime[HISTORY_SIZE];
+        float x[HISTORY_SIZE];
+        float y[HISTORY_SIZE];
+        uint32_t newest; // index of the most recent sample
+        uint32_t size;   // number of valid samples, at most HISTORY_SIZE
     };
 
-    float chooseWeight(uint32_t index) const;
+    float chooseWeight(const PointerHistory& history, uint32_t index) const;
 
     const uint32_t mDegree;
     const Weighting mWeighting;
-    uint32_t mIndex;
-    Movement mMovements[HISTORY_SIZE];
+    nsecs_t mLastEventTime;
+    // Pointers in the most recent movement. Only they have a usable history.
+    BitSet32 mPointerIdBits;
+    PointerHistory mHistory[MAX_POINTER_ID + 1];
 };
 
 
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_POWERMANAGER_THERMALSTATUSPAGE_H
+#define ANDROID_POWERMANAGER_THERMALSTATUSPAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include <powermanager/PowerManager.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+/**
+ * The thermal status page is a page of shared memory that the thermal service
+ * keeps up to date with the current thermal status and headroom forecasts.
+ * Native clients map it once and then read it without binder calls, for
+ * example to make throttling decisions every frame.
+ *
+ * There is a single writer. Readers never block it; a read that races with an
+ * update is retried.
+ */
+
+/** Horizons, in seconds, for which the page carries a headroom forecast. */
+constexpr int32_t kThermalHeadroomForecastSeconds[] = {0, 1, 5, 10, 30};
+constexpr size_t kNumThermalHeadroomForecasts =
+        sizeof(kThermalHeadroomForecastSeconds) / sizeof(kThermalHeadroomForecastSeconds[0]);
+
+struct ThermalStatusSnapshot {
+    ThermalStatus status = ThermalStatus::THERMAL_STATUS_NONE;
+    /** CLOCK_MONOTONIC time of the update, 0 if the page was never written. */
+    int64_t updateTimeNs = 0;
+    /**
+     * Headroom forecast for each of kThermalHeadroomForecastSeconds, as
+     * returned by PowerManager.getThermalHeadroom(): 1.0 is the point where
+     * severe throttling starts. NaN if unknown.
+     */
+    float headroom[kNumThermalHeadroomForecasts];
+};
+
+/** The layout of the shared memory, private to the implementation. */
+struct ThermalStatusPageLayout;
+
+class ThermalStatusPageWriter {
+public:
+    /** Creates a new page, with status NONE and unknown headroom. */
+    static std::unique_ptr<ThermalStatusPageWriter> create();
+    ~ThermalStatusPageWriter();
+
+    /**
+     * The fd of the page, to hand to readers. It can only be mapped
+     * read-only. Owned by the writer.
+     */
+    int getFd() const { return mFd; }
+
+    /** Publishes a new status and headroom forecasts. Not thread safe. */
+    void update(ThermalStatus status, const float (&headroom)[kNumThermalHeadroomForecasts]);
+
+private:
+    ThermalStatusPageWriter(int fd, ThermalStatusPageLayout* page) : mFd(fd), mPage(page) {}
+
+    const int mFd;
+    ThermalStatusPageLayout* const mPage;
+};
+
+class ThermalStatusPageReader {
+public:
+    /** Maps the page behind fd. Does not take ownership of fd. */
+    static std::unique_ptr<ThermalStatusPageReader> create(int fd);
+    ~ThermalStatusPageReader();
+
+    /**
+     * Copies the latest update into outSnapshot. Returns WOULD_BLOCK if the
+     * writer kept updating the page while it was being read.
+     */
+    status_t read(ThermalStatusSnapshot* outSnapshot) const;
+
+    /**
+     * Returns the headroom forecast forecastSeconds ahead, interpolated
+     * between the forecasts on the page. NaN if unknown.
+     */
+    float getHeadroom(int32_t forecastSeconds) const;
+
+private:
+    explicit ThermalStatusPageReader(const ThermalStatusPageLayout* page) : mPage(page) {}
+
+    const ThermalStatusPageLayout* const mPage;
+};
+
+}; // namespace android
+
+#endif // ANDROID_POWERMANAGER_THERMALSTATUSPAGE_H
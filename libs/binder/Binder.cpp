@@ -18,6 +18,7 @@
 
 #include <atomic>
 #include <utils/misc.h>
+#include <binder/BinderStats.h>
 #include <binder/BpBinder.h>
 #include <binder/IInterface.h>
 #include <binder/IResultReceiver.h>
@@ -100,6 +101,22 @@ status_t IBinder::getExtension(sp<IBinder>* out) {
     return reply.readNullableStrongBinder(out);
 }
 
+status_t IBinder::getDebugBinderStats(String16* out) {
+    BBinder* local = this->localBinder();
+    if (local != nullptr) {
+      std::string stats;
+      BinderStats::dump(&stats);
+      *out = String16(stats.c_str());
+      return OK;
+    }
+
+    Parcel data;
+    Parcel reply;
+    status_t status = transact(DEBUG_STATS_TRANSACTION, data, &reply);
+    if (status != OK) return status;
+    return reply.readString16(out);
+}
+
 status_t IBinder::getDebugPid(pid_t* out) {
     BBinder* local = this->localBinder();
     if (local != nullptr) {
@@ -173,6 +190,9 @@ status_t BBinder::transact(
 {
     data.setDataPosition(0);
 
+    const bool recordStats = BinderStats::isEnabled();
+    const nsecs_t startTime = recordStats ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+
     status_t err = NO_ERROR;
     switch (code) {
         case PING_TRANSACTION:
@@ -184,6 +204,12 @@ status_t BBinder::transact(
         case DEBUG_PID_TRANSACTION:
             err = reply->writeInt32(getDebugPid());
             break;
+        case DEBUG_STATS_TRANSACTION: {
+            std::string stats;
+            BinderStats::dump(&stats);
+            err = reply->writeUtf8AsUtf16(stats);
+            break;
+        }
         default:
             err = onTransact(code, data, reply, flags);
             break;
@@ -194,6 +220,11 @@ status_t BBinder::transact(
         reply->setDataPosition(0);
     }
 
+    if (recordStats && code != DEBUG_STATS_TRANSACTION) {
+        BinderStats::recordIncoming(this, code, systemTime(SYSTEM_TIME_MONOTONIC) - startTime,
+                                    data.dataSize());
+    }
+
     return err;
 }
 
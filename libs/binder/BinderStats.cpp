@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BinderStats"
+
+#include <binder/BinderStats.h>
+
+#include <binder/Binder.h>
+#include <binder/BpBinder.h>
+#include <binder/ProcessState.h>
+#include <utils/Log.h>
+#include <utils/String8.h>
+
+#include <algorithm>
+#include <inttypes.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <unistd.h>
+
+namespace android {
+
+std::atomic_bool BinderStats::sEnabled(false);
+
+namespace {
+
+// Slots per thread. Each slot is ~520 bytes, and shards are only allocated
+// for threads that transact while stats are enabled.
+constexpr size_t kSlotsPerShard = 64;
+
+struct Slot {
+    // Published last, with release semantics, once the fields below are set.
+    std::atomic_bool used{false};
+    BinderStats::Direction direction;
+    // The BBinder or BpBinder the samples were recorded against. Only used
+    // to find the slot again; it is never dereferenced.
+    const void* object;
+    uint32_t code;
+    const String16* interface;
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> latencyUs[BinderStats::kNumBuckets] = {};
+    std::atomic<uint64_t> sizeBytes[BinderStats::kNumBuckets] = {};
+};
+
+struct Shard {
+    Slot slots[kSlotsPerShard];
+    std::atomic<uint64_t> dropped{0};
+    // Only touched under gShardLock.
+    bool owned = true;
+};
+
+std::mutex gShardLock;
+// Shards are never freed: a shard whose thread exited keeps its samples and is
+// handed to the next thread that needs one.
+std::vector<Shard*>& shards() {
+    static std::vector<Shard*>* sShards = new std::vector<Shard*>();
+    return *sShards;
+}
+
+std::mutex gInternLock;
+const String16* intern(const String16& s) {
+    static std::set<String16>* sInterned = new std::set<String16>();
+    std::lock_guard<std::mutex> lock(gInternLock);
+    return &*sInterned->insert(s).first;
+}
+
+struct ShardHolder {
+    Shard* shard = nullptr;
+    ~ShardHolder() {
+        if (shard == nullptr) return;
+        std::lock_guard<std::mutex> lock(gShardLock);
+        shard->owned = false;
+    }
+};
+
+thread_local ShardHolder tShard;
+
+Shard* currentShard() {
+    if (tShard.shard != nullptr) return tShard.shard;
+
+    std::lock_guard<std::mutex> lock(gShardLock);
+    for (Shard* shard : shards()) {
+        if (!shard->owned) {
+            shard->owned = true;
+            tShard.shard = shard;
+            return shard;
+        }
+    }
+    tShard.shard = new Shard();
+    shards().push_back(tShard.shard);
+    return tShard.shard;
+}
+
+size_t bucketFor(uint64_t value) {
+    if (value == 0) return 0;
+    size_t bucket = 64 - __builtin_clzll(value);
+    return std::min(bucket, BinderStats::kNumBuckets - 1);
+}
+
+template <typename ResolveInterface>
+void record(BinderStats::Direction direction, const void* object, uint32_t code,
+            nsecs_t latency, size_t size, ResolveInterface resolveInterface) {
+    Shard* shard = currentShard();
+    const size_t hash = (reinterpret_cast<uintptr_t>(object) >> 4) * 31 + code;
+    for (size_t i = 0; i < kSlotsPerShard; i++) {
+        Slot& slot = shard->slots[(hash + i) % kSlotsPerShard];
+        if (!slot.used.load(std::memory_order_acquire)) {
+            // Only this thread writes to the shard, so claiming is race free.
+            slot.direction = direction;
+            slot.object = object;
+            slot.code = code;
+            slot.interface = intern(resolveInterface());
+            slot.used.store(true, std::memory_order_release);
+        } else if (slot.object != object || slot.code != code ||
+                   slot.direction != direction) {
+            continue;
+        }
+        const uint64_t latencyUs = latency > 0 ? static_cast<uint64_t>(latency / 1000) : 0;
+        slot.count.fetch_add(1, std::memory_order_relaxed);
+        slot.latencyUs[bucketFor(latencyUs)].fetch_add(1, std::memory_order_relaxed);
+        slot.sizeBytes[bucketFor(size)].fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    shard->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t bucketUpperBound(size_t bucket) {
+    return bucket == 0 ? 0 : (1ull << bucket) - 1;
+}
+
+uint64_t percentile(const uint64_t (&buckets)[BinderStats::kNumBuckets], uint64_t count,
+                    double p) {
+    const uint64_t target = static_cast<uint64_t>(count * p);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BinderStats::kNumBuckets; i++) {
+        seen += buckets[i];
+        if (seen > target) return bucketUpperBound(i);
+    }
+    return bucketUpperBound(BinderStats::kNumBuckets - 1);
+}
+
+uint64_t maxBucket(const uint64_t (&buckets)[BinderStats::kNumBuckets]) {
+    for (size_t i = BinderStats::kNumBuckets; i > 0; i--) {
+        if (buckets[i - 1] != 0) return bucketUpperBound(i - 1);
+    }
+    return 0;
+}
+
+} // namespace
+
+void BinderStats::setEnabled(bool enabled) {
+    sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void BinderStats::recordIncoming(const BBinder* binder, uint32_t code, nsecs_t latency,
+                                 size_t size) {
+    record(Direction::INCOMING, binder, code, latency, size,
+           [&]() -> const String16& { return binder->getInterfaceDescriptor(); });
+}
+
+void BinderStats::recordOutgoing(const BpBinder* proxy, int32_t handle, uint32_t code,
+                                 nsecs_t latency, size_t size) {
+    record(Direction::OUTGOING, proxy, code, latency, size, [&]() -> String16 {
+        // Never transact from here: only use the descriptor if it is cached.
+        if (proxy->isDescriptorCached()) return proxy->getInterfaceDescriptor();
+        return String16(String8::format("handle %d", handle));
+    });
+}
+
+std::vector<BinderStats::Entry> BinderStats::snapshot() {
+    using Key = std::tuple<Direction, String16, uint32_t>;
+    std::map<Key, Entry> merged;
+
+    std::lock_guard<std::mutex> lock(gShardLock);
+    for (const Shard* shard : shards()) {
+        for (const Slot& slot : shard->slots) {
+            if (!slot.used.load(std::memory_order_acquire)) continue;
+            Key key(slot.direction, *slot.interface, slot.code);
+            auto it = merged.find(key);
+            if (it == merged.end()) {
+                Entry entry = {};
+                entry.direction = slot.direction;
+                entry.interface = *slot.interface;
+                entry.code = slot.code;
+                it = merged.emplace(key, entry).first;
+            }
+            Entry& entry = it->second;
+            entry.count += slot.count.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kNumBuckets; i++) {
+                entry.latencyUs[i] += slot.latencyUs[i].load(std::memory_order_relaxed);
+                entry.sizeBytes[i] += slot.sizeBytes[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(merged.size());
+    for (auto& [key, entry] : merged) entries.push_back(entry);
+    return entries;
+}
+
+void BinderStats::reset() {
+    std::lock_guard<std::mutex> lock(gShardLock);
+    for (Shard* shard : shards()) {
+        for (Slot& slot : shard->slots) {
+            slot.count.store(0, std::memory_order_relaxed);
+            for (size_t i = 0; i < kNumBuckets; i++) {
+                slot.latencyUs[i].store(0, std::memory_order_relaxed);
+                slot.sizeBytes[i].store(0, std::memory_order_relaxed);
+            }
+        }
+        shard->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+void BinderStats::dump(std::string* out) {
+    if (!isEnabled()) {
+        out->append("Binder stats are disabled (setprop debug.binder.stats true).\n");
+        return;
+    }
+
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(gShardLock);
+        for (const Shard* shard : shards()) {
+            dropped += shard->dropped.load(std::memory_order_relaxed);
+        }
+    }
+
+    String8 result;
+    result.appendFormat("Binder stats for pid %d (%" PRIu64 " samples dropped):\n", getpid(),
+                        dropped);
+    if (sp<ProcessState> proc = ProcessState::selfOrNull(); proc != nullptr) {
+        ProcessState::ThreadPoolStats pool = proc->getThreadPoolStats();
+        result.appendFormat("  thread pool: limit=%zu pooled=%zu executing=%zu spawned=%" PRIu64
+                            " grown=%" PRIu64 " retired=%" PRIu64 " starved=%" PRIu64
+                            " (total %" PRId64 " ms, max %" PRId64 " ms)\n",
+                            pool.maxThreads, pool.pooledThreads, pool.executingThreads,
+                            pool.spawnEvents, pool.growEvents, pool.retiredThreads,
+                            pool.starvationEvents, pool.totalStarvationMs, pool.maxStarvationMs);
+    }
+    for (const Entry& e : snapshot()) {
+        if (e.count == 0) continue;
+        result.appendFormat("  %s %s code=%u count=%" PRIu64 " latency_us(p50<=%" PRIu64
+                            " p90<=%" PRIu64 " p99<=%" PRIu64 " max<=%" PRIu64
+                            ") size_bytes(p50<=%" PRIu64 " p99<=%" PRIu64 " max<=%" PRIu64 ")\n",
+                            e.direction == Direction::INCOMING ? "in " : "out",
+                            String8(e.interface).c_str(), e.code, e.count,
+                            percentile(e.latencyUs, e.count, 0.50),
+                            percentile(e.latencyUs, e.count, 0.90),
+                            percentile(e.latencyUs, e.count, 0.99), maxBucket(e.latencyUs),
+                            percentile(e.sizeBytes, e.count, 0.50),
+                            percentile(e.sizeBytes, e.count, 0.99), maxBucket(e.sizeBytes));
+    }
+    out->append(result.c_str(), result.size());
+}
+
+} // namespace android
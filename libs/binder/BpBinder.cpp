@@ -19,6 +19,7 @@
 
 #include <binder/BpBinder.h>
 
+#include <binder/BinderStats.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IResultReceiver.h>
 #include <binder/Stability.h>
@@ -234,10 +235,19 @@ status_t BpBinder::transact(
             }
         }
 
+        const bool recordStats = BinderStats::isEnabled();
+        const nsecs_t startTime = recordStats ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+
         status_t status = IPCThreadState::self()->transact(
             mHandle, code, data, reply, flags);
         if (status == DEAD_OBJECT) mAlive = 0;
 
+        if (recordStats) {
+            BinderStats::recordOutgoing(this, mHandle, code,
+                                        systemTime(SYSTEM_TIME_MONOTONIC) - startTime,
+                                        data.dataSize());
+        }
+
         return status;
     }
 
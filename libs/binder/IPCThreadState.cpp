@@ -34,10 +34,12 @@
 #include <atomic>
 #include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sched.h>
 #include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/resource.h>
 #include <unistd.h>
@@ -115,6 +117,10 @@ static const char *kCommandStrings[] = {
 
 static const int64_t kWorkSourcePropagatedBitIndex = 32;
 
+// Oneway batches are submitted early once they reach this many transactions,
+// to bound both the copies we hold on to and the size of mOut.
+static const size_t kMaxOnewayBatchSize = 64;
+
 static const char* getReturnString(uint32_t cmd)
 {
     size_t idx = cmd & _IOC_NRMASK;
@@ -284,6 +290,17 @@ static pthread_key_t gTLS = 0;
 static std::atomic<bool> gShutdown = false;
 static std::atomic<bool> gDisableBackgroundScheduling = false;
 
+// Parcel buffer arena. Buffers smaller than kParcelBufferArenaMinCapacity are
+// rounded up so that a typical transaction never needs to realloc, and buffers
+// that grew past kParcelBufferArenaMaxCapacity are not worth keeping around.
+static constexpr size_t kParcelBufferArenaMinCapacity = 1024;
+static constexpr size_t kParcelBufferArenaMaxCapacity = 16 * 1024;
+static std::atomic<bool> gParcelBufferArenaEnabled = false;
+static std::atomic<uint64_t> gParcelBufferArenaHits = 0;
+static std::atomic<uint64_t> gParcelBufferArenaMisses = 0;
+static std::atomic<uint64_t> gParcelBufferArenaRecycled = 0;
+static std::atomic<uint64_t> gParcelBufferArenaDiscarded = 0;
+
 IPCThreadState* IPCThreadState::self()
 {
     if (gHaveTLS.load(std::memory_order_acquire)) {
@@ -351,6 +368,71 @@ bool IPCThreadState::backgroundSchedulingDisabled()
     return gDisableBackgroundScheduling.load(std::memory_order_relaxed);
 }
 
+void IPCThreadState::setParcelBufferArenaEnabled(bool enabled)
+{
+    gParcelBufferArenaEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IPCThreadState::parcelBufferArenaEnabled()
+{
+    return gParcelBufferArenaEnabled.load(std::memory_order_relaxed);
+}
+
+IPCThreadState::ParcelBufferArenaStats IPCThreadState::getParcelBufferArenaStats()
+{
+    ParcelBufferArenaStats stats;
+    stats.hits = gParcelBufferArenaHits.load(std::memory_order_relaxed);
+    stats.misses = gParcelBufferArenaMisses.load(std::memory_order_relaxed);
+    stats.recycled = gParcelBufferArenaRecycled.load(std::memory_order_relaxed);
+    stats.discarded = gParcelBufferArenaDiscarded.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint8_t* IPCThreadState::acquireParcelBuffer(size_t desired, size_t* outCapacity)
+{
+    // Best fit among the cached buffers; the arena is tiny so a linear scan
+    // is cheaper than keeping it sorted.
+    size_t best = mParcelBufferCount;
+    for (size_t i = 0; i < mParcelBufferCount; i++) {
+        if (mParcelBuffers[i].capacity >= desired &&
+                (best == mParcelBufferCount ||
+                 mParcelBuffers[i].capacity < mParcelBuffers[best].capacity)) {
+            best = i;
+        }
+    }
+    if (best != mParcelBufferCount) {
+        uint8_t* data = mParcelBuffers[best].data;
+        *outCapacity = mParcelBuffers[best].capacity;
+        mParcelBuffers[best] = mParcelBuffers[--mParcelBufferCount];
+        gParcelBufferArenaHits.fetch_add(1, std::memory_order_relaxed);
+        return data;
+    }
+
+    const size_t capacity = desired < kParcelBufferArenaMinCapacity
+            ? kParcelBufferArenaMinCapacity : desired;
+    uint8_t* data = (uint8_t*)malloc(capacity);
+    if (data) {
+        *outCapacity = capacity;
+        gParcelBufferArenaMisses.fetch_add(1, std::memory_order_relaxed);
+    }
+    return data;
+}
+
+bool IPCThreadState::recycleParcelBuffer(uint8_t* data, size_t capacity)
+{
+    if (mParcelBufferArenaClosed || capacity < kParcelBufferArenaMinCapacity ||
+            capacity > kParcelBufferArenaMaxCapacity ||
+            mParcelBufferCount >= kParcelBufferArenaSlots) {
+        gParcelBufferArenaDiscarded.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    mParcelBuffers[mParcelBufferCount].data = data;
+    mParcelBuffers[mParcelBufferCount].capacity = capacity;
+    mParcelBufferCount++;
+    gParcelBufferArenaRecycled.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
 sp<ProcessState> IPCThreadState::process()
 {
     return mProcess;
@@ -466,6 +548,9 @@ void IPCThreadState::flushCommands()
 {
     if (mProcess->mDriverFD < 0)
         return;
+    if (mOnewayBatchCount > 0) {
+        submitOnewayBatch();
+    }
     talkWithDriver(false);
     // The flush could have caused post-write refcount decrements to have
     // been executed, which in turn could result in BC_RELEASE/BC_DECREFS
@@ -524,6 +609,7 @@ status_t IPCThreadState::getAndExecuteCommand()
                 ALOGE("binder thread pool (%zu threads) starved for %" PRId64 " ms",
                       mProcess->mMaxThreads, starvationTimeMs);
             }
+            mProcess->noteStarvationLocked(starvationTimeMs);
             mProcess->mStarvationStartTimeMs = 0;
         }
         pthread_cond_broadcast(&mProcess->mThreadCountDecrement);
@@ -533,6 +619,28 @@ status_t IPCThreadState::getAndExecuteCommand()
     return result;
 }
 
+bool IPCThreadState::idleTimedOut()
+{
+    const int64_t timeoutMs = mProcess->threadPoolIdleTimeoutMs();
+    if (timeoutMs <= 0 || mIn.dataPosition() < mIn.dataSize()) return false;
+
+    // Hand pending commands (e.g. BC_REGISTER_LOOPER) to the driver first,
+    // without blocking for a reply.
+    if (mOut.dataSize() > 0) {
+        talkWithDriver(false);
+        if (mIn.dataPosition() < mIn.dataSize()) return false;
+    }
+
+    struct pollfd pfd = {
+        .fd = mProcess->mDriverFD,
+        .events = POLLIN,
+    };
+    int ret = TEMP_FAILURE_RETRY(poll(&pfd, 1, static_cast<int>(timeoutMs)));
+    if (ret != 0) return false;
+
+    return mProcess->retireIdlePooledThread();
+}
+
 // When we've cleared the incoming command queue, process any pending derefs
 void IPCThreadState::processPendingDerefs()
 {
@@ -589,9 +697,22 @@ void IPCThreadState::joinThreadPool(bool isMain)
 
     mOut.writeInt32(isMain ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
 
+    if (!isMain) {
+        pthread_mutex_lock(&mProcess->mThreadCountLock);
+        mProcess->mPooledThreadsCount++;
+        pthread_mutex_unlock(&mProcess->mThreadCountLock);
+    }
+
     status_t result;
+    bool retired = false;
     do {
         processPendingDerefs();
+        // With an adaptive pool, idle spawned loopers may leave after a timeout.
+        if (!isMain && idleTimedOut()) {
+            retired = true;
+            result = TIMED_OUT;
+            break;
+        }
         // now get the next command to be processed, waiting if necessary
         result = getAndExecuteCommand();
 
@@ -610,6 +731,12 @@ void IPCThreadState::joinThreadPool(bool isMain)
     LOG_THREADPOOL("**** THREAD %p (PID %d) IS LEAVING THE THREAD POOL err=%d\n",
         (void*)pthread_self(), getpid(), result);
 
+    if (!isMain && !retired) {
+        pthread_mutex_lock(&mProcess->mThreadCountLock);
+        mProcess->mPooledThreadsCount--;
+        pthread_mutex_unlock(&mProcess->mThreadCountLock);
+    }
+
     mOut.writeInt32(BC_EXIT_LOOPER);
     talkWithDriver(false);
 }
@@ -663,6 +790,35 @@ status_t IPCThreadState::transact(int32_t handle,
             << indent << data << dedent << endl;
     }
 
+    if (mOnewayBatchDepth > 0 && (flags & TF_ONE_WAY) != 0) {
+        // The driver only reads the data when the batch is submitted, so
+        // keep our own copy alive until then.
+        if (mOnewayBatchCount == mOnewayBatch.size()) {
+            mOnewayBatch.push_back(std::make_unique<Parcel>());
+        }
+        Parcel* copy = mOnewayBatch[mOnewayBatchCount].get();
+        err = data.errorCheck();
+        if (err == NO_ERROR) err = copy->appendFrom(&data, 0, data.dataSize());
+        if (err == NO_ERROR) {
+            err = writeTransactionData(BC_TRANSACTION, flags, handle, code, *copy, nullptr);
+        }
+        if (err != NO_ERROR) {
+            copy->freeData();
+            return (mLastError = err);
+        }
+        LOG_ONEWAY(">>>> QUEUE from pid %d uid %d ONE WAY (%zu batched)", getpid(), getuid(),
+            mOnewayBatchCount + 1);
+        if (++mOnewayBatchCount >= kMaxOnewayBatchSize) {
+            return submitOnewayBatch();
+        }
+        return NO_ERROR;
+    }
+
+    if (mOnewayBatchCount > 0) {
+        // Completions for the batch must not be mistaken for ours.
+        submitOnewayBatch();
+    }
+
     LOG_ONEWAY(">>>> SEND from pid %d uid %d %s", getpid(), getuid(),
         (flags & TF_ONE_WAY) == 0 ? "READ REPLY" : "ONE WAY");
     err = writeTransactionData(BC_TRANSACTION, flags, handle, code, data, nullptr);
@@ -718,6 +874,42 @@ status_t IPCThreadState::transact(int32_t handle,
     return err;
 }
 
+void IPCThreadState::beginOnewayBatch()
+{
+    mOnewayBatchDepth++;
+}
+
+status_t IPCThreadState::flushOnewayBatch()
+{
+    if (mOnewayBatchDepth == 0) {
+        ALOGW("flushOnewayBatch() without matching beginOnewayBatch()");
+        return INVALID_OPERATION;
+    }
+    if (--mOnewayBatchDepth > 0) return NO_ERROR;
+    return submitOnewayBatch();
+}
+
+status_t IPCThreadState::submitOnewayBatch()
+{
+    status_t result = NO_ERROR;
+    const size_t count = mOnewayBatchCount;
+    LOG_ONEWAY(">>>> SEND from pid %d uid %d %zu ONE WAY", getpid(), getuid(), count);
+
+    // The first waitForResponse() writes out every queued BC_TRANSACTION in one
+    // go; each transaction then gets its own BR_TRANSACTION_COMPLETE (or error)
+    // back, which later iterations consume from mIn.
+    for (size_t i = 0; i < count; i++) {
+        status_t err = waitForResponse(nullptr, nullptr);
+        if (err != NO_ERROR && result == NO_ERROR) result = err;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        mOnewayBatch[i]->freeData();
+    }
+    mOnewayBatchCount = 0;
+    return result;
+}
+
 void IPCThreadState::incStrongHandle(int32_t handle, BpBinder *proxy)
 {
     LOG_REMOTEREFS("IPCThreadState::incStrongHandle(%d)\n", handle);
@@ -802,12 +994,16 @@ status_t IPCThreadState::clearDeathNotification(int32_t handle, BpBinder* proxy)
 
 IPCThreadState::IPCThreadState()
     : mProcess(ProcessState::self()),
+      mParcelBufferCount(0),
+      mParcelBufferArenaClosed(false),
       mServingStackPointer(nullptr),
       mWorkSource(kUnsetWorkSource),
       mPropagateWorkSource(false),
       mStrictModePolicy(0),
       mLastTransactionBinderFlags(0),
-      mCallRestriction(mProcess->mCallRestriction)
+      mCallRestriction(mProcess->mCallRestriction),
+      mOnewayBatchDepth(0),
+      mOnewayBatchCount(0)
 {
     pthread_setspecific(gTLS, this);
     clearCaller();
@@ -817,12 +1013,20 @@ IPCThreadState::IPCThreadState()
 
 IPCThreadState::~IPCThreadState()
 {
+    mParcelBufferArenaClosed = true;
+    for (size_t i = 0; i < mParcelBufferCount; i++) {
+        free(mParcelBuffers[i].data);
+    }
+    mParcelBufferCount = 0;
 }
 
 status_t IPCThreadState::sendReply(const Parcel& reply, uint32_t flags)
 {
     status_t err;
     status_t statusBuffer;
+    if (mOnewayBatchCount > 0) {
+        submitOnewayBatch();
+    }
     err = writeTransactionData(BC_REPLY, flags, -1, 0, reply, &statusBuffer);
     if (err < NO_ERROR) return err;
 
@@ -36,6 +36,9 @@
 
 #include "Static.h"
 
+#include <atomic>
+#include <map>
+#include <mutex>
 #include <unistd.h>
 
 namespace android {
@@ -60,6 +63,15 @@ const String16& IServiceManager::getInterfaceDescriptor() const {
 IServiceManager::IServiceManager() {}
 IServiceManager::~IServiceManager() {}
 
+Vector<sp<IBinder>> IServiceManager::getServices(const Vector<String16>& names) {
+    Vector<sp<IBinder>> res;
+    res.setCapacity(names.size());
+    for (const String16& name : names) {
+        res.push(getService(name));
+    }
+    return res;
+}
+
 // From the old libbinder IServiceManager interface to IServiceManager.
 class ServiceManagerShim : public IServiceManager
 {
@@ -73,6 +85,7 @@ public:
     Vector<String16> listServices(int dumpsysPriority) override;
     sp<IBinder> waitForService(const String16& name16) override;
     bool isDeclared(const String16& name) override;
+    Vector<sp<IBinder>> getServices(const Vector<String16>& names) override;
 
     // for legacy ABI
     const String16& getInterfaceDescriptor() const override {
@@ -82,9 +95,47 @@ public:
         return IInterface::asBinder(mTheRealServiceManager).get();
     }
 private:
+    // Process-local cache of name -> service. Entries are only weak
+    // references, so caching never keeps a (possibly lazy) service alive on
+    // its own. An entry is dropped when its binder dies, and replaced when
+    // servicemanager reports that the name was registered again.
+    class CacheInvalidator : public android::os::BnServiceCallback,
+                             public IBinder::DeathRecipient {
+    public:
+        explicit CacheInvalidator(const ServiceManagerShim* shim) : mShim(shim) {}
+        Status onRegistration(const std::string& name, const sp<IBinder>& binder) override;
+        void binderDied(const wp<IBinder>& who) override;
+    private:
+        const ServiceManagerShim* mShim;
+    };
+
+    sp<IBinder> lookupCache(const String16& name) const;
+    void insertCache(const String16& name, const sp<IBinder>& binder) const;
+
     sp<AidlServiceManager> mTheRealServiceManager;
+
+    mutable std::mutex mCacheMutex;
+    struct CacheEntry {
+        wp<IBinder> binder;
+        bool subscribed;
+    };
+    mutable std::map<String16, CacheEntry> mCache;
+    sp<CacheInvalidator> mCacheInvalidator;
 };
 
+static std::atomic<uint64_t> gServiceCacheHits = 0;
+static std::atomic<uint64_t> gServiceCacheMisses = 0;
+static std::atomic<uint64_t> gServiceCacheInvalidations = 0;
+
+ServiceCacheStats getServiceCacheStats()
+{
+    ServiceCacheStats stats;
+    stats.hits = gServiceCacheHits.load(std::memory_order_relaxed);
+    stats.misses = gServiceCacheMisses.load(std::memory_order_relaxed);
+    stats.invalidations = gServiceCacheInvalidations.load(std::memory_order_relaxed);
+    return stats;
+}
+
 [[clang::no_destroy]] static std::once_flag gSmOnce;
 [[clang::no_destroy]] static sp<IServiceManager> gDefaultServiceManager;
 
@@ -203,9 +254,68 @@ bool checkPermission(const String16& permission, pid_t pid, uid_t uid)
 // ----------------------------------------------------------------------
 
 ServiceManagerShim::ServiceManagerShim(const sp<AidlServiceManager>& impl)
- : mTheRealServiceManager(impl)
+ : mTheRealServiceManager(impl),
+   mCacheInvalidator(new CacheInvalidator(this))
 {}
 
+Status ServiceManagerShim::CacheInvalidator::onRegistration(const std::string& name,
+                                                            const sp<IBinder>& binder)
+{
+    std::lock_guard<std::mutex> lock(mShim->mCacheMutex);
+    auto it = mShim->mCache.find(String16(name.c_str()));
+    if (it != mShim->mCache.end() && it->second.binder != binder) {
+        it->second.binder = binder;
+        gServiceCacheInvalidations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return Status::ok();
+}
+
+void ServiceManagerShim::CacheInvalidator::binderDied(const wp<IBinder>& who)
+{
+    std::lock_guard<std::mutex> lock(mShim->mCacheMutex);
+    for (auto& [name, entry] : mShim->mCache) {
+        if (entry.binder == who) {
+            entry.binder = nullptr;
+            gServiceCacheInvalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+sp<IBinder> ServiceManagerShim::lookupCache(const String16& name) const
+{
+    std::lock_guard<std::mutex> lock(mCacheMutex);
+    auto it = mCache.find(name);
+    if (it == mCache.end()) return nullptr;
+    sp<IBinder> binder = it->second.binder.promote();
+    if (binder == nullptr || !binder->isBinderAlive()) return nullptr;
+    return binder;
+}
+
+void ServiceManagerShim::insertCache(const String16& name, const sp<IBinder>& binder) const
+{
+    bool subscribe;
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        CacheEntry& entry = mCache[name];
+        entry.binder = binder;
+        subscribe = !entry.subscribed;
+        entry.subscribed = true;
+    }
+
+    // Local binders never die; linkToDeath() just fails for them.
+    if (binder->remoteBinder() != nullptr) {
+        binder->linkToDeath(mCacheInvalidator);
+    }
+    if (subscribe &&
+            !mTheRealServiceManager->registerForNotifications(
+                String8(name).c_str(), mCacheInvalidator).isOk()) {
+        // Without a notification stream we can't tell when the name is
+        // re-registered, so don't serve this name from the cache.
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        mCache.erase(name);
+    }
+}
+
 sp<IBinder> ServiceManagerShim::getService(const String16& name) const
 {
     static bool gSystemBootCompleted = false;
@@ -245,10 +355,17 @@ sp<IBinder> ServiceManagerShim::getService(const String16& name) const
 
 sp<IBinder> ServiceManagerShim::checkService(const String16& name) const
 {
-    sp<IBinder> ret;
+    sp<IBinder> ret = lookupCache(name);
+    if (ret != nullptr) {
+        gServiceCacheHits.fetch_add(1, std::memory_order_relaxed);
+        return ret;
+    }
+    gServiceCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
     if (!mTheRealServiceManager->checkService(String8(name).c_str(), &ret).isOk()) {
         return nullptr;
     }
+    if (ret != nullptr) insertCache(name, ret);
     return ret;
 }
 
@@ -305,7 +422,12 @@ sp<IBinder> ServiceManagerShim::waitForService(const String16& name16)
 
     const std::string name = String8(name16).c_str();
 
-    sp<IBinder> out;
+    sp<IBinder> out = lookupCache(name16);
+    if (out != nullptr) {
+        gServiceCacheHits.fetch_add(1, std::memory_order_relaxed);
+        return out;
+    }
+
     if (!mTheRealServiceManager->getService(name, &out).isOk()) {
         return nullptr;
     }
@@ -348,6 +470,44 @@ sp<IBinder> ServiceManagerShim::waitForService(const String16& name16)
     }
 }
 
+Vector<sp<IBinder>> ServiceManagerShim::getServices(const Vector<String16>& names)
+{
+    Vector<sp<IBinder>> res;
+    res.setCapacity(names.size());
+
+    // Serve what we can from the cache and only ask for the rest.
+    std::vector<std::string> missing;
+    for (const String16& name : names) {
+        sp<IBinder> binder = lookupCache(name);
+        if (binder != nullptr) {
+            gServiceCacheHits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            gServiceCacheMisses.fetch_add(1, std::memory_order_relaxed);
+            missing.push_back(String8(name).c_str());
+        }
+        res.push(binder);
+    }
+    if (missing.empty()) return res;
+
+    std::vector<sp<IBinder>> found;
+    if (!mTheRealServiceManager->getServices(missing, &found).isOk() ||
+            found.size() != missing.size()) {
+        // Older servicemanager, fall back to one lookup per name.
+        for (size_t i = 0; i < res.size(); i++) {
+            if (res[i] == nullptr) res.editItemAt(i) = getService(names[i]);
+        }
+        return res;
+    }
+
+    for (size_t i = 0, j = 0; i < res.size(); i++) {
+        if (res[i] != nullptr) continue;
+        const sp<IBinder>& binder = found[j++];
+        if (binder != nullptr) insertCache(names[i], binder);
+        res.editItemAt(i) = binder;
+    }
+    return res;
+}
+
 bool ServiceManagerShim::isDeclared(const String16& name) {
     bool declared;
     if (!mTheRealServiceManager->isDeclared(String8(name).c_str(), &declared).isOk()) {
@@ -25,6 +25,9 @@
 #include <utils/String8.h>
 #include <utils/threads.h>
 
+#include <algorithm>
+#include <map>
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -126,7 +129,8 @@ class SimpleBestFitAllocator
         PAGE_ALIGNED = 0x00000001
     };
 public:
-    explicit SimpleBestFitAllocator(size_t size);
+    explicit SimpleBestFitAllocator(size_t size,
+            MemoryDealer::Policy policy = MemoryDealer::Policy::BEST_FIT);
     ~SimpleBestFitAllocator();
 
     size_t      allocate(size_t size, uint32_t flags = 0);
@@ -141,24 +145,47 @@ private:
 
     struct chunk_t {
         chunk_t(size_t start, size_t size)
-        : start(start), size(size), free(1), prev(nullptr), next(nullptr) {
+        : start(start), size(size), free(1), prev(nullptr), next(nullptr),
+          freePrev(nullptr), freeNext(nullptr) {
         }
         size_t              start;
         size_t              size : 28;
         int                 free : 4;
         mutable chunk_t*    prev;
         mutable chunk_t*    next;
+        // size class list links, only used by SEGREGATED_FIT
+        chunk_t*            freePrev;
+        chunk_t*            freeNext;
     };
 
+    // chunk sizes are 28 bits, so one class per bit
+    static const int kNumSizeClasses = 28;
+    // how many chunks of the smallest possible class to try before moving on
+    // to a class where any chunk fits
+    static const int kMaxClassScan = 8;
+
     ssize_t  alloc(size_t size, uint32_t flags);
     chunk_t* dealloc(size_t start);
+    ssize_t  alloc_segregated(size_t size, uint32_t flags);
+    chunk_t* dealloc_segregated(size_t start);
+    chunk_t* split_l(chunk_t* chunk, size_t size, uint32_t flags);
+    void     insertFree_l(chunk_t* chunk);
+    void     removeFree_l(chunk_t* chunk);
     void     dump_l(const char* what) const;
     void     dump_l(String8& res, const char* what) const;
 
+    static int sizeClass(size_t size) { return 31 - __builtin_clz(uint32_t(size)); }
+
     static const int    kMemoryAlign;
     mutable Mutex       mLock;
     LinkedList<chunk_t> mList;
     size_t              mHeapSize;
+    const MemoryDealer::Policy mPolicy;
+    // SEGREGATED_FIT only: free chunks by floor(log2(size)), a bitmap of the
+    // non-empty classes and every chunk by start for deallocation.
+    chunk_t*            mFreeLists[kNumSizeClasses];
+    uint32_t            mFreeClasses;
+    std::map<size_t, chunk_t*> mChunks;
 };
 
 // ----------------------------------------------------------------------------
@@ -233,6 +260,12 @@ MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags)
 {    
 }
 
+MemoryDealer::MemoryDealer(size_t size, const char* name, uint32_t flags, Policy policy)
+    : mHeap(new MemoryHeapBase(size, flags, name)),
+    mAllocator(new SimpleBestFitAllocator(size, policy))
+{
+}
+
 MemoryDealer::~MemoryDealer()
 {
     delete mAllocator;
@@ -277,13 +310,18 @@ size_t MemoryDealer::getAllocationAlignment()
 // align all the memory blocks on a cache-line boundary
 const int SimpleBestFitAllocator::kMemoryAlign = 32;
 
-SimpleBestFitAllocator::SimpleBestFitAllocator(size_t size)
+SimpleBestFitAllocator::SimpleBestFitAllocator(size_t size, MemoryDealer::Policy policy)
+    : mPolicy(policy), mFreeLists(), mFreeClasses(0)
 {
     size_t pagesize = getpagesize();
     mHeapSize = ((size + pagesize-1) & ~(pagesize-1));
 
     chunk_t* node = new chunk_t(0, mHeapSize / kMemoryAlign);
     mList.insertHead(node);
+    if (mPolicy == MemoryDealer::Policy::SEGREGATED_FIT && node->size) {
+        mChunks.emplace(node->start, node);
+        insertFree_l(node);
+    }
 }
 
 SimpleBestFitAllocator::~SimpleBestFitAllocator()
@@ -309,14 +347,16 @@ size_t SimpleBestFitAllocator::size() const
 size_t SimpleBestFitAllocator::allocate(size_t size, uint32_t flags)
 {
     Mutex::Autolock _l(mLock);
-    ssize_t offset = alloc(size, flags);
+    ssize_t offset = mPolicy == MemoryDealer::Policy::SEGREGATED_FIT
+            ? alloc_segregated(size, flags) : alloc(size, flags);
     return offset;
 }
 
 status_t SimpleBestFitAllocator::deallocate(size_t offset)
 {
     Mutex::Autolock _l(mLock);
-    chunk_t const * const freed = dealloc(offset);
+    chunk_t const * const freed = mPolicy == MemoryDealer::Policy::SEGREGATED_FIT
+            ? dealloc_segregated(offset) : dealloc(offset);
     if (freed) {
         return NO_ERROR;
     }
@@ -421,6 +461,133 @@ SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::dealloc(size_t start)
     return nullptr;
 }
 
+void SimpleBestFitAllocator::insertFree_l(chunk_t* chunk)
+{
+    const int c = sizeClass(chunk->size);
+    chunk->freePrev = nullptr;
+    chunk->freeNext = mFreeLists[c];
+    if (mFreeLists[c]) mFreeLists[c]->freePrev = chunk;
+    mFreeLists[c] = chunk;
+    mFreeClasses |= 1u << c;
+}
+
+void SimpleBestFitAllocator::removeFree_l(chunk_t* chunk)
+{
+    const int c = sizeClass(chunk->size);
+    if (chunk->freePrev) chunk->freePrev->freeNext = chunk->freeNext;
+    else                 mFreeLists[c] = chunk->freeNext;
+    if (chunk->freeNext) chunk->freeNext->freePrev = chunk->freePrev;
+    chunk->freePrev = chunk->freeNext = nullptr;
+    if (!mFreeLists[c]) mFreeClasses &= ~(1u << c);
+}
+
+ssize_t SimpleBestFitAllocator::alloc_segregated(size_t size, uint32_t flags)
+{
+    if (size == 0) {
+        return 0;
+    }
+    size = (size + kMemoryAlign-1) / kMemoryAlign;
+    if (size >= (1u << kNumSizeClasses)) {
+        return NO_MEMORY;
+    }
+
+    const size_t pageUnits = getpagesize() / kMemoryAlign;
+    auto extraFor = [&](const chunk_t* c) -> size_t {
+        return (flags & PAGE_ALIGNED) ? (-c->start & (pageUnits-1)) : 0;
+    };
+    // worst case alignment padding, so any chunk of a large enough class fits
+    const size_t need = size + ((flags & PAGE_ALIGNED) ? pageUnits-1 : 0);
+
+    // Chunks in the class of 'need' itself may or may not fit, try a few.
+    chunk_t* found = nullptr;
+    const int c = sizeClass(need);
+    chunk_t* cur = c < kNumSizeClasses ? mFreeLists[c] : nullptr;
+    for (int i = 0; cur && i < kMaxClassScan; i++, cur = cur->freeNext) {
+        if (cur->size >= size + extraFor(cur)) {
+            found = cur;
+            break;
+        }
+    }
+    // Otherwise the smallest non-empty class above it, where any chunk fits.
+    if (!found && c + 1 < kNumSizeClasses) {
+        const uint32_t larger = mFreeClasses & ~((2u << c) - 1);
+        if (larger) {
+            found = mFreeLists[__builtin_ctz(larger)];
+        }
+    }
+    if (!found) {
+        return NO_MEMORY;
+    }
+
+    removeFree_l(found);
+    found = split_l(found, size, flags);
+    return (found->start)*kMemoryAlign;
+}
+
+SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::split_l(
+        chunk_t* chunk, size_t size, uint32_t flags)
+{
+    const size_t pagesize = getpagesize();
+    const size_t free_size = chunk->size;
+    size_t extra = 0;
+    if (flags & PAGE_ALIGNED)
+        extra = ( -chunk->start & ((pagesize/kMemoryAlign)-1) ) ;
+    chunk->free = 0;
+    chunk->size = size;
+    if (extra) {
+        chunk_t* split = new chunk_t(chunk->start, extra);
+        chunk->start += extra;
+        mList.insertBefore(chunk, split);
+        // the allocation moved, re-key it behind the new free chunk
+        mChunks.erase(split->start);
+        mChunks.emplace(split->start, split);
+        mChunks.emplace(chunk->start, chunk);
+        insertFree_l(split);
+    }
+    const size_t tail_free = free_size - (size+extra);
+    if (tail_free > 0) {
+        chunk_t* split = new chunk_t(chunk->start + chunk->size, tail_free);
+        mList.insertAfter(chunk, split);
+        mChunks.emplace(split->start, split);
+        insertFree_l(split);
+    }
+    return chunk;
+}
+
+SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::dealloc_segregated(size_t start)
+{
+    auto it = mChunks.find(start / kMemoryAlign);
+    if (it == mChunks.end()) {
+        return nullptr;
+    }
+    chunk_t* cur = it->second;
+    LOG_FATAL_IF(cur->free,
+        "block at offset 0x%08lX of size 0x%08lX already freed",
+        cur->start*kMemoryAlign, cur->size*kMemoryAlign);
+    cur->free = 1;
+
+    // merge with free neighbours, the list is ordered by address
+    chunk_t* const n = cur->next;
+    if (n && n->free) {
+        removeFree_l(n);
+        cur->size += n->size;
+        mChunks.erase(n->start);
+        mList.remove(n);
+        delete n;
+    }
+    chunk_t* const p = cur->prev;
+    if (p && p->free) {
+        removeFree_l(p);
+        p->size += cur->size;
+        mChunks.erase(cur->start);
+        mList.remove(cur);
+        delete cur;
+        cur = p;
+    }
+    insertFree_l(cur);
+    return cur;
+}
+
 void SimpleBestFitAllocator::dump(const char* what) const
 {
     Mutex::Autolock _l(mLock);
@@ -478,6 +645,25 @@ void SimpleBestFitAllocator::dump_l(String8& result,
     snprintf(buffer, SIZE,
             "  size allocated: %u (%u KB)\n", int(size), int(size/1024));
     result.append(buffer);
+
+    // fragmentation: how much of the free space is unusable for a single
+    // allocation of the total free size
+    size_t freeSize = 0;
+    size_t largestFree = 0;
+    size_t freeChunks = 0;
+    for (cur = mList.head(); cur; cur = cur->next) {
+        if (!cur->free) continue;
+        freeSize += cur->size*kMemoryAlign;
+        largestFree = std::max(largestFree, size_t(cur->size*kMemoryAlign));
+        freeChunks++;
+    }
+    const unsigned int fragmentation =
+            freeSize ? (unsigned int)(100 - largestFree * 100 / freeSize) : 0;
+    snprintf(buffer, SIZE,
+            "  %s: free %u KB in %u chunks, largest %u KB, fragmentation %u%%\n",
+            mPolicy == MemoryDealer::Policy::SEGREGATED_FIT ? "segregated fit" : "best fit",
+            int(freeSize/1024), int(freeChunks), int(largestFree/1024), fragmentation);
+    result.append(buffer);
 }
 
 
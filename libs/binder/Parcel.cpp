@@ -17,6 +17,7 @@
 #define LOG_TAG "Parcel"
 //#define LOG_NDEBUG 0
 
+#include <atomic>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
@@ -51,6 +52,12 @@
 #include <private/binder/binder_module.h>
 #include "Static.h"
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define LOG_REFS(...)
 //#define LOG_REFS(...) ALOG(LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 #define LOG_ALLOC(...)
@@ -84,8 +91,13 @@ static size_t gParcelGlobalAllocCount = 0;
 
 static size_t gMaxFds = 0;
 
-// Maximum size of a blob to transfer in-place.
+// Default maximum size of a blob to transfer in-place.
 static const size_t BLOB_INPLACE_LIMIT = 16 * 1024;
+static std::atomic<size_t> gBlobInplaceLimit = BLOB_INPLACE_LIMIT;
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
 
 enum {
     BLOB_INPLACE = 0,
@@ -93,6 +105,90 @@ enum {
     BLOB_ASHMEM_MUTABLE = 2,
 };
 
+// ASCII fast paths for the UTF-8 <-> UTF-16 string APIs. Most strings sent
+// through them (package names, tags, ...) are pure ASCII, which converts by
+// widening or narrowing each byte, 16 characters at a time where possible.
+
+// Length of the leading run of ASCII characters in |str|.
+static size_t asciiPrefixLength(const uint8_t* str, size_t len) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    for (; i + 16 <= len; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(str + i)) >= 0x80) break;
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        if (_mm_movemask_epi8(v) != 0) break;
+    }
+#else
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        if (word & 0x8080808080808080ull) break;
+    }
+#endif
+    while (i < len && str[i] < 0x80) i++;
+    return i;
+}
+
+static size_t asciiPrefixLength(const char16_t* str, size_t len) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    for (; i + 8 <= len; i += 8) {
+        if (vmaxvq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(str + i))) >= 0x80) break;
+    }
+#elif defined(__SSE2__)
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<int16_t>(0xff80));
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        if (_mm_movemask_epi8(_mm_and_si128(v, nonAscii)) != 0) break;
+    }
+#endif
+    while (i < len && str[i] < 0x80) i++;
+    return i;
+}
+
+// Converts |len| ASCII characters from |src| to UTF-16.
+static void widenAscii(const uint8_t* src, size_t len, char16_t* dst) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    uint16_t* out = reinterpret_cast<uint16_t*>(dst);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        vst1q_u16(out + i, vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(out + i + 8, vmovl_high_u8(v));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+#endif
+    for (; i < len; i++) dst[i] = src[i];
+}
+
+// Converts |len| ASCII characters from |src| to UTF-8.
+static void narrowAscii(const char16_t* src, size_t len, char* dst) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    const uint16_t* in = reinterpret_cast<const uint16_t*>(src);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vcombine_u8(vmovn_u16(vld1q_u16(in + i)), vmovn_u16(vld1q_u16(in + i + 8)));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), v);
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < len; i++) dst[i] = static_cast<char>(src[i]);
+}
+
 static void acquire_object(const sp<ProcessState>& proc,
     const flat_binder_object& obj, const void* who, size_t* outAshmemSize)
 {
@@ -742,7 +838,13 @@ restart_write:
 status_t Parcel::writeUtf8AsUtf16(const std::string& str) {
     const uint8_t* strData = (uint8_t*)str.data();
     const size_t strLen= str.length();
-    const ssize_t utf16Len = utf8_to_utf16_length(strData, strLen);
+    // An ASCII prefix maps one to one; only the rest needs a real conversion.
+    const size_t asciiLen = asciiPrefixLength(strData, strLen);
+    ssize_t utf16Len = asciiLen;
+    if (asciiLen < strLen) {
+        const ssize_t restLen = utf8_to_utf16_length(strData + asciiLen, strLen - asciiLen);
+        utf16Len = restLen < 0 ? restLen : utf16Len + restLen;
+    }
     if (utf16Len < 0 || utf16Len > std::numeric_limits<int32_t>::max()) {
         return BAD_VALUE;
     }
@@ -758,7 +860,14 @@ status_t Parcel::writeUtf8AsUtf16(const std::string& str) {
         return NO_MEMORY;
     }
 
-    utf8_to_utf16(strData, strLen, (char16_t*)dst, (size_t) utf16Len + 1);
+    char16_t* dst16 = reinterpret_cast<char16_t*>(dst);
+    widenAscii(strData, asciiLen, dst16);
+    if (asciiLen < strLen) {
+        utf8_to_utf16(strData + asciiLen, strLen - asciiLen, dst16 + asciiLen,
+                      (size_t) utf16Len - asciiLen + 1);
+    } else {
+        dst16[utf16Len] = 0;
+    }
 
     return NO_ERROR;
 }
@@ -1177,7 +1286,7 @@ status_t Parcel::writeBlob(size_t len, bool mutableCopy, WritableBlob* outBlob)
     }
 
     status_t status;
-    if (!mAllowFds || len <= BLOB_INPLACE_LIMIT) {
+    if (!mAllowFds || len <= gBlobInplaceLimit.load(std::memory_order_relaxed)) {
         ALOGV("writeBlob: write in place");
         status = writeInt32(BLOB_INPLACE);
         if (status) return status;
@@ -1189,6 +1298,9 @@ status_t Parcel::writeBlob(size_t len, bool mutableCopy, WritableBlob* outBlob)
         return NO_ERROR;
     }
 
+    status = writeMemfdBlob(len, mutableCopy, outBlob);
+    if (status != INVALID_OPERATION) return status;
+
     ALOGV("writeBlob: write to ashmem");
     int fd = ashmem_create_region("Parcel Blob", len);
     if (fd < 0) return NO_MEMORY;
@@ -1223,6 +1335,71 @@ status_t Parcel::writeBlob(size_t len, bool mutableCopy, WritableBlob* outBlob)
     return status;
 }
 
+status_t Parcel::writeMemfdBlob(size_t len, bool mutableCopy, WritableBlob* outBlob)
+{
+#if defined(__ANDROID__)
+    // A sealed memfd behaves like an ashmem blob for the receiver: it cannot
+    // shrink under an existing mapping, and for immutable blobs no new writable
+    // mapping can be created once the fd has left this process.
+    int fd = memfd_create("Parcel Blob", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        // Kernel without memfd support; let the caller fall back to ashmem.
+        return INVALID_OPERATION;
+    }
+
+    status_t status;
+    if (ftruncate(fd, len) < 0) {
+        status = -errno;
+        ::close(fd);
+        return status;
+    }
+
+    void* ptr = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        status = -errno;
+        ::close(fd);
+        return status;
+    }
+
+    int seals = F_SEAL_SHRINK | F_SEAL_GROW;
+    if (!mutableCopy) seals |= F_SEAL_FUTURE_WRITE | F_SEAL_SEAL;
+    if (fcntl(fd, F_ADD_SEALS, seals) < 0) {
+        // F_SEAL_FUTURE_WRITE needs a newer kernel than memfd itself.
+        ::munmap(ptr, len);
+        ::close(fd);
+        return INVALID_OPERATION;
+    }
+
+    ALOGV("writeBlob: write to memfd");
+    status = writeInt32(mutableCopy ? BLOB_ASHMEM_MUTABLE : BLOB_ASHMEM_IMMUTABLE);
+    if (!status) {
+        status = writeFileDescriptor(fd, true /*takeOwnership*/);
+        if (!status) {
+            outBlob->init(fd, ptr, len, mutableCopy);
+            return NO_ERROR;
+        }
+    }
+    ::munmap(ptr, len);
+    ::close(fd);
+    return status;
+#else
+    (void)len;
+    (void)mutableCopy;
+    (void)outBlob;
+    return INVALID_OPERATION;
+#endif
+}
+
+void Parcel::setBlobInplaceLimit(size_t limit)
+{
+    gBlobInplaceLimit.store(limit, std::memory_order_relaxed);
+}
+
+size_t Parcel::getBlobInplaceLimit()
+{
+    return gBlobInplaceLimit.load(std::memory_order_relaxed);
+}
+
 status_t Parcel::writeDupImmutableBlobFileDescriptor(int fd)
 {
     // Must match up with what's done in writeBlob.
@@ -1807,15 +1984,25 @@ status_t Parcel::readUtf8FromUtf16(std::string* str) const {
        return NO_ERROR;
     }
 
+    const size_t asciiSize = asciiPrefixLength(src, utf16Size);
+    if (asciiSize == utf16Size) {
+        str->resize(utf16Size);
+        narrowAscii(src, utf16Size, &((*str)[0]));
+        return NO_ERROR;
+    }
+
     // Allow for closing '\0'
-    ssize_t utf8Size = utf16_to_utf8_length(src, utf16Size) + 1;
-    if (utf8Size < 1) {
+    ssize_t restSize = utf16_to_utf8_length(src + asciiSize, utf16Size - asciiSize);
+    if (restSize < 0) {
         return BAD_VALUE;
     }
+    ssize_t utf8Size = asciiSize + restSize + 1;
     // Note that while it is probably safe to assume string::resize keeps a
     // spare byte around for the trailing null, we still pass the size including the trailing null
     str->resize(utf8Size);
-    utf16_to_utf8(src, utf16Size, &((*str)[0]), utf8Size);
+    narrowAscii(src, asciiSize, &((*str)[0]));
+    utf16_to_utf8(src + asciiSize, utf16Size - asciiSize, &((*str)[asciiSize]),
+                  utf8Size - asciiSize);
     str->resize(utf8Size - 1);
     return NO_ERROR;
 }
@@ -2131,14 +2318,34 @@ status_t Parcel::readBlob(size_t len, ReadableBlob* outBlob) const
     int fd = readFileDescriptor();
     if (fd == int(BAD_TYPE)) return BAD_VALUE;
 
-    if (!ashmem_valid(fd)) {
+    if (ashmem_valid(fd)) {
+        int size = ashmem_get_size_region(fd);
+        if (size < 0 || size_t(size) < len) {
+            ALOGE("request size %zu does not match fd size %d", len, size);
+            return BAD_VALUE;
+        }
+    } else {
+#if defined(__ANDROID__)
+        // Blobs larger than the in-place limit may also arrive as a sealed
+        // memfd; see writeMemfdBlob().
+        int seals = fcntl(fd, F_GET_SEALS);
+        if (seals < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW)) {
+            ALOGE("invalid fd");
+            return BAD_VALUE;
+        }
+        if (!isMutable && (seals & (F_SEAL_WRITE | F_SEAL_FUTURE_WRITE)) == 0) {
+            ALOGE("immutable blob fd is not write-sealed");
+            return BAD_VALUE;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size < 0 || size_t(st.st_size) < len) {
+            ALOGE("request size %zu does not match fd size", len);
+            return BAD_VALUE;
+        }
+#else
         ALOGE("invalid fd");
         return BAD_VALUE;
-    }
-    int size = ashmem_get_size_region(fd);
-    if (size < 0 || size_t(size) < len) {
-        ALOGE("request size %zu does not match fd size %d", len, size);
-        return BAD_VALUE;
+#endif
     }
     void* ptr = ::mmap(nullptr, len, isMutable ? PROT_READ | PROT_WRITE : PROT_READ,
             MAP_SHARED, fd, 0);
@@ -2429,7 +2636,11 @@ void Parcel::freeDataNoInit()
               gParcelGlobalAllocCount--;
             }
             pthread_mutex_unlock(&gParcelGlobalAllocSizeLock);
-            free(mData);
+            IPCThreadState* state = IPCThreadState::parcelBufferArenaEnabled()
+                    ? IPCThreadState::selfOrNull() : nullptr;
+            if (!state || !state->recycleParcelBuffer(mData, mDataCapacity)) {
+                free(mData);
+            }
         }
         if (mObjects) free(mObjects);
     }
@@ -2642,7 +2853,16 @@ status_t Parcel::continueWrite(size_t desired)
 
     } else {
         // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        IPCThreadState* state = IPCThreadState::parcelBufferArenaEnabled()
+                ? IPCThreadState::selfOrNull() : nullptr;
+        uint8_t* data;
+        if (state) {
+            // The arena may hand back more than we asked for, which saves
+            // the reallocs growData() would otherwise do.
+            data = state->acquireParcelBuffer(desired, &desired);
+        } else {
+            data = (uint8_t*)malloc(desired);
+        }
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
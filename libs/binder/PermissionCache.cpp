@@ -18,11 +18,15 @@
 
 #include <stdint.h>
 #include <utils/Log.h>
+#include <binder/ActivityManager.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
+#include <binder/IUidObserver.h>
 #include <binder/PermissionCache.h>
 #include <utils/String8.h>
 
+#include <string_view>
+
 namespace android {
 
 // ----------------------------------------------------------------------------
@@ -31,47 +35,103 @@ ANDROID_SINGLETON_STATIC_INSTANCE(PermissionCache) ;
 
 // ----------------------------------------------------------------------------
 
-PermissionCache::PermissionCache() {
+namespace {
+
+class UidInvalidator : public BnUidObserver {
+public:
+    void onUidGone(uid_t uid, bool /*disabled*/) override {
+        PermissionCache::invalidateUid(uid);
+    }
+    void onUidActive(uid_t /*uid*/) override {}
+    void onUidIdle(uid_t /*uid*/, bool /*disabled*/) override {}
+    void onUidStateChanged(uid_t /*uid*/, int32_t /*procState*/, int64_t /*procStateSeq*/,
+            int32_t /*capability*/) override {}
+};
+
+} // namespace
+
+PermissionCache::PermissionCache() : mTimeToLive(0) {
+    for (Shard& shard : mShards) {
+        shard.entries = std::make_shared<const Map>();
+    }
+}
+
+PermissionCache::Shard& PermissionCache::shardFor(const String16& permission, uid_t uid) {
+    const size_t hash = std::hash<std::u16string_view>()(
+            std::u16string_view(permission.string(), permission.size()));
+    return mShards[(hash * 31 + uid) % kNumShards];
 }
 
 status_t PermissionCache::check(bool* granted,
-        const String16& permission, uid_t uid) const {
-    Mutex::Autolock _l(mLock);
-    Entry e;
-    e.name = permission;
-    e.uid  = uid;
-    ssize_t index = mCache.indexOf(e);
-    if (index >= 0) {
-        *granted = mCache.itemAt(index).granted;
-        return NO_ERROR;
+        const String16& permission, uid_t uid) {
+    std::shared_ptr<const Map> entries = std::atomic_load(&shardFor(permission, uid).entries);
+    auto it = entries->find(Key(uid, permission));
+    if (it == entries->end()) {
+        return NAME_NOT_FOUND;
+    }
+    if (it->second.expiresAt != 0 && systemTime() >= it->second.expiresAt) {
+        return NAME_NOT_FOUND;
     }
-    return NAME_NOT_FOUND;
+    *granted = it->second.granted;
+    return NO_ERROR;
 }
 
 void PermissionCache::cache(const String16& permission,
         uid_t uid, bool granted) {
-    Mutex::Autolock _l(mLock);
-    Entry e;
-    ssize_t index = mPermissionNamesPool.indexOf(permission);
-    if (index > 0) {
-        e.name = mPermissionNamesPool.itemAt(index);
-    } else {
-        mPermissionNamesPool.add(permission);
-        e.name = permission;
-    }
     // note, we don't need to store the pid, which is not actually used in
     // permission checks
-    e.uid  = uid;
-    e.granted = granted;
-    index = mCache.indexOf(e);
-    if (index < 0) {
-        mCache.add(e);
+    const nsecs_t ttl = mTimeToLive.load(std::memory_order_relaxed);
+    const Entry e = { granted, ttl > 0 ? systemTime() + ttl : 0 };
+
+    Shard& shard = shardFor(permission, uid);
+    Mutex::Autolock _l(shard.writeLock);
+    auto entries = std::make_shared<Map>(*shard.entries);
+    // String16 shares its buffer on copy, so repeated names cost no extra
+    // storage.
+    (*entries)[Key(uid, permission)] = e;
+    std::atomic_store(&shard.entries, std::shared_ptr<const Map>(std::move(entries)));
+}
+
+void PermissionCache::invalidate(uid_t uid) {
+    for (Shard& shard : mShards) {
+        Mutex::Autolock _l(shard.writeLock);
+        auto first = shard.entries->lower_bound(Key(uid, String16()));
+        if (first == shard.entries->end() || first->first.first != uid) {
+            continue;
+        }
+        auto entries = std::make_shared<Map>(*shard.entries);
+        auto it = entries->lower_bound(Key(uid, String16()));
+        while (it != entries->end() && it->first.first == uid) {
+            it = entries->erase(it);
+        }
+        std::atomic_store(&shard.entries, std::shared_ptr<const Map>(std::move(entries)));
     }
 }
 
 void PermissionCache::purge() {
-    Mutex::Autolock _l(mLock);
-    mCache.clear();
+    for (Shard& shard : mShards) {
+        Mutex::Autolock _l(shard.writeLock);
+        std::atomic_store(&shard.entries, std::make_shared<const Map>());
+    }
+}
+
+void PermissionCache::setTimeToLive(nsecs_t ttl) {
+    PermissionCache::getInstance().mTimeToLive.store(ttl, std::memory_order_relaxed);
+}
+
+void PermissionCache::invalidateUid(uid_t uid) {
+    PermissionCache::getInstance().invalidate(uid);
+}
+
+void PermissionCache::purgeAll() {
+    PermissionCache::getInstance().purge();
+}
+
+void PermissionCache::registerUidObserver(const String16& callingPackage) {
+    static sp<IUidObserver>* sObserver = new sp<IUidObserver>(new UidInvalidator());
+    ActivityManager am;
+    am.registerUidObserver(*sObserver, ActivityManager::UID_OBSERVER_GONE,
+            ActivityManager::PROCESS_STATE_UNKNOWN, callingPackage);
 }
 
 bool PermissionCache::checkCallingPermission(const String16& permission) {
@@ -18,7 +18,9 @@
 
 #include <binder/PersistableBundle.h>
 
+#include <atomic>
 #include <limits>
+#include <mutex>
 
 #include <binder/IBinder.h>
 #include <binder/Parcel.h>
@@ -46,6 +48,67 @@ enum {
 };
 
 namespace {
+std::atomic_bool gLazyUnparceling(false);
+
+// Moves the parcel past an array of |elementSize| byte elements.
+status_t skipArray(const Parcel* parcel, size_t elementSize) {
+    int32_t count;
+    status_t err = parcel->readInt32(&count);
+    if (err != NO_ERROR) return err;
+    if (count < 0) return NO_ERROR;  // null, rejected when decoded
+    if (static_cast<size_t>(count) > parcel->dataAvail() / elementSize) return BAD_VALUE;
+    parcel->setDataPosition(parcel->dataPosition() + count * elementSize);
+    return NO_ERROR;
+}
+
+// Moves the parcel past a value of the given type without decoding it.
+status_t skipValue(const Parcel* parcel, int32_t type) {
+    size_t len;
+    int32_t scratch;
+    switch (type) {
+        case VAL_STRING:
+            // like readString16(), null strings are an error
+            return parcel->readString16Inplace(&len) != nullptr ? NO_ERROR : UNEXPECTED_NULL;
+        case VAL_INTEGER:
+        case VAL_BOOLEAN:
+            return parcel->readInt32(&scratch);
+        case VAL_LONG:
+        case VAL_DOUBLE:
+            if (parcel->dataAvail() < sizeof(int64_t)) return BAD_VALUE;
+            parcel->setDataPosition(parcel->dataPosition() + sizeof(int64_t));
+            return NO_ERROR;
+        case VAL_INTARRAY:
+        case VAL_BOOLEANARRAY:
+            return skipArray(parcel, sizeof(int32_t));
+        case VAL_LONGARRAY:
+        case VAL_DOUBLEARRAY:
+            return skipArray(parcel, sizeof(int64_t));
+        case VAL_STRINGARRAY: {
+            int32_t count;
+            status_t err = parcel->readInt32(&count);
+            if (err != NO_ERROR) return err;
+            for (; count > 0; --count) {
+                if (parcel->readString16Inplace(&len) == nullptr) return UNEXPECTED_NULL;
+            }
+            return NO_ERROR;
+        }
+        case VAL_PERSISTABLEBUNDLE: {
+            int32_t length;
+            status_t err = parcel->readInt32(&length);
+            if (err != NO_ERROR) return err;
+            if (length < 0) return UNEXPECTED_NULL;
+            if (length == 0) return NO_ERROR;
+            // magic, then |length| bytes of entries
+            if (parcel->dataAvail() < sizeof(int32_t) + length) return BAD_VALUE;
+            parcel->setDataPosition(parcel->dataPosition() + sizeof(int32_t) + length);
+            return NO_ERROR;
+        }
+        default:
+            ALOGE("Unrecognized type: %d", type);
+            return BAD_TYPE;
+    }
+}
+
 template <typename T>
 bool getValue(const android::String16& key, T* out, const map<android::String16, T>& map) {
     const auto& it = map.find(key);
@@ -87,12 +150,59 @@ namespace os {
          }                                                               \
     }
 
+struct PersistableBundle::LazyData {
+    struct Entry {
+        int32_t type;
+        // position of the value in |parcel|
+        size_t offset;
+    };
+
+    int32_t magic;
+    // The entries exactly as received, starting with their count.
+    Parcel parcel;
+    std::map<String16, Entry> index;
+    // Reading moves the data position of |parcel|.
+    mutable std::mutex lock;
+};
+
+template <typename T, typename Reader>
+bool PersistableBundle::getLazyValue(const String16& key, int32_t type, T* out,
+                                     Reader read) const {
+    const auto& it = mLazy->index.find(key);
+    if (it == mLazy->index.end() || it->second.type != type) return false;
+
+    std::lock_guard<std::mutex> lock(mLazy->lock);
+    mLazy->parcel.setDataPosition(it->second.offset);
+    return read(mLazy->parcel, out) == NO_ERROR;
+}
+
+set<String16> PersistableBundle::getLazyKeys(int32_t type) const {
+    set<String16> keys;
+    for (const auto& [key, entry] : mLazy->index) {
+        if (entry.type == type) keys.emplace(key);
+    }
+    return keys;
+}
+
+void PersistableBundle::setLazyUnparcelingEnabled(bool enabled) {
+    gLazyUnparceling.store(enabled, std::memory_order_relaxed);
+}
+
 status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
     /*
      * Keep implementation in sync with writeToParcelInner() in
      * frameworks/base/core/java/android/os/BaseBundle.java.
      */
 
+    // Never decoded or modified, forward the original bytes.
+    if (mLazy != nullptr) {
+        const size_t length = mLazy->parcel.dataSize();
+        RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(length)));
+        RETURN_IF_FAILED(parcel->writeInt32(mLazy->magic));
+        RETURN_IF_FAILED(parcel->write(mLazy->parcel.data(), length));
+        return NO_ERROR;
+    }
+
     // Special case for empty bundles.
     if (empty()) {
         RETURN_IF_FAILED(parcel->writeInt32(0));
@@ -138,6 +248,7 @@ bool PersistableBundle::empty() const {
 }
 
 size_t PersistableBundle::size() const {
+    if (mLazy != nullptr) return mLazy->index.size();
     return (mBoolMap.size() +
             mIntMap.size() +
             mLongMap.size() +
@@ -152,6 +263,7 @@ size_t PersistableBundle::size() const {
 }
 
 size_t PersistableBundle::erase(const String16& key) {
+    materialize();
     RETURN_IF_ENTRY_ERASED(mBoolMap, key);
     RETURN_IF_ENTRY_ERASED(mIntMap, key);
     RETURN_IF_ENTRY_ERASED(mLongMap, key);
@@ -221,90 +333,148 @@ void PersistableBundle::putPersistableBundle(const String16& key, const Persista
 }
 
 bool PersistableBundle::getBoolean(const String16& key, bool* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_BOOLEAN, out,
+                            [](const Parcel& p, bool* v) { return p.readBool(v); });
+    }
     return getValue(key, out, mBoolMap);
 }
 
 bool PersistableBundle::getInt(const String16& key, int32_t* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_INTEGER, out,
+                            [](const Parcel& p, int32_t* v) { return p.readInt32(v); });
+    }
     return getValue(key, out, mIntMap);
 }
 
 bool PersistableBundle::getLong(const String16& key, int64_t* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_LONG, out,
+                            [](const Parcel& p, int64_t* v) { return p.readInt64(v); });
+    }
     return getValue(key, out, mLongMap);
 }
 
 bool PersistableBundle::getDouble(const String16& key, double* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_DOUBLE, out,
+                            [](const Parcel& p, double* v) { return p.readDouble(v); });
+    }
     return getValue(key, out, mDoubleMap);
 }
 
 bool PersistableBundle::getString(const String16& key, String16* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_STRING, out,
+                            [](const Parcel& p, String16* v) { return p.readString16(v); });
+    }
     return getValue(key, out, mStringMap);
 }
 
 bool PersistableBundle::getBooleanVector(const String16& key, vector<bool>* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_BOOLEANARRAY, out,
+                            [](const Parcel& p, vector<bool>* v) { return p.readBoolVector(v); });
+    }
     return getValue(key, out, mBoolVectorMap);
 }
 
 bool PersistableBundle::getIntVector(const String16& key, vector<int32_t>* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_INTARRAY, out,
+                            [](const Parcel& p, vector<int32_t>* v) { return p.readInt32Vector(v); });
+    }
     return getValue(key, out, mIntVectorMap);
 }
 
 bool PersistableBundle::getLongVector(const String16& key, vector<int64_t>* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_LONGARRAY, out,
+                            [](const Parcel& p, vector<int64_t>* v) { return p.readInt64Vector(v); });
+    }
     return getValue(key, out, mLongVectorMap);
 }
 
 bool PersistableBundle::getDoubleVector(const String16& key, vector<double>* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_DOUBLEARRAY, out,
+                            [](const Parcel& p, vector<double>* v) { return p.readDoubleVector(v); });
+    }
     return getValue(key, out, mDoubleVectorMap);
 }
 
 bool PersistableBundle::getStringVector(const String16& key, vector<String16>* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_STRINGARRAY, out,
+                            [](const Parcel& p, vector<String16>* v) { return p.readString16Vector(v); });
+    }
     return getValue(key, out, mStringVectorMap);
 }
 
 bool PersistableBundle::getPersistableBundle(const String16& key, PersistableBundle* out) const {
+    if (mLazy != nullptr) {
+        return getLazyValue(key, VAL_PERSISTABLEBUNDLE, out,
+                            [](const Parcel& p, PersistableBundle* v) {
+                                *v = PersistableBundle();
+                                return v->readFromParcel(&p);
+                            });
+    }
     return getValue(key, out, mPersistableBundleMap);
 }
 
 set<String16> PersistableBundle::getBooleanKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_BOOLEAN);
     return getKeys(mBoolMap);
 }
 
 set<String16> PersistableBundle::getIntKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_INTEGER);
     return getKeys(mIntMap);
 }
 
 set<String16> PersistableBundle::getLongKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_LONG);
     return getKeys(mLongMap);
 }
 
 set<String16> PersistableBundle::getDoubleKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_DOUBLE);
     return getKeys(mDoubleMap);
 }
 
 set<String16> PersistableBundle::getStringKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_STRING);
     return getKeys(mStringMap);
 }
 
 set<String16> PersistableBundle::getBooleanVectorKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_BOOLEANARRAY);
     return getKeys(mBoolVectorMap);
 }
 
 set<String16> PersistableBundle::getIntVectorKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_INTARRAY);
     return getKeys(mIntVectorMap);
 }
 
 set<String16> PersistableBundle::getLongVectorKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_LONGARRAY);
     return getKeys(mLongVectorMap);
 }
 
 set<String16> PersistableBundle::getDoubleVectorKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_DOUBLEARRAY);
     return getKeys(mDoubleVectorMap);
 }
 
 set<String16> PersistableBundle::getStringVectorKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_STRINGARRAY);
     return getKeys(mStringVectorMap);
 }
 
 set<String16> PersistableBundle::getPersistableBundleKeys() const {
+    if (mLazy != nullptr) return getLazyKeys(VAL_PERSISTABLEBUNDLE);
     return getKeys(mPersistableBundleMap);
 }
 
@@ -392,13 +562,20 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
         return NO_ERROR;
     }
 
+    if (gLazyUnparceling.load(std::memory_order_relaxed) && mLazy == nullptr && empty()) {
+        return readLazily(parcel, length);
+    }
+
     int32_t magic;
     RETURN_IF_FAILED(parcel->readInt32(&magic));
     if (magic != BUNDLE_MAGIC && magic != BUNDLE_MAGIC_NATIVE) {
         ALOGE("Bad magic number for PersistableBundle: 0x%08x", magic);
         return BAD_VALUE;
     }
+    return readEntries(parcel);
+}
 
+status_t PersistableBundle::readEntries(const Parcel* parcel) {
     /*
      * To keep this implementation in sync with unparcel() in
      * frameworks/base/core/java/android/os/BaseBundle.java, the number of
@@ -474,6 +651,55 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
     return NO_ERROR;
 }
 
+status_t PersistableBundle::readLazily(const Parcel* parcel, size_t length) {
+    auto lazy = std::make_shared<LazyData>();
+    RETURN_IF_FAILED(parcel->readInt32(&lazy->magic));
+    if (lazy->magic != BUNDLE_MAGIC && lazy->magic != BUNDLE_MAGIC_NATIVE) {
+        ALOGE("Bad magic number for PersistableBundle: 0x%08x", lazy->magic);
+        return BAD_VALUE;
+    }
+    if (length > parcel->dataAvail()) {
+        ALOGE("Bad length in parcel: %zu", length);
+        return BAD_VALUE;
+    }
+    const void* data = parcel->readInplace(length);
+    if (data == nullptr) return BAD_VALUE;
+    RETURN_IF_FAILED(lazy->parcel.setData(static_cast<const uint8_t*>(data), length));
+
+    // Index the keys, skipping over the values. This validates the layout as
+    // far as it can without decoding, so corrupt bundles still fail here.
+    const Parcel* entries = &lazy->parcel;
+    int32_t num_entries;
+    RETURN_IF_FAILED(entries->readInt32(&num_entries));
+    for (; num_entries > 0; --num_entries) {
+        String16 key;
+        int32_t value_type;
+        RETURN_IF_FAILED(entries->readString16(&key));
+        RETURN_IF_FAILED(entries->readInt32(&value_type));
+        lazy->index[key] = {value_type, entries->dataPosition()};
+        RETURN_IF_FAILED(skipValue(entries, value_type));
+    }
+
+    mLazy = std::move(lazy);
+    return NO_ERROR;
+}
+
+void PersistableBundle::materialize() {
+    if (mLazy == nullptr) return;
+    std::shared_ptr<const LazyData> lazy = std::move(mLazy);
+
+    std::lock_guard<std::mutex> lock(lazy->lock);
+    lazy->parcel.setDataPosition(0);
+    status_t err = readEntries(&lazy->parcel);
+    ALOGE_IF(err != NO_ERROR, "Failed to decode lazily read PersistableBundle: %d", err);
+}
+
+PersistableBundle PersistableBundle::materialized(const PersistableBundle& bundle) {
+    PersistableBundle copy(bundle);
+    copy.materialize();
+    return copy;
+}
+
 }  // namespace os
 
 }  // namespace android
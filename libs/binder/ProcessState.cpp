@@ -18,11 +18,13 @@
 
 #include <binder/ProcessState.h>
 
+#include <binder/BinderStats.h>
 #include <binder/BpBinder.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
 #include <binder/Stability.h>
 #include <cutils/atomic.h>
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
 #include <utils/threads.h>
@@ -30,8 +32,10 @@
 #include <private/binder/binder_module.h>
 #include "Static.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -325,19 +329,117 @@ void ProcessState::spawnPooledThread(bool isMain)
         sp<Thread> t = new PoolThread(isMain);
         t->run(name.string());
     }
+    if (!isMain) {
+        pthread_mutex_lock(&mThreadCountLock);
+        mSpawnEvents++;
+        pthread_mutex_unlock(&mThreadCountLock);
+    }
 }
 
 status_t ProcessState::setThreadPoolMaxThreadCount(size_t maxThreads) {
-    status_t result = NO_ERROR;
-    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &maxThreads) != -1) {
-        mMaxThreads = maxThreads;
-    } else {
-        result = -errno;
-        ALOGE("Binder ioctl to set max threads failed: %s", strerror(-result));
+    pthread_mutex_lock(&mThreadCountLock);
+    const size_t previous = mMaxThreads;
+    mMaxThreads = maxThreads;
+    status_t result = updateDriverMaxThreadsLocked();
+    if (result != NO_ERROR) mMaxThreads = previous;
+    pthread_mutex_unlock(&mThreadCountLock);
+    return result;
+}
+
+status_t ProcessState::setThreadPoolAdaptive(size_t minThreads, size_t maxThreads,
+                                             int64_t targetWaitMs, int64_t idleTimeoutMs) {
+    if (minThreads > maxThreads || maxThreads == 0 || targetWaitMs < 0 || idleTimeoutMs < 0) {
+        return BAD_VALUE;
+    }
+
+    pthread_mutex_lock(&mThreadCountLock);
+    mAdaptiveMinThreads = minThreads;
+    mAdaptiveMaxThreads = maxThreads;
+    mAdaptiveTargetWaitMs = targetWaitMs;
+    mAdaptiveIdleTimeoutMs = idleTimeoutMs;
+    // Start from the current limit, clamped to the new range.
+    const size_t previous = mMaxThreads;
+    mMaxThreads = std::min(std::max(mMaxThreads, minThreads), maxThreads);
+    mAdaptiveBaseThreads = mMaxThreads;
+    status_t result = updateDriverMaxThreadsLocked();
+    if (result != NO_ERROR) {
+        mMaxThreads = previous;
+        mAdaptiveMaxThreads = 0;
     }
+    pthread_mutex_unlock(&mThreadCountLock);
     return result;
 }
 
+ProcessState::ThreadPoolStats ProcessState::getThreadPoolStats() {
+    pthread_mutex_lock(&mThreadCountLock);
+    ThreadPoolStats stats = {
+        .maxThreads = mMaxThreads,
+        .pooledThreads = mPooledThreadsCount,
+        .executingThreads = mExecutingThreadsCount,
+        .spawnEvents = mSpawnEvents,
+        .growEvents = mGrowEvents,
+        .retiredThreads = mRetiredThreadsCount,
+        .starvationEvents = mStarvationEvents,
+        .totalStarvationMs = mTotalStarvationMs,
+        .maxStarvationMs = mMaxStarvationMs,
+    };
+    pthread_mutex_unlock(&mThreadCountLock);
+    return stats;
+}
+
+status_t ProcessState::updateDriverMaxThreadsLocked() {
+    // The driver counts every looper it ever asked for against the limit,
+    // including ones that have since exited, so retired loopers are added
+    // back to keep the effective limit at mMaxThreads.
+    size_t driverMaxThreads = mMaxThreads + mRetiredThreadsCount;
+    if (ioctl(mDriverFD, BINDER_SET_MAX_THREADS, &driverMaxThreads) == -1) {
+        status_t result = -errno;
+        ALOGE("Binder ioctl to set max threads failed: %s", strerror(-result));
+        return result;
+    }
+    return NO_ERROR;
+}
+
+void ProcessState::noteStarvationLocked(int64_t starvationTimeMs) {
+    mStarvationEvents++;
+    mTotalStarvationMs += starvationTimeMs;
+    mMaxStarvationMs = std::max(mMaxStarvationMs, starvationTimeMs);
+
+    if (mAdaptiveMaxThreads == 0 || starvationTimeMs <= mAdaptiveTargetWaitMs ||
+            mMaxThreads >= mAdaptiveMaxThreads) {
+        return;
+    }
+    mMaxThreads++;
+    if (updateDriverMaxThreadsLocked() != NO_ERROR) {
+        mMaxThreads--;
+        return;
+    }
+    mGrowEvents++;
+    ALOGI("binder thread pool starved for %" PRId64 " ms, raised limit to %zu threads",
+          starvationTimeMs, mMaxThreads);
+}
+
+bool ProcessState::retireIdlePooledThread() {
+    pthread_mutex_lock(&mThreadCountLock);
+    bool retire = mAdaptiveMaxThreads != 0 && mPooledThreadsCount > mAdaptiveMinThreads;
+    if (retire) {
+        mPooledThreadsCount--;
+        mRetiredThreadsCount++;
+        // Let the limit decay back towards where it started as demand drops.
+        if (mMaxThreads > mAdaptiveBaseThreads) mMaxThreads--;
+        updateDriverMaxThreadsLocked();
+    }
+    pthread_mutex_unlock(&mThreadCountLock);
+    return retire;
+}
+
+int64_t ProcessState::threadPoolIdleTimeoutMs() {
+    pthread_mutex_lock(&mThreadCountLock);
+    int64_t timeoutMs = mAdaptiveMaxThreads != 0 ? mAdaptiveIdleTimeoutMs : 0;
+    pthread_mutex_unlock(&mThreadCountLock);
+    return timeoutMs;
+}
+
 void ProcessState::giveThreadPoolName() {
     androidSetThreadName( makeBinderThreadName().string() );
 }
@@ -383,6 +485,18 @@ ProcessState::ProcessState(const char *driver)
     , mExecutingThreadsCount(0)
     , mMaxThreads(DEFAULT_MAX_BINDER_THREADS)
     , mStarvationStartTimeMs(0)
+    , mAdaptiveMinThreads(0)
+    , mAdaptiveBaseThreads(0)
+    , mAdaptiveMaxThreads(0)
+    , mAdaptiveTargetWaitMs(0)
+    , mAdaptiveIdleTimeoutMs(0)
+    , mPooledThreadsCount(0)
+    , mSpawnEvents(0)
+    , mGrowEvents(0)
+    , mRetiredThreadsCount(0)
+    , mStarvationEvents(0)
+    , mTotalStarvationMs(0)
+    , mMaxStarvationMs(0)
     , mBinderContextCheckFunc(nullptr)
     , mBinderContextUserData(nullptr)
     , mThreadPoolStarted(false)
@@ -410,6 +524,10 @@ ProcessState::ProcessState(const char *driver)
 #ifdef __ANDROID__
     LOG_ALWAYS_FATAL_IF(mDriverFD < 0, "Binder driver '%s' could not be opened.  Terminating.", driver);
 #endif
+
+    if (property_get_bool("debug.binder.stats", false)) {
+        BinderStats::setEnabled(true);
+    }
 }
 
 ProcessState::~ProcessState()
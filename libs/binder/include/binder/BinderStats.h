@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/String16.h>
+#include <utils/Timers.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace android {
+
+class BBinder;
+class BpBinder;
+
+// Optional per-interface, per-transaction-code latency and payload size
+// histograms for this process. Samples are recorded into per-thread shards
+// without taking locks; a snapshot merges all shards.
+//
+// Use `dumpsys --binder-stats SERVICE` to print the histograms of the process
+// hosting SERVICE, or snapshot() to export them (e.g. from a statsd puller).
+class BinderStats final {
+public:
+    // Bucket i counts samples in [2^(i-1), 2^i), bucket 0 counts zero. Latency
+    // is in microseconds, payload size in bytes.
+    static constexpr size_t kNumBuckets = 32;
+
+    enum class Direction : uint8_t {
+        INCOMING, // BBinder::transact
+        OUTGOING, // BpBinder::transact
+    };
+
+    struct Entry {
+        Direction direction;
+        // Interface descriptor for incoming calls; for outgoing calls the
+        // descriptor if the proxy already has it cached, else "handle N".
+        String16 interface;
+        uint32_t code;
+        uint64_t count;
+        uint64_t latencyUs[kNumBuckets];
+        uint64_t sizeBytes[kNumBuckets];
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    // Merged view of all threads, sorted by direction, interface and code.
+    static std::vector<Entry> snapshot();
+    // Clears all recorded samples.
+    static void reset();
+    // Human-readable form of snapshot(), one line per entry with p50/p90/p99
+    // and max bucket upper bounds.
+    static void dump(std::string* out);
+
+private:
+    friend BBinder;
+    friend BpBinder;
+
+    static void recordIncoming(const BBinder* binder, uint32_t code, nsecs_t latency,
+                               size_t size);
+    static void recordOutgoing(const BpBinder* proxy, int32_t handle, uint32_t code,
+                               nsecs_t latency, size_t size);
+
+    static std::atomic_bool sEnabled;
+};
+
+} // namespace android
@@ -27,6 +27,8 @@
 // ---------------------------------------------------------------------------
 namespace android {
 
+class BinderStats;
+
 namespace internal {
 class Stability;
 };
@@ -121,6 +123,8 @@ private:
     const   int32_t             mHandle;
 
     friend ::android::internal::Stability;
+    // to read the descriptor cache without transacting
+    friend ::android::BinderStats;
             int32_t             mStability;
 
     struct Obituary {
@@ -60,6 +60,7 @@ public:
         SYSPROPS_TRANSACTION    = B_PACK_CHARS('_', 'S', 'P', 'R'),
         EXTENSION_TRANSACTION   = B_PACK_CHARS('_', 'E', 'X', 'T'),
         DEBUG_PID_TRANSACTION   = B_PACK_CHARS('_', 'P', 'I', 'D'),
+        DEBUG_STATS_TRANSACTION = B_PACK_CHARS('_', 'S', 'T', 'S'),
 
         // Corresponds to TF_ONE_WAY -- an asynchronous call.
         FLAG_ONEWAY             = 0x00000001,
@@ -139,6 +140,12 @@ public:
      */
     status_t                getDebugPid(pid_t* outPid);
 
+    /**
+     * Dump the binder transaction latency and size histograms of the process
+     * hosting this binder, for debugging. See BinderStats.
+     */
+    status_t                getDebugBinderStats(String16* outStats);
+
     // NOLINTNEXTLINE(google-default-arguments)
     virtual status_t        transact(   uint32_t code,
                                         const Parcel& data,
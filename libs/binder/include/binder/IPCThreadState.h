@@ -22,6 +22,9 @@
 #include <binder/ProcessState.h>
 #include <utils/Vector.h>
 
+#include <memory>
+#include <vector>
+
 #if defined(_WIN32)
 typedef  int  uid_t;
 #endif
@@ -102,6 +105,20 @@ public:
                                          uint32_t code, const Parcel& data,
                                          Parcel* reply, uint32_t flags);
 
+            // Oneway batching. Between beginOnewayBatch() and the matching
+            // flushOnewayBatch(), oneway transactions made from this thread are
+            // queued locally and then submitted to the driver together in a
+            // single BINDER_WRITE_READ, in the order they were made. The data of
+            // each transaction is copied, so callers may free it immediately.
+            //
+            // Any two-way transaction or reply sent from this thread flushes the
+            // batch first. Calls nest; only the outermost flush submits.
+            //
+            // flushOnewayBatch() returns the first error reported for a queued
+            // transaction, or NO_ERROR.
+            void                beginOnewayBatch();
+            status_t            flushOnewayBatch();
+
             void                incStrongHandle(int32_t handle, BpBinder *proxy);
             void                decStrongHandle(int32_t handle);
             void                incWeakHandle(int32_t handle, BpBinder *proxy);
@@ -123,6 +140,23 @@ public:
     static  void                disableBackgroundScheduling(bool disable);
             bool                backgroundSchedulingDisabled();
 
+    // Opt-in, process-wide switch for recycling Parcel data buffers through a
+    // small per-thread arena owned by each IPCThreadState. When enabled, Parcels
+    // created on a binder thread get pre-sized buffers from the arena and hand
+    // them back when they are freed, instead of going through malloc/realloc on
+    // every transaction.
+    static  void                setParcelBufferArenaEnabled(bool enabled);
+    static  bool                parcelBufferArenaEnabled();
+
+    struct ParcelBufferArenaStats {
+        uint64_t hits;      // buffers served from an arena
+        uint64_t misses;    // buffers freshly allocated by an arena
+        uint64_t recycled;  // buffers returned to an arena
+        uint64_t discarded; // buffers too large, or arena full, and freed
+    };
+    // Process-wide counters, summed over all threads. Intended for dump().
+    static  ParcelBufferArenaStats getParcelBufferArenaStats();
+
             // Call blocks until the number of executing binder threads is less than
             // the maximum number of binder threads threads allowed for this process.
             void                blockUntilThreadAvailable();
@@ -145,9 +179,17 @@ public:
             static const int32_t kUnsetWorkSource = -1;
 
 private:
+    friend class Parcel;
+
                                 IPCThreadState();
                                 ~IPCThreadState();
 
+            // Used by Parcel when the buffer arena is enabled. acquire returns
+            // nullptr on allocation failure; recycle returns false if the
+            // buffer was not kept and must be freed by the caller.
+            uint8_t*            acquireParcelBuffer(size_t desired, size_t* outCapacity);
+            bool                recycleParcelBuffer(uint8_t* data, size_t capacity);
+
             status_t            sendReply(const Parcel& reply, uint32_t flags);
             status_t            waitForResponse(Parcel *reply,
                                                 status_t *acquireResult=nullptr);
@@ -158,7 +200,9 @@ private:
                                                      uint32_t code,
                                                      const Parcel& data,
                                                      status_t* statusBuffer);
+            status_t            submitOnewayBatch();
             status_t            getAndExecuteCommand();
+            bool                idleTimedOut();
             status_t            executeCommand(int32_t command);
             void                processPendingDerefs();
             void                processPostWriteDerefs();
@@ -176,6 +220,16 @@ private:
             Vector<RefBase::weakref_type*> mPendingWeakDerefs;
             Vector<RefBase*>    mPostWriteStrongDerefs;
             Vector<RefBase::weakref_type*> mPostWriteWeakDerefs;
+    static constexpr size_t kParcelBufferArenaSlots = 8;
+            struct ParcelBufferSlot {
+                uint8_t* data;
+                size_t capacity;
+            };
+            ParcelBufferSlot    mParcelBuffers[kParcelBufferArenaSlots];
+            size_t              mParcelBufferCount;
+            // Set once the destructor has run, so that the Parcels below (which
+            // are destroyed after it) do not hand buffers back to a dead arena.
+            bool                mParcelBufferArenaClosed;
             Parcel              mIn;
             Parcel              mOut;
             status_t            mLastError;
@@ -192,6 +246,10 @@ private:
             int32_t             mLastTransactionBinderFlags;
 
             ProcessState::CallRestriction mCallRestriction;
+
+            size_t              mOnewayBatchDepth;
+            size_t              mOnewayBatchCount;
+            std::vector<std::unique_ptr<Parcel>> mOnewayBatch;
 };
 
 } // namespace android
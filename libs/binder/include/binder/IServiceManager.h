@@ -96,10 +96,31 @@ public:
      * service.
      */
     virtual bool isDeclared(const String16& name) = 0;
+
+    /**
+     * Retrieve several services at once. Equivalent to calling getService()
+     * on each name, but resolved in a single round trip where supported.
+     * The result has one entry per name, null where a service is unavailable.
+     */
+    virtual Vector<sp<IBinder>> getServices(const Vector<String16>& names);
 };
 
 sp<IServiceManager> defaultServiceManager();
 
+/**
+ * Counters for the process-local service lookup cache used by
+ * defaultServiceManager() for checkService()/getService()/waitForService().
+ * Intended for services to include in their dump().
+ */
+struct ServiceCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    // Cached entries dropped by a death notification or replaced because the
+    // name was registered again.
+    uint64_t invalidations;
+};
+ServiceCacheStats getServiceCacheStats();
+
 /**
  * Directly set the default service manager. Only used for testing.
  * Note that the caller is responsible for caling this method
@@ -34,8 +34,18 @@ class SimpleBestFitAllocator;
 class MemoryDealer : public RefBase
 {
 public:
+    enum class Policy {
+        // Address-ordered list searched in full on every allocation.
+        BEST_FIT,
+        // Free chunks are also kept in power-of-two size classes, making
+        // allocate() O(1) and deallocate() O(log n). Better suited to many
+        // small, short-lived allocations out of one heap.
+        SEGREGATED_FIT,
+    };
+
     explicit MemoryDealer(size_t size, const char* name = nullptr,
             uint32_t flags = 0 /* or bits such as MemoryHeapBase::READ_ONLY */ );
+    MemoryDealer(size_t size, const char* name, uint32_t flags, Policy policy);
 
     virtual sp<IMemory> allocate(size_t size);
     virtual void        deallocate(size_t offset);
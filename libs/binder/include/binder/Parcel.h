@@ -236,7 +236,8 @@ public:
 
     // Writes a blob to the parcel.
     // If the blob is small, then it is stored in-place, otherwise it is
-    // transferred by way of an anonymous shared memory region.  Prefer sending
+    // transferred by way of a sealed memfd (or an ashmem region on kernels
+    // without memfd sealing support).  Prefer sending
     // immutable blobs if possible since they may be subsequently transferred between
     // processes without further copying whereas mutable blobs always need to be copied.
     // The caller should call release() on the blob after writing its contents.
@@ -247,6 +248,11 @@ public:
     // as long as it keeps a dup of the blob file descriptor handy for later.
     status_t            writeDupImmutableBlobFileDescriptor(int fd);
 
+    // Process-wide size above which writeBlob() moves the payload out of the
+    // transaction buffer and into shared memory. Defaults to 16KB.
+    static void         setBlobInplaceLimit(size_t limit);
+    static size_t       getBlobInplaceLimit();
+
     status_t            writeObject(const flat_binder_object& val, bool nullMetaData);
 
     // Like Parcel.java's writeNoException().  Just writes a zero int32.
@@ -443,6 +449,7 @@ private:
     Parcel&             operator=(const Parcel& o);
     
     status_t            finishWrite(size_t len);
+    status_t            writeMemfdBlob(size_t len, bool mutableCopy, WritableBlob* outBlob);
     void                releaseObjects();
     void                acquireObjects();
     status_t            growData(size_t len);
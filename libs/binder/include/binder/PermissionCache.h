@@ -22,9 +22,15 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include <utils/Mutex.h>
 #include <utils/String16.h>
 #include <utils/Singleton.h>
-#include <utils/SortedVector.h>
+#include <utils/Timers.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <utility>
 
 namespace android {
 // ---------------------------------------------------------------------------
@@ -32,38 +38,50 @@ namespace android {
 /*
  * PermissionCache caches permission checks for a given uid.
  *
- * Currently the cache is not updated when there is a permission change,
- * for instance when an application is uninstalled.
+ * The cache is not updated when there is a permission change, for instance
+ * when an application is uninstalled, unless the process opts in to
+ * invalidation with registerUidObserver() or bounds the lifetime of entries
+ * with setTimeToLive().
  *
  * IMPORTANT: for the reason stated above, only system permissions are safe
  * to cache. This restriction may be lifted at a later time.
  *
+ * Lookups never take a lock: the cache is split into shards by uid and
+ * permission, and each shard is an immutable map that writers copy and
+ * swap in under a per-shard lock.
  */
 
 class PermissionCache : Singleton<PermissionCache> {
+    using Key = std::pair<uid_t, String16>;
     struct Entry {
-        String16    name;
-        uid_t       uid;
         bool        granted;
-        inline bool operator < (const Entry& e) const {
-            return (uid == e.uid) ? (name < e.name) : (uid < e.uid);
-        }
+        // systemTime() after which the entry is stale, or 0 for never.
+        nsecs_t     expiresAt;
+    };
+    using Map = std::map<Key, Entry>;
+
+    struct Shard {
+        Mutex writeLock;
+        // Replaced wholesale by writers; readers atomically load a reference.
+        std::shared_ptr<const Map> entries;
     };
-    mutable Mutex mLock;
-    // we pool all the permission names we see, as many permissions checks
-    // will have identical names
-    SortedVector< String16 > mPermissionNamesPool;
-    // this is our cache per say. it stores pooled names.
-    SortedVector< Entry > mCache;
-
-    // free the whole cache, but keep the permission name pool
+
+    static constexpr size_t kNumShards = 16;
+    Shard mShards[kNumShards];
+    std::atomic<nsecs_t> mTimeToLive;
+
+    Shard& shardFor(const String16& permission, uid_t uid);
+
+    // free the whole cache
     void purge();
 
     status_t check(bool* granted,
-            const String16& permission, uid_t uid) const;
+            const String16& permission, uid_t uid);
 
     void cache(const String16& permission, uid_t uid, bool granted);
 
+    void invalidate(uid_t uid);
+
 public:
     PermissionCache();
 
@@ -74,6 +92,22 @@ public:
 
     static bool checkPermission(const String16& permission,
             pid_t pid, uid_t uid);
+
+    // Entries older than ttl are checked again. 0 (the default) keeps entries
+    // until they are invalidated.
+    static void setTimeToLive(nsecs_t ttl);
+
+    // Drops every cached result for uid.
+    static void invalidateUid(uid_t uid);
+
+    // Drops every cached result.
+    static void purgeAll();
+
+    // Registers with the activity manager to invalidate a uid's entries when
+    // the uid goes away (e.g. its package is removed). Waits for the activity
+    // manager to be published, so call it once at init time, never from a
+    // permission check.
+    static void registerUidObserver(const String16& callingPackage);
 };
 
 // ---------------------------------------------------------------------------
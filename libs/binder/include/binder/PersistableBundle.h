@@ -18,6 +18,7 @@
 #define ANDROID_PERSISTABLE_BUNDLE_H
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -42,6 +43,14 @@ public:
     status_t writeToParcel(Parcel* parcel) const override;
     status_t readFromParcel(const Parcel* parcel) override;
 
+    /*
+     * When enabled, readFromParcel() only copies the bundle's bytes and indexes
+     * its keys. Getters then decode just the requested value, and writing an
+     * unmodified bundle re-emits the original bytes. Any setter, erase() or
+     * comparison decodes the whole bundle first. Process wide, off by default.
+     */
+    static void setLazyUnparcelingEnabled(bool enabled);
+
     bool empty() const;
     size_t size() const;
     size_t erase(const String16& key);
@@ -94,6 +103,9 @@ public:
     std::set<String16> getPersistableBundleKeys() const;
 
     friend bool operator==(const PersistableBundle& lhs, const PersistableBundle& rhs) {
+        if (lhs.mLazy != nullptr || rhs.mLazy != nullptr) {
+            return materialized(lhs) == materialized(rhs);
+        }
         return (lhs.mBoolMap == rhs.mBoolMap && lhs.mIntMap == rhs.mIntMap &&
                 lhs.mLongMap == rhs.mLongMap && lhs.mDoubleMap == rhs.mDoubleMap &&
                 lhs.mStringMap == rhs.mStringMap && lhs.mBoolVectorMap == rhs.mBoolVectorMap &&
@@ -109,8 +121,22 @@ public:
     }
 
 private:
+    // Undecoded bundle contents, see setLazyUnparcelingEnabled().
+    struct LazyData;
+
     status_t writeToParcelInner(Parcel* parcel) const;
     status_t readFromParcelInner(const Parcel* parcel, size_t length);
+    status_t readEntries(const Parcel* parcel);
+    status_t readLazily(const Parcel* parcel, size_t length);
+    // Decodes all lazily read entries into the maps below.
+    void materialize();
+    static PersistableBundle materialized(const PersistableBundle& bundle);
+    template <typename T, typename Reader>
+    bool getLazyValue(const String16& key, int32_t type, T* out, Reader read) const;
+    std::set<String16> getLazyKeys(int32_t type) const;
+
+    // Set while the bundle holds undecoded data; the maps are empty then.
+    std::shared_ptr<const LazyData> mLazy;
 
     std::map<String16, bool> mBoolMap;
     std::map<String16, int32_t> mIntMap;
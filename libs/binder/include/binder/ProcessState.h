@@ -63,6 +63,31 @@ public:
             void                spawnPooledThread(bool isMain);
             
             status_t            setThreadPoolMaxThreadCount(size_t maxThreads);
+
+                                // Lets the pool size follow demand instead of staying fixed
+                                // at setThreadPoolMaxThreadCount(). Whenever every binder
+                                // thread has been busy for longer than targetWaitMs, the
+                                // limit is raised by one (up to maxThreads) so the driver
+                                // can request another looper. Non-main loopers idle for
+                                // idleTimeoutMs leave the pool while more than minThreads
+                                // remain. Pass idleTimeoutMs = 0 to never shrink.
+            status_t            setThreadPoolAdaptive(size_t minThreads, size_t maxThreads,
+                                                      int64_t targetWaitMs,
+                                                      int64_t idleTimeoutMs);
+
+            struct ThreadPoolStats {
+                size_t maxThreads;        // current limit given to the driver
+                size_t pooledThreads;     // loopers started by BR_SPAWN_LOOPER
+                size_t executingThreads;
+                uint64_t spawnEvents;     // BR_SPAWN_LOOPER requests received
+                uint64_t growEvents;      // adaptive limit increases
+                uint64_t retiredThreads;  // loopers that left after the idle timeout
+                uint64_t starvationEvents;
+                int64_t totalStarvationMs;
+                int64_t maxStarvationMs;
+            };
+            ThreadPoolStats     getThreadPoolStats();
+
             void                giveThreadPoolName();
 
             String8             getDriverName();
@@ -106,6 +131,13 @@ private:
 
             handle_entry*       lookupHandleLocked(int32_t handle);
 
+            // Called by IPCThreadState with mThreadCountLock held.
+            void                noteStarvationLocked(int64_t starvationTimeMs);
+            status_t            updateDriverMaxThreadsLocked();
+            // Returns true if an idle pooled looper should exit.
+            bool                retireIdlePooledThread();
+            int64_t             threadPoolIdleTimeoutMs();
+
             String8             mDriverName;
             int                 mDriverFD;
             void*               mVMStart;
@@ -119,6 +151,21 @@ private:
             size_t              mMaxThreads;
             // Time when thread pool was emptied
             int64_t             mStarvationStartTimeMs;
+            // Adaptive sizing, see setThreadPoolAdaptive(). Disabled while
+            // mAdaptiveMaxThreads is 0.
+            size_t              mAdaptiveMinThreads;
+            size_t              mAdaptiveBaseThreads;
+            size_t              mAdaptiveMaxThreads;
+            int64_t             mAdaptiveTargetWaitMs;
+            int64_t             mAdaptiveIdleTimeoutMs;
+            // Loopers currently in the pool that were not started as main.
+            size_t              mPooledThreadsCount;
+            uint64_t            mSpawnEvents;
+            uint64_t            mGrowEvents;
+            uint64_t            mRetiredThreadsCount;
+            uint64_t            mStarvationEvents;
+            int64_t             mTotalStarvationMs;
+            int64_t             mMaxStarvationMs;
 
     mutable Mutex               mLock;  // protects everything below.
 
@@ -59,6 +59,9 @@ static std::mutex gLock;
 static const void* kId = "ABpBinder";
 struct Value {
     wp<ABpBinder> binder;
+    // The class last associated with a proxy for this binder. Since the descriptor of a binder
+    // never changes, later proxies can be associated with it without comparing descriptors.
+    const AIBinder_Class* clazz = nullptr;
 };
 void clean(const void* id, void* obj, void* cookie) {
     CHECK(id == kId) << id << " " << obj << " " << cookie;
@@ -75,9 +78,8 @@ bool AIBinder::associateClass(const AIBinder_Class* clazz) {
     if (clazz == nullptr) return false;
     if (mClazz == clazz) return true;
 
-    String8 newDescriptor(clazz->getInterfaceDescriptor());
-
     if (mClazz != nullptr) {
+        String8 newDescriptor(clazz->getInterfaceDescriptor());
         String8 currentDescriptor(mClazz->getInterfaceDescriptor());
         if (newDescriptor == currentDescriptor) {
             LOG(ERROR) << __func__ << ": Class descriptors '" << currentDescriptor
@@ -97,16 +99,36 @@ bool AIBinder::associateClass(const AIBinder_Class* clazz) {
 
     CHECK(asABpBinder() != nullptr);  // ABBinder always has a descriptor
 
-    String8 descriptor(getBinder()->getInterfaceDescriptor());
-    if (descriptor != newDescriptor) {
-        LOG(ERROR) << __func__ << ": Expecting binder to have class '" << newDescriptor.c_str()
-                   << "' but descriptor is actually '" << descriptor.c_str() << "'.";
+    sp<IBinder> binder = getBinder();
+    {
+        std::lock_guard<std::mutex> lock(ABpBinderTag::gLock);
+        ABpBinderTag::Value* value =
+                static_cast<ABpBinderTag::Value*>(binder->findObject(ABpBinderTag::kId));
+        if (value != nullptr && value->clazz == clazz) {
+            mClazz = clazz;
+            return true;
+        }
+    }
+
+    // BpBinder caches the descriptor, so this is only a transaction the first time.
+    const String16& descriptor = binder->getInterfaceDescriptor();
+    if (descriptor != clazz->getInterfaceDescriptor()) {
+        LOG(ERROR) << __func__ << ": Expecting binder to have class '"
+                   << String8(clazz->getInterfaceDescriptor()).c_str()
+                   << "' but descriptor is actually '" << String8(descriptor).c_str() << "'.";
         return false;
     }
 
     // if this is a local object, it's not one known to libbinder_ndk
     mClazz = clazz;
 
+    std::lock_guard<std::mutex> lock(ABpBinderTag::gLock);
+    ABpBinderTag::Value* value =
+            static_cast<ABpBinderTag::Value*>(binder->findObject(ABpBinderTag::kId));
+    if (value != nullptr) {
+        value->clazz = clazz;
+    }
+
     return true;
 }
 
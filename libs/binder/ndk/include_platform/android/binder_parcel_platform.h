@@ -29,4 +29,24 @@ __BEGIN_DECLS
  */
 bool AParcel_getAllowFds(const AParcel*);
 
+/**
+ * Reads an array written by AParcel_writeByteArray, AParcel_writeInt32Array,
+ * AParcel_writeUint32Array, AParcel_writeInt64Array, AParcel_writeUint64Array,
+ * AParcel_writeFloatArray or AParcel_writeDoubleArray without copying it.
+ *
+ * The returned pointer refers to the parcel's own data and stays valid until
+ * the parcel is modified or deleted. It is only 4-byte aligned, so elements
+ * larger than that must be accessed with memcpy. Char and bool arrays are not
+ * packed and cannot be read this way.
+ *
+ * \param parcel the parcel to read from.
+ * \param elementSize size in bytes of one array element.
+ * \param outData the array elements, or null if the array is null or empty.
+ * \param outLength the number of elements, or -1 for a null array.
+ *
+ * eturn STATUS_OK on successful read.
+ */
+binder_status_t AParcel_readArrayView(const AParcel* parcel, size_t elementSize,
+                                      const void** outData, int32_t* outLength);
+
 __END_DECLS
\ No newline at end of file
@@ -91,15 +91,14 @@ binder_status_t WriteArray<char16_t>(AParcel* parcel, const char16_t* array, int
     if (status != STATUS_OK) return status;
     if (length <= 0) return STATUS_OK;
 
-    int32_t size = 0;
-    if (__builtin_smul_overflow(sizeof(char16_t), length, &size)) return STATUS_NO_MEMORY;
-
-    Parcel* rawParcel = parcel->get();
+    // Reserve the whole array at once rather than growing per element.
+    int32_t paddedSize = 0;
+    if (__builtin_smul_overflow(sizeof(int32_t), length, &paddedSize)) return STATUS_NO_MEMORY;
+    int32_t* const data = static_cast<int32_t*>(parcel->get()->writeInplace(paddedSize));
+    if (data == nullptr) return STATUS_NO_MEMORY;
 
     for (int32_t i = 0; i < length; i++) {
-        status = rawParcel->writeChar(array[i]);
-
-        if (status != STATUS_OK) return PruneStatusT(status);
+        data[i] = static_cast<int32_t>(array[i]);
     }
 
     return STATUS_OK;
@@ -151,13 +150,13 @@ binder_status_t ReadArray<char16_t>(const AParcel* parcel, void* arrayData,
     if (length <= 0) return STATUS_OK;
     if (array == nullptr) return STATUS_NO_MEMORY;
 
-    int32_t size = 0;
-    if (__builtin_smul_overflow(sizeof(char16_t), length, &size)) return STATUS_NO_MEMORY;
+    int32_t paddedSize = 0;
+    if (__builtin_smul_overflow(sizeof(int32_t), length, &paddedSize)) return STATUS_NO_MEMORY;
+    const int32_t* const data = static_cast<const int32_t*>(rawParcel->readInplace(paddedSize));
+    if (data == nullptr) return STATUS_NO_MEMORY;
 
     for (int32_t i = 0; i < length; i++) {
-        status = rawParcel->readChar(array + i);
-
-        if (status != STATUS_OK) return PruneStatusT(status);
+        array[i] = static_cast<char16_t>(data[i]);
     }
 
     return STATUS_OK;
@@ -647,4 +646,29 @@ bool AParcel_getAllowFds(const AParcel* parcel) {
     return parcel->get()->allowFds();
 }
 
+binder_status_t AParcel_readArrayView(const AParcel* parcel, size_t elementSize,
+                                      const void** outData, int32_t* outLength) {
+    if (elementSize == 0 || outData == nullptr || outLength == nullptr) return STATUS_BAD_VALUE;
+    const Parcel* rawParcel = parcel->get();
+
+    int32_t length;
+    status_t status = rawParcel->readInt32(&length);
+
+    if (status != STATUS_OK) return PruneStatusT(status);
+    if (length < -1) return STATUS_BAD_VALUE;
+
+    *outData = nullptr;
+    *outLength = length;
+    if (length <= 0) return STATUS_OK;
+
+    int32_t size = 0;
+    if (__builtin_smul_overflow(elementSize, length, &size)) return STATUS_NO_MEMORY;
+
+    const void* data = rawParcel->readInplace(size);
+    if (data == nullptr) return STATUS_NO_MEMORY;
+
+    *outData = data;
+    return STATUS_OK;
+}
+
 // @END
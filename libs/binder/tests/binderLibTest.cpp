@@ -28,6 +28,8 @@
 #include <binder/IBinder.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
+#include <binder/MemoryDealer.h>
+#include <binder/PersistableBundle.h>
 
 #include <private/binder/binder_module.h>
 #include <sys/epoll.h>
@@ -954,6 +956,42 @@ TEST_F(BinderLibTest, OnewayQueueing)
     EXPECT_EQ(NO_ERROR, ret);
 }
 
+TEST_F(BinderLibTest, OnewayBatchKeepsOrder)
+{
+    status_t ret;
+    Parcel data, data2;
+
+    sp<IBinder> pollServer = addPollServer();
+
+    sp<BinderLibTestCallBack> callBack = new BinderLibTestCallBack();
+    data.writeStrongBinder(callBack);
+    data.writeInt32(500000); // delay in us before calling back
+
+    sp<BinderLibTestCallBack> callBack2 = new BinderLibTestCallBack();
+    data2.writeStrongBinder(callBack2);
+    data2.writeInt32(0); // delay in us
+
+    IPCThreadState::self()->beginOnewayBatch();
+    ret = pollServer->transact(BINDER_LIB_TEST_DELAYED_CALL_BACK, data, nullptr, TF_ONE_WAY);
+    EXPECT_EQ(NO_ERROR, ret);
+    ret = pollServer->transact(BINDER_LIB_TEST_DELAYED_CALL_BACK, data2, nullptr, TF_ONE_WAY);
+    EXPECT_EQ(NO_ERROR, ret);
+    // Nothing has reached the driver yet, so the caller's data can go away.
+    data.freeData();
+    data2.freeData();
+    EXPECT_EQ(NO_ERROR, IPCThreadState::self()->flushOnewayBatch());
+
+    ret = callBack->waitEvent(2);
+    EXPECT_EQ(NO_ERROR, ret);
+    ret = callBack->getResult();
+    EXPECT_EQ(NO_ERROR, ret);
+
+    ret = callBack2->waitEvent(2);
+    EXPECT_EQ(NO_ERROR, ret);
+    ret = callBack2->getResult();
+    EXPECT_EQ(NO_ERROR, ret);
+}
+
 TEST_F(BinderLibTest, WorkSourceUnsetByDefault)
 {
     status_t ret;
@@ -1124,6 +1162,138 @@ TEST_F(BinderLibTest, BufRejected) {
     EXPECT_NE(NO_ERROR, ret);
 }
 
+TEST_F(BinderLibTest, ServiceLookupIsCached) {
+    sp<IServiceManager> sm = defaultServiceManager();
+    sp<IBinder> first = sm->checkService(binderLibTestServiceName);
+    ASSERT_TRUE(first != nullptr);
+
+    ServiceCacheStats before = getServiceCacheStats();
+    sp<IBinder> second = sm->checkService(binderLibTestServiceName);
+    ServiceCacheStats after = getServiceCacheStats();
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(before.hits + 1, after.hits);
+    EXPECT_EQ(before.misses, after.misses);
+}
+
+TEST_F(BinderLibTest, ThreadPoolAdaptiveLimits) {
+    sp<ProcessState> proc = ProcessState::self();
+    EXPECT_EQ(BAD_VALUE, proc->setThreadPoolAdaptive(4, 2, 10, 0));
+    EXPECT_EQ(BAD_VALUE, proc->setThreadPoolAdaptive(0, 0, 10, 0));
+
+    ProcessState::ThreadPoolStats before = proc->getThreadPoolStats();
+    EXPECT_EQ(NO_ERROR, proc->setThreadPoolAdaptive(before.maxThreads + 1,
+                                                    before.maxThreads + 4, 10, 0));
+    ProcessState::ThreadPoolStats after = proc->getThreadPoolStats();
+    EXPECT_GE(after.maxThreads, before.maxThreads + 1);
+    EXPECT_LE(after.maxThreads, before.maxThreads + 4);
+    EXPECT_GE(after.spawnEvents, before.spawnEvents);
+    EXPECT_EQ(0u, after.retiredThreads);
+}
+
+TEST_F(BinderLibTest, MemoryDealerSegregatedFit) {
+    sp<MemoryDealer> dealer = new MemoryDealer(64 * 1024, "BinderLibTest", 0,
+                                               MemoryDealer::Policy::SEGREGATED_FIT);
+    std::vector<sp<IMemory>> small;
+    for (int i = 0; i < 64; i++) {
+        sp<IMemory> mem = dealer->allocate(100);
+        ASSERT_NE(nullptr, mem);
+        small.push_back(mem);
+    }
+    // Free every other block; the holes are too small for a large request,
+    // which must come out of the untouched tail.
+    for (size_t i = 0; i < small.size(); i += 2) small[i].clear();
+    sp<IMemory> large = dealer->allocate(32 * 1024);
+    ASSERT_NE(nullptr, large);
+    EXPECT_EQ(0u, large->offset() % MemoryDealer::getAllocationAlignment());
+
+    // Freeing everything coalesces back into a single chunk.
+    small.clear();
+    large.clear();
+    sp<IMemory> all = dealer->allocate(64 * 1024);
+    EXPECT_NE(nullptr, all);
+}
+
+TEST_F(BinderLibTest, PersistableBundleLazyUnparcel) {
+    os::PersistableBundle inner;
+    inner.putString(String16("name"), String16("value"));
+    os::PersistableBundle bundle;
+    bundle.putInt(String16("int"), 42);
+    bundle.putLongVector(String16("longs"), {1, 2, 3});
+    bundle.putPersistableBundle(String16("inner"), inner);
+
+    Parcel data;
+    ASSERT_EQ(NO_ERROR, bundle.writeToParcel(&data));
+
+    os::PersistableBundle::setLazyUnparcelingEnabled(true);
+    os::PersistableBundle lazy;
+    data.setDataPosition(0);
+    status_t ret = lazy.readFromParcel(&data);
+    os::PersistableBundle::setLazyUnparcelingEnabled(false);
+    ASSERT_EQ(NO_ERROR, ret);
+
+    EXPECT_EQ(3u, lazy.size());
+    int32_t i;
+    EXPECT_TRUE(lazy.getInt(String16("int"), &i));
+    EXPECT_EQ(42, i);
+    EXPECT_FALSE(lazy.getLong(String16("int"), nullptr));
+    std::vector<int64_t> longs;
+    EXPECT_TRUE(lazy.getLongVector(String16("longs"), &longs));
+    EXPECT_EQ((std::vector<int64_t>{1, 2, 3}), longs);
+
+    // Forwarding re-emits the original bytes.
+    Parcel forwarded;
+    ASSERT_EQ(NO_ERROR, lazy.writeToParcel(&forwarded));
+    ASSERT_EQ(data.dataSize(), forwarded.dataSize());
+    EXPECT_EQ(0, memcmp(data.data(), forwarded.data(), data.dataSize()));
+
+    EXPECT_EQ(bundle, lazy);
+    lazy.putInt(String16("int"), 7);
+    EXPECT_NE(bundle, lazy);
+    EXPECT_EQ(3u, lazy.size());
+}
+
+TEST_F(BinderLibTest, Utf8Utf16RoundTrip) {
+    // Cover the vectorized ASCII runs, their scalar tails and hand off to
+    // the full conversion at various offsets.
+    for (size_t len : {0, 1, 7, 8, 15, 16, 17, 31, 33, 100}) {
+        for (const char* suffix : {"", "\xc3\xa9", "\xe2\x82\xac!", "\xf0\x9f\x98\x80"}) {
+            std::string str = std::string(len, 'a') + suffix + std::string(len / 2, 'z');
+            Parcel data;
+            ASSERT_EQ(NO_ERROR, data.writeUtf8AsUtf16(str));
+            data.setDataPosition(0);
+            String16 str16 = data.readString16();
+            EXPECT_EQ(String16(str.c_str()), str16);
+            data.setDataPosition(0);
+            std::string out;
+            ASSERT_EQ(NO_ERROR, data.readUtf8FromUtf16(&out));
+            EXPECT_EQ(str, out);
+        }
+    }
+    Parcel bad;
+    EXPECT_EQ(BAD_VALUE, bad.writeUtf8AsUtf16(std::string(20, 'a') + "\xff"));
+}
+
+TEST_F(BinderLibTest, ParcelBufferArenaRecyclesBuffers) {
+    IPCThreadState::self();
+    IPCThreadState::setParcelBufferArenaEnabled(true);
+    IPCThreadState::ParcelBufferArenaStats before = IPCThreadState::getParcelBufferArenaStats();
+    {
+        Parcel data;
+        data.writeInt32(1);
+    }
+    {
+        Parcel data;
+        data.writeInt32(1);
+        EXPECT_GE(data.dataCapacity(), sizeof(int32_t));
+    }
+    IPCThreadState::ParcelBufferArenaStats after = IPCThreadState::getParcelBufferArenaStats();
+    IPCThreadState::setParcelBufferArenaEnabled(false);
+
+    EXPECT_GE(after.recycled - before.recycled, 2u);
+    EXPECT_GE(after.hits - before.hits, 1u);
+}
+
 class BinderLibTestService : public BBinder
 {
     public:
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/Parcel.h>
+
+#include <string>
+
+using android::Parcel;
+
+// A package name, a long ASCII log line and a string that is mostly
+// ASCII with a multibyte character near the end.
+static const std::string kStrings[] = {
+    "com.android.systemui",
+    std::string(256, 'x'),
+    std::string(120, 'a') + "\xc3\xa9" + std::string(8, 'b'),
+};
+
+static void BM_writeUtf8AsUtf16(benchmark::State& state) {
+    const std::string& str = kStrings[state.range(0)];
+    Parcel parcel;
+    for (auto _ : state) {
+        parcel.setDataPosition(0);
+        benchmark::DoNotOptimize(parcel.writeUtf8AsUtf16(str));
+    }
+    state.SetBytesProcessed(state.iterations() * str.size());
+}
+BENCHMARK(BM_writeUtf8AsUtf16)->DenseRange(0, 2);
+
+static void BM_readUtf8FromUtf16(benchmark::State& state) {
+    const std::string& str = kStrings[state.range(0)];
+    Parcel parcel;
+    parcel.writeUtf8AsUtf16(str);
+    std::string out;
+    for (auto _ : state) {
+        parcel.setDataPosition(0);
+        benchmark::DoNotOptimize(parcel.readUtf8FromUtf16(&out));
+    }
+    state.SetBytesProcessed(state.iterations() * str.size());
+}
+BENCHMARK(BM_readUtf8FromUtf16)->DenseRange(0, 2);
+
+BENCHMARK_MAIN();
@@ -7,10 +7,18 @@
 #include <cstdlib>
 #include <cstdio>
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <tuple>
 
+#include <fcntl.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/wait.h>
 
@@ -19,8 +27,33 @@ using namespace android;
 
 enum BinderWorkerServiceCode {
     BINDER_NOP = IBinder::FIRST_CALL_TRANSACTION,
+    // Returns how many oneway calls the server has handled from one client
+    // thread. Lets oneway runs wait before overflowing the server's async
+    // buffer space.
+    BINDER_ONEWAY_COUNT,
 };
 
+enum class CallMode {
+    TWO_WAY,
+    ONE_WAY,
+    FD,
+};
+
+static const char* modeName(CallMode mode) {
+    switch (mode) {
+    case CallMode::TWO_WAY: return "twoway";
+    case CallMode::ONE_WAY: return "oneway";
+    case CallMode::FD: return "fd";
+    }
+    return "unknown";
+}
+
+// Oneway calls in flight per client thread before it waits for the server.
+static const int oneway_window = 16;
+// Half of the binder buffer is reserved for async transactions; larger
+// oneway payloads are rejected by the driver.
+static const int max_oneway_payload = 256 * 1024;
+
 #define ASSERT_TRUE(cond) \
 do { \
     if (!(cond)) {\
@@ -37,16 +70,26 @@ public:
     virtual status_t onTransact(uint32_t code,
                                 const Parcel& data, Parcel* reply,
                                 uint32_t flags = 0) {
-        (void)flags;
-        (void)data;
-        (void)reply;
         switch (code) {
         case BINDER_NOP:
+            if (flags & FLAG_ONEWAY) {
+                int32_t client = data.readInt32();
+                lock_guard<mutex> lock(m_lock);
+                m_oneway_received[client]++;
+            }
             return NO_ERROR;
+        case BINDER_ONEWAY_COUNT: {
+            int32_t client = data.readInt32();
+            lock_guard<mutex> lock(m_lock);
+            return reply->writeUint64(m_oneway_received[client]);
+        }
         default:
             return UNKNOWN_TRANSACTION;
         };
     }
+private:
+    mutex m_lock;
+    map<int32_t, uint64_t> m_oneway_received;
 };
 
 class Pipe {
@@ -79,13 +122,22 @@ public:
         int error = read(m_readFd, &val, sizeof(val));
         ASSERT_TRUE(error >= 0);
     }
+    // Results are larger than PIPE_BUF, so loop until everything is moved.
     template <typename T> void send(const T& v) {
-        int error = write(m_writeFd, &v, sizeof(T));
-        ASSERT_TRUE(error >= 0);
+        const char* p = reinterpret_cast<const char*>(&v);
+        for (size_t done = 0; done < sizeof(T);) {
+            int error = write(m_writeFd, p + done, sizeof(T) - done);
+            ASSERT_TRUE(error > 0);
+            done += error;
+        }
     }
     template <typename T> void recv(T& v) {
-        int error = read(m_readFd, &v, sizeof(T));
-        ASSERT_TRUE(error >= 0);
+        char* p = reinterpret_cast<char*>(&v);
+        for (size_t done = 0; done < sizeof(T);) {
+            int error = read(m_readFd, p + done, sizeof(T) - done);
+            ASSERT_TRUE(error > 0);
+            done += error;
+        }
     }
     static tuple<Pipe, Pipe> createPipePair() {
         int a[2];
@@ -100,9 +152,28 @@ public:
     }
 };
 
-static const uint32_t num_buckets = 128;
+// Log-linear histogram: values below 16ns get their own bucket, above that
+// each power of two is split into 16 buckets, so any reported percentile is
+// within ~6% of the real value without needing to know the range up front.
+static const uint32_t sub_buckets = 16;
+static const uint32_t num_buckets = 64 * sub_buckets;
 static uint64_t max_time_bucket = 50ull * 1000000;
-static uint64_t time_per_bucket = max_time_bucket / num_buckets;
+
+static uint32_t bucket_for(uint64_t time) {
+    if (time < sub_buckets) return time;
+    uint32_t msb = 63 - __builtin_clzll(time);
+    uint32_t sub = (time >> (msb - 4)) & (sub_buckets - 1);
+    return (msb - 3) * sub_buckets + sub;
+}
+
+// Midpoint of the range covered by a bucket, in ns.
+static double bucket_value(uint32_t bucket) {
+    if (bucket < sub_buckets) return bucket;
+    uint32_t msb = bucket / sub_buckets + 3;
+    uint64_t width = 1ull << (msb - 4);
+    uint64_t lower = (sub_buckets + bucket % sub_buckets) * width;
+    return lower + width / 2.0;
+}
 
 struct ProcResults {
     uint64_t m_worst = 0;
@@ -110,13 +181,13 @@ struct ProcResults {
     uint64_t m_transactions = 0;
     uint64_t m_long_transactions = 0;
     uint64_t m_total_time = 0;
-    uint64_t m_best = max_time_bucket;
+    uint64_t m_best = UINT64_MAX;
 
     void add_time(uint64_t time) {
         if (time > max_time_bucket) {
             m_long_transactions++;
         }
-        m_buckets[min(time, max_time_bucket-1) / time_per_bucket] += 1;
+        m_buckets[bucket_for(time)] += 1;
         m_best = min(time, m_best);
         m_worst = max(time, m_worst);
         m_transactions += 1;
@@ -134,7 +205,23 @@ struct ProcResults {
         ret.m_total_time = a.m_total_time + b.m_total_time;
         return ret;
     }
-    void dump() {
+    // Returns the given percentile (0-1) in ns.
+    double percentile(double p) const {
+        if (m_transactions == 0) return 0;
+        uint64_t target = max<uint64_t>(1, p * m_transactions + 0.5);
+        uint64_t cur_total = 0;
+        for (int i = 0; i < num_buckets; i++) {
+            cur_total += m_buckets[i];
+            if (cur_total >= target) {
+                return min<double>(bucket_value(i), m_worst);
+            }
+        }
+        return m_worst;
+    }
+    double average() const {
+        return m_transactions ? (double)m_total_time / m_transactions : 0;
+    }
+    void dump() const {
         if (m_long_transactions > 0) {
             cout << (double)m_long_transactions / m_transactions << "% of transactions took longer "
                 "than estimated max latency. Consider setting -m to be higher than "
@@ -143,31 +230,30 @@ struct ProcResults {
 
         double best = (double)m_best / 1.0E6;
         double worst = (double)m_worst / 1.0E6;
-        double average = (double)m_total_time / m_transactions / 1.0E6;
-        cout << "average:" << average << "ms worst:" << worst << "ms best:" << best << "ms" << endl;
-
-        uint64_t cur_total = 0;
-        float time_per_bucket_ms = time_per_bucket / 1.0E6;
-        for (int i = 0; i < num_buckets; i++) {
-            float cur_time = time_per_bucket_ms * i + 0.5f * time_per_bucket_ms;
-            if ((cur_total < 0.5f * m_transactions) && (cur_total + m_buckets[i] >= 0.5f * m_transactions)) {
-                cout << "50%: " << cur_time << " ";
-            }
-            if ((cur_total < 0.9f * m_transactions) && (cur_total + m_buckets[i] >= 0.9f * m_transactions)) {
-                cout << "90%: " << cur_time << " ";
-            }
-            if ((cur_total < 0.95f * m_transactions) && (cur_total + m_buckets[i] >= 0.95f * m_transactions)) {
-                cout << "95%: " << cur_time << " ";
-            }
-            if ((cur_total < 0.99f * m_transactions) && (cur_total + m_buckets[i] >= 0.99f * m_transactions)) {
-                cout << "99%: " << cur_time << " ";
-            }
-            cur_total += m_buckets[i];
-        }
-        cout << endl;
+        cout << "average:" << average() / 1.0E6 << "ms worst:" << worst << "ms best:" << best
+             << "ms" << endl;
+        cout << "50%: " << percentile(0.5) / 1.0E6 << " "
+             << "90%: " << percentile(0.9) / 1.0E6 << " "
+             << "95%: " << percentile(0.95) / 1.0E6 << " "
+             << "99%: " << percentile(0.99) / 1.0E6 << " "
+             << "99.9%: " << percentile(0.999) / 1.0E6 << endl;
     }
 };
 
+struct RunConfig {
+    int iterations = 10000;
+    int workers = 2;
+    int payload_size = 0;
+    bool cs_pair = false;
+    CallMode mode = CallMode::TWO_WAY;
+    // Threads issuing calls in each client process.
+    int client_threads = 1;
+    // Binder thread pool size of each server process, 0 for the default.
+    int server_threads = 0;
+    // CPUs workers are pinned to, round robin. Empty to not pin.
+    vector<int> cpus;
+};
+
 String16 generateServiceName(int num)
 {
     char num_str[32];
@@ -176,30 +262,103 @@ String16 generateServiceName(int num)
     return serviceName;
 }
 
+static void pin_to_cpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        cerr << "failed to pin to cpu " << cpu << ": " << strerror(errno) << endl;
+    }
+}
+
+static void client_fx(int num, int thread, const RunConfig& config,
+                      const vector<sp<IBinder> >& workers, int server_count,
+                      ProcResults* results)
+{
+    // Identifies this thread to the server for oneway flow control.
+    const int32_t client = num * 1024 + thread;
+    unsigned int seed = num * 1024 + thread;
+    int null_fd = -1;
+    if (config.mode == CallMode::FD) {
+        null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        ASSERT_TRUE(null_fd >= 0);
+    }
+    const uint32_t flags = config.mode == CallMode::ONE_WAY ? IBinder::FLAG_ONEWAY : 0;
+    vector<uint64_t> sent(workers.size(), 0);
+
+    chrono::time_point<chrono::high_resolution_clock> start, end;
+    for (int i = 0; i < config.iterations; i++) {
+        Parcel data, reply;
+        int target = config.cs_pair ? num % server_count : rand_r(&seed) % workers.size();
+        int sz = config.payload_size;
+
+        data.writeInt32(client);
+        sz -= sizeof(int32_t);
+        if (null_fd >= 0) {
+            data.writeFileDescriptor(null_fd);
+        }
+        if (sz > 0) {
+            void* buf = data.writeInplace(sz);
+            ASSERT_TRUE(buf != nullptr);
+            memset(buf, 0, sz);
+        }
+        start = chrono::high_resolution_clock::now();
+        status_t ret = workers[target]->transact(BINDER_NOP, data, &reply, flags);
+        end = chrono::high_resolution_clock::now();
+
+        uint64_t cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+        results->add_time(cur_time);
+
+        if (ret != NO_ERROR) {
+           cout << "thread " << num << " failed " << ret << "i : " << i << endl;
+           exit(EXIT_FAILURE);
+        }
+
+        if (flags & IBinder::FLAG_ONEWAY && ++sent[target] % oneway_window == 0) {
+            // Not timed: wait for the server to drain this thread's calls.
+            for (;;) {
+                Parcel query, count;
+                query.writeInt32(client);
+                ASSERT_TRUE(workers[target]->transact(BINDER_ONEWAY_COUNT, query, &count) ==
+                            NO_ERROR);
+                if (count.readUint64() >= sent[target]) break;
+                sched_yield();
+            }
+        }
+    }
+    if (null_fd >= 0) {
+        close(null_fd);
+    }
+}
+
 void worker_fx(int num,
-               int worker_count,
-               int iterations,
-               int payload_size,
-               bool cs_pair,
+               const RunConfig& config,
                Pipe p)
 {
+    if (!config.cpus.empty()) {
+        pin_to_cpu(config.cpus[num % config.cpus.size()]);
+    }
+
     // Create BinderWorkerService and for go.
+    if (config.server_threads > 0) {
+        // The main pool thread is not counted in the driver's maximum.
+        ProcessState::self()->setThreadPoolMaxThreadCount(config.server_threads - 1);
+    }
     ProcessState::self()->startThreadPool();
     sp<IServiceManager> serviceMgr = defaultServiceManager();
     sp<BinderWorkerService> service = new BinderWorkerService;
     serviceMgr->addService(generateServiceName(num), service);
 
-    srand(num);
     p.signal();
     p.wait();
 
     // If client/server pairs, then half the workers are
     // servers and half are clients
-    int server_count = cs_pair ? worker_count / 2 : worker_count;
+    int server_count = config.cs_pair ? config.workers / 2 : config.workers;
 
     // Get references to other binder services.
     cout << "Created BinderWorker" << num << endl;
-    (void)worker_count;
     vector<sp<IBinder> > workers;
     for (int i = 0; i < server_count; i++) {
         if (num == i)
@@ -209,26 +368,16 @@ void worker_fx(int num,
 
     // Run the benchmark if client
     ProcResults results;
-    chrono::time_point<chrono::high_resolution_clock> start, end;
-    for (int i = 0; (!cs_pair || num >= server_count) && i < iterations; i++) {
-        Parcel data, reply;
-        int target = cs_pair ? num % server_count : rand() % workers.size();
-        int sz = payload_size;
-
-        while (sz >= sizeof(uint32_t)) {
-            data.writeInt32(0);
-            sz -= sizeof(uint32_t);
+    if (!config.cs_pair || num >= server_count) {
+        vector<ProcResults> thread_results(config.client_threads);
+        vector<thread> threads;
+        for (int t = 0; t < config.client_threads; t++) {
+            threads.emplace_back(client_fx, num, t, cref(config), cref(workers), server_count,
+                                 &thread_results[t]);
         }
-        start = chrono::high_resolution_clock::now();
-        status_t ret = workers[target]->transact(BINDER_NOP, data, &reply);
-        end = chrono::high_resolution_clock::now();
-
-        uint64_t cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
-        results.add_time(cur_time);
-
-        if (ret != NO_ERROR) {
-           cout << "thread " << num << " failed " << ret << "i : " << i << endl;
-           exit(EXIT_FAILURE);
+        for (int t = 0; t < config.client_threads; t++) {
+            threads[t].join();
+            results = ProcResults::combine(results, thread_results[t]);
         }
     }
 
@@ -243,7 +392,7 @@ void worker_fx(int num,
     exit(EXIT_SUCCESS);
 }
 
-Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair)
+Pipe make_worker(int num, const RunConfig& config)
 {
     auto pipe_pair = Pipe::createPipePair();
     pid_t pid = fork();
@@ -252,7 +401,7 @@ Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bo
         return move(get<0>(pipe_pair));
     } else {
         /* child */
-        worker_fx(num, worker_count, iterations, payload_size, cs_pair, move(get<1>(pipe_pair)));
+        worker_fx(num, config, move(get<1>(pipe_pair)));
         /* never get here */
         return move(get<0>(pipe_pair));
     }
@@ -273,16 +422,18 @@ void signal_all(vector<Pipe>& v)
     }
 }
 
-void run_main(int iterations,
-              int workers,
-              int payload_size,
-              int cs_pair,
-              bool training_round=false)
+struct RunResults {
+    RunConfig config;
+    ProcResults results;
+    double iterations_per_sec;
+};
+
+RunResults run_main(const RunConfig& config, bool training_round=false)
 {
     vector<Pipe> pipes;
     // Create all the workers and wait for them to spawn.
-    for (int i = 0; i < workers; i++) {
-        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair));
+    for (int i = 0; i < config.workers; i++) {
+        pipes.push_back(make_worker(i, config));
     }
     wait_all(pipes);
 
@@ -294,24 +445,24 @@ void run_main(int iterations,
     wait_all(pipes);
     end = chrono::high_resolution_clock::now();
 
-    // Calculate overall throughput.
-    double iterations_per_sec = double(iterations * workers) / (chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1.0E9);
-    cout << "iterations per sec: " << iterations_per_sec << endl;
-
     // Collect all results from the workers.
     cout << "collecting results" << endl;
     signal_all(pipes);
     ProcResults tot_results;
-    for (int i = 0; i < workers; i++) {
+    for (int i = 0; i < config.workers; i++) {
         ProcResults tmp_results;
         pipes[i].recv(tmp_results);
         tot_results = ProcResults::combine(tot_results, tmp_results);
     }
 
+    // Calculate overall throughput.
+    double iterations_per_sec = double(tot_results.m_transactions) / (chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1.0E9);
+    cout << "iterations per sec: " << iterations_per_sec << endl;
+
     // Kill all the workers.
     cout << "killing workers" << endl;
     signal_all(pipes);
-    for (int i = 0; i < workers; i++) {
+    for (int i = 0; i < config.workers; i++) {
         int status;
         wait(&status);
         if (status != 0) {
@@ -320,24 +471,94 @@ void run_main(int iterations,
     }
     if (training_round) {
         // sets max_time_bucket to 2 * m_worst from the training round.
-        // Also needs to adjust time_per_bucket accordingly.
         max_time_bucket = 2 * tot_results.m_worst;
-        time_per_bucket = max_time_bucket / num_buckets;
         cout << "Max latency during training: " << tot_results.m_worst / 1.0E6 << "ms" << endl;
     } else {
             tot_results.dump();
     }
+    return RunResults{config, tot_results, iterations_per_sec};
+}
+
+static bool write_json(const string& path, const vector<RunResults>& runs)
+{
+    FILE* out = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if (out == nullptr) {
+        cerr << "failed to open " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    fprintf(out, "{\n  \"results\": [\n");
+    for (size_t i = 0; i < runs.size(); i++) {
+        const RunConfig& c = runs[i].config;
+        const ProcResults& r = runs[i].results;
+        fprintf(out,
+                "    {\"mode\": \"%s\", \"payload_bytes\": %d, \"workers\": %d, "
+                "\"cs_pair\": %s, \"client_threads\": %d, \"server_threads\": %d, "
+                "\"iterations\": %d, \"transactions\": %llu, \"iterations_per_sec\": %.1f, "
+                "\"latency_us\": {\"best\": %.3f, \"average\": %.3f, \"p50\": %.3f, "
+                "\"p90\": %.3f, \"p99\": %.3f, \"p99_9\": %.3f, \"worst\": %.3f}}%s\n",
+                modeName(c.mode), c.payload_size, c.workers, c.cs_pair ? "true" : "false",
+                c.client_threads, c.server_threads, c.iterations,
+                (unsigned long long)r.m_transactions, runs[i].iterations_per_sec,
+                r.m_transactions ? r.m_best / 1.0E3 : 0, r.average() / 1.0E3,
+                r.percentile(0.5) / 1.0E3, r.percentile(0.9) / 1.0E3,
+                r.percentile(0.99) / 1.0E3, r.percentile(0.999) / 1.0E3, r.m_worst / 1.0E3,
+                i + 1 < runs.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+    return true;
+}
+
+// Parses "1,2,4" into {1, 2, 4}.
+static vector<int> parse_list(const char* arg)
+{
+    vector<int> values;
+    string s(arg);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t next = s.find(',', pos);
+        if (next == string::npos) next = s.size();
+        values.push_back(atoi(s.substr(pos, next - pos).c_str()));
+        pos = next + 1;
+    }
+    return values;
+}
+
+static vector<CallMode> parse_modes(const char* arg)
+{
+    vector<CallMode> modes;
+    string s(arg);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t next = s.find(',', pos);
+        if (next == string::npos) next = s.size();
+        string name = s.substr(pos, next - pos);
+        if (name == "twoway") {
+            modes.push_back(CallMode::TWO_WAY);
+        } else if (name == "oneway") {
+            modes.push_back(CallMode::ONE_WAY);
+        } else if (name == "fd") {
+            modes.push_back(CallMode::FD);
+        } else {
+            cout << "Unknown mode " << name << endl;
+            exit(EXIT_FAILURE);
+        }
+        pos = next + 1;
+    }
+    return modes;
 }
 
 int main(int argc, char *argv[])
 {
-    int workers = 2;
-    int iterations = 10000;
-    int payload_size = 0;
-    bool cs_pair = false;
+    RunConfig config;
+    vector<int> payload_sizes = {0};
+    vector<int> client_threads = {1};
+    vector<int> server_threads = {0};
+    vector<CallMode> modes = {CallMode::TWO_WAY};
     bool training_round = false;
-    (void)argc;
-    (void)argv;
+    string json_path;
 
     // Parse arguments.
     for (int i = 1; i < argc; i++) {
@@ -346,30 +567,67 @@ int main(int argc, char *argv[])
             cout << "\t-i N    : Specify number of iterations." << endl;
             cout << "\t-m N    : Specify expected max latency in microseconds." << endl;
             cout << "\t-p      : Split workers into client/server pairs." << endl;
-            cout << "\t-s N    : Specify payload size." << endl;
+            cout << "\t-s N[,N...] : Specify payload size(s)." << endl;
             cout << "\t-t N    : Run training round." << endl;
             cout << "\t-w N    : Specify total number of workers." << endl;
+            cout << "\t-c N[,N...] : Number of calling threads per client." << endl;
+            cout << "\t--server-threads N[,N...] : Binder threads per server." << endl;
+            cout << "\t--mode M[,M...] : Calls to make: twoway, oneway or fd." << endl;
+            cout << "\t--sweep : Sweep payloads from 0 to 512KB over all modes." << endl;
+            cout << "\t--cpus N[,N...] : Pin workers round robin to these CPUs." << endl;
+            cout << "\t--json FILE : Also write results as JSON to FILE (- for stdout)." << endl;
             return 0;
         }
         if (string(argv[i]) == "-w") {
-            workers = atoi(argv[i+1]);
+            config.workers = atoi(argv[i+1]);
             i++;
             continue;
         }
         if (string(argv[i]) == "-i") {
-            iterations = atoi(argv[i+1]);
+            config.iterations = atoi(argv[i+1]);
             i++;
             continue;
         }
         if (string(argv[i]) == "-s") {
-            payload_size = atoi(argv[i+1]);
+            payload_sizes = parse_list(argv[i+1]);
             i++;
+            continue;
+        }
+        if (string(argv[i]) == "-c") {
+            client_threads = parse_list(argv[i+1]);
+            i++;
+            continue;
+        }
+        if (string(argv[i]) == "--server-threads") {
+            server_threads = parse_list(argv[i+1]);
+            i++;
+            continue;
+        }
+        if (string(argv[i]) == "--mode") {
+            modes = parse_modes(argv[i+1]);
+            i++;
+            continue;
+        }
+        if (string(argv[i]) == "--sweep") {
+            payload_sizes = {0, 64, 256, 1024, 4096, 16384, 65536, 262144, 524288};
+            modes = {CallMode::TWO_WAY, CallMode::ONE_WAY, CallMode::FD};
+            continue;
+        }
+        if (string(argv[i]) == "--cpus") {
+            config.cpus = parse_list(argv[i+1]);
+            i++;
+            continue;
+        }
+        if (string(argv[i]) == "--json") {
+            json_path = argv[i+1];
+            i++;
+            continue;
         }
         if (string(argv[i]) == "-p") {
             // client/server pairs instead of spreading
             // requests to all workers. If true, half
             // the workers become clients and half servers
-            cs_pair = true;
+            config.cs_pair = true;
         }
         if (string(argv[i]) == "-t") {
             // Run one training round before actually collecting data
@@ -381,7 +639,6 @@ int main(int argc, char *argv[])
             // No need to run training round in this case.
             if (atoi(argv[i+1]) > 0) {
                 max_time_bucket = strtoull(argv[i+1], (char **)nullptr, 10) * 1000;
-                time_per_bucket = max_time_bucket / num_buckets;
                 i++;
             } else {
                 cout << "Max latency -m must be positive." << endl;
@@ -392,10 +649,35 @@ int main(int argc, char *argv[])
 
     if (training_round) {
         cout << "Start training round" << endl;
-        run_main(iterations, workers, payload_size, cs_pair, training_round=true);
+        run_main(config, training_round=true);
         cout << "Completed training round" << endl << endl;
     }
 
-    run_main(iterations, workers, payload_size, cs_pair);
+    vector<RunResults> runs;
+    for (CallMode mode : modes) {
+        for (int payload_size : payload_sizes) {
+            if (mode == CallMode::ONE_WAY && payload_size > max_oneway_payload) {
+                cout << "Skipping oneway payload of " << payload_size << " bytes" << endl;
+                continue;
+            }
+            for (int clients : client_threads) {
+                for (int servers : server_threads) {
+                    RunConfig run = config;
+                    run.mode = mode;
+                    run.payload_size = payload_size;
+                    run.client_threads = max(clients, 1);
+                    run.server_threads = servers;
+                    cout << "mode:" << modeName(mode) << " payload:" << payload_size
+                         << " client threads:" << run.client_threads
+                         << " server threads:" << servers << endl;
+                    runs.push_back(run_main(run));
+                }
+            }
+        }
+    }
+
+    if (!json_path.empty() && !write_json(json_path, runs)) {
+        return EXIT_FAILURE;
+    }
     return 0;
 }
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cputimeinstate.h>
+
+namespace android {
+namespace bpf {
+
+// Battery stats reads every uid's times on each collection, and then only the uids that ran
+// since the previous collection.
+static void BM_GetUidsCpuFreqTimes(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(getUidsCpuFreqTimes());
+    }
+}
+BENCHMARK(BM_GetUidsCpuFreqTimes);
+
+static void BM_GetUidsUpdatedCpuFreqTimes(benchmark::State& state) {
+    uint64_t lastUpdate = 0;
+    getUidsUpdatedCpuFreqTimes(&lastUpdate);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(getUidsUpdatedCpuFreqTimes(&lastUpdate));
+    }
+}
+BENCHMARK(BM_GetUidsUpdatedCpuFreqTimes);
+
+static void BM_GetUidsConcurrentTimes(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(getUidsConcurrentTimes());
+    }
+}
+BENCHMARK(BM_GetUidsConcurrentTimes);
+
+static void BM_GetUidsUpdatedConcurrentTimes(benchmark::State& state) {
+    uint64_t lastUpdate = 0;
+    getUidsUpdatedConcurrentTimes(&lastUpdate);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(getUidsUpdatedConcurrentTimes(&lastUpdate));
+    }
+}
+BENCHMARK(BM_GetUidsUpdatedConcurrentTimes);
+
+static void BM_GetUidCpuFreqTimes(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(getUidCpuFreqTimes(0));
+    }
+}
+BENCHMARK(BM_GetUidCpuFreqTimes);
+
+} // namespace bpf
+} // namespace android
+
+BENCHMARK_MAIN();
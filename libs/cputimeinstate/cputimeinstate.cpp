@@ -22,8 +22,11 @@
 #include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <mutex>
 #include <numeric>
 #include <optional>
@@ -60,6 +63,25 @@ static unique_fd gTisMapFd;
 static unique_fd gConcurrentMapFd;
 static unique_fd gUidLastUpdateMapFd;
 
+// BPF_MAP_LOOKUP_BATCH was added in Linux 5.6, after the uapi headers this library is built
+// against, so the command number and its bpf_attr layout are spelled out here.
+static constexpr int BPF_MAP_LOOKUP_BATCH_CMD = 24;
+struct bpf_map_batch_attr {
+    uint64_t in_batch;
+    uint64_t out_batch;
+    uint64_t keys;
+    uint64_t values;
+    uint32_t count;
+    uint32_t map_fd;
+    uint64_t elem_flags;
+    uint64_t flags;
+};
+// Returned by the kernel when a map type has no batch operations.
+static constexpr int ENOTSUPP_KERNEL = 524;
+static constexpr uint32_t BATCH_LOOKUP_SIZE = 256;
+static constexpr uint32_t MAX_BATCH_LOOKUP_SIZE = 1 << 16;
+static std::atomic<bool> gBatchLookupSupported = true;
+
 static std::optional<std::vector<uint32_t>> readNumbersFromFile(const std::string &path) {
     std::string data;
 
@@ -283,6 +305,121 @@ static std::optional<bool> uidUpdatedSince(uint32_t uid, uint64_t lastUpdate,
     return true;
 }
 
+// Decides which entries of the time in state and concurrent times maps getUidsUpdated*Times()
+// read. Every uid has several buckets in those maps, so uidUpdatedSince() is only called once per
+// uid. A null lastUpdate accepts every entry.
+class UidUpdatedFilter {
+public:
+    explicit UidUpdatedFilter(uint64_t *lastUpdate)
+          : mLastUpdate(lastUpdate), mNewLastUpdate(lastUpdate ? *lastUpdate : 0) {}
+
+    // Returns no value on error.
+    std::optional<bool> accepts(uint32_t uid) {
+        if (!mLastUpdate) return true;
+        auto it = mUpdated.find(uid);
+        if (it != mUpdated.end()) return it->second;
+        auto updated = uidUpdatedSince(uid, *mLastUpdate, &mNewLastUpdate);
+        if (updated.has_value()) mUpdated.emplace(uid, *updated);
+        return updated;
+    }
+
+    // Stores the latest update time seen into lastUpdate once the read has succeeded.
+    void commit() {
+        if (mLastUpdate && mNewLastUpdate > *mLastUpdate) *mLastUpdate = mNewLastUpdate;
+    }
+
+private:
+    uint64_t *mLastUpdate;
+    uint64_t mNewLastUpdate;
+    std::unordered_map<uint32_t, bool> mUpdated;
+};
+
+// Reads every entry of the per-cpu map mapFd with BPF_MAP_LOOKUP_BATCH, which returns many keys
+// and their gNCpus values per syscall. Returns false and sets errno on failure.
+template <class T>
+static bool batchReadMapEntries(const unique_fd &mapFd, std::vector<time_key_t> *keys,
+                                std::vector<T> *vals) {
+    keys->clear();
+    vals->clear();
+    // Opaque cursors into the map. The hash map implementation uses a bucket index, which is no
+    // larger than the key.
+    time_key_t inBatch, outBatch;
+    bool first = true;
+    uint32_t batchSize = BATCH_LOOKUP_SIZE;
+    while (true) {
+        size_t n = keys->size();
+        keys->resize(n + batchSize);
+        vals->resize((n + batchSize) * gNCpus);
+        bpf_map_batch_attr attr = {
+                .in_batch = first ? 0 : reinterpret_cast<uint64_t>(&inBatch),
+                .out_batch = reinterpret_cast<uint64_t>(&outBatch),
+                .keys = reinterpret_cast<uint64_t>(keys->data() + n),
+                .values = reinterpret_cast<uint64_t>(vals->data() + n * gNCpus),
+                .count = batchSize,
+                .map_fd = static_cast<uint32_t>(mapFd.get()),
+        };
+        int ret = syscall(__NR_bpf, BPF_MAP_LOOKUP_BATCH_CMD, &attr, sizeof(attr));
+        int savedErrno = errno;
+        keys->resize(n + attr.count);
+        vals->resize((n + attr.count) * gNCpus);
+        if (!ret) {
+            inBatch = outBatch;
+            first = false;
+            continue;
+        }
+        // ENOENT means the whole map has been read, including any entries returned by this call.
+        if (savedErrno == ENOENT) return true;
+        // ENOSPC means a single hash bucket holds more entries than fit in one batch.
+        if (savedErrno == ENOSPC && batchSize < MAX_BATCH_LOOKUP_SIZE) {
+            batchSize *= 2;
+            continue;
+        }
+        errno = savedErrno;
+        return false;
+    }
+}
+
+// Reads the entries of the per-cpu map mapFd accepted by filter into keys, and gNCpus values per
+// key into vals. Uses BPF_MAP_LOOKUP_BATCH where the kernel supports it, and otherwise walks the
+// map one key at a time. Returns false on error.
+template <class T>
+static bool readMapEntries(const unique_fd &mapFd, UidUpdatedFilter *filter,
+                           std::vector<time_key_t> *keys, std::vector<T> *vals) {
+    if (gBatchLookupSupported) {
+        if (batchReadMapEntries(mapFd, keys, vals)) {
+            size_t accepted = 0;
+            for (size_t i = 0; i < keys->size(); ++i) {
+                auto uidAccepted = filter->accepts((*keys)[i].uid);
+                if (!uidAccepted.has_value()) return false;
+                if (!*uidAccepted) continue;
+                (*keys)[accepted] = (*keys)[i];
+                std::copy_n(vals->begin() + i * gNCpus, gNCpus, vals->begin() + accepted * gNCpus);
+                ++accepted;
+            }
+            keys->resize(accepted);
+            vals->resize(accepted * gNCpus);
+            return true;
+        }
+        // EINVAL comes from kernels older than 5.6, which do not know the command.
+        if (errno != EINVAL && errno != ENOTSUPP_KERNEL && errno != EOPNOTSUPP) return false;
+        gBatchLookupSupported = false;
+    }
+
+    keys->clear();
+    vals->clear();
+    time_key_t key, prevKey;
+    if (getFirstMapKey(mapFd, &key)) return errno == ENOENT;
+    do {
+        auto uidAccepted = filter->accepts(key.uid);
+        if (!uidAccepted.has_value()) return false;
+        if (!*uidAccepted) continue;
+        keys->push_back(key);
+        vals->resize(keys->size() * gNCpus);
+        if (findMapEntry(mapFd, &key, vals->data() + (keys->size() - 1) * gNCpus)) return false;
+    } while (prevKey = key, !getNextMapKey(mapFd, &prevKey, &key));
+    return errno == ENOENT;
+}
+
 // Retrieve the times in ns that each uid spent running at each CPU freq.
 // Return contains no value on error, otherwise it contains a map from uids to vectors of vectors
 // using the format:
@@ -300,42 +437,34 @@ getUidsCpuFreqTimes() {
 std::optional<std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>>>
 getUidsUpdatedCpuFreqTimes(uint64_t *lastUpdate) {
     if (!gInitialized && !initGlobals()) return {};
-    time_key_t key, prevKey;
-    std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> map;
-    if (getFirstMapKey(gTisMapFd, &key)) {
-        if (errno == ENOENT) return map;
-        return std::nullopt;
-    }
+    UidUpdatedFilter filter(lastUpdate);
+    std::vector<time_key_t> keys;
+    std::vector<tis_val_t> vals;
+    if (!readMapEntries(gTisMapFd, &filter, &keys, &vals)) return {};
 
     std::vector<std::vector<uint64_t>> mapFormat;
     for (const auto &freqList : gPolicyFreqs) mapFormat.emplace_back(freqList.size(), 0);
 
-    uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    std::vector<tis_val_t> vals(gNCpus);
-    do {
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
-        }
-        if (findMapEntry(gTisMapFd, &key, vals.data())) return {};
-        if (map.find(key.uid) == map.end()) map.emplace(key.uid, mapFormat);
+    std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> map;
+    for (size_t k = 0; k < keys.size(); ++k) {
+        const auto &key = keys[k];
+        const tis_val_t *keyVals = vals.data() + k * gNCpus;
+        auto &uidTimes = map.try_emplace(key.uid, mapFormat).first->second;
 
         auto offset = key.bucket * FREQS_PER_ENTRY;
         auto nextOffset = (key.bucket + 1) * FREQS_PER_ENTRY;
         for (uint32_t i = 0; i < gNPolicies; ++i) {
             if (offset >= gPolicyFreqs[i].size()) continue;
-            auto begin = map[key.uid][i].begin() + offset;
+            auto begin = uidTimes[i].begin() + offset;
             auto end = nextOffset < gPolicyFreqs[i].size() ? begin + FREQS_PER_ENTRY :
-                map[key.uid][i].end();
+                uidTimes[i].end();
             for (const auto &cpu : gPolicyCpus[i]) {
-                std::transform(begin, end, std::begin(vals[cpu].ar), begin, std::plus<uint64_t>());
+                std::transform(begin, end, std::begin(keyVals[cpu].ar), begin,
+                               std::plus<uint64_t>());
             }
         }
-        prevKey = key;
-    } while (prevKey = key, !getNextMapKey(gTisMapFd, &prevKey, &key));
-    if (errno != ENOENT) return {};
-    if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
+    }
+    filter.commit();
     return map;
 }
 
@@ -410,60 +539,51 @@ std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsConcurrent
 std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsUpdatedConcurrentTimes(
         uint64_t *lastUpdate) {
     if (!gInitialized && !initGlobals()) return {};
-    time_key_t key, prevKey;
-    std::unordered_map<uint32_t, concurrent_time_t> ret;
-    if (getFirstMapKey(gConcurrentMapFd, &key)) {
-        if (errno == ENOENT) return ret;
-        return {};
-    }
+    UidUpdatedFilter filter(lastUpdate);
+    std::vector<time_key_t> keys;
+    std::vector<concurrent_val_t> vals;
+    if (!readMapEntries(gConcurrentMapFd, &filter, &keys, &vals)) return {};
 
     concurrent_time_t retFormat = {.active = std::vector<uint64_t>(gNCpus, 0)};
     for (const auto &cpuList : gPolicyCpus) retFormat.policy.emplace_back(cpuList.size(), 0);
 
-    std::vector<concurrent_val_t> vals(gNCpus);
-    std::vector<uint64_t>::iterator activeBegin, activeEnd, policyBegin, policyEnd;
-
-    uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    do {
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
-        }
-        if (findMapEntry(gConcurrentMapFd, &key, vals.data())) return {};
-        if (ret.find(key.uid) == ret.end()) ret.emplace(key.uid, retFormat);
+    std::unordered_map<uint32_t, concurrent_time_t> ret;
+    for (size_t k = 0; k < keys.size(); ++k) {
+        const auto &key = keys[k];
+        const concurrent_val_t *keyVals = vals.data() + k * gNCpus;
+        auto &uidTimes = ret.try_emplace(key.uid, retFormat).first->second;
 
         auto offset = key.bucket * CPUS_PER_ENTRY;
         auto nextOffset = (key.bucket + 1) * CPUS_PER_ENTRY;
 
-        activeBegin = ret[key.uid].active.begin();
-        activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : ret[key.uid].active.end();
+        auto activeBegin = uidTimes.active.begin() + offset;
+        auto activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : uidTimes.active.end();
 
         for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
-            std::transform(activeBegin, activeEnd, std::begin(vals[cpu].active), activeBegin,
+            std::transform(activeBegin, activeEnd, std::begin(keyVals[cpu].active), activeBegin,
                            std::plus<uint64_t>());
         }
 
         for (uint32_t policy = 0; policy < gNPolicies; ++policy) {
             if (offset >= gPolicyCpus[policy].size()) continue;
-            policyBegin = ret[key.uid].policy[policy].begin() + offset;
-            policyEnd = nextOffset < gPolicyCpus[policy].size() ? policyBegin + CPUS_PER_ENTRY
-                                                                : ret[key.uid].policy[policy].end();
+            auto policyBegin = uidTimes.policy[policy].begin() + offset;
+            auto policyEnd = nextOffset < gPolicyCpus[policy].size()
+                    ? policyBegin + CPUS_PER_ENTRY
+                    : uidTimes.policy[policy].end();
 
             for (const auto &cpu : gPolicyCpus[policy]) {
-                std::transform(policyBegin, policyEnd, std::begin(vals[cpu].policy), policyBegin,
-                               std::plus<uint64_t>());
+                std::transform(policyBegin, policyEnd, std::begin(keyVals[cpu].policy),
+                               policyBegin, std::plus<uint64_t>());
             }
         }
-    } while (prevKey = key, !getNextMapKey(gConcurrentMapFd, &prevKey, &key));
-    if (errno != ENOENT) return {};
+    }
     for (const auto &[key, value] : ret) {
         if (!verifyConcurrentTimes(value)) {
             auto val = getUidConcurrentTimes(key, false);
             if (val.has_value()) ret[key] = val.value();
         }
     }
-    if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
+    filter.commit();
     return ret;
 }
 
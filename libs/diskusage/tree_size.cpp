@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <diskusage/tree_size.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace diskusage {
+
+namespace {
+
+// Large enough to read most directories with a single getdents64() call.
+constexpr size_t kDirentBufferSize = 64 * 1024;
+
+// Walks a tree on several threads. Each thread keeps the directories it finds in its own queue and
+// reads the most recently found one first, which keeps the queues short; idle threads steal the
+// oldest directories from the other queues, which are the ones most likely to hold large subtrees.
+class TreeWalker {
+  public:
+    explicit TreeWalker(const TreeOptions& options);
+
+    int Walk(const std::string& path, TreeStats* stats);
+
+  private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::string> dirs;
+        TreeStats stats;
+        std::unique_ptr<char[]> buffer;
+    };
+
+    // Counts |name| in |dfd| into |stats| according to the filter. Returns false if it cannot be
+    // stat'ed; otherwise sets |descend| to whether it is a directory to walk, and |dev| to the
+    // device it is on.
+    bool Measure(int dfd, const char* name, TreeStats* stats, bool* descend, dev_t* dev);
+
+    void ReadDir(const std::string& path, size_t self);
+    void Push(size_t self, std::string path);
+    bool Pop(size_t self, std::string* path);
+    void WorkerLoop(size_t self);
+
+    const TreeOptions& mOptions;
+    const unsigned int mMask;
+    dev_t mRootDev = 0;
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    // Directories queued or being read, and directories queued only.
+    std::atomic<size_t> mPending{0};
+    std::atomic<size_t> mQueued{0};
+
+    std::mutex mIdleLock;
+    std::condition_variable mIdleCondition;
+    std::atomic<size_t> mIdle{0};
+};
+
+TreeWalker::TreeWalker(const TreeOptions& options)
+      : mOptions(options),
+        mMask(STATX_TYPE | STATX_BLOCKS | (options.filter ? STATX_UID | STATX_GID : 0) |
+              (options.want_modified ? STATX_MTIME : 0)) {
+    const size_t numWorkers = std::max<size_t>(options.max_threads, 1);
+    for (size_t i = 0; i < numWorkers; i++) {
+        mWorkers.emplace_back(new Worker());
+    }
+}
+
+bool TreeWalker::Measure(int dfd, const char* name, TreeStats* stats, bool* descend,
+                         dev_t* dev) {
+    struct statx s;
+    if (statx(dfd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_STATX_DONT_SYNC, mMask, &s)) {
+        return false;
+    }
+    const TreeVisit visit =
+            mOptions.filter ? mOptions.filter(s.stx_uid, s.stx_gid) : TreeVisit::MEASURE;
+    if (visit == TreeVisit::MEASURE) {
+        stats->size += s.stx_blocks * 512;
+        if (mOptions.want_modified) {
+            stats->modified = std::max<int64_t>(stats->modified, s.stx_mtime.tv_sec);
+        }
+    }
+    *descend = visit != TreeVisit::SKIP_TREE && S_ISDIR(s.stx_mode);
+    *dev = makedev(s.stx_dev_major, s.stx_dev_minor);
+    return true;
+}
+
+void TreeWalker::ReadDir(const std::string& path, size_t self) {
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    Worker& worker = *mWorkers[self];
+    if (worker.buffer == nullptr) {
+        worker.buffer.reset(new char[kDirentBufferSize]);
+    }
+
+    long length;
+    while ((length = syscall(SYS_getdents64, fd, worker.buffer.get(), kDirentBufferSize)) > 0) {
+        for (long offset = 0; offset < length;) {
+            const auto* de = reinterpret_cast<const struct dirent64*>(worker.buffer.get() + offset);
+            offset += de->d_reclen;
+
+            const char* name = de->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            bool descend;
+            dev_t dev;
+            if (Measure(fd, name, &worker.stats, &descend, &dev) && descend && dev == mRootDev) {
+                Push(self, path + "/" + name);
+            }
+        }
+    }
+    close(fd);
+}
+
+void TreeWalker::Push(size_t self, std::string path) {
+    // Counted as pending before it can be stolen, so that mPending cannot reach zero early.
+    mPending++;
+    {
+        std::lock_guard<std::mutex> lock(mWorkers[self]->lock);
+        mWorkers[self]->dirs.push_back(std::move(path));
+    }
+    mQueued++;
+    if (mIdle > 0) {
+        std::lock_guard<std::mutex> lock(mIdleLock);
+        mIdleCondition.notify_one();
+    }
+}
+
+bool TreeWalker::Pop(size_t self, std::string* path) {
+    {
+        Worker& worker = *mWorkers[self];
+        std::lock_guard<std::mutex> lock(worker.lock);
+        if (!worker.dirs.empty()) {
+            *path = std::move(worker.dirs.back());
+            worker.dirs.pop_back();
+            mQueued--;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < mWorkers.size(); i++) {
+        Worker& victim = *mWorkers[(self + i) % mWorkers.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.dirs.empty()) {
+            *path = std::move(victim.dirs.front());
+            victim.dirs.pop_front();
+            mQueued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TreeWalker::WorkerLoop(size_t self) {
+    std::string path;
+    while (true) {
+        if (!Pop(self, &path)) {
+            std::unique_lock<std::mutex> lock(mIdleLock);
+            mIdle++;
+            mIdleCondition.wait(lock, [this] { return mQueued > 0 || mPending == 0; });
+            mIdle--;
+            if (mPending == 0) {
+                return;
+            }
+            continue;
+        }
+        ReadDir(path, self);
+        if (--mPending == 0) {
+            std::lock_guard<std::mutex> lock(mIdleLock);
+            mIdleCondition.notify_all();
+        }
+    }
+}
+
+int TreeWalker::Walk(const std::string& path, TreeStats* stats) {
+    bool descend;
+    if (!Measure(AT_FDCWD, path.c_str(), &mWorkers[0]->stats, &descend, &mRootDev)) {
+        return -1;
+    }
+    if (descend) {
+        // The root is read on the calling thread; more threads are only worth starting once it has
+        // subdirectories to hand out.
+        ReadDir(path, 0);
+        const size_t numThreads = std::min<size_t>(mWorkers.size(), mQueued);
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < numThreads; i++) {
+            threads.emplace_back(&TreeWalker::WorkerLoop, this, i);
+        }
+        WorkerLoop(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    for (const auto& worker : mWorkers) {
+        stats->size += worker->stats.size;
+        stats->modified = std::max(stats->modified, worker->stats.modified);
+    }
+    return 0;
+}
+
+}  // namespace
+
+int calculate_tree_stats(const std::string& path, TreeStats* stats, const TreeOptions& options) {
+    TreeWalker walker(options);
+    return walker.Walk(path, stats);
+}
+
+}  // namespace diskusage
+}  // namespace android
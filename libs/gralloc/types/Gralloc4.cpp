@@ -619,6 +619,15 @@ status_t decodeBufferDescriptorInfoHelper(InputHidlVec* input, BufferDescriptorI
     return decodeInteger<uint64_t>(input, &output->reservedSize);
 }
 
+/**
+ * The smallest number of bytes a PlaneLayoutComponent, PlaneLayout or Rect can be encoded in.
+ * Decoders use these to reject counts the remaining input cannot possibly hold before they size
+ * their output, so a corrupt count never turns into a huge allocation.
+ */
+constexpr size_t kMinPlaneLayoutComponentSize = 4 * sizeof(int64_t);
+constexpr size_t kMinPlaneLayoutSize = 9 * sizeof(int64_t);
+constexpr size_t kRectSize = 4 * sizeof(int32_t);
+
 status_t encodePlaneLayoutComponent(const PlaneLayoutComponent& input, OutputHidlVec* output) {
     if (!output) {
         return BAD_VALUE;
@@ -681,7 +690,8 @@ status_t decodePlaneLayoutComponents(InputHidlVec* input, std::vector<PlaneLayou
     if (err) {
         return err;
     }
-    if (size < 0 || size > 10000) {
+    if (size < 0 || size > 10000 ||
+        static_cast<size_t>(size) > input->getRemainingSize() / kMinPlaneLayoutComponentSize) {
         return BAD_VALUE;
     }
 
@@ -800,13 +810,17 @@ status_t decodePlaneLayoutsHelper(InputHidlVec* inputHidlVec, std::vector<PlaneL
     if (err) {
         return err;
     }
-    if (size < 0) {
+    if (size < 0 ||
+        static_cast<size_t>(size) > inputHidlVec->getRemainingSize() / kMinPlaneLayoutSize) {
         return BAD_VALUE;
     }
 
-    for (size_t i = 0; i < size; i++) {
-        outPlaneLayouts->emplace_back();
-        err = decodePlaneLayout(inputHidlVec, &outPlaneLayouts->back());
+    // Decode in place so that a caller decoding into the same vector every frame reuses the
+    // storage of the previous plane layouts and their components instead of reallocating it.
+    outPlaneLayouts->resize(size);
+
+    for (auto& planeLayout : *outPlaneLayouts) {
+        err = decodePlaneLayout(inputHidlVec, &planeLayout);
         if (err) {
             return err;
         }
@@ -843,13 +857,14 @@ status_t decodeCropHelper(InputHidlVec* inputHidlVec, std::vector<Rect>* outCrop
     if (err) {
         return err;
     }
-    if (size < 0) {
+    if (size < 0 || static_cast<size_t>(size) > inputHidlVec->getRemainingSize() / kRectSize) {
         return BAD_VALUE;
     }
 
-    for (size_t i = 0; i < size; i++) {
-        outCrops->emplace_back();
-        err = decodeRect(inputHidlVec, &outCrops->back());
+    outCrops->resize(size);
+
+    for (auto& crop : *outCrops) {
+        err = decodeRect(inputHidlVec, &crop);
         if (err) {
             return err;
         }
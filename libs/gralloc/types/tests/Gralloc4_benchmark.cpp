@@ -0,0 +1,108 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <gralloctypes/Gralloc4.h>
+
+using android::hardware::hidl_vec;
+
+using aidl::android::hardware::graphics::common::PlaneLayout;
+using aidl::android::hardware::graphics::common::PlaneLayoutComponent;
+using aidl::android::hardware::graphics::common::Rect;
+
+namespace android {
+
+// The plane layouts of a 1920x1080 YCbCr_420_888 buffer, which camera and codec clients decode
+// every time they lock a buffer.
+static std::vector<PlaneLayout> makeYCbCr420PlaneLayouts() {
+    const int64_t width = 1920;
+    const int64_t height = 1080;
+    const int64_t stride = 2048;
+
+    PlaneLayout y;
+    y.components.push_back(PlaneLayoutComponent{gralloc4::PlaneLayoutComponentType_Y, 0, 8});
+    y.offsetInBytes = 0;
+    y.sampleIncrementInBits = 8;
+    y.strideInBytes = stride;
+    y.widthInSamples = width;
+    y.heightInSamples = height;
+    y.totalSizeInBytes = stride * height;
+    y.horizontalSubsampling = 1;
+    y.verticalSubsampling = 1;
+
+    PlaneLayout cbcr;
+    cbcr.components.push_back(PlaneLayoutComponent{gralloc4::PlaneLayoutComponentType_CB, 0, 8});
+    cbcr.components.push_back(PlaneLayoutComponent{gralloc4::PlaneLayoutComponentType_CR, 8, 8});
+    cbcr.offsetInBytes = y.totalSizeInBytes;
+    cbcr.sampleIncrementInBits = 16;
+    cbcr.strideInBytes = stride;
+    cbcr.widthInSamples = width / 2;
+    cbcr.heightInSamples = height / 2;
+    cbcr.totalSizeInBytes = stride * height / 2;
+    cbcr.horizontalSubsampling = 2;
+    cbcr.verticalSubsampling = 2;
+
+    return {y, cbcr};
+}
+
+static void BM_EncodePlaneLayouts(benchmark::State& state) {
+    const std::vector<PlaneLayout> planeLayouts = makeYCbCr420PlaneLayouts();
+    for (auto _ : state) {
+        hidl_vec<uint8_t> vec;
+        benchmark::DoNotOptimize(gralloc4::encodePlaneLayouts(planeLayouts, &vec));
+        benchmark::DoNotOptimize(vec.data());
+    }
+}
+BENCHMARK(BM_EncodePlaneLayouts);
+
+static void BM_DecodePlaneLayouts(benchmark::State& state) {
+    hidl_vec<uint8_t> vec;
+    gralloc4::encodePlaneLayouts(makeYCbCr420PlaneLayouts(), &vec);
+    for (auto _ : state) {
+        std::vector<PlaneLayout> planeLayouts;
+        benchmark::DoNotOptimize(gralloc4::decodePlaneLayouts(vec, &planeLayouts));
+        benchmark::DoNotOptimize(planeLayouts.data());
+    }
+}
+BENCHMARK(BM_DecodePlaneLayouts);
+
+// A client that keeps its plane layout vector across locks reuses the previous allocations.
+static void BM_DecodePlaneLayoutsReused(benchmark::State& state) {
+    hidl_vec<uint8_t> vec;
+    gralloc4::encodePlaneLayouts(makeYCbCr420PlaneLayouts(), &vec);
+    std::vector<PlaneLayout> planeLayouts;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gralloc4::decodePlaneLayouts(vec, &planeLayouts));
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_DecodePlaneLayoutsReused);
+
+static void BM_DecodeCrop(benchmark::State& state) {
+    hidl_vec<uint8_t> vec;
+    gralloc4::encodeCrop({Rect{0, 0, 1920, 1080}, Rect{0, 0, 960, 540}}, &vec);
+    std::vector<Rect> crops;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gralloc4::decodeCrop(vec, &crops));
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_DecodeCrop);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -376,6 +376,16 @@ TEST_F(Gralloc4TestCrop, Crop) {
     ASSERT_NO_FATAL_FAILURE(testHelperStableAidlType(crops, gralloc4::encodeCrop, gralloc4::decodeCrop));
 }
 
+TEST_F(Gralloc4TestCrop, CropDecodeReplacesOutput) {
+    std::vector<Rect> crops = {Rect{0, 0, 64, 64}, Rect{1, 2, 3, 4}};
+    hidl_vec<uint8_t> vec;
+    ASSERT_EQ(NO_ERROR, gralloc4::encodeCrop(crops, &vec));
+
+    std::vector<Rect> output = {Rect{5, 6, 7, 8}, Rect{9, 10, 11, 12}, Rect{13, 14, 15, 16}};
+    ASSERT_EQ(NO_ERROR, gralloc4::decodeCrop(vec, &output));
+    ASSERT_TRUE(crops == output);
+}
+
 class Gralloc4TestDataspace : public testing::TestWithParam<Dataspace> { };
 
 INSTANTIATE_TEST_CASE_P(
@@ -556,6 +566,19 @@ TEST_F(Gralloc4TestErrors, Gralloc4TestDecodeBadVec) {
     ASSERT_NE(NO_ERROR, gralloc4::decodeSmpte2094_40(vec, &smpte2094_40));
 }
 
+TEST_F(Gralloc4TestErrors, Gralloc4TestDecodeTruncatedVec) {
+    std::vector<Rect> crops = {Rect{0, 0, 64, 64}, Rect{1, 2, 3, 4}};
+    hidl_vec<uint8_t> vec;
+    ASSERT_EQ(NO_ERROR, gralloc4::encodeCrop(crops, &vec));
+
+    // Drop the last rect so the encoded count claims more rects than the vec holds.
+    hidl_vec<uint8_t> truncated;
+    truncated.setToExternal(vec.data(), vec.size() - 4 * sizeof(int32_t));
+
+    std::vector<Rect> output;
+    ASSERT_NE(NO_ERROR, gralloc4::decodeCrop(truncated, &output));
+}
+
 class Gralloc4TestHelpers : public testing::Test { };
 
 TEST_F(Gralloc4TestHelpers, Gralloc4TestIsStandard) {
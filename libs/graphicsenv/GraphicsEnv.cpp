@@ -437,6 +437,12 @@ bool GraphicsEnv::shouldUseAngle() {
         return false;
     }
 
+    // Evaluated on first use rather than in setAngleInfo(), so that only processes which load a
+    // GLES driver pay for loading ANGLE's opt-in/out logic during startup.
+    std::lock_guard<std::mutex> lock(mAngleLock);
+    if (mUseAngle == UNKNOWN) {
+        updateUseAngle();
+    }
     return (mUseAngle == YES) ? true : false;
 }
 
@@ -470,10 +476,11 @@ void GraphicsEnv::updateUseAngle() {
 void GraphicsEnv::setAngleInfo(const std::string path, const std::string appName,
                                const std::string developerOptIn, const int rulesFd,
                                const long rulesOffset, const long rulesLength) {
-    if (mUseAngle != UNKNOWN) {
-        // We've already figured out an answer for this app, so just return.
-        ALOGV("Already evaluated the rules file for '%s': use ANGLE = %s", appName.c_str(),
-              (mUseAngle == YES) ? "true" : "false");
+    std::lock_guard<std::mutex> lock(mAngleLock);
+    if (!mAngleAppName.empty()) {
+        // We've already been given the rules for this app, so just return.
+        ALOGV("Already have the rules file for '%s', ignoring the ones for '%s'",
+              mAngleAppName.c_str(), appName.c_str());
         return;
     }
 
@@ -499,9 +506,6 @@ void GraphicsEnv::setAngleInfo(const std::string path, const std::string appName
               rulesLength, numBytesRead);
     }
     mRulesBuffer[numBytesRead] = '\0';
-
-    // Update the current status of whether we should use ANGLE or not
-    updateUseAngle();
 }
 
 void GraphicsEnv::setLayerPaths(NativeLoaderNamespace* appNamespace, const std::string layerPaths) {
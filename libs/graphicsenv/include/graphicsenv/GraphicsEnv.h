@@ -96,6 +96,7 @@ public:
     // (libraries must be stored uncompressed and page aligned); such elements
     // in the search path must have a '!' after the zip filename, e.g.
     //     /system/app/ANGLEPrebuilt/ANGLEPrebuilt.apk!/lib/arm64-v8a
+    // The rules are only read here; they are evaluated by the first shouldUseAngle() call.
     void setAngleInfo(const std::string path, const std::string appName, std::string devOptIn,
                       const int rulesFd, const long rulesOffset, const long rulesLength);
     // Get the ANGLE driver namespace.
@@ -128,7 +129,7 @@ private:
     void* loadLibrary(std::string name);
     // Check ANGLE support with the rules.
     bool checkAngleRules(void* so);
-    // Update whether ANGLE should be used.
+    // Update whether ANGLE should be used. Called with mAngleLock held.
     void updateUseAngle();
     // Link updatable driver namespace with llndk and vndk-sp libs.
     bool linkDriverNamespaceLocked(android_namespace_t* vndkNamespace);
@@ -156,7 +157,9 @@ private:
     std::string mAngleDeveloperOptIn;
     // ANGLE rules.
     std::vector<char> mRulesBuffer;
-    // Use ANGLE flag.
+    // This mutex protects setting up the ANGLE info and evaluating mUseAngle.
+    std::mutex mAngleLock;
+    // Use ANGLE flag, evaluated by the first shouldUseAngle() call.
     UseAngle mUseAngle = UNKNOWN;
     // Vulkan debug layers libs.
     std::string mDebugLayers;
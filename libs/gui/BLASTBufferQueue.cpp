@@ -44,6 +44,10 @@ void BLASTBufferItemConsumer::onDisconnect() {
 void BLASTBufferItemConsumer::addAndGetFrameTimestamps(const NewFrameEventsEntry* newTimestamps,
                                                        FrameEventHistoryDelta* outDelta) {
     Mutex::Autolock lock(mFrameEventHistoryMutex);
+    if (outDelta) {
+        // Record the frame queued along with the request, if any.
+        mFrameEventHistory.setProducerWantsEvents();
+    }
     if (newTimestamps) {
         // BufferQueueProducer only adds a new timestamp on
         // queueBuffer
@@ -190,12 +194,21 @@ void BLASTBufferQueue::transactionCallback(nsecs_t /*latchTime*/, const sp<Fence
     processNextBufferLocked(false);
 
     mCallbackCV.notify_all();
+
+    if (mFramePresentedListener && !stats.empty()) {
+        FramePresentedListener listener = mFramePresentedListener;
+        const BufferItem& item = mPendingReleaseItem.item;
+        const uint64_t frameNumber = item.mFrameNumber;
+        const nsecs_t timestamp = item.mTimestamp;
+        _lock.unlock();
+        listener(frameNumber, timestamp, stats[0].latchTime, stats[0].presentFence);
+    }
     decStrong((void*)transactionCallbackThunk);
 }
 
 void BLASTBufferQueue::processNextBufferLocked(bool useNextTransaction) {
     ATRACE_CALL();
-    if (mNumFrameAvailable == 0 || mNumAcquired == MAX_ACQUIRED_BUFFERS + 1) {
+    if (mNumFrameAvailable == 0 || mNumAcquired >= mMaxAcquiredBuffers + 1) {
         return;
     }
 
@@ -219,9 +232,30 @@ void BLASTBufferQueue::processNextBufferLocked(bool useNextTransaction) {
     if (status != OK) {
         return;
     }
-    auto buffer = bufferItem.mGraphicBuffer;
     mNumFrameAvailable--;
 
+    // Merge the frames queued since the previous transaction into one, keeping the latest. A
+    // superseded buffer was never read, so it is released with its own acquire fence.
+    if (mDropSupersededFrames && applyTransaction && mNumFrameAvailable > 0) {
+        mNumMergedTransactions++;
+        while (mNumFrameAvailable > 0) {
+            mBufferItemConsumer->releaseBuffer(bufferItem,
+                                               bufferItem.mFence ? bufferItem.mFence
+                                                                 : Fence::NO_FENCE);
+            mNumDroppedFrames++;
+            status = mBufferItemConsumer->acquireBuffer(&bufferItem, -1, false);
+            if (status != OK) {
+                ALOGE("Failed to acquire the frame superseding a dropped frame: %d", status);
+                mNumFrameAvailable = 0;
+                return;
+            }
+            mNumFrameAvailable--;
+        }
+        ATRACE_INT("BLAST dropped frames", static_cast<int32_t>(mNumDroppedFrames));
+    }
+
+    auto buffer = bufferItem.mGraphicBuffer;
+
     if (buffer == nullptr) {
         mBufferItemConsumer->releaseBuffer(bufferItem, Fence::NO_FENCE);
         return;
@@ -269,7 +303,7 @@ void BLASTBufferQueue::onFrameAvailable(const BufferItem& /*item*/) {
     std::unique_lock _lock{mMutex};
 
     if (mNextTransaction != nullptr) {
-        while (mNumFrameAvailable > 0 || mNumAcquired == MAX_ACQUIRED_BUFFERS + 1) {
+        while (mNumFrameAvailable > 0 || mNumAcquired >= mMaxAcquiredBuffers + 1) {
             mCallbackCV.wait(_lock);
         }
     }
@@ -283,4 +317,34 @@ void BLASTBufferQueue::setNextTransaction(SurfaceComposerClient::Transaction* t)
     mNextTransaction = t;
 }
 
+status_t BLASTBufferQueue::setMaxInFlightTransactions(int32_t count) {
+    std::lock_guard _lock{mMutex};
+    if (count < 1) {
+        ALOGE("setMaxInFlightTransactions: invalid count %d", count);
+        return BAD_VALUE;
+    }
+
+    // The buffer presented by the last completed transaction stays acquired until the next one
+    // completes, which BufferQueue already accounts for by allowing one more than the max.
+    status_t status = mBufferItemConsumer->setMaxAcquiredBufferCount(count);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    mMaxAcquiredBuffers = count;
+    // More frames may be sent now.
+    processNextBufferLocked(false);
+    mCallbackCV.notify_all();
+    return NO_ERROR;
+}
+
+void BLASTBufferQueue::setFramePresentedListener(FramePresentedListener listener) {
+    std::lock_guard _lock{mMutex};
+    mFramePresentedListener = std::move(listener);
+}
+
+void BLASTBufferQueue::setDropSupersededFrames(bool drop) {
+    std::lock_guard _lock{mMutex};
+    mDropSupersededFrames = drop;
+}
+
 } // namespace android
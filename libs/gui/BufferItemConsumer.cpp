@@ -85,6 +85,47 @@ status_t BufferItemConsumer::acquireBuffer(BufferItem *item,
     return OK;
 }
 
+status_t BufferItemConsumer::acquireLatestBuffer(BufferItem* item,
+        bool waitForFence) {
+    status_t err;
+
+    if (!item) return BAD_VALUE;
+
+    Mutex::Autolock _l(mMutex);
+
+    err = acquireBufferLocked(item, 0);
+    if (err != OK) {
+        if (err != NO_BUFFER_AVAILABLE) {
+            BI_LOGE("Error acquiring buffer: %s (%d)", strerror(err), err);
+        }
+        return err;
+    }
+
+    // The dropped buffers were never read, so releasing them with the fences
+    // they were acquired with is enough.
+    BufferItem next;
+    while (acquireBufferLocked(&next, 0) == OK) {
+        BI_LOGV("acquireLatestBuffer: dropping frame %" PRIu64,
+                item->mFrameNumber);
+        releaseBufferLocked(item->mSlot, mSlots[item->mSlot].mGraphicBuffer,
+                EGL_NO_DISPLAY, EGL_NO_SYNC_KHR);
+        *item = next;
+    }
+
+    if (waitForFence) {
+        err = item->mFence->waitForever("BufferItemConsumer::acquireLatestBuffer");
+        if (err != OK) {
+            BI_LOGE("Failed to wait for fence of acquired buffer: %s (%d)",
+                    strerror(-err), err);
+            return err;
+        }
+    }
+
+    item->mGraphicBuffer = mSlots[item->mSlot].mGraphicBuffer;
+
+    return OK;
+}
+
 status_t BufferItemConsumer::releaseBuffer(const BufferItem &item,
         const sp<Fence>& releaseFence) {
     status_t err;
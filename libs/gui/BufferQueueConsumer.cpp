@@ -82,7 +82,8 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
     int numDroppedBuffers = 0;
     sp<IProducerListener> listener;
     {
-        std::unique_lock<std::mutex> lock(mCore->mMutex);
+        std::unique_lock<std::mutex> lock =
+                mCore->lockForOperation(BufferQueueCore::LockedOperation::Acquire);
 
         // Check that the consumer doesn't currently have the maximum number of
         // buffers acquired. We allow the max buffer count to be exceeded by one
@@ -257,6 +258,12 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
         } else {
             slot = front->mSlot;
             *outBuffer = *front;
+#ifndef NO_BINDER
+            if (!outBuffer->mIsStale && mSlots[slot].mQueueTime > 0) {
+                mCore->mOccupancyTracker.registerAcquireWait(systemTime() -
+                                                             mSlots[slot].mQueueTime);
+            }
+#endif
         }
 
         ATRACE_BUFFER_INDEX(slot);
@@ -286,11 +293,6 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
 
         mCore->mQueue.erase(front);
 
-        // We might have freed a slot while dropping old buffers, or the producer
-        // may be blocked waiting for the number of buffers in the queue to
-        // decrease.
-        mCore->mDequeueCondition.notify_all();
-
         ATRACE_INT(mCore->mConsumerName.string(),
                 static_cast<int32_t>(mCore->mQueue.size()));
 #ifndef NO_BINDER
@@ -299,6 +301,12 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
         VALIDATE_CONSISTENCY();
     }
 
+    // We might have freed a slot while dropping old buffers, or the producer
+    // may be blocked waiting for the number of buffers in the queue to
+    // decrease. This is done without the lock held, so that the producer does
+    // not wake up only to block on it.
+    mCore->mDequeueCondition.notify_all();
+
     if (listener != nullptr) {
         for (int i = 0; i < numDroppedBuffers; ++i) {
             listener->onBufferReleased();
@@ -448,7 +456,8 @@ status_t BufferQueueConsumer::releaseBuffer(int slot, uint64_t frameNumber,
 
     sp<IProducerListener> listener;
     { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        std::unique_lock<std::mutex> lock =
+                mCore->lockForOperation(BufferQueueCore::LockedOperation::Release);
 
         // If the frame number has changed because the buffer has been reallocated,
         // we can ignore this releaseBuffer for the old buffer.
@@ -489,10 +498,13 @@ status_t BufferQueueConsumer::releaseBuffer(int slot, uint64_t frameNumber,
         }
         BQ_LOGV("releaseBuffer: releasing slot %d", slot);
 
-        mCore->mDequeueCondition.notify_all();
         VALIDATE_CONSISTENCY();
     } // Autolock scope
 
+    // Wake up the producer without the lock held, so that it does not block on
+    // it straight away.
+    mCore->mDequeueCondition.notify_all();
+
     // Call back without lock held
     if (listener != nullptr) {
         listener->onBufferReleased();
@@ -161,6 +161,18 @@ void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const
     outResult->appendFormat("%s  mTransformHintInUse=%02x mAutoPrerotation=%d\n", prefix.string(),
                             mTransformHintInUse, mAutoPrerotation);
 
+    static constexpr const char* kLockedOperationNames[] = {"dequeue", "queue", "acquire",
+                                                            "release"};
+    static_assert(std::size(kLockedOperationNames) == static_cast<size_t>(LockedOperation::Count));
+    outResult->appendFormat("%s  lock contention (contended/locks, wait):", prefix.string());
+    for (size_t i = 0; i < mLockContention.size(); i++) {
+        const LockContention& contention = mLockContention[i];
+        outResult->appendFormat(" %s=%" PRIu64 "/%" PRIu64 " %.3fms", kLockedOperationNames[i],
+                                contention.contendedCount, contention.lockCount,
+                                static_cast<double>(contention.waitTime) / 1e6);
+    }
+    outResult->append("\n");
+
     outResult->appendFormat("%sFIFO(%zu):\n", prefix.string(), mQueue.size());
 
     outResult->appendFormat("%s(mConsumerName=%s, ", prefix.string(), mConsumerName.string());
@@ -222,6 +234,19 @@ void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const
     }
 }
 
+std::unique_lock<std::mutex> BufferQueueCore::lockForOperation(LockedOperation operation) {
+    std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+    LockContention& contention = mLockContention[static_cast<size_t>(operation)];
+    if (!lock.owns_lock()) {
+        const nsecs_t waitStart = systemTime();
+        lock.lock();
+        contention.contendedCount++;
+        contention.waitTime += systemTime() - waitStart;
+    }
+    contention.lockCount++;
+    return lock;
+}
+
 int BufferQueueCore::getMinUndequeuedBufferCountLocked() const {
     // If dequeueBuffer is allowed to error out, we don't have to add an
     // extra buffer.
@@ -381,21 +381,6 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
                                             uint64_t usage, uint64_t* outBufferAge,
                                             FrameEventHistoryDelta* outTimestamps) {
     ATRACE_CALL();
-    { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
-        mConsumerName = mCore->mConsumerName;
-
-        if (mCore->mIsAbandoned) {
-            BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
-            return NO_INIT;
-        }
-
-        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
-            BQ_LOGE("dequeueBuffer: BufferQueue has no connected producer");
-            return NO_INIT;
-        }
-    } // Autolock scope
-
     BQ_LOGV("dequeueBuffer: w=%u h=%u format=%#x, usage=%#" PRIx64, width, height, format, usage);
 
     if ((width && !height) || (!width && height)) {
@@ -409,7 +394,21 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
     bool attachedByConsumer = false;
 
     { // Autolock scope
-        std::unique_lock<std::mutex> lock(mCore->mMutex);
+        // When a free buffer is available, this is the only time the lock is
+        // taken, so keep the checks that need it in the same scope.
+        std::unique_lock<std::mutex> lock =
+                mCore->lockForOperation(BufferQueueCore::LockedOperation::Dequeue);
+        mConsumerName = mCore->mConsumerName;
+
+        if (mCore->mIsAbandoned) {
+            BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
+            return NO_INIT;
+        }
+
+        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+            BQ_LOGE("dequeueBuffer: BufferQueue has no connected producer");
+            return NO_INIT;
+        }
 
         // If we don't have a free buffer, but we are currently allocating, we wait until allocation
         // is finished such that we don't allocate in parallel.
@@ -438,6 +437,7 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
         }
 
         int found = BufferItem::INVALID_BUFFER_SLOT;
+        const nsecs_t waitStart = systemTime();
         while (found == BufferItem::INVALID_BUFFER_SLOT) {
             status_t status = waitForFreeSlotThenRelock(FreeSlotCaller::Dequeue, lock, &found);
             if (status != NO_ERROR) {
@@ -469,6 +469,9 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
                 }
             }
         }
+#ifndef NO_BINDER
+        mCore->mOccupancyTracker.registerDequeueWait(systemTime() - waitStart);
+#endif
 
         const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
         if (mCore->mSharedBufferSlot == found &&
@@ -845,7 +848,8 @@ status_t BufferQueueProducer::queueBuffer(int slot,
     uint64_t currentFrameNumber = 0;
     BufferItem item;
     { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+        std::unique_lock<std::mutex> lock =
+                mCore->lockForOperation(BufferQueueCore::LockedOperation::Queue);
 
         if (mCore->mIsAbandoned) {
             BQ_LOGE("queueBuffer: BufferQueue has been abandoned");
@@ -903,6 +907,7 @@ status_t BufferQueueProducer::queueBuffer(int slot,
 
         mSlots[slot].mFence = acquireFence;
         mSlots[slot].mBufferState.queue();
+        mSlots[slot].mQueueTime = systemTime();
 
         // Increment the frame counter and store a local version of it
         // for use outside the lock on mCore->mMutex.
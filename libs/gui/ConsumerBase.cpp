@@ -149,6 +149,13 @@ void ConsumerBase::onFrameAvailable(const BufferItem& item) {
     sp<FrameAvailableListener> listener;
     { // scope for the lock
         Mutex::Autolock lock(mFrameAvailableMutex);
+        if (mCoalesceFrameAvailable) {
+            if (mFrameAvailablePending) {
+                CB_LOGV("onFrameAvailable: already notified since last acquire");
+                return;
+            }
+            mFrameAvailablePending = true;
+        }
         listener = mFrameAvailableListener.promote();
     }
 
@@ -241,6 +248,13 @@ void ConsumerBase::setFrameAvailableListener(
     mFrameAvailableListener = listener;
 }
 
+void ConsumerBase::setFrameAvailableCoalescing(bool enabled) {
+    CB_LOGV("setFrameAvailableCoalescing: %d", enabled);
+    Mutex::Autolock lock(mFrameAvailableMutex);
+    mCoalesceFrameAvailable = enabled;
+    mFrameAvailablePending = false;
+}
+
 status_t ConsumerBase::detachBuffer(int slot) {
     CB_LOGV("detachBuffer");
     Mutex::Autolock lock(mMutex);
@@ -389,6 +403,13 @@ status_t ConsumerBase::acquireBufferLocked(BufferItem *item,
         return NO_INIT;
     }
 
+    { // scope for the lock
+        // Cleared before acquiring, so that frames queued from now on are
+        // notified even if this acquire does not take them.
+        Mutex::Autolock lock(mFrameAvailableMutex);
+        mFrameAvailablePending = false;
+    }
+
     status_t err = mConsumer->acquireBuffer(item, presentWhen, maxFrameNumber);
     if (err != NO_ERROR) {
         return err;
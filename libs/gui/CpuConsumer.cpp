@@ -22,6 +22,9 @@
 
 #include <gui/BufferItem.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include <algorithm>
 
 #define CC_LOGV(x, ...) ALOGV("[%s] " x, mName.string(), ##__VA_ARGS__)
 //#define CC_LOGD(x, ...) ALOGD("[%s] " x, mName.string(), ##__VA_ARGS__)
@@ -87,7 +90,17 @@ static bool isPossiblyYUV(PixelFormat format) {
     }
 }
 
-status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const {
+static void copyItemMetadata(const BufferItem& item, CpuConsumer::LockedBuffer* outBuffer) {
+    outBuffer->crop = item.mCrop;
+    outBuffer->transform = item.mTransform;
+    outBuffer->scalingMode = item.mScalingMode;
+    outBuffer->timestamp = item.mTimestamp;
+    outBuffer->dataSpace = item.mDataSpace;
+    outBuffer->frameNumber = item.mFrameNumber;
+}
+
+status_t CpuConsumer::lockBufferItem(const BufferItem& item, const Rect& lockRect,
+                                     LockedBuffer* outBuffer) const {
     android_ycbcr ycbcr = android_ycbcr();
 
     PixelFormat format = item.mGraphicBuffer->getPixelFormat();
@@ -95,7 +108,7 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
     if (isPossiblyYUV(format)) {
         int fenceFd = item.mFence.get() ? item.mFence->dup() : -1;
         status_t err = item.mGraphicBuffer->lockAsyncYCbCr(GraphicBuffer::USAGE_SW_READ_OFTEN,
-                                                           item.mCrop, &ycbcr, fenceFd);
+                                                           lockRect, &ycbcr, fenceFd);
         if (err == OK) {
             flexFormat = HAL_PIXEL_FORMAT_YCbCr_420_888;
             if (format != HAL_PIXEL_FORMAT_YCbCr_420_888) {
@@ -119,7 +132,7 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
         void* bufferPointer = nullptr;
         int fenceFd = item.mFence.get() ? item.mFence->dup() : -1;
         status_t err = item.mGraphicBuffer->lockAsync(GraphicBuffer::USAGE_SW_READ_OFTEN,
-                                                      item.mCrop, &bufferPointer, fenceFd);
+                                                      lockRect, &bufferPointer, fenceFd);
         if (err != OK) {
             CC_LOGE("Unable to lock buffer for CPU reading: %s (%d)", strerror(-err), err);
             return err;
@@ -138,12 +151,7 @@ status_t CpuConsumer::lockBufferItem(const BufferItem& item, LockedBuffer* outBu
     outBuffer->format = format;
     outBuffer->flexFormat = flexFormat;
 
-    outBuffer->crop = item.mCrop;
-    outBuffer->transform = item.mTransform;
-    outBuffer->scalingMode = item.mScalingMode;
-    outBuffer->timestamp = item.mTimestamp;
-    outBuffer->dataSpace = item.mDataSpace;
-    outBuffer->frameNumber = item.mFrameNumber;
+    copyItemMetadata(item, outBuffer);
 
     return OK;
 }
@@ -176,10 +184,39 @@ status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
         b.mGraphicBuffer = mSlots[b.mSlot].mGraphicBuffer;
     }
 
-    err = lockBufferItem(b, nativeBuffer);
-    if (err != OK) {
-        return err;
+    SlotMapping& mapping = mSlotMappings[b.mSlot];
+    const nsecs_t mapStart = systemTime();
+    if (mapping.mGraphicBuffer != nullptr && mapping.mGraphicBuffer == b.mGraphicBuffer) {
+        // The buffer is still mapped; only wait for the producer to finish.
+        if (b.mFence.get()) {
+            err = b.mFence->waitForever("CpuConsumer::lockNextBuffer");
+            if (err != OK) {
+                CC_LOGE("Error waiting for acquire fence: %s (%d)", strerror(-err), err);
+                releaseBufferLocked(b.mSlot, b.mGraphicBuffer);
+                return err;
+            }
+        }
+        *nativeBuffer = mapping.mLockedBuffer;
+        copyItemMetadata(b, nativeBuffer);
+        mMappingStats.reuseCount++;
+    } else {
+        unmapSlotLocked(b.mSlot);
+
+        // A persistent mapping may be reused with any crop, so map the whole buffer.
+        const Rect lockRect = mPersistentMapping ? b.mGraphicBuffer->getBounds() : b.mCrop;
+        err = lockBufferItem(b, lockRect, nativeBuffer);
+        if (err != OK) {
+            return err;
+        }
+        if (mPersistentMapping) {
+            mapping.mGraphicBuffer = b.mGraphicBuffer;
+            mapping.mLockedBuffer = *nativeBuffer;
+        }
+        mMappingStats.mapCount++;
     }
+    const nsecs_t mapTime = systemTime() - mapStart;
+    mMappingStats.mapTime += mapTime;
+    mMappingStats.maxMapTime = std::max(mMappingStats.maxMapTime, mapTime);
 
     // find an unused AcquiredBuffer
     size_t lockedIdx = findAcquiredBufferLocked(AcquiredBuffer::kUnusedId);
@@ -208,16 +245,24 @@ status_t CpuConsumer::unlockBuffer(const LockedBuffer &nativeBuffer) {
 
     AcquiredBuffer& ab = mAcquiredBuffers.editItemAt(lockedIdx);
 
-    int fenceFd = -1;
-    status_t err = ab.mGraphicBuffer->unlockAsync(&fenceFd);
-    if (err != OK) {
-        CC_LOGE("%s: Unable to unlock graphic buffer %zd", __FUNCTION__,
-                lockedIdx);
-        return err;
-    }
+    // Persistently mapped buffers stay locked; the CPU is done reading them once
+    // unlockBuffer is called, so they are released without a fence.
+    const bool persistent = ab.mSlot != BufferQueue::INVALID_BUFFER_SLOT &&
+            mSlotMappings[ab.mSlot].mGraphicBuffer == ab.mGraphicBuffer;
+    if (!persistent) {
+        int fenceFd = -1;
+        const nsecs_t unmapStart = systemTime();
+        status_t err = ab.mGraphicBuffer->unlockAsync(&fenceFd);
+        mMappingStats.unmapTime += systemTime() - unmapStart;
+        if (err != OK) {
+            CC_LOGE("%s: Unable to unlock graphic buffer %zd", __FUNCTION__,
+                    lockedIdx);
+            return err;
+        }
 
-    sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
-    addReleaseFenceLocked(ab.mSlot, ab.mGraphicBuffer, fence);
+        sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
+        addReleaseFenceLocked(ab.mSlot, ab.mGraphicBuffer, fence);
+    }
     releaseBufferLocked(ab.mSlot, ab.mGraphicBuffer);
 
     ab.reset();
@@ -227,4 +272,66 @@ status_t CpuConsumer::unlockBuffer(const LockedBuffer &nativeBuffer) {
     return OK;
 }
 
+void CpuConsumer::setPersistentMappingEnabled(bool enabled) {
+    Mutex::Autolock _l(mMutex);
+    if (mPersistentMapping == enabled) {
+        return;
+    }
+    mPersistentMapping = enabled;
+    if (enabled) {
+        return;
+    }
+
+    // Buffers that are still locked by the user are unlocked when they are
+    // returned, as their slot no longer holds a mapping.
+    for (size_t i = 0; i < mMaxLockedBuffers; i++) {
+        const auto& ab = mAcquiredBuffers[i];
+        if (ab.mSlot != BufferQueue::INVALID_BUFFER_SLOT) {
+            mSlotMappings[ab.mSlot].mGraphicBuffer.clear();
+        }
+    }
+    for (int slot = 0; slot < BufferQueue::NUM_BUFFER_SLOTS; slot++) {
+        unmapSlotLocked(slot);
+    }
+}
+
+CpuConsumer::MappingStats CpuConsumer::getMappingStats() const {
+    Mutex::Autolock _l(mMutex);
+    return mMappingStats;
+}
+
+status_t CpuConsumer::unmapSlotLocked(int slot) {
+    SlotMapping& mapping = mSlotMappings[slot];
+    if (mapping.mGraphicBuffer == nullptr) {
+        return OK;
+    }
+
+    const nsecs_t unmapStart = systemTime();
+    status_t err = mapping.mGraphicBuffer->unlock();
+    mMappingStats.unmapTime += systemTime() - unmapStart;
+    if (err != OK) {
+        CC_LOGE("%s: Unable to unmap buffer in slot %d", __FUNCTION__, slot);
+    }
+    mapping.mGraphicBuffer.clear();
+    mapping.mLockedBuffer = LockedBuffer();
+    return err;
+}
+
+void CpuConsumer::freeBufferLocked(int slotIndex) {
+    // A buffer still locked by the user is unlocked when it is returned.
+    bool inUse = false;
+    for (size_t i = 0; i < mMaxLockedBuffers; i++) {
+        if (mAcquiredBuffers[i].mSlot == slotIndex) {
+            inUse = true;
+        }
+    }
+    if (inUse) {
+        mSlotMappings[slotIndex].mGraphicBuffer.clear();
+        mSlotMappings[slotIndex].mLockedBuffer = LockedBuffer();
+    } else {
+        unmapSlotLocked(slotIndex);
+    }
+    ConsumerBase::freeBufferLocked(slotIndex);
+}
+
 } // namespace android
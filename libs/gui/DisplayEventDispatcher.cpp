@@ -16,6 +16,7 @@
 
 #define LOG_TAG "DisplayEventDispatcher"
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstdint>
 
@@ -28,7 +29,7 @@
 
 namespace android {
 
-// Number of events to read at a time from the DisplayEventDispatcher pipe.
+// Default number of events to read at a time from the DisplayEventDispatcher pipe.
 // The value should be large enough that we can quickly drain the pipe
 // using just a few large reads.
 static const size_t EVENT_BUFFER_SIZE = 100;
@@ -36,7 +37,10 @@ static const size_t EVENT_BUFFER_SIZE = 100;
 DisplayEventDispatcher::DisplayEventDispatcher(const sp<Looper>& looper,
                                                ISurfaceComposer::VsyncSource vsyncSource,
                                                ISurfaceComposer::ConfigChanged configChanged)
-      : mLooper(looper), mReceiver(vsyncSource, configChanged), mWaitingForVsync(false) {
+      : mLooper(looper),
+        mReceiver(vsyncSource, configChanged),
+        mWaitingForVsync(false),
+        mEventBuffer(EVENT_BUFFER_SIZE) {
     ALOGV("dispatcher %p ~ Initializing display event dispatcher.", this);
 }
 
@@ -70,12 +74,11 @@ status_t DisplayEventDispatcher::scheduleVsync() {
         ALOGV("dispatcher %p ~ Scheduling vsync.", this);
 
         // Drain all pending events.
-        nsecs_t vsyncTimestamp;
-        PhysicalDisplayId vsyncDisplayId;
-        uint32_t vsyncCount;
-        if (processPendingEvents(&vsyncTimestamp, &vsyncDisplayId, &vsyncCount)) {
+        const std::vector<PendingVsync> vsyncs = processPendingEvents();
+        if (!vsyncs.empty()) {
             ALOGE("dispatcher %p ~ last event processed while scheduling was for %" PRId64 "", this,
-                  ns2ms(static_cast<nsecs_t>(vsyncTimestamp)));
+                  ns2ms(static_cast<nsecs_t>(vsyncs.back().timestamp)));
+            mDroppedVsyncCount += vsyncs.size();
         }
 
         status_t status = mReceiver.requestNextVsync();
@@ -97,6 +100,10 @@ int DisplayEventDispatcher::getFd() const {
     return mReceiver.getFd();
 }
 
+void DisplayEventDispatcher::setEventBatchSize(size_t size) {
+    mEventBuffer.resize(std::max(size, size_t(1)));
+}
+
 int DisplayEventDispatcher::handleEvent(int, int events, void*) {
     if (events & (Looper::EVENT_ERROR | Looper::EVENT_HANGUP)) {
         ALOGE("Display event receiver pipe was closed or an error occurred.  "
@@ -112,40 +119,45 @@ int DisplayEventDispatcher::handleEvent(int, int events, void*) {
         return 1; // keep the callback
     }
 
-    // Drain all pending events, keep the last vsync.
-    nsecs_t vsyncTimestamp;
-    PhysicalDisplayId vsyncDisplayId;
-    uint32_t vsyncCount;
-    if (processPendingEvents(&vsyncTimestamp, &vsyncDisplayId, &vsyncCount)) {
+    // Drain all pending events, keep the last vsync of each display.
+    const std::vector<PendingVsync> vsyncs = processPendingEvents();
+    if (!vsyncs.empty()) {
+        mWaitingForVsync = false;
+    }
+    for (const auto& [vsyncTimestamp, vsyncDisplayId, vsyncCount] : vsyncs) {
         ALOGV("dispatcher %p ~ Vsync pulse: timestamp=%" PRId64
               ", displayId=%" ANDROID_PHYSICAL_DISPLAY_ID_FORMAT ", count=%d",
               this, ns2ms(vsyncTimestamp), vsyncDisplayId, vsyncCount);
-        mWaitingForVsync = false;
         dispatchVsync(vsyncTimestamp, vsyncDisplayId, vsyncCount);
     }
 
     return 1; // keep the callback
 }
 
-bool DisplayEventDispatcher::processPendingEvents(nsecs_t* outTimestamp,
-                                                  PhysicalDisplayId* outDisplayId,
-                                                  uint32_t* outCount) {
-    bool gotVsync = false;
-    DisplayEventReceiver::Event buf[EVENT_BUFFER_SIZE];
+std::vector<DisplayEventDispatcher::PendingVsync> DisplayEventDispatcher::processPendingEvents() {
+    std::vector<PendingVsync> vsyncs;
     ssize_t n;
-    while ((n = mReceiver.getEvents(buf, EVENT_BUFFER_SIZE)) > 0) {
+    while ((n = mReceiver.getEvents(mEventBuffer.data(), mEventBuffer.size())) > 0) {
         ALOGV("dispatcher %p ~ Read %d events.", this, int(n));
         for (ssize_t i = 0; i < n; i++) {
-            const DisplayEventReceiver::Event& ev = buf[i];
+            const DisplayEventReceiver::Event& ev = mEventBuffer[i];
             switch (ev.header.type) {
-                case DisplayEventReceiver::DISPLAY_EVENT_VSYNC:
+                case DisplayEventReceiver::DISPLAY_EVENT_VSYNC: {
                     // Later vsync events will just overwrite the info from earlier
-                    // ones. That's fine, we only care about the most recent.
-                    gotVsync = true;
-                    *outTimestamp = ev.header.timestamp;
-                    *outDisplayId = ev.header.displayId;
-                    *outCount = ev.vsync.count;
+                    // ones of the same display. That's fine, we only care about the
+                    // most recent.
+                    const PendingVsync vsync{ev.header.timestamp, ev.header.displayId,
+                                             ev.vsync.count};
+                    auto it = std::find_if(vsyncs.begin(), vsyncs.end(), [&](const auto& v) {
+                        return v.displayId == vsync.displayId;
+                    });
+                    if (it != vsyncs.end()) {
+                        vsyncs.erase(it);
+                        mDroppedVsyncCount++;
+                    }
+                    vsyncs.push_back(vsync);
                     break;
+                }
                 case DisplayEventReceiver::DISPLAY_EVENT_HOTPLUG:
                     dispatchHotplug(ev.header.timestamp, ev.header.displayId, ev.hotplug.connected);
                     break;
@@ -165,7 +177,7 @@ bool DisplayEventDispatcher::processPendingEvents(nsecs_t* outTimestamp,
     if (n < 0) {
         ALOGW("Failed to get events from display event dispatcher, status=%d", status_t(n));
     }
-    return gotVsync;
+    return vsyncs;
 }
 
 } // namespace android
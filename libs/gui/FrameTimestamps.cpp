@@ -362,6 +362,7 @@ ConsumerFrameEventHistory::~ConsumerFrameEventHistory() = default;
 void ConsumerFrameEventHistory::onDisconnect() {
     mCurrentConnectId++;
     mProducerWantsEvents = false;
+    mFirstRecordedFrameNumber = std::numeric_limits<uint64_t>::max();
 }
 
 void ConsumerFrameEventHistory::setProducerWantsEvents() {
@@ -373,7 +374,18 @@ void ConsumerFrameEventHistory::initializeCompositorTiming(
     mCompositorTiming = compositorTiming;
 }
 
+bool ConsumerFrameEventHistory::isRecordedFrame(uint64_t frameNumber) const {
+    return mProducerWantsEvents && frameNumber >= mFirstRecordedFrameNumber;
+}
+
 void ConsumerFrameEventHistory::addQueue(const NewFrameEventsEntry& newEntry) {
+    if (!mProducerWantsEvents) {
+        return;
+    }
+    if (mFirstRecordedFrameNumber == std::numeric_limits<uint64_t>::max()) {
+        mFirstRecordedFrameNumber = newEntry.frameNumber;
+    }
+
     // Overwrite all fields of the frame with default values unless set here.
     FrameEvents newTimestamps;
     newTimestamps.connectId = mCurrentConnectId;
@@ -396,7 +408,7 @@ void ConsumerFrameEventHistory::addLatch(
         uint64_t frameNumber, nsecs_t latchTime) {
     FrameEvents* frame = getFrame(frameNumber, &mCompositionOffset);
     if (frame == nullptr) {
-        ALOGE_IF(mProducerWantsEvents, "addLatch: Did not find frame.");
+        ALOGE_IF(isRecordedFrame(frameNumber), "addLatch: Did not find frame.");
         return;
     }
     frame->latchTime = latchTime;
@@ -407,7 +419,7 @@ void ConsumerFrameEventHistory::addPreComposition(
         uint64_t frameNumber, nsecs_t refreshStartTime) {
     FrameEvents* frame = getFrame(frameNumber, &mCompositionOffset);
     if (frame == nullptr) {
-        ALOGE_IF(mProducerWantsEvents,
+        ALOGE_IF(isRecordedFrame(frameNumber),
                 "addPreComposition: Did not find frame.");
         return;
     }
@@ -427,7 +439,7 @@ void ConsumerFrameEventHistory::addPostComposition(uint64_t frameNumber,
 
     FrameEvents* frame = getFrame(frameNumber, &mCompositionOffset);
     if (frame == nullptr) {
-        ALOGE_IF(mProducerWantsEvents,
+        ALOGE_IF(isRecordedFrame(frameNumber),
                 "addPostComposition: Did not find frame.");
         return;
     }
@@ -447,7 +459,7 @@ void ConsumerFrameEventHistory::addRelease(uint64_t frameNumber,
         nsecs_t dequeueReadyTime, std::shared_ptr<FenceTime>&& release) {
     FrameEvents* frame = getFrame(frameNumber, &mReleaseOffset);
     if (frame == nullptr) {
-        ALOGE_IF(mProducerWantsEvents, "addRelease: Did not find frame.");
+        ALOGE_IF(isRecordedFrame(frameNumber), "addRelease: Did not find frame.");
         return;
     }
     frame->addReleaseCalled = true;
@@ -526,18 +538,19 @@ constexpr size_t FrameEventsDelta::minFlattenedSize() {
             sizeof(uint16_t) + // mIndex
             sizeof(uint8_t) + // mAddPostCompositeCalled
             sizeof(uint8_t) + // mAddReleaseCalled
-            sizeof(FrameEventsDelta::mPostedTime) +
-            sizeof(FrameEventsDelta::mRequestedPresentTime) +
-            sizeof(FrameEventsDelta::mLatchTime) +
-            sizeof(FrameEventsDelta::mFirstRefreshStartTime) +
-            sizeof(FrameEventsDelta::mLastRefreshStartTime) +
-            sizeof(FrameEventsDelta::mDequeueReadyTime);
+            sizeof(uint8_t); // Mask of the timestamps that follow
 }
 
 // Flattenable implementation
 size_t FrameEventsDelta::getFlattenedSize() const {
+    auto timestamps = allTimestamps(this);
     auto fences = allFences(this);
     return minFlattenedSize() +
+            sizeof(nsecs_t) * static_cast<size_t>(std::count_if(
+                    timestamps.begin(), timestamps.end(),
+                    [](const nsecs_t* timestamp) {
+                            return FrameEvents::isValidTimestamp(*timestamp);
+                    })) +
             std::accumulate(fences.begin(), fences.end(), size_t(0),
                     [](size_t a, const FenceTime::Snapshot* fence) {
                             return a + fence->getFlattenedSize();
@@ -572,12 +585,21 @@ status_t FrameEventsDelta::flatten(void*& buffer, size_t& size, int*& fds,
     FlattenableUtils::write(
             buffer, size, static_cast<uint8_t>(mAddReleaseCalled));
 
-    FlattenableUtils::write(buffer, size, mPostedTime);
-    FlattenableUtils::write(buffer, size, mRequestedPresentTime);
-    FlattenableUtils::write(buffer, size, mLatchTime);
-    FlattenableUtils::write(buffer, size, mFirstRefreshStartTime);
-    FlattenableUtils::write(buffer, size, mLastRefreshStartTime);
-    FlattenableUtils::write(buffer, size, mDequeueReadyTime);
+    // Pending timestamps are left out, since most of them are for the
+    // frames that were just queued.
+    auto timestamps = allTimestamps(this);
+    uint8_t timestampMask = 0;
+    for (size_t i = 0; i < timestamps.size(); i++) {
+        if (FrameEvents::isValidTimestamp(*timestamps[i])) {
+            timestampMask |= static_cast<uint8_t>(1u << i);
+        }
+    }
+    FlattenableUtils::write(buffer, size, timestampMask);
+    for (auto timestamp : timestamps) {
+        if (FrameEvents::isValidTimestamp(*timestamp)) {
+            FlattenableUtils::write(buffer, size, *timestamp);
+        }
+    }
 
     // Fences
     for (auto fence : allFences(this)) {
@@ -610,12 +632,22 @@ status_t FrameEventsDelta::unflatten(void const*& buffer, size_t& size,
     FlattenableUtils::read(buffer, size, temp8);
     mAddReleaseCalled = static_cast<bool>(temp8);
 
-    FlattenableUtils::read(buffer, size, mPostedTime);
-    FlattenableUtils::read(buffer, size, mRequestedPresentTime);
-    FlattenableUtils::read(buffer, size, mLatchTime);
-    FlattenableUtils::read(buffer, size, mFirstRefreshStartTime);
-    FlattenableUtils::read(buffer, size, mLastRefreshStartTime);
-    FlattenableUtils::read(buffer, size, mDequeueReadyTime);
+    auto timestamps = allTimestamps(this);
+    uint8_t timestampMask = 0;
+    FlattenableUtils::read(buffer, size, timestampMask);
+    if ((timestampMask >> timestamps.size()) != 0) {
+        return BAD_VALUE;
+    }
+    for (size_t i = 0; i < timestamps.size(); i++) {
+        if ((timestampMask & (1u << i)) == 0) {
+            *timestamps[i] = FrameEvents::TIMESTAMP_PENDING;
+            continue;
+        }
+        if (size < sizeof(nsecs_t)) {
+            return NO_MEMORY;
+        }
+        FlattenableUtils::read(buffer, size, *timestamps[i]);
+    }
 
     // Fences
     for (auto fence : allFences(this)) {
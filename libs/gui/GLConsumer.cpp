@@ -42,6 +42,8 @@
 #include <private/gui/ComposerService.h>
 #include <private/gui/SyncFeatures.h>
 
+#include <ui/PixelFormat.h>
+
 #include <utils/Log.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
@@ -78,6 +80,12 @@ static const struct {
 
 static const mat4 mtxIdentity;
 
+// Limits on the images kept for buffers that have left their slot. Enough for
+// a producer to reattach a full set of buffers, while bounding the memory of
+// buffers kept alive only by the cache.
+static const size_t kMaxEglImageCacheSize = 4;
+static const size_t kMaxEglImageCacheBytes = 32 * 1024 * 1024;
+
 Mutex GLConsumer::sStaticInitLock;
 sp<GraphicBuffer> GLConsumer::sReleasedTexImageBuffer;
 
@@ -119,6 +127,9 @@ GLConsumer::GLConsumer(const sp<IGraphicBufferConsumer>& bq, uint32_t tex,
     mTexTarget(texTarget),
     mEglDisplay(EGL_NO_DISPLAY),
     mEglContext(EGL_NO_CONTEXT),
+    mEglImageCacheBytes(0),
+    mEglImageReuseCount(0),
+    mEglImageCreateCount(0),
     mCurrentTexture(BufferQueue::INVALID_BUFFER_SLOT),
     mAttached(true)
 {
@@ -148,6 +159,9 @@ GLConsumer::GLConsumer(const sp<IGraphicBufferConsumer>& bq, uint32_t texTarget,
     mTexTarget(texTarget),
     mEglDisplay(EGL_NO_DISPLAY),
     mEglContext(EGL_NO_CONTEXT),
+    mEglImageCacheBytes(0),
+    mEglImageReuseCount(0),
+    mEglImageCreateCount(0),
     mCurrentTexture(BufferQueue::INVALID_BUFFER_SLOT),
     mAttached(false)
 {
@@ -330,11 +344,16 @@ status_t GLConsumer::acquireBufferLocked(BufferItem *item,
     }
 
     // If item->mGraphicBuffer is not null, this buffer has not been acquired
-    // before, so any prior EglImage created is using a stale buffer. This
-    // replaces any old EglImage with a new one (using the new buffer).
+    // in this slot before, so any prior EglImage in the slot may be using a
+    // stale buffer. This replaces it with the image for the new buffer, which
+    // is only created if the buffer has not had one recently.
     if (item->mGraphicBuffer != nullptr) {
         int slot = item->mSlot;
-        mEglSlots[slot].mEglImage = new EglImage(item->mGraphicBuffer);
+        sp<EglImage> image = takeEglImageLocked(slot, item->mGraphicBuffer);
+        if (mEglSlots[slot].mEglImage != image) {
+            cacheEglImageLocked(mEglSlots[slot].mEglImage);
+            mEglSlots[slot].mEglImage = image;
+        }
     }
 
     return NO_ERROR;
@@ -907,6 +926,7 @@ void GLConsumer::freeBufferLocked(int slotIndex) {
     if (slotIndex == mCurrentTexture) {
         mCurrentTexture = BufferQueue::INVALID_BUFFER_SLOT;
     }
+    cacheEglImageLocked(mEglSlots[slotIndex].mEglImage);
     mEglSlots[slotIndex].mEglImage.clear();
     ConsumerBase::freeBufferLocked(slotIndex);
 }
@@ -915,6 +935,54 @@ void GLConsumer::abandonLocked() {
     GLC_LOGV("abandonLocked");
     mCurrentTextureImage.clear();
     ConsumerBase::abandonLocked();
+    mEglImageCache.clear();
+    mEglImageCacheBytes = 0;
+}
+
+void GLConsumer::cacheEglImageLocked(const sp<EglImage>& image) {
+    if (image == nullptr || image->graphicBuffer() == nullptr) {
+        return;
+    }
+    const sp<GraphicBuffer>& buffer = image->graphicBuffer();
+    uint32_t bpp = bytesPerPixel(buffer->getPixelFormat());
+    if (bpp == 0) {
+        // YUV and opaque formats; assume the worst case of the common ones.
+        bpp = 4;
+    }
+    const size_t bytes = size_t(buffer->getStride()) * buffer->getHeight() * bpp;
+    if (bytes > kMaxEglImageCacheBytes) {
+        return;
+    }
+
+    mEglImageCache.push_front({buffer->getId(), bytes, image});
+    mEglImageCacheBytes += bytes;
+    while (mEglImageCache.size() > kMaxEglImageCacheSize ||
+            mEglImageCacheBytes > kMaxEglImageCacheBytes) {
+        mEglImageCacheBytes -= mEglImageCache.back().mBytes;
+        mEglImageCache.pop_back();
+    }
+}
+
+sp<GLConsumer::EglImage> GLConsumer::takeEglImageLocked(int slot,
+        const sp<GraphicBuffer>& graphicBuffer) {
+    const uint64_t id = graphicBuffer->getId();
+    const sp<EglImage>& slotImage = mEglSlots[slot].mEglImage;
+    if (slotImage != nullptr && slotImage->graphicBuffer() != nullptr &&
+            slotImage->graphicBuffer()->getId() == id) {
+        mEglImageReuseCount++;
+        return slotImage;
+    }
+    for (auto it = mEglImageCache.begin(); it != mEglImageCache.end(); ++it) {
+        if (it->mBufferId == id) {
+            sp<EglImage> image = it->mEglImage;
+            mEglImageCacheBytes -= it->mBytes;
+            mEglImageCache.erase(it);
+            mEglImageReuseCount++;
+            return image;
+        }
+    }
+    mEglImageCreateCount++;
+    return new EglImage(graphicBuffer);
 }
 
 status_t GLConsumer::setConsumerUsageBits(uint64_t usage) {
@@ -929,6 +997,11 @@ void GLConsumer::dumpLocked(String8& result, const char* prefix) const
        prefix, mTexName, mCurrentTexture, prefix, mCurrentCrop.left,
        mCurrentCrop.top, mCurrentCrop.right, mCurrentCrop.bottom,
        mCurrentTransform);
+    result.appendFormat(
+       "%smEglImageCache: %zu images (%zu KiB), %" PRIu64 " reused, %" PRIu64
+       " created\n",
+       prefix, mEglImageCache.size(), mEglImageCacheBytes / 1024,
+       mEglImageReuseCount, mEglImageCreateCount);
 
     ConsumerBase::dumpLocked(result, prefix);
 }
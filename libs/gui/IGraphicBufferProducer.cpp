@@ -17,6 +17,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <algorithm>
+
 #include <utils/Errors.h>
 #include <utils/NativeHandle.h>
 #include <utils/RefBase.h>
@@ -74,8 +76,14 @@ enum {
     GET_CONSUMER_USAGE,
     SET_LEGACY_BUFFER_DROP,
     SET_AUTO_PREROTATION,
+    DEQUEUE_BUFFERS,
+    QUEUE_BUFFERS,
 };
 
+static bool isValidBatchSize(size_t size) {
+    return size > 0 && size <= static_cast<size_t>(BufferQueueDefs::NUM_BUFFER_SLOTS);
+}
+
 class BpGraphicBufferProducer : public BpInterface<IGraphicBufferProducer>
 {
 public:
@@ -183,6 +191,67 @@ public:
         return result;
     }
 
+    virtual status_t dequeueBuffers(const std::vector<DequeueBufferRequest>& requests,
+                                    std::vector<DequeueBufferResult>* outResults) {
+        if (!isValidBatchSize(requests.size())) {
+            return BAD_VALUE;
+        }
+
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeUint32(static_cast<uint32_t>(requests.size()));
+        for (const auto& request : requests) {
+            data.writeUint32(request.width);
+            data.writeUint32(request.height);
+            data.writeInt32(static_cast<int32_t>(request.format));
+            data.writeUint64(request.usage);
+            data.writeBool(request.getTimestamps);
+        }
+
+        status_t result = remote()->transact(DEQUEUE_BUFFERS, data, &reply);
+        if (result != NO_ERROR) {
+            return result;
+        }
+
+        uint32_t count = 0;
+        result = reply.readUint32(&count);
+        if (result != NO_ERROR) {
+            return result;
+        }
+        if (count > requests.size()) {
+            ALOGE("IGBP::dequeueBuffers received %u results for %zu requests", count,
+                  requests.size());
+            return BAD_VALUE;
+        }
+
+        outResults->clear();
+        outResults->reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            DequeueBufferResult dequeueResult;
+            dequeueResult.slot = reply.readInt32();
+            dequeueResult.fence = new Fence();
+            result = reply.read(*dequeueResult.fence);
+            if (result != NO_ERROR) {
+                return result;
+            }
+            result = reply.readUint64(&dequeueResult.bufferAge);
+            if (result != NO_ERROR) {
+                ALOGE("IGBP::dequeueBuffers failed to read buffer age: %d", result);
+                return result;
+            }
+            if (requests[i].getTimestamps) {
+                result = reply.read(dequeueResult.timestamps);
+                if (result != NO_ERROR) {
+                    ALOGE("IGBP::dequeueBuffers failed to read timestamps: %d", result);
+                    return result;
+                }
+            }
+            dequeueResult.result = reply.readInt32();
+            outResults->push_back(std::move(dequeueResult));
+        }
+        return reply.readInt32();
+    }
+
     virtual status_t detachBuffer(int slot) {
         Parcel data, reply;
         data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
@@ -278,6 +347,50 @@ public:
         return result;
     }
 
+    virtual status_t queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                                  std::vector<QueueBufferResult>* outResults) {
+        if (!isValidBatchSize(requests.size())) {
+            return BAD_VALUE;
+        }
+
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeUint32(static_cast<uint32_t>(requests.size()));
+        for (const auto& request : requests) {
+            data.writeInt32(request.slot);
+            data.write(request.input);
+        }
+
+        status_t result = remote()->transact(QUEUE_BUFFERS, data, &reply);
+        if (result != NO_ERROR) {
+            return result;
+        }
+
+        uint32_t count = 0;
+        result = reply.readUint32(&count);
+        if (result != NO_ERROR) {
+            return result;
+        }
+        if (count > requests.size()) {
+            ALOGE("IGBP::queueBuffers received %u results for %zu requests", count,
+                  requests.size());
+            return BAD_VALUE;
+        }
+
+        outResults->clear();
+        outResults->reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            QueueBufferResult queueResult;
+            result = reply.read(queueResult.output);
+            if (result != NO_ERROR) {
+                return result;
+            }
+            queueResult.result = reply.readInt32();
+            outResults->push_back(std::move(queueResult));
+        }
+        return reply.readInt32();
+    }
+
     virtual status_t cancelBuffer(int buf, const sp<Fence>& fence) {
         Parcel data, reply;
         data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
@@ -590,6 +703,11 @@ public:
         return mBase->dequeueBuffer(slot, fence, w, h, format, usage, outBufferAge, outTimestamps);
     }
 
+    status_t dequeueBuffers(const std::vector<DequeueBufferRequest>& requests,
+                            std::vector<DequeueBufferResult>* outResults) override {
+        return mBase->dequeueBuffers(requests, outResults);
+    }
+
     status_t detachBuffer(int slot) override {
         return mBase->detachBuffer(slot);
     }
@@ -611,6 +729,11 @@ public:
         return mBase->queueBuffer(slot, input, output);
     }
 
+    status_t queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                          std::vector<QueueBufferResult>* outResults) override {
+        return mBase->queueBuffers(requests, outResults);
+    }
+
     status_t cancelBuffer(int slot, const sp<Fence>& fence) override {
         return mBase->cancelBuffer(slot, fence);
     }
@@ -698,6 +821,50 @@ IMPLEMENT_HYBRID_META_INTERFACE(GraphicBufferProducer,
 
 // ----------------------------------------------------------------------
 
+status_t IGraphicBufferProducer::dequeueBuffers(const std::vector<DequeueBufferRequest>& requests,
+                                                std::vector<DequeueBufferResult>* outResults) {
+    if (!isValidBatchSize(requests.size())) {
+        return BAD_VALUE;
+    }
+
+    outResults->clear();
+    outResults->reserve(requests.size());
+    for (const auto& request : requests) {
+        DequeueBufferResult dequeueResult;
+        dequeueResult.result =
+                dequeueBuffer(&dequeueResult.slot, &dequeueResult.fence, request.width,
+                              request.height, request.format, request.usage,
+                              &dequeueResult.bufferAge,
+                              request.getTimestamps ? &dequeueResult.timestamps : nullptr);
+        const bool failed = dequeueResult.result < 0;
+        outResults->push_back(std::move(dequeueResult));
+        if (failed) {
+            break;
+        }
+    }
+    return NO_ERROR;
+}
+
+status_t IGraphicBufferProducer::queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                                              std::vector<QueueBufferResult>* outResults) {
+    if (!isValidBatchSize(requests.size())) {
+        return BAD_VALUE;
+    }
+
+    outResults->clear();
+    outResults->reserve(requests.size());
+    for (const auto& request : requests) {
+        QueueBufferResult queueResult;
+        queueResult.result = queueBuffer(request.slot, request.input, &queueResult.output);
+        const bool failed = queueResult.result != NO_ERROR;
+        outResults->push_back(std::move(queueResult));
+        if (failed) {
+            break;
+        }
+    }
+    return NO_ERROR;
+}
+
 status_t IGraphicBufferProducer::setLegacyBufferDrop(bool drop) {
     // No-op for IGBP other than BufferQueue.
     (void) drop;
@@ -841,6 +1008,47 @@ status_t BnGraphicBufferProducer::onTransact(
             reply->writeInt32(result);
             return NO_ERROR;
         }
+        case DEQUEUE_BUFFERS: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            uint32_t count = 0;
+            status_t result = data.readUint32(&count);
+            if (result != NO_ERROR) {
+                return result;
+            }
+            std::vector<DequeueBufferRequest> requests;
+            std::vector<DequeueBufferResult> results;
+            if (isValidBatchSize(count)) {
+                requests.resize(count);
+                for (auto& request : requests) {
+                    request.width = data.readUint32();
+                    request.height = data.readUint32();
+                    request.format = static_cast<PixelFormat>(data.readInt32());
+                    request.usage = data.readUint64();
+                    request.getTimestamps = data.readBool();
+                }
+                result = dequeueBuffers(requests, &results);
+            } else {
+                result = BAD_VALUE;
+            }
+
+            const size_t resultCount = std::min(results.size(), requests.size());
+            reply->writeUint32(static_cast<uint32_t>(resultCount));
+            for (size_t i = 0; i < resultCount; i++) {
+                const DequeueBufferResult& dequeueResult = results[i];
+                if (dequeueResult.fence == nullptr) {
+                    ALOGE("dequeueBuffers returned a NULL fence, setting to Fence::NO_FENCE");
+                }
+                reply->writeInt32(dequeueResult.slot);
+                reply->write(dequeueResult.fence ? *dequeueResult.fence : *Fence::NO_FENCE);
+                reply->writeUint64(dequeueResult.bufferAge);
+                if (requests[i].getTimestamps) {
+                    reply->write(dequeueResult.timestamps);
+                }
+                reply->writeInt32(dequeueResult.result);
+            }
+            reply->writeInt32(result);
+            return NO_ERROR;
+        }
         case DETACH_BUFFER: {
             CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
             int slot = data.readInt32();
@@ -890,6 +1098,35 @@ status_t BnGraphicBufferProducer::onTransact(
 
             return NO_ERROR;
         }
+        case QUEUE_BUFFERS: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            uint32_t count = 0;
+            status_t result = data.readUint32(&count);
+            if (result != NO_ERROR) {
+                return result;
+            }
+            std::vector<QueueBufferRequest> requests;
+            std::vector<QueueBufferResult> results;
+            if (isValidBatchSize(count)) {
+                requests.reserve(count);
+                for (uint32_t i = 0; i < count; i++) {
+                    int slot = data.readInt32();
+                    requests.push_back({slot, QueueBufferInput(data)});
+                }
+                result = queueBuffers(requests, &results);
+            } else {
+                result = BAD_VALUE;
+            }
+
+            const size_t resultCount = std::min(results.size(), requests.size());
+            reply->writeUint32(static_cast<uint32_t>(resultCount));
+            for (size_t i = 0; i < resultCount; i++) {
+                reply->write(results[i].output);
+                reply->writeInt32(results[i].result);
+            }
+            reply->writeInt32(result);
+            return NO_ERROR;
+        }
         case CANCEL_BUFFER: {
             CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
             int buf = data.readInt32();
@@ -145,6 +145,49 @@ public:
         return result;
     }
 
+    virtual status_t captureScreenAsync(const sp<IBinder>& display, sp<GraphicBuffer>* outBuffer,
+                                        sp<Fence>* outReadyFence, bool& outCapturedSecureLayers,
+                                        ui::Dataspace reqDataspace, ui::PixelFormat reqPixelFormat,
+                                        const Rect& sourceCrop, uint32_t reqWidth,
+                                        uint32_t reqHeight, bool useIdentityTransform,
+                                        ui::Rotation rotation, bool captureSecureLayers) {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISurfaceComposer::getInterfaceDescriptor());
+        data.writeStrongBinder(display);
+        data.writeInt32(static_cast<int32_t>(reqDataspace));
+        data.writeInt32(static_cast<int32_t>(reqPixelFormat));
+        data.write(sourceCrop);
+        data.writeUint32(reqWidth);
+        data.writeUint32(reqHeight);
+        data.writeInt32(static_cast<int32_t>(useIdentityTransform));
+        data.writeInt32(static_cast<int32_t>(rotation));
+        data.writeInt32(static_cast<int32_t>(captureSecureLayers));
+        data.writeBool(*outBuffer != nullptr);
+        if (*outBuffer != nullptr) {
+            data.write(**outBuffer);
+        }
+        status_t result = remote()->transact(BnSurfaceComposer::CAPTURE_SCREEN_ASYNC, data, &reply);
+        if (result != NO_ERROR) {
+            ALOGE("captureScreenAsync failed to transact: %d", result);
+            return result;
+        }
+        result = reply.readInt32();
+        if (result != NO_ERROR) {
+            ALOGE("captureScreenAsync failed to readInt32: %d", result);
+            return result;
+        }
+
+        // The buffer is sent back even if it was the caller's, since the reply may carry a new
+        // one when the caller's could not be reused.
+        *outBuffer = new GraphicBuffer();
+        reply.read(**outBuffer);
+        *outReadyFence = new Fence();
+        reply.read(**outReadyFence);
+        outCapturedSecureLayers = reply.readBool();
+
+        return result;
+    }
+
     virtual status_t captureScreen(uint64_t displayOrLayerStack, ui::Dataspace* outDataspace,
                                    sp<GraphicBuffer>* outBuffer) {
         Parcel data, reply;
@@ -1322,6 +1365,42 @@ status_t BnSurfaceComposer::onTransact(
             }
             return NO_ERROR;
         }
+        case CAPTURE_SCREEN_ASYNC: {
+            CHECK_INTERFACE(ISurfaceComposer, data, reply);
+            sp<IBinder> display = data.readStrongBinder();
+            ui::Dataspace reqDataspace = static_cast<ui::Dataspace>(data.readInt32());
+            ui::PixelFormat reqPixelFormat = static_cast<ui::PixelFormat>(data.readInt32());
+            Rect sourceCrop(Rect::EMPTY_RECT);
+            data.read(sourceCrop);
+            uint32_t reqWidth = data.readUint32();
+            uint32_t reqHeight = data.readUint32();
+            bool useIdentityTransform = static_cast<bool>(data.readInt32());
+            int32_t rotation = data.readInt32();
+            bool captureSecureLayers = static_cast<bool>(data.readInt32());
+            sp<GraphicBuffer> buffer;
+            if (data.readBool()) {
+                buffer = new GraphicBuffer();
+                status_t err = data.read(*buffer);
+                if (err != NO_ERROR) {
+                    return err;
+                }
+            }
+
+            sp<Fence> readyFence;
+            bool capturedSecureLayers = false;
+            status_t res = captureScreenAsync(display, &buffer, &readyFence, capturedSecureLayers,
+                                              reqDataspace, reqPixelFormat, sourceCrop, reqWidth,
+                                              reqHeight, useIdentityTransform,
+                                              ui::toRotation(rotation), captureSecureLayers);
+
+            reply->writeInt32(res);
+            if (res == NO_ERROR) {
+                reply->write(*buffer);
+                reply->write(*readyFence);
+                reply->writeBool(capturedSecureLayers);
+            }
+            return NO_ERROR;
+        }
         case CAPTURE_SCREEN_BY_ID: {
             CHECK_INTERFACE(ISurfaceComposer, data, reply);
             uint64_t displayOrLayerStack = data.readUint64();
@@ -113,8 +113,13 @@ status_t SurfaceStats::writeToParcel(Parcel* output) const {
         return err;
     }
 
-    err = output->writeParcelable(eventStats);
-    return err;
+    // Most transactions do not latch a buffer, and their frame event stats are empty.
+    const bool hasEventStats = eventStats.frameNumber != 0;
+    err = output->writeBool(hasEventStats);
+    if (err != NO_ERROR || !hasEventStats) {
+        return err;
+    }
+    return output->writeParcelable(eventStats);
 }
 
 status_t SurfaceStats::readFromParcel(const Parcel* input) {
@@ -143,8 +148,12 @@ status_t SurfaceStats::readFromParcel(const Parcel* input) {
         return err;
     }
 
-    err = input->readParcelable(&eventStats);
-    return err;
+    bool hasEventStats = false;
+    err = input->readBool(&hasEventStats);
+    if (err != NO_ERROR || !hasEventStats) {
+        return err;
+    }
+    return input->readParcelable(&eventStats);
 }
 
 status_t TransactionStats::writeToParcel(Parcel* output) const {
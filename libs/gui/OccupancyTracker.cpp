@@ -24,8 +24,76 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 namespace android {
 
+void OccupancyTracker::WaitHistogram::record(nsecs_t wait) {
+    size_t bucket = 0;
+    while (bucket < NUM_BUCKETS - 1 && wait >= (ms2ns(1) << bucket)) {
+        ++bucket;
+    }
+    ++buckets[bucket];
+    ++count;
+    totalTime += wait;
+    maxTime = std::max(maxTime, wait);
+}
+
+void OccupancyTracker::WaitHistogram::merge(const WaitHistogram& other) {
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    totalTime += other.totalTime;
+    maxTime = std::max(maxTime, other.maxTime);
+}
+
+status_t OccupancyTracker::WaitHistogram::writeToParcel(Parcel* parcel) const {
+    status_t result = parcel->writeUint64(static_cast<uint64_t>(count));
+    if (result != OK) {
+        return result;
+    }
+    result = parcel->writeInt64(totalTime);
+    if (result != OK) {
+        return result;
+    }
+    result = parcel->writeInt64(maxTime);
+    if (result != OK) {
+        return result;
+    }
+    for (uint32_t bucket : buckets) {
+        result = parcel->writeUint32(bucket);
+        if (result != OK) {
+            return result;
+        }
+    }
+    return OK;
+}
+
+status_t OccupancyTracker::WaitHistogram::readFromParcel(const Parcel* parcel) {
+    uint64_t uintCount = 0;
+    status_t result = parcel->readUint64(&uintCount);
+    if (result != OK) {
+        return result;
+    }
+    count = static_cast<size_t>(uintCount);
+    result = parcel->readInt64(&totalTime);
+    if (result != OK) {
+        return result;
+    }
+    result = parcel->readInt64(&maxTime);
+    if (result != OK) {
+        return result;
+    }
+    for (uint32_t& bucket : buckets) {
+        result = parcel->readUint32(&bucket);
+        if (result != OK) {
+            return result;
+        }
+    }
+    return OK;
+}
+
 status_t OccupancyTracker::Segment::writeToParcel(Parcel* parcel) const {
     status_t result = parcel->writeInt64(totalTime);
     if (result != OK) {
@@ -39,7 +107,19 @@ status_t OccupancyTracker::Segment::writeToParcel(Parcel* parcel) const {
     if (result != OK) {
         return result;
     }
-    return parcel->writeBool(usedThirdBuffer);
+    result = parcel->writeBool(usedThirdBuffer);
+    if (result != OK) {
+        return result;
+    }
+    result = parcel->writeInt64Vector(occupancyTimes);
+    if (result != OK) {
+        return result;
+    }
+    result = dequeueWait.writeToParcel(parcel);
+    if (result != OK) {
+        return result;
+    }
+    return acquireWait.writeToParcel(parcel);
 }
 
 status_t OccupancyTracker::Segment::readFromParcel(const Parcel* parcel) {
@@ -57,7 +137,19 @@ status_t OccupancyTracker::Segment::readFromParcel(const Parcel* parcel) {
     if (result != OK) {
         return result;
     }
-    return parcel->readBool(&usedThirdBuffer);
+    result = parcel->readBool(&usedThirdBuffer);
+    if (result != OK) {
+        return result;
+    }
+    result = parcel->readInt64Vector(&occupancyTimes);
+    if (result != OK) {
+        return result;
+    }
+    result = dequeueWait.readFromParcel(parcel);
+    if (result != OK) {
+        return result;
+    }
+    return acquireWait.readFromParcel(parcel);
 }
 
 void OccupancyTracker::registerOccupancyChange(size_t occupancy) {
@@ -81,6 +173,14 @@ void OccupancyTracker::registerOccupancyChange(size_t occupancy) {
     mLastOccupancy = occupancy;
 }
 
+void OccupancyTracker::registerDequeueWait(nsecs_t wait) {
+    mPendingSegment.mDequeueWait.record(wait);
+}
+
+void OccupancyTracker::registerAcquireWait(nsecs_t wait) {
+    mPendingSegment.mAcquireWait.record(wait);
+}
+
 std::vector<OccupancyTracker::Segment> OccupancyTracker::getSegmentHistory(
         bool forceFlush) {
     if (forceFlush) {
@@ -98,15 +198,24 @@ void OccupancyTracker::recordPendingSegment() {
     if (mPendingSegment.numFrames > LONG_SEGMENT_THRESHOLD) {
         float occupancyAverage = 0.0f;
         bool usedThirdBuffer = false;
+        std::vector<nsecs_t> occupancyTimes;
         for (const auto& timePair : mPendingSegment.mOccupancyTimes) {
             size_t occupancy = timePair.first;
             float timeRatio = static_cast<float>(timePair.second) /
                     mPendingSegment.totalTime;
             occupancyAverage += timeRatio * occupancy;
             usedThirdBuffer = usedThirdBuffer || (occupancy > 1);
+            if (occupancyTimes.size() <= occupancy) {
+                occupancyTimes.resize(occupancy + 1);
+            }
+            occupancyTimes[occupancy] = timePair.second;
         }
-        mSegmentHistory.push_front({mPendingSegment.totalTime,
-                mPendingSegment.numFrames, occupancyAverage, usedThirdBuffer});
+        Segment segment(mPendingSegment.totalTime, mPendingSegment.numFrames,
+                occupancyAverage, usedThirdBuffer);
+        segment.occupancyTimes = std::move(occupancyTimes);
+        segment.dequeueWait = mPendingSegment.mDequeueWait;
+        segment.acquireWait = mPendingSegment.mAcquireWait;
+        mSegmentHistory.push_front(std::move(segment));
         if (mSegmentHistory.size() > MAX_HISTORY_SIZE) {
             mSegmentHistory.pop_back();
         }
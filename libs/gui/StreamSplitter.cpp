@@ -16,6 +16,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 #define LOG_TAG "StreamSplitter"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 //#define LOG_NDEBUG 0
@@ -62,9 +64,9 @@ StreamSplitter::StreamSplitter(const sp<IGraphicBufferConsumer>& inputQueue)
 
 StreamSplitter::~StreamSplitter() {
     mInput->consumerDisconnect();
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
+    Vector<Output>::iterator output = mOutputs.begin();
     for (; output != mOutputs.end(); ++output) {
-        (*output)->disconnect(NATIVE_WINDOW_API_CPU);
+        output->queue->disconnect(NATIVE_WINDOW_API_CPU);
     }
 
     if (mBuffers.size() > 0) {
@@ -73,7 +75,7 @@ StreamSplitter::~StreamSplitter() {
 }
 
 status_t StreamSplitter::addOutput(
-        const sp<IGraphicBufferProducer>& outputQueue) {
+        const sp<IGraphicBufferProducer>& outputQueue, bool allowFrameDrops) {
     if (outputQueue == nullptr) {
         ALOGE("addOutput: outputQueue must not be NULL");
         return BAD_VALUE;
@@ -91,8 +93,28 @@ status_t StreamSplitter::addOutput(
         return status;
     }
 
-    mOutputs.push_back(outputQueue);
+    Output output;
+    output.queue = outputQueue;
+    output.allowFrameDrops = allowFrameDrops;
+    mOutputs.push_back(output);
+
+    return NO_ERROR;
+}
+
+status_t StreamSplitter::getOutputStats(
+        const sp<IGraphicBufferProducer>& outputQueue, OutputStats* outStats) {
+    if (outStats == nullptr) {
+        ALOGE("getOutputStats: outStats must not be NULL");
+        return BAD_VALUE;
+    }
 
+    Mutex::Autolock lock(mMutex);
+    const Output* output = findOutputLocked(outputQueue);
+    if (output == nullptr) {
+        ALOGE("getOutputStats: not an output of this splitter");
+        return BAD_VALUE;
+    }
+    *outStats = output->stats;
     return NO_ERROR;
 }
 
@@ -108,7 +130,8 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
     // The current policy is that if any one consumer is consuming buffers too
     // slowly, the splitter will stall the rest of the outputs by not acquiring
     // any more buffers from the input. This will cause back pressure on the
-    // input queue, slowing down its producer.
+    // input queue, slowing down its producer. Outputs added with
+    // allowFrameDrops skip buffers instead, so they never hold more than one.
 
     // If there are too many outstanding buffers, we block until a buffer is
     // released back to the input in onBufferReleased
@@ -139,8 +162,8 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             "detaching buffer from input failed (%d)", status);
 
     // Initialize our reference count for this buffer
-    mBuffers.add(bufferItem.mGraphicBuffer->getId(),
-            new BufferTracker(bufferItem.mGraphicBuffer));
+    const sp<BufferTracker> tracker(new BufferTracker(bufferItem.mGraphicBuffer));
+    mBuffers.add(bufferItem.mGraphicBuffer->getId(), tracker);
 
     IGraphicBufferProducer::QueueBufferInput queueInput(
             bufferItem.mTimestamp, bufferItem.mIsAutoTimestamp,
@@ -149,17 +172,27 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             bufferItem.mTransform, bufferItem.mFence);
 
     // Attach and queue the buffer to each of the outputs
-    Vector<sp<IGraphicBufferProducer> >::iterator output = mOutputs.begin();
+    Vector<Output>::iterator output = mOutputs.begin();
     for (; output != mOutputs.end(); ++output) {
+        if (output->allowFrameDrops &&
+                output->outstandingBuffers >= MAX_OUTSTANDING_BUFFERS - 1) {
+            // This output is still holding a previous buffer, so it does not
+            // get this one. Count it as released by the output right away.
+            ALOGV("dropped buffer %#" PRIx64 " for output %p",
+                    bufferItem.mGraphicBuffer->getId(), output->queue.get());
+            output->stats.framesDropped++;
+            tracker->incrementReleaseCountLocked();
+            continue;
+        }
+
         int slot;
-        status = (*output)->attachBuffer(&slot, bufferItem.mGraphicBuffer);
+        status = output->queue->attachBuffer(&slot, bufferItem.mGraphicBuffer);
         if (status == NO_INIT) {
             // If we just discovered that this output has been abandoned, note
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
@@ -167,22 +200,32 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
         }
 
         IGraphicBufferProducer::QueueBufferOutput queueOutput;
-        status = (*output)->queueBuffer(slot, queueInput, &queueOutput);
+        status = output->queue->queueBuffer(slot, queueInput, &queueOutput);
         if (status == NO_INIT) {
             // If we just discovered that this output has been abandoned, note
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
                     "queueing buffer to output failed (%d)", status);
         }
 
+        output->outstandingBuffers++;
+        output->stats.framesQueued++;
         ALOGV("queued buffer %#" PRIx64 " to output %p",
-                bufferItem.mGraphicBuffer->getId(), output->get());
+                bufferItem.mGraphicBuffer->getId(), output->queue.get());
+    }
+
+    // If no output took the buffer, it can go back to the input right away
+    if (tracker->getReleaseCount() >= mOutputs.size()) {
+        if (mIsAbandoned) {
+            mBuffers.removeItem(bufferItem.mGraphicBuffer->getId());
+            return;
+        }
+        releaseToInputLocked(bufferItem.mGraphicBuffer);
     }
 }
 
@@ -207,6 +250,15 @@ void StreamSplitter::onBufferReleasedByOutput(
     ALOGV("detached buffer %#" PRIx64 " from output %p",
           buffer->getId(), from.get());
 
+    Output* output = findOutputLocked(from);
+    if (output != nullptr) {
+        const nsecs_t latency = systemTime() -
+                mBuffers.valueFor(buffer->getId())->getQueueTime();
+        output->outstandingBuffers--;
+        output->stats.totalLatency += latency;
+        output->stats.maxLatency = std::max(output->stats.maxLatency, latency);
+    }
+
     const sp<BufferTracker>& tracker = mBuffers.editValueFor(buffer->getId());
 
     // Merge the release fence of the incoming buffer so that the fence we send
@@ -228,9 +280,15 @@ void StreamSplitter::onBufferReleasedByOutput(
         return;
     }
 
+    releaseToInputLocked(buffer);
+}
+
+void StreamSplitter::releaseToInputLocked(const sp<GraphicBuffer>& buffer) {
+    const sp<BufferTracker> tracker = mBuffers.valueFor(buffer->getId());
+
     // Attach and release the buffer back to the input
     int consumerSlot;
-    status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
+    status_t status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "attaching buffer to input failed (%d)", status);
 
@@ -250,6 +308,16 @@ void StreamSplitter::onBufferReleasedByOutput(
     mReleaseCondition.signal();
 }
 
+StreamSplitter::Output* StreamSplitter::findOutputLocked(
+        const sp<IGraphicBufferProducer>& queue) {
+    for (size_t i = 0; i < mOutputs.size(); ++i) {
+        if (mOutputs[i].queue == queue) {
+            return &mOutputs.editItemAt(i);
+        }
+    }
+    return nullptr;
+}
+
 void StreamSplitter::onAbandonedLocked() {
     ALOGE("one of my outputs has abandoned me");
     if (!mIsAbandoned) {
@@ -276,7 +344,8 @@ void StreamSplitter::OutputListener::binderDied(const wp<IBinder>& /* who */) {
 }
 
 StreamSplitter::BufferTracker::BufferTracker(const sp<GraphicBuffer>& buffer)
-      : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mReleaseCount(0) {}
+      : mBuffer(buffer), mMergedFence(Fence::NO_FENCE), mReleaseCount(0),
+        mQueueTime(systemTime()) {}
 
 StreamSplitter::BufferTracker::~BufferTracker() {}
 
@@ -20,6 +20,7 @@
 
 #include <gui/Surface.h>
 
+#include <algorithm>
 #include <condition_variable>
 #include <deque>
 #include <mutex>
@@ -74,8 +75,7 @@ Surface::Surface(const sp<IGraphicBufferProducer>& bufferProducer, bool controll
         mSharedBufferHasBeenQueued(false),
         mQueriedSupportedTimestamps(false),
         mFrameTimestampsSupportsPresent(false),
-        mEnableFrameTimestamps(false),
-        mFrameEventHistory(std::make_unique<ProducerFrameEventHistory>()) {
+        mEnableFrameTimestamps(false) {
     // Initialize the ANativeWindow function pointers.
     ANativeWindow::setSwapInterval  = hook_setSwapInterval;
     ANativeWindow::dequeueBuffer    = hook_dequeueBuffer;
@@ -160,6 +160,10 @@ String8 Surface::getConsumerName() const {
 }
 
 status_t Surface::setDequeueTimeout(nsecs_t timeout) {
+    Mutex::Autolock lock(mMutex);
+    // A dequeue timeout makes dequeueBuffer able to block again, which changes the minimum
+    // undequeued buffer count.
+    invalidateQueryCacheLocked();
     return mGraphicBufferProducer->setDequeueTimeout(timeout);
 }
 
@@ -188,6 +192,9 @@ void Surface::enableFrameTimestamps(bool enable) {
     // If going from disabled to enabled, get the initial values for
     // compositor and display timing.
     if (!mEnableFrameTimestamps && enable) {
+        if (!mFrameEventHistory) {
+            mFrameEventHistory = std::make_unique<ProducerFrameEventHistory>();
+        }
         FrameEventHistoryDelta delta;
         mGraphicBufferProducer->getFrameTimestamps(&delta);
         mFrameEventHistory->applyDelta(delta);
@@ -616,15 +623,22 @@ private:
     std::mutex mMutex;
 };
 
+void Surface::getDequeueBufferRequestLocked(
+        IGraphicBufferProducer::DequeueBufferRequest* request) {
+    request->width = mReqWidth ? mReqWidth : mUserWidth;
+    request->height = mReqHeight ? mReqHeight : mUserHeight;
+
+    request->format = mReqFormat;
+    request->usage = mReqUsage;
+
+    request->getTimestamps = mEnableFrameTimestamps;
+}
+
 int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     ATRACE_CALL();
     ALOGV("Surface::dequeueBuffer");
 
-    uint32_t reqWidth;
-    uint32_t reqHeight;
-    PixelFormat reqFormat;
-    uint64_t reqUsage;
-    bool enableFrameTimestamps;
+    IGraphicBufferProducer::DequeueBufferRequest request;
 
     {
         Mutex::Autolock lock(mMutex);
@@ -632,13 +646,7 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
             mRemovedBuffers.clear();
         }
 
-        reqWidth = mReqWidth ? mReqWidth : mUserWidth;
-        reqHeight = mReqHeight ? mReqHeight : mUserHeight;
-
-        reqFormat = mReqFormat;
-        reqUsage = mReqUsage;
-
-        enableFrameTimestamps = mEnableFrameTimestamps;
+        getDequeueBufferRequestLocked(&request);
 
         if (mSharedBufferMode && mAutoRefresh && mSharedBufferSlot !=
                 BufferItem::INVALID_BUFFER_SLOT) {
@@ -656,16 +664,17 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     nsecs_t startTime = systemTime();
 
     FrameEventHistoryDelta frameTimestamps;
-    status_t result = mGraphicBufferProducer->dequeueBuffer(&buf, &fence, reqWidth, reqHeight,
-                                                            reqFormat, reqUsage, &mBufferAge,
-                                                            enableFrameTimestamps ? &frameTimestamps
-                                                                                  : nullptr);
+    status_t result =
+            mGraphicBufferProducer->dequeueBuffer(&buf, &fence, request.width, request.height,
+                                                  request.format, request.usage, &mBufferAge,
+                                                  request.getTimestamps ? &frameTimestamps
+                                                                        : nullptr);
     mLastDequeueDuration = systemTime() - startTime;
 
     if (result < 0) {
         ALOGV("dequeueBuffer: IGraphicBufferProducer::dequeueBuffer"
                 "(%d, %d, %d, %#" PRIx64 ") failed: %d",
-                reqWidth, reqHeight, reqFormat, reqUsage, result);
+                request.width, request.height, request.format, request.usage, result);
         return result;
     }
 
@@ -694,7 +703,7 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
         freeAllBuffers();
     }
 
-    if (enableFrameTimestamps) {
+    if (request.getTimestamps) {
          mFrameEventHistory->applyDelta(frameTimestamps);
     }
 
@@ -702,6 +711,7 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
         if (mReportRemovedBuffers && (gbuf != nullptr)) {
             mRemovedBuffers.push_back(gbuf);
         }
+        invalidateQueryCacheLocked();
         result = mGraphicBufferProducer->requestBuffer(buf, &gbuf);
         if (result != NO_ERROR) {
             ALOGE("dequeueBuffer: IGraphicBufferProducer::requestBuffer failed: %d", result);
@@ -737,6 +747,143 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
     return OK;
 }
 
+int Surface::dequeueBuffers(std::vector<BatchBuffer>* buffers) {
+    ATRACE_CALL();
+    ALOGV("Surface::dequeueBuffers");
+
+    if (buffers->empty()) {
+        ALOGE("dequeueBuffers: no buffers to dequeue");
+        return BAD_VALUE;
+    }
+
+    std::vector<IGraphicBufferProducer::DequeueBufferRequest> requests(buffers->size());
+    {
+        Mutex::Autolock lock(mMutex);
+        if (mSharedBufferMode) {
+            ALOGE("dequeueBuffers: not supported in shared buffer mode");
+            return INVALID_OPERATION;
+        }
+
+        if (mReportRemovedBuffers) {
+            mRemovedBuffers.clear();
+        }
+
+        getDequeueBufferRequestLocked(&requests[0]);
+        std::fill(requests.begin() + 1, requests.end(), requests[0]);
+    } // Drop the lock so that we can still touch the Surface while blocking in IGBP::dequeueBuffers
+
+    std::vector<IGraphicBufferProducer::DequeueBufferResult> results;
+    nsecs_t startTime = systemTime();
+    status_t result = mGraphicBufferProducer->dequeueBuffers(requests, &results);
+    mLastDequeueDuration = systemTime() - startTime;
+
+    if (result < 0) {
+        ALOGV("dequeueBuffers: IGraphicBufferProducer::dequeueBuffers failed: %d", result);
+        return result;
+    }
+
+    // Either all of the buffers are handed out, or the ones that were dequeued are cancelled.
+    auto cancelDequeuedBuffers = [&]() {
+        for (const auto& dequeueResult : results) {
+            if (dequeueResult.result >= 0 && dequeueResult.slot >= 0 &&
+                dequeueResult.slot < NUM_BUFFER_SLOTS) {
+                mGraphicBufferProducer->cancelBuffer(dequeueResult.slot, dequeueResult.fence);
+            }
+        }
+    };
+
+    for (const auto& dequeueResult : results) {
+        if (dequeueResult.result < 0) {
+            ALOGV("dequeueBuffers: IGraphicBufferProducer::dequeueBuffer"
+                  "(%d, %d, %d, %#" PRIx64 ") failed: %d",
+                  requests[0].width, requests[0].height, requests[0].format, requests[0].usage,
+                  dequeueResult.result);
+            result = dequeueResult.result;
+        } else if (dequeueResult.slot < 0 || dequeueResult.slot >= NUM_BUFFER_SLOTS) {
+            ALOGE("dequeueBuffers: IGraphicBufferProducer returned invalid slot number %d",
+                  dequeueResult.slot);
+            android_errorWriteLog(0x534e4554, "36991414"); // SafetyNet logging
+            result = FAILED_TRANSACTION;
+        }
+    }
+    if (result == NO_ERROR && results.size() != requests.size()) {
+        ALOGE("dequeueBuffers: IGraphicBufferProducer returned %zu buffers instead of %zu",
+              results.size(), requests.size());
+        result = FAILED_TRANSACTION;
+    }
+    if (result < 0) {
+        cancelDequeuedBuffers();
+        return result;
+    }
+
+    Mutex::Autolock lock(mMutex);
+
+    // Write this while holding the mutex
+    mLastDequeueStartTime = startTime;
+
+    // This has to be done before any of the new buffers is mirrored.
+    const bool releaseAllBuffers =
+            std::any_of(results.begin(), results.end(), [](const auto& dequeueResult) {
+                return (dequeueResult.result & IGraphicBufferProducer::RELEASE_ALL_BUFFERS) != 0;
+            });
+    if (releaseAllBuffers) {
+        freeAllBuffers();
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& dequeueResult = results[i];
+        sp<GraphicBuffer>& gbuf(mSlots[dequeueResult.slot].buffer);
+
+        if (requests[i].getTimestamps) {
+            mFrameEventHistory->applyDelta(dequeueResult.timestamps);
+        }
+
+        if ((dequeueResult.result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) ||
+            gbuf == nullptr) {
+            if (mReportRemovedBuffers && (gbuf != nullptr)) {
+                mRemovedBuffers.push_back(gbuf);
+            }
+            invalidateQueryCacheLocked();
+            result = mGraphicBufferProducer->requestBuffer(dequeueResult.slot, &gbuf);
+            if (result != NO_ERROR) {
+                ALOGE("dequeueBuffers: IGraphicBufferProducer::requestBuffer failed: %d", result);
+                cancelDequeuedBuffers();
+                return result;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& dequeueResult = results[i];
+        const int slot = dequeueResult.slot;
+
+        // this should never happen
+        ALOGE_IF(dequeueResult.fence == nullptr,
+                 "Surface::dequeueBuffers: received null Fence! buf=%d", slot);
+
+        BatchBuffer& batchBuffer = (*buffers)[i];
+        if (dequeueResult.fence != nullptr && dequeueResult.fence->isValid()) {
+            batchBuffer.fenceFd = dequeueResult.fence->dup();
+            if (batchBuffer.fenceFd == -1) {
+                ALOGE("dequeueBuffers: error duping fence: %d", errno);
+            }
+        } else {
+            batchBuffer.fenceFd = -1;
+        }
+        batchBuffer.buffer = mSlots[slot].buffer.get();
+
+        if (mSharedBufferSlot == slot) {
+            mSharedBufferSlot = BufferItem::INVALID_BUFFER_SLOT;
+            mSharedBufferHasBeenQueued = false;
+        }
+
+        mDequeuedSlots.insert(slot);
+    }
+    mBufferAge = results.back().bufferAge;
+
+    return OK;
+}
+
 int Surface::cancelBuffer(android_native_buffer_t* buffer,
         int fenceFd) {
     ATRACE_CALL();
@@ -785,42 +932,21 @@ int Surface::lockBuffer_DEPRECATED(android_native_buffer_t* buffer __attribute__
     return OK;
 }
 
-int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
-    ATRACE_CALL();
-    ALOGV("Surface::queueBuffer");
-    Mutex::Autolock lock(mMutex);
-    int64_t timestamp;
+IGraphicBufferProducer::QueueBufferInput Surface::getQueueBufferInputLocked(
+        android_native_buffer_t* buffer, const sp<Fence>& fence, int64_t timestamp) {
     bool isAutoTimestamp = false;
 
-    if (mTimestamp == NATIVE_WINDOW_TIMESTAMP_AUTO) {
+    if (timestamp == NATIVE_WINDOW_TIMESTAMP_AUTO) {
         timestamp = systemTime(SYSTEM_TIME_MONOTONIC);
         isAutoTimestamp = true;
         ALOGV("Surface::queueBuffer making up timestamp: %.2f ms",
             timestamp / 1000000.0);
-    } else {
-        timestamp = mTimestamp;
-    }
-    int i = getSlotFromBufferLocked(buffer);
-    if (i < 0) {
-        if (fenceFd >= 0) {
-            close(fenceFd);
-        }
-        return i;
     }
-    if (mSharedBufferSlot == i && mSharedBufferHasBeenQueued) {
-        if (fenceFd >= 0) {
-            close(fenceFd);
-        }
-        return OK;
-    }
-
 
     // Make sure the crop rectangle is entirely inside the buffer.
     Rect crop(Rect::EMPTY_RECT);
     mCrop.intersect(Rect(buffer->width, buffer->height), &crop);
 
-    sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
-    IGraphicBufferProducer::QueueBufferOutput output;
     IGraphicBufferProducer::QueueBufferInput input(timestamp, isAutoTimestamp,
             static_cast<android_dataspace>(mDataSpace), crop, mScalingMode,
             mTransform ^ mStickyTransform, fence, mStickyTransform,
@@ -892,14 +1018,12 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
         input.setSurfaceDamage(flippedRegion);
     }
 
-    nsecs_t now = systemTime();
-    status_t err = mGraphicBufferProducer->queueBuffer(i, input, &output);
-    mLastQueueDuration = systemTime() - now;
-    if (err != OK)  {
-        ALOGE("queueBuffer: error queuing buffer to SurfaceTexture, %d", err);
-    }
+    return input;
+}
 
-    mDequeuedSlots.erase(i);
+void Surface::onBufferQueuedLocked(int slot, const sp<Fence>& fence,
+                                   const IGraphicBufferProducer::QueueBufferOutput& output) {
+    mDequeuedSlots.erase(slot);
 
     if (mEnableFrameTimestamps) {
         mFrameEventHistory->applyDelta(output.frameTimestamps);
@@ -933,7 +1057,7 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
         mDirtyRegion = Region::INVALID_REGION;
     }
 
-    if (mSharedBufferMode && mAutoRefresh && mSharedBufferSlot == i) {
+    if (mSharedBufferMode && mAutoRefresh && mSharedBufferSlot == slot) {
         mSharedBufferHasBeenQueued = true;
     }
 
@@ -943,10 +1067,109 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
         static FenceMonitor gpuCompletionThread("GPU completion");
         gpuCompletionThread.queueFence(fence);
     }
+}
+
+int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
+    ATRACE_CALL();
+    ALOGV("Surface::queueBuffer");
+    Mutex::Autolock lock(mMutex);
+    int i = getSlotFromBufferLocked(buffer);
+    if (i < 0) {
+        if (fenceFd >= 0) {
+            close(fenceFd);
+        }
+        return i;
+    }
+    if (mSharedBufferSlot == i && mSharedBufferHasBeenQueued) {
+        if (fenceFd >= 0) {
+            close(fenceFd);
+        }
+        return OK;
+    }
+
+    sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
+    IGraphicBufferProducer::QueueBufferOutput output;
+    IGraphicBufferProducer::QueueBufferInput input =
+            getQueueBufferInputLocked(buffer, fence, mTimestamp);
+
+    nsecs_t now = systemTime();
+    status_t err = mGraphicBufferProducer->queueBuffer(i, input, &output);
+    mLastQueueDuration = systemTime() - now;
+    if (err != OK)  {
+        ALOGE("queueBuffer: error queuing buffer to SurfaceTexture, %d", err);
+    }
+
+    onBufferQueuedLocked(i, fence, output);
 
     return err;
 }
 
+int Surface::queueBuffers(const std::vector<BatchQueuedBuffer>& buffers) {
+    ATRACE_CALL();
+    ALOGV("Surface::queueBuffers");
+    Mutex::Autolock lock(mMutex);
+
+    // Closes the fences that were not handed over to a Fence object yet.
+    auto closeFences = [&buffers](size_t begin) {
+        for (size_t i = begin; i < buffers.size(); i++) {
+            if (buffers[i].fenceFd >= 0) {
+                close(buffers[i].fenceFd);
+            }
+        }
+    };
+
+    if (buffers.empty()) {
+        ALOGE("queueBuffers: no buffers to queue");
+        return BAD_VALUE;
+    }
+    if (mSharedBufferMode) {
+        ALOGE("queueBuffers: not supported in shared buffer mode");
+        closeFences(0);
+        return INVALID_OPERATION;
+    }
+
+    std::vector<IGraphicBufferProducer::QueueBufferRequest> requests;
+    requests.reserve(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        const BatchQueuedBuffer& batchBuffer = buffers[i];
+        int slot = getSlotFromBufferLocked(batchBuffer.buffer);
+        if (slot < 0) {
+            closeFences(i);
+            return slot;
+        }
+
+        sp<Fence> fence(batchBuffer.fenceFd >= 0 ? new Fence(batchBuffer.fenceFd)
+                                                 : Fence::NO_FENCE);
+        requests.push_back({slot,
+                            getQueueBufferInputLocked(batchBuffer.buffer, fence,
+                                                      batchBuffer.timestamp)});
+
+        if (!mConnectedToCpu) {
+            // The surface damage only applies to the first buffer.
+            mDirtyRegion = Region::INVALID_REGION;
+        }
+    }
+
+    std::vector<IGraphicBufferProducer::QueueBufferResult> results;
+    nsecs_t now = systemTime();
+    status_t err = mGraphicBufferProducer->queueBuffers(requests, &results);
+    mLastQueueDuration = systemTime() - now;
+    if (err != OK) {
+        ALOGE("queueBuffers: error queuing buffers to SurfaceTexture, %d", err);
+        return err;
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        onBufferQueuedLocked(requests[i].slot, requests[i].input.fence, results[i].output);
+        if (results[i].result != OK) {
+            ALOGE("queueBuffers: error queuing buffer to SurfaceTexture, %d", results[i].result);
+            return results[i].result;
+        }
+    }
+
+    return OK;
+}
+
 void Surface::querySupportedTimestampsLocked() const {
     // mMutex must be locked when calling this method.
 
@@ -1056,11 +1279,52 @@ int Surface::query(int what, int* value) const {
                 *value = mMaxBufferCount;
                 return NO_ERROR;
             }
+            case NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS:
+            case NATIVE_WINDOW_CONSUMER_USAGE_BITS:
+            case NATIVE_WINDOW_DEFAULT_DATASPACE:
+                if (queryCachedLocked(what, value)) {
+                    return NO_ERROR;
+                }
+                break;
         }
     }
     return mGraphicBufferProducer->query(what, value);
 }
 
+bool Surface::queryCachedLocked(int what, int* value) const {
+    std::optional<int>* cached;
+    switch (what) {
+        case NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS:
+            cached = &mCachedMinUndequeuedBuffers;
+            break;
+        case NATIVE_WINDOW_CONSUMER_USAGE_BITS:
+            cached = &mCachedConsumerUsageBits;
+            break;
+        case NATIVE_WINDOW_DEFAULT_DATASPACE:
+            cached = &mCachedDefaultDataSpace;
+            break;
+        default:
+            return false;
+    }
+
+    if (!cached->has_value()) {
+        int result = 0;
+        if (mGraphicBufferProducer->query(what, &result) != NO_ERROR) {
+            return false;
+        }
+        *cached = result;
+    }
+    *value = **cached;
+    return true;
+}
+
+void Surface::invalidateQueryCacheLocked() {
+    mCachedMinUndequeuedBuffers.reset();
+    mCachedConsumerUsageBits.reset();
+    mCachedDefaultDataSpace.reset();
+    mCachedConsumerUsage64.reset();
+}
+
 int Surface::perform(int operation, va_list args)
 {
     int res = NO_ERROR;
@@ -1207,6 +1471,9 @@ int Surface::perform(int operation, va_list args)
     case NATIVE_WINDOW_GET_LAST_QUEUED_BUFFER:
         res = dispatchGetLastQueuedBuffer(args);
         break;
+    case NATIVE_WINDOW_SET_BUFFERS_USER_GEOMETRY:
+        res = dispatchSetBuffersUserGeometry(args);
+        break;
     default:
         res = NAME_NOT_FOUND;
         break;
@@ -1255,6 +1522,14 @@ int Surface::dispatchSetBuffersGeometry(va_list args) {
     return setBuffersFormat(format);
 }
 
+int Surface::dispatchSetBuffersUserGeometry(va_list args) {
+    uint32_t width = va_arg(args, uint32_t);
+    uint32_t height = va_arg(args, uint32_t);
+    PixelFormat format = va_arg(args, PixelFormat);
+    int scalingMode = va_arg(args, int);
+    return setBuffersUserGeometry(width, height, format, scalingMode);
+}
+
 int Surface::dispatchSetBuffersDimensions(va_list args) {
     uint32_t width = va_arg(args, uint32_t);
     uint32_t height = va_arg(args, uint32_t);
@@ -1543,6 +1818,7 @@ int Surface::connect(
     IGraphicBufferProducer::QueueBufferOutput output;
     mReportRemovedBuffers = reportBufferRemoval;
     int err = mGraphicBufferProducer->connect(listener, api, mProducerControlledByApp, &output);
+    invalidateQueryCacheLocked();
     if (err == NO_ERROR) {
         mDefaultWidth = output.width;
         mDefaultHeight = output.height;
@@ -1580,6 +1856,7 @@ int Surface::disconnect(int api, IGraphicBufferProducer::DisconnectMode mode) {
     mSharedBufferHasBeenQueued = false;
     freeAllBuffers();
     int err = mGraphicBufferProducer->disconnect(api, mode);
+    invalidateQueryCacheLocked();
     if (!err) {
         mReqFormat = 0;
         mReqWidth = 0;
@@ -1712,8 +1989,10 @@ int Surface::setBufferCount(int bufferCount)
         err = mGraphicBufferProducer->setMaxDequeuedBufferCount(1);
     } else {
         int minUndequeuedBuffers = 0;
-        err = mGraphicBufferProducer->query(
-                NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS, &minUndequeuedBuffers);
+        err = queryCachedLocked(NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS, &minUndequeuedBuffers)
+                ? NO_ERROR
+                : mGraphicBufferProducer->query(NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS,
+                                                &minUndequeuedBuffers);
         if (err == NO_ERROR) {
             err = mGraphicBufferProducer->setMaxDequeuedBufferCount(
                     bufferCount - minUndequeuedBuffers);
@@ -1745,6 +2024,7 @@ int Surface::setAsyncMode(bool async) {
     Mutex::Autolock lock(mMutex);
 
     status_t err = mGraphicBufferProducer->setAsyncMode(async);
+    invalidateQueryCacheLocked();
     ALOGE_IF(err, "IGraphicBufferProducer::setAsyncMode(%d) returned %s",
             async, strerror(-err));
 
@@ -1827,6 +2107,40 @@ int Surface::setBuffersFormat(PixelFormat format)
     return NO_ERROR;
 }
 
+int Surface::setBuffersUserGeometry(uint32_t width, uint32_t height, PixelFormat format,
+                                    int scalingMode) {
+    ATRACE_CALL();
+    ALOGV("Surface::setBuffersUserGeometry");
+
+    Mutex::Autolock lock(mMutex);
+    if (format != mReqFormat) {
+        mSharedBufferSlot = BufferItem::INVALID_BUFFER_SLOT;
+    }
+    mReqFormat = format;
+
+    if ((width && !height) || (!width && height)) {
+        return BAD_VALUE;
+    }
+    if (width != mUserWidth || height != mUserHeight) {
+        mSharedBufferSlot = BufferItem::INVALID_BUFFER_SLOT;
+    }
+    mUserWidth = width;
+    mUserHeight = height;
+
+    switch (scalingMode) {
+        case NATIVE_WINDOW_SCALING_MODE_FREEZE:
+        case NATIVE_WINDOW_SCALING_MODE_SCALE_TO_WINDOW:
+        case NATIVE_WINDOW_SCALING_MODE_SCALE_CROP:
+        case NATIVE_WINDOW_SCALING_MODE_NO_SCALE_CROP:
+            break;
+        default:
+            ALOGE("unknown scaling mode: %d", scalingMode);
+            return BAD_VALUE;
+    }
+    mScalingMode = scalingMode;
+    return NO_ERROR;
+}
+
 int Surface::setScalingMode(int mode)
 {
     ATRACE_CALL();
@@ -2183,8 +2497,20 @@ status_t Surface::getUniqueId(uint64_t* outId) const {
 }
 
 int Surface::getConsumerUsage(uint64_t* outUsage) const {
+    if (outUsage == nullptr) {
+        return BAD_VALUE;
+    }
     Mutex::Autolock lock(mMutex);
-    return mGraphicBufferProducer->getConsumerUsage(outUsage);
+    if (!mCachedConsumerUsage64.has_value()) {
+        uint64_t usage = 0;
+        status_t err = mGraphicBufferProducer->getConsumerUsage(&usage);
+        if (err != NO_ERROR) {
+            return err;
+        }
+        mCachedConsumerUsage64 = usage;
+    }
+    *outUsage = *mCachedConsumerUsage64;
+    return NO_ERROR;
 }
 
 status_t Surface::getAndFlushRemovedBuffers(std::vector<sp<GraphicBuffer>>* out) {
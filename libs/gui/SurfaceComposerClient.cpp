@@ -16,9 +16,18 @@
 
 #define LOG_TAG "SurfaceComposerClient"
 
+#include <pthread.h>
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 #include <utils/Errors.h>
 #include <utils/Log.h>
 #include <utils/SortedVector.h>
@@ -40,12 +49,15 @@
 #include <gui/Surface.h>
 #include <gui/SurfaceComposerClient.h>
 #include <ui/DisplayConfig.h>
+#include <ui/DisplayInfo.h>
+#include <ui/HdrCapabilities.h>
 
 #ifndef NO_INPUT
 #include <input/InputWindow.h>
 #endif
 
 #include <private/gui/ComposerService.h>
+#include <private/gui/InputInfoCache.h>
 
 // This server size should always be smaller than the server cache size
 #define BUFFER_CACHE_MAX_SIZE 64
@@ -55,6 +67,144 @@ namespace android {
 using ui::ColorMode;
 // ---------------------------------------------------------------------------
 
+// Caches the properties of internal displays that stay the same while SurfaceFlinger runs, so that
+// the queries apps and the framework repeat during startup and layout are memory reads. External
+// displays can come back with other configs under the same token after a hotplug, so their
+// properties are always fetched. The active config changes at runtime and is not cached at all.
+class DisplayPropertiesCache {
+public:
+    static DisplayPropertiesCache& getInstance() {
+        static DisplayPropertiesCache* sInstance = new DisplayPropertiesCache();
+        return *sInstance;
+    }
+
+    status_t getDisplayInfo(const sp<ISurfaceComposer>& sf, const sp<IBinder>& display,
+                            DisplayInfo* info) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const Entry* entry = findLocked(display);
+            if (entry != nullptr && entry->internal) {
+                *info = entry->info;
+                return NO_ERROR;
+            }
+        }
+        const status_t result = sf->getDisplayInfo(display, info);
+        if (result == NO_ERROR) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            addLocked(display, *info);
+        }
+        return result;
+    }
+
+    status_t getDisplayConfigs(const sp<ISurfaceComposer>& sf, const sp<IBinder>& display,
+                               Vector<DisplayConfig>* configs) {
+        if (!isInternal(sf, display)) {
+            return sf->getDisplayConfigs(display, configs);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const Entry* entry = findLocked(display);
+            if (entry != nullptr && entry->configs) {
+                *configs = *entry->configs;
+                return NO_ERROR;
+            }
+        }
+        const status_t result = sf->getDisplayConfigs(display, configs);
+        if (result == NO_ERROR) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (Entry* entry = findLocked(display)) {
+                entry->configs = *configs;
+            }
+        }
+        return result;
+    }
+
+    status_t getHdrCapabilities(const sp<ISurfaceComposer>& sf, const sp<IBinder>& display,
+                                HdrCapabilities* outCapabilities) {
+        if (!isInternal(sf, display)) {
+            return sf->getHdrCapabilities(display, outCapabilities);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const Entry* entry = findLocked(display);
+            if (entry != nullptr && entry->hdrCapabilities) {
+                *outCapabilities = copyOf(*entry->hdrCapabilities);
+                return NO_ERROR;
+            }
+        }
+        const status_t result = sf->getHdrCapabilities(display, outCapabilities);
+        if (result == NO_ERROR) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (Entry* entry = findLocked(display)) {
+                entry->hdrCapabilities = copyOf(*outCapabilities);
+            }
+        }
+        return result;
+    }
+
+    // Display tokens do not outlive SurfaceFlinger, so everything is dropped when it dies.
+    void clear() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.clear();
+    }
+
+private:
+    struct Entry {
+        wp<IBinder> token;
+        bool internal = false;
+        DisplayInfo info;
+        std::optional<Vector<DisplayConfig>> configs;
+        std::optional<HdrCapabilities> hdrCapabilities;
+    };
+
+    static HdrCapabilities copyOf(const HdrCapabilities& capabilities) {
+        return HdrCapabilities(capabilities.getSupportedHdrTypes(),
+                               capabilities.getDesiredMaxLuminance(),
+                               capabilities.getDesiredMaxAverageLuminance(),
+                               capabilities.getDesiredMinLuminance());
+    }
+
+    // Whether |display| is internal, fetching its DisplayInfo the first time it is seen.
+    bool isInternal(const sp<ISurfaceComposer>& sf, const sp<IBinder>& display) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (const Entry* entry = findLocked(display)) {
+                return entry->internal;
+            }
+        }
+        DisplayInfo info;
+        return getDisplayInfo(sf, display, &info) == NO_ERROR &&
+                info.connectionType == DisplayConnectionType::Internal;
+    }
+
+    // Entries are keyed by address, so one whose token has been destroyed is dropped rather than
+    // returned for a new token that happens to reuse the address.
+    Entry* findLocked(const sp<IBinder>& display) {
+        const auto it = mEntries.find(display.get());
+        if (it == mEntries.end()) {
+            return nullptr;
+        }
+        if (it->second.token.promote() != display) {
+            mEntries.erase(it);
+            return nullptr;
+        }
+        return &it->second;
+    }
+
+    void addLocked(const sp<IBinder>& display, const DisplayInfo& info) {
+        for (auto it = mEntries.begin(); it != mEntries.end();) {
+            it = it->second.token.promote() == nullptr ? mEntries.erase(it) : std::next(it);
+        }
+        Entry& entry = mEntries[display.get()];
+        entry.token = display;
+        entry.internal = info.connectionType == DisplayConnectionType::Internal;
+        entry.info = info;
+    }
+
+    std::mutex mMutex;
+    std::map<const IBinder*, Entry> mEntries;
+};
+
 ANDROID_SINGLETON_STATIC_INSTANCE(ComposerService);
 
 ComposerService::ComposerService()
@@ -102,8 +252,50 @@ void ComposerService::composerServiceDied()
     Mutex::Autolock _l(mLock);
     mComposerService = nullptr;
     mDeathObserver = nullptr;
+    DisplayPropertiesCache::getInstance().clear();
+}
+
+#ifndef NO_INPUT
+InputInfoCache& InputInfoCache::getInstance() {
+    static InputInfoCache* sInstance = new InputInfoCache();
+    return *sInstance;
 }
 
+bool InputInfoCache::shouldSend(const sp<IBinder>& handle, const InputWindowInfo& info) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry& entry = getEntryLocked(handle);
+    if (entry.shared) {
+        return true;
+    }
+    if (entry.info == info) {
+        return false;
+    }
+    entry.info = info;
+    return true;
+}
+
+void InputInfoCache::markShared(const sp<IBinder>& handle) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry& entry = getEntryLocked(handle);
+    entry.shared = true;
+    entry.info = InputWindowInfo();
+}
+
+InputInfoCache::Entry& InputInfoCache::getEntryLocked(const sp<IBinder>& handle) {
+    const auto it = mEntries.find(handle.get());
+    if (it != mEntries.end() && it->second.handle.promote() == handle) {
+        return it->second;
+    }
+    for (auto dead = mEntries.begin(); dead != mEntries.end();) {
+        dead = dead->second.handle.promote() == nullptr ? mEntries.erase(dead) : std::next(dead);
+    }
+    Entry& entry = mEntries[handle.get()];
+    entry = Entry();
+    entry.handle = handle;
+    return entry;
+}
+#endif
+
 class DefaultComposerClient: public Singleton<DefaultComposerClient> {
     Mutex mLock;
     sp<SurfaceComposerClient> mClient;
@@ -348,6 +540,67 @@ void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId) {
 
 // ---------------------------------------------------------------------------
 
+// Sends the transactions handed over by Transaction::applyAsync to SurfaceFlinger on a
+// background thread, one at a time and in the order they were handed over.
+class AsyncTransactionApplier {
+public:
+    static AsyncTransactionApplier& getInstance() {
+        // Never destroyed, so that the thread can outlive static destructors.
+        static AsyncTransactionApplier* sInstance = new AsyncTransactionApplier();
+        return *sInstance;
+    }
+
+    void enqueue(std::function<void()> job) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mThread.joinable()) {
+            mThread = std::thread(&AsyncTransactionApplier::threadMain, this);
+            mThreadId = mThread.get_id();
+        }
+        mJobs.push_back(std::move(job));
+        mCondition.notify_all();
+    }
+
+    // Waits until everything handed over so far has been sent, so that a transaction the caller
+    // sends next cannot overtake it. Returns at once when called from the background thread,
+    // e.g. by a buffer death callback while a transaction's buffers are released.
+    void waitUntilIdle() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (std::this_thread::get_id() == mThreadId) {
+            return;
+        }
+        mCondition.wait(lock, [this] { return mJobs.empty() && !mBusy; });
+    }
+
+private:
+    void threadMain() {
+        pthread_setname_np(pthread_self(), "TransactionApply");
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true) {
+            mCondition.wait(lock, [this] { return !mJobs.empty(); });
+            std::function<void()> job = std::move(mJobs.front());
+            mJobs.pop_front();
+            mBusy = true;
+            lock.unlock();
+            job();
+            // Drop the transaction's references before reporting it as sent.
+            job = nullptr;
+            lock.lock();
+            mBusy = false;
+            mCondition.notify_all();
+        }
+    }
+
+    // Everything below is protected by mMutex.
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::function<void()>> mJobs;
+    bool mBusy = false;
+    std::thread mThread;
+    std::thread::id mThreadId;
+};
+
+// ---------------------------------------------------------------------------
+
 SurfaceComposerClient::Transaction::Transaction(const Transaction& other)
       : mForceSynchronous(other.mForceSynchronous),
         mTransactionNestCount(other.mTransactionNestCount),
@@ -436,6 +689,11 @@ status_t SurfaceComposerClient::Transaction::readFromParcel(const Parcel* parcel
         if (composerState.read(*parcel) == BAD_VALUE) {
             return BAD_VALUE;
         }
+#ifndef NO_INPUT
+        if (surfaceControlHandle != nullptr) {
+            InputInfoCache::getInstance().markShared(surfaceControlHandle);
+        }
+#endif
         composerStates[surfaceControlHandle] = composerState;
     }
 
@@ -500,6 +758,9 @@ status_t SurfaceComposerClient::Transaction::writeToParcel(Parcel* parcel) const
 
     parcel->writeUint32(static_cast<uint32_t>(mComposerStates.size()));
     for (auto const& [surfaceHandle, composerState] : mComposerStates) {
+#ifndef NO_INPUT
+        InputInfoCache::getInstance().markShared(surfaceHandle);
+#endif
         parcel->writeStrongBinder(surfaceHandle);
         composerState.write(*parcel);
     }
@@ -582,6 +843,7 @@ void SurfaceComposerClient::doUncacheBufferTransaction(uint64_t cacheId) {
     uncacheBuffer.id = cacheId;
 
     sp<IBinder> applyToken = IInterface::asBinder(TransactionCompletedListener::getIInstance());
+    AsyncTransactionApplier::getInstance().waitUntilIdle();
     sf->setTransactionState({}, {}, 0, applyToken, {}, -1, uncacheBuffer, false, {});
 }
 
@@ -632,6 +894,14 @@ void SurfaceComposerClient::Transaction::cacheBuffers() {
 }
 
 status_t SurfaceComposerClient::Transaction::apply(bool synchronous) {
+    return applyInternal(synchronous, false /* async */);
+}
+
+status_t SurfaceComposerClient::Transaction::applyAsync() {
+    return applyInternal(false /* synchronous */, true /* async */);
+}
+
+status_t SurfaceComposerClient::Transaction::applyInternal(bool synchronous, bool async) {
     if (mStatus != NO_ERROR) {
         return mStatus;
     }
@@ -640,6 +910,7 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous) {
 
     bool hasListenerCallbacks = !mListenerCallbacks.empty();
     std::vector<ListenerCallbacks> listenerCallbacks;
+    listenerCallbacks.reserve(mListenerCallbacks.size());
     // For every listener with registered callbacks
     for (const auto& [listener, callbackInfo] : mListenerCallbacks) {
         auto& [callbackIds, surfaceControls] = callbackInfo;
@@ -675,7 +946,17 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous) {
 
     mForceSynchronous |= synchronous;
 
+    composerStates.setCapacity(mComposerStates.size());
     for (auto const& kv : mComposerStates){
+#ifndef NO_INPUT
+        if ((kv.second.state.what & layer_state_t::eInputInfoChanged) &&
+            !InputInfoCache::getInstance().shouldSend(kv.first, kv.second.state.inputInfo)) {
+            ComposerState s = kv.second;
+            s.state.what &= ~layer_state_t::eInputInfoChanged;
+            composerStates.add(s);
+            continue;
+        }
+#endif
         composerStates.add(kv.second);
     }
 
@@ -710,10 +991,24 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous) {
     mExplicitEarlyWakeupEnd = false;
 
     sp<IBinder> applyToken = IInterface::asBinder(TransactionCompletedListener::getIInstance());
-    sf->setTransactionState(composerStates, displayStates, flags, applyToken, mInputWindowCommands,
-                            mDesiredPresentTime,
-                            {} /*uncacheBuffer - only set in doUncacheBufferTransaction*/,
-                            hasListenerCallbacks, listenerCallbacks);
+    if (async && !(flags & ISurfaceComposer::eSynchronous)) {
+        AsyncTransactionApplier::getInstance().enqueue(
+                [sf, composerStates, displayStates, flags, applyToken,
+                 inputWindowCommands = mInputWindowCommands,
+                 desiredPresentTime = mDesiredPresentTime, hasListenerCallbacks,
+                 listenerCallbacks = std::move(listenerCallbacks)]() {
+                    sf->setTransactionState(composerStates, displayStates, flags, applyToken,
+                                            inputWindowCommands, desiredPresentTime,
+                                            {} /*uncacheBuffer*/, hasListenerCallbacks,
+                                            listenerCallbacks);
+                });
+    } else {
+        AsyncTransactionApplier::getInstance().waitUntilIdle();
+        sf->setTransactionState(composerStates, displayStates, flags, applyToken,
+                                mInputWindowCommands, mDesiredPresentTime,
+                                {} /*uncacheBuffer - only set in doUncacheBufferTransaction*/,
+                                hasListenerCallbacks, listenerCallbacks);
+    }
     mInputWindowCommands.clear();
     mStatus = NO_ERROR;
     return NO_ERROR;
@@ -1713,12 +2008,14 @@ status_t SurfaceComposerClient::getDisplayState(const sp<IBinder>& display,
 }
 
 status_t SurfaceComposerClient::getDisplayInfo(const sp<IBinder>& display, DisplayInfo* info) {
-    return ComposerService::getComposerService()->getDisplayInfo(display, info);
+    return DisplayPropertiesCache::getInstance().getDisplayInfo(ComposerService::getComposerService(),
+                                                                display, info);
 }
 
 status_t SurfaceComposerClient::getDisplayConfigs(const sp<IBinder>& display,
                                                   Vector<DisplayConfig>* configs) {
-    return ComposerService::getComposerService()->getDisplayConfigs(display, configs);
+    return DisplayPropertiesCache::getInstance()
+            .getDisplayConfigs(ComposerService::getComposerService(), display, configs);
 }
 
 status_t SurfaceComposerClient::getActiveDisplayConfig(const sp<IBinder>& display,
@@ -1835,8 +2132,8 @@ status_t SurfaceComposerClient::getAnimationFrameStats(FrameStats* outStats) {
 
 status_t SurfaceComposerClient::getHdrCapabilities(const sp<IBinder>& display,
         HdrCapabilities* outCapabilities) {
-    return ComposerService::getComposerService()->getHdrCapabilities(display,
-            outCapabilities);
+    return DisplayPropertiesCache::getInstance()
+            .getHdrCapabilities(ComposerService::getComposerService(), display, outCapabilities);
 }
 
 status_t SurfaceComposerClient::getDisplayedContentSamplingAttributes(const sp<IBinder>& display,
@@ -1939,6 +2236,19 @@ status_t ScreenshotClient::capture(uint64_t displayOrLayerStack, ui::Dataspace*
     return s->captureScreen(displayOrLayerStack, outDataspace, outBuffer);
 }
 
+status_t ScreenshotClient::captureAsync(const sp<IBinder>& display, ui::Dataspace reqDataSpace,
+                                        ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
+                                        uint32_t reqWidth, uint32_t reqHeight,
+                                        bool useIdentityTransform, ui::Rotation rotation,
+                                        bool captureSecureLayers, sp<GraphicBuffer>* outBuffer,
+                                        sp<Fence>* outReadyFence, bool& outCapturedSecureLayers) {
+    sp<ISurfaceComposer> s(ComposerService::getComposerService());
+    if (s == nullptr) return NO_INIT;
+    return s->captureScreenAsync(display, outBuffer, outReadyFence, outCapturedSecureLayers,
+                                 reqDataSpace, reqPixelFormat, sourceCrop, reqWidth, reqHeight,
+                                 useIdentityTransform, rotation, captureSecureLayers);
+}
+
 status_t ScreenshotClient::captureLayers(const sp<IBinder>& layerHandle, ui::Dataspace reqDataSpace,
                                          ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
                                          float frameScale, sp<GraphicBuffer>* outBuffer) {
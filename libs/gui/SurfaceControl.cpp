@@ -39,6 +39,8 @@
 #include <gui/SurfaceComposerClient.h>
 #include <gui/SurfaceControl.h>
 
+#include <private/gui/InputInfoCache.h>
+
 namespace android {
 
 // ============================================================================
@@ -171,6 +173,9 @@ void SurfaceControl::setTransformHint(uint32_t hint) {
 
 void SurfaceControl::writeToParcel(Parcel* parcel)
 {
+#ifndef NO_INPUT
+    InputInfoCache::getInstance().markShared(mHandle);
+#endif
     parcel->writeStrongBinder(ISurfaceComposerClient::asBinder(mClient->getClient()));
     parcel->writeStrongBinder(mHandle);
     parcel->writeStrongBinder(IGraphicBufferProducer::asBinder(mGraphicBufferProducer));
@@ -189,6 +194,9 @@ sp<SurfaceControl> SurfaceControl::readFromParcel(const Parcel* parcel) {
     parcel->readNullableStrongBinder(&gbp);
 
     uint32_t transformHint = parcel->readUint32();
+#ifndef NO_INPUT
+    InputInfoCache::getInstance().markShared(handle);
+#endif
     // We aren't the original owner of the surface.
     return new SurfaceControl(new SurfaceComposerClient(
                                       interface_cast<ISurfaceComposerClient>(client)),
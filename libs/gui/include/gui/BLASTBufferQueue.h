@@ -27,6 +27,7 @@
 #include <utils/RefBase.h>
 
 #include <system/window.h>
+#include <functional>
 #include <thread>
 
 namespace android {
@@ -83,6 +84,23 @@ public:
 
     void update(const sp<SurfaceControl>& surface, int width, int height);
 
+    // Sets how many transactions may wait for SurfaceFlinger at once. Frames queued beyond that
+    // are held until a transaction completes. Defaults to 1.
+    status_t setMaxInFlightTransactions(int32_t count);
+
+    // When enabled, frames which are superseded by a newer frame before they could be sent are
+    // released without being presented, so that the next transaction only carries the latest
+    // frame. Frames sent with the next transaction are never dropped.
+    void setDropSupersededFrames(bool drop);
+
+    // Called once SurfaceFlinger has latched a frame, with the frame number, the timestamp the
+    // frame was queued with, the time it was latched and the present fence of the display
+    // frame that shows it. Called without internal locks held, on a binder thread.
+    using FramePresentedListener =
+            std::function<void(uint64_t frameNumber, nsecs_t timestamp, nsecs_t latchTime,
+                               const sp<Fence>& presentFence)>;
+    void setFramePresentedListener(FramePresentedListener listener);
+
     virtual ~BLASTBufferQueue() = default;
 
 private:
@@ -102,11 +120,17 @@ private:
 
     // BufferQueue internally allows 1 more than
     // the max to be acquired
-    static const int MAX_ACQUIRED_BUFFERS = 1;
+    int32_t mMaxAcquiredBuffers GUARDED_BY(mMutex) = 1;
+    bool mDropSupersededFrames GUARDED_BY(mMutex) = false;
 
     int32_t mNumFrameAvailable GUARDED_BY(mMutex);
     int32_t mNumAcquired GUARDED_BY(mMutex);
 
+    // Frames released without being presented because a newer frame was available.
+    uint64_t mNumDroppedFrames GUARDED_BY(mMutex) = 0;
+    // Transactions which carried the latest of several available frames.
+    uint64_t mNumMergedTransactions GUARDED_BY(mMutex) = 0;
+
     struct PendingReleaseItem {
         BufferItem item;
         sp<Fence> releaseFence;
@@ -125,6 +149,8 @@ private:
     sp<BLASTBufferItemConsumer> mBufferItemConsumer;
 
     SurfaceComposerClient::Transaction* mNextTransaction GUARDED_BY(mMutex);
+
+    FramePresentedListener mFramePresentedListener GUARDED_BY(mMutex);
 };
 
 } // namespace android
@@ -76,6 +76,13 @@ class BufferItemConsumer: public ConsumerBase
     status_t acquireBuffer(BufferItem* item, nsecs_t presentWhen,
             bool waitForFence = true);
 
+    // Acquires the newest queued buffer, like acquireBuffer, and releases every
+    // older queued buffer unread. This suits consumers that only ever show the
+    // latest frame, especially with setFrameAvailableCoalescing enabled. If the
+    // maximum number of buffers is acquired part way through, the newest
+    // buffer acquired so far is returned.
+    status_t acquireLatestBuffer(BufferItem* item, bool waitForFence = true);
+
     // Returns an acquired buffer to the queue, allowing it to be reused. Since
     // only a fixed number of buffers may be acquired at a time, old buffers
     // must be released by calling releaseBuffer to ensure new buffers can be
@@ -26,9 +26,11 @@
 #include <utils/RefBase.h>
 #include <utils/String8.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 #include <utils/Vector.h>
 
+#include <array>
 #include <list>
 #include <set>
 #include <mutex>
@@ -78,9 +80,16 @@ public:
     virtual ~BufferQueueCore();
 
 private:
+    // The operations whose contention on mMutex is reported by dumpState.
+    enum class LockedOperation { Dequeue, Queue, Acquire, Release, Count };
+
     // Dump our state in a string
     void dumpState(const String8& prefix, String8* outResult) const;
 
+    // lockForOperation locks mMutex on behalf of the given operation, and
+    // records how long it had to wait if another thread was holding it.
+    std::unique_lock<std::mutex> lockForOperation(LockedOperation operation);
+
     // getMinUndequeuedBufferCountLocked returns the minimum number of buffers
     // that must remain in a state other than DEQUEUED. The async parameter
     // tells whether we're in asynchronous mode.
@@ -354,6 +363,15 @@ private:
     // mTransformHintInUse is to cache the mTransformHint used by the producer.
     uint32_t mTransformHintInUse;
 
+    // mLockContention counts, for each LockedOperation, how often mMutex was
+    // locked and how often and how long it had to wait for another thread.
+    struct LockContention {
+        uint64_t lockCount = 0;
+        uint64_t contendedCount = 0;
+        nsecs_t waitTime = 0;
+    };
+    std::array<LockContention, static_cast<size_t>(LockedOperation::Count)> mLockContention;
+
 }; // class BufferQueueCore
 
 } // namespace android
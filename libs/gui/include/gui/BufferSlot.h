@@ -182,7 +182,8 @@ struct BufferSlot {
       mEglFence(EGL_NO_SYNC_KHR),
       mFence(Fence::NO_FENCE),
       mAcquireCalled(false),
-      mNeedsReallocation(false) {
+      mNeedsReallocation(false),
+      mQueueTime(0) {
     }
 
     // mGraphicBuffer points to the buffer allocated for this slot or is NULL
@@ -230,6 +231,10 @@ struct BufferSlot {
     // producer. If so, it needs to set the BUFFER_NEEDS_REALLOCATION flag when
     // dequeued to prevent the producer from using a stale cached buffer.
     bool mNeedsReallocation;
+
+    // mQueueTime is when this slot was last queued, used to measure how long
+    // queued buffers wait to be acquired.
+    nsecs_t mQueueTime;
 };
 
 } // namespace android
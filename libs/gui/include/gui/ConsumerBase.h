@@ -80,6 +80,13 @@ public:
     // when a new frame becomes available.
     void setFrameAvailableListener(const wp<FrameAvailableListener>& listener);
 
+    // setFrameAvailableCoalescing makes the listener get at most one
+    // onFrameAvailable call until the next acquire, however many frames are
+    // queued in between. A notification may then stand for several frames, so a
+    // consumer that enables this must keep acquiring until no buffer is
+    // available, or acquire only the latest frame. It is disabled by default.
+    void setFrameAvailableCoalescing(bool enabled);
+
     // See IGraphicBufferConsumer::detachBuffer
     status_t detachBuffer(int slot);
 
@@ -264,6 +271,12 @@ protected:
     Mutex mFrameAvailableMutex;
     wp<FrameAvailableListener> mFrameAvailableListener;
 
+    // mCoalesceFrameAvailable is set by setFrameAvailableCoalescing, and
+    // mFrameAvailablePending records that the listener has been notified since
+    // the last acquire. Both are protected by mFrameAvailableMutex.
+    bool mCoalesceFrameAvailable = false;
+    bool mFrameAvailablePending = false;
+
     // The ConsumerBase has-a BufferQueue and is responsible for creating this object
     // if none is supplied
     sp<IGraphicBufferConsumer> mConsumer;
@@ -111,6 +111,36 @@ class CpuConsumer : public ConsumerBase
     // lockNextBuffer.
     status_t unlockBuffer(const LockedBuffer &nativeBuffer);
 
+    // Keeps buffers mapped for CPU access after unlockBuffer, so that locking a
+    // slot again while it still holds the same buffer reuses the mapping instead
+    // of going through gralloc. A slot's mapping is dropped when its buffer is
+    // freed or when persistent mapping is disabled again.
+    //
+    // Gralloc flushes and invalidates CPU caches when a buffer is locked and
+    // unlocked, which a reused mapping skips. Only enable this when the
+    // producer's writes are visible to the CPU without it, e.g. for buffers
+    // written by the CPU or allocated from cache-coherent memory. The producer
+    // must also be able to write a buffer while it is locked by this consumer,
+    // which in practice means it lives in another process.
+    void setPersistentMappingEnabled(bool enabled);
+
+    // Cost of mapping buffers for CPU access since this consumer was created.
+    struct MappingStats {
+        // Number of buffers locked through gralloc.
+        uint64_t mapCount = 0;
+        // Number of buffers that reused a persistent mapping.
+        uint64_t reuseCount = 0;
+        // Time spent locking and unlocking buffers through gralloc. Waiting on
+        // a buffer's acquire fence is included in mapTime.
+        nsecs_t mapTime = 0;
+        nsecs_t unmapTime = 0;
+        nsecs_t maxMapTime = 0;
+    };
+    MappingStats getMappingStats() const;
+
+  protected:
+    void freeBufferLocked(int slotIndex) override;
+
   private:
     // Maximum number of buffers that can be locked at a time
     const size_t mMaxLockedBuffers;
@@ -140,12 +170,29 @@ class CpuConsumer : public ConsumerBase
 
     size_t findAcquiredBufferLocked(uintptr_t id) const;
 
-    status_t lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const;
+    status_t lockBufferItem(const BufferItem& item, const Rect& lockRect,
+                            LockedBuffer* outBuffer) const;
+
+    // Unlocks the persistent mapping of a slot, if it has one.
+    status_t unmapSlotLocked(int slot);
 
     Vector<AcquiredBuffer> mAcquiredBuffers;
 
     // Count of currently locked buffers
     size_t mCurrentLockedBuffers;
+
+    // Buffers that stay locked between frames while persistent mapping is
+    // enabled, indexed by slot. Only the pointer and stride fields of
+    // mLockedBuffer are reused.
+    struct SlotMapping {
+        sp<GraphicBuffer> mGraphicBuffer;
+        LockedBuffer mLockedBuffer;
+    };
+    SlotMapping mSlotMappings[BufferQueue::NUM_BUFFER_SLOTS];
+
+    bool mPersistentMapping = false;
+
+    MappingStats mMappingStats;
 };
 
 } // namespace android
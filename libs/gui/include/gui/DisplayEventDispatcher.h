@@ -18,6 +18,8 @@
 #include <utils/Log.h>
 #include <utils/Looper.h>
 
+#include <vector>
+
 namespace android {
 
 class DisplayEventDispatcher : public LooperCallback {
@@ -35,13 +37,28 @@ public:
     int getFd() const;
     virtual int handleEvent(int receiveFd, int events, void* data);
 
+    // Sets how many events are read from the receiver at a time.
+    void setEventBatchSize(size_t size);
+
+    // Returns how many vsync events were not dispatched, either because a later vsync for the
+    // same display was read along with them, or because they were drained while scheduling.
+    uint64_t getDroppedVsyncCount() const { return mDroppedVsyncCount; }
+
 protected:
     virtual ~DisplayEventDispatcher() = default;
 
 private:
+    struct PendingVsync {
+        nsecs_t timestamp;
+        PhysicalDisplayId displayId;
+        uint32_t count;
+    };
+
     sp<Looper> mLooper;
     DisplayEventReceiver mReceiver;
     bool mWaitingForVsync;
+    std::vector<DisplayEventReceiver::Event> mEventBuffer;
+    uint64_t mDroppedVsyncCount = 0;
 
     virtual void dispatchVsync(nsecs_t timestamp, PhysicalDisplayId displayId, uint32_t count) = 0;
     virtual void dispatchHotplug(nsecs_t timestamp, PhysicalDisplayId displayId,
@@ -52,7 +69,8 @@ private:
     // can be properly poked.
     virtual void dispatchNullEvent(nsecs_t timestamp, PhysicalDisplayId displayId) = 0;
 
-    bool processPendingEvents(nsecs_t* outTimestamp, PhysicalDisplayId* outDisplayId,
-                              uint32_t* outCount);
+    // Dispatches the pending hotplug, config changed and null events, and returns the latest
+    // vsync of each display, ordered by timestamp.
+    std::vector<PendingVsync> processPendingEvents();
 };
 } // namespace android
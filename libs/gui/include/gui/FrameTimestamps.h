@@ -24,6 +24,7 @@
 
 #include <array>
 #include <bitset>
+#include <limits>
 #include <vector>
 
 namespace android {
@@ -228,6 +229,9 @@ private:
     void getFrameDelta(FrameEventHistoryDelta* delta,
                        const std::vector<FrameEvents>::iterator& frame);
 
+    // Whether the events of the given frame are expected to be recorded.
+    bool isRecordedFrame(uint64_t frameNumber) const;
+
     std::vector<FrameEventDirtyFields> mFramesDirty;
 
     size_t mQueueOffset{0};
@@ -235,7 +239,10 @@ private:
     size_t mReleaseOffset{0};
 
     int mCurrentConnectId{0};
+    // Frames are only recorded once the producer asked for their events, so
+    // that producers which never do so don't pay for them.
     bool mProducerWantsEvents{false};
+    uint64_t mFirstRecordedFrameNumber{std::numeric_limits<uint64_t>::max()};
 };
 
 
@@ -296,6 +303,17 @@ private:
             &fed->mReleaseFence
         }};
     }
+
+    // Only the timestamps that are not pending are flattened.
+    template <typename ThisT>
+    static inline auto allTimestamps(ThisT fed) ->
+            std::array<decltype(&fed->mPostedTime), 6> {
+        return {{
+            &fed->mPostedTime, &fed->mRequestedPresentTime, &fed->mLatchTime,
+            &fed->mFirstRefreshStartTime, &fed->mLastRefreshStartTime,
+            &fed->mDequeueReadyTime
+        }};
+    }
 };
 
 
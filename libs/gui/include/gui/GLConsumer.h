@@ -30,6 +30,8 @@
 #include <utils/Vector.h>
 #include <utils/threads.h>
 
+#include <list>
+
 namespace android {
 // ----------------------------------------------------------------------------
 
@@ -346,11 +348,22 @@ private:
 
     // freeBufferLocked frees up the given buffer slot. If the slot has been
     // initialized this will release the reference to the GraphicBuffer in that
-    // slot and destroy the EGLImage in that slot.  Otherwise it has no effect.
+    // slot and move the EGLImage in that slot to the image cache.  Otherwise it
+    // has no effect.
     //
     // This method must be called with mMutex locked.
     virtual void freeBufferLocked(int slotIndex);
 
+    // cacheEglImageLocked keeps an image that has left its slot in
+    // mEglImageCache, evicting the least recently used images to stay within
+    // the cache limits.
+    void cacheEglImageLocked(const sp<EglImage>& image);
+
+    // takeEglImageLocked returns the image for graphicBuffer if the slot or
+    // mEglImageCache still has one, removing it from the cache, or a new image
+    // otherwise.
+    sp<EglImage> takeEglImageLocked(int slot, const sp<GraphicBuffer>& graphicBuffer);
+
     // computeCurrentTransformMatrixLocked computes the transform matrix for the
     // current texture.  It uses mCurrentTransform and the current GraphicBuffer
     // to compute this matrix and stores it in mCurrentTransformMatrix.
@@ -480,6 +493,27 @@ private:
     // of the buffer allocated to a slot.
     EglSlot mEglSlots[BufferQueueDefs::NUM_BUFFER_SLOTS];
 
+    // CachedEglImage is an image whose buffer has left its slot, kept so that
+    // the buffer can get its image back if the producer reattaches it, e.g.
+    // after reconnecting or switching between sets of buffers. Images are
+    // created without a crop, so the buffer id alone identifies them.
+    struct CachedEglImage {
+        uint64_t mBufferId;
+        size_t mBytes;
+        sp<EglImage> mEglImage;
+    };
+
+    // mEglImageCache holds the cached images, most recently used first. Each
+    // one keeps its buffer alive, so mEglImageCacheBytes tracks the memory of
+    // those buffers and is kept under a fixed limit.
+    std::list<CachedEglImage> mEglImageCache;
+    size_t mEglImageCacheBytes;
+
+    // mEglImageReuseCount and mEglImageCreateCount count the acquired buffers
+    // whose image was reused and the ones that needed a new image.
+    uint64_t mEglImageReuseCount;
+    uint64_t mEglImageCreateCount;
+
     // mCurrentTexture is the buffer slot index of the buffer that is currently
     // bound to the OpenGL texture. It is initialized to INVALID_BUFFER_SLOT,
     // indicating that no buffer slot is currently bound to the texture. Note,
@@ -20,6 +20,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <vector>
+
 #include <utils/Errors.h>
 #include <utils/RefBase.h>
 
@@ -218,6 +220,38 @@ public:
                                    PixelFormat format, uint64_t usage, uint64_t* outBufferAge,
                                    FrameEventHistoryDelta* outTimestamps) = 0;
 
+    // The arguments and results of one dequeueBuffer call made by
+    // dequeueBuffers.
+    struct DequeueBufferRequest {
+        uint32_t width{0};
+        uint32_t height{0};
+        PixelFormat format{0};
+        uint64_t usage{0};
+        bool getTimestamps{false};
+    };
+
+    struct DequeueBufferResult {
+        // The value dequeueBuffer returned, including its flags.
+        status_t result{NO_ERROR};
+        int slot{-1};
+        sp<Fence> fence{Fence::NO_FENCE};
+        uint64_t bufferAge{0};
+        // Only filled in if the request asked for timestamps.
+        FrameEventHistoryDelta timestamps;
+    };
+
+    // dequeueBuffers dequeues a buffer for each request in turn, in a single
+    // call to a remote producer. It stops at the first dequeueBuffer that
+    // fails, so outResults holds one entry per buffer that was attempted, and
+    // only the last one can have failed. The buffers that were dequeued are
+    // owned by the client whether or not a later one failed.
+    //
+    // Return of a value other than NO_ERROR means the call failed before any
+    // result could be returned, for instance because requests was empty or
+    // held more than NUM_BUFFER_SLOTS entries (BAD_VALUE).
+    virtual status_t dequeueBuffers(const std::vector<DequeueBufferRequest>& requests,
+                                    std::vector<DequeueBufferResult>* outResults);
+
     // detachBuffer attempts to remove all ownership of the buffer in the given
     // slot from the buffer queue. If this call succeeds, the slot will be
     // freed, and there will be no way to obtain the buffer from this interface.
@@ -419,6 +453,29 @@ public:
     virtual status_t queueBuffer(int slot, const QueueBufferInput& input,
             QueueBufferOutput* output) = 0;
 
+    // The arguments and results of one queueBuffer call made by queueBuffers.
+    struct QueueBufferRequest {
+        int slot;
+        QueueBufferInput input;
+    };
+
+    struct QueueBufferResult {
+        status_t result{NO_ERROR};
+        QueueBufferOutput output;
+    };
+
+    // queueBuffers queues the buffer of each request in turn, in a single call
+    // to a remote producer. Like dequeueBuffers, it stops at the first
+    // queueBuffer that fails, and outResults holds one entry per buffer that
+    // was attempted. The buffers after the failed one are still owned by the
+    // client.
+    //
+    // Return of a value other than NO_ERROR means the call failed before any
+    // result could be returned, for instance because requests was empty or
+    // held more than NUM_BUFFER_SLOTS entries (BAD_VALUE).
+    virtual status_t queueBuffers(const std::vector<QueueBufferRequest>& requests,
+                                  std::vector<QueueBufferResult>* outResults);
+
     // cancelBuffer indicates that the client does not wish to fill in the
     // buffer associated with slot and transfers ownership of the slot back to
     // the server.
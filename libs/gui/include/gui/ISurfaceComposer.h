@@ -272,6 +272,22 @@ public:
                                    uint32_t reqWidth, uint32_t reqHeight, bool useIdentityTransform,
                                    ui::Rotation rotation = ui::ROTATION_0,
                                    bool captureSecureLayers = false) = 0;
+
+    /**
+     * Capture the specified screen like captureScreen, but return as soon as
+     * the capture has been submitted to the GPU instead of waiting for it to
+     * finish. outReadyFence signals once the buffer is ready to be read.
+     *
+     * If *outBuffer is not NULL and has the requested size and pixel format,
+     * the screen is rendered into it rather than into a new buffer. The caller
+     * must be done reading it before making the call.
+     */
+    virtual status_t captureScreenAsync(const sp<IBinder>& display, sp<GraphicBuffer>* outBuffer,
+                                        sp<Fence>* outReadyFence, bool& outCapturedSecureLayers,
+                                        ui::Dataspace reqDataspace, ui::PixelFormat reqPixelFormat,
+                                        const Rect& sourceCrop, uint32_t reqWidth,
+                                        uint32_t reqHeight, bool useIdentityTransform,
+                                        ui::Rotation rotation, bool captureSecureLayers) = 0;
     /**
      * Capture the specified screen. This requires READ_FRAME_BUFFER
      * permission.  This function will fail if there is a secure window on
@@ -599,6 +615,7 @@ public:
         SET_GAME_CONTENT_TYPE,
         SET_FRAME_RATE,
         ACQUIRE_FRAME_RATE_FLEXIBILITY_TOKEN,
+        CAPTURE_SCREEN_ASYNC,
         // Always append new enum to the end.
     };
 
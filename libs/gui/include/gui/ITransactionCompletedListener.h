@@ -50,11 +50,12 @@ public:
             refreshStartTime(refreshTime),
             dequeueReadyTime(dequeueReadyTime) {}
 
-    uint64_t frameNumber;
+    // 0 when no buffer was latched for the transaction, in which case no other field is set.
+    uint64_t frameNumber = 0;
     sp<Fence> gpuCompositionDoneFence;
     CompositorTiming compositorTiming;
-    nsecs_t refreshStartTime;
-    nsecs_t dequeueReadyTime;
+    nsecs_t refreshStartTime = 0;
+    nsecs_t dequeueReadyTime = 0;
 };
 
 class SurfaceStats : public Parcelable {
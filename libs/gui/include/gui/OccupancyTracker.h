@@ -22,8 +22,10 @@
 
 #include <utils/Timers.h>
 
+#include <array>
 #include <deque>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 
@@ -38,6 +40,24 @@ public:
         mLastOccupancy(0),
         mLastOccupancyChangeTime(0) {}
 
+    // Distribution of how long buffers waited at one end of the queue.
+    struct WaitHistogram {
+        // Bucket i counts waits shorter than 2^i ms; the last bucket holds the
+        // remaining ones.
+        static constexpr size_t NUM_BUCKETS = 7;
+
+        void record(nsecs_t wait);
+        void merge(const WaitHistogram& other);
+
+        status_t writeToParcel(Parcel* parcel) const;
+        status_t readFromParcel(const Parcel* parcel);
+
+        size_t count = 0;
+        nsecs_t totalTime = 0;
+        nsecs_t maxTime = 0;
+        std::array<uint32_t, NUM_BUCKETS> buckets{};
+    };
+
     struct Segment : public Parcelable {
         Segment()
           : totalTime(0),
@@ -67,9 +87,20 @@ public:
         // segment could read as double-buffered on average, but still require a
         // third buffer to avoid jank for some smaller portion)
         bool usedThirdBuffer;
+
+        // Time spent at each queue depth, indexed by the number of queued
+        // buffers. Time at depth 0 means the consumer was starved.
+        std::vector<nsecs_t> occupancyTimes;
+
+        // How long the producer blocked in dequeueBuffer, and how long queued
+        // buffers waited before being acquired.
+        WaitHistogram dequeueWait;
+        WaitHistogram acquireWait;
     };
 
     void registerOccupancyChange(size_t occupancy);
+    void registerDequeueWait(nsecs_t wait);
+    void registerAcquireWait(nsecs_t wait);
     std::vector<Segment> getSegmentHistory(bool forceFlush);
 
 private:
@@ -82,11 +113,15 @@ private:
             totalTime = 0;
             numFrames = 0;
             mOccupancyTimes.clear();
+            mDequeueWait = WaitHistogram();
+            mAcquireWait = WaitHistogram();
         }
 
         nsecs_t totalTime;
         size_t numFrames;
         std::unordered_map<size_t, nsecs_t> mOccupancyTimes;
+        WaitHistogram mDequeueWait;
+        WaitHistogram mAcquireWait;
     };
 
     void recordPendingSegment();
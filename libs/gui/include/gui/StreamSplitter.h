@@ -24,6 +24,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -61,7 +62,28 @@ public:
     // outputQueue has not been added to the splitter. BAD_VALUE is returned if
     // outputQueue is NULL. See IGraphicBufferProducer::connect for explanations
     // of other error codes.
-    status_t addOutput(const sp<IGraphicBufferProducer>& outputQueue);
+    //
+    // If allowFrameDrops is true, buffers are not queued to outputQueue while
+    // it is still holding a previous one. Such buffers are released to the
+    // input once the other outputs are done with them, so that a slow output
+    // (such as an encoder) does not stall the others.
+    status_t addOutput(const sp<IGraphicBufferProducer>& outputQueue,
+            bool allowFrameDrops = false);
+
+    struct OutputStats {
+        uint64_t framesQueued = 0;
+        uint64_t framesDropped = 0;
+        // Time from a buffer being queued to the output until the output
+        // released it
+        nsecs_t totalLatency = 0;
+        nsecs_t maxLatency = 0;
+    };
+
+    // getOutputStats returns the statistics of an output added with
+    // addOutput. BAD_VALUE is returned if outputQueue is not an output of the
+    // splitter or outStats is NULL.
+    status_t getOutputStats(const sp<IGraphicBufferProducer>& outputQueue,
+            OutputStats* outStats);
 
     // setName sets the consumer name of the input queue
     void setName(const String8& name);
@@ -104,6 +126,10 @@ private:
     // acquire. This must be called with mMutex locked.
     void onAbandonedLocked();
 
+    // Attaches a buffer which every output is done with and releases it back
+    // to the input. This must be called with mMutex locked.
+    void releaseToInputLocked(const sp<GraphicBuffer>& buffer);
+
     // This is a thin wrapper class that lets us determine which BufferQueue
     // the IProducerListener::onBufferReleased callback is associated with. We
     // create one of these per output BufferQueue, and then pass the producer
@@ -132,12 +158,14 @@ private:
 
         const sp<GraphicBuffer>& getBuffer() const { return mBuffer; }
         const sp<Fence>& getMergedFence() const { return mMergedFence; }
+        nsecs_t getQueueTime() const { return mQueueTime; }
 
         void mergeFence(const sp<Fence>& with);
 
         // Returns the new value
         // Only called while mMutex is held
         size_t incrementReleaseCountLocked() { return ++mReleaseCount; }
+        size_t getReleaseCount() const { return mReleaseCount; }
 
     private:
         // Only destroy through LightRefBase
@@ -151,8 +179,21 @@ private:
         sp<GraphicBuffer> mBuffer; // One instance that holds this native handle
         sp<Fence> mMergedFence;
         size_t mReleaseCount;
+        nsecs_t mQueueTime;
     };
 
+    struct Output {
+        sp<IGraphicBufferProducer> queue;
+        bool allowFrameDrops = false;
+        // Buffers queued to the output which it has not released yet
+        int outstandingBuffers = 0;
+        OutputStats stats;
+    };
+
+    // Returns the output for the given queue, or NULL if there is none. This
+    // must be called with mMutex locked.
+    Output* findOutputLocked(const sp<IGraphicBufferProducer>& queue);
+
     // Only called from createSplitter
     explicit StreamSplitter(const sp<IGraphicBufferConsumer>& inputQueue);
 
@@ -171,7 +212,7 @@ private:
     Condition mReleaseCondition;
     int mOutstandingBuffers;
     sp<IGraphicBufferConsumer> mInput;
-    Vector<sp<IGraphicBufferProducer> > mOutputs;
+    Vector<Output> mOutputs;
 
     // Map of GraphicBuffer IDs (GraphicBuffer::getId()) to buffer tracking
     // objects (which are mostly for counting how many outputs have released the
@@ -29,6 +29,7 @@
 #include <utils/Mutex.h>
 #include <utils/RefBase.h>
 
+#include <optional>
 #include <shared_mutex>
 #include <unordered_set>
 
@@ -265,6 +266,7 @@ private:
     int dispatchAddQueueInterceptor(va_list args);
     int dispatchAddQueryInterceptor(va_list args);
     int dispatchGetLastQueuedBuffer(va_list args);
+    int dispatchSetBuffersUserGeometry(va_list args);
     bool transformToDisplayInverse();
 
 protected:
@@ -280,6 +282,10 @@ protected:
     virtual int setBufferCount(int bufferCount);
     virtual int setBuffersUserDimensions(uint32_t width, uint32_t height);
     virtual int setBuffersFormat(PixelFormat format);
+    // Sets the format, user dimensions and scaling mode under a single lock, with the same
+    // results as calling setBuffersFormat, setBuffersUserDimensions and setScalingMode in turn.
+    int setBuffersUserGeometry(uint32_t width, uint32_t height, PixelFormat format,
+                               int scalingMode);
     virtual int setBuffersTransform(uint32_t transform);
     virtual int setBuffersStickyTransform(uint32_t transform);
     virtual int setBuffersTimestamp(int64_t timestamp);
@@ -335,6 +341,25 @@ public:
     static status_t attachAndQueueBufferWithDataspace(Surface* surface, sp<GraphicBuffer> buffer,
                                                       ui::Dataspace dataspace);
 
+    // Batch versions of dequeueBuffer and queueBuffer, which make a single call to the producer
+    // for all of the buffers. They are meant for producers that work in bursts, and do not
+    // support shared buffer mode.
+    struct BatchBuffer {
+        ANativeWindowBuffer* buffer = nullptr;
+        int fenceFd = -1;
+    };
+    // Dequeues buffers->size() buffers. Either all of them are dequeued, or none are.
+    virtual int dequeueBuffers(std::vector<BatchBuffer>* buffers);
+
+    struct BatchQueuedBuffer {
+        ANativeWindowBuffer* buffer = nullptr;
+        int fenceFd = -1;
+        nsecs_t timestamp = NATIVE_WINDOW_TIMESTAMP_AUTO;
+    };
+    // Queues the buffers in order, taking ownership of their fences. If one of them fails to
+    // queue, the buffers after it are not queued and remain dequeued.
+    virtual int queueBuffers(const std::vector<BatchQueuedBuffer>& buffers);
+
 protected:
     enum { NUM_BUFFER_SLOTS = BufferQueueDefs::NUM_BUFFER_SLOTS };
     enum { DEFAULT_FORMAT = PIXEL_FORMAT_RGBA_8888 };
@@ -361,9 +386,21 @@ protected:
 
     void querySupportedTimestampsLocked() const;
 
+    // Returns true and sets value if what is a producer query whose result is cached.
+    bool queryCachedLocked(int what, int* value) const;
+    void invalidateQueryCacheLocked();
+
     void freeAllBuffers();
     int getSlotFromBufferLocked(android_native_buffer_t* buffer) const;
 
+    void getDequeueBufferRequestLocked(IGraphicBufferProducer::DequeueBufferRequest* request);
+    // Builds the input of queueBuffer for a buffer and the fence the consumer must wait on.
+    IGraphicBufferProducer::QueueBufferInput getQueueBufferInputLocked(
+            android_native_buffer_t* buffer, const sp<Fence>& fence, int64_t timestamp);
+    // Updates the state of the Surface after the buffer in the given slot was queued.
+    void onBufferQueuedLocked(int slot, const sp<Fence>& fence,
+                              const IGraphicBufferProducer::QueueBufferOutput& output);
+
     struct BufferSlot {
         sp<GraphicBuffer> buffer;
         Region dirtyRegion;
@@ -465,6 +502,15 @@ protected:
     // one buffer behind the producer.
     mutable bool mConsumerRunningBehind;
 
+    // Results of producer queries that only change when the producer or the consumer is
+    // reconfigured, cached so that clients polling them every frame don't make a binder call
+    // each time. They are cleared on connect and disconnect, by the producer calls that affect
+    // them, and whenever dequeueBuffer has to reallocate a buffer.
+    mutable std::optional<int> mCachedMinUndequeuedBuffers;
+    mutable std::optional<int> mCachedConsumerUsageBits;
+    mutable std::optional<int> mCachedDefaultDataSpace;
+    mutable std::optional<uint64_t> mCachedConsumerUsage64;
+
     // mMutex is the mutex used to prevent concurrent access to the member
     // variables of Surface objects. It must be locked whenever the
     // member variables are accessed.
@@ -535,7 +581,8 @@ protected:
     mutable bool mQueriedSupportedTimestamps;
     mutable bool mFrameTimestampsSupportsPresent;
 
-    // A cached copy of the FrameEventHistory maintained by the consumer.
+    // A cached copy of the FrameEventHistory maintained by the consumer. It is only created once
+    // frame timestamps are enabled, and must not be used while they are disabled.
     bool mEnableFrameTimestamps = false;
     std::unique_ptr<ProducerFrameEventHistory> mFrameEventHistory;
 
@@ -106,10 +106,10 @@ public:
     // Get transactional state of given display.
     static status_t getDisplayState(const sp<IBinder>& display, ui::DisplayState*);
 
-    // Get immutable information about given physical display.
+    // Get immutable information about given physical display. Cached for internal displays.
     static status_t getDisplayInfo(const sp<IBinder>& display, DisplayInfo*);
 
-    // Get configurations supported by given physical display.
+    // Get configurations supported by given physical display. Cached for internal displays.
     static status_t getDisplayConfigs(const sp<IBinder>& display, Vector<DisplayConfig>*);
 
     // Get the ID of the active DisplayConfig, as getDisplayConfigs index.
@@ -378,6 +378,7 @@ public:
 
         void cacheBuffers();
         void registerSurfaceControlForCallback(const sp<SurfaceControl>& sc);
+        status_t applyInternal(bool synchronous, bool async);
 
     public:
         Transaction() = default;
@@ -393,7 +394,15 @@ public:
         // Clears the contents of the transaction without applying it.
         void clear();
 
+        // Applying a transaction leaves it empty and ready to be filled in again. Reusing one
+        // Transaction for a transaction that is applied every frame keeps the capacity of its
+        // maps, rather than allocating them again each frame.
         status_t apply(bool synchronous = false);
+        // Like apply, but sends the transaction to SurfaceFlinger from a background thread
+        // instead of blocking on the binder call. Transactions still reach SurfaceFlinger in the
+        // order they were applied, but the caller's own later binder calls may overtake it. A
+        // synchronous transaction is applied as if by apply.
+        status_t applyAsync();
         // Merge another transaction in to this one, clearing other
         // as if it had been applied.
         Transaction& merge(Transaction&& other);
@@ -605,6 +614,14 @@ public:
                             ui::Rotation rotation, sp<GraphicBuffer>* outBuffer);
     static status_t capture(uint64_t displayOrLayerStack, ui::Dataspace* outDataspace,
                             sp<GraphicBuffer>* outBuffer);
+    // Like capture, but returns without waiting for the capture to be rendered. See
+    // ISurfaceComposer::captureScreenAsync.
+    static status_t captureAsync(const sp<IBinder>& display, ui::Dataspace reqDataSpace,
+                                 ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
+                                 uint32_t reqWidth, uint32_t reqHeight, bool useIdentityTransform,
+                                 ui::Rotation rotation, bool captureSecureLayers,
+                                 sp<GraphicBuffer>* outBuffer, sp<Fence>* outReadyFence,
+                                 bool& outCapturedSecureLayers);
     static status_t captureLayers(const sp<IBinder>& layerHandle, ui::Dataspace reqDataSpace,
                                   ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
                                   float frameScale, sp<GraphicBuffer>* outBuffer);
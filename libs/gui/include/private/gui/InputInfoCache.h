@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_PRIVATE_GUI_INPUT_INFO_CACHE_H
+#define ANDROID_PRIVATE_GUI_INPUT_INFO_CACHE_H
+
+#ifndef NO_INPUT
+
+#include <map>
+#include <mutex>
+
+#include <binder/IBinder.h>
+#include <input/InputWindow.h>
+#include <utils/StrongPointer.h>
+
+namespace android {
+
+// ---------------------------------------------------------------------------
+
+// Remembers the input info this process last sent to SurfaceFlinger for each layer. The window
+// manager sets the input info of every window whenever one of them changes, and with touchable
+// regions and names those parcels are large, so info equal to the one last sent is left out of
+// the transaction.
+//
+// This only holds while this process is the only one setting the info of a layer, so a layer
+// whose SurfaceControl or handle is parceled into or out of the process always has its info sent.
+class InputInfoCache {
+public:
+    static InputInfoCache& getInstance();
+
+    // Returns whether |info| has to be sent for the layer |handle|, and if so records it as the
+    // info last sent.
+    bool shouldSend(const sp<IBinder>& handle, const InputWindowInfo& info);
+
+    // Stops leaving out the input info of the layer |handle|, as another process may set it.
+    void markShared(const sp<IBinder>& handle);
+
+private:
+    struct Entry {
+        wp<IBinder> handle;
+        bool shared = false;
+        InputWindowInfo info;
+    };
+
+    // Returns the entry for |handle|, creating it if needed. Entries are keyed by address, so
+    // ones whose layer handle is gone are dropped before a new handle can reuse the address.
+    Entry& getEntryLocked(const sp<IBinder>& handle);
+
+    std::mutex mMutex;
+    std::map<const IBinder*, Entry> mEntries;
+};
+
+// ---------------------------------------------------------------------------
+}; // namespace android
+
+#endif // NO_INPUT
+
+#endif // ANDROID_PRIVATE_GUI_INPUT_INFO_CACHE_H
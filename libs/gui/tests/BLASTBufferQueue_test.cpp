@@ -68,6 +68,28 @@ public:
         return mBlastBufferQueueAdapter->mSurfaceControl;
     }
 
+    status_t setMaxInFlightTransactions(int32_t count) {
+        return mBlastBufferQueueAdapter->setMaxInFlightTransactions(count);
+    }
+
+    void setDropSupersededFrames(bool drop) {
+        mBlastBufferQueueAdapter->setDropSupersededFrames(drop);
+    }
+
+    void setFramePresentedListener(BLASTBufferQueue::FramePresentedListener listener) {
+        mBlastBufferQueueAdapter->setFramePresentedListener(std::move(listener));
+    }
+
+    int32_t getNumFrameAvailable() {
+        std::unique_lock lock{mBlastBufferQueueAdapter->mMutex};
+        return mBlastBufferQueueAdapter->mNumFrameAvailable;
+    }
+
+    uint64_t getNumDroppedFrames() {
+        std::unique_lock lock{mBlastBufferQueueAdapter->mMutex};
+        return mBlastBufferQueueAdapter->mNumDroppedFrames;
+    }
+
     void waitForCallbacks() {
         std::unique_lock lock{mBlastBufferQueueAdapter->mMutex};
         while (mBlastBufferQueueAdapter->mSubmitted.size() > 0) {
@@ -350,6 +372,89 @@ TEST_F(BLASTBufferQueueTest, TripleBuffering) {
     adapter.waitForCallbacks();
 }
 
+TEST_F(BLASTBufferQueueTest, SetMaxInFlightTransactions) {
+    BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
+    ASSERT_EQ(BAD_VALUE, adapter.setMaxInFlightTransactions(0));
+    ASSERT_EQ(NO_ERROR, adapter.setMaxInFlightTransactions(2));
+    ASSERT_EQ(NO_ERROR, adapter.setMaxInFlightTransactions(1));
+}
+
+TEST_F(BLASTBufferQueueTest, DropSupersededFrames) {
+    BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
+    adapter.setDropSupersededFrames(true);
+    sp<IGraphicBufferProducer> igbProducer;
+    setUpProducer(adapter, igbProducer);
+
+    constexpr int kFrameCount = 100;
+    for (int i = 0; i < kFrameCount; i++) {
+        int slot;
+        sp<Fence> fence;
+        sp<GraphicBuffer> buf;
+        auto ret = igbProducer->dequeueBuffer(&slot, &fence, mDisplayWidth, mDisplayHeight,
+                                              PIXEL_FORMAT_RGBA_8888, GRALLOC_USAGE_SW_WRITE_OFTEN,
+                                              nullptr, nullptr);
+        if (ret == IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            ASSERT_EQ(OK, igbProducer->requestBuffer(slot, &buf));
+        } else {
+            ASSERT_EQ(NO_ERROR, ret);
+        }
+        IGraphicBufferProducer::QueueBufferOutput qbOutput;
+        IGraphicBufferProducer::QueueBufferInput input(systemTime(), false, HAL_DATASPACE_UNKNOWN,
+                                                       Rect(mDisplayWidth, mDisplayHeight),
+                                                       NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                       Fence::NO_FENCE);
+        ASSERT_EQ(NO_ERROR, igbProducer->queueBuffer(slot, input, &qbOutput));
+    }
+    adapter.waitForCallbacks();
+
+    // Every frame was either presented or dropped, none are left behind.
+    EXPECT_EQ(0, adapter.getNumFrameAvailable());
+    EXPECT_LT(adapter.getNumDroppedFrames(), static_cast<uint64_t>(kFrameCount));
+}
+
+TEST_F(BLASTBufferQueueTest, FramePresentedListener) {
+    BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::pair<uint64_t, nsecs_t>> presented;
+    adapter.setFramePresentedListener([&](uint64_t frameNumber, nsecs_t timestamp,
+                                          nsecs_t latchTime, const sp<Fence>& presentFence) {
+        EXPECT_GE(latchTime, timestamp);
+        EXPECT_NE(nullptr, presentFence);
+        std::lock_guard lock{mutex};
+        presented.emplace_back(frameNumber, timestamp);
+        cv.notify_all();
+    });
+    sp<IGraphicBufferProducer> igbProducer;
+    setUpProducer(adapter, igbProducer);
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buf;
+    auto ret = igbProducer->dequeueBuffer(&slot, &fence, mDisplayWidth, mDisplayHeight,
+                                          PIXEL_FORMAT_RGBA_8888, GRALLOC_USAGE_SW_WRITE_OFTEN,
+                                          nullptr, nullptr);
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION, ret);
+    ASSERT_EQ(OK, igbProducer->requestBuffer(slot, &buf));
+
+    const nsecs_t timestamp = systemTime();
+    IGraphicBufferProducer::QueueBufferOutput qbOutput;
+    IGraphicBufferProducer::QueueBufferInput input(timestamp, false, HAL_DATASPACE_UNKNOWN,
+                                                   Rect(mDisplayWidth, mDisplayHeight),
+                                                   NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                   Fence::NO_FENCE);
+    ASSERT_EQ(NO_ERROR, igbProducer->queueBuffer(slot, input, &qbOutput));
+
+    std::unique_lock lock{mutex};
+    ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&] { return !presented.empty(); }));
+    EXPECT_EQ(1u, presented[0].first);
+    EXPECT_EQ(timestamp, presented[0].second);
+    lock.unlock();
+
+    // Clear the listener before the captured state goes out of scope.
+    adapter.setFramePresentedListener(nullptr);
+}
+
 TEST_F(BLASTBufferQueueTest, SetCrop_Item) {
     uint8_t r = 255;
     uint8_t g = 0;
@@ -22,6 +22,8 @@
 #include <gui/IProducerListener.h>
 #include <gui/Surface.h>
 
+#include <atomic>
+
 namespace android {
 
 static constexpr int kWidth = 100;
@@ -203,4 +205,49 @@ TEST_F(BufferItemConsumerTest, TriggerBufferFreed_DeleteBufferItemConsumer) {
     ASSERT_EQ(1, GetFreedBufferCount());
 }
 
+// Test that acquireLatestBuffer returns the newest frame and drops the others.
+TEST_F(BufferItemConsumerTest, AcquireLatestBufferDropsOlderFrames) {
+    int slot;
+    for (int i = 0; i < kMaxLockedBuffers; i++) {
+        DequeueBuffer(&slot);
+        QueueBuffer(slot);
+    }
+
+    BufferItem item;
+    ASSERT_EQ(NO_ERROR, mBIC->acquireLatestBuffer(&item, false));
+    EXPECT_EQ(static_cast<uint64_t>(kMaxLockedBuffers), item.mFrameNumber);
+    EXPECT_EQ(slot, item.mSlot);
+
+    BufferItem none;
+    EXPECT_EQ(BufferItemConsumer::NO_BUFFER_AVAILABLE,
+              mBIC->acquireBuffer(&none, 0, false));
+    ReleaseBuffer(item.mSlot);
+}
+
+// Test that coalescing sends one onFrameAvailable per acquire.
+TEST_F(BufferItemConsumerTest, CoalescedFrameAvailable) {
+    struct CountingListener : public BufferItemConsumer::FrameAvailableListener {
+        void onFrameAvailable(const BufferItem& /* item */) override { mCount++; }
+        std::atomic<int> mCount{0};
+    };
+    sp<CountingListener> listener = new CountingListener();
+    mBIC->setFrameAvailableListener(listener);
+    mBIC->setFrameAvailableCoalescing(true);
+
+    int slot;
+    DequeueBuffer(&slot);
+    QueueBuffer(slot);
+    DequeueBuffer(&slot);
+    QueueBuffer(slot);
+    EXPECT_EQ(1, listener->mCount);
+
+    BufferItem item;
+    ASSERT_EQ(NO_ERROR, mBIC->acquireLatestBuffer(&item, false));
+    ReleaseBuffer(item.mSlot);
+
+    DequeueBuffer(&slot);
+    QueueBuffer(slot);
+    EXPECT_EQ(2, listener->mCount);
+}
+
 }  // namespace android
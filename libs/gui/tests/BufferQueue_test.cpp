@@ -1010,6 +1010,63 @@ TEST_F(BufferQueueTest, TestOccupancyHistory) {
     ASSERT_EQ(true, thirdSegment.usedThirdBuffer);
 }
 
+TEST_F(BufferQueueTest, TestOccupancyHistogramAndWaitTimes) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(dc, false));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    ASSERT_EQ(OK, mProducer->connect(new DummyProducerListener,
+            NATIVE_WINDOW_API_CPU, false, &output));
+
+    int slot = BufferQueue::INVALID_BUFFER_SLOT;
+    sp<Fence> fence = Fence::NO_FENCE;
+    sp<GraphicBuffer> buffer = nullptr;
+    IGraphicBufferProducer::QueueBufferInput input(0ull, true,
+        HAL_DATASPACE_UNKNOWN, Rect::INVALID_RECT,
+        NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+    BufferItem item{};
+
+    // Preallocate a buffer so we don't get BUFFER_NEEDS_REALLOCATION below
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+            mProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, 0, nullptr, nullptr));
+    ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buffer));
+    ASSERT_EQ(OK, mProducer->cancelBuffer(slot, Fence::NO_FENCE));
+    std::this_thread::sleep_for(500ms);
+
+    // Each buffer sits in the queue for at least 2ms, and the queue is then
+    // empty for at least 4ms
+    for (size_t i = 0; i < 5; ++i) {
+        ASSERT_EQ(OK, mProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, 0, nullptr, nullptr));
+        ASSERT_EQ(OK, mProducer->queueBuffer(slot, input, &output));
+        std::this_thread::sleep_for(2ms);
+        ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+        ASSERT_EQ(OK, mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber,
+                EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+        std::this_thread::sleep_for(4ms);
+    }
+
+    std::vector<OccupancyTracker::Segment> history;
+    ASSERT_EQ(OK, mConsumer->getOccupancyHistory(true, &history));
+    ASSERT_EQ(1u, history.size());
+    const auto& segment = history[0];
+
+    // The queue only ever held zero or one buffers
+    ASSERT_EQ(2u, segment.occupancyTimes.size());
+    EXPECT_LT(0, segment.occupancyTimes[0]);
+    EXPECT_LT(0, segment.occupancyTimes[1]);
+    EXPECT_EQ(segment.totalTime, segment.occupancyTimes[0] + segment.occupancyTimes[1]);
+
+    // Every acquired buffer waited at least 2ms, so none of them fall into the
+    // <1ms or <2ms buckets
+    EXPECT_EQ(5u, segment.acquireWait.count);
+    EXPECT_LE(ms2ns(2), segment.acquireWait.maxTime);
+    EXPECT_EQ(0u, segment.acquireWait.buckets[0]);
+    EXPECT_EQ(0u, segment.acquireWait.buckets[1]);
+
+    // The first dequeue belongs to the segment before the first queueBuffer
+    EXPECT_EQ(4u, segment.dequeueWait.count);
+}
+
 struct BufferDiscardedListener : public BnProducerListener {
 public:
     BufferDiscardedListener() = default;
@@ -565,6 +565,33 @@ TEST_P(CpuConsumerTest, FromCpuSingle) {
     mCC->unlockBuffer(b);
 }
 
+// This test is disabled because the HAL_PIXEL_FORMAT_RAW16 format is not
+// supported on all devices.
+TEST_P(CpuConsumerTest, FromCpuMappingStats) {
+    status_t err;
+    CpuConsumerTestParams params = GetParam();
+
+    const int numFrames = 3;
+    ASSERT_NO_FATAL_FAILURE(configureANW(mANW, params, numFrames));
+
+    for (int i = 0; i < numFrames; i++) {
+        uint32_t stride;
+        ASSERT_NO_FATAL_FAILURE(produceOneFrame(mANW, params, i + 1, &stride));
+
+        CpuConsumer::LockedBuffer b;
+        err = mCC->lockNextBuffer(&b);
+        ASSERT_NO_ERROR(err, "getNextBuffer error: ");
+        checkAnyBuffer(b, GetParam().format);
+        mCC->unlockBuffer(b);
+    }
+
+    // Without persistent mapping every buffer goes through gralloc.
+    CpuConsumer::MappingStats stats = mCC->getMappingStats();
+    EXPECT_EQ(static_cast<uint64_t>(numFrames), stats.mapCount);
+    EXPECT_EQ(0u, stats.reuseCount);
+    EXPECT_GE(stats.mapTime, stats.maxMapTime);
+}
+
 // This test is disabled because the HAL_PIXEL_FORMAT_RAW16 format is not
 // supported on all devices.
 TEST_P(CpuConsumerTest, FromCpuManyInQueue) {
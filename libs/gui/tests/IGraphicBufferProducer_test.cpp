@@ -418,6 +418,59 @@ TEST_P(IGraphicBufferProducerTest, Queue_Succeeds) {
     EXPECT_EQ(BAD_VALUE, mProducer->queueBuffer(dequeuedSlot, input, &output));
 }
 
+TEST_P(IGraphicBufferProducerTest, DequeueBuffersThenQueueBuffers_Succeeds) {
+    ASSERT_NO_FATAL_FAILURE(ConnectProducer());
+
+    IGraphicBufferProducer::DequeueBufferRequest dequeueRequest;
+    dequeueRequest.width = DEFAULT_WIDTH;
+    dequeueRequest.height = DEFAULT_HEIGHT;
+    dequeueRequest.format = DEFAULT_FORMAT;
+    dequeueRequest.usage = TEST_PRODUCER_USAGE_BITS;
+    const std::vector<IGraphicBufferProducer::DequeueBufferRequest> dequeueRequests(2,
+                                                                                   dequeueRequest);
+
+    std::vector<IGraphicBufferProducer::DequeueBufferResult> dequeueResults;
+    ASSERT_OK(mProducer->dequeueBuffers(dequeueRequests, &dequeueResults));
+    ASSERT_EQ(2u, dequeueResults.size());
+
+    std::vector<IGraphicBufferProducer::QueueBufferRequest> queueRequests;
+    for (const auto& dequeueResult : dequeueResults) {
+        ASSERT_EQ(OK, ~IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION & dequeueResult.result);
+        EXPECT_LE(0, dequeueResult.slot);
+        EXPECT_GT(BufferQueue::NUM_BUFFER_SLOTS, dequeueResult.slot);
+
+        // Request the buffer (pre-requisite for queueing)
+        sp<GraphicBuffer> dequeuedBuffer;
+        ASSERT_OK(mProducer->requestBuffer(dequeueResult.slot, &dequeuedBuffer));
+        queueRequests.push_back({dequeueResult.slot, CreateBufferInput()});
+    }
+    EXPECT_NE(dequeueResults[0].slot, dequeueResults[1].slot);
+
+    std::vector<IGraphicBufferProducer::QueueBufferResult> queueResults;
+    ASSERT_OK(mProducer->queueBuffers(queueRequests, &queueResults));
+    ASSERT_EQ(2u, queueResults.size());
+    for (const auto& queueResult : queueResults) {
+        EXPECT_OK(queueResult.result);
+        EXPECT_EQ(DEFAULT_WIDTH, queueResult.output.width);
+        EXPECT_EQ(DEFAULT_HEIGHT, queueResult.output.height);
+    }
+
+    // The buffers are no longer dequeued, so only the first one is attempted.
+    ASSERT_OK(mProducer->queueBuffers(queueRequests, &queueResults));
+    ASSERT_EQ(1u, queueResults.size());
+    EXPECT_EQ(BAD_VALUE, queueResults[0].result);
+}
+
+TEST_P(IGraphicBufferProducerTest, DequeueBuffersWithoutRequests_ReturnsError) {
+    ASSERT_NO_FATAL_FAILURE(ConnectProducer());
+
+    std::vector<IGraphicBufferProducer::DequeueBufferResult> dequeueResults;
+    EXPECT_EQ(BAD_VALUE, mProducer->dequeueBuffers({}, &dequeueResults));
+
+    std::vector<IGraphicBufferProducer::QueueBufferResult> queueResults;
+    EXPECT_EQ(BAD_VALUE, mProducer->queueBuffers({}, &queueResults));
+}
+
 TEST_P(IGraphicBufferProducerTest, Queue_ReturnsError) {
     ASSERT_NO_FATAL_FAILURE(ConnectProducer());
 
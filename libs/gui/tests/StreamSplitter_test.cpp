@@ -195,6 +195,75 @@ TEST_F(StreamSplitterTest, OneInputMultipleOutputs) {
                                            nullptr, nullptr));
 }
 
+TEST_F(StreamSplitterTest, SlowOutputDropsFrames) {
+    sp<IGraphicBufferProducer> inputProducer;
+    sp<IGraphicBufferConsumer> inputConsumer;
+    BufferQueue::createBufferQueue(&inputProducer, &inputConsumer);
+
+    sp<IGraphicBufferProducer> fastProducer;
+    sp<IGraphicBufferConsumer> fastConsumer;
+    BufferQueue::createBufferQueue(&fastProducer, &fastConsumer);
+    ASSERT_EQ(OK, fastConsumer->consumerConnect(new DummyListener, false));
+
+    sp<IGraphicBufferProducer> slowProducer;
+    sp<IGraphicBufferConsumer> slowConsumer;
+    BufferQueue::createBufferQueue(&slowProducer, &slowConsumer);
+    ASSERT_EQ(OK, slowConsumer->consumerConnect(new DummyListener, false));
+
+    sp<StreamSplitter> splitter;
+    status_t status = StreamSplitter::createSplitter(inputConsumer, &splitter);
+    ASSERT_EQ(OK, status);
+    ASSERT_EQ(OK, splitter->addOutput(fastProducer));
+    ASSERT_EQ(OK, splitter->addOutput(slowProducer, /* allowFrameDrops */ true));
+
+    IGraphicBufferProducer::QueueBufferOutput qbOutput;
+    ASSERT_EQ(OK, inputProducer->connect(new DummyProducerListener,
+            NATIVE_WINDOW_API_CPU, false, &qbOutput));
+
+    IGraphicBufferProducer::QueueBufferInput qbInput(0, false,
+            HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+            NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+
+    // Queue two buffers, only releasing them from the fast output. The slow
+    // output keeps the first one, so it does not get the second.
+    for (int frame = 0; frame < 2; ++frame) {
+        int slot;
+        sp<Fence> fence;
+        sp<GraphicBuffer> buffer;
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                  inputProducer->dequeueBuffer(&slot, &fence, 0, 0, 0,
+                                               GRALLOC_USAGE_SW_WRITE_OFTEN, nullptr, nullptr));
+        ASSERT_EQ(OK, inputProducer->requestBuffer(slot, &buffer));
+        ASSERT_EQ(OK, inputProducer->queueBuffer(slot, qbInput, &qbOutput));
+
+        BufferItem item;
+        ASSERT_EQ(OK, fastConsumer->acquireBuffer(&item, 0));
+        ASSERT_EQ(OK, fastConsumer->releaseBuffer(item.mSlot, item.mFrameNumber,
+                EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+    }
+
+    // The second buffer went back to the input without waiting for the slow
+    // output
+    ASSERT_EQ(OK, inputProducer->allowAllocation(false));
+    int slot;
+    sp<Fence> fence;
+    ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+              inputProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, GRALLOC_USAGE_SW_WRITE_OFTEN,
+                                           nullptr, nullptr));
+
+    StreamSplitter::OutputStats fastStats;
+    ASSERT_EQ(OK, splitter->getOutputStats(fastProducer, &fastStats));
+    EXPECT_EQ(2u, fastStats.framesQueued);
+    EXPECT_EQ(0u, fastStats.framesDropped);
+
+    StreamSplitter::OutputStats slowStats;
+    ASSERT_EQ(OK, splitter->getOutputStats(slowProducer, &slowStats));
+    EXPECT_EQ(1u, slowStats.framesQueued);
+    EXPECT_EQ(1u, slowStats.framesDropped);
+
+    ASSERT_EQ(BAD_VALUE, splitter->getOutputStats(inputProducer, &slowStats));
+}
+
 TEST_F(StreamSplitterTest, OutputAbandonment) {
     sp<IGraphicBufferProducer> inputProducer;
     sp<IGraphicBufferConsumer> inputConsumer;
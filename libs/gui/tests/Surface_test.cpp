@@ -284,6 +284,32 @@ TEST_F(SurfaceTest, ScreenshotsOfProtectedBuffersDontSucceed) {
                                 ui::PixelFormat::RGBA_8888, Rect(), 64, 64, false));
 }
 
+TEST_F(SurfaceTest, AsyncScreenshotReusesBuffer) {
+    sp<ISurfaceComposer> sf(ComposerService::getComposerService());
+
+    const sp<IBinder> display = sf->getInternalDisplayToken();
+    ASSERT_FALSE(display == nullptr);
+
+    sp<GraphicBuffer> outBuffer;
+    sp<Fence> readyFence;
+    bool ignored;
+    ASSERT_EQ(NO_ERROR,
+              sf->captureScreenAsync(display, &outBuffer, &readyFence, ignored,
+                                     ui::Dataspace::V0_SRGB, ui::PixelFormat::RGBA_8888, Rect(),
+                                     64, 64, false, ui::ROTATION_0, false));
+    ASSERT_NE(nullptr, outBuffer.get());
+    ASSERT_NE(nullptr, readyFence.get());
+    ASSERT_EQ(NO_ERROR, readyFence->wait(Fence::TIMEOUT_NEVER));
+
+    const uint64_t bufferId = outBuffer->getId();
+    ASSERT_EQ(NO_ERROR,
+              sf->captureScreenAsync(display, &outBuffer, &readyFence, ignored,
+                                     ui::Dataspace::V0_SRGB, ui::PixelFormat::RGBA_8888, Rect(),
+                                     64, 64, false, ui::ROTATION_0, false));
+    ASSERT_EQ(NO_ERROR, readyFence->wait(Fence::TIMEOUT_NEVER));
+    EXPECT_EQ(bufferId, outBuffer->getId());
+}
+
 TEST_F(SurfaceTest, ConcreteTypeIsSurface) {
     sp<ANativeWindow> anw(mSurface);
     int result = -123;
@@ -341,6 +367,62 @@ TEST_F(SurfaceTest, QueryDefaultBuffersDataSpace) {
     ASSERT_EQ(TEST_DATASPACE, dataSpace);
 }
 
+TEST_F(SurfaceTest, QueryMinUndequeuedBuffersFollowsAsyncMode) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    sp<CpuConsumer> cpuConsumer = new CpuConsumer(consumer, 1);
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    ASSERT_EQ(NO_ERROR, native_window_api_connect(window.get(), NATIVE_WINDOW_API_CPU));
+
+    // The second query is answered from the cache.
+    int minUndequeued = -1;
+    ASSERT_EQ(NO_ERROR,
+              window->query(window.get(), NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS, &minUndequeued));
+    EXPECT_EQ(1, minUndequeued);
+    ASSERT_EQ(NO_ERROR,
+              window->query(window.get(), NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS, &minUndequeued));
+    EXPECT_EQ(1, minUndequeued);
+
+    // Async mode needs an extra buffer, so it must invalidate the cached count.
+    ASSERT_EQ(NO_ERROR, surface->setAsyncMode(true));
+    ASSERT_EQ(NO_ERROR,
+              window->query(window.get(), NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS, &minUndequeued));
+    EXPECT_EQ(2, minUndequeued);
+}
+
+TEST_F(SurfaceTest, SetBuffersGeometry) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    sp<CpuConsumer> cpuConsumer = new CpuConsumer(consumer, 1);
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+    ASSERT_EQ(NO_ERROR, native_window_api_connect(window.get(), NATIVE_WINDOW_API_CPU));
+
+    ASSERT_EQ(NO_ERROR,
+              ANativeWindow_setBuffersGeometry(window.get(), 32, 16, HAL_PIXEL_FORMAT_RGB_565));
+    int value = -1;
+    ASSERT_EQ(NO_ERROR, window->query(window.get(), NATIVE_WINDOW_DEFAULT_WIDTH, &value));
+    EXPECT_EQ(32, value);
+    ASSERT_EQ(NO_ERROR, window->query(window.get(), NATIVE_WINDOW_DEFAULT_HEIGHT, &value));
+    EXPECT_EQ(16, value);
+    EXPECT_EQ(HAL_PIXEL_FORMAT_RGB_565, ANativeWindow_getFormat(window.get()));
+
+    ANativeWindowBuffer* buffer;
+    int fenceFd;
+    ASSERT_EQ(NO_ERROR, window->dequeueBuffer(window.get(), &buffer, &fenceFd));
+    EXPECT_EQ(32, buffer->width);
+    EXPECT_EQ(16, buffer->height);
+    EXPECT_EQ(HAL_PIXEL_FORMAT_RGB_565, buffer->format);
+    ASSERT_EQ(NO_ERROR, window->cancelBuffer(window.get(), buffer, fenceFd));
+
+    // Only one of the dimensions being zero is an error, as with the separate setters.
+    EXPECT_EQ(BAD_VALUE,
+              ANativeWindow_setBuffersGeometry(window.get(), 32, 0, HAL_PIXEL_FORMAT_RGB_565));
+}
+
 TEST_F(SurfaceTest, SettingGenerationNumber) {
     sp<IGraphicBufferProducer> producer;
     sp<IGraphicBufferConsumer> consumer;
@@ -376,6 +458,38 @@ TEST_F(SurfaceTest, SettingGenerationNumber) {
     ASSERT_EQ(1U, graphicBuffer->getGenerationNumber());
 }
 
+TEST_F(SurfaceTest, BatchDequeueAndQueueBuffers) {
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    sp<CpuConsumer> cpuConsumer = new CpuConsumer(consumer, 1);
+    sp<Surface> surface = new Surface(producer);
+    sp<ANativeWindow> window(surface);
+
+    ASSERT_EQ(NO_ERROR, surface->setMaxDequeuedBufferCount(2));
+    ASSERT_EQ(NO_ERROR, native_window_api_connect(window.get(), NATIVE_WINDOW_API_CPU));
+
+    std::vector<Surface::BatchBuffer> buffers(2);
+    ASSERT_EQ(NO_ERROR, surface->dequeueBuffers(&buffers));
+    ASSERT_NE(nullptr, buffers[0].buffer);
+    ASSERT_NE(nullptr, buffers[1].buffer);
+    EXPECT_NE(buffers[0].buffer, buffers[1].buffer);
+
+    std::vector<Surface::BatchQueuedBuffer> queuedBuffers(2);
+    for (size_t i = 0; i < buffers.size(); i++) {
+        queuedBuffers[i].buffer = buffers[i].buffer;
+        queuedBuffers[i].fenceFd = buffers[i].fenceFd;
+        queuedBuffers[i].timestamp = static_cast<nsecs_t>(i + 1);
+    }
+    ASSERT_EQ(NO_ERROR, surface->queueBuffers(queuedBuffers));
+
+    // Both buffers are waiting to be acquired.
+    int consumerRunningBehind = 0;
+    ASSERT_EQ(NO_ERROR,
+              producer->query(NATIVE_WINDOW_CONSUMER_RUNNING_BEHIND, &consumerRunningBehind));
+    EXPECT_EQ(1, consumerRunningBehind);
+}
+
 TEST_F(SurfaceTest, GetConsumerName) {
     sp<IGraphicBufferProducer> producer;
     sp<IGraphicBufferConsumer> consumer;
@@ -761,6 +875,14 @@ public:
         return NO_ERROR;
     }
     void setGameContentType(const sp<IBinder>& /*display*/, bool /*on*/) override {}
+    status_t captureScreenAsync(const sp<IBinder>& /*display*/, sp<GraphicBuffer>* /*outBuffer*/,
+                                sp<Fence>* /*outReadyFence*/, bool& /*outCapturedSecureLayers*/,
+                                ui::Dataspace /*reqDataspace*/, ui::PixelFormat /*reqPixelFormat*/,
+                                const Rect& /*sourceCrop*/, uint32_t /*reqWidth*/,
+                                uint32_t /*reqHeight*/, bool /*useIdentityTransform*/,
+                                ui::Rotation, bool /*captureSecureLayers*/) override {
+        return NO_ERROR;
+    }
     status_t captureScreen(uint64_t /*displayOrLayerStack*/, ui::Dataspace* /*outDataspace*/,
                            sp<GraphicBuffer>* /*outBuffer*/) override {
         return NO_ERROR;
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <binder/Parcel.h>
+#include <binder/ProcessState.h>
+#include <gui/LayerState.h>
+#include <gui/SurfaceComposerClient.h>
+#include <gui/SurfaceControl.h>
+
+#include <vector>
+
+namespace android {
+
+// A position update, as an animation sends every frame.
+static layer_state_t positionState() {
+    layer_state_t state;
+    state.what = layer_state_t::ePositionChanged;
+    state.x = 120.5f;
+    state.y = 640.25f;
+    return state;
+}
+
+// A state that touches most fields, as when a window is first shown.
+static layer_state_t fullState() {
+    layer_state_t state = positionState();
+    state.what |= layer_state_t::eLayerChanged | layer_state_t::eSizeChanged |
+            layer_state_t::eAlphaChanged | layer_state_t::eMatrixChanged |
+            layer_state_t::eTransparentRegionChanged | layer_state_t::eFlagsChanged |
+            layer_state_t::eLayerStackChanged | layer_state_t::eCropChanged_legacy |
+            layer_state_t::eCornerRadiusChanged | layer_state_t::eColorChanged |
+            layer_state_t::eSurfaceDamageRegionChanged | layer_state_t::eColorTransformChanged |
+            layer_state_t::eMetadataChanged | layer_state_t::eShadowRadiusChanged |
+            layer_state_t::eInputInfoChanged;
+    state.z = 3;
+    state.w = 1080;
+    state.h = 2340;
+    state.alpha = 0.5f;
+    state.matrix = {1.0f, 0.0f, 0.0f, 1.0f};
+    for (int i = 0; i < 8; i++) {
+        state.transparentRegion.orSelf(Rect(i * 100, i * 100, i * 100 + 50, i * 100 + 50));
+        state.surfaceDamageRegion.orSelf(Rect(i * 120, 0, i * 120 + 60, 60));
+    }
+    state.flags = layer_state_t::eLayerOpaque;
+    state.mask = layer_state_t::eLayerOpaque;
+    state.crop_legacy = Rect(0, 0, 1080, 2340);
+    state.cornerRadius = 32.0f;
+    state.color = half3(0.2f, 0.4f, 0.6f);
+    state.metadata.setInt32(METADATA_WINDOW_TYPE, 1);
+    state.metadata.setInt32(METADATA_OWNER_UID, 10042);
+    state.shadowRadius = 12.0f;
+    state.inputInfo.name = "Transaction_benchmark";
+    state.inputInfo.frameRight = 1080;
+    state.inputInfo.frameBottom = 2340;
+    return state;
+}
+
+static void BM_WriteLayerState(benchmark::State& benchmarkState, layer_state_t (*makeState)()) {
+    const layer_state_t state = makeState();
+    Parcel parcel;
+    for (auto _ : benchmarkState) {
+        parcel.setDataSize(0);
+        state.write(parcel);
+        benchmark::DoNotOptimize(parcel.data());
+    }
+    benchmarkState.counters["bytes"] = parcel.dataSize();
+}
+BENCHMARK_CAPTURE(BM_WriteLayerState, position, positionState);
+BENCHMARK_CAPTURE(BM_WriteLayerState, full, fullState);
+
+static void BM_ReadLayerState(benchmark::State& benchmarkState, layer_state_t (*makeState)()) {
+    Parcel parcel;
+    makeState().write(parcel);
+    for (auto _ : benchmarkState) {
+        parcel.setDataPosition(0);
+        layer_state_t state;
+        state.read(parcel);
+        benchmark::DoNotOptimize(state);
+    }
+    benchmarkState.counters["bytes"] = parcel.dataSize();
+}
+BENCHMARK_CAPTURE(BM_ReadLayerState, position, positionState);
+BENCHMARK_CAPTURE(BM_ReadLayerState, full, fullState);
+
+// Moves the given number of layers in one transaction and applies it, as a launcher animation
+// does every frame. With |async|, the transaction is reused across frames and handed to
+// applyAsync(), so only the caller's side of the apply is timed. Talks to the running
+// SurfaceFlinger.
+static void BM_ApplyPositionTransaction(benchmark::State& benchmarkState, bool async) {
+    ProcessState::self()->startThreadPool();
+    sp<SurfaceComposerClient> client = new SurfaceComposerClient;
+    if (client->initCheck() != NO_ERROR) {
+        benchmarkState.SkipWithError("Could not connect to SurfaceFlinger");
+        return;
+    }
+
+    std::vector<sp<SurfaceControl>> layers;
+    for (int64_t i = 0; i < benchmarkState.range(0); i++) {
+        sp<SurfaceControl> layer =
+                client->createSurface(String8("Transaction_benchmark"), 0, 0,
+                                      PIXEL_FORMAT_RGBA_8888,
+                                      ISurfaceComposerClient::eFXSurfaceEffect);
+        if (layer == nullptr) {
+            benchmarkState.SkipWithError("Could not create a layer");
+            return;
+        }
+        layers.push_back(layer);
+    }
+
+    size_t bytes = 0;
+    float offset = 0;
+    SurfaceComposerClient::Transaction reused;
+    for (auto _ : benchmarkState) {
+        SurfaceComposerClient::Transaction local;
+        SurfaceComposerClient::Transaction& transaction = async ? reused : local;
+        for (size_t i = 0; i < layers.size(); i++) {
+            transaction.setPosition(layers[i], offset + i, offset);
+        }
+        offset = offset < 1000 ? offset + 1 : 0;
+
+        benchmarkState.PauseTiming();
+        Parcel parcel;
+        transaction.writeToParcel(&parcel);
+        bytes = parcel.dataSize();
+        benchmarkState.ResumeTiming();
+
+        if (async) {
+            transaction.applyAsync();
+        } else {
+            transaction.apply();
+        }
+    }
+    benchmarkState.counters["bytes"] = bytes;
+
+    SurfaceComposerClient::Transaction transaction;
+    for (const auto& layer : layers) {
+        transaction.reparent(layer, nullptr);
+    }
+    transaction.apply();
+}
+BENCHMARK_CAPTURE(BM_ApplyPositionTransaction, sync, false)->Arg(1)->Arg(10)->Arg(50)->Arg(150);
+BENCHMARK_CAPTURE(BM_ApplyPositionTransaction, async, true)->Arg(1)->Arg(10)->Arg(50)->Arg(150);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -45,6 +45,17 @@ public:
                 IBinder::FLAG_ONEWAY);
     }
 
+    virtual void updateInputWindows(const InputWindowsUpdate& update,
+            const sp<ISetInputWindowsListener>& setInputWindowsListener) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IInputFlinger::getInterfaceDescriptor());
+        update.write(data);
+        data.writeStrongBinder(IInterface::asBinder(setInputWindowsListener));
+
+        remote()->transact(BnInputFlinger::UPDATE_INPUT_WINDOWS_TRANSACTION, data, &reply,
+                IBinder::FLAG_ONEWAY);
+    }
+
     virtual void registerInputChannel(const sp<InputChannel>& channel) {
         Parcel data, reply;
         data.writeInterfaceToken(IInputFlinger::getInterfaceDescriptor());
@@ -80,6 +91,18 @@ status_t BnInputFlinger::onTransact(
         setInputWindows(handles, setInputWindowsListener);
         break;
     }
+    case UPDATE_INPUT_WINDOWS_TRANSACTION: {
+        CHECK_INTERFACE(IInputFlinger, data, reply);
+        InputWindowsUpdate update;
+        status_t status = update.read(data);
+        if (status != OK) {
+            return status;
+        }
+        const sp<ISetInputWindowsListener> setInputWindowsListener =
+                ISetInputWindowsListener::asInterface(data.readStrongBinder());
+        updateInputWindows(update, setInputWindowsListener);
+        break;
+    }
     case REGISTER_INPUT_CHANNEL_TRANSACTION: {
         CHECK_INTERFACE(IInputFlinger, data, reply);
         sp<InputChannel> channel = InputChannel::read(data);
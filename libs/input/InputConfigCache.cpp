@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "InputConfigCache"
+
+#include <input/InputConfigCache.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mutex>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <utils/Log.h>
+
+using android::base::StringPrintf;
+using android::base::unique_fd;
+
+namespace android {
+
+static constexpr uint32_t MAGIC = 0x43434e49; // "INCC"
+
+// Followed by the source path, padded to a multiple of four bytes, then the words.
+struct CompiledHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t kind;
+    uint32_t pathLength;
+    int64_t mtime;
+    int64_t size;
+    uint64_t contentHash;
+    uint32_t wordCount;
+    uint32_t reserved;
+};
+static_assert(sizeof(CompiledHeader) == 48);
+
+static std::mutex gLock;
+static std::string gDirectory;
+
+static uint64_t fnv1a(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static size_t padded(size_t length) {
+    return (length + 3) & ~static_cast<size_t>(3);
+}
+
+static std::string getCompiledPath(const std::string& directory, const std::string& path,
+                                   InputConfigCache::Kind kind) {
+    return StringPrintf("%s/%016llx.%s", directory.c_str(),
+                        static_cast<unsigned long long>(fnv1a(path.data(), path.size())),
+                        kind == InputConfigCache::Kind::KEY_LAYOUT ? "klc" : "kcmc");
+}
+
+static bool readSource(const std::string& path, InputConfigCache::Source* outSource) {
+    unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    std::string contents;
+    if (!android::base::ReadFdToString(fd, &contents)) {
+        return false;
+    }
+    outSource->path = path;
+    outSource->mtime = st.st_mtime;
+    outSource->size = static_cast<int64_t>(contents.size());
+    outSource->contentHash = fnv1a(contents.data(), contents.size());
+    outSource->valid = true;
+    return true;
+}
+
+// --- InputConfigCache::Entry ---
+
+InputConfigCache::Entry::Entry(void* mapping, size_t mappingSize, const int32_t* words,
+                               size_t wordCount)
+      : mMapping(mapping), mMappingSize(mappingSize), mWords(words), mWordCount(wordCount) {}
+
+InputConfigCache::Entry::~Entry() {
+    munmap(mMapping, mMappingSize);
+}
+
+// --- InputConfigCache::Reader ---
+
+bool InputConfigCache::Reader::readCount(size_t wordsPerItem, size_t* outCount) {
+    int32_t count;
+    if (!read(&count) || count < 0) {
+        return false;
+    }
+    if (static_cast<size_t>(count) > (mWordCount - mPosition) / wordsPerItem) {
+        return false;
+    }
+    *outCount = static_cast<size_t>(count);
+    return true;
+}
+
+// --- InputConfigCache ---
+
+void InputConfigCache::setDirectory(const std::string& directory) {
+    std::scoped_lock _l(gLock);
+    gDirectory = directory;
+}
+
+std::string InputConfigCache::getDirectory() {
+    std::scoped_lock _l(gLock);
+    return gDirectory;
+}
+
+std::unique_ptr<InputConfigCache::Entry> InputConfigCache::find(const std::string& path,
+                                                                Kind kind, Source* outSource) {
+    *outSource = Source();
+    const std::string directory = getDirectory();
+    if (directory.empty() || !readSource(path, outSource)) {
+        return nullptr;
+    }
+
+    unique_fd fd(open(getCompiledPath(directory, path, kind).c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CompiledHeader)) {
+        return nullptr;
+    }
+    const size_t mappingSize = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        ALOGW("Could not map compiled form of %s: %s", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+
+    const CompiledHeader* header = static_cast<const CompiledHeader*>(mapping);
+    const char* compiledPath = static_cast<const char*>(mapping) + sizeof(CompiledHeader);
+    const size_t wordsOffset = sizeof(CompiledHeader) + padded(header->pathLength);
+    if (header->magic != MAGIC || header->version != VERSION ||
+        header->kind != static_cast<uint32_t>(kind) || header->pathLength != path.size() ||
+        header->mtime != outSource->mtime || header->size != outSource->size ||
+        header->contentHash != outSource->contentHash || wordsOffset > mappingSize ||
+        header->wordCount != (mappingSize - wordsOffset) / sizeof(int32_t) ||
+        (mappingSize - wordsOffset) % sizeof(int32_t) != 0 ||
+        memcmp(compiledPath, path.data(), path.size()) != 0) {
+        munmap(mapping, mappingSize);
+        return nullptr;
+    }
+
+    const int32_t* words = reinterpret_cast<const int32_t*>(
+            static_cast<const char*>(mapping) + wordsOffset);
+    return std::make_unique<Entry>(mapping, mappingSize, words, header->wordCount);
+}
+
+void InputConfigCache::store(const Source& source, Kind kind, const std::vector<int32_t>& words) {
+    const std::string directory = getDirectory();
+    if (!source.valid || directory.empty()) {
+        return;
+    }
+
+    CompiledHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.kind = static_cast<uint32_t>(kind);
+    header.pathLength = static_cast<uint32_t>(source.path.size());
+    header.mtime = source.mtime;
+    header.size = source.size;
+    header.contentHash = source.contentHash;
+    header.wordCount = static_cast<uint32_t>(words.size());
+
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents.append(source.path);
+    contents.resize(sizeof(header) + padded(source.path.size()), '\0');
+    contents.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(int32_t));
+
+    // Written aside and renamed into place, so that a reader never maps a partial file.
+    const std::string compiledPath = getCompiledPath(directory, source.path, kind);
+    const std::string tempPath = StringPrintf("%s.%d.tmp", compiledPath.c_str(), getpid());
+    {
+        unique_fd fd(open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (fd < 0) {
+            ALOGW("Could not create %s: %s", tempPath.c_str(), strerror(errno));
+            return;
+        }
+        if (!android::base::WriteFully(fd, contents.data(), contents.size())) {
+            ALOGW("Could not write %s: %s", tempPath.c_str(), strerror(errno));
+            unlink(tempPath.c_str());
+            return;
+        }
+    }
+    if (rename(tempPath.c_str(), compiledPath.c_str()) != 0) {
+        ALOGW("Could not rename %s: %s", tempPath.c_str(), strerror(errno));
+        unlink(tempPath.c_str());
+    }
+}
+
+} // namespace android
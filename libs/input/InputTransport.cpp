@@ -23,18 +23,28 @@ static constexpr bool DEBUG_TRANSPORT_ACTIONS = false;
 #include <fcntl.h>
 #include <inttypes.h>
 #include <math.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <android-base/stringprintf.h>
 #include <binder/Parcel.h>
+#include <cutils/ashmem.h>
 #include <cutils/properties.h>
 #include <log/log.h>
 #include <utils/Trace.h>
 
 #include <input/InputTransport.h>
 
+#include <atomic>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using android::base::StringPrintf;
 
 namespace android {
@@ -45,6 +55,13 @@ namespace android {
 // behind processing touches.
 static const size_t SOCKET_BUFFER_SIZE = 32 * 1024;
 
+// Number of messages each shared memory ring holds. Like the socket buffer, it only needs to
+// absorb a burst while the application is behind; once it is full the publisher gets WOULD_BLOCK
+// and waits for finished signals.
+static constexpr uint64_t RING_CAPACITY = 16;
+
+static constexpr uint32_t RING_MAGIC = 0x494e5052; // 'INPR'
+
 // Nanoseconds per milliseconds.
 static const nsecs_t NANOS_PER_MS = 1000000;
 
@@ -84,6 +101,32 @@ inline static float lerp(float a, float b, float alpha) {
     return a + alpha * (b - a);
 }
 
+/**
+ * out[i] = lerp(a[i], b[i], alpha) for i in [0, count).
+ * The vector paths perform the same multiply and add as lerp(), so the results are identical.
+ */
+static void lerpLanes(const float* a, const float* b, float alpha, float* out, size_t count) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    const float32x4_t vAlpha = vdupq_n_f32(alpha);
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t va = vld1q_f32(a + i);
+        const float32x4_t vb = vld1q_f32(b + i);
+        vst1q_f32(out + i, vaddq_f32(va, vmulq_f32(vAlpha, vsubq_f32(vb, va))));
+    }
+#elif defined(__SSE2__)
+    const __m128 vAlpha = _mm_set1_ps(alpha);
+    for (; i + 4 <= count; i += 4) {
+        const __m128 va = _mm_loadu_ps(a + i);
+        const __m128 vb = _mm_loadu_ps(b + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(va, _mm_mul_ps(vAlpha, _mm_sub_ps(vb, va))));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = lerp(a[i], b[i], alpha);
+    }
+}
+
 inline static bool isPointerEvent(int32_t source) {
     return (source & AINPUT_SOURCE_CLASS_POINTER) == AINPUT_SOURCE_CLASS_POINTER;
 }
@@ -246,6 +289,73 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
     }
 }
 
+// --- InputChannel::SharedRings ---
+
+namespace {
+
+struct RingSlot {
+    uint32_t size;
+    uint32_t padding;
+    InputMessage msg;
+};
+
+/*
+ * A single-producer, single-consumer queue of InputMessages. It lives in memory shared with the
+ * peer, so its layout must be identical on 64 and 32 bit processes, and nothing read from it can
+ * be trusted: the peer may scribble over the indices or the slots at any time.
+ */
+struct Ring {
+    // Number of messages ever pushed. Only advanced by the producer.
+    alignas(64) std::atomic<uint64_t> head;
+    // Number of messages ever popped. Only advanced by the consumer.
+    alignas(64) std::atomic<uint64_t> tail;
+    // Set by a consumer that found the ring empty. The producer that clears it owes the
+    // consumer a wakeup over the socket.
+    alignas(64) std::atomic<uint32_t> consumerWaiting;
+    alignas(64) RingSlot slots[RING_CAPACITY];
+};
+
+struct SharedRegion {
+    uint32_t magic;
+    uint32_t padding;
+    // rings[0] carries server -> client messages, rings[1] client -> server.
+    Ring rings[2];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+} // namespace
+
+struct InputChannel::SharedRings {
+    android::base::unique_fd fd;
+    SharedRegion* region;
+    bool isServer;
+
+    ~SharedRings() { munmap(region, sizeof(SharedRegion)); }
+
+    Ring& tx() { return region->rings[isServer ? 0 : 1]; }
+    Ring& rx() { return region->rings[isServer ? 1 : 0]; }
+
+    static std::shared_ptr<SharedRings> map(android::base::unique_fd fd, bool isServer) {
+        if (ashmem_get_size_region(fd.get()) != static_cast<int>(sizeof(SharedRegion))) {
+            ALOGE("Input channel shared memory has the wrong size");
+            return nullptr;
+        }
+        void* addr = mmap(nullptr, sizeof(SharedRegion), PROT_READ | PROT_WRITE, MAP_SHARED,
+                          fd.get(), 0);
+        if (addr == MAP_FAILED) {
+            ALOGE("Could not map input channel shared memory: %s", strerror(errno));
+            return nullptr;
+        }
+        auto rings = std::make_shared<SharedRings>();
+        rings->fd = std::move(fd);
+        rings->region = static_cast<SharedRegion*>(addr);
+        rings->isServer = isServer;
+        return rings;
+    }
+};
+
 // --- InputChannel ---
 
 sp<InputChannel> InputChannel::create(const std::string& name, android::base::unique_fd fd,
@@ -256,11 +366,12 @@ sp<InputChannel> InputChannel::create(const std::string& name, android::base::un
                          strerror(errno));
         return nullptr;
     }
-    return new InputChannel(name, std::move(fd), token);
+    return new InputChannel(name, std::move(fd), token, nullptr);
 }
 
-InputChannel::InputChannel(const std::string& name, android::base::unique_fd fd, sp<IBinder> token)
-      : mName(name), mFd(std::move(fd)), mToken(token) {
+InputChannel::InputChannel(const std::string& name, android::base::unique_fd fd, sp<IBinder> token,
+                           std::shared_ptr<SharedRings> rings)
+      : mName(name), mFd(std::move(fd)), mToken(token), mRings(std::move(rings)) {
     if (DEBUG_CHANNEL_LIFECYCLE) {
         ALOGD("Input channel constructed: name='%s', fd=%d", mName.c_str(), mFd.get());
     }
@@ -302,7 +413,58 @@ status_t InputChannel::openInputChannelPair(const std::string& name,
     return OK;
 }
 
+status_t InputChannel::openInputChannelPair(const std::string& name,
+        sp<InputChannel>& outServerChannel, sp<InputChannel>& outClientChannel,
+        Transport transport) {
+    status_t result = openInputChannelPair(name, outServerChannel, outClientChannel);
+    if (result != OK || transport == Transport::SOCKET) {
+        return result;
+    }
+
+    std::string regionName = "input channel " + name;
+    android::base::unique_fd serverFd(ashmem_create_region(regionName.c_str(),
+                                                           sizeof(SharedRegion)));
+    if (!serverFd.ok()) {
+        ALOGW("channel '%s' ~ Could not create shared memory, using the socket: %s",
+              name.c_str(), strerror(errno));
+        return OK;
+    }
+    android::base::unique_fd clientFd(::dup(serverFd.get()));
+    std::shared_ptr<SharedRings> serverRings = SharedRings::map(std::move(serverFd), true);
+    if (!clientFd.ok() || serverRings == nullptr) {
+        ALOGW("channel '%s' ~ Could not set up shared memory, using the socket", name.c_str());
+        return OK;
+    }
+    // ashmem is zero filled, which is the empty state for both rings. Both consumers start out
+    // waiting, so the first message also tells the producer whether the peer is still there.
+    serverRings->region->magic = RING_MAGIC;
+    for (Ring& ring : serverRings->region->rings) {
+        ring.consumerWaiting.store(1, std::memory_order_relaxed);
+    }
+    std::shared_ptr<SharedRings> clientRings = SharedRings::map(std::move(clientFd), false);
+    if (clientRings == nullptr) {
+        ALOGW("channel '%s' ~ Could not set up shared memory, using the socket", name.c_str());
+        return OK;
+    }
+
+    outServerChannel->mRings = std::move(serverRings);
+    outClientChannel->mRings = std::move(clientRings);
+    return OK;
+}
+
+InputChannel::Transport InputChannel::getTransport() const {
+    return mRings != nullptr ? Transport::SHARED_MEMORY : Transport::SOCKET;
+}
+
 status_t InputChannel::sendMessage(const InputMessage* msg) {
+    return mRings != nullptr ? sendRingMessage(msg) : sendSocketMessage(msg);
+}
+
+status_t InputChannel::receiveMessage(InputMessage* msg) {
+    return mRings != nullptr ? receiveRingMessage(msg) : receiveSocketMessage(msg);
+}
+
+status_t InputChannel::sendSocketMessage(const InputMessage* msg) {
     const size_t msgLength = msg->size();
     InputMessage cleanMsg;
     msg->getSanitizedCopy(&cleanMsg);
@@ -340,7 +502,7 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
     return OK;
 }
 
-status_t InputChannel::receiveMessage(InputMessage* msg) {
+status_t InputChannel::receiveSocketMessage(InputMessage* msg) {
     ssize_t nRead;
     do {
         nRead = ::recv(mFd.get(), msg, sizeof(InputMessage), MSG_DONTWAIT);
@@ -380,6 +542,119 @@ status_t InputChannel::receiveMessage(InputMessage* msg) {
     return OK;
 }
 
+status_t InputChannel::sendRingMessage(const InputMessage* msg) {
+    Ring& ring = mRings->tx();
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    const uint64_t tail = ring.tail.load(std::memory_order_acquire);
+    if (tail > head || head - tail > RING_CAPACITY) {
+        ALOGE("channel '%s' ~ shared ring is corrupt, head=%" PRIu64 " tail=%" PRIu64,
+              mName.c_str(), head, tail);
+        return DEAD_OBJECT;
+    }
+    if (head - tail == RING_CAPACITY) {
+        return WOULD_BLOCK;
+    }
+
+    RingSlot& slot = ring.slots[head % RING_CAPACITY];
+    msg->getSanitizedCopy(&slot.msg);
+    slot.size = static_cast<uint32_t>(msg->size());
+    // seq_cst orders the publish before the consumerWaiting check; the consumer does the
+    // opposite, so one of the two always sees the other.
+    ring.head.store(head + 1, std::memory_order_seq_cst);
+
+#if DEBUG_CHANNEL_MESSAGES
+    ALOGD("channel '%s' ~ queued message of type %d", mName.c_str(), msg->header.type);
+#endif
+
+    if (ring.consumerWaiting.exchange(0, std::memory_order_seq_cst) == 0) {
+        // The consumer has not drained the ring yet, so it will see this message without
+        // being woken up.
+        return OK;
+    }
+
+    const uint8_t wakeup = 0;
+    ssize_t nWrite;
+    do {
+        nWrite = ::send(mFd.get(), &wakeup, sizeof(wakeup), MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (nWrite == -1 && errno == EINTR);
+    if (nWrite < 0) {
+        int error = errno;
+        if (error == EAGAIN || error == EWOULDBLOCK) {
+            // Wakeups are still pending in the socket, so the consumer will come back.
+            return OK;
+        }
+        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED || error == ECONNRESET) {
+            return DEAD_OBJECT;
+        }
+        return -error;
+    }
+    return OK;
+}
+
+// Pops the oldest message of a ring. Returns WOULD_BLOCK if it is empty.
+static status_t popRingMessage(Ring& ring, InputMessage* msg) {
+    const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    const uint64_t head = ring.head.load(std::memory_order_seq_cst);
+    if (head == tail) {
+        return WOULD_BLOCK;
+    }
+    if (head < tail || head - tail > RING_CAPACITY) {
+        return BAD_VALUE;
+    }
+
+    const RingSlot& slot = ring.slots[tail % RING_CAPACITY];
+    // Read the size exactly once: the peer may change it under us.
+    const uint32_t size = *static_cast<const volatile uint32_t*>(&slot.size);
+    if (size > sizeof(InputMessage)) {
+        return BAD_VALUE;
+    }
+    memcpy(msg, &slot.msg, size);
+    ring.tail.store(tail + 1, std::memory_order_release);
+
+    // Validate the private copy only.
+    return msg->isValid(size) ? OK : BAD_VALUE;
+}
+
+status_t InputChannel::receiveRingMessage(InputMessage* msg) {
+    Ring& ring = mRings->rx();
+    status_t status = popRingMessage(ring, msg);
+    if (status != WOULD_BLOCK) {
+#if DEBUG_CHANNEL_MESSAGES
+        ALOGD("channel '%s' ~ dequeued message, status=%d", mName.c_str(), status);
+#endif
+        return status;
+    }
+
+    // The ring is empty. Consume the wakeup that may have brought us here, which also notices
+    // when the peer has closed its end.
+    uint8_t wakeup;
+    ssize_t nRead;
+    do {
+        nRead = ::recv(mFd.get(), &wakeup, sizeof(wakeup), MSG_DONTWAIT);
+    } while (nRead == -1 && errno == EINTR);
+    if (nRead == 0) {
+        return DEAD_OBJECT;
+    }
+    if (nRead < 0) {
+        int error = errno;
+        if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
+            return DEAD_OBJECT;
+        }
+        if (error != EAGAIN && error != EWOULDBLOCK) {
+            return -error;
+        }
+    }
+
+    // Ask for a wakeup, then look again in case a message was queued before the producer could
+    // have seen the request.
+    ring.consumerWaiting.store(1, std::memory_order_seq_cst);
+    status = popRingMessage(ring, msg);
+    if (status != WOULD_BLOCK) {
+        ring.consumerWaiting.store(0, std::memory_order_relaxed);
+    }
+    return status;
+}
+
 sp<InputChannel> InputChannel::dup() const {
     android::base::unique_fd newFd(::dup(getFd()));
     if (!newFd.ok()) {
@@ -394,7 +669,11 @@ sp<InputChannel> InputChannel::dup() const {
                             getName().c_str());
         return nullptr;
     }
-    return InputChannel::create(mName, std::move(newFd), mToken);
+    sp<InputChannel> channel = InputChannel::create(mName, std::move(newFd), mToken);
+    if (channel != nullptr) {
+        channel->mRings = mRings;
+    }
+    return channel;
 }
 
 status_t InputChannel::write(Parcel& out) const {
@@ -409,6 +688,21 @@ status_t InputChannel::write(Parcel& out) const {
     }
 
     s = out.writeUniqueFileDescriptor(mFd);
+    if (s != OK) {
+        return s;
+    }
+
+    s = out.writeBool(mRings != nullptr);
+    if (s != OK || mRings == nullptr) {
+        return s;
+    }
+
+    s = out.writeUniqueFileDescriptor(mRings->fd);
+    if (s != OK) {
+        return s;
+    }
+
+    s = out.writeBool(mRings->isServer);
     return s;
 }
 
@@ -421,7 +715,24 @@ sp<InputChannel> InputChannel::read(const Parcel& from) {
         return nullptr;
     }
 
-    return InputChannel::create(name, std::move(rawFd), token);
+    std::shared_ptr<SharedRings> rings;
+    if (from.readBool()) {
+        android::base::unique_fd ringFd;
+        if (from.readUniqueFileDescriptor(&ringFd) != OK) {
+            return nullptr;
+        }
+        const bool isServer = from.readBool();
+        rings = SharedRings::map(std::move(ringFd), isServer);
+        if (rings == nullptr || rings->region->magic != RING_MAGIC) {
+            return nullptr;
+        }
+    }
+
+    sp<InputChannel> channel = InputChannel::create(name, std::move(rawFd), token);
+    if (channel != nullptr) {
+        channel->mRings = std::move(rings);
+    }
+    return channel;
 }
 
 sp<IBinder> InputChannel::getConnectionToken() const {
@@ -960,26 +1271,31 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
     }
 
     // Find the data to use for resampling.
-    const History* other;
-    History future;
+    // The future sample is read in place from the next batched message rather than copied
+    // into a History.
+    BitSet32 otherIdBits;
+    const PointerCoords* otherCoordsById[MAX_POINTER_ID + 1];
     float alpha;
     if (next) {
         // Interpolate between current sample and future sample.
         // So current->eventTime <= sampleTime <= future.eventTime.
-        future.initializeFrom(*next);
-        other = &future;
-        nsecs_t delta = future.eventTime - current->eventTime;
+        nsecs_t delta = next->body.motion.eventTime - current->eventTime;
         if (delta < RESAMPLE_MIN_DELTA) {
 #if DEBUG_RESAMPLING
             ALOGD("Not resampled, delta time is too small: %" PRId64 " ns.", delta);
 #endif
             return;
         }
+        for (uint32_t i = 0; i < next->body.motion.pointerCount; i++) {
+            uint32_t id = next->body.motion.pointers[i].properties.id;
+            otherIdBits.markBit(id);
+            otherCoordsById[id] = &next->body.motion.pointers[i].coords;
+        }
         alpha = float(sampleTime - current->eventTime) / delta;
     } else if (touchState.historySize >= 2) {
         // Extrapolate future sample using current sample and past sample.
         // So other->eventTime <= current->eventTime <= sampleTime.
-        other = touchState.getHistory(1);
+        const History* other = touchState.getHistory(1);
         nsecs_t delta = current->eventTime - other->eventTime;
         if (delta < RESAMPLE_MIN_DELTA) {
 #if DEBUG_RESAMPLING
@@ -1001,6 +1317,11 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
 #endif
             sampleTime = maxPredict;
         }
+        otherIdBits = other->idBits;
+        for (BitSet32 idBits(other->idBits); !idBits.isEmpty(); ) {
+            uint32_t id = idBits.clearFirstMarkedBit();
+            otherCoordsById[id] = &other->getPointerById(id);
+        }
         alpha = float(current->eventTime - sampleTime) / delta;
     } else {
 #if DEBUG_RESAMPLING
@@ -1010,6 +1331,14 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
     }
 
     // Resample touch coordinates.
+    // The coordinates of the pointers that need blending are gathered into contiguous x and y
+    // lanes, blended in a vectorized pass, then written back.
+    size_t laneCount = 0;
+    uint32_t lanePointerIndex[MAX_POINTERS];
+    float currentX[MAX_POINTERS], currentY[MAX_POINTERS];
+    float otherX[MAX_POINTERS], otherY[MAX_POINTERS];
+    float resampledX[MAX_POINTERS], resampledY[MAX_POINTERS];
+
     History oldLastResample;
     oldLastResample.initializeFrom(touchState.lastResample);
     touchState.lastResample.eventTime = sampleTime;
@@ -1033,21 +1362,15 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
         PointerCoords& resampledCoords = touchState.lastResample.pointers[i];
         const PointerCoords& currentCoords = current->getPointerById(id);
         resampledCoords.copyFrom(currentCoords);
-        if (other->idBits.hasBit(id)
+        if (otherIdBits.hasBit(id)
                 && shouldResampleTool(event->getToolType(i))) {
-            const PointerCoords& otherCoords = other->getPointerById(id);
-            resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_X,
-                    lerp(currentCoords.getX(), otherCoords.getX(), alpha));
-            resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_Y,
-                    lerp(currentCoords.getY(), otherCoords.getY(), alpha));
-#if DEBUG_RESAMPLING
-            ALOGD("[%d] - out (%0.3f, %0.3f), cur (%0.3f, %0.3f), "
-                    "other (%0.3f, %0.3f), alpha %0.3f",
-                    id, resampledCoords.getX(), resampledCoords.getY(),
-                    currentCoords.getX(), currentCoords.getY(),
-                    otherCoords.getX(), otherCoords.getY(),
-                    alpha);
-#endif
+            const PointerCoords& otherCoords = *otherCoordsById[id];
+            lanePointerIndex[laneCount] = i;
+            currentX[laneCount] = currentCoords.getX();
+            currentY[laneCount] = currentCoords.getY();
+            otherX[laneCount] = otherCoords.getX();
+            otherY[laneCount] = otherCoords.getY();
+            laneCount++;
         } else {
 #if DEBUG_RESAMPLING
             ALOGD("[%d] - out (%0.3f, %0.3f), cur (%0.3f, %0.3f)",
@@ -1057,6 +1380,22 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
         }
     }
 
+    lerpLanes(currentX, otherX, alpha, resampledX, laneCount);
+    lerpLanes(currentY, otherY, alpha, resampledY, laneCount);
+    for (size_t lane = 0; lane < laneCount; lane++) {
+        PointerCoords& resampledCoords = touchState.lastResample.pointers[lanePointerIndex[lane]];
+        resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_X, resampledX[lane]);
+        resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, resampledY[lane]);
+#if DEBUG_RESAMPLING
+        ALOGD("[%d] - out (%0.3f, %0.3f), cur (%0.3f, %0.3f), "
+                "other (%0.3f, %0.3f), alpha %0.3f",
+                event->getPointerId(lanePointerIndex[lane]),
+                resampledCoords.getX(), resampledCoords.getY(),
+                currentX[lane], currentY[lane], otherX[lane], otherY[lane],
+                alpha);
+#endif
+    }
+
     event->addSample(sampleTime, touchState.lastResample.pointers);
 }
 
@@ -65,6 +65,25 @@ bool InputWindowInfo::overlaps(const InputWindowInfo* other) const {
             && frameTop < other->frameBottom && frameBottom > other->frameTop;
 }
 
+bool InputWindowInfo::operator==(const InputWindowInfo& other) const {
+    return token == other.token && id == other.id && name == other.name &&
+            layoutParamsFlags == other.layoutParamsFlags &&
+            layoutParamsType == other.layoutParamsType &&
+            dispatchingTimeout == other.dispatchingTimeout && frameLeft == other.frameLeft &&
+            frameTop == other.frameTop && frameRight == other.frameRight &&
+            frameBottom == other.frameBottom && surfaceInset == other.surfaceInset &&
+            globalScaleFactor == other.globalScaleFactor && windowXScale == other.windowXScale &&
+            windowYScale == other.windowYScale &&
+            touchableRegion.hasSameRects(other.touchableRegion) && visible == other.visible && canReceiveKeys == other.canReceiveKeys &&
+            hasFocus == other.hasFocus && hasWallpaper == other.hasWallpaper &&
+            paused == other.paused && ownerPid == other.ownerPid && ownerUid == other.ownerUid &&
+            inputFeatures == other.inputFeatures && displayId == other.displayId &&
+            portalToDisplayId == other.portalToDisplayId &&
+            applicationInfo == other.applicationInfo &&
+            replaceTouchableRegionWithCrop == other.replaceTouchableRegionWithCrop &&
+            touchableRegionCropHandle == other.touchableRegionCropHandle;
+}
+
 status_t InputWindowInfo::write(Parcel& output) const {
     if (name.empty()) {
         output.writeInt32(0);
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "InputWindowsUpdate"
+
+#include <input/InputWindowsUpdate.h>
+
+#include <inttypes.h>
+#include <log/log.h>
+
+namespace android {
+
+// --- InputWindowsUpdate ---
+
+status_t InputWindowsUpdate::write(Parcel& output) const {
+    status_t status = output.writeUint64(sequence);
+    if (status != OK) return status;
+    status = output.writeBool(fullSync);
+    if (status != OK) return status;
+    status = output.writeUint32(static_cast<uint32_t>(changed.size()));
+    if (status != OK) return status;
+    for (const InputWindowInfo& info : changed) {
+        status = info.write(output);
+        if (status != OK) return status;
+    }
+    status = output.writeInt32Vector(removed);
+    if (status != OK) return status;
+    status = output.writeBool(orderChanged);
+    if (status != OK) return status;
+    return output.writeInt32Vector(order);
+}
+
+status_t InputWindowsUpdate::read(const Parcel& from) {
+    status_t status = from.readUint64(&sequence);
+    if (status != OK) return status;
+    status = from.readBool(&fullSync);
+    if (status != OK) return status;
+    uint32_t count;
+    status = from.readUint32(&count);
+    if (status != OK) return status;
+    if (count > from.dataAvail()) {
+        return BAD_VALUE;
+    }
+    changed.clear();
+    changed.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        changed.push_back(InputWindowInfo::read(from));
+    }
+    status = from.readInt32Vector(&removed);
+    if (status != OK) return status;
+    status = from.readBool(&orderChanged);
+    if (status != OK) return status;
+    return from.readInt32Vector(&order);
+}
+
+// --- InputWindowsUpdateWriter ---
+
+InputWindowsUpdate InputWindowsUpdateWriter::update(const std::vector<InputWindowInfo>& windows) {
+    InputWindowsUpdate result;
+
+    std::vector<int32_t> order;
+    order.reserve(windows.size());
+    for (const InputWindowInfo& info : windows) {
+        order.push_back(info.id);
+    }
+
+    if (mFullSyncRequested || ++mUpdatesSinceFullSync >= FULL_SYNC_INTERVAL) {
+        mFullSyncRequested = false;
+        mUpdatesSinceFullSync = 0;
+        mWindows.clear();
+        for (const InputWindowInfo& info : windows) {
+            mWindows.insert_or_assign(info.id, info);
+        }
+        mOrder = order;
+
+        result.sequence = ++mSequence;
+        result.fullSync = true;
+        result.changed = windows;
+        result.orderChanged = true;
+        result.order = std::move(order);
+        return result;
+    }
+
+    std::unordered_set<int32_t> ids;
+    ids.reserve(windows.size());
+    for (const InputWindowInfo& info : windows) {
+        if (!ids.insert(info.id).second) {
+            ALOGE("Input window %s has the same id %" PRId32 " as another window",
+                  info.name.c_str(), info.id);
+        }
+        auto it = mWindows.find(info.id);
+        if (it == mWindows.end()) {
+            mWindows.emplace(info.id, info);
+            result.changed.push_back(info);
+        } else if (it->second != info) {
+            it->second = info;
+            result.changed.push_back(info);
+        }
+    }
+    for (auto it = mWindows.begin(); it != mWindows.end();) {
+        if (ids.find(it->first) == ids.end()) {
+            result.removed.push_back(it->first);
+            it = mWindows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (order != mOrder) {
+        mOrder = order;
+        result.orderChanged = true;
+        result.order = std::move(order);
+    }
+    result.sequence = result.isEmpty() ? mSequence : ++mSequence;
+    return result;
+}
+
+// --- InputWindowsState ---
+
+bool InputWindowsState::apply(const InputWindowsUpdate& update,
+                              std::unordered_set<int32_t>* outChangedDisplays) {
+    if (update.fullSync) {
+        for (const auto& [id, info] : mWindows) {
+            outChangedDisplays->insert(info.displayId);
+        }
+        mWindows.clear();
+        mOrder.clear();
+        mSynced = true;
+    } else if (mSynced && update.isEmpty() && update.sequence == mSequence) {
+        return true;
+    } else if (!mSynced || update.sequence != mSequence + 1) {
+        // Everything up to the next full sync is relative to state we do not have.
+        mSynced = false;
+        return false;
+    }
+    mSequence = update.sequence;
+
+    for (int32_t id : update.removed) {
+        auto it = mWindows.find(id);
+        if (it != mWindows.end()) {
+            outChangedDisplays->insert(it->second.displayId);
+            mWindows.erase(it);
+        }
+    }
+    for (const InputWindowInfo& info : update.changed) {
+        auto it = mWindows.find(info.id);
+        if (it != mWindows.end()) {
+            // The window may have moved to another display.
+            outChangedDisplays->insert(it->second.displayId);
+            it->second = info;
+        } else {
+            mWindows.emplace(info.id, info);
+        }
+        outChangedDisplays->insert(info.displayId);
+    }
+    if (update.orderChanged) {
+        mOrder = update.order;
+        for (int32_t id : mOrder) {
+            auto it = mWindows.find(id);
+            if (it == mWindows.end()) {
+                ALOGE("Input windows update %" PRIu64 " orders unknown window %" PRId32,
+                      update.sequence, id);
+                mSynced = false;
+                return false;
+            }
+            outChangedDisplays->insert(it->second.displayId);
+        }
+    }
+
+    if (mOrder.size() != mWindows.size()) {
+        ALOGE("Input windows update %" PRIu64 " lists %zu windows in z order but has %zu windows",
+              update.sequence, mOrder.size(), mWindows.size());
+        mSynced = false;
+        return false;
+    }
+    return true;
+}
+
+const InputWindowInfo* InputWindowsState::getWindow(int32_t id) const {
+    auto it = mWindows.find(id);
+    return it != mWindows.end() ? &it->second : nullptr;
+}
+
+} // namespace android
@@ -110,6 +110,23 @@ status_t KeyCharacterMap::load(const std::string& filename,
         Format format, sp<KeyCharacterMap>* outMap) {
     outMap->clear();
 
+    InputConfigCache::Source source;
+    std::unique_ptr<InputConfigCache::Entry> entry =
+            InputConfigCache::find(filename, InputConfigCache::Kind::KEY_CHARACTER_MAP, &source);
+    if (entry) {
+        sp<KeyCharacterMap> map = new KeyCharacterMap();
+        InputConfigCache::Reader reader(*entry);
+        if (map->readCompiled(reader) != OK) {
+            ALOGW("Ignoring malformed compiled key character map for %s.", filename.c_str());
+        } else if ((format == FORMAT_BASE && map->mType != KEYBOARD_TYPE_OVERLAY)
+                || (format == FORMAT_OVERLAY && map->mType == KEYBOARD_TYPE_OVERLAY)
+                || format == FORMAT_ANY) {
+            *outMap = map;
+            return OK;
+        }
+        // Otherwise the parser reports why the map does not have the requested format.
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
     if (status) {
@@ -117,6 +134,10 @@ status_t KeyCharacterMap::load(const std::string& filename,
     } else {
         status = load(tokenizer, format, outMap);
         delete tokenizer;
+        if (!status) {
+            InputConfigCache::store(source, InputConfigCache::Kind::KEY_CHARACTER_MAP,
+                    (*outMap)->compile());
+        }
     }
     return status;
 }
@@ -599,6 +620,87 @@ void KeyCharacterMap::addLockedMetaKey(Vector<KeyEvent>& outEvents,
     }
 }
 
+std::vector<int32_t> KeyCharacterMap::compile() const {
+    std::vector<int32_t> words;
+    words.push_back(mType);
+    words.push_back(mKeys.size());
+    for (size_t i = 0; i < mKeys.size(); i++) {
+        const Key* key = mKeys.valueAt(i);
+        words.push_back(mKeys.keyAt(i));
+        words.push_back(key->label);
+        words.push_back(key->number);
+        const size_t countIndex = words.size();
+        words.push_back(0);
+        for (const Behavior* behavior = key->firstBehavior; behavior != nullptr;
+                behavior = behavior->next) {
+            words.push_back(behavior->metaState);
+            words.push_back(behavior->character);
+            words.push_back(behavior->fallbackKeyCode);
+            words.push_back(behavior->replacementKeyCode);
+            words[countIndex]++;
+        }
+    }
+    for (const KeyedVector<int32_t, int32_t>* keys : {&mKeysByScanCode, &mKeysByUsageCode}) {
+        words.push_back(keys->size());
+        for (size_t i = 0; i < keys->size(); i++) {
+            words.push_back(keys->keyAt(i));
+            words.push_back(keys->valueAt(i));
+        }
+    }
+    return words;
+}
+
+status_t KeyCharacterMap::readCompiled(InputConfigCache::Reader& reader) {
+    int32_t type;
+    size_t numKeys;
+    if (!reader.read(&type) || !reader.readCount(4, &numKeys) || numKeys > MAX_KEYS) {
+        return BAD_VALUE;
+    }
+    mType = type;
+    mKeys.setCapacity(numKeys);
+    for (size_t i = 0; i < numKeys; i++) {
+        int32_t keyCode, label, number;
+        size_t numBehaviors;
+        if (!reader.read(&keyCode) || !reader.read(&label) || !reader.read(&number)
+                || !reader.readCount(4, &numBehaviors) || mKeys.indexOfKey(keyCode) >= 0) {
+            return BAD_VALUE;
+        }
+        Key* key = new Key();
+        key->label = static_cast<char16_t>(label);
+        key->number = static_cast<char16_t>(number);
+        mKeys.add(keyCode, key);
+
+        Behavior** nextBehavior = &key->firstBehavior;
+        for (size_t j = 0; j < numBehaviors; j++) {
+            Behavior* behavior = new Behavior();
+            *nextBehavior = behavior;
+            nextBehavior = &behavior->next;
+            int32_t character;
+            if (!reader.read(&behavior->metaState) || !reader.read(&character)
+                    || !reader.read(&behavior->fallbackKeyCode)
+                    || !reader.read(&behavior->replacementKeyCode)) {
+                return BAD_VALUE;
+            }
+            behavior->character = static_cast<char16_t>(character);
+        }
+    }
+    for (KeyedVector<int32_t, int32_t>* keys : {&mKeysByScanCode, &mKeysByUsageCode}) {
+        size_t count;
+        if (!reader.readCount(2, &count)) {
+            return BAD_VALUE;
+        }
+        keys->setCapacity(count);
+        for (size_t i = 0; i < count; i++) {
+            int32_t code, keyCode;
+            if (!reader.read(&code) || !reader.read(&keyCode)) {
+                return BAD_VALUE;
+            }
+            keys->add(code, keyCode);
+        }
+    }
+    return reader.isAtEnd() ? OK : BAD_VALUE;
+}
+
 #ifdef __ANDROID__
 sp<KeyCharacterMap> KeyCharacterMap::readFromParcel(Parcel* parcel) {
     sp<KeyCharacterMap> map = new KeyCharacterMap();
@@ -637,7 +739,7 @@ sp<KeyCharacterMap> KeyCharacterMap::readFromParcel(Parcel* parcel) {
 
             Behavior* behavior = new Behavior();
             behavior->metaState = metaState;
-            behavior->character = character;
+            behavior->character = static_cast<char16_t>(character);
             behavior->fallbackKeyCode = fallbackKeyCode;
             behavior->replacementKeyCode = replacementKeyCode;
             if (lastBehavior) {
@@ -52,6 +52,19 @@ KeyLayoutMap::~KeyLayoutMap() {
 status_t KeyLayoutMap::load(const std::string& filename, sp<KeyLayoutMap>* outMap) {
     outMap->clear();
 
+    InputConfigCache::Source source;
+    std::unique_ptr<InputConfigCache::Entry> entry =
+            InputConfigCache::find(filename, InputConfigCache::Kind::KEY_LAYOUT, &source);
+    if (entry) {
+        sp<KeyLayoutMap> map = new KeyLayoutMap();
+        InputConfigCache::Reader reader(*entry);
+        if (map->readCompiled(reader) == OK) {
+            *outMap = map;
+            return OK;
+        }
+        ALOGW("Ignoring malformed compiled key layout map for %s.", filename.c_str());
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
     if (status) {
@@ -75,6 +88,8 @@ status_t KeyLayoutMap::load(const std::string& filename, sp<KeyLayoutMap>* outMa
 #endif
             if (!status) {
                 *outMap = map;
+                InputConfigCache::store(source, InputConfigCache::Kind::KEY_LAYOUT,
+                                        map->compile());
             }
         }
         delete tokenizer;
@@ -120,6 +135,85 @@ const KeyLayoutMap::Key* KeyLayoutMap::getKey(int32_t scanCode, int32_t usageCod
     return nullptr;
 }
 
+template <typename T, typename Fn>
+static void compileVector(const KeyedVector<int32_t, T>& vector, std::vector<int32_t>& words,
+                          Fn compileValue) {
+    words.push_back(static_cast<int32_t>(vector.size()));
+    for (size_t i = 0; i < vector.size(); i++) {
+        words.push_back(vector.keyAt(i));
+        compileValue(vector.valueAt(i));
+    }
+}
+
+// Keys are written in ascending order, so add() always appends.
+template <typename T, typename Fn>
+static bool readCompiledVector(InputConfigCache::Reader& reader, size_t wordsPerValue,
+                               KeyedVector<int32_t, T>& vector, Fn readValue) {
+    size_t count;
+    if (!reader.readCount(1 + wordsPerValue, &count)) {
+        return false;
+    }
+    vector.setCapacity(count);
+    for (size_t i = 0; i < count; i++) {
+        int32_t key;
+        T value;
+        if (!reader.read(&key) || !readValue(&value) || vector.add(key, value) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<int32_t> KeyLayoutMap::compile() const {
+    std::vector<int32_t> words;
+    auto compileKey = [&words](const Key& key) {
+        words.push_back(key.keyCode);
+        words.push_back(static_cast<int32_t>(key.flags));
+    };
+    auto compileLed = [&words](const Led& led) { words.push_back(led.ledCode); };
+    compileVector(mKeysByScanCode, words, compileKey);
+    compileVector(mKeysByUsageCode, words, compileKey);
+    compileVector(mAxes, words, [&words](const AxisInfo& axis) {
+        words.push_back(axis.mode);
+        words.push_back(axis.axis);
+        words.push_back(axis.highAxis);
+        words.push_back(axis.splitValue);
+        words.push_back(axis.flatOverride);
+    });
+    compileVector(mLedsByScanCode, words, compileLed);
+    compileVector(mLedsByUsageCode, words, compileLed);
+    return words;
+}
+
+status_t KeyLayoutMap::readCompiled(InputConfigCache::Reader& reader) {
+    auto readKey = [&reader](Key* key) {
+        int32_t flags;
+        if (!reader.read(&key->keyCode) || !reader.read(&flags)) {
+            return false;
+        }
+        key->flags = static_cast<uint32_t>(flags);
+        return true;
+    };
+    auto readLed = [&reader](Led* led) { return reader.read(&led->ledCode); };
+    auto readAxis = [&reader](AxisInfo* axis) {
+        int32_t mode;
+        if (!reader.read(&mode) || mode < AxisInfo::MODE_NORMAL || mode > AxisInfo::MODE_SPLIT) {
+            return false;
+        }
+        axis->mode = static_cast<AxisInfo::Mode>(mode);
+        return reader.read(&axis->axis) && reader.read(&axis->highAxis) &&
+                reader.read(&axis->splitValue) && reader.read(&axis->flatOverride);
+    };
+    if (!readCompiledVector(reader, 2, mKeysByScanCode, readKey) ||
+        !readCompiledVector(reader, 2, mKeysByUsageCode, readKey) ||
+        !readCompiledVector(reader, 5, mAxes, readAxis) ||
+        !readCompiledVector(reader, 1, mLedsByScanCode, readLed) ||
+        !readCompiledVector(reader, 1, mLedsByUsageCode, readLed) || !reader.isAtEnd()) {
+        return BAD_VALUE;
+    }
+    return OK;
+}
+
 status_t KeyLayoutMap::findScanCodesForKey(
         int32_t keyCode, std::vector<int32_t>* outScanCodes) const {
     const size_t N = mKeysByScanCode.size();
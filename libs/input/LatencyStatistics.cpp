@@ -18,6 +18,7 @@
 
 #include <android-base/chrono_utils.h>
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
@@ -87,4 +88,68 @@ bool LatencyStatistics::shouldReport() {
     return mCount != 0 && timeSinceReport >= mReportPeriod;
 }
 
+// --- LatencyHistogram ---
+
+size_t LatencyHistogram::bucketIndex(int64_t micros) {
+    if (micros < static_cast<int64_t>(EXACT_BUCKETS)) {
+        return micros > 0 ? static_cast<size_t>(micros) : 0;
+    }
+    const uint64_t value = static_cast<uint64_t>(micros);
+    const uint32_t exponent = 63 - __builtin_clzll(value);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    const size_t subBucket =
+            (value >> (exponent - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+    return EXACT_BUCKETS + ((exponent - MIN_EXPONENT) << SUB_BUCKET_BITS) + subBucket;
+}
+
+int64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < EXACT_BUCKETS) {
+        return static_cast<int64_t>(index);
+    }
+    const size_t offset = index - EXACT_BUCKETS;
+    const uint32_t exponent = MIN_EXPONENT + (offset >> SUB_BUCKET_BITS);
+    const int64_t subBucket = offset & ((1 << SUB_BUCKET_BITS) - 1);
+    const int64_t width = int64_t(1) << (exponent - SUB_BUCKET_BITS);
+    return (int64_t(1) << exponent) + (subBucket + 1) * width - 1;
+}
+
+void LatencyHistogram::addValue(int64_t micros) {
+    mCounts[bucketIndex(micros)]++;
+    mCount++;
+    mMax = std::max(mMax, micros);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        mCounts[i] += other.mCounts[i];
+    }
+    mCount += other.mCount;
+    mMax = std::max(mMax, other.mMax);
+}
+
+void LatencyHistogram::reset() {
+    mCounts.fill(0);
+    mCount = 0;
+    mMax = 0;
+}
+
+int64_t LatencyHistogram::getPercentile(float percentile) const {
+    if (mCount == 0) {
+        return 0;
+    }
+    const float clamped = std::clamp(percentile, 0.0f, 100.0f);
+    const size_t rank = std::max<size_t>(1, std::ceil(clamped / 100.0f * mCount));
+    size_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += mCounts[i];
+        if (seen >= rank) {
+            // The top bucket also holds values past its range.
+            return i == BUCKET_COUNT - 1 ? mMax : std::min(bucketUpperBound(i), mMax);
+        }
+    }
+    return mMax;
+}
+
 } // namespace android
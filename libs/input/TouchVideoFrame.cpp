@@ -17,17 +17,27 @@
 #include <input/DisplayViewport.h>
 #include <input/TouchVideoFrame.h>
 
+#include <algorithm>
+
 namespace android {
 
 TouchVideoFrame::TouchVideoFrame(uint32_t height, uint32_t width, std::vector<int16_t> data,
         const struct timeval& timestamp) :
-         mHeight(height), mWidth(width),mData(std::move(data)), mTimestamp(timestamp) {
+         mHeight(height), mWidth(width), mTimestamp(timestamp) {
+    setData(std::move(data));
+}
+
+TouchVideoFrame::TouchVideoFrame(uint32_t height, uint32_t width,
+        std::shared_ptr<const int16_t> data, size_t size, const struct timeval& timestamp) :
+        mHeight(height), mWidth(width), mData(std::move(data)), mSize(size),
+        mTimestamp(timestamp) {
 }
 
 bool TouchVideoFrame::operator==(const TouchVideoFrame& rhs) const {
     return mHeight == rhs.mHeight
             && mWidth == rhs.mWidth
-            && mData == rhs.mData
+            && mSize == rhs.mSize
+            && std::equal(mData.get(), mData.get() + mSize, rhs.mData.get())
             && mTimestamp.tv_sec == rhs.mTimestamp.tv_sec
             && mTimestamp.tv_usec == rhs.mTimestamp.tv_usec;
 }
@@ -36,10 +46,20 @@ uint32_t TouchVideoFrame::getHeight() const { return mHeight; }
 
 uint32_t TouchVideoFrame::getWidth() const { return mWidth; }
 
-const std::vector<int16_t>& TouchVideoFrame::getData() const { return mData; }
+const int16_t* TouchVideoFrame::getData() const { return mData.get(); }
+
+size_t TouchVideoFrame::getSize() const { return mSize; }
 
 const struct timeval& TouchVideoFrame::getTimestamp() const { return mTimestamp; }
 
+void TouchVideoFrame::setData(std::vector<int16_t> data) {
+    // The vector lives in the control block, and mData aliases its contents.
+    std::shared_ptr<std::vector<int16_t>> storage =
+            std::make_shared<std::vector<int16_t>>(std::move(data));
+    mSize = storage->size();
+    mData = std::shared_ptr<const int16_t>(storage, storage->data());
+}
+
 void TouchVideoFrame::rotate(int32_t orientation) {
     switch (orientation) {
         case DISPLAY_ORIENTATION_90:
@@ -63,7 +83,8 @@ void TouchVideoFrame::rotate(int32_t orientation) {
  *     An element at position (i, j) is rotated to (width - j - 1, i)
  */
 void TouchVideoFrame::rotateQuarterTurn(bool clockwise) {
-    std::vector<int16_t> rotated(mData.size());
+    std::vector<int16_t> rotated(mSize);
+    const int16_t* data = mData.get();
     for (size_t i = 0; i < mHeight; i++) {
         for (size_t j = 0; j < mWidth; j++) {
             size_t iRotated, jRotated;
@@ -75,27 +96,26 @@ void TouchVideoFrame::rotateQuarterTurn(bool clockwise) {
                 jRotated = i;
             }
             size_t indexRotated = iRotated * mHeight + jRotated;
-            rotated[indexRotated] = mData[i * mWidth + j];
+            rotated[indexRotated] = data[i * mWidth + j];
         }
     }
-    mData = std::move(rotated);
+    setData(std::move(rotated));
     std::swap(mHeight, mWidth);
 }
 
 /**
  * An element at position (i, j) is rotated to (height - i - 1, width - j - 1)
- * This is equivalent to moving element [i] to position [height * width - i - 1]
- * Since element at [height * width - i - 1] would move to position [i],
- * we can just swap elements [i] and [height * width - i - 1].
+ * This is equivalent to moving element [i] to position [height * width - i - 1],
+ * so the rotated frame is the data in reverse order.
+ * The data may be shared with other frames, so it is reversed into a new buffer.
  */
 void TouchVideoFrame::rotate180() {
-    if (mData.size() == 0) {
+    if (mSize == 0) {
         return;
     }
-    // Just need to swap elements i and (height * width - 1 - i)
-    for (size_t i = 0; i < mData.size() / 2; i++) {
-        std::swap(mData[i], mData[mHeight * mWidth - 1 - i]);
-    }
+    std::vector<int16_t> rotated(mData.get(), mData.get() + mSize);
+    std::reverse(rotated.begin(), rotated.end());
+    setData(std::move(rotated));
 }
 
 } // namespace android
@@ -29,6 +29,12 @@
 #include <math.h>
 #include <optional>
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <android-base/stringprintf.h>
 #include <cutils/properties.h>
 #include <input/VelocityTracker.h>
@@ -47,21 +53,80 @@ static const nsecs_t NANOS_PER_MS = 1000000;
 static const nsecs_t ASSUME_POINTER_STOPPED_TIME = 40 * NANOS_PER_MS;
 
 
+// The least squares solver keeps its columns in fixed arrays padded with zeros to a multiple
+// of the vector width, so that the vector helpers below never need a scalar tail.
+static constexpr uint32_t VECTOR_WIDTH = 4;
+static constexpr uint32_t MAX_LEAST_SQUARES_SAMPLES = 20;
+static_assert(MAX_LEAST_SQUARES_SAMPLES % VECTOR_WIDTH == 0);
+
+static inline uint32_t paddedLength(uint32_t m) {
+    return (m + VECTOR_WIDTH - 1) & ~(VECTOR_WIDTH - 1);
+}
+
+// Dot product of two padded vectors of length m.
 static float vectorDot(const float* a, const float* b, uint32_t m) {
+#if defined(__aarch64__)
+    float32x4_t sum = vdupq_n_f32(0);
+    for (uint32_t i = 0; i < m; i += VECTOR_WIDTH) {
+        sum = vmlaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    return vaddvq_f32(sum);
+#elif defined(__SSE2__)
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t i = 0; i < m; i += VECTOR_WIDTH) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+    }
+    float lanes[VECTOR_WIDTH];
+    _mm_storeu_ps(lanes, sum);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
     float r = 0;
-    for (size_t i = 0; i < m; i++) {
-        r += *(a++) * *(b++);
+    for (uint32_t i = 0; i < m; i++) {
+        r += a[i] * b[i];
     }
     return r;
+#endif
 }
 
 static float vectorNorm(const float* a, uint32_t m) {
-    float r = 0;
-    for (size_t i = 0; i < m; i++) {
-        float t = *(a++);
-        r += t * t;
+    return sqrtf(vectorDot(a, a, m));
+}
+
+// a -= s * b, for padded vectors of length m.
+static void vectorSubtractScaled(float* a, const float* b, float s, uint32_t m) {
+#if defined(__aarch64__)
+    const float32x4_t vs = vdupq_n_f32(s);
+    for (uint32_t i = 0; i < m; i += VECTOR_WIDTH) {
+        vst1q_f32(a + i, vmlsq_f32(vld1q_f32(a + i), vs, vld1q_f32(b + i)));
     }
-    return sqrtf(r);
+#elif defined(__SSE2__)
+    const __m128 vs = _mm_set1_ps(s);
+    for (uint32_t i = 0; i < m; i += VECTOR_WIDTH) {
+        _mm_store_ps(a + i, _mm_sub_ps(_mm_load_ps(a + i), _mm_mul_ps(vs, _mm_load_ps(b + i))));
+    }
+#else
+    for (uint32_t i = 0; i < m; i++) {
+        a[i] -= s * b[i];
+    }
+#endif
+}
+
+// a *= s, for a padded vector of length m.
+static void vectorScale(float* a, float s, uint32_t m) {
+#if defined(__aarch64__)
+    for (uint32_t i = 0; i < m; i += VECTOR_WIDTH) {
+        vst1q_f32(a + i, vmulq_n_f32(vld1q_f32(a + i), s));
+    }
+#elif defined(__SSE2__)
+    const __m128 vs = _mm_set1_ps(s);
+    for (uint32_t i = 0; i < m; i += VECTOR_WIDTH) {
+        _mm_store_ps(a + i, _mm_mul_ps(_mm_load_ps(a + i), vs));
+    }
+#else
+    for (uint32_t i = 0; i < m; i++) {
+        a[i] *= s;
+    }
+#endif
 }
 
 #if DEBUG_STRATEGY || DEBUG_VELOCITY
@@ -79,29 +144,6 @@ static std::string vectorToString(const float* a, uint32_t m) {
 }
 #endif
 
-#if DEBUG_STRATEGY
-static std::string matrixToString(const float* a, uint32_t m, uint32_t n, bool rowMajor) {
-    std::string str;
-    str = "[";
-    for (size_t i = 0; i < m; i++) {
-        if (i) {
-            str += ",";
-        }
-        str += " [";
-        for (size_t j = 0; j < n; j++) {
-            if (j) {
-                str += ",";
-            }
-            str += android::base::StringPrintf(" %f", a[rowMajor ? i * n + j : j * m + i]);
-        }
-        str += " ]";
-    }
-    str += " ]";
-    return str;
-}
-#endif
-
-
 // --- VelocityTracker ---
 
 // The default velocity tracker strategy.
@@ -371,37 +413,47 @@ LeastSquaresVelocityTrackerStrategy::~LeastSquaresVelocityTrackerStrategy() {
 }
 
 void LeastSquaresVelocityTrackerStrategy::clear() {
-    mIndex = 0;
-    mMovements[0].idBits.clear();
+    mLastEventTime = 0;
+    mPointerIdBits.clear();
 }
 
 void LeastSquaresVelocityTrackerStrategy::clearPointers(BitSet32 idBits) {
-    BitSet32 remainingIdBits(mMovements[mIndex].idBits.value & ~idBits.value);
-    mMovements[mIndex].idBits = remainingIdBits;
+    // A cleared pointer's history is restarted when it shows up again.
+    mPointerIdBits.value &= ~idBits.value;
 }
 
 void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet32 idBits,
         const VelocityTracker::Position* positions) {
-    if (mMovements[mIndex].eventTime != eventTime) {
-        // When ACTION_POINTER_DOWN happens, we will first receive ACTION_MOVE with the coordinates
-        // of the existing pointers, and then ACTION_POINTER_DOWN with the coordinates that include
-        // the new pointer. If the eventtimes for both events are identical, just update the data
-        // for this time.
-        // We only compare against the last value, as it is likely that addMovement is called
-        // in chronological order as events occur.
-        mIndex++;
-    }
-    if (mIndex == HISTORY_SIZE) {
-        mIndex = 0;
-    }
+    // When ACTION_POINTER_DOWN happens, we will first receive ACTION_MOVE with the coordinates
+    // of the existing pointers, and then ACTION_POINTER_DOWN with the coordinates that include
+    // the new pointer. If the eventtimes for both events are identical, just update the data
+    // for this time.
+    // We only compare against the last value, as it is likely that addMovement is called
+    // in chronological order as events occur.
+    const bool replaceNewest = eventTime == mLastEventTime;
 
-    Movement& movement = mMovements[mIndex];
-    movement.eventTime = eventTime;
-    movement.idBits = idBits;
-    uint32_t count = idBits.count();
-    for (uint32_t i = 0; i < count; i++) {
-        movement.positions[i] = positions[i];
+    uint32_t index = 0;
+    for (BitSet32 remaining(idBits); !remaining.isEmpty(); index++) {
+        const uint32_t id = remaining.clearFirstMarkedBit();
+        PointerHistory& history = mHistory[id];
+        if (!mPointerIdBits.hasBit(id)) {
+            // The pointer was not in the previous movement, so its older samples are stale.
+            history.size = 0;
+            history.newest = HISTORY_SIZE - 1;
+        }
+        if (!replaceNewest || history.size == 0) {
+            history.newest = history.newest == HISTORY_SIZE - 1 ? 0 : history.newest + 1;
+            if (history.size < HISTORY_SIZE) {
+                history.size++;
+            }
+        }
+        history.eventTime[history.newest] = eventTime;
+        history.x[history.newest] = positions[index].x;
+        history.y[history.newest] = positions[index].y;
     }
+
+    mLastEventTime = eventTime;
+    mPointerIdBits = idBits;
 }
 
 /**
@@ -450,44 +502,59 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet3
  * For efficiency, we lay out A and Q column-wise in memory because we frequently
  * operate on the column vectors.  Conversely, we lay out R row-wise.
  *
+ * Q and R only depend on X and W, so the decomposition is computed once by
+ * decomposeLeastSquares() and reused by solveDecomposedLeastSquares() for each Y
+ * (both axes of a pointer).  The columns are zero padded to the vector width and
+ * processed with the vector helpers above.
+ *
  * http://en.wikipedia.org/wiki/Numerical_methods_for_linear_least_squares
  * http://en.wikipedia.org/wiki/Gram-Schmidt
  */
-static bool solveLeastSquares(const float* x, const float* y,
-        const float* w, uint32_t m, uint32_t n, float* outB, float* outDet) {
+struct LeastSquaresDecomposition {
+    uint32_t m;       // number of samples
+    uint32_t paddedM; // m rounded up to the vector width
+    uint32_t n;       // number of coefficients
+    // orthonormal basis, column-major order
+    alignas(16) float q[VelocityTracker::Estimator::MAX_DEGREE + 1][MAX_LEAST_SQUARES_SAMPLES];
+    // upper triangular matrix, row-major order
+    float r[VelocityTracker::Estimator::MAX_DEGREE + 1][VelocityTracker::Estimator::MAX_DEGREE + 1];
+};
+
+static bool decomposeLeastSquares(const float* x, const float* w, uint32_t m, uint32_t n,
+        LeastSquaresDecomposition* outQr) {
 #if DEBUG_STRATEGY
-    ALOGD("solveLeastSquares: m=%d, n=%d, x=%s, y=%s, w=%s", int(m), int(n),
-            vectorToString(x, m).c_str(), vectorToString(y, m).c_str(),
-            vectorToString(w, m).c_str());
+    ALOGD("decomposeLeastSquares: m=%d, n=%d, x=%s, w=%s", int(m), int(n),
+            vectorToString(x, m).c_str(), vectorToString(w, m).c_str());
 #endif
+    const uint32_t paddedM = paddedLength(m);
+    outQr->m = m;
+    outQr->paddedM = paddedM;
+    outQr->n = n;
 
     // Expand the X vector to a matrix A, pre-multiplied by the weights.
-    float a[n][m]; // column-major order
+    alignas(16) float a[VelocityTracker::Estimator::MAX_DEGREE + 1][MAX_LEAST_SQUARES_SAMPLES];
     for (uint32_t h = 0; h < m; h++) {
         a[0][h] = w[h];
         for (uint32_t i = 1; i < n; i++) {
             a[i][h] = a[i - 1][h] * x[h];
         }
     }
-#if DEBUG_STRATEGY
-    ALOGD("  - a=%s", matrixToString(&a[0][0], m, n, false /*rowMajor*/).c_str());
-#endif
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t h = m; h < paddedM; h++) {
+            a[i][h] = 0;
+        }
+    }
 
     // Apply the Gram-Schmidt process to A to obtain its QR decomposition.
-    float q[n][m]; // orthonormal basis, column-major order
-    float r[n][n]; // upper triangular matrix, row-major order
+    float (&q)[VelocityTracker::Estimator::MAX_DEGREE + 1][MAX_LEAST_SQUARES_SAMPLES] = outQr->q;
     for (uint32_t j = 0; j < n; j++) {
-        for (uint32_t h = 0; h < m; h++) {
-            q[j][h] = a[j][h];
-        }
+        memcpy(&q[j][0], &a[j][0], paddedM * sizeof(float));
         for (uint32_t i = 0; i < j; i++) {
-            float dot = vectorDot(&q[j][0], &q[i][0], m);
-            for (uint32_t h = 0; h < m; h++) {
-                q[j][h] -= dot * q[i][h];
-            }
+            float dot = vectorDot(&q[j][0], &q[i][0], paddedM);
+            vectorSubtractScaled(&q[j][0], &q[i][0], dot, paddedM);
         }
 
-        float norm = vectorNorm(&q[j][0], m);
+        float norm = vectorNorm(&q[j][0], paddedM);
         if (norm < 0.000001f) {
             // vectors are linearly dependent or zero so no solution
 #if DEBUG_STRATEGY
@@ -496,47 +563,45 @@ static bool solveLeastSquares(const float* x, const float* y,
             return false;
         }
 
-        float invNorm = 1.0f / norm;
-        for (uint32_t h = 0; h < m; h++) {
-            q[j][h] *= invNorm;
-        }
+        vectorScale(&q[j][0], 1.0f / norm, paddedM);
         for (uint32_t i = 0; i < n; i++) {
-            r[j][i] = i < j ? 0 : vectorDot(&q[j][0], &a[i][0], m);
+            outQr->r[j][i] = i < j ? 0 : vectorDot(&q[j][0], &a[i][0], paddedM);
         }
     }
 #if DEBUG_STRATEGY
-    ALOGD("  - q=%s", matrixToString(&q[0][0], m, n, false /*rowMajor*/).c_str());
-    ALOGD("  - r=%s", matrixToString(&r[0][0], n, n, true /*rowMajor*/).c_str());
-
-    // calculate QR, if we factored A correctly then QR should equal A
-    float qr[n][m];
-    for (uint32_t h = 0; h < m; h++) {
-        for (uint32_t i = 0; i < n; i++) {
-            qr[i][h] = 0;
-            for (uint32_t j = 0; j < n; j++) {
-                qr[i][h] += q[j][h] * r[j][i];
-            }
-        }
+    for (uint32_t j = 0; j < n; j++) {
+        ALOGD("  - q[%d]=%s, r[%d]=%s", int(j), vectorToString(&q[j][0], m).c_str(), int(j),
+                vectorToString(&outQr->r[j][0], n).c_str());
     }
-    ALOGD("  - qr=%s", matrixToString(&qr[0][0], m, n, false /*rowMajor*/).c_str());
 #endif
+    return true;
+}
+
+static void solveDecomposedLeastSquares(const LeastSquaresDecomposition& qr, const float* x,
+        const float* y, const float* w, float* outB, float* outDet) {
+    const uint32_t m = qr.m;
+    const uint32_t n = qr.n;
 
     // Solve R B = Qt W Y to find B.  This is easy because R is upper triangular.
     // We just work from bottom-right to top-left calculating B's coefficients.
-    float wy[m];
+    alignas(16) float wy[MAX_LEAST_SQUARES_SAMPLES];
     for (uint32_t h = 0; h < m; h++) {
         wy[h] = y[h] * w[h];
     }
+    for (uint32_t h = m; h < qr.paddedM; h++) {
+        wy[h] = 0;
+    }
     for (uint32_t i = n; i != 0; ) {
         i--;
-        outB[i] = vectorDot(&q[i][0], wy, m);
+        outB[i] = vectorDot(&qr.q[i][0], wy, qr.paddedM);
         for (uint32_t j = n - 1; j > i; j--) {
-            outB[i] -= r[i][j] * outB[j];
+            outB[i] -= qr.r[i][j] * outB[j];
         }
-        outB[i] /= r[i][i];
+        outB[i] /= qr.r[i][i];
     }
 #if DEBUG_STRATEGY
-    ALOGD("  - b=%s", vectorToString(outB, n).c_str());
+    ALOGD("solveDecomposedLeastSquares: y=%s, b=%s", vectorToString(y, m).c_str(),
+            vectorToString(outB, n).c_str());
 #endif
 
     // Calculate the coefficient of determination as 1 - (SSerr / SStot) where
@@ -568,7 +633,6 @@ static bool solveLeastSquares(const float* x, const float* y,
     ALOGD("  - sstot=%f", sstot);
     ALOGD("  - det=%f", *outDet);
 #endif
-    return true;
 }
 
 /*
@@ -627,36 +691,32 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
         VelocityTracker::Estimator* outEstimator) const {
     outEstimator->clear();
 
-    // Iterate over movement samples in reverse time order and collect samples.
+    if (!mPointerIdBits.hasBit(id)) {
+        return false; // no data
+    }
+
+    // Iterate over the pointer's samples in reverse time order and collect samples.
+    static_assert(HISTORY_SIZE <= MAX_LEAST_SQUARES_SAMPLES);
+    const PointerHistory& history = mHistory[id];
+    const nsecs_t newestEventTime = history.eventTime[history.newest];
     float x[HISTORY_SIZE];
     float y[HISTORY_SIZE];
     float w[HISTORY_SIZE];
     float time[HISTORY_SIZE];
     uint32_t m = 0;
-    uint32_t index = mIndex;
-    const Movement& newestMovement = mMovements[mIndex];
+    uint32_t index = history.newest;
     do {
-        const Movement& movement = mMovements[index];
-        if (!movement.idBits.hasBit(id)) {
-            break;
-        }
-
-        nsecs_t age = newestMovement.eventTime - movement.eventTime;
+        nsecs_t age = newestEventTime - history.eventTime[index];
         if (age > HORIZON) {
             break;
         }
 
-        const VelocityTracker::Position& position = movement.getPosition(id);
-        x[m] = position.x;
-        y[m] = position.y;
-        w[m] = chooseWeight(index);
+        x[m] = history.x[index];
+        y[m] = history.y[index];
+        w[m] = chooseWeight(history, index);
         time[m] = -age * 0.000000001f;
         index = (index == 0 ? HISTORY_SIZE : index) - 1;
-    } while (++m < HISTORY_SIZE);
-
-    if (m == 0) {
-        return false; // no data
-    }
+    } while (++m < history.size);
 
     // Calculate a least squares polynomial fit.
     uint32_t degree = mDegree;
@@ -669,7 +729,7 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
         std::optional<std::array<float, 3>> xCoeff = solveUnweightedLeastSquaresDeg2(time, x, m);
         std::optional<std::array<float, 3>> yCoeff = solveUnweightedLeastSquaresDeg2(time, y, m);
         if (xCoeff && yCoeff) {
-            outEstimator->time = newestMovement.eventTime;
+            outEstimator->time = newestEventTime;
             outEstimator->degree = 2;
             outEstimator->confidence = 1;
             for (size_t i = 0; i <= outEstimator->degree; i++) {
@@ -679,12 +739,15 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
             return true;
         }
     } else if (degree >= 1) {
-        // General case for an Nth degree polynomial fit
+        // General case for an Nth degree polynomial fit. Both axes share the sample
+        // times and weights, so they share one decomposition.
         float xdet, ydet;
         uint32_t n = degree + 1;
-        if (solveLeastSquares(time, x, w, m, n, outEstimator->xCoeff, &xdet)
-                && solveLeastSquares(time, y, w, m, n, outEstimator->yCoeff, &ydet)) {
-            outEstimator->time = newestMovement.eventTime;
+        LeastSquaresDecomposition qr;
+        if (decomposeLeastSquares(time, w, m, n, &qr)) {
+            solveDecomposedLeastSquares(qr, time, x, w, outEstimator->xCoeff, &xdet);
+            solveDecomposedLeastSquares(qr, time, y, w, outEstimator->yCoeff, &ydet);
+            outEstimator->time = newestEventTime;
             outEstimator->degree = degree;
             outEstimator->confidence = xdet * ydet;
 #if DEBUG_STRATEGY
@@ -701,24 +764,25 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
     // No velocity data available for this pointer, but we do have its current position.
     outEstimator->xCoeff[0] = x[0];
     outEstimator->yCoeff[0] = y[0];
-    outEstimator->time = newestMovement.eventTime;
+    outEstimator->time = newestEventTime;
     outEstimator->degree = 0;
     outEstimator->confidence = 1;
     return true;
 }
 
-float LeastSquaresVelocityTrackerStrategy::chooseWeight(uint32_t index) const {
+float LeastSquaresVelocityTrackerStrategy::chooseWeight(const PointerHistory& history,
+        uint32_t index) const {
     switch (mWeighting) {
     case WEIGHTING_DELTA: {
         // Weight points based on how much time elapsed between them and the next
         // point so that points that "cover" a shorter time span are weighed less.
         //   delta  0ms: 0.5
         //   delta 10ms: 1.0
-        if (index == mIndex) {
+        if (index == history.newest) {
             return 1.0f;
         }
         uint32_t nextIndex = (index + 1) % HISTORY_SIZE;
-        float deltaMillis = (mMovements[nextIndex].eventTime- mMovements[index].eventTime)
+        float deltaMillis = (history.eventTime[nextIndex] - history.eventTime[index])
                 * 0.000001f;
         if (deltaMillis < 0) {
             return 0.5f;
@@ -735,7 +799,7 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(uint32_t index) const {
         //   age 10ms: 1.0
         //   age 50ms: 1.0
         //   age 60ms: 0.5
-        float ageMillis = (mMovements[mIndex].eventTime - mMovements[index].eventTime)
+        float ageMillis = (history.eventTime[history.newest] - history.eventTime[index])
                 * 0.000001f;
         if (ageMillis < 0) {
             return 0.5f;
@@ -757,7 +821,7 @@ float LeastSquaresVelocityTrackerStrategy::chooseWeight(uint32_t index) const {
         //   age   0ms: 1.0
         //   age  50ms: 1.0
         //   age 100ms: 0.5
-        float ageMillis = (mMovements[mIndex].eventTime - mMovements[index].eventTime)
+        float ageMillis = (history.eventTime[history.newest] - history.eventTime[index])
                 * 0.000001f;
         if (ageMillis < 50) {
             return 1.0f;
@@ -21,6 +21,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <poll.h>
 
 #include <binder/Binder.h>
 #include <gtest/gtest.h>
@@ -197,5 +198,69 @@ TEST_F(InputChannelTest, SendAndReceive_MotionClassification) {
     }
 }
 
+TEST_F(InputChannelTest, SharedMemoryTransport_SendsMessagesInOrderInBothDirections) {
+    sp<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name", serverChannel,
+            clientChannel, InputChannel::Transport::SHARED_MEMORY);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+    ASSERT_EQ(InputChannel::Transport::SHARED_MEMORY, serverChannel->getTransport());
+    ASSERT_EQ(InputChannel::Transport::SHARED_MEMORY, clientChannel->getTransport());
+
+    InputMessage msg;
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&msg));
+
+    // Fill the ring until the publisher is told to back off.
+    InputMessage serverMsg = {};
+    serverMsg.header.type = InputMessage::Type::MOTION;
+    serverMsg.body.motion.pointerCount = 1;
+    uint32_t sent = 0;
+    while (sent < 1000) {
+        serverMsg.body.motion.seq = sent + 1;
+        status_t status = serverChannel->sendMessage(&serverMsg);
+        if (status == WOULD_BLOCK) break;
+        ASSERT_EQ(OK, status);
+        sent++;
+    }
+    ASSERT_GT(sent, 1u);
+    ASSERT_LT(sent, 1000u) << "a full ring should return WOULD_BLOCK";
+
+    // The consumer was waiting, so the first message made the socket readable.
+    struct pollfd pfd = {.fd = clientChannel->getFd(), .events = POLLIN};
+    EXPECT_EQ(1, poll(&pfd, 1, 0));
+
+    for (uint32_t seq = 1; seq <= sent; seq++) {
+        ASSERT_EQ(OK, clientChannel->receiveMessage(&msg));
+        EXPECT_EQ(InputMessage::Type::MOTION, msg.header.type);
+        EXPECT_EQ(seq, msg.body.motion.seq);
+    }
+    EXPECT_EQ(WOULD_BLOCK, clientChannel->receiveMessage(&msg));
+    EXPECT_EQ(0, poll(&pfd, 1, 0)) << "draining the ring should consume the wakeup";
+
+    // Finished signals come back through the other ring.
+    InputMessage clientReply = {};
+    clientReply.header.type = InputMessage::Type::FINISHED;
+    clientReply.body.finished.seq = 7;
+    clientReply.body.finished.handled = true;
+    ASSERT_EQ(OK, clientChannel->sendMessage(&clientReply));
+
+    ASSERT_EQ(OK, serverChannel->receiveMessage(&msg));
+    EXPECT_EQ(InputMessage::Type::FINISHED, msg.header.type);
+    EXPECT_EQ(7u, msg.body.finished.seq);
+    EXPECT_TRUE(msg.body.finished.handled);
+    EXPECT_EQ(WOULD_BLOCK, serverChannel->receiveMessage(&msg));
+}
+
+TEST_F(InputChannelTest, SharedMemoryTransport_WhenPeerClosed_ReturnsAnError) {
+    sp<InputChannel> serverChannel, clientChannel;
+    status_t result = InputChannel::openInputChannelPair("channel name", serverChannel,
+            clientChannel, InputChannel::Transport::SHARED_MEMORY);
+    ASSERT_EQ(OK, result) << "should have successfully opened a channel pair";
+
+    serverChannel.clear(); // close server channel
+
+    InputMessage msg;
+    EXPECT_EQ(DEAD_OBJECT, clientChannel->receiveMessage(&msg))
+            << "receiveMessage should have returned DEAD_OBJECT";
+}
 
 } // namespace android
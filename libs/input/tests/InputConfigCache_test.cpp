@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <android/keycodes.h>
+#include <gtest/gtest.h>
+#include <input/InputConfigCache.h>
+#include <input/KeyCharacterMap.h>
+#include <input/KeyLayoutMap.h>
+
+namespace android {
+
+static const char* KEY_LAYOUT = "key 30 A\n"
+                                "key 48 B WAKE\n"
+                                "key usage 0x0c0067 C\n"
+                                "axis 0x00 X\n"
+                                "axis 0x01 split 0x7f LTRIGGER RTRIGGER\n"
+                                "led 0x00 NUM_LOCK\n";
+
+static const char* KEY_CHARACTER_MAP = "type FULL\n"
+                                       "map key 30 A\n"
+                                       "key A {\n"
+                                       "    label: 'A'\n"
+                                       "    base: 'a'\n"
+                                       "    shift, capslock: 'A'\n"
+                                       "}\n";
+
+class InputConfigCacheTest : public testing::Test {
+protected:
+    TemporaryDir mSourceDir;
+    TemporaryDir mCacheDir;
+
+    void SetUp() override { InputConfigCache::setDirectory(mCacheDir.path); }
+    void TearDown() override { InputConfigCache::setDirectory(""); }
+
+    std::string writeSource(const char* name, const char* contents) {
+        std::string path = std::string(mSourceDir.path) + "/" + name;
+        EXPECT_TRUE(android::base::WriteStringToFile(contents, path));
+        return path;
+    }
+};
+
+TEST_F(InputConfigCacheTest, StoreThenFind_ReturnsWords) {
+    const std::string path = writeSource("test.kl", KEY_LAYOUT);
+    InputConfigCache::Source source;
+    ASSERT_EQ(nullptr, InputConfigCache::find(path, InputConfigCache::Kind::KEY_LAYOUT, &source));
+    ASSERT_TRUE(source.valid);
+
+    InputConfigCache::store(source, InputConfigCache::Kind::KEY_LAYOUT, {1, 2, 3});
+    std::unique_ptr<InputConfigCache::Entry> entry =
+            InputConfigCache::find(path, InputConfigCache::Kind::KEY_LAYOUT, &source);
+    ASSERT_NE(nullptr, entry);
+    ASSERT_EQ(3u, entry->getWordCount());
+    ASSERT_EQ(1, entry->getWords()[0]);
+    ASSERT_EQ(3, entry->getWords()[2]);
+
+    // Kinds are cached separately.
+    ASSERT_EQ(nullptr,
+              InputConfigCache::find(path, InputConfigCache::Kind::KEY_CHARACTER_MAP, &source));
+}
+
+TEST_F(InputConfigCacheTest, SourceChanged_Misses) {
+    const std::string path = writeSource("test.kl", KEY_LAYOUT);
+    InputConfigCache::Source source;
+    InputConfigCache::find(path, InputConfigCache::Kind::KEY_LAYOUT, &source);
+    InputConfigCache::store(source, InputConfigCache::Kind::KEY_LAYOUT, {1});
+
+    // Same length, so only the content hash tells the files apart.
+    std::string contents = KEY_LAYOUT;
+    contents[7] = 'Z';
+    writeSource("test.kl", contents.c_str());
+    ASSERT_EQ(nullptr, InputConfigCache::find(path, InputConfigCache::Kind::KEY_LAYOUT, &source));
+}
+
+TEST_F(InputConfigCacheTest, Disabled_SourceNotValid) {
+    const std::string path = writeSource("test.kl", KEY_LAYOUT);
+    InputConfigCache::setDirectory("");
+    InputConfigCache::Source source;
+    ASSERT_EQ(nullptr, InputConfigCache::find(path, InputConfigCache::Kind::KEY_LAYOUT, &source));
+    ASSERT_FALSE(source.valid);
+}
+
+TEST_F(InputConfigCacheTest, Reader_ReadCountBounded) {
+    const std::string path = writeSource("test.kl", KEY_LAYOUT);
+    InputConfigCache::Source source;
+    InputConfigCache::find(path, InputConfigCache::Kind::KEY_LAYOUT, &source);
+    InputConfigCache::store(source, InputConfigCache::Kind::KEY_LAYOUT, {2, 7, 8, 9});
+    std::unique_ptr<InputConfigCache::Entry> entry =
+            InputConfigCache::find(path, InputConfigCache::Kind::KEY_LAYOUT, &source);
+    ASSERT_NE(nullptr, entry);
+
+    InputConfigCache::Reader reader(*entry);
+    size_t count;
+    ASSERT_FALSE(reader.readCount(2, &count));
+
+    InputConfigCache::Reader reader2(*entry);
+    ASSERT_TRUE(reader2.readCount(1, &count));
+    ASSERT_EQ(2u, count);
+}
+
+TEST_F(InputConfigCacheTest, KeyLayoutMap_LoadedFromCacheMatchesParsed) {
+    const std::string path = writeSource("test.kl", KEY_LAYOUT);
+    sp<KeyLayoutMap> parsed;
+    ASSERT_EQ(OK, KeyLayoutMap::load(path, &parsed));
+    InputConfigCache::Source source;
+    ASSERT_NE(nullptr, InputConfigCache::find(path, InputConfigCache::Kind::KEY_LAYOUT, &source));
+
+    sp<KeyLayoutMap> cached;
+    ASSERT_EQ(OK, KeyLayoutMap::load(path, &cached));
+    ASSERT_NE(parsed.get(), cached.get());
+
+    int32_t keyCode;
+    uint32_t flags;
+    ASSERT_EQ(OK, cached->mapKey(48, 0, &keyCode, &flags));
+    ASSERT_EQ(AKEYCODE_B, keyCode);
+    ASSERT_EQ(static_cast<uint32_t>(POLICY_FLAG_WAKE), flags);
+    ASSERT_EQ(OK, cached->mapKey(0, 0x0c0067, &keyCode, &flags));
+    ASSERT_EQ(AKEYCODE_C, keyCode);
+
+    AxisInfo axis;
+    ASSERT_EQ(OK, cached->mapAxis(0x01, &axis));
+    ASSERT_EQ(AxisInfo::MODE_SPLIT, axis.mode);
+    ASSERT_EQ(0x7f, axis.splitValue);
+    ASSERT_EQ(AMOTION_EVENT_AXIS_LTRIGGER, axis.axis);
+    ASSERT_EQ(AMOTION_EVENT_AXIS_RTRIGGER, axis.highAxis);
+
+    int32_t scanCode;
+    ASSERT_EQ(OK, cached->findScanCodeForLed(ALED_NUM_LOCK, &scanCode));
+    ASSERT_EQ(0x00, scanCode);
+}
+
+TEST_F(InputConfigCacheTest, KeyCharacterMap_LoadedFromCacheMatchesParsed) {
+    const std::string path = writeSource("test.kcm", KEY_CHARACTER_MAP);
+    sp<KeyCharacterMap> parsed;
+    ASSERT_EQ(OK, KeyCharacterMap::load(path, KeyCharacterMap::FORMAT_BASE, &parsed));
+    InputConfigCache::Source source;
+    ASSERT_NE(nullptr,
+              InputConfigCache::find(path, InputConfigCache::Kind::KEY_CHARACTER_MAP, &source));
+
+    sp<KeyCharacterMap> cached;
+    ASSERT_EQ(OK, KeyCharacterMap::load(path, KeyCharacterMap::FORMAT_BASE, &cached));
+    ASSERT_NE(parsed.get(), cached.get());
+    ASSERT_EQ(KeyCharacterMap::KEYBOARD_TYPE_FULL, cached->getKeyboardType());
+    ASSERT_EQ(u'A', cached->getDisplayLabel(AKEYCODE_A));
+    ASSERT_EQ(u'a', cached->getCharacter(AKEYCODE_A, 0));
+    ASSERT_EQ(u'A', cached->getCharacter(AKEYCODE_A, AMETA_SHIFT_ON));
+
+    int32_t keyCode;
+    ASSERT_EQ(OK, cached->mapKey(30, 0, &keyCode));
+    ASSERT_EQ(AKEYCODE_A, keyCode);
+
+    // The cached map is not an overlay, so the parser rejects it as it did before.
+    sp<KeyCharacterMap> overlay;
+    ASSERT_NE(OK, KeyCharacterMap::load(path, KeyCharacterMap::FORMAT_OVERLAY, &overlay));
+}
+
+} // namespace android
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/InputTransport.h>
+
+namespace android {
+
+static constexpr nsecs_t NANOS_PER_MS = 1000000;
+
+// Matches RESAMPLE_LATENCY in InputTransport.cpp.
+static constexpr nsecs_t RESAMPLE_LATENCY = 5 * NANOS_PER_MS;
+
+// A 240Hz touch panel.
+static constexpr nsecs_t SAMPLE_INTERVAL = 4 * NANOS_PER_MS;
+
+static const std::array<uint8_t, 32> HMAC = {};
+
+struct Touch {
+    PointerProperties properties[MAX_POINTERS];
+    PointerCoords coords[MAX_POINTERS];
+
+    explicit Touch(size_t pointerCount) {
+        for (size_t i = 0; i < pointerCount; i++) {
+            properties[i].clear();
+            properties[i].id = i;
+            properties[i].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+            coords[i].clear();
+            coords[i].setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, 1.0f);
+        }
+    }
+
+    void moveTo(size_t pointerCount, nsecs_t eventTime) {
+        for (size_t i = 0; i < pointerCount; i++) {
+            const float offset = float(eventTime / NANOS_PER_MS);
+            coords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 100 + i * 50 + offset);
+            coords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 200 + i * 30 + offset);
+        }
+    }
+};
+
+static status_t publish(InputPublisher& publisher, uint32_t seq, int32_t action,
+                        nsecs_t eventTime, size_t pointerCount, const Touch& touch) {
+    return publisher.publishMotionEvent(seq, InputEvent::nextId(), 1 /*deviceId*/,
+                                        AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT, HMAC,
+                                        action, 0 /*actionButton*/, 0 /*flags*/, 0 /*edgeFlags*/,
+                                        0 /*metaState*/, 0 /*buttonState*/,
+                                        MotionClassification::NONE, 1 /*xScale*/, 1 /*yScale*/,
+                                        0 /*xOffset*/, 0 /*yOffset*/, 0 /*xPrecision*/,
+                                        0 /*yPrecision*/, AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                        AMOTION_EVENT_INVALID_CURSOR_POSITION, 0 /*downTime*/,
+                                        eventTime, pointerCount, touch.properties, touch.coords);
+}
+
+static void drainFinishedSignals(InputPublisher& publisher) {
+    uint32_t seq;
+    bool handled;
+    while (publisher.receiveFinishedSignal(&seq, &handled) == OK) {
+    }
+}
+
+// Each iteration publishes one MOVE sample and consumes the batch at a frame time that falls
+// between the previous sample and this one, so every frame is resampled by interpolation,
+// as an app drawing at 60Hz from a 240Hz panel would see.
+static void BM_ConsumeResampledBatch(benchmark::State& state) {
+    const size_t pointerCount = state.range(0);
+    sp<InputChannel> serverChannel, clientChannel;
+    if (InputChannel::openInputChannelPair("benchmark", serverChannel, clientChannel) != OK) {
+        state.SkipWithError("could not open an input channel pair");
+        return;
+    }
+    InputPublisher publisher(serverChannel);
+    InputConsumer consumer(clientChannel);
+    PreallocatedInputEventFactory factory;
+    Touch touch(pointerCount);
+
+    uint32_t seq = 1;
+    nsecs_t eventTime = SAMPLE_INTERVAL;
+    touch.moveTo(pointerCount, eventTime);
+    publish(publisher, seq++, AMOTION_EVENT_ACTION_DOWN, eventTime, pointerCount, touch);
+
+    for (auto _ : state) {
+        eventTime += SAMPLE_INTERVAL;
+        touch.moveTo(pointerCount, eventTime);
+        if (publish(publisher, seq++, AMOTION_EVENT_ACTION_MOVE, eventTime, pointerCount, touch) !=
+            OK) {
+            state.SkipWithError("could not publish a motion event");
+            break;
+        }
+
+        const nsecs_t frameTime = eventTime - SAMPLE_INTERVAL / 2 + RESAMPLE_LATENCY;
+        uint32_t consumeSeq;
+        InputEvent* event;
+        while (consumer.consume(&factory, true /*consumeBatches*/, frameTime, &consumeSeq,
+                                &event) == OK) {
+            benchmark::DoNotOptimize(event);
+            consumer.sendFinishedSignal(consumeSeq, true);
+        }
+        drainFinishedSignals(publisher);
+    }
+}
+BENCHMARK(BM_ConsumeResampledBatch)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -394,4 +394,55 @@ TEST_F(InputPublisherAndConsumerTest, PublishMultipleEvents_EndToEnd) {
     ASSERT_NO_FATAL_FAILURE(PublishAndConsumeKeyEvent());
 }
 
+TEST_F(InputPublisherAndConsumerTest, ConsumeBatch_InterpolatesEveryPointer) {
+    // Enough pointers to cover both the vector and the scalar resampling lanes.
+    constexpr size_t pointerCount = 5;
+    constexpr nsecs_t ms = 1000000;
+    PointerProperties pointerProperties[pointerCount];
+    PointerCoords pointerCoords[pointerCount];
+    for (size_t i = 0; i < pointerCount; i++) {
+        pointerProperties[i].clear();
+        pointerProperties[i].id = i;
+        pointerProperties[i].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+        pointerCoords[i].clear();
+    }
+
+    auto publishAt = [&](uint32_t seq, int32_t action, nsecs_t eventTime, float offset) {
+        for (size_t i = 0; i < pointerCount; i++) {
+            pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, 100 * i + offset);
+            pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, 200 * i - offset);
+        }
+        return mPublisher->publishMotionEvent(seq, InputEvent::nextId(), 1 /*deviceId*/,
+                                              AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                                              INVALID_HMAC, action, 0, 0, 0, 0, 0,
+                                              MotionClassification::NONE, 1 /* xScale */,
+                                              1 /* yScale */, 0, 0, 0, 0,
+                                              AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                                              AMOTION_EVENT_INVALID_CURSOR_POSITION, 0, eventTime,
+                                              pointerCount, pointerProperties, pointerCoords);
+    };
+
+    ASSERT_EQ(OK, publishAt(1, AMOTION_EVENT_ACTION_DOWN, 0, 0));
+    uint32_t seq;
+    InputEvent* event;
+    ASSERT_EQ(OK, mConsumer->consume(&mEventFactory, true /*consumeBatches*/, -1, &seq, &event));
+
+    ASSERT_EQ(OK, publishAt(2, AMOTION_EVENT_ACTION_MOVE, 10 * ms, 10));
+    ASSERT_EQ(OK, publishAt(3, AMOTION_EVENT_ACTION_MOVE, 20 * ms, 20));
+
+    // With the 5ms resampling latency, a 20ms frame samples at 15ms: halfway between the moves.
+    ASSERT_EQ(OK, mConsumer->consume(&mEventFactory, true /*consumeBatches*/, 20 * ms, &seq,
+                                     &event));
+    ASSERT_EQ(AINPUT_EVENT_TYPE_MOTION, event->getType());
+    MotionEvent* motionEvent = static_cast<MotionEvent*>(event);
+    if (motionEvent->getHistorySize() == 0) {
+        GTEST_SKIP() << "touch resampling is disabled on this device";
+    }
+    EXPECT_EQ(15 * ms, motionEvent->getEventTime());
+    for (size_t i = 0; i < pointerCount; i++) {
+        EXPECT_FLOAT_EQ(100 * i + 15, motionEvent->getX(i)) << "pointer " << i;
+        EXPECT_FLOAT_EQ(200 * i - 15.0f, motionEvent->getY(i)) << "pointer " << i;
+    }
+}
+
 } // namespace android
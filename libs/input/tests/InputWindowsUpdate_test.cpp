@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <binder/Binder.h>
+#include <binder/Parcel.h>
+
+#include <input/InputWindowsUpdate.h>
+
+namespace android {
+namespace test {
+
+static InputWindowInfo createWindow(int32_t id, int32_t displayId) {
+    InputWindowInfo info;
+    info.token = new BBinder();
+    info.id = id;
+    info.name = "Window " + std::to_string(id);
+    info.displayId = displayId;
+    info.frameRight = 100;
+    info.frameBottom = 100;
+    info.addTouchableRegion(Rect(0, 0, 100, 100));
+    return info;
+}
+
+// Sends the update through a parcel, the way it reaches inputflinger.
+static InputWindowsUpdate parcel(const InputWindowsUpdate& update) {
+    Parcel p;
+    EXPECT_EQ(OK, update.write(p));
+    p.setDataPosition(0);
+    InputWindowsUpdate result;
+    EXPECT_EQ(OK, result.read(p));
+    return result;
+}
+
+TEST(InputWindowsUpdate, FirstUpdateIsFullSync) {
+    InputWindowsUpdateWriter writer;
+    InputWindowsUpdate update = writer.update({createWindow(1, 0), createWindow(2, 0)});
+
+    ASSERT_TRUE(update.fullSync);
+    ASSERT_EQ(2u, update.changed.size());
+    ASSERT_EQ((std::vector<int32_t>{1, 2}), update.order);
+}
+
+TEST(InputWindowsUpdate, OnlyChangedWindowsSent) {
+    std::vector<InputWindowInfo> windows = {createWindow(1, 0), createWindow(2, 0),
+                                            createWindow(3, 1)};
+    InputWindowsUpdateWriter writer;
+    InputWindowsState state;
+    std::unordered_set<int32_t> changedDisplays;
+    ASSERT_TRUE(state.apply(parcel(writer.update(windows)), &changedDisplays));
+
+    windows[1].frameLeft = 10;
+    InputWindowsUpdate update = parcel(writer.update(windows));
+    ASSERT_FALSE(update.fullSync);
+    ASSERT_FALSE(update.orderChanged);
+    ASSERT_EQ(1u, update.changed.size());
+    ASSERT_EQ(2, update.changed[0].id);
+    ASSERT_TRUE(update.removed.empty());
+
+    changedDisplays.clear();
+    ASSERT_TRUE(state.apply(update, &changedDisplays));
+    ASSERT_EQ((std::unordered_set<int32_t>{0}), changedDisplays);
+    ASSERT_EQ(10, state.getWindow(2)->frameLeft);
+    ASSERT_EQ(windows[1], *state.getWindow(2));
+
+    // Nothing changed.
+    update = writer.update(windows);
+    ASSERT_TRUE(update.isEmpty());
+    changedDisplays.clear();
+    ASSERT_TRUE(state.apply(update, &changedDisplays));
+    ASSERT_TRUE(changedDisplays.empty());
+}
+
+TEST(InputWindowsUpdate, RemoveAndReorder) {
+    std::vector<InputWindowInfo> windows = {createWindow(1, 0), createWindow(2, 0),
+                                            createWindow(3, 1)};
+    InputWindowsUpdateWriter writer;
+    InputWindowsState state;
+    std::unordered_set<int32_t> changedDisplays;
+    ASSERT_TRUE(state.apply(parcel(writer.update(windows)), &changedDisplays));
+
+    InputWindowsUpdate update = parcel(writer.update({windows[1], windows[0]}));
+    ASSERT_TRUE(update.changed.empty());
+    ASSERT_EQ((std::vector<int32_t>{3}), update.removed);
+    ASSERT_TRUE(update.orderChanged);
+
+    changedDisplays.clear();
+    ASSERT_TRUE(state.apply(update, &changedDisplays));
+    ASSERT_EQ((std::unordered_set<int32_t>{0, 1}), changedDisplays);
+    ASSERT_EQ((std::vector<int32_t>{2, 1}), state.getOrder());
+    ASSERT_EQ(nullptr, state.getWindow(3));
+}
+
+/**
+ * A missed update makes the receiver drop everything until the next full sync.
+ */
+TEST(InputWindowsUpdate, GapRecoversOnFullSync) {
+    std::vector<InputWindowInfo> windows = {createWindow(1, 0)};
+    InputWindowsUpdateWriter writer;
+    InputWindowsState state;
+    std::unordered_set<int32_t> changedDisplays;
+    ASSERT_TRUE(state.apply(writer.update(windows), &changedDisplays));
+
+    windows[0].frameLeft = 1;
+    writer.update(windows); // lost
+    windows[0].frameLeft = 2;
+    ASSERT_FALSE(state.apply(writer.update(windows), &changedDisplays));
+    windows[0].frameLeft = 3;
+    ASSERT_FALSE(state.apply(writer.update(windows), &changedDisplays));
+
+    writer.requestFullSync();
+    ASSERT_TRUE(state.apply(writer.update(windows), &changedDisplays));
+    ASSERT_EQ(3, state.getWindow(1)->frameLeft);
+}
+
+} // namespace test
+} // namespace android
@@ -71,5 +71,67 @@ TEST(LatencyStatisticsTest, ShouldReportStats) {
     ASSERT_EQ(stats.shouldReport(), true);
 }
 
+TEST(LatencyHistogramTest, Empty_PercentilesZero) {
+    LatencyHistogram histogram;
+
+    ASSERT_EQ(histogram.getCount(), 0u);
+    ASSERT_EQ(histogram.getPercentile(50), 0);
+    ASSERT_EQ(histogram.getPercentile(100), 0);
+}
+
+TEST(LatencyHistogramTest, SmallValues_Exact) {
+    LatencyHistogram histogram;
+    for (int64_t value = 0; value < 10; value++) {
+        histogram.addValue(value);
+    }
+
+    ASSERT_EQ(histogram.getCount(), 10u);
+    ASSERT_EQ(histogram.getPercentile(0), 0);
+    ASSERT_EQ(histogram.getPercentile(50), 4);
+    ASSERT_EQ(histogram.getPercentile(90), 8);
+    ASSERT_EQ(histogram.getPercentile(100), 9);
+}
+
+TEST(LatencyHistogramTest, LargeValues_WithinBucketError) {
+    LatencyHistogram histogram;
+    for (int64_t value = 1; value <= 100000; value++) {
+        histogram.addValue(value);
+    }
+
+    const int64_t p50 = histogram.getPercentile(50);
+    const int64_t p99 = histogram.getPercentile(99);
+    ASSERT_GE(p50, 50000);
+    ASSERT_LE(p50, 50000 * 9 / 8);
+    ASSERT_GE(p99, 99000);
+    ASSERT_LE(p99, 100000);
+    ASSERT_EQ(histogram.getPercentile(100), 100000);
+}
+
+TEST(LatencyHistogramTest, OutOfRange_Clamped) {
+    LatencyHistogram histogram;
+    histogram.addValue(-5);
+    histogram.addValue(int64_t(1) << 40);
+
+    ASSERT_EQ(histogram.getPercentile(50), 0);
+    ASSERT_EQ(histogram.getPercentile(100), int64_t(1) << 40);
+}
+
+TEST(LatencyHistogramTest, Merge) {
+    LatencyHistogram a;
+    LatencyHistogram b;
+    a.addValue(1);
+    b.addValue(3);
+    b.addValue(5);
+    a.merge(b);
+
+    ASSERT_EQ(a.getCount(), 3u);
+    ASSERT_EQ(a.getMax(), 5);
+    ASSERT_EQ(a.getPercentile(50), 3);
+
+    a.reset();
+    ASSERT_EQ(a.getCount(), 0u);
+    ASSERT_EQ(a.getMax(), 0);
+}
+
 } // namespace test
 } // namespace android
\ No newline at end of file
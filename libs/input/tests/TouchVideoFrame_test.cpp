@@ -15,6 +15,7 @@
  */
 
 #include <gtest/gtest.h>
+#include <optional>
 
 #include <input/DisplayViewport.h>
 #include <input/TouchVideoFrame.h>
@@ -31,7 +32,7 @@ TEST(TouchVideoFrame, Constructor) {
 
     TouchVideoFrame frame(height, width, data, TIMESTAMP);
 
-    ASSERT_EQ(data, frame.getData());
+    ASSERT_EQ(data, std::vector<int16_t>(frame.getData(), frame.getData() + frame.getSize()));
     ASSERT_EQ(height, frame.getHeight());
     ASSERT_EQ(width, frame.getWidth());
     ASSERT_EQ(TIMESTAMP.tv_sec, frame.getTimestamp().tv_sec);
@@ -68,6 +69,33 @@ TEST(TouchVideoFrame, Equality) {
     ASSERT_FALSE(frame == changedTimestampFrame);
 }
 
+TEST(TouchVideoFrame, SharedData_ReleasedWithLastCopy) {
+    static const int16_t buffer[] = {1, 2, 3, 4, 5, 6};
+    bool released = false;
+    std::optional<TouchVideoFrame> frame;
+    frame.emplace(3, 2,
+                  std::shared_ptr<const int16_t>(buffer,
+                                                 [&released](const int16_t*) { released = true; }),
+                  6, TIMESTAMP);
+    ASSERT_EQ(buffer, frame->getData());
+
+    std::vector<TouchVideoFrame> copies = {*frame, *frame};
+    ASSERT_EQ(buffer, copies[0].getData());
+    frame.reset();
+    copies.pop_back();
+    ASSERT_FALSE(released);
+    copies.clear();
+    ASSERT_TRUE(released);
+}
+
+TEST(TouchVideoFrame, SharedData_RotateLeavesOtherCopies) {
+    TouchVideoFrame frame(3, 2, {1, 2, 3, 4, 5, 6}, TIMESTAMP);
+    TouchVideoFrame copy = frame;
+    copy.rotate(DISPLAY_ORIENTATION_180);
+    ASSERT_EQ(TouchVideoFrame(3, 2, {1, 2, 3, 4, 5, 6}, TIMESTAMP), frame);
+    ASSERT_EQ(TouchVideoFrame(3, 2, {6, 5, 4, 3, 2, 1}, TIMESTAMP), copy);
+}
+
 // --- Rotate 90 degrees ---
 
 TEST(TouchVideoFrame, Rotate90_0x0) {
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <input/VelocityTracker.h>
+
+namespace android {
+
+static constexpr nsecs_t NANOS_PER_MS = 1000000;
+
+// A 240Hz touch panel.
+static constexpr nsecs_t SAMPLE_INTERVAL = 4 * NANOS_PER_MS;
+
+// Samples per stroke, after which the tracker is cleared as it would be on the next DOWN.
+static constexpr size_t STROKE_LENGTH = 64;
+
+// Adds one sample per pointer and queries the velocity of each pointer, as an app does on
+// every MOVE while it tracks a fling.
+static void BM_AddMovementAndGetVelocity(benchmark::State& state, const char* strategy) {
+    const size_t pointerCount = state.range(0);
+    VelocityTracker tracker(strategy);
+    BitSet32 idBits;
+    for (size_t i = 0; i < pointerCount; i++) {
+        idBits.markBit(i);
+    }
+
+    VelocityTracker::Position positions[MAX_POINTERS];
+    size_t sample = 0;
+    for (auto _ : state) {
+        if (sample == STROKE_LENGTH) {
+            tracker.clear();
+            sample = 0;
+        }
+        // An accelerating stroke, so the polynomial fits have something to do.
+        const float t = sample * 0.004f;
+        for (size_t i = 0; i < pointerCount; i++) {
+            positions[i].x = 100 + i * 60 + 800 * t + 2000 * t * t;
+            positions[i].y = 1500 - i * 40 - 1200 * t - 3000 * t * t;
+        }
+        tracker.addMovement(sample * SAMPLE_INTERVAL, idBits, positions);
+        sample++;
+
+        for (size_t i = 0; i < pointerCount; i++) {
+            float vx, vy;
+            tracker.getVelocity(i, &vx, &vy);
+            benchmark::DoNotOptimize(vx);
+            benchmark::DoNotOptimize(vy);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * pointerCount);
+}
+
+#define VELOCITY_TRACKER_BENCHMARK(name, strategy) \
+    BENCHMARK_CAPTURE(BM_AddMovementAndGetVelocity, name, strategy)->Arg(1)->Arg(2)->Arg(10)
+
+VELOCITY_TRACKER_BENCHMARK(impulse, "impulse");
+VELOCITY_TRACKER_BENCHMARK(lsq1, "lsq1");
+VELOCITY_TRACKER_BENCHMARK(lsq2, "lsq2");
+VELOCITY_TRACKER_BENCHMARK(lsq3, "lsq3");
+VELOCITY_TRACKER_BENCHMARK(wlsq2_delta, "wlsq2-delta");
+VELOCITY_TRACKER_BENCHMARK(wlsq2_central, "wlsq2-central");
+VELOCITY_TRACKER_BENCHMARK(wlsq2_recent, "wlsq2-recent");
+VELOCITY_TRACKER_BENCHMARK(int1, "int1");
+VELOCITY_TRACKER_BENCHMARK(int2, "int2");
+VELOCITY_TRACKER_BENCHMARK(legacy, "legacy");
+
+} // namespace android
@@ -907,4 +907,44 @@ TEST_F(VelocityTrackerTest, LeastSquaresVelocityTrackerStrategyEstimator_Parabol
     computeAndCheckQuadraticEstimate(motions, std::array<float, 3>({0, 0E3, 1E6}));
 }
 
+/*
+ * A pointer that goes down later has its own history, and lifting it does not disturb the others.
+ */
+TEST_F(VelocityTrackerTest, LeastSquaresVelocityTrackerStrategy_PointerHistoriesAreIndependent) {
+    VelocityTracker vt("lsq2");
+    VelocityTracker single("lsq2");
+    BitSet32 first;
+    first.markBit(0);
+    BitSet32 both(first);
+    both.markBit(3);
+
+    for (int i = 0; i < 10; i++) {
+        const nsecs_t eventTime = i * 8000000;
+        VelocityTracker::Position positions[2] = {{10.0f * i, 20.0f * i}, {-5.0f * i, 500}};
+        if (i < 5) {
+            vt.addMovement(eventTime, first, positions);
+        } else {
+            vt.addMovement(eventTime, both, positions);
+        }
+        single.addMovement(eventTime, first, positions);
+    }
+
+    float vx, vy, singleVx, singleVy;
+    ASSERT_TRUE(vt.getVelocity(0, &vx, &vy));
+    ASSERT_TRUE(single.getVelocity(0, &singleVx, &singleVy));
+    EXPECT_FLOAT_EQ(singleVx, vx);
+    EXPECT_FLOAT_EQ(singleVy, vy);
+
+    // Pointer 3 has only been down for 5 samples, moving at -625 units/s in x.
+    ASSERT_TRUE(vt.getVelocity(3, &vx, &vy));
+    EXPECT_NEAR(-625, vx, 1);
+    EXPECT_NEAR(0, vy, 1);
+
+    vt.clearPointers(BitSet32(1u << (31 - 3)));
+    EXPECT_FALSE(vt.getVelocity(3, &vx, &vy));
+    ASSERT_TRUE(vt.getVelocity(0, &vx, &vy));
+    EXPECT_FLOAT_EQ(singleVx, vx);
+}
+
 } // namespace android
+
@@ -381,6 +381,36 @@ CONSTEXPR typename TMat33<U>::col_type PURE operator *(const TMat33<T>& lhs, con
     return result;
 }
 
+#ifdef __has_builtin
+#if __has_builtin(__builtin_is_constant_evaluated)
+// float matrix * float column-vector, spelled out with 4-wide vectors (NEON on ARM) with the
+// fourth lane unused. Same operations in the same order as above, so results are bit-identical.
+inline CONSTEXPR TVec3<float> PURE operator *(const TMat33<float>& lhs, const TVec3<float>& rhs) {
+    if (__builtin_is_constant_evaluated()) {
+        float x = 0, y = 0, z = 0;
+        for (size_t col = 0; col < TMat33<float>::NUM_COLS; ++col) {
+            x += lhs[col].x * rhs[col];
+            y += lhs[col].y * rhs[col];
+            z += lhs[col].z * rhs[col];
+        }
+        return TVec3<float>(x, y, z);
+    }
+
+    typedef float float4 __attribute__((vector_size(16)));
+    float4 result = { 0, 0, 0, 0 };
+    for (size_t col = 0; col < TMat33<float>::NUM_COLS; ++col) {
+        const TVec3<float>& c = lhs[col];
+        const float4 column = { c.x, c.y, c.z, 0 };
+        // Kept as a separate statement so the compiler can't contract it into a fused
+        // multiply-add, which would round differently from the generic version.
+        const float4 product = column * rhs[col];
+        result += product;
+    }
+    return TVec3<float>(result[0], result[1], result[2]);
+}
+#endif
+#endif
+
 // row-vector * matrix, result is a vector of the same type than the input vector
 template <typename T, typename U>
 CONSTEXPR typename TMat33<U>::row_type PURE operator *(const TVec3<U>& lhs, const TMat33<T>& rhs) {
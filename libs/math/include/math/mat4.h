@@ -530,6 +530,39 @@ CONSTEXPR typename TMat44<T>::col_type PURE operator *(const TMat44<T>& lhs, con
     return result;
 }
 
+#ifdef __has_builtin
+#if __has_builtin(__builtin_is_constant_evaluated)
+// float matrix * float column-vector is the inner loop of every float mat4 product, so spell
+// it out with 4-wide vectors (NEON on ARM) instead of relying on auto-vectorization. It does
+// the same multiplies and additions in the same order as the generic version above, so the
+// results are bit-identical.
+inline CONSTEXPR TVec4<float> PURE operator *(const TMat44<float>& lhs, const TVec4<float>& rhs) {
+    if (__builtin_is_constant_evaluated()) {
+        float x = 0, y = 0, z = 0, w = 0;
+        for (size_t col = 0; col < TMat44<float>::NUM_COLS; ++col) {
+            x += lhs[col].x * rhs[col];
+            y += lhs[col].y * rhs[col];
+            z += lhs[col].z * rhs[col];
+            w += lhs[col].w * rhs[col];
+        }
+        return TVec4<float>(x, y, z, w);
+    }
+
+    typedef float float4 __attribute__((vector_size(16)));
+    float4 result = { 0, 0, 0, 0 };
+    for (size_t col = 0; col < TMat44<float>::NUM_COLS; ++col) {
+        const TVec4<float>& c = lhs[col];
+        const float4 column = { c.x, c.y, c.z, c.w };
+        // Kept as a separate statement so the compiler can't contract it into a fused
+        // multiply-add, which would round differently from the generic version.
+        const float4 product = column * rhs[col];
+        result += product;
+    }
+    return TVec4<float>(result[0], result[1], result[2], result[3]);
+}
+#endif
+#endif
+
 // mat44 * vec3, result is vec3( mat44 * {vec3, 1} )
 template <typename T, typename U>
 CONSTEXPR typename TMat44<T>::col_type PURE operator *(const TMat44<T>& lhs, const TVec3<U>& rhs) {
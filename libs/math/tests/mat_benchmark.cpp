@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <math/mat3.h>
+#include <math/mat4.h>
+
+namespace android {
+
+// The products SurfaceFlinger and RenderEngine compute for every layer: composing a layer's
+// transform with the display's, transforming its corners, and building color matrices.
+static const mat4 kProjection = mat4::ortho(0, 1080, 2340, 0, 0, 1);
+static const mat4 kLayerTransform = mat4::translate(vec4(90, 800, 0, 1)) * mat4::scale(vec4(2));
+static const vec4 kCorner(900, 800, 0, 1);
+static const mat3 kColorTransform(vec3(0.8f, 0.1f, 0.1f), vec3(0.1f, 0.8f, 0.1f),
+                                  vec3(0.1f, 0.1f, 0.8f));
+
+static void BM_Mat4TimesVec4(benchmark::State& state) {
+    const mat4 m = kProjection;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m * kCorner);
+    }
+}
+BENCHMARK(BM_Mat4TimesVec4);
+
+static void BM_Mat4TimesMat4(benchmark::State& state) {
+    const mat4 m = kProjection;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m * kLayerTransform);
+    }
+}
+BENCHMARK(BM_Mat4TimesMat4);
+
+static void BM_Mat4Inverse(benchmark::State& state) {
+    const mat4 m = kProjection * kLayerTransform;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(inverse(m));
+    }
+}
+BENCHMARK(BM_Mat4Inverse);
+
+static void BM_Mat3TimesMat3(benchmark::State& state) {
+    const mat3 m = kColorTransform;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m * kColorTransform);
+    }
+}
+BENCHMARK(BM_Mat3TimesMat3);
+
+static void BM_Mat3Inverse(benchmark::State& state) {
+    const mat3 m = kColorTransform;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(inverse(m));
+    }
+}
+BENCHMARK(BM_Mat3Inverse);
+
+} // namespace android
+
+BENCHMARK_MAIN();
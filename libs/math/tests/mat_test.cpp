@@ -163,6 +163,33 @@ TEST_F(MatTest, ElementAccess) {
     EXPECT_FLOAT_EQ(m(3, 2), 100);
 }
 
+TEST_F(MatTest, FloatProductsMatchGenericImplementation) {
+    std::default_random_engine generator(171717);
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+    auto random = std::bind(distribution, generator);
+
+    for (size_t i = 0; i < 100; i++) {
+        const mat4 m(vec4(random(), random(), random(), random()),
+                     vec4(random(), random(), random(), random()),
+                     vec4(random(), random(), random(), random()),
+                     vec4(random(), random(), random(), random()));
+        const vec4 v(random(), random(), random(), random());
+
+        // The float specialization must agree bit for bit with the generic template.
+        const vec4 expected = details::operator*<float, float>(m, v);
+        const vec4 actual = m * v;
+        for (size_t r = 0; r < 4; r++) {
+            EXPECT_EQ(expected[r], actual[r]);
+        }
+
+        const mat4 product = m * m;
+        for (size_t c = 0; c < 4; c++) {
+            const vec4 expectedColumn = details::operator*<float, float>(m, m[c]);
+            EXPECT_EQ(expectedColumn, product[c]);
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 // MAT 3
 //------------------------------------------------------------------------------
@@ -241,6 +268,25 @@ TEST_F(Mat3Test, UnaryOps) {
     EXPECT_EQ(identity, m0);
 }
 
+TEST_F(Mat3Test, FloatProductsMatchGenericImplementation) {
+    std::default_random_engine generator(171717);
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+    auto random = std::bind(distribution, generator);
+
+    for (size_t i = 0; i < 100; i++) {
+        const mat3 m(vec3(random(), random(), random()), vec3(random(), random(), random()),
+                     vec3(random(), random(), random()));
+        const vec3 v(random(), random(), random());
+
+        // The float specialization must agree bit for bit with the generic template.
+        const vec3 expected = details::operator*<float, float>(m, v);
+        const vec3 actual = m * v;
+        for (size_t r = 0; r < 3; r++) {
+            EXPECT_EQ(expected[r], actual[r]);
+        }
+    }
+}
+
 TEST_F(Mat3Test, MiscOps) {
     const mat3 identity;
     mat3 m0;
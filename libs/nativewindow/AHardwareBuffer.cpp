@@ -21,11 +21,15 @@
 #include <errno.h>
 #include <sys/socket.h>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include <cutils/native_handle.h>
 #include <log/log.h>
 #include <utils/StrongPointer.h>
+#include <ui/Fence.h>
 #include <ui/GraphicBuffer.h>
+#include <ui/GraphicBufferMapper.h>
 #include <system/graphics.h>
 
 #include <private/android/AHardwareBufferHelpers.h>
@@ -36,6 +40,152 @@ static constexpr int kFdBufferSize = 128 * sizeof(int);  // 128 ints
 
 using namespace android;
 
+// ----------------------------------------------------------------------------
+// Persistent mappings
+// ----------------------------------------------------------------------------
+
+namespace {
+
+// A buffer that stays locked in gralloc from its first AHardwareBuffer lock
+// until the mapping is released.  AHardwareBuffer lock and unlock calls on it
+// only synchronize the CPU mapping with other users of the buffer.
+struct PersistentMapping {
+    std::mutex mutex;
+
+    // Keeps the buffer alive while it is mapped.  Cleared on release.
+    sp<GraphicBuffer> buffer;
+
+    bool mapped = false;
+    bool ycbcr = false;
+    // The gralloc usage the buffer is mapped with.
+    uint64_t mappedUsage = 0;
+
+    // Whether the buffer is locked through the AHardwareBuffer API, and with
+    // what gralloc usage.
+    bool locked = false;
+    uint64_t lockedUsage = 0;
+
+    void* data = nullptr;
+    int32_t bytesPerPixel = -1;
+    int32_t bytesPerStride = -1;
+    android_ycbcr ycbcrData = {};
+};
+
+// The addresses a lock of a persistently mapped buffer hands back.
+struct PersistentLock {
+    void* data = nullptr;
+    int32_t bytesPerPixel = -1;
+    int32_t bytesPerStride = -1;
+    android_ycbcr ycbcrData = {};
+};
+
+std::mutex gPersistentMappingsMutex;
+std::unordered_map<const AHardwareBuffer*, std::shared_ptr<PersistentMapping>>
+        gPersistentMappings;
+
+std::shared_ptr<PersistentMapping> findPersistentMapping(const AHardwareBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(gPersistentMappingsMutex);
+    auto it = gPersistentMappings.find(buffer);
+    return it != gPersistentMappings.end() ? it->second : nullptr;
+}
+
+// Hands a release fence to the caller, or waits for it if the caller did not
+// ask for one.
+void returnReleaseFence(int releaseFence, int32_t* outFence) {
+    if (outFence != nullptr) {
+        *outFence = releaseFence;
+    } else {
+        sp<Fence>(new Fence(releaseFence))->waitForever("AHardwareBuffer_unlock");
+    }
+}
+
+// Locks a persistently mapped buffer, mapping it first if it is not mapped
+// yet or not mapped for the requested usage.  Takes ownership of fence.
+status_t lockPersistentMapping(PersistentMapping* mapping, uint64_t usage, bool ycbcr,
+                               int32_t fence, const Rect& bounds, PersistentLock* outLock) {
+    sp<Fence> acquireFence = new Fence(fence);
+    std::lock_guard<std::mutex> lock(mapping->mutex);
+
+    GraphicBuffer* gbuffer = mapping->buffer.get();
+    if (gbuffer == nullptr || mapping->locked) {
+        return INVALID_OPERATION;
+    }
+    if (bounds.left < 0 || bounds.right > int32_t(gbuffer->getWidth()) ||
+        bounds.top < 0 || bounds.bottom > int32_t(gbuffer->getHeight())) {
+        ALOGE("locking pixels (%d,%d,%d,%d) outside of buffer (w=%d, h=%d)",
+                bounds.left, bounds.top, bounds.right, bounds.bottom,
+                gbuffer->getWidth(), gbuffer->getHeight());
+        return BAD_VALUE;
+    }
+
+    if (mapping->mapped && ((usage & ~mapping->mappedUsage) || ycbcr != mapping->ycbcr)) {
+        int releaseFence = -1;
+        gbuffer->unlockAsync(&releaseFence);
+        sp<Fence>(new Fence(releaseFence))->waitForever("AHardwareBuffer_lock");
+        mapping->mapped = false;
+        usage |= mapping->mappedUsage;
+    }
+
+    if (!mapping->mapped) {
+        // Map the whole buffer, so that later locks of any region can use it.
+        const Rect fullBounds(gbuffer->getWidth(), gbuffer->getHeight());
+        status_t err;
+        if (ycbcr) {
+            err = gbuffer->lockAsyncYCbCr(usage, fullBounds, &mapping->ycbcrData,
+                                          acquireFence->dup());
+        } else {
+            err = gbuffer->lockAsync(usage, usage, fullBounds, &mapping->data,
+                                     acquireFence->dup(), &mapping->bytesPerPixel,
+                                     &mapping->bytesPerStride);
+        }
+        if (err != NO_ERROR) {
+            return err;
+        }
+        mapping->mapped = true;
+        mapping->ycbcr = ycbcr;
+        mapping->mappedUsage = usage;
+    } else {
+        status_t err = acquireFence->waitForever("AHardwareBuffer_lock");
+        if (err == NO_ERROR && (usage & GRALLOC_USAGE_SW_READ_MASK)) {
+            err = GraphicBufferMapper::get().rereadLockedBuffer(gbuffer->handle);
+        }
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+
+    mapping->locked = true;
+    mapping->lockedUsage = usage;
+    outLock->data = mapping->data;
+    outLock->bytesPerPixel = mapping->bytesPerPixel;
+    outLock->bytesPerStride = mapping->bytesPerStride;
+    outLock->ycbcrData = mapping->ycbcrData;
+    return NO_ERROR;
+}
+
+// Unlocks a persistently mapped buffer, leaving it mapped.
+status_t unlockPersistentMapping(PersistentMapping* mapping, int32_t* outFence) {
+    std::lock_guard<std::mutex> lock(mapping->mutex);
+
+    if (mapping->buffer == nullptr || !mapping->locked) {
+        return INVALID_OPERATION;
+    }
+
+    int releaseFence = -1;
+    if (mapping->lockedUsage & GRALLOC_USAGE_SW_WRITE_MASK) {
+        status_t err = GraphicBufferMapper::get().flushLockedBuffer(mapping->buffer->handle,
+                                                                    &releaseFence);
+        if (err != NO_ERROR) {
+            return err;
+        }
+    }
+    mapping->locked = false;
+    returnReleaseFence(releaseFence, outFence);
+    return NO_ERROR;
+}
+
+} // namespace
+
 // ----------------------------------------------------------------------------
 // Public functions
 // ----------------------------------------------------------------------------
@@ -134,13 +284,30 @@ int AHardwareBuffer_lockAndGetInfo(AHardwareBuffer* buffer, uint64_t usage,
     }
     int32_t bytesPerPixel;
     int32_t bytesPerStride;
-    int result = gbuffer->lockAsync(usage, usage, bounds, outVirtualAddress, fence, &bytesPerPixel, &bytesPerStride);
+    int result;
+    if (auto mapping = findPersistentMapping(buffer)) {
+        PersistentLock persistentLock;
+        result = lockPersistentMapping(mapping.get(), usage, /*ycbcr=*/false, fence, bounds,
+                                       &persistentLock);
+        if (result != NO_ERROR) {
+            return result;
+        }
+        *outVirtualAddress = persistentLock.data;
+        bytesPerPixel = persistentLock.bytesPerPixel;
+        bytesPerStride = persistentLock.bytesPerStride;
+        if (bytesPerPixel == -1 || bytesPerStride == -1) {
+            unlockPersistentMapping(mapping.get(), nullptr);
+            return INVALID_OPERATION;
+        }
+    } else {
+        result = gbuffer->lockAsync(usage, usage, bounds, outVirtualAddress, fence, &bytesPerPixel, &bytesPerStride);
 
-    // if hardware returns -1 for bytes per pixel or bytes per stride, we fail
-    // and unlock the buffer
-    if (bytesPerPixel == -1 || bytesPerStride == -1) {
-        gbuffer->unlock();
-        return INVALID_OPERATION;
+        // if hardware returns -1 for bytes per pixel or bytes per stride, we fail
+        // and unlock the buffer
+        if (bytesPerPixel == -1 || bytesPerStride == -1) {
+            gbuffer->unlock();
+            return INVALID_OPERATION;
+        }
     }
 
     if (outBytesPerPixel) *outBytesPerPixel = bytesPerPixel;
@@ -177,6 +344,15 @@ int AHardwareBuffer_lock(AHardwareBuffer* buffer, uint64_t usage,
     } else {
         bounds.set(Rect(rect->left, rect->top, rect->right, rect->bottom));
     }
+    if (auto mapping = findPersistentMapping(buffer)) {
+        PersistentLock persistentLock;
+        int result = lockPersistentMapping(mapping.get(), usage, /*ycbcr=*/false, fence, bounds,
+                                           &persistentLock);
+        if (result == NO_ERROR) {
+            *outVirtualAddress = persistentLock.data;
+        }
+        return result;
+    }
     return gbuffer->lockAsync(usage, usage, bounds, outVirtualAddress, fence, &bytesPerPixel, &bytesPerStride);
 }
 
@@ -201,9 +377,18 @@ int AHardwareBuffer_lockPlanes(AHardwareBuffer* buffer, uint64_t usage,
     }
     int format = AHardwareBuffer_convertFromPixelFormat(uint32_t(gBuffer->getPixelFormat()));
     memset(outPlanes->planes, 0, sizeof(outPlanes->planes));
+    auto mapping = findPersistentMapping(buffer);
     if (AHardwareBuffer_formatIsYuv(format)) {
       android_ycbcr yuvData;
-      int result = gBuffer->lockAsyncYCbCr(usage, bounds, &yuvData, fence);
+      int result;
+      if (mapping) {
+        PersistentLock persistentLock;
+        result = lockPersistentMapping(mapping.get(), usage, /*ycbcr=*/true, fence, bounds,
+                                       &persistentLock);
+        yuvData = persistentLock.ycbcrData;
+      } else {
+        result = gBuffer->lockAsyncYCbCr(usage, bounds, &yuvData, fence);
+      }
       if (result == 0) {
         outPlanes->planeCount = 3;
         outPlanes->planes[0].data = yuvData.y;
@@ -224,6 +409,13 @@ int AHardwareBuffer_lockPlanes(AHardwareBuffer* buffer, uint64_t usage,
       outPlanes->planeCount = 1;
       outPlanes->planes[0].pixelStride = pixelStride;
       outPlanes->planes[0].rowStride = gBuffer->getStride() * pixelStride;
+      if (mapping) {
+        PersistentLock persistentLock;
+        int result = lockPersistentMapping(mapping.get(), usage, /*ycbcr=*/false, fence, bounds,
+                                           &persistentLock);
+        outPlanes->planes[0].data = persistentLock.data;
+        return result;
+      }
       return gBuffer->lockAsync(usage, usage, bounds, &outPlanes->planes[0].data, fence);
     }
 }
@@ -231,6 +423,10 @@ int AHardwareBuffer_lockPlanes(AHardwareBuffer* buffer, uint64_t usage,
 int AHardwareBuffer_unlock(AHardwareBuffer* buffer, int32_t* fence) {
     if (!buffer) return BAD_VALUE;
 
+    if (auto mapping = findPersistentMapping(buffer)) {
+        return unlockPersistentMapping(mapping.get(), fence);
+    }
+
     GraphicBuffer* gBuffer = AHardwareBuffer_to_GraphicBuffer(buffer);
     if (fence == nullptr)
         return gBuffer->unlock();
@@ -238,6 +434,60 @@ int AHardwareBuffer_unlock(AHardwareBuffer* buffer, int32_t* fence) {
         return gBuffer->unlockAsync(fence);
 }
 
+int AHardwareBuffer_enablePersistentMapping(AHardwareBuffer* buffer) {
+    if (!buffer) return BAD_VALUE;
+
+    GraphicBuffer* gBuffer = AHardwareBuffer_to_GraphicBuffer(buffer);
+    if (gBuffer->getLayerCount() > 1) {
+        ALOGE("Buffer with multiple layers passed to AHardwareBuffer_enablePersistentMapping; "
+                "only buffers with one layer are allowed");
+        return INVALID_OPERATION;
+    }
+
+    // Only gralloc 4 can synchronize a locked buffer without unlocking it.
+    if (gBuffer->getBufferMapperVersion() != GraphicBufferMapper::Version::GRALLOC_4) {
+        return INVALID_OPERATION;
+    }
+
+    std::lock_guard<std::mutex> lock(gPersistentMappingsMutex);
+    auto& mapping = gPersistentMappings[buffer];
+    if (mapping == nullptr) {
+        mapping = std::make_shared<PersistentMapping>();
+        mapping->buffer = gBuffer;
+    }
+    return NO_ERROR;
+}
+
+int AHardwareBuffer_releasePersistentMapping(AHardwareBuffer* buffer, int32_t* fence) {
+    if (!buffer) return BAD_VALUE;
+
+    std::shared_ptr<PersistentMapping> mapping;
+    {
+        std::lock_guard<std::mutex> lock(gPersistentMappingsMutex);
+        auto it = gPersistentMappings.find(buffer);
+        if (it == gPersistentMappings.end()) {
+            return BAD_VALUE;
+        }
+        mapping = std::move(it->second);
+        gPersistentMappings.erase(it);
+    }
+
+    std::lock_guard<std::mutex> lock(mapping->mutex);
+    int releaseFence = -1;
+    status_t err = NO_ERROR;
+    if (mapping->mapped) {
+        err = mapping->buffer->unlockAsync(&releaseFence);
+    }
+    mapping->mapped = false;
+    mapping->locked = false;
+    mapping->buffer.clear();
+    if (err != NO_ERROR) {
+        return err;
+    }
+    returnReleaseFence(releaseFence, fence);
+    return NO_ERROR;
+}
+
 int AHardwareBuffer_sendHandleToUnixSocket(const AHardwareBuffer* buffer, int socketFd) {
     if (!buffer) return BAD_VALUE;
     const GraphicBuffer* gBuffer = AHardwareBuffer_to_GraphicBuffer(buffer);
@@ -88,14 +88,22 @@ int32_t ANativeWindow_getFormat(ANativeWindow* window) {
 
 int32_t ANativeWindow_setBuffersGeometry(ANativeWindow* window,
         int32_t width, int32_t height, int32_t format) {
+    int mode = NATIVE_WINDOW_SCALING_MODE_FREEZE;
+    if (width && height) {
+        mode = NATIVE_WINDOW_SCALING_MODE_SCALE_TO_WINDOW;
+    }
+    // Surface sets all three in one perform call, which is cheaper for apps that call this every
+    // frame. Windows that don't support it, or that fail it, take the calls one at a time, which
+    // reproduces the same result and error.
+    if (window->perform(window, NATIVE_WINDOW_SET_BUFFERS_USER_GEOMETRY, width, height, format,
+                        mode) == 0) {
+        return 0;
+    }
+
     int32_t err = native_window_set_buffers_format(window, format);
     if (!err) {
         err = native_window_set_buffers_user_dimensions(window, width, height);
         if (!err) {
-            int mode = NATIVE_WINDOW_SCALING_MODE_FREEZE;
-            if (width && height) {
-                mode = NATIVE_WINDOW_SCALING_MODE_SCALE_TO_WINDOW;
-            }
             err = native_window_set_scaling_mode(window, mode);
         }
     }
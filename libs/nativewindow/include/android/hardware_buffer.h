@@ -542,6 +542,49 @@ int AHardwareBuffer_lockAndGetInfo(AHardwareBuffer* buffer, uint64_t usage,
         int32_t* outBytesPerPixel, int32_t* outBytesPerStride) __INTRODUCED_IN(29);
 #endif // __ANDROID_API__ >= 29
 
+#if __ANDROID_API__ >= 31
+
+/**
+ * Keep the CPU mapping of an AHardwareBuffer across lock and unlock calls.
+ *
+ * Meant for buffers that are locked for CPU access every frame. After this
+ * call, the next AHardwareBuffer_lock(), AHardwareBuffer_lockAndGetInfo() or
+ * AHardwareBuffer_lockPlanes() maps the whole buffer. AHardwareBuffer_unlock()
+ * then only makes CPU writes visible to other users of the buffer and leaves
+ * it mapped. Later locks wait for \a fence, make writes by other users visible
+ * to the CPU, and return the same addresses. A lock with usage flags that the
+ * mapping does not cover maps the buffer again.
+ *
+ * The buffer must not be locked when this is called. The mapping holds a
+ * reference to the buffer until AHardwareBuffer_releasePersistentMapping() is
+ * called.
+ *
+ * Available since API level 31.
+ *
+ * \return 0 on success. -EINVAL if \a buffer is NULL. INVALID_OPERATION if the
+ * buffer has more than one layer, or if the device cannot synchronize a mapped
+ * buffer without unmapping it, in which case lock and unlock keep mapping and
+ * unmapping the buffer.
+ */
+int AHardwareBuffer_enablePersistentMapping(AHardwareBuffer* buffer) __INTRODUCED_IN(31);
+
+/**
+ * Unmap an AHardwareBuffer that was kept mapped by
+ * AHardwareBuffer_enablePersistentMapping(), and go back to mapping it on each
+ * lock. If the buffer is locked, this also unlocks it.
+ *
+ * \a fence is handled as by AHardwareBuffer_unlock().
+ *
+ * Available since API level 31.
+ *
+ * \return 0 on success. -EINVAL if \a buffer is NULL or not persistently
+ * mapped. Error number if the unmapping fails for any other reason.
+ */
+int AHardwareBuffer_releasePersistentMapping(AHardwareBuffer* buffer, int32_t* fence)
+        __INTRODUCED_IN(31);
+
+#endif // __ANDROID_API__ >= 31
+
 __END_DECLS
 
 #endif // ANDROID_HARDWARE_BUFFER_H
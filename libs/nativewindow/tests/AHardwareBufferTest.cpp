@@ -21,6 +21,8 @@
 #include <private/android/AHardwareBufferHelpers.h>
 #include <android/hardware/graphics/common/1.0/types.h>
 #include <vndk/hardware_buffer.h>
+#include <unistd.h>
+#include <utils/Errors.h>
 
 #include <gtest/gtest.h>
 
@@ -131,3 +133,55 @@ TEST(AHardwareBufferTest, GetCreateHandleTest) {
     AHardwareBuffer_release(buffer);
     AHardwareBuffer_release(otherBuffer);
 }
+
+TEST(AHardwareBufferTest, PersistentMappingTest) {
+    AHardwareBuffer_Desc desc{
+            .width = 64,
+            .height = 1,
+            .layers = 1,
+            .format = AHARDWAREBUFFER_FORMAT_BLOB,
+            .usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+            .stride = 64,
+    };
+
+    AHardwareBuffer* buffer = nullptr;
+    ASSERT_EQ(0, AHardwareBuffer_allocate(&desc, &buffer));
+
+    int result = AHardwareBuffer_enablePersistentMapping(buffer);
+    if (result == INVALID_OPERATION) {
+        // Persistent mappings are not supported by this device's gralloc.
+        AHardwareBuffer_release(buffer);
+        return;
+    }
+    ASSERT_EQ(0, result);
+
+    void* data = nullptr;
+    ASSERT_EQ(0, AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr,
+                                      &data));
+    ASSERT_NE(nullptr, data);
+    static_cast<uint8_t*>(data)[0] = 0x5a;
+    // A persistently mapped buffer cannot be locked twice.
+    void* otherData = nullptr;
+    EXPECT_EQ(INVALID_OPERATION,
+              AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr,
+                                   &otherData));
+    EXPECT_EQ(0, AHardwareBuffer_unlock(buffer, nullptr));
+
+    // The buffer stays mapped at the same address, with earlier writes visible.
+    ASSERT_EQ(0, AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr,
+                                      &otherData));
+    EXPECT_EQ(data, otherData);
+    EXPECT_EQ(0x5a, static_cast<uint8_t*>(otherData)[0]);
+
+    int32_t fence = -1;
+    EXPECT_EQ(0, AHardwareBuffer_releasePersistentMapping(buffer, &fence));
+    if (fence >= 0) close(fence);
+    EXPECT_EQ(BAD_VALUE, AHardwareBuffer_releasePersistentMapping(buffer, nullptr));
+
+    // Without a persistent mapping, lock and unlock work as before.
+    ASSERT_EQ(0, AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr,
+                                      &data));
+    EXPECT_EQ(0, AHardwareBuffer_unlock(buffer, nullptr));
+
+    AHardwareBuffer_release(buffer);
+}
@@ -38,6 +38,7 @@
 #include <ui/ColorSpace.h>
 #include <ui/DebugUtils.h>
 #include <ui/GraphicBuffer.h>
+#include <ui/PixelFormat.h>
 #include <ui/Rect.h>
 #include <ui/Region.h>
 #include <utils/KeyedVector.h>
@@ -46,7 +47,6 @@
 #include "GLExtensions.h"
 #include "GLFramebuffer.h"
 #include "GLImage.h"
-#include "GLShadowVertexGenerator.h"
 #include "Program.h"
 #include "ProgramCache.h"
 #include "filters/BlurFilter.h"
@@ -119,6 +119,15 @@ namespace gl {
 using base::StringAppendF;
 using ui::Dataspace;
 
+// Size of the buffer an image maps, for the image cache budget. YUV and implementation defined
+// formats have no fixed bytes per pixel, so they count as 8 bit 4:2:0.
+static size_t estimateImageBytes(const GraphicBuffer& buffer) {
+    const size_t pixels = static_cast<size_t>(buffer.getStride()) * buffer.getHeight() *
+            std::max(buffer.getLayerCount(), 1u);
+    const uint32_t pixelBytes = bytesPerPixel(buffer.getPixelFormat());
+    return pixelBytes > 0 ? pixels * pixelBytes : pixels * 3 / 2;
+}
+
 static status_t selectConfigForAttribute(EGLDisplay dpy, EGLint const* attrs, EGLint attribute,
                                          EGLint wanted, EGLConfig* outConfig) {
     EGLint numConfigs = -1, n = 0;
@@ -255,6 +264,9 @@ std::unique_ptr<GLESRenderEngine> GLESRenderEngine::create(const RenderEngineCre
     LOG_ALWAYS_FATAL_IF(!success, "can't make dummy pbuffer current");
     extensions.initWithGLStrings(glGetString(GL_VENDOR), glGetString(GL_RENDERER),
                                  glGetString(GL_VERSION), glGetString(GL_EXTENSIONS));
+    char programCacheDirectory[PROPERTY_VALUE_MAX];
+    property_get(PROPERTY_RENDERENGINE_PROGRAM_CACHE_DIR, programCacheDirectory, "");
+    ProgramCache::getInstance().initBinaryCache(programCacheDirectory);
 
     EGLSurface protectedDummy = EGL_NO_SURFACE;
     if (protectedContext != EGL_NO_CONTEXT && !extensions.hasSurfacelessContext()) {
@@ -346,12 +358,16 @@ GLESRenderEngine::GLESRenderEngine(const RenderEngineCreationArgs& args, EGLDisp
         mVpWidth(0),
         mVpHeight(0),
         mFramebufferImageCacheSize(args.imageCacheSize),
-        mUseColorManagement(args.useColorManagement) {
+        mUseColorManagement(args.useColorManagement),
+        mImageCacheBudget(args.imageCacheBudget) {
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &mMaxTextureSize);
     glGetIntegerv(GL_MAX_VIEWPORT_DIMS, mMaxViewportDims);
 
     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // Programs may be built on another context, so the attribute every mesh has is enabled
+    // here rather than when the first program is built.
+    glEnableVertexAttribArray(Program::position);
 
     // Initialize protected EGL Context.
     if (mProtectedEGLContext != EGL_NO_CONTEXT) {
@@ -360,10 +376,28 @@ GLESRenderEngine::GLESRenderEngine(const RenderEngineCreationArgs& args, EGLDisp
         ALOGE_IF(!success, "can't make protected context current");
         glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glEnableVertexAttribArray(Program::position);
         success = eglMakeCurrent(display, mDummySurface, mDummySurface, mEGLContext);
         LOG_ALWAYS_FATAL_IF(!success, "can't make default context current");
     }
 
+    // Shares objects with the other contexts, so that the shader cache can be primed on it in
+    // the background.
+    mPrimeCacheEGLContext =
+            createEglContext(display, config, ctxt, /*useContextPriority*/ false,
+                             Protection::UNPROTECTED);
+    if (mPrimeCacheEGLContext != EGL_NO_CONTEXT &&
+        !GLExtensions::getInstance().hasSurfacelessContext()) {
+        mPrimeCacheDummySurface = createDummyEglPbufferSurface(display, config, args.pixelFormat,
+                                                               Protection::UNPROTECTED);
+        if (mPrimeCacheDummySurface == EGL_NO_SURFACE) {
+            eglDestroyContext(display, mPrimeCacheEGLContext);
+            mPrimeCacheEGLContext = EGL_NO_CONTEXT;
+        }
+    }
+    ALOGE_IF(mPrimeCacheEGLContext == EGL_NO_CONTEXT,
+             "Can't create shader cache context, priming the cache synchronously");
+
     // mColorBlindnessCorrection = M;
 
     if (mUseColorManagement) {
@@ -429,7 +463,8 @@ GLESRenderEngine::GLESRenderEngine(const RenderEngineCreationArgs& args, EGLDisp
 }
 
 GLESRenderEngine::~GLESRenderEngine() {
-    // Destroy the image manager first.
+    // Stop the threads that use the display first.
+    ProgramCache::getInstance().stopBackgroundThread();
     mImageManager = nullptr;
     std::lock_guard<std::mutex> lock(mRenderingMutex);
     unbindFrameBuffer(mDrawingBuffer.get());
@@ -440,8 +475,14 @@ GLESRenderEngine::~GLESRenderEngine() {
         eglDestroyImageKHR(mEGLDisplay, expired);
         DEBUG_EGL_IMAGE_TRACKER_DESTROY();
     }
+    {
+        std::lock_guard<std::mutex> lock(mFramebufferImageCacheMutex);
+        evictTransientFramebufferImagesLocked(systemTime(), true);
+    }
     eglDestroyImageKHR(mEGLDisplay, mPlaceholderImage);
     mImageCache.clear();
+    mImageLru.clear();
+    mShadowCache.clear();
     eglMakeCurrent(mEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglTerminate(mEGLDisplay);
 }
@@ -459,8 +500,15 @@ Framebuffer* GLESRenderEngine::getFramebufferForDrawing() {
 }
 
 void GLESRenderEngine::primeCache() const {
-    ProgramCache::getInstance().primeCache(mInProtectedContext ? mProtectedEGLContext : mEGLContext,
-                                           mArgs.useColorManagement,
+    const EGLContext context = mInProtectedContext ? mProtectedEGLContext : mEGLContext;
+    if (mPrimeCacheEGLContext != EGL_NO_CONTEXT) {
+        ProgramCache::getInstance().primeCacheInBackground(mEGLDisplay, mPrimeCacheEGLContext,
+                                                           mPrimeCacheDummySurface, context,
+                                                           mArgs.useColorManagement,
+                                                           mArgs.precacheToneMapperShaderOnly);
+        return;
+    }
+    ProgramCache::getInstance().primeCache(context, mArgs.useColorManagement,
                                            mArgs.precacheToneMapperShaderOnly);
 }
 
@@ -638,6 +686,11 @@ status_t GLESRenderEngine::bindExternalTextureBuffer(uint32_t texName,
         std::lock_guard<std::mutex> lock(mRenderingMutex);
         auto cachedImage = mImageCache.find(buffer->getId());
         found = (cachedImage != mImageCache.end());
+        if (found) {
+            mImageCacheHits++;
+        } else {
+            mImageCacheMisses++;
+        }
     }
 
     // If we couldn't find the image in the cache at this time, then either
@@ -666,8 +719,11 @@ status_t GLESRenderEngine::bindExternalTextureBuffer(uint32_t texName,
             return NO_INIT;
         }
 
-        bindExternalTextureImage(texName, *cachedImage->second);
+        CachedImage& cached = cachedImage->second;
+        bindExternalTextureImage(texName, *cached.image);
         mTextureView.insert_or_assign(texName, buffer->getId());
+        cached.lastUsedFrame = mFrameCount;
+        mImageLru.splice(mImageLru.begin(), mImageLru, cached.lruPosition);
     }
 
     // Wait for the new buffer to be ready.
@@ -731,6 +787,7 @@ status_t GLESRenderEngine::cacheExternalTextureBufferInternal(const sp<GraphicBu
         return NO_INIT;
     }
 
+    std::vector<std::unique_ptr<Image>> evicted;
     {
         std::lock_guard<std::mutex> lock(mRenderingMutex);
         if (mImageCache.count(buffer->getId()) > 0) {
@@ -738,12 +795,42 @@ status_t GLESRenderEngine::cacheExternalTextureBufferInternal(const sp<GraphicBu
             // so bail out if another thread won.
             return NO_ERROR;
         }
-        mImageCache.insert(std::make_pair(buffer->getId(), std::move(newImage)));
+        CachedImage cached;
+        cached.image = std::move(newImage);
+        cached.bytes = estimateImageBytes(*buffer);
+        cached.lastUsedFrame = mFrameCount;
+        cached.lruPosition = mImageLru.insert(mImageLru.begin(), buffer->getId());
+        mImageCacheBytes += cached.bytes;
+        mImageCache.insert(std::make_pair(buffer->getId(), std::move(cached)));
+        evicted = evictImagesLocked();
     }
+    // The evicted images are destroyed here, without the lock held.
 
     return NO_ERROR;
 }
 
+std::vector<std::unique_ptr<Image>> GLESRenderEngine::evictImagesLocked() {
+    std::vector<std::unique_ptr<Image>> evicted;
+    if (mImageCacheBudget == 0) {
+        return evicted;
+    }
+    while (mImageCacheBytes > mImageCacheBudget && !mImageLru.empty()) {
+        auto cachedImage = mImageCache.find(mImageLru.back());
+        CachedImage& cached = cachedImage->second;
+        if (cached.lastUsedFrame + IMAGE_CACHE_IDLE_FRAMES > mFrameCount) {
+            // The rest of the list was used even more recently.
+            break;
+        }
+        ALOGV("Evicting image for buffer: %" PRIu64, cachedImage->first);
+        evicted.push_back(std::move(cached.image));
+        mImageCacheBytes -= cached.bytes;
+        mImageCacheEvictions++;
+        mImageLru.pop_back();
+        mImageCache.erase(cachedImage);
+    }
+    return evicted;
+}
+
 void GLESRenderEngine::unbindExternalTextureBuffer(uint64_t bufferId) {
     mImageManager->releaseAsync(bufferId, nullptr);
 }
@@ -765,7 +852,9 @@ void GLESRenderEngine::unbindExternalTextureBufferInternal(uint64_t bufferId) {
             ALOGV("Destroying image for buffer: %" PRIu64, bufferId);
             // Move the buffer out of cache first, so that we can destroy
             // without holding the cache's lock.
-            image = std::move(cachedImage->second);
+            image = std::move(cachedImage->second.image);
+            mImageCacheBytes -= cachedImage->second.bytes;
+            mImageLru.erase(cachedImage->second.lruPosition);
             mImageCache.erase(bufferId);
             return;
         }
@@ -773,6 +862,75 @@ void GLESRenderEngine::unbindExternalTextureBufferInternal(uint64_t bufferId) {
     ALOGV("Failed to find image for buffer: %" PRIu64, bufferId);
 }
 
+// Whether a layer is a plain solid color quad, which drawSolidColorBatch can draw along with the
+// layers next to it.
+static bool isBatchableSolidColor(const LayerSettings& layer) {
+    return layer.source.buffer.buffer == nullptr && layer.shadow.length <= 0.0f &&
+            layer.geometry.roundedCornersRadius <= 0.0f && layer.backgroundBlurRadius == 0;
+}
+
+size_t GLESRenderEngine::getSolidColorBatchSize(const std::vector<const LayerSettings*>& layers,
+                                                size_t first) {
+    const LayerSettings& leader = *layers[first];
+    if (!isBatchableSolidColor(leader)) {
+        return 1;
+    }
+    // Only neighbours are merged, so that the layers are still blended in order.
+    size_t count = 1;
+    while (first + count < layers.size()) {
+        const LayerSettings& layer = *layers[first + count];
+        if (!isBatchableSolidColor(layer) || layer.source.solidColor != leader.source.solidColor ||
+            layer.alpha != leader.alpha || layer.colorTransform != leader.colorTransform ||
+            layer.sourceDataspace != leader.sourceDataspace ||
+            layer.disableBlending != leader.disableBlending) {
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+void GLESRenderEngine::drawSolidColorBatch(const DisplaySettings& display,
+                                           const mat4& projectionMatrix,
+                                           const LayerSettings* const* layers, size_t count) {
+    ATRACE_CALL();
+    // The layers only differ in their geometry, which is transformed here so that a single
+    // projection draws them all. Positions are kept homogeneous, so any transform is exact.
+    Mesh mesh = Mesh::Builder()
+                        .setPrimitive(Mesh::TRIANGLES)
+                        .setVertices(6 * count /* count */, 4 /* size */)
+                        .build();
+    Mesh::VertexArray<vec4> position(mesh.getPositionArray<vec4>());
+    for (size_t i = 0; i < count; i++) {
+        const FloatRect& bounds = layers[i]->geometry.boundaries;
+        const mat4& transform = layers[i]->geometry.positionTransform;
+        const vec4 leftTop = transform * vec4(bounds.left, bounds.top, 0.0f, 1.0f);
+        const vec4 rightBottom = transform * vec4(bounds.right, bounds.bottom, 0.0f, 1.0f);
+        position[6 * i + 0] = leftTop;
+        position[6 * i + 1] = transform * vec4(bounds.left, bounds.bottom, 0.0f, 1.0f);
+        position[6 * i + 2] = rightBottom;
+        position[6 * i + 3] = leftTop;
+        position[6 * i + 4] = rightBottom;
+        position[6 * i + 5] = transform * vec4(bounds.right, bounds.top, 0.0f, 1.0f);
+    }
+
+    const LayerSettings& leader = *layers[0];
+    mState.maxMasteringLuminance = leader.source.buffer.maxMasteringLuminance;
+    mState.maxContentLuminance = leader.source.buffer.maxContentLuminance;
+    mState.projectionMatrix = projectionMatrix;
+    setColorTransform(display.colorTransform * leader.colorTransform);
+
+    const half3 solidColor = leader.source.solidColor;
+    const half4 color = half4(solidColor.r, solidColor.g, solidColor.b, leader.alpha);
+    setupLayerBlending(true /* premultipliedAlpha */, false /* opaque */,
+                       true /* disableTexture */, color, 0.0f /* cornerRadius */);
+    if (leader.disableBlending) {
+        glDisable(GL_BLEND);
+    }
+    setSourceDataSpace(leader.sourceDataspace);
+    drawMesh(mesh);
+}
+
 FloatRect GLESRenderEngine::setupLayerCropping(const LayerSettings& layer, Mesh& mesh) {
     // Translate win by the rounded corners rect coordinates, to have all values in
     // layer coordinate space.
@@ -793,7 +951,8 @@ FloatRect GLESRenderEngine::setupLayerCropping(const LayerSettings& layer, Mesh&
 }
 
 void GLESRenderEngine::handleRoundedCorners(const DisplaySettings& display,
-                                            const LayerSettings& layer, const Mesh& mesh) {
+                                            const LayerSettings& layer, const Mesh& mesh,
+                                            const Rect& damage) {
     // We separate the layer into 3 parts essentially, such that we only turn on blending for the
     // top rectangle and the bottom rectangle, and turn off blending for the middle rectangle.
     FloatRect bounds = layer.geometry.roundedCornersCrop;
@@ -858,26 +1017,40 @@ void GLESRenderEngine::handleRoundedCorners(const DisplaySettings& display,
                        std::max(leftTopCoordinateInBuffer[0], rightBottomCoordinateInBuffer[0]),
                        std::max(leftTopCoordinateInBuffer[1], rightBottomCoordinateInBuffer[1]));
 
+    // The scissors below replace the one limiting drawing to the damage, so they need to be
+    // limited to it themselves.
+    const auto setDamagedScissor = [&](const Rect& rect) {
+        Rect damagedRect = rect;
+        if (damage.isValid()) {
+            rect.intersect(damage, &damagedRect);
+        }
+        setScissor(damagedRect);
+    };
+
     // Finally, we cut the layer into 3 parts, with top and bottom parts having rounded corners
     // and the middle part without rounded corners.
     const int32_t radius = ceil(layer.geometry.roundedCornersRadius);
     const Rect topRect(bounds.left, bounds.top, bounds.right, bounds.top + radius);
-    setScissor(topRect);
+    setDamagedScissor(topRect);
     drawMesh(mesh);
     const Rect bottomRect(bounds.left, bounds.bottom - radius, bounds.right, bounds.bottom);
-    setScissor(bottomRect);
+    setDamagedScissor(bottomRect);
     drawMesh(mesh);
 
     // The middle part of the layer can turn off blending.
     if (topRect.bottom < bottomRect.top) {
         const Rect middleRect(bounds.left, bounds.top + radius, bounds.right,
                               bounds.bottom - radius);
-        setScissor(middleRect);
+        setDamagedScissor(middleRect);
         mState.cornerRadius = 0.0;
         disableBlending();
         drawMesh(mesh);
     }
-    disableScissor();
+    if (damage.isValid()) {
+        setScissor(damage);
+    } else {
+        disableScissor();
+    }
 }
 
 status_t GLESRenderEngine::bindFrameBuffer(Framebuffer* framebuffer) {
@@ -912,6 +1085,11 @@ void GLESRenderEngine::unbindFrameBuffer(Framebuffer* /*framebuffer*/) {
 bool GLESRenderEngine::cleanupPostRender(CleanupMode mode) {
     ATRACE_CALL();
 
+    {
+        std::lock_guard<std::mutex> lock(mFramebufferImageCacheMutex);
+        evictTransientFramebufferImagesLocked(systemTime(), mode == CleanupMode::CLEAN_ALL);
+    }
+
     if (mPriorResourcesCleaned ||
         (mLastDrawFence != nullptr && mLastDrawFence->getStatus() != Fence::Status::Signaled)) {
         // If we don't have a prior frame needing cleanup, then don't do anything.
@@ -939,6 +1117,8 @@ bool GLESRenderEngine::cleanupPostRender(CleanupMode mode) {
         {
             std::lock_guard<std::mutex> lock(mRenderingMutex);
             mImageCache.clear();
+            mImageLru.clear();
+            mImageCacheBytes = 0;
         }
     }
 
@@ -992,13 +1172,32 @@ EGLImageKHR GLESRenderEngine::createFramebufferImageIfNeeded(ANativeWindowBuffer
                                                              bool isProtected,
                                                              bool useFramebufferCache) {
     sp<GraphicBuffer> graphicBuffer = GraphicBuffer::from(nativeBuffer);
-    if (useFramebufferCache) {
+    const uint64_t bufferId = graphicBuffer->getId();
+    const nsecs_t now = systemTime();
+    {
         std::lock_guard<std::mutex> lock(mFramebufferImageCacheMutex);
-        for (const auto& image : mFramebufferImageCache) {
-            if (image.first == graphicBuffer->getId()) {
-                return image.second;
+        if (useFramebufferCache) {
+            for (const auto& image : mFramebufferImageCache) {
+                if (image.first == bufferId) {
+                    mFramebufferImageHits++;
+                    return image.second;
+                }
+            }
+        } else {
+            evictTransientFramebufferImagesLocked(now);
+            for (auto it = mTransientFramebufferImages.begin();
+                 it != mTransientFramebufferImages.end(); ++it) {
+                if (it->bufferId == bufferId && it->isProtected == isProtected) {
+                    TransientFramebufferImage image = *it;
+                    image.lastUsedTime = now;
+                    mTransientFramebufferImages.erase(it);
+                    mTransientFramebufferImages.push_front(image);
+                    mFramebufferImageHits++;
+                    return image.image;
+                }
             }
         }
+        mFramebufferImageMisses++;
     }
     EGLint attributes[] = {
             isProtected ? EGL_PROTECTED_CONTENT_EXT : EGL_NONE,
@@ -1016,8 +1215,17 @@ EGLImageKHR GLESRenderEngine::createFramebufferImageIfNeeded(ANativeWindowBuffer
                 eglDestroyImageKHR(mEGLDisplay, expired);
                 DEBUG_EGL_IMAGE_TRACKER_DESTROY();
             }
-            mFramebufferImageCache.push_back({graphicBuffer->getId(), image});
+            mFramebufferImageCache.push_back({bufferId, image});
+        }
+    } else if (image != EGL_NO_IMAGE_KHR) {
+        std::lock_guard<std::mutex> lock(mFramebufferImageCacheMutex);
+        if (mTransientFramebufferImages.size() >= kMaxTransientFramebufferImages) {
+            eglDestroyImageKHR(mEGLDisplay, mTransientFramebufferImages.back().image);
+            DEBUG_EGL_IMAGE_TRACKER_DESTROY();
+            mTransientFramebufferImages.pop_back();
+            mTransientFramebufferImageEvictions++;
         }
+        mTransientFramebufferImages.push_front({bufferId, isProtected, image, now});
     }
 
     if (image != EGL_NO_IMAGE_KHR) {
@@ -1026,6 +1234,18 @@ EGLImageKHR GLESRenderEngine::createFramebufferImageIfNeeded(ANativeWindowBuffer
     return image;
 }
 
+void GLESRenderEngine::evictTransientFramebufferImagesLocked(nsecs_t now, bool all) {
+    while (!mTransientFramebufferImages.empty() &&
+           (all ||
+            now - mTransientFramebufferImages.back().lastUsedTime >
+                    kTransientFramebufferImageTimeout)) {
+        eglDestroyImageKHR(mEGLDisplay, mTransientFramebufferImages.back().image);
+        DEBUG_EGL_IMAGE_TRACKER_DESTROY();
+        mTransientFramebufferImages.pop_back();
+        mTransientFramebufferImageEvictions++;
+    }
+}
+
 status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
                                       const std::vector<const LayerSettings*>& layers,
                                       ANativeWindowBuffer* const buffer,
@@ -1051,6 +1271,27 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         return BAD_VALUE;
     }
 
+    {
+        std::vector<sp<GraphicBuffer>> uncached;
+        std::vector<std::unique_ptr<Image>> evicted;
+        {
+            std::lock_guard<std::mutex> lock(mRenderingMutex);
+            mFrameCount++;
+            for (auto layer : layers) {
+                const sp<GraphicBuffer>& layerBuffer = layer->source.buffer.buffer;
+                if (layerBuffer != nullptr && mImageCache.count(layerBuffer->getId()) == 0) {
+                    uncached.push_back(layerBuffer);
+                }
+            }
+            evicted = evictImagesLocked();
+        }
+        // Have the ImageManager thread create the images this frame is missing while the first
+        // layers are drawn, rather than one at a time as each layer binds its buffer.
+        for (const sp<GraphicBuffer>& layerBuffer : uncached) {
+            mImageManager->cacheAsync(layerBuffer, nullptr);
+        }
+    }
+
     std::unique_ptr<BindNativeBufferAsFramebuffer> fbo;
     // Gathering layers that requested blur, we'll need them to decide when to render to an
     // offscreen buffer, and when to render to the native buffer.
@@ -1085,6 +1326,14 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         }
     }
 
+    // If the caller knows the buffer already holds most of the result, only the damaged part of
+    // it is cleared and drawn. Blurs sample everything drawn below them into an offscreen buffer,
+    // so they always redraw the whole buffer.
+    const Rect damage = blurLayersSize == 0 ? display.damage : Rect::INVALID_RECT;
+    if (damage.isValid()) {
+        setScissor(damage);
+    }
+
     // clear the entire buffer, sometimes when we reuse buffers we'd persist
     // ghost images otherwise.
     // we also require a full transparent framebuffer for overlays. This is
@@ -1108,7 +1357,8 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
                         .setTexCoords(2 /* size */)
                         .setCropCoords(2 /* size */)
                         .build();
-    for (auto const layer : layers) {
+    for (size_t i = 0; i < layers.size(); i++) {
+        const LayerSettings* const layer = layers[i];
         if (blurLayers.size() > 0 && blurLayers.front() == layer) {
             blurLayers.pop_front();
 
@@ -1148,6 +1398,13 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
             }
         }
 
+        const size_t batchSize = getSolidColorBatchSize(layers, i);
+        if (batchSize > 1) {
+            drawSolidColorBatch(display, projectionMatrix, &layers[i], batchSize);
+            i += batchSize - 1;
+            continue;
+        }
+
         mState.maxMasteringLuminance = layer->source.buffer.maxMasteringLuminance;
         mState.maxContentLuminance = layer->source.buffer.maxContentLuminance;
         mState.projectionMatrix = projectionMatrix * layer->geometry.positionTransform;
@@ -1210,7 +1467,7 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         // is the only reason it needs to turn on blending, otherwise, we handle it like the
         // usual way since it needs to turn on blending anyway.
         else if (layer->geometry.roundedCornersRadius > 0.0 && color.a >= 1.0f && isOpaque) {
-            handleRoundedCorners(display, *layer, mesh);
+            handleRoundedCorners(display, *layer, mesh, damage);
         } else {
             drawMesh(mesh);
         }
@@ -1223,6 +1480,10 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         }
     }
 
+    if (damage.isValid()) {
+        disableScissor();
+    }
+
     if (drawFence != nullptr) {
         *drawFence = flush();
     }
@@ -1363,6 +1624,67 @@ void GLESRenderEngine::drawMesh(const Mesh& mesh) {
                               mesh.getByteStride(), mesh.getShadowParams());
     }
 
+    useManagedProgram();
+
+    if (mState.drawShadows) {
+        glDrawElements(mesh.getPrimitive(), mesh.getIndexCount(), GL_UNSIGNED_SHORT,
+                       mesh.getIndices());
+    } else {
+        glDrawArrays(mesh.getPrimitive(), 0, mesh.getVertexCount());
+    }
+
+    if (mUseColorManagement && outputDebugPPMs) {
+        static uint64_t managedColorFrameCount = 0;
+        std::ostringstream out;
+        out << "/data/texture_out" << managedColorFrameCount++;
+        writePPM(out.str().c_str(), mVpWidth, mVpHeight);
+    }
+
+    if (mesh.getTexCoordsSize()) {
+        glDisableVertexAttribArray(Program::texCoords);
+    }
+
+    if (mState.cornerRadius > 0.0f) {
+        glDisableVertexAttribArray(Program::cropCoords);
+    }
+
+    if (mState.drawShadows) {
+        glDisableVertexAttribArray(Program::shadowColor);
+        glDisableVertexAttribArray(Program::shadowParams);
+    }
+}
+
+void GLESRenderEngine::drawShadow(const GLShadowCache::Shadow& shadow) {
+    ATRACE_CALL();
+    if (shadow.indexCount == 0) {
+        return;
+    }
+
+    // The attribute pointers are offsets into the vertex buffer bound while they are set.
+    shadow.vertices.bind();
+    glVertexAttribPointer(Program::position, shadow.vertexSize, GL_FLOAT, GL_FALSE,
+                          shadow.byteStride, 0 /* offset */);
+    glEnableVertexAttribArray(Program::shadowColor);
+    glVertexAttribPointer(Program::shadowColor, shadow.shadowColorSize, GL_FLOAT, GL_FALSE,
+                          shadow.byteStride,
+                          reinterpret_cast<const GLvoid*>(shadow.shadowColorOffset));
+    glEnableVertexAttribArray(Program::shadowParams);
+    glVertexAttribPointer(Program::shadowParams, shadow.shadowParamsSize, GL_FLOAT, GL_FALSE,
+                          shadow.byteStride,
+                          reinterpret_cast<const GLvoid*>(shadow.shadowParamsOffset));
+    shadow.vertices.unbind();
+
+    useManagedProgram();
+
+    shadow.indices.bind();
+    glDrawElements(shadow.primitive, shadow.indexCount, GL_UNSIGNED_SHORT, 0 /* offset */);
+    shadow.indices.unbind();
+
+    glDisableVertexAttribArray(Program::shadowColor);
+    glDisableVertexAttribArray(Program::shadowParams);
+}
+
+void GLESRenderEngine::useManagedProgram() {
     Description managedState = mState;
     // By default, DISPLAY_P3 is the only supported wide color output. However,
     // when HDR content is present, hardware composer may be able to handle
@@ -1464,33 +1786,6 @@ void GLESRenderEngine::drawMesh(const Mesh& mesh) {
 
     ProgramCache::getInstance().useProgram(mInProtectedContext ? mProtectedEGLContext : mEGLContext,
                                            managedState);
-
-    if (mState.drawShadows) {
-        glDrawElements(mesh.getPrimitive(), mesh.getIndexCount(), GL_UNSIGNED_SHORT,
-                       mesh.getIndices());
-    } else {
-        glDrawArrays(mesh.getPrimitive(), 0, mesh.getVertexCount());
-    }
-
-    if (mUseColorManagement && outputDebugPPMs) {
-        static uint64_t managedColorFrameCount = 0;
-        std::ostringstream out;
-        out << "/data/texture_out" << managedColorFrameCount++;
-        writePPM(out.str().c_str(), mVpWidth, mVpHeight);
-    }
-
-    if (mesh.getTexCoordsSize()) {
-        glDisableVertexAttribArray(Program::texCoords);
-    }
-
-    if (mState.cornerRadius > 0.0f) {
-        glDisableVertexAttribArray(Program::cropCoords);
-    }
-
-    if (mState.drawShadows) {
-        glDisableVertexAttribArray(Program::shadowColor);
-        glDisableVertexAttribArray(Program::shadowParams);
-    }
 }
 
 size_t GLESRenderEngine::getMaxTextureSize() const {
@@ -1520,9 +1815,16 @@ void GLESRenderEngine::dump(std::string& result) {
     StringAppendF(&result, "RenderEngine last dataspace conversion: (%s) to (%s)\n",
                   dataspaceDetails(static_cast<android_dataspace>(mDataSpace)).c_str(),
                   dataspaceDetails(static_cast<android_dataspace>(mOutputDataSpace)).c_str());
+    StringAppendF(&result, "RenderEngine shadow cache hits: %zu, misses: %zu\n",
+                  mShadowCache.getHitCount(), mShadowCache.getMissCount());
     {
         std::lock_guard<std::mutex> lock(mRenderingMutex);
         StringAppendF(&result, "RenderEngine image cache size: %zu\n", mImageCache.size());
+        StringAppendF(&result,
+                      "RenderEngine image cache bytes: %zu (budget %zu), hits: %" PRIu64
+                      ", misses: %" PRIu64 ", evictions: %" PRIu64 "\n",
+                      mImageCacheBytes, mImageCacheBudget, mImageCacheHits, mImageCacheMisses,
+                      mImageCacheEvictions);
         StringAppendF(&result, "Dumping buffer ids...\n");
         for (const auto& [id, unused] : mImageCache) {
             StringAppendF(&result, "0x%" PRIx64 "\n", id);
@@ -1536,6 +1838,17 @@ void GLESRenderEngine::dump(std::string& result) {
         for (const auto& [id, unused] : mFramebufferImageCache) {
             StringAppendF(&result, "0x%" PRIx64 "\n", id);
         }
+        StringAppendF(&result, "RenderEngine transient framebuffer images: %zu (max %zu)\n",
+                      mTransientFramebufferImages.size(), kMaxTransientFramebufferImages);
+        for (const auto& image : mTransientFramebufferImages) {
+            StringAppendF(&result, "0x%" PRIx64 "%s\n", image.bufferId,
+                          image.isProtected ? " (protected)" : "");
+        }
+        StringAppendF(&result,
+                      "RenderEngine framebuffer images: %" PRIu64 " hits, %" PRIu64
+                      " created, %" PRIu64 " transient evictions\n",
+                      mFramebufferImageHits, mFramebufferImageMisses,
+                      mTransientFramebufferImageEvictions);
     }
 }
 
@@ -1680,6 +1993,14 @@ bool GLESRenderEngine::isFramebufferImageCachedForTesting(uint64_t bufferId) {
                        });
 }
 
+bool GLESRenderEngine::isTransientFramebufferImageCachedForTesting(uint64_t bufferId) {
+    std::lock_guard<std::mutex> lock(mFramebufferImageCacheMutex);
+    return std::any_of(mTransientFramebufferImages.cbegin(), mTransientFramebufferImages.cend(),
+                       [=](const TransientFramebufferImage& image) {
+                           return image.bufferId == bufferId;
+                       });
+}
+
 // FlushTracer implementation
 GLESRenderEngine::FlushTracer::FlushTracer(GLESRenderEngine* engine) : mEngine(engine) {
     mThread = std::thread(&GLESRenderEngine::FlushTracer::loop, this);
@@ -1738,30 +2059,21 @@ void GLESRenderEngine::FlushTracer::loop() {
 void GLESRenderEngine::handleShadow(const FloatRect& casterRect, float casterCornerRadius,
                                     const ShadowSettings& settings) {
     ATRACE_CALL();
-    const float casterZ = settings.length / 2.0f;
-    const GLShadowVertexGenerator shadows(casterRect, casterCornerRadius, casterZ,
-                                          settings.casterIsTranslucent, settings.ambientColor,
-                                          settings.spotColor, settings.lightPos,
-                                          settings.lightRadius);
-
-    // setup mesh for both shadows
-    Mesh mesh = Mesh::Builder()
-                        .setPrimitive(Mesh::TRIANGLES)
-                        .setVertices(shadows.getVertexCount(), 2 /* size */)
-                        .setShadowAttrs()
-                        .setIndices(shadows.getIndexCount())
-                        .build();
-
-    Mesh::VertexArray<vec2> position = mesh.getPositionArray<vec2>();
-    Mesh::VertexArray<vec4> shadowColor = mesh.getShadowColorArray<vec4>();
-    Mesh::VertexArray<vec3> shadowParams = mesh.getShadowParamsArray<vec3>();
-    shadows.fillVertices(position, shadowColor, shadowParams);
-    shadows.fillIndices(mesh.getIndicesArray());
+    GLShadowCache::Key key;
+    key.casterRect = casterRect;
+    key.casterCornerRadius = casterCornerRadius;
+    key.casterZ = settings.length / 2.0f;
+    key.casterIsTranslucent = settings.casterIsTranslucent;
+    key.ambientColor = settings.ambientColor;
+    key.spotColor = settings.spotColor;
+    key.lightPosition = settings.lightPos;
+    key.lightRadius = settings.lightRadius;
+    const GLShadowCache::Shadow& shadow = mShadowCache.get(key);
 
     mState.cornerRadius = 0.0f;
     mState.drawShadows = true;
     setupLayerTexturing(mShadowTexture.getTexture());
-    drawMesh(mesh);
+    drawShadow(shadow);
     mState.drawShadows = false;
 }
 
@@ -19,10 +19,12 @@
 
 #include <condition_variable>
 #include <deque>
+#include <list>
 #include <mutex>
 #include <queue>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
@@ -31,6 +33,8 @@
 #include <renderengine/RenderEngine.h>
 #include <renderengine/private/Description.h>
 #include <sys/types.h>
+#include <utils/Timers.h>
+#include "GLShadowCache.h"
 #include "GLShadowTexture.h"
 #include "ImageManager.h"
 
@@ -78,7 +82,7 @@ public:
     bool cleanupPostRender(CleanupMode mode) override;
 
     EGLDisplay getEGLDisplay() const { return mEGLDisplay; }
-    // Creates an output image for rendering to
+    // Creates an output image for rendering to, or returns a cached one. The engine owns it.
     EGLImageKHR createFramebufferImageIfNeeded(ANativeWindowBuffer* nativeBuffer, bool isProtected,
                                                bool useFramebufferCache)
             EXCLUDES(mFramebufferImageCacheMutex);
@@ -95,6 +99,9 @@ public:
     // Returns true iff mFramebufferImageCache contains an image keyed by bufferId
     bool isFramebufferImageCachedForTesting(uint64_t bufferId)
             EXCLUDES(mFramebufferImageCacheMutex);
+    // Returns true iff mTransientFramebufferImages contains an image keyed by bufferId
+    bool isTransientFramebufferImageCachedForTesting(uint64_t bufferId)
+            EXCLUDES(mFramebufferImageCacheMutex);
     // These are wrappers around public methods above, but exposing Barrier
     // objects so that tests can block.
     std::shared_ptr<ImageManager::Barrier> cacheExternalTextureBufferForTesting(
@@ -133,6 +140,9 @@ private:
     status_t cacheExternalTextureBufferInternal(const sp<GraphicBuffer>& buffer)
             EXCLUDES(mRenderingMutex);
     void unbindExternalTextureBufferInternal(uint64_t bufferId) EXCLUDES(mRenderingMutex);
+    // Moves the images over budget out of mImageCache, so that the caller destroys them
+    // without the lock held.
+    std::vector<std::unique_ptr<Image>> evictImagesLocked() REQUIRES(mRenderingMutex);
 
     // A data space is considered HDR data space if it has BT2020 color space
     // with PQ or HLG transfer function.
@@ -151,8 +161,9 @@ private:
     // for the majority of the layer. The rounded corners needs to turn on blending such that
     // we can set the alpha value correctly, however, only the corners need this, and since
     // blending is an expensive operation, we want to turn off blending when it's not necessary.
+    // Only the part of the layer within the damage is drawn, if the damage is valid.
     void handleRoundedCorners(const DisplaySettings& display, const LayerSettings& layer,
-                              const Mesh& mesh);
+                              const Mesh& mesh, const Rect& damage);
     base::unique_fd flush();
     bool finish();
     bool waitFence(base::unique_fd fenceFd);
@@ -160,6 +171,11 @@ private:
     void fillRegionWithColor(const Region& region, float red, float green, float blue, float alpha);
     void handleShadow(const FloatRect& casterRect, float casterCornerRadius,
                       const ShadowSettings& shadowSettings);
+    // Number of layers from first on that drawSolidColorBatch can draw in a single call, or 1.
+    static size_t getSolidColorBatchSize(const std::vector<const LayerSettings*>& layers,
+                                         size_t first);
+    void drawSolidColorBatch(const DisplaySettings& display, const mat4& projectionMatrix,
+                             const LayerSettings* const* layers, size_t count);
     void setupLayerBlending(bool premultipliedAlpha, bool opaque, bool disableTexture,
                             const half4& color, float cornerRadius);
     void setupLayerTexturing(const Texture& texture);
@@ -177,6 +193,13 @@ private:
 
     // drawing
     void drawMesh(const Mesh& mesh);
+    void drawShadow(const GLShadowCache::Shadow& shadow);
+    // Selects the program for mState, with the color conversions the output dataspace needs.
+    void useManagedProgram();
+    // Destroys the transient framebuffer images last drawn into before now minus the timeout,
+    // or all of them.
+    void evictTransientFramebufferImagesLocked(nsecs_t now, bool all = false)
+            REQUIRES(mFramebufferImageCacheMutex);
 
     EGLDisplay mEGLDisplay;
     EGLConfig mEGLConfig;
@@ -184,12 +207,16 @@ private:
     EGLSurface mDummySurface;
     EGLContext mProtectedEGLContext;
     EGLSurface mProtectedDummySurface;
+    // Context the shader cache is primed on in the background, or EGL_NO_CONTEXT.
+    EGLContext mPrimeCacheEGLContext = EGL_NO_CONTEXT;
+    EGLSurface mPrimeCacheDummySurface = EGL_NO_SURFACE;
     GLint mMaxViewportDims[2];
     GLint mMaxTextureSize;
     GLuint mVpWidth;
     GLuint mVpHeight;
     Description mState;
     GLShadowTexture mShadowTexture;
+    GLShadowCache mShadowCache;
 
     mat4 mSrgbToXyz;
     mat4 mDisplayP3ToXyz;
@@ -214,6 +241,23 @@ private:
     // Cache of output images, keyed by corresponding GraphicBuffer ID.
     std::deque<std::pair<uint64_t, EGLImageKHR>> mFramebufferImageCache
             GUARDED_BY(mFramebufferImageCacheMutex);
+    // Output images of buffers drawn without the framebuffer cache, most recently used first.
+    // Screenshots and region sampling draw into the same few buffers again and again, so their
+    // images are kept for a short while rather than created and destroyed for every capture.
+    struct TransientFramebufferImage {
+        uint64_t bufferId;
+        bool isProtected;
+        EGLImageKHR image;
+        nsecs_t lastUsedTime;
+    };
+    std::deque<TransientFramebufferImage> mTransientFramebufferImages
+            GUARDED_BY(mFramebufferImageCacheMutex);
+    static constexpr size_t kMaxTransientFramebufferImages = 2;
+    // Transient images not drawn into for this long are destroyed.
+    static constexpr nsecs_t kTransientFramebufferImageTimeout = ms2ns(1000);
+    uint64_t mFramebufferImageHits GUARDED_BY(mFramebufferImageCacheMutex) = 0;
+    uint64_t mFramebufferImageMisses GUARDED_BY(mFramebufferImageCacheMutex) = 0;
+    uint64_t mTransientFramebufferImageEvictions GUARDED_BY(mFramebufferImageCacheMutex) = 0;
     // The only reason why we have this mutex is so that we don't segfault when
     // dumping info.
     std::mutex mFramebufferImageCacheMutex;
@@ -229,7 +273,30 @@ private:
     const bool mUseColorManagement = false;
 
     // Cache of GL images that we'll store per GraphicBuffer ID
-    std::unordered_map<uint64_t, std::unique_ptr<Image>> mImageCache GUARDED_BY(mRenderingMutex);
+    struct CachedImage {
+        std::unique_ptr<Image> image;
+        // Estimated size of the buffer the image maps.
+        size_t bytes = 0;
+        // Value of mFrameCount when the image was last bound or created.
+        uint64_t lastUsedFrame = 0;
+        // Position in mImageLru.
+        std::list<uint64_t>::iterator lruPosition;
+    };
+    std::unordered_map<uint64_t, CachedImage> mImageCache GUARDED_BY(mRenderingMutex);
+    // Buffer ids of mImageCache, most recently used first.
+    std::list<uint64_t> mImageLru GUARDED_BY(mRenderingMutex);
+    size_t mImageCacheBytes GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mImageCacheHits GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mImageCacheMisses GUARDED_BY(mRenderingMutex) = 0;
+    uint64_t mImageCacheEvictions GUARDED_BY(mRenderingMutex) = 0;
+    // Number of drawLayers calls so far.
+    uint64_t mFrameCount GUARDED_BY(mRenderingMutex) = 0;
+    // Once mImageCacheBytes is over this, images idle for IMAGE_CACHE_IDLE_FRAMES frames are
+    // evicted, least recently used first. 0 disables eviction.
+    const size_t mImageCacheBudget;
+    // Images used in this many of the last frames are kept even over budget, since the layers
+    // that show them are likely still on screen.
+    static constexpr uint64_t IMAGE_CACHE_IDLE_FRAMES = 3;
     std::unordered_map<uint32_t, std::optional<uint64_t>> mTextureView;
 
     // Mutex guarding rendering operations, so that:
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "GLShadowCache.h"
+
+#include <utils/Trace.h>
+
+#include "GLShadowVertexGenerator.h"
+
+namespace android {
+namespace renderengine {
+namespace gl {
+
+bool GLShadowCache::Key::operator==(const Key& other) const {
+    return casterRect == other.casterRect && casterCornerRadius == other.casterCornerRadius &&
+            casterZ == other.casterZ && casterIsTranslucent == other.casterIsTranslucent &&
+            ambientColor == other.ambientColor && spotColor == other.spotColor &&
+            lightPosition == other.lightPosition && lightRadius == other.lightRadius;
+}
+
+const GLShadowCache::Shadow& GLShadowCache::get(const Key& key) {
+    for (auto it = mShadows.begin(); it != mShadows.end(); it++) {
+        if (it->first == key) {
+            mHitCount++;
+            mShadows.splice(mShadows.begin(), mShadows, it);
+            return *mShadows.front().second;
+        }
+    }
+
+    mMissCount++;
+    if (mShadows.size() >= kMaxShadows) {
+        mShadows.pop_back();
+    }
+    mShadows.emplace_front(key, generate(key));
+    return *mShadows.front().second;
+}
+
+void GLShadowCache::clear() {
+    mShadows.clear();
+}
+
+std::unique_ptr<GLShadowCache::Shadow> GLShadowCache::generate(const Key& key) {
+    ATRACE_CALL();
+    const GLShadowVertexGenerator shadows(key.casterRect, key.casterCornerRadius, key.casterZ,
+                                          key.casterIsTranslucent, key.ambientColor,
+                                          key.spotColor, key.lightPosition, key.lightRadius);
+
+    // setup mesh for both shadows
+    Mesh mesh = Mesh::Builder()
+                        .setPrimitive(Mesh::TRIANGLES)
+                        .setVertices(shadows.getVertexCount(), 2 /* size */)
+                        .setShadowAttrs()
+                        .setIndices(shadows.getIndexCount())
+                        .build();
+
+    Mesh::VertexArray<vec2> position = mesh.getPositionArray<vec2>();
+    Mesh::VertexArray<vec4> shadowColor = mesh.getShadowColorArray<vec4>();
+    Mesh::VertexArray<vec3> shadowParams = mesh.getShadowParamsArray<vec3>();
+    shadows.fillVertices(position, shadowColor, shadowParams);
+    shadows.fillIndices(mesh.getIndicesArray());
+
+    // The accessors for the raw arrays are only public on a const Mesh.
+    const Mesh& generated = mesh;
+    auto shadow = std::make_unique<Shadow>();
+    shadow->primitive = generated.getPrimitive();
+    shadow->vertices.allocateBuffers(generated.getPositions(),
+                                     generated.getVertexCount() * generated.getStride());
+    shadow->indices.allocateBuffers(generated.getIndices(), generated.getIndexCount());
+    shadow->indexCount = generated.getIndexCount();
+    shadow->byteStride = generated.getByteStride();
+    shadow->vertexSize = generated.getVertexSize();
+    shadow->shadowColorSize = generated.getShadowColorSize();
+    shadow->shadowColorOffset =
+            (generated.getShadowColor() - generated.getPositions()) * sizeof(float);
+    shadow->shadowParamsSize = generated.getShadowParamsSize();
+    shadow->shadowParamsOffset =
+            (generated.getShadowParams() - generated.getPositions()) * sizeof(float);
+    return shadow;
+}
+
+} // namespace gl
+} // namespace renderengine
+} // namespace android
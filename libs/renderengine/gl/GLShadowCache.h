@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <utility>
+
+#include <math/vec3.h>
+#include <math/vec4.h>
+#include <renderengine/Mesh.h>
+#include <ui/FloatRect.h>
+
+#include "GLVertexBuffer.h"
+
+namespace android {
+namespace renderengine {
+namespace gl {
+
+/**
+ * Keeps the tessellated shadows of recently drawn casters in vertex buffers, so that a caster
+ * whose rect, corners, elevation, colors and light did not change is drawn again without
+ * generating or uploading its geometry. The least recently drawn shadow is dropped when the
+ * cache is full.
+ *
+ * Must be used with the GL context current. The buffers are bound to GL_ARRAY_BUFFER and
+ * GL_ELEMENT_ARRAY_BUFFER while the shadow is set up and drawn.
+ */
+class GLShadowCache {
+public:
+    // Everything GLShadowVertexGenerator depends on.
+    struct Key {
+        FloatRect casterRect;
+        float casterCornerRadius = 0.0f;
+        float casterZ = 0.0f;
+        bool casterIsTranslucent = false;
+        vec4 ambientColor;
+        vec4 spotColor;
+        vec3 lightPosition;
+        float lightRadius = 0.0f;
+
+        bool operator==(const Key& other) const;
+    };
+
+    // The geometry of both shadows of a caster, interleaved as in the Mesh it was generated in.
+    struct Shadow {
+        Mesh::Primitive primitive = Mesh::TRIANGLES;
+        GLVertexBuffer vertices{GL_ARRAY_BUFFER};
+        GLVertexBuffer indices{GL_ELEMENT_ARRAY_BUFFER};
+        size_t indexCount = 0;
+        size_t byteStride = 0;
+        size_t vertexSize = 0;
+        size_t shadowColorSize = 0;
+        size_t shadowColorOffset = 0;
+        size_t shadowParamsSize = 0;
+        size_t shadowParamsOffset = 0;
+    };
+
+    static constexpr size_t kMaxShadows = 32;
+
+    // Returns the shadow for key, generating and uploading it if it is not cached.
+    const Shadow& get(const Key& key);
+
+    // Drops every shadow.
+    void clear();
+
+    size_t getHitCount() const { return mHitCount; }
+    size_t getMissCount() const { return mMissCount; }
+
+private:
+    static std::unique_ptr<Shadow> generate(const Key& key);
+
+    // Most recently drawn first. There are few entries, so they are searched in order.
+    std::list<std::pair<Key, std::unique_ptr<Shadow>>> mShadows;
+    size_t mHitCount = 0;
+    size_t mMissCount = 0;
+};
+
+} // namespace gl
+} // namespace renderengine
+} // namespace android
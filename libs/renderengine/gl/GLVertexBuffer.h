@@ -32,15 +32,18 @@ class GLESRenderEngine;
 
 class GLVertexBuffer {
 public:
-    explicit GLVertexBuffer();
+    // target is GL_ARRAY_BUFFER for vertex data, or GL_ELEMENT_ARRAY_BUFFER for indices.
+    explicit GLVertexBuffer(GLenum target = GL_ARRAY_BUFFER);
     ~GLVertexBuffer();
 
     void allocateBuffers(const GLfloat data[], const GLuint size);
+    void allocateBuffers(const GLushort data[], const GLuint size);
     uint32_t getBufferName() const { return mBufferName; }
     void bind() const;
     void unbind() const;
 
 private:
+    const GLenum mTarget;
     uint32_t mBufferName;
 };
 
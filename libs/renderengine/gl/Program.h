@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include <GLES2/gl2.h>
 #include <renderengine/private/Description.h>
 #include "ProgramCache.h"
@@ -54,6 +56,9 @@ public:
     };
 
     Program(const ProgramCache::Key& needs, const char* vertex, const char* fragment);
+    /* Loads a program previously returned by getBinary(). Not valid if the driver rejects it. */
+    Program(const ProgramCache::Key& needs, GLenum binaryFormat, const void* binary,
+            GLsizei length);
     ~Program() = default;
 
     /* whether this object is usable */
@@ -71,9 +76,15 @@ public:
     /* set-up uniforms from the description */
     void setUniforms(const Description& desc);
 
+    /* Copies the linked program out of the driver, so that it can be loaded again later */
+    bool getBinary(GLenum* outFormat, std::vector<uint8_t>* outBinary) const;
+
 private:
     GLuint buildShader(const char* source, GLenum type);
 
+    // looks up the uniforms of a linked program and marks this object usable
+    void initUniforms(GLuint programId);
+
     // whether the initialization succeeded
     bool mInitialized;
 
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "ProgramBinaryCache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+
+using android::base::StringPrintf;
+using android::base::unique_fd;
+
+namespace android {
+namespace renderengine {
+namespace gl {
+
+static constexpr uint32_t MAGIC = 0x42505452; // "RTPB"
+// Bump when the layout of the file changes.
+static constexpr uint32_t VERSION = 2;
+
+// Followed by entryCount entries.
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fingerprintHash;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 24);
+
+// Followed by the binary, padded to a multiple of four bytes. The length is 0 for a key that
+// was drawn but has no binary.
+struct EntryHeader {
+    uint32_t key;
+    uint32_t useCount;
+    uint32_t format;
+    uint32_t length;
+};
+static_assert(sizeof(EntryHeader) == 16);
+
+static uint64_t fnv1a(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static size_t padded(size_t length) {
+    return (length + 3) & ~static_cast<size_t>(3);
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& path, const std::string& fingerprint)
+      : mPath(path), mFingerprintHash(fnv1a(fingerprint.data(), fingerprint.size())) {
+    load();
+}
+
+const ProgramBinaryCache::Binary* ProgramBinaryCache::find(uint32_t key) const {
+    auto it = mEntries.find(key);
+    if (it == mEntries.end() || it->second.binary.data.empty()) {
+        return nullptr;
+    }
+    return &it->second.binary;
+}
+
+void ProgramBinaryCache::insert(uint32_t key, Binary binary) {
+    mEntries[key].binary = std::move(binary);
+    mDirty = true;
+}
+
+void ProgramBinaryCache::erase(uint32_t key) {
+    auto it = mEntries.find(key);
+    if (it != mEntries.end() && !it->second.binary.data.empty()) {
+        it->second.binary = Binary();
+        mDirty = true;
+    }
+}
+
+void ProgramBinaryCache::noteUsed(uint32_t key) {
+    uint32_t& useCount = mEntries[key].useCount;
+    if (useCount < UINT32_MAX) {
+        useCount++;
+    }
+    mDirty = true;
+}
+
+uint32_t ProgramBinaryCache::getUseCount(uint32_t key) const {
+    auto it = mEntries.find(key);
+    return it == mEntries.end() ? 0 : it->second.useCount;
+}
+
+std::vector<uint32_t> ProgramBinaryCache::getUsedKeys() const {
+    std::vector<uint32_t> keys;
+    for (const auto& [key, entry] : mEntries) {
+        if (entry.useCount > 0) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+void ProgramBinaryCache::load() {
+    ATRACE_CALL();
+    std::string contents;
+    if (!android::base::ReadFileToString(mPath, &contents)) {
+        return;
+    }
+
+    FileHeader header;
+    if (contents.size() < sizeof(header)) {
+        return;
+    }
+    memcpy(&header, contents.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION) {
+        ALOGW("Ignoring program binaries in %s: unknown format", mPath.c_str());
+        return;
+    }
+
+    size_t offset = sizeof(header);
+    std::unordered_map<uint32_t, Entry> entries;
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        EntryHeader entryHeader;
+        if (contents.size() - offset < sizeof(entryHeader)) {
+            ALOGW("Ignoring program binaries in %s: truncated", mPath.c_str());
+            return;
+        }
+        memcpy(&entryHeader, contents.data() + offset, sizeof(entryHeader));
+        offset += sizeof(entryHeader);
+        if (entryHeader.length > contents.size() - offset ||
+            padded(entryHeader.length) > contents.size() - offset) {
+            ALOGW("Ignoring program binaries in %s: truncated", mPath.c_str());
+            return;
+        }
+        Entry& entry = entries[entryHeader.key];
+        entry.useCount = entryHeader.useCount;
+        entry.binary.format = entryHeader.format;
+        entry.binary.data.assign(contents.data() + offset,
+                                 contents.data() + offset + entryHeader.length);
+        offset += padded(entryHeader.length);
+    }
+    mEntries = std::move(entries);
+
+    if (header.fingerprintHash != mFingerprintHash) {
+        // The driver or the build changed, so none of the binaries can be trusted. Which keys
+        // are drawn most does not depend on the driver, so the counts are kept.
+        ALOGI("Ignoring program binaries in %s: driver changed", mPath.c_str());
+        for (auto& [key, entry] : mEntries) {
+            entry.binary = Binary();
+        }
+        mDirty = true;
+    }
+}
+
+void ProgramBinaryCache::save() {
+    std::string contents;
+    if (serialize(&contents)) {
+        write(contents);
+    }
+}
+
+bool ProgramBinaryCache::serialize(std::string* outContents) {
+    if (!mDirty) {
+        return false;
+    }
+    mDirty = false;
+
+    FileHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.fingerprintHash = mFingerprintHash;
+    header.entryCount = static_cast<uint32_t>(mEntries.size());
+
+    outContents->assign(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& [key, entry] : mEntries) {
+        const std::vector<uint8_t>& data = entry.binary.data;
+        EntryHeader entryHeader = {key, entry.useCount, entry.binary.format,
+                                   static_cast<uint32_t>(data.size())};
+        outContents->append(reinterpret_cast<const char*>(&entryHeader), sizeof(entryHeader));
+        outContents->append(reinterpret_cast<const char*>(data.data()), data.size());
+        outContents->append(padded(data.size()) - data.size(), '\0');
+    }
+    return true;
+}
+
+void ProgramBinaryCache::write(const std::string& contents) const {
+    ATRACE_CALL();
+    // Written aside and renamed into place, so that a crash never leaves a partial file.
+    const std::string tempPath = StringPrintf("%s.%d.tmp", mPath.c_str(), getpid());
+    {
+        unique_fd fd(open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+        if (fd < 0) {
+            ALOGW("Could not create %s: %s", tempPath.c_str(), strerror(errno));
+            return;
+        }
+        if (!android::base::WriteFully(fd, contents.data(), contents.size())) {
+            ALOGW("Could not write %s: %s", tempPath.c_str(), strerror(errno));
+            unlink(tempPath.c_str());
+            return;
+        }
+    }
+    if (rename(tempPath.c_str(), mPath.c_str()) != 0) {
+        ALOGW("Could not rename %s: %s", tempPath.c_str(), strerror(errno));
+        unlink(tempPath.c_str());
+    }
+}
+
+} // namespace gl
+} // namespace renderengine
+} // namespace android
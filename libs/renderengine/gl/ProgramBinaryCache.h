@@ -0,0 +1,93 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SF_RENDER_ENGINE_PROGRAMBINARYCACHE_H
+#define SF_RENDER_ENGINE_PROGRAMBINARYCACHE_H
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace renderengine {
+namespace gl {
+
+/*
+ * Program binaries kept in a single file across boots, so that SurfaceFlinger does not compile
+ * the same shaders again each time it starts, or the first time a rare key is drawn. The file
+ * also counts the boots each key was drawn in, which orders the keys primed at the next boot.
+ *
+ * The binaries are tied to a fingerprint of the driver and the build, and a mismatch drops them
+ * but keeps the counts. Any damaged entry drops the whole file, and programs are compiled from
+ * source as before.
+ */
+class ProgramBinaryCache {
+public:
+    struct Binary {
+        uint32_t format = 0;
+        std::vector<uint8_t> data;
+    };
+
+    ProgramBinaryCache(const std::string& path, const std::string& fingerprint);
+
+    // Returns the binary stored for key, or nullptr.
+    const Binary* find(uint32_t key) const;
+
+    // Replaces the binary stored for key. Nothing is written until save().
+    void insert(uint32_t key, Binary binary);
+
+    // Drops the binary stored for key, for example when the driver rejects it.
+    void erase(uint32_t key);
+
+    // Counts one more boot in which key was drawn. Call at most once per key and boot.
+    void noteUsed(uint32_t key);
+
+    // Returns the number of boots key was drawn in, this one included.
+    uint32_t getUseCount(uint32_t key) const;
+
+    // Returns every key drawn in any boot so far.
+    std::vector<uint32_t> getUsedKeys() const;
+
+    // Writes the file if anything changed since it was loaded or last saved.
+    void save();
+
+    // save() in two steps, so that the file can be written without holding the lock that
+    // guards this object: serialize() returns false if nothing changed, write() needs no state
+    // but the path.
+    bool serialize(std::string* outContents);
+    void write(const std::string& contents) const;
+
+private:
+    struct Entry {
+        Binary binary;
+        uint32_t useCount = 0;
+    };
+
+    void load();
+
+    const std::string mPath;
+    const uint64_t mFingerprintHash;
+    std::unordered_map<uint32_t, Entry> mEntries;
+    bool mDirty = false;
+};
+
+} // namespace gl
+} // namespace renderengine
+} // namespace android
+
+#endif /* SF_RENDER_ENGINE_PROGRAMBINARYCACHE_H */
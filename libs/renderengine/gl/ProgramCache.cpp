@@ -18,12 +18,18 @@
 
 #include "ProgramCache.h"
 
+#include <pthread.h>
+
+#include <algorithm>
+
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <cutils/properties.h>
 #include <log/log.h>
 #include <renderengine/private/Description.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
+#include "GLExtensions.h"
 #include "Program.h"
 
 ANDROID_SINGLETON_STATIC_INSTANCE(android::renderengine::gl::ProgramCache)
@@ -77,10 +83,32 @@ Formatter& dedent(Formatter& f) {
     return f;
 }
 
-void ProgramCache::primeCache(
-        EGLContext context, bool useColorManagement, bool toneMapperShaderOnly) {
-    auto& cache = mCaches[context];
-    uint32_t shaderCount = 0;
+void ProgramCache::initBinaryCache(const std::string& directory) {
+    if (directory.empty()) {
+        return;
+    }
+    GLint formatCount = 0;
+    if (GLExtensions::getInstance().hasProgramBinary()) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formatCount);
+    }
+
+    // Binaries are only good for the driver that produced them, which the GL strings alone do
+    // not always tell apart, so the build is part of the fingerprint too.
+    const GLExtensions& extensions = GLExtensions::getInstance();
+    char build[PROPERTY_VALUE_MAX];
+    property_get("ro.build.fingerprint", build, "");
+    std::string fingerprint = std::string(extensions.getVendor()) + '\n' +
+            extensions.getRenderer() + '\n' + extensions.getVersion() + '\n' + build;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mBinaryCache = std::make_unique<ProgramBinaryCache>(directory + "/renderengine_programs.bin",
+                                                        fingerprint);
+    mUseProgramBinaries = formatCount > 0;
+}
+
+std::vector<ProgramCache::Key> ProgramCache::getPrimeKeys(bool useColorManagement,
+                                                          bool toneMapperShaderOnly) {
+    std::vector<Key> keys;
 
     if (toneMapperShaderOnly) {
         Key shaderKey;
@@ -101,12 +129,9 @@ void ProgramCache::primeCache(
             // Cache Y410 input on or off
             shaderKey.set(Key::Y410_BT2020_MASK, (i & 2) ?
                     Key::Y410_BT2020_ON : Key::Y410_BT2020_OFF);
-            if (cache.count(shaderKey) == 0) {
-                cache.emplace(shaderKey, generateProgram(shaderKey));
-                shaderCount++;
-            }
+            keys.push_back(shaderKey);
         }
-        return;
+        return keys;
     }
 
     uint32_t keyMask = Key::BLEND_MASK | Key::OPACITY_MASK | Key::ALPHA_MASK | Key::TEXTURE_MASK
@@ -114,7 +139,6 @@ void ProgramCache::primeCache(
     // Prime the cache for all combinations of the above masks,
     // leaving off the experimental color matrix mask options.
 
-    nsecs_t timeBefore = systemTime();
     for (uint32_t keyVal = 0; keyVal <= keyMask; keyVal++) {
         Key shaderKey;
         shaderKey.set(keyMask, keyVal);
@@ -122,10 +146,7 @@ void ProgramCache::primeCache(
         if (tex != Key::TEXTURE_OFF && tex != Key::TEXTURE_EXT && tex != Key::TEXTURE_2D) {
             continue;
         }
-        if (cache.count(shaderKey) == 0) {
-            cache.emplace(shaderKey, generateProgram(shaderKey));
-            shaderCount++;
-        }
+        keys.push_back(shaderKey);
     }
 
     // Prime for sRGB->P3 conversion
@@ -146,18 +167,204 @@ void ProgramCache::primeCache(
 
             // Cache texture off option for window transition
             shaderKey.set(Key::TEXTURE_MASK, (i & 8) ? Key::TEXTURE_EXT : Key::TEXTURE_OFF);
-            if (cache.count(shaderKey) == 0) {
-                cache.emplace(shaderKey, generateProgram(shaderKey));
-                shaderCount++;
-            }
+            keys.push_back(shaderKey);
+        }
+    }
+    return keys;
+}
+
+void ProgramCache::primeCache(
+        EGLContext context, bool useColorManagement, bool toneMapperShaderOnly) {
+    uint32_t shaderCount = 0;
+    nsecs_t timeBefore = systemTime();
+    for (const Key& shaderKey : getPrimeKeys(useColorManagement, toneMapperShaderOnly)) {
+        bool generated;
+        getProgram(context, shaderKey, /*inBackground*/ false, &generated);
+        if (generated) {
+            shaderCount++;
         }
     }
+    requestSave();
 
     nsecs_t timeAfter = systemTime();
     float compileTimeMs = static_cast<float>(timeAfter - timeBefore) / 1.0E6;
     ALOGD("shader cache generated - %u shaders in %f ms\n", shaderCount, compileTimeMs);
 }
 
+void ProgramCache::primeCacheInBackground(EGLDisplay display, EGLContext workerContext,
+                                          EGLSurface workerSurface, EGLContext context,
+                                          bool useColorManagement, bool toneMapperShaderOnly) {
+    std::vector<Key> keys = getPrimeKeys(useColorManagement, toneMapperShaderOnly);
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mBackgroundThreadRunning) {
+            ALOGW("Shader cache is already being primed in the background");
+            return;
+        }
+        if (mBinaryCache) {
+            // Keys drawn in previous boots come first, most drawn first, then the fixed set in
+            // its usual order.
+            std::unordered_set<Key::key_t> fixedKeys;
+            for (const Key& key : keys) {
+                fixedKeys.insert(key.mKey);
+            }
+            for (uint32_t usedKey : mBinaryCache->getUsedKeys()) {
+                if (fixedKeys.count(usedKey) == 0) {
+                    Key key;
+                    key.mKey = usedKey;
+                    keys.push_back(key);
+                }
+            }
+            std::stable_sort(keys.begin(), keys.end(),
+                             [this](const Key& lhs, const Key& rhs) REQUIRES(mLock) {
+                                 return mBinaryCache->getUseCount(lhs.mKey) >
+                                         mBinaryCache->getUseCount(rhs.mKey);
+                             });
+        }
+        mBackgroundThreadRunning = true;
+        mStopBackgroundThread = false;
+    }
+
+    // A previous thread may have given up early, without being stopped.
+    if (mBackgroundThread.joinable()) {
+        mBackgroundThread.join();
+    }
+    mBackgroundThread = std::thread(&ProgramCache::backgroundThreadMain, this, display,
+                                    workerContext, workerSurface, context, std::move(keys));
+    pthread_setname_np(mBackgroundThread.native_handle(), "ProgramCache");
+}
+
+void ProgramCache::stopBackgroundThread() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopBackgroundThread = true;
+    }
+    mCondition.notify_all();
+    if (mBackgroundThread.joinable()) {
+        mBackgroundThread.join();
+    }
+}
+
+void ProgramCache::backgroundThreadMain(EGLDisplay display, EGLContext workerContext,
+                                        EGLSurface workerSurface, EGLContext context,
+                                        std::vector<Key> keys) {
+    if (!eglMakeCurrent(display, workerSurface, workerSurface, workerContext)) {
+        ALOGE("Can't make shader cache context current: %#x", eglGetError());
+        std::lock_guard<std::mutex> lock(mLock);
+        mBackgroundThreadRunning = false;
+        return;
+    }
+
+    uint32_t shaderCount = 0;
+    nsecs_t timeBefore = systemTime();
+    for (const Key& shaderKey : keys) {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            if (mStopBackgroundThread) {
+                break;
+            }
+        }
+        bool generated;
+        getProgram(context, shaderKey, /*inBackground*/ true, &generated);
+        if (generated) {
+            shaderCount++;
+        }
+    }
+    nsecs_t timeAfter = systemTime();
+    float compileTimeMs = static_cast<float>(timeAfter - timeBefore) / 1.0E6;
+    ALOGD("shader cache generated in the background - %u shaders in %f ms\n", shaderCount,
+          compileTimeMs);
+
+    save();
+    bool stop = false;
+    while (!stop) {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mCondition.wait(mLock, [&]() REQUIRES(mLock) {
+                return mSaveRequested || mStopBackgroundThread;
+            });
+            mSaveRequested = false;
+            stop = mStopBackgroundThread;
+        }
+        // Saved once more on the way out, for keys drawn just before the engine went away.
+        save();
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    std::lock_guard<std::mutex> lock(mLock);
+    mBackgroundThreadRunning = false;
+}
+
+Program* ProgramCache::getProgram(EGLContext context, const Key& needs, bool inBackground,
+                                  bool* outGenerated) {
+    *outGenerated = false;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mCondition.wait(mLock, [&]() REQUIRES(mLock) {
+            return mGenerating.count(needs.mKey) == 0;
+        });
+        auto& cache = mCaches[context];
+        auto it = cache.find(needs);
+        if (it != cache.end()) {
+            return it->second.get();
+        }
+        mGenerating.insert(needs.mKey);
+    }
+
+    std::unique_ptr<Program> program = generateProgram(needs);
+    if (inBackground) {
+        // Changes to a shared object only reach other contexts once they are complete.
+        glFinish();
+    }
+
+    Program* result;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mGenerating.erase(needs.mKey);
+        result = mCaches[context].emplace(needs, std::move(program)).first->second.get();
+    }
+    mCondition.notify_all();
+    *outGenerated = true;
+    return result;
+}
+
+void ProgramCache::noteUsed(const Key& needs) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!mUsedKeys.insert(needs.mKey).second || !mBinaryCache) {
+            return;
+        }
+        mBinaryCache->noteUsed(needs.mKey);
+    }
+    requestSave();
+}
+
+void ProgramCache::requestSave() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mBackgroundThreadRunning) {
+            mSaveRequested = true;
+            mCondition.notify_all();
+            return;
+        }
+    }
+    save();
+}
+
+void ProgramCache::save() {
+    std::string contents;
+    ProgramBinaryCache* binaryCache;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!mBinaryCache || !mBinaryCache->serialize(&contents)) {
+            return;
+        }
+        binaryCache = mBinaryCache.get();
+    }
+    // Only the background thread saves while it runs, so writes never overlap.
+    binaryCache->write(contents);
+}
+
 ProgramCache::Key ProgramCache::computeKey(const Description& description) {
     Key needs;
     needs.set(Key::TEXTURE_MASK,
@@ -761,34 +968,65 @@ String8 ProgramCache::generateFragmentShader(const Key& needs) {
 std::unique_ptr<Program> ProgramCache::generateProgram(const Key& needs) {
     ATRACE_CALL();
 
+    ProgramBinaryCache::Binary binary;
+    bool useProgramBinaries;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        useProgramBinaries = mBinaryCache && mUseProgramBinaries;
+        if (useProgramBinaries) {
+            if (const ProgramBinaryCache::Binary* cached = mBinaryCache->find(needs.mKey)) {
+                binary = *cached;
+            }
+        }
+    }
+    if (!binary.data.empty()) {
+        auto program = std::make_unique<Program>(needs, binary.format, binary.data.data(),
+                                                 static_cast<GLsizei>(binary.data.size()));
+        if (program->isValid()) {
+            return program;
+        }
+        std::lock_guard<std::mutex> lock(mLock);
+        mBinaryCache->erase(needs.mKey);
+    }
+
     // vertex shader
     String8 vs = generateVertexShader(needs);
 
     // fragment shader
     String8 fs = generateFragmentShader(needs);
 
-    return std::make_unique<Program>(needs, vs.string(), fs.string());
+    auto program = std::make_unique<Program>(needs, vs.string(), fs.string());
+    if (useProgramBinaries) {
+        GLenum format;
+        ProgramBinaryCache::Binary compiled;
+        if (program->getBinary(&format, &compiled.data)) {
+            compiled.format = format;
+            std::lock_guard<std::mutex> lock(mLock);
+            mBinaryCache->insert(needs.mKey, std::move(compiled));
+        }
+    }
+    return program;
 }
 
 void ProgramCache::useProgram(EGLContext context, const Description& description) {
     // generate the key for the shader based on the description
     Key needs(computeKey(description));
-
-    // look-up the program in the cache
-    auto& cache = mCaches[context];
-    auto it = cache.find(needs);
-    if (it == cache.end()) {
-        // we didn't find our program, so generate one...
-        nsecs_t time = systemTime();
-        it = cache.emplace(needs, generateProgram(needs)).first;
+    noteUsed(needs);
+
+    // look-up the program in the cache, or generate it
+    nsecs_t time = systemTime();
+    bool generated;
+    Program* program = getProgram(context, needs, /*inBackground*/ false, &generated);
+    if (generated) {
+        // Rare keys are the ones that stall a frame, so keep them as soon as they are built.
+        requestSave();
         time = systemTime() - time;
 
-        ALOGV(">>> generated new program for context %p: needs=%08X, time=%u ms (%zu programs)",
-              context, needs.mKey, uint32_t(ns2ms(time)), cache.size());
+        ALOGV(">>> generated new program for context %p: needs=%08X, time=%u ms",
+              context, needs.mKey, uint32_t(ns2ms(time)));
     }
 
     // here we have a suitable program for this description
-    std::unique_ptr<Program>& program = it->second;
     if (program->isValid()) {
         program->use();
         program->setUniforms(description);
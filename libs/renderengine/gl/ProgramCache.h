@@ -17,14 +17,22 @@
 #ifndef SF_RENDER_ENGINE_PROGRAMCACHE_H
 #define SF_RENDER_ENGINE_PROGRAMCACHE_H
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
+#include <android-base/thread_annotations.h>
 #include <renderengine/private/Description.h>
 #include <utils/Singleton.h>
 #include <utils/TypeHelpers.h>
+#include "ProgramBinaryCache.h"
 
 namespace android {
 
@@ -185,14 +193,38 @@ public:
     ProgramCache() = default;
     ~ProgramCache() = default;
 
-    // Generate shaders to populate the cache
-    void primeCache(const EGLContext context, bool useColorManagement, bool toneMapperShaderOnly);
+    // Loads the program binaries kept in directory, and keeps the binaries of any program
+    // compiled from now on there, along with how often each key is drawn. Binaries are left
+    // out if the driver cannot return them. Does nothing if directory is empty. Must be called
+    // with a context current, before any program is generated.
+    void initBinaryCache(const std::string& directory) EXCLUDES(mLock);
 
-    size_t getSize(const EGLContext context) { return mCaches[context].size(); }
+    // Generate shaders to populate the cache
+    void primeCache(const EGLContext context, bool useColorManagement, bool toneMapperShaderOnly)
+            EXCLUDES(mLock);
+
+    // Like primeCache, but on a background thread, with workerContext current on workerSurface.
+    // workerContext must share objects with context. Keys drawn in more of the previous boots
+    // are primed first, so they include keys the fixed set misses. Keys useProgram needs before
+    // their turn are generated on demand as usual. The thread then stays to write the binary
+    // cache, so that the render thread never does.
+    void primeCacheInBackground(EGLDisplay display, EGLContext workerContext,
+                                EGLSurface workerSurface, EGLContext context,
+                                bool useColorManagement, bool toneMapperShaderOnly)
+            EXCLUDES(mLock);
+
+    // Stops the background thread, if any, once it is done with the program it is building.
+    // Its context is no longer current when this returns.
+    void stopBackgroundThread() EXCLUDES(mLock);
+
+    size_t getSize(const EGLContext context) EXCLUDES(mLock) {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mCaches[context].size();
+    }
 
     // useProgram lookup a suitable program in the cache or generates one
     // if none can be found.
-    void useProgram(const EGLContext context, const Description& description);
+    void useProgram(const EGLContext context, const Description& description) EXCLUDES(mLock);
 
 private:
     // compute a cache Key from a Description
@@ -205,17 +237,49 @@ private:
     static void generateOOTF(Formatter& fs, const Key& needs);
     // Generate OETF based from Key.
     static void generateOETF(Formatter& fs, const Key& needs);
-    // generates a program from the Key
-    static std::unique_ptr<Program> generateProgram(const Key& needs);
+    // the keys primeCache generates, in a fixed order
+    static std::vector<Key> getPrimeKeys(bool useColorManagement, bool toneMapperShaderOnly);
+    // looks up the program for needs, and generates it unless another thread is already doing
+    // so, in which case it waits for that thread. Sets outGenerated if this call generated it.
+    // A program generated in the background is finished before other contexts can see it.
+    Program* getProgram(const EGLContext context, const Key& needs, bool inBackground,
+                        bool* outGenerated) EXCLUDES(mLock);
+    // generates a program from the Key, loading its binary if one was kept
+    std::unique_ptr<Program> generateProgram(const Key& needs) EXCLUDES(mLock);
+    // counts a key drawn for the first time since boot
+    void noteUsed(const Key& needs) EXCLUDES(mLock);
+    // writes the binary cache on the background thread if there is one, otherwise right away
+    void requestSave() EXCLUDES(mLock);
+    void save() EXCLUDES(mLock);
+    void backgroundThreadMain(EGLDisplay display, EGLContext workerContext,
+                              EGLSurface workerSurface, EGLContext context,
+                              std::vector<Key> keys) EXCLUDES(mLock);
     // generates the vertex shader from the Key
     static String8 generateVertexShader(const Key& needs);
     // generates the fragment shader from the Key
     static String8 generateFragmentShader(const Key& needs);
 
+    std::mutex mLock;
+    std::condition_variable_any mCondition;
+
     // Key/Value map used for caching Programs. Currently the cache
     // is never shrunk (and the GL program objects are never deleted).
     std::unordered_map<EGLContext, std::unordered_map<Key, std::unique_ptr<Program>, Key::Hash>>
-            mCaches;
+            mCaches GUARDED_BY(mLock);
+    // Keys some thread is generating a program for.
+    std::unordered_set<Key::key_t> mGenerating GUARDED_BY(mLock);
+    // Keys drawn since boot.
+    std::unordered_set<Key::key_t> mUsedKeys GUARDED_BY(mLock);
+
+    // Binaries of the programs, and how often each key is drawn, kept across boots. Null if
+    // disabled.
+    std::unique_ptr<ProgramBinaryCache> mBinaryCache GUARDED_BY(mLock);
+    bool mUseProgramBinaries GUARDED_BY(mLock) = false;
+
+    std::thread mBackgroundThread;
+    bool mBackgroundThreadRunning GUARDED_BY(mLock) = false;
+    bool mStopBackgroundThread GUARDED_BY(mLock) = false;
+    bool mSaveRequested GUARDED_BY(mLock) = false;
 };
 
 } // namespace gl
@@ -33,10 +33,13 @@ namespace gl {
 BlurFilter::BlurFilter(GLESRenderEngine& engine)
       : mEngine(engine),
         mCompositionFbo(engine),
-        mPingFbo(engine),
-        mPongFbo(engine),
         mMixProgram(engine),
-        mBlurProgram(engine) {
+        mDownsampleProgram(engine),
+        mUpsampleProgram(engine) {
+    for (auto& level : mPyramid) {
+        level = std::make_unique<GLFramebuffer>(engine);
+    }
+
     mMixProgram.compile(getVertexShader(), getMixFragShader());
     mMPosLoc = mMixProgram.getAttributeLocation("aPosition");
     mMUvLoc = mMixProgram.getAttributeLocation("aUV");
@@ -44,11 +47,17 @@ BlurFilter::BlurFilter(GLESRenderEngine& engine)
     mMCompositionTextureLoc = mMixProgram.getUniformLocation("uCompositionTexture");
     mMMixLoc = mMixProgram.getUniformLocation("uMix");
 
-    mBlurProgram.compile(getVertexShader(), getFragmentShader());
-    mBPosLoc = mBlurProgram.getAttributeLocation("aPosition");
-    mBUvLoc = mBlurProgram.getAttributeLocation("aUV");
-    mBTextureLoc = mBlurProgram.getUniformLocation("uTexture");
-    mBOffsetLoc = mBlurProgram.getUniformLocation("uOffset");
+    mDownsampleProgram.compile(getVertexShader(), getDownsampleFragShader());
+    mDPosLoc = mDownsampleProgram.getAttributeLocation("aPosition");
+    mDUvLoc = mDownsampleProgram.getAttributeLocation("aUV");
+    mDTextureLoc = mDownsampleProgram.getUniformLocation("uTexture");
+    mDOffsetLoc = mDownsampleProgram.getUniformLocation("uOffset");
+
+    mUpsampleProgram.compile(getVertexShader(), getUpsampleFragShader());
+    mUPosLoc = mUpsampleProgram.getAttributeLocation("aPosition");
+    mUUvLoc = mUpsampleProgram.getAttributeLocation("aUV");
+    mUTextureLoc = mUpsampleProgram.getUniformLocation("uTexture");
+    mUOffsetLoc = mUpsampleProgram.getUniformLocation("uOffset");
 
     static constexpr auto size = 2.0f;
     static constexpr auto translation = 1.0f;
@@ -79,24 +88,20 @@ status_t BlurFilter::setAsDrawTarget(const DisplaySettings& display, uint32_t ra
         mDisplayHeight = display.physicalDisplay.height();
         mCompositionFbo.allocateBuffers(mDisplayWidth, mDisplayHeight);
 
-        const uint32_t fboWidth = floorf(mDisplayWidth * kFboScale);
-        const uint32_t fboHeight = floorf(mDisplayHeight * kFboScale);
-        mPingFbo.allocateBuffers(fboWidth, fboHeight);
-        mPongFbo.allocateBuffers(fboWidth, fboHeight);
-
-        if (mPingFbo.getStatus() != GL_FRAMEBUFFER_COMPLETE) {
-            ALOGE("Invalid ping buffer");
-            return mPingFbo.getStatus();
-        }
-        if (mPongFbo.getStatus() != GL_FRAMEBUFFER_COMPLETE) {
-            ALOGE("Invalid pong buffer");
-            return mPongFbo.getStatus();
+        for (uint32_t i = 0; i < kMaxPasses; i++) {
+            const uint32_t levelWidth = max(mDisplayWidth >> (i + 1), 1u);
+            const uint32_t levelHeight = max(mDisplayHeight >> (i + 1), 1u);
+            mPyramid[i]->allocateBuffers(levelWidth, levelHeight);
+            if (mPyramid[i]->getStatus() != GL_FRAMEBUFFER_COMPLETE) {
+                ALOGE("Invalid blur buffer for level %u", i);
+                return mPyramid[i]->getStatus();
+            }
         }
         if (mCompositionFbo.getStatus() != GL_FRAMEBUFFER_COMPLETE) {
             ALOGE("Invalid composition buffer");
             return mCompositionFbo.getStatus();
         }
-        if (!mBlurProgram.isValid()) {
+        if (!mDownsampleProgram.isValid() || !mUpsampleProgram.isValid()) {
             ALOGE("Invalid shader");
             return GL_INVALID_OPERATION;
         }
@@ -122,49 +127,58 @@ void BlurFilter::drawMesh(GLuint uv, GLuint position) {
     glDrawArrays(GL_TRIANGLES, 0 /* first */, 3 /* count */);
 }
 
-status_t BlurFilter::prepare() {
-    ATRACE_NAME("BlurFilter::prepare");
+uint32_t BlurFilter::getPassCount(uint32_t radius) {
+    // Each level doubles the reach of the samples, so a radius twice as large needs one more.
+    uint32_t passes = 1;
+    while (passes < kMaxPasses && radius > (4u << passes)) {
+        passes++;
+    }
+    return passes;
+}
 
-    // Kawase is an approximation of Gaussian, but it behaves differently from it.
-    // A radius transformation is required for approximating them, and also to introduce
-    // non-integer steps, necessary to smoothly interpolate large radii.
-    const auto radius = mRadius / 6.0f;
+float BlurFilter::getSampleOffset(uint32_t radius) {
+    // Scales the samples between levels, so that the blur grows smoothly with the radius
+    // instead of jumping each time a level is added. Past the last level, the samples spread
+    // further apart instead.
+    return max(radius, 1u) / (float)(4u << getPassCount(radius));
+}
 
-    // Calculate how many passes we'll do, based on the radius.
-    // Too many passes will make the operation expensive.
-    const auto passes = min(kMaxPasses, (uint32_t)ceil(radius));
+status_t BlurFilter::prepare() {
+    ATRACE_NAME("BlurFilter::prepare");
 
-    const float radiusByPasses = radius / (float)passes;
-    const float stepX = radiusByPasses / (float)mCompositionFbo.getBufferWidth();
-    const float stepY = radiusByPasses / (float)mCompositionFbo.getBufferHeight();
+    const uint32_t passes = getPassCount(mRadius);
+    const float offset = getSampleOffset(mRadius);
 
-    // Let's start by downsampling and blurring the composited frame simultaneously.
-    mBlurProgram.useProgram();
+    // Downsample the composited frame, blurring it on the way down the pyramid.
+    GLFramebuffer* read = &mCompositionFbo;
+    mDownsampleProgram.useProgram();
     glActiveTexture(GL_TEXTURE0);
-    glUniform1i(mBTextureLoc, 0);
-    glBindTexture(GL_TEXTURE_2D, mCompositionFbo.getTextureName());
-    glUniform2f(mBOffsetLoc, stepX, stepY);
-    glViewport(0, 0, mPingFbo.getBufferWidth(), mPingFbo.getBufferHeight());
-    mPingFbo.bind();
-    drawMesh(mBUvLoc, mBPosLoc);
-
-    // And now we'll ping pong between our textures, to accumulate the result of various offsets.
-    GLFramebuffer* read = &mPingFbo;
-    GLFramebuffer* draw = &mPongFbo;
-    glViewport(0, 0, draw->getBufferWidth(), draw->getBufferHeight());
-    for (auto i = 1; i < passes; i++) {
-        ATRACE_NAME("BlurFilter::renderPass");
+    glUniform1i(mDTextureLoc, 0);
+    for (uint32_t i = 0; i < passes; i++) {
+        ATRACE_NAME("BlurFilter::downsamplePass");
+        GLFramebuffer* draw = mPyramid[i].get();
         draw->bind();
-
+        glViewport(0, 0, draw->getBufferWidth(), draw->getBufferHeight());
         glBindTexture(GL_TEXTURE_2D, read->getTextureName());
-        glUniform2f(mBOffsetLoc, stepX * i, stepY * i);
-
-        drawMesh(mBUvLoc, mBPosLoc);
+        glUniform2f(mDOffsetLoc, 0.5f * offset / read->getBufferWidth(),
+                    0.5f * offset / read->getBufferHeight());
+        drawMesh(mDUvLoc, mDPosLoc);
+        read = draw;
+    }
 
-        // Swap buffers for next iteration
-        auto tmp = draw;
-        draw = read;
-        read = tmp;
+    // And upsample it again, blurring it on the way back up to the first level.
+    mUpsampleProgram.useProgram();
+    glUniform1i(mUTextureLoc, 0);
+    for (uint32_t i = passes - 1; i > 0; i--) {
+        ATRACE_NAME("BlurFilter::upsamplePass");
+        GLFramebuffer* draw = mPyramid[i - 1].get();
+        draw->bind();
+        glViewport(0, 0, draw->getBufferWidth(), draw->getBufferHeight());
+        glBindTexture(GL_TEXTURE_2D, read->getTextureName());
+        glUniform2f(mUOffsetLoc, 0.5f * offset / read->getBufferWidth(),
+                    0.5f * offset / read->getBufferHeight());
+        drawMesh(mUUvLoc, mUPosLoc);
+        read = draw;
     }
     mLastDrawTarget = read;
 
@@ -221,7 +235,7 @@ string BlurFilter::getVertexShader() const {
     )SHADER";
 }
 
-string BlurFilter::getFragmentShader() const {
+string BlurFilter::getDownsampleFragShader() const {
     return R"SHADER(#version 310 es
         precision mediump float;
 
@@ -232,13 +246,38 @@ string BlurFilter::getFragmentShader() const {
         out vec4 fragColor;
 
         void main() {
-            fragColor  = texture(uTexture, vUV, 0.0);
-            fragColor += texture(uTexture, vUV + vec2( uOffset.x,  uOffset.y), 0.0);
-            fragColor += texture(uTexture, vUV + vec2( uOffset.x, -uOffset.y), 0.0);
-            fragColor += texture(uTexture, vUV + vec2(-uOffset.x,  uOffset.y), 0.0);
-            fragColor += texture(uTexture, vUV + vec2(-uOffset.x, -uOffset.y), 0.0);
+            vec4 sum = texture(uTexture, vUV, 0.0) * 4.0;
+            sum += texture(uTexture, vUV + vec2( uOffset.x,  uOffset.y), 0.0);
+            sum += texture(uTexture, vUV + vec2( uOffset.x, -uOffset.y), 0.0);
+            sum += texture(uTexture, vUV + vec2(-uOffset.x,  uOffset.y), 0.0);
+            sum += texture(uTexture, vUV + vec2(-uOffset.x, -uOffset.y), 0.0);
+
+            fragColor = vec4(sum.rgb * 0.125, 1.0);
+        }
+    )SHADER";
+}
+
+string BlurFilter::getUpsampleFragShader() const {
+    return R"SHADER(#version 310 es
+        precision mediump float;
+
+        uniform sampler2D uTexture;
+        uniform vec2 uOffset;
 
-            fragColor = vec4(fragColor.rgb * 0.2, 1.0);
+        in highp vec2 vUV;
+        out vec4 fragColor;
+
+        void main() {
+            vec4 sum = texture(uTexture, vUV + vec2(-2.0 * uOffset.x, 0.0), 0.0);
+            sum += texture(uTexture, vUV + vec2(2.0 * uOffset.x, 0.0), 0.0);
+            sum += texture(uTexture, vUV + vec2(0.0, -2.0 * uOffset.y), 0.0);
+            sum += texture(uTexture, vUV + vec2(0.0,  2.0 * uOffset.y), 0.0);
+            sum += texture(uTexture, vUV + vec2( uOffset.x,  uOffset.y), 0.0) * 2.0;
+            sum += texture(uTexture, vUV + vec2( uOffset.x, -uOffset.y), 0.0) * 2.0;
+            sum += texture(uTexture, vUV + vec2(-uOffset.x,  uOffset.y), 0.0) * 2.0;
+            sum += texture(uTexture, vUV + vec2(-uOffset.x, -uOffset.y), 0.0) * 2.0;
+
+            fragColor = vec4(sum.rgb / 12.0, 1.0);
         }
     )SHADER";
 }
@@ -17,6 +17,9 @@
 #pragma once
 
 #include <ui/GraphicTypes.h>
+
+#include <memory>
+
 #include "../GLESRenderEngine.h"
 #include "../GLFramebuffer.h"
 #include "../GLVertexBuffer.h"
@@ -29,15 +32,17 @@ namespace renderengine {
 namespace gl {
 
 /**
- * This is an implementation of a Kawase blur, as described in here:
+ * This is an implementation of a dual filter Kawase blur, as described in here:
  * https://community.arm.com/cfs-file/__key/communityserver-blogs-components-weblogfiles/
  * 00-00-00-20-66/siggraph2015_2D00_mmg_2D00_marius_2D00_notes.pdf
+ *
+ * The composited background is downsampled into a pyramid of buffers, each half the size of the
+ * previous one, and then upsampled back to the first level. Larger radii go down more levels, so
+ * the cost stays close to that of the first, largest level whatever the radius.
  */
 class BlurFilter {
 public:
-    // Downsample FBO to improve performance
-    static constexpr float kFboScale = 0.25f;
-    // Maximum number of render passes
+    // Maximum number of levels of the pyramid, the smallest being 1/2^kMaxPasses of the display.
     static constexpr uint32_t kMaxPasses = 4;
     // To avoid downscaling artifacts, we interpolate the blurred fbo with the full composited
     // image, up to this radius.
@@ -53,19 +58,25 @@ public:
     // Render blur to the bound framebuffer (screen).
     status_t render(bool multiPass);
 
+    // Number of levels of the pyramid used for a radius, between 1 and kMaxPasses.
+    static uint32_t getPassCount(uint32_t radius);
+    // Distance of the samples from the center, in texels of the level read, for a radius.
+    static float getSampleOffset(uint32_t radius);
+
 private:
     uint32_t mRadius;
     void drawMesh(GLuint uv, GLuint position);
     string getVertexShader() const;
-    string getFragmentShader() const;
+    string getDownsampleFragShader() const;
+    string getUpsampleFragShader() const;
     string getMixFragShader() const;
 
     GLESRenderEngine& mEngine;
     // Frame buffer holding the composited background.
     GLFramebuffer mCompositionFbo;
-    // Frame buffers holding the blur passes.
-    GLFramebuffer mPingFbo;
-    GLFramebuffer mPongFbo;
+    // Frame buffers holding the levels of the pyramid, level i being 1/2^(i + 1) of the display.
+    // They are reused by every blurred layer of a frame, and by the following frames.
+    std::unique_ptr<GLFramebuffer> mPyramid[kMaxPasses];
     uint32_t mDisplayWidth = 0;
     uint32_t mDisplayHeight = 0;
     uint32_t mDisplayX = 0;
@@ -83,11 +94,17 @@ private:
     GLuint mMTextureLoc;
     GLuint mMCompositionTextureLoc;
 
-    GenericProgram mBlurProgram;
-    GLuint mBPosLoc;
-    GLuint mBUvLoc;
-    GLuint mBTextureLoc;
-    GLuint mBOffsetLoc;
+    GenericProgram mDownsampleProgram;
+    GLuint mDPosLoc;
+    GLuint mDUvLoc;
+    GLuint mDTextureLoc;
+    GLuint mDOffsetLoc;
+
+    GenericProgram mUpsampleProgram;
+    GLuint mUPosLoc;
+    GLuint mUUvLoc;
+    GLuint mUTextureLoc;
+    GLuint mUOffsetLoc;
 };
 
 } // namespace gl
@@ -60,13 +60,20 @@ struct DisplaySettings {
     // capture of a device in landscape while the buffer is in portrait
     // orientation.
     uint32_t orientation = ui::Transform::ROT_0;
+
+    // Part of the buffer that needs to be redrawn, in physical display space.
+    // If valid, the rest of the buffer must already hold the result of this
+    // request from a previous draw, and is left untouched. Otherwise, the
+    // whole buffer is redrawn.
+    Rect damage = Rect::INVALID_RECT;
 };
 
 static inline bool operator==(const DisplaySettings& lhs, const DisplaySettings& rhs) {
     return lhs.physicalDisplay == rhs.physicalDisplay && lhs.clip == rhs.clip &&
             lhs.maxLuminance == rhs.maxLuminance && lhs.outputDataspace == rhs.outputDataspace &&
             lhs.colorTransform == rhs.colorTransform &&
-            lhs.clearRegion.hasSameRects(rhs.clearRegion) && lhs.orientation == rhs.orientation;
+            lhs.clearRegion.hasSameRects(rhs.clearRegion) && lhs.orientation == rhs.orientation &&
+            lhs.damage == rhs.damage;
 }
 
 // Defining PrintTo helps with Google Tests.
@@ -83,6 +90,8 @@ static inline void PrintTo(const DisplaySettings& settings, ::std::ostream* os)
     *os << "\n    .clearRegion = ";
     PrintTo(settings.clearRegion, os);
     *os << "\n    .orientation = " << settings.orientation;
+    *os << "\n    .damage = ";
+    PrintTo(settings.damage, os);
     *os << "\n}";
 }
 
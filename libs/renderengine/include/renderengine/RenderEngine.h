@@ -31,10 +31,16 @@
 #include <ui/Transform.h>
 
 /**
- * Allows to set RenderEngine backend to GLES (default) or Vulkan (NOT yet supported).
+ * Allows to set RenderEngine backend to GLES (default) or Vulkan (NOT yet supported). "threaded"
+ * runs the GLES backend on a thread of its own.
  */
 #define PROPERTY_DEBUG_RENDERENGINE_BACKEND "debug.renderengine.backend"
 
+/**
+ * Directory RenderEngine keeps compiled shader programs in across boots. Unset disables it.
+ */
+#define PROPERTY_RENDERENGINE_PROGRAM_CACHE_DIR "ro.renderengine.program_cache_dir"
+
 struct ANativeWindowBuffer;
 
 namespace android {
@@ -54,6 +60,10 @@ namespace impl {
 class RenderEngine;
 }
 
+namespace threaded {
+class RenderEngineThreaded;
+}
+
 enum class Protection {
     UNPROTECTED = 1,
     PROTECTED = 2,
@@ -185,11 +195,14 @@ protected:
     // live longer than RenderEngine.
     virtual Framebuffer* getFramebufferForDrawing() = 0;
     friend class BindNativeBufferAsFramebuffer;
+    friend class threaded::RenderEngineThreaded;
 };
 
 struct RenderEngineCreationArgs {
     int pixelFormat;
     uint32_t imageCacheSize;
+    // Bytes of source buffer images kept once they are idle. 0 keeps them until unbound.
+    size_t imageCacheBudget;
     bool useColorManagement;
     bool enableProtectedContext;
     bool precacheToneMapperShaderOnly;
@@ -203,6 +216,7 @@ private:
     RenderEngineCreationArgs(
             int _pixelFormat,
             uint32_t _imageCacheSize,
+            size_t _imageCacheBudget,
             bool _useColorManagement,
             bool _enableProtectedContext,
             bool _precacheToneMapperShaderOnly,
@@ -210,6 +224,7 @@ private:
             RenderEngine::ContextPriority _contextPriority)
         : pixelFormat(_pixelFormat)
         , imageCacheSize(_imageCacheSize)
+        , imageCacheBudget(_imageCacheBudget)
         , useColorManagement(_useColorManagement)
         , enableProtectedContext(_enableProtectedContext)
         , precacheToneMapperShaderOnly(_precacheToneMapperShaderOnly)
@@ -229,6 +244,10 @@ struct RenderEngineCreationArgs::Builder {
         this->imageCacheSize = imageCacheSize;
         return *this;
     }
+    Builder& setImageCacheBudget(size_t imageCacheBudget) {
+        this->imageCacheBudget = imageCacheBudget;
+        return *this;
+    }
     Builder& setUseColorManagerment(bool useColorManagement) {
         this->useColorManagement = useColorManagement;
         return *this;
@@ -250,15 +269,17 @@ struct RenderEngineCreationArgs::Builder {
         return *this;
     }
     RenderEngineCreationArgs build() const {
-        return RenderEngineCreationArgs(pixelFormat, imageCacheSize, useColorManagement,
-                                        enableProtectedContext, precacheToneMapperShaderOnly,
-                                        supportsBackgroundBlur, contextPriority);
+        return RenderEngineCreationArgs(pixelFormat, imageCacheSize, imageCacheBudget,
+                                        useColorManagement, enableProtectedContext,
+                                        precacheToneMapperShaderOnly, supportsBackgroundBlur,
+                                        contextPriority);
     }
 
 private:
     // 1 means RGBA_8888
     int pixelFormat = 1;
     uint32_t imageCacheSize = 0;
+    size_t imageCacheBudget = 0;
     bool useColorManagement = true;
     bool enableProtectedContext = false;
     bool precacheToneMapperShaderOnly = false;
@@ -0,0 +1,376 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <renderengine/RenderEngine.h>
+#include <string.h>
+#include <sync/sync.h>
+#include <ui/GraphicBuffer.h>
+#include <ui/PixelFormat.h>
+#include <unistd.h>
+
+#include <functional>
+
+namespace android {
+
+using ui::Dataspace;
+
+static const uint32_t DISPLAY_WIDTH = 1080;
+static const uint32_t DISPLAY_HEIGHT = 2340;
+
+// A single engine for the whole run: RenderEngine keeps per-context state in singletons, so
+// creating several in one process is not supported.
+static renderengine::RenderEngine& getRenderEngine() {
+    static std::unique_ptr<renderengine::RenderEngine> engine = renderengine::RenderEngine::create(
+            renderengine::RenderEngineCreationArgs::Builder()
+                    .setPixelFormat(static_cast<int>(ui::PixelFormat::RGBA_8888))
+                    .setImageCacheSize(1)
+                    .setUseColorManagerment(true)
+                    .setEnableProtectedContext(true)
+                    .setPrecacheToneMapperShaderOnly(false)
+                    .setSupportsBackgroundBlur(true)
+                    .setContextPriority(renderengine::RenderEngine::ContextPriority::MEDIUM)
+                    .build());
+    return *engine;
+}
+
+static sp<GraphicBuffer> allocateBuffer(uint32_t width, uint32_t height, uint64_t usage,
+                                        const char* name) {
+    return new GraphicBuffer(width, height, HAL_PIXEL_FORMAT_RGBA_8888, 1, usage, name);
+}
+
+static sp<GraphicBuffer> allocateTarget(bool isProtected = false) {
+    return allocateBuffer(DISPLAY_WIDTH, DISPLAY_HEIGHT,
+                          GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE |
+                                  (isProtected ? GRALLOC_USAGE_PROTECTED : 0),
+                          "target");
+}
+
+static renderengine::DisplaySettings getDisplaySettings() {
+    const Rect display(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = display;
+    settings.clip = display;
+    return settings;
+}
+
+static renderengine::LayerSettings getColorLayer(const Rect& bounds, const half3& color) {
+    renderengine::LayerSettings layer;
+    layer.geometry.boundaries = bounds.toFloatRect();
+    layer.source.solidColor = color;
+    layer.alpha = 1.0f;
+    return layer;
+}
+
+/**
+ * Times the GPU work of the calls made between begin() and end() with EXT_disjoint_timer_query,
+ * on the context current when it is created. isSupported() is false without the extension.
+ */
+class GpuTimer {
+public:
+    GpuTimer() {
+        const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        if (extensions == nullptr || strstr(extensions, "GL_EXT_disjoint_timer_query") == nullptr) {
+            return;
+        }
+        mGenQueries = reinterpret_cast<PFNGLGENQUERIESEXTPROC>(
+                eglGetProcAddress("glGenQueriesEXT"));
+        mDeleteQueries = reinterpret_cast<PFNGLDELETEQUERIESEXTPROC>(
+                eglGetProcAddress("glDeleteQueriesEXT"));
+        mBeginQuery = reinterpret_cast<PFNGLBEGINQUERYEXTPROC>(
+                eglGetProcAddress("glBeginQueryEXT"));
+        mEndQuery =
+                reinterpret_cast<PFNGLENDQUERYEXTPROC>(eglGetProcAddress("glEndQueryEXT"));
+        mGetQueryObjectui64v = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(
+                eglGetProcAddress("glGetQueryObjectui64vEXT"));
+        if (mGenQueries && mDeleteQueries && mBeginQuery && mEndQuery && mGetQueryObjectui64v) {
+            mGenQueries(1, &mQuery);
+        }
+    }
+
+    ~GpuTimer() {
+        if (isSupported()) {
+            mDeleteQueries(1, &mQuery);
+        }
+    }
+
+    bool isSupported() const { return mQuery != 0; }
+
+    void begin() {
+        if (isSupported()) {
+            mBeginQuery(GL_TIME_ELAPSED_EXT, mQuery);
+        }
+    }
+
+    void end() {
+        if (isSupported()) {
+            mEndQuery(GL_TIME_ELAPSED_EXT);
+        }
+    }
+
+    // Waits for the result of the last query. Returns false if the GPU was disjoint meanwhile,
+    // for example because its clock changed, which makes the result meaningless.
+    bool getElapsedNs(uint64_t* outNs) {
+        if (!isSupported()) {
+            return false;
+        }
+        mGetQueryObjectui64v(mQuery, GL_QUERY_RESULT_EXT, outNs);
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        return !disjoint;
+    }
+
+private:
+    PFNGLGENQUERIESEXTPROC mGenQueries = nullptr;
+    PFNGLDELETEQUERIESEXTPROC mDeleteQueries = nullptr;
+    PFNGLBEGINQUERYEXTPROC mBeginQuery = nullptr;
+    PFNGLENDQUERYEXTPROC mEndQuery = nullptr;
+    PFNGLGETQUERYOBJECTUI64VEXTPROC mGetQueryObjectui64v = nullptr;
+    GLuint mQuery = 0;
+};
+
+/**
+ * Draws layers into target once per iteration and waits for the GPU to finish. The CPU time
+ * reported is the time spent building and submitting the frame; gpu_time_us is the GPU time of
+ * the frame, when the driver supports timer queries. beforeDraw runs outside the GPU timing,
+ * and may switch contexts, in which case the GPU time is not reported.
+ */
+static void drawLayers(benchmark::State& state,
+                       const std::vector<const renderengine::LayerSettings*>& layers,
+                       const sp<GraphicBuffer>& target,
+                       const renderengine::DisplaySettings& settings = getDisplaySettings(),
+                       const std::function<sp<GraphicBuffer>()>& beforeDraw = nullptr) {
+    renderengine::RenderEngine& engine = getRenderEngine();
+    GpuTimer timer;
+    const bool timeGpu = timer.isSupported() && beforeDraw == nullptr;
+    uint64_t gpuNs = 0;
+    uint64_t gpuFrames = 0;
+
+    for (auto _ : state) {
+        sp<GraphicBuffer> buffer = beforeDraw ? beforeDraw() : target;
+        if (timeGpu) {
+            timer.begin();
+        }
+        base::unique_fd fence;
+        status_t status = engine.drawLayers(settings, layers, buffer->getNativeBuffer(), true,
+                                            base::unique_fd(), &fence);
+        if (timeGpu) {
+            timer.end();
+        }
+        if (status != NO_ERROR) {
+            state.SkipWithError("drawLayers failed");
+            break;
+        }
+        int fd = fence.release();
+        if (fd >= 0) {
+            sync_wait(fd, -1);
+            close(fd);
+        }
+        uint64_t frameNs = 0;
+        if (timeGpu && timer.getElapsedNs(&frameNs)) {
+            gpuNs += frameNs;
+            gpuFrames++;
+        }
+    }
+
+    if (gpuFrames > 0) {
+        state.counters["gpu_time_us"] = gpuNs / 1000.0 / gpuFrames;
+    }
+}
+
+/**
+ * Composites the given number of full screen layers, each sampling a buffer of its own with
+ * blending, like a stack of translucent windows.
+ */
+static void benchmarkTexturedLayers(benchmark::State& state) {
+    const size_t layerCount = static_cast<size_t>(state.range(0));
+    renderengine::RenderEngine& engine = getRenderEngine();
+
+    std::vector<sp<GraphicBuffer>> sources;
+    std::vector<uint32_t> textureNames(layerCount);
+    engine.genTextures(layerCount, textureNames.data());
+    std::vector<renderengine::LayerSettings> layerSettings(layerCount);
+    std::vector<const renderengine::LayerSettings*> layers;
+    for (size_t i = 0; i < layerCount; i++) {
+        sources.push_back(allocateBuffer(DISPLAY_WIDTH, DISPLAY_HEIGHT,
+                                         GRALLOC_USAGE_HW_TEXTURE, "source"));
+        renderengine::LayerSettings& layer = layerSettings[i];
+        layer.geometry.boundaries = Rect(DISPLAY_WIDTH, DISPLAY_HEIGHT).toFloatRect();
+        layer.source.buffer.buffer = sources[i];
+        layer.source.buffer.textureName = textureNames[i];
+        layer.source.buffer.usePremultipliedAlpha = true;
+        layer.alpha = 0.5f;
+        layers.push_back(&layer);
+    }
+
+    drawLayers(state, layers, allocateTarget());
+    engine.deleteTextures(layerCount, textureNames.data());
+}
+BENCHMARK(benchmarkTexturedLayers)->Arg(1)->Arg(4)->Arg(10)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Composites a background and a dialog sized layer with rounded corners of the given radius.
+ */
+static void benchmarkRoundedCorners(benchmark::State& state) {
+    const float radius = static_cast<float>(state.range(0));
+    renderengine::LayerSettings background =
+            getColorLayer(Rect(DISPLAY_WIDTH, DISPLAY_HEIGHT), half3(0.0f, 0.0f, 1.0f));
+    const Rect dialogBounds(DISPLAY_WIDTH / 8, DISPLAY_HEIGHT / 4, DISPLAY_WIDTH * 7 / 8,
+                            DISPLAY_HEIGHT * 3 / 4);
+    renderengine::LayerSettings dialog = getColorLayer(dialogBounds, half3(1.0f, 1.0f, 1.0f));
+    dialog.geometry.roundedCornersRadius = radius;
+    dialog.geometry.roundedCornersCrop = dialogBounds.toFloatRect();
+
+    drawLayers(state, {&background, &dialog}, allocateTarget());
+}
+BENCHMARK(benchmarkRoundedCorners)->Arg(8)->Arg(32)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Composites a background and the given number of elevated layers, each with its shadow.
+ */
+static void benchmarkShadows(benchmark::State& state) {
+    const size_t casterCount = static_cast<size_t>(state.range(0));
+    std::vector<renderengine::LayerSettings> layerSettings;
+    layerSettings.reserve(1 + 2 * casterCount);
+    layerSettings.push_back(
+            getColorLayer(Rect(DISPLAY_WIDTH, DISPLAY_HEIGHT), half3(1.0f, 1.0f, 1.0f)));
+    for (size_t i = 0; i < casterCount; i++) {
+        const int32_t offset = static_cast<int32_t>(i) * 100;
+        const Rect casterBounds(100 + offset, 200 + offset, 700 + offset, 900 + offset);
+
+        renderengine::LayerSettings shadow;
+        shadow.geometry.boundaries = casterBounds.toFloatRect();
+        shadow.shadow.ambientColor = vec4(0.0f, 0.0f, 0.0f, 0.039f);
+        shadow.shadow.spotColor = vec4(0.0f, 0.0f, 0.0f, 0.19f);
+        shadow.shadow.lightPos = vec3(DISPLAY_WIDTH / 2, 0.0f, 1500.0f);
+        shadow.shadow.lightRadius = 800.0f;
+        shadow.shadow.length = 40.0f;
+        shadow.alpha = 1.0f;
+        layerSettings.push_back(shadow);
+        layerSettings.push_back(getColorLayer(casterBounds, half3(0.8f, 0.8f, 0.8f)));
+    }
+    std::vector<const renderengine::LayerSettings*> layers;
+    for (const renderengine::LayerSettings& layer : layerSettings) {
+        layers.push_back(&layer);
+    }
+
+    drawLayers(state, layers, allocateTarget());
+}
+BENCHMARK(benchmarkShadows)->Arg(1)->Arg(4)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Composites a display of two solid color halves under a number of blurred layers, all with the
+ * same radius. Takes the radius and the layer count.
+ */
+static void benchmarkBlur(benchmark::State& state) {
+    const int radius = static_cast<int>(state.range(0));
+    const size_t blurLayerCount = static_cast<size_t>(state.range(1));
+
+    renderengine::LayerSettings background =
+            getColorLayer(Rect(DISPLAY_WIDTH, DISPLAY_HEIGHT), half3(0.0f, 1.0f, 0.0f));
+    renderengine::LayerSettings left =
+            getColorLayer(Rect(DISPLAY_WIDTH / 2, DISPLAY_HEIGHT), half3(1.0f, 0.0f, 0.0f));
+
+    std::vector<renderengine::LayerSettings> blurLayers(blurLayerCount);
+    std::vector<const renderengine::LayerSettings*> layers = {&background, &left};
+    for (renderengine::LayerSettings& blurLayer : blurLayers) {
+        blurLayer.geometry.boundaries = Rect(DISPLAY_WIDTH, DISPLAY_HEIGHT).toFloatRect();
+        blurLayer.backgroundBlurRadius = radius;
+        blurLayer.alpha = 0.0f;
+        layers.push_back(&blurLayer);
+    }
+
+    drawLayers(state, layers, allocateTarget());
+}
+
+static void blurArgs(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({"radius", "layers"});
+    for (int radius : {10, 30, 60, 120}) {
+        for (int layers = 1; layers <= 3; layers++) {
+            benchmark->Args({radius, layers});
+        }
+    }
+}
+BENCHMARK(benchmarkBlur)->Apply(blurArgs)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Composites a full screen HDR10 buffer to a Display P3 output, which runs the tone mapping
+ * shader, against the same buffer drawn without any conversion as a baseline.
+ */
+static void benchmarkToneMapping(benchmark::State& state) {
+    const bool toneMap = state.range(0) != 0;
+    renderengine::RenderEngine& engine = getRenderEngine();
+
+    uint32_t textureName = 0;
+    engine.genTextures(1, &textureName);
+    renderengine::LayerSettings layer;
+    layer.geometry.boundaries = Rect(DISPLAY_WIDTH, DISPLAY_HEIGHT).toFloatRect();
+    layer.source.buffer.buffer =
+            allocateBuffer(DISPLAY_WIDTH, DISPLAY_HEIGHT, GRALLOC_USAGE_HW_TEXTURE, "hdr");
+    layer.source.buffer.textureName = textureName;
+    layer.source.buffer.maxMasteringLuminance = 1000.0f;
+    layer.source.buffer.maxContentLuminance = 1000.0f;
+    layer.alpha = 1.0f;
+
+    renderengine::DisplaySettings settings = getDisplaySettings();
+    if (toneMap) {
+        layer.sourceDataspace = Dataspace::BT2020_ITU_PQ;
+        settings.outputDataspace = Dataspace::DISPLAY_P3;
+        settings.maxLuminance = 500.0f;
+    }
+
+    drawLayers(state, {&layer}, allocateTarget(), settings);
+    engine.deleteTextures(1, &textureName);
+}
+BENCHMARK(benchmarkToneMapping)
+        ->ArgName("toneMap")
+        ->Arg(0)
+        ->Arg(1)
+        ->Unit(benchmark::kMicrosecond);
+
+/**
+ * Alternates between a protected and an unprotected frame, as when a protected video starts and
+ * stops, to measure the cost of switching contexts.
+ */
+static void benchmarkProtectedContextSwitch(benchmark::State& state) {
+    renderengine::RenderEngine& engine = getRenderEngine();
+    if (!engine.supportsProtectedContent()) {
+        state.SkipWithError("Protected content is not supported");
+        return;
+    }
+
+    renderengine::LayerSettings layer =
+            getColorLayer(Rect(DISPLAY_WIDTH, DISPLAY_HEIGHT), half3(1.0f, 0.0f, 0.0f));
+    const sp<GraphicBuffer> target = allocateTarget();
+    const sp<GraphicBuffer> protectedTarget = allocateTarget(true /* isProtected */);
+    bool useProtected = false;
+
+    drawLayers(state, {&layer}, target, getDisplaySettings(), [&]() {
+        useProtected = !useProtected;
+        engine.useProtectedContext(useProtected);
+        return useProtected ? protectedTarget : target;
+    });
+    engine.useProtectedContext(false);
+}
+BENCHMARK(benchmarkProtectedContextSwitch)->Unit(benchmark::kMicrosecond);
+
+} // namespace android
+
+BENCHMARK_MAIN();
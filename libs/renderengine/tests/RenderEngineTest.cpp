@@ -1032,10 +1032,75 @@ TEST_F(RenderEngineTest, drawLayers_doesNotCacheFramebuffer) {
     expectBufferColor(fullscreenRect(), 255, 0, 0, 255);
 }
 
+TEST_F(RenderEngineTest, drawLayers_reusesTransientFramebuffer) {
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+
+    std::vector<const renderengine::LayerSettings*> layers;
+    renderengine::LayerSettings layer;
+    layer.geometry.boundaries = fullscreenRect().toFloatRect();
+    BufferSourceVariant<ForceOpaqueBufferVariant>::fillColor(layer, 1.0f, 0.0f, 0.0f, this);
+    layer.alpha = 1.0;
+    layers.push_back(&layer);
+
+    for (int i = 0; i < 2; i++) {
+        status_t status = sRE->drawLayers(settings, layers, mBuffer->getNativeBuffer(), false,
+                                          base::unique_fd(), nullptr);
+        sCurrentBuffer = mBuffer;
+        ASSERT_EQ(NO_ERROR, status);
+        ASSERT_TRUE(sRE->isTransientFramebufferImageCachedForTesting(mBuffer->getId()));
+        expectBufferColor(fullscreenRect(), 255, 0, 0, 255);
+    }
+
+    sRE->cleanupPostRender(renderengine::RenderEngine::CleanupMode::CLEAN_ALL);
+    ASSERT_FALSE(sRE->isTransientFramebufferImageCachedForTesting(mBuffer->getId()));
+}
+
 TEST_F(RenderEngineTest, drawLayers_fillRedBuffer_colorSource) {
     fillRedBuffer<ColorSourceVariant>();
 }
 
+TEST_F(RenderEngineTest, drawLayers_fillBuffer_batchedColorLayers) {
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+
+    // The three red layers are drawn together, each with its own transform, and the blue one
+    // must still be blended over them.
+    const FloatRect quarter = Rect(DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT / 2)
+                                      .toFloatRect();
+    renderengine::LayerSettings topLeft;
+    topLeft.geometry.boundaries = quarter;
+    topLeft.source.solidColor = half3(1.0f, 0.0f, 0.0f);
+    topLeft.alpha = 1.0f;
+
+    renderengine::LayerSettings topRight = topLeft;
+    topRight.geometry.positionTransform =
+            mat4::translate(vec4(DEFAULT_DISPLAY_WIDTH / 2, 0.0f, 0.0f, 0.0f));
+
+    renderengine::LayerSettings bottom = topLeft;
+    bottom.geometry.boundaries =
+            Rect(DEFAULT_DISPLAY_WIDTH, DEFAULT_DISPLAY_HEIGHT / 2).toFloatRect();
+    bottom.geometry.positionTransform =
+            mat4::translate(vec4(0.0f, DEFAULT_DISPLAY_HEIGHT / 2, 0.0f, 0.0f));
+
+    renderengine::LayerSettings blue = topLeft;
+    blue.source.solidColor = half3(0.0f, 0.0f, 1.0f);
+
+    std::vector<const renderengine::LayerSettings*> layers = {&topLeft, &topRight, &bottom,
+                                                              &blue};
+    invokeDraw(settings, layers, mBuffer);
+
+    expectBufferColor(Rect(DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT / 2), 0, 0, 255, 255);
+    expectBufferColor(Rect(DEFAULT_DISPLAY_WIDTH / 2, 0, DEFAULT_DISPLAY_WIDTH,
+                           DEFAULT_DISPLAY_HEIGHT / 2),
+                      255, 0, 0, 255);
+    expectBufferColor(Rect(0, DEFAULT_DISPLAY_HEIGHT / 2, DEFAULT_DISPLAY_WIDTH,
+                           DEFAULT_DISPLAY_HEIGHT),
+                      255, 0, 0, 255);
+}
+
 TEST_F(RenderEngineTest, drawLayers_fillGreenBuffer_colorSource) {
     fillGreenBuffer<ColorSourceVariant>();
 }
@@ -1216,6 +1281,28 @@ TEST_F(RenderEngineTest, drawLayers_clearRegion) {
     clearRegion();
 }
 
+TEST_F(RenderEngineTest, drawLayers_onlyRedrawsDamage) {
+    fillRedBuffer<ColorSourceVariant>();
+
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+    settings.damage = Rect(DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT);
+
+    std::vector<const renderengine::LayerSettings*> layers;
+    renderengine::LayerSettings layer;
+    layer.geometry.boundaries = fullscreenRect().toFloatRect();
+    ColorSourceVariant::fillColor(layer, 0.0f, 0.0f, 1.0f, this);
+    layer.alpha = 1.0f;
+    layers.push_back(&layer);
+    invokeDraw(settings, layers, mBuffer);
+
+    expectBufferColor(Rect(DEFAULT_DISPLAY_WIDTH / 2, DEFAULT_DISPLAY_HEIGHT), 0, 0, 255, 255);
+    expectBufferColor(Rect(DEFAULT_DISPLAY_WIDTH / 2, 0, DEFAULT_DISPLAY_WIDTH,
+                           DEFAULT_DISPLAY_HEIGHT),
+                      255, 0, 0, 255);
+}
+
 TEST_F(RenderEngineTest, drawLayers_fillsBufferAndCachesImages) {
     renderengine::DisplaySettings settings;
     settings.physicalDisplay = fullscreenRect();
@@ -1339,6 +1426,25 @@ TEST_F(RenderEngineTest, drawLayers_fillShadow_casterColorLayer) {
     expectShadowColor(castingLayer, settings, casterColor, backgroundColor);
 }
 
+TEST_F(RenderEngineTest, drawLayers_fillShadow_redrawnFromCache) {
+    const ubyte4 casterColor(255, 0, 0, 255);
+    const ubyte4 backgroundColor(255, 255, 255, 255);
+    const float shadowLength = 5.0f;
+    Rect casterBounds(DEFAULT_DISPLAY_WIDTH / 3.0f, DEFAULT_DISPLAY_HEIGHT / 3.0f);
+    casterBounds.offsetBy(shadowLength + 1, shadowLength + 1);
+    renderengine::LayerSettings castingLayer;
+    castingLayer.geometry.boundaries = casterBounds.toFloatRect();
+    castingLayer.alpha = 1.0f;
+    renderengine::ShadowSettings settings =
+            getShadowSettings(vec2(casterBounds.left, casterBounds.top), shadowLength,
+                              false /* casterIsTranslucent */);
+
+    // The second frame draws the shadow generated for the first one.
+    drawShadow<ColorSourceVariant>(castingLayer, settings, casterColor, backgroundColor);
+    drawShadow<ColorSourceVariant>(castingLayer, settings, casterColor, backgroundColor);
+    expectShadowColor(castingLayer, settings, casterColor, backgroundColor);
+}
+
 TEST_F(RenderEngineTest, drawLayers_fillShadow_casterOpaqueBufferLayer) {
     const ubyte4 casterColor(255, 0, 0, 255);
     const ubyte4 backgroundColor(255, 255, 255, 255);
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <renderengine/mock/RenderEngine.h>
+
+#include <thread>
+
+#include "../threaded/RenderEngineThreaded.h"
+
+namespace android {
+
+using testing::Eq;
+using testing::Invoke;
+using testing::Return;
+
+struct RenderEngineThreadedTest : public ::testing::Test {
+    RenderEngineThreadedTest() {
+        mThreadedRE = renderengine::threaded::RenderEngineThreaded::create(
+                [this]() {
+                    return std::unique_ptr<renderengine::RenderEngine>(mRenderEngine);
+                },
+                renderengine::RenderEngineCreationArgs::Builder().build());
+    }
+
+    // Owned by mThreadedRE once it is created.
+    renderengine::mock::RenderEngine* mRenderEngine = new renderengine::mock::RenderEngine();
+    std::unique_ptr<renderengine::threaded::RenderEngineThreaded> mThreadedRE;
+};
+
+TEST_F(RenderEngineThreadedTest, callsRunOnTheRenderEngineThread) {
+    const std::thread::id callerId = std::this_thread::get_id();
+    std::thread::id calleeId;
+    EXPECT_CALL(*mRenderEngine, getMaxTextureSize()).WillOnce(Invoke([&]() {
+        calleeId = std::this_thread::get_id();
+        return size_t(20);
+    }));
+
+    ASSERT_EQ(size_t(20), mThreadedRE->getMaxTextureSize());
+    EXPECT_NE(callerId, calleeId);
+}
+
+TEST_F(RenderEngineThreadedTest, genTextures) {
+    uint32_t texName;
+    EXPECT_CALL(*mRenderEngine, genTextures(1, &texName));
+    mThreadedRE->genTextures(1, &texName);
+}
+
+TEST_F(RenderEngineThreadedTest, bindExternalTextureBuffer_returnsResult) {
+    sp<GraphicBuffer> buffer = new GraphicBuffer();
+    sp<Fence> fence = Fence::NO_FENCE;
+    EXPECT_CALL(*mRenderEngine, bindExternalTextureBuffer(3, Eq(buffer), Eq(fence)))
+            .WillOnce(Return(NO_MEMORY));
+    EXPECT_EQ(NO_MEMORY, mThreadedRE->bindExternalTextureBuffer(3, buffer, fence));
+}
+
+TEST_F(RenderEngineThreadedTest, unbindExternalTextureBuffer_runsInOrder) {
+    testing::InSequence sequence;
+    EXPECT_CALL(*mRenderEngine, unbindExternalTextureBuffer(0x3));
+    EXPECT_CALL(*mRenderEngine, unbindExternalTextureBuffer(0x4));
+    EXPECT_CALL(*mRenderEngine, isProtected()).WillOnce(Return(true));
+
+    mThreadedRE->unbindExternalTextureBuffer(0x3);
+    mThreadedRE->unbindExternalTextureBuffer(0x4);
+    // Waits for the asynchronous calls queued before it.
+    EXPECT_TRUE(mThreadedRE->isProtected());
+}
+
+TEST_F(RenderEngineThreadedTest, drawLayers) {
+    renderengine::DisplaySettings settings;
+    std::vector<const renderengine::LayerSettings*> layers;
+    sp<GraphicBuffer> buffer = new GraphicBuffer();
+    base::unique_fd bufferFence;
+    base::unique_fd drawFence;
+
+    EXPECT_CALL(*mRenderEngine, drawLayers)
+            .WillOnce([](const renderengine::DisplaySettings&,
+                         const std::vector<const renderengine::LayerSettings*>&,
+                         ANativeWindowBuffer*, const bool, base::unique_fd&&,
+                         base::unique_fd*) -> status_t { return NO_ERROR; });
+
+    EXPECT_EQ(NO_ERROR,
+              mThreadedRE->drawLayers(settings, layers, buffer->getNativeBuffer(), true,
+                                      std::move(bufferFence), &drawFence));
+}
+
+} // namespace android
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "RenderEngineThreaded.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <future>
+
+#include <processgroup/sched_policy.h>
+#include <utils/Log.h>
+#include <utils/Trace.h>
+
+namespace android {
+namespace renderengine {
+namespace threaded {
+
+std::unique_ptr<RenderEngineThreaded> RenderEngineThreaded::create(
+        CreateInstanceFactory factory, const RenderEngineCreationArgs& args) {
+    return std::make_unique<RenderEngineThreaded>(std::move(factory), args);
+}
+
+RenderEngineThreaded::RenderEngineThreaded(CreateInstanceFactory factory,
+                                           const RenderEngineCreationArgs& args)
+      : impl::RenderEngine(args) {
+    ATRACE_CALL();
+    mThread = std::thread([this, factory = std::move(factory)]() { threadMain(factory); });
+    pthread_setname_np(mThread.native_handle(), "RenderEngine");
+    // Use SCHED_FIFO to minimize jitter
+    struct sched_param param = {0};
+    param.sched_priority = 2;
+    if (pthread_setschedparam(mThread.native_handle(), SCHED_FIFO, &param) != 0) {
+        ALOGE("Couldn't set SCHED_FIFO for RenderEngine");
+    }
+}
+
+RenderEngineThreaded::~RenderEngineThreaded() {
+    queueCall([this](renderengine::RenderEngine&) { mRunning = false; });
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) {
+    set_sched_policy(0, SP_FOREGROUND);
+    // The EGL context is created, made current and destroyed on this thread.
+    mRenderEngine = factory();
+
+    while (mRunning) {
+        Call call;
+        {
+            std::lock_guard<std::mutex> lock(mThreadMutex);
+            mCondition.wait(mThreadMutex,
+                            [&]() REQUIRES(mThreadMutex) { return !mFunctionCalls.empty(); });
+            call = std::move(mFunctionCalls.front());
+            mFunctionCalls.pop();
+        }
+        call(*mRenderEngine);
+    }
+    mRenderEngine = nullptr;
+}
+
+void RenderEngineThreaded::queueCall(Call call) const {
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push(std::move(call));
+    }
+    mCondition.notify_one();
+}
+
+void RenderEngineThreaded::runAndWait(const Call& call) const {
+    std::promise<void> done;
+    std::future<void> doneFuture = done.get_future();
+    queueCall([&](renderengine::RenderEngine& instance) {
+        call(instance);
+        done.set_value();
+    });
+    doneFuture.wait();
+}
+
+void RenderEngineThreaded::primeCache() const {
+    runAndWait([](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::primeCache");
+        instance.primeCache();
+    });
+}
+
+void RenderEngineThreaded::dump(std::string& result) {
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::dump");
+        instance.dump(result);
+    });
+}
+
+bool RenderEngineThreaded::useNativeFenceSync() const {
+    bool result = false;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        result = instance.useNativeFenceSync();
+    });
+    return result;
+}
+
+bool RenderEngineThreaded::useWaitSync() const {
+    bool result = false;
+    runAndWait([&](renderengine::RenderEngine& instance) { result = instance.useWaitSync(); });
+    return result;
+}
+
+void RenderEngineThreaded::genTextures(size_t count, uint32_t* names) {
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::genTextures");
+        instance.genTextures(count, names);
+    });
+}
+
+void RenderEngineThreaded::deleteTextures(size_t count, uint32_t const* names) {
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::deleteTextures");
+        instance.deleteTextures(count, names);
+    });
+}
+
+void RenderEngineThreaded::bindExternalTextureImage(uint32_t texName, const Image& image) {
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::bindExternalTextureImage");
+        instance.bindExternalTextureImage(texName, image);
+    });
+}
+
+status_t RenderEngineThreaded::bindExternalTextureBuffer(uint32_t texName,
+                                                         const sp<GraphicBuffer>& buffer,
+                                                         const sp<Fence>& fence) {
+    status_t result = NO_ERROR;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::bindExternalTextureBuffer");
+        result = instance.bindExternalTextureBuffer(texName, buffer, fence);
+    });
+    return result;
+}
+
+void RenderEngineThreaded::cacheExternalTextureBuffer(const sp<GraphicBuffer>& buffer) {
+    // Asynchronous in the interface, so binder threads don't wait for a frame being drawn.
+    queueCall([buffer](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::cacheExternalTextureBuffer");
+        instance.cacheExternalTextureBuffer(buffer);
+    });
+}
+
+void RenderEngineThreaded::unbindExternalTextureBuffer(uint64_t bufferId) {
+    queueCall([bufferId](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::unbindExternalTextureBuffer");
+        instance.unbindExternalTextureBuffer(bufferId);
+    });
+}
+
+status_t RenderEngineThreaded::bindFrameBuffer(Framebuffer* framebuffer) {
+    status_t result = NO_ERROR;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::bindFrameBuffer");
+        result = instance.bindFrameBuffer(framebuffer);
+    });
+    return result;
+}
+
+void RenderEngineThreaded::unbindFrameBuffer(Framebuffer* framebuffer) {
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::unbindFrameBuffer");
+        instance.unbindFrameBuffer(framebuffer);
+    });
+}
+
+bool RenderEngineThreaded::cleanupPostRender(CleanupMode mode) {
+    bool result = false;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::cleanupPostRender");
+        result = instance.cleanupPostRender(mode);
+    });
+    return result;
+}
+
+size_t RenderEngineThreaded::getMaxTextureSize() const {
+    size_t result = 0;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        result = instance.getMaxTextureSize();
+    });
+    return result;
+}
+
+size_t RenderEngineThreaded::getMaxViewportDims() const {
+    size_t result = 0;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        result = instance.getMaxViewportDims();
+    });
+    return result;
+}
+
+bool RenderEngineThreaded::isProtected() const {
+    bool result = false;
+    runAndWait([&](renderengine::RenderEngine& instance) { result = instance.isProtected(); });
+    return result;
+}
+
+bool RenderEngineThreaded::supportsProtectedContent() const {
+    bool result = false;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        result = instance.supportsProtectedContent();
+    });
+    return result;
+}
+
+bool RenderEngineThreaded::useProtectedContext(bool useProtectedContext) {
+    bool result = false;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::useProtectedContext");
+        result = instance.useProtectedContext(useProtectedContext);
+    });
+    return result;
+}
+
+Framebuffer* RenderEngineThreaded::getFramebufferForDrawing() {
+    Framebuffer* framebuffer = nullptr;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        framebuffer = instance.getFramebufferForDrawing();
+    });
+    return framebuffer;
+}
+
+status_t RenderEngineThreaded::drawLayers(const DisplaySettings& display,
+                                          const std::vector<const LayerSettings*>& layers,
+                                          ANativeWindowBuffer* buffer,
+                                          const bool useFramebufferCache,
+                                          base::unique_fd&& bufferFence,
+                                          base::unique_fd* drawFence) {
+    status_t result = NO_ERROR;
+    runAndWait([&](renderengine::RenderEngine& instance) {
+        ATRACE_NAME("REThreaded::drawLayers");
+        result = instance.drawLayers(display, layers, buffer, useFramebufferCache,
+                                     std::move(bufferFence), drawFence);
+    });
+    return result;
+}
+
+} // namespace threaded
+} // namespace renderengine
+} // namespace android
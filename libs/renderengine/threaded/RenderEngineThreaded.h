@@ -0,0 +1,103 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include <renderengine/RenderEngine.h>
+
+namespace android {
+namespace renderengine {
+namespace threaded {
+
+using CreateInstanceFactory = std::function<std::unique_ptr<renderengine::RenderEngine>()>;
+
+/**
+ * A RenderEngine that forwards every call to another one running on a thread of its own. Each
+ * call is queued as a function, which the thread runs in order. The caller waits for it, except
+ * for the calls the interface documents as asynchronous.
+ *
+ * The RenderEngine it wraps is created, used and destroyed on that thread only, so the EGL
+ * context is current there and the SurfaceFlinger main thread never holds it. The thread runs
+ * at SCHED_FIFO, like the ImageManager thread.
+ */
+class RenderEngineThreaded : public impl::RenderEngine {
+public:
+    static std::unique_ptr<RenderEngineThreaded> create(CreateInstanceFactory factory,
+                                                        const RenderEngineCreationArgs& args);
+
+    RenderEngineThreaded(CreateInstanceFactory factory, const RenderEngineCreationArgs& args);
+    ~RenderEngineThreaded() override;
+    void primeCache() const override;
+
+    void dump(std::string& result) override;
+
+    bool useNativeFenceSync() const override;
+    bool useWaitSync() const override;
+    void genTextures(size_t count, uint32_t* names) override;
+    void deleteTextures(size_t count, uint32_t const* names) override;
+    void bindExternalTextureImage(uint32_t texName, const Image& image) override;
+    status_t bindExternalTextureBuffer(uint32_t texName, const sp<GraphicBuffer>& buffer,
+                                       const sp<Fence>& fence) override;
+    void cacheExternalTextureBuffer(const sp<GraphicBuffer>& buffer) override;
+    void unbindExternalTextureBuffer(uint64_t bufferId) override;
+    status_t bindFrameBuffer(Framebuffer* framebuffer) override;
+    void unbindFrameBuffer(Framebuffer* framebuffer) override;
+    bool cleanupPostRender(CleanupMode mode) override;
+    size_t getMaxTextureSize() const override;
+    size_t getMaxViewportDims() const override;
+
+    bool isProtected() const override;
+    bool supportsProtectedContent() const override;
+    bool useProtectedContext(bool useProtectedContext) override;
+
+    status_t drawLayers(const DisplaySettings& display,
+                        const std::vector<const LayerSettings*>& layers,
+                        ANativeWindowBuffer* buffer, const bool useFramebufferCache,
+                        base::unique_fd&& bufferFence, base::unique_fd* drawFence) override;
+
+protected:
+    Framebuffer* getFramebufferForDrawing() override;
+
+private:
+    using Call = std::function<void(renderengine::RenderEngine&)>;
+
+    void threadMain(CreateInstanceFactory factory);
+    // Queues call for the thread, without waiting for it.
+    void queueCall(Call call) const;
+    // Queues call and waits until the thread has run it.
+    void runAndWait(const Call& call) const;
+
+    // The wrapped RenderEngine, only touched on mThread.
+    std::unique_ptr<renderengine::RenderEngine> mRenderEngine;
+
+    std::thread mThread;
+    mutable std::mutex mThreadMutex;
+    mutable std::condition_variable_any mCondition;
+    mutable std::queue<Call> mFunctionCalls GUARDED_BY(mThreadMutex);
+    // Only read and written on mThread.
+    bool mRunning = true;
+};
+
+} // namespace threaded
+} // namespace renderengine
+} // namespace android
@@ -42,6 +42,10 @@ namespace android {
 Mutex SensorManager::sLock;
 std::map<String16, SensorManager*> SensorManager::sPackageInstances;
 
+Mutex SensorManager::sSensorListLock;
+wp<IBinder> SensorManager::sSensorListServer;
+Vector<Sensor> SensorManager::sSensorList;
+
 SensorManager& SensorManager::getInstanceForPackage(const String16& packageName) {
     waitForSensorService(nullptr);
 
@@ -160,7 +164,7 @@ status_t SensorManager::assertStateLocked() {
         mDeathObserver = new DeathObserver(*const_cast<SensorManager *>(this));
         IInterface::asBinder(mSensorServer)->linkToDeath(mDeathObserver);
 
-        mSensors = mSensorServer->getSensorList(mOpPackageName);
+        mSensors = getSensorListFromCache(mSensorServer, mOpPackageName);
         size_t count = mSensors.size();
         mSensorList =
                 static_cast<Sensor const**>(malloc(count * sizeof(Sensor*)));
@@ -174,6 +178,19 @@ status_t SensorManager::assertStateLocked() {
     return NO_ERROR;
 }
 
+Vector<Sensor> SensorManager::getSensorListFromCache(const sp<ISensorServer>& server,
+                                                     const String16& opPackageName) {
+    Mutex::Autolock _l(sSensorListLock);
+    sp<IBinder> binder = IInterface::asBinder(server);
+    if (sSensorListServer.promote() != binder) {
+        // Either the first SensorManager of the process, or the sensor service restarted.
+        sSensorList = server->getSensorList(opPackageName);
+        sSensorListServer = binder;
+    }
+    // Vector copies share the storage until one of them is modified.
+    return sSensorList;
+}
+
 ssize_t SensorManager::getSensorList(Sensor const* const** list) {
     Mutex::Autolock _l(mLock);
     status_t err = assertStateLocked();
@@ -73,11 +73,19 @@ private:
 
     explicit SensorManager(const String16& opPackageName);
     status_t assertStateLocked();
+    static Vector<Sensor> getSensorListFromCache(const sp<ISensorServer>& server,
+                                                 const String16& opPackageName);
 
 private:
     static Mutex sLock;
     static std::map<String16, SensorManager*> sPackageInstances;
 
+    // The static sensor list is the same for every SensorManager in the process, so it is only
+    // fetched once from each instance of the sensor service.
+    static Mutex sSensorListLock;
+    static wp<IBinder> sSensorListServer;
+    static Vector<Sensor> sSensorList;
+
     Mutex mLock;
     sp<ISensorServer> mSensorServer;
     Sensor const** mSensorList;
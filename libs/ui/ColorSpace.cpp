@@ -376,6 +376,101 @@ std::unique_ptr<float3[]> ColorSpace::createLUT(uint32_t size, const ColorSpace&
     return lut;
 }
 
+ColorSpaceLUT::ColorSpaceLUT(const ColorSpace& src, const ColorSpace& dst, uint32_t size)
+      : mSize(clamp(size, 2u, 256u)) {
+    const float m = 1.0f / float(mSize - 1);
+    mTable.reserve(mSize * mSize * mSize);
+
+    ColorSpaceConnector connector(src, dst);
+    for (uint32_t b = 0; b < mSize; b++) {
+        for (uint32_t g = 0; g < mSize; g++) {
+            for (uint32_t r = 0; r < mSize; r++) {
+                mTable.push_back(connector.transform({
+                    static_cast<float>(r) * m,
+                    static_cast<float>(g) * m,
+                    static_cast<float>(b) * m,
+                }));
+            }
+        }
+    }
+}
+
+static inline float3 interpolate(const float3& a, const float3& b, float t) {
+    return a + (b - a) * t;
+}
+
+template <ColorSpaceLUT::Interpolation I>
+float3 ColorSpaceLUT::sample(const float3& v) const noexcept {
+    const float scale = float(mSize - 1);
+    const float3 p = clamp(v, 0.0f, 1.0f) * scale;
+
+    // Index of the lower corner of the cube containing p; the upper corner of the last cube
+    // is the last entry, so the lower corner stops one short of it.
+    const uint32_t r = std::min(static_cast<uint32_t>(p.r), mSize - 2);
+    const uint32_t g = std::min(static_cast<uint32_t>(p.g), mSize - 2);
+    const uint32_t b = std::min(static_cast<uint32_t>(p.b), mSize - 2);
+    const float fr = p.r - float(r);
+    const float fg = p.g - float(g);
+    const float fb = p.b - float(b);
+
+    const size_t dr = 1;
+    const size_t dg = mSize;
+    const size_t db = mSize * mSize;
+    const float3* c = &mTable[b * db + g * dg + r * dr];
+    const float3& c000 = c[0];
+    const float3& c100 = c[dr];
+    const float3& c010 = c[dg];
+    const float3& c110 = c[dg + dr];
+    const float3& c001 = c[db];
+    const float3& c101 = c[db + dr];
+    const float3& c011 = c[db + dg];
+    const float3& c111 = c[db + dg + dr];
+
+    if (I == Interpolation::TRILINEAR) {
+        const float3 c00 = interpolate(c000, c100, fr);
+        const float3 c10 = interpolate(c010, c110, fr);
+        const float3 c01 = interpolate(c001, c101, fr);
+        const float3 c11 = interpolate(c011, c111, fr);
+        return interpolate(interpolate(c00, c10, fg), interpolate(c01, c11, fg), fb);
+    }
+
+    // Pick the tetrahedron of the cube containing p, and walk its edges from c000 to c111.
+    if (fr > fg) {
+        if (fg > fb) {
+            return c000 + fr * (c100 - c000) + fg * (c110 - c100) + fb * (c111 - c110);
+        }
+        if (fr > fb) {
+            return c000 + fr * (c100 - c000) + fb * (c101 - c100) + fg * (c111 - c101);
+        }
+        return c000 + fb * (c001 - c000) + fr * (c101 - c001) + fg * (c111 - c101);
+    }
+    if (fb > fg) {
+        return c000 + fb * (c001 - c000) + fg * (c011 - c001) + fr * (c111 - c011);
+    }
+    if (fb > fr) {
+        return c000 + fg * (c010 - c000) + fb * (c011 - c010) + fr * (c111 - c011);
+    }
+    return c000 + fg * (c010 - c000) + fr * (c110 - c010) + fb * (c111 - c110);
+}
+
+float3 ColorSpaceLUT::transform(const float3& v, Interpolation interpolation) const noexcept {
+    return interpolation == Interpolation::TRILINEAR ? sample<Interpolation::TRILINEAR>(v)
+                                                     : sample<Interpolation::TETRAHEDRAL>(v);
+}
+
+void ColorSpaceLUT::transform(const float3* in, float3* out, size_t count,
+                              Interpolation interpolation) const noexcept {
+    if (interpolation == Interpolation::TRILINEAR) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = sample<Interpolation::TRILINEAR>(in[i]);
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = sample<Interpolation::TETRAHEDRAL>(in[i]);
+        }
+    }
+}
+
 static const float2 ILLUMINANT_D50_XY = {0.34567f, 0.35850f};
 static const float3 ILLUMINANT_D50_XYZ = {0.964212f, 1.0f, 0.825188f};
 static const mat3 BRADFORD = mat3{
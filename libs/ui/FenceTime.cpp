@@ -20,8 +20,11 @@
 
 #include <cutils/compiler.h>  // For CC_[UN]LIKELY
 #include <utils/Log.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <memory>
 
@@ -149,6 +152,67 @@ nsecs_t FenceTime::getCachedSignalTime() const {
     return mSignalTime.load(std::memory_order_acquire);
 }
 
+void FenceTime::updateSignalTimes(
+        const std::vector<std::shared_ptr<FenceTime>>& fenceTimes) {
+    std::vector<FenceTime*> pendingFenceTimes;
+    // Keeps the file descriptors open until the poll returns.
+    std::vector<sp<Fence>> pendingFences;
+    std::vector<struct pollfd> pollFds;
+
+    for (const auto& fenceTime : fenceTimes) {
+        if (!fenceTime || fenceTime->mSignalTime.load(
+                std::memory_order_relaxed) != Fence::SIGNAL_TIME_PENDING) {
+            continue;
+        }
+
+        sp<Fence> fence;
+        {
+            std::lock_guard<std::mutex> lock(fenceTime->mMutex);
+            fence = fenceTime->mFence;
+        }
+        if (!fence.get()) {
+            continue;
+        }
+
+        // Fences without a file descriptor, as used by tests, do not need a
+        // system call to be queried.
+        if (fence->get() < 0) {
+            fenceTime->getSignalTime();
+            continue;
+        }
+
+        pendingFenceTimes.push_back(fenceTime.get());
+        pendingFences.push_back(std::move(fence));
+        pollFds.push_back({pendingFences.back()->get(), POLLIN, 0});
+    }
+
+    // A single fence is as cheap to query directly.
+    if (pollFds.size() <= 1) {
+        for (auto* fenceTime : pendingFenceTimes) {
+            fenceTime->getSignalTime();
+        }
+        return;
+    }
+
+    int result;
+    do {
+        result = poll(pollFds.data(), pollFds.size(), 0);
+    } while (result == -1 && errno == EINTR);
+
+    if (result < 0) {
+        ALOGE("Failed to poll %zu fences: %s (%d)", pollFds.size(),
+                strerror(errno), errno);
+    }
+
+    for (size_t i = 0; i < pollFds.size(); i++) {
+        // Fences which signaled, or which poll reported an error for, are
+        // left to getSignalTime() to sort out.
+        if (result < 0 || pollFds[i].revents != 0) {
+            pendingFenceTimes[i]->getSignalTime();
+        }
+    }
+}
+
 FenceTime::Snapshot FenceTime::getSnapshot() const {
     // Quick check without the lock.
     nsecs_t signalTime = mSignalTime.load(std::memory_order_relaxed);
@@ -273,23 +337,40 @@ void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
             // we are removing it from the timeline.
             front->getSignalTime();
         }
-        mQueue.pop();
+        mQueue.pop_front();
     }
-    mQueue.push(fence);
+    mQueue.push_back(fence);
 }
 
 void FenceTimeline::updateSignalTimes() {
     std::lock_guard<std::mutex> lock(mMutex);
+
+    // Poll all the queued fences at once, rather than one system call per
+    // fence that signaled plus one for the first one that did not.
+    const bool polled = mQueue.size() > 1;
+    if (polled) {
+        std::vector<std::shared_ptr<FenceTime>> fences;
+        fences.reserve(mQueue.size());
+        for (const auto& weakFence : mQueue) {
+            fences.push_back(weakFence.lock());
+        }
+        FenceTime::updateSignalTimes(fences);
+    }
+
     while (!mQueue.empty()) {
         std::shared_ptr<FenceTime> fence = mQueue.front().lock();
         if (!fence) {
             // The shared_ptr no longer exists and no one cares about the
             // timestamp anymore.
-            mQueue.pop();
+            mQueue.pop_front();
             continue;
-        } else if (fence->getSignalTime() != Fence::SIGNAL_TIME_PENDING) {
+        }
+
+        const nsecs_t signalTime = polled ? fence->getCachedSignalTime()
+                                          : fence->getSignalTime();
+        if (signalTime != Fence::SIGNAL_TIME_PENDING) {
             // The fence has signaled and we've removed the sp<Fence> ref.
-            mQueue.pop();
+            mQueue.pop_front();
             continue;
         } else {
             // The fence didn't signal yet. Break since the later ones
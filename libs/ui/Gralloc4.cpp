@@ -160,6 +160,11 @@ status_t Gralloc4Mapper::importBuffer(const hardware::hidl_handle& rawHandle,
 }
 
 void Gralloc4Mapper::freeBuffer(buffer_handle_t bufferHandle) const {
+    {
+        std::lock_guard<std::mutex> lock(mMetadataCacheMutex);
+        mMetadataCache.erase(bufferHandle);
+    }
+
     auto buffer = const_cast<native_handle_t*>(bufferHandle);
     auto ret = mMapper->freeBuffer(buffer);
 
@@ -409,6 +414,52 @@ int Gralloc4Mapper::unlock(buffer_handle_t bufferHandle) const {
     return releaseFence;
 }
 
+status_t Gralloc4Mapper::flushLockedBuffer(buffer_handle_t bufferHandle,
+                                           int* outReleaseFence) const {
+    auto buffer = const_cast<native_handle_t*>(bufferHandle);
+
+    *outReleaseFence = -1;
+    Error error;
+    auto ret = mMapper->flushLockedBuffer(buffer,
+                                          [&](const auto& tmpError, const auto& tmpReleaseFence) {
+                                              error = tmpError;
+                                              if (error != Error::NONE) {
+                                                  return;
+                                              }
+
+                                              auto fenceHandle = tmpReleaseFence.getNativeHandle();
+                                              if (fenceHandle && fenceHandle->numFds == 1) {
+                                                  int fd = dup(fenceHandle->data[0]);
+                                                  if (fd >= 0) {
+                                                      *outReleaseFence = fd;
+                                                  } else {
+                                                      ALOGD("failed to dup flush release fence");
+                                                      sync_wait(fenceHandle->data[0], -1);
+                                                  }
+                                              }
+                                          });
+
+    if (!ret.isOk()) {
+        error = kTransactionError;
+    }
+
+    if (error != Error::NONE) {
+        ALOGE("flushLockedBuffer(%p) failed with %d", buffer, error);
+    }
+
+    return static_cast<status_t>(error);
+}
+
+status_t Gralloc4Mapper::rereadLockedBuffer(buffer_handle_t bufferHandle) const {
+    auto buffer = const_cast<native_handle_t*>(bufferHandle);
+
+    auto ret = mMapper->rereadLockedBuffer(buffer);
+
+    auto error = (ret.isOk()) ? static_cast<Error>(ret) : kTransactionError;
+    ALOGE_IF(error != Error::NONE, "rereadLockedBuffer(%p) failed with %d", buffer, error);
+    return static_cast<status_t>(error);
+}
+
 status_t Gralloc4Mapper::isSupported(uint32_t width, uint32_t height, PixelFormat format,
                                      uint32_t layerCount, uint64_t usage,
                                      bool* outSupported) const {
@@ -439,6 +490,60 @@ status_t Gralloc4Mapper::isSupported(uint32_t width, uint32_t height, PixelForma
     return static_cast<status_t>(error);
 }
 
+// Standard metadata that the mapper reports but does not allow to be set, so it stays the same
+// for the lifetime of a buffer.
+static bool isImmutableMetadataType(const MetadataType& metadataType) {
+    if (!gralloc4::isStandardMetadataType(metadataType)) {
+        return false;
+    }
+    switch (gralloc4::getStandardMetadataTypeValue(metadataType)) {
+        case StandardMetadataType::BUFFER_ID:
+        case StandardMetadataType::NAME:
+        case StandardMetadataType::WIDTH:
+        case StandardMetadataType::HEIGHT:
+        case StandardMetadataType::LAYER_COUNT:
+        case StandardMetadataType::PIXEL_FORMAT_REQUESTED:
+        case StandardMetadataType::PIXEL_FORMAT_FOURCC:
+        case StandardMetadataType::PIXEL_FORMAT_MODIFIER:
+        case StandardMetadataType::USAGE:
+        case StandardMetadataType::ALLOCATION_SIZE:
+        case StandardMetadataType::PLANE_LAYOUTS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Gralloc4Mapper::getCachedMetadata(buffer_handle_t bufferHandle,
+                                       const MetadataType& metadataType,
+                                       hidl_vec<uint8_t>* outVec) const {
+    if (!isImmutableMetadataType(metadataType)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMetadataCacheMutex);
+    auto buffer = mMetadataCache.find(bufferHandle);
+    if (buffer == mMetadataCache.end()) {
+        return false;
+    }
+    auto entry = buffer->second.find(metadataType.value);
+    if (entry == buffer->second.end()) {
+        return false;
+    }
+    *outVec = entry->second;
+    return true;
+}
+
+void Gralloc4Mapper::cacheMetadata(buffer_handle_t bufferHandle, const MetadataType& metadataType,
+                                   const hidl_vec<uint8_t>& vec) const {
+    if (!isImmutableMetadataType(metadataType)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMetadataCacheMutex);
+    mMetadataCache[bufferHandle][metadataType.value] = vec;
+}
+
 template <class T>
 status_t Gralloc4Mapper::get(buffer_handle_t bufferHandle, const MetadataType& metadataType,
                              DecodeFunction<T> decodeFunction, T* outMetadata) const {
@@ -447,6 +552,10 @@ status_t Gralloc4Mapper::get(buffer_handle_t bufferHandle, const MetadataType& m
     }
 
     hidl_vec<uint8_t> vec;
+    if (getCachedMetadata(bufferHandle, metadataType, &vec)) {
+        return decodeFunction(vec, outMetadata);
+    }
+
     Error error;
     auto ret = mMapper->get(const_cast<native_handle_t*>(bufferHandle), metadataType,
                             [&](const auto& tmpError, const hidl_vec<uint8_t>& tmpVec) {
@@ -464,6 +573,7 @@ status_t Gralloc4Mapper::get(buffer_handle_t bufferHandle, const MetadataType& m
         return static_cast<status_t>(error);
     }
 
+    cacheMetadata(bufferHandle, metadataType, vec);
     return decodeFunction(vec, outMetadata);
 }
 
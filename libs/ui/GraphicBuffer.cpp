@@ -123,7 +123,11 @@ void GraphicBuffer::free_handle()
         mBufferMapper.freeBuffer(handle);
     } else if (mOwner == ownData) {
         GraphicBufferAllocator& allocator(GraphicBufferAllocator::get());
-        allocator.free(handle);
+        if (mRecyclable) {
+            allocator.recycle(handle);
+        } else {
+            allocator.free(handle);
+        }
     }
     handle = nullptr;
 }
@@ -368,6 +372,9 @@ status_t GraphicBuffer::flatten(void*& buffer, size_t& size, int*& fds, size_t&
     size_t fdCountNeeded = GraphicBuffer::getFdCount();
     if (count < fdCountNeeded) return NO_MEMORY;
 
+    // The receiving process may keep using the buffer after it is dropped here.
+    mRecyclable = false;
+
     int32_t* buf = static_cast<int32_t*>(buffer);
     buf[0] = 'GB01';
     buf[1] = width;
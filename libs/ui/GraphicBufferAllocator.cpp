@@ -101,6 +101,14 @@ void GraphicBufferAllocator::dump(std::string& result, bool less) const {
     }
     StringAppendF(&result, "Total allocated by GraphicBufferAllocator (estimate): %.2f KB\n",
                   static_cast<double>(total) / 1024.0);
+    if (mPoolBudget > 0) {
+        StringAppendF(&result,
+                      "Pool: %zu buffers, %.2f KB of %.2f KB | %" PRIu64 " hits, %" PRIu64
+                      " misses, %" PRIu64 " trimmed\n",
+                      mPool.size(), static_cast<double>(mPoolSize) / 1024.0,
+                      static_cast<double>(mPoolBudget) / 1024.0, mPoolHits, mPoolMisses,
+                      mPoolTrimmed);
+    }
 
     result.append(mAllocator->dumpDebugInfo(less));
 }
@@ -137,6 +145,14 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
     // TODO(b/72323293, b/72703005): Remove these invalid bits from callers
     usage &= ~static_cast<uint64_t>((1 << 10) | (1 << 13));
 
+    if (importBuffer) {
+        Mutex::Autolock _l(sLock);
+        if (takePooledBufferLocked(width, height, format, layerCount, usage, requestorName,
+                                   handle, stride)) {
+            return NO_ERROR;
+        }
+    }
+
     status_t error = mAllocator->allocate(requestorName, width, height, format, layerCount, usage,
                                           1, stride, handle, importBuffer);
     if (error != NO_ERROR) {
@@ -215,5 +231,101 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
     return NO_ERROR;
 }
 
+void GraphicBufferAllocator::setPoolBudget(size_t budgetBytes, nsecs_t maxIdleTime) {
+    std::vector<buffer_handle_t> trimmed;
+    {
+        Mutex::Autolock _l(sLock);
+        mPoolBudget = budgetBytes;
+        mPoolMaxIdleTime = maxIdleTime;
+        trimmed = trimPoolLocked(systemTime());
+    }
+
+    for (buffer_handle_t handle : trimmed) {
+        free(handle);
+    }
+}
+
+status_t GraphicBufferAllocator::recycle(buffer_handle_t handle) {
+    std::vector<buffer_handle_t> trimmed;
+    bool pooled = false;
+    {
+        Mutex::Autolock _l(sLock);
+        const ssize_t index = sAllocList.indexOfKey(handle);
+        if (mPoolBudget > 0 && index >= 0) {
+            const alloc_rec_t& rec = sAllocList.valueAt(index);
+            // Protected buffers are left out, as they may not be cleared by their next user.
+            if (rec.size > 0 && rec.size <= mPoolBudget &&
+                (rec.usage & GRALLOC_USAGE_PROTECTED) == 0) {
+                const nsecs_t now = systemTime();
+                mPool.push_back({handle, now});
+                mPoolSize += rec.size;
+                // The buffer just added is not trimmed, as it fits in the budget on its own.
+                trimmed = trimPoolLocked(now);
+                pooled = true;
+            }
+        }
+    }
+
+    for (buffer_handle_t trimmedHandle : trimmed) {
+        free(trimmedHandle);
+    }
+    return pooled ? NO_ERROR : free(handle);
+}
+
+void GraphicBufferAllocator::trimPool() {
+    std::vector<buffer_handle_t> trimmed;
+    {
+        Mutex::Autolock _l(sLock);
+        if (mPool.empty()) {
+            return;
+        }
+        trimmed = trimPoolLocked(systemTime());
+    }
+
+    for (buffer_handle_t handle : trimmed) {
+        free(handle);
+    }
+}
+
+bool GraphicBufferAllocator::takePooledBufferLocked(uint32_t width, uint32_t height,
+                                                    PixelFormat format, uint32_t layerCount,
+                                                    uint64_t usage,
+                                                    const std::string& requestorName,
+                                                    buffer_handle_t* handle, uint32_t* stride) {
+    if (mPoolBudget == 0) {
+        return false;
+    }
+
+    // Prefer the most recently recycled buffer, which is the least likely to be trimmed soon.
+    for (auto it = mPool.rbegin(); it != mPool.rend(); ++it) {
+        const alloc_rec_t& rec = sAllocList.valueFor(it->handle);
+        if (rec.width == width && rec.height == height && rec.format == format &&
+            rec.layerCount == layerCount && rec.usage == usage &&
+            rec.requestorName == requestorName) {
+            *handle = it->handle;
+            *stride = rec.stride;
+            mPoolSize -= rec.size;
+            mPool.erase(std::next(it).base());
+            mPoolHits++;
+            return true;
+        }
+    }
+
+    mPoolMisses++;
+    return false;
+}
+
+std::vector<buffer_handle_t> GraphicBufferAllocator::trimPoolLocked(nsecs_t now) {
+    std::vector<buffer_handle_t> trimmed;
+    while (!mPool.empty() &&
+           (mPoolSize > mPoolBudget || now - mPool.front().recycleTime > mPoolMaxIdleTime)) {
+        mPoolSize -= sAllocList.valueFor(mPool.front().handle).size;
+        trimmed.push_back(mPool.front().handle);
+        mPool.erase(mPool.begin());
+        mPoolTrimmed++;
+    }
+    return trimmed;
+}
+
 // ---------------------------------------------------------------------------
 }; // namespace android
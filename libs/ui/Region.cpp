@@ -643,6 +643,103 @@ bool Region::validate(const Region& reg, const char* name, bool silent)
     return result;
 }
 
+bool Region::boolean_operation_rects(uint32_t op, Region& dst,
+        Rect lhs, Rect rhs)
+{
+    if (lhs.isEmpty() || rhs.isEmpty()) {
+        return false;
+    }
+
+    Rect intersection;
+    const bool intersects = lhs.intersect(rhs, &intersection);
+    FatVector<Rect>& storage = dst.mStorage;
+    switch (op) {
+        case op_and:
+            if (intersects) {
+                dst.set(intersection);
+            } else {
+                dst.clear();
+            }
+            return true;
+
+        case op_nand:
+            if (!intersects) {
+                dst.set(lhs);
+                return true;
+            }
+            if (intersection == lhs) {
+                dst.clear();
+                return true;
+            }
+            // What is left of lhs is at most a band above, two rects on
+            // either side, and a band below the intersection.
+            storage.clear();
+            if (lhs.top < intersection.top) {
+                storage.push_back(Rect(lhs.left, lhs.top, lhs.right, intersection.top));
+            }
+            if (lhs.left < intersection.left) {
+                storage.push_back(Rect(lhs.left, intersection.top,
+                        intersection.left, intersection.bottom));
+            }
+            if (intersection.right < lhs.right) {
+                storage.push_back(Rect(intersection.right, intersection.top,
+                        lhs.right, intersection.bottom));
+            }
+            if (intersection.bottom < lhs.bottom) {
+                storage.push_back(Rect(lhs.left, intersection.bottom, lhs.right, lhs.bottom));
+            }
+            if (storage.size() > 1) {
+                Rect bounds(storage.front());
+                for (const Rect& rect : storage) {
+                    bounds.left = min(bounds.left, rect.left);
+                    bounds.right = max(bounds.right, rect.right);
+                }
+                bounds.bottom = storage.back().bottom;
+                storage.push_back(bounds);
+            }
+            return true;
+
+        case op_or:
+            if (intersects && intersection == lhs) {
+                dst.set(rhs);
+                return true;
+            }
+            if (intersects && intersection == rhs) {
+                dst.set(lhs);
+                return true;
+            }
+            // Rects which line up on one side merge into a single rect.
+            if (lhs.left == rhs.left && lhs.right == rhs.right &&
+                    lhs.top <= rhs.bottom && rhs.top <= lhs.bottom) {
+                dst.set(Rect(lhs.left, min(lhs.top, rhs.top),
+                        lhs.right, max(lhs.bottom, rhs.bottom)));
+                return true;
+            }
+            if (lhs.top == rhs.top && lhs.bottom == rhs.bottom &&
+                    lhs.left <= rhs.right && rhs.left <= lhs.right) {
+                dst.set(Rect(min(lhs.left, rhs.left), lhs.top,
+                        max(lhs.right, rhs.right), lhs.bottom));
+                return true;
+            }
+            // Rects which do not share any row are each a band of their own.
+            if (lhs.bottom <= rhs.top || rhs.bottom <= lhs.top) {
+                const Rect& upper = lhs.top < rhs.top ? lhs : rhs;
+                const Rect& lower = lhs.top < rhs.top ? rhs : lhs;
+                const Rect bounds(min(lhs.left, rhs.left), upper.top,
+                        max(lhs.right, rhs.right), lower.bottom);
+                storage.clear();
+                storage.push_back(upper);
+                storage.push_back(lower);
+                storage.push_back(bounds);
+                return true;
+            }
+            return false;
+
+        default:
+            return false;
+    }
+}
+
 void Region::boolean_operation(uint32_t op, Region& dst,
         const Region& lhs,
         const Region& rhs, int dx, int dy)
@@ -653,6 +750,19 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     validate(dst, "boolean_operation (before): dst");
 #endif
 
+#if !VALIDATE_WITH_CORECG
+    if (lhs.isRect() && rhs.isRect()) {
+        Rect rhsRect(rhs.getBounds());
+        rhsRect.offsetBy(dx, dy);
+        if (boolean_operation_rects(op, dst, lhs.getBounds(), rhsRect)) {
+#if defined(VALIDATE_REGIONS)
+            validate(dst, "boolean_operation_rects: dst");
+#endif
+            return;
+        }
+    }
+#endif
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -767,6 +877,14 @@ void Region::boolean_operation(uint32_t op, Region& dst,
 #if VALIDATE_WITH_CORECG || defined(VALIDATE_REGIONS)
     boolean_operation(op, dst, lhs, Region(rhs), dx, dy);
 #else
+    if (lhs.isRect()) {
+        Rect rhsRect(rhs);
+        rhsRect.offsetBy(dx, dy);
+        if (boolean_operation_rects(op, dst, lhs.getBounds(), rhsRect)) {
+            return;
+        }
+    }
+
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
@@ -16,6 +16,8 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include <android-base/stringprintf.h>
 #include <cutils/compiler.h>
 #include <ui/Region.h>
@@ -268,6 +270,17 @@ Region Transform::transform(const Region& reg) const
     Region out;
     if (CC_UNLIKELY(type() > TRANSLATE)) {
         if (CC_LIKELY(preserveRects())) {
+            if (reg.isEmpty()) {
+                return out;
+            }
+            // Unless the transform shrinks the region, rounding cannot make two rects of a valid
+            // region touch or vanish, so the rects can be moved as they are.
+            const mat33& M(mMatrix);
+            const bool shrinks = fabsf(M[0][0]) + fabsf(M[1][0]) < 1.0f ||
+                    fabsf(M[0][1]) + fabsf(M[1][1]) < 1.0f;
+            if (CC_LIKELY(!shrinks)) {
+                return (getOrientation() & ROT_90) ? transformRotated(reg) : transformAligned(reg);
+            }
             Region::const_iterator it = reg.begin();
             Region::const_iterator const end = reg.end();
             while (it != end) {
@@ -284,6 +297,100 @@ Region Transform::transform(const Region& reg) const
     return out;
 }
 
+// Puts rects transformed from a valid region back in the order of a valid region: mirroring makes
+// the bands run backwards in y, and the rects within each band backwards in x.
+static void reorderBands(Rect* begin, Rect* end, bool mirrorX, bool mirrorY) {
+    if (mirrorY) {
+        std::reverse(begin, end);
+    }
+    if (mirrorX != mirrorY) {
+        for (Rect* band = begin; band != end;) {
+            Rect* next = band + 1;
+            while (next != end && next->top == band->top) {
+                next++;
+            }
+            std::reverse(band, next);
+            band = next;
+        }
+    }
+}
+
+// Transforms a region without rotating it, by moving each rect in place.
+Region Transform::transformAligned(const Region& reg) const
+{
+    Region out(reg);
+    for (Rect& rect : out.mStorage) {
+        rect = transform(rect);
+    }
+    if (!out.isRect()) {
+        const mat33& M(mMatrix);
+        Rect* const begin = out.mStorage.data();
+        reorderBands(begin, begin + out.mStorage.size() - 1, M[0][0] < 0, M[1][1] < 0);
+    }
+    return out;
+}
+
+// Transforms a region rotated by 90 or 270 degrees. The x edges of the rects are where the bands
+// of the result start and end, so the region is first cut into columns between them, each column
+// becoming a band, and the columns are then transformed in place.
+Region Transform::transformRotated(const Region& reg) const
+{
+    FatVector<int32_t, 16> edges;
+    for (const Rect& rect : reg) {
+        edges.push_back(rect.left);
+        edges.push_back(rect.right);
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    Region out;
+    FatVector<Rect>& rects = out.mStorage;
+    rects.clear();
+    size_t previous = 0;
+    for (size_t i = 0; i + 1 < edges.size(); i++) {
+        const int32_t left = edges[i];
+        const int32_t right = edges[i + 1];
+        const size_t column = rects.size();
+        for (const Rect& rect : reg) {
+            if (rect.left > left || rect.right < right) {
+                continue;
+            }
+            if (rects.size() > column && rects.back().bottom == rect.top) {
+                rects.back().bottom = rect.bottom;
+            } else {
+                rects.push_back(Rect(left, rect.top, right, rect.bottom));
+            }
+        }
+
+        // A column which continues the one before it with the same spans widens it instead.
+        const size_t count = rects.size() - column;
+        const bool continues = count > 0 && column > previous && rects[previous].right == left &&
+                column - previous == count &&
+                std::equal(rects.begin() + previous, rects.begin() + column,
+                           rects.begin() + column, [](const Rect& lhs, const Rect& rhs) {
+                               return lhs.top == rhs.top && lhs.bottom == rhs.bottom;
+                           });
+        if (continues) {
+            for (size_t j = previous; j < column; j++) {
+                rects[j].right = right;
+            }
+            rects.resize(column);
+        } else if (count > 0) {
+            previous = column;
+        }
+    }
+
+    for (Rect& rect : rects) {
+        rect = transform(rect);
+    }
+    if (rects.size() > 1) {
+        const mat33& M(mMatrix);
+        reorderBands(rects.data(), rects.data() + rects.size(), M[1][0] < 0, M[0][1] < 0);
+        rects.push_back(transform(reg.getBounds()));
+    }
+    return out;
+}
+
 uint32_t Transform::type() const
 {
     if (mType & UNKNOWN_TYPE) {
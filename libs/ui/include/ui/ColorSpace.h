@@ -22,6 +22,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <math/mat3.h>
 #include <math/scalar.h>
@@ -300,6 +301,40 @@ private:
     mat3 mTransform;
 };
 
+/**
+ * A 3D lookup table sampling a ColorSpaceConnector, to convert many colors without
+ * evaluating the transfer functions of both color spaces for each of them. Input colors
+ * are clamped to [0..1], so this is not suitable for extended range color spaces.
+ */
+class ColorSpaceLUT {
+public:
+    enum class Interpolation {
+        TRILINEAR,
+        // Interpolates between 4 instead of 8 entries, and preserves neutral colors better.
+        TETRAHEDRAL,
+    };
+
+    // size is the number of entries per dimension, clamped to [2..256]
+    ColorSpaceLUT(const ColorSpace& src, const ColorSpace& dst, uint32_t size = 33);
+
+    uint32_t getSize() const noexcept { return mSize; }
+
+    float3 transform(const float3& v,
+                     Interpolation interpolation = Interpolation::TETRAHEDRAL) const noexcept;
+
+    // Converts count colors. in and out may point to the same buffer.
+    void transform(const float3* in, float3* out, size_t count,
+                   Interpolation interpolation = Interpolation::TETRAHEDRAL) const noexcept;
+
+private:
+    template <Interpolation I>
+    float3 sample(const float3& v) const noexcept;
+
+    uint32_t mSize;
+    // Indexed by [b][g][r]
+    std::vector<float3> mTable;
+};
+
 }; // namespace android
 
 #endif // ANDROID_UI_COLOR_SPACE
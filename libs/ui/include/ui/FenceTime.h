@@ -23,9 +23,11 @@
 #include <utils/Timers.h>
 
 #include <atomic>
+#include <deque>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 
@@ -109,6 +111,13 @@ public:
     // Gets the cached timestamp without attempting to query the Fence.
     nsecs_t getCachedSignalTime() const;
 
+    // Updates the cached timestamp of all the given FenceTimes. The pending
+    // Fences are polled together with a single system call, and only those
+    // that signaled are then queried for their timestamp. Callers can then
+    // use getCachedSignalTime() instead of polling each Fence on its own.
+    static void updateSignalTimes(
+            const std::vector<std::shared_ptr<FenceTime>>& fenceTimes);
+
     // Returns a snapshot of the FenceTime in its current state.
     Snapshot getSnapshot() const;
 
@@ -160,7 +169,7 @@ public:
 
 private:
     mutable std::mutex mMutex;
-    std::queue<std::weak_ptr<FenceTime>> mQueue GUARDED_BY(mMutex);
+    std::deque<std::weak_ptr<FenceTime>> mQueue GUARDED_BY(mMutex);
 };
 
 // Used by test code to create or get FenceTimes for a given Fence.
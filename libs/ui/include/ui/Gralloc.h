@@ -74,6 +74,20 @@ public:
     // owned by the caller
     virtual int unlock(buffer_handle_t bufferHandle) const = 0;
 
+    // flushLockedBuffer makes CPU writes to a locked buffer visible to other
+    // users of the buffer without unlocking it.  The release fence sync object
+    // (or -1) returned in *outReleaseFence is owned by the caller.
+    virtual status_t flushLockedBuffer(buffer_handle_t /*bufferHandle*/,
+                                       int* /*outReleaseFence*/) const {
+        return INVALID_OPERATION;
+    }
+
+    // rereadLockedBuffer makes writes by other users of a locked buffer
+    // visible to the CPU without unlocking it.
+    virtual status_t rereadLockedBuffer(buffer_handle_t /*bufferHandle*/) const {
+        return INVALID_OPERATION;
+    }
+
     // isSupported queries whether or not a buffer with the given width, height,
     // format, layer count, and usage can be allocated on the device.  If
     // *outSupported is set to true, a buffer with the given specifications may be successfully
@@ -26,7 +26,9 @@
 #include <ui/Rect.h>
 #include <utils/StrongPointer.h>
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 namespace android {
 
@@ -64,6 +66,10 @@ public:
 
     int unlock(buffer_handle_t bufferHandle) const override;
 
+    status_t flushLockedBuffer(buffer_handle_t bufferHandle, int* outReleaseFence) const override;
+
+    status_t rereadLockedBuffer(buffer_handle_t bufferHandle) const override;
+
     status_t isSupported(uint32_t width, uint32_t height, PixelFormat format, uint32_t layerCount,
                          uint64_t usage, bool* outSupported) const override;
 
@@ -165,6 +171,17 @@ private:
             const android::hardware::graphics::mapper::V4_0::IMapper::MetadataType& metadataType,
             DecodeFunction<T> decodeFunction, T* outMetadata) const;
 
+    // Metadata that cannot change after allocation is cached per imported buffer, encoded,
+    // until the buffer is freed.
+    bool getCachedMetadata(
+            buffer_handle_t bufferHandle,
+            const android::hardware::graphics::mapper::V4_0::IMapper::MetadataType& metadataType,
+            hardware::hidl_vec<uint8_t>* outVec) const;
+    void cacheMetadata(
+            buffer_handle_t bufferHandle,
+            const android::hardware::graphics::mapper::V4_0::IMapper::MetadataType& metadataType,
+            const hardware::hidl_vec<uint8_t>& vec) const;
+
     template <class T>
     status_t getDefault(
             uint32_t width, uint32_t height, PixelFormat format, uint32_t layerCount,
@@ -182,6 +199,12 @@ private:
             std::ostringstream* outDump, uint64_t* outAllocationSize, bool less) const;
 
     sp<hardware::graphics::mapper::V4_0::IMapper> mMapper;
+
+    mutable std::mutex mMetadataCacheMutex;
+    // Keyed by buffer handle, then by StandardMetadataType
+    mutable std::unordered_map<buffer_handle_t,
+                               std::unordered_map<int64_t, hardware::hidl_vec<uint8_t>>>
+            mMetadataCache;
 };
 
 class Gralloc4Allocator : public GrallocAllocator {
@@ -215,6 +215,11 @@ public:
 
     void addDeathCallback(GraphicBufferDeathCallback deathCallback, void* context);
 
+    // Returns the buffer to the GraphicBufferAllocator pool instead of freeing it once the last
+    // reference is dropped. Only for buffers allocated by this GraphicBuffer which are never
+    // given to another process. Flattening the buffer opts it out again.
+    void setRecyclable(bool recyclable) { mRecyclable = recyclable; }
+
 private:
     ~GraphicBuffer();
 
@@ -278,6 +283,9 @@ private:
     // and informs SurfaceFlinger that it should drop its strong pointer reference to the buffer.
     std::vector<std::pair<GraphicBufferDeathCallback, void* /*mDeathCallbackContext*/>>
             mDeathCallbacks;
+
+    // Set by flatten(), which may be called on a const buffer.
+    mutable bool mRecyclable = false;
 };
 
 }; // namespace android
@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <cutils/native_handle.h>
 
@@ -31,6 +32,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -72,6 +74,29 @@ public:
 
     status_t free(buffer_handle_t handle);
 
+    /**
+     * Enables a pool of recycled buffers. Allocations with the same dimensions, format, layer
+     * count, usage and requestor name as a pooled buffer are then served from the pool instead
+     * of the gralloc HAL. The pool holds up to budgetBytes, and frees buffers which have been
+     * pooled for longer than maxIdleTime. A budget of 0 disables the pool and frees its buffers.
+     *
+     * Pooled buffers keep the contents they had when they were recycled.
+     */
+    void setPoolBudget(size_t budgetBytes, nsecs_t maxIdleTime);
+
+    /**
+     * Like free(), but keeps the buffer in the pool if it is enabled and has room for it.
+     *
+     * The caller must make sure no other process holds the buffer, as it will be handed out
+     * again by a later allocation.
+     */
+    status_t recycle(buffer_handle_t handle);
+
+    /**
+     * Frees the pooled buffers which have been idle for too long.
+     */
+    void trimPool();
+
     uint64_t getTotalSize() const;
 
     void dump(std::string& res, bool less = true) const;
@@ -89,13 +114,36 @@ protected:
         std::string requestorName;
     };
 
+    struct pooled_buffer_t {
+        buffer_handle_t handle;
+        nsecs_t recycleTime;
+    };
+
     status_t allocateHelper(uint32_t w, uint32_t h, PixelFormat format, uint32_t layerCount,
                             uint64_t usage, buffer_handle_t* handle, uint32_t* stride,
                             std::string requestorName, bool importBuffer);
 
+    // Takes a pooled buffer matching the allocation, if any.
+    bool takePooledBufferLocked(uint32_t w, uint32_t h, PixelFormat format, uint32_t layerCount,
+                                uint64_t usage, const std::string& requestorName,
+                                buffer_handle_t* handle, uint32_t* stride);
+    // Removes the buffers over the budget or idle for too long from the pool, and returns them
+    // so that they can be freed without the lock held.
+    std::vector<buffer_handle_t> trimPoolLocked(nsecs_t now);
+
     static Mutex sLock;
     static KeyedVector<buffer_handle_t, alloc_rec_t> sAllocList;
 
+    // The pooled buffers, in the order they were recycled. Guarded by sLock, and still listed
+    // in sAllocList as they remain allocated.
+    std::vector<pooled_buffer_t> mPool;
+    size_t mPoolBudget = 0;
+    nsecs_t mPoolMaxIdleTime = 0;
+    size_t mPoolSize = 0;
+    uint64_t mPoolHits = 0;
+    uint64_t mPoolMisses = 0;
+    uint64_t mPoolTrimmed = 0;
+
     friend class Singleton<GraphicBufferAllocator>;
     GraphicBufferAllocator();
     ~GraphicBufferAllocator();
@@ -86,6 +86,14 @@ public:
 
     status_t unlockAsync(buffer_handle_t handle, int *fenceFd);
 
+    // Synchronize the CPU mapping of a locked buffer with other users of the
+    // buffer, while leaving it locked.  flushLockedBuffer publishes CPU
+    // writes and returns a release fence in *fenceFd; rereadLockedBuffer
+    // makes writes by others visible to the CPU.  These are supported by
+    // gralloc 4.0+.
+    status_t flushLockedBuffer(buffer_handle_t handle, int* fenceFd);
+    status_t rereadLockedBuffer(buffer_handle_t handle);
+
     status_t isSupported(uint32_t width, uint32_t height, android::PixelFormat format,
                          uint32_t layerCount, uint64_t usage, bool* outSupported);
 
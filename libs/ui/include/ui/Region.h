@@ -33,6 +33,10 @@
 namespace android {
 // ---------------------------------------------------------------------------
 
+namespace ui {
+class Transform;
+} // namespace ui
+
 class Region : public LightFlattenable<Region>
 {
 public:
@@ -153,6 +157,9 @@ private:
     class rasterizer;
     friend class rasterizer;
 
+    // Transforms regions by moving their rects in place when that keeps them valid.
+    friend class ui::Transform;
+
     Region& operationSelf(const Rect& r, uint32_t op);
     Region& operationSelf(const Region& r, uint32_t op);
     Region& operationSelf(const Region& r, int dx, int dy, uint32_t op);
@@ -170,6 +177,12 @@ private:
     static void boolean_operation(uint32_t op, Region& dst,
             const Region& lhs, const Rect& rhs);
 
+    // Applies op to two rects without running the rasterizer, when the result
+    // is known to be at most a few simple bands. Returns false if the general
+    // path is needed. The rects are taken by value as they may live in dst.
+    static bool boolean_operation_rects(uint32_t op, Region& dst,
+            Rect lhs, Rect rhs);
+
     static void translate(Region& reg, int dx, int dy);
     static void translate(Region& dst, const Region& reg, int dx, int dy);
 
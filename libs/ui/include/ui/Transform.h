@@ -112,6 +112,8 @@ private:
     enum { UNKNOWN_TYPE = 0x80000000 };
 
     uint32_t type() const;
+    Region transformAligned(const Region& reg) const;
+    Region transformRotated(const Region& reg) const;
     static bool absIsOne(float f);
     static bool isZero(float f);
 
@@ -53,6 +53,12 @@ public:
                     allocate)
                 .WillOnce(DoAll(SetArgPointee<7>(stride), Return(err)));
     }
+    void setUpAllocateExpectations(status_t err, uint32_t stride, buffer_handle_t handle) {
+        EXPECT_CALL(*(reinterpret_cast<const mock::MockGrallocAllocator*>(mAllocator.get())),
+                    allocate)
+                .WillOnce(DoAll(SetArgPointee<7>(stride), SetArgPointee<8>(handle), Return(err)))
+                .RetiresOnSaturation();
+    }
     std::unique_ptr<const GrallocAllocator>& getAllocator() { return mAllocator; }
 };
 
@@ -113,4 +119,52 @@ TEST_F(GraphicBufferAllocatorTest, AllocateLargeStride) {
     ASSERT_EQ(NO_ERROR, err);
     ASSERT_EQ(expectedStride, stride);
 }
+
+TEST_F(GraphicBufferAllocatorTest, AllocateReusesRecycledBuffer) {
+    const auto recycledHandle = reinterpret_cast<buffer_handle_t>(0x1000);
+    mAllocator.setPoolBudget(2 * kTestWidth * kTestHeight * 4, s2ns(10));
+    mAllocator.setUpAllocateExpectations(NO_ERROR, kTestWidth, recycledHandle);
+
+    uint32_t stride = 0;
+    buffer_handle_t handle;
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "GraphicBufferAllocatorTest"));
+    ASSERT_EQ(NO_ERROR, mAllocator.recycle(handle));
+
+    // Served from the pool, without going through the allocator again.
+    stride = 0;
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "GraphicBufferAllocatorTest"));
+    EXPECT_EQ(recycledHandle, handle);
+    EXPECT_EQ(kTestWidth, stride);
+}
+
+TEST_F(GraphicBufferAllocatorTest, AllocateDoesNotReuseBufferRecycledByOtherRequestor) {
+    const auto recycledHandle = reinterpret_cast<buffer_handle_t>(0x2000);
+    const auto otherHandle = reinterpret_cast<buffer_handle_t>(0x3000);
+    mAllocator.setPoolBudget(2 * kTestWidth * kTestHeight * 4, s2ns(10));
+    mAllocator.setUpAllocateExpectations(NO_ERROR, kTestWidth, otherHandle);
+    mAllocator.setUpAllocateExpectations(NO_ERROR, kTestWidth, recycledHandle);
+
+    uint32_t stride = 0;
+    buffer_handle_t handle;
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "GraphicBufferAllocatorTest"));
+    ASSERT_EQ(recycledHandle, handle);
+    ASSERT_EQ(NO_ERROR, mAllocator.recycle(handle));
+
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "OtherRequestor"));
+    EXPECT_EQ(otherHandle, handle);
+
+    // Takes the recycled buffer back out, as the test allocator cannot free it.
+    ASSERT_EQ(NO_ERROR,
+              mAllocator.allocate(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888, kTestLayerCount,
+                                  kTestUsage, &handle, &stride, "GraphicBufferAllocatorTest"));
+    EXPECT_EQ(recycledHandle, handle);
+}
 } // namespace android
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+namespace android {
+
+// The operations SurfaceFlinger runs on every layer while it computes visible regions: a
+// layer's bounds against the screen, against an opaque layer above it, and the union of two
+// layers' dirty rects.
+static const Rect kScreen(0, 0, 1080, 2340);
+static const Rect kStatusBar(0, 0, 1080, 80);
+static const Rect kDialog(90, 800, 990, 1600);
+static const Rect kNavigationBar(0, 2214, 1080, 2340);
+
+static void BM_IntersectRect(benchmark::State& state) {
+    const Region screen(kScreen);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(screen.intersect(kDialog));
+    }
+}
+BENCHMARK(BM_IntersectRect);
+
+static void BM_SubtractInnerRect(benchmark::State& state) {
+    const Region screen(kScreen);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(screen.subtract(kDialog));
+    }
+}
+BENCHMARK(BM_SubtractInnerRect);
+
+static void BM_SubtractEdgeRect(benchmark::State& state) {
+    const Region screen(kScreen);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(screen.subtract(kStatusBar));
+    }
+}
+BENCHMARK(BM_SubtractEdgeRect);
+
+static void BM_MergeDisjointRects(benchmark::State& state) {
+    const Region statusBar(kStatusBar);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(statusBar.merge(kNavigationBar));
+    }
+}
+BENCHMARK(BM_MergeDisjointRects);
+
+// Overlapping rects which do not line up are left to the general path.
+static void BM_MergeOverlappingRects(benchmark::State& state) {
+    const Region statusBar(kStatusBar);
+    const Rect overlapping(540, 40, 1080, 400);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(statusBar.merge(overlapping));
+    }
+}
+BENCHMARK(BM_MergeOverlappingRects);
+
+// A screen with the status bar, a dialog and the navigation bar cut out, as the visible region of
+// the wallpaper is, taken through the display transform.
+static void BM_TransformRegion(benchmark::State& state, ui::Transform::RotationFlags rotation,
+                               float scale) {
+    const Region region = Region(kScreen).subtract(kStatusBar).subtract(kDialog).subtract(
+            kNavigationBar);
+    ui::Transform scaleAndTranslation;
+    scaleAndTranslation.set(scale, 0, 0, scale);
+    scaleAndTranslation.set(0, 24);
+    const ui::Transform transform =
+            scaleAndTranslation * ui::Transform(rotation, kScreen.width(), kScreen.height());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(transform.transform(region));
+    }
+}
+BENCHMARK_CAPTURE(BM_TransformRegion, translate, ui::Transform::ROT_0, 1.0f);
+BENCHMARK_CAPTURE(BM_TransformRegion, scale, ui::Transform::ROT_0, 1.5f);
+BENCHMARK_CAPTURE(BM_TransformRegion, rot90, ui::Transform::ROT_90, 1.0f);
+BENCHMARK_CAPTURE(BM_TransformRegion, rot180, ui::Transform::ROT_180, 1.0f);
+BENCHMARK_CAPTURE(BM_TransformRegion, rot270, ui::Transform::ROT_270, 1.0f);
+// Shrinking transforms are left to the general path.
+BENCHMARK_CAPTURE(BM_TransformRegion, downscale, ui::Transform::ROT_0, 0.5f);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -17,8 +17,10 @@
 #define LOG_TAG "RegionTest"
 
 #include <stdlib.h>
+#include <initializer_list>
 #include <ui/Region.h>
 #include <ui/Rect.h>
+#include <ui/Transform.h>
 #include <gtest/gtest.h>
 
 namespace android {
@@ -53,6 +55,24 @@ protected:
         }
         EXPECT_TRUE((original ^ modified).isEmpty());
     }
+
+    void checkRects(const Region& region, std::initializer_list<Rect> expected) {
+        size_t count;
+        const Rect* rects = region.getArray(&count);
+        ASSERT_EQ(expected.size(), count);
+        for (const Rect& rect : expected) {
+            EXPECT_EQ(rect, *rects++);
+        }
+    }
+
+    // Computes lhs op rhs through the general path, by adding a rect far away from both
+    // operands so that neither of them is a single rect, and removing it again afterwards.
+    template <typename Op>
+    Region applyWithoutFastPath(const Rect& lhs, const Rect& rhs, Op op) {
+        const Rect far(1000, 1000, 1001, 1001);
+        const Region result = op(Region(lhs).orSelf(far), Region(rhs).orSelf(far));
+        return result.subtract(far);
+    }
 };
 
 TEST_F(RegionTest, MinimalDivision_TJunction) {
@@ -167,5 +187,92 @@ TEST_F(RegionTest, EqualsToSelf) {
     ASSERT_TRUE(touchableRegion.contains(50, 50));
 }
 
+TEST_F(RegionTest, RectFastPaths_Shapes) {
+    const Rect lhs(0, 0, 10, 10);
+
+    checkRects(Region(lhs).subtract(Rect(3, 3, 6, 6)),
+               {Rect(0, 0, 10, 3), Rect(0, 3, 3, 6), Rect(6, 3, 10, 6), Rect(0, 6, 10, 10)});
+    checkRects(Region(lhs).subtract(Rect(-5, 5, 15, 15)), {Rect(0, 0, 10, 5)});
+    EXPECT_TRUE(Region(lhs).subtract(Rect(-5, -5, 15, 15)).isEmpty());
+    checkRects(Region(lhs).subtract(Rect(20, 20, 30, 30)), {lhs});
+
+    checkRects(Region(lhs).intersect(Rect(5, 5, 15, 15)), {Rect(5, 5, 10, 10)});
+    EXPECT_TRUE(Region(lhs).intersect(Rect(10, 0, 15, 10)).isEmpty());
+
+    checkRects(Region(lhs).merge(Rect(2, 2, 4, 4)), {lhs});
+    checkRects(Region(lhs).merge(Rect(0, 10, 10, 20)), {Rect(0, 0, 10, 20)});
+    checkRects(Region(lhs).merge(Rect(5, 0, 20, 10)), {Rect(0, 0, 20, 10)});
+    checkRects(Region(lhs).merge(Rect(20, 10, 30, 20)), {lhs, Rect(20, 10, 30, 20)});
+    EXPECT_EQ(Rect(0, 0, 30, 20), Region(lhs).merge(Rect(20, 10, 30, 20)).getBounds());
+}
+
+TEST_F(RegionTest, RectFastPaths_MatchGeneralPath) {
+    srandom(54321);
+
+    const auto randomRect = [] {
+        const int left = static_cast<int>(random() % X_MAX);
+        const int top = static_cast<int>(random() % Y_MAX);
+        return Rect(left, top, left + 1 + static_cast<int>(random() % X_MAX),
+                    top + 1 + static_cast<int>(random() % Y_MAX));
+    };
+
+    for (int iter = 0; iter < ITER_MAX; iter++) {
+        const Rect lhs = randomRect();
+        const Rect rhs = randomRect();
+
+        EXPECT_TRUE(Region(lhs).merge(rhs).hasSameRects(
+                applyWithoutFastPath(lhs, rhs, [](const Region& l, const Region& r) {
+                    return l.merge(r);
+                })));
+        EXPECT_TRUE(Region(lhs).intersect(rhs).hasSameRects(
+                applyWithoutFastPath(lhs, rhs, [](const Region& l, const Region& r) {
+                    return l.intersect(r);
+                })));
+        EXPECT_TRUE(Region(lhs).subtract(Region(rhs)).hasSameRects(
+                applyWithoutFastPath(lhs, rhs, [](const Region& l, const Region& r) {
+                    return l.subtract(r);
+                })));
+    }
+}
+
+TEST_F(RegionTest, Transform_MatchesRectByRect) {
+    srandom(12345);
+
+    const uint32_t orientations[] = {ui::Transform::ROT_0,   ui::Transform::FLIP_H,
+                                     ui::Transform::FLIP_V,  ui::Transform::ROT_90,
+                                     ui::Transform::ROT_180, ui::Transform::ROT_270,
+                                     ui::Transform::ROT_90 | ui::Transform::FLIP_H,
+                                     ui::Transform::ROT_90 | ui::Transform::FLIP_V};
+    const float scales[] = {1.0f, 1.5f, 0.5f};
+
+    for (int iter = 0; iter < ITER_MAX; iter++) {
+        Region region;
+        for (int i = 0; i < 6; i++) {
+            const int left = static_cast<int>(random() % X_MAX);
+            const int top = static_cast<int>(random() % Y_MAX);
+            region.orSelf(Rect(left, top, left + 1 + static_cast<int>(random() % X_MAX),
+                               top + 1 + static_cast<int>(random() % Y_MAX)));
+        }
+
+        for (uint32_t orientation : orientations) {
+            for (float scale : scales) {
+                ui::Transform rotation(orientation, X_MAX * 2, Y_MAX * 2);
+                ui::Transform scaleAndTranslation;
+                scaleAndTranslation.set(scale, 0, 0, scale);
+                scaleAndTranslation.set(10.5f, -20.0f);
+                const ui::Transform transform = scaleAndTranslation * rotation;
+
+                Region expected;
+                for (const Rect& rect : region) {
+                    expected.orSelf(transform.transform(rect));
+                }
+                const Region transformed = transform.transform(region);
+                EXPECT_TRUE(transformed.hasSameRects(expected));
+                EXPECT_EQ(expected.getBounds(), transformed.getBounds());
+            }
+        }
+    }
+}
+
 }; // namespace android
 
@@ -180,4 +180,38 @@ TEST_F(ColorSpaceTest, LUT) {
 
 }
 
+TEST_F(ColorSpaceTest, LUTMatchesConnector) {
+    const ColorSpaceConnector connector(ColorSpace::sRGB(), ColorSpace::DisplayP3());
+    const ColorSpaceLUT lut(ColorSpace::sRGB(), ColorSpace::DisplayP3(), 33);
+    EXPECT_EQ(33u, lut.getSize());
+
+    std::vector<float3> colors;
+    for (float r = 0.0f; r <= 1.0f; r += 0.0625f) {
+        for (float g = 0.0f; g <= 1.0f; g += 0.125f) {
+            for (float b = 0.0f; b <= 1.0f; b += 0.25f) {
+                colors.push_back({r, g, b});
+            }
+        }
+    }
+    colors.push_back({0.3f, 0.3f, 0.3f});
+    colors.push_back({0.91f, 0.02f, 0.47f});
+
+    for (auto interpolation :
+         {ColorSpaceLUT::Interpolation::TRILINEAR, ColorSpaceLUT::Interpolation::TETRAHEDRAL}) {
+        std::vector<float3> converted(colors.size());
+        lut.transform(colors.data(), converted.data(), colors.size(), interpolation);
+        for (size_t i = 0; i < colors.size(); i++) {
+            const float3 expected = connector.transform(colors[i]);
+            EXPECT_TRUE(all(lessThan(abs(converted[i] - expected), float3{2e-3f})))
+                    << "color " << i << " interpolation " << static_cast<int>(interpolation);
+            EXPECT_EQ(converted[i], lut.transform(colors[i], interpolation));
+        }
+    }
+
+    // Out of range inputs are clamped.
+    EXPECT_TRUE(all(lessThan(abs(lut.transform({2.0f, -1.0f, 1.0f}) -
+                                 connector.transform({1.0f, 0.0f, 1.0f})),
+                             float3{1e-4f})));
+}
+
 }; // namespace android
@@ -0,0 +1,153 @@
+#include "libbroadcastring/broadcast_ring.h"
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace android {
+namespace dvr {
+namespace {
+
+template <uint32_t N>
+struct alignas(8) Record {
+  char v[N];
+};
+
+template <typename RecordType, bool Padded>
+struct Traits : public DefaultRingTraits {
+  using Ring = BroadcastRing<RecordType, Traits>;
+  static constexpr bool kUseCacheLinePadding = Padded;
+};
+
+template <uint32_t N>
+using Unpadded = Traits<Record<N>, false>;
+template <uint32_t N>
+using Padded = Traits<Record<N>, true>;
+
+// Records kept in the ring, and the size of the history snapshots.
+constexpr uint32_t kRecordCount = 16;
+constexpr uint32_t kHistoryCount = 8;
+
+// Time between puts. Fast enough for readers to regularly race the writer, but
+// well within the usage guidelines in broadcast_ring.h.
+constexpr std::chrono::microseconds kPutPeriod{10};
+
+// Runs a writer and |reader_count - 1| background readers against a ring, so
+// that the benchmark loop is one of |reader_count| concurrent readers.
+template <typename Ring>
+class RingFixture {
+ public:
+  using R = typename Ring::Record;
+
+  explicit RingFixture(int reader_count)
+      : storage_(new char[Ring::MemorySize(kRecordCount) +
+                          Ring::mmap_alignment()]) {
+    const uintptr_t alignment = Ring::mmap_alignment();
+    uintptr_t base = reinterpret_cast<uintptr_t>(storage_.get());
+    base = (base + alignment - 1) & ~(alignment - 1);
+    ring_ = Ring::Create(reinterpret_cast<void*>(base),
+                         Ring::MemorySize(kRecordCount), kRecordCount);
+
+    R record = {};
+    for (uint32_t i = 0; i < kRecordCount; ++i)
+      ring_.Put(record);
+
+    threads_.emplace_back([this]() { WriterLoop(); });
+    for (int i = 1; i < reader_count; ++i)
+      threads_.emplace_back([this]() { ReaderLoop(); });
+  }
+
+  ~RingFixture() {
+    quit_.store(true, std::memory_order_relaxed);
+    for (auto& thread : threads_)
+      thread.join();
+  }
+
+  const Ring& ring() const { return ring_; }
+
+ private:
+  void WriterLoop() {
+    R record = {};
+    auto next_put = std::chrono::steady_clock::now();
+    while (!quit_.load(std::memory_order_relaxed)) {
+      record.v[0]++;
+      ring_.Put(record);
+      next_put += kPutPeriod;
+      while (std::chrono::steady_clock::now() < next_put) {
+        // Busy wait; sleeping is far too coarse for this period.
+      }
+    }
+  }
+
+  void ReaderLoop() {
+    R record;
+    uint32_t sequence = ring_.GetOldestSequence();
+    while (!quit_.load(std::memory_order_relaxed)) {
+      if (ring_.GetNewest(&sequence, &record))
+        sequence++;
+      benchmark::DoNotOptimize(record);
+    }
+  }
+
+  std::unique_ptr<char[]> storage_;
+  Ring ring_;
+  std::atomic<bool> quit_{false};
+  std::vector<std::thread> threads_;
+};
+
+template <typename T>
+void BM_GetNewest(benchmark::State& state) {
+  using Ring = typename T::Ring;
+  RingFixture<Ring> fixture(state.range(0));
+  typename Ring::Record record;
+  uint32_t sequence = fixture.ring().GetOldestSequence();
+  for (auto _ : state) {
+    // Re-read the newest record even when nothing new was put, so that every
+    // iteration copies a record.
+    sequence = fixture.ring().GetNewestSequence();
+    fixture.ring().GetNewest(&sequence, &record);
+    benchmark::DoNotOptimize(record);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(record));
+}
+
+template <typename T>
+void BM_GetNewestRange(benchmark::State& state) {
+  using Ring = typename T::Ring;
+  RingFixture<Ring> fixture(state.range(0));
+  typename Ring::Record records[kHistoryCount];
+  int64_t records_read = 0;
+  for (auto _ : state) {
+    uint32_t sequence = fixture.ring().GetOldestSequence();
+    records_read +=
+        fixture.ring().GetNewestRange(&sequence, records, kHistoryCount);
+    benchmark::DoNotOptimize(records);
+  }
+  state.SetBytesProcessed(records_read * sizeof(records[0]));
+}
+
+// Reader counts include the benchmark loop itself.
+void ReaderCounts(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgName("readers")->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+}
+
+#define RING_BENCHMARKS(size)                                                  \
+  BENCHMARK_TEMPLATE(BM_GetNewest, Unpadded<size>)->Apply(ReaderCounts);       \
+  BENCHMARK_TEMPLATE(BM_GetNewest, Padded<size>)->Apply(ReaderCounts);         \
+  BENCHMARK_TEMPLATE(BM_GetNewestRange, Unpadded<size>)                        \
+      ->Apply(ReaderCounts);                                                   \
+  BENCHMARK_TEMPLATE(BM_GetNewestRange, Padded<size>)->Apply(ReaderCounts)
+
+RING_BENCHMARKS(16);
+RING_BENCHMARKS(32);   // DvrVsync
+RING_BENCHMARKS(112);  // DvrPose
+RING_BENCHMARKS(256);
+
+}  // namespace
+}  // namespace dvr
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -46,10 +46,16 @@ struct alignas(8) Sized {
 char FillChar(int val) { return static_cast<char>(val); }
 
 struct FakeMmap {
-  explicit FakeMmap(size_t size) : size(size), data(new char[size]) {}
+  // Aligned for padded rings as well.
+  static constexpr size_t kAlignment = 64;
+  explicit FakeMmap(size_t size)
+      : size(size), data(new char[size + kAlignment]) {}
   size_t size;
   std::unique_ptr<char[]> data;
-  void* mmap() { return static_cast<void*>(data.get()); }
+  void* mmap() {
+    uintptr_t base = reinterpret_cast<uintptr_t>(data.get());
+    return reinterpret_cast<void*>((base + kAlignment - 1) & ~(kAlignment - 1));
+  }
 };
 
 template <typename Ring>
@@ -87,6 +93,12 @@ struct TraitsStatic
   static uint32_t MinCount() { return StaticCount; }
 };
 
+template <typename BaseTraits>
+struct TraitsPadded : public BaseTraits {
+  using Ring = BroadcastRing<typename BaseTraits::Record, TraitsPadded>;
+  static constexpr bool kUseCacheLinePadding = true;
+};
+
 using Dynamic_8_NxM = TraitsDynamic<Sized<8>>;
 using Dynamic_16_NxM = TraitsDynamic<Sized<16>>;
 using Dynamic_32_NxM = TraitsDynamic<Sized<32>>;
@@ -103,6 +115,11 @@ using Static_16_16x16 = TraitsStatic<Sized<16>, 16>;
 using Static_16_16x32 = TraitsStatic<Sized<16>, 32>;
 using Static_32_Nx8 = TraitsStatic<Sized<32>, 8, false>;
 
+using Padded_Dynamic_16_NxM = TraitsPadded<Dynamic_16_NxM>;
+using Padded_Dynamic_16_NxM_1plus0 = TraitsPadded<Dynamic_16_NxM_1plus0>;
+using Padded_Dynamic_256_NxM_1plus0 = TraitsPadded<Dynamic_256_NxM_1plus0>;
+using Padded_Static_8_8x16 = TraitsPadded<Static_8_8x16>;
+
 using TraitsList = ::testing::Types<Dynamic_8_NxM,           //
                                     Dynamic_16_NxM,          //
                                     Dynamic_32_NxM,          //
@@ -116,7 +133,18 @@ using TraitsList = ::testing::Types<Dynamic_8_NxM,           //
                                     Static_16_16x8,          //
                                     Static_16_16x16,         //
                                     Static_16_16x32,         //
-                                    Static_32_Nx8>;
+                                    Static_32_Nx8,           //
+                                    Padded_Dynamic_16_NxM,   //
+                                    Padded_Dynamic_256_NxM_1plus0,
+                                    Padded_Static_8_8x16>;
+
+// Size of each record in the mmap area, including any cache line padding.
+template <typename Ring>
+constexpr uint32_t RecordStride() {
+  using Record = typename Ring::Record;
+  return Ring::Traits::kUseCacheLinePadding ? (sizeof(Record) + 63) & ~63
+                                            : sizeof(Record);
+}
 
 }  // namespace
 
@@ -131,7 +159,8 @@ TYPED_TEST(BroadcastRingTest, Geometry) {
   Ring ring;
   auto mmap = CreateRing(&ring, Ring::Traits::MinCount());
   EXPECT_EQ(Ring::Traits::MinCount(), ring.record_count());
-  EXPECT_EQ(sizeof(Record), ring.record_size());
+  EXPECT_EQ(RecordStride<Ring>(), ring.record_size());
+  EXPECT_LE(sizeof(Record), ring.record_size());
 }
 
 TYPED_TEST(BroadcastRingTest, PutGet) {
@@ -286,6 +315,58 @@ TYPED_TEST(BroadcastRingTest, FillTwice) {
   }
 }
 
+TYPED_TEST(BroadcastRingTest, GetRange) {
+  using Record = typename TypeParam::Record;
+  using Ring = typename TypeParam::Ring;
+  Ring ring;
+  auto mmap = CreateRing(&ring, Ring::Traits::MinCount());
+  const uint32_t count = ring.record_count();
+  std::unique_ptr<Record[]> records(new Record[count + 1]);
+  {
+    uint32_t sequence = ring.GetOldestSequence();
+    EXPECT_EQ(0U, ring.GetRange(&sequence, records.get(), count));
+    EXPECT_EQ(0U, ring.GetNewestRange(&sequence, records.get(), count));
+  }
+
+  const uint32_t next_sequence_at_start = ring.GetNextSequence();
+  for (uint32_t i = 0; i < 2 * count; ++i)
+    ring.Put(Record(FillChar(i)));
+  const uint32_t oldest_sequence = ring.GetOldestSequence();
+  EXPECT_EQ(next_sequence_at_start + count, oldest_sequence);
+
+  {
+    // Reading from an overwritten sequence skips to the oldest record and
+    // never returns more than the ring holds.
+    uint32_t sequence = oldest_sequence - 1;
+    EXPECT_EQ(count, ring.GetRange(&sequence, records.get(), count + 1));
+    EXPECT_EQ(oldest_sequence, sequence);
+    for (uint32_t i = 0; i < count; ++i)
+      EXPECT_EQ(Record(FillChar(count + i)), records[i]);
+  }
+
+  {
+    uint32_t sequence = oldest_sequence;
+    EXPECT_EQ(1U, ring.GetRange(&sequence, records.get(), 1));
+    EXPECT_EQ(oldest_sequence, sequence);
+    EXPECT_EQ(Record(FillChar(count)), records[0]);
+  }
+
+  {
+    // The newest records come back oldest first.
+    const uint32_t max_count = std::max(count / 2, 1U);
+    uint32_t sequence = oldest_sequence;
+    EXPECT_EQ(max_count,
+              ring.GetNewestRange(&sequence, records.get(), max_count));
+    EXPECT_EQ(ring.GetNextSequence() - max_count, sequence);
+    for (uint32_t i = 0; i < max_count; ++i)
+      EXPECT_EQ(Record(FillChar(2 * count - max_count + i)), records[i]);
+
+    sequence += max_count;
+    EXPECT_EQ(0U, ring.GetNewestRange(&sequence, records.get(), max_count));
+    EXPECT_EQ(ring.GetNextSequence(), sequence);
+  }
+}
+
 TYPED_TEST(BroadcastRingTest, Import) {
   using Record = typename TypeParam::Record;
   using Ring = typename TypeParam::Ring;
@@ -827,6 +908,35 @@ std::unique_ptr<std::thread> CheckFillTask(std::atomic<bool>* quit,
       }));
 }
 
+template <typename Ring>
+std::unique_ptr<std::thread> CheckRangeTask(std::atomic<bool>* quit,
+                                            void* in_base, size_t in_size) {
+  return std::unique_ptr<std::thread>(
+      new std::thread([quit, in_base, in_size]() {
+        using Record = typename Ring::Record;
+
+        bool import_ok;
+        Ring in_ring;
+        std::tie(in_ring, import_ok) = Ring::Import(in_base, in_size);
+        ASSERT_TRUE(import_ok);
+
+        const uint32_t max_count = in_ring.record_count();
+        std::unique_ptr<Record[]> records(new Record[max_count]);
+        uint32_t sequence = in_ring.GetOldestSequence();
+        while (!std::atomic_load_explicit(quit, std::memory_order_relaxed)) {
+          uint32_t count =
+              in_ring.GetNewestRange(&sequence, records.get(), max_count);
+          // The writer fills records with consecutive values, so a consistent
+          // snapshot is a run of consecutive, untorn records.
+          for (uint32_t i = 0; i < count; ++i) {
+            ASSERT_EQ(Record(records[i].v[0]), records[i]);
+            ASSERT_EQ(FillChar(records[0].v[0] + i), records[i].v[0]);
+          }
+          sequence += count;
+        }
+      }));
+}
+
 template <typename Ring>
 void ThreadedOverwriteTorture() {
   using Record = typename Ring::Record;
@@ -842,6 +952,8 @@ void ThreadedOverwriteTorture() {
     std::atomic<bool> quit(false);
     std::unique_ptr<std::thread> check_task =
         CheckFillTask<Ring>(&quit, out_mmap.mmap(), out_mmap.size);
+    std::unique_ptr<std::thread> check_range_task =
+        CheckRangeTask<Ring>(&quit, out_mmap.mmap(), out_mmap.size);
 
     constexpr int kIterations = 10000;
     for (int i = 0; i < kIterations; ++i) {
@@ -851,6 +963,7 @@ void ThreadedOverwriteTorture() {
 
     std::atomic_store_explicit(&quit, true, std::memory_order_relaxed);
     check_task->join();
+    check_range_task->join();
   }
 }
 
@@ -862,5 +975,20 @@ TEST(BroadcastRingTest, ThreadedOverwriteTortureLarge) {
   ThreadedOverwriteTorture<Dynamic_256_NxM_1plus0::Ring>();
 }
 
+TEST(BroadcastRingTest, ThreadedOverwriteTorturePadded) {
+  ThreadedOverwriteTorture<Padded_Dynamic_16_NxM_1plus0::Ring>();
+}
+
+TEST(BroadcastRingTest, PaddedLayout) {
+  using Ring = Padded_Dynamic_16_NxM::Ring;
+  static_assert(Ring::mmap_alignment() == 64, "Padded ring not aligned");
+  // The header and every record take a full cache line.
+  EXPECT_EQ(64U * 9, Ring::MemorySize(8));
+  EXPECT_EQ(8U, Ring::GetRecordCount(Ring::MemorySize(8)));
+
+  // Unpadded rings keep their layout.
+  EXPECT_EQ(16U + 16U * 8, Dynamic_16_NxM::Ring::MemorySize(8));
+}
+
 } // namespace dvr
 } // namespace android
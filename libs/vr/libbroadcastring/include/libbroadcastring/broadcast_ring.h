@@ -4,6 +4,8 @@
 #include <inttypes.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include <atomic>
 #include <limits>
 #include <tuple>
@@ -31,6 +33,13 @@ struct DefaultRingTraits {
 
   // Set this to the min number of records that must be readable.
   static constexpr uint32_t kMinAvailableRecords = 1;
+
+  // Set this to true to give the header and each record their own cache
+  // lines, so that the writer does not invalidate lines that readers are
+  // copying neighboring records out of. This changes the mmap layout, so
+  // writers and readers must agree on it. Traits that leave this out are not
+  // padded.
+  static constexpr bool kUseCacheLinePadding = false;
 };
 
 // Nonblocking ring suitable for concurrent single-writer, multi-reader access.
@@ -128,6 +137,12 @@ struct DefaultRingTraits {
 //         ProcessRecord(sequence, record);
 //         sequence++;
 //       }
+//     } else if (you_want_the_newest_records_as_one_snapshot) {
+//       Record history[kHistoryCount];
+//       uint32_t count = ring.GetNewestRange(&sequence, history,
+//                                            kHistoryCount);
+//       ProcessRecords(sequence, history, count);
+//       sequence += count;
 //     }
 //
 //     DoSomethingExpensiveOrBlocking();
@@ -137,6 +152,14 @@ struct DefaultRingTraits {
 //
 template <typename RecordType, typename BaseTraits = DefaultRingTraits>
 class BroadcastRing {
+  // Reads BaseTraits::kUseCacheLinePadding, defaulting to false for traits
+  // written before the option existed.
+  template <typename T, typename = void>
+  struct CacheLinePadding : std::false_type {};
+  template <typename T>
+  struct CacheLinePadding<T, decltype(void(T::kUseCacheLinePadding))>
+      : std::integral_constant<bool, T::kUseCacheLinePadding> {};
+
  public:
   using Record = RecordType;
   struct Traits : public BaseTraits {
@@ -151,6 +174,9 @@ class BroadcastRing {
     // If both record size and count are static then the overall size is too.
     static constexpr bool kIsStaticSize =
         BaseTraits::kUseStaticRecordSize && kUseStaticRecordCount;
+
+    static constexpr bool kUseCacheLinePadding =
+        CacheLinePadding<BaseTraits>::value;
   };
 
   static constexpr bool IsPowerOfTwo(uint32_t size) {
@@ -177,8 +203,9 @@ class BroadcastRing {
   static BroadcastRing Create(void* mmap, size_t mmap_size,
                               uint32_t record_count) {
     BroadcastRing ring(mmap);
-    CHECK(ring.ValidateGeometry(mmap_size, sizeof(Record), record_count));
-    ring.InitializeHeader(sizeof(Record), record_count);
+    CHECK(ring.ValidateGeometry(mmap_size, sizeof(RecordStorage),
+                                record_count));
+    ring.InitializeHeader(sizeof(RecordStorage), record_count);
     return ring;
   }
 
@@ -217,7 +244,7 @@ class BroadcastRing {
   //
   // Use this function for dynamically sized rings.
   static constexpr size_t MemorySize(uint32_t record_count) {
-    return sizeof(Header) + sizeof(Record) * record_count;
+    return kHeaderSize + sizeof(RecordStorage) * record_count;
   }
 
   // Calculates the space necessary for a statically sized ring.
@@ -246,11 +273,11 @@ class BroadcastRing {
   //
   // The header size has been taken into account.
   static uint32_t GetRecordCount(size_t mmap_size) {
-    if (mmap_size <= sizeof(Header)) {
+    if (mmap_size <= kHeaderSize) {
       return 0;
     }
-    uint32_t count =
-        static_cast<uint32_t>((mmap_size - sizeof(Header)) / sizeof(Record));
+    uint32_t count = static_cast<uint32_t>((mmap_size - kHeaderSize) /
+                                           sizeof(RecordStorage));
     return IsPowerOfTwo(count) ? count : (NextPowerOf2(count) / 2);
   }
 
@@ -369,6 +396,65 @@ class BroadcastRing {
     return Get(sequence, record);
   }
 
+  // Copies up to |max_count| consecutive records, starting with the oldest
+  // available record with sequence at least |*sequence|, to |records|.
+  //
+  // Returns the number of records copied, which is zero if there is no recent
+  // enough record available.
+  //
+  // Updates |*sequence| with the sequence number of the first record returned.
+  // All returned records are from the same consistent view of the ring: none
+  // of them was overwritten while being copied. This synchronizes with the
+  // writer the same way as Get().
+  uint32_t GetRange(uint32_t* sequence /*inout*/, Record* records /*out*/,
+                    uint32_t max_count) const {
+    for (;;) {
+      uint32_t tail = std::atomic_load_explicit(&header_mmap()->tail,
+                                                std::memory_order_acquire);
+      uint32_t head = std::atomic_load_explicit(&header_mmap()->head,
+                                                std::memory_order_relaxed);
+
+      if (tail - head > record_count())
+        continue;  // Concurrent modification; re-try.
+
+      if (*sequence - head > tail - head)
+        *sequence = head;  // Out of window, skip forward to first available.
+
+      const uint32_t count = std::min(max_count, tail - *sequence);
+      for (uint32_t i = 0; i < count; ++i) {
+        uint32_t index = SequenceToIndex(*sequence + i, record_count());
+        GetRecordInternal(record_mmap_reader(index), &records[i]);
+      }
+
+      // NB: It is not sufficient to change this to a load-acquire of |head|.
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      uint32_t final_head = std::atomic_load_explicit(
+          &header_mmap()->head, std::memory_order_relaxed);
+
+      // Every copied record has a sequence >= |*sequence|, so they are all
+      // intact as long as the oldest one is.
+      if (count > 0 && final_head - head > *sequence - head)
+        continue;  // Concurrent modification; re-try.
+
+      return count;
+    }
+  }
+
+  // Copies up to |max_count| of the newest available records with sequence at
+  // least |*sequence| to |records|, oldest first.
+  //
+  // Returns the number of records copied and updates |*sequence| with the
+  // sequence number of the first one, like GetRange(). To continue with the
+  // following record, increment |*sequence| by the returned count.
+  uint32_t GetNewestRange(uint32_t* sequence, Record* records,
+                          uint32_t max_count) const {
+    uint32_t next_sequence = GetNextSequence();
+    if (next_sequence - *sequence > max_count)
+      *sequence = next_sequence - max_count;
+    return GetRange(sequence, records, max_count);
+  }
+
   // Returns true if this instance has been created or imported.
   bool is_valid() const { return !!data_.mmap; }
 
@@ -412,7 +498,14 @@ class BroadcastRing {
   static_assert(kRecordAlignment % sizeof(StorageType) == 0,
                 "Bad record alignment");
 
-  struct RecordStorage {
+  // Padded rings align the records, and therefore the end of the header, to
+  // this boundary.
+  static constexpr size_t kCacheLineSize = 64;
+  static constexpr size_t kRecordStorageAlignment =
+      Traits::kUseCacheLinePadding ? kCacheLineSize
+                                   : alignof(std::atomic<StorageType>);
+
+  struct alignas(kRecordStorageAlignment) RecordStorage {
     // This is accessed with relaxed atomics to prevent data races on the
     // contained data, which would be undefined behavior.
     std::atomic<StorageType> data[sizeof(Record) / sizeof(StorageType)];
@@ -423,6 +516,11 @@ class BroadcastRing {
                     sizeof(Record),
                 "Record length must be a multiple of sizeof(StorageType)");
 
+  // Offset of the first record in the mmap area.
+  static constexpr size_t kHeaderSize =
+      (sizeof(Header) + alignof(RecordStorage) - 1) &
+      ~(alignof(RecordStorage) - 1);
+
   struct Geometry {
     // Static geometry.
     uint32_t record_count;
@@ -456,6 +554,9 @@ class BroadcastRing {
 
   static_assert(std::is_standard_layout<Mmap>::value,
                 "Mmap must be standard layout");
+  static_assert(!Traits::kUseCacheLinePadding ||
+                    alignof(Mmap) == kCacheLineSize,
+                "Padded rings must be cache line aligned");
   static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
                 "Lockless atomics contain extra state");
   static_assert(sizeof(std::atomic<StorageType>) == sizeof(StorageType),
@@ -494,12 +595,13 @@ class BroadcastRing {
     if (record_count() < Traits::kMinRecordCount) return false;
     if (record_size() < sizeof(Record)) return false;
     if (record_size() % kRecordAlignment != 0) return false;
+    if (record_size() % alignof(RecordStorage) != 0) return false;
     if (!IsPowerOfTwo(record_count())) return false;
 
     size_t memory_size = record_count() * record_size();
     if (memory_size / record_size() != record_count()) return false;
-    if (memory_size + sizeof(Header) < memory_size) return false;
-    if (memory_size + sizeof(Header) > mmap_size) return false;
+    if (memory_size + kHeaderSize < memory_size) return false;
+    if (memory_size + kHeaderSize > mmap_size) return false;
 
     return true;
   }
@@ -600,7 +702,7 @@ class BroadcastRing {
   Mmap* mmap() const { return data_.mmap; }
   Header* header_mmap() const { return &data_.mmap->header; }
   RecordStorage* record_mmap_writer(uint32_t index) const {
-    DCHECK_EQ(sizeof(Record), record_size());
+    DCHECK_EQ(sizeof(RecordStorage), record_size());
     return &data_.mmap->records[index];
   }
   RecordStorage* record_mmap_reader(uint32_t index) const {
@@ -623,7 +725,7 @@ class BroadcastRing {
   template <typename T = Traits>
   typename std::enable_if<T::kUseStaticRecordSize, uint32_t>::type
   record_size_internal() const {
-    return sizeof(Record);
+    return sizeof(RecordStorage);
   }
 
   template <typename T = Traits>
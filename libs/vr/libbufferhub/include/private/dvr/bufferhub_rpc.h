@@ -302,6 +302,8 @@ struct BufferHubRPC {
   // interface: |android::IGraphicBufferProducer|.
   static constexpr size_t kMaxQueueCapacity =
       android::BufferQueueDefs::NUM_BUFFER_SLOTS;
+  static_assert(kMaxQueueCapacity <= sizeof(uint64_t) * 8,
+                "Queue slots must fit in the batched gain/post slot mask.");
 
   // Op codes.
   enum {
@@ -320,6 +322,8 @@ struct BufferHubRPC {
     kOpProducerQueueInsertBuffer,
     kOpProducerQueueRemoveBuffer,
     kOpConsumerQueueImportBuffers,
+    kOpProducerQueueGainBuffers,
+    kOpProducerQueuePostBuffers,
     // TODO(b/77153033): Separate all those RPC operations into subclasses.
   };
 
@@ -369,6 +373,16 @@ struct BufferHubRPC {
                     void(size_t slot));
   PDX_REMOTE_METHOD(ConsumerQueueImportBuffers, kOpConsumerQueueImportBuffers,
                     std::vector<std::pair<LocalChannelHandle, size_t>>(Void));
+
+  // Batched counterparts of ProducerGain and ProducerPost. These are only sent
+  // as impulses on the producer queue channel, with the bit mask of the queue
+  // slots whose buffers changed state as the payload. The state transitions
+  // and fences themselves go through the shared metadata of each buffer, just
+  // like with the per-buffer impulses.
+  PDX_REMOTE_METHOD(ProducerQueueGainBuffers, kOpProducerQueueGainBuffers,
+                    void(uint64_t slot_mask));
+  PDX_REMOTE_METHOD(ProducerQueuePostBuffers, kOpProducerQueuePostBuffers,
+                    void(uint64_t slot_mask));
 };
 
 }  // namespace dvr
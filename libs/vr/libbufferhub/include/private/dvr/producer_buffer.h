@@ -75,6 +75,8 @@ class ProducerBuffer : public pdx::ClientBase<ProducerBuffer, BufferHubBase> {
 
  private:
   friend BASE;
+  // Batches the local state transitions of several buffers into one impulse.
+  friend class ProducerQueue;
 
   // Constructors are automatically exposed through ProducerBuffer::Create(...)
   // static template methods inherited from ClientBase, which take the same
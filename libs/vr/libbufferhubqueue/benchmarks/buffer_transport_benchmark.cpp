@@ -4,20 +4,31 @@
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
 #include <dvr/dvr_api.h>
+#include <gui/BLASTBufferQueue.h>
 #include <gui/BufferItem.h>
 #include <gui/BufferItemConsumer.h>
 #include <gui/Surface.h>
+#include <gui/SurfaceComposerClient.h>
 #include <private/dvr/epoll_file_descriptor.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <thread>
 #include <vector>
 
 #include <dlfcn.h>
 #include <poll.h>
+#include <sched.h>
 #include <sys/epoll.h>
 #include <sys/wait.h>
 
@@ -35,52 +46,227 @@ static const String16 kBinderService = String16("bufferTransport");
 static const uint32_t kBufferWidth = 100;
 static const uint32_t kBufferHeight = 1;
 static const uint32_t kBufferFormat = HAL_PIXEL_FORMAT_BLOB;
+// SurfaceFlinger has to composite BLAST buffers, so they cannot be blobs.
+static const uint32_t kBlastBufferFormat = HAL_PIXEL_FORMAT_RGBA_8888;
 static const uint64_t kBufferUsage =
     GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN;
 static const uint32_t kBufferLayer = 1;
 static const int kMaxAcquiredImages = 1;
-static const int kQueueDepth = 2;  // We are double buffering for this test.
 static const size_t kMaxQueueCounts = 128;
 static const int kInvalidFence = -1;
+// How many frames back BlastBufferTransport looks for a latch time. Frame
+// timestamps only keep a short history, so this stays small.
+static const uint64_t kLatchLookback = 2;
 
 enum BufferTransportServiceCode {
   CREATE_BUFFER_QUEUE = IBinder::FIRST_CALL_TRANSACTION,
+  TAKE_FRAME_STATS,
 };
 
-// A binder services that minics a compositor that consumes buffers. It provides
-// one Binder interface to create a new Surface for buffer producer to write
-// into; while itself will carry out no-op buffer consuming by acquiring then
-// releasing the buffer immediately.
-class BufferTransportService : public BBinder {
+// CPU affinity for the producer or consumer threads, set from the
+// --producer_cpus and --consumer_cpus command line options. Threads keep the
+// default affinity unless the option is given.
+struct CpuAffinity {
+  bool enabled = false;
+  cpu_set_t cpus;
+
+  // Parses a list such as "0-3,6" into |cpus|.
+  bool Parse(const std::string& list) {
+    CPU_ZERO(&cpus);
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+      int first = 0;
+      int last = 0;
+      if (sscanf(range.c_str(), "%d-%d", &first, &last) != 2) {
+        if (sscanf(range.c_str(), "%d", &first) != 1)
+          return false;
+        last = first;
+      }
+      if (first < 0 || last < first || last >= CPU_SETSIZE)
+        return false;
+      for (int cpu = first; cpu <= last; cpu++)
+        CPU_SET(cpu, &cpus);
+    }
+    enabled = CPU_COUNT(&cpus) > 0;
+    return enabled;
+  }
+
+  // Pins the calling thread.
+  void Apply() const {
+    if (enabled && sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+      LOG(ERROR) << "Failed to set CPU affinity: " << strerror(errno);
+  }
+};
+
+// Parsed before the fork, so the Binder server process sees them too.
+static CpuAffinity producer_affinity;
+static CpuAffinity consumer_affinity;
+
+// Consumer side statistics of one queue: the latency from the producer posting
+// a frame to the consumer acquiring it, and the consumer thread CPU time spent
+// acquiring and releasing it. The post time is the buffer timestamp, which
+// Surface fills with CLOCK_MONOTONIC and is comparable across processes.
+class TransportFrameStats {
  public:
-  BufferTransportService() = default;
-  ~BufferTransportService() = default;
+  struct Summary {
+    uint64_t frames = 0;
+    double latency_p50_us = 0;
+    double latency_p99_us = 0;
+    double consumer_cpu_us = 0;
+
+    void WriteToParcel(Parcel* parcel) const {
+      parcel->writeUint64(frames);
+      parcel->writeDouble(latency_p50_us);
+      parcel->writeDouble(latency_p99_us);
+      parcel->writeDouble(consumer_cpu_us);
+    }
 
-  virtual status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply,
-                              uint32_t flags = 0) {
-    (void)flags;
-    (void)data;
-    switch (code) {
-      case CREATE_BUFFER_QUEUE: {
-        auto new_queue = std::make_shared<BufferQueueHolder>(this);
-        reply->writeStrongBinder(
-            IGraphicBufferProducer::asBinder(new_queue->producer));
-        buffer_queues_.push_back(new_queue);
-        return OK;
-      }
-      default:
-        return UNKNOWN_TRANSACTION;
-    };
+    void ReadFromParcel(const Parcel& parcel) {
+      frames = parcel.readUint64();
+      latency_p50_us = parcel.readDouble();
+      latency_p99_us = parcel.readDouble();
+      consumer_cpu_us = parcel.readDouble();
+    }
+  };
+
+  void Record(nsecs_t latency, nsecs_t cpu_time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latencies_.push_back(latency);
+    cpu_time_ += cpu_time;
+  }
+
+  // Summarizes the frames recorded so far and starts over.
+  Summary Take() {
+    std::vector<nsecs_t> latencies;
+    nsecs_t cpu_time = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      latencies.swap(latencies_);
+      std::swap(cpu_time, cpu_time_);
+    }
+
+    Summary summary;
+    summary.frames = latencies.size();
+    if (!latencies.empty()) {
+      summary.latency_p50_us = Percentile(&latencies, 50) / 1000.0;
+      summary.latency_p99_us = Percentile(&latencies, 99) / 1000.0;
+      summary.consumer_cpu_us = cpu_time / 1000.0 / latencies.size();
+    }
+    return summary;
+  }
+
+ private:
+  static nsecs_t Percentile(std::vector<nsecs_t>* values, size_t percentile) {
+    auto nth = values->begin() + (values->size() - 1) * percentile / 100;
+    std::nth_element(values->begin(), nth, values->end());
+    return *nth;
+  }
+
+  std::mutex mutex_;
+  std::vector<nsecs_t> latencies_;
+  nsecs_t cpu_time_ = 0;
+};
+
+// A consumer thread that runs the acquire/release work of the queues assigned
+// to it, so that the measured latency includes waking up a consumer thread
+// rather than running inside the producer's queueBuffer() call.
+class ConsumerThread {
+ public:
+  ConsumerThread() { thread_ = std::thread([this]() { Run(); }); }
+
+  ~ConsumerThread() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    condition_.notify_one();
+    thread_.join();
+  }
+
+  void Post(std::function<void()> work) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      work_.push_back(std::move(work));
+    }
+    condition_.notify_one();
   }
 
+ private:
+  void Run() {
+    consumer_affinity.Apply();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      condition_.wait(lock, [this]() { return stopped_ || !work_.empty(); });
+      if (work_.empty())
+        return;
+      auto work = std::move(work_.front());
+      work_.pop_front();
+      lock.unlock();
+      work();
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> work_;
+  bool stopped_ = false;
+  std::thread thread_;
+};
+
+// A BufferQueue whose consumer end acquires and releases every frame right
+// away on a ConsumerThread, which minics a compositor doing no-op consuming.
+class InstantBufferQueueConsumer {
+ public:
+  InstantBufferQueueConsumer(ConsumerThread* consumer_thread,
+                             const char* name) {
+    BufferQueue::createBufferQueue(&producer_, &consumer_);
+
+    sp<BufferItemConsumer> buffer_item_consumer =
+        new BufferItemConsumer(consumer_, kBufferUsage, kMaxAcquiredImages,
+                               /*controlledByApp=*/true);
+    buffer_item_consumer->setName(String8(name));
+    frame_listener_ =
+        new FrameListener(consumer_thread, buffer_item_consumer, &stats_);
+    buffer_item_consumer->setFrameAvailableListener(frame_listener_);
+  }
+
+  ~InstantBufferQueueConsumer() { frame_listener_->Detach(); }
+
+  const sp<IGraphicBufferProducer>& producer() const { return producer_; }
+  TransportFrameStats* stats() { return &stats_; }
+
  private:
   struct FrameListener : public ConsumerBase::FrameAvailableListener {
    public:
-    FrameListener(BufferTransportService* /*service*/,
-                  sp<BufferItemConsumer> buffer_item_consumer)
-        : buffer_item_consumer_(buffer_item_consumer) {}
+    FrameListener(ConsumerThread* consumer_thread,
+                  sp<BufferItemConsumer> buffer_item_consumer,
+                  TransportFrameStats* stats)
+        : consumer_thread_(consumer_thread),
+          buffer_item_consumer_(buffer_item_consumer),
+          stats_(stats) {}
 
     void onFrameAvailable(const BufferItem& /*item*/) override {
+      // Keep the listener alive until the consumer thread gets to the frame.
+      sp<FrameListener> self = this;
+      consumer_thread_->Post([self]() { self->AcquireAndRelease(); });
+    }
+
+    // Stops recording into the stats of a consumer that is going away.
+    void Detach() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stats_ = nullptr;
+    }
+
+   private:
+    void AcquireAndRelease() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stats_)
+          return;
+      }
+      const nsecs_t start_cpu_time = systemTime(SYSTEM_TIME_THREAD);
       BufferItem buffer;
       status_t ret = 0;
       {
@@ -93,6 +279,8 @@ class BufferTransportService : public BBinder {
         LOG(ERROR) << "Failed to acquire next buffer.";
         return;
       }
+      const nsecs_t latency =
+          systemTime(SYSTEM_TIME_MONOTONIC) - buffer.mTimestamp;
 
       {
         ATRACE_NAME("ReleaseBuffer");
@@ -103,32 +291,69 @@ class BufferTransportService : public BBinder {
         LOG(ERROR) << "Failed to release buffer.";
         return;
       }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stats_) {
+        stats_->Record(latency,
+                       systemTime(SYSTEM_TIME_THREAD) - start_cpu_time);
+      }
     }
 
-   private:
+    ConsumerThread* consumer_thread_;
     sp<BufferItemConsumer> buffer_item_consumer_;
+    std::mutex mutex_;
+    TransportFrameStats* stats_;
   };
 
-  struct BufferQueueHolder {
-    explicit BufferQueueHolder(BufferTransportService* service) {
-      BufferQueue::createBufferQueue(&producer, &consumer);
-
-      sp<BufferItemConsumer> buffer_item_consumer =
-          new BufferItemConsumer(consumer, kBufferUsage, kMaxAcquiredImages,
-                                 /*controlledByApp=*/true);
-      buffer_item_consumer->setName(String8("BinderBufferTransport"));
-      frame_listener_ = new FrameListener(service, buffer_item_consumer);
-      buffer_item_consumer->setFrameAvailableListener(frame_listener_);
-    }
+  sp<IGraphicBufferProducer> producer_;
+  sp<IGraphicBufferConsumer> consumer_;
+  TransportFrameStats stats_;
+  sp<FrameListener> frame_listener_;
+};
 
-    sp<IGraphicBufferProducer> producer;
-    sp<IGraphicBufferConsumer> consumer;
+// A binder services that minics a compositor that consumes buffers. It provides
+// one Binder interface to create a new Surface for buffer producer to write
+// into; while itself will carry out no-op buffer consuming by acquiring then
+// releasing the buffer immediately on one of its consumer threads. A second
+// interface returns the consumer side TransportFrameStats of a queue.
+class BufferTransportService : public BBinder {
+ public:
+  BufferTransportService() = default;
+  ~BufferTransportService() = default;
 
-   private:
-    sp<FrameListener> frame_listener_;
-  };
+  virtual status_t onTransact(uint32_t code, const Parcel& data, Parcel* reply,
+                              uint32_t flags = 0) {
+    (void)flags;
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (code) {
+      case CREATE_BUFFER_QUEUE: {
+        auto& consumer_thread = consumer_threads_[data.readInt32()];
+        if (!consumer_thread)
+          consumer_thread.reset(new ConsumerThread);
+        auto new_queue = std::make_unique<InstantBufferQueueConsumer>(
+            consumer_thread.get(), "BinderBufferTransport");
+        reply->writeStrongBinder(
+            IGraphicBufferProducer::asBinder(new_queue->producer()));
+        reply->writeInt32(buffer_queues_.size());
+        buffer_queues_.push_back(std::move(new_queue));
+        return OK;
+      }
+      case TAKE_FRAME_STATS: {
+        const int32_t index = data.readInt32();
+        if (index < 0 || static_cast<size_t>(index) >= buffer_queues_.size())
+          return BAD_VALUE;
+        buffer_queues_[index]->stats()->Take().WriteToParcel(reply);
+        return OK;
+      }
+      default:
+        return UNKNOWN_TRANSACTION;
+    };
+  }
 
-  std::vector<std::shared_ptr<BufferQueueHolder>> buffer_queues_;
+ private:
+  std::mutex mutex_;
+  std::map<int32_t, std::unique_ptr<ConsumerThread>> consumer_threads_;
+  std::vector<std::unique_ptr<InstantBufferQueueConsumer>> buffer_queues_;
 };
 
 // A virtual interfaces that abstracts the common BufferQueue operations, so
@@ -139,7 +364,23 @@ class BufferTransport {
   virtual ~BufferTransport() {}
 
   virtual int Start() = 0;
-  virtual sp<Surface> CreateSurface() = 0;
+
+  // Creates the producer end of a new queue. Frames posted to it are consumed
+  // on consumer |consumer_index| of the transport.
+  virtual sp<Surface> CreateSurface(int consumer_index) = 0;
+
+  // Returns and resets the statistics of the |surface_index|-th surface
+  // created.
+  virtual TransportFrameStats::Summary TakeFrameStats(size_t surface_index) = 0;
+
+  // Called after the producer posted |frame_number| to the |surface_index|-th
+  // surface, for transports that can only observe consumption from the
+  // producer side.
+  virtual void OnFramePosted(size_t /*surface_index*/, Surface* /*surface*/,
+                             uint64_t /*frame_number*/) {}
+
+  // Whether TransportFrameStats::Summary::consumer_cpu_us is measured.
+  virtual bool MeasuresConsumerCpu() const { return true; }
 };
 
 // Binder-based buffer transport backend.
@@ -167,9 +408,10 @@ class BinderBufferTransport : public BufferTransport {
     return 0;
   }
 
-  sp<Surface> CreateSurface() override {
+  sp<Surface> CreateSurface(int consumer_index) override {
     Parcel data;
     Parcel reply;
+    data.writeInt32(consumer_index);
     int error = service_->transact(CREATE_BUFFER_QUEUE, data, &reply);
     if (error != OK) {
       LOG(ERROR) << "Failed to get buffer queue over binder.";
@@ -188,6 +430,7 @@ class BinderBufferTransport : public BufferTransport {
       LOG(ERROR) << "Failed to get IGraphicBufferProducer over binder.";
       return nullptr;
     }
+    queue_ids_.push_back(reply.readInt32());
 
     sp<Surface> surface = new Surface(producer, /*controlledByApp=*/true);
 
@@ -199,8 +442,145 @@ class BinderBufferTransport : public BufferTransport {
     return surface;
   }
 
+  TransportFrameStats::Summary TakeFrameStats(size_t surface_index) override {
+    Parcel data;
+    Parcel reply;
+    TransportFrameStats::Summary summary;
+    data.writeInt32(queue_ids_[surface_index]);
+    if (service_->transact(TAKE_FRAME_STATS, data, &reply) != OK) {
+      LOG(ERROR) << "Failed to get frame stats over binder.";
+      return summary;
+    }
+    summary.ReadFromParcel(reply);
+    return summary;
+  }
+
  private:
   sp<IBinder> service_;
+  std::vector<int32_t> queue_ids_;
+};
+
+// In-process BufferQueue transport.
+//
+// Same consumer as the Binder-based backend, but the BufferQueue and its
+// consumer threads live in the benchmark process, so no frame crosses a
+// process boundary.
+class BufferQueueTransport : public BufferTransport {
+ public:
+  explicit BufferQueueTransport(int consumer_count)
+      : consumer_threads_(consumer_count) {}
+
+  int Start() override {
+    for (auto& consumer_thread : consumer_threads_)
+      consumer_thread.reset(new ConsumerThread);
+    return 0;
+  }
+
+  sp<Surface> CreateSurface(int consumer_index) override {
+    auto* consumer_thread =
+        consumer_threads_[consumer_index % consumer_threads_.size()].get();
+    buffer_queues_.push_back(std::make_unique<InstantBufferQueueConsumer>(
+        consumer_thread, "BufferQueueTransport"));
+
+    sp<Surface> surface = new Surface(buffer_queues_.back()->producer(),
+                                      /*controlledByApp=*/true);
+    ANativeWindow* window = static_cast<ANativeWindow*>(surface.get());
+    ANativeWindow_setBuffersGeometry(window, kBufferWidth, kBufferHeight,
+                                     kBufferFormat);
+    return surface;
+  }
+
+  TransportFrameStats::Summary TakeFrameStats(size_t surface_index) override {
+    return buffer_queues_[surface_index]->stats()->Take();
+  }
+
+ private:
+  std::vector<std::unique_ptr<ConsumerThread>> consumer_threads_;
+  // Destroyed before the threads that may still run their consumer work.
+  std::vector<std::unique_ptr<InstantBufferQueueConsumer>> buffer_queues_;
+};
+
+// BLASTBufferQueue-based buffer transport.
+//
+// Frames go to SurfaceFlinger in transactions and are consumed by the real
+// compositor. There is no consumer side code to time, so the latency is the
+// time from posting a frame to SurfaceFlinger latching it, read back through
+// the frame timestamps of the producer Surface. SurfaceFlinger's CPU time is
+// not measured.
+class BlastBufferTransport : public BufferTransport {
+ public:
+  int Start() override {
+    client_ = new SurfaceComposerClient;
+    if (client_->initCheck() != NO_ERROR) {
+      LOG(ERROR) << "Failed to connect to SurfaceFlinger.";
+      return -EIO;
+    }
+    return 0;
+  }
+
+  sp<Surface> CreateSurface(int /*consumer_index*/) override {
+    sp<SurfaceControl> surface_control = client_->createSurface(
+        String8("BufferTransportBenchmark"), kBufferWidth, kBufferHeight,
+        kBlastBufferFormat, ISurfaceComposerClient::eFXSurfaceBufferState);
+    if (surface_control == nullptr) {
+      LOG(ERROR) << "Failed to create BLAST surface.";
+      return nullptr;
+    }
+    SurfaceComposerClient::Transaction()
+        .setLayerStack(surface_control, 0)
+        .setLayer(surface_control, std::numeric_limits<int32_t>::max())
+        .show(surface_control)
+        .apply();
+
+    sp<BLASTBufferQueue> buffer_queue =
+        new BLASTBufferQueue(surface_control, kBufferWidth, kBufferHeight);
+    sp<Surface> surface = new Surface(buffer_queue->getIGraphicBufferProducer(),
+                                      /*controlledByApp=*/true);
+    surface->enableFrameTimestamps(true);
+    ANativeWindow* window = static_cast<ANativeWindow*>(surface.get());
+    ANativeWindow_setBuffersGeometry(window, kBufferWidth, kBufferHeight,
+                                     kBlastBufferFormat);
+
+    buffer_queues_.push_back(std::make_unique<BufferQueueHolder>());
+    buffer_queues_.back()->surface_control = surface_control;
+    buffer_queues_.back()->buffer_queue = buffer_queue;
+    return surface;
+  }
+
+  TransportFrameStats::Summary TakeFrameStats(size_t surface_index) override {
+    return buffer_queues_[surface_index]->stats.Take();
+  }
+
+  void OnFramePosted(size_t surface_index, Surface* surface,
+                     uint64_t frame_number) override {
+    if (frame_number < kLatchLookback)
+      return;
+
+    nsecs_t post_time = 0;
+    nsecs_t latch_time = 0;
+    status_t ret = surface->getFrameTimestamps(
+        frame_number - kLatchLookback, &post_time, /*outAcquireTime=*/nullptr,
+        &latch_time, /*outFirstRefreshStartTime=*/nullptr,
+        /*outLastRefreshStartTime=*/nullptr,
+        /*outGpuCompositionDoneTime=*/nullptr,
+        /*outDisplayPresentTime=*/nullptr, /*outDequeueReadyTime=*/nullptr,
+        /*outReleaseTime=*/nullptr);
+    // The frame may not be latched yet, or may already be out of the history.
+    if (ret == OK && latch_time >= post_time && post_time > 0)
+      buffer_queues_[surface_index]->stats.Record(latch_time - post_time, 0);
+  }
+
+  bool MeasuresConsumerCpu() const override { return false; }
+
+ private:
+  struct BufferQueueHolder {
+    sp<SurfaceControl> surface_control;
+    sp<BLASTBufferQueue> buffer_queue;
+    TransportFrameStats stats;
+  };
+
+  sp<SurfaceComposerClient> client_;
+  std::vector<std::unique_ptr<BufferQueueHolder>> buffer_queues_;
 };
 
 class DvrApi {
@@ -227,70 +607,44 @@ class DvrApi {
 
 // BufferHub/PDX-based buffer transport.
 //
-// On Start() a new thread will be swapned to run an epoll polling thread which
-// minics the behavior of a compositor. Similar to Binder-based backend, the
-// buffer available handler is also a no-op: Buffer gets acquired and released
-// immediately.
+// On Start() new threads will be swapned to run epoll polling loops which
+// minic the behavior of a compositor, one per consumer. Similar to Binder-based
+// backend, the buffer available handler is also a no-op: Buffer gets acquired
+// and released immediately.
 // On CreateSurface() a pair of dvr::ProducerQueue and dvr::ConsumerQueue will
-// be created. The epoll thread holds on the consumer queue and dequeues buffer
-// from it; while the producer queue will be wrapped in a Surface and returned
-// to test suite.
+// be created. One of the epoll threads holds on the consumer queue and dequeues
+// buffer from it; while the producer queue will be wrapped in a Surface and
+// returned to test suite.
 class BufferHubTransport : public BufferTransport {
  public:
+  explicit BufferHubTransport(int consumer_count)
+      : readers_(consumer_count) {}
+
   virtual ~BufferHubTransport() {
     stopped_.store(true);
-    if (reader_thread_.joinable()) {
-      reader_thread_.join();
+    for (auto& reader : readers_) {
+      if (reader.thread.joinable()) {
+        reader.thread.join();
+      }
     }
   }
 
   int Start() override {
-    int ret = epoll_fd_.Create();
-    if (ret < 0) {
-      LOG(ERROR) << "Failed to create epoll fd: %s", strerror(-ret);
-      return -1;
-    }
-
-    // Create the reader thread.
-    reader_thread_ = std::thread([this]() {
-      int ret = dvr_.Api().PerformanceSetSchedulerPolicy(0, "graphics");
+    for (auto& reader : readers_) {
+      int ret = reader.epoll_fd.Create();
       if (ret < 0) {
-        LOG(ERROR) << "Failed to set scheduler policy, ret=" << ret;
-        return;
-      }
-
-      stopped_.store(false);
-      LOG(INFO) << "Reader Thread Running...";
-
-      while (!stopped_.load()) {
-        std::array<epoll_event, kMaxQueueCounts> events;
-
-        // Don't sleep forever so that we will have a chance to wake up.
-        const int ret = epoll_fd_.Wait(events.data(), events.size(),
-                                       /*timeout=*/100);
-        if (ret < 0) {
-          LOG(ERROR) << "Error polling consumer queues.";
-          continue;
-        }
-        if (ret == 0) {
-          continue;
-        }
-
-        const int num_events = ret;
-        for (int i = 0; i < num_events; i++) {
-          uint32_t index = events[i].data.u32;
-          dvr_.Api().ReadBufferQueueHandleEvents(
-              buffer_queues_[index]->GetReadQueue());
-        }
+        LOG(ERROR) << "Failed to create epoll fd: " << strerror(-ret);
+        return -1;
       }
 
-      LOG(INFO) << "Reader Thread Exiting...";
-    });
+      // Create the reader thread.
+      reader.thread = std::thread([this, &reader]() { RunReader(&reader); });
+    }
 
     return 0;
   }
 
-  sp<Surface> CreateSurface() override {
+  sp<Surface> CreateSurface(int consumer_index) override {
     auto new_queue = std::make_shared<BufferQueueHolder>();
     if (!new_queue->IsReady()) {
       LOG(ERROR) << "Failed to create BufferHub-based BufferQueue.";
@@ -301,12 +655,14 @@ class BufferHubTransport : public BufferTransport {
     ANativeWindow_setBuffersGeometry(new_queue->GetSurface(), kBufferWidth,
                                      kBufferHeight, kBufferFormat);
 
-    // Use the next position as buffer_queue index.
-    uint32_t index = buffer_queues_.size();
-    epoll_event event = {.events = EPOLLIN | EPOLLET, .data = {.u32 = index}};
+    // The reader threads may already be polling, so they get the queue itself
+    // rather than an index into |buffer_queues_|.
+    epoll_event event = {.events = EPOLLIN | EPOLLET,
+                         .data = {.ptr = new_queue.get()}};
     int queue_fd =
         dvr_.Api().ReadBufferQueueGetEventFd(new_queue->GetReadQueue());
-    const int ret = epoll_fd_.Control(EPOLL_CTL_ADD, queue_fd, &event);
+    auto& reader = readers_[consumer_index % readers_.size()];
+    const int ret = reader.epoll_fd.Control(EPOLL_CTL_ADD, queue_fd, &event);
     if (ret < 0) {
       LOG(ERROR) << "Failed to track consumer queue: " << strerror(-ret)
                  << ", consumer queue fd: " << queue_fd;
@@ -318,7 +674,50 @@ class BufferHubTransport : public BufferTransport {
     return static_cast<Surface*>(new_queue->GetSurface());
   }
 
+  TransportFrameStats::Summary TakeFrameStats(size_t surface_index) override {
+    return buffer_queues_[surface_index]->GetStats()->Take();
+  }
+
  private:
+  struct Reader {
+    dvr::EpollFileDescriptor epoll_fd;
+    std::thread thread;
+  };
+
+  void RunReader(Reader* reader) {
+    int ret = dvr_.Api().PerformanceSetSchedulerPolicy(0, "graphics");
+    if (ret < 0) {
+      LOG(ERROR) << "Failed to set scheduler policy, ret=" << ret;
+      return;
+    }
+    consumer_affinity.Apply();
+
+    LOG(INFO) << "Reader Thread Running...";
+
+    while (!stopped_.load()) {
+      std::array<epoll_event, kMaxQueueCounts> events;
+
+      // Don't sleep forever so that we will have a chance to wake up.
+      const int ret = reader->epoll_fd.Wait(events.data(), events.size(),
+                                            /*timeout=*/100);
+      if (ret < 0) {
+        LOG(ERROR) << "Error polling consumer queues.";
+        continue;
+      }
+      if (ret == 0) {
+        continue;
+      }
+
+      const int num_events = ret;
+      for (int i = 0; i < num_events; i++) {
+        auto* queue = static_cast<BufferQueueHolder*>(events[i].data.ptr);
+        dvr_.Api().ReadBufferQueueHandleEvents(queue->GetReadQueue());
+      }
+    }
+
+    LOG(INFO) << "Reader Thread Exiting...";
+  }
+
   struct BufferQueueHolder {
     BufferQueueHolder() {
       int ret = 0;
@@ -359,6 +758,8 @@ class BufferHubTransport : public BufferTransport {
 
     DvrReadBufferQueue* GetReadQueue() { return read_queue_; }
 
+    TransportFrameStats* GetStats() { return &stats_; }
+
     ANativeWindow* GetSurface() { return surface_; }
 
     bool IsReady() {
@@ -367,6 +768,7 @@ class BufferHubTransport : public BufferTransport {
     }
 
     void HandleBufferAvailable() {
+      const nsecs_t start_cpu_time = systemTime(SYSTEM_TIME_THREAD);
       int ret = 0;
       DvrNativeBufferMetadata meta;
       DvrReadBuffer* buffer = nullptr;
@@ -382,6 +784,8 @@ class BufferHubTransport : public BufferTransport {
         LOG(ERROR) << "Failed to acquire consumer buffer, error: " << ret;
         return;
       }
+      const nsecs_t latency =
+          systemTime(SYSTEM_TIME_MONOTONIC) - metadata.timestamp;
 
       if (buffer != nullptr) {
         ATRACE_NAME("ReleaseBuffer");
@@ -390,6 +794,11 @@ class BufferHubTransport : public BufferTransport {
       }
       if (ret < 0) {
         LOG(ERROR) << "Failed to release consumer buffer, error: " << ret;
+        return;
+      }
+      if (buffer != nullptr) {
+        stats_.Record(latency,
+                      systemTime(SYSTEM_TIME_THREAD) - start_cpu_time);
       }
     }
 
@@ -397,13 +806,13 @@ class BufferHubTransport : public BufferTransport {
     DvrWriteBufferQueue* write_queue_ = nullptr;
     DvrReadBufferQueue* read_queue_ = nullptr;
     ANativeWindow* surface_ = nullptr;
+    TransportFrameStats stats_;
   };
 
   static DvrApi dvr_;
-  std::atomic<bool> stopped_;
-  std::thread reader_thread_;
+  std::atomic<bool> stopped_{false};
+  std::vector<Reader> readers_;
 
-  dvr::EpollFileDescriptor epoll_fd_;
   std::vector<std::shared_ptr<BufferQueueHolder>> buffer_queues_;
 };
 
@@ -412,22 +821,37 @@ DvrApi BufferHubTransport::dvr_ = {};
 enum TransportType {
   kBinderBufferTransport,
   kBufferHubTransport,
+  kBufferQueueTransport,
+  kBlastBufferTransport,
 };
 
-// Main test suite, which supports two transport backend: 1) BinderBufferQueue,
-// 2) BufferHubQueue. The test case drives the producer end of both transport
+// Main test suite, which supports four transport backends: 1) BufferQueue
+// consumed in another process over Binder, 2) BufferHubQueue, 3) BufferQueue
+// consumed in the benchmark process, 4) BLASTBufferQueue consumed by
+// SurfaceFlinger. The test case drives the producer end of the transport
 // backend by queuing buffers into the buffer queue by using ANativeWindow API.
+//
+// Arguments are the transport, the queue depth (buffer count of each producer
+// Surface) and the number of consumer threads the queues are spread over. Each
+// benchmark thread is a producer with its own queue.
 class BufferTransportBenchmark : public ::benchmark::Fixture {
  public:
   void SetUp(State& state) override {
     if (state.thread_index == 0) {
       const int transport = state.range(0);
+      const int consumer_count = state.range(2);
       switch (transport) {
         case kBinderBufferTransport:
           transport_.reset(new BinderBufferTransport);
           break;
         case kBufferHubTransport:
-          transport_.reset(new BufferHubTransport);
+          transport_.reset(new BufferHubTransport(consumer_count));
+          break;
+        case kBufferQueueTransport:
+          transport_.reset(new BufferQueueTransport(consumer_count));
+          break;
+        case kBlastBufferTransport:
+          transport_.reset(new BlastBufferTransport);
           break;
         default:
           CHECK(false) << "Unknown test case.";
@@ -444,7 +868,7 @@ class BufferTransportBenchmark : public ::benchmark::Fixture {
       surfaces_.resize(state.threads);
       for (int i = 0; i < state.threads; i++) {
         // Common setup every thread needs.
-        surfaces_[i] = transport_->CreateSurface();
+        surfaces_[i] = transport_->CreateSurface(i % consumer_count);
         CHECK(surfaces_[i]);
 
         LOG(INFO) << "Surface initialized on thread " << i << ".";
@@ -467,26 +891,42 @@ class BufferTransportBenchmark : public ::benchmark::Fixture {
 
 BENCHMARK_DEFINE_F(BufferTransportBenchmark, Producers)(State& state) {
   ANativeWindow* window = nullptr;
+  Surface* surface = nullptr;
   ANativeWindow_Buffer buffer;
   int32_t error = 0;
   double total_gain_buffer_us = 0;
   double total_post_buffer_us = 0;
+  nsecs_t start_cpu_time = 0;
   int iterations = 0;
+  const int queue_depth = state.range(1);
+
+  producer_affinity.Apply();
 
   while (state.KeepRunning()) {
     if (window == nullptr) {
       CHECK(surfaces_[state.thread_index]);
-      window = static_cast<ANativeWindow*>(surfaces_[state.thread_index].get());
+      surface = surfaces_[state.thread_index].get();
+      window = static_cast<ANativeWindow*>(surface);
+
+      error = native_window_set_buffer_count(window, queue_depth);
+      if (error != 0) {
+        state.SkipWithError("Queue depth not supported by the transport.");
+        break;
+      }
 
       // Lock buffers a couple time from the queue, so that we have the buffer
       // allocated.
-      for (int i = 0; i < kQueueDepth; i++) {
+      for (int i = 0; i < queue_depth; i++) {
         error = ANativeWindow_lock(window, &buffer,
                                    /*inOutDirtyBounds=*/nullptr);
         CHECK_EQ(error, 0);
         error = ANativeWindow_unlockAndPost(window);
         CHECK_EQ(error, 0);
       }
+
+      // Leave the allocation frames out of the statistics.
+      transport_->TakeFrameStats(state.thread_index);
+      start_cpu_time = systemTime(SYSTEM_TIME_THREAD);
     }
 
     {
@@ -500,6 +940,7 @@ BENCHMARK_DEFINE_F(BufferTransportBenchmark, Producers)(State& state) {
     }
     CHECK_EQ(error, 0);
 
+    const uint64_t frame_number = surface->getNextFrameNumber();
     {
       ATRACE_NAME("PostBuffer");
       auto t1 = std::chrono::high_resolution_clock::now();
@@ -509,10 +950,18 @@ BENCHMARK_DEFINE_F(BufferTransportBenchmark, Producers)(State& state) {
       total_post_buffer_us += delta_us.count();
     }
     CHECK_EQ(error, 0);
+    transport_->OnFramePosted(state.thread_index, surface, frame_number);
 
     iterations++;
   }
 
+  if (iterations == 0)
+    return;
+
+  const double producer_cpu_us =
+      (systemTime(SYSTEM_TIME_THREAD) - start_cpu_time) / 1000.0;
+  const auto stats = transport_->TakeFrameStats(state.thread_index);
+
   state.counters["gain_buffer_us"] = ::benchmark::Counter(
       total_gain_buffer_us / iterations, ::benchmark::Counter::kAvgThreads);
   state.counters["post_buffer_us"] = ::benchmark::Counter(
@@ -520,11 +969,35 @@ BENCHMARK_DEFINE_F(BufferTransportBenchmark, Producers)(State& state) {
   state.counters["producer_us"] = ::benchmark::Counter(
       (total_gain_buffer_us + total_post_buffer_us) / iterations,
       ::benchmark::Counter::kAvgThreads);
+  state.counters["producer_cpu_us"] = ::benchmark::Counter(
+      producer_cpu_us / iterations, ::benchmark::Counter::kAvgThreads);
+  // Percentiles are computed per queue and averaged over the producers.
+  state.counters["post_to_acquire_p50_us"] = ::benchmark::Counter(
+      stats.latency_p50_us, ::benchmark::Counter::kAvgThreads);
+  state.counters["post_to_acquire_p99_us"] = ::benchmark::Counter(
+      stats.latency_p99_us, ::benchmark::Counter::kAvgThreads);
+  state.counters["acquired_frames"] = stats.frames;
+  if (transport_->MeasuresConsumerCpu()) {
+    state.counters["consumer_cpu_us"] = ::benchmark::Counter(
+        stats.consumer_cpu_us, ::benchmark::Counter::kAvgThreads);
+  }
+}
+
+static void TransportArguments(::benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"transport", "depth", "consumers"});
+  for (int transport : {kBinderBufferTransport, kBufferHubTransport,
+                        kBufferQueueTransport, kBlastBufferTransport}) {
+    for (int depth : {2, 3, 4}) {
+      for (int consumers : {1, 4}) {
+        benchmark->Args({transport, depth, consumers});
+      }
+    }
+  }
 }
 
 BENCHMARK_REGISTER_F(BufferTransportBenchmark, Producers)
     ->Unit(::benchmark::kMicrosecond)
-    ->Ranges({{kBinderBufferTransport, kBufferHubTransport}})
+    ->Apply(TransportArguments)
     ->ThreadRange(1, 32);
 
 static void runBinderServer() {
@@ -550,25 +1023,44 @@ static void runBinderServer() {
 
 // To run binder-based benchmark, use:
 // adb shell buffer_transport_benchmark \
-//   --benchmark_filter="BufferTransportBenchmark/ContinuousLoad/0/"
+//   --benchmark_filter="BufferTransportBenchmark/Producers/transport:0/"
 //
 // To run bufferhub-based benchmark, use:
 // adb shell buffer_transport_benchmark \
-//   --benchmark_filter="BufferTransportBenchmark/ContinuousLoad/1/"
+//   --benchmark_filter="BufferTransportBenchmark/Producers/transport:1/"
+//
+// Transports 2 and 3 are the in-process BufferQueue and BLASTBufferQueue. To
+// collect the latency percentiles and CPU costs for comparison, add:
+//   --benchmark_out=/data/local/tmp/transport.json --benchmark_out_format=json
 int main(int argc, char** argv) {
   bool tracing_enabled = false;
 
   // Parse arguments in addition to "--benchmark_filter" paramters.
   for (int i = 1; i < argc; i++) {
-    if (std::string(argv[i]) == "--help") {
+    const std::string arg = argv[i];
+    if (arg == "--help") {
       std::cout << "Usage: binderThroughputTest [OPTIONS]" << std::endl;
       std::cout << "\t--trace: Enable systrace logging." << std::endl;
+      std::cout << "\t--producer_cpus=<list>: Pin producers, e.g. 0-3."
+                << std::endl;
+      std::cout << "\t--consumer_cpus=<list>: Pin consumers, e.g. 4,5."
+                << std::endl;
       return 0;
     }
-    if (std::string(argv[i]) == "--trace") {
+    if (arg == "--trace") {
       tracing_enabled = true;
       continue;
     }
+    for (auto [option, affinity] :
+         {std::make_pair("--producer_cpus=", &producer_affinity),
+          std::make_pair("--consumer_cpus=", &consumer_affinity)}) {
+      const std::string prefix = option;
+      if (arg.compare(0, prefix.size(), prefix) == 0 &&
+          !affinity->Parse(arg.substr(prefix.size()))) {
+        std::cerr << "Invalid CPU list: " << arg << std::endl;
+        return 1;
+      }
+    }
   }
 
   // Setup ATRACE/systrace based on command line.
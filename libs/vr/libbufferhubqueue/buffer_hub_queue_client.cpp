@@ -618,6 +618,102 @@ pdx::Status<std::shared_ptr<ProducerBuffer>> ProducerQueue::Dequeue(
   return {std::move(buffer)};
 }
 
+Status<std::vector<std::shared_ptr<ProducerBuffer>>>
+ProducerQueue::DequeueBatch(int timeout, size_t max_count,
+                            std::vector<size_t>* slots,
+                            std::vector<DvrNativeBufferMetadata>* out_metas,
+                            std::vector<LocalHandle>* release_fences) {
+  ATRACE_NAME("ProducerQueue::DequeueBatch");
+  if (max_count == 0 || slots == nullptr || out_metas == nullptr ||
+      release_fences == nullptr) {
+    ALOGE("%s: Invalid parameter.", __FUNCTION__);
+    return ErrorStatus(EINVAL);
+  }
+
+  std::vector<std::shared_ptr<ProducerBuffer>> buffers;
+  slots->clear();
+  out_metas->clear();
+  release_fences->clear();
+  uint64_t slot_mask = 0;
+  int error = 0;
+  while (buffers.size() < max_count) {
+    // Only the first buffer is waited for.
+    size_t slot;
+    auto dequeue_status =
+        BufferHubQueue::Dequeue(buffers.empty() ? timeout : 0, &slot);
+    if (!dequeue_status) {
+      error = dequeue_status.error();
+      break;
+    }
+    auto buffer =
+        std::static_pointer_cast<ProducerBuffer>(dequeue_status.take());
+
+    DvrNativeBufferMetadata meta;
+    LocalHandle release_fence;
+    error = -buffer->LocalGain(&meta, &release_fence);
+    if (error)
+      break;
+
+    buffers.push_back(std::move(buffer));
+    slots->push_back(slot);
+    out_metas->push_back(meta);
+    release_fences->push_back(std::move(release_fence));
+    slot_mask |= 1ULL << slot;
+  }
+  if (buffers.empty())
+    return ErrorStatus(error);
+
+  auto status = SendImpulse(BufferHubRPC::ProducerQueueGainBuffers::Opcode,
+                            &slot_mask, sizeof(slot_mask));
+  if (!status) {
+    ALOGE("%s: Failed to send gain impulse: %s", __FUNCTION__,
+          status.GetErrorMessage().c_str());
+    return status.error_status();
+  }
+  return {std::move(buffers)};
+}
+
+Status<void> ProducerQueue::PostBatch(
+    const std::vector<size_t>& slots,
+    const std::vector<DvrNativeBufferMetadata>& metas,
+    const std::vector<LocalHandle>& ready_fences) {
+  ATRACE_NAME("ProducerQueue::PostBatch");
+  if (slots.size() != metas.size() || slots.size() != ready_fences.size()) {
+    ALOGE("%s: Invalid parameter.", __FUNCTION__);
+    return ErrorStatus(EINVAL);
+  }
+
+  uint64_t slot_mask = 0;
+  int error = 0;
+  for (size_t i = 0; i < slots.size(); i++) {
+    std::shared_ptr<ProducerBuffer> buffer;
+    if (slots[i] < kMaxQueueCapacity)
+      buffer = GetBuffer(slots[i]);
+    if (buffer == nullptr) {
+      ALOGE("%s: No buffer in slot %zu.", __FUNCTION__, slots[i]);
+      error = EINVAL;
+      break;
+    }
+    error = -buffer->LocalPost(&metas[i], ready_fences[i]);
+    if (error)
+      break;
+    slot_mask |= 1ULL << slots[i];
+  }
+
+  if (slot_mask) {
+    auto status = SendImpulse(BufferHubRPC::ProducerQueuePostBuffers::Opcode,
+                              &slot_mask, sizeof(slot_mask));
+    if (!status) {
+      ALOGE("%s: Failed to send post impulse: %s", __FUNCTION__,
+            status.GetErrorMessage().c_str());
+      return status.error_status();
+    }
+  }
+  if (error)
+    return ErrorStatus(error);
+  return {};
+}
+
 Status<std::shared_ptr<ProducerBuffer>> ProducerQueue::DequeueUnacquiredBuffer(
     size_t* slot) {
   if (unavailable_buffers_slot_.size() < 1) {
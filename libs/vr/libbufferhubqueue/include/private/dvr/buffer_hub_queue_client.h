@@ -379,6 +379,25 @@ class ProducerQueue : public pdx::ClientBase<ProducerQueue, BufferHubQueue> {
       int timeout, size_t* slot, DvrNativeBufferMetadata* out_meta,
       pdx::LocalHandle* release_fence, bool gain_posted_buffer = false);
 
+  // Dequeue up to |max_count| producer buffers to write. The first buffer is
+  // waited for up to |timeout|; the rest are only taken if they are already
+  // available. Instead of one impulse per buffer, BufferHub is notified of the
+  // whole batch with a single impulse on the queue channel. Slots, metadata and
+  // release fences are returned in the same order as the buffers.
+  pdx::Status<std::vector<std::shared_ptr<ProducerBuffer>>> DequeueBatch(
+      int timeout, size_t max_count, std::vector<size_t>* slots,
+      std::vector<DvrNativeBufferMetadata>* out_metas,
+      std::vector<pdx::LocalHandle>* release_fences);
+
+  // Posts the gained buffers in |slots| to the consumer side, passing along
+  // the matching entries of |metas| and |ready_fences|, with a single impulse
+  // on the queue channel. If posting a buffer fails, the buffers before it are
+  // still posted and the error is returned.
+  pdx::Status<void> PostBatch(
+      const std::vector<size_t>& slots,
+      const std::vector<DvrNativeBufferMetadata>& metas,
+      const std::vector<pdx::LocalHandle>& ready_fences);
+
   // Enqueues a producer buffer in the queue.
   pdx::Status<void> Enqueue(const std::shared_ptr<ProducerBuffer>& buffer,
                             size_t slot, uint64_t index) {
@@ -9,6 +9,7 @@
 #include <poll.h>
 #include <sys/eventfd.h>
 
+#include <algorithm>
 #include <vector>
 
 // Enable/disable debug logging.
@@ -324,6 +325,52 @@ TEST_F(BufferHubQueueTest, TestProducerConsumer) {
   }
 }
 
+TEST_F(BufferHubQueueTest, TestDequeueAndPostBatch) {
+  const size_t kBufferCount = 4;
+  ASSERT_TRUE(CreateQueues(config_builder_.Build(), UsagePolicy{}));
+  for (size_t i = 0; i < kBufferCount; i++)
+    AllocateBuffer();
+
+  for (int64_t frame = 0; frame < 3; frame++) {
+    // Gain all buffers with a single call, asking for more than there are.
+    std::vector<size_t> slots;
+    std::vector<DvrNativeBufferMetadata> metas;
+    std::vector<LocalHandle> fences;
+    auto producer_status = producer_queue_->DequeueBatch(
+        kTimeoutMs, kBufferCount + 1, &slots, &metas, &fences);
+    ASSERT_TRUE(producer_status.ok()) << producer_status.GetErrorMessage();
+    ASSERT_EQ(kBufferCount, producer_status.get().size());
+    ASSERT_EQ(kBufferCount, slots.size());
+    EXPECT_EQ(0U, producer_queue_->count());
+
+    for (size_t i = 0; i < kBufferCount; i++) {
+      metas[i].index = frame * kBufferCount + i;
+      fences[i] = LocalHandle();
+    }
+    ASSERT_TRUE(producer_queue_->PostBatch(slots, metas, fences).ok());
+
+    // Every buffer of the batch shows up on the consumer side, in any order.
+    for (size_t i = 0; i < kBufferCount; i++) {
+      size_t slot;
+      LocalHandle fence;
+      DvrNativeBufferMetadata mi, mo;
+      auto consumer_status =
+          consumer_queue_->Dequeue(kTimeoutMs, &slot, &mo, &fence);
+      ASSERT_TRUE(consumer_status.ok()) << consumer_status.GetErrorMessage();
+      auto it = std::find(slots.begin(), slots.end(), slot);
+      ASSERT_NE(slots.end(), it);
+      EXPECT_EQ(metas[it - slots.begin()].index, mo.index);
+      EXPECT_EQ(consumer_status.take()->ReleaseAsync(&mi, LocalHandle()), 0);
+    }
+  }
+
+  // Posting a slot that was not gained fails without posting anything.
+  std::vector<size_t> slots{0};
+  std::vector<DvrNativeBufferMetadata> metas(1);
+  std::vector<LocalHandle> fences(1);
+  EXPECT_FALSE(producer_queue_->PostBatch(slots, metas, fences).ok());
+}
+
 TEST_F(BufferHubQueueTest, TestInsertBuffer) {
   ASSERT_TRUE(CreateProducerQueue(config_builder_.Build(), UsagePolicy{}));
 
@@ -0,0 +1,80 @@
+#ifndef ANDROID_DVR_VSYNC_PREDICTOR_H_
+#define ANDROID_DVR_VSYNC_PREDICTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+#include <dvr/dvr_vsync.h>
+
+namespace android {
+namespace dvr {
+
+// Fits a vsync period and phase to recent hardware vsync timestamps with a
+// least squares regression, so that predictions do not drift when the real
+// period differs from the nominal one. Predictions made from the nominal period
+// are used until there are enough samples. Not thread safe.
+class VsyncPredictor {
+ public:
+  explicit VsyncPredictor(int64_t nominal_period_ns);
+
+  // Drops all samples and starts over with a new nominal period.
+  void Reset(int64_t nominal_period_ns);
+
+  // Adds a hardware vsync timestamp. Returns false if the timestamp was
+  // rejected as an outlier.
+  bool AddVsyncTimestamp(int64_t timestamp_ns);
+
+  int64_t nominal_period_ns() const { return nominal_period_ns_; }
+
+  // The fitted period, or the nominal period without enough samples.
+  int64_t period_ns() const { return period_ns_; }
+
+  // Whether the period and phase were fitted to hardware vsync.
+  bool has_model() const { return has_model_; }
+
+  // Returns the first predicted vsync at or after |time_ns|.
+  int64_t NextVsyncAfter(int64_t time_ns) const;
+
+  // Fills in the prediction fields of |vsync| relative to its timestamp.
+  void FillPrediction(DvrVsync* vsync) const;
+
+ private:
+  // Samples to fit the model to.
+  static constexpr size_t kHistorySize = 20;
+  // Samples needed before the model is trusted.
+  static constexpr size_t kMinSamples = 6;
+  // How far, in percent of the period, a sample may be from the model before
+  // it is rejected.
+  static constexpr int64_t kOutlierTolerancePercent = 25;
+  // Outliers in a row after which the model is dropped.
+  static constexpr int kMaxConsecutiveOutliers = 3;
+  // How far, in percent, the fitted period may be from the nominal one.
+  static constexpr int64_t kMaxPeriodErrorPercent = 20;
+
+  void UpdateModel();
+
+  int64_t nominal_period_ns_;
+  int64_t period_ns_;
+  // The timestamp of a vsync on the model.
+  int64_t anchor_ns_ = 0;
+  bool has_model_ = false;
+  int consecutive_outliers_ = 0;
+
+  std::array<int64_t, kHistorySize> timestamps_;
+  size_t sample_count_ = 0;
+  size_t next_sample_ = 0;
+};
+
+// Returns the timestamp of the vsync |vsyncs_ahead| after |vsync|, using the
+// prediction published by the display service when there is one.
+int64_t PredictVsyncTimestamp(const DvrVsync& vsync, uint32_t vsyncs_ahead);
+
+// Returns the first vsync at or after |time_ns| predicted from |vsync|.
+int64_t PredictNextVsyncAfter(const DvrVsync& vsync, int64_t time_ns);
+
+}  // namespace dvr
+}  // namespace android
+
+#endif  // ANDROID_DVR_VSYNC_PREDICTOR_H_
@@ -37,7 +37,8 @@ class BnVsyncCallback : public BnInterface<IVsyncCallback> {
 //
 // 3. The IVsyncService provides the real vsync timestamp reported by hardware
 // composer, whereas the vsync shared memory buffer only has predicted vsync
-// times.
+// times. The predictions are fitted to the hardware timestamps, see
+// vsync_predictor.h for reading them.
 class IVsyncService : public IInterface {
 public:
   DECLARE_META_INTERFACE(VsyncService)
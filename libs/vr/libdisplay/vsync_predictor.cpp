@@ -0,0 +1,172 @@
+#include "include/private/dvr/vsync_predictor.h"
+
+#include <inttypes.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace android {
+namespace dvr {
+
+namespace {
+
+// Rounds |numerator| / |denominator| to the nearest integer, for positive
+// denominators.
+int64_t DivideRounded(int64_t numerator, int64_t denominator) {
+  return numerator >= 0 ? (numerator + denominator / 2) / denominator
+                        : -((-numerator + denominator / 2) / denominator);
+}
+
+// Returns the first vsync at or after |time_ns| for a vsync at |anchor_ns|
+// and a period of |period_ns|.
+int64_t NextVsync(int64_t anchor_ns, int64_t period_ns, int64_t time_ns) {
+  if (period_ns <= 0)
+    return time_ns;
+  const int64_t delta = time_ns - anchor_ns;
+  int64_t count = delta / period_ns;
+  if (count * period_ns < delta)
+    count++;
+  return anchor_ns + count * period_ns;
+}
+
+}  // anonymous namespace
+
+VsyncPredictor::VsyncPredictor(int64_t nominal_period_ns) {
+  Reset(nominal_period_ns);
+}
+
+void VsyncPredictor::Reset(int64_t nominal_period_ns) {
+  nominal_period_ns_ = nominal_period_ns;
+  period_ns_ = nominal_period_ns;
+  anchor_ns_ = 0;
+  has_model_ = false;
+  consecutive_outliers_ = 0;
+  sample_count_ = 0;
+  next_sample_ = 0;
+}
+
+bool VsyncPredictor::AddVsyncTimestamp(int64_t timestamp_ns) {
+  if (sample_count_ > 0) {
+    const size_t newest = (next_sample_ + kHistorySize - 1) % kHistorySize;
+    if (timestamp_ns <= timestamps_[newest])
+      return false;
+  }
+
+  if (has_model_) {
+    // Reject samples far from any predicted vsync. Skipped vsyncs are fine.
+    const int64_t phase_error = std::abs(
+        timestamp_ns - anchor_ns_ -
+        DivideRounded(timestamp_ns - anchor_ns_, period_ns_) * period_ns_);
+    if (phase_error * 100 > period_ns_ * kOutlierTolerancePercent) {
+      ALOGW_IF(TRACE, "VsyncPredictor: Rejecting vsync at %" PRId64
+               " with phase error %" PRId64,
+               timestamp_ns, phase_error);
+      // Several outliers in a row mean the phase moved; start over.
+      if (++consecutive_outliers_ < kMaxConsecutiveOutliers)
+        return false;
+      Reset(nominal_period_ns_);
+    }
+  }
+  consecutive_outliers_ = 0;
+
+  timestamps_[next_sample_] = timestamp_ns;
+  next_sample_ = (next_sample_ + 1) % kHistorySize;
+  sample_count_ = std::min(sample_count_ + 1, kHistorySize);
+
+  UpdateModel();
+  return true;
+}
+
+void VsyncPredictor::UpdateModel() {
+  const size_t oldest = (next_sample_ + kHistorySize - sample_count_) %
+                        kHistorySize;
+  const int64_t origin = timestamps_[oldest];
+
+  if (!has_model_) {
+    // Until there is a model the newest sample is the best anchor.
+    const size_t newest = (next_sample_ + kHistorySize - 1) % kHistorySize;
+    anchor_ns_ = timestamps_[newest];
+  }
+  if (sample_count_ < kMinSamples)
+    return;
+
+  // Fit timestamp = intercept + period * ordinal, where the ordinal of each
+  // sample counts nominal periods from the oldest one. Times are relative to
+  // the oldest sample to keep the sums small.
+  double mean_x = 0.0;
+  double mean_y = 0.0;
+  std::array<double, kHistorySize> xs;
+  std::array<double, kHistorySize> ys;
+  for (size_t i = 0; i < sample_count_; ++i) {
+    const int64_t y = timestamps_[(oldest + i) % kHistorySize] - origin;
+    xs[i] = static_cast<double>(DivideRounded(y, nominal_period_ns_));
+    ys[i] = static_cast<double>(y);
+    mean_x += xs[i];
+    mean_y += ys[i];
+  }
+  mean_x /= sample_count_;
+  mean_y /= sample_count_;
+
+  double covariance = 0.0;
+  double variance = 0.0;
+  for (size_t i = 0; i < sample_count_; ++i) {
+    covariance += (xs[i] - mean_x) * (ys[i] - mean_y);
+    variance += (xs[i] - mean_x) * (xs[i] - mean_x);
+  }
+  if (variance == 0.0)
+    return;
+
+  const double period = covariance / variance;
+  if (std::abs(period - nominal_period_ns_) * 100 >
+      nominal_period_ns_ * kMaxPeriodErrorPercent) {
+    // The samples do not match the display mode; fall back to the nominal
+    // period until they do.
+    Reset(nominal_period_ns_);
+    return;
+  }
+
+  period_ns_ = std::llround(period);
+  anchor_ns_ = origin + std::llround(mean_y - period * mean_x);
+  has_model_ = true;
+}
+
+int64_t VsyncPredictor::NextVsyncAfter(int64_t time_ns) const {
+  return NextVsync(anchor_ns_, period_ns_, time_ns);
+}
+
+void VsyncPredictor::FillPrediction(DvrVsync* vsync) const {
+  if (!has_model_) {
+    vsync->predicted_period_ns = 0;
+    vsync->predicted_phase_ns = 0;
+    return;
+  }
+
+  // The model vsync closest to the published one.
+  const int64_t timestamp = static_cast<int64_t>(vsync->vsync_timestamp_ns);
+  const int64_t nearest = NextVsyncAfter(timestamp - period_ns_ / 2);
+  vsync->predicted_period_ns = static_cast<uint32_t>(period_ns_);
+  vsync->predicted_phase_ns = static_cast<int32_t>(nearest - timestamp);
+}
+
+int64_t PredictVsyncTimestamp(const DvrVsync& vsync, uint32_t vsyncs_ahead) {
+  const int64_t timestamp = static_cast<int64_t>(vsync.vsync_timestamp_ns);
+  if (vsync.predicted_period_ns == 0) {
+    return timestamp +
+           static_cast<int64_t>(vsync.vsync_period_ns) * vsyncs_ahead;
+  }
+  return timestamp + vsync.predicted_phase_ns +
+         static_cast<int64_t>(vsync.predicted_period_ns) * vsyncs_ahead;
+}
+
+int64_t PredictNextVsyncAfter(const DvrVsync& vsync, int64_t time_ns) {
+  const int64_t timestamp = static_cast<int64_t>(vsync.vsync_timestamp_ns);
+  if (vsync.predicted_period_ns == 0)
+    return NextVsync(timestamp, vsync.vsync_period_ns, time_ns);
+  return NextVsync(timestamp + vsync.predicted_phase_ns,
+                   vsync.predicted_period_ns, time_ns);
+}
+
+}  // namespace dvr
+}  // namespace android
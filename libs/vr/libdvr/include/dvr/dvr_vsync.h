@@ -23,8 +23,13 @@ typedef struct __attribute__((packed, aligned(16))) DvrVsync {
   // The period of a vsync in nanoseconds.
   uint32_t vsync_period_ns;
 
-  // Padding to 32 bytes so the size is a multiple of 16.
-  uint8_t padding[8];
+  // The vsync period measured from hardware vsync, or 0 if there is no
+  // measurement yet. Vsync n after this one is predicted at
+  // vsync_timestamp_ns + predicted_phase_ns + n * predicted_period_ns.
+  uint32_t predicted_period_ns;
+
+  // The offset of the measured vsync phase from vsync_timestamp_ns.
+  int32_t predicted_phase_ns;
 } DvrVsync;
 
 __END_DECLS
@@ -150,6 +150,30 @@ std::chrono::nanoseconds DeserializeTestRunner(
   return stop - start;
 }
 
+// Version of DeserializeTestRunner for StringWrapper/BufferWrapper types. The
+// value is serialized through a View wrapping it and deserialized into Output;
+// read-only views deserialize without copying the data out of the read buffer.
+// Wrappers have no comparison operators, so the contents are compared instead.
+template <typename View, typename Output, typename T>
+std::chrono::nanoseconds DeserializeWrapperTestRunner(
+    MessageReader* reader, MessageWriter* writer, size_t iterations,
+    ResetFunc* read_reset, ResetFunc* write_reset, void* reset_data,
+    const T& value) {
+  write_reset(reset_data);
+  Serialize(View(value.data(), value.size()), writer);
+  Output output_data;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    read_reset(reset_data);
+    Deserialize(&output_data, reader);
+  }
+  auto stop = std::chrono::high_resolution_clock::now();
+  if (!std::equal(output_data.begin(), output_data.end(), value.begin(),
+                  value.end()))
+    return start - stop;  // Return negative value to indicate error.
+  return stop - start;
+}
+
 // Special version of SerializeTestRunner that doesn't perform any serialization
 // but does all the same setup steps and moves data of size |data_size| into
 // the output buffer. Useful to determine the baseline to calculate time used
@@ -246,6 +270,17 @@ class TestRunner {
                         std::move(deserialize_test), data_size);
   }
 
+  template <typename View, typename Output = View, typename T>
+  void AddWrapperDeserializationTest(const std::string& name, const T& value) {
+    const size_t data_size =
+        GetSerializedSize(View(value.data(), value.size()));
+    auto deserialize_test =
+        std::bind(&DeserializeWrapperTestRunner<View, Output, T>, _1, _2, _3,
+                  _4, _5, _6, value);
+    tests_.emplace_back(name, std::function<SerializeTestSignature>{},
+                        std::move(deserialize_test), data_size);
+  }
+
   template <typename T>
   void AddTest(const std::string& name, T&& value) {
     const size_t data_size = GetSerializedSize(value);
@@ -439,6 +474,11 @@ int main(int /*argc*/, char** /*argv*/) {
   // deserialization only.
   test_runner.AddDeserializationTest(GenerateContainerName("string", 10240),
                                      std::string(10240, '*'));
+  for (size_t len : {0, 1, 8, 64, 256, 10240}) {
+    test_runner.AddWrapperDeserializationTest<StringWrapper<const char>>(
+        GenerateContainerName("StringWrapper<const char>", len),
+        std::string(len, '*'));
+  }
 
   for (size_t len : {0, 1, 8, 64, 256}) {
     std::vector<int32_t> int_vector(len);
@@ -476,8 +516,9 @@ int main(int /*argc*/, char** /*argv*/) {
         std::move(test_map));
   }
 
-  // BufferWrapper can't be used with deserialization tests right now because
-  // it requires external buffer to be filled in, which is not available.
+  // BufferWrapper<uint8_t*> can't be used with deserialization tests right now
+  // because it requires external buffer to be filled in, which is not
+  // available. The read-only view BufferWrapper<const uint8_t*> needs none.
   std::vector<std::vector<uint8_t>> data_buffers;
   for (size_t len : {0, 1, 8, 64, 256}) {
     data_buffers.emplace_back(len);
@@ -486,6 +527,15 @@ int main(int /*argc*/, char** /*argv*/) {
         BufferWrapper<uint8_t*>(data_buffers.back().data(),
                                 data_buffers.back().size()));
   }
+  for (size_t len : {0, 1, 8, 64, 256, 10240}) {
+    test_runner.AddWrapperDeserializationTest<
+        BufferWrapper<const uint8_t*>, BufferWrapper<std::vector<uint8_t>>>(
+        GenerateContainerName("BufferWrapper<vector<uint8_t>>", len),
+        std::vector<uint8_t>(len, 1));
+    test_runner.AddWrapperDeserializationTest<BufferWrapper<const uint8_t*>>(
+        GenerateContainerName("BufferWrapper<const uint8_t*>", len),
+        std::vector<uint8_t>(len, 1));
+  }
 
   // Various backing buffers to run the tests on.
   std::vector<TestRunner::BufferInfo> buffers;
@@ -13,6 +13,11 @@ namespace rpc {
 // Wrapper class for buffers, providing an interface suitable for
 // SerializeObject and DeserializeObject. This class supports serialization of
 // buffers as raw bytes.
+//
+// BufferWrapper<const T*> deserializes as a read-only view that points into the
+// read buffer instead of copying the data out of it. The view is only valid for
+// as long as the read buffer is; for RemoteMethod handler arguments that is the
+// duration of the call.
 template <typename T>
 class BufferWrapper;
 
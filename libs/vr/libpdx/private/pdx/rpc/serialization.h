@@ -125,6 +125,7 @@ enum class ErrorCode {
   GET_FILE_DESCRIPTOR_FAILED,
   GET_CHANNEL_HANDLE_FAILED,
   INVALID_VARIANT_ELEMENT,
+  UNALIGNED_VIEW,
 };
 
 // Type for errors returned by the deserialization code.
@@ -177,6 +178,8 @@ class ErrorType {
         return "INSUFFICIENT_BUFFER";
       case ErrorCode::INSUFFICIENT_DESTINATION_SIZE:
         return "INSUFFICIENT_DESTINATION_SIZE";
+      case ErrorCode::UNALIGNED_VIEW:
+        return "UNALIGNED_VIEW";
       default:
         return "[Unknown Error]";
     }
@@ -1397,11 +1400,17 @@ inline ErrorType DeserializeObject(BufferWrapper<std::vector<T, Allocator>>*,
 template <typename T>
 inline ErrorType DeserializeObject(BufferWrapper<T*>*, MessageReader*,
                                    const void*&, const void*&);
+template <typename T>
+inline ErrorType DeserializeObject(BufferWrapper<const T*>*, MessageReader*,
+                                   const void*&, const void*&);
 inline ErrorType DeserializeObject(std::string*, MessageReader*, const void*&,
                                    const void*&);
 template <typename T>
 inline ErrorType DeserializeObject(StringWrapper<T>*, MessageReader*,
                                    const void*&, const void*&);
+template <typename T>
+inline ErrorType DeserializeObject(StringWrapper<const T>*, MessageReader*,
+                                   const void*&, const void*&);
 template <typename T, typename U>
 inline ErrorType DeserializeObject(std::pair<T, U>*, MessageReader*,
                                    const void*&, const void*&);
@@ -1609,6 +1618,50 @@ inline ErrorType DeserializeObject(BufferWrapper<T*>* value,
   }
 }
 
+// Points a read-only view of size bytes at the next data in the read buffer,
+// instead of copying the data out of it. The view is only valid for as long as
+// the read buffer is; for RemoteMethod arguments that is the duration of the
+// handler call.
+template <typename T>
+inline ErrorType DeserializeView(const T** data, std::size_t size,
+                                 const void*& start, const void*& end) {
+  if (PDX_UNLIKELY(AdvancePointer(start, size) > end)) {
+    return ErrorCode::INSUFFICIENT_BUFFER;
+  } else if (reinterpret_cast<std::uintptr_t>(start) % alignof(T) != 0) {
+    return ErrorCode::UNALIGNED_VIEW;
+  }
+  *data = static_cast<const T*>(start);
+  start = AdvancePointer(start, size);
+  return ErrorCode::NO_ERROR;
+}
+
+// Overload of DeserializeObject() for read-only BufferWrapper types. These can
+// not be written to, so they are deserialized as a view of the payload in the
+// read buffer rather than a copy of it.
+template <typename T>
+inline ErrorType DeserializeObject(BufferWrapper<const T*>* value,
+                                   MessageReader* reader, const void*& start,
+                                   const void*& end) {
+  const auto value_type_size = sizeof(T);
+  EncodingType encoding;
+  std::size_t size;
+
+  if (const auto error =
+          DeserializeBinType(&encoding, &size, reader, start, end))
+    return error;
+
+  if (size % value_type_size != 0)
+    return ErrorCode::INSUFFICIENT_DESTINATION_SIZE;
+
+  const T* data = nullptr;
+  if (size != 0U) {
+    if (const auto error = DeserializeView(&data, size, start, end))
+      return error;
+  }
+  *value = BufferWrapper<const T*>(data, size / value_type_size);
+  return ErrorCode::NO_ERROR;
+}
+
 // Deserializes the type code and size for string types.
 inline ErrorType DeserializeStringType(EncodingType* encoding,
                                        std::size_t* size, MessageReader* reader,
@@ -1674,6 +1727,33 @@ inline ErrorType DeserializeObject(StringWrapper<T>* value,
   }
 }
 
+// Overload of DeserializeObject() for read-only StringWrapper types. Like
+// read-only BufferWrappers these are deserialized as a view of the payload in
+// the read buffer rather than a copy of it.
+template <typename T>
+inline ErrorType DeserializeObject(StringWrapper<const T>* value,
+                                   MessageReader* reader, const void*& start,
+                                   const void*& end) {
+  const auto value_type_size = sizeof(T);
+  EncodingType encoding;
+  std::size_t size;
+
+  if (const auto error =
+          DeserializeStringType(&encoding, &size, reader, start, end))
+    return error;
+
+  if (size % value_type_size != 0)
+    return ErrorCode::INSUFFICIENT_DESTINATION_SIZE;
+
+  const T* data = nullptr;
+  if (size != 0U) {
+    if (const auto error = DeserializeView(&data, size, start, end))
+      return error;
+  }
+  *value = StringWrapper<const T>(data, size / value_type_size);
+  return ErrorCode::NO_ERROR;
+}
+
 // Deserializes the type code and size of array types.
 inline ErrorType DeserializeArrayType(EncodingType* encoding, std::size_t* size,
                                       MessageReader* reader, const void*& start,
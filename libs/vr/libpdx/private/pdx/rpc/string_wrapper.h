@@ -16,6 +16,10 @@ namespace rpc {
 // during serialization and deserialization. This substitution makes handling of
 // C strings more efficient by avoiding unnecessary copies when remote method
 // signatures specify std::basic_string arguments or return values.
+//
+// StringWrapper<const CharT> deserializes as a read-only view that points into
+// the read buffer instead of copying the string out of it. The view is only
+// valid for as long as the read buffer is.
 template <typename CharT = std::string::value_type,
           typename Traits = std::char_traits<CharT>>
 class StringWrapper {
@@ -1991,6 +1991,79 @@ TEST(DeserializationTest, string) {
   EXPECT_EQ(std::string(0x10000, 'x'), result);
 }
 
+TEST(DeserializationTest, StringWrapperView) {
+  Payload buffer;
+  StringWrapper<const char> result;
+  ErrorType error;
+
+  // Min FIXSTR.
+  buffer = {ENCODING_TYPE_FIXSTR_MIN};
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(0u, result.length());
+
+  // The view points straight into the payload.
+  buffer = {ENCODING_TYPE_STR8, 0xff};
+  buffer.Append(0xff, 'x');
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(std::string(0xff, 'x'), std::string(result.begin(), result.end()));
+  EXPECT_EQ(reinterpret_cast<const char*>(buffer.Data() + 2), result.data());
+
+  // Truncated payload.
+  buffer = {ENCODING_TYPE_STR8, 0xff};
+  buffer.Append(0x10, 'x');
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::INSUFFICIENT_BUFFER, error);
+}
+
+TEST(DeserializationTest, BufferWrapperView) {
+  Payload buffer;
+  BufferWrapper<const std::uint8_t*> result;
+  ErrorType error;
+
+  // Min BIN8.
+  buffer = {ENCODING_TYPE_BIN8, 0x00};
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(0u, result.size());
+
+  // The view points straight into the payload.
+  buffer = {ENCODING_TYPE_BIN16, 0x00, 0x01};
+  buffer.Append(0x100, 1);
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(0x100u, result.size());
+  EXPECT_EQ(buffer.Data() + 3, result.data());
+  EXPECT_EQ(std::vector<std::uint8_t>(0x100, 1),
+            std::vector<std::uint8_t>(result.begin(), result.end()));
+
+  // Truncated payload.
+  buffer = {ENCODING_TYPE_BIN8, 0xff};
+  buffer.Append(0x10, 1);
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::INSUFFICIENT_BUFFER, error);
+}
+
+TEST(DeserializationTest, BufferWrapperViewAlignment) {
+  Payload buffer;
+  BufferWrapper<const std::uint32_t*> result;
+  ErrorType error;
+
+  // The BIN8 header is two bytes, so the data can't be 4-byte aligned if the
+  // payload is.
+  buffer = {ENCODING_TYPE_BIN8, 0x08};
+  buffer.Append(8, 1);
+  ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(buffer.Data()) % 4);
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::UNALIGNED_VIEW, error);
+
+  // Wrong element size.
+  buffer = {ENCODING_TYPE_BIN8, 0x03, 1, 1, 1};
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::INSUFFICIENT_DESTINATION_SIZE, error);
+}
+
 TEST(DeserializationTest, vector) {
   Payload buffer;
   std::vector<std::uint8_t, DefaultInitializationAllocator<std::uint8_t>>
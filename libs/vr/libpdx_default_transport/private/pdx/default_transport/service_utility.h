@@ -3,6 +3,15 @@
 
 #include <ftw.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <pdx/client.h>
 #include <pdx/default_transport/client_channel_factory.h>
 #include <pdx/service.h>
@@ -28,14 +37,68 @@ class ServiceUtility : public ClientBase<ServiceUtility> {
   }
 
   // Traverses the PDX service path space and sends a message to reload system
-  // properties to each service endpoint it finds along the way.
+  // properties to each service endpoint it finds along the way. The services
+  // are poked concurrently, so that a slow service does not hold up the rest;
+  // services that have not replied within kPokeTimeout are given up on.
   // NOTE: This method is used by atrace to poke PDX services. Please avoid
   // unnecessary changes to this mechanism to minimize impact on atrace.
   static bool PokeServices() {
     const int kMaxDepth = 16;
+    std::vector<std::string> endpoints;
+    endpoints_ = &endpoints;
     const int result =
-        nftw(GetRootEndpointPath().c_str(), PokeService, kMaxDepth, FTW_PHYS);
-    return result == 0 ? true : false;
+        nftw(GetRootEndpointPath().c_str(), FindEndpoint, kMaxDepth, FTW_PHYS);
+    endpoints_ = nullptr;
+    if (result != 0)
+      return false;
+
+    // Shared with the poking threads, which outlive this call if a service
+    // does not reply in time.
+    struct PokeState {
+      std::mutex mutex;
+      std::condition_variable done;
+      size_t remaining;
+      std::vector<std::optional<std::chrono::steady_clock::duration>> latencies;
+    };
+    auto state = std::make_shared<PokeState>();
+    state->remaining = endpoints.size();
+    state->latencies.resize(endpoints.size());
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+      std::thread([state, start, i, path = endpoints[i]] {
+        PokeService(path);
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->latencies[i] = std::chrono::steady_clock::now() - start;
+        if (--state->remaining == 0)
+          state->done.notify_one();
+      }).detach();
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait_until(lock, start + kPokeTimeout,
+                           [&state] { return state->remaining == 0; });
+
+    std::string slow;
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+      const auto& latency = state->latencies[i];
+      if (latency && *latency < kSlowPokeLatency)
+        continue;
+      slow += slow.empty() ? " " : ", ";
+      slow += endpoints[i];
+      if (latency) {
+        const auto ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(*latency);
+        slow += " (" + std::to_string(ms.count()) + " ms)";
+      } else {
+        slow += " (no reply)";
+      }
+    }
+    if (!slow.empty()) {
+      ALOGW("ServiceUtility::PokeServices: Slow to reload properties:%s",
+            slow.c_str());
+    }
+    return true;
   }
 
  private:
@@ -48,37 +111,41 @@ class ServiceUtility : public ClientBase<ServiceUtility> {
       *error = Client::error();
   }
 
-  // Sends the sysprop_change message to the service at fpath, so it re-reads
-  // its system properties. Returns 0 on success or a negated errno code on
-  // failure.
+  static constexpr std::chrono::milliseconds kPokeTimeout{1000};
+  static constexpr std::chrono::milliseconds kSlowPokeLatency{100};
+
+  // Endpoints collected by FindEndpoint during the nftw call in PokeServices.
+  static inline thread_local std::vector<std::string>* endpoints_ = nullptr;
+
+  static int FindEndpoint(const char* fpath, const struct stat* /*sb*/,
+                          int typeflag, struct FTW* /*ftwbuf*/) {
+    if (typeflag == FTW_F)
+      endpoints_->push_back(fpath);
+    return 0;
+  }
+
+  // Sends the sysprop_change message to the service at path, so it re-reads
+  // its system properties. Errors are logged and otherwise ignored.
   // NOTE: This method is used by atrace to poke PDX services. Please avoid
   // unnecessary changes to this mechanism to minimize impact on atrace.
-  static int PokeService(const char* fpath, const struct stat* /*sb*/,
-                         int typeflag, struct FTW* /*ftwbuf*/) {
-    const bool kIgnoreErrors = true;
-
-    if (typeflag == FTW_F) {
-      int error;
-      auto utility = ServiceUtility::Create(fpath, &error);
-      if (!utility) {
-        if (error != -ECONNREFUSED) {
-          ALOGE("ServiceUtility::PokeService: Failed to open %s: %s.", fpath,
-                strerror(-error));
-        }
-        return kIgnoreErrors ? 0 : error;
-      }
-
-      auto status = utility->ReloadSystemProperties();
-      if (!status) {
-        ALOGE(
-            "ServiceUtility::PokeService: Failed to send sysprop change to %s: "
-            "%s",
-            fpath, status.GetErrorMessage().c_str());
-        return kIgnoreErrors ? 0 : -status.error();
+  static void PokeService(const std::string& path) {
+    int error;
+    auto utility = ServiceUtility::Create(path, &error);
+    if (!utility) {
+      if (error != -ECONNREFUSED) {
+        ALOGE("ServiceUtility::PokeService: Failed to open %s: %s.",
+              path.c_str(), strerror(-error));
       }
+      return;
     }
 
-    return 0;
+    auto status = utility->ReloadSystemProperties();
+    if (!status) {
+      ALOGE(
+          "ServiceUtility::PokeService: Failed to send sysprop change to %s: "
+          "%s",
+          path.c_str(), status.GetErrorMessage().c_str());
+    }
   }
 
   ServiceUtility(const ServiceUtility&) = delete;
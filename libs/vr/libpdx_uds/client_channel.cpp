@@ -89,26 +89,53 @@ Status<void> ReadAndDiscardData(const BorrowedHandle& socket_fd, size_t size) {
 Status<void> SendRequest(const BorrowedHandle& socket_fd,
                          TransactionState* transaction_state, int opcode,
                          const iovec* send_vector, size_t send_count,
-                         size_t max_recv_len) {
+                         size_t max_recv_len, SharedMemoryArea* shared_memory,
+                         bool shared_memory_accepted) {
+  auto& request = transaction_state->request;
   size_t send_len = CountVectorSize(send_vector, send_count);
-  InitRequest(&transaction_state->request, opcode, send_len, max_recv_len,
-              false);
-  if (send_len == 0) {
+  InitRequest(&request, opcode, send_len, max_recv_len, false);
+  request.shared_memory = BorrowedHandle{};
+  request.send_in_shared_memory = false;
+  request.recv_in_shared_memory = false;
+  if (shared_memory && !shared_memory_accepted) {
+    request.shared_memory = shared_memory->fd().Borrow();
+  } else if (shared_memory) {
+    request.recv_in_shared_memory = true;
+    if (send_len > 0 && send_len <= shared_memory->size()) {
+      shared_memory->Write(send_vector, send_count);
+      request.send_in_shared_memory = true;
+    }
+  }
+  if (send_len == 0 || request.send_in_shared_memory) {
     send_vector = nullptr;
     send_count = 0;
   }
-  return SendData(socket_fd, transaction_state->request, send_vector,
-                  send_count);
+  return SendData(socket_fd, request, send_vector, send_count);
 }
 
 Status<void> ReceiveResponse(const BorrowedHandle& socket_fd,
                              TransactionState* transaction_state,
                              const iovec* receive_vector, size_t receive_count,
-                             size_t max_recv_len) {
+                             size_t max_recv_len,
+                             const SharedMemoryArea* shared_memory) {
   auto status = ReceiveData(socket_fd, &transaction_state->response);
   if (!status)
     return status;
 
+  if (transaction_state->response.recv_in_shared_memory) {
+    // The payload was copied into the shared memory area by the service and
+    // nothing follows the header in the socket stream.
+    const size_t recv_len = transaction_state->response.recv_len;
+    if (!shared_memory || recv_len > shared_memory->size())
+      return ErrorStatus(EIO);
+    if (shared_memory->Read(receive_vector, receive_count, recv_len) !=
+        recv_len) {
+      // Same as ReadAndDiscardData(): the caller did not provide enough room.
+      return ErrorStatus(EIO);
+    }
+    return status;
+  }
+
   if (transaction_state->response.recv_len > 0) {
     std::vector<iovec> read_buffers;
     size_t size_remaining = 0;
@@ -192,10 +219,21 @@ Status<int> ClientChannel::SendAndReceive(void* transaction_state, int opcode,
   size_t max_recv_len = CountVectorSize(receive_vector, receive_count);
 
   auto status = SendRequest(BorrowedHandle{channel_handle_.value()}, state,
-                            opcode, send_vector, send_count, max_recv_len);
+                            opcode, send_vector, send_count, max_recv_len,
+                            shared_memory_.get(), shared_memory_accepted_);
   if (status) {
     status = ReceiveResponse(BorrowedHandle{channel_handle_.value()}, state,
-                             receive_vector, receive_count, max_recv_len);
+                             receive_vector, receive_count, max_recv_len,
+                             shared_memory_.get());
+  }
+  if (status && shared_memory_ && !shared_memory_accepted_) {
+    shared_memory_accepted_ = state->response.shared_memory_accepted;
+    if (!shared_memory_accepted_) {
+      ALOGW(
+          "ClientChannel::SendAndReceive: Service declined the shared memory "
+          "area, falling back to the socket");
+      shared_memory_.reset();
+    }
   }
   if (!result.PropagateError(status)) {
     const int return_code = state->response.ret_code;
@@ -293,6 +331,24 @@ bool ClientChannel::GetChannelHandle(void* transaction_state,
   return state->GetLocalChannelHandle(ref, handle);
 }
 
+Status<void> ClientChannel::EnableSharedMemory(size_t size) {
+  std::unique_lock<std::mutex> lock(socket_mutex_);
+  if (shared_memory_)
+    return ErrorStatus(EALREADY);
+
+  auto status = SharedMemoryArea::Create(size);
+  if (!status)
+    return status.error_status();
+  shared_memory_ = status.take();
+  shared_memory_accepted_ = false;
+  return {};
+}
+
+bool ClientChannel::IsSharedMemoryActive() {
+  std::unique_lock<std::mutex> lock(socket_mutex_);
+  return shared_memory_ && shared_memory_accepted_;
+}
+
 std::unique_ptr<pdx::ChannelParcelable> ClientChannel::TakeChannelParcelable()
     {
   if (!channel_handle_)
@@ -0,0 +1,133 @@
+#include <uds/client_channel.h>
+
+#include <sys/socket.h>
+
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <pdx/client.h>
+#include <pdx/service.h>
+#include <pdx/service_dispatcher.h>
+
+#include <uds/client_channel_factory.h>
+#include <uds/service_endpoint.h>
+
+using android::pdx::ClientBase;
+using android::pdx::LocalHandle;
+using android::pdx::Message;
+using android::pdx::ServiceBase;
+using android::pdx::ServiceDispatcher;
+using android::pdx::Status;
+using android::pdx::Transaction;
+using android::pdx::uds::ClientChannel;
+using android::pdx::uds::ClientChannelFactory;
+using android::pdx::uds::Endpoint;
+
+namespace {
+
+constexpr int kOpEcho = 0;
+
+class EchoService : public ServiceBase<EchoService> {
+ public:
+  explicit EchoService(std::unique_ptr<Endpoint> endpoint)
+      : ServiceBase{"EchoService", std::move(endpoint)} {}
+
+  Status<void> HandleMessage(Message& message) override {
+    if (message.GetOp() != kOpEcho)
+      return Service::HandleMessage(message);
+
+    buffer_.resize(message.GetSendLength());
+    auto status = message.Read(buffer_.data(), buffer_.size());
+    if (status)
+      status = message.Write(buffer_.data(), status.get());
+    return message.Reply(status ? static_cast<int>(status.get())
+                                : -status.error());
+  }
+
+ private:
+  // Only touched from the single dispatch thread.
+  std::vector<uint8_t> buffer_;
+};
+
+class EchoClient : public ClientBase<EchoClient> {
+ public:
+  using ClientBase::ClientBase;
+
+  Status<int> Echo(const std::vector<uint8_t>& data,
+                   std::vector<uint8_t>* reply) {
+    Transaction trans{*this};
+    return trans.Send<int>(kOpEcho, data.data(), data.size(), reply->data(),
+                           reply->size());
+  }
+
+  ClientChannel* GetUdsChannel() const {
+    return static_cast<ClientChannel*>(GetChannel());
+  }
+};
+
+// Connects an EchoClient to an EchoService running on its own dispatch thread
+// over a socket pair, optionally with a shared memory area on the channel.
+class EchoFixture {
+ public:
+  explicit EchoFixture(size_t shared_memory_size) {
+    int channel_sockets[2] = {};
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channel_sockets);
+
+    auto endpoint = Endpoint::CreateFromSocketFd(LocalHandle{});
+    endpoint->RegisterNewChannelForTests(LocalHandle{channel_sockets[0]});
+    service_ = EchoService::Create(std::move(endpoint));
+    dispatcher_ = ServiceDispatcher::Create();
+    dispatcher_->AddService(service_);
+    dispatch_thread_ = std::thread(
+        std::bind(&ServiceDispatcher::EnterDispatchLoop, dispatcher_.get()));
+
+    auto factory =
+        ClientChannelFactory::Create(LocalHandle{channel_sockets[1]});
+    auto status = factory->Connect(android::pdx::Client::kInfiniteTimeout);
+    client_ = EchoClient::Create(status.take());
+    if (shared_memory_size > 0)
+      client_->GetUdsChannel()->EnableSharedMemory(shared_memory_size);
+  }
+
+  ~EchoFixture() {
+    dispatcher_->SetCanceled(true);
+    dispatch_thread_.join();
+    dispatcher_->RemoveService(service_);
+  }
+
+  EchoClient* client() const { return client_.get(); }
+
+ private:
+  std::shared_ptr<EchoService> service_;
+  std::unique_ptr<ServiceDispatcher> dispatcher_;
+  std::thread dispatch_thread_;
+  std::shared_ptr<EchoClient> client_;
+};
+
+void RunEcho(benchmark::State& state, size_t shared_memory_size) {
+  EchoFixture fixture{shared_memory_size};
+  std::vector<uint8_t> data(state.range(0), 0x5a);
+  std::vector<uint8_t> reply(data.size());
+  for (auto _ : state) {
+    auto status = fixture.client()->Echo(data, &reply);
+    if (!status) {
+      state.SkipWithError("Echo transaction failed");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * data.size() * 2);
+}
+
+void BM_EchoSocket(benchmark::State& state) { RunEcho(state, 0); }
+BENCHMARK(BM_EchoSocket)->RangeMultiplier(8)->Range(64, 256 * 1024);
+
+void BM_EchoSharedMemory(benchmark::State& state) {
+  RunEcho(state, 256 * 1024);
+}
+BENCHMARK(BM_EchoSharedMemory)->RangeMultiplier(8)->Range(64, 256 * 1024);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -1,5 +1,6 @@
 #include <uds/client_channel.h>
 
+#include <sys/mman.h>
 #include <sys/socket.h>
 
 #include <algorithm>
@@ -17,6 +18,7 @@
 
 #include <uds/client_channel_factory.h>
 #include <uds/service_endpoint.h>
+#include <uds/shared_memory_area.h>
 
 using testing::Return;
 using testing::_;
@@ -28,10 +30,12 @@ using android::pdx::Message;
 using android::pdx::ServiceBase;
 using android::pdx::ServiceDispatcher;
 using android::pdx::Status;
+using android::pdx::Transaction;
 using android::pdx::rpc::DispatchRemoteMethod;
 using android::pdx::uds::ClientChannel;
 using android::pdx::uds::ClientChannelFactory;
 using android::pdx::uds::Endpoint;
+using android::pdx::uds::SharedMemoryArea;
 
 namespace {
 
@@ -39,6 +43,7 @@ struct TestProtocol {
   using DataType = int8_t;
   enum {
     kOpSum = 0,
+    kOpEcho,
   };
   PDX_REMOTE_METHOD(Sum, kOpSum, int64_t(const std::vector<DataType>&));
 };
@@ -55,6 +60,9 @@ class TestService : public ServiceBase<TestService> {
                                                 message);
         return {};
 
+      case TestProtocol::kOpEcho:
+        return OnEcho(message);
+
       default:
         return Service::HandleMessage(message);
     }
@@ -64,6 +72,16 @@ class TestService : public ServiceBase<TestService> {
                 const std::vector<TestProtocol::DataType>& data) {
     return std::accumulate(data.begin(), data.end(), int64_t{0});
   }
+
+  // Raw echo, not limited by the remote method buffer capacity.
+  Status<void> OnEcho(Message& message) {
+    std::vector<uint8_t> data(message.GetSendLength());
+    auto status = message.Read(data.data(), data.size());
+    if (status)
+      status = message.Write(data.data(), status.get());
+    return message.Reply(status ? static_cast<int>(status.get())
+                                : -status.error());
+  }
 };
 
 class TestClient : public ClientBase<TestClient> {
@@ -74,6 +92,19 @@ class TestClient : public ClientBase<TestClient> {
     auto status = InvokeRemoteMethod<TestProtocol::Sum>(data);
     return status ? status.get() : -1;
   }
+
+  std::vector<uint8_t> Echo(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> reply(data.size());
+    Transaction trans{*this};
+    auto status = trans.Send<int>(TestProtocol::kOpEcho, data.data(),
+                                  data.size(), reply.data(), reply.size());
+    reply.resize(status ? status.get() : 0);
+    return reply;
+  }
+
+  ClientChannel* GetUdsChannel() const {
+    return static_cast<ClientChannel*>(GetChannel());
+  }
 };
 
 class TestServiceRunner {
@@ -160,4 +191,73 @@ TEST_F(ClientChannelTest, MultithreadedClient) {
     thread.join();
 }
 
+TEST_F(ClientChannelTest, SharedMemory) {
+  constexpr size_t kAreaSize = 4096;
+  ClientChannel* channel = client_->GetUdsChannel();
+  ASSERT_TRUE(channel->EnableSharedMemory(kAreaSize));
+  EXPECT_EQ(EALREADY, channel->EnableSharedMemory(kAreaSize).error());
+  EXPECT_FALSE(channel->IsSharedMemoryActive());
+
+  // The first transaction offers the area to the service.
+  std::vector<TestProtocol::DataType> values(100, 3);
+  EXPECT_EQ(300, client_->Sum(values));
+  EXPECT_TRUE(channel->IsSharedMemoryActive());
+  EXPECT_EQ(300, client_->Sum(values));
+
+  std::vector<uint8_t> data(kAreaSize);
+  std::iota(data.begin(), data.end(), 0);
+  EXPECT_EQ(data, client_->Echo(data));
+
+  // Payloads larger than the area still go over the socket.
+  std::vector<uint8_t> large_data(kAreaSize * 4);
+  std::iota(large_data.begin(), large_data.end(), 7);
+  EXPECT_EQ(large_data, client_->Echo(large_data));
+  EXPECT_EQ(data, client_->Echo(data));
+  EXPECT_TRUE(channel->IsSharedMemoryActive());
+}
+
+TEST_F(ClientChannelTest, SharedMemoryMultithreadedClient) {
+  constexpr int kNumTestThreads = 8;
+  constexpr int kMaxIterations = 500;
+  ASSERT_TRUE(client_->GetUdsChannel()->EnableSharedMemory(4096));
+
+  auto worker = [](std::shared_ptr<TestClient> client,
+                   std::vector<uint8_t> data) {
+    for (int i = 0; i < kMaxIterations; i++) {
+      ASSERT_EQ(data, client->Echo(data));
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumTestThreads; i++) {
+    std::vector<uint8_t> data(1000, i);
+    threads.emplace_back(worker, client_, std::move(data));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_TRUE(client_->GetUdsChannel()->IsSharedMemoryActive());
+}
+
+TEST(SharedMemoryAreaTest, ImportRequiresSealedMemfd) {
+  LocalHandle fd{memfd_create("test", MFD_CLOEXEC)};
+  ASSERT_TRUE(fd);
+  ASSERT_EQ(0, ftruncate(fd.Get(), 4096));
+  EXPECT_EQ(EINVAL, SharedMemoryArea::Import(std::move(fd)).error());
+
+  auto area = SharedMemoryArea::Create(100);
+  ASSERT_TRUE(area);
+  EXPECT_EQ(static_cast<size_t>(sysconf(_SC_PAGESIZE)), area.get()->size());
+  auto imported = SharedMemoryArea::Import(area.get()->fd().Duplicate());
+  ASSERT_TRUE(imported);
+
+  const char kData[] = "shared";
+  area.get()->Write(kData, sizeof(kData));
+  char buffer[sizeof(kData)] = {};
+  imported.get()->Read(buffer, sizeof(buffer));
+  EXPECT_STREQ(kData, buffer);
+
+  EXPECT_EQ(EINVAL, SharedMemoryArea::Create(SharedMemoryArea::kMaxSize + 1)
+                        .error());
+}
+
 }  // namespace
@@ -8,6 +8,7 @@
 #include <uds/channel_event_set.h>
 #include <uds/channel_manager.h>
 #include <uds/service_endpoint.h>
+#include <uds/shared_memory_area.h>
 
 namespace android {
 namespace pdx {
@@ -79,6 +80,13 @@ class ClientChannel : public pdx::ClientChannel {
 
   std::unique_ptr<pdx::ChannelParcelable> TakeChannelParcelable() override;
 
+  // Sets up a shared memory area of |size| bytes for this channel. The area is
+  // offered to the service with the next transaction; once accepted, request
+  // and response payloads that fit in the area skip the socket. Returns
+  // EALREADY if the channel already has an area.
+  Status<void> EnableSharedMemory(size_t size);
+  bool IsSharedMemoryActive();
+
  private:
   explicit ClientChannel(LocalChannelHandle channel_handle);
 
@@ -89,6 +97,8 @@ class ClientChannel : public pdx::ClientChannel {
   LocalChannelHandle channel_handle_;
   ChannelEventReceiver* channel_data_;
   std::mutex socket_mutex_;
+  std::unique_ptr<SharedMemoryArea> shared_memory_;
+  bool shared_memory_accepted_{false};
 };
 
 }  // namespace uds
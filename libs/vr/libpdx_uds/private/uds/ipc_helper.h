@@ -139,11 +139,18 @@ class RequestHeader {
   std::vector<ChannelInfo<FileHandleType>> channels;
   std::array<uint8_t, 32> impulse_payload;
   bool is_impulse{false};
+  // Shared memory area offered to the service, see SharedMemoryArea.
+  FileHandleType shared_memory;
+  // The request payload is in the shared memory area instead of the socket.
+  bool send_in_shared_memory{false};
+  // The service may return the response payload in the shared memory area.
+  bool recv_in_shared_memory{false};
 
  private:
   PDX_SERIALIZABLE_MEMBERS(RequestHeader, op, send_len, max_recv_len,
                            file_descriptors, channels, impulse_payload,
-                           is_impulse);
+                           is_impulse, shared_memory, send_in_shared_memory,
+                           recv_in_shared_memory);
 };
 
 template <typename FileHandleType>
@@ -153,10 +160,15 @@ class ResponseHeader {
   uint32_t recv_len{0};
   std::vector<FileHandleType> file_descriptors;
   std::vector<ChannelInfo<FileHandleType>> channels;
+  // The service mapped the shared memory area offered with the request.
+  bool shared_memory_accepted{false};
+  // The response payload is in the shared memory area instead of the socket.
+  bool recv_in_shared_memory{false};
 
  private:
   PDX_SERIALIZABLE_MEMBERS(ResponseHeader, ret_code, recv_len, file_descriptors,
-                           channels);
+                           channels, shared_memory_accepted,
+                           recv_in_shared_memory);
 };
 
 template <typename T>
@@ -13,6 +13,7 @@
 #include <pdx/service.h>
 #include <pdx/service_endpoint.h>
 #include <uds/channel_event_set.h>
+#include <uds/shared_memory_area.h>
 
 namespace android {
 namespace pdx {
@@ -112,6 +113,9 @@ class Endpoint : public pdx::Endpoint {
     LocalHandle data_fd;
     ChannelEventSet event_set;
     Channel* channel_state{nullptr};
+    // Shared by in-flight messages so that replacing or closing the channel
+    // does not unmap the area from under a pending reply.
+    std::shared_ptr<SharedMemoryArea> shared_memory;
   };
 
   // This class must be instantiated using Create() static methods above.
@@ -143,6 +147,8 @@ class Endpoint : public pdx::Endpoint {
   Status<std::pair<BorrowedHandle, BorrowedHandle>> GetChannelEventFd(
       int32_t channel_id);
   int32_t GetChannelId(const BorrowedHandle& channel_fd);
+  std::shared_ptr<SharedMemoryArea> UpdateChannelSharedMemory(
+      int32_t channel_id, std::shared_ptr<SharedMemoryArea> shared_memory);
   Status<void> CreateChannelSocketPair(LocalHandle* local_socket,
                                        LocalHandle* remote_socket);
 
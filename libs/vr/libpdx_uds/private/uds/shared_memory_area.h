@@ -0,0 +1,67 @@
+#ifndef ANDROID_PDX_UDS_SHARED_MEMORY_AREA_H_
+#define ANDROID_PDX_UDS_SHARED_MEMORY_AREA_H_
+
+#include <sys/uio.h>
+
+#include <memory>
+
+#include <pdx/file_handle.h>
+#include <pdx/status.h>
+
+namespace android {
+namespace pdx {
+namespace uds {
+
+// A fixed-size memfd mapping shared by a client channel and the service
+// endpoint at the other end of its socket. The client creates and seals the
+// area and offers its fd along with a regular request; once the service accepts
+// it, request and response payloads that fit are copied through the mapping
+// instead of the socket. Headers, credentials, file descriptors, channels and
+// the channel lifecycle still go over the socket, which also provides the
+// wakeup for the other side.
+//
+// The channel only ever has one transaction in flight, so a single area serves
+// both directions: the service copies the request out before the reply is
+// written back.
+class SharedMemoryArea {
+ public:
+  static constexpr size_t kMaxSize = 1024 * 1024;
+
+  ~SharedMemoryArea();
+
+  // Creates a sealed area of |size| bytes, rounded up to the page size.
+  static Status<std::unique_ptr<SharedMemoryArea>> Create(size_t size);
+
+  // Maps an area offered by a client. The fd must be a memfd sealed against
+  // shrinking so that the client cannot truncate the mapping from under the
+  // service.
+  static Status<std::unique_ptr<SharedMemoryArea>> Import(LocalHandle fd);
+
+  size_t size() const { return size_; }
+  const LocalHandle& fd() const { return fd_; }
+
+  // Gathers |vector| into the area. The caller must make sure the data fits.
+  void Write(const iovec* vector, size_t vector_length);
+  void Write(const void* data, size_t size);
+
+  // Copies up to |size| bytes out of the area into |vector| and returns the
+  // number of bytes copied.
+  size_t Read(const iovec* vector, size_t vector_length, size_t size) const;
+  void Read(void* data, size_t size) const;
+
+ private:
+  SharedMemoryArea(LocalHandle fd, void* data, size_t size);
+
+  SharedMemoryArea(const SharedMemoryArea&) = delete;
+  void operator=(const SharedMemoryArea&) = delete;
+
+  LocalHandle fd_;
+  uint8_t* data_;
+  size_t size_;
+};
+
+}  // namespace uds
+}  // namespace pdx
+}  // namespace android
+
+#endif  // ANDROID_PDX_UDS_SHARED_MEMORY_AREA_H_
@@ -30,6 +30,7 @@ using android::pdx::LocalHandle;
 using android::pdx::Status;
 using android::pdx::uds::ChannelInfo;
 using android::pdx::uds::ChannelManager;
+using android::pdx::uds::SharedMemoryArea;
 
 struct MessageState {
   bool GetLocalFileHandle(int index, LocalHandle* handle) {
@@ -123,6 +124,7 @@ struct MessageState {
   std::vector<uint8_t> request_data;
   size_t request_data_read_pos{0};
   std::vector<uint8_t> response_data;
+  std::shared_ptr<SharedMemoryArea> shared_memory;
 };
 
 }  // anonymous namespace
@@ -494,6 +496,17 @@ int32_t Endpoint::GetChannelId(const BorrowedHandle& channel_fd) {
   return (iter != channel_fd_to_id_.end()) ? iter->second : -1;
 }
 
+std::shared_ptr<SharedMemoryArea> Endpoint::UpdateChannelSharedMemory(
+    int32_t channel_id, std::shared_ptr<SharedMemoryArea> shared_memory) {
+  std::lock_guard<std::mutex> autolock(channel_mutex_);
+  auto channel_data = channels_.find(channel_id);
+  if (channel_data == channels_.end())
+    return nullptr;
+  if (shared_memory)
+    channel_data->second.shared_memory = std::move(shared_memory);
+  return channel_data->second.shared_memory;
+}
+
 Status<void> Endpoint::ReceiveMessageForChannel(
     const BorrowedHandle& channel_fd, Message* message) {
   RequestHeader<LocalHandle> request;
@@ -535,10 +548,30 @@ Status<void> Endpoint::ReceiveMessageForChannel(
   *message = Message{info};
   auto* state = static_cast<MessageState*>(message->GetState());
   state->request = std::move(request);
+  if (!state->request.is_impulse) {
+    std::shared_ptr<SharedMemoryArea> offered_area;
+    if (state->request.shared_memory) {
+      auto import_status =
+          SharedMemoryArea::Import(std::move(state->request.shared_memory));
+      if (import_status)
+        offered_area = import_status.take();
+      state->response.shared_memory_accepted = !!offered_area;
+    }
+    state->shared_memory =
+        UpdateChannelSharedMemory(channel_id, std::move(offered_area));
+  }
   if (state->request.send_len > 0 && !state->request.is_impulse) {
     state->request_data.resize(state->request.send_len);
-    status = ReceiveData(channel_fd, state->request_data.data(),
-                         state->request_data.size());
+    if (!state->request.send_in_shared_memory) {
+      status = ReceiveData(channel_fd, state->request_data.data(),
+                           state->request_data.size());
+    } else if (state->shared_memory &&
+               state->request_data.size() <= state->shared_memory->size()) {
+      state->shared_memory->Read(state->request_data.data(),
+                                 state->request_data.size());
+    } else {
+      status.SetError(EIO);
+    }
   }
 
   if (status && state->request.is_impulse)
@@ -645,8 +678,18 @@ Status<void> Endpoint::MessageReply(Message* message, int return_code) {
 
   state->response.ret_code = return_code;
   state->response.recv_len = state->response_data.size();
+  state->response.recv_in_shared_memory =
+      state->shared_memory && !state->response_data.empty() &&
+      state->response_data.size() <= state->shared_memory->size() &&
+      (state->request.recv_in_shared_memory ||
+       state->response.shared_memory_accepted);
+  if (state->response.recv_in_shared_memory) {
+    state->shared_memory->Write(state->response_data.data(),
+                                state->response_data.size());
+  }
   auto status = SendData(channel_socket, state->response);
-  if (status && !state->response_data.empty()) {
+  if (status && !state->response_data.empty() &&
+      !state->response.recv_in_shared_memory) {
     status = SendData(channel_socket, state->response_data.data(),
                       state->response_data.size());
   }
@@ -0,0 +1,119 @@
+#include "uds/shared_memory_area.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace android {
+namespace pdx {
+namespace uds {
+
+namespace {
+
+constexpr int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_SEAL;
+
+Status<void*> MapArea(const LocalHandle& fd, size_t size) {
+  void* data =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.Get(), 0);
+  if (data == MAP_FAILED) {
+    ALOGE("SharedMemoryArea: Failed to map %zu bytes: %s", size,
+          strerror(errno));
+    return ErrorStatus(errno);
+  }
+  return data;
+}
+
+}  // anonymous namespace
+
+SharedMemoryArea::SharedMemoryArea(LocalHandle fd, void* data, size_t size)
+    : fd_{std::move(fd)}, data_{static_cast<uint8_t*>(data)}, size_{size} {}
+
+SharedMemoryArea::~SharedMemoryArea() { munmap(data_, size_); }
+
+Status<std::unique_ptr<SharedMemoryArea>> SharedMemoryArea::Create(
+    size_t size) {
+  if (size == 0 || size > kMaxSize)
+    return ErrorStatus(EINVAL);
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  size = (size + page_size - 1) & ~(page_size - 1);
+
+  LocalHandle fd{
+      memfd_create("pdx_uds_channel", MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+  if (!fd) {
+    ALOGE("SharedMemoryArea::Create: Failed to create memfd: %s",
+          strerror(errno));
+    return ErrorStatus(errno);
+  }
+  if (ftruncate(fd.Get(), size) < 0 ||
+      fcntl(fd.Get(), F_ADD_SEALS, kRequiredSeals | F_SEAL_GROW) < 0) {
+    ALOGE("SharedMemoryArea::Create: Failed to size and seal memfd: %s",
+          strerror(errno));
+    return ErrorStatus(errno);
+  }
+
+  auto data = MapArea(fd, size);
+  if (!data)
+    return data.error_status();
+  return std::unique_ptr<SharedMemoryArea>{
+      new SharedMemoryArea{std::move(fd), data.get(), size}};
+}
+
+Status<std::unique_ptr<SharedMemoryArea>> SharedMemoryArea::Import(
+    LocalHandle fd) {
+  const int seals = fcntl(fd.Get(), F_GET_SEALS);
+  if (seals < 0 || (seals & kRequiredSeals) != kRequiredSeals) {
+    ALOGE("SharedMemoryArea::Import: Offered fd is not a sealed memfd");
+    return ErrorStatus(EINVAL);
+  }
+
+  struct stat stat_buf;
+  if (fstat(fd.Get(), &stat_buf) < 0)
+    return ErrorStatus(errno);
+  const size_t size = stat_buf.st_size;
+  if (size == 0 || size > kMaxSize)
+    return ErrorStatus(EINVAL);
+
+  auto data = MapArea(fd, size);
+  if (!data)
+    return data.error_status();
+  // The mapping keeps the memory alive; the service has no use for the fd.
+  return std::unique_ptr<SharedMemoryArea>{
+      new SharedMemoryArea{LocalHandle{}, data.get(), size}};
+}
+
+void SharedMemoryArea::Write(const iovec* vector, size_t vector_length) {
+  size_t offset = 0;
+  for (size_t i = 0; i < vector_length; i++) {
+    memcpy(data_ + offset, vector[i].iov_base, vector[i].iov_len);
+    offset += vector[i].iov_len;
+  }
+}
+
+void SharedMemoryArea::Write(const void* data, size_t size) {
+  memcpy(data_, data, size);
+}
+
+size_t SharedMemoryArea::Read(const iovec* vector, size_t vector_length,
+                              size_t size) const {
+  size_t offset = 0;
+  for (size_t i = 0; i < vector_length && offset < size; i++) {
+    size_t size_to_copy = std::min(size - offset, vector[i].iov_len);
+    memcpy(vector[i].iov_base, data_ + offset, size_to_copy);
+    offset += size_to_copy;
+  }
+  return offset;
+}
+
+void SharedMemoryArea::Read(void* data, size_t size) const {
+  memcpy(data, data_, size);
+}
+
+}  // namespace uds
+}  // namespace pdx
+}  // namespace android
@@ -2,6 +2,7 @@
 #define ANDROID_DVR_PERFORMANCE_CLIENT_API_H_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <unistd.h>
 
 #ifdef __cplusplus
@@ -66,6 +67,36 @@ int dvrSetSchedulerClass(pid_t task_id, const char* scheduler_class);
 /// @returns Returns 0 on success or a negative errno error code on error.
 int dvrGetCpuPartition(pid_t task_id, char* partition, size_t size);
 
+/// Sets a deadline policy for a task.
+///
+/// Declares that the task needs |runtime_ns| of CPU time within |deadline_ns|
+/// of the start of every |period_ns| long period. The service places the task
+/// on SCHED_DEADLINE with these parameters when the kernel admits it, and
+/// otherwise on a deadline-ordered SCHED_FIFO priority in a performance cpuset
+/// with enough spare capacity. Both reset on fork.
+///
+/// @param task_id The task id of the task to set the policy for. When task_id
+/// is 0 the current task id is substituted.
+/// @param runtime_ns Worst case execution time per period. Passing 0 removes
+/// the deadline policy and restores the normal scheduler policy.
+/// @param deadline_ns Relative deadline; must be at least runtime_ns.
+/// @param period_ns Activation period; must be at least deadline_ns. When 0 the
+/// deadline is used as the period.
+/// @returns Returns 0 on success or a negative errno error code on error.
+int dvrSetDeadlinePolicy(pid_t task_id, uint64_t runtime_ns,
+                         uint64_t deadline_ns, uint64_t period_ns);
+
+/// Reports that a task with a deadline policy missed a deadline.
+///
+/// The service logs misses per task and includes them in its dumped state.
+///
+/// @param task_id The task id of the task that missed its deadline. When
+/// task_id is 0 the current task id is substituted.
+/// @param lateness_ns How late the task finished its work for the period.
+/// @returns Returns 0 on success, -ENOENT if the task has no deadline policy,
+/// or another negative errno error code on error.
+int dvrReportDeadlineMiss(pid_t task_id, uint64_t lateness_ns);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -1,6 +1,7 @@
 #ifndef ANDROID_DVR_PERFORMANCE_CLIENT_H_
 #define ANDROID_DVR_PERFORMANCE_CLIENT_H_
 
+#include <stdint.h>
 #include <sys/types.h>
 
 #include <cstddef>
@@ -24,6 +25,9 @@ class PerformanceClient : public pdx::ClientBase<PerformanceClient> {
   int SetSchedulerClass(pid_t task_id, const char* scheduler_class);
   int GetCpuPartition(pid_t task_id, std::string* partition_out);
   int GetCpuPartition(pid_t task_id, char* partition_out, std::size_t size);
+  int SetDeadlinePolicy(pid_t task_id, uint64_t runtime_ns,
+                        uint64_t deadline_ns, uint64_t period_ns);
+  int ReportDeadlineMiss(pid_t task_id, uint64_t lateness_ns);
 
  private:
   friend BASE;
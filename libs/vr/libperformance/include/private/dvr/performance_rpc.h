@@ -1,6 +1,7 @@
 #ifndef ANDROID_DVR_PERFORMANCE_RPC_H_
 #define ANDROID_DVR_PERFORMANCE_RPC_H_
 
+#include <stdint.h>
 #include <sys/types.h>
 
 #include <string>
@@ -22,6 +23,8 @@ struct PerformanceRPC {
     kOpSetSchedulerClass,
     kOpGetCpuPartition,
     kOpSetSchedulerPolicy,
+    kOpSetDeadlinePolicy,
+    kOpReportDeadlineMiss,
   };
 
   // Methods.
@@ -32,6 +35,11 @@ struct PerformanceRPC {
   PDX_REMOTE_METHOD(GetCpuPartition, kOpGetCpuPartition, std::string(pid_t));
   PDX_REMOTE_METHOD(SetSchedulerPolicy, kOpSetSchedulerPolicy,
                     void(pid_t, const std::string&));
+  PDX_REMOTE_METHOD(SetDeadlinePolicy, kOpSetDeadlinePolicy,
+                    void(pid_t task_id, uint64_t runtime_ns,
+                         uint64_t deadline_ns, uint64_t period_ns));
+  PDX_REMOTE_METHOD(ReportDeadlineMiss, kOpReportDeadlineMiss,
+                    void(pid_t task_id, uint64_t lateness_ns));
 };
 
 }  // namespace dvr
@@ -110,6 +110,27 @@ int PerformanceClient::GetCpuPartition(pid_t task_id, char* partition_out,
   return 0;
 }
 
+int PerformanceClient::SetDeadlinePolicy(pid_t task_id, uint64_t runtime_ns,
+                                         uint64_t deadline_ns,
+                                         uint64_t period_ns) {
+  if (task_id == 0)
+    task_id = gettid();
+
+  return ReturnStatusOrError(
+      InvokeRemoteMethod<PerformanceRPC::SetDeadlinePolicy>(
+          task_id, runtime_ns, deadline_ns, period_ns));
+}
+
+int PerformanceClient::ReportDeadlineMiss(pid_t task_id,
+                                          uint64_t lateness_ns) {
+  if (task_id == 0)
+    task_id = gettid();
+
+  return ReturnStatusOrError(
+      InvokeRemoteMethod<PerformanceRPC::ReportDeadlineMiss>(task_id,
+                                                             lateness_ns));
+}
+
 }  // namespace dvr
 }  // namespace android
 
@@ -146,3 +167,21 @@ extern "C" int dvrGetCpuPartition(pid_t task_id, char* partition, size_t size) {
   else
     return error;
 }
+
+extern "C" int dvrSetDeadlinePolicy(pid_t task_id, uint64_t runtime_ns,
+                                    uint64_t deadline_ns, uint64_t period_ns) {
+  int error;
+  if (auto client = android::dvr::PerformanceClient::Create(&error))
+    return client->SetDeadlinePolicy(task_id, runtime_ns, deadline_ns,
+                                     period_ns);
+  else
+    return error;
+}
+
+extern "C" int dvrReportDeadlineMiss(pid_t task_id, uint64_t lateness_ns) {
+  int error;
+  if (auto client = android::dvr::PerformanceClient::Create(&error))
+    return client->ReportDeadlineMiss(task_id, lateness_ns);
+  else
+    return error;
+}
@@ -51,6 +51,17 @@ const char kDvrStandaloneProperty[] = "ro.boot.vr";
 
 const char kRightEyeOffsetProperty[] = "dvr.right_eye_offset_ns";
 
+const char kAdaptivePostOffsetProperty[] = "dvr.adaptive_post_offset";
+
+// The post thread wakes up early enough for this percentile of recent frames
+// to finish composition in time, plus a margin for scheduling jitter.
+constexpr int kCompositionPercentile = 95;
+constexpr int64_t kFramePostOffsetMarginNs = 1000000;
+constexpr int64_t kMinFramePostOffsetNs = 1000000;
+
+// Latencies outside this range come from a pose ring with garbage contents.
+constexpr int64_t kMaxMotionToPhotonNs = 1000000000;
+
 // Surface flinger uses "VSYNC-sf" and "VSYNC-app" for its version of these
 // events. Name ours similarly.
 const char kVsyncTraceEventName[] = "VSYNC-vrflinger";
@@ -127,6 +138,62 @@ const char* GetDisplayName(bool is_primary) {
 
 }  // anonymous namespace
 
+void FrameStats::AddCompositionDuration(int64_t duration_ns) {
+  const size_t bucket = std::min<size_t>(
+      std::max<int64_t>(duration_ns, 0) / kHistogramBucketNs,
+      kHistogramBucketCount - 1);
+  histogram_[bucket]++;
+
+  recent_[recent_index_] = duration_ns;
+  recent_index_ = (recent_index_ + 1) % kRecentSampleCount;
+  recent_count_ = std::min(recent_count_ + 1, kRecentSampleCount);
+}
+
+std::optional<int64_t> FrameStats::GetRecentCompositionDuration(
+    int percentile) const {
+  // Wait for a full window so that a few fast frames right after resume do not
+  // push the wake-up too late.
+  if (recent_count_ < kRecentSampleCount)
+    return std::nullopt;
+
+  std::array<int64_t, kRecentSampleCount> sorted = recent_;
+  const size_t index = (kRecentSampleCount - 1) * percentile / 100;
+  std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+  return sorted[index];
+}
+
+void FrameStats::AddMotionToPhotonLatency(int64_t latency_ns) {
+  motion_to_photon_count_++;
+  motion_to_photon_total_ns_ += latency_ns;
+  motion_to_photon_max_ns_ = std::max(motion_to_photon_max_ns_, latency_ns);
+}
+
+void FrameStats::Dump(std::ostringstream& stream) const {
+  stream << "  Posted frames:      " << posted_frames << std::endl;
+  stream << "  Dropped frames:     " << dropped_frames << std::endl;
+  stream << "  Missed vsyncs:      " << missed_vsyncs << std::endl;
+  stream << "  Failed frames:      " << failed_frames << std::endl;
+
+  if (motion_to_photon_count_ > 0) {
+    stream << "  Motion to photon:   avg="
+           << motion_to_photon_total_ns_ / motion_to_photon_count_ / 1000
+           << "us max=" << motion_to_photon_max_ns_ / 1000 << "us"
+           << std::endl;
+  }
+
+  stream << "  Composition time histogram:" << std::endl;
+  for (size_t i = 0; i < kHistogramBucketCount; i++) {
+    if (histogram_[i] == 0)
+      continue;
+    stream << "    " << (i * kHistogramBucketNs / 1000) << "us";
+    if (i + 1 < kHistogramBucketCount)
+      stream << "-" << ((i + 1) * kHistogramBucketNs / 1000) << "us";
+    else
+      stream << "+";
+    stream << ": " << histogram_[i] << std::endl;
+  }
+}
+
 HardwareComposer::HardwareComposer()
     : initialized_(false), request_display_callback_(nullptr) {}
 
@@ -479,6 +546,17 @@ std::string HardwareComposer::Dump() {
   stream << "Active layers:       " << layers_.size() << std::endl;
   stream << std::endl;
 
+  {
+    std::lock_guard<std::mutex> stats_lock(frame_stats_mutex_);
+    for (const auto& pair : frame_stats_) {
+      const bool is_primary = pair.first == primary_display_.id;
+      stream << GetDisplayName(is_primary) << " display frame stats (id="
+             << pair.first << "):" << std::endl;
+      pair.second.Dump(stream);
+    }
+  }
+  stream << std::endl;
+
   for (size_t i = 0; i < layers_.size(); i++) {
     stream << "Layer " << i << ":";
     stream << " type=" << layers_[i].GetCompositionType().to_string();
@@ -496,7 +574,7 @@ std::string HardwareComposer::Dump() {
   return stream.str();
 }
 
-void HardwareComposer::PostLayers(hwc2_display_t display) {
+bool HardwareComposer::PostLayers(hwc2_display_t display) {
   ATRACE_NAME("HardwareComposer::PostLayers");
 
   // Setup the hardware composer layers with current buffers.
@@ -529,7 +607,9 @@ void HardwareComposer::PostLayers(hwc2_display_t display) {
     for (auto& layer : layers_) {
       layer.Drop();
     }
-    return;
+    UpdateFrameStats(display,
+                     [](FrameStats& stats) { stats.dropped_frames++; });
+    return false;
   } else {
     // Make the transition more obvious in systrace when the frame skip happens
     // above.
@@ -548,14 +628,16 @@ void HardwareComposer::PostLayers(hwc2_display_t display) {
   if (error != HWC::Error::None) {
     ALOGE("HardwareComposer::PostLayers: Validate failed: %s display=%" PRIu64,
           error.to_string().c_str(), display);
-    return;
+    UpdateFrameStats(display, [](FrameStats& stats) { stats.failed_frames++; });
+    return false;
   }
 
   error = Present(display);
   if (error != HWC::Error::None) {
     ALOGE("HardwareComposer::PostLayers: Present failed: %s",
           error.to_string().c_str());
-    return;
+    UpdateFrameStats(display, [](FrameStats& stats) { stats.failed_frames++; });
+    return false;
   }
 
   std::vector<Hwc2::Layer> out_layers;
@@ -575,6 +657,52 @@ void HardwareComposer::PostLayers(hwc2_display_t display) {
       }
     }
   }
+  return true;
+}
+
+void HardwareComposer::UpdateFrameStats(
+    hwc2_display_t display, const std::function<void(FrameStats&)>& update) {
+  std::lock_guard<std::mutex> lock(frame_stats_mutex_);
+  update(frame_stats_[display]);
+}
+
+int64_t HardwareComposer::GetFramePostOffsetNs(const DisplayParams& display) {
+  const int64_t configured_offset_ns = post_thread_config_.frame_post_offset_ns;
+  if (!adaptive_post_offset_)
+    return configured_offset_ns;
+
+  std::optional<int64_t> duration_ns;
+  {
+    std::lock_guard<std::mutex> lock(frame_stats_mutex_);
+    duration_ns = frame_stats_[display.id].GetRecentCompositionDuration(
+        kCompositionPercentile);
+  }
+  if (!duration_ns)
+    return configured_offset_ns;
+
+  return std::clamp(*duration_ns + kFramePostOffsetMarginNs,
+                    kMinFramePostOffsetNs,
+                    static_cast<int64_t>(display.vsync_period_ns) / 2);
+}
+
+void HardwareComposer::LatchPose(hwc2_display_t display,
+                                 int64_t photon_time_ns) {
+  ATRACE_NAME("HardwareComposer::LatchPose");
+  DvrPose pose;
+  {
+    std::lock_guard<std::mutex> lock(pose_ring_mutex_);
+    if (!pose_ring_ || !pose_ring_->GetNewest(&pose))
+      return;
+  }
+
+  const int64_t latency_ns = photon_time_ns - pose.timestamp_ns;
+  if (latency_ns < 0 || latency_ns > kMaxMotionToPhotonNs)
+    return;
+
+  ATRACE_INT64("motion_to_photon_ns", latency_ns);
+  UpdateFrameStats(display, [latency_ns](FrameStats& stats) {
+    stats.AddMotionToPhotonLatency(latency_ns);
+  });
 }
 
 void HardwareComposer::SetDisplaySurfaces(
@@ -606,6 +734,17 @@ int HardwareComposer::OnNewGlobalBuffer(DvrGlobalBufferKey key,
     }
   }
 
+  if (key == DvrGlobalBuffers::kSensorPoseBuffer) {
+    std::lock_guard<std::mutex> lock(pose_ring_mutex_);
+    pose_ring_ = std::make_unique<CPUMappedBroadcastRing<DvrPoseRing>>(
+        &ion_buffer, CPUUsageMode::READ_OFTEN);
+
+    if (pose_ring_->IsMapped() == false) {
+      pose_ring_ = nullptr;
+      return -EPERM;
+    }
+  }
+
   if (key == DvrGlobalBuffers::kVrFlingerConfigBufferKey) {
     return MapConfigBuffer(ion_buffer);
   }
@@ -614,6 +753,11 @@ int HardwareComposer::OnNewGlobalBuffer(DvrGlobalBufferKey key,
 }
 
 void HardwareComposer::OnDeletedGlobalBuffer(DvrGlobalBufferKey key) {
+  if (key == DvrGlobalBuffers::kSensorPoseBuffer) {
+    std::lock_guard<std::mutex> lock(pose_ring_mutex_);
+    pose_ring_ = nullptr;
+  }
+
   if (key == DvrGlobalBuffers::kVrFlingerConfigBufferKey) {
     ConfigBufferDeleted();
   }
@@ -744,6 +888,9 @@ void HardwareComposer::PostThread() {
   bool thread_policy_setup =
       SetThreadPolicy("graphics:high", "/system/performance");
 
+  adaptive_post_offset_ =
+      property_get_bool(kAdaptivePostOffsetProperty, true);
+
   // Create a timerfd based on CLOCK_MONOTINIC.
   vsync_sleep_timer_fd_.Reset(timerfd_create(CLOCK_MONOTONIC, 0));
   LOG_ALWAYS_FATAL_IF(
@@ -857,7 +1004,12 @@ void HardwareComposer::PostThread() {
       // predictor will sync up with the real vsync.
       last_vsync_timestamp_ = GetSystemClockNs();
       vsync_prediction_interval_ = 1;
+      vsync_predictor_.Reset(target_display_->vsync_period_ns);
       retire_fence_fds_.clear();
+
+      // Composition durations measured before the change do not apply.
+      UpdateFrameStats(target_display_->id,
+                       [](FrameStats& stats) { stats.ResetRecent(); });
     }
 
     int64_t vsync_timestamp = 0;
@@ -901,22 +1053,29 @@ void HardwareComposer::PostThread() {
       vsync.vsync_left_eye_offset_ns = vsync_eye_offsets.left_ns;
       vsync.vsync_right_eye_offset_ns = vsync_eye_offsets.right_ns;
       vsync.vsync_period_ns = target_display_->vsync_period_ns;
+      if (vsync_predictor_.nominal_period_ns() !=
+          target_display_->vsync_period_ns) {
+        vsync_predictor_.Reset(target_display_->vsync_period_ns);
+      }
+      vsync_predictor_.FillPrediction(&vsync);
 
       vsync_ring_->Publish(vsync);
     }
 
     {
-      // Sleep until shortly before vsync.
+      // Sleep until shortly before vsync, leaving enough time to compose.
       ATRACE_NAME("sleep");
 
       const int64_t display_time_est_ns =
           vsync_timestamp + target_display_->vsync_period_ns;
+      const int64_t frame_post_offset_ns =
+          GetFramePostOffsetNs(*target_display_);
       const int64_t now_ns = GetSystemClockNs();
-      const int64_t sleep_time_ns = display_time_est_ns - now_ns -
-                                    post_thread_config_.frame_post_offset_ns;
-      const int64_t wakeup_time_ns =
-          display_time_est_ns - post_thread_config_.frame_post_offset_ns;
+      const int64_t sleep_time_ns =
+          display_time_est_ns - now_ns - frame_post_offset_ns;
+      const int64_t wakeup_time_ns = display_time_est_ns - frame_post_offset_ns;
 
+      ATRACE_INT64("frame_post_offset_ns", frame_post_offset_ns);
       ATRACE_INT64("sleep_time_ns", sleep_time_ns);
       if (sleep_time_ns > 0) {
         int error = SleepUntil(wakeup_time_ns);
@@ -930,6 +1089,8 @@ void HardwareComposer::PostThread() {
       }
     }
 
+    const int64_t post_start_ns = GetSystemClockNs();
+
     {
       auto status = composer_callback_->GetVsyncTime(target_display_->id);
 
@@ -951,14 +1112,29 @@ void HardwareComposer::PostThread() {
             "since last frame: timestamp=%" PRId64 " prediction_interval=%d",
             current_vsync_timestamp, vsync_prediction_interval_);
         vsync_prediction_interval_++;
+        UpdateFrameStats(target_display_->id,
+                         [](FrameStats& stats) { stats.missed_vsyncs++; });
       } else {
         // We have an updated vsync timestamp, reset the prediction interval.
         last_vsync_timestamp_ = current_vsync_timestamp;
         vsync_prediction_interval_ = 1;
+        vsync_predictor_.AddVsyncTimestamp(current_vsync_timestamp);
       }
     }
 
-    PostLayers(target_display_->id);
+    // Latch the pose as late as possible; the frame lights up at the pose
+    // prediction time published with this vsync.
+    LatchPose(target_display_->id, vsync_timestamp + vsync_eye_offsets.left_ns);
+
+    if (PostLayers(target_display_->id)) {
+      const int64_t composition_ns = GetSystemClockNs() - post_start_ns;
+      ATRACE_INT64("composition_ns", composition_ns);
+      UpdateFrameStats(target_display_->id,
+                       [composition_ns](FrameStats& stats) {
+                         stats.posted_frames++;
+                         stats.AddCompositionDuration(composition_ns);
+                       });
+    }
   }
 }
 
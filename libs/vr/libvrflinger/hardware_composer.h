@@ -11,9 +11,11 @@
 
 #include <array>
 #include <condition_variable>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <sstream>
 #include <thread>
 #include <tuple>
 #include <vector>
@@ -23,6 +25,7 @@
 #include <pdx/file_handle.h>
 #include <pdx/rpc/variant.h>
 #include <private/dvr/shared_buffer_helpers.h>
+#include <private/dvr/vsync_predictor.h>
 #include <private/dvr/vsync_service.h>
 
 #include "DisplayHardware/DisplayIdentification.h"
@@ -53,6 +56,54 @@ struct DisplayParams {
   int vsync_period_ns;
 };
 
+// Frame timing and skipped frame counters for one display.
+class FrameStats {
+ public:
+  // Histogram of composition durations in 0.5ms buckets; the last bucket
+  // collects everything longer.
+  static constexpr int64_t kHistogramBucketNs = 500000;
+  static constexpr size_t kHistogramBucketCount = 16;
+
+  // Number of recent composition durations kept for the wake-up estimate.
+  static constexpr size_t kRecentSampleCount = 64;
+
+  // Records the time from post thread wake-up to present for a posted frame.
+  void AddCompositionDuration(int64_t duration_ns);
+
+  // Returns the composition duration that |percentile| percent of the recent
+  // frames did not exceed, or an empty optional until enough frames have been
+  // posted.
+  std::optional<int64_t> GetRecentCompositionDuration(int percentile) const;
+
+  // Records the age of the latched pose at the predicted display time.
+  void AddMotionToPhotonLatency(int64_t latency_ns);
+
+  // Forgets recent durations, e.g. when the display timing changes. The
+  // histogram and counters are kept.
+  void ResetRecent() { recent_count_ = 0; }
+
+  void Dump(std::ostringstream& stream) const;
+
+  // Frames handed to hardware composer.
+  uint64_t posted_frames = 0;
+  // Frames dropped to let a backed up display driver catch up.
+  uint64_t dropped_frames = 0;
+  // Vsyncs whose timestamp did not advance by the time we posted.
+  uint64_t missed_vsyncs = 0;
+  // Frames that hardware composer failed to validate or present.
+  uint64_t failed_frames = 0;
+
+ private:
+  std::array<uint64_t, kHistogramBucketCount> histogram_{};
+  std::array<int64_t, kRecentSampleCount> recent_{};
+  size_t recent_count_ = 0;
+  size_t recent_index_ = 0;
+
+  uint64_t motion_to_photon_count_ = 0;
+  int64_t motion_to_photon_total_ns_ = 0;
+  int64_t motion_to_photon_max_ns_ = 0;
+};
+
 // Layer represents the connection between a hardware composer layer and the
 // source supplying buffers for the layer's contents.
 class Layer {
@@ -416,9 +467,24 @@ class HardwareComposer {
   HWC::Error Validate(hwc2_display_t display);
   HWC::Error Present(hwc2_display_t display);
 
-  void PostLayers(hwc2_display_t display);
+  // Hands the current layer buffers to hardware composer. Returns true if a
+  // frame was presented, false if it was dropped or failed.
+  bool PostLayers(hwc2_display_t display);
   void PostThread();
 
+  // Returns how long before the predicted display time the post thread should
+  // wake up for |display|. Adapts to the measured composition durations unless
+  // disabled, falling back to the configured frame post offset.
+  int64_t GetFramePostOffsetNs(const DisplayParams& display);
+
+  // Reads the newest sensor pose just before posting and records how old it
+  // will be at |display_time_ns|, the motion-to-photon latency of the frame.
+  void LatchPose(hwc2_display_t display, int64_t display_time_ns);
+
+  // Runs |update| on the frame stats for |display| under the stats lock.
+  void UpdateFrameStats(hwc2_display_t display,
+                        const std::function<void(FrameStats&)>& update);
+
   // The post thread has two controlling states:
   // 1. Idle: no work to do (no visible surfaces).
   // 2. Suspended: explicitly halted (system is not in VR mode).
@@ -540,6 +606,10 @@ class HardwareComposer {
   // Vsync count since display on.
   uint32_t vsync_count_ = 0;
 
+  // Fits the hardware vsync timestamps of the target display, for the
+  // predictions published in the vsync ring.
+  VsyncPredictor vsync_predictor_{0};
+
   // Counter tracking the number of skipped frames.
   int frame_skip_count_ = 0;
 
@@ -550,6 +620,19 @@ class HardwareComposer {
   // If we are publishing vsync data, we will put it here.
   std::unique_ptr<CPUMappedBroadcastRing<DvrVsyncRing>> vsync_ring_;
 
+  // Sensor pose ring latched before each post. Mapped by the dispatch thread
+  // and read by the post thread.
+  std::unique_ptr<CPUMappedBroadcastRing<DvrPoseRing>> pose_ring_;
+  std::mutex pose_ring_mutex_;
+
+  // Per-display frame stats, keyed by display id. Updated by the post thread
+  // and read by Dump().
+  std::map<hwc2_display_t, FrameStats> frame_stats_;
+  std::mutex frame_stats_mutex_;
+
+  // Whether the post offset adapts to measured composition durations.
+  bool adaptive_post_offset_ = true;
+
   // Broadcast ring for receiving config data from the DisplayManager.
   DvrConfigRing shared_config_ring_;
   uint32_t shared_config_ring_sequence_{0};
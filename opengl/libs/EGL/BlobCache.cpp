@@ -23,7 +23,8 @@
 
 #include <android-base/properties.h>
 #include <log/log.h>
-#include <chrono>
+
+#include <string_view>
 
 namespace android {
 
@@ -41,15 +42,6 @@ BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize
         mMaxKeySize(maxKeySize),
         mMaxValueSize(maxValueSize),
         mTotalSize(0) {
-    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
-#ifdef _WIN32
-    srand(now);
-#else
-    mRandState[0] = (now >> 0) & 0xFFFF;
-    mRandState[1] = (now >> 16) & 0xFFFF;
-    mRandState[2] = (now >> 32) & 0xFFFF;
-#endif
-    ALOGV("initializing random seed using %lld", (unsigned long long)now);
 }
 
 void BlobCache::set(const void* key, size_t keySize, const void* value,
@@ -78,15 +70,12 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
         return;
     }
 
-    std::shared_ptr<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, nullptr);
+    Blob lookupKey(key, keySize, false);
 
     while (true) {
-        auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), dummyEntry);
-        if (index == mCacheEntries.end() || dummyEntry < *index) {
+        auto index = mCacheIndex.find(&lookupKey);
+        if (index == mCacheIndex.end()) {
             // Create a new cache entry.
-            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
             size_t newTotalSize = mTotalSize + keySize + valueSize;
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
@@ -101,15 +90,18 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            mCacheEntries.insert(index, CacheEntry(keyBlob, valueBlob));
+            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
+            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
+            mCacheEntries.emplace_front(keyBlob, valueBlob);
+            mCacheIndex.emplace(keyBlob.get(), mCacheEntries.begin());
             mTotalSize = newTotalSize;
+            mGeneration++;
             ALOGV("set: created new cache entry with %zu byte key and %zu byte value",
                     keySize, valueSize);
         } else {
             // Update the existing cache entry.
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            std::shared_ptr<Blob> oldValueBlob(index->getValue());
-            size_t newTotalSize = mTotalSize + valueSize - oldValueBlob->getSize();
+            auto entry = index->second;
+            size_t newTotalSize = mTotalSize + valueSize - entry->getValue()->getSize();
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
                     // Clean the cache and try again.
@@ -122,8 +114,10 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            index->setValue(valueBlob);
+            entry->setValue(std::shared_ptr<Blob>(new Blob(value, valueSize, true)));
+            mCacheEntries.splice(mCacheEntries.begin(), mCacheEntries, entry);
             mTotalSize = newTotalSize;
+            mGeneration++;
             ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
                     "value", keySize, valueSize);
         }
@@ -136,19 +130,23 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value,
     if (mMaxKeySize < keySize) {
         ALOGV("get: not searching because the key is too large: %zu (limit %zu)",
                 keySize, mMaxKeySize);
+        mStats.misses++;
         return 0;
     }
-    std::shared_ptr<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, nullptr);
-    auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), dummyEntry);
-    if (index == mCacheEntries.end() || dummyEntry < *index) {
+    Blob lookupKey(key, keySize, false);
+    auto index = mCacheIndex.find(&lookupKey);
+    if (index == mCacheIndex.end()) {
         ALOGV("get: no cache entry found for key of size %zu", keySize);
+        mStats.misses++;
         return 0;
     }
+    mStats.hits++;
 
-    // The key was found. Return the value if the caller's buffer is large
-    // enough.
-    std::shared_ptr<Blob> valueBlob(index->getValue());
+    // The key was found. Mark it as the most recently used entry, and return
+    // the value if the caller's buffer is large enough.
+    auto entry = index->second;
+    mCacheEntries.splice(mCacheEntries.begin(), mCacheEntries, entry);
+    std::shared_ptr<Blob> valueBlob(entry->getValue());
     size_t valueBlobSize = valueBlob->getSize();
     if (valueBlobSize <= valueSize) {
         ALOGV("get: copying %zu bytes to caller's buffer", valueBlobSize);
@@ -190,10 +188,12 @@ int BlobCache::flatten(void* buffer, size_t size) const {
     header->mBuildIdLength = buildId.size();
     memcpy(header->mBuildId, buildId.c_str(), header->mBuildIdLength);
 
-    // Write cache entries
+    // Write cache entries, least recently used first, so that unflattening
+    // them in order restores the same recency order.
     uint8_t* byteBuffer = reinterpret_cast<uint8_t*>(buffer);
     off_t byteOffset = align4(sizeof(Header) + header->mBuildIdLength);
-    for (const CacheEntry& e :  mCacheEntries) {
+    for (auto it = mCacheEntries.rbegin(); it != mCacheEntries.rend(); ++it) {
+        const CacheEntry& e = *it;
         std::shared_ptr<Blob> const& keyBlob = e.getKey();
         std::shared_ptr<Blob> const& valueBlob = e.getValue();
         size_t keySize = keyBlob->getSize();
@@ -227,7 +227,7 @@ int BlobCache::flatten(void* buffer, size_t size) const {
 
 int BlobCache::unflatten(void const* buffer, size_t size) {
     // All errors should result in the BlobCache being in an empty state.
-    mCacheEntries.clear();
+    clear();
 
     // Read the cache header
     if (size < sizeof(Header)) {
@@ -254,7 +254,7 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     size_t numEntries = header->mNumEntries;
     for (size_t i = 0; i < numEntries; i++) {
         if (byteOffset + sizeof(EntryHeader) > size) {
-            mCacheEntries.clear();
+            clear();
             ALOGE("unflatten: not enough room for cache entry headers");
             return -EINVAL;
         }
@@ -267,7 +267,7 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
 
         size_t totalSize = align4(entrySize);
         if (byteOffset + totalSize > size) {
-            mCacheEntries.clear();
+            clear();
             ALOGE("unflatten: not enough room for cache entry headers");
             return -EINVAL;
         }
@@ -281,22 +281,18 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     return 0;
 }
 
-long int BlobCache::blob_random() {
-#ifdef _WIN32
-    return rand();
-#else
-    return nrand48(mRandState);
-#endif
-}
-
 void BlobCache::clean() {
-    // Remove a random cache entry until the total cache size gets below half
-    // the maximum total cache size.
-    while (mTotalSize > mMaxTotalSize / 2) {
-        size_t i = size_t(blob_random() % (mCacheEntries.size()));
-        const CacheEntry& entry(mCacheEntries[i]);
-        mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.erase(mCacheEntries.begin() + i);
+    // Remove the least recently used cache entry until the total cache size
+    // gets below half the maximum total cache size.
+    while (mTotalSize > mMaxTotalSize / 2 && !mCacheEntries.empty()) {
+        const CacheEntry& entry(mCacheEntries.back());
+        size_t entrySize = entry.getKey()->getSize() + entry.getValue()->getSize();
+        mCacheIndex.erase(entry.getKey().get());
+        mTotalSize -= entrySize;
+        mStats.evictions++;
+        mStats.evictedBytes += entrySize;
+        mCacheEntries.pop_back();
+        mGeneration++;
     }
 }
 
@@ -327,6 +323,15 @@ bool BlobCache::Blob::operator<(const Blob& rhs) const {
     }
 }
 
+bool BlobCache::Blob::operator==(const Blob& rhs) const {
+    return mSize == rhs.mSize && memcmp(mData, rhs.mData, mSize) == 0;
+}
+
+size_t BlobCache::BlobPtrHash::operator()(const Blob* blob) const {
+    return std::hash<std::string_view>()(
+            std::string_view(static_cast<const char*>(blob->getData()), blob->getSize()));
+}
+
 const void* BlobCache::Blob::getData() const {
     return mData;
 }
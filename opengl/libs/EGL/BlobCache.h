@@ -18,9 +18,11 @@
 #define ANDROID_BLOB_CACHE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <list>
 #include <memory>
-#include <vector>
+#include <unordered_map>
 
 namespace android {
 
@@ -99,7 +101,24 @@ public:
 
     // clear flushes out all contents of the cache then the BlobCache, leaving
     // it in an empty state.
-    void clear() { mCacheEntries.clear(); }
+    void clear() {
+        mCacheIndex.clear();
+        mCacheEntries.clear();
+        mTotalSize = 0;
+        mGeneration++;
+    }
+
+    // Stats counts the lookups made through get and the entries evicted to
+    // make room for new ones since the BlobCache was created.
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t evictedBytes = 0;
+    };
+
+    // getStats returns the lookup and eviction counters of the cache.
+    Stats getStats() const { return mStats; }
 
 protected:
     // mMaxTotalSize is the maximum size that all cache entries can occupy. This
@@ -109,15 +128,18 @@ protected:
     // will be evicted from the cache to make room for the new entry.
     const size_t mMaxTotalSize;
 
+    // getGeneration returns a counter that changes every time an entry is
+    // added, replaced or evicted.  Reordering entries by recency does not
+    // change it.  Subclasses use it to tell whether their saved copy of the
+    // cache is stale.
+    uint64_t getGeneration() const { return mGeneration; }
+
 private:
     // Copying is disallowed.
     BlobCache(const BlobCache&);
     void operator=(const BlobCache&);
 
-    // A random function helper to get around MinGW not having nrand48()
-    long int blob_random();
-
-    // clean evicts a randomly chosen set of entries from the cache such that
+    // clean evicts the least recently used entries from the cache such that
     // the total size of all remaining entries is less than mMaxTotalSize/2.
     void clean();
 
@@ -132,6 +154,7 @@ private:
         ~Blob();
 
         bool operator<(const Blob& rhs) const;
+        bool operator==(const Blob& rhs) const;
 
         const void* getData() const;
         size_t getSize() const;
@@ -152,6 +175,15 @@ private:
         bool mOwnsData;
     };
 
+    // BlobPtrHash and BlobPtrEqual let mCacheIndex look entries up by the
+    // contents of their key rather than by pointer.
+    struct BlobPtrHash {
+        size_t operator()(const Blob* blob) const;
+    };
+    struct BlobPtrEqual {
+        bool operator()(const Blob* lhs, const Blob* rhs) const { return *lhs == *rhs; }
+    };
+
     // A CacheEntry is a single key/value pair in the cache.
     class CacheEntry {
     public:
@@ -236,13 +268,22 @@ private:
     // the cache.
     size_t mTotalSize;
 
-    // mRandState is the pseudo-random number generator state. It is passed to
-    // nrand48 to generate random numbers when needed.
-    unsigned short mRandState[3];
+    // mCacheEntries stores all the cache entries that are resident in memory,
+    // ordered from most to least recently used.  Cache entries are added to
+    // it by the 'set' method and moved to the front by 'get' and 'set'.
+    using CacheEntries = std::list<CacheEntry>;
+    CacheEntries mCacheEntries;
+
+    // mCacheIndex maps the key of every entry in mCacheEntries to its
+    // position in the list.  The Blob pointers are owned by the entries.
+    std::unordered_map<const Blob*, CacheEntries::iterator, BlobPtrHash, BlobPtrEqual>
+            mCacheIndex;
+
+    // mStats holds the counters returned by getStats.
+    Stats mStats;
 
-    // mCacheEntries stores all the cache entries that are resident in memory.
-    // Cache entries are added to it by the 'set' method.
-    std::vector<CacheEntry> mCacheEntries;
+    // mGeneration is the counter returned by getGeneration.
+    uint64_t mGeneration = 0;
 };
 
 }
@@ -267,6 +267,49 @@ TEST_F(BlobCacheTest, ExceedingTotalLimitHalvesCacheSize) {
     ASSERT_EQ(maxEntries/2 + 1, numCached);
 }
 
+TEST_F(BlobCacheTest, ExceedingTotalLimitEvictsLeastRecentlyUsed) {
+    // Fill up the entire cache with 1 char key/value pairs.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, "x", 1);
+    }
+    // Touch the oldest entries so that they become the most recently used.
+    for (int i = 0; i < maxEntries / 2; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+    // Insert one more entry, causing a cache overflow.
+    {
+        uint8_t k = maxEntries;
+        mBC->set(&k, 1, "x", 1);
+    }
+    // The touched entries and the new one survive; the others are evicted.
+    for (int i = 0; i < maxEntries + 1; i++) {
+        uint8_t k = i;
+        bool recent = i < maxEntries / 2 || i == maxEntries;
+        ASSERT_EQ(recent ? size_t(1) : size_t(0), mBC->get(&k, 1, nullptr, 0)) << i;
+    }
+}
+
+TEST_F(BlobCacheTest, StatsCountHitsMissesAndEvictions) {
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries + 1; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, "x", 1);
+    }
+    uint8_t k = maxEntries;
+    ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    k = 0;
+    ASSERT_EQ(size_t(0), mBC->get(&k, 1, nullptr, 0));
+
+    BlobCache::Stats stats = mBC->getStats();
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(1u, stats.misses);
+    EXPECT_EQ(uint64_t(maxEntries / 2), stats.evictions);
+    EXPECT_EQ(uint64_t(maxEntries / 2 * 2), stats.evictedBytes);
+}
+
 class BlobCacheFlattenTest : public BlobCacheTest {
 protected:
     virtual void SetUp() {
@@ -320,6 +363,28 @@ TEST_F(BlobCacheFlattenTest, FlattenFullCache) {
     }
 }
 
+TEST_F(BlobCacheFlattenTest, FlattenKeepsRecencyOrder) {
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, &k, 1);
+    }
+    // Make key 0 the most recently used entry.
+    uint8_t k = 0;
+    ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+
+    roundTrip();
+
+    // Overflowing the unflattened cache must evict key 1, the least recently
+    // used entry, and keep key 0.
+    k = maxEntries;
+    mBC2->set(&k, 1, &k, 1);
+    k = 0;
+    EXPECT_EQ(size_t(1), mBC2->get(&k, 1, nullptr, 0));
+    k = 1;
+    EXPECT_EQ(size_t(0), mBC2->get(&k, 1, nullptr, 0));
+}
+
 TEST_F(BlobCacheFlattenTest, FlattenDoesntChangeCache) {
     // Fill up the entire cache with 1 char key/value pairs.
     const int maxEntries = MAX_TOTAL_SIZE / 2;
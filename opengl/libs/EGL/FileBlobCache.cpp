@@ -111,11 +111,12 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
 
         munmap(buf, fileSize);
         close(fd);
+        mSavedGeneration = getGeneration();
     }
 }
 
 void FileBlobCache::writeToFile() {
-    if (mFilename.length() > 0) {
+    if (mFilename.length() > 0 && getGeneration() != mSavedGeneration) {
         size_t cacheSize = getFlattenedSize();
         size_t headerSize = cacheFileHeaderSize;
         const char* fname = mFilename.c_str();
@@ -144,10 +145,20 @@ void FileBlobCache::writeToFile() {
 
         size_t fileSize = headerSize + cacheSize;
 
-        uint8_t* buf = new uint8_t [fileSize];
-        if (!buf) {
-            ALOGE("error allocating buffer for cache contents: %s (%d)",
-                    strerror(errno), errno);
+        // Flatten straight into the mapped file rather than into a heap
+        // buffer that would then have to be copied out with write().
+        if (ftruncate(fd, fileSize) == -1) {
+            ALOGE("error sizing cache file: %s (%d)", strerror(errno),
+                    errno);
+            close(fd);
+            unlink(fname);
+            return;
+        }
+        uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(nullptr, fileSize,
+                PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        if (buf == MAP_FAILED) {
+            ALOGE("error mmaping cache file: %s (%d)", strerror(errno),
+                    errno);
             close(fd);
             unlink(fname);
             return;
@@ -157,7 +168,7 @@ void FileBlobCache::writeToFile() {
         if (err < 0) {
             ALOGE("error writing cache contents: %s (%d)", strerror(-err),
                     -err);
-            delete [] buf;
+            munmap(buf, fileSize);
             close(fd);
             unlink(fname);
             return;
@@ -168,18 +179,17 @@ void FileBlobCache::writeToFile() {
         uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
         *crc = crc32c(buf + headerSize, cacheSize);
 
-        if (write(fd, buf, fileSize) == -1) {
+        if (munmap(buf, fileSize) == -1) {
             ALOGE("error writing cache file: %s (%d)", strerror(errno),
                     errno);
-            delete [] buf;
             close(fd);
             unlink(fname);
             return;
         }
 
-        delete [] buf;
         fchmod(fd, S_IRUSR);
         close(fd);
+        mSavedGeneration = getGeneration();
     }
 }
 
@@ -30,12 +30,17 @@ public:
             const std::string& filename);
 
     // writeToFile attempts to save the current contents of BlobCache to
-    // disk.
+    // disk.  Nothing is written if no entry was added, replaced or evicted
+    // since the file was last loaded or saved.
     void writeToFile();
 
 private:
     // mFilename is the name of the file for storing cache contents.
     std::string mFilename;
+
+    // mSavedGeneration is the BlobCache generation that the file on disk
+    // matches.
+    uint64_t mSavedGeneration = 0;
 };
 
 } // namespace android
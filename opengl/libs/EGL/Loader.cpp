@@ -19,10 +19,12 @@
 
 #include <EGL/Loader.h>
 
+#include <atomic>
 #include <string>
 
 #include <dirent.h>
 #include <dlfcn.h>
+#include <stddef.h>
 
 #include <android-base/properties.h>
 #include <android/dlext.h>
@@ -170,6 +172,8 @@ static bool should_unload_system_driver(egl_connection_t* cnx) {
     return false;
 }
 
+typedef __eglMustCastToProperFunctionPointerType (*GetProcAddressFn)(const char*);
+
 static void uninit_api(char const* const* api, __eglMustCastToProperFunctionPointerType* curr) {
     while (*api) {
         *curr++ = nullptr;
@@ -319,6 +323,59 @@ void Loader::close(egl_connection_t* cnx)
     cnx->useAngle = false;
 }
 
+// Looks up one GLES entry point in the driver, falling back to eglGetProcAddress and to the name
+// with or without the OES suffix. Returns gl_unimplemented (or gl_noop for the debug marker
+// functions) if the driver has no such function.
+static __eglMustCastToProperFunctionPointerType resolve_gl_entry(void* dso, char const* name,
+                                                                 GetProcAddressFn getProcAddress) {
+    const ssize_t SIZE = 256;
+    char scrap[SIZE];
+
+    __eglMustCastToProperFunctionPointerType f =
+        (__eglMustCastToProperFunctionPointerType)dlsym(dso, name);
+    if (f == nullptr) {
+        // couldn't find the entry-point, use eglGetProcAddress()
+        f = getProcAddress(name);
+    }
+    if (f == nullptr) {
+        // Try without the OES postfix
+        ssize_t index = ssize_t(strlen(name)) - 3;
+        if ((index>0 && (index<SIZE-1)) && (!strcmp(name+index, "OES"))) {
+            strncpy(scrap, name, index);
+            scrap[index] = 0;
+            f = (__eglMustCastToProperFunctionPointerType)dlsym(dso, scrap);
+            //ALOGD_IF(f, "found <%s> instead", scrap);
+        }
+    }
+    if (f == nullptr) {
+        // Try with the OES postfix
+        ssize_t index = ssize_t(strlen(name)) - 3;
+        if (index>0 && strcmp(name+index, "OES")) {
+            snprintf(scrap, SIZE, "%sOES", name);
+            f = (__eglMustCastToProperFunctionPointerType)dlsym(dso, scrap);
+            //ALOGD_IF(f, "found <%s> instead", scrap);
+        }
+    }
+    if (f == nullptr) {
+        //ALOGD("%s", name);
+        f = (__eglMustCastToProperFunctionPointerType)gl_unimplemented;
+
+        /*
+         * GL_EXT_debug_label is special, we always report it as
+         * supported, it's handled by GLES_trace. If GLES_trace is not
+         * enabled, then these are no-ops.
+         */
+        if (!strcmp(name, "glInsertEventMarkerEXT")) {
+            f = (__eglMustCastToProperFunctionPointerType)gl_noop;
+        } else if (!strcmp(name, "glPushGroupMarkerEXT")) {
+            f = (__eglMustCastToProperFunctionPointerType)gl_noop;
+        } else if (!strcmp(name, "glPopGroupMarkerEXT")) {
+            f = (__eglMustCastToProperFunctionPointerType)gl_noop;
+        }
+    }
+    return f;
+}
+
 void Loader::init_api(void* dso,
         char const * const * api,
         char const * const * ref_api,
@@ -327,8 +384,6 @@ void Loader::init_api(void* dso,
 {
     ATRACE_CALL();
 
-    const ssize_t SIZE = 256;
-    char scrap[SIZE];
     while (*api) {
         char const * name = *api;
         if (ref_api) {
@@ -340,54 +395,82 @@ void Loader::init_api(void* dso,
             }
         }
 
-        __eglMustCastToProperFunctionPointerType f =
-            (__eglMustCastToProperFunctionPointerType)dlsym(dso, name);
-        if (f == nullptr) {
-            // couldn't find the entry-point, use eglGetProcAddress()
-            f = getProcAddress(name);
-        }
-        if (f == nullptr) {
-            // Try without the OES postfix
-            ssize_t index = ssize_t(strlen(name)) - 3;
-            if ((index>0 && (index<SIZE-1)) && (!strcmp(name+index, "OES"))) {
-                strncpy(scrap, name, index);
-                scrap[index] = 0;
-                f = (__eglMustCastToProperFunctionPointerType)dlsym(dso, scrap);
-                //ALOGD_IF(f, "found <%s> instead", scrap);
-            }
-        }
-        if (f == nullptr) {
-            // Try with the OES postfix
-            ssize_t index = ssize_t(strlen(name)) - 3;
-            if (index>0 && strcmp(name+index, "OES")) {
-                snprintf(scrap, SIZE, "%sOES", name);
-                f = (__eglMustCastToProperFunctionPointerType)dlsym(dso, scrap);
-                //ALOGD_IF(f, "found <%s> instead", scrap);
-            }
-        }
-        if (f == nullptr) {
-            //ALOGD("%s", name);
-            f = (__eglMustCastToProperFunctionPointerType)gl_unimplemented;
-
-            /*
-             * GL_EXT_debug_label is special, we always report it as
-             * supported, it's handled by GLES_trace. If GLES_trace is not
-             * enabled, then these are no-ops.
-             */
-            if (!strcmp(name, "glInsertEventMarkerEXT")) {
-                f = (__eglMustCastToProperFunctionPointerType)gl_noop;
-            } else if (!strcmp(name, "glPushGroupMarkerEXT")) {
-                f = (__eglMustCastToProperFunctionPointerType)gl_noop;
-            } else if (!strcmp(name, "glPopGroupMarkerEXT")) {
-                f = (__eglMustCastToProperFunctionPointerType)gl_noop;
-            }
-        }
-        *curr++ = f;
+        *curr++ = resolve_gl_entry(dso, name, getProcAddress);
         api++;
         if (ref_api) ref_api++;
     }
 }
 
+// With debug.egl.lazy_entrypoints set, the GLESv2 hook table is not resolved when the driver
+// loads. Each slot instead starts out pointing at a stub that resolves the driver function on
+// its first call, records it in sLazyGl.resolved and patches the hook table so later calls go
+// straight to the driver. Processes that only use a handful of GL functions then skip the
+// thousand or so lookups. Layers may capture the stubs as their next pointers; the stubs always
+// forward through sLazyGl.resolved, never through the hook table, so that cannot recurse.
+static constexpr size_t kGlEntryCount =
+        sizeof(gl_hooks_t::gl_t) / sizeof(__eglMustCastToProperFunctionPointerType);
+
+static struct {
+    void* dso;
+    GetProcAddressFn getProcAddress;
+    __eglMustCastToProperFunctionPointerType* hooks;
+    std::atomic<__eglMustCastToProperFunctionPointerType> resolved[kGlEntryCount];
+} sLazyGl;
+
+static __eglMustCastToProperFunctionPointerType resolve_lazy_gl_entry(
+        size_t slot, __eglMustCastToProperFunctionPointerType stub) {
+    __eglMustCastToProperFunctionPointerType f = sLazyGl.resolved[slot].load();
+    if (f == nullptr) {
+        f = resolve_gl_entry(sLazyGl.dso, gl_names[slot], sLazyGl.getProcAddress);
+        sLazyGl.resolved[slot].store(f);
+        // Leave the slot alone if a layer has replaced the stub.
+        if (sLazyGl.hooks[slot] == stub) {
+            sLazyGl.hooks[slot] = f;
+        }
+    }
+    return f;
+}
+
+template <size_t Slot, typename Fn>
+struct LazyGlEntry;
+
+template <size_t Slot, typename R, typename... Args>
+struct LazyGlEntry<Slot, R (*)(Args...)> {
+    static R call(Args... args) {
+        __eglMustCastToProperFunctionPointerType f = resolve_lazy_gl_entry(
+                Slot, reinterpret_cast<__eglMustCastToProperFunctionPointerType>(&call));
+        return reinterpret_cast<R (*)(Args...)>(f)(args...);
+    }
+};
+
+#undef GL_ENTRY
+#define GL_ENTRY(_r, _api, ...)                                                   \
+    reinterpret_cast<__eglMustCastToProperFunctionPointerType>(                   \
+            &LazyGlEntry<offsetof(gl_hooks_t::gl_t, _api) /                       \
+                                 sizeof(__eglMustCastToProperFunctionPointerType), \
+                         decltype(gl_hooks_t::gl_t::_api)>::call),
+
+static const __eglMustCastToProperFunctionPointerType kLazyGlStubs[] = {
+    #include "../entries.in"
+};
+
+#undef GL_ENTRY
+
+static_assert(sizeof(kLazyGlStubs) / sizeof(kLazyGlStubs[0]) == kGlEntryCount,
+              "every GLES entry point needs a lazy stub");
+
+static void init_lazy_gl_api(void* dso, __eglMustCastToProperFunctionPointerType* curr,
+                             GetProcAddressFn getProcAddress) {
+    ATRACE_CALL();
+    sLazyGl.dso = dso;
+    sLazyGl.getProcAddress = getProcAddress;
+    sLazyGl.hooks = curr;
+    for (size_t i = 0; i < kGlEntryCount; i++) {
+        sLazyGl.resolved[i].store(nullptr);
+        curr[i] = kLazyGlStubs[i];
+    }
+}
+
 static void* load_system_driver(const char* kind, const char* suffix, const bool exact) {
     ATRACE_CALL();
     class MatchFile {
@@ -670,10 +753,14 @@ void Loader::initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask) {
     }
 
     if (mask & GLESv2) {
-        init_api(dso, gl_names, nullptr,
+        __eglMustCastToProperFunctionPointerType* curr =
             (__eglMustCastToProperFunctionPointerType*)
-                &cnx->hooks[egl_connection_t::GLESv2_INDEX]->gl,
-            getProcAddress);
+                &cnx->hooks[egl_connection_t::GLESv2_INDEX]->gl;
+        if (base::GetBoolProperty("debug.egl.lazy_entrypoints", false)) {
+            init_lazy_gl_api(dso, curr, getProcAddress);
+        } else {
+            init_api(dso, gl_names, nullptr, curr, getProcAddress);
+        }
     }
 }
 
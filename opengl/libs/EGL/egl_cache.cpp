@@ -171,6 +171,11 @@ void egl_cache_t::setCacheFilename(const char* filename) {
     mFilename = filename;
 }
 
+BlobCache::Stats egl_cache_t::getBlobCacheStats() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBlobCache ? mBlobCache->getStats() : BlobCache::Stats();
+}
+
 BlobCache* egl_cache_t::getBlobCacheLocked() {
     if (mBlobCache == nullptr) {
         mBlobCache.reset(new FileBlobCache(maxKeySize, maxValueSize, maxTotalSize, mFilename));
@@ -67,6 +67,10 @@ public:
     // cache contents from one program invocation to another.
     void setCacheFilename(const char* filename);
 
+    // getBlobCacheStats returns the hit, miss and eviction counters of the
+    // cache.  All counters are zero if the cache has not been used yet.
+    BlobCache::Stats getBlobCacheStats() const;
+
 private:
     // Creation and (the lack of) destruction is handled internally.
     egl_cache_t();
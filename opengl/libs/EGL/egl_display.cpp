@@ -85,7 +85,8 @@ int egl_get_init_count(EGLDisplay dpy) {
 egl_display_t egl_display_t::sDisplay[NUM_DISPLAYS];
 
 egl_display_t::egl_display_t() :
-    magic('_dpy'), finishOnSwap(false), traceGpuCompletion(false), refs(0), eglIsInitialized(false) {
+    magic('_dpy'), finishOnSwap(false), traceGpuCompletion(false), elideRedundantMakeCurrent(true),
+    refs(0), eglIsInitialized(false) {
 }
 
 egl_display_t::~egl_display_t() {
@@ -105,19 +106,29 @@ egl_display_t* egl_display_t::get(EGLDisplay dpy) {
     return &sDisplay[index];
 }
 
+egl_display_t::ObjectShard& egl_display_t::getObjectShard(egl_object_t* object) const {
+    // Objects are heap allocated, so the low bits carry little information.
+    uintptr_t key = reinterpret_cast<uintptr_t>(object);
+    key ^= key >> 12;
+    return objectShards[(key >> 6) % kNumObjectShards];
+}
+
 void egl_display_t::addObject(egl_object_t* object) {
-    std::lock_guard<std::mutex> _l(lock);
-    objects.insert(object);
+    ObjectShard& shard = getObjectShard(object);
+    std::lock_guard<std::mutex> _l(shard.lock);
+    shard.objects.insert(object);
 }
 
 void egl_display_t::removeObject(egl_object_t* object) {
-    std::lock_guard<std::mutex> _l(lock);
-    objects.erase(object);
+    ObjectShard& shard = getObjectShard(object);
+    std::lock_guard<std::mutex> _l(shard.lock);
+    shard.objects.erase(object);
 }
 
 bool egl_display_t::getObject(egl_object_t* object) const {
-    std::lock_guard<std::mutex> _l(lock);
-    if (objects.find(object) != objects.end()) {
+    ObjectShard& shard = getObjectShard(object);
+    std::lock_guard<std::mutex> _l(shard.lock);
+    if (shard.objects.find(object) != shard.objects.end()) {
         if (object->getDisplay() == this) {
             object->incRef();
             return true;
@@ -372,6 +383,8 @@ EGLBoolean egl_display_t::initialize(EGLint *major, EGLint *minor) {
 
         finishOnSwap = base::GetBoolProperty("debug.egl.finish", false);
         traceGpuCompletion = base::GetBoolProperty("debug.egl.traceGpuCompletion", false);
+        elideRedundantMakeCurrent =
+                base::GetBoolProperty("debug.egl.elideRedundantMakeCurrent", true);
 
         // TODO: If device doesn't provide 1.4 or 1.5 then we'll be
         // changing the behavior from the past where we always advertise
@@ -438,14 +451,20 @@ EGLBoolean egl_display_t::terminate() {
         // Mark all objects remaining in the list as terminated, unless
         // there are no reference to them, it which case, we're free to
         // delete them.
-        size_t count = objects.size();
-        ALOGW_IF(count, "eglTerminate() called w/ %zu objects remaining", count);
-        for (auto o : objects) {
-            o->destroy();
-        }
+        size_t count = 0;
+        for (auto& shard : objectShards) {
+            std::lock_guard<std::mutex> _sl(shard.lock);
+            count += shard.objects.size();
+            for (auto o : shard.objects) {
+                o->destroy();
+            }
 
-        // this marks all object handles are "terminated"
-        objects.clear();
+            // this marks all object handles are "terminated"
+            shard.objects.clear();
+        }
+        ALOGW_IF(count, "eglTerminate() called w/ %zu objects remaining", count);
+        ALOGV("eglTerminate(): %u of %u eglMakeCurrent() calls elided",
+              makeCurrentElidedCount.load(), makeCurrentCount.load());
     }
 
     { // scope for refLock
@@ -21,6 +21,8 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <string>
@@ -115,8 +117,14 @@ public:
     DisplayImpl     disp;
     bool    finishOnSwap;       // property: debug.egl.finish
     bool    traceGpuCompletion; // property: debug.egl.traceGpuCompletion
+    bool    elideRedundantMakeCurrent; // property: debug.egl.elideRedundantMakeCurrent
     bool    hasColorSpaceSupport;
 
+    // eglMakeCurrent() calls made on this display, and those that were not forwarded to the
+    // driver because the thread already had the same context and surfaces current.
+    std::atomic<uint32_t> makeCurrentCount{0};
+    std::atomic<uint32_t> makeCurrentElidedCount{0};
+
 private:
     friend class egl_display_ptr;
 
@@ -125,7 +133,17 @@ private:
     mutable std::mutex                  lock;
     mutable std::mutex                  refLock;
     mutable std::condition_variable     refCond;
-            std::unordered_set<egl_object_t*> objects;
+
+    // Objects are spread over several sets, each with its own lock, so that threads validating
+    // different objects (e.g. in eglSwapBuffers or eglMakeCurrent) rarely contend.
+    static constexpr size_t kNumObjectShards = 16;
+    struct alignas(64) ObjectShard {
+        std::mutex lock;
+        std::unordered_set<egl_object_t*> objects;
+    };
+    ObjectShard& getObjectShard(egl_object_t* object) const;
+    mutable std::array<ObjectShard, kNumObjectShards> objectShards;
+
             std::string mVendorString;
             std::string mVersionString;
             std::string mClientApiString;
@@ -1048,6 +1048,8 @@ EGLBoolean eglMakeCurrentImpl(  EGLDisplay dpy, EGLSurface draw,
     // these are the current objects structs
     egl_context_t * cur_c = get_context(getContext());
 
+    dp->makeCurrentCount++;
+
     if (ctx != EGL_NO_CONTEXT) {
         c = get_context(ctx);
         impl_ctx = c->context;
@@ -1078,6 +1080,13 @@ EGLBoolean eglMakeCurrentImpl(  EGLDisplay dpy, EGLSurface draw,
         impl_read = r->surface;
     }
 
+    // Everything passed in is valid, so if it is exactly what this thread already has current
+    // there is nothing for the driver, the hooks or the TLS to change; skip the round trip, which
+    // many clients make once per frame.
+    if (c && c == cur_c && c->draw == draw && c->read == read && dp->elideRedundantMakeCurrent) {
+        ATRACE_INT("EGL redundant makeCurrent", int32_t(++dp->makeCurrentElidedCount));
+        return EGL_TRUE;
+    }
 
     EGLBoolean result = dp->makeCurrent(c, cur_c,
             draw, read, ctx,
@@ -1425,7 +1434,8 @@ EGLBoolean eglSwapBuffersWithDamageKHRImpl(EGLDisplay dpy, EGLSurface draw,
         return s->cnx->egl.eglSwapBuffers(dp->disp.dpy, s->surface);
     }
 
-    std::vector<android_native_rect_t> androidRects((size_t)n_rects);
+    std::vector<android_native_rect_t> androidRects;
+    androidRects.reserve((size_t)n_rects);
     for (int r = 0; r < n_rects; ++r) {
         int offset = r * 4;
         int x = rects[offset];
@@ -161,6 +161,43 @@ TEST_F(EGLTest, EGLTerminateSucceedsWithRemainingObjects) {
     // eglTerminate is called in the tear down and should destroy it for us
 }
 
+TEST_F(EGLTest, EGLMakeCurrentRedundantCallsAreValidated) {
+    EGLint numConfigs;
+    EGLConfig config;
+    EGLint attrs[] = {
+        EGL_SURFACE_TYPE,       EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE,    EGL_OPENGL_ES2_BIT,
+        EGL_NONE
+    };
+    ASSERT_TRUE(eglChooseConfig(mEglDisplay, attrs, &config, 1, &numConfigs));
+    ASSERT_EQ(1, numConfigs);
+
+    EGLint contextAttrs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+    EGLContext eglContext = eglCreateContext(mEglDisplay, config, EGL_NO_CONTEXT, contextAttrs);
+    ASSERT_NE(EGL_NO_CONTEXT, eglContext);
+    EGLint surfaceAttrs[] = {EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE};
+    EGLSurface eglSurface = eglCreatePbufferSurface(mEglDisplay, config, surfaceAttrs);
+    ASSERT_NE(EGL_NO_SURFACE, eglSurface);
+
+    // Making the same context and surfaces current again must leave them current.
+    for (int i = 0; i < 3; i++) {
+        EXPECT_TRUE(eglMakeCurrent(mEglDisplay, eglSurface, eglSurface, eglContext));
+        EXPECT_EQ(EGL_SUCCESS, eglGetError());
+        EXPECT_EQ(eglContext, eglGetCurrentContext());
+        EXPECT_EQ(eglSurface, eglGetCurrentSurface(EGL_DRAW));
+        EXPECT_EQ(eglSurface, eglGetCurrentSurface(EGL_READ));
+    }
+
+    // A current surface that has been destroyed is still rejected.
+    EXPECT_TRUE(eglDestroySurface(mEglDisplay, eglSurface));
+    EXPECT_FALSE(eglMakeCurrent(mEglDisplay, eglSurface, eglSurface, eglContext));
+    EXPECT_EQ(EGL_BAD_SURFACE, eglGetError());
+
+    EXPECT_TRUE(eglMakeCurrent(mEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT));
+    EXPECT_EQ(EGL_NO_CONTEXT, eglGetCurrentContext());
+    EXPECT_TRUE(eglDestroyContext(mEglDisplay, eglContext));
+}
+
 TEST_F(EGLTest, EGLConfigRGBA8888First) {
 
     EGLint numConfigs;
@@ -14,9 +14,19 @@
 // limitations under the License.
 //
 
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <utility>
 
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 #include <gui/bufferqueue/2.0/B2HGraphicBufferProducer.h>
+#include <utils/Trace.h>
 
 #include "AutomotiveDisplayProxyService.h"
 
@@ -27,12 +37,73 @@ namespace display {
 namespace V1_0 {
 namespace implementation {
 
+using android::base::StringAppendF;
+
+
+FrameLatencyTracker::FrameLatencyTracker(uint64_t displayId)
+      : mTraceName(android::base::StringPrintf("EVS frame latency %lX",
+                                               (unsigned long)displayId)) {}
+
+
+void FrameLatencyTracker::onFramePresented(nsecs_t timestamp, const sp<Fence>& presentFence) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (presentFence != nullptr && presentFence->isValid()) {
+        if (mPending.size() == kMaxPendingFrames) {
+            mPending.pop_front();
+        }
+        mPending.push_back({timestamp, presentFence});
+    }
+
+    // Present fences signal in order, so stop at the first pending one.
+    while (!mPending.empty()) {
+        const nsecs_t presentTime = mPending.front().presentFence->getSignalTime();
+        if (presentTime == Fence::SIGNAL_TIME_PENDING) {
+            break;
+        }
+
+        const nsecs_t latency = presentTime - mPending.front().timestamp;
+        mPending.pop_front();
+        if (presentTime == Fence::SIGNAL_TIME_INVALID || latency < 0) {
+            // The producer used a timestamp that is not on the monotonic clock.
+            continue;
+        }
+
+        mMinLatency = mNumFrames == 0 ? latency : std::min(mMinLatency, latency);
+        mMaxLatency = std::max(mMaxLatency, latency);
+        mTotalLatency += latency;
+        mLastLatency = latency;
+        ++mNumFrames;
+        ATRACE_INT64(mTraceName.c_str(), latency);
+    }
+}
+
+
+void FrameLatencyTracker::dump(std::string* result) {
+    std::lock_guard<std::mutex> lock(mLock);
+    StringAppendF(result, "    frames presented: %" PRIu64 "\n", mNumFrames);
+    if (mNumFrames > 0) {
+        StringAppendF(result,
+                      "    queue to present latency (ms): last %.2f, min %.2f, avg %.2f, "
+                      "max %.2f\n",
+                      mLastLatency / 1e6, mMinLatency / 1e6,
+                      mTotalLatency / mNumFrames / 1e6, mMaxLatency / 1e6);
+    }
+}
+
+
+AutomotiveDisplayProxyService::AutomotiveDisplayProxyService()
+      : mLowLatency(android::base::GetBoolProperty("persist.automotive.display.low_latency",
+                                                   false)) {
+    ALOGI_IF(mLowLatency, "Camera frames are sent as buffer transactions.");
+}
+
 
 Return<sp<IGraphicBufferProducer>>
 AutomotiveDisplayProxyService::getIGraphicBufferProducer(uint64_t id) {
     auto it = mDisplays.find(id);
     sp<IBinder> displayToken = nullptr;
     sp<SurfaceControl> surfaceControl = nullptr;
+    sp<BLASTBufferQueue> blastBufferQueue = nullptr;
     if (it == mDisplays.end()) {
         displayToken = SurfaceComposerClient::getPhysicalDisplayToken(id);
         if (displayToken == nullptr) {
@@ -72,27 +143,55 @@ AutomotiveDisplayProxyService::getIGraphicBufferProducer(uint64_t id) {
         }
 
         // Create a SurfaceControl instance
+        uint32_t flags = ISurfaceComposerClient::eOpaque;
+        if (mLowLatency) {
+            flags |= ISurfaceComposerClient::eFXSurfaceBufferState;
+        }
         surfaceControl = surfaceClient->createSurface(
                 String8::format("AutomotiveDisplay::%lX", (unsigned long)id),
                 displayWidth, displayHeight,
-                PIXEL_FORMAT_RGBX_8888, ISurfaceComposerClient::eOpaque);
+                PIXEL_FORMAT_RGBX_8888, flags);
         if (surfaceControl == nullptr || !surfaceControl->isValid()) {
             ALOGE("Failed to create SurfaceControl.");
             return nullptr;
         }
 
+        std::shared_ptr<FrameLatencyTracker> latencyTracker = nullptr;
+        if (mLowLatency) {
+            // Each camera frame is sent as soon as it is queued.  A frame
+            // which is superseded before it could be sent is dropped, so that
+            // the display never falls behind the camera.
+            blastBufferQueue = new BLASTBufferQueue(surfaceControl, displayWidth, displayHeight,
+                                                    /*enableTripleBuffering=*/false);
+            blastBufferQueue->setDropSupersededFrames(true);
+
+            latencyTracker = std::make_shared<FrameLatencyTracker>(id);
+            blastBufferQueue->setFramePresentedListener(
+                    [latencyTracker](uint64_t /*frameNumber*/, nsecs_t timestamp,
+                                     nsecs_t /*latchTime*/, const sp<Fence>& presentFence) {
+                        latencyTracker->onFramePresented(timestamp, presentFence);
+                    });
+        }
+
         // Store
-        DisplayDesc descriptor = {displayToken, surfaceControl};
+        DisplayDesc descriptor = {displayToken, surfaceControl, blastBufferQueue,
+                                  std::move(latencyTracker)};
         mDisplays.insert_or_assign(id, std::move(descriptor));
     } else {
         displayToken = it->second.token;
         surfaceControl = it->second.surfaceControl;
+        blastBufferQueue = it->second.blastBufferQueue;
     }
 
-    // SurfaceControl::getSurface is guaranteed to be not null.
-    auto targetSurface = surfaceControl->getSurface();
+    sp<::android::IGraphicBufferProducer> producer;
+    if (blastBufferQueue != nullptr) {
+        producer = blastBufferQueue->getIGraphicBufferProducer();
+    } else {
+        // SurfaceControl::getSurface is guaranteed to be not null.
+        producer = surfaceControl->getSurface()->getIGraphicBufferProducer();
+    }
     return new ::android::hardware::graphics::bufferqueue::V2_0::utils::
-               B2HGraphicBufferProducer(targetSurface->getIGraphicBufferProducer());
+               B2HGraphicBufferProducer(producer);
 }
 
 
@@ -184,6 +283,31 @@ Return<void> AutomotiveDisplayProxyService::getDisplayInfo(uint64_t id, getDispl
 }
 
 
+Return<void> AutomotiveDisplayProxyService::debug(const hidl_handle& fd,
+                                                  const hidl_vec<hidl_string>& /*options*/) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("Invalid file descriptor for debug output.");
+        return hardware::Void();
+    }
+
+    std::string result;
+    StringAppendF(&result, "Low latency mode: %s\n", mLowLatency ? "on" : "off");
+    for (const auto& [id, descriptor] : mDisplays) {
+        StringAppendF(&result, "Display 0x%lX:\n", (unsigned long)id);
+        if (descriptor.latencyTracker != nullptr) {
+            descriptor.latencyTracker->dump(&result);
+        }
+    }
+
+    FILE* out = fdopen(dup(fd->data[0]), "w");
+    if (out != nullptr) {
+        fprintf(out, "%s", result.c_str());
+        fclose(out);
+    }
+    return hardware::Void();
+}
+
+
 }  // namespace implementation
 }  // namespace V1_0
 }  // namespace display
@@ -16,12 +16,17 @@
 #pragma once
 
 #include <android/frameworks/automotive/display/1.0/IAutomotiveDisplayProxyService.h>
+#include <gui/BLASTBufferQueue.h>
 #include <gui/IGraphicBufferProducer.h>
 #include <gui/ISurfaceComposer.h>
 #include <gui/Surface.h>
 #include <gui/SurfaceComposerClient.h>
 #include <ui/DisplayConfig.h>
 #include <ui/DisplayState.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -32,29 +37,76 @@ namespace display {
 namespace V1_0 {
 namespace implementation {
 
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 using ::android::hardware::graphics::bufferqueue::V2_0::IGraphicBufferProducer;
 using ::android::sp;
 
 
+// Measures the time from the timestamp a frame was queued with to the
+// present fence of the display frame that showed it.
+class FrameLatencyTracker {
+public:
+    explicit FrameLatencyTracker(uint64_t displayId);
+
+    // Called from the BLASTBufferQueue binder thread for every latched frame.
+    void onFramePresented(nsecs_t timestamp, const sp<Fence>& presentFence);
+
+    void dump(std::string* result);
+
+private:
+    struct PendingFrame {
+        nsecs_t        timestamp;
+        sp<Fence>      presentFence;
+    };
+
+    // Present fences of frames that may not have been shown yet.  Bounded, in
+    // case the display stops signalling them.
+    static constexpr size_t kMaxPendingFrames = 8;
+
+    std::mutex mLock;
+    const std::string mTraceName;
+    std::deque<PendingFrame> mPending;
+    uint64_t mNumFrames = 0;
+    nsecs_t  mLastLatency = 0;
+    nsecs_t  mMinLatency = 0;
+    nsecs_t  mMaxLatency = 0;
+    nsecs_t  mTotalLatency = 0;
+};
+
+
 typedef struct DisplayDesc {
     sp<IBinder>        token;
     sp<SurfaceControl> surfaceControl;
+
+    // Only set when frames are sent to SurfaceFlinger as buffer transactions.
+    sp<BLASTBufferQueue>                 blastBufferQueue;
+    std::shared_ptr<FrameLatencyTracker> latencyTracker;
 } DisplayDesc;
 
 
 class AutomotiveDisplayProxyService : public IAutomotiveDisplayProxyService {
 public:
+    AutomotiveDisplayProxyService();
+
     Return<sp<IGraphicBufferProducer>> getIGraphicBufferProducer(uint64_t id) override;
     Return<bool> showWindow(uint64_t id) override;
     Return<bool> hideWindow(uint64_t id) override;
     Return<void> getDisplayIdList(getDisplayIdList_cb _cb) override;
     Return<void> getDisplayInfo(uint64_t, getDisplayInfo_cb _cb) override;
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
 
 private:
     uint8_t getDisplayPort(const uint64_t id) { return (id & 0xF); }
 
     std::unordered_map<uint64_t, DisplayDesc> mDisplays;
+
+    // Whether to hand out BLAST producers, so that camera frames reach
+    // SurfaceFlinger as buffer transactions instead of being latched from a
+    // BufferQueue on the next vsync.
+    const bool mLowLatency;
 };
 
 }  // namespace implementation
@@ -107,35 +107,31 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
           appPackageName.c_str(), vulkanVersion, static_cast<int32_t>(driver), isDriverLoaded,
           driverLoadingTime);
 
-    if (!mGlobalStats.count(driverVersionCode)) {
-        GpuStatsGlobalInfo globalInfo;
-        addLoadingCount(driver, isDriverLoaded, &globalInfo);
+    auto [globalIt, globalInserted] = mGlobalStats.try_emplace(driverVersionCode);
+    GpuStatsGlobalInfo& globalInfo = globalIt->second;
+    if (globalInserted) {
         globalInfo.driverPackageName = driverPackageName;
         globalInfo.driverVersionName = driverVersionName;
         globalInfo.driverVersionCode = driverVersionCode;
         globalInfo.driverBuildTime = driverBuildTime;
         globalInfo.vulkanVersion = vulkanVersion;
-        mGlobalStats.insert({driverVersionCode, globalInfo});
-    } else {
-        addLoadingCount(driver, isDriverLoaded, &mGlobalStats[driverVersionCode]);
     }
+    addLoadingCount(driver, isDriverLoaded, &globalInfo);
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-    if (!mAppStats.count(appStatsKey)) {
-        if (mAppStats.size() >= MAX_NUM_APP_RECORDS) {
+    GpuStatsAppInfo* appInfo = findAppStatsLocked(appPackageName, driverVersionCode);
+    if (!appInfo) {
+        if (mNumAppStats >= MAX_NUM_APP_RECORDS) {
             ALOGV("GpuStatsAppInfo has reached maximum size. Ignore new stats.");
             return;
         }
 
-        GpuStatsAppInfo appInfo;
-        addLoadingTime(driver, driverLoadingTime, &appInfo);
-        appInfo.appPackageName = appPackageName;
-        appInfo.driverVersionCode = driverVersionCode;
-        mAppStats.insert({appStatsKey, appInfo});
-        return;
+        appInfo = &mAppStats[appPackageName][driverVersionCode];
+        appInfo->appPackageName = appPackageName;
+        appInfo->driverVersionCode = driverVersionCode;
+        mNumAppStats++;
     }
 
-    addLoadingTime(driver, driverLoadingTime, &mAppStats[appStatsKey]);
+    addLoadingTime(driver, driverLoadingTime, appInfo);
 }
 
 void GpuStats::insertTargetStats(const std::string& appPackageName,
@@ -143,29 +139,43 @@ void GpuStats::insertTargetStats(const std::string& appPackageName,
                                  const uint64_t /*value*/) {
     ATRACE_CALL();
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-
     std::lock_guard<std::mutex> lock(mLock);
     registerStatsdCallbacksIfNeeded();
-    if (!mAppStats.count(appStatsKey)) {
+    GpuStatsAppInfo* appInfo = findAppStatsLocked(appPackageName, driverVersionCode);
+    if (!appInfo) {
         return;
     }
 
     switch (stats) {
         case GpuStatsInfo::Stats::CPU_VULKAN_IN_USE:
-            mAppStats[appStatsKey].cpuVulkanInUse = true;
+            appInfo->cpuVulkanInUse = true;
             break;
         case GpuStatsInfo::Stats::FALSE_PREROTATION:
-            mAppStats[appStatsKey].falsePrerotation = true;
+            appInfo->falsePrerotation = true;
             break;
         case GpuStatsInfo::Stats::GLES_1_IN_USE:
-            mAppStats[appStatsKey].gles1InUse = true;
+            appInfo->gles1InUse = true;
             break;
         default:
             break;
     }
 }
 
+GpuStatsAppInfo* GpuStats::findAppStatsLocked(const std::string& appPackageName,
+                                              uint64_t driverVersionCode) {
+    auto appIt = mAppStats.find(appPackageName);
+    if (appIt == mAppStats.end()) {
+        return nullptr;
+    }
+    auto driverIt = appIt->second.find(driverVersionCode);
+    return driverIt == appIt->second.end() ? nullptr : &driverIt->second;
+}
+
+void GpuStats::clearAppStatsLocked() {
+    mAppStats.clear();
+    mNumAppStats = 0;
+}
+
 void GpuStats::interceptSystemDriverStatsLocked() {
     // Append cpuVulkanVersion and glesVersion to system driver stats
     if (!mGlobalStats.count(0) || mGlobalStats[0].glesVersion) {
@@ -228,13 +238,13 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
         }
 
         if (dumpApp) {
-            mAppStats.clear();
+            clearAppStatsLocked();
             clearAll = false;
         }
 
         if (clearAll) {
             mGlobalStats.clear();
-            mAppStats.clear();
+            clearAppStatsLocked();
         }
     }
 }
@@ -249,9 +259,11 @@ void GpuStats::dumpGlobalLocked(std::string* result) {
 }
 
 void GpuStats::dumpAppLocked(std::string* result) {
-    for (const auto& ele : mAppStats) {
-        result->append(ele.second.toString());
-        result->append("\n");
+    for (const auto& app : mAppStats) {
+        for (const auto& ele : app.second) {
+            result->append(ele.second.toString());
+            result->append("\n");
+        }
     }
 }
 
@@ -287,45 +299,58 @@ static std::string int64VectorToProtoByteString(const std::vector<int64_t>& valu
 AStatsManager_PullAtomCallbackReturn GpuStats::pullAppInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
+    // Every pull reports the stats collected since the previous one. Take them out under the lock
+    // and serialize them afterwards, so apps reporting stats meanwhile never wait on the
+    // serialization.
+    std::unordered_map<std::string, std::unordered_map<uint64_t, GpuStatsAppInfo>> appStats;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        appStats.swap(mAppStats);
+        mNumAppStats = 0;
+    }
 
     if (data) {
-        for (const auto& ele : mAppStats) {
-            AStatsEvent* event = AStatsEventList_addStatsEvent(data);
-            AStatsEvent_setAtomId(event, android::util::GPU_STATS_APP_INFO);
-            AStatsEvent_writeString(event, ele.second.appPackageName.c_str());
-            AStatsEvent_writeInt64(event, ele.second.driverVersionCode);
-
-            std::string bytes = int64VectorToProtoByteString(ele.second.glDriverLoadingTime);
-            AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
-
-            bytes = int64VectorToProtoByteString(ele.second.vkDriverLoadingTime);
-            AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
-
-            bytes = int64VectorToProtoByteString(ele.second.angleDriverLoadingTime);
-            AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
-
-            AStatsEvent_writeBool(event, ele.second.cpuVulkanInUse);
-            AStatsEvent_writeBool(event, ele.second.falsePrerotation);
-            AStatsEvent_writeBool(event, ele.second.gles1InUse);
-            AStatsEvent_build(event);
+        for (const auto& app : appStats) {
+            for (const auto& ele : app.second) {
+                AStatsEvent* event = AStatsEventList_addStatsEvent(data);
+                AStatsEvent_setAtomId(event, android::util::GPU_STATS_APP_INFO);
+                AStatsEvent_writeString(event, ele.second.appPackageName.c_str());
+                AStatsEvent_writeInt64(event, ele.second.driverVersionCode);
+
+                std::string bytes = int64VectorToProtoByteString(ele.second.glDriverLoadingTime);
+                AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
+
+                bytes = int64VectorToProtoByteString(ele.second.vkDriverLoadingTime);
+                AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
+
+                bytes = int64VectorToProtoByteString(ele.second.angleDriverLoadingTime);
+                AStatsEvent_writeByteArray(event, (const uint8_t*)bytes.c_str(), bytes.length());
+
+                AStatsEvent_writeBool(event, ele.second.cpuVulkanInUse);
+                AStatsEvent_writeBool(event, ele.second.falsePrerotation);
+                AStatsEvent_writeBool(event, ele.second.gles1InUse);
+                AStatsEvent_build(event);
+            }
         }
     }
 
-    mAppStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
 AStatsManager_PullAtomCallbackReturn GpuStats::pullGlobalInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
-    // flush cpuVulkanVersion and glesVersion to builtin driver stats
-    interceptSystemDriverStatsLocked();
+    // As with app stats, serialize outside the lock.
+    std::unordered_map<uint64_t, GpuStatsGlobalInfo> globalStats;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        // flush cpuVulkanVersion and glesVersion to builtin driver stats
+        interceptSystemDriverStatsLocked();
+        globalStats.swap(mGlobalStats);
+    }
 
     if (data) {
-        for (const auto& ele : mGlobalStats) {
+        for (const auto& ele : globalStats) {
             AStatsEvent* event = AStatsEventList_addStatsEvent(data);
             AStatsEvent_setAtomId(event, android::util::GPU_STATS_GLOBAL_INFO);
             AStatsEvent_writeString(event, ele.second.driverPackageName.c_str());
@@ -345,8 +370,6 @@ AStatsManager_PullAtomCallbackReturn GpuStats::pullGlobalInfoAtom(AStatsEventLis
         }
     }
 
-    mGlobalStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
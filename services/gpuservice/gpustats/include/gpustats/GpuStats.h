@@ -63,6 +63,11 @@ private:
     void dumpGlobalLocked(std::string* result);
     // Dump app stats
     void dumpAppLocked(std::string* result);
+    // Returns the app stats for the app and driver, or nullptr if there are none.
+    GpuStatsAppInfo* findAppStatsLocked(const std::string& appPackageName,
+                                        uint64_t driverVersionCode);
+    // Clear app stats
+    void clearAppStatsLocked();
     // Append cpuVulkanVersion and glesVersion to system driver stats
     void interceptSystemDriverStatsLocked();
     // Registers statsd callbacks if they have not already been registered
@@ -77,8 +82,11 @@ private:
     bool mStatsdRegistered = false;
     // Key is driver version code.
     std::unordered_map<uint64_t, GpuStatsGlobalInfo> mGlobalStats;
-    // Key is <app package name>+<driver version code>.
-    std::unordered_map<std::string, GpuStatsAppInfo> mAppStats;
+    // Outer key is app package name, inner key is driver version code. Keying by the package
+    // name on its own lets every report look its app up without building a new string.
+    std::unordered_map<std::string, std::unordered_map<uint64_t, GpuStatsAppInfo>> mAppStats;
+    // Number of GpuStatsAppInfo records in mAppStats.
+    size_t mNumAppStats = 0;
 };
 
 } // namespace android
@@ -193,6 +193,27 @@ TEST_F(GpuStatsTest, canDump3dApiVersion) {
     EXPECT_THAT(inputCommand(InputCommand::DUMP_GLOBAL), HasSubstr(expectedResult));
 }
 
+TEST_F(GpuStatsTest, canInsertTargetStatsPerDriver) {
+    mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
+                                 BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME, APP_PKG_NAME_1,
+                                 VULKAN_VERSION, GpuStatsInfo::Driver::GL, true,
+                                 DRIVER_LOADING_TIME_1);
+    mGpuStats->insertDriverStats(UPDATED_DRIVER_PKG_NAME, UPDATED_DRIVER_VER_NAME,
+                                 UPDATED_DRIVER_VER_CODE, UPDATED_DRIVER_BUILD_TIME, APP_PKG_NAME_1,
+                                 VULKAN_VERSION, GpuStatsInfo::Driver::GL_UPDATED, true,
+                                 DRIVER_LOADING_TIME_2);
+    mGpuStats->insertTargetStats(APP_PKG_NAME_1, UPDATED_DRIVER_VER_CODE,
+                                 GpuStatsInfo::Stats::GLES_1_IN_USE, 0);
+
+    const std::string result = inputCommand(InputCommand::DUMP_APP);
+    EXPECT_THAT(result, HasSubstr("gles1InUse = 0"));
+    EXPECT_THAT(result, HasSubstr("gles1InUse = 1"));
+    std::string expectedResult = "glDriverLoadingTime: " + std::to_string(DRIVER_LOADING_TIME_1);
+    EXPECT_THAT(result, HasSubstr(expectedResult));
+    expectedResult = "glDriverLoadingTime: " + std::to_string(DRIVER_LOADING_TIME_2);
+    EXPECT_THAT(result, HasSubstr(expectedResult));
+}
+
 TEST_F(GpuStatsTest, canNotInsertTargetStatsBeforeProperSetup) {
     mGpuStats->insertTargetStats(APP_PKG_NAME_1, BUILTIN_DRIVER_VER_CODE,
                                  GpuStatsInfo::Stats::CPU_VULKAN_IN_USE, 0);
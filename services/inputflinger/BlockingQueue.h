@@ -51,6 +51,20 @@ public:
         return t;
     };
 
+    /**
+     * Retrieve and remove all objects, oldest first.
+     * Blocks execution while queue is empty.
+     */
+    std::vector<T> popAll() {
+        std::vector<T> all;
+        all.reserve(mCapacity);
+        std::unique_lock lock(mLock);
+        android::base::ScopedLockAssertion assumeLock(mLock);
+        mHasElements.wait(lock, [this]() REQUIRES(mLock) { return !this->mQueue.empty(); });
+        std::swap(all, mQueue);
+        return all;
+    };
+
     /**
      * Add a new object to the queue.
      * Does not block.
@@ -69,10 +83,16 @@ public:
         return true;
     };
 
-    void erase(const std::function<bool(const T&)>& lambda) {
+    /**
+     * Remove the objects that lambda returns true for.
+     * Return the number of objects removed.
+     */
+    size_t erase(const std::function<bool(const T&)>& lambda) {
         std::scoped_lock lock(mLock);
+        const size_t oldSize = mQueue.size();
         mQueue.erase(std::remove_if(mQueue.begin(), mQueue.end(),
                 [&lambda](const T& t) { return lambda(t); }), mQueue.end());
+        return oldSize - mQueue.size();
     }
 
     /**
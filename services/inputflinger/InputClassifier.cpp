@@ -45,8 +45,9 @@ using namespace android::hardware::input;
 
 namespace android {
 
-//Max number of elements to store in mEvents.
-static constexpr size_t MAX_EVENTS = 5;
+// Max number of elements to store in mEvents. The HAL thread drains the whole queue on each
+// wakeup, so this only needs to cover the events that arrive during one slow HAL call.
+static constexpr size_t MAX_EVENTS = 16;
 
 template<class K, class V>
 static V getValueForKey(const std::unordered_map<K, V>& map, K key, V defaultValue) {
@@ -172,54 +173,99 @@ MotionClassifier::~MotionClassifier() {
  */
 void MotionClassifier::processEvents() {
     while (true) {
-        ClassifierEvent event = mEvents.pop();
-        bool halResponseOk = true;
-        switch (event.type) {
-            case ClassifierEventType::MOTION: {
-                NotifyMotionArgs* motionArgs = static_cast<NotifyMotionArgs*>(event.args.get());
-                common::V1_0::MotionEvent motionEvent =
-                        notifyMotionArgsToHalMotionEvent(*motionArgs);
-                Return<common::V1_0::Classification> response = mService->classify(motionEvent);
-                halResponseOk = response.isOk();
-                if (halResponseOk) {
-                    common::V1_0::Classification halClassification = response;
-                    updateClassification(motionArgs->deviceId, motionArgs->eventTime,
-                            getMotionClassification(halClassification));
-                }
-                break;
-            }
-            case ClassifierEventType::DEVICE_RESET: {
-                const int32_t deviceId = *(event.getDeviceId());
-                halResponseOk = mService->resetDevice(deviceId).isOk();
-                clearDeviceState(deviceId);
-                break;
-            }
-            case ClassifierEventType::HAL_RESET: {
-                halResponseOk = mService->reset().isOk();
-                clearClassifications();
-                break;
-            }
-            case ClassifierEventType::EXIT: {
-                clearClassifications();
+        // Take everything that queued up while the previous batch was being processed, so the
+        // reader thread only contends with this thread once per batch.
+        std::vector<ClassifierEvent> events = mEvents.popAll();
+        {
+            std::scoped_lock lock(mLock);
+            mMaxBatchSize = std::max(mMaxBatchSize, events.size());
+        }
+        for (const ClassifierEvent& event : events) {
+            if (!processEvent(event)) {
                 return;
             }
         }
-        if (!halResponseOk) {
-            ALOGE("Error communicating with InputClassifier HAL. "
-                    "Exiting MotionClassifier HAL thread");
+    }
+}
+
+bool MotionClassifier::processEvent(const ClassifierEvent& event) {
+    bool halResponseOk = true;
+    const nsecs_t startTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    switch (event.type) {
+        case ClassifierEventType::MOTION: {
+            NotifyMotionArgs* motionArgs = static_cast<NotifyMotionArgs*>(event.args.get());
+            common::V1_0::MotionEvent motionEvent =
+                    notifyMotionArgsToHalMotionEvent(*motionArgs);
+            Return<common::V1_0::Classification> response = mService->classify(motionEvent);
+            recordHalCall(systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
+            halResponseOk = response.isOk();
+            if (halResponseOk) {
+                common::V1_0::Classification halClassification = response;
+                updateClassification(motionArgs->deviceId, motionArgs->eventTime,
+                        getMotionClassification(halClassification));
+            }
+            break;
+        }
+        case ClassifierEventType::DEVICE_RESET: {
+            const int32_t deviceId = *(event.getDeviceId());
+            halResponseOk = mService->resetDevice(deviceId).isOk();
+            recordHalCall(systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
+            clearDeviceState(deviceId);
+            break;
+        }
+        case ClassifierEventType::HAL_RESET: {
+            halResponseOk = mService->reset().isOk();
+            recordHalCall(systemTime(SYSTEM_TIME_MONOTONIC) - startTime);
             clearClassifications();
-            return;
+            break;
+        }
+        case ClassifierEventType::EXIT: {
+            clearClassifications();
+            return false;
         }
     }
+    if (!halResponseOk) {
+        ALOGE("Error communicating with InputClassifier HAL. "
+                "Exiting MotionClassifier HAL thread");
+        clearClassifications();
+        return false;
+    }
+    return true;
+}
+
+void MotionClassifier::recordHalCall(nsecs_t duration) {
+    std::scoped_lock lock(mLock);
+    mHalCallLatency.addValue(ns2us(duration));
 }
 
 void MotionClassifier::enqueueEvent(ClassifierEvent&& event) {
-    bool eventAdded = mEvents.push(std::move(event));
-    if (!eventAdded) {
-        // If the queue is full, suspect the HAL is slow in processing the events.
-        ALOGE("Could not add the event to the queue. Resetting");
-        reset();
+    if (mEvents.push(std::move(event))) {
+        return;
     }
+    // The HAL is falling behind. Pending moves are superseded by the ones after them, so drop
+    // those first, and keep the downs, ups and resets the HAL needs to track the gesture.
+    // push() leaves the event alone when it fails, so it can be retried.
+    const size_t dropped = mEvents.erase([](const ClassifierEvent& queued) {
+        return queued.type == ClassifierEventType::MOTION &&
+                static_cast<const NotifyMotionArgs*>(queued.args.get())->action ==
+                        AMOTION_EVENT_ACTION_MOVE;
+    });
+    if (dropped != 0) {
+        {
+            std::scoped_lock lock(mLock);
+            mDroppedEvents += dropped;
+        }
+        if (mEvents.push(std::move(event))) {
+            return;
+        }
+    }
+    // If the queue is still full, suspect the HAL is stuck.
+    ALOGE("Could not add the event to the queue. Resetting");
+    {
+        std::scoped_lock lock(mLock);
+        mQueueResets++;
+    }
+    reset();
 }
 
 void MotionClassifier::requestExit() {
@@ -312,6 +358,14 @@ void MotionClassifier::dump(std::string& dump) {
     dump += StringPrintf(INDENT2 "mService status: %s\n", getServiceStatus());
     dump += StringPrintf(INDENT2 "mEvents: %zu element(s) (max=%zu)\n",
             mEvents.size(), MAX_EVENTS);
+    dump += StringPrintf(INDENT2 "HAL call latency (us): p50=%" PRId64 " p90=%" PRId64
+                                 " p99=%" PRId64 " max=%" PRId64 " (%zu calls)\n",
+                         mHalCallLatency.getPercentile(50), mHalCallLatency.getPercentile(90),
+                         mHalCallLatency.getPercentile(99), mHalCallLatency.getMax(),
+                         mHalCallLatency.getCount());
+    dump += StringPrintf(INDENT2 "Dropped moves: %" PRIu64 ", queue resets: %" PRIu64
+                                 ", max batch: %zu\n",
+                         mDroppedEvents, mQueueResets, mMaxBatchSize);
     dump += INDENT2 "mClassifications, mLastDownTimes:\n";
     dump += INDENT3 "Device Id\tClassification\tLast down time";
     // Combine mClassifications and mLastDownTimes into a single table.
@@ -18,6 +18,7 @@
 #define _UI_INPUT_CLASSIFIER_H
 
 #include <android-base/thread_annotations.h>
+#include <input/LatencyStatistics.h>
 #include <utils/RefBase.h>
 #include <thread>
 #include <unordered_map>
@@ -162,6 +163,10 @@ private:
      * Process events and call the InputClassifier HAL
      */
     void processEvents();
+    /**
+     * Send one event to the HAL. Return false if the thread should exit.
+     */
+    bool processEvent(const ClassifierEvent& event);
     /**
      * Access to the InputClassifier HAL. May be null if init() hasn't completed yet.
      * When init() successfully completes, mService is guaranteed to remain non-null and to not
@@ -204,6 +209,20 @@ private:
 
     void clearDeviceState(int32_t deviceId);
 
+    /**
+     * Metrics about the HAL keeping up with the events.
+     */
+    // Duration of each HAL call, in microseconds.
+    LatencyHistogram mHalCallLatency GUARDED_BY(mLock);
+    // Pending move events dropped because the queue was full.
+    uint64_t mDroppedEvents GUARDED_BY(mLock) = 0;
+    // Times the queue was full without any move events to drop, and was reset.
+    uint64_t mQueueResets GUARDED_BY(mLock) = 0;
+    // Largest number of events sent to the HAL from one wakeup of the HAL thread.
+    size_t mMaxBatchSize GUARDED_BY(mLock) = 0;
+
+    void recordHalCall(nsecs_t duration);
+
     /**
      * Exit the InputClassifier HAL thread.
      * Useful for tests to ensure proper cleanup.
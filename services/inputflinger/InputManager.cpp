@@ -24,8 +24,10 @@
 
 #include <binder/IPCThreadState.h>
 
+#include <inttypes.h>
 #include <log/log.h>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <private/android_filesystem_config.h>
 
@@ -118,6 +120,49 @@ void InputManager::setInputWindows(const std::vector<InputWindowInfo>& infos,
     }
 }
 
+void InputManager::updateInputWindows(const InputWindowsUpdate& update,
+        const sp<ISetInputWindowsListener>& setInputWindowsListener) {
+    std::unordered_map<int32_t, std::vector<sp<InputWindowHandle>>> handlesPerDisplay;
+    { // acquire lock
+        std::scoped_lock _l(mWindowsLock);
+        std::unordered_set<int32_t> changedDisplays;
+        if (!mWindowsState.apply(update, &changedDisplays)) {
+            ALOGW("Dropped input windows update %" PRIu64 ", waiting for a full sync",
+                  update.sequence);
+        } else {
+            if (update.fullSync) {
+                mWindowHandlesById.clear();
+            }
+            for (int32_t id : update.removed) {
+                mWindowHandlesById.erase(id);
+            }
+            for (const InputWindowInfo& info : update.changed) {
+                mWindowHandlesById[info.id] = new BinderWindowHandle(info);
+            }
+
+            // Only the displays that changed are handed to the dispatcher. An empty list
+            // removes the last windows of a display.
+            for (int32_t displayId : changedDisplays) {
+                handlesPerDisplay.emplace(displayId, std::vector<sp<InputWindowHandle>>());
+            }
+            for (int32_t id : mWindowsState.getOrder()) {
+                const sp<InputWindowHandle>& handle = mWindowHandlesById[id];
+                auto it = handlesPerDisplay.find(handle->getInfo()->displayId);
+                if (it != handlesPerDisplay.end()) {
+                    it->second.push_back(handle);
+                }
+            }
+        }
+    } // release lock
+
+    if (!handlesPerDisplay.empty()) {
+        mDispatcher->setInputWindows(handlesPerDisplay);
+    }
+    if (setInputWindowsListener) {
+        setInputWindowsListener->onSetInputWindowsFinished();
+    }
+}
+
 // Used by tests only.
 void InputManager::registerInputChannel(const sp<InputChannel>& channel) {
     IPCThreadState* ipc = IPCThreadState::self();
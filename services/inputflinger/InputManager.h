@@ -26,6 +26,7 @@
 
 #include <InputDispatcherInterface.h>
 #include <InputDispatcherPolicyInterface.h>
+#include <android-base/thread_annotations.h>
 #include <input/ISetInputWindowsListener.h>
 #include <input/Input.h>
 #include <input/InputTransport.h>
@@ -36,6 +37,9 @@
 #include <utils/Timers.h>
 #include <utils/RefBase.h>
 
+#include <mutex>
+#include <unordered_map>
+
 namespace android {
 class InputChannel;
 class InputDispatcherThread;
@@ -96,6 +100,8 @@ public:
 
     virtual void setInputWindows(const std::vector<InputWindowInfo>& handles,
             const sp<ISetInputWindowsListener>& setInputWindowsListener);
+    virtual void updateInputWindows(const InputWindowsUpdate& update,
+            const sp<ISetInputWindowsListener>& setInputWindowsListener);
 
     virtual void registerInputChannel(const sp<InputChannel>& channel);
     virtual void unregisterInputChannel(const sp<InputChannel>& channel);
@@ -108,6 +114,13 @@ private:
     sp<InputClassifierInterface> mClassifier;
 
     sp<InputDispatcherInterface> mDispatcher;
+
+    // Window list received through updateInputWindows.
+    std::mutex mWindowsLock;
+    InputWindowsState mWindowsState GUARDED_BY(mWindowsLock);
+    // Handles are never modified once handed to the dispatcher; a changed window gets a new one.
+    std::unordered_map<int32_t, sp<InputWindowHandle>> mWindowHandlesById
+            GUARDED_BY(mWindowsLock);
 };
 
 } // namespace android
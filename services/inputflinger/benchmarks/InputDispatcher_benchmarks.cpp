@@ -17,6 +17,7 @@
 #include <benchmark/benchmark.h>
 
 #include <binder/Binder.h>
+#include <input/LatencyStatistics.h>
 #include "../dispatcher/InputDispatcher.h"
 
 namespace android::inputdispatcher {
@@ -35,6 +36,24 @@ static nsecs_t now() {
     return systemTime(SYSTEM_TIME_MONOTONIC);
 }
 
+struct PointF {
+    float x;
+    float y;
+};
+
+/**
+ * Reports the throughput as items per second, and the distribution of the time from each event
+ * to its arrival at the receiver, in microseconds.
+ */
+static void reportEvents(benchmark::State& state, int64_t eventsPerIteration,
+                         const LatencyHistogram& latency) {
+    state.SetItemsProcessed(state.iterations() * eventsPerIteration);
+    state.counters["p50_us"] = latency.getPercentile(50);
+    state.counters["p90_us"] = latency.getPercentile(90);
+    state.counters["p99_us"] = latency.getPercentile(99);
+    state.counters["max_us"] = latency.getMax();
+}
+
 // --- FakeInputDispatcherPolicy ---
 
 class FakeInputDispatcherPolicy : public InputDispatcherPolicyInterface {
@@ -105,9 +124,13 @@ public:
 
 class FakeInputReceiver {
 public:
-    void consumeEvent() {
-        uint32_t consumeSeq;
-        InputEvent* event;
+    /**
+     * Returns the next event, or nullptr if none arrived in time. The event is valid until the
+     * next call, and must be finished by the caller. If latency is not null, the time since the
+     * event (its newest sample, for a batch of moves) is added to it.
+     */
+    InputEvent* receiveEvent(uint32_t* outSeq, LatencyHistogram* latency = nullptr) {
+        InputEvent* event = nullptr;
 
         std::chrono::time_point start = std::chrono::steady_clock::now();
         status_t result = WOULD_BLOCK;
@@ -117,18 +140,38 @@ public:
                 ALOGE("Waited too long for consumer to produce an event, giving up");
                 break;
             }
-            result = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, -1, &consumeSeq,
+            result = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, -1, outSeq,
                                         &event);
         }
         if (result != OK) {
             ALOGE("Received result = %d from consume()", result);
+            return nullptr;
         }
-        result = mConsumer->sendFinishedSignal(consumeSeq, true);
+        if (latency != nullptr) {
+            if (event->getType() == AINPUT_EVENT_TYPE_KEY) {
+                latency->addValue(ns2us(now() - static_cast<KeyEvent*>(event)->getEventTime()));
+            } else if (event->getType() == AINPUT_EVENT_TYPE_MOTION) {
+                latency->addValue(
+                        ns2us(now() - static_cast<MotionEvent*>(event)->getEventTime()));
+            }
+        }
+        return event;
+    }
+
+    void finishEvent(uint32_t seq) {
+        status_t result = mConsumer->sendFinishedSignal(seq, true);
         if (result != OK) {
             ALOGE("Received result = %d from sendFinishedSignal", result);
         }
     }
 
+    void consumeEvent(LatencyHistogram* latency = nullptr) {
+        uint32_t consumeSeq;
+        if (receiveEvent(&consumeSeq, latency) != nullptr) {
+            finishEvent(consumeSeq);
+        }
+    }
+
 protected:
     explicit FakeInputReceiver(const sp<InputDispatcher>& dispatcher, const std::string name)
           : mDispatcher(dispatcher) {
@@ -144,14 +187,24 @@ protected:
     PreallocatedInputEventFactory mEventFactory;
 };
 
+class FakeMonitorReceiver : public FakeInputReceiver, public RefBase {
+public:
+    FakeMonitorReceiver(const sp<InputDispatcher>& dispatcher, const std::string name,
+                        bool isGestureMonitor)
+          : FakeInputReceiver(dispatcher, name) {
+        mDispatcher->registerInputMonitor(mServerChannel, ADISPLAY_ID_DEFAULT, isGestureMonitor);
+    }
+};
+
 class FakeWindowHandle : public InputWindowHandle, public FakeInputReceiver {
 public:
     static const int32_t WIDTH = 200;
     static const int32_t HEIGHT = 200;
 
     FakeWindowHandle(const sp<InputApplicationHandle>& inputApplicationHandle,
-                     const sp<InputDispatcher>& dispatcher, const std::string name)
-          : FakeInputReceiver(dispatcher, name), mFrame(Rect(0, 0, WIDTH, HEIGHT)) {
+                     const sp<InputDispatcher>& dispatcher, const std::string name,
+                     const Rect& frame = Rect(0, 0, WIDTH, HEIGHT), int32_t flags = 0)
+          : FakeInputReceiver(dispatcher, name), mFrame(frame), mFlags(flags) {
         mDispatcher->registerInputChannel(mServerChannel);
 
         inputApplicationHandle->updateInfo();
@@ -161,7 +214,7 @@ public:
     virtual bool updateInfo() override {
         mInfo.token = mServerChannel->getConnectionToken();
         mInfo.name = "FakeWindowHandle";
-        mInfo.layoutParamsFlags = 0;
+        mInfo.layoutParamsFlags = mFlags;
         mInfo.layoutParamsType = InputWindowInfo::TYPE_APPLICATION;
         mInfo.dispatchingTimeout = DISPATCHING_TIMEOUT.count();
         mInfo.frameLeft = mFrame.left;
@@ -173,7 +226,7 @@ public:
         mInfo.addTouchableRegion(mFrame);
         mInfo.visible = true;
         mInfo.canReceiveKeys = true;
-        mInfo.hasFocus = true;
+        mInfo.hasFocus = mHasFocus;
         mInfo.hasWallpaper = false;
         mInfo.paused = false;
         mInfo.ownerPid = INJECTOR_PID;
@@ -184,8 +237,13 @@ public:
         return true;
     }
 
+    // Takes effect at the next setInputWindows().
+    void setFocus(bool hasFocus) { mHasFocus = hasFocus; }
+
 protected:
     Rect mFrame;
+    int32_t mFlags;
+    bool mHasFocus = true;
 };
 
 static MotionEvent generateMotionEvent() {
@@ -215,32 +273,66 @@ static MotionEvent generateMotionEvent() {
     return event;
 }
 
-static NotifyMotionArgs generateMotionArgs() {
-    PointerProperties pointerProperties[1];
-    PointerCoords pointerCoords[1];
-
-    pointerProperties[0].clear();
-    pointerProperties[0].id = 0;
-    pointerProperties[0].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
-
-    pointerCoords[0].clear();
-    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, 100);
-    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, 100);
+static NotifyMotionArgs generateMotionArgs(int32_t action, int32_t source,
+                                           const std::vector<PointF>& points) {
+    const size_t pointerCount = points.size();
+    PointerProperties pointerProperties[pointerCount];
+    PointerCoords pointerCoords[pointerCount];
+
+    for (size_t i = 0; i < pointerCount; i++) {
+        pointerProperties[i].clear();
+        pointerProperties[i].id = i;
+        pointerProperties[i].toolType = source == AINPUT_SOURCE_MOUSE
+                ? AMOTION_EVENT_TOOL_TYPE_MOUSE
+                : AMOTION_EVENT_TOOL_TYPE_FINGER;
+
+        pointerCoords[i].clear();
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_X, points[i].x);
+        pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_Y, points[i].y);
+    }
 
     const nsecs_t currentTime = now();
     // Define a valid motion event.
-    NotifyMotionArgs args(/* id */ 0, currentTime, DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN,
-                          ADISPLAY_ID_DEFAULT, POLICY_FLAG_PASS_TO_USER, AMOTION_EVENT_ACTION_DOWN,
-                          /* actionButton */ 0, /* flags */ 0, AMETA_NONE, /* buttonState */ 0,
-                          MotionClassification::NONE, AMOTION_EVENT_EDGE_FLAG_NONE, 1,
-                          pointerProperties, pointerCoords,
-                          /* xPrecision */ 0, /* yPrecision */ 0,
+    NotifyMotionArgs args(/* id */ 0, currentTime, DEVICE_ID, source, ADISPLAY_ID_DEFAULT,
+                          POLICY_FLAG_PASS_TO_USER, action, /* actionButton */ 0, /* flags */ 0,
+                          AMETA_NONE, /* buttonState */ 0, MotionClassification::NONE,
+                          AMOTION_EVENT_EDGE_FLAG_NONE, pointerCount, pointerProperties,
+                          pointerCoords, /* xPrecision */ 0, /* yPrecision */ 0,
                           AMOTION_EVENT_INVALID_CURSOR_POSITION,
                           AMOTION_EVENT_INVALID_CURSOR_POSITION, currentTime, /* videoFrames */ {});
 
     return args;
 }
 
+static NotifyMotionArgs generateMotionArgs() {
+    return generateMotionArgs(AMOTION_EVENT_ACTION_DOWN, AINPUT_SOURCE_TOUCHSCREEN,
+                              {{100, 100}});
+}
+
+static NotifyKeyArgs generateKeyArgs(int32_t action) {
+    const nsecs_t currentTime = now();
+    // Define a valid key event.
+    NotifyKeyArgs args(/* id */ 0, currentTime, DEVICE_ID, AINPUT_SOURCE_KEYBOARD,
+                       ADISPLAY_ID_NONE, POLICY_FLAG_PASS_TO_USER, action, /* flags */ 0,
+                       AKEYCODE_A, /* scanCode */ 30, AMETA_NONE, currentTime);
+
+    return args;
+}
+
+/**
+ * Sends a motion event like the reader would, with a new id and the current time.
+ */
+static void notifyMotion(const sp<InputDispatcher>& dispatcher, NotifyMotionArgs& motionArgs,
+                         int32_t action) {
+    motionArgs.action = action;
+    motionArgs.id++;
+    motionArgs.eventTime = now();
+    if (action == AMOTION_EVENT_ACTION_DOWN) {
+        motionArgs.downTime = motionArgs.eventTime;
+    }
+    dispatcher->notifyMotion(&motionArgs);
+}
+
 static void benchmarkNotifyMotion(benchmark::State& state) {
     // Create dispatcher
     sp<FakeInputDispatcherPolicy> fakePolicy = new FakeInputDispatcherPolicy();
@@ -255,6 +347,7 @@ static void benchmarkNotifyMotion(benchmark::State& state) {
     dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
 
     NotifyMotionArgs motionArgs = generateMotionArgs();
+    LatencyHistogram latency;
 
     for (auto _ : state) {
         // Send ACTION_DOWN
@@ -270,11 +363,12 @@ static void benchmarkNotifyMotion(benchmark::State& state) {
         motionArgs.eventTime = now();
         dispatcher->notifyMotion(&motionArgs);
 
-        window->consumeEvent();
-        window->consumeEvent();
+        window->consumeEvent(&latency);
+        window->consumeEvent(&latency);
     }
 
     dispatcher->stop();
+    reportEvents(state, 2, latency);
 }
 
 static void benchmarkInjectMotion(benchmark::State& state) {
@@ -290,6 +384,8 @@ static void benchmarkInjectMotion(benchmark::State& state) {
 
     dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
 
+    LatencyHistogram latency;
+
     for (auto _ : state) {
         MotionEvent event = generateMotionEvent();
         // Send ACTION_DOWN
@@ -303,15 +399,359 @@ static void benchmarkInjectMotion(benchmark::State& state) {
                                      INPUT_EVENT_INJECTION_SYNC_NONE, INJECT_EVENT_TIMEOUT,
                                      POLICY_FLAG_FILTERED | POLICY_FLAG_PASS_TO_USER);
 
-        window->consumeEvent();
-        window->consumeEvent();
+        window->consumeEvent(&latency);
+        window->consumeEvent(&latency);
+    }
+
+    dispatcher->stop();
+    reportEvents(state, 2, latency);
+}
+
+/**
+ * Touch the bottom-most of state.range(0) windows. The other windows are tiled over the display
+ * in front of it like split screen, picture-in-picture and overlay windows, none of them covering
+ * the touched point, so hit-testing has to look past all of them.
+ */
+static void benchmarkNotifyMotionManyWindows(benchmark::State& state) {
+    sp<FakeInputDispatcherPolicy> fakePolicy = new FakeInputDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    std::vector<sp<InputWindowHandle>> windows;
+    const int32_t count = state.range(0);
+    for (int32_t i = 0; i < count - 1; i++) {
+        // 8 columns of 100x100 windows starting below the touched point.
+        const int32_t left = (i % 8) * 100;
+        const int32_t top = 200 + (i / 8) * 100;
+        windows.push_back(new FakeWindowHandle(application, dispatcher,
+                                               "Overlay " + std::to_string(i),
+                                               Rect(left, top, left + 100, top + 100),
+                                               InputWindowInfo::FLAG_NOT_TOUCH_MODAL));
+    }
+    sp<FakeWindowHandle> window =
+            new FakeWindowHandle(application, dispatcher, "Fake Window",
+                                 Rect(0, 0, 1000, 2000), InputWindowInfo::FLAG_NOT_TOUCH_MODAL);
+    windows.push_back(window);
+
+    dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, windows}});
+
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+    LatencyHistogram latency;
+
+    for (auto _ : state) {
+        motionArgs.action = AMOTION_EVENT_ACTION_DOWN;
+        motionArgs.id = 0;
+        motionArgs.downTime = now();
+        motionArgs.eventTime = motionArgs.downTime;
+        dispatcher->notifyMotion(&motionArgs);
+
+        motionArgs.action = AMOTION_EVENT_ACTION_UP;
+        motionArgs.id = 1;
+        motionArgs.eventTime = now();
+        dispatcher->notifyMotion(&motionArgs);
+
+        window->consumeEvent(&latency);
+        window->consumeEvent(&latency);
+    }
+
+    dispatcher->stop();
+    reportEvents(state, 2, latency);
+}
+
+/**
+ * Cost of querying the hit-testing index on its own, against the same layout as above.
+ */
+static void benchmarkTouchWindowIndexQuery(benchmark::State& state) {
+    sp<FakeInputDispatcherPolicy> fakePolicy = new FakeInputDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(fakePolicy);
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    std::vector<sp<InputWindowHandle>> windows;
+    const int32_t count = state.range(0);
+    for (int32_t i = 0; i < count; i++) {
+        const int32_t left = (i % 8) * 100;
+        const int32_t top = 200 + (i / 8) * 100;
+        const Rect frame = i == count - 1 ? Rect(0, 0, 1000, 2000)
+                                          : Rect(left, top, left + 100, top + 100);
+        windows.push_back(new FakeWindowHandle(application, dispatcher,
+                                               "Window " + std::to_string(i), frame,
+                                               InputWindowInfo::FLAG_NOT_TOUCH_MODAL));
+        windows.back()->updateInfo();
+    }
+    TouchWindowIndex index;
+    index.update(windows);
+
+    for (auto _ : state) {
+        sp<InputWindowHandle> touched;
+        index.forEachCandidate(100, 100, [&](const sp<InputWindowHandle>& windowHandle) {
+            if (!windowHandle->getInfo()->touchableRegionContainsPoint(100, 100)) {
+                return false;
+            }
+            touched = windowHandle;
+            return true;
+        });
+        benchmark::DoNotOptimize(touched);
+    }
+}
+
+/**
+ * A two finger gesture split across two windows side by side, so that every event after the
+ * first is split between them.
+ */
+static void benchmarkNotifyMotionSplitTouch(benchmark::State& state) {
+    sp<FakeInputDispatcherPolicy> fakePolicy = new FakeInputDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    const int32_t flags = InputWindowInfo::FLAG_NOT_TOUCH_MODAL | InputWindowInfo::FLAG_SPLIT_TOUCH;
+    sp<FakeWindowHandle> left =
+            new FakeWindowHandle(application, dispatcher, "Left", Rect(0, 0, 500, 1000), flags);
+    sp<FakeWindowHandle> right =
+            new FakeWindowHandle(application, dispatcher, "Right", Rect(500, 0, 1000, 1000), flags);
+    // Neither window is focused, so they receive only the motion events.
+    left->setFocus(false);
+    right->setFocus(false);
+
+    dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {left, right}}});
+
+    const int32_t pointerDown = AMOTION_EVENT_ACTION_POINTER_DOWN |
+            (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+    const int32_t pointerUp = AMOTION_EVENT_ACTION_POINTER_UP |
+            (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+    NotifyMotionArgs oneFinger =
+            generateMotionArgs(AMOTION_EVENT_ACTION_DOWN, AINPUT_SOURCE_TOUCHSCREEN, {{100, 100}});
+    NotifyMotionArgs twoFingers =
+            generateMotionArgs(pointerDown, AINPUT_SOURCE_TOUCHSCREEN, {{100, 100}, {600, 100}});
+    LatencyHistogram latency;
+
+    for (auto _ : state) {
+        // Each window gets its part of every event that has one of its pointers: the left
+        // window 5 events, the right window 3.
+        notifyMotion(dispatcher, oneFinger, AMOTION_EVENT_ACTION_DOWN);
+        left->consumeEvent(&latency);
+
+        twoFingers.id = oneFinger.id;
+        twoFingers.downTime = oneFinger.downTime;
+        notifyMotion(dispatcher, twoFingers, pointerDown);
+        left->consumeEvent(&latency);
+        right->consumeEvent(&latency);
+
+        notifyMotion(dispatcher, twoFingers, AMOTION_EVENT_ACTION_MOVE);
+        left->consumeEvent(&latency);
+        right->consumeEvent(&latency);
+
+        notifyMotion(dispatcher, twoFingers, pointerUp);
+        left->consumeEvent(&latency);
+        right->consumeEvent(&latency);
+
+        oneFinger.id = twoFingers.id;
+        notifyMotion(dispatcher, oneFinger, AMOTION_EVENT_ACTION_UP);
+        left->consumeEvent(&latency);
+    }
+
+    dispatcher->stop();
+    reportEvents(state, 8, latency);
+}
+
+/**
+ * A tap on a window while a global monitor and a gesture monitor are registered on the display,
+ * so every event goes to three connections.
+ */
+static void benchmarkNotifyMotionWithMonitors(benchmark::State& state) {
+    sp<FakeInputDispatcherPolicy> fakePolicy = new FakeInputDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    sp<FakeWindowHandle> window = new FakeWindowHandle(application, dispatcher, "Fake Window");
+    sp<FakeMonitorReceiver> globalMonitor =
+            new FakeMonitorReceiver(dispatcher, "Global Monitor", false /*isGestureMonitor*/);
+    sp<FakeMonitorReceiver> gestureMonitor =
+            new FakeMonitorReceiver(dispatcher, "Gesture Monitor", true /*isGestureMonitor*/);
+    window->setFocus(false);
+
+    dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
+
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+    LatencyHistogram latency;
+
+    for (auto _ : state) {
+        notifyMotion(dispatcher, motionArgs, AMOTION_EVENT_ACTION_DOWN);
+        notifyMotion(dispatcher, motionArgs, AMOTION_EVENT_ACTION_UP);
+
+        for (FakeInputReceiver* receiver :
+             {static_cast<FakeInputReceiver*>(window.get()),
+              static_cast<FakeInputReceiver*>(globalMonitor.get()),
+              static_cast<FakeInputReceiver*>(gestureMonitor.get())}) {
+            receiver->consumeEvent(&latency);
+            receiver->consumeEvent(&latency);
+        }
+    }
+
+    dispatcher->stop();
+    reportEvents(state, 6, latency);
+}
+
+/**
+ * A key press after focus moves to the other of two windows, as when the user switches apps with
+ * the keyboard. Only the keys count towards the latency; the focus events are drained.
+ */
+static void benchmarkNotifyKeyFocusSwitch(benchmark::State& state) {
+    sp<FakeInputDispatcherPolicy> fakePolicy = new FakeInputDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    sp<FakeWindowHandle> windows[] = {
+            new FakeWindowHandle(application, dispatcher, "First", Rect(0, 0, 500, 1000)),
+            new FakeWindowHandle(application, dispatcher, "Second", Rect(500, 0, 1000, 1000)),
+    };
+    windows[1]->setFocus(false);
+    dispatcher->setFocusedApplication(ADISPLAY_ID_DEFAULT, application);
+    dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {windows[0], windows[1]}}});
+    windows[0]->consumeEvent();
+
+    NotifyKeyArgs keyArgs = generateKeyArgs(AKEY_EVENT_ACTION_DOWN);
+    LatencyHistogram latency;
+    size_t focused = 0;
+
+    for (auto _ : state) {
+        windows[focused]->setFocus(false);
+        focused = 1 - focused;
+        windows[focused]->setFocus(true);
+        dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {windows[0], windows[1]}}});
+
+        keyArgs.action = AKEY_EVENT_ACTION_DOWN;
+        keyArgs.id++;
+        keyArgs.eventTime = keyArgs.downTime = now();
+        dispatcher->notifyKey(&keyArgs);
+
+        keyArgs.action = AKEY_EVENT_ACTION_UP;
+        keyArgs.id++;
+        keyArgs.eventTime = now();
+        dispatcher->notifyKey(&keyArgs);
+
+        windows[1 - focused]->consumeEvent(); // lost focus
+        windows[focused]->consumeEvent();     // gained focus
+        windows[focused]->consumeEvent(&latency);
+        windows[focused]->consumeEvent(&latency);
+    }
+
+    dispatcher->stop();
+    reportEvents(state, 2, latency);
+}
+
+/**
+ * A gesture of state.range(0) events that the window only finishes at the end, so that the
+ * dispatcher tracks a wait queue of that depth for ANRs while it keeps dispatching.
+ */
+static void benchmarkNotifyMotionAnrTracking(benchmark::State& state) {
+    sp<FakeInputDispatcherPolicy> fakePolicy = new FakeInputDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    sp<FakeWindowHandle> window = new FakeWindowHandle(application, dispatcher, "Fake Window");
+    window->setFocus(false);
+
+    dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
+
+    const int32_t count = state.range(0);
+    NotifyMotionArgs motionArgs = generateMotionArgs();
+    std::vector<uint32_t> seqs;
+    seqs.reserve(count);
+    LatencyHistogram latency;
+
+    for (auto _ : state) {
+        for (int32_t i = 0; i < count; i++) {
+            const int32_t action = i == 0 ? AMOTION_EVENT_ACTION_DOWN
+                    : i == count - 1      ? AMOTION_EVENT_ACTION_UP
+                                          : AMOTION_EVENT_ACTION_MOVE;
+            notifyMotion(dispatcher, motionArgs, action);
+            // Receive each event before the next one is sent, so that moves are not batched.
+            uint32_t seq;
+            if (window->receiveEvent(&seq, &latency) != nullptr) {
+                seqs.push_back(seq);
+            }
+        }
+        for (uint32_t seq : seqs) {
+            window->finishEvent(seq);
+        }
+        seqs.clear();
+    }
+
+    dispatcher->stop();
+    reportEvents(state, count, latency);
+}
+
+/**
+ * A mouse hovering over a window, reporting state.range(0) samples per frame as a high polling
+ * rate mouse does. The window consumes once per frame, getting the samples in one batch.
+ */
+static void benchmarkNotifyMotionHover(benchmark::State& state) {
+    sp<FakeInputDispatcherPolicy> fakePolicy = new FakeInputDispatcherPolicy();
+    sp<InputDispatcher> dispatcher = new InputDispatcher(fakePolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    sp<FakeWindowHandle> window =
+            new FakeWindowHandle(application, dispatcher, "Fake Window", Rect(0, 0, 1000, 1000));
+    window->setFocus(false);
+
+    dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
+
+    NotifyMotionArgs motionArgs =
+            generateMotionArgs(AMOTION_EVENT_ACTION_HOVER_MOVE, AINPUT_SOURCE_MOUSE, {{100, 100}});
+    // The first sample enters the window, and comes with a synthesized HOVER_ENTER.
+    notifyMotion(dispatcher, motionArgs, AMOTION_EVENT_ACTION_HOVER_MOVE);
+    window->consumeEvent();
+    window->consumeEvent();
+
+    const int32_t samplesPerFrame = state.range(0);
+    LatencyHistogram latency;
+    int32_t step = 0;
+
+    for (auto _ : state) {
+        for (int32_t i = 0; i < samplesPerFrame; i++) {
+            step = (step + 1) % 800;
+            motionArgs.pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, 100 + step);
+            notifyMotion(dispatcher, motionArgs, AMOTION_EVENT_ACTION_HOVER_MOVE);
+        }
+        // The dispatcher may still be publishing when the first batch is read, so keep reading
+        // until every sample of the frame has arrived.
+        int32_t received = 0;
+        while (received < samplesPerFrame) {
+            uint32_t seq;
+            InputEvent* event = window->receiveEvent(&seq, &latency);
+            if (event == nullptr) {
+                break;
+            }
+            const size_t samples = static_cast<MotionEvent*>(event)->getHistorySize() + 1;
+            received += static_cast<int32_t>(samples);
+            window->finishEvent(seq);
+        }
     }
 
     dispatcher->stop();
+    reportEvents(state, samplesPerFrame, latency);
 }
 
 BENCHMARK(benchmarkNotifyMotion);
 BENCHMARK(benchmarkInjectMotion);
+BENCHMARK(benchmarkNotifyMotionManyWindows)->Arg(1)->Arg(16)->Arg(64);
+BENCHMARK(benchmarkTouchWindowIndexQuery)->Arg(1)->Arg(16)->Arg(64);
+BENCHMARK(benchmarkNotifyMotionSplitTouch);
+BENCHMARK(benchmarkNotifyMotionWithMonitors);
+BENCHMARK(benchmarkNotifyKeyFocusSwitch);
+BENCHMARK(benchmarkNotifyMotionAnrTracking)->Arg(2)->Arg(8)->Arg(32);
+BENCHMARK(benchmarkNotifyMotionHover)->Arg(1)->Arg(8);
 
 } // namespace android::inputdispatcher
 
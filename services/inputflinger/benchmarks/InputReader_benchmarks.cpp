@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <EventHub.h>
+#include <InputReader.h>
+#include <InputReaderBase.h>
+#include <linux/input.h>
+
+#include <algorithm>
+
+namespace android {
+
+// An arbitrary device id.
+static const int32_t DEVICE_ID = 1;
+
+static const int32_t DISPLAY_WIDTH = 1080;
+static const int32_t DISPLAY_HEIGHT = 2340;
+
+static const int32_t RAW_X_MAX = 4095;
+static const int32_t RAW_Y_MAX = 8191;
+static const int32_t RAW_SLOT_MAX = 9;
+
+// Frames of the trace played back in a loop.
+static const size_t TRACE_FRAMES = 120;
+
+// --- FakeInputReaderPolicy ---
+
+class FakeInputReaderPolicy : public InputReaderPolicyInterface {
+public:
+    FakeInputReaderPolicy() {
+        DisplayViewport viewport;
+        viewport.displayId = ADISPLAY_ID_DEFAULT;
+        viewport.orientation = DISPLAY_ORIENTATION_0;
+        viewport.logicalRight = viewport.physicalRight = viewport.deviceWidth = DISPLAY_WIDTH;
+        viewport.logicalBottom = viewport.physicalBottom = viewport.deviceHeight =
+                DISPLAY_HEIGHT;
+        viewport.uniqueId = "local:0";
+        viewport.type = ViewportType::VIEWPORT_INTERNAL;
+        mConfig.setDisplayViewports({viewport});
+    }
+
+protected:
+    virtual ~FakeInputReaderPolicy() {}
+
+private:
+    virtual void getReaderConfiguration(InputReaderConfiguration* outConfig) override {
+        *outConfig = mConfig;
+    }
+
+    virtual sp<PointerControllerInterface> obtainPointerController(int32_t) override {
+        return nullptr;
+    }
+
+    virtual void notifyInputDevicesChanged(const std::vector<InputDeviceInfo>&) override {}
+
+    virtual sp<KeyCharacterMap> getKeyboardLayoutOverlay(const InputDeviceIdentifier&) override {
+        return nullptr;
+    }
+
+    virtual std::string getDeviceAlias(const InputDeviceIdentifier&) override { return ""; }
+
+    virtual TouchAffineTransformation getTouchAffineTransformation(const std::string&,
+                                                                   int32_t) override {
+        return TouchAffineTransformation();
+    }
+
+    InputReaderConfiguration mConfig;
+};
+
+// --- FakeInputListener ---
+
+class FakeInputListener : public InputListenerInterface {
+private:
+    virtual void notifyConfigurationChanged(const NotifyConfigurationChangedArgs*) override {}
+    virtual void notifyKey(const NotifyKeyArgs*) override {}
+    virtual void notifyMotion(const NotifyMotionArgs*) override {}
+    virtual void notifySwitch(const NotifySwitchArgs*) override {}
+    virtual void notifyDeviceReset(const NotifyDeviceResetArgs*) override {}
+};
+
+// --- FakeEventHub ---
+
+/**
+ * A single multi-touch screen using the slots protocol, playing back a trace of pointers
+ * sweeping across the screen, one frame (up to and including SYN_REPORT) per getEvents() call.
+ */
+class FakeEventHub : public EventHubInterface {
+public:
+    explicit FakeEventHub(int32_t pointerCount) {
+        mIdentifier.name = "Benchmark touchscreen";
+        mIdentifier.descriptor = "benchmark_touchscreen";
+        mFrames.push_back({{DEVICE_ADDED, 0, 0}, {FINISHED_DEVICE_SCAN, 0, 0}});
+
+        for (size_t frame = 0; frame < TRACE_FRAMES; frame++) {
+            std::vector<Event> events;
+            for (int32_t slot = 0; slot < pointerCount; slot++) {
+                events.push_back({EV_ABS, ABS_MT_SLOT, slot});
+                if (frame == 0) {
+                    events.push_back({EV_ABS, ABS_MT_TRACKING_ID, slot});
+                    events.push_back({EV_ABS, ABS_MT_TOUCH_MAJOR, 40 + slot});
+                    events.push_back({EV_ABS, ABS_MT_PRESSURE, 100 + slot});
+                }
+                // Each pointer moves down and back up the screen in its own column.
+                const size_t step = frame < TRACE_FRAMES / 2 ? frame : TRACE_FRAMES - frame;
+                events.push_back({EV_ABS, ABS_MT_POSITION_X,
+                                  (RAW_X_MAX / (pointerCount + 1)) * (slot + 1) +
+                                          static_cast<int32_t>(step)});
+                events.push_back({EV_ABS, ABS_MT_POSITION_Y,
+                                  static_cast<int32_t>(step * RAW_Y_MAX / TRACE_FRAMES)});
+            }
+            events.push_back({EV_SYN, SYN_REPORT, 0});
+            mFrames.push_back(std::move(events));
+        }
+    }
+
+    virtual size_t getEvents(int, RawEvent* buffer, size_t bufferSize) override {
+        // Frame 0 adds the device, frame 1 puts the pointers down, the others move them.
+        const std::vector<Event>& events = mFrames[mNextFrame];
+        mNextFrame = mNextFrame + 1 < mFrames.size() ? mNextFrame + 1 : 2;
+        const nsecs_t when = systemTime(SYSTEM_TIME_MONOTONIC);
+        const size_t count = std::min(events.size(), bufferSize);
+        for (size_t i = 0; i < count; i++) {
+            buffer[i] = {when, DEVICE_ID, events[i].type, events[i].code, events[i].value};
+        }
+        return count;
+    }
+
+    virtual uint32_t getDeviceClasses(int32_t) const override {
+        return INPUT_DEVICE_CLASS_TOUCH | INPUT_DEVICE_CLASS_TOUCH_MT;
+    }
+
+    virtual InputDeviceIdentifier getDeviceIdentifier(int32_t) const override {
+        return mIdentifier;
+    }
+
+    virtual int32_t getDeviceControllerNumber(int32_t) const override { return 0; }
+
+    virtual void getConfiguration(int32_t, PropertyMap* outConfiguration) const override {
+        outConfiguration->clear();
+    }
+
+    virtual status_t getAbsoluteAxisInfo(int32_t, int axis,
+                                         RawAbsoluteAxisInfo* outAxisInfo) const override {
+        outAxisInfo->clear();
+        switch (axis) {
+            case ABS_MT_POSITION_X:
+                outAxisInfo->maxValue = RAW_X_MAX;
+                break;
+            case ABS_MT_POSITION_Y:
+                outAxisInfo->maxValue = RAW_Y_MAX;
+                break;
+            case ABS_MT_SLOT:
+                outAxisInfo->maxValue = RAW_SLOT_MAX;
+                break;
+            case ABS_MT_TRACKING_ID:
+                outAxisInfo->maxValue = 65535;
+                break;
+            case ABS_MT_TOUCH_MAJOR:
+                outAxisInfo->maxValue = 255;
+                break;
+            case ABS_MT_PRESSURE:
+                outAxisInfo->maxValue = 255;
+                break;
+            default:
+                return -1;
+        }
+        outAxisInfo->valid = true;
+        return OK;
+    }
+
+    virtual bool hasRelativeAxis(int32_t, int) const override { return false; }
+
+    virtual bool hasInputProperty(int32_t, int property) const override {
+        return property == INPUT_PROP_DIRECT;
+    }
+
+    virtual status_t mapKey(int32_t, int32_t, int32_t, int32_t, int32_t*, int32_t*,
+                            uint32_t*) const override {
+        return NAME_NOT_FOUND;
+    }
+
+    virtual status_t mapAxis(int32_t, int32_t, AxisInfo*) const override {
+        return NAME_NOT_FOUND;
+    }
+
+    virtual void setExcludedDevices(const std::vector<std::string>&) override {}
+
+    virtual std::vector<TouchVideoFrame> getVideoFrames(int32_t) override { return {}; }
+
+    virtual int32_t getScanCodeState(int32_t, int32_t) const override { return AKEY_STATE_UP; }
+    virtual int32_t getKeyCodeState(int32_t, int32_t) const override { return AKEY_STATE_UP; }
+    virtual int32_t getSwitchState(int32_t, int32_t) const override { return AKEY_STATE_UP; }
+    virtual status_t getAbsoluteAxisValue(int32_t, int32_t, int32_t* outValue) const override {
+        *outValue = 0;
+        return OK;
+    }
+
+    virtual bool markSupportedKeyCodes(int32_t, size_t, const int32_t*,
+                                       uint8_t*) const override {
+        return false;
+    }
+
+    virtual bool hasScanCode(int32_t, int32_t) const override { return false; }
+    virtual bool hasLed(int32_t, int32_t) const override { return false; }
+    virtual void setLedState(int32_t, int32_t, bool) override {}
+
+    virtual void getVirtualKeyDefinitions(int32_t,
+                                          std::vector<VirtualKeyDefinition>&) const override {}
+
+    virtual sp<KeyCharacterMap> getKeyCharacterMap(int32_t) const override { return nullptr; }
+    virtual bool setKeyboardLayoutOverlay(int32_t, const sp<KeyCharacterMap>&) override {
+        return false;
+    }
+
+    virtual void vibrate(int32_t, nsecs_t) override {}
+    virtual void cancelVibrate(int32_t) override {}
+    virtual void requestReopenDevices() override {}
+    virtual void wake() override {}
+    virtual void dump(std::string&) override {}
+    virtual void monitor() override {}
+    virtual bool isDeviceEnabled(int32_t) override { return true; }
+    virtual status_t enableDevice(int32_t) override { return OK; }
+    virtual status_t disableDevice(int32_t) override { return OK; }
+
+private:
+    struct Event {
+        int32_t type;
+        int32_t code;
+        int32_t value;
+    };
+
+    InputDeviceIdentifier mIdentifier;
+    std::vector<std::vector<Event>> mFrames;
+    size_t mNextFrame = 0;
+};
+
+// --- BenchmarkInputReader ---
+
+class BenchmarkInputReader : public InputReader {
+public:
+    using InputReader::InputReader;
+    using InputReader::loopOnce;
+};
+
+/**
+ * Reads and cooks one multi-touch frame with the given number of pointers moving, and sends
+ * the resulting motion event to a listener that drops it.
+ */
+static void benchmarkMultiTouchFrame(benchmark::State& state) {
+    const int32_t pointerCount = static_cast<int32_t>(state.range(0));
+    BenchmarkInputReader reader(std::make_shared<FakeEventHub>(pointerCount),
+                                new FakeInputReaderPolicy(), new FakeInputListener());
+    // Add the device and put the pointers down.
+    reader.loopOnce();
+    reader.loopOnce();
+
+    for (auto _ : state) {
+        reader.loopOnce();
+    }
+}
+BENCHMARK(benchmarkMultiTouchFrame)->Arg(1)->Arg(2)->Arg(5)->Arg(10);
+
+} // namespace android
+
+BENCHMARK_MAIN();
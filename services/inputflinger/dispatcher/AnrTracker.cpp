@@ -24,6 +24,7 @@ static T max(const T& a, const T& b) {
 }
 
 void AnrTracker::insert(nsecs_t timeoutTime, sp<IBinder> token) {
+    mTimeoutsByToken[token].insert(timeoutTime);
     mAnrTimeouts.insert(std::make_pair(timeoutTime, std::move(token)));
 }
 
@@ -34,19 +35,28 @@ void AnrTracker::insert(nsecs_t timeoutTime, sp<IBinder> token) {
 void AnrTracker::erase(nsecs_t timeoutTime, const sp<IBinder>& token) {
     auto pair = std::make_pair(timeoutTime, token);
     auto it = mAnrTimeouts.find(pair);
-    if (it != mAnrTimeouts.end()) {
-        mAnrTimeouts.erase(it);
+    if (it == mAnrTimeouts.end()) {
+        return;
+    }
+    mAnrTimeouts.erase(it);
+
+    auto tokenIt = mTimeoutsByToken.find(token);
+    std::multiset<nsecs_t>& timeouts = tokenIt->second;
+    timeouts.erase(timeouts.find(timeoutTime));
+    if (timeouts.empty()) {
+        mTimeoutsByToken.erase(tokenIt);
     }
 }
 
 void AnrTracker::eraseToken(const sp<IBinder>& token) {
-    for (auto it = mAnrTimeouts.begin(); it != mAnrTimeouts.end();) {
-        if (it->second == token) {
-            it = mAnrTimeouts.erase(it);
-        } else {
-            ++it;
-        }
+    auto tokenIt = mTimeoutsByToken.find(token);
+    if (tokenIt == mTimeoutsByToken.end()) {
+        return;
+    }
+    for (nsecs_t timeoutTime : tokenIt->second) {
+        mAnrTimeouts.erase(mAnrTimeouts.find(std::make_pair(timeoutTime, token)));
     }
+    mTimeoutsByToken.erase(tokenIt);
 }
 
 bool AnrTracker::empty() const {
@@ -68,6 +78,7 @@ const sp<IBinder>& AnrTracker::firstToken() const {
 
 void AnrTracker::clear() {
     mAnrTimeouts.clear();
+    mTimeoutsByToken.clear();
 }
 
 } // namespace android::inputdispatcher
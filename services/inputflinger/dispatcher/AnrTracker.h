@@ -19,6 +19,7 @@
 
 #include <binder/IBinder.h>
 #include <utils/Timers.h>
+#include <map>
 #include <set>
 
 namespace android::inputdispatcher {
@@ -53,6 +54,11 @@ private:
     // from the same connection and same timestamp, but different sequence numbers.
     // We are not tracking sequence numbers, and just allow duplicates to exist.
     std::multiset<std::pair<nsecs_t /*timeoutTime*/, sp<IBinder> /*connectionToken*/>> mAnrTimeouts;
+
+    // The same entries, grouped by connection, so that eraseToken only visits the timeouts of
+    // that connection rather than those of every connection.
+    std::map<sp<IBinder> /*connectionToken*/, std::multiset<nsecs_t /*timeoutTime*/>>
+            mTimeoutsByToken;
 };
 
 } // namespace android::inputdispatcher
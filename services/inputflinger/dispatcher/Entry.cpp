@@ -55,6 +55,37 @@ VerifiedMotionEvent verifiedMotionEventFromMotionEntry(const MotionEntry& entry)
             entry.buttonState};
 }
 
+// --- Entry pools ---
+
+// Bounds on the free entries kept around. KeyEntry and MotionEntry cover the inbound queue and
+// the recent events of a busy stream; there is one DispatchEntry per event and target window.
+static constexpr size_t MAX_CACHED_KEY_ENTRIES = 32;
+static constexpr size_t MAX_CACHED_MOTION_ENTRIES = 64;
+static constexpr size_t MAX_CACHED_DISPATCH_ENTRIES = 256;
+
+// The pools are never destroyed, since entries can still be released during static destruction.
+static EntryPool& keyEntryPool() {
+    static EntryPool* sPool = new EntryPool("KeyEntry", sizeof(KeyEntry), MAX_CACHED_KEY_ENTRIES);
+    return *sPool;
+}
+
+static EntryPool& motionEntryPool() {
+    static EntryPool* sPool =
+            new EntryPool("MotionEntry", sizeof(MotionEntry), MAX_CACHED_MOTION_ENTRIES);
+    return *sPool;
+}
+
+static EntryPool& dispatchEntryPool() {
+    static EntryPool* sPool =
+            new EntryPool("DispatchEntry", sizeof(DispatchEntry), MAX_CACHED_DISPATCH_ENTRIES);
+    return *sPool;
+}
+
+std::vector<EntryPoolStats> getEntryPoolStats() {
+    return {keyEntryPool().getStats(), motionEntryPool().getStats(),
+            dispatchEntryPool().getStats()};
+}
+
 // --- EventEntry ---
 
 EventEntry::EventEntry(int32_t id, Type type, nsecs_t eventTime, uint32_t policyFlags)
@@ -64,7 +95,8 @@ EventEntry::EventEntry(int32_t id, Type type, nsecs_t eventTime, uint32_t policy
         eventTime(eventTime),
         policyFlags(policyFlags),
         injectionState(nullptr),
-        dispatchInProgress(false) {}
+        dispatchInProgress(false),
+        enqueueTime(0) {}
 
 EventEntry::~EventEntry() {
     releaseInjectionState();
@@ -151,6 +183,14 @@ KeyEntry::KeyEntry(int32_t id, nsecs_t eventTime, int32_t deviceId, uint32_t sou
 
 KeyEntry::~KeyEntry() {}
 
+void* KeyEntry::operator new(size_t size) {
+    return keyEntryPool().allocate(size);
+}
+
+void KeyEntry::operator delete(void* ptr, size_t size) {
+    keyEntryPool().free(ptr, size);
+}
+
 void KeyEntry::appendDescription(std::string& msg) const {
     msg += StringPrintf("KeyEvent");
     if (!GetBoolProperty("ro.debuggable", false)) {
@@ -211,6 +251,14 @@ MotionEntry::MotionEntry(int32_t id, nsecs_t eventTime, int32_t deviceId, uint32
 
 MotionEntry::~MotionEntry() {}
 
+void* MotionEntry::operator new(size_t size) {
+    return motionEntryPool().allocate(size);
+}
+
+void MotionEntry::operator delete(void* ptr, size_t size) {
+    motionEntryPool().free(ptr, size);
+}
+
 void MotionEntry::appendDescription(std::string& msg) const {
     msg += StringPrintf("MotionEvent");
     if (!GetBoolProperty("ro.debuggable", false)) {
@@ -261,6 +309,14 @@ DispatchEntry::~DispatchEntry() {
     eventEntry->release();
 }
 
+void* DispatchEntry::operator new(size_t size) {
+    return dispatchEntryPool().allocate(size);
+}
+
+void DispatchEntry::operator delete(void* ptr, size_t size) {
+    dispatchEntryPool().free(ptr, size);
+}
+
 uint32_t DispatchEntry::nextSeq() {
     // Sequence number 0 is reserved and will never be returned.
     uint32_t seq;
@@ -274,6 +330,7 @@ uint32_t DispatchEntry::nextSeq() {
 
 CommandEntry::CommandEntry(Command command)
       : command(command),
+        runsUnlocked(false),
         eventTime(0),
         keyEntry(nullptr),
         userActivityEventType(0),
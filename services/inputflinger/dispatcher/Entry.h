@@ -17,6 +17,7 @@
 #ifndef _UI_INPUT_INPUTDISPATCHER_ENTRY_H
 #define _UI_INPUT_INPUTDISPATCHER_ENTRY_H
 
+#include "EntryPool.h"
 #include "InjectionState.h"
 #include "InputTarget.h"
 
@@ -26,6 +27,7 @@
 #include <utils/Timers.h>
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace android::inputdispatcher {
 
@@ -61,6 +63,7 @@ struct EventEntry {
     InjectionState* injectionState;
 
     bool dispatchInProgress; // initially false, set to true while dispatching
+    nsecs_t enqueueTime;     // when the entry was added to the inbound queue, 0 before
 
     /**
      * Injected keys are events from an external (probably untrusted) application
@@ -149,6 +152,10 @@ struct KeyEntry : EventEntry {
     virtual void appendDescription(std::string& msg) const;
     void recycle();
 
+    // Storage comes from a bounded freelist, see getEntryPoolStats().
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
 protected:
     virtual ~KeyEntry();
 };
@@ -183,6 +190,11 @@ struct MotionEntry : EventEntry {
                 float xOffset, float yOffset);
     virtual void appendDescription(std::string& msg) const;
 
+    // The pointer arrays are inline, so they are pooled along with the entry.
+    // Storage comes from a bounded freelist, see getEntryPoolStats().
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
 protected:
     virtual ~MotionEntry();
 };
@@ -213,6 +225,10 @@ struct DispatchEntry {
                   float globalScaleFactor, float windowXScale, float windowYScale);
     ~DispatchEntry();
 
+    // Storage comes from a bounded freelist, see getEntryPoolStats().
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
     inline bool hasForegroundTarget() const { return targetFlags & InputTarget::FLAG_FOREGROUND; }
 
     inline bool isSplit() const { return targetFlags & InputTarget::FLAG_SPLIT; }
@@ -223,6 +239,9 @@ private:
     static uint32_t nextSeq();
 };
 
+// Usage of the KeyEntry, MotionEntry and DispatchEntry pools.
+std::vector<EntryPoolStats> getEntryPoolStats();
+
 VerifiedKeyEvent verifiedKeyEventFromKeyEntry(const KeyEntry& entry);
 VerifiedMotionEvent verifiedMotionEventFromMotionEntry(const MotionEntry& entry);
 
@@ -253,6 +272,10 @@ struct CommandEntry {
 
     Command command;
 
+    // Set for commands that only pass their parameters to the policy. These run with the
+    // dispatcher lock released, and consecutive ones are run under a single release.
+    bool runsUnlocked;
+
     // parameters for the command (usage varies by command)
     sp<Connection> connection;
     nsecs_t eventTime;
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UI_INPUT_INPUTDISPATCHER_ENTRYPOOL_H
+#define _UI_INPUT_INPUTDISPATCHER_ENTRYPOOL_H
+
+#include <android-base/thread_annotations.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <new>
+
+namespace android::inputdispatcher {
+
+struct EntryPoolStats {
+    const char* name;
+    size_t objectSize;
+    size_t cached;
+    size_t maxCached;
+    uint64_t allocations; // every allocate() call
+    uint64_t reused;      // allocations served from the cache
+    uint64_t overflowed;  // frees that went to the heap because the cache was full
+};
+
+/**
+ * Freelist of raw storage for one entry type, used from the class-specific operator new and
+ * delete of that type. Holds at most maxCached free objects, the rest go back to the heap.
+ *
+ * Entries are allocated both on the reader thread and on the dispatcher thread, so the
+ * freelist is protected by a lock. It is only held to push or pop a node.
+ */
+class EntryPool {
+public:
+    EntryPool(const char* name, size_t objectSize, size_t maxCached)
+          : mName(name), mObjectSize(objectSize), mMaxCached(maxCached) {}
+    EntryPool(const EntryPool&) = delete;
+    EntryPool& operator=(const EntryPool&) = delete;
+
+    void* allocate(size_t size) {
+        if (size != mObjectSize) {
+            // A subclass of the pooled type.
+            return ::operator new(size);
+        }
+        {
+            std::scoped_lock _l(mLock);
+            mAllocations++;
+            if (mFreeList != nullptr) {
+                FreeNode* node = mFreeList;
+                mFreeList = node->next;
+                mCached--;
+                mReused++;
+                return node;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void free(void* ptr, size_t size) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (size == mObjectSize) {
+            std::scoped_lock _l(mLock);
+            if (mCached < mMaxCached) {
+                FreeNode* node = new (ptr) FreeNode{mFreeList};
+                mFreeList = node;
+                mCached++;
+                return;
+            }
+            mOverflowed++;
+        }
+        ::operator delete(ptr);
+    }
+
+    EntryPoolStats getStats() const {
+        std::scoped_lock _l(mLock);
+        return {mName, mObjectSize, mCached, mMaxCached, mAllocations, mReused, mOverflowed};
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    const char* const mName;
+    const size_t mObjectSize;
+    const size_t mMaxCached;
+
+    mutable std::mutex mLock;
+    FreeNode* mFreeList GUARDED_BY(mLock) = nullptr;
+    size_t mCached GUARDED_BY(mLock) = 0;
+    uint64_t mAllocations GUARDED_BY(mLock) = 0;
+    uint64_t mReused GUARDED_BY(mLock) = 0;
+    uint64_t mOverflowed GUARDED_BY(mLock) = 0;
+};
+
+} // namespace android::inputdispatcher
+
+#endif // _UI_INPUT_INPUTDISPATCHER_ENTRYPOOL_H
@@ -52,6 +52,7 @@ static constexpr bool DEBUG_FOCUS = false;
 #include <limits.h>
 #include <statslog.h>
 #include <stddef.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <queue>
@@ -63,6 +64,7 @@ static constexpr bool DEBUG_FOCUS = false;
 #include <input/InputDevice.h>
 #include <log/log.h>
 #include <openssl/hmac.h>
+#include <openssl/mem.h>
 #include <openssl/rand.h>
 #include <powermanager/PowerManager.h>
 #include <utils/Trace.h>
@@ -349,7 +351,14 @@ static std::array<uint8_t, 128> getRandomKey() {
 
 // --- HmacKeyManager ---
 
-HmacKeyManager::HmacKeyManager() : mHmacKey(getRandomKey()) {}
+HmacKeyManager::HmacKeyManager() {
+    std::array<uint8_t, 128> key = getRandomKey();
+    if (HMAC_Init_ex(mKeyedContext.get(), key.data(), key.size(), EVP_sha256(), nullptr) != 1) {
+        LOG_ALWAYS_FATAL("Can't initialize HMAC context");
+    }
+    // The keyed context is all that is needed from now on.
+    OPENSSL_cleanse(key.data(), key.size());
+}
 
 std::array<uint8_t, 32> HmacKeyManager::sign(const VerifiedInputEvent& event) const {
     size_t size;
@@ -371,9 +380,10 @@ std::array<uint8_t, 32> HmacKeyManager::sign(const uint8_t* data, size_t size) c
     // SHA256 always generates 32-bytes result
     std::array<uint8_t, 32> hash;
     unsigned int hashLen = 0;
-    uint8_t* result =
-            HMAC(EVP_sha256(), mHmacKey.data(), mHmacKey.size(), data, size, hash.data(), &hashLen);
-    if (result == nullptr) {
+    bssl::ScopedHMAC_CTX context;
+    if (HMAC_CTX_copy_ex(context.get(), mKeyedContext.get()) != 1 ||
+        HMAC_Update(context.get(), data, size) != 1 ||
+        HMAC_Final(context.get(), hash.data(), &hashLen) != 1) {
         ALOGE("Could not sign the data using HMAC");
         return INVALID_HMAC;
     }
@@ -449,6 +459,7 @@ void InputDispatcher::dispatchOnce() {
     nsecs_t nextWakeupTime = LONG_LONG_MAX;
     { // acquire lock
         std::scoped_lock _l(mLock);
+        mLockAcquireTime = now();
         mDispatcherIsAlive.notify_all();
 
         // Run a dispatch loop if there are no pending commands.
@@ -473,6 +484,7 @@ void InputDispatcher::dispatchOnce() {
         if (nextWakeupTime == LONG_LONG_MAX) {
             mDispatcherEnteredIdle.notify_all();
         }
+        recordLockHoldTimeLocked();
     } // release lock
 
     // Wait for callback or timeout or wake.  (make sure we round up, not down)
@@ -503,23 +515,26 @@ nsecs_t InputDispatcher::processAnrsLocked() {
         }
     }
 
-    // Check if any connection ANRs are due
-    nextAnrCheck = std::min(nextAnrCheck, mAnrTracker.firstTimeout());
-    if (currentTime < nextAnrCheck) { // most likely scenario
-        return nextAnrCheck;          // everything is normal. Let's check again at nextAnrCheck
+    // Raise an ANR for every connection that is due, rather than one per dispatcher loop.
+    bool raisedAnr = false;
+    while (mAnrTracker.firstTimeout() <= currentTime) {
+        const sp<IBinder> token = mAnrTracker.firstToken();
+        sp<Connection> connection = getConnectionLocked(token);
+        // Stop waking up for this unresponsive connection
+        mAnrTracker.eraseToken(token);
+        if (connection == nullptr) {
+            ALOGE("Could not find connection for ANR entry, dropping it");
+            continue;
+        }
+        connection->responsive = false;
+        onAnrLocked(connection);
+        raisedAnr = true;
     }
-
-    // If we reached here, we have an unresponsive connection.
-    sp<Connection> connection = getConnectionLocked(mAnrTracker.firstToken());
-    if (connection == nullptr) {
-        ALOGE("Could not find connection for entry %" PRId64, mAnrTracker.firstTimeout());
-        return nextAnrCheck;
+    if (raisedAnr) {
+        return LONG_LONG_MIN;
     }
-    connection->responsive = false;
-    // Stop waking up for this unresponsive connection
-    mAnrTracker.eraseToken(connection->inputChannel->getConnectionToken());
-    onAnrLocked(connection);
-    return LONG_LONG_MIN;
+    // Everything is normal. Let's check again at the next timeout.
+    return std::min(nextAnrCheck, mAnrTracker.firstTimeout());
 }
 
 nsecs_t InputDispatcher::getDispatchingTimeoutLocked(const sp<IBinder>& token) {
@@ -743,6 +758,7 @@ bool InputDispatcher::shouldPruneInboundQueueLocked(const MotionEntry& motionEnt
 
 bool InputDispatcher::enqueueInboundEventLocked(EventEntry* entry) {
     bool needWake = mInboundQueue.empty();
+    entry->enqueueTime = now();
     mInboundQueue.push_back(entry);
     traceInboundQueueLengthLocked();
 
@@ -807,9 +823,15 @@ sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t display
         LOG_ALWAYS_FATAL(
                 "Must provide a valid touch state if adding portal windows or outside targets");
     }
-    // Traverse windows from front to back to find touched window.
-    const std::vector<sp<InputWindowHandle>> windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<InputWindowHandle>& windowHandle : windowHandles) {
+    auto indexIt = mTouchWindowIndexByDisplay.find(displayId);
+    if (indexIt == mTouchWindowIndexByDisplay.end()) {
+        return nullptr;
+    }
+
+    // Traverse the windows that can be hit at (x, y) from front to back to find touched window.
+    sp<InputWindowHandle> touchedWindow;
+    int32_t portalToDisplayId = ADISPLAY_ID_NONE;
+    indexIt->second.forEachCandidate(x, y, [&](const sp<InputWindowHandle>& windowHandle) {
         const InputWindowInfo* windowInfo = windowHandle->getInfo();
         if (windowInfo->displayId == displayId) {
             int32_t flags = windowInfo->layoutParamsFlags;
@@ -820,18 +842,18 @@ sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t display
                                          (InputWindowInfo::FLAG_NOT_FOCUSABLE |
                                           InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) == 0;
                     if (isTouchModal || windowInfo->touchableRegionContainsPoint(x, y)) {
-                        int32_t portalToDisplayId = windowInfo->portalToDisplayId;
-                        if (portalToDisplayId != ADISPLAY_ID_NONE &&
-                            portalToDisplayId != displayId) {
+                        if (windowInfo->portalToDisplayId != ADISPLAY_ID_NONE &&
+                            windowInfo->portalToDisplayId != displayId) {
                             if (addPortalWindows) {
                                 // For the monitoring channels of the display.
                                 touchState->addPortalWindow(windowHandle);
                             }
-                            return findTouchedWindowAtLocked(portalToDisplayId, x, y, touchState,
-                                                             addOutsideTargets, addPortalWindows);
+                            portalToDisplayId = windowInfo->portalToDisplayId;
+                            return true;
                         }
                         // Found window.
-                        return windowHandle;
+                        touchedWindow = windowHandle;
+                        return true;
                     }
                 }
 
@@ -842,8 +864,15 @@ sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t display
                 }
             }
         }
+        return false;
+    });
+
+    if (portalToDisplayId != ADISPLAY_ID_NONE) {
+        // Recurse once the candidates of this display are no longer being visited.
+        return findTouchedWindowAtLocked(portalToDisplayId, x, y, touchState, addOutsideTargets,
+                                         addPortalWindows);
     }
-    return nullptr;
+    return touchedWindow;
 }
 
 std::vector<TouchedMonitor> InputDispatcher::findTouchedGestureMonitorsLocked(
@@ -961,10 +990,33 @@ bool InputDispatcher::runCommandsLockedInterruptible() {
     do {
         std::unique_ptr<CommandEntry> commandEntry = std::move(mCommandQueue.front());
         mCommandQueue.pop_front();
-        Command command = commandEntry->command;
-        command(*this, commandEntry.get()); // commands are implicitly 'LockedInterruptible'
+        if (!commandEntry->runsUnlocked) {
+            Command command = commandEntry->command;
+            command(*this, commandEntry.get()); // commands are implicitly 'LockedInterruptible'
 
-        commandEntry->connection.clear();
+            commandEntry->connection.clear();
+            continue;
+        }
+
+        // Run the unlocked commands at the front of the queue under a single release of the
+        // lock, rather than reacquiring it between policy calls. Commands posted meanwhile go
+        // to the back of the queue, so the order is preserved.
+        std::vector<std::unique_ptr<CommandEntry>> batch;
+        batch.push_back(std::move(commandEntry));
+        while (!mCommandQueue.empty() && mCommandQueue.front()->runsUnlocked) {
+            batch.push_back(std::move(mCommandQueue.front()));
+            mCommandQueue.pop_front();
+        }
+        mCommandBatchCount++;
+        mBatchedCommandCount += batch.size();
+
+        recordLockHoldTimeLocked();
+        mLock.unlock();
+        for (const std::unique_ptr<CommandEntry>& entry : batch) {
+            entry->command(*this, entry.get());
+        }
+        mLock.lock();
+        mLockAcquireTime = now();
     } while (!mCommandQueue.empty());
     return true;
 }
@@ -973,6 +1025,15 @@ void InputDispatcher::postCommandLocked(std::unique_ptr<CommandEntry> commandEnt
     mCommandQueue.push_back(std::move(commandEntry));
 }
 
+void InputDispatcher::postUnlockedCommandLocked(std::unique_ptr<CommandEntry> commandEntry) {
+    commandEntry->runsUnlocked = true;
+    postCommandLocked(std::move(commandEntry));
+}
+
+void InputDispatcher::recordLockHoldTimeLocked() {
+    mLockHoldTime.addValue(ns2us(now() - mLockAcquireTime));
+}
+
 void InputDispatcher::drainInboundQueueLocked() {
     while (!mInboundQueue.empty()) {
         EventEntry* entry = mInboundQueue.front();
@@ -1055,10 +1116,10 @@ bool InputDispatcher::dispatchConfigurationChangedLocked(nsecs_t currentTime,
     resetKeyRepeatLocked();
 
     // Enqueue a command to run outside the lock to tell the policy that the configuration changed.
-    std::unique_ptr<CommandEntry> commandEntry = std::make_unique<CommandEntry>(
-            &InputDispatcher::doNotifyConfigurationChangedLockedInterruptible);
+    std::unique_ptr<CommandEntry> commandEntry =
+            std::make_unique<CommandEntry>(&InputDispatcher::doNotifyConfigurationChanged);
     commandEntry->eventTime = entry->eventTime;
-    postCommandLocked(std::move(commandEntry));
+    postUnlockedCommandLocked(std::move(commandEntry));
     return true;
 }
 
@@ -2200,10 +2261,10 @@ void InputDispatcher::pokeUserActivityLocked(const EventEntry& eventEntry) {
     }
 
     std::unique_ptr<CommandEntry> commandEntry =
-            std::make_unique<CommandEntry>(&InputDispatcher::doPokeUserActivityLockedInterruptible);
+            std::make_unique<CommandEntry>(&InputDispatcher::doPokeUserActivity);
     commandEntry->eventTime = eventEntry.eventTime;
     commandEntry->userActivityEventType = eventType;
-    postCommandLocked(std::move(commandEntry));
+    postUnlockedCommandLocked(std::move(commandEntry));
 }
 
 void InputDispatcher::prepareDispatchCycleLocked(nsecs_t currentTime,
@@ -2447,10 +2508,10 @@ void InputDispatcher::dispatchPointerDownOutsideFocus(uint32_t source, int32_t a
         return;
     }
 
-    std::unique_ptr<CommandEntry> commandEntry = std::make_unique<CommandEntry>(
-            &InputDispatcher::doOnPointerDownOutsideFocusLockedInterruptible);
+    std::unique_ptr<CommandEntry> commandEntry =
+            std::make_unique<CommandEntry>(&InputDispatcher::doOnPointerDownOutsideFocus);
     commandEntry->newToken = newToken;
-    postCommandLocked(std::move(commandEntry));
+    postUnlockedCommandLocked(std::move(commandEntry));
 }
 
 void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
@@ -2613,8 +2674,8 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
     }
 }
 
-const std::array<uint8_t, 32> InputDispatcher::getSignature(
-        const MotionEntry& motionEntry, const DispatchEntry& dispatchEntry) const {
+const std::array<uint8_t, 32> InputDispatcher::getSignature(const MotionEntry& motionEntry,
+                                                            const DispatchEntry& dispatchEntry) {
     int32_t actionMasked = dispatchEntry.resolvedAction & AMOTION_EVENT_ACTION_MASK;
     if ((actionMasked == AMOTION_EVENT_ACTION_UP) || (actionMasked == AMOTION_EVENT_ACTION_DOWN)) {
         // Only sign events up and down events as the purely move events
@@ -2622,17 +2683,29 @@ const std::array<uint8_t, 32> InputDispatcher::getSignature(
         VerifiedMotionEvent verifiedEvent = verifiedMotionEventFromMotionEntry(motionEntry);
         verifiedEvent.actionMasked = actionMasked;
         verifiedEvent.flags = dispatchEntry.resolvedFlags & VERIFIED_MOTION_EVENT_FLAGS;
-        return mHmacKeyManager.sign(verifiedEvent);
+        return signLocked(verifiedEvent, mLastSignedMotion);
     }
     return INVALID_HMAC;
 }
 
-const std::array<uint8_t, 32> InputDispatcher::getSignature(
-        const KeyEntry& keyEntry, const DispatchEntry& dispatchEntry) const {
+const std::array<uint8_t, 32> InputDispatcher::getSignature(const KeyEntry& keyEntry,
+                                                            const DispatchEntry& dispatchEntry) {
     VerifiedKeyEvent verifiedEvent = verifiedKeyEventFromKeyEntry(keyEntry);
     verifiedEvent.flags = dispatchEntry.resolvedFlags & VERIFIED_KEY_EVENT_FLAGS;
     verifiedEvent.action = dispatchEntry.resolvedAction;
-    return mHmacKeyManager.sign(verifiedEvent);
+    return signLocked(verifiedEvent, mLastSignedKey);
+}
+
+template <typename T>
+std::array<uint8_t, 32> InputDispatcher::signLocked(const T& verifiedEvent,
+                                                    std::optional<SignedEvent<T>>& lastSigned) {
+    // The verified events are packed, so comparing their bytes compares exactly what is signed.
+    if (lastSigned && memcmp(&lastSigned->event, &verifiedEvent, sizeof(T)) == 0) {
+        return lastSigned->hmac;
+    }
+    std::array<uint8_t, 32> hmac = mHmacKeyManager.sign(verifiedEvent);
+    lastSigned = SignedEvent<T>{verifiedEvent, hmac};
+    return hmac;
 }
 
 void InputDispatcher::finishDispatchCycleLocked(nsecs_t currentTime,
@@ -3616,6 +3689,7 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     if (inputWindowHandles.empty()) {
         // Remove all handles on a display if there are no windows left.
         mWindowHandlesByDisplay.erase(displayId);
+        mTouchWindowIndexByDisplay.erase(displayId);
         return;
     }
 
@@ -3666,7 +3740,8 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     }
 
     // Insert or replace
-    mWindowHandlesByDisplay[displayId] = newHandles;
+    mTouchWindowIndexByDisplay[displayId].update(newHandles);
+    mWindowHandlesByDisplay[displayId] = std::move(newHandles);
 }
 
 void InputDispatcher::setInputWindows(
@@ -4125,6 +4200,12 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
         for (auto& it : mWindowHandlesByDisplay) {
             const std::vector<sp<InputWindowHandle>> windowHandles = it.second;
             dump += StringPrintf(INDENT "Display: %" PRId32 "\n", it.first);
+            auto indexIt = mTouchWindowIndexByDisplay.find(it.first);
+            if (indexIt != mTouchWindowIndexByDisplay.end()) {
+                dump += StringPrintf(INDENT2 "TouchWindowIndex: windows=%zu, rebuilds=%zu\n",
+                                     indexIt->second.getWindowCount(),
+                                     indexIt->second.getRebuildCount());
+            }
             if (!windowHandles.empty()) {
                 dump += INDENT2 "Windows:\n";
                 for (size_t i = 0; i < windowHandles.size(); i++) {
@@ -4280,6 +4361,24 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
         dump += INDENT "AppSwitch: not pending\n";
     }
 
+    dump += INDENT "Latency:\n";
+    mLatencyTracker.dump(dump, INDENT);
+
+    dump += StringPrintf(INDENT "LockHoldTime: count=%zu, p50=%" PRId64 "us, p99=%" PRId64
+                                "us, max=%" PRId64 "us\n",
+                         mLockHoldTime.getCount(), mLockHoldTime.getPercentile(50),
+                         mLockHoldTime.getPercentile(99), mLockHoldTime.getMax());
+    dump += StringPrintf(INDENT "CommandBatches: count=%zu, commands=%zu\n", mCommandBatchCount,
+                         mBatchedCommandCount);
+
+    dump += INDENT "EntryPools:\n";
+    for (const EntryPoolStats& stats : getEntryPoolStats()) {
+        dump += StringPrintf(INDENT2 "%s: objectSize=%zu, cached=%zu/%zu, allocations=%" PRIu64
+                                     ", reused=%" PRIu64 ", overflowed=%" PRIu64 "\n",
+                             stats.name, stats.objectSize, stats.cached, stats.maxCached,
+                             stats.allocations, stats.reused, stats.overflowed);
+    }
+
     dump += INDENT "Configuration:\n";
     dump += StringPrintf(INDENT2 "KeyRepeatDelay: %" PRId64 "ms\n", ns2ms(mConfig.keyRepeatDelay));
     dump += StringPrintf(INDENT2 "KeyRepeatTimeout: %" PRId64 "ms\n",
@@ -4314,6 +4413,7 @@ status_t InputDispatcher::registerInputChannel(const sp<InputChannel>& inputChan
 
         int fd = inputChannel->getFd();
         mConnectionsByFd[fd] = connection;
+        mConnectionsByToken[inputChannel->getConnectionToken()] = connection;
         mInputChannelsByToken[inputChannel->getConnectionToken()] = inputChannel;
 
         mLooper->addFd(fd, 0, ALOOPER_EVENT_INPUT, handleReceiveCallback, this);
@@ -4343,6 +4443,7 @@ status_t InputDispatcher::registerInputMonitor(const sp<InputChannel>& inputChan
 
         const int fd = inputChannel->getFd();
         mConnectionsByFd[fd] = connection;
+        mConnectionsByToken[inputChannel->getConnectionToken()] = connection;
         mInputChannelsByToken[inputChannel->getConnectionToken()] = inputChannel;
 
         auto& monitorsByDisplay =
@@ -4493,19 +4594,18 @@ sp<Connection> InputDispatcher::getConnectionLocked(const sp<IBinder>& inputConn
         return nullptr;
     }
 
-    for (const auto& pair : mConnectionsByFd) {
-        const sp<Connection>& connection = pair.second;
-        if (connection->inputChannel->getConnectionToken() == inputConnectionToken) {
-            return connection;
-        }
-    }
-
-    return nullptr;
+    auto it = mConnectionsByToken.find(inputConnectionToken);
+    return it != mConnectionsByToken.end() ? it->second : nullptr;
 }
 
 void InputDispatcher::removeConnectionLocked(const sp<Connection>& connection) {
-    mAnrTracker.eraseToken(connection->inputChannel->getConnectionToken());
+    const sp<IBinder> token = connection->inputChannel->getConnectionToken();
+    mAnrTracker.eraseToken(token);
     removeByValue(mConnectionsByFd, connection);
+    auto it = mConnectionsByToken.find(token);
+    if (it != mConnectionsByToken.end() && it->second == connection) {
+        mConnectionsByToken.erase(it);
+    }
 }
 
 void InputDispatcher::onDispatchCycleFinishedLocked(nsecs_t currentTime,
@@ -4535,11 +4635,11 @@ void InputDispatcher::onFocusChangedLocked(const sp<InputWindowHandle>& oldFocus
                                            const sp<InputWindowHandle>& newFocus) {
     sp<IBinder> oldToken = oldFocus != nullptr ? oldFocus->getToken() : nullptr;
     sp<IBinder> newToken = newFocus != nullptr ? newFocus->getToken() : nullptr;
-    std::unique_ptr<CommandEntry> commandEntry = std::make_unique<CommandEntry>(
-            &InputDispatcher::doNotifyFocusChangedLockedInterruptible);
+    std::unique_ptr<CommandEntry> commandEntry =
+            std::make_unique<CommandEntry>(&InputDispatcher::doNotifyFocusChanged);
     commandEntry->oldToken = oldToken;
     commandEntry->newToken = newToken;
-    postCommandLocked(std::move(commandEntry));
+    postUnlockedCommandLocked(std::move(commandEntry));
 }
 
 void InputDispatcher::onAnrLocked(const sp<Connection>& connection) {
@@ -4619,12 +4719,8 @@ void InputDispatcher::updateLastAnrStateLocked(const std::string& windowLabel,
     dumpDispatchStateLocked(mLastAnrState);
 }
 
-void InputDispatcher::doNotifyConfigurationChangedLockedInterruptible(CommandEntry* commandEntry) {
-    mLock.unlock();
-
+void InputDispatcher::doNotifyConfigurationChanged(CommandEntry* commandEntry) {
     mPolicy->notifyConfigurationChanged(commandEntry->eventTime);
-
-    mLock.lock();
 }
 
 void InputDispatcher::doNotifyInputChannelBrokenLockedInterruptible(CommandEntry* commandEntry) {
@@ -4639,12 +4735,8 @@ void InputDispatcher::doNotifyInputChannelBrokenLockedInterruptible(CommandEntry
     }
 }
 
-void InputDispatcher::doNotifyFocusChangedLockedInterruptible(CommandEntry* commandEntry) {
-    sp<IBinder> oldToken = commandEntry->oldToken;
-    sp<IBinder> newToken = commandEntry->newToken;
-    mLock.unlock();
-    mPolicy->notifyFocusChanged(oldToken, newToken);
-    mLock.lock();
+void InputDispatcher::doNotifyFocusChanged(CommandEntry* commandEntry) {
+    mPolicy->notifyFocusChanged(commandEntry->oldToken, commandEntry->newToken);
 }
 
 void InputDispatcher::doNotifyAnrLockedInterruptible(CommandEntry* commandEntry) {
@@ -4728,10 +4820,8 @@ void InputDispatcher::doInterceptKeyBeforeDispatchingLockedInterruptible(
     entry->release();
 }
 
-void InputDispatcher::doOnPointerDownOutsideFocusLockedInterruptible(CommandEntry* commandEntry) {
-    mLock.unlock();
+void InputDispatcher::doOnPointerDownOutsideFocus(CommandEntry* commandEntry) {
     mPolicy->onPointerDownOutsideFocus(commandEntry->newToken);
-    mLock.lock();
 }
 
 /**
@@ -4765,7 +4855,7 @@ void InputDispatcher::doDispatchCycleFinishedLockedInterruptible(CommandEntry* c
         ALOGI("%s spent %" PRId64 "ms processing %s", connection->getWindowName().c_str(),
               ns2ms(eventDuration), dispatchEntry->eventEntry->getDescription().c_str());
     }
-    reportDispatchStatistics(std::chrono::nanoseconds(eventDuration), *connection, handled);
+    reportDispatchStatistics(*connection, *dispatchEntry, finishTime, handled);
 
     bool restartEvent;
     if (dispatchEntry->eventEntry->type == EventEntry::Type::KEY) {
@@ -4989,12 +5079,8 @@ bool InputDispatcher::afterMotionEventLockedInterruptible(const sp<Connection>&
     return false;
 }
 
-void InputDispatcher::doPokeUserActivityLockedInterruptible(CommandEntry* commandEntry) {
-    mLock.unlock();
-
+void InputDispatcher::doPokeUserActivity(CommandEntry* commandEntry) {
     mPolicy->pokeUserActivity(commandEntry->eventTime, commandEntry->userActivityEventType);
-
-    mLock.lock();
 }
 
 KeyEvent InputDispatcher::createKeyEvent(const KeyEntry& entry) {
@@ -5005,9 +5091,31 @@ KeyEvent InputDispatcher::createKeyEvent(const KeyEntry& entry) {
     return event;
 }
 
-void InputDispatcher::reportDispatchStatistics(std::chrono::nanoseconds eventDuration,
-                                               const Connection& connection, bool handled) {
-    // TODO Write some statistics about how long we spend waiting.
+/**
+ * Adds the time spent in each stage of the pipeline by an event that a window has finished to the
+ * latency distributions. Only events from input devices are tracked.
+ */
+void InputDispatcher::reportDispatchStatistics(const Connection& connection,
+                                               const DispatchEntry& dispatchEntry,
+                                               nsecs_t finishTime, bool handled) {
+    const EventEntry& entry = *dispatchEntry.eventEntry;
+    if (entry.isSynthesized() || entry.enqueueTime == 0) {
+        return;
+    }
+    int32_t deviceId;
+    switch (entry.type) {
+        case EventEntry::Type::KEY:
+            deviceId = static_cast<const KeyEntry&>(entry).deviceId;
+            break;
+        case EventEntry::Type::MOTION:
+            deviceId = static_cast<const MotionEntry&>(entry).deviceId;
+            break;
+        default:
+            return;
+    }
+    mLatencyTracker.addTimeline(deviceId, connection.getWindowName(),
+                                {entry.eventTime, entry.enqueueTime, dispatchEntry.deliveryTime,
+                                 finishTime});
 }
 
 /**
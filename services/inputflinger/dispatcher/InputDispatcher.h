@@ -27,8 +27,10 @@
 #include "InputState.h"
 #include "InputTarget.h"
 #include "InputThread.h"
+#include "LatencyTracker.h"
 #include "Monitor.h"
 #include "TouchState.h"
+#include "TouchWindowIndex.h"
 #include "TouchedWindow.h"
 
 #include <input/Input.h>
@@ -37,6 +39,7 @@
 #include <input/InputWindow.h>
 #include <input/LatencyStatistics.h>
 #include <limits.h>
+#include <openssl/hmac.h>
 #include <stddef.h>
 #include <ui/Region.h>
 #include <unistd.h>
@@ -64,7 +67,9 @@ public:
 
 private:
     std::array<uint8_t, 32> sign(const uint8_t* data, size_t size) const;
-    const std::array<uint8_t, 128> mHmacKey;
+    // Already keyed, so that signing only hashes the event. Copied for every signature, and
+    // never modified after construction, so it can be used from any thread.
+    bssl::ScopedHMAC_CTX mKeyedContext;
 };
 
 /* Dispatches events to input targets.  Some functions of the input dispatcher, such as
@@ -83,6 +88,8 @@ private:
  *     then reacquire the lock.  The caller is responsible for recovering gracefully.
  *
  *     A 'LockedInterruptible' method may called a 'Locked' method, but NOT vice-versa.
+ *
+ *     Commands posted with postUnlockedCommandLocked are run with the lock released.
  */
 class InputDispatcher : public android::InputDispatcherInterface {
 protected:
@@ -209,6 +216,9 @@ private:
             return std::hash<IBinder*>{}(b.get());
         }
     };
+    // All connections, by connection token, so that getConnectionLocked does not scan them.
+    std::unordered_map<sp<IBinder>, sp<Connection>, IBinderHash> mConnectionsByToken
+            GUARDED_BY(mLock);
     std::unordered_map<sp<IBinder>, sp<InputChannel>, IBinderHash> mInputChannelsByToken
             GUARDED_BY(mLock);
 
@@ -227,9 +237,25 @@ private:
 
     const HmacKeyManager mHmacKeyManager;
     const std::array<uint8_t, 32> getSignature(const MotionEntry& motionEntry,
-                                               const DispatchEntry& dispatchEntry) const;
+                                               const DispatchEntry& dispatchEntry)
+            REQUIRES(mLock);
     const std::array<uint8_t, 32> getSignature(const KeyEntry& keyEntry,
-                                               const DispatchEntry& dispatchEntry) const;
+                                               const DispatchEntry& dispatchEntry)
+            REQUIRES(mLock);
+    // The last key and motion event signed, with their signatures. An event is usually published
+    // to several connections (the window and the monitors) with the same signed fields, so it
+    // only needs to be signed once.
+    template <typename T>
+    struct SignedEvent {
+        T event;
+        std::array<uint8_t, 32> hmac;
+    };
+    std::optional<SignedEvent<VerifiedKeyEvent>> mLastSignedKey GUARDED_BY(mLock);
+    std::optional<SignedEvent<VerifiedMotionEvent>> mLastSignedMotion GUARDED_BY(mLock);
+    template <typename T>
+    std::array<uint8_t, 32> signLocked(const T& verifiedEvent,
+                                       std::optional<SignedEvent<T>>& lastSigned)
+            REQUIRES(mLock);
 
     // Event injection and synchronization.
     std::condition_variable mInjectionResultAvailable;
@@ -272,6 +298,16 @@ private:
     bool haveCommandsLocked() const REQUIRES(mLock);
     bool runCommandsLockedInterruptible() REQUIRES(mLock);
     void postCommandLocked(std::unique_ptr<CommandEntry> commandEntry) REQUIRES(mLock);
+    // Posts a command that only calls into the policy, so it can be batched with others.
+    void postUnlockedCommandLocked(std::unique_ptr<CommandEntry> commandEntry) REQUIRES(mLock);
+
+    // Time the dispatcher thread holds mLock for at a stretch. Locked interruptible commands
+    // release it internally, and the time they spend in the policy is counted as held.
+    nsecs_t mLockAcquireTime GUARDED_BY(mLock) = 0;
+    LatencyHistogram mLockHoldTime GUARDED_BY(mLock);
+    size_t mCommandBatchCount GUARDED_BY(mLock) = 0;
+    size_t mBatchedCommandCount GUARDED_BY(mLock) = 0;
+    void recordLockHoldTimeLocked() REQUIRES(mLock);
 
     nsecs_t processAnrsLocked() REQUIRES(mLock);
     nsecs_t getDispatchingTimeoutLocked(const sp<IBinder>& token) REQUIRES(mLock);
@@ -293,6 +329,9 @@ private:
 
     std::unordered_map<int32_t, std::vector<sp<InputWindowHandle>>> mWindowHandlesByDisplay
             GUARDED_BY(mLock);
+    // Hit-testing index over mWindowHandlesByDisplay, kept in sync by
+    // updateWindowHandlesForDisplayLocked.
+    std::unordered_map<int32_t, TouchWindowIndex> mTouchWindowIndexByDisplay GUARDED_BY(mLock);
     void setInputWindowsLocked(const std::vector<sp<InputWindowHandle>>& inputWindowHandles,
                                int32_t displayId) REQUIRES(mLock);
     // Get window handles by display, return an empty vector if not found.
@@ -499,10 +538,9 @@ private:
             REQUIRES(mLock);
 
     // Outbound policy interactions.
-    void doNotifyConfigurationChangedLockedInterruptible(CommandEntry* commandEntry)
-            REQUIRES(mLock);
+    void doNotifyConfigurationChanged(CommandEntry* commandEntry) EXCLUDES(mLock);
     void doNotifyInputChannelBrokenLockedInterruptible(CommandEntry* commandEntry) REQUIRES(mLock);
-    void doNotifyFocusChangedLockedInterruptible(CommandEntry* commandEntry) REQUIRES(mLock);
+    void doNotifyFocusChanged(CommandEntry* commandEntry) EXCLUDES(mLock);
     void doNotifyAnrLockedInterruptible(CommandEntry* commandEntry) REQUIRES(mLock);
     void doInterceptKeyBeforeDispatchingLockedInterruptible(CommandEntry* commandEntry)
             REQUIRES(mLock);
@@ -513,17 +551,18 @@ private:
     bool afterMotionEventLockedInterruptible(const sp<Connection>& connection,
                                              DispatchEntry* dispatchEntry, MotionEntry* motionEntry,
                                              bool handled) REQUIRES(mLock);
-    void doPokeUserActivityLockedInterruptible(CommandEntry* commandEntry) REQUIRES(mLock);
+    void doPokeUserActivity(CommandEntry* commandEntry) EXCLUDES(mLock);
     KeyEvent createKeyEvent(const KeyEntry& entry);
-    void doOnPointerDownOutsideFocusLockedInterruptible(CommandEntry* commandEntry) REQUIRES(mLock);
+    void doOnPointerDownOutsideFocus(CommandEntry* commandEntry) EXCLUDES(mLock);
 
     // Statistics gathering.
     static constexpr std::chrono::duration TOUCH_STATS_REPORT_PERIOD = 5min;
     LatencyStatistics mTouchStatistics{TOUCH_STATS_REPORT_PERIOD};
 
     void reportTouchEventForStatistics(const MotionEntry& entry);
-    void reportDispatchStatistics(std::chrono::nanoseconds eventDuration,
-                                  const Connection& connection, bool handled);
+    LatencyTracker mLatencyTracker GUARDED_BY(mLock);
+    void reportDispatchStatistics(const Connection& connection, const DispatchEntry& dispatchEntry,
+                                  nsecs_t finishTime, bool handled) REQUIRES(mLock);
     void traceInboundQueueLengthLocked() REQUIRES(mLock);
     void traceOutboundQueueLength(const sp<Connection>& connection);
     void traceWaitQueueLength(const sp<Connection>& connection);
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LatencyTracker.h"
+
+#include <android-base/stringprintf.h>
+#include <inttypes.h>
+
+using android::base::StringPrintf;
+
+namespace android::inputdispatcher {
+
+static const char* stageToString(LatencyTracker::Stage stage) {
+    switch (stage) {
+        case LatencyTracker::Stage::EVENT_TO_ENQUEUE:
+            return "event->enqueue";
+        case LatencyTracker::Stage::ENQUEUE_TO_PUBLISH:
+            return "enqueue->publish";
+        case LatencyTracker::Stage::PUBLISH_TO_FINISH:
+            return "publish->finish";
+        case LatencyTracker::Stage::EVENT_TO_FINISH:
+            return "event->finish";
+    }
+}
+
+template <typename Key>
+static std::array<LatencyHistogram, LatencyTracker::STAGE_COUNT>* findOrAdd(
+        std::map<Key, std::array<LatencyHistogram, LatencyTracker::STAGE_COUNT>>& map,
+        const Key& key, size_t maxSize) {
+    auto it = map.find(key);
+    if (it != map.end()) {
+        return &it->second;
+    }
+    if (map.size() >= maxSize) {
+        return nullptr;
+    }
+    return &map[key];
+}
+
+void LatencyTracker::addTimeline(int32_t deviceId, const std::string& windowName,
+                                 const Timeline& timeline) {
+    std::array<int64_t, STAGE_COUNT> micros;
+    micros[static_cast<size_t>(Stage::EVENT_TO_ENQUEUE)] =
+            ns2us(timeline.enqueueTime - timeline.eventTime);
+    micros[static_cast<size_t>(Stage::ENQUEUE_TO_PUBLISH)] =
+            ns2us(timeline.publishTime - timeline.enqueueTime);
+    micros[static_cast<size_t>(Stage::PUBLISH_TO_FINISH)] =
+            ns2us(timeline.finishTime - timeline.publishTime);
+    micros[static_cast<size_t>(Stage::EVENT_TO_FINISH)] =
+            ns2us(timeline.finishTime - timeline.eventTime);
+
+    StageHistograms* device = findOrAdd(mByDevice, deviceId, MAX_DEVICES);
+    StageHistograms* window = findOrAdd(mByWindow, windowName, MAX_WINDOWS);
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        if (device != nullptr) {
+            (*device)[i].addValue(micros[i]);
+        }
+        if (window != nullptr) {
+            (*window)[i].addValue(micros[i]);
+        }
+        if (device == nullptr || window == nullptr) {
+            mOther[i].addValue(micros[i]);
+        }
+    }
+}
+
+const LatencyHistogram* LatencyTracker::getDeviceHistogram(int32_t deviceId, Stage stage) const {
+    auto it = mByDevice.find(deviceId);
+    return it != mByDevice.end() ? &it->second[static_cast<size_t>(stage)] : nullptr;
+}
+
+const LatencyHistogram* LatencyTracker::getWindowHistogram(const std::string& windowName,
+                                                           Stage stage) const {
+    auto it = mByWindow.find(windowName);
+    return it != mByWindow.end() ? &it->second[static_cast<size_t>(stage)] : nullptr;
+}
+
+static void dumpStages(std::string& dump, const char* prefix,
+                       const std::array<LatencyHistogram, LatencyTracker::STAGE_COUNT>& stages) {
+    for (size_t i = 0; i < LatencyTracker::STAGE_COUNT; i++) {
+        const LatencyHistogram& histogram = stages[i];
+        dump += StringPrintf("%s%s: count=%zu, p50=%" PRId64 "us, p90=%" PRId64 "us, p99=%" PRId64
+                             "us, max=%" PRId64 "us\n",
+                             prefix, stageToString(static_cast<LatencyTracker::Stage>(i)),
+                             histogram.getCount(), histogram.getPercentile(50),
+                             histogram.getPercentile(90), histogram.getPercentile(99),
+                             histogram.getMax());
+    }
+}
+
+void LatencyTracker::dump(std::string& dump, const char* prefix) const {
+    const std::string stagePrefix = std::string(prefix) + "    ";
+    for (const auto& [deviceId, stages] : mByDevice) {
+        dump += StringPrintf("%s  device %" PRId32 ":\n", prefix, deviceId);
+        dumpStages(dump, stagePrefix.c_str(), stages);
+    }
+    for (const auto& [windowName, stages] : mByWindow) {
+        dump += StringPrintf("%s  window '%s':\n", prefix, windowName.c_str());
+        dumpStages(dump, stagePrefix.c_str(), stages);
+    }
+    if (mOther[0].getCount() != 0) {
+        dump += StringPrintf("%s  other:\n", prefix);
+        dumpStages(dump, stagePrefix.c_str(), mOther);
+    }
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UI_INPUT_INPUTDISPATCHER_LATENCYTRACKER_H
+#define _UI_INPUT_INPUTDISPATCHER_LATENCYTRACKER_H
+
+#include <input/LatencyStatistics.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <map>
+#include <string>
+
+namespace android::inputdispatcher {
+
+/**
+ * Distributions of the time input events spend in each stage of the pipeline, per input device
+ * and per window, from the dispatch cycles that completed.
+ */
+class LatencyTracker {
+public:
+    enum class Stage {
+        // From the kernel timestamp to the dispatcher inbound queue. This covers the EventHub read
+        // and InputReader processing.
+        EVENT_TO_ENQUEUE,
+        // From the inbound queue to the event being published to the window.
+        ENQUEUE_TO_PUBLISH,
+        // From publishing to the window reporting the event as finished.
+        PUBLISH_TO_FINISH,
+        // From the kernel timestamp to finished.
+        EVENT_TO_FINISH,
+    };
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::EVENT_TO_FINISH) + 1;
+
+    // Samples for devices and windows beyond these are not kept per device or window.
+    static constexpr size_t MAX_DEVICES = 16;
+    static constexpr size_t MAX_WINDOWS = 32;
+
+    struct Timeline {
+        nsecs_t eventTime;
+        nsecs_t enqueueTime;
+        nsecs_t publishTime;
+        nsecs_t finishTime;
+    };
+
+    void addTimeline(int32_t deviceId, const std::string& windowName, const Timeline& timeline);
+
+    // Returns nullptr if there are no samples for the device or window.
+    const LatencyHistogram* getDeviceHistogram(int32_t deviceId, Stage stage) const;
+    const LatencyHistogram* getWindowHistogram(const std::string& windowName, Stage stage) const;
+
+    void dump(std::string& dump, const char* prefix) const;
+
+private:
+    using StageHistograms = std::array<LatencyHistogram, STAGE_COUNT>;
+
+    std::map<int32_t, StageHistograms> mByDevice;
+    std::map<std::string, StageHistograms> mByWindow;
+    // Samples of devices and windows past the limits.
+    StageHistograms mOther;
+};
+
+} // namespace android::inputdispatcher
+
+#endif // _UI_INPUT_INPUTDISPATCHER_LATENCYTRACKER_H
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TouchWindowIndex.h"
+
+#include <algorithm>
+
+namespace android::inputdispatcher {
+
+static bool contains(const Rect& outer, const Rect& inner) {
+    return inner.left >= outer.left && inner.top >= outer.top && inner.right <= outer.right &&
+            inner.bottom <= outer.bottom;
+}
+
+static int32_t cellSize(int32_t begin, int32_t end) {
+    const int64_t length = static_cast<int64_t>(end) - begin;
+    return static_cast<int32_t>(
+            std::max<int64_t>(1, (length + TouchWindowIndex::GRID_SIZE - 1) /
+                                         TouchWindowIndex::GRID_SIZE));
+}
+
+// Cell column or row holding coordinate value, which must lie inside [begin, end).
+static int32_t cellIndex(int32_t value, int32_t begin, int32_t cellSize) {
+    const int64_t index = (static_cast<int64_t>(value) - begin) / cellSize;
+    return static_cast<int32_t>(std::min<int64_t>(index, TouchWindowIndex::GRID_SIZE - 1));
+}
+
+TouchWindowIndex::IndexedWindow TouchWindowIndex::classify(const InputWindowInfo& info) {
+    if (!info.visible) {
+        return {Kind::NONE, Rect::EMPTY_RECT};
+    }
+    const int32_t flags = info.layoutParamsFlags;
+    // Outside targets are collected for every window above the touched one.
+    if (flags & InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH) {
+        return {Kind::GLOBAL, Rect::EMPTY_RECT};
+    }
+    if (flags & InputWindowInfo::FLAG_NOT_TOUCHABLE) {
+        return {Kind::NONE, Rect::EMPTY_RECT};
+    }
+    const bool isTouchModal =
+            (flags & (InputWindowInfo::FLAG_NOT_FOCUSABLE | InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) ==
+            0;
+    if (isTouchModal) {
+        return {Kind::GLOBAL, Rect::EMPTY_RECT};
+    }
+    const Rect bounds = info.touchableRegion.getBounds();
+    if (bounds.isEmpty()) {
+        return {Kind::NONE, Rect::EMPTY_RECT};
+    }
+    return {Kind::REGION, bounds};
+}
+
+void TouchWindowIndex::clear() {
+    mWindowHandles.clear();
+    mWindows.clear();
+    mCells.clear();
+    mGlobal.clear();
+    mExtent = Rect::EMPTY_RECT;
+}
+
+void TouchWindowIndex::update(const std::vector<sp<InputWindowHandle>>& windowHandles) {
+    if (windowHandles != mWindowHandles) {
+        rebuild(windowHandles);
+        return;
+    }
+
+    for (uint32_t i = 0; i < mWindows.size(); i++) {
+        const IndexedWindow window = classify(*mWindowHandles[i]->getInfo());
+        if (window == mWindows[i]) {
+            continue;
+        }
+        if (window.kind == Kind::REGION && (mCells.empty() || !contains(mExtent, window.bounds))) {
+            // The grid no longer covers every window.
+            rebuild(windowHandles);
+            return;
+        }
+        erase(i, mWindows[i]);
+        insert(i, window);
+        mWindows[i] = window;
+    }
+}
+
+void TouchWindowIndex::rebuild(const std::vector<sp<InputWindowHandle>>& windowHandles) {
+    clear();
+    mRebuildCount++;
+    mWindowHandles = windowHandles;
+    mWindows.reserve(windowHandles.size());
+
+    bool haveExtent = false;
+    for (const sp<InputWindowHandle>& windowHandle : windowHandles) {
+        const IndexedWindow window = classify(*windowHandle->getInfo());
+        if (window.kind == Kind::REGION) {
+            if (!haveExtent) {
+                mExtent = window.bounds;
+                haveExtent = true;
+            } else {
+                mExtent.left = std::min(mExtent.left, window.bounds.left);
+                mExtent.top = std::min(mExtent.top, window.bounds.top);
+                mExtent.right = std::max(mExtent.right, window.bounds.right);
+                mExtent.bottom = std::max(mExtent.bottom, window.bounds.bottom);
+            }
+        }
+        mWindows.push_back(window);
+    }
+
+    if (haveExtent) {
+        mCellWidth = cellSize(mExtent.left, mExtent.right);
+        mCellHeight = cellSize(mExtent.top, mExtent.bottom);
+        mCells.resize(GRID_SIZE * GRID_SIZE);
+    }
+    for (uint32_t i = 0; i < mWindows.size(); i++) {
+        insert(i, mWindows[i]);
+    }
+}
+
+template <typename Fn>
+void TouchWindowIndex::forEachCell(const Rect& bounds, Fn fn) {
+    const int32_t left = cellIndex(bounds.left, mExtent.left, mCellWidth);
+    const int32_t right = cellIndex(bounds.right - 1, mExtent.left, mCellWidth);
+    const int32_t top = cellIndex(bounds.top, mExtent.top, mCellHeight);
+    const int32_t bottom = cellIndex(bounds.bottom - 1, mExtent.top, mCellHeight);
+    for (int32_t row = top; row <= bottom; row++) {
+        for (int32_t column = left; column <= right; column++) {
+            fn(mCells[row * GRID_SIZE + column]);
+        }
+    }
+}
+
+static void insertSorted(std::vector<uint32_t>& list, uint32_t index) {
+    list.insert(std::lower_bound(list.begin(), list.end(), index), index);
+}
+
+static void eraseSorted(std::vector<uint32_t>& list, uint32_t index) {
+    auto it = std::lower_bound(list.begin(), list.end(), index);
+    if (it != list.end() && *it == index) {
+        list.erase(it);
+    }
+}
+
+void TouchWindowIndex::insert(uint32_t index, const IndexedWindow& window) {
+    switch (window.kind) {
+        case Kind::NONE:
+            break;
+        case Kind::REGION:
+            forEachCell(window.bounds,
+                        [index](std::vector<uint32_t>& cell) { insertSorted(cell, index); });
+            break;
+        case Kind::GLOBAL:
+            insertSorted(mGlobal, index);
+            break;
+    }
+}
+
+void TouchWindowIndex::erase(uint32_t index, const IndexedWindow& window) {
+    switch (window.kind) {
+        case Kind::NONE:
+            break;
+        case Kind::REGION:
+            forEachCell(window.bounds,
+                        [index](std::vector<uint32_t>& cell) { eraseSorted(cell, index); });
+            break;
+        case Kind::GLOBAL:
+            eraseSorted(mGlobal, index);
+            break;
+    }
+}
+
+const std::vector<uint32_t>* TouchWindowIndex::cellAt(int32_t x, int32_t y) const {
+    if (mCells.empty() || x < mExtent.left || x >= mExtent.right || y < mExtent.top ||
+        y >= mExtent.bottom) {
+        return nullptr;
+    }
+    const int32_t column = cellIndex(x, mExtent.left, mCellWidth);
+    const int32_t row = cellIndex(y, mExtent.top, mCellHeight);
+    return &mCells[row * GRID_SIZE + column];
+}
+
+} // namespace android::inputdispatcher
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UI_INPUT_INPUTDISPATCHER_TOUCHWINDOWINDEX_H
+#define _UI_INPUT_INPUTDISPATCHER_TOUCHWINDOWINDEX_H
+
+#include <input/InputWindow.h>
+#include <ui/Rect.h>
+#include <utils/RefBase.h>
+
+#include <vector>
+
+namespace android::inputdispatcher {
+
+/**
+ * Uniform grid over the touchable bounds of the windows of one display, used to narrow down
+ * touch hit-testing to the windows that can actually be hit at a given location.
+ *
+ * Windows that can be hit anywhere (touch modal) or that must see every touch (watch outside
+ * touch) are kept in a separate list that is merged into every query, so visiting the
+ * candidates front to back is equivalent to walking the whole window list and skipping the
+ * windows that cannot match.
+ */
+class TouchWindowIndex {
+public:
+    static constexpr int32_t GRID_SIZE = 16;
+
+    // Indexes windowHandles, ordered front to back. When the list itself is unchanged, only the
+    // windows whose touchable bounds or flags changed are moved to their new cells.
+    void update(const std::vector<sp<InputWindowHandle>>& windowHandles);
+    void clear();
+
+    // Calls visitor, front to back, with each window that may be touched at (x, y) or that watches
+    // outside touches, until visitor returns true.
+    template <typename Visitor>
+    void forEachCandidate(int32_t x, int32_t y, Visitor visitor) const {
+        const std::vector<uint32_t>* cell = cellAt(x, y);
+        auto c = cell != nullptr ? cell->begin() : mGlobal.end();
+        auto cEnd = cell != nullptr ? cell->end() : mGlobal.end();
+        auto g = mGlobal.begin();
+        while (c != cEnd || g != mGlobal.end()) {
+            const uint32_t i = (g == mGlobal.end() || (c != cEnd && *c < *g)) ? *c++ : *g++;
+            if (visitor(mWindowHandles[i])) {
+                return;
+            }
+        }
+    }
+
+    size_t getWindowCount() const { return mWindowHandles.size(); }
+    // Number of full rebuilds, as opposed to in-place updates of single windows.
+    size_t getRebuildCount() const { return mRebuildCount; }
+
+private:
+    enum class Kind {
+        NONE,   // Can never be touched or receive outside touches.
+        REGION, // Can only be touched within its touchable region bounds.
+        GLOBAL, // Candidate for every touch.
+    };
+
+    struct IndexedWindow {
+        Kind kind;
+        Rect bounds;
+        bool operator==(const IndexedWindow& other) const {
+            return kind == other.kind && (kind != Kind::REGION || bounds == other.bounds);
+        }
+        bool operator!=(const IndexedWindow& other) const { return !(*this == other); }
+    };
+
+    static IndexedWindow classify(const InputWindowInfo& info);
+    void rebuild(const std::vector<sp<InputWindowHandle>>& windowHandles);
+    void insert(uint32_t index, const IndexedWindow& window);
+    void erase(uint32_t index, const IndexedWindow& window);
+    const std::vector<uint32_t>* cellAt(int32_t x, int32_t y) const;
+    // Calls fn with each cell overlapping bounds.
+    template <typename Fn>
+    void forEachCell(const Rect& bounds, Fn fn);
+
+    std::vector<sp<InputWindowHandle>> mWindowHandles;
+    std::vector<IndexedWindow> mWindows;
+    // Union of the bounds of all REGION windows; the grid covers exactly this area.
+    Rect mExtent;
+    int32_t mCellWidth = 1;
+    int32_t mCellHeight = 1;
+    // GRID_SIZE * GRID_SIZE cells, each listing window indexes in ascending (front to back) order.
+    std::vector<std::vector<uint32_t>> mCells;
+    // Indexes of GLOBAL windows in ascending order.
+    std::vector<uint32_t> mGlobal;
+    size_t mRebuildCount = 0;
+};
+
+} // namespace android::inputdispatcher
+
+#endif // _UI_INPUT_INPUTDISPATCHER_TOUCHWINDOWINDEX_H
@@ -28,7 +28,9 @@
 #include <sys/epoll.h>
 #include <sys/inotify.h>
 #include <sys/ioctl.h>
+#include <sys/eventfd.h>
 #include <sys/limits.h>
+#include <sys/poll.h>
 #include <unistd.h>
 
 #define LOG_TAG "EventHub"
@@ -38,6 +40,7 @@
 #include "EventHub.h"
 
 #include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
 #include <cutils/properties.h>
 #include <openssl/sha.h>
 #include <utils/Errors.h>
@@ -45,10 +48,14 @@
 #include <utils/Timers.h>
 #include <utils/threads.h>
 
+#include <input/InputConfigCache.h>
 #include <input/KeyCharacterMap.h>
 #include <input/KeyLayoutMap.h>
 #include <input/VirtualKeyMap.h>
 
+#include <atomic>
+#include <thread>
+
 /* this macro is used to tell if "bit" is set in "array"
  * it selects a byte from the array, and does a boolean AND
  * operation with a byte that only has the relevant bit set.
@@ -118,6 +125,34 @@ static bool isV4lScanningEnabled() {
     return property_get_bool("ro.input.video_enabled", true /* default_value */);
 }
 
+/**
+ * Returns true if high-rate devices (touchscreens, styluses and joysticks) should be read on
+ * dedicated threads, controlled by the system property ro.input.dedicated_reader_threads.
+ *
+ * Each such device then neither waits behind nor delays the other devices read by the
+ * InputReader thread, at the cost of one thread per device.
+ */
+static bool isDedicatedReaderThreadsEnabled() {
+    return property_get_bool("ro.input.dedicated_reader_threads", false /* default_value */);
+}
+
+/**
+ * Returns the directory compiled key layout and key character map files are cached in, set by
+ * the system property ro.input.config_cache_dir. Caching is disabled if it is empty.
+ *
+ * The directory must exist and be writable by the input reader. Entries are validated against
+ * the modification time, size and content hash of their source file, so stale entries are
+ * replaced rather than used, but the cache is never trimmed.
+ */
+static std::string getConfigCacheDirectory() {
+    char directory[PROPERTY_VALUE_MAX];
+    property_get("ro.input.config_cache_dir", directory, "");
+    return directory;
+}
+
+static constexpr uint32_t DEDICATED_READER_CLASSES = INPUT_DEVICE_CLASS_TOUCH |
+        INPUT_DEVICE_CLASS_EXTERNAL_STYLUS | INPUT_DEVICE_CLASS_JOYSTICK;
+
 static nsecs_t processEventTimestamp(const struct input_event& event) {
     // Use the time specified in the event instead of the current time
     // so that downstream code can get more accurate estimates of
@@ -179,6 +214,149 @@ uint32_t getAbsAxisUsage(int32_t axis, uint32_t deviceClasses) {
 
 // --- EventHub::Device ---
 
+// --- EventHub::DeviceReader ---
+
+/**
+ * Reads one evdev device on its own thread into a single-producer single-consumer ring.
+ *
+ * The thread reads as many events as fit in the ring in one read() and then signals an eventfd
+ * that getEvents polls with EPOLLWAKEUP, so the wake lock is held until the InputReader thread
+ * has taken the events. When the ring is full the thread stops reading, and the kernel keeps
+ * buffering (and eventually reports SYN_DROPPED) just as when the InputReader thread falls
+ * behind.
+ */
+class EventHub::DeviceReader {
+public:
+    static constexpr size_t RING_SIZE = 1024; // must be a power of 2
+
+    DeviceReader(int deviceFd, const std::string& name)
+          : mDeviceFd(deviceFd),
+            mReadyFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+            mWakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+            mName(name) {
+        LOG_ALWAYS_FATAL_IF(!mReadyFd.ok() || !mWakeFd.ok(),
+                            "Could not create eventfds for device reader: %s", strerror(errno));
+        mThread = std::thread([this]() { threadLoop(); });
+    }
+
+    ~DeviceReader() {
+        mStopping.store(true);
+        signal(mWakeFd);
+        mThread.join();
+    }
+
+    int getReadyFd() const { return mReadyFd.get(); }
+
+    // Moves up to capacity events out of the ring. Only called by the InputReader thread.
+    size_t drain(struct input_event* out, size_t capacity) {
+        // Clear the notification first: events queued from here on signal again.
+        uint64_t counter;
+        while (read(mReadyFd.get(), &counter, sizeof(counter)) == -1 && errno == EINTR) {
+        }
+
+        const uint64_t tail = mTail.load(std::memory_order_relaxed);
+        const uint64_t head = mHead.load(std::memory_order_acquire);
+        const size_t count = std::min<uint64_t>(head - tail, capacity);
+        for (size_t i = 0; i < count; i++) {
+            out[i] = mRing[(tail + i) & (RING_SIZE - 1)];
+        }
+        mTail.store(tail + count);
+        if (count > 0 && mProducerWaiting.load()) {
+            signal(mWakeFd);
+        }
+        return count;
+    }
+
+    // True once the device has gone away and every event read before that has been drained.
+    bool hasHungUp() const {
+        return mHungUp.load(std::memory_order_acquire) &&
+                mTail.load(std::memory_order_relaxed) == mHead.load(std::memory_order_acquire);
+    }
+
+private:
+    static void signal(const android::base::unique_fd& fd) {
+        const uint64_t one = 1;
+        while (write(fd.get(), &one, sizeof(one)) == -1 && errno == EINTR) {
+        }
+    }
+
+    static void drainWakeFd(const android::base::unique_fd& fd) {
+        uint64_t counter;
+        while (read(fd.get(), &counter, sizeof(counter)) == -1 && errno == EINTR) {
+        }
+    }
+
+    void threadLoop() {
+        std::string threadName = "evdev:" + mName;
+        threadName.resize(std::min<size_t>(threadName.size(), 15));
+        pthread_setname_np(pthread_self(), threadName.c_str());
+
+        struct pollfd fds[2] = {{mDeviceFd, POLLIN, 0}, {mWakeFd.get(), POLLIN, 0}};
+        while (!mStopping.load()) {
+            const uint64_t head = mHead.load(std::memory_order_relaxed);
+            size_t space = RING_SIZE - (head - mTail.load(std::memory_order_acquire));
+            if (space == 0) {
+                // Wait for the InputReader thread to make room, see drain().
+                mProducerWaiting.store(true);
+                if (RING_SIZE - (head - mTail.load()) == 0) {
+                    poll(&fds[1], 1, -1);
+                    drainWakeFd(mWakeFd);
+                }
+                mProducerWaiting.store(false);
+                continue;
+            }
+
+            if (poll(fds, 2, -1) < 0) {
+                if (errno != EINTR) {
+                    ALOGW("Device reader for %s could not poll (errno=%d)", mName.c_str(), errno);
+                }
+                continue;
+            }
+            if (fds[1].revents & POLLIN) {
+                drainWakeFd(mWakeFd);
+                continue;
+            }
+
+            const size_t offset = head & (RING_SIZE - 1);
+            const size_t contiguous = std::min(space, RING_SIZE - offset);
+            const ssize_t readSize =
+                    read(mDeviceFd, &mRing[offset], sizeof(struct input_event) * contiguous);
+            if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
+                mHungUp.store(true, std::memory_order_release);
+                signal(mReadyFd);
+                return;
+            }
+            if (readSize < 0) {
+                if (errno != EAGAIN && errno != EINTR) {
+                    ALOGW("could not get event (errno=%d)", errno);
+                }
+                continue;
+            }
+            if ((readSize % sizeof(struct input_event)) != 0) {
+                ALOGE("could not get event (wrong size: %zd)", readSize);
+                continue;
+            }
+            mHead.store(head + readSize / sizeof(struct input_event), std::memory_order_release);
+            signal(mReadyFd);
+        }
+    }
+
+    const int mDeviceFd;
+    const android::base::unique_fd mReadyFd; // signalled by the thread when events are queued
+    const android::base::unique_fd mWakeFd;  // signalled to stop the thread or when space frees
+    const std::string mName;
+
+    std::atomic<bool> mStopping{false};
+    std::atomic<bool> mProducerWaiting{false};
+    std::atomic<bool> mHungUp{false};
+    // Total number of events ever queued and taken, the ring index is the count modulo RING_SIZE.
+    alignas(64) std::atomic<uint64_t> mHead{0};
+    alignas(64) std::atomic<uint64_t> mTail{0};
+    struct input_event mRing[RING_SIZE];
+
+    std::thread mThread;
+};
+
 EventHub::Device::Device(int fd, int32_t id, const std::string& path,
                          const InputDeviceIdentifier& identifier)
       : next(nullptr),
@@ -209,6 +387,8 @@ EventHub::Device::~Device() {
 }
 
 void EventHub::Device::close() {
+    // The reader thread must be gone before its fd is closed.
+    reader = nullptr;
     if (fd >= 0) {
         ::close(fd);
         fd = -1;
@@ -289,10 +469,12 @@ EventHub::EventHub(void)
         mNeedToSendFinishedDeviceScan(false),
         mNeedToReopenDevices(false),
         mNeedToScanDevices(true),
+        mDedicatedReaderThreads(isDedicatedReaderThreadsEnabled()),
         mPendingEventCount(0),
         mPendingEventIndex(0),
         mPendingINotify(false) {
     ensureProcessCanBlockSuspend();
+    InputConfigCache::setDirectory(getConfigCacheDirectory());
 
     mEpollFd = epoll_create1(EPOLL_CLOEXEC);
     LOG_ALWAYS_FATAL_IF(mEpollFd < 0, "Could not create epoll instance: %s", strerror(errno));
@@ -838,6 +1020,10 @@ EventHub::Device* EventHub::getDeviceByFdLocked(int fd) const {
             // This is a video device event
             return device;
         }
+        if (device->reader && device->reader->getReadyFd() == fd) {
+            // Events read by the device's reader thread
+            return device;
+        }
     }
     // We do not check mUnattachedVideoDevices here because they should not participate in epoll,
     // and therefore should never be looked up by fd.
@@ -972,6 +1158,22 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                 }
                 continue;
             }
+            if (device->reader && eventItem.data.fd == device->reader->getReadyFd()) {
+                size_t count = device->reader->drain(readBuffer, capacity);
+                event = processDeviceEventsLocked(device, readBuffer, count, event);
+                capacity -= count;
+                if (capacity == 0) {
+                    // The result buffer is full. Drain the rest on the next iteration.
+                    mPendingEventIndex -= 1;
+                    break;
+                }
+                if (device->reader->hasHungUp()) {
+                    ALOGW("could not get event, removed? (fd: %d)", device->fd);
+                    deviceChanged = true;
+                    closeDeviceLocked(device);
+                }
+                continue;
+            }
             // This must be an input event
             if (eventItem.events & EPOLLIN) {
                 int32_t readSize =
@@ -990,19 +1192,9 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                 } else if ((readSize % sizeof(struct input_event)) != 0) {
                     ALOGE("could not get event (wrong size: %d)", readSize);
                 } else {
-                    int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
-
                     size_t count = size_t(readSize) / sizeof(struct input_event);
-                    for (size_t i = 0; i < count; i++) {
-                        struct input_event& iev = readBuffer[i];
-                        event->when = processEventTimestamp(iev);
-                        event->deviceId = deviceId;
-                        event->type = iev.type;
-                        event->code = iev.code;
-                        event->value = iev.value;
-                        event += 1;
-                        capacity -= 1;
-                    }
+                    event = processDeviceEventsLocked(device, readBuffer, count, event);
+                    capacity -= count;
                     if (capacity == 0) {
                         // The result buffer is full.  Reset the pending event index
                         // so we will try to read the device again on the next iteration.
@@ -1085,6 +1277,33 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
     return event - buffer;
 }
 
+RawEvent* EventHub::processDeviceEventsLocked(Device* device, const struct input_event* events,
+                                              size_t count, RawEvent* event) {
+    if (count == 0) {
+        return event;
+    }
+    const int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
+    for (size_t i = 0; i < count; i++) {
+        const struct input_event& iev = events[i];
+        event->when = processEventTimestamp(iev);
+        event->deviceId = deviceId;
+        event->type = iev.type;
+        event->code = iev.code;
+        event->value = iev.value;
+        event += 1;
+    }
+
+    const nsecs_t latency = systemTime(SYSTEM_TIME_MONOTONIC) - (event - count)->when;
+    ReadStats& stats = device->readStats;
+    stats.batches += 1;
+    stats.events += count;
+    if (latency > 0) {
+        stats.totalLatency += latency;
+        stats.maxLatency = std::max(stats.maxLatency, latency);
+    }
+    return event;
+}
+
 std::vector<TouchVideoFrame> EventHub::getVideoFrames(int32_t deviceId) {
     AutoMutex _l(mLock);
 
@@ -1173,9 +1392,15 @@ status_t EventHub::registerDeviceForEpollLocked(Device* device) {
         }
         return BAD_VALUE;
     }
-    status_t result = registerFdForEpoll(device->fd);
+    int fd = device->fd;
+    if (device->useReaderThread) {
+        device->reader = std::make_unique<DeviceReader>(device->fd, device->identifier.name);
+        fd = device->reader->getReadyFd();
+    }
+    status_t result = registerFdForEpoll(fd);
     if (result != OK) {
         ALOGE("Could not add input device fd to epoll for device %" PRId32, device->id);
+        device->reader = nullptr;
         return result;
     }
     if (device->videoDevice) {
@@ -1192,7 +1417,15 @@ void EventHub::registerVideoDeviceForEpollLocked(const TouchVideoDevice& videoDe
 }
 
 status_t EventHub::unregisterDeviceFromEpollLocked(Device* device) {
-    if (device->hasValidFd()) {
+    if (device->reader) {
+        status_t result = unregisterFdFromEpoll(device->reader->getReadyFd());
+        // Events still in the ring are dropped, like unread events in the kernel buffer.
+        device->reader = nullptr;
+        if (result != OK) {
+            ALOGW("Could not remove input device fd from epoll for device %" PRId32, device->id);
+            return result;
+        }
+    } else if (device->hasValidFd()) {
         status_t result = unregisterFdFromEpoll(device->fd);
         if (result != OK) {
             ALOGW("Could not remove input device fd from epoll for device %" PRId32, device->id);
@@ -1483,6 +1716,8 @@ status_t EventHub::openDeviceLocked(const char* devicePath) {
                                   }),
                    mUnattachedVideoDevices.end());
 
+    device->useReaderThread =
+            mDedicatedReaderThreads && (device->classes & DEDICATED_READER_CLASSES);
     if (registerDeviceForEpollLocked(device) != OK) {
         delete device;
         return -1;
@@ -1921,6 +2156,8 @@ void EventHub::dump(std::string& dump) {
         AutoMutex _l(mLock);
 
         dump += StringPrintf(INDENT "BuiltInKeyboardId: %d\n", mBuiltInKeyboardId);
+        dump += StringPrintf(INDENT "DedicatedReaderThreads: %s\n",
+                             toString(mDedicatedReaderThreads));
 
         dump += INDENT "Devices:\n";
 
@@ -1936,6 +2173,15 @@ void EventHub::dump(std::string& dump) {
             dump += StringPrintf(INDENT3 "Classes: 0x%08x\n", device->classes);
             dump += StringPrintf(INDENT3 "Path: %s\n", device->path.c_str());
             dump += StringPrintf(INDENT3 "Enabled: %s\n", toString(device->enabled));
+            const ReadStats& stats = device->readStats;
+            dump += StringPrintf(INDENT3 "Reads: readerThread=%s, batches=%" PRIu64
+                                         ", events=%" PRIu64 ", avgLatency=%.1fus, "
+                                         "maxLatency=%.1fus\n",
+                                 toString(device->reader != nullptr), stats.batches, stats.events,
+                                 stats.batches == 0
+                                         ? 0.0
+                                         : stats.totalLatency / 1000.0 / stats.batches,
+                                 stats.maxLatency / 1000.0);
             dump += StringPrintf(INDENT3 "Descriptor: %s\n", device->identifier.descriptor.c_str());
             dump += StringPrintf(INDENT3 "Location: %s\n", device->identifier.location.c_str());
             dump += StringPrintf(INDENT3 "ControllerNumber: %d\n", device->controllerNumber);
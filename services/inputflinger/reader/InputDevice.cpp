@@ -308,7 +308,10 @@ void InputDevice::configure(nsecs_t when, const InputReaderConfiguration* config
         }
 
         for_each_mapper([this, when, config, changes](InputMapper& mapper) {
-            mapper.configure(when, config, changes);
+            // Leave mappers that do not act on any of the changes alone.
+            if (!changes || (changes & mapper.getConfigurationChanges())) {
+                mapper.configure(when, config, changes);
+            }
             mSources |= mapper.getSources();
         });
 
@@ -332,10 +332,20 @@ void InputReader::refreshConfigurationLocked(uint32_t changes) {
         if (changes & InputReaderConfiguration::CHANGE_MUST_REOPEN) {
             mEventHub->requestReopenDevices();
         } else {
+            mLastConfigurationChanges = changes;
+            mSlowestConfiguredDevice.clear();
+            mSlowestDeviceConfigurationDuration = 0;
             for (auto& devicePair : mDevices) {
                 std::shared_ptr<InputDevice>& device = devicePair.second;
+                const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
                 device->configure(now, &mConfig, changes);
+                const nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+                if (duration > mSlowestDeviceConfigurationDuration) {
+                    mSlowestDeviceConfigurationDuration = duration;
+                    mSlowestConfiguredDevice = device->getName();
+                }
             }
+            mLastConfigurationDuration = systemTime(SYSTEM_TIME_MONOTONIC) - now;
         }
     }
 }
@@ -681,6 +691,16 @@ void InputReader::dump(std::string& dump) {
 
     dump += INDENT3 "Viewports:\n";
     mConfig.dump(dump);
+
+    if (mLastConfigurationChanges) {
+        dump += StringPrintf(INDENT2 "LastReconfiguration: changes=%s, duration=%0.3fms, "
+                                     "slowestDevice='%s' (%0.3fms)\n",
+                             InputReaderConfiguration::changesToString(mLastConfigurationChanges)
+                                     .c_str(),
+                             mLastConfigurationDuration * 0.000001f,
+                             mSlowestConfiguredDevice.c_str(),
+                             mSlowestDeviceConfigurationDuration * 0.000001f);
+    }
 }
 
 void InputReader::monitor() {
@@ -26,8 +26,10 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include <iostream>
+#include <mutex>
 
 #include <android-base/stringprintf.h>
+#include <android-base/thread_annotations.h>
 #include <android-base/unique_fd.h>
 #include <log/log.h>
 
@@ -36,15 +38,99 @@ using android::base::unique_fd;
 
 namespace android {
 
+// --- TouchVideoDevice::Buffers ---
+
+class TouchVideoDevice::Buffers {
+public:
+    // The fd is owned by the device, and only used until close() is called.
+    Buffers(int fd, size_t length) : mFd(fd), mLength(length) { mLocations.fill(nullptr); }
+
+    ~Buffers() {
+        for (const int16_t* location : mLocations) {
+            if (location == nullptr) {
+                continue;
+            }
+            void* bufferAddress = static_cast<void*>(const_cast<int16_t*>(location));
+            if (munmap(bufferAddress, mLength) == -1) {
+                ALOGE("%s: Couldn't unmap: [%s]", __func__, strerror(errno));
+            }
+        }
+    }
+
+    bool map(size_t index, uint32_t offset) {
+        void* location = mmap(nullptr /* start anywhere */, mLength, PROT_READ /* required */,
+                              MAP_SHARED /* recommended */, mFd, offset);
+        if (location == MAP_FAILED) {
+            ALOGE("%s: map failed: %s", __func__, strerror(errno));
+            return false;
+        }
+        mLocations[index] = static_cast<const int16_t*>(location);
+        return true;
+    }
+
+    const int16_t* getLocation(size_t index) const { return mLocations[index]; }
+
+    /**
+     * Give a buffer to the driver to fill. Does nothing once the device is closed.
+     */
+    bool queue(uint32_t index) {
+        std::scoped_lock _l(mLock);
+        if (mClosed) {
+            return false;
+        }
+        struct v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = index;
+        if (ioctl(mFd, VIDIOC_QBUF, &buf) == -1) {
+            ALOGE("VIDIOC_QBUF failed for buffer %" PRIu32 ": %s", index, strerror(errno));
+            return false;
+        }
+        mQueuedCount++;
+        return true;
+    }
+
+    /**
+     * Account for a buffer taken back from the driver. Return true if a frame may keep it,
+     * false if it should be copied out and queued again straight away.
+     */
+    bool dequeued() {
+        std::scoped_lock _l(mLock);
+        mQueuedCount--;
+        return mQueuedCount >= MIN_QUEUED_BUFFERS;
+    }
+
+    void close() {
+        std::scoped_lock _l(mLock);
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        if (ioctl(mFd, VIDIOC_STREAMOFF, &type) == -1) {
+            ALOGE("VIDIOC_STREAMOFF failed: %s", strerror(errno));
+        }
+        mClosed = true;
+    }
+
+private:
+    const int mFd;
+    const size_t mLength;
+    std::array<const int16_t*, NUM_BUFFERS> mLocations;
+
+    std::mutex mLock;
+    // Number of buffers the driver is holding.
+    size_t mQueuedCount GUARDED_BY(mLock) = 0;
+    bool mClosed GUARDED_BY(mLock) = false;
+};
+
+// --- TouchVideoDevice ---
+
 TouchVideoDevice::TouchVideoDevice(int fd, std::string&& name, std::string&& devicePath,
                                    uint32_t height, uint32_t width,
-                                   const std::array<const int16_t*, NUM_BUFFERS>& readLocations)
+                                   std::shared_ptr<Buffers> buffers)
       : mFd(fd),
         mName(std::move(name)),
         mPath(std::move(devicePath)),
         mHeight(height),
         mWidth(width),
-        mReadLocations(readLocations) {
+        mBuffers(std::move(buffers)) {
     mFrames.reserve(MAX_QUEUE_SIZE);
 };
 
@@ -114,7 +200,8 @@ std::unique_ptr<TouchVideoDevice> TouchVideoDevice::create(std::string devicePat
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     buf.memory = V4L2_MEMORY_MMAP;
     // buf.reserved and buf.reserved2 are zeroed during initialization, required per v4l docs
-    std::array<const int16_t*, NUM_BUFFERS> readLocations;
+    std::shared_ptr<Buffers> buffers =
+            std::make_shared<Buffers>(fd.get(), height * width * sizeof(int16_t));
     for (size_t i = 0; i < NUM_BUFFERS; i++) {
         buf.index = i;
         result = ioctl(fd.get(), VIDIOC_QUERYBUF, &buf);
@@ -128,11 +215,7 @@ std::unique_ptr<TouchVideoDevice> TouchVideoDevice::create(std::string devicePat
             return nullptr;
         }
 
-        readLocations[i] = static_cast<const int16_t*>(
-                mmap(nullptr /* start anywhere */, buf.length, PROT_READ /* required */,
-                     MAP_SHARED /* recommended */, fd.get(), buf.m.offset));
-        if (readLocations[i] == MAP_FAILED) {
-            ALOGE("%s: map failed: %s", __func__, strerror(errno));
+        if (!buffers->map(i, buf.m.offset)) {
             return nullptr;
         }
     }
@@ -145,17 +228,14 @@ std::unique_ptr<TouchVideoDevice> TouchVideoDevice::create(std::string devicePat
     }
 
     for (size_t i = 0; i < NUM_BUFFERS; i++) {
-        buf.index = i;
-        result = ioctl(fd.get(), VIDIOC_QBUF, &buf);
-        if (result == -1) {
-            ALOGE("VIDIOC_QBUF failed for buffer %zu: %s", i, strerror(errno));
+        if (!buffers->queue(i)) {
             return nullptr;
         }
     }
     // Using 'new' to access a non-public constructor.
     return std::unique_ptr<TouchVideoDevice>(new TouchVideoDevice(fd.release(), std::move(name),
                                                                   std::move(devicePath), height,
-                                                                  width, readLocations));
+                                                                  width, std::move(buffers)));
 }
 
 size_t TouchVideoDevice::readAndQueueFrames() {
@@ -200,16 +280,23 @@ std::optional<TouchVideoFrame> TouchVideoDevice::readFrame() {
         ALOGW("The timestamp %ld.%ld was not acquired using CLOCK_MONOTONIC", buf.timestamp.tv_sec,
               buf.timestamp.tv_usec);
     }
-    std::vector<int16_t> data(mHeight * mWidth);
-    const int16_t* readFrom = mReadLocations[buf.index];
-    std::copy(readFrom, readFrom + mHeight * mWidth, data.begin());
-    TouchVideoFrame frame(mHeight, mWidth, std::move(data), buf.timestamp);
-
-    result = ioctl(mFd.get(), VIDIOC_QBUF, &buf);
-    if (result == -1) {
-        ALOGE("VIDIOC_QBUF failed: %s", strerror(errno));
+    const int16_t* readFrom = mBuffers->getLocation(buf.index);
+    const size_t size = mHeight * mWidth;
+    if (!mBuffers->dequeued()) {
+        // Too many frames are still holding on to buffers. Copy this one so the driver gets its
+        // buffer back now.
+        std::vector<int16_t> data(readFrom, readFrom + size);
+        mBuffers->queue(buf.index);
+        return std::make_optional<TouchVideoFrame>(mHeight, mWidth, std::move(data),
+                                                   buf.timestamp);
     }
-    return std::make_optional(std::move(frame));
+    // The frame points into the mapped buffer, and the last copy of it queues the buffer back.
+    const uint32_t index = buf.index;
+    std::shared_ptr<const int16_t> data(readFrom, [buffers = mBuffers, index](const int16_t*) {
+        buffers->queue(index);
+    });
+    return std::make_optional<TouchVideoFrame>(mHeight, mWidth, std::move(data), size,
+                                               buf.timestamp);
 }
 
 /*
@@ -230,18 +317,8 @@ std::vector<TouchVideoFrame> TouchVideoDevice::readFrames() {
 }
 
 TouchVideoDevice::~TouchVideoDevice() {
-    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    int result = ioctl(mFd.get(), VIDIOC_STREAMOFF, &type);
-    if (result == -1) {
-        ALOGE("VIDIOC_STREAMOFF failed: %s", strerror(errno));
-    }
-    for (const int16_t* buffer : mReadLocations) {
-        void* bufferAddress = static_cast<void*>(const_cast<int16_t*>(buffer));
-        result = munmap(bufferAddress, mHeight * mWidth * sizeof(int16_t));
-        if (result == -1) {
-            ALOGE("%s: Couldn't unmap: [%s]", __func__, strerror(errno));
-        }
-    }
+    // Frames that are still in flight keep the buffers mapped, but no longer queue them.
+    mBuffers->close();
 }
 
 std::string TouchVideoDevice::dump() const {
@@ -320,6 +320,17 @@ public:
     virtual ~EventHub() override;
 
 private:
+    class DeviceReader;
+
+    // Per device read latency, measured from the kernel timestamp of the oldest event in each
+    // batch to the time the batch reached getEvents.
+    struct ReadStats {
+        uint64_t batches = 0;
+        uint64_t events = 0;
+        nsecs_t totalLatency = 0;
+        nsecs_t maxLatency = 0;
+    };
+
     struct Device {
         Device* next;
 
@@ -365,6 +376,12 @@ private:
         bool hasValidFd();
         const bool isVirtual; // set if fd < 0 is passed to constructor
 
+        // Set for high-rate devices when dedicated reader threads are enabled. The reader only
+        // exists while the device is registered for epoll.
+        bool useReaderThread = false;
+        std::unique_ptr<DeviceReader> reader;
+        ReadStats readStats;
+
         const sp<KeyCharacterMap>& getKeyCharacterMap() const {
             if (combinedKeyMap != nullptr) {
                 return combinedKeyMap;
@@ -394,6 +411,9 @@ private:
     status_t registerDeviceForEpollLocked(Device* device);
     void registerVideoDeviceForEpollLocked(const TouchVideoDevice& videoDevice);
     status_t unregisterDeviceFromEpollLocked(Device* device);
+    // Converts count events read from device into RawEvents at event, and records read stats.
+    RawEvent* processDeviceEventsLocked(Device* device, const struct input_event* events,
+                                        size_t count, RawEvent* event);
     void unregisterVideoDeviceFromEpollLocked(const TouchVideoDevice& videoDevice);
 
     status_t scanDirLocked(const char* dirname);
@@ -459,6 +479,8 @@ private:
     bool mNeedToReopenDevices;
     bool mNeedToScanDevices;
     std::vector<std::string> mExcludedDevices;
+    // Whether touch, stylus and joystick devices get their own reader thread.
+    const bool mDedicatedReaderThreads;
 
     int mEpollFd;
     int mINotifyFd;
@@ -133,6 +133,12 @@ private:
 
     InputReaderConfiguration mConfig;
 
+    // Timing of the last reconfiguration of the devices, for dump.
+    uint32_t mLastConfigurationChanges = 0;
+    nsecs_t mLastConfigurationDuration = 0;
+    std::string mSlowestConfiguredDevice;
+    nsecs_t mSlowestDeviceConfigurationDuration = 0;
+
     // The event queue.
     static const int EVENT_BUFFER_SIZE = 256;
     RawEvent mEventBuffer[EVENT_BUFFER_SIZE];
@@ -21,6 +21,7 @@
 #include <input/TouchVideoFrame.h>
 #include <stdint.h>
 #include <array>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -95,9 +96,22 @@ private:
      * How many buffers to request for heatmap.
      * The kernel driver will be allocating these buffers for us,
      * and will provide memory locations to read these from.
+     * Frames point into these buffers while they travel through the reader and classifier,
+     * so there are enough for a few frames in flight on top of the ones the driver fills.
      */
-    static constexpr size_t NUM_BUFFERS = 3;
-    std::array<const int16_t*, NUM_BUFFERS> mReadLocations;
+    static constexpr size_t NUM_BUFFERS = 8;
+    /**
+     * How many buffers the driver is left with, at least. A frame read while fewer are queued
+     * is copied out, and its buffer given back straight away, so that the driver never runs out.
+     */
+    static constexpr size_t MIN_QUEUED_BUFFERS = 2;
+    /**
+     * The mapped buffers, shared with the frames that point into them. A buffer is queued back
+     * to the driver when the last frame using it is dropped, and unmapped once the device is
+     * closed and no frames are left.
+     */
+    class Buffers;
+    std::shared_ptr<Buffers> mBuffers;
     /**
      * How many buffers to keep for the internal queue. When the internal buffer
      * exceeds this capacity, oldest frames will be dropped.
@@ -110,8 +124,7 @@ private:
      * To get a new TouchVideoDevice, use 'create' instead.
      */
     explicit TouchVideoDevice(int fd, std::string&& name, std::string&& devicePath, uint32_t height,
-                              uint32_t width,
-                              const std::array<const int16_t*, NUM_BUFFERS>& readLocations);
+                              uint32_t width, std::shared_ptr<Buffers> buffers);
     /**
      * Read all currently available frames.
      */
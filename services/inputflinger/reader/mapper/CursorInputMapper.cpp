@@ -193,6 +193,12 @@ void CursorInputMapper::configure(nsecs_t when, const InputReaderConfiguration*
     }
 }
 
+uint32_t CursorInputMapper::getConfigurationChanges() const {
+    return InputReaderConfiguration::CHANGE_DISPLAY_INFO |
+            InputReaderConfiguration::CHANGE_POINTER_CAPTURE |
+            InputReaderConfiguration::CHANGE_POINTER_SPEED;
+}
+
 void CursorInputMapper::configureParameters() {
     mParameters.mode = Parameters::MODE_POINTER;
     String8 cursorModeString;
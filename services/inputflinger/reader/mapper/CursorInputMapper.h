@@ -61,6 +61,7 @@ public:
     virtual void dump(std::string& dump) override;
     virtual void configure(nsecs_t when, const InputReaderConfiguration* config,
                            uint32_t changes) override;
+    virtual uint32_t getConfigurationChanges() const override;
     virtual void reset(nsecs_t when) override;
     virtual void process(const RawEvent* rawEvent) override;
 
@@ -35,6 +35,10 @@ void InputMapper::dump(std::string& dump) {}
 void InputMapper::configure(nsecs_t when, const InputReaderConfiguration* config,
                             uint32_t changes) {}
 
+uint32_t InputMapper::getConfigurationChanges() const {
+    return ~0u;
+}
+
 void InputMapper::reset(nsecs_t when) {}
 
 void InputMapper::timeoutExpired(nsecs_t when) {}
@@ -53,6 +53,9 @@ public:
     virtual void populateDeviceInfo(InputDeviceInfo* deviceInfo);
     virtual void dump(std::string& dump);
     virtual void configure(nsecs_t when, const InputReaderConfiguration* config, uint32_t changes);
+    // The InputReaderConfiguration changes that configure() acts on once the mapper has been
+    // configured for the first time. The mapper is not reconfigured for any other changes.
+    virtual uint32_t getConfigurationChanges() const;
     virtual void reset(nsecs_t when);
     virtual void process(const RawEvent* rawEvent) = 0;
     virtual void timeoutExpired(nsecs_t when);
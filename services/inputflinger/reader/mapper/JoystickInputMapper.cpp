@@ -198,6 +198,11 @@ void JoystickInputMapper::configure(nsecs_t when, const InputReaderConfiguration
     }
 }
 
+uint32_t JoystickInputMapper::getConfigurationChanges() const {
+    // Only configured once, when the device is added.
+    return 0;
+}
+
 bool JoystickInputMapper::haveAxis(int32_t axisId) {
     size_t numAxes = mAxes.size();
     for (size_t i = 0; i < numAxes; i++) {
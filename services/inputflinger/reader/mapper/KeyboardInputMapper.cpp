@@ -158,6 +158,10 @@ void KeyboardInputMapper::configure(nsecs_t when, const InputReaderConfiguration
     }
 }
 
+uint32_t KeyboardInputMapper::getConfigurationChanges() const {
+    return InputReaderConfiguration::CHANGE_DISPLAY_INFO;
+}
+
 static void mapStemKey(int32_t keyCode, const PropertyMap& config, char const* property) {
     int32_t mapped = 0;
     if (config.tryGetProperty(String8(property), mapped) && mapped > 0) {
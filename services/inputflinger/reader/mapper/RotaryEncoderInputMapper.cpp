@@ -75,6 +75,10 @@ void RotaryEncoderInputMapper::configure(nsecs_t when, const InputReaderConfigur
     }
 }
 
+uint32_t RotaryEncoderInputMapper::getConfigurationChanges() const {
+    return InputReaderConfiguration::CHANGE_DISPLAY_INFO;
+}
+
 void RotaryEncoderInputMapper::reset(nsecs_t when) {
     mRotaryEncoderScrollAccumulator.reset(getDeviceContext());
 
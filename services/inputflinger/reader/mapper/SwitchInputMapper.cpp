@@ -29,6 +29,11 @@ uint32_t SwitchInputMapper::getSources() {
     return AINPUT_SOURCE_SWITCH;
 }
 
+uint32_t SwitchInputMapper::getConfigurationChanges() const {
+    // Only configured once, when the device is added.
+    return 0;
+}
+
 void SwitchInputMapper::process(const RawEvent* rawEvent) {
     switch (rawEvent->type) {
         case EV_SW:
@@ -27,6 +27,7 @@ public:
     virtual ~SwitchInputMapper();
 
     virtual uint32_t getSources() override;
+    virtual uint32_t getConfigurationChanges() const override;
     virtual void process(const RawEvent* rawEvent) override;
 
     virtual int32_t getSwitchState(uint32_t sourceMask, int32_t switchCode) override;
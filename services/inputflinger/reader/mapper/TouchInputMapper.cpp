@@ -391,6 +391,15 @@ void TouchInputMapper::configure(nsecs_t when, const InputReaderConfiguration* c
     }
 }
 
+uint32_t TouchInputMapper::getConfigurationChanges() const {
+    return InputReaderConfiguration::CHANGE_DISPLAY_INFO |
+            InputReaderConfiguration::CHANGE_POINTER_GESTURE_ENABLEMENT |
+            InputReaderConfiguration::CHANGE_POINTER_SPEED |
+            InputReaderConfiguration::CHANGE_SHOW_TOUCHES |
+            InputReaderConfiguration::CHANGE_TOUCH_AFFINE_TRANSFORMATION |
+            InputReaderConfiguration::CHANGE_EXTERNAL_STYLUS_PRESENCE;
+}
+
 void TouchInputMapper::resolveExternalStylusPresence() {
     std::vector<InputDeviceInfo> devices;
     getContext()->getExternalStylusDevices(devices);
@@ -1354,6 +1363,50 @@ void TouchInputMapper::dumpAffineTransformation(std::string& dump) {
 void TouchInputMapper::updateAffineTransformation() {
     mAffineTransform = getPolicy()->getTouchAffineTransformation(getDeviceContext().getDescriptor(),
                                                                  mSurfaceOrientation);
+    updatePositionTransform();
+}
+
+void TouchInputMapper::updatePositionTransform() {
+    // The surface rotation, applied to coordinates already scaled to the surface, as
+    // x' = rx.x * x + rx.y * y + r0.x and y' = ry.x * x + ry.y * y + r0.y.
+    // 0 - no swap and reverse.
+    // 90 - swap x/y and reverse y.
+    // 180 - reverse x, y.
+    // 270 - swap x/y and reverse x.
+    double rxx, rxy, rx0, ryx, ryy, ry0;
+    switch (mSurfaceOrientation) {
+        case DISPLAY_ORIENTATION_90:
+            rxx = 0, rxy = 1, rx0 = mYTranslate;
+            ryx = -1, ryy = 0, ry0 = mSurfaceRight;
+            break;
+        case DISPLAY_ORIENTATION_180:
+            rxx = -1, rxy = 0, rx0 = mSurfaceRight;
+            ryx = 0, ryy = -1, ry0 = mSurfaceBottom;
+            break;
+        case DISPLAY_ORIENTATION_270:
+            rxx = 0, rxy = -1, rx0 = mSurfaceBottom;
+            ryx = 1, ryy = 0, ry0 = mXTranslate;
+            break;
+        default:
+            rxx = 1, rxy = 0, rx0 = mXTranslate;
+            ryx = 0, ryy = 1, ry0 = mYTranslate;
+            break;
+    }
+
+    // Calibration, then scaling to the surface, then rotation.
+    const TouchAffineTransformation& a = mAffineTransform;
+    const double sxx = double(mXScale) * a.x_scale;
+    const double sxy = double(mXScale) * a.x_ymix;
+    const double sx0 = double(mXScale) * (double(a.x_offset) - mRawPointerAxes.x.minValue);
+    const double syx = double(mYScale) * a.y_xmix;
+    const double syy = double(mYScale) * a.y_scale;
+    const double sy0 = double(mYScale) * (double(a.y_offset) - mRawPointerAxes.y.minValue);
+    mPositionTransform.xx = float(rxx * sxx + rxy * syx);
+    mPositionTransform.xy = float(rxx * sxy + rxy * syy);
+    mPositionTransform.x0 = float(rxx * sx0 + rxy * sy0 + rx0);
+    mPositionTransform.yx = float(ryx * sxx + ryy * syx);
+    mPositionTransform.yy = float(ryx * sxy + ryy * syy);
+    mPositionTransform.y0 = float(ryx * sx0 + ryy * sy0 + ry0);
 }
 
 void TouchInputMapper::reset(nsecs_t when) {
@@ -2014,6 +2067,15 @@ const BitSet32& TouchInputMapper::findActiveIdBits(const CookedPointerData& cook
     return cookedPointerData.hoveringIdBits;
 }
 
+// Same as PointerCoords::setAxisValue() for an axis above all axes already set, without
+// searching for its index or moving the values after it.
+static inline void appendAxisValue(PointerCoords& coords, int32_t axis, float value) {
+    if (value != 0) { // axes with value 0 are not stored
+        coords.values[BitSet64::count(coords.bits)] = value;
+        BitSet64::markBit(coords.bits, axis);
+    }
+}
+
 void TouchInputMapper::cookPointerData() {
     uint32_t currentPointerCount = mCurrentRawState.rawPointerData.pointerCount;
 
@@ -2030,8 +2092,24 @@ void TouchInputMapper::cookPointerData() {
         mCurrentCookedState.buttonState = mCurrentRawState.buttonState;
     }
 
-    // Walk through the the active pointers and map device coordinates onto
-    // surface coordinates and adjust for display orientation.
+    // Map device coordinates onto surface coordinates for all pointers at once, over
+    // contiguous arrays so that the compiler can vectorize the loop.
+    float xTransformed[MAX_POINTERS];
+    float yTransformed[MAX_POINTERS];
+    for (uint32_t i = 0; i < currentPointerCount; i++) {
+        xTransformed[i] = mCurrentRawState.rawPointerData.pointers[i].x;
+        yTransformed[i] = mCurrentRawState.rawPointerData.pointers[i].y;
+    }
+    const PositionTransform& transform = mPositionTransform;
+    for (uint32_t i = 0; i < currentPointerCount; i++) {
+        const float x = xTransformed[i];
+        const float y = yTransformed[i];
+        xTransformed[i] = transform.xx * x + transform.xy * y + transform.x0;
+        yTransformed[i] = transform.yx * x + transform.yy * y + transform.y0;
+    }
+
+    // Walk through the the active pointers and cook the remaining axes, adjusting for display
+    // orientation.
     for (uint32_t i = 0; i < currentPointerCount; i++) {
         const RawPointerData::Pointer& in = mCurrentRawState.rawPointerData.pointers[i];
 
@@ -2185,13 +2263,8 @@ void TouchInputMapper::cookPointerData() {
                 break;
         }
 
-        // Adjust X,Y coords for device calibration
-        // TODO: Adjust coverage coords?
-        float xTransformed = in.x, yTransformed = in.y;
-        mAffineTransform.applyTo(xTransformed, yTransformed);
-        rotateAndScale(xTransformed, yTransformed);
-
-        // Adjust X, Y, and coverage coords for surface orientation.
+        // Adjust coverage coords for surface orientation.
+        // TODO: Adjust coverage coords for device calibration?
         float left, top, right, bottom;
 
         switch (mSurfaceOrientation) {
@@ -2239,26 +2312,27 @@ void TouchInputMapper::cookPointerData() {
                 break;
         }
 
-        // Write output coords.
+        // Write output coords, in ascending axis order.
         PointerCoords& out = mCurrentCookedState.cookedPointerData.pointerCoords[i];
         out.clear();
-        out.setAxisValue(AMOTION_EVENT_AXIS_X, xTransformed);
-        out.setAxisValue(AMOTION_EVENT_AXIS_Y, yTransformed);
-        out.setAxisValue(AMOTION_EVENT_AXIS_PRESSURE, pressure);
-        out.setAxisValue(AMOTION_EVENT_AXIS_SIZE, size);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, touchMajor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, touchMinor);
-        out.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, orientation);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
-        out.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, distance);
+        appendAxisValue(out, AMOTION_EVENT_AXIS_X, xTransformed[i]);
+        appendAxisValue(out, AMOTION_EVENT_AXIS_Y, yTransformed[i]);
+        appendAxisValue(out, AMOTION_EVENT_AXIS_PRESSURE, pressure);
+        appendAxisValue(out, AMOTION_EVENT_AXIS_SIZE, size);
+        appendAxisValue(out, AMOTION_EVENT_AXIS_TOUCH_MAJOR, touchMajor);
+        appendAxisValue(out, AMOTION_EVENT_AXIS_TOUCH_MINOR, touchMinor);
+        if (mCalibration.coverageCalibration != Calibration::COVERAGE_CALIBRATION_BOX) {
+            appendAxisValue(out, AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
+            appendAxisValue(out, AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
+        }
+        appendAxisValue(out, AMOTION_EVENT_AXIS_ORIENTATION, orientation);
+        appendAxisValue(out, AMOTION_EVENT_AXIS_DISTANCE, distance);
+        appendAxisValue(out, AMOTION_EVENT_AXIS_TILT, tilt);
         if (mCalibration.coverageCalibration == Calibration::COVERAGE_CALIBRATION_BOX) {
-            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_1, left);
-            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_2, top);
-            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_3, right);
-            out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_4, bottom);
-        } else {
-            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
-            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
+            appendAxisValue(out, AMOTION_EVENT_AXIS_GENERIC_1, left);
+            appendAxisValue(out, AMOTION_EVENT_AXIS_GENERIC_2, top);
+            appendAxisValue(out, AMOTION_EVENT_AXIS_GENERIC_3, right);
+            appendAxisValue(out, AMOTION_EVENT_AXIS_GENERIC_4, bottom);
         }
 
         // Write output properties.
@@ -3620,38 +3694,6 @@ void TouchInputMapper::cancelTouch(nsecs_t when) {
 }
 
 // Transform raw coordinate to surface coordinate
-void TouchInputMapper::rotateAndScale(float& x, float& y) {
-    // Scale to surface coordinate.
-    const float xScaled = float(x - mRawPointerAxes.x.minValue) * mXScale;
-    const float yScaled = float(y - mRawPointerAxes.y.minValue) * mYScale;
-
-    // Rotate to surface coordinate.
-    // 0 - no swap and reverse.
-    // 90 - swap x/y and reverse y.
-    // 180 - reverse x, y.
-    // 270 - swap x/y and reverse x.
-    switch (mSurfaceOrientation) {
-        case DISPLAY_ORIENTATION_0:
-            x = xScaled + mXTranslate;
-            y = yScaled + mYTranslate;
-            break;
-        case DISPLAY_ORIENTATION_90:
-            y = mSurfaceRight - xScaled;
-            x = yScaled + mYTranslate;
-            break;
-        case DISPLAY_ORIENTATION_180:
-            x = mSurfaceRight - xScaled;
-            y = mSurfaceBottom - yScaled;
-            break;
-        case DISPLAY_ORIENTATION_270:
-            y = xScaled + mXTranslate;
-            x = mSurfaceBottom - yScaled;
-            break;
-        default:
-            assert(false);
-    }
-}
-
 bool TouchInputMapper::isPointInsideSurface(int32_t x, int32_t y) {
     const float xScaled = (x - mRawPointerAxes.x.minValue) * mXScale;
     const float yScaled = (y - mRawPointerAxes.y.minValue) * mYScale;
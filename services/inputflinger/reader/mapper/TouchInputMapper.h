@@ -140,6 +140,7 @@ public:
     virtual void dump(std::string& dump) override;
     virtual void configure(nsecs_t when, const InputReaderConfiguration* config,
                            uint32_t changes) override;
+    virtual uint32_t getConfigurationChanges() const override;
     virtual void reset(nsecs_t when) override;
     virtual void process(const RawEvent* rawEvent) override;
 
@@ -292,6 +293,14 @@ protected:
     // Affine location transformation/calibration
     struct TouchAffineTransformation mAffineTransform;
 
+    // Raw to surface coordinates of pointer positions: the calibration, scaling and surface
+    // rotation folded into one affine map, x' = xx * x + xy * y + x0 and
+    // y' = yx * x + yy * y + y0.
+    struct PositionTransform {
+        float xx, xy, x0;
+        float yx, yy, y0;
+    } mPositionTransform;
+
     RawPointerAxes mRawPointerAxes;
 
     struct RawState {
@@ -392,6 +401,7 @@ protected:
     virtual void resolveCalibration();
     virtual void dumpCalibration(std::string& dump);
     virtual void updateAffineTransformation();
+    void updatePositionTransform();
     virtual void dumpAffineTransformation(std::string& dump);
     virtual void resolveExternalStylusPresence();
     virtual bool hasStylus() const = 0;
@@ -761,7 +771,6 @@ private:
     static void assignPointerIds(const RawState* last, RawState* current);
 
     const char* modeToString(DeviceMode deviceMode);
-    void rotateAndScale(float& x, float& y);
 };
 
 } // namespace android
@@ -29,6 +29,11 @@ uint32_t VibratorInputMapper::getSources() {
     return 0;
 }
 
+uint32_t VibratorInputMapper::getConfigurationChanges() const {
+    // Only configured once, when the device is added.
+    return 0;
+}
+
 void VibratorInputMapper::populateDeviceInfo(InputDeviceInfo* info) {
     InputMapper::populateDeviceInfo(info);
 
@@ -27,6 +27,7 @@ public:
     virtual ~VibratorInputMapper();
 
     virtual uint32_t getSources() override;
+    virtual uint32_t getConfigurationChanges() const override;
     virtual void populateDeviceInfo(InputDeviceInfo* deviceInfo) override;
     virtual void process(const RawEvent* rawEvent) override;
 
@@ -132,6 +132,32 @@ TEST(AnrTrackerTest, MultipleTokens_IdenticalTimesRemove) {
     ASSERT_EQ(token1, tracker.firstToken());
 }
 
+TEST(AnrTrackerTest, MultipleTokens_RemoveTokenWithDuplicates) {
+    AnrTracker tracker;
+
+    sp<IBinder> token1 = new BBinder();
+    sp<IBinder> token2 = new BBinder();
+
+    tracker.insert(1, token1);
+    tracker.insert(1, token1);
+    tracker.insert(2, token2);
+    tracker.insert(3, token1);
+
+    tracker.eraseToken(token1);
+
+    ASSERT_EQ(2, tracker.firstTimeout());
+    ASSERT_EQ(token2, tracker.firstToken());
+
+    // The entries of a removed token can be inserted again
+    tracker.insert(1, token1);
+    ASSERT_EQ(1, tracker.firstTimeout());
+    ASSERT_EQ(token1, tracker.firstToken());
+
+    tracker.erase(1, token1);
+    tracker.eraseToken(token2);
+    ASSERT_TRUE(tracker.empty());
+}
+
 TEST(AnrTrackerTest, Empty_DoesntCrash) {
     AnrTracker tracker;
 
@@ -87,12 +87,28 @@ TEST(BlockingQueueTest, Queue_Erases) {
     queue.push(3);
     queue.push(4);
     // Erase elements 2 and 4
-    queue.erase([](int element) { return element == 2 || element == 4; });
+    ASSERT_EQ(2u, queue.erase([](int element) { return element == 2 || element == 4; }));
     // Should no longer receive elements 2 and 4
     ASSERT_EQ(1, queue.pop());
     ASSERT_EQ(3, queue.pop());
 }
 
+TEST(BlockingQueueTest, Queue_PopsAll) {
+    constexpr size_t capacity = 4;
+    BlockingQueue<int> queue(capacity);
+
+    queue.push(1);
+    queue.push(2);
+    queue.push(3);
+    ASSERT_EQ((std::vector<int>{1, 2, 3}), queue.popAll());
+    ASSERT_EQ(0u, queue.size());
+    // The capacity is unchanged.
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.push(i + 10));
+    }
+    ASSERT_FALSE(queue.push(5));
+}
+
 // --- BlockingQueueTest - Multiple threads ---
 
 TEST(BlockingQueueTest, Queue_AllowsMultipleThreads) {
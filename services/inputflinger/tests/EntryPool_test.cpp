@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/Entry.h"
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+namespace inputdispatcher {
+
+// --- EntryPoolTest ---
+
+TEST(EntryPoolTest, FreedObject_Reused) {
+    EntryPool pool("test", 64, 4);
+
+    void* first = pool.allocate(64);
+    pool.free(first, 64);
+    void* second = pool.allocate(64);
+
+    ASSERT_EQ(first, second);
+    EntryPoolStats stats = pool.getStats();
+    ASSERT_EQ(2u, stats.allocations);
+    ASSERT_EQ(1u, stats.reused);
+    ASSERT_EQ(0u, stats.cached);
+    pool.free(second, 64);
+}
+
+/**
+ * Frees beyond maxCached go back to the heap.
+ */
+TEST(EntryPoolTest, CacheBounded) {
+    EntryPool pool("test", 64, 2);
+    void* objects[3];
+    for (void*& object : objects) {
+        object = pool.allocate(64);
+    }
+    for (void* object : objects) {
+        pool.free(object, 64);
+    }
+
+    EntryPoolStats stats = pool.getStats();
+    ASSERT_EQ(2u, stats.cached);
+    ASSERT_EQ(2u, stats.maxCached);
+    ASSERT_EQ(1u, stats.overflowed);
+}
+
+/**
+ * Objects of another size, such as subclasses of the pooled type, bypass the pool.
+ */
+TEST(EntryPoolTest, OtherSize_NotPooled) {
+    EntryPool pool("test", 64, 2);
+
+    void* object = pool.allocate(128);
+    pool.free(object, 128);
+
+    EntryPoolStats stats = pool.getStats();
+    ASSERT_EQ(0u, stats.allocations);
+    ASSERT_EQ(0u, stats.cached);
+}
+
+TEST(EntryPoolTest, MotionEntry_StorageRecycled) {
+    PointerProperties properties;
+    properties.clear();
+    PointerCoords coords;
+    coords.clear();
+    auto createEntry = [&]() {
+        return new MotionEntry(/*id*/ 1, /*eventTime*/ 0, /*deviceId*/ 1,
+                               AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT, /*policyFlags*/ 0,
+                               AMOTION_EVENT_ACTION_DOWN, /*actionButton*/ 0, /*flags*/ 0,
+                               AMETA_NONE, /*buttonState*/ 0, MotionClassification::NONE,
+                               AMOTION_EVENT_EDGE_FLAG_NONE, /*xPrecision*/ 0, /*yPrecision*/ 0,
+                               AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                               AMOTION_EVENT_INVALID_CURSOR_POSITION, /*downTime*/ 0,
+                               /*pointerCount*/ 1, &properties, &coords, /*xOffset*/ 0,
+                               /*yOffset*/ 0);
+    };
+
+    MotionEntry* first = createEntry();
+    first->release();
+    MotionEntry* second = createEntry();
+
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(1, second->refCount);
+    ASSERT_EQ(1u, second->pointerCount);
+    second->release();
+}
+
+} // namespace inputdispatcher
+
+} // namespace android
@@ -1484,6 +1484,8 @@ public:
 
     std::optional<int32_t> receiveEvent() { return mInputReceiver->receiveEvent(); }
 
+    InputEvent* consume() { return mInputReceiver->consume(); }
+
     void finishEvent(uint32_t consumeSeq) { return mInputReceiver->finishEvent(consumeSeq); }
 
     void consumeMotionDown(int32_t expectedDisplayId, int32_t expectedFlags = 0) {
@@ -1539,6 +1541,33 @@ TEST_F(InputDispatcherTest, GestureMonitor_DoesNotReceiveKeyEvents) {
     monitor.assertNoEvents();
 }
 
+/**
+ * An event sent to several connections is signed once. Every copy must still verify, and the
+ * next event must not reuse the signature of the previous one.
+ */
+TEST_F(InputDispatcherTest, VerifyInputEvent_SentToWindowAndMonitor) {
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    sp<FakeWindowHandle> window =
+            new FakeWindowHandle(application, mDispatcher, "Fake Window", ADISPLAY_ID_DEFAULT);
+    mDispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
+    FakeMonitorReceiver monitor = FakeMonitorReceiver(mDispatcher, "M_1", ADISPLAY_ID_DEFAULT,
+                                                      false /*isGestureMonitor*/);
+
+    for (int32_t action : {AMOTION_EVENT_ACTION_DOWN, AMOTION_EVENT_ACTION_UP}) {
+        NotifyMotionArgs motionArgs =
+                generateMotionArgs(action, AINPUT_SOURCE_TOUCHSCREEN, ADISPLAY_ID_DEFAULT,
+                                   {{10, 20}});
+        mDispatcher->notifyMotion(&motionArgs);
+
+        InputEvent* windowEvent = window->consume();
+        ASSERT_NE(nullptr, windowEvent);
+        ASSERT_NE(nullptr, mDispatcher->verifyInputEvent(*windowEvent));
+        InputEvent* monitorEvent = monitor.consume();
+        ASSERT_NE(nullptr, monitorEvent);
+        ASSERT_NE(nullptr, mDispatcher->verifyInputEvent(*monitorEvent));
+    }
+}
+
 TEST_F(InputDispatcherTest, GestureMonitor_CanPilferAfterWindowIsRemovedMidStream) {
     sp<FakeApplicationHandle> application = new FakeApplicationHandle();
     sp<FakeWindowHandle> window =
@@ -959,6 +959,7 @@ class FakeInputMapper : public InputMapper {
     std::mutex mLock;
     std::condition_variable mStateChangedCondition;
     bool mConfigureWasCalled GUARDED_BY(mLock);
+    uint32_t mConfigurationChanges;
     bool mResetWasCalled GUARDED_BY(mLock);
     bool mProcessWasCalled GUARDED_BY(mLock);
     RawEvent mLastEvent GUARDED_BY(mLock);
@@ -971,6 +972,7 @@ public:
             mKeyboardType(AINPUT_KEYBOARD_TYPE_NONE),
             mMetaState(0),
             mConfigureWasCalled(false),
+            mConfigurationChanges(~0u),
             mResetWasCalled(false),
             mProcessWasCalled(false) {}
 
@@ -984,6 +986,8 @@ public:
         mMetaState = metaState;
     }
 
+    void setConfigurationChanges(uint32_t changes) { mConfigurationChanges = changes; }
+
     void assertConfigureWasCalled() {
         std::unique_lock<std::mutex> lock(mLock);
         base::ScopedLockAssertion assumeLocked(mLock);
@@ -997,6 +1001,11 @@ public:
         mConfigureWasCalled = false;
     }
 
+    void assertConfigureWasNotCalled() {
+        std::scoped_lock<std::mutex> lock(mLock);
+        ASSERT_FALSE(mConfigureWasCalled) << "Expected configure() to not have been called.";
+    }
+
     void assertResetWasCalled() {
         std::unique_lock<std::mutex> lock(mLock);
         base::ScopedLockAssertion assumeLocked(mLock);
@@ -1068,6 +1077,8 @@ private:
         mStateChangedCondition.notify_all();
     }
 
+    virtual uint32_t getConfigurationChanges() const { return mConfigurationChanges; }
+
     virtual void reset(nsecs_t) {
         std::scoped_lock<std::mutex> lock(mLock);
         mResetWasCalled = true;
@@ -2100,6 +2111,33 @@ TEST_F(InputDeviceTest, WhenNoMappersAreRegistered_DeviceIsIgnored) {
     ASSERT_EQ(1, flags[1]) << "Flag for unsupported key should be unchanged.";
 }
 
+TEST_F(InputDeviceTest, Configure_OnlyReconfiguresMappersForTheirChanges) {
+    FakeInputMapper& keyboardMapper =
+            mDevice->addMapper<FakeInputMapper>(EVENTHUB_ID, AINPUT_SOURCE_KEYBOARD);
+    keyboardMapper.setConfigurationChanges(InputReaderConfiguration::CHANGE_DISPLAY_INFO);
+    FakeInputMapper& touchMapper =
+            mDevice->addMapper<FakeInputMapper>(EVENTHUB_ID, AINPUT_SOURCE_TOUCHSCREEN);
+    touchMapper.setConfigurationChanges(InputReaderConfiguration::CHANGE_DISPLAY_INFO |
+                                        InputReaderConfiguration::CHANGE_SHOW_TOUCHES);
+
+    // Every mapper is configured the first time.
+    InputReaderConfiguration config;
+    mDevice->configure(ARBITRARY_TIME, &config, 0);
+    ASSERT_NO_FATAL_FAILURE(keyboardMapper.assertConfigureWasCalled());
+    ASSERT_NO_FATAL_FAILURE(touchMapper.assertConfigureWasCalled());
+
+    mDevice->configure(ARBITRARY_TIME, &config, InputReaderConfiguration::CHANGE_SHOW_TOUCHES);
+    ASSERT_NO_FATAL_FAILURE(keyboardMapper.assertConfigureWasNotCalled());
+    ASSERT_NO_FATAL_FAILURE(touchMapper.assertConfigureWasCalled());
+
+    mDevice->configure(ARBITRARY_TIME, &config, InputReaderConfiguration::CHANGE_POINTER_SPEED);
+    ASSERT_NO_FATAL_FAILURE(keyboardMapper.assertConfigureWasNotCalled());
+    ASSERT_NO_FATAL_FAILURE(touchMapper.assertConfigureWasNotCalled());
+
+    // The sources of mappers that were not reconfigured are kept.
+    ASSERT_EQ(uint32_t(AINPUT_SOURCE_KEYBOARD | AINPUT_SOURCE_TOUCHSCREEN), mDevice->getSources());
+}
+
 TEST_F(InputDeviceTest, WhenMappersAreRegistered_DeviceIsNotIgnoredAndForwardsRequestsToMappers) {
     // Configuration.
     mFakeEventHub->addConfigurationProperty(EVENTHUB_ID, String8("key"), String8("value"));
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/LatencyTracker.h"
+
+#include <gtest/gtest.h>
+
+namespace android::inputdispatcher {
+
+using Stage = LatencyTracker::Stage;
+
+static LatencyTracker::Timeline timeline(nsecs_t eventTime, nsecs_t enqueueDelay,
+                                         nsecs_t publishDelay, nsecs_t finishDelay) {
+    const nsecs_t enqueueTime = eventTime + enqueueDelay;
+    const nsecs_t publishTime = enqueueTime + publishDelay;
+    return {eventTime, enqueueTime, publishTime, publishTime + finishDelay};
+}
+
+TEST(LatencyTrackerTest, Stages_SplitAtEachTimestamp) {
+    LatencyTracker tracker;
+    tracker.addTimeline(1, "window", timeline(1000000, 2000000, 3000000, 4000000));
+
+    ASSERT_EQ(2000, tracker.getDeviceHistogram(1, Stage::EVENT_TO_ENQUEUE)->getMax());
+    ASSERT_EQ(3000, tracker.getDeviceHistogram(1, Stage::ENQUEUE_TO_PUBLISH)->getMax());
+    ASSERT_EQ(4000, tracker.getDeviceHistogram(1, Stage::PUBLISH_TO_FINISH)->getMax());
+    ASSERT_EQ(9000, tracker.getWindowHistogram("window", Stage::EVENT_TO_FINISH)->getMax());
+}
+
+TEST(LatencyTrackerTest, KeyedPerDeviceAndWindow) {
+    LatencyTracker tracker;
+    tracker.addTimeline(1, "a", timeline(0, 1000, 0, 0));
+    tracker.addTimeline(2, "a", timeline(0, 5000, 0, 0));
+    tracker.addTimeline(2, "b", timeline(0, 7000, 0, 0));
+
+    ASSERT_EQ(1u, tracker.getDeviceHistogram(1, Stage::EVENT_TO_ENQUEUE)->getCount());
+    ASSERT_EQ(2u, tracker.getDeviceHistogram(2, Stage::EVENT_TO_ENQUEUE)->getCount());
+    ASSERT_EQ(5000, tracker.getWindowHistogram("a", Stage::EVENT_TO_ENQUEUE)->getMax());
+    ASSERT_EQ(7000, tracker.getWindowHistogram("b", Stage::EVENT_TO_ENQUEUE)->getMax());
+    ASSERT_EQ(nullptr, tracker.getDeviceHistogram(3, Stage::EVENT_TO_ENQUEUE));
+    ASSERT_EQ(nullptr, tracker.getWindowHistogram("c", Stage::EVENT_TO_ENQUEUE));
+}
+
+TEST(LatencyTrackerTest, TooManyWindows_NotTrackedPerWindow) {
+    LatencyTracker tracker;
+    for (size_t i = 0; i <= LatencyTracker::MAX_WINDOWS; i++) {
+        tracker.addTimeline(1, "window" + std::to_string(i), timeline(0, 0, 0, 0));
+    }
+
+    ASSERT_NE(nullptr, tracker.getWindowHistogram("window0", Stage::EVENT_TO_FINISH));
+    ASSERT_EQ(nullptr,
+              tracker.getWindowHistogram("window" + std::to_string(LatencyTracker::MAX_WINDOWS),
+                                         Stage::EVENT_TO_FINISH));
+    ASSERT_EQ(LatencyTracker::MAX_WINDOWS + 1,
+              tracker.getDeviceHistogram(1, Stage::EVENT_TO_FINISH)->getCount());
+
+    std::string dump;
+    tracker.dump(dump, "");
+    ASSERT_NE(std::string::npos, dump.find("other:"));
+}
+
+} // namespace android::inputdispatcher
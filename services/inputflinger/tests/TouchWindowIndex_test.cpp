@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../dispatcher/TouchWindowIndex.h"
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+namespace inputdispatcher {
+
+class TestWindowHandle : public InputWindowHandle {
+public:
+    TestWindowHandle(const std::string& name, const Rect& frame) {
+        mInfo.name = name;
+        mInfo.visible = true;
+        mInfo.layoutParamsFlags = InputWindowInfo::FLAG_NOT_TOUCH_MODAL;
+        setFrame(frame);
+    }
+
+    bool updateInfo() override { return true; }
+
+    void setFrame(const Rect& frame) {
+        mInfo.touchableRegion.clear();
+        mInfo.addTouchableRegion(frame);
+    }
+    void setFlags(int32_t flags) { mInfo.layoutParamsFlags = flags; }
+    void setVisible(bool visible) { mInfo.visible = visible; }
+};
+
+static std::vector<std::string> candidatesAt(const TouchWindowIndex& index, int32_t x,
+                                             int32_t y) {
+    std::vector<std::string> names;
+    index.forEachCandidate(x, y, [&](const sp<InputWindowHandle>& windowHandle) {
+        names.push_back(windowHandle->getName());
+        return false;
+    });
+    return names;
+}
+
+// --- TouchWindowIndexTest ---
+
+TEST(TouchWindowIndexTest, Empty_NoCandidates) {
+    TouchWindowIndex index;
+    index.update({});
+
+    ASSERT_TRUE(candidatesAt(index, 0, 0).empty());
+}
+
+/**
+ * Only windows whose touchable bounds contain the point are returned, front to back.
+ */
+TEST(TouchWindowIndexTest, OverlappingWindows_ZOrderKept) {
+    sp<TestWindowHandle> top = new TestWindowHandle("top", Rect(100, 100, 200, 200));
+    sp<TestWindowHandle> middle = new TestWindowHandle("middle", Rect(0, 0, 150, 150));
+    sp<TestWindowHandle> bottom = new TestWindowHandle("bottom", Rect(0, 0, 1000, 2000));
+    TouchWindowIndex index;
+    index.update({top, middle, bottom});
+
+    ASSERT_EQ((std::vector<std::string>{"top", "middle", "bottom"}), candidatesAt(index, 120, 120));
+    ASSERT_EQ((std::vector<std::string>{"middle", "bottom"}), candidatesAt(index, 10, 10));
+    ASSERT_EQ((std::vector<std::string>{"bottom"}), candidatesAt(index, 900, 1900));
+    ASSERT_TRUE(candidatesAt(index, 1000, 10).empty());
+}
+
+/**
+ * Touch modal and outside-watching windows are candidates everywhere, hidden and untouchable
+ * windows nowhere.
+ */
+TEST(TouchWindowIndexTest, Flags_MergedInZOrder) {
+    sp<TestWindowHandle> hidden = new TestWindowHandle("hidden", Rect(0, 0, 100, 100));
+    hidden->setVisible(false);
+    sp<TestWindowHandle> watcher = new TestWindowHandle("watcher", Rect(0, 0, 10, 10));
+    watcher->setFlags(InputWindowInfo::FLAG_NOT_TOUCHABLE |
+                      InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH);
+    sp<TestWindowHandle> untouchable = new TestWindowHandle("untouchable", Rect(0, 0, 100, 100));
+    untouchable->setFlags(InputWindowInfo::FLAG_NOT_TOUCHABLE);
+    sp<TestWindowHandle> window = new TestWindowHandle("window", Rect(0, 0, 100, 100));
+    sp<TestWindowHandle> modal = new TestWindowHandle("modal", Rect(0, 0, 10, 10));
+    modal->setFlags(0);
+    TouchWindowIndex index;
+    index.update({hidden, watcher, untouchable, window, modal});
+
+    ASSERT_EQ((std::vector<std::string>{"watcher", "window", "modal"}), candidatesAt(index, 50, 50));
+    ASSERT_EQ((std::vector<std::string>{"watcher", "modal"}), candidatesAt(index, 500, 500));
+}
+
+TEST(TouchWindowIndexTest, VisitorStops) {
+    sp<TestWindowHandle> top = new TestWindowHandle("top", Rect(0, 0, 100, 100));
+    sp<TestWindowHandle> bottom = new TestWindowHandle("bottom", Rect(0, 0, 100, 100));
+    TouchWindowIndex index;
+    index.update({top, bottom});
+
+    size_t visited = 0;
+    index.forEachCandidate(50, 50, [&](const sp<InputWindowHandle>&) {
+        visited++;
+        return true;
+    });
+    ASSERT_EQ(1u, visited);
+}
+
+/**
+ * Moving a window inside the indexed area updates it in place; growing past it or changing the
+ * window list rebuilds the grid.
+ */
+TEST(TouchWindowIndexTest, Update_IncrementalWhenListUnchanged) {
+    sp<TestWindowHandle> small = new TestWindowHandle("small", Rect(0, 0, 100, 100));
+    sp<TestWindowHandle> large = new TestWindowHandle("large", Rect(0, 0, 1000, 1000));
+    TouchWindowIndex index;
+    index.update({small, large});
+    ASSERT_EQ(1u, index.getRebuildCount());
+
+    small->setFrame(Rect(800, 800, 900, 900));
+    index.update({small, large});
+    ASSERT_EQ(1u, index.getRebuildCount());
+    ASSERT_EQ((std::vector<std::string>{"large"}), candidatesAt(index, 50, 50));
+    ASSERT_EQ((std::vector<std::string>{"small", "large"}), candidatesAt(index, 850, 850));
+
+    small->setFlags(0);
+    index.update({small, large});
+    ASSERT_EQ(1u, index.getRebuildCount());
+    ASSERT_EQ((std::vector<std::string>{"small", "large"}), candidatesAt(index, 50, 50));
+
+    large->setFrame(Rect(0, 0, 2000, 2000));
+    index.update({small, large});
+    ASSERT_EQ(2u, index.getRebuildCount());
+    ASSERT_EQ((std::vector<std::string>{"small", "large"}), candidatesAt(index, 1500, 1500));
+
+    index.update({large, small});
+    ASSERT_EQ(3u, index.getRebuildCount());
+    ASSERT_EQ((std::vector<std::string>{"large", "small"}), candidatesAt(index, 1500, 1500));
+}
+
+} // namespace inputdispatcher
+
+} // namespace android
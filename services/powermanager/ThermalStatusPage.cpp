@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ThermalStatusPage"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include <cutils/ashmem.h>
+#include <powermanager/ThermalStatusPage.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+namespace {
+
+constexpr uint32_t kPageMagic = 0x54485350; // 'THSP'
+constexpr uint32_t kPageVersion = 1;
+
+// Reads racing with this many updates in a row give up.
+constexpr int kMaxReadAttempts = 16;
+
+} // namespace
+
+// Fields are atomics, so that the page can be read while it is written. The
+// sequence number is odd while an update is in progress.
+struct ThermalStatusPageLayout {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> sequence;
+    std::atomic<int32_t> status;
+    std::atomic<int64_t> updateTimeNs;
+    std::atomic<float> headroom[kNumThermalHeadroomForecasts];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                      std::atomic<int64_t>::is_always_lock_free &&
+                      std::atomic<float>::is_always_lock_free,
+              "atomics in shared memory must be lock free");
+
+static size_t pageSize() {
+    return (sizeof(ThermalStatusPageLayout) + getpagesize() - 1) & ~(getpagesize() - 1);
+}
+
+// ----------------------------------------------------------------------------
+
+std::unique_ptr<ThermalStatusPageWriter> ThermalStatusPageWriter::create() {
+    const size_t size = pageSize();
+    int fd = ashmem_create_region("thermal status page", size);
+    if (fd < 0) {
+        ALOGE("%s: Failed to create ashmem region: %s", __FUNCTION__, strerror(errno));
+        return nullptr;
+    }
+
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ALOGE("%s: Failed to map page: %s", __FUNCTION__, strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+
+    // Readers may only map the page read-only from now on.
+    if (ashmem_set_prot_region(fd, PROT_READ) < 0) {
+        ALOGE("%s: Failed to restrict page protection: %s", __FUNCTION__, strerror(errno));
+        munmap(addr, size);
+        close(fd);
+        return nullptr;
+    }
+
+    auto page = new (addr) ThermalStatusPageLayout();
+    page->magic = kPageMagic;
+    page->version = kPageVersion;
+    page->status.store(static_cast<int32_t>(ThermalStatus::THERMAL_STATUS_NONE),
+                       std::memory_order_relaxed);
+    page->updateTimeNs.store(0, std::memory_order_relaxed);
+    for (auto& headroom : page->headroom) {
+        headroom.store(NAN, std::memory_order_relaxed);
+    }
+    page->sequence.store(0, std::memory_order_release);
+
+    return std::unique_ptr<ThermalStatusPageWriter>(new ThermalStatusPageWriter(fd, page));
+}
+
+ThermalStatusPageWriter::~ThermalStatusPageWriter() {
+    munmap(mPage, pageSize());
+    close(mFd);
+}
+
+void ThermalStatusPageWriter::update(ThermalStatus status,
+                                     const float (&headroom)[kNumThermalHeadroomForecasts]) {
+    const uint32_t sequence = mPage->sequence.load(std::memory_order_relaxed);
+    mPage->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mPage->status.store(static_cast<int32_t>(status), std::memory_order_relaxed);
+    mPage->updateTimeNs.store(systemTime(SYSTEM_TIME_MONOTONIC), std::memory_order_relaxed);
+    for (size_t i = 0; i < kNumThermalHeadroomForecasts; i++) {
+        mPage->headroom[i].store(headroom[i], std::memory_order_relaxed);
+    }
+
+    mPage->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// ----------------------------------------------------------------------------
+
+std::unique_ptr<ThermalStatusPageReader> ThermalStatusPageReader::create(int fd) {
+    const int size = ashmem_get_size_region(fd);
+    if (size < 0 || static_cast<size_t>(size) < pageSize()) {
+        ALOGE("%s: Invalid thermal status page fd", __FUNCTION__);
+        return nullptr;
+    }
+
+    void* addr = mmap(nullptr, pageSize(), PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ALOGE("%s: Failed to map page: %s", __FUNCTION__, strerror(errno));
+        return nullptr;
+    }
+
+    auto page = static_cast<const ThermalStatusPageLayout*>(addr);
+    if (page->magic != kPageMagic || page->version != kPageVersion) {
+        ALOGE("%s: Unknown page format %#x version %u", __FUNCTION__, page->magic,
+              page->version);
+        munmap(addr, pageSize());
+        return nullptr;
+    }
+
+    return std::unique_ptr<ThermalStatusPageReader>(new ThermalStatusPageReader(page));
+}
+
+ThermalStatusPageReader::~ThermalStatusPageReader() {
+    munmap(const_cast<ThermalStatusPageLayout*>(mPage), pageSize());
+}
+
+status_t ThermalStatusPageReader::read(ThermalStatusSnapshot* outSnapshot) const {
+    if (outSnapshot == nullptr) {
+        return BAD_VALUE;
+    }
+
+    for (int attempt = 0; attempt < kMaxReadAttempts; attempt++) {
+        const uint32_t sequence = mPage->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+
+        ThermalStatusSnapshot snapshot;
+        snapshot.status =
+                static_cast<ThermalStatus>(mPage->status.load(std::memory_order_relaxed));
+        snapshot.updateTimeNs = mPage->updateTimeNs.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kNumThermalHeadroomForecasts; i++) {
+            snapshot.headroom[i] = mPage->headroom[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mPage->sequence.load(std::memory_order_relaxed) == sequence) {
+            *outSnapshot = snapshot;
+            return OK;
+        }
+    }
+    return WOULD_BLOCK;
+}
+
+float ThermalStatusPageReader::getHeadroom(int32_t forecastSeconds) const {
+    ThermalStatusSnapshot snapshot;
+    if (read(&snapshot) != OK) {
+        return NAN;
+    }
+
+    if (forecastSeconds <= kThermalHeadroomForecastSeconds[0]) {
+        return snapshot.headroom[0];
+    }
+    for (size_t i = 1; i < kNumThermalHeadroomForecasts; i++) {
+        if (forecastSeconds <= kThermalHeadroomForecastSeconds[i]) {
+            const float t = float(forecastSeconds - kThermalHeadroomForecastSeconds[i - 1]) /
+                    float(kThermalHeadroomForecastSeconds[i] -
+                          kThermalHeadroomForecastSeconds[i - 1]);
+            return snapshot.headroom[i - 1] + t * (snapshot.headroom[i] - snapshot.headroom[i - 1]);
+        }
+    }
+    // Beyond the last forecast; use it rather than extrapolating.
+    return snapshot.headroom[kNumThermalHeadroomForecasts - 1];
+}
+
+}; // namespace android
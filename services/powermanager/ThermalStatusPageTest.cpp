@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ThermalStatusPageTest"
+
+#include <math.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <powermanager/ThermalStatusPage.h>
+
+using namespace android;
+
+TEST(ThermalStatusPageTest, InitialState) {
+    auto writer = ThermalStatusPageWriter::create();
+    ASSERT_NE(nullptr, writer);
+    auto reader = ThermalStatusPageReader::create(writer->getFd());
+    ASSERT_NE(nullptr, reader);
+
+    ThermalStatusSnapshot snapshot;
+    ASSERT_EQ(OK, reader->read(&snapshot));
+    EXPECT_EQ(ThermalStatus::THERMAL_STATUS_NONE, snapshot.status);
+    EXPECT_EQ(0, snapshot.updateTimeNs);
+    for (float headroom : snapshot.headroom) {
+        EXPECT_TRUE(isnan(headroom));
+    }
+}
+
+TEST(ThermalStatusPageTest, ReadOnlyForReaders) {
+    auto writer = ThermalStatusPageWriter::create();
+    ASSERT_NE(nullptr, writer);
+    void* addr = mmap(nullptr, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED,
+                      writer->getFd(), 0);
+    EXPECT_EQ(MAP_FAILED, addr);
+}
+
+TEST(ThermalStatusPageTest, Update) {
+    auto writer = ThermalStatusPageWriter::create();
+    ASSERT_NE(nullptr, writer);
+    auto reader = ThermalStatusPageReader::create(writer->getFd());
+    ASSERT_NE(nullptr, reader);
+
+    const float headroom[kNumThermalHeadroomForecasts] = {0.1f, 0.2f, 0.6f, 1.1f, 2.1f};
+    writer->update(ThermalStatus::THERMAL_STATUS_MODERATE, headroom);
+
+    ThermalStatusSnapshot snapshot;
+    ASSERT_EQ(OK, reader->read(&snapshot));
+    EXPECT_EQ(ThermalStatus::THERMAL_STATUS_MODERATE, snapshot.status);
+    EXPECT_GT(snapshot.updateTimeNs, 0);
+    for (size_t i = 0; i < kNumThermalHeadroomForecasts; i++) {
+        EXPECT_EQ(headroom[i], snapshot.headroom[i]);
+    }
+
+    // Forecasts between horizons are interpolated, and clamped outside of them.
+    EXPECT_FLOAT_EQ(0.1f, reader->getHeadroom(0));
+    EXPECT_FLOAT_EQ(0.4f, reader->getHeadroom(3));
+    EXPECT_FLOAT_EQ(1.6f, reader->getHeadroom(20));
+    EXPECT_FLOAT_EQ(2.1f, reader->getHeadroom(60));
+}
+
+TEST(ThermalStatusPageTest, ConsistentReadsDuringUpdates) {
+    auto writer = ThermalStatusPageWriter::create();
+    ASSERT_NE(nullptr, writer);
+    auto reader = ThermalStatusPageReader::create(writer->getFd());
+    ASSERT_NE(nullptr, reader);
+
+    std::atomic<bool> done{false};
+    std::thread writerThread([&] {
+        float headroom[kNumThermalHeadroomForecasts];
+        for (int i = 0; i < 100000; i++) {
+            for (float& h : headroom) {
+                h = i;
+            }
+            writer->update(ThermalStatus::THERMAL_STATUS_LIGHT, headroom);
+        }
+        done = true;
+    });
+
+    // Every successful read sees all the forecasts of a single update.
+    size_t tornReads = 0;
+    while (!done) {
+        ThermalStatusSnapshot snapshot;
+        if (reader->read(&snapshot) != OK || snapshot.updateTimeNs == 0) {
+            continue;
+        }
+        for (float headroom : snapshot.headroom) {
+            if (headroom != snapshot.headroom[0]) {
+                tornReads++;
+            }
+        }
+    }
+    writerThread.join();
+    EXPECT_EQ(0u, tornReads);
+}
@@ -487,7 +487,22 @@ void Fusion::predict(const vec3_t& w, float dT) {
     if (x0.w < 0)
         x0 = -x0;
 
-    P = Phi*P*transpose(Phi) + GQGt;
+    // P(k+1) = Phi*P*Phi' + G*Q*G', leaving out the zero and identity blocks of Phi, which take
+    // 10 of the 16 3x3 products of the full 6x6 product.
+    //
+    //  Phi*P*Phi' = | Phi00*P00*Phi00' + (Phi00*P10 + Phi10*P11)*Phi10'    Phi00*P10 + Phi10*P11 |
+    //               |     + Phi10*P01*Phi00'                                                      |
+    //               | transpose(Phi00*P10 + Phi10*P11)                     P11                    |
+    const mat33_t& Phi00 = Phi[0][0];
+    const mat33_t& Phi10 = Phi[1][0];
+    const mat33_t PhiP00(Phi00*P[0][0] + Phi10*P[0][1]);
+    const mat33_t PhiP10(Phi00*P[1][0] + Phi10*P[1][1]);
+    const mat33_t P00(PhiP00*transpose(Phi00) + PhiP10*transpose(Phi10));
+    // Mirror the result so that it stays exactly symmetric, as checkState() expects.
+    P[0][0] = (P00 + transpose(P00))*0.5f + GQGt[0][0];
+    P[1][0] = PhiP10 + GQGt[1][0];
+    P[0][1] = transpose(P[1][0]);
+    P[1][1] += GQGt[1][1];
 
     checkState();
 }
@@ -17,13 +17,13 @@
 #ifndef ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
 #define ANDROID_SENSOR_SERVICE_UTIL_RECENT_EVENT_LOGGER_H
 
-#include "RingBuffer.h"
 #include "SensorServiceUtils.h"
+#include "SpscRingBuffer.h"
 
 #include <hardware/sensors.h>
 #include <utils/String8.h>
 
-#include <mutex>
+#include <atomic>
 
 namespace android {
 namespace SensorServiceUtil {
@@ -33,6 +33,9 @@ namespace SensorServiceUtil {
 // generated from the sensor are stored in this buffer.  The buffer is NOT cleared when the sensor
 // unregisters and as a result very old data in the dumpsys output can be seen, which is an intended
 // behavior.
+//
+// Events are only added from the sensor poll thread, and are recorded without taking a lock, so
+// that dumping the log or sending the last event to a new client never holds up the poll thread.
 class RecentEventLogger : public Dumpable {
 public:
     explicit RecentEventLogger(int sensorType);
@@ -53,6 +56,7 @@ public:
 
 protected:
     struct SensorEventLog {
+        SensorEventLog() = default;
         explicit SensorEventLog(const sensors_event_t& e);
         timespec mWallTime;
         sensors_event_t mEvent;
@@ -61,11 +65,10 @@ protected:
     const int mSensorType;
     const size_t mEventSize;
 
-    mutable std::mutex mLock;
-    RingBuffer<SensorEventLog> mRecentEvents;
+    SpscRingBuffer<SensorEventLog> mRecentEvents;
 
     bool mMaskData;
-    bool mIsLastEventCurrent;
+    std::atomic<bool> mIsLastEventCurrent;
 
 private:
     static size_t logSizeBySensorType(int sensorType);
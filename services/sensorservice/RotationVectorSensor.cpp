@@ -29,6 +29,13 @@ namespace android {
 
 RotationVectorSensor::RotationVectorSensor(int mode) :
       mMode(mode) {
+    // Head tracking clients read the gyro based rotation vectors from ashmem direct channels,
+    // which sensorservice writes to itself.
+    uint32_t flags = SENSOR_FLAG_CONTINUOUS_MODE;
+    if (mode != FUSION_NOGYRO) {
+        flags |= (SENSOR_DIRECT_RATE_FAST << SENSOR_FLAG_SHIFT_DIRECT_REPORT) |
+                SENSOR_FLAG_DIRECT_CHANNEL_ASHMEM;
+    }
     const sensor_t sensor = {
         .name       = getSensorName(),
         .vendor     = "AOSP",
@@ -39,8 +46,10 @@ RotationVectorSensor::RotationVectorSensor(int mode) :
         .resolution = 1.0f / (1<<24),
         .power      = mSensorFusion.getPowerUsage(),
         .minDelay   = mSensorFusion.getMinDelay(),
+        .flags      = flags,
     };
-    mSensor = Sensor(&sensor);
+    // The direct report flags are only read from HAL 1.3 on.
+    mSensor = Sensor(&sensor, SENSORS_DEVICE_API_VERSION_1_3);
 }
 
 bool RotationVectorSensor::process(sensors_event_t* outEvent,
@@ -432,6 +432,8 @@ std::string SensorDevice::dump() const {
                         mSensorList.size(), mActivationCount.size(), mDisabledClients.size());
 
     Mutex::Autolock _l(mLock);
+    result.appendFormat("h/w batch calls: %zu made, %zu skipped as unchanged\n", mHalBatchCount,
+                        mSkippedHalBatchCount);
     for (const auto & s : mSensorList) {
         int32_t handle = s.handle;
         const Info& info = mActivationCount.valueFor(handle);
@@ -704,6 +706,7 @@ status_t SensorDevice::activateLocked(void* ident, int handle, int enabled) {
         }
     } else {
         ALOGD_IF(DEBUG_CONNECTIONS, "disable index=%zd", info.batchParams.indexOfKey(ident));
+        const BatchParams prevBestBatchParams = info.bestBatchParams;
 
         // If a connected dynamic sensor is deactivated, remove it from the
         // dictionary.
@@ -717,15 +720,20 @@ status_t SensorDevice::activateLocked(void* ident, int handle, int enabled) {
             if (info.numActiveClients() == 0) {
                 // This is the last connection, we need to de-activate the underlying h/w sensor.
                 activateHardware = true;
-            } else {
-                // Call batch for this sensor with the previously calculated best effort
+            } else if (info.bestBatchParams != prevBestBatchParams) {
+                // Call batch for this sensor with the newly calculated best effort
                 // batch_rate and timeout. One of the apps has unregistered for sensor
-                // events, and the best effort batch parameters might have changed.
+                // events, and the best effort batch parameters have changed.
                 ALOGD_IF(DEBUG_CONNECTIONS,
                          "\t>>> actuating h/w batch 0x%08x %" PRId64 " %" PRId64, handle,
                          info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch);
+                mHalBatchCount++;
                 checkReturn(mSensors->batch(
                         handle, info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch));
+            } else {
+                // The remaining apps asked for at least as fast a rate, so the h/w is already
+                // running with the right parameters.
+                mSkippedHalBatchCount++;
             }
         } else {
             // sensor wasn't enabled for this ident
@@ -829,8 +837,11 @@ status_t SensorDevice::updateBatchParamsLocked(int handle, Info &info) {
     if (prevBestBatchParams != info.bestBatchParams && info.numActiveClients() > 0) {
         ALOGD_IF(DEBUG_CONNECTIONS, "\t>>> actuating h/w BATCH 0x%08x %" PRId64 " %" PRId64, handle,
                  info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch);
+        mHalBatchCount++;
         err = checkReturnAndGetStatus(mSensors->batch(
                 handle, info.bestBatchParams.mTSample, info.bestBatchParams.mTBatch));
+    } else if (info.numActiveClients() > 0) {
+        mSkippedHalBatchCount++;
     }
 
     return err;
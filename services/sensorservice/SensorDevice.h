@@ -137,6 +137,10 @@ private:
 
     static const nsecs_t MINIMUM_EVENTS_PERIOD =   1000000; // 1000 Hz
     mutable Mutex mLock; // protect mActivationCount[].batchParams
+    // Batch calls made to the HAL on behalf of clients, and those skipped because the selected
+    // batch parameters of the sensor did not change. Protected by mLock.
+    size_t mHalBatchCount = 0;
+    size_t mSkippedHalBatchCount = 0;
     // fixed-size array after construction
 
     // Struct to store all the parameters(samplingPeriod, maxBatchReportLatency and flags) from
@@ -19,6 +19,11 @@
 #include <android/util/ProtoOutputStream.h>
 #include <frameworks/base/core/proto/android/service/sensor_service.proto.h>
 #include <hardware/sensors.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
 
 #define UNUSED(x) (void)(x)
 
@@ -26,12 +31,28 @@ namespace android {
 
 using util::ProtoOutputStream;
 
+// Sampling period virtual sensors run at for each direct report rate level, within the ranges
+// the rate levels are defined to cover.
+static nsecs_t getVirtualSensorSamplingPeriodNs(int rateLevel) {
+    switch (rateLevel) {
+        case SENSOR_DIRECT_RATE_NORMAL:
+            return 20000000;  // 50Hz
+        case SENSOR_DIRECT_RATE_FAST:
+            return 5000000;  // 200Hz
+        case SENSOR_DIRECT_RATE_VERY_FAST:
+            return 1250000;  // 800Hz
+        default:
+            return 0;
+    }
+}
+
 SensorService::SensorDirectConnection::SensorDirectConnection(const sp<SensorService>& service,
         uid_t uid, const sensors_direct_mem_t *mem, int32_t halChannelHandle,
         const String16& opPackageName)
         : mService(service), mUid(uid), mMem(*mem),
         mHalChannelHandle(halChannelHandle),
-        mOpPackageName(opPackageName), mDestroyed(false) {
+        mOpPackageName(opPackageName), mRing(nullptr), mRingSize(0), mRingPosition(0),
+        mRingCounter(0), mDestroyed(false) {
     ALOGD_IF(DEBUG_CONNECTIONS, "Created SensorDirectConnection");
 }
 
@@ -49,6 +70,13 @@ void SensorService::SensorDirectConnection::destroy() {
 
     stopAll();
     mService->cleanupConnection(this);
+    {
+        Mutex::Autolock _cl(mConnectionLock);
+        if (mRing != nullptr) {
+            munmap(mRing, mMem.size);
+            mRing = nullptr;
+        }
+    }
     if (mMem.handle != nullptr) {
         native_handle_close(mMem.handle);
         native_handle_delete(const_cast<struct native_handle*>(mMem.handle));
@@ -66,6 +94,9 @@ void SensorService::SensorDirectConnection::dump(String8& result) const {
     for (auto &i : mActivated) {
         result.appendFormat("\t\tSensor %#08x, rate %d\n", i.first, i.second);
     }
+    for (auto &i : mVirtualActivated) {
+        result.appendFormat("\t\tVirtual sensor %#08x, rate %d\n", i.first, i.second);
+    }
 }
 
 /**
@@ -95,7 +126,8 @@ sp<BitTube> SensorService::SensorDirectConnection::getSensorChannel() const {
 
 void SensorService::SensorDirectConnection::onSensorAccessChanged(bool hasAccess) {
     if (!hasAccess) {
-        stopAll(true /* backupRecord */);
+        Mutex::Autolock _l(mConnectionLock);
+        stopAllLocked(true /* backupRecord */);
     } else {
         recoverAll();
     }
@@ -157,11 +189,22 @@ int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int
         return INVALID_OPERATION;
     }
 
+    if (si->isVirtual()) {
+        // Virtual sensors are computed with SensorService::mLock held, which is taken first.
+        Mutex::Autolock _sl(mService->mLock);
+        Mutex::Autolock _l(mConnectionLock);
+        return configureVirtualSensorLocked(si, handle, rateLevel);
+    }
+
+    Mutex::Autolock _l(mConnectionLock);
+    if (mHalChannelHandle <= 0 || !mVirtualActivated.empty()) {
+        return INVALID_OPERATION;
+    }
+
     struct sensors_direct_cfg_t config = {
         .rate_level = rateLevel
     };
 
-    Mutex::Autolock _l(mConnectionLock);
     SensorDevice& dev(SensorDevice::getInstance());
     int ret = dev.configureDirectChannel(handle, getHalChannelHandle(), &config);
 
@@ -180,7 +223,93 @@ int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int
     return ret;
 }
 
+int32_t SensorService::SensorDirectConnection::configureVirtualSensorLocked(
+        const sp<SensorInterface>& si, int handle, int rateLevel) {
+    if (rateLevel == SENSOR_DIRECT_RATE_STOP) {
+        if (mVirtualActivated.erase(handle) > 0) {
+            si->activate(this, false);
+            mService->mDirectVirtualSensorCount--;
+        }
+        return NO_ERROR;
+    }
+
+    if (mMem.type != SENSOR_DIRECT_MEM_TYPE_ASHMEM || !mActivated.empty() || !mapMemoryLocked()) {
+        return INVALID_OPERATION;
+    }
+
+    const nsecs_t samplingPeriodNs = std::max(getVirtualSensorSamplingPeriodNs(rateLevel),
+                                              si->getSensor().getMinDelayNs());
+    status_t err = si->batch(this, handle, 0, samplingPeriodNs, 0);
+    if (err == NO_ERROR && mVirtualActivated.count(handle) == 0) {
+        err = si->activate(this, true);
+        if (err == NO_ERROR) {
+            mService->mDirectVirtualSensorCount++;
+        }
+    }
+    if (err != NO_ERROR) {
+        return err;
+    }
+    mVirtualActivated[handle] = rateLevel;
+    // The handle doubles as the report token, so that it cannot clash with another sensor's.
+    return handle;
+}
+
+bool SensorService::SensorDirectConnection::mapMemoryLocked() {
+    if (mRing != nullptr) {
+        return true;
+    }
+    if (mMem.handle == nullptr || mMem.handle->numFds < 1 || mMem.size < sizeof(sensors_event_t)) {
+        return false;
+    }
+    void* ring = mmap(nullptr, mMem.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      mMem.handle->data[0], 0);
+    if (ring == MAP_FAILED) {
+        ALOGE("Cannot map direct channel memory for virtual sensors: %s", strerror(errno));
+        return false;
+    }
+    mRing = static_cast<sensors_event_t*>(ring);
+    mRingSize = mMem.size / sizeof(sensors_event_t);
+    return true;
+}
+
+void SensorService::SensorDirectConnection::getVirtualSensorHandles(
+        std::vector<int>* handles) const {
+    Mutex::Autolock _l(mConnectionLock);
+    for (auto &i : mVirtualActivated) {
+        handles->push_back(i.first);
+    }
+}
+
+void SensorService::SensorDirectConnection::writeVirtualSensorEvents(
+        const sensors_event_t* events, size_t count) {
+    Mutex::Autolock _l(mConnectionLock);
+    if (mVirtualActivated.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (mVirtualActivated.count(events[i].sensor) == 0) {
+            continue;
+        }
+        // The counter is written last, so that a reader that sees it change also sees the event
+        // it belongs to. It skips 0, which marks a slot that was never written.
+        sensors_event_t* slot = &mRing[mRingPosition];
+        slot->version = sizeof(sensors_event_t);
+        slot->sensor = events[i].sensor;
+        slot->type = events[i].type;
+        slot->timestamp = events[i].timestamp;
+        memcpy(slot->data, events[i].data, sizeof(slot->data));
+        slot->flags = 0;
+        memset(slot->reserved1, 0, sizeof(slot->reserved1));
+        if (++mRingCounter == 0) {
+            mRingCounter = 1;
+        }
+        __atomic_store_n(&slot->reserved0, static_cast<int32_t>(mRingCounter), __ATOMIC_RELEASE);
+        mRingPosition = (mRingPosition + 1) % mRingSize;
+    }
+}
+
 void SensorService::SensorDirectConnection::stopAll(bool backupRecord) {
+    Mutex::Autolock _sl(mService->mLock);
     Mutex::Autolock _l(mConnectionLock);
     stopAllLocked(backupRecord);
 }
@@ -194,16 +323,25 @@ void SensorService::SensorDirectConnection::stopAllLocked(bool backupRecord) {
     for (auto &i : mActivated) {
         dev.configureDirectChannel(i.first, getHalChannelHandle(), &config);
     }
+    for (auto &i : mVirtualActivated) {
+        sp<SensorInterface> si = mService->getSensorInterfaceFromHandle(i.first);
+        if (si != nullptr) {
+            si->activate(this, false);
+        }
+        mService->mDirectVirtualSensorCount--;
+    }
 
-    if (backupRecord && mActivatedBackup.empty()) {
+    if (backupRecord && mActivatedBackup.empty() && mVirtualActivatedBackup.empty()) {
         mActivatedBackup = mActivated;
+        mVirtualActivatedBackup = mVirtualActivated;
     }
     mActivated.clear();
+    mVirtualActivated.clear();
 }
 
 void SensorService::SensorDirectConnection::recoverAll() {
     Mutex::Autolock _l(mConnectionLock);
-    if (!mActivatedBackup.empty()) {
+    if (!mActivatedBackup.empty() || !mVirtualActivatedBackup.empty()) {
         stopAllLocked(false);
 
         SensorDevice& dev(SensorDevice::getInstance());
@@ -221,6 +359,15 @@ void SensorService::SensorDirectConnection::recoverAll() {
             };
             dev.configureDirectChannel(i.first, getHalChannelHandle(), &config);
         }
+
+        std::unordered_map<int, int> virtualActivated;
+        virtualActivated.swap(mVirtualActivatedBackup);
+        for (auto &i : virtualActivated) {
+            sp<SensorInterface> si = mService->getSensorInterfaceFromHandle(i.first);
+            if (si != nullptr) {
+                configureVirtualSensorLocked(si, i.first, i.second);
+            }
+        }
     }
 }
 
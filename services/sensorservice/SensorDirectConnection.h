@@ -20,6 +20,9 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <unordered_map>
+#include <vector>
+
 #include <binder/BinderService.h>
 
 #include <sensor/Sensor.h>
@@ -48,9 +51,18 @@ public:
 
     // Invoked when access to sensors for this connection has changed, e.g. lost or
     // regained due to changes in the sensor restricted/privacy mode or the
-    // app changed to idle/active status.
+    // app changed to idle/active status. Called with SensorService::mLock held.
     void onSensorAccessChanged(bool hasAccess);
 
+    // Append the handles of the virtual sensors configured on this channel to handles. Called
+    // with SensorService::mLock held.
+    void getVirtualSensorHandles(std::vector<int>* handles) const;
+
+    // Write the events of the virtual sensors configured on this channel to the shared memory,
+    // in the same sensors_event_t ring format the HAL uses for hardware sensors. Called with
+    // SensorService::mLock held.
+    void writeVirtualSensorEvents(const sensors_event_t* events, size_t count);
+
 protected:
     virtual ~SensorDirectConnection();
     // ISensorEventConnection functions
@@ -82,6 +94,15 @@ private:
     // If no requests are backed up by stopAll(), this method is no-op.
     void recoverAll();
 
+    // Start, change the rate of or stop a virtual sensor, which sensorservice computes and writes
+    // to the channel itself. Virtual and hardware sensors cannot share a channel, since the HAL
+    // and sensorservice would both be writing to the same ring. Called with SensorService::mLock
+    // and mConnectionLock held.
+    int32_t configureVirtualSensorLocked(const sp<SensorInterface>& si, int handle,
+                                         int rateLevel);
+    // Map the shared memory for writes from sensorservice, if it is not mapped yet.
+    bool mapMemoryLocked();
+
     const sp<SensorService> mService;
     const uid_t mUid;
     const sensors_direct_mem_t mMem;
@@ -91,6 +112,14 @@ private:
     mutable Mutex mConnectionLock;
     std::unordered_map<int, int> mActivated;
     std::unordered_map<int, int> mActivatedBackup;
+    std::unordered_map<int, int> mVirtualActivated;
+    std::unordered_map<int, int> mVirtualActivatedBackup;
+
+    // Ring in the shared memory that virtual sensor events are written to, mapped on first use.
+    sensors_event_t* mRing;
+    size_t mRingSize;
+    size_t mRingPosition;
+    uint32_t mRingCounter;
 
     mutable Mutex mDestroyLock;
     bool mDestroyed;
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <limits>
 #include <log/log.h>
 #include <sys/socket.h>
 #include <utils/threads.h>
@@ -41,7 +42,7 @@ SensorService::SensorEventConnection::SensorEventConnection(
         const String16& opPackageName)
     : mService(service), mUid(uid), mWakeLockRefCount(0), mHasLooperCallbacks(false),
       mDead(false), mDataInjectionMode(isDataInjectionMode), mEventCache(nullptr),
-      mCacheSize(0), mMaxCacheSize(0), mTimeOfLastEventDrop(0), mEventsDropped(0),
+      mCacheHead(0), mCacheSize(0), mMaxCacheSize(0), mTimeOfLastEventDrop(0), mEventsDropped(0),
       mPackageName(packageName), mOpPackageName(opPackageName), mTargetSdk(kTargetSdkUnknown),
       mDestroyed(false) {
     mChannel = new BitTube(mService->mSocketBufferSize);
@@ -171,6 +172,7 @@ bool SensorService::SensorEventConnection::addSensor(int32_t handle) {
 
 bool SensorService::SensorEventConnection::removeSensor(int32_t handle) {
     Mutex::Autolock _l(mConnectionLock);
+    mDecimation.erase(handle);
     if (mSensorInfo.erase(handle) >= 0) {
         return true;
     }
@@ -221,6 +223,54 @@ void SensorService::SensorEventConnection::setFirstFlushPending(int32_t handle,
     }
 }
 
+void SensorService::SensorEventConnection::setSamplingPeriod(int32_t handle,
+                                nsecs_t samplingPeriodNs) {
+    Mutex::Autolock _l(mConnectionLock);
+    if (mSensorInfo.count(handle) == 0) {
+        return;
+    }
+    auto it = mDecimation.find(handle);
+    if (it == mDecimation.end()) {
+        mDecimation.emplace(handle, Decimation(samplingPeriodNs));
+    } else {
+        it->second.mSamplingPeriodNs = samplingPeriodNs;
+    }
+}
+
+nsecs_t SensorService::SensorEventConnection::getNextEventTimestamp(int32_t handle) const {
+    Mutex::Autolock _l(mConnectionLock);
+    if (mSensorInfo.count(handle) == 0) {
+        return std::numeric_limits<nsecs_t>::max();
+    }
+    auto it = mDecimation.find(handle);
+    if (it == mDecimation.end()) {
+        return 0;
+    }
+    return it->second.mNextEventTimestamp - it->second.mSamplingPeriodNs / 2;
+}
+
+bool SensorService::SensorEventConnection::isEventDueLocked(const sensors_event_t& event) {
+    if (mDecimation.empty()) {
+        return true;
+    }
+    auto it = mDecimation.find(event.sensor);
+    if (it == mDecimation.end()) {
+        return true;
+    }
+    Decimation& decimation = it->second;
+    if (event.timestamp < decimation.mNextEventTimestamp - decimation.mSamplingPeriodNs / 2) {
+        return false;
+    }
+    // Keep to the requested rate on average, unless a whole period went by without any event, in
+    // which case start over from this one.
+    if (event.timestamp - decimation.mNextEventTimestamp >= decimation.mSamplingPeriodNs) {
+        decimation.mNextEventTimestamp = event.timestamp + decimation.mSamplingPeriodNs;
+    } else {
+        decimation.mNextEventTimestamp += decimation.mSamplingPeriodNs;
+    }
+    return true;
+}
+
 void SensorService::SensorEventConnection::updateLooperRegistration(const sp<Looper>& looper) {
     Mutex::Autolock _l(mConnectionLock);
     updateLooperRegistrationLocked(looper);
@@ -344,8 +394,9 @@ status_t SensorService::SensorEventConnection::sendEvents(
                     }
                 } else {
                     // Regular sensor event, just copy it to the scratch buffer after checking
-                    // the AppOp.
-                    if (hasSensorAccess() && noteOpIfRequired(buffer[i])) {
+                    // that it is due and the AppOp.
+                    if (hasSensorAccess() && isEventDueLocked(buffer[i]) &&
+                            noteOpIfRequired(buffer[i])) {
                         scratch[count++] = buffer[i];
                     }
                 }
@@ -416,6 +467,7 @@ status_t SensorService::SensorEventConnection::sendEvents(
         if (mEventCache == nullptr) {
             mMaxCacheSize = computeMaxCacheSizeLocked();
             mEventCache = new sensors_event_t[mMaxCacheSize];
+            mCacheHead = 0;
             mCacheSize = 0;
         }
         // Save the events so that they can be written later
@@ -468,36 +520,50 @@ bool SensorService::SensorEventConnection::noteOpIfRequired(const sensors_event_
     return success;
 }
 
-void SensorService::SensorEventConnection::reAllocateCacheLocked(sensors_event_t const* scratch,
-                                                                 int count) {
-    sensors_event_t *eventCache_new;
-    const int new_cache_size = computeMaxCacheSizeLocked();
-    // Allocate new cache, copy over events from the old cache & scratch, free up memory.
-    eventCache_new = new sensors_event_t[new_cache_size];
-    memcpy(eventCache_new, mEventCache, mCacheSize * sizeof(sensors_event_t));
-    memcpy(&eventCache_new[mCacheSize], scratch, count * sizeof(sensors_event_t));
+void SensorService::SensorEventConnection::reAllocateCacheLocked(int maxCacheSize) {
+    // Allocate the new cache and copy over the cached events, oldest first, so that the ring
+    // starts at the beginning of the new cache.
+    sensors_event_t* eventCache_new = new sensors_event_t[maxCacheSize];
+    const int firstChunk = std::min(mCacheSize, mMaxCacheSize - mCacheHead);
+    if (firstChunk > 0) {
+        memcpy(eventCache_new, &mEventCache[mCacheHead], firstChunk * sizeof(sensors_event_t));
+        memcpy(&eventCache_new[firstChunk], mEventCache,
+                (mCacheSize - firstChunk) * sizeof(sensors_event_t));
+    }
 
     ALOGD_IF(DEBUG_CONNECTIONS, "reAllocateCacheLocked maxCacheSize=%d %d", mMaxCacheSize,
-            new_cache_size);
+            maxCacheSize);
 
     delete[] mEventCache;
     mEventCache = eventCache_new;
-    mCacheSize += count;
-    mMaxCacheSize = new_cache_size;
+    mCacheHead = 0;
+    mMaxCacheSize = maxCacheSize;
+}
+
+void SensorService::SensorEventConnection::dropCachedEventsLocked(int count) {
+    // The dropped events may wrap around the end of the cache.
+    const int firstChunk = std::min(count, mMaxCacheSize - mCacheHead);
+    countFlushCompleteEventsLocked(&mEventCache[mCacheHead], firstChunk);
+    countFlushCompleteEventsLocked(mEventCache, count - firstChunk);
+    mCacheHead = (mCacheHead + count) % mMaxCacheSize;
+    mCacheSize -= count;
 }
 
 void SensorService::SensorEventConnection::appendEventsToCacheLocked(sensors_event_t const* events,
                                                                      int count) {
     if (count <= 0) {
         return;
-    } else if (mCacheSize + count <= mMaxCacheSize) {
-        // The events fit within the current cache: add them
-        memcpy(&mEventCache[mCacheSize], events, count * sizeof(sensors_event_t));
-        mCacheSize += count;
-    } else if (mCacheSize + count <= computeMaxCacheSizeLocked()) {
-        // The events fit within a resized cache: resize the cache and add the events
-        reAllocateCacheLocked(events, count);
-    } else {
+    }
+
+    if (mCacheSize + count > mMaxCacheSize) {
+        // More sensors may have registered since the cache was sized: grow it if they need more.
+        const int maxCacheSize = computeMaxCacheSizeLocked();
+        if (maxCacheSize > mMaxCacheSize) {
+            reAllocateCacheLocked(maxCacheSize);
+        }
+    }
+
+    if (mCacheSize + count > mMaxCacheSize) {
         // The events do not fit within the cache: drop the oldest events.
         int freeSpace = mMaxCacheSize - mCacheSize;
 
@@ -523,21 +589,18 @@ void SensorService::SensorEventConnection::appendEventsToCacheLocked(sensors_eve
         }
 
         // Check for any flush complete events in the events that will be dropped
-        countFlushCompleteEventsLocked(mEventCache, cachedEventsToDrop);
+        dropCachedEventsLocked(cachedEventsToDrop);
         countFlushCompleteEventsLocked(events, newEventsToDrop);
-
-        // Only shift the events if they will not all be overwritten
-        if (eventsToCopy != mMaxCacheSize) {
-            memmove(mEventCache, &mEventCache[cachedEventsToDrop],
-                    (mCacheSize - cachedEventsToDrop) * sizeof(sensors_event_t));
-        }
-        mCacheSize -= cachedEventsToDrop;
-
-        // Copy the events into the cache
-        memcpy(&mEventCache[mCacheSize], &events[newEventsToDrop],
-                eventsToCopy * sizeof(sensors_event_t));
-        mCacheSize += eventsToCopy;
+        events += newEventsToDrop;
+        count = eventsToCopy;
     }
+
+    // Copy the events after the newest cached one, wrapping around the end of the cache.
+    const int tail = (mCacheHead + mCacheSize) % mMaxCacheSize;
+    const int firstChunk = std::min(count, mMaxCacheSize - tail);
+    memcpy(&mEventCache[tail], events, firstChunk * sizeof(sensors_event_t));
+    memcpy(mEventCache, &events[firstChunk], (count - firstChunk) * sizeof(sensors_event_t));
+    mCacheSize += count;
 }
 
 void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
@@ -581,15 +644,16 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
     Mutex::Autolock _l(mConnectionLock);
     // Send pending flush complete events (if any)
     sendPendingFlushEventsLocked();
-    for (int numEventsSent = 0; numEventsSent < mCacheSize;) {
-        const int numEventsToWrite = helpers::min(mCacheSize - numEventsSent, maxWriteSize);
+    while (mCacheSize > 0) {
+        // Each write is contiguous, so a cache that wraps around is sent in two packets.
+        sensors_event_t* events = &mEventCache[mCacheHead];
+        const int numEventsToWrite = helpers::min(
+                helpers::min(mCacheSize, mMaxCacheSize - mCacheHead), maxWriteSize);
         int index_wake_up_event = -1;
         if (hasSensorAccess()) {
-            index_wake_up_event =
-                      findWakeUpSensorEventLocked(mEventCache + numEventsSent, numEventsToWrite);
+            index_wake_up_event = findWakeUpSensorEventLocked(events, numEventsToWrite);
             if (index_wake_up_event >= 0) {
-                mEventCache[index_wake_up_event + numEventsSent].flags |=
-                        WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
+                events[index_wake_up_event].flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 ++mWakeLockRefCount;
 #if DEBUG_CONNECTIONS
                 ++mTotalAcksNeeded;
@@ -598,13 +662,11 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
         }
 
         ssize_t size = SensorEventQueue::write(mChannel,
-                          reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
-                          numEventsToWrite);
+                          reinterpret_cast<ASensorEvent const*>(events), numEventsToWrite);
         if (size < 0) {
             if (index_wake_up_event >= 0) {
                 // If there was a wake_up sensor_event, reset the flag.
-                mEventCache[index_wake_up_event + numEventsSent].flags  &=
-                        ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
+                events[index_wake_up_event].flags &= ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 if (mWakeLockRefCount > 0) {
                     --mWakeLockRefCount;
                 }
@@ -612,21 +674,19 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
                 --mTotalAcksNeeded;
 #endif
             }
-            memmove(mEventCache, &mEventCache[numEventsSent],
-                                 (mCacheSize - numEventsSent) * sizeof(sensors_event_t));
-            ALOGD_IF(DEBUG_CONNECTIONS, "wrote %d events from cache size==%d ",
-                    numEventsSent, mCacheSize);
-            mCacheSize -= numEventsSent;
+            ALOGD_IF(DEBUG_CONNECTIONS, "wrote events from cache, %d left", mCacheSize);
             return;
         }
-        numEventsSent += numEventsToWrite;
+        mCacheHead = (mCacheHead + numEventsToWrite) % mMaxCacheSize;
+        mCacheSize -= numEventsToWrite;
 #if DEBUG_CONNECTIONS
         mEventsSentFromCache += numEventsToWrite;
 #endif
     }
-    ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache size=%d ", mCacheSize);
-    // All events from the cache have been sent. Reset cache size to zero.
-    mCacheSize = 0;
+    ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache");
+    // All events from the cache have been sent. Start the ring over at the beginning of the
+    // cache, so that the next events are written in a single packet.
+    mCacheHead = 0;
     // There are no more events in the cache. We don't need to poll for write on the fd.
     // Update Looper registration.
     updateLooperRegistrationLocked(mService->getLooper());
@@ -61,6 +61,12 @@ public:
     bool removeSensor(int32_t handle);
     std::vector<int32_t> getActiveSensorHandles() const;
     void setFirstFlushPending(int32_t handle, bool value);
+    // Send events of the given sensor no faster than needed for the given sampling period. Only
+    // used for virtual sensors, which are computed at the rate of the fastest connection.
+    void setSamplingPeriod(int32_t handle, nsecs_t samplingPeriodNs);
+    // Return the earliest timestamp of an event of the given sensor that this connection would
+    // send, or INT64_MAX if the connection has not registered for the sensor.
+    nsecs_t getNextEventTimestamp(int32_t handle) const;
     void dump(String8& result);
     void dump(util::ProtoOutputStream* proto) const;
     bool needsWakeLock();
@@ -91,6 +97,10 @@ private:
     // flag set. SOCK_SEQPACKET ensures that either the entire packet is read or dropped.
     int findWakeUpSensorEventLocked(sensors_event_t const* scratch, int count);
 
+    // Return true if the event is due for this connection given the sampling period it asked for,
+    // and move on to the next event that will be due.
+    bool isEventDueLocked(const sensors_event_t& event);
+
     // Send pending flush_complete events. There may have been flush_complete_events that are
     // dropped which need to be sent separately before other events. On older HALs (1_0) this method
     // emulates the behavior of flush().
@@ -104,12 +114,16 @@ private:
     // amongst wake-up sensors and non-wake up sensors.
     int computeMaxCacheSizeLocked() const;
 
-    // When more sensors register, the maximum cache size desired may change.  Compute max cache
-    // size, reallocate memory and copy over events from the older cache.
-    void reAllocateCacheLocked(sensors_event_t const* scratch, int count);
+    // When more sensors register, the maximum cache size desired may change. Reallocate the cache
+    // with the given size and copy over the cached events, oldest first.
+    void reAllocateCacheLocked(int maxCacheSize);
+
+    // Drop the given number of the oldest events from the cache, counting the flush complete
+    // events among them.
+    void dropCachedEventsLocked(int count);
 
-    // Add the events to the cache. If the cache would be exceeded, drop events at the beginning of
-    // the cache.
+    // Add the events to the cache, growing it if more sensors registered since it was sized. If
+    // the cache would still be exceeded, drop the oldest events.
     void appendEventsToCacheLocked(sensors_event_t const* events, int count);
 
     // LooperCallback method. If there is data to read on this fd, it is an ack from the app that it
@@ -171,8 +185,23 @@ private:
     // protected by SensorService::mLock. Key for this map is the sensor handle.
     std::unordered_map<int32_t, FlushInfo> mSensorInfo;
 
+    struct Decimation {
+        nsecs_t mSamplingPeriodNs;
+        // Events up to half a sampling period before this are sent, so that jitter in the
+        // underlying sensor never brings the rate below the requested one.
+        nsecs_t mNextEventTimestamp;
+
+        explicit Decimation(nsecs_t samplingPeriodNs)
+              : mSamplingPeriodNs(samplingPeriodNs), mNextEventTimestamp(0) {}
+    };
+    // protected by mConnectionLock. Key for this map is the sensor handle.
+    std::unordered_map<int32_t, Decimation> mDecimation;
+
+    // Ring of mMaxCacheSize events, allocated the first time a write fails. The mCacheSize cached
+    // events start at mCacheHead and wrap around the end, so that neither sending nor dropping
+    // events moves the others.
     sensors_event_t *mEventCache;
-    int mCacheSize, mMaxCacheSize;
+    int mCacheHead, mCacheSize, mMaxCacheSize;
     int64_t mTimeOfLastEventDrop;
     int mEventsDropped;
     String8 mPackageName;
@@ -50,8 +50,10 @@
 #include "SensorRecord.h"
 #include "SensorRegistrationInfo.h"
 
+#include <algorithm>
 #include <ctime>
 #include <inttypes.h>
+#include <limits>
 #include <math.h>
 #include <sched.h>
 #include <stdint.h>
@@ -94,7 +96,7 @@ static const String16 sManageSensorsPermission("android.permission.MANAGE_SENSOR
 
 SensorService::SensorService()
     : mInitCheck(NO_INIT), mSocketBufferSize(SOCKET_BUFFER_SIZE_NON_BATCHED),
-      mWakeLockAcquired(false) {
+      mDirectVirtualSensorCount(0), mWakeLockAcquired(false) {
     mUidPolicy = new UidPolicy(this);
     mSensorPrivacyPolicy = new SensorPrivacyPolicy(this);
 }
@@ -893,10 +895,25 @@ bool SensorService::threadLoop() {
         }
         recordLastValueLocked(mSensorEventBuffer, count);
 
+        // Cache the list of active connections, since we use it in multiple places below but won't
+        // modify it here
+        const std::vector<sp<SensorEventConnection>> activeConnections = connLock.getActiveConnections();
+
+        // Virtual sensors configured on direct channels are computed like the others, and
+        // written to the channels once they are.
+        std::vector<sp<SensorDirectConnection>> directConnections;
+        mDirectVirtualSensors.clear();
+        if (mDirectVirtualSensorCount > 0) {
+            directConnections = connLock.getDirectConnections();
+            for (const sp<SensorDirectConnection>& connection : directConnections) {
+                connection->getVirtualSensorHandles(&mDirectVirtualSensors);
+            }
+        }
+
         // handle virtual sensors
         if (count && vcount) {
             sensors_event_t const * const event = mSensorEventBuffer;
-            if (!mActiveVirtualSensors.empty()) {
+            if (!mActiveVirtualSensors.empty() || !mDirectVirtualSensors.empty()) {
                 size_t k = 0;
                 SensorFusion& fusion(SensorFusion::getInstance());
                 if (fusion.isEnabled()) {
@@ -904,14 +921,39 @@ bool SensorService::threadLoop() {
                         fusion.process(event[i]);
                     }
                 }
+                // Virtual sensor events carry the timestamp of the event they are computed from.
+                // Don't compute the ones that every connection would drop for coming too soon.
+                mVirtualSensorsToProcess.clear();
+                for (int handle : mActiveVirtualSensors) {
+                    nsecs_t nextEventTimestamp = std::numeric_limits<nsecs_t>::max();
+                    for (const sp<SensorEventConnection>& connection : activeConnections) {
+                        nextEventTimestamp = std::min(nextEventTimestamp,
+                                connection->getNextEventTimestamp(handle));
+                    }
+                    mVirtualSensorsToProcess.emplace_back(handle, nextEventTimestamp);
+                }
+                // Direct channels take every event.
+                for (int handle : mDirectVirtualSensors) {
+                    auto it = std::find_if(mVirtualSensorsToProcess.begin(),
+                                           mVirtualSensorsToProcess.end(),
+                                           [handle](const auto& v) { return v.first == handle; });
+                    if (it != mVirtualSensorsToProcess.end()) {
+                        it->second = 0;
+                    } else {
+                        mVirtualSensorsToProcess.emplace_back(handle, 0);
+                    }
+                }
                 for (size_t i=0 ; i<size_t(count) && k<minBufferSize ; i++) {
-                    for (int handle : mActiveVirtualSensors) {
+                    for (const auto& [handle, nextEventTimestamp] : mVirtualSensorsToProcess) {
                         if (count + k >= minBufferSize) {
                             ALOGE("buffer too small to hold all events: "
                                     "count=%zd, k=%zu, size=%zu",
                                     count, k, minBufferSize);
                             break;
                         }
+                        if (event[i].timestamp < nextEventTimestamp) {
+                            continue;
+                        }
                         sensors_event_t out;
                         sp<SensorInterface> si = mSensors.getInterface(handle);
                         if (si == nullptr) {
@@ -926,6 +968,9 @@ bool SensorService::threadLoop() {
                     }
                 }
                 if (k) {
+                    for (const sp<SensorDirectConnection>& connection : directConnections) {
+                        connection->writeVirtualSensorEvents(&mSensorEventBuffer[count], k);
+                    }
                     // record the last synthesized values
                     recordLastValueLocked(&mSensorEventBuffer[count], k);
                     count += k;
@@ -946,10 +991,6 @@ bool SensorService::threadLoop() {
             }
         }
 
-        // Cache the list of active connections, since we use it in multiple places below but won't
-        // modify it here
-        const std::vector<sp<SensorEventConnection>> activeConnections = connLock.getActiveConnections();
-
         for (int i = 0; i < count; ++i) {
             // Map flush_complete_events in the buffer to SensorEventConnections which called flush
             // on the hardware sensor. mapFlushEventsToConnections[i] will be the
@@ -1353,7 +1394,14 @@ sp<ISensorEventConnection> SensorService::createSensorDirectConnection(
     SensorDevice& dev(SensorDevice::getInstance());
     int channelHandle = dev.registerDirectChannel(&mem);
 
-    if (channelHandle <= 0) {
+    if (channelHandle <= 0 && type == SENSOR_DIRECT_MEM_TYPE_ASHMEM) {
+        // sensorservice writes virtual sensors to ashmem channels itself, so they do not need the
+        // HAL to support direct channels. Hardware sensors cannot be configured on such a channel.
+        ALOGD_IF(DEBUG_CONNECTIONS, "SensorDevice::registerDirectChannel returns %d, creating a "
+                 "channel for virtual sensors only", channelHandle);
+        mem.handle = clone;
+        conn = new SensorDirectConnection(this, uid, &mem, 0, opPackageName);
+    } else if (channelHandle <= 0) {
         ALOGE("SensorDevice::registerDirectChannel returns %d", channelHandle);
     } else {
         mem.handle = clone;
@@ -1533,7 +1581,9 @@ void SensorService::cleanupConnection(SensorDirectConnection* c) {
     Mutex::Autolock _l(mLock);
 
     SensorDevice& dev(SensorDevice::getInstance());
-    dev.unregisterDirectChannel(c->getHalChannelHandle());
+    if (c->getHalChannelHandle() > 0) {
+        dev.unregisterDirectChannel(c->getHalChannelHandle());
+    }
     mConnectionHolder.removeDirectConnection(c);
 }
 
@@ -1668,6 +1718,11 @@ status_t SensorService::enable(const sp<SensorEventConnection>& connection,
     if (err == NO_ERROR) {
         connection->updateLooperRegistration(mLooper);
 
+        if (sensor->isVirtual() &&
+                sensor->getSensor().getReportingMode() == AREPORTING_MODE_CONTINUOUS) {
+            connection->setSamplingPeriod(handle, samplingPeriodNs);
+        }
+
         if (sensor->getSensor().getRequiredPermission().size() > 0 &&
                 sensor->getSensor().getRequiredAppOp() >= 0) {
             connection->mHandleToAppOp[handle] = sensor->getSensor().getRequiredAppOp();
@@ -1753,7 +1808,12 @@ status_t SensorService::setEventRate(const sp<SensorEventConnection>& connection
         ns = minDelayNs;
     }
 
-    return sensor->setDelay(connection.get(), handle, ns);
+    status_t err = sensor->setDelay(connection.get(), handle, ns);
+    if (err == NO_ERROR && sensor->isVirtual() &&
+            sensor->getSensor().getReportingMode() == AREPORTING_MODE_CONTINUOUS) {
+        connection->setSamplingPeriod(handle, ns);
+    }
+    return err;
 }
 
 status_t SensorService::flushSensor(const sp<SensorEventConnection>& connection,
@@ -400,6 +400,13 @@ private:
     mutable Mutex mLock;
     DefaultKeyedVector<int, SensorRecord*> mActiveSensors;
     std::unordered_set<int> mActiveVirtualSensors;
+    // Active virtual sensors, each with the earliest timestamp any connection takes it from.
+    // Rebuilt on every iteration of threadLoop().
+    std::vector<std::pair<int, nsecs_t>> mVirtualSensorsToProcess;
+    // Number of virtual sensors configured on direct channels, and their handles, gathered on
+    // every iteration of threadLoop() while there are any.
+    int mDirectVirtualSensorCount;
+    std::vector<int> mDirectVirtualSensors;
     SensorConnectionHolder mConnectionHolder;
     bool mWakeLockAcquired;
     sensors_event_t *mSensorEventBuffer, *mSensorEventScratch;
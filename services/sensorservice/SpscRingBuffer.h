@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SENSOR_SERVICE_UTIL_SPSC_RING_BUFFER_H
+#define ANDROID_SENSOR_SERVICE_UTIL_SPSC_RING_BUFFER_H
+
+#include <atomic>
+#include <memory>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+namespace android {
+namespace SensorServiceUtil {
+
+/**
+ * A fixed size ring buffer written by a single thread without locks, and read from any thread.
+ * Once full, each item added replaces the oldest one.
+ *
+ * Readers never block the writer. Each slot carries a sequence number that tells which item it
+ * holds and whether it is being written, so a reader copies a slot and keeps the copy only if the
+ * sequence number is the one expected before and after. The items are stored as relaxed atomic
+ * words, so a reader racing with the writer only ever sees a torn copy, which it throws away.
+ */
+template <class T>
+class SpscRingBuffer final {
+    static_assert(std::is_trivially_copyable<T>::value, "Items are copied as raw words");
+
+public:
+    /**
+     * Construct a SpscRingBuffer that holds up to the given number of items.
+     */
+    explicit SpscRingBuffer(size_t length);
+
+    /**
+     * Add an item, replacing the oldest one if the buffer is full. Only one thread may call this.
+     */
+    void add(const T& item);
+
+    /**
+     * Return a copy of the items, newest first. Items overwritten while the copy was taken are
+     * left out, along with all the items older than them, so the result is always a run of
+     * consecutive items ending with one that was the newest at the time of the call.
+     */
+    std::vector<T> snapshot() const;
+
+    /**
+     * Copy the newest item into item. Return false if the buffer is empty, or if the writer kept
+     * replacing the newest item while it was read.
+     */
+    bool getNewest(T* item) const;
+
+    /**
+     * Return true if no item has ever been added.
+     */
+    bool isEmpty() const;
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    // The newest item is retried this many times when the writer replaces it during a read.
+    static constexpr int MAX_READ_ATTEMPTS = 3;
+
+    struct Slot {
+        // 2 * n + 1 while the item of generation n is written, 2 * (n + 1) once it is done.
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<uint64_t> words[WORDS];
+    };
+
+    // Copy the item with the given index, counting from the first ever added, if the slot
+    // still holds it.
+    bool read(uint64_t index, T* item) const;
+
+    const size_t mLength;
+    std::unique_ptr<Slot[]> mSlots;
+    // Number of items ever added.
+    std::atomic<uint64_t> mCount{0};
+}; // class SpscRingBuffer
+
+
+template <class T>
+SpscRingBuffer<T>::SpscRingBuffer(size_t length) : mLength{length}, mSlots{new Slot[length]} {}
+
+template <class T>
+void SpscRingBuffer<T>::add(const T& item) {
+    if (mLength == 0) {
+        return;
+    }
+    const uint64_t index = mCount.load(std::memory_order_relaxed);
+    Slot& slot = mSlots[index % mLength];
+    const uint64_t generation = index / mLength;
+
+    uint64_t words[WORDS] = {};
+    memcpy(words, &item, sizeof(T));
+
+    slot.sequence.store(2 * generation + 1, std::memory_order_relaxed);
+    // Readers that see any of the new words must also see the odd sequence number.
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.sequence.store(2 * (generation + 1), std::memory_order_release);
+    mCount.store(index + 1, std::memory_order_release);
+}
+
+template <class T>
+bool SpscRingBuffer<T>::read(uint64_t index, T* item) const {
+    const Slot& slot = mSlots[index % mLength];
+    const uint64_t expected = 2 * (index / mLength + 1);
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+        return false;
+    }
+    uint64_t words[WORDS];
+    for (size_t i = 0; i < WORDS; i++) {
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    // The words must be read before the sequence number is checked again.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+        return false;
+    }
+    memcpy(item, words, sizeof(T));
+    return true;
+}
+
+template <class T>
+std::vector<T> SpscRingBuffer<T>::snapshot() const {
+    std::vector<T> items;
+    const uint64_t count = mCount.load(std::memory_order_acquire);
+    const uint64_t available = count < mLength ? count : mLength;
+    items.reserve(available);
+    for (uint64_t i = 0; i < available; i++) {
+        T item;
+        if (!read(count - 1 - i, &item)) {
+            // Overwritten, and so are all older items.
+            break;
+        }
+        items.push_back(item);
+    }
+    return items;
+}
+
+template <class T>
+bool SpscRingBuffer<T>::getNewest(T* item) const {
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+        const uint64_t count = mCount.load(std::memory_order_acquire);
+        if (count == 0) {
+            return false;
+        }
+        if (read(count - 1, item)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class T>
+bool SpscRingBuffer<T>::isEmpty() const {
+    return mCount.load(std::memory_order_relaxed) == 0;
+}
+
+}  // namespace SensorServiceUtil
+}; // namespace android
+
+#endif // ANDROID_SENSOR_SERVICE_UTIL_SPSC_RING_BUFFER_H
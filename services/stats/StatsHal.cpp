@@ -17,6 +17,11 @@
 #define DEBUG false // STOPSHIP if true
 #define LOG_TAG "StatsHal"
 
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+
 #include <log/log.h>
 #include <statslog.h>
 
@@ -28,28 +33,86 @@ namespace stats {
 namespace V1_0 {
 namespace implementation {
 
-StatsHal::StatsHal() {}
+StatsHal::StatsHal() : mWriterThread(&StatsHal::writerLoop, this) {}
+
+StatsHal::~StatsHal() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExiting = true;
+    }
+    mCondition.notify_one();
+    mWriterThread.join();
+}
+
+void StatsHal::enqueue(AtomWriter writer) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mQueue.size() >= kMaxQueuedAtoms) {
+            // Only log the first drop of a burst.
+            ALOGE_IF(!mDropping, "Atom queue is full, dropping atoms (%" PRIu64 " dropped so far)",
+                    mDroppedAtoms);
+            mDropping = true;
+            mDroppedAtoms++;
+            return;
+        }
+        mDropping = false;
+        mQueue.push_back(std::move(writer));
+        mMaxQueueDepth = std::max(mMaxQueueDepth, mQueue.size());
+    }
+    mCondition.notify_one();
+}
+
+void StatsHal::writerLoop() {
+    std::deque<AtomWriter> batch;
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait(lock, [this] { return mExiting || !mQueue.empty(); });
+        if (mQueue.empty()) {
+            // Exiting, and everything queued was written.
+            return;
+        }
+
+        // Write everything queued since the last wake-up without holding the lock, so that
+        // reporters are never blocked on statsd.
+        batch.swap(mQueue);
+        lock.unlock();
+        for (auto& writer : batch) {
+            writer();
+        }
+        const size_t written = batch.size();
+        batch.clear();
+        lock.lock();
+        mWrittenAtoms += written;
+    }
+}
 
 hardware::Return<void> StatsHal::reportSpeakerImpedance(
         const SpeakerImpedance& speakerImpedance) {
-    android::util::stats_write(android::util::SPEAKER_IMPEDANCE_REPORTED,
-            speakerImpedance.speakerLocation, speakerImpedance.milliOhms);
+    enqueue([speakerImpedance] {
+        android::util::stats_write(android::util::SPEAKER_IMPEDANCE_REPORTED,
+                speakerImpedance.speakerLocation, speakerImpedance.milliOhms);
+    });
 
     return hardware::Void();
 }
 
 hardware::Return<void> StatsHal::reportHardwareFailed(const HardwareFailed& hardwareFailed) {
-    android::util::stats_write(android::util::HARDWARE_FAILED, int32_t(hardwareFailed.hardwareType),
-            hardwareFailed.hardwareLocation, int32_t(hardwareFailed.errorCode));
+    enqueue([hardwareFailed] {
+        android::util::stats_write(android::util::HARDWARE_FAILED,
+                int32_t(hardwareFailed.hardwareType), hardwareFailed.hardwareLocation,
+                int32_t(hardwareFailed.errorCode));
+    });
 
     return hardware::Void();
 }
 
 hardware::Return<void> StatsHal::reportPhysicalDropDetected(
         const PhysicalDropDetected& physicalDropDetected) {
-    android::util::stats_write(android::util::PHYSICAL_DROP_DETECTED,
-            int32_t(physicalDropDetected.confidencePctg), physicalDropDetected.accelPeak,
-            physicalDropDetected.freefallDuration);
+    enqueue([physicalDropDetected] {
+        android::util::stats_write(android::util::PHYSICAL_DROP_DETECTED,
+                int32_t(physicalDropDetected.confidencePctg), physicalDropDetected.accelPeak,
+                physicalDropDetected.freefallDuration);
+    });
 
     return hardware::Void();
 }
@@ -60,53 +123,68 @@ hardware::Return<void> StatsHal::reportChargeCycles(const ChargeCycles& chargeCy
     for (int i = 0; i < 10 - initialSize; i++) {
         buckets.push_back(0); // Push 0 for buckets that do not exist.
     }
-    android::util::stats_write(android::util::CHARGE_CYCLES_REPORTED, buckets[0], buckets[1],
-            buckets[2], buckets[3], buckets[4], buckets[5], buckets[6], buckets[7], buckets[8],
-            buckets[9]);
+    enqueue([buckets = std::move(buckets)] {
+        android::util::stats_write(android::util::CHARGE_CYCLES_REPORTED, buckets[0], buckets[1],
+                buckets[2], buckets[3], buckets[4], buckets[5], buckets[6], buckets[7],
+                buckets[8], buckets[9]);
+    });
 
     return hardware::Void();
 }
 
 hardware::Return<void> StatsHal::reportBatteryHealthSnapshot(
         const BatteryHealthSnapshotArgs& batteryHealthSnapshotArgs) {
-    android::util::stats_write(android::util::BATTERY_HEALTH_SNAPSHOT,
-            int32_t(batteryHealthSnapshotArgs.type), batteryHealthSnapshotArgs.temperatureDeciC,
-            batteryHealthSnapshotArgs.voltageMicroV, batteryHealthSnapshotArgs.currentMicroA,
-            batteryHealthSnapshotArgs.openCircuitVoltageMicroV,
-            batteryHealthSnapshotArgs.resistanceMicroOhm, batteryHealthSnapshotArgs.levelPercent);
+    enqueue([batteryHealthSnapshotArgs] {
+        android::util::stats_write(android::util::BATTERY_HEALTH_SNAPSHOT,
+                int32_t(batteryHealthSnapshotArgs.type),
+                batteryHealthSnapshotArgs.temperatureDeciC,
+                batteryHealthSnapshotArgs.voltageMicroV, batteryHealthSnapshotArgs.currentMicroA,
+                batteryHealthSnapshotArgs.openCircuitVoltageMicroV,
+                batteryHealthSnapshotArgs.resistanceMicroOhm,
+                batteryHealthSnapshotArgs.levelPercent);
+    });
 
     return hardware::Void();
 }
 
 hardware::Return<void> StatsHal::reportSlowIo(const SlowIo& slowIo) {
-    android::util::stats_write(android::util::SLOW_IO, int32_t(slowIo.operation), slowIo.count);
+    enqueue([slowIo] {
+        android::util::stats_write(android::util::SLOW_IO, int32_t(slowIo.operation),
+                slowIo.count);
+    });
 
     return hardware::Void();
 }
 
 hardware::Return<void> StatsHal::reportBatteryCausedShutdown(
         const BatteryCausedShutdown& batteryCausedShutdown) {
-    android::util::stats_write(android::util::BATTERY_CAUSED_SHUTDOWN,
-            batteryCausedShutdown.voltageMicroV);
+    enqueue([batteryCausedShutdown] {
+        android::util::stats_write(android::util::BATTERY_CAUSED_SHUTDOWN,
+                batteryCausedShutdown.voltageMicroV);
+    });
 
     return hardware::Void();
 }
 
 hardware::Return<void> StatsHal::reportUsbPortOverheatEvent(
         const UsbPortOverheatEvent& usbPortOverheatEvent) {
-    android::util::stats_write(android::util::USB_PORT_OVERHEAT_EVENT_REPORTED,
-            usbPortOverheatEvent.plugTemperatureDeciC, usbPortOverheatEvent.maxTemperatureDeciC,
-            usbPortOverheatEvent.timeToOverheat, usbPortOverheatEvent.timeToHysteresis,
-            usbPortOverheatEvent.timeToInactive);
+    enqueue([usbPortOverheatEvent] {
+        android::util::stats_write(android::util::USB_PORT_OVERHEAT_EVENT_REPORTED,
+                usbPortOverheatEvent.plugTemperatureDeciC,
+                usbPortOverheatEvent.maxTemperatureDeciC, usbPortOverheatEvent.timeToOverheat,
+                usbPortOverheatEvent.timeToHysteresis, usbPortOverheatEvent.timeToInactive);
+    });
 
     return hardware::Void();
 }
 
 hardware::Return<void> StatsHal::reportSpeechDspStat(
         const SpeechDspStat& speechDspStat) {
-    android::util::stats_write(android::util::SPEECH_DSP_STAT_REPORTED,
-            speechDspStat.totalUptimeMillis, speechDspStat.totalDowntimeMillis,
-            speechDspStat.totalCrashCount, speechDspStat.totalRecoverCount);
+    enqueue([speechDspStat] {
+        android::util::stats_write(android::util::SPEECH_DSP_STAT_REPORTED,
+                speechDspStat.totalUptimeMillis, speechDspStat.totalDowntimeMillis,
+                speechDspStat.totalCrashCount, speechDspStat.totalRecoverCount);
+    });
 
     return hardware::Void();
 }
@@ -121,29 +199,52 @@ hardware::Return<void> StatsHal::reportVendorAtom(const VendorAtom& vendorAtom)
         ALOGE("Vendor atom reverse domain name %s is too long.", reverseDomainName.c_str());
         return hardware::Void();
     }
-    AStatsEvent* event = AStatsEvent_obtain();
-    AStatsEvent_setAtomId(event, vendorAtom.atomId);
-    AStatsEvent_writeString(event, vendorAtom.reverseDomainName.c_str());
-    for (int i = 0; i < (int)vendorAtom.values.size(); i++) {
-        switch (vendorAtom.values[i].getDiscriminator()) {
-            case VendorAtom::Value::hidl_discriminator::intValue:
-                AStatsEvent_writeInt32(event, vendorAtom.values[i].intValue());
-                break;
-            case VendorAtom::Value::hidl_discriminator::longValue:
-                AStatsEvent_writeInt64(event, vendorAtom.values[i].longValue());
-                break;
-            case VendorAtom::Value::hidl_discriminator::floatValue:
-                AStatsEvent_writeFloat(event, vendorAtom.values[i].floatValue());
-                break;
-            case VendorAtom::Value::hidl_discriminator::stringValue:
-                AStatsEvent_writeString(event, vendorAtom.values[i].stringValue().c_str());
-                break;
+    enqueue([vendorAtom] {
+        AStatsEvent* event = AStatsEvent_obtain();
+        AStatsEvent_setAtomId(event, vendorAtom.atomId);
+        AStatsEvent_writeString(event, vendorAtom.reverseDomainName.c_str());
+        for (int i = 0; i < (int)vendorAtom.values.size(); i++) {
+            switch (vendorAtom.values[i].getDiscriminator()) {
+                case VendorAtom::Value::hidl_discriminator::intValue:
+                    AStatsEvent_writeInt32(event, vendorAtom.values[i].intValue());
+                    break;
+                case VendorAtom::Value::hidl_discriminator::longValue:
+                    AStatsEvent_writeInt64(event, vendorAtom.values[i].longValue());
+                    break;
+                case VendorAtom::Value::hidl_discriminator::floatValue:
+                    AStatsEvent_writeFloat(event, vendorAtom.values[i].floatValue());
+                    break;
+                case VendorAtom::Value::hidl_discriminator::stringValue:
+                    AStatsEvent_writeString(event, vendorAtom.values[i].stringValue().c_str());
+                    break;
+            }
         }
+        AStatsEvent_build(event);
+        AStatsEvent_write(event);
+        AStatsEvent_release(event);
+    });
+
+    return hardware::Void();
+}
+
+hardware::Return<void> StatsHal::debug(const hidl_handle& fd,
+        const hidl_vec<hidl_string>& /*options*/) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        ALOGE("Invalid file descriptor for debug output");
+        return hardware::Void();
     }
-    AStatsEvent_build(event);
-    AStatsEvent_write(event);
-    AStatsEvent_release(event);
 
+    std::unique_lock<std::mutex> lock(mLock);
+    const size_t queued = mQueue.size();
+    const size_t maxQueueDepth = mMaxQueueDepth;
+    const uint64_t written = mWrittenAtoms;
+    const uint64_t dropped = mDroppedAtoms;
+    lock.unlock();
+
+    dprintf(fd->data[0],
+            "Atoms written: %" PRIu64 "\nAtoms dropped: %" PRIu64 "\nAtoms queued: %zu "
+            "(max %zu, limit %zu)\n",
+            written, dropped, queued, maxQueueDepth, kMaxQueuedAtoms);
     return hardware::Void();
 }
 
@@ -19,6 +19,12 @@
 
 #include <stats_event.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
 using namespace android::frameworks::stats::V1_0;
 
 namespace android {
@@ -27,14 +33,22 @@ namespace stats {
 namespace V1_0 {
 namespace implementation {
 
+using android::hardware::hidl_handle;
+using android::hardware::hidl_string;
+using android::hardware::hidl_vec;
 using android::hardware::Return;
 
 /**
 * Implements the Stats HAL
+*
+* Atoms are queued and written to statsd from a background thread, so that
+* reporters do not wait for the write. Atoms reported while the queue is full
+* are dropped and counted.
 */
 class StatsHal : public IStats {
 public:
     StatsHal();
+    ~StatsHal();
 
     /**
      * Binder call to get SpeakerImpedance atom.
@@ -90,6 +104,37 @@ public:
      * Binder call to get vendor atom.
      */
     virtual Return<void> reportVendorAtom(const VendorAtom& vendorAtom) override;
+
+    /**
+     * Dumps the queue and drop counters.
+     */
+    virtual Return<void> debug(const hidl_handle& fd,
+                               const hidl_vec<hidl_string>& options) override;
+
+private:
+    // Atoms that can be queued before new ones are dropped.
+    static constexpr size_t kMaxQueuedAtoms = 1024;
+
+    using AtomWriter = std::function<void()>;
+
+    /**
+     * Queues an atom to be written by the writer thread.
+     */
+    void enqueue(AtomWriter writer);
+
+    void writerLoop();
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<AtomWriter> mQueue;
+    bool mExiting = false;
+
+    uint64_t mWrittenAtoms = 0;
+    uint64_t mDroppedAtoms = 0;
+    bool mDropping = false;
+    size_t mMaxQueueDepth = 0;
+
+    std::thread mWriterThread;
 };
 
 }  // namespace implementation
@@ -304,9 +304,8 @@ void BufferLayer::preparePerFrameCompositionState() {
     }
 
     compositionState->buffer = mBufferInfo.mBuffer;
-    compositionState->bufferSlot = (mBufferInfo.mBufferSlot == BufferQueue::INVALID_BUFFER_SLOT)
-            ? 0
-            : mBufferInfo.mBufferSlot;
+    // Buffers without a slot are given one by the HWC buffer cache of each output layer.
+    compositionState->bufferSlot = mBufferInfo.mBufferSlot;
     compositionState->acquireFence = mBufferInfo.mFence;
 }
 
@@ -396,6 +395,7 @@ bool BufferLayer::latchBuffer(bool& recomputeVisibleRegions, nsecs_t latchTime,
     bool refreshRequired = latchSidebandStream(recomputeVisibleRegions);
 
     if (refreshRequired) {
+        mBufferGeneration++;
         return refreshRequired;
     }
 
@@ -423,6 +423,7 @@ bool BufferLayer::latchBuffer(bool& recomputeVisibleRegions, nsecs_t latchTime,
     // Capture the old state of the layer for comparisons later
     const State& s(getDrawingState());
     const bool oldOpacity = isOpaque(s);
+    const Geometry oldGeometry = getActiveGeometry(s);
 
     BufferInfo oldBufferInfo = mBufferInfo;
 
@@ -447,12 +448,14 @@ bool BufferLayer::latchBuffer(bool& recomputeVisibleRegions, nsecs_t latchTime,
     }
 
     gatherBufferInfo();
+    mBufferGeneration++;
 
     mRefreshPending = true;
     if (oldBufferInfo.mBuffer == nullptr) {
         // the first time we receive a buffer, we need to trigger a
         // geometry invalidation.
         recomputeVisibleRegions = true;
+        setGeometryDirty();
     }
 
     if ((mBufferInfo.mCrop != oldBufferInfo.mCrop) ||
@@ -460,6 +463,7 @@ bool BufferLayer::latchBuffer(bool& recomputeVisibleRegions, nsecs_t latchTime,
         (mBufferInfo.mScaleMode != oldBufferInfo.mScaleMode) ||
         (mBufferInfo.mTransformToDisplayInverse != oldBufferInfo.mTransformToDisplayInverse)) {
         recomputeVisibleRegions = true;
+        setGeometryDirty();
     }
 
     if (oldBufferInfo.mBuffer != nullptr) {
@@ -468,9 +472,15 @@ bool BufferLayer::latchBuffer(bool& recomputeVisibleRegions, nsecs_t latchTime,
         if (bufWidth != uint32_t(oldBufferInfo.mBuffer->width) ||
             bufHeight != uint32_t(oldBufferInfo.mBuffer->height)) {
             recomputeVisibleRegions = true;
+            setGeometryDirty();
         }
     }
 
+    // Latching may also resize the layer to match the new buffer.
+    if (getActiveGeometry(s) != oldGeometry) {
+        setGeometryDirty();
+    }
+
     if (oldOpacity != isOpaque(s)) {
         recomputeVisibleRegions = true;
     }
@@ -809,9 +819,16 @@ void BufferLayer::updateCloneBufferInfo() {
     }
 
     sp<BufferLayer> clonedFrom = static_cast<BufferLayer*>(getClonedFrom().get());
+    // The damage changes every frame, even when no buffer is latched.
+    surfaceDamageRegion = clonedFrom->surfaceDamageRegion;
+    if (mClonedBufferGeneration == clonedFrom->mBufferGeneration) {
+        return;
+    }
+    mClonedBufferGeneration = clonedFrom->mBufferGeneration;
+    mBufferGeneration++;
+
     mBufferInfo = clonedFrom->mBufferInfo;
     mSidebandStream = clonedFrom->mSidebandStream;
-    surfaceDamageRegion = clonedFrom->surfaceDamageRegion;
     mCurrentFrameNumber = clonedFrom->mCurrentFrameNumber.load();
     mPreviousFrameNumber = clonedFrom->mPreviousFrameNumber;
 
@@ -823,9 +840,12 @@ void BufferLayer::updateCloneBufferInfo() {
     wp<Layer> tmpZOrderRelativeOf = mDrawingState.zOrderRelativeOf;
     SortedVector<wp<Layer>> tmpZOrderRelatives = mDrawingState.zOrderRelatives;
     wp<Layer> tmpTouchableRegionCrop = mDrawingState.touchableRegionCrop;
-    InputWindowInfo tmpInputInfo = mDrawingState.inputInfo;
+    auto tmpInputInfo = mDrawingState.inputInfo;
 
     mDrawingState = clonedFrom->mDrawingState;
+    mClonedDrawingStateGeneration = clonedFrom->mDrawingStateGeneration;
+    mDrawingStateGeneration++;
+    setGeometryDirty();
 
     mDrawingState.touchableRegionCrop = tmpTouchableRegionCrop;
     mDrawingState.zOrderRelativeOf = tmpZOrderRelativeOf;
@@ -176,6 +176,11 @@ protected:
 
     BufferInfo mBufferInfo;
     virtual void gatherBufferInfo() = 0;
+    // Bumped whenever a buffer or sideband stream is latched, so clones only copy the buffer
+    // info when it changed.
+    uint64_t mBufferGeneration = 0;
+    // For clones, the mBufferGeneration of the real layer that was last copied.
+    std::optional<uint64_t> mClonedBufferGeneration;
 
     std::optional<compositionengine::LayerFE::LayerSettings> prepareClientComposition(
             compositionengine::LayerFE::ClientCompositionTargetSettings&) override;
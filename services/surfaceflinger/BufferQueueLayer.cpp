@@ -158,6 +158,15 @@ bool BufferQueueLayer::fenceHasSignaled() const {
     return fenceSignaled;
 }
 
+void BufferQueueLayer::prefetchFenceStatus() {
+    Mutex::Autolock lock(mQueueItemLock);
+    if (!mQueueItems.isEmpty()) {
+        // FenceTime keeps the signal time once it is known, so fenceHasSignaled() won't query
+        // the fence again.
+        mQueueItems[0].mFenceTime->getSignalTime();
+    }
+}
+
 bool BufferQueueLayer::framePresentTimeIsCurrent(nsecs_t expectedPresentTime) const {
     if (!hasFrameUpdate() || isRemovedFromCurrentState()) {
         return true;
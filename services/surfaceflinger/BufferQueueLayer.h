@@ -62,6 +62,7 @@ public:
 public:
     bool fenceHasSignaled() const override;
     bool framePresentTimeIsCurrent(nsecs_t expectedPresentTime) const override;
+    void prefetchFenceStatus() override;
 
 private:
     uint64_t getFrameNumber(nsecs_t expectedPresentTime) const override;
@@ -426,8 +426,10 @@ bool BufferStateLayer::fenceHasSignaled() const {
         return true;
     }
 
-    const bool fenceSignaled =
-            getDrawingState().acquireFence->getStatus() == Fence::Status::Signaled;
+    const sp<Fence>& acquireFence = getDrawingState().acquireFence;
+    const bool fenceSignaled = acquireFence == mSignaledAcquireFence ||
+            acquireFence->getStatus() == Fence::Status::Signaled;
+    mSignaledAcquireFence = nullptr;
     if (!fenceSignaled) {
         mFlinger->mTimeStats->incrementLatchSkipped(getSequence(),
                                                     TimeStats::LatchSkipReason::LateAcquire);
@@ -436,6 +438,13 @@ bool BufferStateLayer::fenceHasSignaled() const {
     return fenceSignaled;
 }
 
+void BufferStateLayer::prefetchFenceStatus() {
+    const sp<Fence>& acquireFence = getDrawingState().acquireFence;
+    if (acquireFence != nullptr && acquireFence->getStatus() == Fence::Status::Signaled) {
+        mSignaledAcquireFence = acquireFence;
+    }
+}
+
 bool BufferStateLayer::framePresentTimeIsCurrent(nsecs_t expectedPresentTime) const {
     if (!hasFrameUpdate() || isRemovedFromCurrentState()) {
         return true;
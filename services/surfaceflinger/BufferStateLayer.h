@@ -87,6 +87,7 @@ public:
     // Override to ignore legacy layer state properties that are not used by BufferStateLayer
     bool setSize(uint32_t /*w*/, uint32_t /*h*/) override { return false; }
     bool setPosition(float /*x*/, float /*y*/) override { return false; }
+    void setCursorPosition(float /*x*/, float /*y*/) override {}
     bool setTransparentRegionHint(const Region& transparent) override;
     bool setMatrix(const layer_state_t::matrix22_t& /*matrix*/,
                    bool /*allowNonRectPreservingTransforms*/) override {
@@ -111,6 +112,7 @@ public:
     bool fenceHasSignaled() const override;
     bool framePresentTimeIsCurrent(nsecs_t expectedPresentTime) const override;
     bool onPreComposition(nsecs_t refreshStartTime) override;
+    void prefetchFenceStatus() override;
 
 protected:
     void gatherBufferInfo() override;
@@ -159,6 +161,9 @@ private:
     uint64_t mPreviousReleasedFrameNumber = 0;
 
     mutable bool mCurrentStateModified = false;
+    // The drawing acquire fence, once prefetchFenceStatus() has found it signaled. Cleared by
+    // the next fenceHasSignaled().
+    mutable sp<Fence> mSignaledAcquireFence;
     bool mReleasePreviousBuffer = false;
     nsecs_t mCallbackHandleAcquireTime = -1;
 
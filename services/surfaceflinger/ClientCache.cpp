@@ -19,8 +19,12 @@
 #define LOG_TAG "ClientCache"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <algorithm>
 #include <cinttypes>
 
+#include <android-base/stringprintf.h>
+#include <ui/PixelFormat.h>
+
 #include "ClientCache.h"
 
 namespace android {
@@ -29,6 +33,17 @@ ANDROID_SINGLETON_STATIC_INSTANCE(ClientCache);
 
 ClientCache::ClientCache() : mDeathRecipient(new CacheDeathRecipient) {}
 
+namespace {
+
+// Formats without a fixed pixel size, such as YUV, are counted at 4 bytes per pixel.
+size_t getBufferSize(const sp<GraphicBuffer>& buffer) {
+    const uint32_t bpp = bytesPerPixel(buffer->getPixelFormat());
+    return static_cast<size_t>(buffer->getStride()) * buffer->getHeight() *
+            std::max(buffer->getLayerCount(), 1u) * (bpp ? bpp : 4);
+}
+
+} // namespace
+
 bool ClientCache::getBuffer(const client_cache_t& cacheId,
                             ClientCacheBuffer** outClientCacheBuffer) {
     auto& [processToken, id] = cacheId;
@@ -55,6 +70,80 @@ bool ClientCache::getBuffer(const client_cache_t& cacheId,
     return true;
 }
 
+size_t ClientCache::getProcessSizeLocked(const wp<IBinder>& processToken) {
+    size_t size = 0;
+    auto it = mBuffers.find(processToken);
+    if (it != mBuffers.end()) {
+        for (const auto& [id, buf] : it->second.second) {
+            size += buf.size;
+        }
+    }
+    return size;
+}
+
+bool ClientCache::evictLeastRecentlyUsedLocked(const wp<IBinder>& processToken,
+                                               const client_cache_t& keepCacheId,
+                                               ErasedBuffers& outErased) {
+    auto lruProcess = mBuffers.end();
+    uint64_t lruId = 0;
+    uint64_t lruLastUsed = UINT64_MAX;
+    for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
+        if (processToken != nullptr && it->first != processToken) {
+            continue;
+        }
+        for (const auto& [id, buf] : it->second.second) {
+            if (it->first == keepCacheId.token && id == keepCacheId.id) {
+                continue;
+            }
+            if (buf.lastUsed < lruLastUsed) {
+                lruProcess = it;
+                lruId = id;
+                lruLastUsed = buf.lastUsed;
+            }
+        }
+    }
+    if (lruProcess == mBuffers.end()) {
+        return false;
+    }
+
+    auto& processBuffers = lruProcess->second.second;
+    auto bufItr = processBuffers.find(lruId);
+    const client_cache_t cacheId = {lruProcess->first, lruId};
+    for (auto& recipient : bufItr->second.recipients) {
+        sp<ErasedRecipient> erasedRecipient = recipient.promote();
+        if (erasedRecipient) {
+            outErased.emplace_back(erasedRecipient, cacheId);
+        }
+    }
+    ALOGV("evicting buffer %" PRIu64 " (%zu bytes)", lruId, bufItr->second.size);
+    mTotalSize -= bufItr->second.size;
+    mEvictedCount++;
+    processBuffers.erase(bufItr);
+    return true;
+}
+
+void ClientCache::enforceBudgetLocked(const client_cache_t& addedCacheId,
+                                      ErasedBuffers& outErased) {
+    if (mProcessBudget > 0) {
+        size_t processSize = getProcessSizeLocked(addedCacheId.token);
+        while (processSize > mProcessBudget) {
+            const size_t sizeBefore = mTotalSize;
+            if (!evictLeastRecentlyUsedLocked(addedCacheId.token, addedCacheId, outErased)) {
+                break;
+            }
+            processSize -= sizeBefore - mTotalSize;
+        }
+    }
+
+    if (mTotalBudget > 0) {
+        while (mTotalSize > mTotalBudget) {
+            if (!evictLeastRecentlyUsedLocked(nullptr, addedCacheId, outErased)) {
+                break;
+            }
+        }
+    }
+}
+
 bool ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer) {
     auto& [processToken, id] = cacheId;
     if (processToken == nullptr) {
@@ -67,7 +156,8 @@ bool ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& bu
         return false;
     }
 
-    std::lock_guard lock(mMutex);
+    ErasedBuffers pendingErase;
+    std::unique_lock lock(mMutex);
     sp<IBinder> token;
 
     // If this is a new process token, set a death recipient. If the client process dies, we will
@@ -100,7 +190,19 @@ bool ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& bu
         return false;
     }
 
-    processBuffers[id].buffer = buffer;
+    ClientCacheBuffer& buf = processBuffers[id];
+    mTotalSize -= buf.size;
+    buf.buffer = buffer;
+    buf.size = getBufferSize(buffer);
+    buf.lastUsed = ++mUseCount;
+    mTotalSize += buf.size;
+
+    enforceBudgetLocked(cacheId, pendingErase);
+    lock.unlock();
+
+    for (auto& [recipient, erasedCacheId] : pendingErase) {
+        recipient->bufferErased(erasedCacheId);
+    }
     return true;
 }
 
@@ -122,6 +224,7 @@ void ClientCache::erase(const client_cache_t& cacheId) {
             }
         }
 
+        mTotalSize -= buf->size;
         mBuffers[processToken].second.erase(id);
     }
 
@@ -139,6 +242,7 @@ sp<GraphicBuffer> ClientCache::get(const client_cache_t& cacheId) {
         return nullptr;
     }
 
+    buf->lastUsed = ++mUseCount;
     return buf->buffer;
 }
 
@@ -169,7 +273,7 @@ void ClientCache::unregisterErasedRecipient(const client_cache_t& cacheId,
 }
 
 void ClientCache::removeProcess(const wp<IBinder>& processToken) {
-    std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    ErasedBuffers pendingErase;
     {
         if (processToken == nullptr) {
             ALOGE("failed to remove process, invalid (nullptr) process token");
@@ -183,6 +287,7 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
         }
 
         for (auto& [id, clientCacheBuffer] : itr->second.second) {
+            mTotalSize -= clientCacheBuffer.size;
             client_cache_t cacheId = {processToken, id};
             for (auto& recipient : clientCacheBuffer.recipients) {
                 sp<ErasedRecipient> erasedRecipient = recipient.promote();
@@ -199,6 +304,29 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
     }
 }
 
+void ClientCache::setBudget(size_t processBudgetBytes, size_t totalBudgetBytes) {
+    std::lock_guard lock(mMutex);
+    mProcessBudget = processBudgetBytes;
+    mTotalBudget = totalBudgetBytes;
+}
+
+void ClientCache::dump(std::string& result) {
+    using base::StringAppendF;
+    std::lock_guard lock(mMutex);
+
+    StringAppendF(&result, "ClientCache: %zu processes, %.2f MiB", mBuffers.size(),
+                  static_cast<float>(mTotalSize) / 1048576.0f);
+    if (mTotalBudget > 0) {
+        StringAppendF(&result, " of %.2f MiB", static_cast<float>(mTotalBudget) / 1048576.0f);
+    }
+    StringAppendF(&result, ", %" PRIu64 " buffers evicted\n", mEvictedCount);
+    for (const auto& [processToken, process] : mBuffers) {
+        StringAppendF(&result, "  process %p: %zu buffers, %.2f MiB\n",
+                      processToken.unsafe_get(), process.second.size(),
+                      static_cast<float>(getProcessSizeLocked(processToken)) / 1048576.0f);
+    }
+}
+
 void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
     ClientCache::getInstance().removeProcess(who);
 }
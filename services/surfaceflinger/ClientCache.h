@@ -26,7 +26,9 @@
 #include <map>
 #include <mutex>
 #include <set>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #define BUFFER_CACHE_MAX_SIZE 64
 
@@ -43,6 +45,17 @@ public:
 
     void removeProcess(const wp<IBinder>& processToken);
 
+    // Limits the memory held by the cache, per process and in total. When adding a buffer goes
+    // over a budget, the least recently used buffers are erased until it fits again, notifying
+    // their erased recipients. The buffer being added is never erased. A budget of 0 means no
+    // limit.
+    //
+    // Clients are not told about buffers erased this way, so budgets should leave room for what
+    // well-behaved clients cache.
+    void setBudget(size_t processBudgetBytes, size_t totalBudgetBytes);
+
+    void dump(std::string& result);
+
     class ErasedRecipient : public virtual RefBase {
     public:
         virtual void bufferErased(const client_cache_t& clientCacheId) = 0;
@@ -59,7 +72,12 @@ private:
     struct ClientCacheBuffer {
         sp<GraphicBuffer> buffer;
         std::set<wp<ErasedRecipient>> recipients;
+        size_t size = 0;
+        // Value of mUseCount when the buffer was last added or retrieved.
+        uint64_t lastUsed = 0;
     };
+
+    using ErasedBuffers = std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>>;
     std::map<wp<IBinder> /*caching process*/,
              std::pair<sp<IBinder> /*strong ref to caching process*/,
                        std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>
@@ -72,8 +90,24 @@ private:
 
     sp<CacheDeathRecipient> mDeathRecipient;
 
+    size_t mProcessBudget GUARDED_BY(mMutex) = 0;
+    size_t mTotalBudget GUARDED_BY(mMutex) = 0;
+    size_t mTotalSize GUARDED_BY(mMutex) = 0;
+    uint64_t mUseCount GUARDED_BY(mMutex) = 0;
+    uint64_t mEvictedCount GUARDED_BY(mMutex) = 0;
+
     bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
             REQUIRES(mMutex);
+
+    size_t getProcessSizeLocked(const wp<IBinder>& processToken) REQUIRES(mMutex);
+    // Erases the least recently used buffer of the given process, or of any process if
+    // processToken is null, other than the one identified by keepCacheId. Returns false if there
+    // was no such buffer.
+    bool evictLeastRecentlyUsedLocked(const wp<IBinder>& processToken,
+                                      const client_cache_t& keepCacheId,
+                                      ErasedBuffers& outErased) REQUIRES(mMutex);
+    void enforceBudgetLocked(const client_cache_t& addedCacheId, ErasedBuffers& outErased)
+            REQUIRES(mMutex);
 };
 
 }; // namespace android
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <optional>
 #include <vector>
 
@@ -31,6 +32,9 @@ namespace android::compositionengine {
 using Layers = std::vector<sp<compositionengine::LayerFE>>;
 using Outputs = std::vector<std::shared_ptr<compositionengine::Output>>;
 
+// Runs work(i) for each i in [0, count), possibly concurrently, and returns once all are done.
+using ParallelRunner = std::function<void(size_t count, const std::function<void(size_t)>& work)>;
+
 /**
  * A parameter object for refreshing a set of outputs
  */
@@ -79,6 +83,9 @@ struct CompositionRefreshArgs {
 
     // If set, causes the dirty regions to flash with the delay
     std::optional<std::chrono::microseconds> devOptFlashDirtyRegionsDelay;
+
+    // If set, used to prepare the outputs concurrently when their geometry is recomputed
+    ParallelRunner runInParallel;
 };
 
 } // namespace android::compositionengine
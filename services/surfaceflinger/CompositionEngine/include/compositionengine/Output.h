@@ -27,6 +27,7 @@
 #include <compositionengine/LayerFE.h>
 #include <renderengine/LayerSettings.h>
 #include <ui/Fence.h>
+#include <ui/GraphicBuffer.h>
 #include <ui/GraphicTypes.h>
 #include <ui/Region.h>
 #include <ui/Transform.h>
@@ -251,6 +252,24 @@ public:
     // Latches the front-end layer state for each output layer
     virtual void updateLayerStateFromFE(const CompositionRefreshArgs&) const = 0;
 
+    // A client target buffer, and the fence signaled once rendering into it is done.
+    struct ClientTarget {
+        sp<GraphicBuffer> buffer;
+        sp<Fence> readyFence;
+    };
+
+    // Returns true if this output shows the same layers as the other output, with the same
+    // projection, so that a client target composed for one is also valid for the other.
+    virtual bool showsSameContentAs(const Output&) const = 0;
+
+    // Sets the output this output mirrors this frame, or nullptr. When both outputs are fully
+    // client composed, this output copies the client target of the source, using the given
+    // texture, rather than composing its layers again. The source must be presented first.
+    virtual void setMirrorSource(const Output*, uint32_t textureName) = 0;
+
+    // Returns the client target presented this frame, if all its layers were client composed
+    virtual std::optional<ClientTarget> getComposedClientTarget() const = 0;
+
 protected:
     virtual void setDisplayColorProfile(std::unique_ptr<DisplayColorProfile>) = 0;
     virtual void setRenderSurface(std::unique_ptr<RenderSurface>) = 0;
@@ -280,6 +299,12 @@ protected:
             std::vector<LayerFE::LayerSettings>& clientCompositionLayers) = 0;
     virtual void setExpensiveRenderingExpected(bool enabled) = 0;
     virtual void cacheClientCompositionRequests(uint32_t cacheSize) = 0;
+    // Flattens runs of layers unchanged for staticFrameThreshold frames into a single buffer.
+    // Flattening is disabled if the threshold is 0.
+    virtual void flattenStaticLayers(uint32_t staticFrameThreshold) = 0;
+    // Reuses the visibility computed for layers whose geometry, and the geometry of the layers
+    // above them, did not change since the last geometry update.
+    virtual void cacheLayerVisibility(bool enabled) = 0;
 };
 
 } // namespace compositionengine
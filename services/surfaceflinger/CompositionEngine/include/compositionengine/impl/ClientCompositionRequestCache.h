@@ -18,10 +18,12 @@
 
 #include <cstdint>
 #include <deque>
+#include <optional>
 
 #include <compositionengine/LayerFE.h>
 #include <renderengine/DisplaySettings.h>
 #include <renderengine/LayerSettings.h>
+#include <ui/Region.h>
 
 namespace android {
 
@@ -37,12 +39,19 @@ namespace compositionengine::impl {
 // the composition request. We need to make sure the request, including the order of the
 // layers, do not change from call to call. The snapshot removes strong references to the
 // client buffer id so we don't extend the lifetime of the buffer by storing it in the cache.
+//
+// If the request only differs from what was rendered into the buffer by some of its layers, the
+// buffer can still be reused by redrawing only the part of it those layers cover.
 class ClientCompositionRequestCache {
 public:
     explicit ClientCompositionRequestCache(uint32_t cacheSize) : mMaxCacheSize(cacheSize){};
     ~ClientCompositionRequestCache() = default;
     bool exists(uint64_t bufferId, const renderengine::DisplaySettings& display,
                 const std::vector<LayerFE::LayerSettings>& layerSettings) const;
+    // Returns the region, in layer-stack space, that needs to be redrawn for the buffer to hold
+    // the result of the request. Returns nullopt if the whole buffer needs to be redrawn.
+    std::optional<Region> getDamage(uint64_t bufferId, const renderengine::DisplaySettings& display,
+                                    const std::vector<LayerFE::LayerSettings>& layerSettings) const;
     void add(uint64_t bufferId, const renderengine::DisplaySettings& display,
              const std::vector<LayerFE::LayerSettings>& layerSettings);
     void remove(uint64_t bufferId);
@@ -56,6 +65,9 @@ private:
                                  const std::vector<LayerFE::LayerSettings>& _layerSettings);
         bool equals(const renderengine::DisplaySettings& _display,
                     const std::vector<LayerFE::LayerSettings>& _layerSettings) const;
+        std::optional<Region> getDamage(
+                const renderengine::DisplaySettings& _display,
+                const std::vector<LayerFE::LayerSettings>& _layerSettings) const;
     };
 
     // Cache of requests, keyed by corresponding GraphicBuffer ID.
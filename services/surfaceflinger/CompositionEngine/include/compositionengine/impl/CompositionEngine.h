@@ -17,6 +17,10 @@
 #pragma once
 
 #include <compositionengine/CompositionEngine.h>
+#include <compositionengine/LayerFE.h>
+
+#include <unordered_set>
+#include <vector>
 
 namespace android::compositionengine::impl {
 
@@ -57,11 +61,26 @@ public:
     void setNeedsAnotherUpdateForTest(bool);
 
 private:
+    // Prepares each output on its own thread, after latching the geometry of all layers.
+    void prepareInParallel(CompositionRefreshArgs&, LayerFESet& latchedLayers);
+
+    // Pairs each output with an earlier output showing the same content, if any, so that it can
+    // copy the client target of that output rather than compose the same layers again.
+    // Returns the outputs used as a mirror source.
+    std::vector<const compositionengine::Output*> assignMirrorSources(CompositionRefreshArgs&);
+    // Forgets the source client targets RenderEngine may hold images for.
+    void releaseMirroredBuffers();
+
     std::unique_ptr<HWComposer> mHwComposer;
     std::unique_ptr<renderengine::RenderEngine> mRenderEngine;
     std::shared_ptr<TimeStats> mTimeStats;
     bool mNeedsAnotherUpdate = false;
     nsecs_t mRefreshStartTime = 0;
+
+    // The texture used by outputs to sample the client target they mirror, and the ids of all
+    // the client targets sampled through it so far.
+    uint32_t mMirrorTextureName = 0;
+    std::unordered_set<uint64_t> mMirroredBufferIds;
 };
 
 std::unique_ptr<compositionengine::CompositionEngine> createCompositionEngine();
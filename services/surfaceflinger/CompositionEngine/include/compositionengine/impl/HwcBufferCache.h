@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -45,9 +46,14 @@ namespace compositionengine::impl {
 //
 // To be able to find out whether a buffer is already in the HAL's cache, we
 // use HWComposerBufferCache to mirror the cache in SF.
+//
+// Buffers with a BufferQueue slot use that slot. Buffers without one, such as
+// those set directly on a BufferStateLayer, are assigned one of the first
+// lruSlotCount slots by buffer id, replacing the least recently used buffer
+// once they are all taken.
 class HwcBufferCache {
 public:
-    HwcBufferCache();
+    explicit HwcBufferCache(uint32_t lruSlotCount = BufferQueue::NUM_BUFFER_SLOTS);
     // Given a buffer, return the HWC cache slot and
     // buffer to be sent to HWC.
     //
@@ -56,11 +62,29 @@ public:
     void getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uint32_t* outSlot,
                       sp<GraphicBuffer>* outBuffer);
 
+    // The number of buffers found in the HWC cache, the number of buffers sent
+    // to HWC, and how many of those replaced another buffer in their slot.
+    uint64_t getHitCount() const { return mHitCount; }
+    uint64_t getSendCount() const { return mSendCount; }
+    uint64_t getEvictionCount() const { return mEvictionCount; }
+
+    void dump(std::string& out) const;
+
 private:
-    // an array where the index corresponds to a slot and the value corresponds to a (counter,
-    // buffer) pair. "counter" is a unique value that indicates the last time this slot was updated
-    // or used and allows us to keep track of the least-recently used buffer.
+    uint32_t getLeastRecentlyUsedSlot(uint64_t bufferId) const;
+
+    const uint32_t mLruSlotCount;
+
+    // Indexed by slot, the buffer HWC has cached in the slot, its id, and the
+    // value of mCounter when the slot was last used.
     wp<GraphicBuffer> mBuffers[BufferQueue::NUM_BUFFER_SLOTS];
+    uint64_t mBufferIds[BufferQueue::NUM_BUFFER_SLOTS] = {};
+    uint64_t mLastUsed[BufferQueue::NUM_BUFFER_SLOTS] = {};
+    uint64_t mCounter = 0;
+
+    uint64_t mHitCount = 0;
+    uint64_t mSendCount = 0;
+    uint64_t mEvictionCount = 0;
 };
 
 } // namespace compositionengine::impl
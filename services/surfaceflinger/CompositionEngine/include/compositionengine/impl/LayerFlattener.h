@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <compositionengine/LayerFE.h>
+#include <compositionengine/LayerFECompositionState.h>
+#include <math/vec4.h>
+#include <ui/Fence.h>
+#include <ui/GraphicTypes.h>
+#include <ui/Rect.h>
+
+namespace android {
+
+namespace renderengine {
+class RenderEngine;
+} // namespace renderengine
+
+namespace compositionengine {
+
+class Output;
+class OutputLayer;
+
+namespace impl {
+
+// Flattens runs of layers which have not changed for a number of frames into a single buffer,
+// rendered once with RenderEngine. The first layer of the run presents that buffer to HWC, and
+// the other layers of the run are made fully transparent, so that HWC has less layers to blend
+// and is less likely to fall back to client composition on mostly static content.
+//
+// Any geometry change, or any change in the buffer or content of a layer of the run, drops the
+// flattened buffer. The run is flattened again once its layers have been static long enough.
+class LayerFlattener {
+public:
+    explicit LayerFlattener(uint32_t staticFrameThreshold);
+    ~LayerFlattener();
+
+    // Updates which layers of the output are static, renders the longest static run if it is
+    // not already flattened, and sets the override state of the output layers accordingly.
+    // Returns true if the set of overridden layers changed, in which case their geometry needs
+    // to be written to HWC again.
+    bool update(compositionengine::Output&, renderengine::RenderEngine&, bool geometryChanged);
+
+    void dump(std::string&) const;
+
+private:
+    // The state of a layer that, if changed, invalidates the flattened buffer.
+    struct LayerSnapshot {
+        bool flattenable{false};
+        uint64_t bufferId{0};
+        sp<Fence> acquireFence;
+        hal::Composition compositionType{hal::Composition::INVALID};
+        float alpha{1.f};
+        half4 color;
+
+        // The number of frames this layer has been unchanged for.
+        uint32_t staticFrameCount{0};
+
+        bool hasSameContent(const LayerSnapshot& other) const;
+    };
+
+    static LayerSnapshot takeSnapshot(const compositionengine::OutputLayer&);
+
+    // Renders the layers in [begin, end) into a new buffer. Returns false on failure.
+    bool render(compositionengine::Output&, renderengine::RenderEngine&,
+                const std::vector<compositionengine::OutputLayer*>& layers, size_t begin,
+                size_t end);
+    void clear();
+
+    // Runs shorter than this are not worth the extra render pass.
+    static constexpr size_t kMinLayersToFlatten = 2;
+
+    const uint32_t mStaticFrameThreshold;
+
+    std::unordered_map<const LayerFE*, LayerSnapshot> mSnapshots;
+
+    // The run of layers currently flattened into mBuffer, in Z order.
+    std::vector<const LayerFE*> mFlattenedLayers;
+    sp<GraphicBuffer> mBuffer;
+    sp<Fence> mAcquireFence;
+    Rect mDisplayFrame;
+    ui::Dataspace mDataspace{ui::Dataspace::UNKNOWN};
+    // True until the flattened buffer has been given to HWC once.
+    bool mBufferIsNew{false};
+
+    // Debugging
+    uint32_t mRenderCount{0};
+    uint32_t mFlattenedFrameCount{0};
+};
+
+} // namespace impl
+} // namespace compositionengine
+} // namespace android
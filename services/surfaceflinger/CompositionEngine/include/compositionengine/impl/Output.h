@@ -19,6 +19,8 @@
 #include <compositionengine/CompositionEngine.h>
 #include <compositionengine/Output.h>
 #include <compositionengine/impl/ClientCompositionRequestCache.h>
+#include <compositionengine/impl/LayerFlattener.h>
+#include <compositionengine/impl/VisibilityCache.h>
 #include <compositionengine/impl/OutputCompositionState.h>
 #include <renderengine/DisplaySettings.h>
 #include <renderengine/LayerSettings.h>
@@ -77,6 +79,9 @@ public:
     void setReleasedLayers(const compositionengine::CompositionRefreshArgs&) override;
 
     void updateLayerStateFromFE(const CompositionRefreshArgs&) const override;
+    bool showsSameContentAs(const compositionengine::Output&) const override;
+    void setMirrorSource(const compositionengine::Output*, uint32_t textureName) override;
+    std::optional<ClientTarget> getComposedClientTarget() const override;
     void updateAndWriteCompositionState(const compositionengine::CompositionRefreshArgs&) override;
     void updateColorProfile(const compositionengine::CompositionRefreshArgs&) override;
     void beginFrame() override;
@@ -87,6 +92,8 @@ public:
             const Region&, const compositionengine::CompositionRefreshArgs& refreshArgs) override;
     void postFramebuffer() override;
     void cacheClientCompositionRequests(uint32_t) override;
+    void flattenStaticLayers(uint32_t) override;
+    void cacheLayerVisibility(bool) override;
 
     // Testing
     const ReleasedLayers& getReleasedLayersForTest() const;
@@ -117,10 +124,15 @@ protected:
 
 private:
     void dirtyEntireOutput();
+    bool reuseCachedVisibility(const sp<compositionengine::LayerFE>&,
+                               const LayerFECompositionState&, const Rect& footprint,
+                               compositionengine::Output::CoverageState&);
     compositionengine::OutputLayer* findLayerRequestingBackgroundComposition() const;
     ui::Dataspace getBestDataspace(ui::Dataspace*, bool*) const;
     compositionengine::Output::ColorProfile pickColorProfile(
             const compositionengine::CompositionRefreshArgs&) const;
+    std::optional<base::unique_fd> copyMirrorSourceClientTarget(const sp<GraphicBuffer>&,
+                                                                base::unique_fd& bufferFence);
 
     std::string mName;
 
@@ -130,6 +142,11 @@ private:
     ReleasedLayers mReleasedLayers;
     OutputLayer* mLayerRequestingBackgroundBlur = nullptr;
     std::unique_ptr<ClientCompositionRequestCache> mClientCompositionRequestCache;
+    std::unique_ptr<LayerFlattener> mLayerFlattener;
+    std::unique_ptr<VisibilityCache> mVisibilityCache;
+    const compositionengine::Output* mMirrorSource = nullptr;
+    uint32_t mMirrorTextureName = 0;
+    std::optional<ClientTarget> mComposedClientTarget;
 };
 
 // This template factory function standardizes the implementation details of the
@@ -57,6 +57,10 @@ struct OutputCompositionState {
     // If true, the current frame reused the buffer from a previous client composition
     bool reusedClientComposition{false};
 
+    // If true, the current frame only redrew the damaged part of a buffer from a previous client
+    // composition
+    bool partialClientComposition{false};
+
     // If true, this output displays layers that are internal-only
     bool layerStackInternal{false};
 
@@ -31,6 +31,9 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
 
+#include <ui/Fence.h>
+#include <ui/GraphicBuffer.h>
+
 #include "DisplayHardware/ComposerHal.h"
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -83,6 +86,25 @@ struct OutputLayerCompositionState {
     // The Z order index of this layer on this output
     uint32_t z{0};
 
+    // Set by the LayerFlattener when this layer is part of a run of static layers that were
+    // flattened into a single buffer. The first layer of the run presents that buffer instead of
+    // its own content, and the other layers of the run are skipped.
+    struct OverrideInfo {
+        // The flattened buffer, only set on the first layer of the run
+        sp<GraphicBuffer> buffer;
+        sp<Fence> acquireFence;
+
+        // The portion of the output covered by the flattened buffer, in output space
+        Rect displayFrame;
+        ui::Dataspace dataspace{ui::Dataspace::UNKNOWN};
+        Region damageRegion;
+
+        // If true, the content of this layer is already in the buffer of a layer below it
+        bool skip{false};
+    };
+
+    OverrideInfo overrideInfo;
+
     /*
      * HWC state
      */
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <compositionengine/LayerFE.h>
+#include <compositionengine/LayerFECompositionState.h>
+#include <ui/FloatRect.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <ui/Transform.h>
+
+namespace android::compositionengine::impl {
+
+struct OutputCompositionState;
+
+// Remembers the visibility computed for each layer of an output in the previous geometry update,
+// so that layers whose own geometry and whose part of the layer stack above did not change can
+// reuse it instead of computing it again.
+//
+// What a layer contributes to the coverage of the layers below it only depends on its own
+// geometry and on the layers above it. The cache tracks the part of the output where that
+// coverage may have changed since the previous update: the old and new footprints of layers
+// which were added, removed or changed contribution. A layer is only recomputed if it changed,
+// or if its footprint intersects that damage, so moving a small window only recomputes the
+// layers under it. Reordered layers fall back to recomputing the rest of the stack.
+class VisibilityCache {
+public:
+    // The visibility of a layer, all in layer stack space.
+    struct LayerVisibility {
+        // The area the layer covers, including its shadow
+        Rect footprint;
+        // The area the layer adds to the opaque coverage of the layers below it
+        Rect opaque;
+        // Whether the layer had an output layer
+        bool visible{false};
+        // The dirty region the layer yields when it is recomputed without any change
+        Region dirtyRegion;
+    };
+
+    // Must bracket the visibility computation of every geometry update of the output.
+    void beginFrame(const OutputCompositionState&);
+    void endFrame();
+
+    // Called front to back for every layer which covers part of the output, before its
+    // visibility is computed. Returns the visibility the layer had in the previous update if it
+    // is still valid. Unless that visibility is then passed to reuse(), the visibility computed
+    // for the layer must be passed to record().
+    const LayerVisibility* lookUp(const sp<LayerFE>&, const LayerFECompositionState&,
+                                  const Rect& footprint);
+    // Keeps the visibility returned by the last lookUp()
+    void reuse();
+    // Records the visibility computed for the layer passed to the last lookUp()
+    void record(const sp<LayerFE>&, const LayerFECompositionState&, LayerVisibility);
+
+    void dump(std::string&) const;
+
+private:
+    // The geometry a layer's visibility is computed from.
+    struct LayerGeometry {
+        explicit LayerGeometry(const LayerFECompositionState&);
+        bool operator==(const LayerFECompositionState&) const;
+
+        ui::Transform transform;
+        FloatRect bounds;
+        float shadowRadius;
+        bool isOpaque;
+        Region transparentRegionHint;
+    };
+
+    struct Entry {
+        wp<LayerFE> layerFE;
+        LayerGeometry geometry;
+        LayerVisibility visibility;
+    };
+
+    // The output geometry the cached visibility was computed for.
+    struct OutputGeometry {
+        ui::Transform transform;
+        Rect bounds;
+        Rect viewport;
+        uint32_t layerStackId{~0u};
+        bool layerStackInternal{false};
+
+        bool operator==(const OutputCompositionState&) const;
+    };
+
+    static constexpr size_t kNoEntry = SIZE_MAX;
+
+    OutputGeometry mOutputGeometry;
+
+    // The entries of the previous update, front to back, and their index by layer.
+    std::vector<Entry> mPreviousEntries;
+    std::unordered_map<const LayerFE*, size_t> mPreviousIndices;
+    // The entries of the current update, front to back.
+    std::vector<Entry> mEntries;
+
+    // The previous entry of the layer passed to the last lookUp(), if any.
+    size_t mLookedUpIndex{kNoEntry};
+    // Previous entries before this one were either looked up or skipped.
+    size_t mNextPreviousIndex{0};
+    // Set once a layer was found above a layer it was below in the previous update.
+    bool mReordered{false};
+    // Where the coverage of the layers above may differ from the previous update.
+    Region mDamage;
+
+    // Debugging
+    uint64_t mReusedLayerCount{0};
+    uint64_t mRecomputedLayerCount{0};
+};
+
+} // namespace android::compositionengine::impl
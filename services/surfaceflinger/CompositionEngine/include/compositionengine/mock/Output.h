@@ -86,6 +86,9 @@ public:
     MOCK_METHOD1(setReleasedLayers, void(const compositionengine::CompositionRefreshArgs&));
 
     MOCK_CONST_METHOD1(updateLayerStateFromFE, void(const CompositionRefreshArgs&));
+    MOCK_CONST_METHOD1(showsSameContentAs, bool(const compositionengine::Output&));
+    MOCK_METHOD2(setMirrorSource, void(const compositionengine::Output*, uint32_t));
+    MOCK_CONST_METHOD0(getComposedClientTarget, std::optional<ClientTarget>());
     MOCK_METHOD1(updateAndWriteCompositionState, void(const CompositionRefreshArgs&));
     MOCK_METHOD1(updateColorProfile, void(const compositionengine::CompositionRefreshArgs&));
 
@@ -113,6 +116,8 @@ public:
                  void(const Region&, std::vector<LayerFE::LayerSettings>&));
     MOCK_METHOD1(setExpensiveRenderingExpected, void(bool));
     MOCK_METHOD1(cacheClientCompositionRequests, void(uint32_t));
+    MOCK_METHOD1(flattenStaticLayers, void(uint32_t));
+    MOCK_METHOD1(cacheLayerVisibility, void(bool));
 };
 
 } // namespace android::compositionengine::mock
@@ -15,6 +15,7 @@
  */
 
 #include <algorithm>
+#include <cmath>
 
 #include <compositionengine/impl/ClientCompositionRequestCache.h>
 #include <renderengine/DisplaySettings.h>
@@ -66,6 +67,30 @@ bool layerSettingsAreEqual(const LayerFE::LayerSettings& lhs, const LayerFE::Lay
             equalIgnoringBuffer(lhs, rhs);
 }
 
+// Returns the bounds of what the layer draws, in layer-stack space.
+Rect getLayerStackBounds(const renderengine::Geometry& geometry) {
+    const FloatRect& bounds = geometry.boundaries;
+    const vec4 corners[] = {
+            geometry.positionTransform * vec4(bounds.left, bounds.top, 0.f, 1.f),
+            geometry.positionTransform * vec4(bounds.right, bounds.top, 0.f, 1.f),
+            geometry.positionTransform * vec4(bounds.left, bounds.bottom, 0.f, 1.f),
+            geometry.positionTransform * vec4(bounds.right, bounds.bottom, 0.f, 1.f),
+    };
+
+    float left = corners[0].x;
+    float top = corners[0].y;
+    float right = corners[0].x;
+    float bottom = corners[0].y;
+    for (const vec4& corner : corners) {
+        left = std::min(left, corner.x);
+        top = std::min(top, corner.y);
+        right = std::max(right, corner.x);
+        bottom = std::max(bottom, corner.y);
+    }
+    return Rect(static_cast<int32_t>(std::floor(left)), static_cast<int32_t>(std::floor(top)),
+                static_cast<int32_t>(std::ceil(right)), static_cast<int32_t>(std::ceil(bottom)));
+}
+
 } // namespace
 
 ClientCompositionRequestCache::ClientCompositionRequest::ClientCompositionRequest(
@@ -86,6 +111,34 @@ bool ClientCompositionRequestCache::ClientCompositionRequest::equals(
                        newLayerSettings.end(), layerSettingsAreEqual);
 }
 
+std::optional<Region> ClientCompositionRequestCache::ClientCompositionRequest::getDamage(
+        const renderengine::DisplaySettings& newDisplay,
+        const std::vector<LayerFE::LayerSettings>& newLayerSettings) const {
+    if (!(newDisplay == display) || newLayerSettings.size() != layerSettings.size()) {
+        return std::nullopt;
+    }
+
+    Region damage;
+    for (size_t i = 0; i < layerSettings.size(); i++) {
+        const auto& cached = layerSettings[i];
+        const auto& current = newLayerSettings[i];
+        // A blur depends on everything below it, wherever it changed.
+        if (current.backgroundBlurRadius > 0) {
+            return std::nullopt;
+        }
+        if (layerSettingsAreEqual(cached, current)) {
+            continue;
+        }
+        // Shadows are drawn outside of the layer bounds.
+        if (cached.shadow.length > 0.f || current.shadow.length > 0.f) {
+            return std::nullopt;
+        }
+        damage.orSelf(getLayerStackBounds(cached.geometry));
+        damage.orSelf(getLayerStackBounds(current.geometry));
+    }
+    return damage;
+}
+
 bool ClientCompositionRequestCache::exists(
         uint64_t bufferId, const renderengine::DisplaySettings& display,
         const std::vector<LayerFE::LayerSettings>& layerSettings) const {
@@ -97,6 +150,17 @@ bool ClientCompositionRequestCache::exists(
     return false;
 }
 
+std::optional<Region> ClientCompositionRequestCache::getDamage(
+        uint64_t bufferId, const renderengine::DisplaySettings& display,
+        const std::vector<LayerFE::LayerSettings>& layerSettings) const {
+    for (const auto& [cachedBufferId, cachedRequest] : mCache) {
+        if (cachedBufferId == bufferId) {
+            return cachedRequest.getDamage(display, layerSettings);
+        }
+    }
+    return std::nullopt;
+}
+
 void ClientCompositionRequestCache::add(uint64_t bufferId,
                                         const renderengine::DisplaySettings& display,
                                         const std::vector<LayerFE::LayerSettings>& layerSettings) {
@@ -24,6 +24,9 @@
 #include <renderengine/RenderEngine.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <numeric>
+
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
@@ -44,7 +47,12 @@ std::unique_ptr<compositionengine::CompositionEngine> createCompositionEngine()
 }
 
 CompositionEngine::CompositionEngine() = default;
-CompositionEngine::~CompositionEngine() = default;
+CompositionEngine::~CompositionEngine() {
+    if (mMirrorTextureName != 0) {
+        releaseMirroredBuffers();
+        mRenderEngine->deleteTextures(1, &mMirrorTextureName);
+    }
+}
 
 std::shared_ptr<compositionengine::Display> CompositionEngine::createDisplay(
         const DisplayCreationArgs& args) {
@@ -100,16 +108,91 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
         // needed for anything else.
         LayerFESet latchedLayers;
 
-        for (const auto& output : args.outputs) {
-            output->prepare(args, latchedLayers);
+        if (args.runInParallel && args.outputs.size() > 1 &&
+            args.updatingOutputGeometryThisFrame) {
+            prepareInParallel(args, latchedLayers);
+        } else {
+            for (const auto& output : args.outputs) {
+                output->prepare(args, latchedLayers);
+            }
         }
     }
 
     updateLayerStateFromFE(args);
 
+    const auto mirrorSources = assignMirrorSources(args);
+
     for (const auto& output : args.outputs) {
         output->present(args);
     }
+
+    if (mirrorSources.empty()) {
+        releaseMirroredBuffers();
+    }
+    for (const auto* source : mirrorSources) {
+        if (const auto clientTarget = source->getComposedClientTarget()) {
+            mMirroredBufferIds.insert(clientTarget->buffer->getId());
+        }
+    }
+}
+
+std::vector<const compositionengine::Output*> CompositionEngine::assignMirrorSources(
+        CompositionRefreshArgs& args) {
+    std::vector<const compositionengine::Output*> sources;
+    for (auto it = args.outputs.begin(); it != args.outputs.end(); ++it) {
+        const auto sourceIt = std::find_if(args.outputs.begin(), it, [&](const auto& output) {
+            return output->showsSameContentAs(**it);
+        });
+        if (sourceIt == it) {
+            (*it)->setMirrorSource(nullptr, 0);
+            continue;
+        }
+
+        if (mMirrorTextureName == 0) {
+            getRenderEngine().genTextures(1, &mMirrorTextureName);
+        }
+        (*it)->setMirrorSource(sourceIt->get(), mMirrorTextureName);
+        if (std::find(sources.begin(), sources.end(), sourceIt->get()) == sources.end()) {
+            sources.push_back(sourceIt->get());
+        }
+    }
+    return sources;
+}
+
+void CompositionEngine::releaseMirroredBuffers() {
+    for (const uint64_t bufferId : mMirroredBufferIds) {
+        mRenderEngine->unbindExternalTextureBuffer(bufferId);
+    }
+    mMirroredBufferIds.clear();
+}
+
+void CompositionEngine::prepareInParallel(CompositionRefreshArgs& args,
+                                          LayerFESet& latchedLayers) {
+    ATRACE_CALL();
+
+    // The front-end layers are shared by all outputs, so latch their geometry here rather than
+    // from the worker threads. Each output then only reads the latched state. Presenting stays
+    // serial, as RenderEngine and the HWC command buffer are shared between displays.
+    for (const auto& layer : args.layers) {
+        if (latchedLayers.insert(layer).second) {
+            layer->prepareCompositionState(LayerFE::StateSubset::BasicGeometry);
+        }
+    }
+
+    std::vector<nsecs_t> durations(args.outputs.size(), 0);
+    const nsecs_t startTime = systemTime();
+    args.runInParallel(args.outputs.size(), [&](size_t i) {
+        const nsecs_t outputStartTime = systemTime();
+        args.outputs[i]->prepare(args, latchedLayers);
+        durations[i] = systemTime() - outputStartTime;
+    });
+    const nsecs_t parallelDuration = systemTime() - startTime;
+
+    if (mTimeStats) {
+        mTimeStats->recordParallelComposition(std::accumulate(durations.begin(), durations.end(),
+                                                              nsecs_t(0)),
+                                              parallelDuration);
+    }
 }
 
 void CompositionEngine::updateCursorAsync(CompositionRefreshArgs& args) {
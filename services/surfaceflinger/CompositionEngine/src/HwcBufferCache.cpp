@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <android-base/stringprintf.h>
 #include <compositionengine/impl/HwcBufferCache.h>
 
+#include <algorithm>
+#include <cinttypes>
+
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
@@ -28,31 +32,63 @@
 
 namespace android::compositionengine::impl {
 
-HwcBufferCache::HwcBufferCache() {
+HwcBufferCache::HwcBufferCache(uint32_t lruSlotCount)
+      : mLruSlotCount(std::clamp(lruSlotCount, 1u,
+                                 static_cast<uint32_t>(BufferQueue::NUM_BUFFER_SLOTS))) {
     std::fill(std::begin(mBuffers), std::end(mBuffers), wp<GraphicBuffer>(nullptr));
 }
 
 void HwcBufferCache::getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uint32_t* outSlot,
                                   sp<GraphicBuffer>* outBuffer) {
-    // default is 0
     if (slot == BufferQueue::INVALID_BUFFER_SLOT || slot < 0 ||
         slot >= BufferQueue::NUM_BUFFER_SLOTS) {
-        *outSlot = 0;
+        // Without a BufferQueue slot, reuse the slot already holding the buffer, if any. The
+        // default for no buffer is 0.
+        *outSlot = buffer ? getLeastRecentlyUsedSlot(buffer->getId()) : 0;
     } else {
         *outSlot = static_cast<uint32_t>(slot);
     }
+    mLastUsed[*outSlot] = ++mCounter;
 
     auto& currentBuffer = mBuffers[*outSlot];
     wp<GraphicBuffer> weakCopy(buffer);
     if (currentBuffer == weakCopy) {
         // already cached in HWC, skip sending the buffer
         *outBuffer = nullptr;
+        if (buffer) {
+            mHitCount++;
+        }
     } else {
         *outBuffer = buffer;
+        if (buffer) {
+            mSendCount++;
+            if (mBufferIds[*outSlot] != 0) {
+                mEvictionCount++;
+            }
+        }
 
         // update cache
         currentBuffer = buffer;
+        mBufferIds[*outSlot] = buffer ? buffer->getId() : 0;
+    }
+}
+
+uint32_t HwcBufferCache::getLeastRecentlyUsedSlot(uint64_t bufferId) const {
+    uint32_t leastRecentlyUsedSlot = 0;
+    for (uint32_t slot = 0; slot < mLruSlotCount; slot++) {
+        if (mBufferIds[slot] == bufferId) {
+            return slot;
+        }
+        if (mLastUsed[slot] < mLastUsed[leastRecentlyUsedSlot]) {
+            leastRecentlyUsedSlot = slot;
+        }
     }
+    return leastRecentlyUsedSlot;
+}
+
+void HwcBufferCache::dump(std::string& out) const {
+    base::StringAppendF(&out, "bufferCache hits=%" PRIu64 " sends=%" PRIu64 " evictions=%" PRIu64,
+                        mHitCount, mSendCount, mEvictionCount);
 }
 
 } // namespace android::compositionengine::impl
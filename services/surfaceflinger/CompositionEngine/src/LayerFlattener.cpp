@@ -0,0 +1,298 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <compositionengine/DisplayColorProfile.h>
+#include <compositionengine/LayerFECompositionState.h>
+#include <compositionengine/Output.h>
+#include <compositionengine/OutputLayer.h>
+#include <compositionengine/impl/DumpHelpers.h>
+#include <compositionengine/impl/LayerFlattener.h>
+#include <compositionengine/impl/OutputCompositionState.h>
+#include <compositionengine/impl/OutputLayerCompositionState.h>
+#include <renderengine/DisplaySettings.h>
+#include <renderengine/RenderEngine.h>
+#include <utils/Trace.h>
+
+namespace android::compositionengine::impl {
+
+LayerFlattener::LayerFlattener(uint32_t staticFrameThreshold)
+      : mStaticFrameThreshold(staticFrameThreshold) {}
+
+LayerFlattener::~LayerFlattener() = default;
+
+bool LayerFlattener::LayerSnapshot::hasSameContent(const LayerSnapshot& other) const {
+    return flattenable == other.flattenable && bufferId == other.bufferId &&
+            acquireFence == other.acquireFence && compositionType == other.compositionType &&
+            alpha == other.alpha && color == other.color;
+}
+
+LayerFlattener::LayerSnapshot LayerFlattener::takeSnapshot(
+        const compositionengine::OutputLayer& layer) {
+    LayerSnapshot snapshot;
+
+    const auto& state = layer.getState();
+    const auto* layerFEState = layer.getLayerFE().getCompositionState();
+    if (!layerFEState) {
+        return snapshot;
+    }
+
+    snapshot.bufferId = layerFEState->buffer ? layerFEState->buffer->getId() : 0;
+    snapshot.acquireFence = layerFEState->acquireFence;
+    snapshot.compositionType = layerFEState->compositionType;
+    snapshot.alpha = layerFEState->alpha;
+    snapshot.color = layerFEState->color;
+
+    // Only plain buffer and color layers can be rendered ahead of time. Anything HWC has to treat
+    // specially, or that is composed with the layers below it, is left alone.
+    const bool hasFlattenableContent =
+            (layerFEState->compositionType == hal::Composition::DEVICE && layerFEState->buffer) ||
+            layerFEState->compositionType == hal::Composition::SOLID_COLOR;
+    snapshot.flattenable = state.hwc && !state.forceClientComposition && hasFlattenableContent &&
+            !layerFEState->hasProtectedContent && layerFEState->backgroundBlurRadius == 0;
+    return snapshot;
+}
+
+bool LayerFlattener::update(compositionengine::Output& output,
+                            renderengine::RenderEngine& renderEngine, bool geometryChanged) {
+    ATRACE_CALL();
+
+    const auto enumerator = output.getOutputLayersOrderedByZ();
+    const std::vector<compositionengine::OutputLayer*> layers(enumerator.begin(),
+                                                              enumerator.end());
+
+    // If HWC did not take the flattened buffer, the run is still composed from its original
+    // layers, so stop overriding them until they have been static for long enough again.
+    const bool flattenedLayerRejected =
+            std::any_of(layers.begin(), layers.end(), [](const auto* layer) {
+                const auto& state = layer->getState();
+                return (state.overrideInfo.buffer || state.overrideInfo.skip) &&
+                        layer->requiresClientComposition();
+            });
+    if (flattenedLayerRejected) {
+        ALOGV("Flattened layers of %s were composed by the client", output.getName().c_str());
+        geometryChanged = true;
+    }
+
+    std::unordered_map<const LayerFE*, LayerSnapshot> snapshots;
+    snapshots.reserve(layers.size());
+    for (const auto* layer : layers) {
+        LayerSnapshot snapshot = takeSnapshot(*layer);
+        const auto it = mSnapshots.find(&layer->getLayerFE());
+        if (!geometryChanged && it != mSnapshots.end() && it->second.hasSameContent(snapshot)) {
+            snapshot.staticFrameCount = it->second.staticFrameCount + 1;
+        }
+        snapshots.emplace(&layer->getLayerFE(), std::move(snapshot));
+    }
+    mSnapshots = std::move(snapshots);
+
+    // Find the longest run of consecutive layers that have been static long enough.
+    size_t runBegin = 0;
+    size_t runEnd = 0;
+    for (size_t begin = 0; begin < layers.size();) {
+        size_t end = begin;
+        while (end < layers.size()) {
+            const auto& snapshot = mSnapshots[&layers[end]->getLayerFE()];
+            if (!snapshot.flattenable || snapshot.staticFrameCount < mStaticFrameThreshold) {
+                break;
+            }
+            end++;
+        }
+        if (end - begin > runEnd - runBegin) {
+            runBegin = begin;
+            runEnd = end;
+        }
+        begin = end + 1;
+    }
+
+    const auto& outputState = output.getState();
+    std::vector<const LayerFE*> runLayers;
+    if (runEnd - runBegin >= kMinLayersToFlatten && !renderEngine.isProtected()) {
+        runLayers.reserve(runEnd - runBegin);
+        std::transform(layers.begin() + static_cast<ptrdiff_t>(runBegin),
+                       layers.begin() + static_cast<ptrdiff_t>(runEnd),
+                       std::back_inserter(runLayers),
+                       [](const auto* layer) { return &layer->getLayerFE(); });
+    }
+
+    if (runLayers.empty()) {
+        clear();
+    } else if (runLayers != mFlattenedLayers || !mBuffer || mDataspace != outputState.dataspace) {
+        clear();
+        if (render(output, renderEngine, layers, runBegin, runEnd)) {
+            mFlattenedLayers = std::move(runLayers);
+        } else {
+            // Wait for the run to be static long enough again before retrying.
+            for (const auto* layerFE : runLayers) {
+                mSnapshots[layerFE].staticFrameCount = 0;
+            }
+            clear();
+        }
+    }
+
+    if (mBuffer) {
+        mFlattenedFrameCount++;
+    }
+
+    bool overridesChanged = false;
+    for (size_t i = 0; i < layers.size(); i++) {
+        OutputLayerCompositionState::OverrideInfo overrideInfo;
+        if (mBuffer && i == runBegin) {
+            overrideInfo.buffer = mBuffer;
+            overrideInfo.acquireFence = mAcquireFence;
+            overrideInfo.displayFrame = mDisplayFrame;
+            overrideInfo.dataspace = mDataspace;
+            // The whole buffer is new the first time it is presented, and unchanged afterwards.
+            overrideInfo.damageRegion = mBufferIsNew ? Region(mDisplayFrame) : Region();
+        } else if (mBuffer && i > runBegin && i < runEnd) {
+            overrideInfo.skip = true;
+        }
+
+        auto& state = layers[i]->editState();
+        overridesChanged |= state.overrideInfo.buffer != overrideInfo.buffer ||
+                state.overrideInfo.skip != overrideInfo.skip;
+        state.overrideInfo = std::move(overrideInfo);
+    }
+    mBufferIsNew = false;
+
+    return overridesChanged;
+}
+
+bool LayerFlattener::render(compositionengine::Output& output,
+                            renderengine::RenderEngine& renderEngine,
+                            const std::vector<compositionengine::OutputLayer*>& layers,
+                            size_t begin, size_t end) {
+    ATRACE_CALL();
+
+    const auto& outputState = output.getState();
+    const auto* profile = output.getDisplayColorProfile();
+
+    renderengine::DisplaySettings displaySettings;
+    displaySettings.physicalDisplay = outputState.destinationClip;
+    displaySettings.clip = outputState.sourceClip;
+    displaySettings.orientation = outputState.orientation;
+    displaySettings.outputDataspace = profile && profile->hasWideColorGamut()
+            ? outputState.dataspace
+            : ui::Dataspace::UNKNOWN;
+    if (profile) {
+        displaySettings.maxLuminance = profile->getHdrCapabilities().getDesiredMaxLuminance();
+    }
+
+    const Region viewportRegion(outputState.viewport);
+    // Nothing is cleared, as the layers are rendered over a transparent buffer.
+    Region clearRegion;
+    Region displayRegion;
+    std::vector<LayerFE::LayerSettings> layerSettings;
+
+    for (size_t i = begin; i < end; i++) {
+        auto* layer = layers[i];
+        const auto& layerState = layer->getState();
+        displayRegion.orSelf(layerState.displayFrame);
+
+        const Region clip(viewportRegion.intersect(layerState.visibleRegion));
+        if (clip.isEmpty()) {
+            continue;
+        }
+
+        compositionengine::LayerFE::ClientCompositionTargetSettings targetSettings{
+                clip,
+                /*useIdentityTransform=*/false,
+                layer->needsFiltering() || outputState.needsFiltering,
+                outputState.isSecure,
+                /*supportsProtectedContent=*/false,
+                clearRegion,
+                outputState.viewport,
+                displaySettings.outputDataspace,
+                /*realContentIsVisible=*/true,
+                /*clearContent=*/false,
+        };
+        std::vector<LayerFE::LayerSettings> results =
+                layer->getLayerFE().prepareClientCompositionList(targetSettings);
+        layerSettings.insert(layerSettings.end(), std::make_move_iterator(results.begin()),
+                             std::make_move_iterator(results.end()));
+    }
+
+    Rect displayFrame;
+    displayRegion.getBounds().intersect(outputState.bounds, &displayFrame);
+    if (layerSettings.empty() || displayFrame.isEmpty()) {
+        return false;
+    }
+
+    std::vector<const renderengine::LayerSettings*> layerSettingsPointers;
+    layerSettingsPointers.reserve(layerSettings.size());
+    std::transform(layerSettings.begin(), layerSettings.end(),
+                   std::back_inserter(layerSettingsPointers),
+                   [](LayerFE::LayerSettings& settings) -> renderengine::LayerSettings* {
+                       return &settings;
+                   });
+
+    // A new buffer is used for every render, since HWC may still be reading the previous one.
+    const uint64_t usage = GraphicBuffer::USAGE_HW_RENDER | GraphicBuffer::USAGE_HW_COMPOSER |
+            GraphicBuffer::USAGE_HW_TEXTURE;
+    sp<GraphicBuffer> buffer =
+            new GraphicBuffer(static_cast<uint32_t>(outputState.bounds.getWidth()),
+                              static_cast<uint32_t>(outputState.bounds.getHeight()),
+                              PIXEL_FORMAT_RGBA_8888, 1, usage, "LayerFlattener");
+    if (buffer->initCheck() != NO_ERROR) {
+        ALOGE("Failed to allocate the flattened buffer for %s", output.getName().c_str());
+        return false;
+    }
+
+    base::unique_fd readyFence;
+    const status_t status =
+            renderEngine.drawLayers(displaySettings, layerSettingsPointers,
+                                    buffer->getNativeBuffer(), /*useFramebufferCache=*/false,
+                                    base::unique_fd(), &readyFence);
+    if (status != NO_ERROR) {
+        ALOGE("Failed to flatten %zu layers of %s: %d", end - begin, output.getName().c_str(),
+              status);
+        return false;
+    }
+
+    mBuffer = std::move(buffer);
+    if (readyFence.get() >= 0) {
+        mAcquireFence = new Fence(std::move(readyFence));
+    } else {
+        mAcquireFence = Fence::NO_FENCE;
+    }
+    mDisplayFrame = displayFrame;
+    mDataspace = outputState.dataspace;
+    mBufferIsNew = true;
+    mRenderCount++;
+    return true;
+}
+
+void LayerFlattener::clear() {
+    mFlattenedLayers.clear();
+    mBuffer = nullptr;
+    mAcquireFence = nullptr;
+    mDisplayFrame = Rect::EMPTY_RECT;
+    mDataspace = ui::Dataspace::UNKNOWN;
+    mBufferIsNew = false;
+}
+
+void LayerFlattener::dump(std::string& out) const {
+    out.append("\n   Layer flattening: ");
+    dumpVal(out, "staticFrameThreshold", mStaticFrameThreshold);
+    dumpVal(out, "flattenedLayers", static_cast<uint32_t>(mFlattenedLayers.size()));
+    dumpVal(out, "displayFrame", mDisplayFrame);
+    dumpVal(out, "renderCount", mRenderCount);
+    dumpVal(out, "flattenedFrameCount", mFlattenedFrameCount);
+    out.append("\n");
+}
+
+} // namespace android::compositionengine::impl
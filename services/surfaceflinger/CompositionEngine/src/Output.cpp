@@ -38,6 +38,7 @@
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic pop // ignored "-Wconversion"
 
+#include <gui/GLConsumer.h>
 #include <ui/DebugUtils.h>
 #include <ui/HdrCapabilities.h>
 #include <utils/Trace.h>
@@ -207,6 +208,14 @@ void Output::dumpBase(std::string& out) const {
         }
         outputLayer->dump(out);
     }
+
+    if (mLayerFlattener) {
+        mLayerFlattener->dump(out);
+    }
+
+    if (mVisibilityCache) {
+        mVisibilityCache->dump(out);
+    }
 }
 
 compositionengine::DisplayColorProfile* Output::getDisplayColorProfile() const {
@@ -245,6 +254,22 @@ void Output::cacheClientCompositionRequests(uint32_t cacheSize) {
     }
 };
 
+void Output::cacheLayerVisibility(bool enabled) {
+    if (!enabled) {
+        mVisibilityCache.reset();
+    } else if (!mVisibilityCache) {
+        mVisibilityCache = std::make_unique<VisibilityCache>();
+    }
+}
+
+void Output::flattenStaticLayers(uint32_t staticFrameThreshold) {
+    if (staticFrameThreshold == 0) {
+        mLayerFlattener.reset();
+    } else {
+        mLayerFlattener = std::make_unique<LayerFlattener>(staticFrameThreshold);
+    }
+}
+
 void Output::setRenderSurfaceForTest(std::unique_ptr<compositionengine::RenderSurface> surface) {
     mRenderSurface = std::move(surface);
 }
@@ -308,6 +333,8 @@ void Output::present(const compositionengine::CompositionRefreshArgs& refreshArg
     ATRACE_CALL();
     ALOGV(__FUNCTION__);
 
+    mComposedClientTarget.reset();
+
     updateColorProfile(refreshArgs);
     updateAndWriteCompositionState(refreshArgs);
     setColorTransform(refreshArgs);
@@ -345,6 +372,10 @@ void Output::rebuildLayerStacks(const compositionengine::CompositionRefreshArgs&
 
 void Output::collectVisibleLayers(const compositionengine::CompositionRefreshArgs& refreshArgs,
                                   compositionengine::Output::CoverageState& coverage) {
+    if (mVisibilityCache) {
+        mVisibilityCache->beginFrame(getState());
+    }
+
     // Evaluate the layers from front to back to determine what is visible. This
     // also incrementally calculates the coverage information for each layer as
     // well as the entire output.
@@ -356,6 +387,10 @@ void Output::collectVisibleLayers(const compositionengine::CompositionRefreshArg
         // no more layers could even be visible underneath the ones on top.
     }
 
+    if (mVisibilityCache) {
+        mVisibilityCache->endFrame();
+    }
+
     setReleasedLayers(refreshArgs);
 
     finalizePendingOutputLayers();
@@ -449,6 +484,11 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
         return;
     }
 
+    const Rect footprint = visibleRegion.getBounds();
+    if (mVisibilityCache && reuseCachedVisibility(layerFE, *layerFEState, footprint, coverage)) {
+        return;
+    }
+
     // Remove the transparent area from the visible region
     if (!layerFEState->isOpaque) {
         if (tr.preserveRects()) {
@@ -482,6 +522,10 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
     visibleRegion.subtractSelf(coverage.aboveOpaqueLayers);
 
     if (visibleRegion.isEmpty()) {
+        if (mVisibilityCache) {
+            mVisibilityCache->record(layerFE, *layerFEState,
+                                     {footprint, Rect::EMPTY_RECT, /*visible=*/false, Region()});
+        }
         return;
     }
 
@@ -541,6 +585,12 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
     Region drawRegion(outputState.transform.transform(visibleNonTransparentRegion));
     drawRegion.andSelf(outputState.bounds);
     if (drawRegion.isEmpty()) {
+        if (mVisibilityCache) {
+            // Without an output layer, the layer is considered newly exposed every time.
+            mVisibilityCache->record(layerFE, *layerFEState,
+                                     {footprint, opaqueRegion.getBounds(), /*visible=*/false,
+                                      visibleRegion.subtract(coveredRegion)});
+        }
         return;
     }
 
@@ -559,6 +609,44 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
     outputLayerState.outputSpaceVisibleRegion =
             outputState.transform.transform(visibleNonShadowRegion.intersect(outputState.viewport));
     outputLayerState.shadowRegion = shadowRegion;
+
+    if (mVisibilityCache) {
+        // Once unchanged, only the covered part of the layer is considered dirty.
+        mVisibilityCache->record(layerFE, *layerFEState,
+                                 {footprint, opaqueRegion.getBounds(), /*visible=*/true,
+                                  visibleRegion.intersect(coveredRegion)});
+    }
+}
+
+bool Output::reuseCachedVisibility(const sp<compositionengine::LayerFE>& layerFE,
+                                   const LayerFECompositionState& layerFEState,
+                                   const Rect& footprint,
+                                   compositionengine::Output::CoverageState& coverage) {
+    const auto* cached = mVisibilityCache->lookUp(layerFE, layerFEState, footprint);
+    if (!cached) {
+        return false;
+    }
+
+    // The output layer still holds the regions computed in the previous update.
+    std::optional<size_t> prevOutputLayerIndex;
+    if (cached->visible) {
+        prevOutputLayerIndex = findCurrentOutputLayerForLayer(layerFE);
+        if (!prevOutputLayerIndex) {
+            return false;
+        }
+    }
+
+    coverage.aboveCoveredLayers.orSelf(cached->footprint);
+    if (!cached->opaque.isEmpty()) {
+        coverage.aboveOpaqueLayers.orSelf(cached->opaque);
+    }
+    coverage.dirtyRegion.orSelf(cached->dirtyRegion);
+    if (cached->visible) {
+        ensureOutputLayer(prevOutputLayerIndex, layerFE);
+    }
+
+    mVisibilityCache->reuse();
+    return true;
 }
 
 void Output::setReleasedLayers(const compositionengine::CompositionRefreshArgs&) {
@@ -573,6 +661,41 @@ void Output::updateLayerStateFromFE(const CompositionRefreshArgs& args) const {
     }
 }
 
+bool Output::showsSameContentAs(const compositionengine::Output& other) const {
+    const auto& state = getState();
+    const auto& otherState = other.getState();
+    if (!state.isEnabled || !otherState.isEnabled || state.isSecure != otherState.isSecure ||
+        state.layerStackId != otherState.layerStackId ||
+        state.layerStackInternal != otherState.layerStackInternal ||
+        state.bounds != otherState.bounds || !(state.transform == otherState.transform) ||
+        state.orientation != otherState.orientation || state.frame != otherState.frame ||
+        state.viewport != otherState.viewport || state.sourceClip != otherState.sourceClip ||
+        state.destinationClip != otherState.destinationClip) {
+        return false;
+    }
+
+    const size_t layerCount = getOutputLayerCount();
+    if (layerCount != other.getOutputLayerCount()) {
+        return false;
+    }
+    for (size_t i = 0; i < layerCount; i++) {
+        if (&getOutputLayerOrderedByZByIndex(i)->getLayerFE() !=
+            &other.getOutputLayerOrderedByZByIndex(i)->getLayerFE()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Output::setMirrorSource(const compositionengine::Output* source, uint32_t textureName) {
+    mMirrorSource = source;
+    mMirrorTextureName = textureName;
+}
+
+std::optional<compositionengine::Output::ClientTarget> Output::getComposedClientTarget() const {
+    return mComposedClientTarget;
+}
+
 void Output::updateAndWriteCompositionState(
         const compositionengine::CompositionRefreshArgs& refreshArgs) {
     ATRACE_CALL();
@@ -594,9 +717,19 @@ void Output::updateAndWriteCompositionState(
         if (mLayerRequestingBackgroundBlur == layer) {
             forceClientComposition = false;
         }
+    }
 
+    // The geometry of layers that start or stop being overridden by a flattened buffer changes.
+    bool flattenedLayersChanged = false;
+    if (mLayerFlattener) {
+        flattenedLayersChanged =
+                mLayerFlattener->update(*this, getCompositionEngine().getRenderEngine(),
+                                        refreshArgs.updatingGeometryThisFrame);
+    }
+
+    for (auto* layer : getOutputLayersOrderedByZ()) {
         // Send the updated state to the HWC, if appropriate.
-        layer->writeStateToHWC(refreshArgs.updatingGeometryThisFrame);
+        layer->writeStateToHWC(refreshArgs.updatingGeometryThisFrame || flattenedLayersChanged);
     }
 }
 
@@ -861,6 +994,14 @@ std::optional<base::unique_fd> Output::composeSurfaces(
 
     ALOGV("hasClientComposition");
 
+    // If this output mirrors another one which was fully client composed this frame, copy its
+    // client target rather than composing the same layers a second time.
+    if (mMirrorSource && !outputState.usesDeviceComposition && debugRegion.isEmpty()) {
+        if (auto copyFence = copyMirrorSourceClientTarget(buf, fd)) {
+            return copyFence;
+        }
+    }
+
     renderengine::DisplaySettings clientCompositionDisplay;
     clientCompositionDisplay.physicalDisplay = outputState.destinationClip;
     clientCompositionDisplay.clip = outputState.sourceClip;
@@ -892,11 +1033,27 @@ std::optional<base::unique_fd> Output::composeSurfaces(
         if (mClientCompositionRequestCache->exists(buf->getId(), clientCompositionDisplay,
                                                    clientCompositionLayers)) {
             outputCompositionState.reusedClientComposition = true;
+            if (!outputState.usesDeviceComposition) {
+                mComposedClientTarget = ClientTarget{buf, Fence::NO_FENCE};
+            }
             setExpensiveRenderingExpected(false);
             return readyFence;
         }
+        // Otherwise, if only some layers changed since the buffer was rendered, only redraw
+        // what they cover now and covered then, along with anything else dirty this frame.
+        const auto damage =
+                mClientCompositionRequestCache->getDamage(buf->getId(), clientCompositionDisplay,
+                                                          clientCompositionLayers);
         mClientCompositionRequestCache->add(buf->getId(), clientCompositionDisplay,
                                             clientCompositionLayers);
+        if (damage) {
+            Region displayDamage = outputState.transform.transform(*damage);
+            displayDamage.orSelf(outputState.transform.transform(outputState.dirtyRegion));
+            // Filtering may sample one pixel past the bounds of a layer.
+            Rect damageBounds = displayDamage.getBounds();
+            clientCompositionDisplay.damage = damageBounds.inset(-1, -1, -1, -1);
+            outputCompositionState.partialClientComposition = true;
+        }
     }
 
     // We boost GPU frequency here because there will be color spaces conversion
@@ -930,6 +1087,13 @@ std::optional<base::unique_fd> Output::composeSurfaces(
         mClientCompositionRequestCache->remove(buf->getId());
     }
 
+    if (status == NO_ERROR && !outputState.usesDeviceComposition && debugRegion.isEmpty()) {
+        mComposedClientTarget = ClientTarget{buf, Fence::NO_FENCE};
+        if (readyFence.get() >= 0) {
+            mComposedClientTarget->readyFence = new Fence(dup(readyFence.get()));
+        }
+    }
+
     auto& timeStats = getCompositionEngine().getTimeStats();
     if (readyFence.get() < 0) {
         timeStats.recordRenderEngineDuration(renderEngineStart, systemTime());
@@ -942,6 +1106,80 @@ std::optional<base::unique_fd> Output::composeSurfaces(
     return readyFence;
 }
 
+std::optional<base::unique_fd> Output::copyMirrorSourceClientTarget(
+        const sp<GraphicBuffer>& buf, base::unique_fd& bufferFence) {
+    const auto& outputState = getState();
+    const auto& sourceState = mMirrorSource->getState();
+    const auto source = mMirrorSource->getComposedClientTarget();
+    if (!source || source->buffer == buf ||
+        source->buffer->getWidth() != buf->getWidth() ||
+        source->buffer->getHeight() != buf->getHeight() ||
+        sourceState.dataspace != outputState.dataspace ||
+        sourceState.colorTransformMatrix != outputState.colorTransformMatrix ||
+        outputState.colorTransformMatrix != mat4()) {
+        return {};
+    }
+
+    ATRACE_CALL();
+
+    renderengine::DisplaySettings displaySettings;
+    displaySettings.physicalDisplay = outputState.bounds;
+    displaySettings.clip = outputState.bounds;
+    displaySettings.outputDataspace = mDisplayColorProfile->hasWideColorGamut()
+            ? outputState.dataspace
+            : ui::Dataspace::UNKNOWN;
+    displaySettings.maxLuminance =
+            mDisplayColorProfile->getHdrCapabilities().getDesiredMaxLuminance();
+    displaySettings.clearRegion = Region();
+
+    // The source client target is already in the output dataspace, and covers the whole output,
+    // so it is drawn opaque and unscaled.
+    renderengine::LayerSettings layerSettings;
+    layerSettings.geometry.boundaries = outputState.bounds.toFloatRect();
+    layerSettings.source.buffer.buffer = source->buffer;
+    layerSettings.source.buffer.fence = source->readyFence;
+    layerSettings.source.buffer.textureName = mMirrorTextureName;
+    layerSettings.source.buffer.isOpaque = true;
+    layerSettings.source.buffer.usePremultipliedAlpha = true;
+    float textureMatrix[16];
+    GLConsumer::computeTransformMatrix(textureMatrix, source->buffer,
+                                       Rect(source->buffer->getWidth(),
+                                            source->buffer->getHeight()),
+                                       0, false);
+    layerSettings.source.buffer.textureTransform =
+            mat4(static_cast<const float*>(textureMatrix));
+    layerSettings.sourceDataspace = displaySettings.outputDataspace;
+    layerSettings.alpha = half(1.0);
+    layerSettings.disableBlending = true;
+
+    auto& renderEngine = getCompositionEngine().getRenderEngine();
+    base::unique_fd readyFence;
+    const nsecs_t renderEngineStart = systemTime();
+    const status_t status = renderEngine.drawLayers(displaySettings, {&layerSettings},
+                                                    buf->getNativeBuffer(),
+                                                    /*useFramebufferCache=*/true,
+                                                    std::move(bufferFence), &readyFence);
+    if (mClientCompositionRequestCache) {
+        // The buffer no longer holds what was cached for it.
+        mClientCompositionRequestCache->remove(buf->getId());
+    }
+    if (status != NO_ERROR) {
+        ALOGW("Copying the client target of [%s] to [%s] failed: %d",
+              mMirrorSource->getName().c_str(), mName.c_str(), status);
+    }
+
+    setExpensiveRenderingExpected(false);
+    auto& timeStats = getCompositionEngine().getTimeStats();
+    if (readyFence.get() < 0) {
+        timeStats.recordRenderEngineDuration(renderEngineStart, systemTime());
+    } else {
+        timeStats.recordRenderEngineDuration(renderEngineStart,
+                                             std::make_shared<FenceTime>(
+                                                     new Fence(dup(readyFence.get()))));
+    }
+    return readyFence;
+}
+
 std::vector<LayerFE::LayerSettings> Output::generateClientCompositionRequests(
         bool supportsProtectedContent, Region& clearRegion, ui::Dataspace outputDataspace) {
     std::vector<LayerFE::LayerSettings> clientCompositionLayers;
@@ -1102,6 +1340,7 @@ void Output::chooseCompositionStrategy() {
     outputState.usesClientComposition = true;
     outputState.usesDeviceComposition = false;
     outputState.reusedClientComposition = false;
+    outputState.partialClientComposition = false;
 }
 
 bool Output::getSkipColorTransform() const {
@@ -332,7 +332,10 @@ void OutputLayer::writeStateToHWC(bool includeGeometry) {
         return;
     }
 
-    auto requestedCompositionType = outputIndependentState->compositionType;
+    // A flattened buffer is always presented as a device composited buffer.
+    auto requestedCompositionType = state.overrideInfo.buffer
+            ? hal::Composition::DEVICE
+            : outputIndependentState->compositionType;
 
     if (includeGeometry) {
         writeOutputDependentGeometryStateToHWC(hwcLayer.get(), requestedCompositionType);
@@ -351,24 +354,26 @@ void OutputLayer::writeStateToHWC(bool includeGeometry) {
 void OutputLayer::writeOutputDependentGeometryStateToHWC(
         HWC2::Layer* hwcLayer, hal::Composition requestedCompositionType) {
     const auto& outputDependentState = getState();
+    const auto& overrideInfo = outputDependentState.overrideInfo;
 
-    if (auto error = hwcLayer->setDisplayFrame(outputDependentState.displayFrame);
-        error != hal::Error::NONE) {
+    // The flattened buffer covers the output, so it is cropped to the same frame it is shown in.
+    const Rect displayFrame =
+            overrideInfo.buffer ? overrideInfo.displayFrame : outputDependentState.displayFrame;
+    const FloatRect sourceCrop = overrideInfo.buffer ? overrideInfo.displayFrame.toFloatRect()
+                                                     : outputDependentState.sourceCrop;
+
+    if (auto error = hwcLayer->setDisplayFrame(displayFrame); error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set display frame [%d, %d, %d, %d]: %s (%d)",
-              getLayerFE().getDebugName(), outputDependentState.displayFrame.left,
-              outputDependentState.displayFrame.top, outputDependentState.displayFrame.right,
-              outputDependentState.displayFrame.bottom, to_string(error).c_str(),
+              getLayerFE().getDebugName(), displayFrame.left, displayFrame.top,
+              displayFrame.right, displayFrame.bottom, to_string(error).c_str(),
               static_cast<int32_t>(error));
     }
 
-    if (auto error = hwcLayer->setSourceCrop(outputDependentState.sourceCrop);
-        error != hal::Error::NONE) {
+    if (auto error = hwcLayer->setSourceCrop(sourceCrop); error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set source crop [%.3f, %.3f, %.3f, %.3f]: "
               "%s (%d)",
-              getLayerFE().getDebugName(), outputDependentState.sourceCrop.left,
-              outputDependentState.sourceCrop.top, outputDependentState.sourceCrop.right,
-              outputDependentState.sourceCrop.bottom, to_string(error).c_str(),
-              static_cast<int32_t>(error));
+              getLayerFE().getDebugName(), sourceCrop.left, sourceCrop.top, sourceCrop.right,
+              sourceCrop.bottom, to_string(error).c_str(), static_cast<int32_t>(error));
     }
 
     uint32_t z = outputDependentState.z;
@@ -383,8 +388,10 @@ void OutputLayer::writeOutputDependentGeometryStateToHWC(
               outputDependentState.z, to_string(error).c_str(), static_cast<int32_t>(error));
     }
 
-    // Solid-color layers should always use an identity transform.
-    const auto bufferTransform = requestedCompositionType != hal::Composition::SOLID_COLOR
+    // Solid-color layers should always use an identity transform, as should flattened buffers,
+    // which are rendered in output space.
+    const auto bufferTransform =
+            requestedCompositionType != hal::Composition::SOLID_COLOR && !overrideInfo.buffer
             ? outputDependentState.bufferTransform
             : static_cast<hal::Transform>(0);
     if (auto error = hwcLayer->setTransform(static_cast<hal::Transform>(bufferTransform));
@@ -397,17 +404,24 @@ void OutputLayer::writeOutputDependentGeometryStateToHWC(
 
 void OutputLayer::writeOutputIndependentGeometryStateToHWC(
         HWC2::Layer* hwcLayer, const LayerFECompositionState& outputIndependentState) {
-    if (auto error = hwcLayer->setBlendMode(outputIndependentState.blendMode);
-        error != hal::Error::NONE) {
+    const auto& overrideInfo = getState().overrideInfo;
+    const bool isOverridden = overrideInfo.buffer || overrideInfo.skip;
+
+    // The flattened buffer already has the alpha of its layers applied, and skipped layers are
+    // made fully transparent so that they do not show a second time.
+    const auto blendMode =
+            isOverridden ? hal::BlendMode::PREMULTIPLIED : outputIndependentState.blendMode;
+    const float alpha =
+            overrideInfo.skip ? 0.0f : (overrideInfo.buffer ? 1.0f : outputIndependentState.alpha);
+
+    if (auto error = hwcLayer->setBlendMode(blendMode); error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set blend mode %s: %s (%d)", getLayerFE().getDebugName(),
-              toString(outputIndependentState.blendMode).c_str(), to_string(error).c_str(),
-              static_cast<int32_t>(error));
+              toString(blendMode).c_str(), to_string(error).c_str(), static_cast<int32_t>(error));
     }
 
-    if (auto error = hwcLayer->setPlaneAlpha(outputIndependentState.alpha);
-        error != hal::Error::NONE) {
-        ALOGE("[%s] Failed to set plane alpha %.3f: %s (%d)", getLayerFE().getDebugName(),
-              outputIndependentState.alpha, to_string(error).c_str(), static_cast<int32_t>(error));
+    if (auto error = hwcLayer->setPlaneAlpha(alpha); error != hal::Error::NONE) {
+        ALOGE("[%s] Failed to set plane alpha %.3f: %s (%d)", getLayerFE().getDebugName(), alpha,
+              to_string(error).c_str(), static_cast<int32_t>(error));
     }
 
     if (auto error = hwcLayer->setInfo(static_cast<uint32_t>(outputIndependentState.type),
@@ -428,26 +442,34 @@ void OutputLayer::writeOutputIndependentGeometryStateToHWC(
 
 void OutputLayer::writeOutputDependentPerFrameStateToHWC(HWC2::Layer* hwcLayer) {
     const auto& outputDependentState = getState();
+    const auto& overrideInfo = outputDependentState.overrideInfo;
 
     // TODO(lpique): b/121291683 outputSpaceVisibleRegion is output-dependent geometry
     // state and should not change every frame.
-    if (auto error = hwcLayer->setVisibleRegion(outputDependentState.outputSpaceVisibleRegion);
-        error != hal::Error::NONE) {
+    const Region visibleRegion = overrideInfo.buffer
+            ? Region(overrideInfo.displayFrame)
+            : outputDependentState.outputSpaceVisibleRegion;
+    if (auto error = hwcLayer->setVisibleRegion(visibleRegion); error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set visible region: %s (%d)", getLayerFE().getDebugName(),
               to_string(error).c_str(), static_cast<int32_t>(error));
-        outputDependentState.outputSpaceVisibleRegion.dump(LOG_TAG);
+        visibleRegion.dump(LOG_TAG);
     }
 
-    if (auto error = hwcLayer->setDataspace(outputDependentState.dataspace);
-        error != hal::Error::NONE) {
-        ALOGE("[%s] Failed to set dataspace %d: %s (%d)", getLayerFE().getDebugName(),
-              outputDependentState.dataspace, to_string(error).c_str(),
-              static_cast<int32_t>(error));
+    const auto dataspace =
+            overrideInfo.buffer ? overrideInfo.dataspace : outputDependentState.dataspace;
+    if (auto error = hwcLayer->setDataspace(dataspace); error != hal::Error::NONE) {
+        ALOGE("[%s] Failed to set dataspace %d: %s (%d)", getLayerFE().getDebugName(), dataspace,
+              to_string(error).c_str(), static_cast<int32_t>(error));
     }
 }
 
 void OutputLayer::writeOutputIndependentPerFrameStateToHWC(
         HWC2::Layer* hwcLayer, const LayerFECompositionState& outputIndependentState) {
+    if (getState().overrideInfo.buffer) {
+        writeOverrideBufferStateToHWC(hwcLayer, outputIndependentState);
+        return;
+    }
+
     switch (auto error = hwcLayer->setColorTransform(outputIndependentState.colorTransform)) {
         case hal::Error::NONE:
             break;
@@ -485,9 +507,42 @@ void OutputLayer::writeOutputIndependentPerFrameStateToHWC(
     }
 }
 
+void OutputLayer::writeOverrideBufferStateToHWC(
+        HWC2::Layer* hwcLayer, const LayerFECompositionState& outputIndependentState) {
+    const auto& overrideInfo = getState().overrideInfo;
+
+    // The color transform of the layers was applied when they were flattened.
+    if (auto error = hwcLayer->setColorTransform(mat4()); error != hal::Error::NONE) {
+        ALOGE("[%s] Failed to clear color transform: %s (%d)", getLayerFE().getDebugName(),
+              to_string(error).c_str(), static_cast<int32_t>(error));
+    }
+
+    if (auto error = hwcLayer->setSurfaceDamage(overrideInfo.damageRegion);
+        error != hal::Error::NONE) {
+        ALOGE("[%s] Failed to set surface damage: %s (%d)", getLayerFE().getDebugName(),
+              to_string(error).c_str(), static_cast<int32_t>(error));
+    }
+
+    uint32_t hwcSlot = 0;
+    sp<GraphicBuffer> hwcBuffer;
+    // The flattened buffer takes the slot of the layer's own buffer, or a slot of its own if the
+    // layer has no buffer slots. The layer's buffer is sent again, if needed, once the layer is no
+    // longer overridden.
+    editState().hwc->hwcBufferCache.getHwcBuffer(outputIndependentState.bufferSlot,
+                                                 overrideInfo.buffer, &hwcSlot, &hwcBuffer);
+
+    if (auto error = hwcLayer->setBuffer(hwcSlot, hwcBuffer, overrideInfo.acquireFence);
+        error != hal::Error::NONE) {
+        ALOGE("[%s] Failed to set flattened buffer %p: %s (%d)", getLayerFE().getDebugName(),
+              overrideInfo.buffer->handle, to_string(error).c_str(),
+              static_cast<int32_t>(error));
+    }
+}
+
 void OutputLayer::writeSolidColorStateToHWC(HWC2::Layer* hwcLayer,
                                             const LayerFECompositionState& outputIndependentState) {
-    if (outputIndependentState.compositionType != hal::Composition::SOLID_COLOR) {
+    if (outputIndependentState.compositionType != hal::Composition::SOLID_COLOR ||
+        getState().overrideInfo.buffer) {
         return;
     }
 
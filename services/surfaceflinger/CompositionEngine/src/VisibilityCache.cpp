@@ -0,0 +1,138 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cinttypes>
+
+#include <android-base/stringprintf.h>
+#include <compositionengine/impl/OutputCompositionState.h>
+#include <compositionengine/impl/VisibilityCache.h>
+#include <log/log.h>
+
+namespace android::compositionengine::impl {
+
+VisibilityCache::LayerGeometry::LayerGeometry(const LayerFECompositionState& state)
+      : transform(state.geomLayerTransform),
+        bounds(state.geomLayerBounds),
+        shadowRadius(state.shadowRadius),
+        isOpaque(state.isOpaque),
+        transparentRegionHint(state.transparentRegionHint) {}
+
+bool VisibilityCache::LayerGeometry::operator==(const LayerFECompositionState& state) const {
+    return transform == state.geomLayerTransform && bounds == state.geomLayerBounds &&
+            shadowRadius == state.shadowRadius && isOpaque == state.isOpaque &&
+            transparentRegionHint.hasSameRects(state.transparentRegionHint);
+}
+
+bool VisibilityCache::OutputGeometry::operator==(const OutputCompositionState& state) const {
+    return transform == state.transform && bounds == state.bounds && viewport == state.viewport &&
+            layerStackId == state.layerStackId && layerStackInternal == state.layerStackInternal;
+}
+
+void VisibilityCache::beginFrame(const OutputCompositionState& outputState) {
+    if (!(mOutputGeometry == outputState)) {
+        mOutputGeometry = {outputState.transform, outputState.bounds, outputState.viewport,
+                           outputState.layerStackId, outputState.layerStackInternal};
+        mPreviousEntries.clear();
+        mPreviousIndices.clear();
+    }
+
+    mEntries.clear();
+    mEntries.reserve(mPreviousEntries.size());
+    mLookedUpIndex = kNoEntry;
+    mNextPreviousIndex = 0;
+    mReordered = false;
+    mDamage.clear();
+}
+
+void VisibilityCache::endFrame() {
+    mPreviousEntries = std::move(mEntries);
+    mEntries.clear();
+
+    mPreviousIndices.clear();
+    mPreviousIndices.reserve(mPreviousEntries.size());
+    for (size_t i = 0; i < mPreviousEntries.size(); i++) {
+        mPreviousIndices.emplace(mPreviousEntries[i].layerFE.unsafe_get(), i);
+    }
+}
+
+const VisibilityCache::LayerVisibility* VisibilityCache::lookUp(
+        const sp<LayerFE>& layerFE, const LayerFECompositionState& state, const Rect& footprint) {
+    mLookedUpIndex = kNoEntry;
+    const auto it = mPreviousIndices.find(layerFE.get());
+    if (it != mPreviousIndices.end() && mPreviousEntries[it->second].layerFE.promote() == layerFE) {
+        mLookedUpIndex = it->second;
+    }
+
+    if (mLookedUpIndex == kNoEntry) {
+        return nullptr;
+    }
+
+    if (mLookedUpIndex < mNextPreviousIndex) {
+        mReordered = true;
+    } else {
+        // The layers skipped over were removed or no longer cover the output.
+        for (size_t i = mNextPreviousIndex; i < mLookedUpIndex; i++) {
+            mDamage.orSelf(mPreviousEntries[i].visibility.footprint);
+        }
+        mNextPreviousIndex = mLookedUpIndex + 1;
+    }
+
+    const Entry& entry = mPreviousEntries[mLookedUpIndex];
+    if (mReordered || state.contentDirty || !(entry.geometry == state) ||
+        entry.visibility.footprint != footprint) {
+        return nullptr;
+    }
+
+    Rect damageBounds;
+    if (mDamage.getBounds().intersect(footprint, &damageBounds) &&
+        !mDamage.intersect(footprint).isEmpty()) {
+        return nullptr;
+    }
+    return &entry.visibility;
+}
+
+void VisibilityCache::reuse() {
+    LOG_ALWAYS_FATAL_IF(mLookedUpIndex == kNoEntry, "No layer to reuse the visibility of");
+    mEntries.emplace_back(std::move(mPreviousEntries[mLookedUpIndex]));
+    mLookedUpIndex = kNoEntry;
+    mReusedLayerCount++;
+}
+
+void VisibilityCache::record(const sp<LayerFE>& layerFE, const LayerFECompositionState& state,
+                             LayerVisibility visibility) {
+    if (mLookedUpIndex == kNoEntry) {
+        mDamage.orSelf(visibility.footprint);
+    } else {
+        const LayerVisibility& previous = mPreviousEntries[mLookedUpIndex].visibility;
+        if (previous.footprint != visibility.footprint || previous.opaque != visibility.opaque) {
+            mDamage.orSelf(previous.footprint);
+            mDamage.orSelf(visibility.footprint);
+        }
+    }
+
+    mEntries.push_back({layerFE, LayerGeometry(state), std::move(visibility)});
+    mLookedUpIndex = kNoEntry;
+    mRecomputedLayerCount++;
+}
+
+void VisibilityCache::dump(std::string& out) const {
+    base::StringAppendF(&out,
+                        "\n   Layer visibility cache: %zu layers, %" PRIu64 " reused, %" PRIu64
+                        " recomputed\n",
+                        mPreviousEntries.size(), mReusedLayerCount, mRecomputedLayerCount);
+}
+
+} // namespace android::compositionengine::impl
@@ -96,6 +96,13 @@ TEST_F(CompositionEnginePresentTest, worksWithEmptyRequest) {
 }
 
 TEST_F(CompositionEnginePresentTest, worksAsExpected) {
+    // None of the outputs mirror another.
+    EXPECT_CALL(*mOutput1, showsSameContentAs(_)).WillRepeatedly(Return(false));
+    EXPECT_CALL(*mOutput2, showsSameContentAs(_)).WillRepeatedly(Return(false));
+    EXPECT_CALL(*mOutput1, setMirrorSource(nullptr, 0u));
+    EXPECT_CALL(*mOutput2, setMirrorSource(nullptr, 0u));
+    EXPECT_CALL(*mOutput3, setMirrorSource(nullptr, 0u));
+
     // Expect calls to in a certain sequence
     InSequence seq;
 
@@ -122,6 +129,77 @@ TEST_F(CompositionEnginePresentTest, worksAsExpected) {
     mEngine.present(mRefreshArgs);
 }
 
+TEST_F(CompositionEnginePresentTest, preparesOutputsInParallelWhenGeometryChanges) {
+    sp<StrictMock<mock::LayerFE>> layerFE = new StrictMock<mock::LayerFE>();
+
+    EXPECT_CALL(mEngine, preComposition(Ref(mRefreshArgs)));
+
+    // The layer geometry is latched once, before the outputs are prepared.
+    EXPECT_CALL(*layerFE, prepareCompositionState(LayerFE::StateSubset::BasicGeometry));
+    EXPECT_CALL(*mOutput1, prepare(Ref(mRefreshArgs), _));
+    EXPECT_CALL(*mOutput2, prepare(Ref(mRefreshArgs), _));
+
+    EXPECT_CALL(*mOutput1, updateLayerStateFromFE(Ref(mRefreshArgs)));
+    EXPECT_CALL(*mOutput2, updateLayerStateFromFE(Ref(mRefreshArgs)));
+    EXPECT_CALL(*mOutput1, showsSameContentAs(Ref(*mOutput2))).WillOnce(Return(false));
+    EXPECT_CALL(*mOutput1, setMirrorSource(nullptr, 0u));
+    EXPECT_CALL(*mOutput2, setMirrorSource(nullptr, 0u));
+    EXPECT_CALL(*mOutput1, present(Ref(mRefreshArgs)));
+    EXPECT_CALL(*mOutput2, present(Ref(mRefreshArgs)));
+
+    size_t runCount = 0;
+    mRefreshArgs.runInParallel = [&](size_t count, const std::function<void(size_t)>& work) {
+        runCount++;
+        for (size_t i = count; i-- > 0;) {
+            work(i);
+        }
+    };
+    mRefreshArgs.updatingOutputGeometryThisFrame = true;
+    mRefreshArgs.layers = {layerFE};
+    mRefreshArgs.outputs = {mOutput1, mOutput2};
+    mEngine.present(mRefreshArgs);
+
+    EXPECT_EQ(1u, runCount);
+}
+
+TEST_F(CompositionEnginePresentTest, mirrorsOutputsShowingSameContent) {
+    constexpr uint32_t kTextureName = 42;
+    mEngine.setRenderEngine(std::unique_ptr<renderengine::RenderEngine>(mRenderEngine));
+    sp<GraphicBuffer> clientTarget = new GraphicBuffer();
+
+    EXPECT_CALL(mEngine, preComposition(Ref(mRefreshArgs))).Times(2);
+    EXPECT_CALL(*mOutput1, prepare(Ref(mRefreshArgs), _)).Times(2);
+    EXPECT_CALL(*mOutput2, prepare(Ref(mRefreshArgs), _)).Times(2);
+    EXPECT_CALL(*mOutput1, updateLayerStateFromFE(Ref(mRefreshArgs))).Times(2);
+    EXPECT_CALL(*mOutput2, updateLayerStateFromFE(Ref(mRefreshArgs))).Times(2);
+    EXPECT_CALL(*mOutput1, present(Ref(mRefreshArgs))).Times(2);
+    EXPECT_CALL(*mOutput2, present(Ref(mRefreshArgs))).Times(2);
+    EXPECT_CALL(*mOutput1, setMirrorSource(nullptr, 0u)).Times(2);
+
+    // The second output mirrors the first, and samples its client target through a texture
+    // generated once.
+    EXPECT_CALL(*mRenderEngine, genTextures(1, _))
+            .WillOnce([](size_t, uint32_t* names) { *names = kTextureName; });
+    EXPECT_CALL(*mOutput1, showsSameContentAs(Ref(*mOutput2)))
+            .WillOnce(Return(true))
+            .WillOnce(Return(false));
+    EXPECT_CALL(*mOutput2, setMirrorSource(mOutput1.get(), kTextureName));
+    EXPECT_CALL(*mOutput1, getComposedClientTarget())
+            .WillOnce(Return(compositionengine::Output::ClientTarget{clientTarget,
+                                                                     Fence::NO_FENCE}));
+
+    mRefreshArgs.outputs = {mOutput1, mOutput2};
+    mEngine.present(mRefreshArgs);
+
+    // Once the outputs stop mirroring, RenderEngine is told to forget the client target.
+    EXPECT_CALL(*mOutput2, setMirrorSource(nullptr, 0u));
+    EXPECT_CALL(*mRenderEngine, unbindExternalTextureBuffer(clientTarget->getId()));
+
+    mEngine.present(mRefreshArgs);
+
+    EXPECT_CALL(*mRenderEngine, deleteTextures(1, _));
+}
+
 /*
  * CompositionEngine::updateCursorAsync
  */
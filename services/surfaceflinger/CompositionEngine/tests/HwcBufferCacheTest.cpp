@@ -78,8 +78,60 @@ TEST_F(HwcBufferCacheTest, cacheWorksForMaxSlot) {
     testSlot(BufferQueue::NUM_BUFFER_SLOTS - 1, BufferQueue::NUM_BUFFER_SLOTS - 1);
 }
 
-TEST_F(HwcBufferCacheTest, cacheMapsNegativeSlotToZero) {
-    testSlot(-123, 0);
+TEST_F(HwcBufferCacheTest, cacheAssignsSlotsByBufferIdWithoutSlot) {
+    uint32_t outSlot;
+    sp<GraphicBuffer> outBuffer;
+
+    mCache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1, &outSlot, &outBuffer);
+    EXPECT_EQ(0u, outSlot);
+    EXPECT_EQ(mBuffer1, outBuffer);
+
+    // A new buffer takes a free slot instead of replacing the first one.
+    mCache.getHwcBuffer(-123, mBuffer2, &outSlot, &outBuffer);
+    EXPECT_EQ(1u, outSlot);
+    EXPECT_EQ(mBuffer2, outBuffer);
+
+    // Both buffers are now found in the cache.
+    mCache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1, &outSlot, &outBuffer);
+    EXPECT_EQ(0u, outSlot);
+    EXPECT_EQ(nullptr, outBuffer.get());
+    mCache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer2, &outSlot, &outBuffer);
+    EXPECT_EQ(1u, outSlot);
+    EXPECT_EQ(nullptr, outBuffer.get());
+
+    EXPECT_EQ(2u, mCache.getHitCount());
+    EXPECT_EQ(2u, mCache.getSendCount());
+    EXPECT_EQ(0u, mCache.getEvictionCount());
+}
+
+TEST_F(HwcBufferCacheTest, cacheEvictsLeastRecentlyUsedBufferWithoutSlot) {
+    impl::HwcBufferCache cache(2);
+    sp<GraphicBuffer> buffer3{new GraphicBuffer(1, 1, HAL_PIXEL_FORMAT_RGBA_8888, 1, 0)};
+    uint32_t outSlot;
+    sp<GraphicBuffer> outBuffer;
+
+    cache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1, &outSlot, &outBuffer);
+    cache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer2, &outSlot, &outBuffer);
+    cache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1, &outSlot, &outBuffer);
+    EXPECT_EQ(0u, outSlot);
+
+    // The second buffer is the least recently used one, so the third buffer replaces it.
+    cache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, buffer3, &outSlot, &outBuffer);
+    EXPECT_EQ(1u, outSlot);
+    EXPECT_EQ(buffer3, outBuffer);
+
+    cache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer1, &outSlot, &outBuffer);
+    EXPECT_EQ(0u, outSlot);
+    EXPECT_EQ(nullptr, outBuffer.get());
+
+    // The second buffer has to be sent again, in place of the third one.
+    cache.getHwcBuffer(BufferQueue::INVALID_BUFFER_SLOT, mBuffer2, &outSlot, &outBuffer);
+    EXPECT_EQ(1u, outSlot);
+    EXPECT_EQ(mBuffer2, outBuffer);
+
+    EXPECT_EQ(2u, cache.getHitCount());
+    EXPECT_EQ(4u, cache.getSendCount());
+    EXPECT_EQ(2u, cache.getEvictionCount());
 }
 
 } // namespace
@@ -32,6 +32,8 @@ public:
     MOCK_METHOD0(onBootFinished, void());
     MOCK_METHOD2(setExpensiveRenderingExpected, void(DisplayId displayId, bool expected));
     MOCK_METHOD0(notifyDisplayUpdateImminent, void());
+    MOCK_METHOD1(notifyFrameWorkload, void(const FrameWorkload&));
+    MOCK_CONST_METHOD1(dump, void(std::string&));
 };
 
 } // namespace mock
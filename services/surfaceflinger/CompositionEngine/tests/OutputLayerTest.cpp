@@ -852,6 +852,60 @@ TEST_F(OutputLayerWriteStateToHWCTest, canSetAllState) {
     mOutputLayer.writeStateToHWC(true);
 }
 
+TEST_F(OutputLayerWriteStateToHWCTest, writesFlattenedBufferInPlaceOfLayerContent) {
+    const sp<GraphicBuffer> flattenedBuffer = new GraphicBuffer();
+    const sp<Fence> flattenedFence = new Fence();
+    const Rect flattenedFrame{0, 0, 100, 200};
+
+    auto& overrideInfo = mOutputLayer.editState().overrideInfo;
+    overrideInfo.buffer = flattenedBuffer;
+    overrideInfo.acquireFence = flattenedFence;
+    overrideInfo.displayFrame = flattenedFrame;
+    overrideInfo.dataspace = ui::Dataspace::SRGB;
+    overrideInfo.damageRegion = Region(flattenedFrame);
+
+    // The layer's own content is replaced, even if it is not a buffer.
+    mLayerFEState.compositionType = Hwc2::IComposerClient::Composition::SOLID_COLOR;
+
+    EXPECT_CALL(*mHwcLayer, setDisplayFrame(flattenedFrame)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setSourceCrop(flattenedFrame.toFloatRect())).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setZOrder(kZOrder)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setTransform(static_cast<Hwc2::Transform>(0)))
+            .WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setBlendMode(Hwc2::IComposerClient::BlendMode::PREMULTIPLIED))
+            .WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setPlaneAlpha(1.0f)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setInfo(kType, kAppId)).WillOnce(Return(kError));
+
+    EXPECT_CALL(*mHwcLayer, setVisibleRegion(RegionEq(Region(flattenedFrame))))
+            .WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setDataspace(ui::Dataspace::SRGB)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setColorTransform(mat4())).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setSurfaceDamage(RegionEq(Region(flattenedFrame))))
+            .WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setBuffer(kExpectedHwcSlot, flattenedBuffer, flattenedFence));
+    expectSetCompositionTypeCall(Hwc2::IComposerClient::Composition::DEVICE);
+
+    mOutputLayer.writeStateToHWC(true);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, makesSkippedFlattenedLayerTransparent) {
+    mOutputLayer.editState().overrideInfo.skip = true;
+
+    EXPECT_CALL(*mHwcLayer, setDisplayFrame(kDisplayFrame)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setSourceCrop(kSourceCrop)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setZOrder(kZOrder)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setTransform(kBufferTransform)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setBlendMode(Hwc2::IComposerClient::BlendMode::PREMULTIPLIED))
+            .WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setPlaneAlpha(0.0f)).WillOnce(Return(kError));
+    EXPECT_CALL(*mHwcLayer, setInfo(kType, kAppId)).WillOnce(Return(kError));
+    expectPerFrameCommonCalls();
+    expectNoSetCompositionTypeCall();
+
+    mOutputLayer.writeStateToHWC(true);
+}
+
 TEST_F(OutputLayerTest, displayInstallOrientationBufferTransformSetTo90) {
     mLayerFEState.geomBufferUsesDisplayInverseTransform = false;
     mLayerFEState.geomLayerTransform = ui::Transform{TR_IDENT};
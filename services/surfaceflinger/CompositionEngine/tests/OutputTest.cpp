@@ -24,6 +24,7 @@
 #include <compositionengine/mock/CompositionEngine.h>
 #include <compositionengine/mock/DisplayColorProfile.h>
 #include <compositionengine/mock/LayerFE.h>
+#include <compositionengine/mock/Output.h>
 #include <compositionengine/mock/OutputLayer.h>
 #include <compositionengine/mock/RenderSurface.h>
 #include <gtest/gtest.h>
@@ -45,6 +46,7 @@ using testing::DoAll;
 using testing::ElementsAre;
 using testing::ElementsAreArray;
 using testing::Eq;
+using testing::Field;
 using testing::InSequence;
 using testing::Invoke;
 using testing::IsEmpty;
@@ -287,6 +289,30 @@ TEST_F(OutputTest, setLayerStackFilterSetsFilterAndDirtiesEntireOutput) {
     EXPECT_THAT(mOutput->getState().dirtyRegion, RegionEq(Region(kDefaultDisplaySize)));
 }
 
+/*
+ * Output::showsSameContentAs()
+ */
+
+TEST_F(OutputTest, showsSameContentAsOutputWithSameLayerStackAndProjection) {
+    std::shared_ptr<Output> other = createOutput(mCompositionEngine);
+    mOutput->editState().isEnabled = true;
+    mOutput->setLayerStackFilter(123u, true);
+    other->editState() = mOutput->getState();
+
+    EXPECT_TRUE(mOutput->showsSameContentAs(*other));
+
+    other->editState().viewport = Rect{10, 20};
+    EXPECT_FALSE(mOutput->showsSameContentAs(*other));
+
+    other->editState() = mOutput->getState();
+    other->setLayerStackFilter(456u, true);
+    EXPECT_FALSE(mOutput->showsSameContentAs(*other));
+
+    other->editState() = mOutput->getState();
+    other->editState().isEnabled = false;
+    EXPECT_FALSE(mOutput->showsSameContentAs(*other));
+}
+
 /*
  * Output::setColorTransform
  */
@@ -3069,6 +3095,105 @@ TEST_F(OutputComposeSurfacesTest, clientCompositionIfRequestChanges) {
     EXPECT_FALSE(mOutput.mState.reusedClientComposition);
 }
 
+TEST_F(OutputComposeSurfacesTest, partialClientCompositionIfFewLayersChange) {
+    LayerFE::LayerSettings r1;
+    LayerFE::LayerSettings r2;
+    LayerFE::LayerSettings r3;
+
+    r1.geometry.boundaries = FloatRect{1, 2, 3, 4};
+    r2.geometry.boundaries = FloatRect{5, 6, 7, 8};
+    r3.geometry.boundaries = FloatRect{5, 6, 7, 9};
+
+    EXPECT_CALL(mOutput, getSkipColorTransform()).WillRepeatedly(Return(false));
+    EXPECT_CALL(*mDisplayColorProfile, hasWideColorGamut()).WillRepeatedly(Return(true));
+    EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mOutput, generateClientCompositionRequests(_, _, kDefaultOutputDataspace))
+            .WillOnce(Return(std::vector<LayerFE::LayerSettings>{r1, r2}))
+            .WillOnce(Return(std::vector<LayerFE::LayerSettings>{r1, r3}));
+    EXPECT_CALL(mOutput, appendRegionFlashRequests(RegionEq(kDebugRegion), _))
+            .WillRepeatedly(Return());
+
+    EXPECT_CALL(*mRenderSurface, dequeueBuffer(_)).WillRepeatedly(Return(mOutputBuffer));
+    EXPECT_CALL(mRenderEngine,
+                drawLayers(Field(&renderengine::DisplaySettings::damage, Rect::INVALID_RECT),
+                           ElementsAre(Pointee(r1), Pointee(r2)), _, true, _, _))
+            .WillOnce(Return(NO_ERROR));
+    // Only the changed layer, and the dirty region, are redrawn.
+    mOutput.mState.dirtyRegion = Region(Rect(20, 20, 30, 30));
+    EXPECT_CALL(mRenderEngine,
+                drawLayers(Field(&renderengine::DisplaySettings::damage, Rect(4, 5, 31, 31)),
+                           ElementsAre(Pointee(r1), Pointee(r3)), _, true, _, _))
+            .WillOnce(Return(NO_ERROR));
+
+    verify().execute().expectAFenceWasReturned();
+    EXPECT_FALSE(mOutput.mState.partialClientComposition);
+
+    verify().execute().expectAFenceWasReturned();
+    EXPECT_FALSE(mOutput.mState.reusedClientComposition);
+    EXPECT_TRUE(mOutput.mState.partialClientComposition);
+}
+
+TEST_F(OutputComposeSurfacesTest, fullClientCompositionIfLayersAreAdded) {
+    LayerFE::LayerSettings r1;
+    LayerFE::LayerSettings r2;
+
+    r1.geometry.boundaries = FloatRect{1, 2, 3, 4};
+    r2.geometry.boundaries = FloatRect{5, 6, 7, 8};
+
+    EXPECT_CALL(mOutput, getSkipColorTransform()).WillRepeatedly(Return(false));
+    EXPECT_CALL(*mDisplayColorProfile, hasWideColorGamut()).WillRepeatedly(Return(true));
+    EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mOutput, generateClientCompositionRequests(_, _, kDefaultOutputDataspace))
+            .WillOnce(Return(std::vector<LayerFE::LayerSettings>{r1}))
+            .WillOnce(Return(std::vector<LayerFE::LayerSettings>{r1, r2}));
+    EXPECT_CALL(mOutput, appendRegionFlashRequests(RegionEq(kDebugRegion), _))
+            .WillRepeatedly(Return());
+
+    EXPECT_CALL(*mRenderSurface, dequeueBuffer(_)).WillRepeatedly(Return(mOutputBuffer));
+    EXPECT_CALL(mRenderEngine,
+                drawLayers(Field(&renderengine::DisplaySettings::damage, Rect::INVALID_RECT), _, _,
+                           true, _, _))
+            .Times(2)
+            .WillRepeatedly(Return(NO_ERROR));
+
+    verify().execute().expectAFenceWasReturned();
+    verify().execute().expectAFenceWasReturned();
+    EXPECT_FALSE(mOutput.mState.partialClientComposition);
+}
+
+TEST_F(OutputComposeSurfacesTest, copiesClientTargetOfMirrorSource) {
+    constexpr uint32_t kTextureName = 42;
+    StrictMock<mock::Output> source;
+    sp<GraphicBuffer> sourceBuffer = new GraphicBuffer();
+    mOutput.mState.colorTransformMatrix = mat4();
+    impl::OutputCompositionState sourceState = mOutput.mState;
+    mOutput.setMirrorSource(&source, kTextureName);
+
+    EXPECT_CALL(source, getState()).WillRepeatedly(ReturnRef(sourceState));
+    EXPECT_CALL(source, getComposedClientTarget())
+            .WillOnce(Return(compositionengine::Output::ClientTarget{sourceBuffer,
+                                                                     Fence::NO_FENCE}));
+    EXPECT_CALL(*mDisplayColorProfile, hasWideColorGamut()).WillRepeatedly(Return(false));
+    EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
+    EXPECT_CALL(*mRenderSurface, dequeueBuffer(_)).WillOnce(Return(mOutputBuffer));
+    EXPECT_CALL(mOutput, setExpensiveRenderingExpected(false));
+
+    // The layers of the output are not composed, only the client target of the source is drawn.
+    EXPECT_CALL(mRenderEngine, drawLayers(_, _, _, true, _, _))
+            .WillOnce([&](const renderengine::DisplaySettings&,
+                          const std::vector<const renderengine::LayerSettings*>& layers,
+                          ANativeWindowBuffer*, const bool, base::unique_fd&&,
+                          base::unique_fd*) {
+                EXPECT_EQ(1u, layers.size());
+                EXPECT_EQ(sourceBuffer, layers[0]->source.buffer.buffer);
+                EXPECT_EQ(kTextureName, layers[0]->source.buffer.textureName);
+                EXPECT_TRUE(layers[0]->disableBlending);
+                return NO_ERROR;
+            });
+
+    EXPECT_TRUE(mOutput.composeSurfaces(Region::INVALID_REGION, kDefaultRefreshArgs));
+}
+
 struct OutputComposeSurfacesTest_UsesExpectedDisplaySettings : public OutputComposeSurfacesTest {
     OutputComposeSurfacesTest_UsesExpectedDisplaySettings() {
         EXPECT_CALL(mRenderEngine, supportsProtectedContent()).WillRepeatedly(Return(false));
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <compositionengine/LayerFECompositionState.h>
+#include <compositionengine/impl/OutputCompositionState.h>
+#include <compositionengine/impl/VisibilityCache.h>
+#include <compositionengine/mock/LayerFE.h>
+#include <gtest/gtest.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+
+namespace android::compositionengine {
+namespace {
+
+using impl::VisibilityCache;
+using testing::StrictMock;
+
+struct Layer {
+    explicit Layer(const Rect& footprint) : footprint(footprint) {
+        state.geomLayerBounds = footprint.toFloatRect();
+        state.isOpaque = true;
+    }
+
+    sp<StrictMock<mock::LayerFE>> layerFE = new StrictMock<mock::LayerFE>();
+    // Value initialized, as not all of the state has a default value.
+    LayerFECompositionState state{};
+    Rect footprint;
+};
+
+struct VisibilityCacheTest : public testing::Test {
+    VisibilityCacheTest() {
+        mOutputState.bounds = Rect(0, 0, 1000, 1000);
+        mOutputState.viewport = Rect(0, 0, 1000, 1000);
+        mOutputState.transform = ui::Transform(ui::Transform::ROT_0, 1000, 1000);
+    }
+
+    // Runs one geometry update over the layers, front to back, recording the visibility of the
+    // layers that could not reuse it. Returns which layers reused their visibility.
+    std::vector<bool> update(const std::vector<Layer*>& layers) {
+        std::vector<bool> reused;
+        mCache.beginFrame(mOutputState);
+        for (auto* layer : layers) {
+            if (mCache.lookUp(layer->layerFE, layer->state, layer->footprint)) {
+                mCache.reuse();
+                reused.push_back(true);
+            } else {
+                mCache.record(layer->layerFE, layer->state,
+                              {layer->footprint, layer->footprint, /*visible=*/true, Region()});
+                reused.push_back(false);
+            }
+        }
+        mCache.endFrame();
+        return reused;
+    }
+
+    impl::OutputCompositionState mOutputState;
+    VisibilityCache mCache;
+
+    Layer mTop{Rect(100, 100, 200, 200)};
+    Layer mMiddle{Rect(150, 150, 400, 400)};
+    Layer mBottom{Rect(0, 0, 1000, 1000)};
+    Layer mDisjoint{Rect(600, 600, 700, 700)};
+};
+
+TEST_F(VisibilityCacheTest, reusesUnchangedLayers) {
+    EXPECT_EQ(std::vector<bool>({false, false, false}), update({&mTop, &mMiddle, &mBottom}));
+    EXPECT_EQ(std::vector<bool>({true, true, true}), update({&mTop, &mMiddle, &mBottom}));
+}
+
+TEST_F(VisibilityCacheTest, doesNotReuseContentDirtyLayers) {
+    update({&mTop, &mMiddle, &mBottom});
+
+    mMiddle.state.contentDirty = true;
+    EXPECT_EQ(std::vector<bool>({true, false, true}), update({&mTop, &mMiddle, &mBottom}));
+}
+
+TEST_F(VisibilityCacheTest, recomputesLayersUnderMovedLayer) {
+    update({&mTop, &mDisjoint, &mMiddle, &mBottom});
+
+    mTop.footprint = Rect(120, 100, 220, 200);
+    mTop.state.geomLayerBounds = mTop.footprint.toFloatRect();
+    EXPECT_EQ(std::vector<bool>({false, true, false, false}),
+              update({&mTop, &mDisjoint, &mMiddle, &mBottom}));
+}
+
+TEST_F(VisibilityCacheTest, recomputesLayersUnderRemovedLayer) {
+    update({&mTop, &mDisjoint, &mMiddle, &mBottom});
+
+    EXPECT_EQ(std::vector<bool>({true, false, false}), update({&mDisjoint, &mMiddle, &mBottom}));
+}
+
+TEST_F(VisibilityCacheTest, recomputesLayersUnderAddedLayer) {
+    update({&mDisjoint, &mMiddle, &mBottom});
+
+    EXPECT_EQ(std::vector<bool>({false, true, false, false}),
+              update({&mTop, &mDisjoint, &mMiddle, &mBottom}));
+}
+
+TEST_F(VisibilityCacheTest, recomputesLayersBelowReorderedLayers) {
+    update({&mTop, &mDisjoint, &mBottom});
+
+    EXPECT_EQ(std::vector<bool>({true, false, false}), update({&mDisjoint, &mTop, &mBottom}));
+}
+
+TEST_F(VisibilityCacheTest, recomputesAllLayersIfOutputChanged) {
+    update({&mTop, &mBottom});
+
+    mOutputState.viewport = Rect(0, 0, 500, 500);
+    EXPECT_EQ(std::vector<bool>({false, false}), update({&mTop, &mBottom}));
+}
+
+} // namespace
+} // namespace android::compositionengine
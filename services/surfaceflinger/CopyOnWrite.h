@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+namespace android {
+
+// Holds a value that is shared by all copies of the holder until one of them is edited, at which
+// point that copy gets its own value. Used for the heavy fields of Layer::State, which is copied
+// wholesale on every commit even though few of the fields usually change.
+//
+// Like the value it holds, a CopyOnWrite must not be read on one thread while it is being written
+// on another. Different copies may be used on different threads.
+template <typename T>
+class CopyOnWrite {
+public:
+    CopyOnWrite() : mValue(std::make_shared<T>()) {}
+    explicit CopyOnWrite(T value) : mValue(std::make_shared<T>(std::move(value))) {}
+
+    CopyOnWrite& operator=(T value) {
+        if (mValue.use_count() == 1) {
+            *mValue = std::move(value);
+        } else {
+            mValue = std::make_shared<T>(std::move(value));
+        }
+        return *this;
+    }
+
+    const T& get() const { return *mValue; }
+    const T& operator*() const { return *mValue; }
+    const T* operator->() const { return mValue.get(); }
+
+    // Returns the value for writing, copying it first if it is shared with other holders.
+    T& edit() {
+        if (mValue.use_count() != 1) {
+            mValue = std::make_shared<T>(*mValue);
+        }
+        return *mValue;
+    }
+
+    // Whether both holders refer to the same value, i.e. neither was edited since one was copied
+    // from the other.
+    bool isSharedWith(const CopyOnWrite& other) const { return mValue == other.mValue; }
+
+private:
+    std::shared_ptr<T> mValue;
+};
+
+} // namespace android
@@ -76,6 +76,14 @@ DisplayDevice::DisplayDevice(DisplayDeviceCreationArgs& args)
                 static_cast<uint32_t>(SurfaceFlinger::maxFrameBufferAcquiredBuffers));
     }
 
+    if (mFlinger->mFlattenStaticLayersFrameThreshold > 0 && !isVirtual()) {
+        mCompositionDisplay->flattenStaticLayers(mFlinger->mFlattenStaticLayersFrameThreshold);
+    }
+
+    if (mFlinger->mCacheLayerVisibility) {
+        mCompositionDisplay->cacheLayerVisibility(true);
+    }
+
     mCompositionDisplay->createDisplayColorProfile(
             compositionengine::DisplayColorProfileCreationArgs{args.hasWideColorGamut,
                                                                std::move(args.hdrCapabilities),
@@ -21,6 +21,7 @@
 #undef LOG_TAG
 #define LOG_TAG "HwcComposer"
 
+#include <android-base/stringprintf.h>
 #include <log/log.h>
 
 #include <algorithm>
@@ -245,6 +246,14 @@ std::string Composer::dumpDebugInfo()
         info = tmpInfo.c_str();
     });
 
+    const uint64_t executeCount = mExecuteCount;
+    const uint64_t totalCommandBytes = mTotalCommandBytes;
+    base::StringAppendF(&info,
+                        "\nComposer commands: %" PRIu64 " executed, %" PRIu64
+                        " bytes on average, %" PRIu32 " bytes at most\n",
+                        executeCount, executeCount ? totalCommandBytes / executeCount : 0,
+                        mMaxCommandBytes.load());
+
     return info;
 }
 
@@ -321,6 +330,7 @@ Error Composer::createVirtualDisplay(uint32_t width, uint32_t height,
 Error Composer::destroyVirtualDisplay(Display display)
 {
     auto ret = mClient->destroyVirtualDisplay(display);
+    mReader.eraseReturnData(display);
     return unwrapRet(ret);
 }
 
@@ -897,6 +907,13 @@ Error Composer::execute()
         return Error::NONE;
     }
 
+    const uint32_t commandBytes = commandLength * sizeof(uint32_t);
+    mExecuteCount++;
+    mTotalCommandBytes += commandBytes;
+    if (commandBytes > mMaxCommandBytes) {
+        mMaxCommandBytes = commandBytes;
+    }
+
     Error error = kDefaultError;
     hardware::Return<void> ret;
     auto hidl_callback = [&](const auto& tmpError, const auto& tmpOutChanged,
@@ -1427,6 +1444,7 @@ bool CommandReader::parseSelectDisplay(uint16_t length)
     }
 
     mCurrentReturnData = &mReturnData[read64()];
+    mCurrentReturnData->selected = true;
 
     return true;
 }
@@ -1553,21 +1571,59 @@ void CommandReader::resetData()
 {
     mErrors.clear();
 
-    for (auto& data : mReturnData) {
-        if (data.second.presentFence >= 0) {
-            close(data.second.presentFence);
-        }
-        for (auto fence : data.second.releaseFences) {
-            if (fence >= 0) {
-                close(fence);
-            }
-        }
+    for (auto& [display, data] : mReturnData) {
+        closeFences(data);
+
+        // Clear rather than destroy the data, so that the vectors keep their capacity.
+        data.selected = false;
+        data.displayRequests = 0;
+        data.changedLayers.clear();
+        data.compositionTypes.clear();
+        data.requestedLayers.clear();
+        data.requestMasks.clear();
+        data.presentFence = -1;
+        data.releasedLayers.clear();
+        data.releaseFences.clear();
+        data.presentOrValidateState = 0;
+        data.clientTargetProperty = {PixelFormat::RGBA_8888, Dataspace::UNKNOWN};
     }
 
-    mReturnData.clear();
     mCurrentReturnData = nullptr;
 }
 
+void CommandReader::closeFences(const ReturnData& data) {
+    if (data.presentFence >= 0) {
+        close(data.presentFence);
+    }
+    for (auto fence : data.releaseFences) {
+        if (fence >= 0) {
+            close(fence);
+        }
+    }
+}
+
+void CommandReader::eraseReturnData(Display display) {
+    auto found = mReturnData.find(display);
+    if (found == mReturnData.end()) {
+        return;
+    }
+    closeFences(found->second);
+    if (mCurrentReturnData == &found->second) {
+        mCurrentReturnData = nullptr;
+    }
+    mReturnData.erase(found);
+}
+
+CommandReader::ReturnData* CommandReader::findReturnData(Display display) {
+    auto found = mReturnData.find(display);
+    return found != mReturnData.end() && found->second.selected ? &found->second : nullptr;
+}
+
+const CommandReader::ReturnData* CommandReader::findReturnData(Display display) const {
+    auto found = mReturnData.find(display);
+    return found != mReturnData.end() && found->second.selected ? &found->second : nullptr;
+}
+
 std::vector<CommandReader::CommandError> CommandReader::takeErrors()
 {
     return std::move(mErrors);
@@ -1577,14 +1633,14 @@ bool CommandReader::hasChanges(Display display,
         uint32_t* outNumChangedCompositionTypes,
         uint32_t* outNumLayerRequestMasks) const
 {
-    auto found = mReturnData.find(display);
-    if (found == mReturnData.end()) {
+    const ReturnData* found = findReturnData(display);
+    if (!found) {
         *outNumChangedCompositionTypes = 0;
         *outNumLayerRequestMasks = 0;
         return false;
     }
 
-    const ReturnData& data = found->second;
+    const ReturnData& data = *found;
 
     *outNumChangedCompositionTypes = data.compositionTypes.size();
     *outNumLayerRequestMasks = data.requestMasks.size();
@@ -1596,90 +1652,98 @@ void CommandReader::takeChangedCompositionTypes(Display display,
         std::vector<Layer>* outLayers,
         std::vector<IComposerClient::Composition>* outTypes)
 {
-    auto found = mReturnData.find(display);
-    if (found == mReturnData.end()) {
+    ReturnData* found = findReturnData(display);
+    if (!found) {
         outLayers->clear();
         outTypes->clear();
         return;
     }
 
-    ReturnData& data = found->second;
+    ReturnData& data = *found;
 
-    *outLayers = std::move(data.changedLayers);
-    *outTypes = std::move(data.compositionTypes);
+    // Copy rather than move, so that the next parse does not need to allocate again.
+    outLayers->assign(data.changedLayers.begin(), data.changedLayers.end());
+    outTypes->assign(data.compositionTypes.begin(), data.compositionTypes.end());
+    data.changedLayers.clear();
+    data.compositionTypes.clear();
 }
 
 void CommandReader::takeDisplayRequests(Display display,
         uint32_t* outDisplayRequestMask, std::vector<Layer>* outLayers,
         std::vector<uint32_t>* outLayerRequestMasks)
 {
-    auto found = mReturnData.find(display);
-    if (found == mReturnData.end()) {
+    ReturnData* found = findReturnData(display);
+    if (!found) {
         *outDisplayRequestMask = 0;
         outLayers->clear();
         outLayerRequestMasks->clear();
         return;
     }
 
-    ReturnData& data = found->second;
+    ReturnData& data = *found;
 
     *outDisplayRequestMask = data.displayRequests;
-    *outLayers = std::move(data.requestedLayers);
-    *outLayerRequestMasks = std::move(data.requestMasks);
+    outLayers->assign(data.requestedLayers.begin(), data.requestedLayers.end());
+    outLayerRequestMasks->assign(data.requestMasks.begin(), data.requestMasks.end());
+    data.requestedLayers.clear();
+    data.requestMasks.clear();
 }
 
 void CommandReader::takeReleaseFences(Display display,
         std::vector<Layer>* outLayers, std::vector<int>* outReleaseFences)
 {
-    auto found = mReturnData.find(display);
-    if (found == mReturnData.end()) {
+    ReturnData* found = findReturnData(display);
+    if (!found) {
         outLayers->clear();
         outReleaseFences->clear();
         return;
     }
 
-    ReturnData& data = found->second;
+    ReturnData& data = *found;
 
-    *outLayers = std::move(data.releasedLayers);
-    *outReleaseFences = std::move(data.releaseFences);
+    // The caller takes ownership of the fences.
+    outLayers->assign(data.releasedLayers.begin(), data.releasedLayers.end());
+    outReleaseFences->assign(data.releaseFences.begin(), data.releaseFences.end());
+    data.releasedLayers.clear();
+    data.releaseFences.clear();
 }
 
 void CommandReader::takePresentFence(Display display, int* outPresentFence)
 {
-    auto found = mReturnData.find(display);
-    if (found == mReturnData.end()) {
+    ReturnData* found = findReturnData(display);
+    if (!found) {
         *outPresentFence = -1;
         return;
     }
 
-    ReturnData& data = found->second;
+    ReturnData& data = *found;
 
     *outPresentFence = data.presentFence;
     data.presentFence = -1;
 }
 
 void CommandReader::takePresentOrValidateStage(Display display, uint32_t* state) {
-    auto found = mReturnData.find(display);
-    if (found == mReturnData.end()) {
+    ReturnData* found = findReturnData(display);
+    if (!found) {
         *state= -1;
         return;
     }
-    ReturnData& data = found->second;
+    ReturnData& data = *found;
     *state = data.presentOrValidateState;
 }
 
 void CommandReader::takeClientTargetProperty(
         Display display, IComposerClient::ClientTargetProperty* outClientTargetProperty) {
-    auto found = mReturnData.find(display);
+    ReturnData* found = findReturnData(display);
 
     // If not found, return the default values.
-    if (found == mReturnData.end()) {
+    if (!found) {
         outClientTargetProperty->pixelFormat = PixelFormat::RGBA_8888;
         outClientTargetProperty->dataspace = Dataspace::UNKNOWN;
         return;
     }
 
-    ReturnData& data = found->second;
+    ReturnData& data = *found;
     *outClientTargetProperty = data.clientTargetProperty;
 }
 
@@ -17,6 +17,7 @@
 #ifndef ANDROID_SF_COMPOSER_HAL_H
 #define ANDROID_SF_COMPOSER_HAL_H
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -288,6 +289,9 @@ public:
     void takeClientTargetProperty(Display display,
                                   IComposerClient::ClientTargetProperty* outClientTargetProperty);
 
+    // Drop the data kept for a display that no longer exists.
+    void eraseReturnData(Display display);
+
 private:
     void resetData();
 
@@ -300,7 +304,19 @@ private:
     bool parseSetPresentOrValidateDisplayResult(uint16_t length);
     bool parseSetClientTargetProperty(uint16_t length);
 
+    struct ReturnData;
+    static void closeFences(const ReturnData& data);
+
+    // Returns the data returned for the display by the last parse, or nullptr.
+    ReturnData* findReturnData(Display display);
+    const ReturnData* findReturnData(Display display) const;
+
+    // The return data of each display is kept across parses, so that its vectors keep their
+    // capacity from one frame to the next.
     struct ReturnData {
+        // Whether the display was selected by the last parse. Otherwise the rest is stale.
+        bool selected = false;
+
         uint32_t displayRequests = 0;
 
         std::vector<Layer> changedLayers;
@@ -532,6 +548,11 @@ private:
     CommandWriter mWriter;
     CommandReader mReader;
 
+    // Statistics on the commands sent by execute(), for dumpsys.
+    std::atomic<uint64_t> mExecuteCount{0};
+    std::atomic<uint64_t> mTotalCommandBytes{0};
+    std::atomic<uint32_t> mMaxCommandBytes{0};
+
     // When true, the we attach to the vr_hwcomposer service instead of the
     // hwcomposer. This allows us to redirect surfaces to 3d surfaces in vr.
     const bool mIsUsingVrComposer;
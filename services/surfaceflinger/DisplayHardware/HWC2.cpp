@@ -29,6 +29,7 @@
 #include <ui/Fence.h>
 #include <ui/FloatRect.h>
 #include <ui/GraphicBuffer.h>
+#include <utils/Trace.h>
 
 #include <android/configuration.h>
 
@@ -101,7 +102,11 @@ namespace impl {
 Display::Display(android::Hwc2::Composer& composer,
                  const std::unordered_set<Capability>& capabilities, HWDisplayId id,
                  DisplayType type)
-      : mComposer(composer), mCapabilities(capabilities), mId(id), mType(type) {
+      : mComposer(composer),
+        mCapabilities(capabilities),
+        mId(id),
+        mType(type),
+        mElidedLayerCommandsTraceName("HWC elided layer commands " + std::to_string(id)) {
     ALOGV("Created display %" PRIu64, id);
 }
 
@@ -149,7 +154,8 @@ Error Display::createLayer(HWC2::Layer** outLayer) {
         return error;
     }
 
-    auto layer = std::make_unique<impl::Layer>(mComposer, mCapabilities, mId, layerId);
+    auto layer = std::make_unique<impl::Layer>(mComposer, mCapabilities, mId, layerId,
+                                               mLayerCommandCounts);
     *outLayer = layer.get();
     mLayers.emplace(layerId, std::move(layer));
     return Error::NONE;
@@ -484,6 +490,7 @@ Error Display::present(sp<Fence>* outPresentFence)
     }
 
     *outPresentFence = new Fence(presentFenceFd);
+    traceFrameLayerCommandCounts();
     return Error::NONE;
 }
 
@@ -637,6 +644,7 @@ Error Display::presentOrValidate(uint32_t* outNumTypes, uint32_t* outNumRequests
 
     if (*state == 1) {
         *outPresentFence = new Fence(presentFenceFd);
+        traceFrameLayerCommandCounts();
     }
 
     if (*state == 0) {
@@ -736,7 +744,13 @@ void Display::loadConfigs()
 
 // Other Display methods
 
-HWC2::Layer* Display::getLayerById(HWLayerId id) const {
+HWC2::void Display::traceFrameLayerCommandCounts() {
+    const uint64_t elided = mLayerCommandCounts.elided - mPresentedLayerCommandCounts.elided;
+    ATRACE_INT(mElidedLayerCommandsTraceName.c_str(), static_cast<int32_t>(elided));
+    mPresentedLayerCommandCounts = mLayerCommandCounts;
+}
+
+Layer* Display::getLayerById(HWLayerId id) const {
     if (mLayers.count(id) == 0) {
         return nullptr;
     }
@@ -752,11 +766,12 @@ Layer::~Layer() = default;
 namespace impl {
 
 Layer::Layer(android::Hwc2::Composer& composer, const std::unordered_set<Capability>& capabilities,
-             HWDisplayId displayId, HWLayerId layerId)
+             HWDisplayId displayId, HWLayerId layerId, LayerCommandCounts& commandCounts)
       : mComposer(composer),
         mCapabilities(capabilities),
         mDisplayId(displayId),
         mId(layerId),
+        mCommandCounts(commandCounts),
         mColorMatrix(android::mat4()) {
     ALOGV("Created layer %" PRIu64 " on display %" PRIu64, layerId, displayId);
 }
@@ -771,6 +786,16 @@ Layer::~Layer()
              mDisplayId, mId, to_string(error).c_str(), intError);
 }
 
+Error Layer::elideCommand() {
+    mCommandCounts.elided++;
+    return Error::NONE;
+}
+
+Error Layer::countSentCommand(Error error) {
+    mCommandCounts.sent++;
+    return error;
+}
+
 Error Layer::setCursorPosition(int32_t x, int32_t y)
 {
     auto intError = mComposer.setCursorPosition(mDisplayId, mId, x, y);
@@ -781,21 +806,22 @@ Error Layer::setBuffer(uint32_t slot, const sp<GraphicBuffer>& buffer,
         const sp<Fence>& acquireFence)
 {
     if (buffer == nullptr && mBufferSlot == slot) {
-        return Error::NONE;
+        return elideCommand();
     }
     mBufferSlot = slot;
 
     int32_t fenceFd = acquireFence->dup();
     auto intError = mComposer.setLayerBuffer(mDisplayId, mId, slot, buffer,
                                              fenceFd);
-    return static_cast<Error>(intError);
+    mCommandCounts.buffersSent++;
+    return countSentCommand(static_cast<Error>(intError));
 }
 
 Error Layer::setSurfaceDamage(const Region& damage)
 {
     if (damage.isRect() && mDamageRegion.isRect() &&
         (damage.getBounds() == mDamageRegion.getBounds())) {
-        return Error::NONE;
+        return elideCommand();
     }
     mDamageRegion = damage;
 
@@ -818,41 +844,57 @@ Error Layer::setSurfaceDamage(const Region& damage)
         intError = mComposer.setLayerSurfaceDamage(mDisplayId, mId, hwcRects);
     }
 
-    return static_cast<Error>(intError);
+    mCommandCounts.damageRegionsSent++;
+    return countSentCommand(static_cast<Error>(intError));
 }
 
 Error Layer::setBlendMode(BlendMode mode)
 {
+    if (mBlendMode == mode) {
+        return elideCommand();
+    }
     auto intError = mComposer.setLayerBlendMode(mDisplayId, mId, mode);
-    return static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
+    if (error == Error::NONE) {
+        mBlendMode = mode;
+    }
+    return error;
 }
 
 Error Layer::setColor(Color color) {
+    if (mColor == color) {
+        return elideCommand();
+    }
     auto intError = mComposer.setLayerColor(mDisplayId, mId, color);
-    return static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
+    if (error == Error::NONE) {
+        mColor = color;
+    }
+    return error;
 }
 
 Error Layer::setCompositionType(Composition type)
 {
     auto intError = mComposer.setLayerCompositionType(mDisplayId, mId, type);
-    return static_cast<Error>(intError);
+    mCommandCounts.compositionTypesSent++;
+    return countSentCommand(static_cast<Error>(intError));
 }
 
 Error Layer::setDataspace(Dataspace dataspace)
 {
     if (dataspace == mDataSpace) {
-        return Error::NONE;
+        return elideCommand();
     }
     mDataSpace = dataspace;
     auto intError = mComposer.setLayerDataspace(mDisplayId, mId, mDataSpace);
-    return static_cast<Error>(intError);
+    return countSentCommand(static_cast<Error>(intError));
 }
 
 Error Layer::setPerFrameMetadata(const int32_t supportedPerFrameMetadata,
         const android::HdrMetadata& metadata)
 {
     if (metadata == mHdrMetadata) {
-        return Error::NONE;
+        return elideCommand();
     }
 
     mHdrMetadata = metadata;
@@ -890,8 +932,8 @@ Error Layer::setPerFrameMetadata(const int32_t supportedPerFrameMetadata,
                                    mHdrMetadata.cta8613.maxFrameAverageLightLevel}});
     }
 
-    Error error = static_cast<Error>(
-            mComposer.setLayerPerFrameMetadata(mDisplayId, mId, perFrameMetadatas));
+    Error error = countSentCommand(static_cast<Error>(
+            mComposer.setLayerPerFrameMetadata(mDisplayId, mId, perFrameMetadatas)));
 
     if (validTypes & HdrMetadata::HDR10PLUS) {
         if (CC_UNLIKELY(mHdrMetadata.hdr10plus.size() == 0)) {
@@ -901,8 +943,8 @@ Error Layer::setPerFrameMetadata(const int32_t supportedPerFrameMetadata,
         std::vector<Hwc2::PerFrameMetadataBlob> perFrameMetadataBlobs;
         perFrameMetadataBlobs.push_back(
                 {Hwc2::PerFrameMetadataKey::HDR10_PLUS_SEI, mHdrMetadata.hdr10plus});
-        Error setMetadataBlobsError = static_cast<Error>(
-                mComposer.setLayerPerFrameMetadataBlobs(mDisplayId, mId, perFrameMetadataBlobs));
+        Error setMetadataBlobsError = countSentCommand(static_cast<Error>(
+                mComposer.setLayerPerFrameMetadataBlobs(mDisplayId, mId, perFrameMetadataBlobs)));
         if (error == Error::NONE) {
             return setMetadataBlobsError;
         }
@@ -912,16 +954,30 @@ Error Layer::setPerFrameMetadata(const int32_t supportedPerFrameMetadata,
 
 Error Layer::setDisplayFrame(const Rect& frame)
 {
+    if (mDisplayFrame == frame) {
+        return elideCommand();
+    }
     Hwc2::IComposerClient::Rect hwcRect{frame.left, frame.top,
         frame.right, frame.bottom};
     auto intError = mComposer.setLayerDisplayFrame(mDisplayId, mId, hwcRect);
-    return static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
+    if (error == Error::NONE) {
+        mDisplayFrame = frame;
+    }
+    return error;
 }
 
 Error Layer::setPlaneAlpha(float alpha)
 {
+    if (mPlaneAlpha == alpha) {
+        return elideCommand();
+    }
     auto intError = mComposer.setLayerPlaneAlpha(mDisplayId, mId, alpha);
-    return static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
+    if (error == Error::NONE) {
+        mPlaneAlpha = alpha;
+    }
+    return error;
 }
 
 Error Layer::setSidebandStream(const native_handle_t* stream)
@@ -931,30 +987,51 @@ Error Layer::setSidebandStream(const native_handle_t* stream)
                 "device supports sideband streams");
         return Error::UNSUPPORTED;
     }
+    if (mSidebandStream == stream) {
+        return elideCommand();
+    }
     auto intError = mComposer.setLayerSidebandStream(mDisplayId, mId, stream);
-    return static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
+    if (error == Error::NONE) {
+        mSidebandStream = stream;
+    }
+    return error;
 }
 
 Error Layer::setSourceCrop(const FloatRect& crop)
 {
+    if (mSourceCrop == crop) {
+        return elideCommand();
+    }
     Hwc2::IComposerClient::FRect hwcRect{
         crop.left, crop.top, crop.right, crop.bottom};
     auto intError = mComposer.setLayerSourceCrop(mDisplayId, mId, hwcRect);
-    return static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
+    if (error == Error::NONE) {
+        mSourceCrop = crop;
+    }
+    return error;
 }
 
 Error Layer::setTransform(Transform transform)
 {
+    if (mTransform == transform) {
+        return elideCommand();
+    }
     auto intTransform = static_cast<Hwc2::Transform>(transform);
     auto intError = mComposer.setLayerTransform(mDisplayId, mId, intTransform);
-    return static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
+    if (error == Error::NONE) {
+        mTransform = transform;
+    }
+    return error;
 }
 
 Error Layer::setVisibleRegion(const Region& region)
 {
     if (region.isRect() && mVisibleRegion.isRect() &&
         (region.getBounds() == mVisibleRegion.getBounds())) {
-        return Error::NONE;
+        return elideCommand();
     }
     mVisibleRegion = region;
 
@@ -968,28 +1045,43 @@ Error Layer::setVisibleRegion(const Region& region)
     }
 
     auto intError = mComposer.setLayerVisibleRegion(mDisplayId, mId, hwcRects);
-    return static_cast<Error>(intError);
+    return countSentCommand(static_cast<Error>(intError));
 }
 
 Error Layer::setZOrder(uint32_t z)
 {
+    if (mZOrder == z) {
+        return elideCommand();
+    }
     auto intError = mComposer.setLayerZOrder(mDisplayId, mId, z);
-    return static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
+    if (error == Error::NONE) {
+        mZOrder = z;
+    }
+    return error;
 }
 
 Error Layer::setInfo(uint32_t type, uint32_t appId)
 {
+  const auto info = std::make_pair(type, appId);
+  if (mInfo == info) {
+      return elideCommand();
+  }
   auto intError = mComposer.setLayerInfo(mDisplayId, mId, type, appId);
-  return static_cast<Error>(intError);
+  Error error = countSentCommand(static_cast<Error>(intError));
+  if (error == Error::NONE) {
+      mInfo = info;
+  }
+  return error;
 }
 
 // Composer HAL 2.3
 Error Layer::setColorTransform(const android::mat4& matrix) {
     if (matrix == mColorMatrix) {
-        return Error::NONE;
+        return elideCommand();
     }
     auto intError = mComposer.setLayerColorTransform(mDisplayId, mId, matrix.asArray());
-    Error error = static_cast<Error>(intError);
+    Error error = countSentCommand(static_cast<Error>(intError));
     if (error != Error::NONE) {
         return error;
     }
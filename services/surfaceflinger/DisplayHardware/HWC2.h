@@ -28,6 +28,7 @@
 
 #include <functional>
 #include <future>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -52,6 +53,18 @@ class Layer;
 
 namespace hal = android::hardware::graphics::composer::hal;
 
+// Counts the layer commands sent to the composer, and those that were not sent since the composer
+// already had the values they would have set.
+struct LayerCommandCounts {
+    uint64_t sent = 0;
+    uint64_t elided = 0;
+
+    // The sent commands which set a buffer, its damage, and a composition type.
+    uint64_t buffersSent = 0;
+    uint64_t damageRegionsSent = 0;
+    uint64_t compositionTypesSent = 0;
+};
+
 // Implement this interface to receive hardware composer events.
 //
 // These callback functions will generally be called on a hwbinder thread, but
@@ -160,6 +173,9 @@ public:
     virtual void setConnected(bool connected) = 0; // For use by Device only
     virtual const std::unordered_set<hal::DisplayCapability>& getCapabilities() const = 0;
     virtual bool isVsyncPeriodSwitchSupported() const = 0;
+    // Returns the commands of the layers of this display since it was created.
+    virtual LayerCommandCounts getLayerCommandCounts() const = 0;
+    virtual size_t getLayerCount() const = 0;
 
     [[clang::warn_unused_result]] virtual hal::Error acceptChanges() = 0;
     [[clang::warn_unused_result]] virtual hal::Error createLayer(Layer** outLayer) = 0;
@@ -317,9 +333,13 @@ public:
         return mDisplayCapabilities;
     };
     virtual bool isVsyncPeriodSwitchSupported() const override;
+    LayerCommandCounts getLayerCommandCounts() const override { return mLayerCommandCounts; }
+    size_t getLayerCount() const override { return mLayers.size(); }
 
 private:
     int32_t getAttribute(hal::HWConfigId configId, hal::Attribute attribute);
+    // Traces the layer commands of the frame that was just presented.
+    void traceFrameLayerCommandCounts();
     void loadConfig(hal::HWConfigId configId);
     void loadConfigs();
 
@@ -344,6 +364,11 @@ private:
     std::unordered_map<hal::HWLayerId, std::unique_ptr<Layer>> mLayers;
     std::unordered_map<hal::HWConfigId, std::shared_ptr<const Config>> mConfigs;
 
+    // Updated by the layers of this display.
+    LayerCommandCounts mLayerCommandCounts;
+    LayerCommandCounts mPresentedLayerCommandCounts;
+    const std::string mElidedLayerCommandsTraceName;
+
     std::once_flag mDisplayCapabilityQueryFlag;
     std::unordered_set<hal::DisplayCapability> mDisplayCapabilities;
 };
@@ -399,7 +424,7 @@ class Layer : public HWC2::Layer {
 public:
     Layer(android::Hwc2::Composer& composer,
           const std::unordered_set<hal::Capability>& capabilities, hal::HWDisplayId displayId,
-          hal::HWLayerId layerId);
+          hal::HWLayerId layerId, LayerCommandCounts& commandCounts);
     ~Layer() override;
 
     hal::HWLayerId getId() const override { return mId; }
@@ -432,6 +457,11 @@ public:
                                        const std::vector<uint8_t>& value) override;
 
 private:
+    // Counts a command that does not need to be sent, since the composer already has its value.
+    hal::Error elideCommand();
+    // Counts a command that was sent, and returns its result.
+    hal::Error countSentCommand(hal::Error error);
+
     // These are references to data owned by HWC2::Device, which will outlive
     // this HWC2::Layer, so these references are guaranteed to be valid for
     // the lifetime of this object.
@@ -441,6 +471,9 @@ private:
     hal::HWDisplayId mDisplayId;
     hal::HWLayerId mId;
 
+    // Owned by the HWC2::Display this layer belongs to, which destroys its layers first.
+    LayerCommandCounts& mCommandCounts;
+
     // Cached HWC2 data, to ensure the same commands aren't sent to the HWC
     // multiple times.
     android::Region mVisibleRegion = android::Region::INVALID_REGION;
@@ -449,6 +482,15 @@ private:
     android::HdrMetadata mHdrMetadata;
     android::mat4 mColorMatrix;
     uint32_t mBufferSlot;
+    std::optional<hal::BlendMode> mBlendMode;
+    std::optional<hal::Color> mColor;
+    std::optional<android::Rect> mDisplayFrame;
+    std::optional<float> mPlaneAlpha;
+    std::optional<const native_handle_t*> mSidebandStream;
+    std::optional<android::FloatRect> mSourceCrop;
+    std::optional<hal::Transform> mTransform;
+    std::optional<uint32_t> mZOrder;
+    std::optional<std::pair<uint32_t, uint32_t>> mInfo;
 };
 
 } // namespace impl
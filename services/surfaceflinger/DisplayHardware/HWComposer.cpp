@@ -26,9 +26,12 @@
 
 #include "HWComposer.h"
 
+#include <algorithm>
+
 #include <compositionengine/Output.h>
 #include <compositionengine/OutputLayer.h>
 #include <compositionengine/impl/OutputLayerCompositionState.h>
+#include <android-base/stringprintf.h>
 #include <log/log.h>
 #include <ui/DebugUtils.h>
 #include <ui/GraphicBuffer.h>
@@ -500,18 +503,38 @@ status_t HWComposer::getDeviceCompositionChanges(
 
     hal::Error error = hal::Error::NONE;
 
+    // Describe how the layers changed since the previous frame, from the commands this frame
+    // sent to HWC.
+    const auto counts = hwcDisplay->getLayerCommandCounts();
+    const auto& lastCounts = displayData.lastLayerCommandCounts;
+    const uint64_t buffers = counts.buffersSent - lastCounts.buffersSent;
+    const uint64_t damageRegions = counts.damageRegionsSent - lastCounts.damageRegionsSent;
+    const uint64_t compositionTypes = counts.compositionTypesSent - lastCounts.compositionTypesSent;
+    const uint64_t otherCommands =
+            counts.sent - lastCounts.sent - buffers - damageRegions - compositionTypes;
+    Hwc2::PresentOrValidatePredictor::Signature signature;
+    signature.layerCount = hwcDisplay->getLayerCount();
+    signature.bufferUpdates = static_cast<uint32_t>(
+            std::min<uint64_t>(buffers, Hwc2::PresentOrValidatePredictor::kMaxBufferUpdates));
+    signature.compositionTypesChanged = compositionTypes > 0;
+    signature.geometryChanged = otherCommands > 0;
+    displayData.lastLayerCommandCounts = counts;
+
     // First try to skip validate altogether when there is no client
-    // composition.  When there is client composition, since we haven't
-    // rendered to the client target yet, we should not attempt to skip
-    // validate.
+    // composition, unless HWC has kept asking for a validate for similar
+    // frames. When there is client composition, since we haven't rendered to
+    // the client target yet, we should not attempt to skip validate.
     displayData.validateWasSkipped = false;
-    if (!frameUsesClientComposition) {
+    auto& predictor = displayData.presentOrValidatePredictor;
+    if (!frameUsesClientComposition && predictor.shouldTryPresentOrValidate(signature)) {
         sp<Fence> outPresentFence;
         uint32_t state = UINT32_MAX;
+        const nsecs_t start = systemTime();
         error = hwcDisplay->presentOrValidate(&numTypes, &numRequests, &outPresentFence , &state);
         if (!hasChangesError(error)) {
             RETURN_IF_HWC_ERROR_FOR("presentOrValidate", error, displayId, UNKNOWN_ERROR);
         }
+        predictor.recordPresentOrValidate(signature, state == 1, systemTime() - start);
         if (state == 1) { //Present Succeeded.
             std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
             error = hwcDisplay->getReleaseFences(&releaseFences);
@@ -523,7 +546,9 @@ status_t HWComposer::getDeviceCompositionChanges(
         }
         // Present failed but Validate ran.
     } else {
+        const nsecs_t start = systemTime();
         error = hwcDisplay->validate(&numTypes, &numRequests);
+        predictor.recordValidate(systemTime() - start);
     }
     ALOGV("SkipValidate failed, Falling back to SLOW validate/present");
     if (!hasChangesError(error)) {
@@ -863,6 +888,18 @@ const std::unordered_map<std::string, bool>& HWComposer::getSupportedLayerGeneri
 
 void HWComposer::dump(std::string& result) const {
     result.append(mComposer->dumpDebugInfo());
+
+    for (const auto& [displayId, displayData] : mDisplayData) {
+        if (!displayData.hwcDisplay) {
+            continue;
+        }
+        const auto counts = displayData.hwcDisplay->getLayerCommandCounts();
+        base::StringAppendF(&result,
+                            "Display %s layer commands: %" PRIu64 " sent, %" PRIu64
+                            " elided as redundant\n",
+                            to_string(displayId).c_str(), counts.sent, counts.elided);
+        displayData.presentOrValidatePredictor.dump(result);
+    }
 }
 
 std::optional<DisplayId> HWComposer::toPhysicalDisplayId(hal::HWDisplayId hwcDisplayId) const {
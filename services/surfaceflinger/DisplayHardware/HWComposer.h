@@ -41,6 +41,7 @@
 #include "DisplayIdentification.h"
 #include "HWC2.h"
 #include "Hal.h"
+#include "PresentOrValidatePredictor.h"
 
 namespace android {
 
@@ -393,6 +394,10 @@ private:
         bool validateWasSkipped;
         hal::Error presentError;
 
+        Hwc2::PresentOrValidatePredictor presentOrValidatePredictor;
+        // The layer commands sent before the previous frame was validated.
+        HWC2::LayerCommandCounts lastLayerCommandCounts;
+
         bool vsyncTraceToggle = false;
 
         std::mutex vsyncEnabledLock;
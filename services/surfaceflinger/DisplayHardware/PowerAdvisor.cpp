@@ -22,6 +22,7 @@
 #include <cinttypes>
 
 #include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 #include <utils/Log.h>
 #include <utils/Mutex.h>
 
@@ -47,7 +48,9 @@ using V1_3::PowerHint;
 using android::hardware::power::Boost;
 using android::hardware::power::IPower;
 using android::hardware::power::Mode;
+using base::GetBoolProperty;
 using base::GetIntProperty;
+using base::StringAppendF;
 using scheduler::OneShotTimer;
 
 PowerAdvisor::~PowerAdvisor() = default;
@@ -59,10 +62,25 @@ int32_t getUpdateTimeout() {
     return timeout;
 }
 
+// A layer RenderEngine composites costs this many times as much as one HWC composites.
+constexpr float CLIENT_COMPOSITION_WEIGHT = 4.0f;
+// Frames estimated to take more than this fraction of the vsync period are expensive.
+constexpr float EXPENSIVE_FRAME_FRACTION = 0.8f;
+// Light frames in a row after which EXPENSIVE_RENDERING is released.
+constexpr int LIGHT_FRAMES_BEFORE_RELEASE = 10;
+// Weight of the newest frame in the learned composition time per workload unit.
+constexpr float WORKLOAD_SMOOTHING = 0.2f;
+constexpr size_t MAX_RECENT_DECISIONS = 16;
+
+float toMillis(nsecs_t duration) {
+    return static_cast<float>(duration) / 1e6f;
+}
+
 } // namespace
 
 PowerAdvisor::PowerAdvisor()
-      : mUseUpdateImminentTimer(getUpdateTimeout() > 0),
+      : mUseWorkloadHints(GetBoolProperty("debug.sf.power_workload_hints", false)),
+        mUseUpdateImminentTimer(getUpdateTimeout() > 0),
         mUpdateImminentTimer(
                 OneShotTimer::Interval(getUpdateTimeout()),
                 /* resetCallback */ [this] { mSendUpdateImminent.store(false); },
@@ -83,7 +101,12 @@ void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expec
         mExpensiveDisplays.erase(displayId);
     }
 
-    const bool expectsExpensiveRendering = !mExpensiveDisplays.empty();
+    updateExpensiveRendering();
+}
+
+void PowerAdvisor::updateExpensiveRendering() {
+    const bool expectsExpensiveRendering =
+            !mExpensiveDisplays.empty() || mPredictedExpensiveRendering;
     if (mNotifiedExpensiveRendering != expectsExpensiveRendering) {
         std::lock_guard lock(mPowerHalMutex);
         HalWrapper* const halWrapper = getPowerHal();
@@ -127,6 +150,86 @@ void PowerAdvisor::notifyDisplayUpdateImminent() {
     }
 }
 
+void PowerAdvisor::notifyFrameWorkload(const FrameWorkload& workload) {
+    // Like notifyDisplayUpdateImminent, avoid an early-boot dependency on Power HAL
+    if (!mUseWorkloadHints || !mBootFinished.load()) {
+        return;
+    }
+
+    const float units = static_cast<float>(workload.layerCount) +
+            CLIENT_COMPOSITION_WEIGHT * static_cast<float>(workload.clientCompositionLayerCount);
+    FrameDecision decision{workload.layerCount, workload.clientCompositionLayerCount};
+    {
+        std::lock_guard lock(mWorkloadMutex);
+
+        // Record how the previous frame went, and learn from it.
+        if (!mRecentDecisions.empty() && mPendingWorkloadUnits > 0.0f &&
+            workload.previousFrameDuration > 0) {
+            FrameDecision& previous = mRecentDecisions.back();
+            previous.duration = workload.previousFrameDuration;
+            previous.missed = workload.previousFrameMissed;
+            if (previous.missed) {
+                (previous.expensive ? mMissedExpensiveFrameCount : mMissedLightFrameCount)++;
+            }
+
+            const float sample =
+                    static_cast<float>(workload.previousFrameDuration) / mPendingWorkloadUnits;
+            mDurationPerWorkloadUnit = mDurationPerWorkloadUnit == 0.0f
+                    ? sample
+                    : mDurationPerWorkloadUnit +
+                            WORKLOAD_SMOOTHING * (sample - mDurationPerWorkloadUnit);
+        }
+
+        decision.estimatedDuration = static_cast<nsecs_t>(mDurationPerWorkloadUnit * units);
+        decision.expensive = workload.previousFrameMissed ||
+                static_cast<float>(decision.estimatedDuration) >
+                        EXPENSIVE_FRAME_FRACTION * static_cast<float>(workload.vsyncPeriod);
+
+        mPendingWorkloadUnits = units;
+        mFrameCount++;
+        if (decision.expensive) {
+            mExpensiveFrameCount++;
+        }
+        mRecentDecisions.push_back(decision);
+        if (mRecentDecisions.size() > MAX_RECENT_DECISIONS) {
+            mRecentDecisions.pop_front();
+        }
+    }
+
+    if (decision.expensive) {
+        mLightFrameCount = 0;
+        mPredictedExpensiveRendering = true;
+    } else if (mPredictedExpensiveRendering &&
+               ++mLightFrameCount >= LIGHT_FRAMES_BEFORE_RELEASE) {
+        mPredictedExpensiveRendering = false;
+    }
+
+    updateExpensiveRendering();
+}
+
+void PowerAdvisor::dump(std::string& result) const {
+    StringAppendF(&result, "Workload hints: %s\n", mUseWorkloadHints ? "on" : "off");
+    if (!mUseWorkloadHints) {
+        return;
+    }
+
+    std::lock_guard lock(mWorkloadMutex);
+    StringAppendF(&result,
+                  "  %.3f us per workload unit, frames=%zu, expensive=%zu, "
+                  "missed while expensive=%zu, missed while light=%zu\n",
+                  mDurationPerWorkloadUnit / 1e3f, mFrameCount, mExpensiveFrameCount,
+                  mMissedExpensiveFrameCount, mMissedLightFrameCount);
+    result.append("  Recent frames, oldest first:\n");
+    for (const auto& decision : mRecentDecisions) {
+        StringAppendF(&result,
+                      "    layers=%zu client=%zu estimate=%.2fms %s duration=%.2fms%s\n",
+                      decision.layerCount, decision.clientCompositionLayerCount,
+                      toMillis(decision.estimatedDuration),
+                      decision.expensive ? "expensive" : "light", toMillis(decision.duration),
+                      decision.missed ? " missed" : "");
+    }
+}
+
 class HidlPowerHalWrapper : public PowerAdvisor::HalWrapper {
 public:
     HidlPowerHalWrapper(sp<V1_3::IPower> powerHal) : mPowerHal(std::move(powerHal)) {}
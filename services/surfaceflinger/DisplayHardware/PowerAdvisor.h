@@ -16,11 +16,16 @@
 
 #pragma once
 
+#include <android-base/thread_annotations.h>
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
+
 #include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
 #include <unordered_set>
 
-#include <utils/Mutex.h>
-
 #include "../Scheduler/OneShotTimer.h"
 #include "DisplayIdentification.h"
 
@@ -29,11 +34,27 @@ namespace Hwc2 {
 
 class PowerAdvisor {
 public:
+    // The frame about to be composited, and how the previous one went.
+    struct FrameWorkload {
+        size_t layerCount = 0;
+        // Layers that RenderEngine composited in the previous frame.
+        size_t clientCompositionLayerCount = 0;
+        nsecs_t vsyncPeriod = 0;
+        // Composition time of the previous frame, or 0 if there was none.
+        nsecs_t previousFrameDuration = 0;
+        bool previousFrameMissed = false;
+    };
+
     virtual ~PowerAdvisor();
 
     virtual void onBootFinished() = 0;
     virtual void setExpensiveRenderingExpected(DisplayId displayId, bool expected) = 0;
     virtual void notifyDisplayUpdateImminent() = 0;
+    // Called before each frame is composited, so that the HAL can be told to boost before a
+    // frame expected to be heavy, rather than after one was missed.
+    virtual void notifyFrameWorkload(const FrameWorkload&) = 0;
+
+    virtual void dump(std::string& result) const = 0;
 };
 
 namespace impl {
@@ -56,17 +77,48 @@ public:
     void onBootFinished() override;
     void setExpensiveRenderingExpected(DisplayId displayId, bool expected) override;
     void notifyDisplayUpdateImminent() override;
+    void notifyFrameWorkload(const FrameWorkload&) override;
+
+    void dump(std::string& result) const override;
 
 private:
+    // A hint decision, and once the frame is done, its outcome.
+    struct FrameDecision {
+        size_t layerCount = 0;
+        size_t clientCompositionLayerCount = 0;
+        nsecs_t estimatedDuration = 0;
+        bool expensive = false;
+        nsecs_t duration = 0;
+        bool missed = false;
+    };
+
     HalWrapper* getPowerHal() REQUIRES(mPowerHalMutex);
     bool mReconnectPowerHal GUARDED_BY(mPowerHalMutex) = false;
     std::mutex mPowerHalMutex;
 
     std::atomic_bool mBootFinished = false;
 
+    // Sends EXPENSIVE_RENDERING if a display or the workload estimate expects it.
+    void updateExpensiveRendering();
+
     std::unordered_set<DisplayId> mExpensiveDisplays;
     bool mNotifiedExpensiveRendering = false;
 
+    const bool mUseWorkloadHints;
+    bool mPredictedExpensiveRendering = false;
+    // Frames in a row estimated to be light, to avoid toggling the hint on every other frame.
+    int mLightFrameCount = 0;
+
+    mutable std::mutex mWorkloadMutex;
+    // Composition time per unit of workload, learned from the frames composited so far.
+    float mDurationPerWorkloadUnit GUARDED_BY(mWorkloadMutex) = 0.0f;
+    float mPendingWorkloadUnits GUARDED_BY(mWorkloadMutex) = 0.0f;
+    std::deque<FrameDecision> mRecentDecisions GUARDED_BY(mWorkloadMutex);
+    size_t mFrameCount GUARDED_BY(mWorkloadMutex) = 0;
+    size_t mExpensiveFrameCount GUARDED_BY(mWorkloadMutex) = 0;
+    size_t mMissedExpensiveFrameCount GUARDED_BY(mWorkloadMutex) = 0;
+    size_t mMissedLightFrameCount GUARDED_BY(mWorkloadMutex) = 0;
+
     const bool mUseUpdateImminentTimer;
     std::atomic_bool mSendUpdateImminent = true;
     scheduler::OneShotTimer mUpdateImminentTimer;
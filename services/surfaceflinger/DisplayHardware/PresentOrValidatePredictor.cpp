@@ -0,0 +1,105 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PresentOrValidatePredictor.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <functional>
+
+#include <android-base/stringprintf.h>
+
+namespace android {
+namespace Hwc2 {
+
+bool PresentOrValidatePredictor::Signature::operator==(const Signature& other) const {
+    return layerCount == other.layerCount && bufferUpdates == other.bufferUpdates &&
+            compositionTypesChanged == other.compositionTypesChanged &&
+            geometryChanged == other.geometryChanged;
+}
+
+size_t PresentOrValidatePredictor::SignatureHash::operator()(const Signature& signature) const {
+    const size_t flags = (signature.compositionTypesChanged ? 1u : 0u) |
+            (signature.geometryChanged ? 2u : 0u);
+    return std::hash<size_t>{}((signature.layerCount << 6) ^ (signature.bufferUpdates << 2) ^
+                               flags);
+}
+
+bool PresentOrValidatePredictor::shouldTryPresentOrValidate(const Signature& signature) {
+    if (mPredictions.size() >= kMaxSignatures && mPredictions.count(signature) == 0) {
+        mPredictions.clear();
+    }
+
+    auto& prediction = mPredictions[signature];
+    if (prediction.confidence > 0) {
+        return true;
+    }
+
+    if (++prediction.framesSinceProbe >= kProbeInterval) {
+        prediction.framesSinceProbe = 0;
+        return true;
+    }
+
+    mSkippedPresentOrValidateCount++;
+    return false;
+}
+
+void PresentOrValidatePredictor::recordPresentOrValidate(const Signature& signature,
+                                                         bool presented, nsecs_t duration) {
+    mPresentOrValidateCount++;
+
+    auto& prediction = mPredictions[signature];
+    if (presented) {
+        mPresentedCount++;
+        mTimeSaved += mAverageValidateDuration;
+        prediction.confidence = std::min(prediction.confidence + 1, kMaxConfidence);
+    } else {
+        // A presentOrValidate that does not present runs a validate instead.
+        recordValidate(duration);
+        prediction.confidence = std::max(prediction.confidence - 2, -kMaxConfidence);
+    }
+}
+
+void PresentOrValidatePredictor::recordValidate(nsecs_t duration) {
+    if (mAverageValidateDuration == 0) {
+        mAverageValidateDuration = duration;
+    } else {
+        mAverageValidateDuration += (duration - mAverageValidateDuration) / 8;
+    }
+}
+
+void PresentOrValidatePredictor::dump(std::string& result) const {
+    using base::StringAppendF;
+
+    const uint64_t mispredicted = mPresentOrValidateCount - mPresentedCount;
+    const float mispredictionRate = mPresentOrValidateCount == 0
+            ? 0.f
+            : 100.f * static_cast<float>(mispredicted) /
+                    static_cast<float>(mPresentOrValidateCount);
+    StringAppendF(&result,
+                  "    presentOrValidate: %" PRIu64 " tried, %" PRIu64
+                  " presented, %.1f%% mispredicted, %" PRIu64 " skipped\n",
+                  mPresentOrValidateCount, mPresentedCount, mispredictionRate,
+                  mSkippedPresentOrValidateCount);
+    StringAppendF(&result,
+                  "    average validate %.3f ms, estimated HAL time saved %.3f ms over %zu "
+                  "frame signatures\n",
+                  static_cast<double>(mAverageValidateDuration) / 1e6,
+                  static_cast<double>(mTimeSaved) / 1e6, mPredictions.size());
+}
+
+} // namespace Hwc2
+} // namespace android
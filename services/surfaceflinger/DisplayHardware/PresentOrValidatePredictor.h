@@ -0,0 +1,91 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Timers.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace android {
+namespace Hwc2 {
+
+// Predicts, for each kind of frame a display composes, whether HWC will present it without
+// asking for a validate. Frames where HWC keeps asking for one skip presentOrValidate and are
+// validated directly, and are probed again every so often in case HWC changed its mind.
+//
+// Only frames without client composition are considered, since the client target has not been
+// rendered yet when HWC is asked to present.
+class PresentOrValidatePredictor {
+public:
+    // Describes how the layer stack changed since the previous frame.
+    struct Signature {
+        size_t layerCount = 0;
+        // Layers which were given a new buffer, saturated at kMaxBufferUpdates.
+        uint32_t bufferUpdates = 0;
+        bool compositionTypesChanged = false;
+        bool geometryChanged = false;
+
+        bool operator==(const Signature&) const;
+    };
+
+    static constexpr uint32_t kMaxBufferUpdates = 8;
+
+    // Returns true if presentOrValidate is expected to present the frame.
+    bool shouldTryPresentOrValidate(const Signature&);
+
+    // Records the outcome of presentOrValidate, and how long the call took.
+    void recordPresentOrValidate(const Signature&, bool presented, nsecs_t duration);
+    // Records a validate call, whether or not presentOrValidate was tried first.
+    void recordValidate(nsecs_t duration);
+
+    void dump(std::string& result) const;
+
+private:
+    struct SignatureHash {
+        size_t operator()(const Signature&) const;
+    };
+
+    struct Prediction {
+        // Positive when HWC is expected to present.
+        int32_t confidence = 1;
+        // Frames validated directly since presentOrValidate was last tried.
+        uint32_t framesSinceProbe = 0;
+    };
+
+    static constexpr int32_t kMaxConfidence = 4;
+    static constexpr uint32_t kProbeInterval = 30;
+    // Bounds the memory used by displays whose layer stack keeps changing.
+    static constexpr size_t kMaxSignatures = 64;
+
+    std::unordered_map<Signature, Prediction, SignatureHash> mPredictions;
+
+    // Running average of the validate calls, used to estimate the time saved by presenting
+    // without one.
+    nsecs_t mAverageValidateDuration = 0;
+
+    // Debugging
+    uint64_t mPresentOrValidateCount = 0;
+    uint64_t mPresentedCount = 0;
+    uint64_t mSkippedPresentOrValidateCount = 0;
+    nsecs_t mTimeSaved = 0;
+};
+
+} // namespace Hwc2
+} // namespace android
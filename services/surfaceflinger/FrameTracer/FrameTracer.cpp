@@ -35,6 +35,18 @@ PERFETTO_DEFINE_DATA_SOURCE_STATIC_MEMBERS(android::FrameTracer::FrameTracerData
 namespace android {
 
 using Clock = perfetto::protos::pbzero::ClockSnapshot::Clock;
+
+FrameTracer::FrameTracer() : mThread(&FrameTracer::threadMain, this) {}
+
+FrameTracer::~FrameTracer() {
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        mDone = true;
+    }
+    mQueueCondition.notify_one();
+    mThread.join();
+}
+
 void FrameTracer::initialize() {
     std::call_once(mInitializationFlag, [this]() {
         perfetto::TracingInitArgs args;
@@ -52,10 +64,9 @@ void FrameTracer::registerDataSource() {
 
 void FrameTracer::traceNewLayer(int32_t layerId, const std::string& layerName) {
     FrameTracerDataSource::Trace([this, layerId, &layerName](FrameTracerDataSource::TraceContext) {
-        if (mTraceTracker.find(layerId) == mTraceTracker.end()) {
-            std::lock_guard<std::mutex> lock(mTraceMutex);
-            mTraceTracker[layerId].layerName = layerName;
-        }
+        Event event(Event::Kind::NewLayer, layerId);
+        event.layerName = layerName;
+        enqueue(std::move(event));
     });
 }
 
@@ -63,17 +74,14 @@ void FrameTracer::traceTimestamp(int32_t layerId, uint64_t bufferID, uint64_t fr
                                  nsecs_t timestamp, FrameEvent::BufferEventType type,
                                  nsecs_t duration) {
     FrameTracerDataSource::Trace([this, layerId, bufferID, frameNumber, timestamp, type,
-                                  duration](FrameTracerDataSource::TraceContext ctx) {
-        std::lock_guard<std::mutex> lock(mTraceMutex);
-        if (mTraceTracker.find(layerId) == mTraceTracker.end()) {
-            return;
-        }
-
-        // Handle any pending fences for this buffer.
-        tracePendingFencesLocked(ctx, layerId, bufferID);
-
-        // Complete current trace.
-        traceLocked(ctx, layerId, bufferID, frameNumber, timestamp, type, duration);
+                                  duration](FrameTracerDataSource::TraceContext) {
+        Event event(Event::Kind::Timestamp, layerId);
+        event.bufferID = bufferID;
+        event.frameNumber = frameNumber;
+        event.type = type;
+        event.timestamp = timestamp;
+        event.duration = duration;
+        enqueue(std::move(event));
     });
 }
 
@@ -81,32 +89,174 @@ void FrameTracer::traceFence(int32_t layerId, uint64_t bufferID, uint64_t frameN
                              const std::shared_ptr<FenceTime>& fence,
                              FrameEvent::BufferEventType type, nsecs_t startTime) {
     FrameTracerDataSource::Trace([this, layerId, bufferID, frameNumber, &fence, type,
-                                  startTime](FrameTracerDataSource::TraceContext ctx) {
-        const nsecs_t signalTime = fence->getSignalTime();
-        if (signalTime != Fence::SIGNAL_TIME_INVALID) {
-            std::lock_guard<std::mutex> lock(mTraceMutex);
-            if (mTraceTracker.find(layerId) == mTraceTracker.end()) {
-                return;
-            }
+                                  startTime](FrameTracerDataSource::TraceContext) {
+        Event event(Event::Kind::Fence, layerId);
+        event.bufferID = bufferID;
+        event.frameNumber = frameNumber;
+        event.type = type;
+        event.timestamp = startTime;
+        event.fence = fence;
+        enqueue(std::move(event));
+    });
+}
 
-            // Handle any pending fences for this buffer.
-            tracePendingFencesLocked(ctx, layerId, bufferID);
+void FrameTracer::onDestroy(int32_t layerId) {
+    enqueue(Event(Event::Kind::Destroy, layerId));
+}
+
+void FrameTracer::enqueue(Event&& event) {
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        mQueue.push_back(std::move(event));
+        mQueuedCount++;
+    }
+    mQueueCondition.notify_one();
+}
 
-            if (signalTime != Fence::SIGNAL_TIME_PENDING) {
-                traceSpanLocked(ctx, layerId, bufferID, frameNumber, type, startTime, signalTime);
+void FrameTracer::flush() {
+    std::unique_lock<std::mutex> lock(mQueueMutex);
+    const uint64_t target = mQueuedCount;
+    mQueueCondition.notify_one();
+    mFlushCondition.wait(lock, [this, target] { return mProcessedCount >= target; });
+}
+
+void FrameTracer::threadMain() {
+    std::vector<Event> events;
+    bool hasPendingFences = false;
+
+    std::unique_lock<std::mutex> lock(mQueueMutex);
+    while (!mDone) {
+        if (mQueue.empty()) {
+            if (hasPendingFences) {
+                mQueueCondition.wait_for(lock, kPendingFencePollPeriod);
             } else {
-                mTraceTracker[layerId].pendingFences[bufferID].push_back(
-                        {.frameNumber = frameNumber,
-                         .type = type,
-                         .fence = fence,
-                         .startTime = startTime});
+                mQueueCondition.wait(lock);
+            }
+            if (mDone) {
+                break;
+            }
+        }
+
+        events.swap(mQueue);
+        const uint64_t processedCount = mQueuedCount;
+        lock.unlock();
+
+        processEvents(events);
+        events.clear();
+        {
+            std::lock_guard<std::mutex> traceLock(mTraceMutex);
+            hasPendingFences = pendingFenceCountLocked() > 0;
+        }
+
+        lock.lock();
+        mProcessedCount = processedCount;
+        mFlushCondition.notify_all();
+    }
+}
+
+void FrameTracer::processEvents(const std::vector<Event>& events) {
+    std::vector<TracePoint> tracePoints;
+    {
+        std::lock_guard<std::mutex> lock(mTraceMutex);
+        for (const Event& event : events) {
+            switch (event.kind) {
+                case Event::Kind::NewLayer:
+                    if (mTraceTracker.find(event.layerId) == mTraceTracker.end()) {
+                        mTraceTracker[event.layerId].layerName = event.layerName;
+                    }
+                    break;
+                case Event::Kind::Destroy:
+                    mTraceTracker.erase(event.layerId);
+                    break;
+                case Event::Kind::Timestamp:
+                    if (mTraceTracker.find(event.layerId) == mTraceTracker.end()) {
+                        break;
+                    }
+
+                    // Handle any pending fences for this buffer.
+                    tracePendingFencesLocked(event.layerId, event.bufferID, &tracePoints);
+
+                    // Complete current trace.
+                    traceLocked(event.layerId, event.bufferID, event.frameNumber, event.timestamp,
+                                event.type, event.duration, &tracePoints);
+                    break;
+                case Event::Kind::Fence: {
+                    const nsecs_t signalTime = event.fence->getSignalTime();
+                    if (signalTime == Fence::SIGNAL_TIME_INVALID ||
+                        mTraceTracker.find(event.layerId) == mTraceTracker.end()) {
+                        break;
+                    }
+
+                    // Handle any pending fences for this buffer.
+                    tracePendingFencesLocked(event.layerId, event.bufferID, &tracePoints);
+
+                    if (signalTime != Fence::SIGNAL_TIME_PENDING) {
+                        // The event may have been queued for a while, so apply the same deadline
+                        // as for pending fences.
+                        if (systemTime() - signalTime >= kFenceSignallingDeadline) {
+                            break;
+                        }
+                        traceSpanLocked(event.layerId, event.bufferID, event.frameNumber,
+                                        event.type, event.timestamp, signalTime, &tracePoints);
+                    } else {
+                        mTraceTracker[event.layerId].pendingFences[event.bufferID].push_back(
+                                {.frameNumber = event.frameNumber,
+                                 .type = event.type,
+                                 .fence = event.fence,
+                                 .startTime = event.timestamp});
+                    }
+                    break;
+                }
+            }
+        }
+        traceAllPendingFencesLocked(&tracePoints);
+    }
+
+    if (tracePoints.empty()) {
+        return;
+    }
+
+    FrameTracerDataSource::Trace([&tracePoints](FrameTracerDataSource::TraceContext ctx) {
+        for (const TracePoint& tracePoint : tracePoints) {
+            auto packet = ctx.NewTracePacket();
+            packet->set_timestamp_clock_id(Clock::MONOTONIC);
+            packet->set_timestamp(tracePoint.timestamp);
+            auto* event = packet->set_graphics_frame_event()->set_buffer_event();
+            event->set_buffer_id(static_cast<uint32_t>(tracePoint.bufferID));
+            if (tracePoint.frameNumber != UNSPECIFIED_FRAME_NUMBER) {
+                event->set_frame_number(tracePoint.frameNumber);
+            }
+            event->set_type(tracePoint.type);
+
+            if (!tracePoint.layerName.empty()) {
+                event->set_layer_name(tracePoint.layerName.c_str(), tracePoint.layerName.size());
+            }
+
+            if (tracePoint.duration > 0) {
+                event->set_duration_ns(tracePoint.duration);
             }
         }
     });
 }
 
-void FrameTracer::tracePendingFencesLocked(FrameTracerDataSource::TraceContext& ctx,
-                                           int32_t layerId, uint64_t bufferID) {
+void FrameTracer::tracePendingFencesLocked(int32_t layerId, uint64_t bufferID,
+                                           std::vector<TracePoint>* tracePoints) {
+    if (mTraceTracker[layerId].pendingFences.count(bufferID)) {
+        auto& pendingFences = mTraceTracker[layerId].pendingFences[bufferID];
+
+        // Poll all the pending fences of the buffer at once.
+        std::vector<std::shared_ptr<FenceTime>> fences;
+        fences.reserve(pendingFences.size());
+        for (const auto& pendingFence : pendingFences) {
+            fences.push_back(pendingFence.fence);
+        }
+        FenceTime::updateSignalTimes(fences);
+    }
+    traceSignaledFencesLocked(layerId, bufferID, tracePoints);
+}
+
+void FrameTracer::traceSignaledFencesLocked(int32_t layerId, uint64_t bufferID,
+                                            std::vector<TracePoint>* tracePoints) {
     if (mTraceTracker[layerId].pendingFences.count(bufferID)) {
         auto& pendingFences = mTraceTracker[layerId].pendingFences[bufferID];
         for (size_t i = 0; i < pendingFences.size(); ++i) {
@@ -114,7 +264,7 @@ void FrameTracer::tracePendingFencesLocked(FrameTracerDataSource::TraceContext&
 
             nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
             if (pendingFence.fence && pendingFence.fence->isValid()) {
-                signalTime = pendingFence.fence->getSignalTime();
+                signalTime = pendingFence.fence->getCachedSignalTime();
                 if (signalTime == Fence::SIGNAL_TIME_PENDING) {
                     continue;
                 }
@@ -122,59 +272,87 @@ void FrameTracer::tracePendingFencesLocked(FrameTracerDataSource::TraceContext&
 
             if (signalTime != Fence::SIGNAL_TIME_INVALID &&
                 systemTime() - signalTime < kFenceSignallingDeadline) {
-                traceSpanLocked(ctx, layerId, bufferID, pendingFence.frameNumber, pendingFence.type,
-                                pendingFence.startTime, signalTime);
+                traceSpanLocked(layerId, bufferID, pendingFence.frameNumber, pendingFence.type,
+                                pendingFence.startTime, signalTime, tracePoints);
             }
 
             pendingFences.erase(pendingFences.begin() + i);
             --i;
         }
+
+        if (pendingFences.empty()) {
+            mTraceTracker[layerId].pendingFences.erase(bufferID);
+        }
     }
 }
 
-void FrameTracer::traceLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId,
-                              uint64_t bufferID, uint64_t frameNumber, nsecs_t timestamp,
-                              FrameEvent::BufferEventType type, nsecs_t duration) {
-    auto packet = ctx.NewTracePacket();
-    packet->set_timestamp_clock_id(Clock::MONOTONIC);
-    packet->set_timestamp(timestamp);
-    auto* event = packet->set_graphics_frame_event()->set_buffer_event();
-    event->set_buffer_id(static_cast<uint32_t>(bufferID));
-    if (frameNumber != UNSPECIFIED_FRAME_NUMBER) {
-        event->set_frame_number(frameNumber);
+void FrameTracer::traceAllPendingFencesLocked(std::vector<TracePoint>* tracePoints) {
+    // Poll every pending fence with a single call.
+    std::vector<std::shared_ptr<FenceTime>> fences;
+    fences.reserve(pendingFenceCountLocked());
+    for (const auto& [layerId, traceRecord] : mTraceTracker) {
+        for (const auto& [bufferID, pendingFences] : traceRecord.pendingFences) {
+            for (const auto& pendingFence : pendingFences) {
+                fences.push_back(pendingFence.fence);
+            }
+        }
+    }
+    if (fences.empty()) {
+        return;
     }
-    event->set_type(type);
+    FenceTime::updateSignalTimes(fences);
 
-    if (mTraceTracker.find(layerId) != mTraceTracker.end() &&
-        !mTraceTracker[layerId].layerName.empty()) {
-        const std::string& layerName = mTraceTracker[layerId].layerName;
-        event->set_layer_name(layerName.c_str(), layerName.size());
+    for (auto& [layerId, traceRecord] : mTraceTracker) {
+        std::vector<uint64_t> bufferIDs;
+        bufferIDs.reserve(traceRecord.pendingFences.size());
+        for (const auto& [bufferID, pendingFences] : traceRecord.pendingFences) {
+            bufferIDs.push_back(bufferID);
+        }
+        for (uint64_t bufferID : bufferIDs) {
+            traceSignaledFencesLocked(layerId, bufferID, tracePoints);
+        }
     }
+}
+
+size_t FrameTracer::pendingFenceCountLocked() const {
+    size_t count = 0;
+    for (const auto& [layerId, traceRecord] : mTraceTracker) {
+        for (const auto& [bufferID, pendingFences] : traceRecord.pendingFences) {
+            count += pendingFences.size();
+        }
+    }
+    return count;
+}
 
-    if (duration > 0) {
-        event->set_duration_ns(duration);
+void FrameTracer::traceLocked(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
+                              nsecs_t timestamp, FrameEvent::BufferEventType type,
+                              nsecs_t duration, std::vector<TracePoint>* tracePoints) {
+    std::string layerName;
+    if (mTraceTracker.find(layerId) != mTraceTracker.end()) {
+        layerName = mTraceTracker[layerId].layerName;
     }
+    tracePoints->push_back({.layerName = std::move(layerName),
+                            .bufferID = bufferID,
+                            .frameNumber = frameNumber,
+                            .timestamp = timestamp,
+                            .type = type,
+                            .duration = duration});
 }
 
-void FrameTracer::traceSpanLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId,
-                                  uint64_t bufferID, uint64_t frameNumber,
+void FrameTracer::traceSpanLocked(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
                                   FrameEvent::BufferEventType type, nsecs_t startTime,
-                                  nsecs_t endTime) {
+                                  nsecs_t endTime, std::vector<TracePoint>* tracePoints) {
     nsecs_t timestamp = endTime;
     nsecs_t duration = 0;
     if (startTime > 0 && startTime < endTime) {
         timestamp = startTime;
         duration = endTime - startTime;
     }
-    traceLocked(ctx, layerId, bufferID, frameNumber, timestamp, type, duration);
-}
-
-void FrameTracer::onDestroy(int32_t layerId) {
-    std::lock_guard<std::mutex> traceLock(mTraceMutex);
-    mTraceTracker.erase(layerId);
+    traceLocked(layerId, bufferID, frameNumber, timestamp, type, duration, tracePoints);
 }
 
 std::string FrameTracer::miniDump() {
+    flush();
     std::string result = "FrameTracer miniDump:\n";
     std::lock_guard<std::mutex> lock(mTraceMutex);
     android::base::StringAppendF(&result, "Number of layers currently being traced is %zu\n",
@@ -20,8 +20,13 @@
 #include <perfetto/tracing.h>
 #include <ui/FenceTime.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 
@@ -37,7 +42,8 @@ public:
 
     using FrameEvent = perfetto::protos::pbzero::GraphicsFrameEvent;
 
-    ~FrameTracer() = default;
+    FrameTracer();
+    ~FrameTracer();
 
     // Sets up the perfetto tracing backend and data source.
     void initialize();
@@ -65,6 +71,11 @@ public:
 
     std::string miniDump();
 
+    // The trace calls above only queue their events, which are written to perfetto from a
+    // background thread. Blocks until every event queued before the call has been written.
+    // Public for testing, since a tracing session drops events still queued when it stops.
+    void flush();
+
     static constexpr char kFrameTracerDataSource[] = "android.surfaceflinger.frame";
 
     // The maximum amount of time a fence has to signal before it is discarded.
@@ -73,6 +84,32 @@ public:
     static constexpr nsecs_t kFenceSignallingDeadline = 60'000'000'000; // 60 seconds
 
 private:
+    struct Event {
+        enum class Kind { NewLayer, Timestamp, Fence, Destroy };
+        Event(Kind kind, int32_t layerId) : kind(kind), layerId(layerId) {}
+
+        Kind kind;
+        int32_t layerId;
+        std::string layerName;
+        uint64_t bufferID = 0;
+        uint64_t frameNumber = 0;
+        FrameEvent::BufferEventType type = FrameEvent::UNSPECIFIED;
+        // The timestamp of a Timestamp event, or the start time of a Fence event.
+        nsecs_t timestamp = 0;
+        nsecs_t duration = 0;
+        std::shared_ptr<FenceTime> fence;
+    };
+
+    // A trace point resolved from the events, ready to be written as a packet.
+    struct TracePoint {
+        std::string layerName;
+        uint64_t bufferID;
+        uint64_t frameNumber;
+        nsecs_t timestamp;
+        FrameEvent::BufferEventType type;
+        nsecs_t duration;
+    };
+
     struct PendingFence {
         uint64_t frameNumber;
         FrameEvent::BufferEventType type;
@@ -86,23 +123,49 @@ private:
         std::unordered_map<BufferID, std::vector<PendingFence>> pendingFences;
     };
 
+    // Queues an event for the background thread. Only takes mQueueMutex, and only to append.
+    void enqueue(Event&& event);
+    void threadMain();
+    // Applies the events to mTraceTracker and resolves them into trace points, then writes the
+    // trace points in a single perfetto trace call.
+    void processEvents(const std::vector<Event>& events);
     // Checks if any pending fences for a layer and buffer have signalled and, if they have, creates
     // trace points for them.
-    void tracePendingFencesLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId,
-                                  uint64_t bufferID);
+    void tracePendingFencesLocked(int32_t layerId, uint64_t bufferID,
+                                  std::vector<TracePoint>* tracePoints);
+    // Same as above, but only reads the signal times cached by the last poll of the fences.
+    void traceSignaledFencesLocked(int32_t layerId, uint64_t bufferID,
+                                   std::vector<TracePoint>* tracePoints);
+    // Checks the pending fences of every layer and buffer at once. Used after each batch so that
+    // fences are traced without waiting for another trace call for their buffer.
+    void traceAllPendingFencesLocked(std::vector<TracePoint>* tracePoints);
     // Creates a trace point by translating a start time and an end time to a timestamp and
     // duration. If startTime is later than end time it sets end time as the timestamp and the
     // duration to 0. Used by traceFence().
-    void traceSpanLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId,
-                         uint64_t bufferID, uint64_t frameNumber, FrameEvent::BufferEventType type,
-                         nsecs_t startTime, nsecs_t endTime);
-    void traceLocked(FrameTracerDataSource::TraceContext& ctx, int32_t layerId, uint64_t bufferID,
-                     uint64_t frameNumber, nsecs_t timestamp, FrameEvent::BufferEventType type,
-                     nsecs_t duration = 0);
-
+    void traceSpanLocked(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
+                         FrameEvent::BufferEventType type, nsecs_t startTime, nsecs_t endTime,
+                         std::vector<TracePoint>* tracePoints);
+    void traceLocked(int32_t layerId, uint64_t bufferID, uint64_t frameNumber, nsecs_t timestamp,
+                     FrameEvent::BufferEventType type, nsecs_t duration,
+                     std::vector<TracePoint>* tracePoints);
+    size_t pendingFenceCountLocked() const;
+
+    // How often the background thread checks the pending fences when no events arrive.
+    static constexpr std::chrono::milliseconds kPendingFencePollPeriod{100};
+
+    // Guards mTraceTracker, which is otherwise only used on the background thread.
     std::mutex mTraceMutex;
     std::unordered_map<int32_t, TraceRecord> mTraceTracker;
     std::once_flag mInitializationFlag;
+
+    std::mutex mQueueMutex;
+    std::condition_variable mQueueCondition;
+    std::condition_variable mFlushCondition;
+    std::vector<Event> mQueue;
+    uint64_t mQueuedCount = 0;
+    uint64_t mProcessedCount = 0;
+    bool mDone = false;
+    std::thread mThread;
 };
 
 } // namespace android
@@ -367,8 +367,33 @@ FloatRect Layer::getBoundsPreScaling(const ui::Transform& bufferScaleTransform)
     return bufferScaleTransform.inverse().transform(mBounds);
 }
 
+void Layer::setGeometryDirty() {
+    mGeometryDirty = true;
+    // Ancestors are marked bottom up and cleared top down, so an ancestor that is already marked
+    // has all of its own ancestors marked too.
+    for (sp<Layer> parent = mDrawingParent.promote(); parent && !parent->mChildGeometryDirty;
+         parent = parent->mDrawingParent.promote()) {
+        parent->mChildGeometryDirty = true;
+    }
+}
+
 void Layer::computeBounds(FloatRect parentBounds, ui::Transform parentTransform,
                           float parentShadowRadius) {
+    const bool inputsChanged = mGeometryDirty || !(parentBounds == mParentBounds) ||
+            !(parentTransform == mParentTransform) || parentShadowRadius != mParentShadowRadius;
+    if (!inputsChanged) {
+        if (mChildGeometryDirty) {
+            mChildGeometryDirty = false;
+            computeChildrenBounds();
+        }
+        return;
+    }
+    mGeometryDirty = false;
+    mChildGeometryDirty = false;
+    mParentBounds = parentBounds;
+    mParentTransform = parentTransform;
+    mParentShadowRadius = parentShadowRadius;
+
     const State& s(getDrawingState());
 
     // Calculate effective layer transform
@@ -399,6 +424,10 @@ void Layer::computeBounds(FloatRect parentBounds, ui::Transform parentTransform,
         mEffectiveShadowRadius = parentShadowRadius;
     }
 
+    computeChildrenBounds();
+}
+
+void Layer::computeChildrenBounds() {
     // Shadow radius is passed down to only one layer so if the layer can draw shadows,
     // don't pass it to its children.
     const float childShadowRadius = canDrawShadows() ? 0.f : mEffectiveShadowRadius;
@@ -469,13 +498,13 @@ void Layer::prepareBasicGeometryCompositionState() {
 void Layer::prepareGeometryCompositionState() {
     const auto& drawingState{getDrawingState()};
 
-    int type = drawingState.metadata.getInt32(METADATA_WINDOW_TYPE, 0);
-    int appId = drawingState.metadata.getInt32(METADATA_OWNER_UID, 0);
+    int type = drawingState.metadata->getInt32(METADATA_WINDOW_TYPE, 0);
+    int appId = drawingState.metadata->getInt32(METADATA_OWNER_UID, 0);
     sp<Layer> parent = mDrawingParent.promote();
     if (parent.get()) {
         auto& parentState = parent->getDrawingState();
-        const int parentType = parentState.metadata.getInt32(METADATA_WINDOW_TYPE, 0);
-        const int parentAppId = parentState.metadata.getInt32(METADATA_OWNER_UID, 0);
+        const int parentType = parentState.metadata->getInt32(METADATA_WINDOW_TYPE, 0);
+        const int parentAppId = parentState.metadata->getInt32(METADATA_OWNER_UID, 0);
         if (parentType > 0 && parentAppId > 0) {
             type = parentType;
             appId = parentAppId;
@@ -506,8 +535,8 @@ void Layer::prepareGeometryCompositionState() {
         }
         const uint32_t id = compatIter->second;
 
-        auto it = drawingState.metadata.mMap.find(id);
-        if (it == std::end(drawingState.metadata.mMap)) {
+        auto it = drawingState.metadata->mMap.find(id);
+        if (it == std::end(drawingState.metadata->mMap)) {
             continue;
         }
 
@@ -549,7 +578,25 @@ void Layer::prepareCursorCompositionState() {
     Rect win = getCroppedBufferSize(drawingState);
     // Subtract the transparent region and snap to the bounds
     Rect bounds = reduce(win, getActiveTransparentRegion(drawingState));
-    Rect frame(getTransform().transform(bounds));
+
+    // Move the layer to where the cursor fast path put it, in its parent's space.
+    const ui::Transform activeTransform = getActiveTransform(drawingState);
+    std::optional<vec2> position;
+    {
+        Mutex::Autolock lock(mCursorPositionLock);
+        if (mCursorPosition && mCursorPosition->x == activeTransform.tx() &&
+            mCursorPosition->y == activeTransform.ty()) {
+            mCursorPosition.reset();
+        }
+        position = mCursorPosition;
+    }
+    ui::Transform transform = getTransform();
+    if (position) {
+        ui::Transform movedTransform = activeTransform;
+        movedTransform.set(position->x, position->y);
+        transform = transform * activeTransform.inverse() * movedTransform;
+    }
+    Rect frame(transform.transform(bounds));
 
     compositionState->cursorFrame = frame;
 }
@@ -1012,6 +1059,8 @@ uint32_t Layer::doTransaction(uint32_t flags) {
 
 void Layer::commitTransaction(const State& stateToCommit) {
     mDrawingState = stateToCommit;
+    mDrawingStateGeneration++;
+    setGeometryDirty();
 }
 
 uint32_t Layer::getTransactionFlags(uint32_t flags) {
@@ -1023,6 +1072,13 @@ uint32_t Layer::setTransactionFlags(uint32_t flags) {
 }
 
 bool Layer::setPosition(float x, float y) {
+    {
+        Mutex::Autolock lock(mCursorPositionLock);
+        if (mCursorPosition && (mCursorPosition->x != x || mCursorPosition->y != y)) {
+            mCursorPosition.reset();
+        }
+    }
+
     if (mCurrentState.requested_legacy.transform.tx() == x &&
         mCurrentState.requested_legacy.transform.ty() == y)
         return false;
@@ -1043,6 +1099,11 @@ bool Layer::setPosition(float x, float y) {
     return true;
 }
 
+void Layer::setCursorPosition(float x, float y) {
+    Mutex::Autolock lock(mCursorPositionLock);
+    mCursorPosition = vec2(x, y);
+}
+
 bool Layer::setChildLayer(const sp<Layer>& childLayer, int32_t z) {
     ssize_t idx = mCurrentChildren.indexOf(childLayer);
     if (idx < 0) {
@@ -1270,12 +1331,13 @@ bool Layer::setCrop_legacy(const Rect& crop) {
 bool Layer::setOverrideScalingMode(int32_t scalingMode) {
     if (scalingMode == mOverrideScalingMode) return false;
     mOverrideScalingMode = scalingMode;
+    setGeometryDirty();
     setTransactionFlags(eTransactionNeeded);
     return true;
 }
 
 bool Layer::setMetadata(const LayerMetadata& data) {
-    if (!mCurrentState.metadata.merge(data, true /* eraseEmpty */)) return false;
+    if (!mCurrentState.metadata.edit().merge(data, true /* eraseEmpty */)) return false;
     mCurrentState.sequence++;
     mCurrentState.modified = true;
     setTransactionFlags(eTransactionNeeded);
@@ -1695,6 +1757,10 @@ void Layer::addAndGetFrameTimestamps(const NewFrameEventsEntry* newTimestamps,
     }
 
     Mutex::Autolock lock(mFrameEventHistoryMutex);
+    if (outDelta) {
+        // Record the frame queued along with the request, if any.
+        mFrameEventHistory.setProducerWantsEvents();
+    }
     if (newTimestamps) {
         // If there are any unsignaled fences in the aquire timeline at this
         // point, the previously queued frame hasn't been latched yet. Go ahead
@@ -2175,7 +2241,10 @@ void Layer::commitChildList() {
         child->commitChildList();
     }
     mDrawingChildren = mCurrentChildren;
-    mDrawingParent = mCurrentParent;
+    if (mDrawingParent != mCurrentParent) {
+        mDrawingParent = mCurrentParent;
+        setGeometryDirty();
+    }
 }
 
 static wp<Layer> extractLayerFromBinder(const wp<IBinder>& weakBinderHandle) {
@@ -2349,13 +2418,13 @@ void Layer::writeToProtoCommonState(LayerProto* layerInfo, LayerVector::StateSet
     }
 
     if (traceFlags & SurfaceTracing::TRACE_INPUT) {
-        LayerProtoHelper::writeToProto(state.inputInfo, state.touchableRegionCrop,
+        LayerProtoHelper::writeToProto(*state.inputInfo, state.touchableRegionCrop,
                                        [&]() { return layerInfo->mutable_input_window_info(); });
     }
 
     if (traceFlags & SurfaceTracing::TRACE_EXTRA) {
         auto protoMap = layerInfo->mutable_metadata();
-        for (const auto& entry : state.metadata.mMap) {
+        for (const auto& entry : state.metadata->mMap) {
             (*protoMap)[entry.first] = std::string(entry.second.cbegin(), entry.second.cend());
         }
     }
@@ -2366,17 +2435,16 @@ bool Layer::isRemovedFromCurrentState() const  {
 }
 
 InputWindowInfo Layer::fillInputInfo() {
+    InputWindowInfo info = *mDrawingState.inputInfo;
     if (!hasInputInfo()) {
-        mDrawingState.inputInfo.name = getName();
-        mDrawingState.inputInfo.ownerUid = mCallingUid;
-        mDrawingState.inputInfo.ownerPid = mCallingPid;
-        mDrawingState.inputInfo.inputFeatures =
-            InputWindowInfo::INPUT_FEATURE_NO_INPUT_CHANNEL;
-        mDrawingState.inputInfo.layoutParamsFlags = InputWindowInfo::FLAG_NOT_TOUCH_MODAL;
-        mDrawingState.inputInfo.displayId = getLayerStack();
+        // Fill in the defaults on the copy so that the shared drawing state is not edited.
+        info.name = getName();
+        info.ownerUid = mCallingUid;
+        info.ownerPid = mCallingPid;
+        info.inputFeatures = InputWindowInfo::INPUT_FEATURE_NO_INPUT_CHANNEL;
+        info.layoutParamsFlags = InputWindowInfo::FLAG_NOT_TOUCH_MODAL;
+        info.displayId = getLayerStack();
     }
-
-    InputWindowInfo info = mDrawingState.inputInfo;
     info.id = sequence;
 
     if (info.displayId == ADISPLAY_ID_NONE) {
@@ -2474,7 +2542,7 @@ sp<Layer> Layer::getClonedRoot() {
 }
 
 bool Layer::hasInputInfo() const {
-    return mDrawingState.inputInfo.token != nullptr;
+    return mDrawingState.inputInfo->token != nullptr;
 }
 
 bool Layer::canReceiveInput() const {
@@ -2495,6 +2563,7 @@ Region Layer::getVisibleRegion(const DisplayDevice* display) const {
 void Layer::setInitialValuesForClone(const sp<Layer>& clonedFrom) {
     // copy drawing state from cloned layer
     mDrawingState = clonedFrom->mDrawingState;
+    mClonedDrawingStateGeneration = clonedFrom->mDrawingStateGeneration;
     mClonedFrom = clonedFrom;
 }
 
@@ -2515,7 +2584,13 @@ void Layer::updateMirrorInfo() {
     // copied to drawingState for the root layer. So the clonedChild is always removed from
     // drawingState and then needs to be added back each traversal.
     if (!mClonedChild->getClonedFrom()->isRemovedFromCurrentState()) {
-        addChildToDrawing(mClonedChild);
+        if (mClonedChild->mDrawingParent == this) {
+            // Re-adding the clone to the same parent does not move it, so its geometry is not
+            // dirtied as addChildToDrawing would.
+            mDrawingChildren.add(mClonedChild);
+        } else {
+            addChildToDrawing(mClonedChild);
+        }
     }
 
     mClonedChild->updateClonedDrawingState(clonedLayersMap);
@@ -2529,7 +2604,14 @@ void Layer::updateClonedDrawingState(std::map<sp<Layer>, sp<Layer>>& clonedLayer
     // since we may be able to pull out other children that are still alive.
     if (isClonedFromAlive()) {
         sp<Layer> clonedFrom = getClonedFrom();
-        mDrawingState = clonedFrom->mDrawingState;
+        // Only copy the state if it changed since the last copy. The heavy fields of the state are
+        // shared with the real layer rather than deep copied.
+        if (mClonedDrawingStateGeneration != clonedFrom->mDrawingStateGeneration) {
+            mDrawingState = clonedFrom->mDrawingState;
+            mClonedDrawingStateGeneration = clonedFrom->mDrawingStateGeneration;
+            mDrawingStateGeneration++;
+            setGeometryDirty();
+        }
         clonedLayersMap.emplace(clonedFrom, this);
     }
 
@@ -2546,13 +2628,13 @@ void Layer::updateClonedDrawingState(std::map<sp<Layer>, sp<Layer>>& clonedLayer
 
 void Layer::updateClonedChildren(const sp<Layer>& mirrorRoot,
                                  std::map<sp<Layer>, sp<Layer>>& clonedLayersMap) {
-    mDrawingChildren.clear();
-
     if (!isClonedFromAlive()) {
+        mDrawingChildren.clear();
         return;
     }
 
     sp<Layer> clonedFrom = getClonedFrom();
+    LayerVector clonedChildren(LayerVector::StateSet::Drawing);
     for (sp<Layer>& child : clonedFrom->mDrawingChildren) {
         if (child == mirrorRoot) {
             // This is to avoid cyclical mirroring.
@@ -2563,7 +2645,23 @@ void Layer::updateClonedChildren(const sp<Layer>& mirrorRoot,
             clonedChild = child->createClone();
             clonedLayersMap[child] = clonedChild;
         }
-        addChildToDrawing(clonedChild);
+        clonedChildren.add(clonedChild);
+    }
+
+    // Most transactions leave the mirrored hierarchy alone, so only re-add the children, which
+    // dirties their geometry, when they or their order changed.
+    bool childrenChanged = clonedChildren.size() != mDrawingChildren.size();
+    for (size_t i = 0; !childrenChanged && i < clonedChildren.size(); i++) {
+        childrenChanged = clonedChildren[i] != mDrawingChildren[i];
+    }
+    if (childrenChanged) {
+        mDrawingChildren.clear();
+        for (const sp<Layer>& clonedChild : clonedChildren) {
+            addChildToDrawing(clonedChild);
+        }
+    }
+
+    for (const sp<Layer>& clonedChild : clonedChildren) {
         clonedChild->updateClonedChildren(mirrorRoot, clonedLayersMap);
     }
 }
@@ -2582,7 +2680,7 @@ void Layer::updateClonedInputInfo(const std::map<sp<Layer>, sp<Layer>>& clonedLa
     }
     // Cloned layers shouldn't handle watch outside since their z order is not determined by
     // WM or the client.
-    mDrawingState.inputInfo.layoutParamsFlags &= ~InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH;
+    mDrawingState.inputInfo.edit().layoutParamsFlags &= ~InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH;
 }
 
 void Layer::updateClonedRelatives(const std::map<sp<Layer>, sp<Layer>>& clonedLayersMap) {
@@ -2594,6 +2692,8 @@ void Layer::updateClonedRelatives(const std::map<sp<Layer>, sp<Layer>>& clonedLa
     }
 
     const sp<Layer>& clonedFrom = getClonedFrom();
+    // The state may not have been copied again, so start from the real layer's crop layer.
+    mDrawingState.touchableRegionCrop = clonedFrom->mDrawingState.touchableRegionCrop;
     for (wp<Layer>& relativeWeak : clonedFrom->mDrawingState.zOrderRelatives) {
         const sp<Layer>& relative = relativeWeak.promote();
         if (clonedLayersMap.count(relative) > 0) {
@@ -2623,6 +2723,7 @@ void Layer::updateClonedRelatives(const std::map<sp<Layer>, sp<Layer>>& clonedLa
 void Layer::addChildToDrawing(const sp<Layer>& layer) {
     mDrawingChildren.add(layer);
     layer->mDrawingParent = this;
+    layer->setGeometryDirty();
 }
 
 Layer::FrameRateCompatibility Layer::FrameRate::convertCompatibility(int8_t compatibility) {
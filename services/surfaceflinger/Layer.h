@@ -42,6 +42,7 @@
 
 #include "Client.h"
 #include "ClientCache.h"
+#include "CopyOnWrite.h"
 #include "DisplayHardware/ComposerHal.h"
 #include "DisplayHardware/HWComposer.h"
 #include "FrameTracker.h"
@@ -207,7 +208,9 @@ public:
         Region activeTransparentRegion_legacy;
         Region requestedTransparentRegion_legacy;
 
-        LayerMetadata metadata;
+        // The metadata and input info are shared with the states this one was copied from until
+        // they are edited, since commits copy the whole state but rarely change either.
+        CopyOnWrite<LayerMetadata> metadata;
 
         // If non-null, a Surface this Surface's Z-order is interpreted relative to.
         wp<Layer> zOrderRelativeOf;
@@ -221,7 +224,7 @@ public:
         int backgroundBlurRadius;
 
         bool inputInfoChanged;
-        InputWindowInfo inputInfo;
+        CopyOnWrite<InputWindowInfo> inputInfo;
         wp<Layer> touchableRegionCrop;
 
         // dataspace is only used by BufferStateLayer and EffectLayer
@@ -287,6 +290,7 @@ public:
     void onFirstRef() override;
 
     int getWindowType() const { return mWindowType; }
+    uid_t getOwnerUid() const { return mCallingUid; }
 
     void setPrimaryDisplayOnly() { mPrimaryDisplayOnly = true; }
     bool getPrimaryDisplayOnly() const { return mPrimaryDisplayOnly; }
@@ -334,6 +338,9 @@ public:
     // setPosition operates in parent buffer space (pre parent-transform) or display
     // space for top-level layers.
     virtual bool setPosition(float x, float y);
+    // Moves the cursor ahead of the layer state, from any thread. The position is dropped once the
+    // drawing state reaches it, or once a transaction moves the layer elsewhere.
+    virtual void setCursorPosition(float x, float y);
     // Buffer space
     virtual bool setCrop_legacy(const Rect& crop);
 
@@ -443,9 +450,14 @@ public:
     FloatRect getBounds(const Region& activeTransparentRegion) const;
     FloatRect getBounds() const;
 
-    // Compute bounds for the layer and cache the results.
+    // Compute bounds for the layer and cache the results. Subtrees whose geometry and parent
+    // bounds have not changed since the last call are skipped.
     void computeBounds(FloatRect parentBounds, ui::Transform parentTransform, float shadowRadius);
 
+    // Forces the next computeBounds() to recompute this layer and its children. Called whenever
+    // the drawing state or buffer that the bounds are computed from changes.
+    void setGeometryDirty();
+
     // Returns the buffer scale transform if a scaling mode is set.
     ui::Transform getBufferScaleTransform() const;
 
@@ -612,6 +624,8 @@ public:
     void onLayerDisplayed(const sp<Fence>& releaseFence) override;
     const char* getDebugName() const override;
 
+    bool isPotentialCursor() const { return mPotentialCursor; }
+
 protected:
     void prepareBasicGeometryCompositionState();
     void prepareGeometryCompositionState();
@@ -709,6 +723,13 @@ public:
      */
     virtual bool hasReadyFrame() const { return false; }
 
+    /*
+     * Queries the acquire fence of the next frame ahead of latchBuffer(), so that latching does
+     * not have to. Called for many layers at once from other threads while the main thread
+     * waits, so it must not touch anything but the fence.
+     */
+    virtual void prefetchFenceStatus() {}
+
     virtual int32_t getQueuedFrameCount() const { return 0; }
 
     // -----------------------------------------------------------------------
@@ -862,6 +883,7 @@ protected:
 
     // For unit tests
     friend class TestableSurfaceFlinger;
+    friend class LayerBoundsTest;
     friend class RefreshRateSelectionTest;
     friend class SetFrameRateTest;
 
@@ -982,6 +1004,10 @@ protected:
 
     // These are only accessed by the main thread or the tracing thread.
     State mDrawingState;
+    // Bumped whenever mDrawingState is replaced, so clones only copy it when it changed.
+    uint64_t mDrawingStateGeneration = 0;
+    // For clones, the mDrawingStateGeneration of mClonedFrom that was last copied.
+    uint64_t mClonedDrawingStateGeneration = 0;
     // Store a copy of the pending state so that the drawing thread can access the
     // states without a lock.
     Vector<State> mPendingStatesSnapshot;
@@ -1026,6 +1052,10 @@ protected:
     // This layer can be a cursor on some displays.
     bool mPotentialCursor{false};
 
+    // Set by setCursorPosition.
+    mutable Mutex mCursorPositionLock;
+    std::optional<vec2> mCursorPosition GUARDED_BY(mCursorPositionLock);
+
     // Child list about to be committed/used for editing.
     LayerVector mCurrentChildren{LayerVector::StateSet::Current};
     // Child list used for rendering.
@@ -1086,6 +1116,9 @@ private:
 
     void removeRemoteSyncPoints();
 
+    // Computes the bounds of the children from the cached bounds of this layer.
+    void computeChildrenBounds();
+
     // Tracks the process and user id of the caller when creating this layer
     // to help debugging.
     pid_t mCallingPid;
@@ -1102,6 +1135,16 @@ private:
     // shadow radius is the set shadow radius, otherwise its the parent's shadow radius.
     float mEffectiveShadowRadius = 0.f;
 
+    // The cached bounds are stale and must be recomputed.
+    bool mGeometryDirty = true;
+    // Some descendant has stale bounds, so computeBounds() must visit the children even if
+    // this layer is up to date.
+    bool mChildGeometryDirty = false;
+    // Arguments of the last computeBounds() call.
+    FloatRect mParentBounds;
+    ui::Transform mParentTransform;
+    float mParentShadowRadius = 0.f;
+
     // Returns true if the layer can draw shadows on its border.
     virtual bool canDrawShadows() const { return true; }
 
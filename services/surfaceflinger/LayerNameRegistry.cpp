@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#undef LOG_TAG
+#define LOG_TAG "LayerNameRegistry"
+
+#include "LayerNameRegistry.h"
+
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <log/log.h>
+
+namespace android {
+
+std::string LayerNameRegistry::acquire(const std::string& name) {
+    uint32_t counter;
+    {
+        std::lock_guard lock(mMutex);
+        Counters& counters = mNames[name];
+        if (counters.released.empty()) {
+            counter = counters.next++;
+        } else {
+            counter = *counters.released.begin();
+            counters.released.erase(counters.released.begin());
+        }
+    }
+
+    // Tack on our counter whether there is a hit or not, so everyone gets a tag
+    std::string uniqueName = base::StringPrintf("%s#%u", name.c_str(), counter);
+    ALOGV_IF(counter > 0, "duplicate layer name: changing %s to %s", name.c_str(),
+             uniqueName.c_str());
+    return uniqueName;
+}
+
+void LayerNameRegistry::release(const std::string& uniqueName) {
+    const size_t separator = uniqueName.rfind('#');
+    uint32_t counter;
+    if (separator == std::string::npos ||
+        !base::ParseUint(uniqueName.substr(separator + 1), &counter)) {
+        return;
+    }
+
+    std::lock_guard lock(mMutex);
+    auto it = mNames.find(uniqueName.substr(0, separator));
+    if (it == mNames.end()) {
+        return;
+    }
+    Counters& counters = it->second;
+    if (counter >= counters.next || counters.released.count(counter) > 0) {
+        return;
+    }
+
+    if (counter + 1 == counters.next) {
+        // Shrink past the released counters at the top, so the set stays small.
+        counters.next--;
+        while (!counters.released.empty() && *counters.released.rbegin() + 1 == counters.next) {
+            counters.released.erase(std::prev(counters.released.end()));
+            counters.next--;
+        }
+    } else {
+        counters.released.insert(counter);
+    }
+
+    if (counters.next == 0) {
+        mNames.erase(it);
+    }
+}
+
+size_t LayerNameRegistry::size() const {
+    std::lock_guard lock(mMutex);
+    return mNames.size();
+}
+
+} // namespace android
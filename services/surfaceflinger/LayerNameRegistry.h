@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace android {
+
+/*
+ * Hands out unique layer names of the form "<name>#<counter>", using the
+ * lowest counter that is not taken by a live layer with the same name. Both
+ * acquiring and releasing a name are constant time in the number of layers.
+ * Thread safe.
+ */
+class LayerNameRegistry {
+public:
+    std::string acquire(const std::string& name);
+
+    // Makes a name returned by acquire() available again. Names that were not
+    // acquired from this registry are ignored.
+    void release(const std::string& uniqueName);
+
+    // The number of base names with live layers.
+    size_t size() const;
+
+private:
+    struct Counters {
+        // One past the highest counter in use.
+        uint32_t next = 0;
+        // Released counters below next.
+        std::set<uint32_t> released;
+    };
+
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, Counters> mNames GUARDED_BY(mMutex);
+};
+
+} // namespace android
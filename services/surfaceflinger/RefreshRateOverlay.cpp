@@ -51,11 +51,11 @@ void RefreshRateOverlay::SevenSegmentDrawer::drawRect(const Rect& r, const half4
     }
 }
 
-void RefreshRateOverlay::SevenSegmentDrawer::drawSegment(Segment segment, int left,
+void RefreshRateOverlay::SevenSegmentDrawer::drawSegment(Segment segment, int left, int top,
                                                          const half4& color,
                                                          const sp<GraphicBuffer>& buffer,
                                                          uint8_t* pixels) {
-    const Rect rect = [&]() {
+    Rect rect = [&]() {
         switch (segment) {
             case Segment::Upper:
                 return Rect(left, 0, left + DIGIT_WIDTH, DIGIT_SPACE);
@@ -76,69 +76,87 @@ void RefreshRateOverlay::SevenSegmentDrawer::drawSegment(Segment segment, int le
                 return Rect(left, DIGIT_HEIGHT - DIGIT_SPACE, left + DIGIT_WIDTH, DIGIT_HEIGHT);
         }
     }();
+    rect.offsetBy(0, top);
 
     drawRect(rect, color, buffer, pixels);
 }
 
-void RefreshRateOverlay::SevenSegmentDrawer::drawDigit(int digit, int left, const half4& color,
+void RefreshRateOverlay::SevenSegmentDrawer::drawDigit(int digit, int left, int top,
+                                                       const half4& color,
                                                        const sp<GraphicBuffer>& buffer,
                                                        uint8_t* pixels) {
     if (digit < 0 || digit > 9) return;
 
     if (digit == 0 || digit == 2 || digit == 3 || digit == 5 || digit == 6 || digit == 7 ||
         digit == 8 || digit == 9)
-        drawSegment(Segment::Upper, left, color, buffer, pixels);
+        drawSegment(Segment::Upper, left, top, color, buffer, pixels);
     if (digit == 0 || digit == 4 || digit == 5 || digit == 6 || digit == 8 || digit == 9)
-        drawSegment(Segment::UpperLeft, left, color, buffer, pixels);
+        drawSegment(Segment::UpperLeft, left, top, color, buffer, pixels);
     if (digit == 0 || digit == 1 || digit == 2 || digit == 3 || digit == 4 || digit == 7 ||
         digit == 8 || digit == 9)
-        drawSegment(Segment::UpperRight, left, color, buffer, pixels);
+        drawSegment(Segment::UpperRight, left, top, color, buffer, pixels);
     if (digit == 2 || digit == 3 || digit == 4 || digit == 5 || digit == 6 || digit == 8 ||
         digit == 9)
-        drawSegment(Segment::Middle, left, color, buffer, pixels);
+        drawSegment(Segment::Middle, left, top, color, buffer, pixels);
     if (digit == 0 || digit == 2 || digit == 6 || digit == 8)
-        drawSegment(Segment::LowerLeft, left, color, buffer, pixels);
+        drawSegment(Segment::LowerLeft, left, top, color, buffer, pixels);
     if (digit == 0 || digit == 1 || digit == 3 || digit == 4 || digit == 5 || digit == 6 ||
         digit == 7 || digit == 8 || digit == 9)
-        drawSegment(Segment::LowerRight, left, color, buffer, pixels);
+        drawSegment(Segment::LowerRight, left, top, color, buffer, pixels);
     if (digit == 0 || digit == 2 || digit == 3 || digit == 5 || digit == 6 || digit == 8 ||
         digit == 9)
-        drawSegment(Segment::Buttom, left, color, buffer, pixels);
+        drawSegment(Segment::Buttom, left, top, color, buffer, pixels);
 }
 
-sp<GraphicBuffer> RefreshRateOverlay::SevenSegmentDrawer::drawNumber(int number,
-                                                                     const half4& color) {
-    if (number < 0 || number > 1000) return nullptr;
+void RefreshRateOverlay::SevenSegmentDrawer::drawNumber(int number, int top, const half4& color,
+                                                        const sp<GraphicBuffer>& buffer,
+                                                        uint8_t* pixels) {
+    if (number < 0 || number > 1000) return;
 
     const auto hundreds = number / 100;
     const auto tens = (number / 10) % 10;
     const auto ones = number % 10;
 
-    sp<GraphicBuffer> buffer =
-            new GraphicBuffer(BUFFER_WIDTH, BUFFER_HEIGHT, HAL_PIXEL_FORMAT_RGBA_8888, 1,
-                              GRALLOC_USAGE_SW_WRITE_RARELY | GRALLOC_USAGE_HW_COMPOSER |
-                                      GRALLOC_USAGE_HW_TEXTURE,
-                              "RefreshRateOverlayBuffer");
-    uint8_t* pixels;
-    buffer->lock(GRALLOC_USAGE_SW_WRITE_RARELY, reinterpret_cast<void**>(&pixels));
-    // Clear buffer content
-    drawRect(Rect(BUFFER_WIDTH, BUFFER_HEIGHT), half4(0), buffer, pixels);
     int left = 0;
     if (hundreds != 0) {
-        drawDigit(hundreds, left, color, buffer, pixels);
+        drawDigit(hundreds, left, top, color, buffer, pixels);
         left += DIGIT_WIDTH + DIGIT_SPACE;
     }
 
     if (tens != 0) {
-        drawDigit(tens, left, color, buffer, pixels);
+        drawDigit(tens, left, top, color, buffer, pixels);
         left += DIGIT_WIDTH + DIGIT_SPACE;
     }
 
-    drawDigit(ones, left, color, buffer, pixels);
+    drawDigit(ones, left, top, color, buffer, pixels);
+}
+
+sp<GraphicBuffer> RefreshRateOverlay::SevenSegmentDrawer::drawNumbers(
+        const std::vector<std::pair<int, half4>>& numbers) {
+    if (numbers.empty()) return nullptr;
+
+    const uint32_t height = BUFFER_HEIGHT * numbers.size();
+    sp<GraphicBuffer> buffer =
+            new GraphicBuffer(BUFFER_WIDTH, height, HAL_PIXEL_FORMAT_RGBA_8888, 1,
+                              GRALLOC_USAGE_SW_WRITE_RARELY | GRALLOC_USAGE_HW_COMPOSER |
+                                      GRALLOC_USAGE_HW_TEXTURE,
+                              "RefreshRateOverlayBuffer");
+    uint8_t* pixels;
+    buffer->lock(GRALLOC_USAGE_SW_WRITE_RARELY, reinterpret_cast<void**>(&pixels));
+    // Clear buffer content
+    drawRect(Rect(BUFFER_WIDTH, height), half4(0), buffer, pixels);
+    for (size_t row = 0; row < numbers.size(); row++) {
+        const auto& [number, color] = numbers[row];
+        drawNumber(number, getNumberBounds(row).top, color, buffer, pixels);
+    }
     buffer->unlock();
     return buffer;
 }
 
+Rect RefreshRateOverlay::SevenSegmentDrawer::getNumberBounds(size_t row) {
+    return Rect(0, BUFFER_HEIGHT * row, BUFFER_WIDTH, BUFFER_HEIGHT * (row + 1));
+}
+
 RefreshRateOverlay::RefreshRateOverlay(SurfaceFlinger& flinger)
       : mFlinger(flinger), mClient(new Client(&mFlinger)) {
     createLayer();
@@ -172,11 +190,14 @@ bool RefreshRateOverlay::createLayer() {
 }
 
 void RefreshRateOverlay::primeCache() {
+    std::vector<std::pair<int, half4>> numbers;
     auto& allRefreshRates = mFlinger.mRefreshRateConfigs->getAllRefreshRates();
     if (allRefreshRates.size() == 1) {
-        auto fps = allRefreshRates.begin()->second->getFps();
+        int fps = allRefreshRates.begin()->second->getFps();
         half4 color = {LOW_FPS_COLOR, ALPHA};
-        mBufferCache.emplace(fps, SevenSegmentDrawer::drawNumber(fps, color));
+        numbers.emplace_back(fps, color);
+        mAtlasRows.emplace(fps, 0);
+        mAtlas = SevenSegmentDrawer::drawNumbers(numbers);
         return;
     }
 
@@ -196,8 +217,11 @@ void RefreshRateOverlay::primeCache() {
         color.g = HIGH_FPS_COLOR.g * fpsScale + LOW_FPS_COLOR.g * (1 - fpsScale);
         color.b = HIGH_FPS_COLOR.b * fpsScale + LOW_FPS_COLOR.b * (1 - fpsScale);
         color.a = ALPHA;
-        mBufferCache.emplace(fps, SevenSegmentDrawer::drawNumber(fps, color));
+        if (mAtlasRows.emplace(fps, numbers.size()).second) {
+            numbers.emplace_back(fps, color);
+        }
     }
+    mAtlas = SevenSegmentDrawer::drawNumbers(numbers);
 }
 
 void RefreshRateOverlay::setViewport(ui::Size viewport) {
@@ -209,8 +233,17 @@ void RefreshRateOverlay::setViewport(ui::Size viewport) {
 }
 
 void RefreshRateOverlay::changeRefreshRate(const RefreshRate& refreshRate) {
-    auto buffer = mBufferCache[refreshRate.getFps()];
-    mLayer->setBuffer(buffer, Fence::NO_FENCE, 0, 0, {});
+    const auto row = mAtlasRows.find(refreshRate.getFps());
+    if (row == mAtlasRows.end()) {
+        return;
+    }
+
+    // The atlas is only set once. Switching between rates then only changes the crop.
+    if (!mAtlasIsSet) {
+        mLayer->setBuffer(mAtlas, Fence::NO_FENCE, 0, 0, {});
+        mAtlasIsSet = true;
+    }
+    mLayer->setCrop(SevenSegmentDrawer::getNumberBounds(row->second));
 
     mFlinger.mTransactionFlags.fetch_or(eTransactionMask);
 }
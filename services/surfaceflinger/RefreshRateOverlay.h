@@ -17,6 +17,8 @@
 #pragma once
 
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <math/vec4.h>
 #include <ui/Rect.h>
@@ -46,7 +48,10 @@ public:
 private:
     class SevenSegmentDrawer {
     public:
-        static sp<GraphicBuffer> drawNumber(int number, const half4& color);
+        // Draws each number with its color on its own row of a single atlas buffer, in order.
+        static sp<GraphicBuffer> drawNumbers(const std::vector<std::pair<int, half4>>& numbers);
+        // The bounds of the given row of the atlas.
+        static Rect getNumberBounds(size_t row);
         static uint32_t getHeight() { return BUFFER_HEIGHT; }
         static uint32_t getWidth() { return BUFFER_WIDTH; }
 
@@ -55,10 +60,12 @@ private:
 
         static void drawRect(const Rect& r, const half4& color, const sp<GraphicBuffer>& buffer,
                              uint8_t* pixels);
-        static void drawSegment(Segment segment, int left, const half4& color,
+        static void drawSegment(Segment segment, int left, int top, const half4& color,
                                 const sp<GraphicBuffer>& buffer, uint8_t* pixels);
-        static void drawDigit(int digit, int left, const half4& color,
+        static void drawDigit(int digit, int left, int top, const half4& color,
                               const sp<GraphicBuffer>& buffer, uint8_t* pixels);
+        static void drawNumber(int number, int top, const half4& color,
+                               const sp<GraphicBuffer>& buffer, uint8_t* pixels);
 
         static constexpr uint32_t DIGIT_HEIGHT = 100;
         static constexpr uint32_t DIGIT_WIDTH = 64;
@@ -77,7 +84,11 @@ private:
     sp<IBinder> mIBinder;
     sp<IGraphicBufferProducer> mGbp;
 
-    std::unordered_map<int, sp<GraphicBuffer>> mBufferCache;
+    // All the supported refresh rates are drawn once into a single buffer, and the visible one
+    // is selected with the crop of the layer.
+    sp<GraphicBuffer> mAtlas;
+    std::unordered_map<int, size_t> mAtlasRows;
+    bool mAtlasIsSet = false;
 
     static constexpr float ALPHA = 0.8f;
     const half3 LOW_FPS_COLOR = half3(1.0f, 0.0f, 0.0f);
@@ -32,6 +32,7 @@
 #include <ui/DisplayStatInfo.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <string>
 
 #include "DisplayDevice.h"
@@ -62,6 +63,10 @@ constexpr auto maxRegionSamplingSkips = 10;
 constexpr auto defaultRegionSamplingOffset = -3ms;
 constexpr auto defaultRegionSamplingPeriod = 100ms;
 constexpr auto defaultRegionSamplingTimerTimeout = 100ms;
+// The sampled area is rendered this many times smaller, so that RenderEngine averages pixels as it
+// filters them and fewer are read back on the CPU. With bilinear filtering, a factor of 2 averages
+// each 2x2 block exactly, while larger factors only approximate the mean luma.
+constexpr auto defaultRegionSamplingDownscale = 2;
 // TODO: (b/127403193) duration to string conversion could probably be constexpr
 template <typename Rep, typename Per>
 inline std::string toNsString(std::chrono::duration<Rep, Per> t) {
@@ -173,6 +178,9 @@ RegionSamplingThread::RegionSamplingThread(SurfaceFlinger& flinger, Scheduler& s
                    [] {}, [this] { checkForStaleLuma(); }),
         mPhaseCallback(std::make_unique<SamplingOffsetCallback>(*this, mScheduler,
                                                                 tunables.mSamplingOffset)),
+        mDownscale(std::max(1,
+                            property_get_int32("debug.sf.region_sampling_downscale",
+                                               defaultRegionSamplingDownscale))),
         lastSampleTime(0ns) {
     mThread = std::thread([this]() { threadMain(); });
     pthread_setname_np(mThread.native_handle(), "RegionSamplingThread");
@@ -309,7 +317,8 @@ float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t st
 
 std::vector<float> RegionSamplingThread::sampleBuffer(
         const sp<GraphicBuffer>& buffer, const Point& leftTop,
-        const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation) {
+        const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation,
+        int32_t downscale) {
     void* data_raw = nullptr;
     buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &data_raw);
     std::shared_ptr<uint32_t> data(reinterpret_cast<uint32_t*>(data_raw),
@@ -322,8 +331,15 @@ std::vector<float> RegionSamplingThread::sampleBuffer(
     std::vector<float> lumas(descriptors.size());
     std::transform(descriptors.begin(), descriptors.end(), lumas.begin(),
                    [&](auto const& descriptor) {
+                       // Round outwards, so that small areas still cover at least one pixel.
+                       const Rect area = descriptor.area - leftTop;
+                       const Rect scaledArea(area.left / downscale, area.top / downscale,
+                                             std::min((area.right + downscale - 1) / downscale,
+                                                      width),
+                                             std::min((area.bottom + downscale - 1) / downscale,
+                                                      height));
                        return sampleArea(data.get(), width, height, stride, orientation,
-                                         descriptor.area - leftTop);
+                                         scaledArea);
                    });
     return lumas;
 }
@@ -347,6 +363,8 @@ void RegionSamplingThread::captureSample() {
     }
 
     const Rect sampledArea = sampleRegion.bounds();
+    const int32_t sampleWidth = std::max(1, sampledArea.getWidth() / mDownscale);
+    const int32_t sampleHeight = std::max(1, sampledArea.getHeight() / mDownscale);
 
     auto dx = 0;
     auto dy = 0;
@@ -368,8 +386,8 @@ void RegionSamplingThread::captureSample() {
     ui::Transform t(orientation);
     auto screencapRegion = t.transform(sampleRegion);
     screencapRegion = screencapRegion.translate(dx, dy);
-    DisplayRenderArea renderArea(device, screencapRegion.bounds(), sampledArea.getWidth(),
-                                 sampledArea.getHeight(), ui::Dataspace::V0_SRGB, orientation);
+    DisplayRenderArea renderArea(device, screencapRegion.bounds(), sampleWidth, sampleHeight,
+                                 ui::Dataspace::V0_SRGB, orientation);
 
     std::unordered_set<sp<IRegionSamplingListener>, SpHash<IRegionSamplingListener>> listeners;
 
@@ -415,13 +433,16 @@ void RegionSamplingThread::captureSample() {
     };
 
     sp<GraphicBuffer> buffer = nullptr;
-    if (mCachedBuffer && mCachedBuffer->getWidth() == sampledArea.getWidth() &&
-        mCachedBuffer->getHeight() == sampledArea.getHeight()) {
+    if (mCachedBuffer && mCachedBuffer->getWidth() == sampleWidth &&
+        mCachedBuffer->getHeight() == sampleHeight) {
         buffer = mCachedBuffer;
     } else {
         const uint32_t usage = GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER;
-        buffer = new GraphicBuffer(sampledArea.getWidth(), sampledArea.getHeight(),
-                                   PIXEL_FORMAT_RGBA_8888, 1, usage, "RegionSamplingThread");
+        buffer = new GraphicBuffer(sampleWidth, sampleHeight, PIXEL_FORMAT_RGBA_8888, 1, usage,
+                                   "RegionSamplingThread");
+        // The sampling buffer never leaves SurfaceFlinger, so it can be reused once the sampled
+        // area changes size.
+        buffer->setRecyclable(true);
     }
 
     bool ignored;
@@ -437,7 +458,8 @@ void RegionSamplingThread::captureSample() {
 
     ALOGV("Sampling %zu descriptors", activeDescriptors.size());
     std::vector<float> lumas =
-            sampleBuffer(buffer, sampledArea.leftTop(), activeDescriptors, orientation);
+            sampleBuffer(buffer, sampledArea.leftTop(), activeDescriptors, orientation,
+                         mDownscale);
     if (lumas.size() != activeDescriptors.size()) {
         ALOGW("collected %zu median luma values for %zu descriptors", lumas.size(),
               activeDescriptors.size());
@@ -95,7 +95,8 @@ private:
     };
     std::vector<float> sampleBuffer(
             const sp<GraphicBuffer>& buffer, const Point& leftTop,
-            const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation);
+            const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation,
+            int32_t downscale);
 
     void doSample();
     void binderDied(const wp<IBinder>& who) override;
@@ -111,6 +112,10 @@ private:
 
     std::unique_ptr<SamplingOffsetCallback> const mPhaseCallback;
 
+    // debug.sf.region_sampling_downscale
+    // How many times smaller than the sampled area the sample buffer is rendered.
+    const int32_t mDownscale;
+
     std::thread mThread;
 
     std::mutex mThreadControlMutex;
@@ -24,6 +24,7 @@
 #include <sched.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <optional>
@@ -31,6 +32,7 @@
 
 #include <android-base/stringprintf.h>
 
+#include <binder/IPCThreadState.h>
 #include <bfqio/bfqio.h>
 #include <cutils/compiler.h>
 #include <cutils/sched_policy.h>
@@ -68,8 +70,10 @@ std::string toString(VSyncRequest request) {
 }
 
 std::string toString(const EventThreadConnection& connection) {
-    return StringPrintf("Connection{%p, %s}", &connection,
-                        toString(connection.vsyncRequest).c_str());
+    return StringPrintf("Connection{%p, uid=%d, %s, wakeups=%zu, throttledVSyncs=%zu}",
+                        &connection, connection.mOwnerUid,
+                        toString(connection.vsyncRequest).c_str(), connection.wakeupCount,
+                        connection.throttledVSyncCount);
 }
 
 std::string toString(const DisplayEventReceiver::Event& event) {
@@ -92,6 +96,12 @@ std::string toString(const DisplayEventReceiver::Event& event) {
     }
 }
 
+bool hasVSync(const std::vector<DisplayEventReceiver::Event>& events) {
+    return std::any_of(events.begin(), events.end(), [](const auto& event) {
+        return event.header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC;
+    });
+}
+
 DisplayEventReceiver::Event makeHotplug(PhysicalDisplayId displayId, nsecs_t timestamp,
                                         bool connected) {
     DisplayEventReceiver::Event event;
@@ -120,11 +130,12 @@ DisplayEventReceiver::Event makeConfigChanged(PhysicalDisplayId displayId,
 
 } // namespace
 
-EventThreadConnection::EventThreadConnection(EventThread* eventThread,
+EventThreadConnection::EventThreadConnection(EventThread* eventThread, uid_t callingUid,
                                              ResyncCallback resyncCallback,
                                              ISurfaceComposer::ConfigChanged configChanged)
       : resyncCallback(std::move(resyncCallback)),
         mConfigChanged(configChanged),
+        mOwnerUid(callingUid),
         mEventThread(eventThread),
         mChannel(gui::BitTube::DefaultSize) {}
 
@@ -159,6 +170,14 @@ status_t EventThreadConnection::postEvent(const DisplayEventReceiver::Event& eve
     return size < 0 ? status_t(size) : status_t(NO_ERROR);
 }
 
+status_t EventThreadConnection::postEvents(const std::vector<DisplayEventReceiver::Event>& events) {
+    if (events.size() == 1) {
+        return postEvent(events.front());
+    }
+    ssize_t size = DisplayEventReceiver::sendEvents(&mChannel, events.data(), events.size());
+    return size < 0 ? status_t(size) : status_t(NO_ERROR);
+}
+
 // ---------------------------------------------------------------------------
 
 EventThread::~EventThread() = default;
@@ -212,8 +231,9 @@ void EventThread::setPhaseOffset(nsecs_t phaseOffset) {
 
 sp<EventThreadConnection> EventThread::createEventConnection(
         ResyncCallback resyncCallback, ISurfaceComposer::ConfigChanged configChanged) const {
-    return new EventThreadConnection(const_cast<EventThread*>(this), std::move(resyncCallback),
-                                     configChanged);
+    return new EventThreadConnection(const_cast<EventThread*>(this),
+                                     IPCThreadState::self()->getCallingUid(),
+                                     std::move(resyncCallback), configChanged);
 }
 
 status_t EventThread::registerDisplayEventConnection(const sp<EventThreadConnection>& connection) {
@@ -317,45 +337,90 @@ size_t EventThread::getEventThreadConnectionCount() {
     return mDisplayEventConnections.size();
 }
 
+void EventThread::setFrameRateDividers(FrameRateDividers dividers) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFrameRateDividers = std::move(dividers);
+}
+
+void EventThread::setDispatchDelays(DispatchDelays delays) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDispatchDelays = std::move(delays);
+}
+
+nsecs_t EventThread::getLastVSyncDispatchTime(uid_t uid, nsecs_t time) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (const auto it = mLastVSyncDispatchTimes.find(uid); it != mLastVSyncDispatchTimes.end()) {
+        for (const nsecs_t dispatchTime : it->second) {
+            if (dispatchTime <= time) {
+                return dispatchTime;
+            }
+        }
+    }
+    return 0;
+}
+
 void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
+    DisplayEvents events;
     DisplayEventConsumers consumers;
 
     while (mState != State::Quit) {
-        std::optional<DisplayEventReceiver::Event> event;
-
-        // Determine next event to dispatch.
-        if (!mPendingEvents.empty()) {
-            event = mPendingEvents.front();
+        // Take all pending events, so that each connection receives them in a single write.
+        while (!mPendingEvents.empty()) {
+            const auto& event = events.emplace_back(mPendingEvents.front());
             mPendingEvents.pop_front();
 
-            switch (event->header.type) {
+            switch (event.header.type) {
                 case DisplayEventReceiver::DISPLAY_EVENT_HOTPLUG:
-                    if (event->hotplug.connected && !mVSyncState) {
-                        mVSyncState.emplace(event->header.displayId);
-                    } else if (!event->hotplug.connected && mVSyncState &&
-                               mVSyncState->displayId == event->header.displayId) {
+                    if (event.hotplug.connected && !mVSyncState) {
+                        mVSyncState.emplace(event.header.displayId);
+                    } else if (!event.hotplug.connected && mVSyncState &&
+                               mVSyncState->displayId == event.header.displayId) {
                         mVSyncState.reset();
                     }
                     break;
 
                 case DisplayEventReceiver::DISPLAY_EVENT_VSYNC:
                     if (mInterceptVSyncsCallback) {
-                        mInterceptVSyncsCallback(event->header.timestamp);
+                        mInterceptVSyncsCallback(event.header.timestamp);
                     }
                     break;
             }
         }
 
+        // Send the delayed events that are due first, so that each connection receives its events
+        // in order.
+        const nsecs_t wakeTime = systemTime(SYSTEM_TIME_MONOTONIC);
+        while (!mDelayedConsumers.empty() &&
+               mDelayedConsumers.front().dispatchTime <= wakeTime) {
+            consumers.push_back(std::move(mDelayedConsumers.front().consumer));
+            mDelayedConsumers.pop_front();
+        }
+        if (!consumers.empty()) {
+            dispatchEvents(consumers);
+            consumers.clear();
+        }
+
         bool vsyncRequested = false;
 
-        // Find connections that should consume this event.
+        // Find connections that should consume these events.
         auto it = mDisplayEventConnections.begin();
         while (it != mDisplayEventConnections.end()) {
             if (const auto connection = it->promote()) {
                 vsyncRequested |= connection->vsyncRequest != VSyncRequest::None;
 
-                if (event && shouldConsumeEvent(*event, connection)) {
-                    consumers.push_back(connection);
+                DisplayEventConsumer* consumer = nullptr;
+                for (const auto& event : events) {
+                    if (!shouldConsumeEvent(event, connection)) {
+                        continue;
+                    }
+                    if (!consumer) {
+                        consumer = &consumers.emplace_back();
+                        consumer->connection = connection;
+                    }
+                    consumer->events.push_back(event);
+                }
+                if (consumer && delayConsumer(*consumer, wakeTime)) {
+                    consumers.pop_back();
                 }
 
                 ++it;
@@ -365,10 +430,13 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
         }
 
         if (!consumers.empty()) {
-            dispatchEvent(*event, consumers);
+            dispatchEvents(consumers);
             consumers.clear();
         }
 
+        const bool hadEvents = !events.empty();
+        events.clear();
+
         State nextState;
         if (mVSyncState && vsyncRequested) {
             nextState = mVSyncState->synthetic ? State::SyntheticVSync : State::VSync;
@@ -387,7 +455,18 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
             mState = nextState;
         }
 
-        if (event) {
+        if (hadEvents) {
+            continue;
+        }
+
+        // Wait for the delayed events instead, which are due within a fraction of a frame, so that
+        // the wait does not count as a driver stall.
+        if (!mDelayedConsumers.empty()) {
+            const nsecs_t timeout =
+                    mDelayedConsumers.front().dispatchTime - systemTime(SYSTEM_TIME_MONOTONIC);
+            if (timeout > 0) {
+                mCondition.wait_for(lock, std::chrono::nanoseconds(timeout));
+            }
             continue;
         }
 
@@ -433,7 +512,19 @@ bool EventThread::shouldConsumeEvent(const DisplayEventReceiver::Event& event,
             return connection->mConfigChanged == ISurfaceComposer::eConfigChangedDispatch;
         }
 
-        case DisplayEventReceiver::DISPLAY_EVENT_VSYNC:
+        case DisplayEventReceiver::DISPLAY_EVENT_VSYNC: {
+            if (connection->vsyncRequest == VSyncRequest::None) {
+                return false;
+            }
+
+            // A throttled request is kept, and served on the next VSYNC the divider lets through.
+            if (const auto divider = mFrameRateDividers.find(connection->mOwnerUid);
+                divider != mFrameRateDividers.end() && divider->second > 1 &&
+                event.vsync.count % divider->second != 0) {
+                connection->throttledVSyncCount++;
+                return false;
+            }
+
             switch (connection->vsyncRequest) {
                 case VSyncRequest::None:
                     return false;
@@ -445,28 +536,64 @@ bool EventThread::shouldConsumeEvent(const DisplayEventReceiver::Event& event,
                 default:
                     return event.vsync.count % vsyncPeriod(connection->vsyncRequest) == 0;
             }
+        }
 
         default:
             return false;
     }
 }
 
-void EventThread::dispatchEvent(const DisplayEventReceiver::Event& event,
-                                const DisplayEventConsumers& consumers) {
-    for (const auto& consumer : consumers) {
-        switch (consumer->postEvent(event)) {
+bool EventThread::delayConsumer(DisplayEventConsumer& consumer, nsecs_t now) {
+    const auto pending =
+            std::find_if(mDelayedConsumers.begin(), mDelayedConsumers.end(),
+                         [&](const auto& delayed) {
+                             return delayed.consumer.connection == consumer.connection;
+                         });
+    if (pending != mDelayedConsumers.end()) {
+        auto& events = pending->consumer.events;
+        events.insert(events.end(), consumer.events.begin(), consumer.events.end());
+        return true;
+    }
+
+    const auto delay = mDispatchDelays.find(consumer.connection->mOwnerUid);
+    if (delay == mDispatchDelays.end() || delay->second <= 0 || !hasVSync(consumer.events)) {
+        return false;
+    }
+
+    const nsecs_t dispatchTime = now + delay->second;
+    const auto position =
+            std::upper_bound(mDelayedConsumers.begin(), mDelayedConsumers.end(), dispatchTime,
+                             [](nsecs_t time, const auto& delayed) {
+                                 return time < delayed.dispatchTime;
+                             });
+    mDelayedConsumers.insert(position,
+                             DelayedDisplayEventConsumer{dispatchTime, std::move(consumer)});
+    return true;
+}
+
+void EventThread::dispatchEvents(const DisplayEventConsumers& consumers) {
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (const auto& [connection, events] : consumers) {
+        connection->wakeupCount++;
+        switch (connection->postEvents(events)) {
             case NO_ERROR:
+                if (hasVSync(events)) {
+                    auto& times = mLastVSyncDispatchTimes[connection->mOwnerUid];
+                    if (times[0] != now) {
+                        times = {now, times[0]};
+                    }
+                }
                 break;
 
             case -EAGAIN:
                 // TODO: Try again if pipe is full.
-                ALOGW("Failed dispatching %s for %s", toString(event).c_str(),
-                      toString(*consumer).c_str());
+                ALOGW("Failed dispatching %s for %s", toString(events.back()).c_str(),
+                      toString(*connection).c_str());
                 break;
 
             default:
                 // Treat EPIPE and other errors as fatal.
-                removeDisplayEventConnectionLocked(consumer);
+                removeDisplayEventConnectionLocked(connection);
         }
     }
 }
@@ -488,6 +615,23 @@ void EventThread::dump(std::string& result) const {
         StringAppendF(&result, "    %s\n", toString(event).c_str());
     }
 
+    if (!mFrameRateDividers.empty()) {
+        StringAppendF(&result, "  frame rate dividers:");
+        for (const auto& [uid, divider] : mFrameRateDividers) {
+            StringAppendF(&result, " {uid=%d, divider=%u}", uid, divider);
+        }
+        StringAppendF(&result, "\n");
+    }
+
+    if (!mDispatchDelays.empty()) {
+        StringAppendF(&result, "  dispatch delays (delayed consumers=%zu):",
+                      mDelayedConsumers.size());
+        for (const auto& [uid, delay] : mDispatchDelays) {
+            StringAppendF(&result, " {uid=%d, delay=%.2fms}", uid, delay / 1e6f);
+        }
+        StringAppendF(&result, "\n");
+    }
+
     StringAppendF(&result, "  connections (count=%zu):\n", mDisplayEventConnections.size());
     for (const auto& ptr : mDisplayEventConnections) {
         if (const auto connection = ptr.promote()) {
@@ -23,12 +23,14 @@
 #include <sys/types.h>
 #include <utils/Errors.h>
 
+#include <array>
 #include <condition_variable>
 #include <cstdint>
 #include <deque>
 #include <mutex>
 #include <optional>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "HwcStrongTypes.h"
@@ -72,11 +74,13 @@ public:
 
 class EventThreadConnection : public BnDisplayEventConnection {
 public:
-    EventThreadConnection(EventThread*, ResyncCallback,
+    EventThreadConnection(EventThread*, uid_t callingUid, ResyncCallback,
                           ISurfaceComposer::ConfigChanged configChanged);
     virtual ~EventThreadConnection();
 
     virtual status_t postEvent(const DisplayEventReceiver::Event& event);
+    // Sends the events with a single write, so that the receiver only wakes up once.
+    virtual status_t postEvents(const std::vector<DisplayEventReceiver::Event>& events);
 
     status_t stealReceiveChannel(gui::BitTube* outChannel) override;
     status_t setVsyncRate(uint32_t rate) override;
@@ -89,6 +93,13 @@ public:
     const ISurfaceComposer::ConfigChanged mConfigChanged =
             ISurfaceComposer::ConfigChanged::eConfigChangedSuppress;
 
+    // The uid of the process that created the connection.
+    const uid_t mOwnerUid;
+
+    // Number of writes to the channel, and of VSYNC events held back by a frame rate divider.
+    size_t wakeupCount = 0;
+    size_t throttledVSyncCount = 0;
+
 private:
     virtual void onFirstRef();
     EventThread* const mEventThread;
@@ -97,6 +108,12 @@ private:
 
 class EventThread {
 public:
+    // Keyed by uid. A connection owned by one of the uids only receives every nth VSYNC event.
+    using FrameRateDividers = std::unordered_map<uid_t, uint32_t>;
+    // Keyed by uid. VSYNC events for a connection owned by one of the uids are sent that long after
+    // the VSYNC callback, with their timestamps unchanged.
+    using DispatchDelays = std::unordered_map<uid_t, nsecs_t>;
+
     virtual ~EventThread();
 
     virtual sp<EventThreadConnection> createEventConnection(
@@ -126,6 +143,19 @@ public:
 
     // Retrieves the number of event connections tracked by this EventThread.
     virtual size_t getEventThreadConnectionCount() = 0;
+
+    // Throttles the VSYNC events sent to the connections of the given uids, for example to the
+    // frame rate an app voted for. Replaces the previous dividers.
+    virtual void setFrameRateDividers(FrameRateDividers dividers) = 0;
+
+    // Delays the VSYNC events sent to the connections of the given uids, so that apps that finish
+    // their frames early start them closer to when SurfaceFlinger latches them. Replaces the
+    // previous delays.
+    virtual void setDispatchDelays(DispatchDelays delays) = 0;
+
+    // Returns when a VSYNC event was last sent to a connection of the uid at or before the given
+    // time, or 0 if it is not known.
+    virtual nsecs_t getLastVSyncDispatchTime(uid_t uid, nsecs_t time) const = 0;
 };
 
 namespace impl {
@@ -161,17 +191,39 @@ public:
 
     size_t getEventThreadConnectionCount() override;
 
+    void setFrameRateDividers(FrameRateDividers dividers) override;
+
+    void setDispatchDelays(DispatchDelays delays) override;
+
+    nsecs_t getLastVSyncDispatchTime(uid_t uid, nsecs_t time) const override;
+
 private:
     friend EventThreadTest;
 
-    using DisplayEventConsumers = std::vector<sp<EventThreadConnection>>;
+    using DisplayEvents = std::vector<DisplayEventReceiver::Event>;
+
+    // A connection and the events it should receive, in order.
+    struct DisplayEventConsumer {
+        sp<EventThreadConnection> connection;
+        DisplayEvents events;
+    };
+    using DisplayEventConsumers = std::vector<DisplayEventConsumer>;
+
+    // A consumer held back by the dispatch delay of the connection's owner.
+    struct DelayedDisplayEventConsumer {
+        nsecs_t dispatchTime;
+        DisplayEventConsumer consumer;
+    };
 
     void threadMain(std::unique_lock<std::mutex>& lock) REQUIRES(mMutex);
 
     bool shouldConsumeEvent(const DisplayEventReceiver::Event& event,
                             const sp<EventThreadConnection>& connection) const REQUIRES(mMutex);
-    void dispatchEvent(const DisplayEventReceiver::Event& event,
-                       const DisplayEventConsumers& consumers) REQUIRES(mMutex);
+    void dispatchEvents(const DisplayEventConsumers& consumers) REQUIRES(mMutex);
+
+    // Holds the consumer back if its connection already has delayed events, or if it receives a
+    // VSYNC event and its owner has a dispatch delay. Returns false if it should be sent now.
+    bool delayConsumer(DisplayEventConsumer& consumer, nsecs_t now) REQUIRES(mMutex);
 
     void removeDisplayEventConnectionLocked(const wp<EventThreadConnection>& connection)
             REQUIRES(mMutex);
@@ -190,6 +242,14 @@ private:
 
     std::vector<wp<EventThreadConnection>> mDisplayEventConnections GUARDED_BY(mMutex);
     std::deque<DisplayEventReceiver::Event> mPendingEvents GUARDED_BY(mMutex);
+    FrameRateDividers mFrameRateDividers GUARDED_BY(mMutex);
+    DispatchDelays mDispatchDelays GUARDED_BY(mMutex);
+
+    // Ordered by dispatch time. Holds at most one consumer per connection.
+    std::deque<DelayedDisplayEventConsumer> mDelayedConsumers GUARDED_BY(mMutex);
+
+    // The last two times a VSYNC event was sent to a connection of each uid, most recent first.
+    std::unordered_map<uid_t, std::array<nsecs_t, 2>> mLastVSyncDispatchTimes GUARDED_BY(mMutex);
 
     // VSYNC state of connected display.
     struct VSyncState {
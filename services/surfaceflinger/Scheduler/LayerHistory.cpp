@@ -125,11 +125,11 @@ LayerHistory::Summary LayerHistory::summarize(nsecs_t now) {
                     }
                 }();
                 summary.push_back({layer->getName(), voteType, frameRate.rate, /* weight */ 1.0f,
-                                   layerFocused});
+                                   layerFocused, layer->getOwnerUid()});
             } else if (recent) {
                 summary.push_back({layer->getName(), LayerVoteType::Heuristic,
                                    info->getRefreshRate(now),
-                                   /* weight */ 1.0f, layerFocused});
+                                   /* weight */ 1.0f, layerFocused, layer->getOwnerUid()});
             }
 
             if (CC_UNLIKELY(mTraceEnabled)) {
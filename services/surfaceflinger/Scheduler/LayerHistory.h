@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -45,10 +46,13 @@ public:
 
     virtual ~LayerHistory() = default;
 
-    // Layers are unregistered when the weak reference expires.
+    // Layers are registered on creation, and deregistered when they are destroyed.
     virtual void registerLayer(Layer*, float lowRefreshRate, float highRefreshRate,
                                LayerVoteType type) = 0;
 
+    // Called from the layer destructor, so the layer must not be dereferenced.
+    virtual void deregisterLayer(Layer*) = 0;
+
     // Sets the display size. Client is responsible for synchronization.
     virtual void setDisplayArea(uint32_t displayArea) = 0;
 
@@ -86,6 +90,8 @@ public:
     void registerLayer(Layer*, float lowRefreshRate, float highRefreshRate,
                        LayerVoteType type) override;
 
+    void deregisterLayer(Layer*) override {}
+
     void setDisplayArea(uint32_t /*displayArea*/) override {}
 
     void setConfigChangePending(bool /*pending*/) override {}
@@ -139,10 +145,11 @@ public:
     LayerHistoryV2(const scheduler::RefreshRateConfigs&);
     virtual ~LayerHistoryV2();
 
-    // Layers are unregistered when the weak reference expires.
     void registerLayer(Layer*, float lowRefreshRate, float highRefreshRate,
                        LayerVoteType type) override;
 
+    void deregisterLayer(Layer*) override;
+
     // Sets the display size. Client is responsible for synchronization.
     void setDisplayArea(uint32_t displayArea) override { mDisplayArea = displayArea; }
 
@@ -173,17 +180,24 @@ private:
 
     ActiveLayers activeLayers() REQUIRES(mLock) { return {mLayerInfos, mActiveLayersEnd}; }
 
-    // Iterates over layers in a single pass, swapping pairs such that active layers precede
-    // inactive layers, and inactive layers precede expired layers. Removes expired layers by
-    // truncating after inactive layers.
-    void partitionLayers(nsecs_t now) REQUIRES(mLock);
+    // Iterates over the active layers in a single pass, swapping pairs such that active layers
+    // precede inactive layers. Inactive layers are left alone until they are recorded again or
+    // deregistered. Returns a strong reference to each active layer in order, and to each layer
+    // made inactive. They must be released after mLock, since releasing the last reference to a
+    // layer destroys and deregisters it.
+    void partitionLayers(nsecs_t now, std::vector<sp<Layer>>* outActiveLayers,
+                         std::vector<sp<Layer>>* outInactiveLayers) REQUIRES(mLock);
+
+    void swapLayers(size_t i, size_t j) REQUIRES(mLock);
 
     mutable std::mutex mLock;
 
-    // Partitioned such that active layers precede inactive layers. For fast lookup, the few active
-    // layers are at the front, and weak pointers are stored in contiguous memory to hit the cache.
+    // Partitioned such that active layers precede inactive layers, so that each frame only
+    // walks the few active layers at the front.
     LayerInfos mLayerInfos GUARDED_BY(mLock);
     size_t mActiveLayersEnd GUARDED_BY(mLock) = 0;
+    // The index of each layer in mLayerInfos, so that recording does not search for it.
+    std::unordered_map<const Layer*, size_t> mLayerIndices GUARDED_BY(mLock);
 
     uint32_t mDisplayArea = 0;
 
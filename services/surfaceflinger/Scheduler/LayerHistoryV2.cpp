@@ -58,11 +58,8 @@ bool useFrameRatePriority() {
     return atoi(value);
 }
 
-void trace(const wp<Layer>& weak, const LayerInfoV2& info, LayerHistory::LayerVoteType type,
+void trace(const Layer& layer, const LayerInfoV2& info, LayerHistory::LayerVoteType type,
            int fps) {
-    const auto layer = weak.promote();
-    if (!layer) return;
-
     const auto traceType = [&](LayerHistory::LayerVoteType checkedType, int value) {
         ATRACE_INT(info.getTraceTag(checkedType), type == checkedType ? value : 0);
     };
@@ -74,7 +71,7 @@ void trace(const wp<Layer>& weak, const LayerInfoV2& info, LayerHistory::LayerVo
     traceType(LayerHistory::LayerVoteType::Min, 1);
     traceType(LayerHistory::LayerVoteType::Max, 1);
 
-    ALOGD("%s: %s @ %d Hz", __FUNCTION__, layer->getName().c_str(), fps);
+    ALOGD("%s: %s @ %d Hz", __FUNCTION__, layer.getName().c_str(), fps);
 }
 } // namespace
 
@@ -91,39 +88,69 @@ void LayerHistoryV2::registerLayer(Layer* layer, float /*lowRefreshRate*/, float
     const nsecs_t highRefreshRatePeriod = static_cast<nsecs_t>(1e9f / highRefreshRate);
     auto info = std::make_unique<LayerInfoV2>(layer->getName(), highRefreshRatePeriod, type);
     std::lock_guard lock(mLock);
+    mLayerIndices.emplace(layer, mLayerInfos.size());
     mLayerInfos.emplace_back(layer, std::move(info));
 }
 
+void LayerHistoryV2::deregisterLayer(Layer* layer) {
+    std::lock_guard lock(mLock);
+
+    const auto it = mLayerIndices.find(layer);
+    if (it == mLayerIndices.end()) {
+        return;
+    }
+
+    // Move the layer to the end, keeping active layers in front of inactive ones.
+    size_t index = it->second;
+    if (index < mActiveLayersEnd) {
+        swapLayers(index, --mActiveLayersEnd);
+        index = mActiveLayersEnd;
+    }
+    swapLayers(index, mLayerInfos.size() - 1);
+    mLayerInfos.pop_back();
+    mLayerIndices.erase(layer);
+}
+
+void LayerHistoryV2::swapLayers(size_t i, size_t j) {
+    if (i == j) {
+        return;
+    }
+    std::swap(mLayerInfos[i], mLayerInfos[j]);
+    mLayerIndices[mLayerInfos[i].first.unsafe_get()] = i;
+    mLayerIndices[mLayerInfos[j].first.unsafe_get()] = j;
+}
+
 void LayerHistoryV2::record(Layer* layer, nsecs_t presentTime, nsecs_t now,
                             LayerUpdateType updateType) {
     std::lock_guard lock(mLock);
 
-    const auto it = std::find_if(mLayerInfos.begin(), mLayerInfos.end(),
-                                 [layer](const auto& pair) { return pair.first == layer; });
-    LOG_FATAL_IF(it == mLayerInfos.end(), "%s: unknown layer %p", __FUNCTION__, layer);
+    const auto it = mLayerIndices.find(layer);
+    LOG_FATAL_IF(it == mLayerIndices.end(), "%s: unknown layer %p", __FUNCTION__, layer);
+    const size_t index = it->second;
 
-    const auto& info = it->second;
+    const auto& info = mLayerInfos[index].second;
     info->setLastPresentTime(presentTime, now, updateType, mConfigChangePending);
 
     // Activate layer if inactive.
-    if (const auto end = activeLayers().end(); it >= end) {
-        std::iter_swap(it, end);
+    if (index >= mActiveLayersEnd) {
+        swapLayers(index, mActiveLayersEnd);
         mActiveLayersEnd++;
     }
 }
 
 LayerHistoryV2::Summary LayerHistoryV2::summarize(nsecs_t now) {
     LayerHistory::Summary summary;
+    // Declared before the lock, so that the references are released after it.
+    std::vector<sp<Layer>> activeLayers;
+    std::vector<sp<Layer>> inactiveLayers;
 
     std::lock_guard lock(mLock);
 
-    partitionLayers(now);
+    partitionLayers(now, &activeLayers, &inactiveLayers);
 
-    for (const auto& [layer, info] : activeLayers()) {
-        const auto strong = layer.promote();
-        if (!strong) {
-            continue;
-        }
+    for (size_t i = 0; i < activeLayers.size(); i++) {
+        const auto& strong = activeLayers[i];
+        const auto& info = mLayerInfos[i].second;
 
         const auto frameRateSelectionPriority = strong->getFrameRateSelectionPriority();
         const auto layerFocused = Layer::isLayerFocusedBasedOnPriority(frameRateSelectionPriority);
@@ -144,24 +171,28 @@ LayerHistoryV2::Summary LayerHistoryV2::summarize(nsecs_t now) {
 
         const float layerArea = transformed.getWidth() * transformed.getHeight();
         float weight = mDisplayArea ? layerArea / mDisplayArea : 0.0f;
-        summary.push_back({strong->getName(), type, refreshRate, weight, layerFocused});
+        summary.push_back({strong->getName(), type, refreshRate, weight, layerFocused,
+                           strong->getOwnerUid()});
 
         if (CC_UNLIKELY(mTraceEnabled)) {
-            trace(layer, *info, type, static_cast<int>(std::round(refreshRate)));
+            trace(*strong, *info, type, static_cast<int>(std::round(refreshRate)));
         }
     }
 
     return summary;
 }
 
-void LayerHistoryV2::partitionLayers(nsecs_t now) {
+void LayerHistoryV2::partitionLayers(nsecs_t now, std::vector<sp<Layer>>* outActiveLayers,
+                                     std::vector<sp<Layer>>* outInactiveLayers) {
     const nsecs_t threshold = getActiveLayerThreshold(now);
 
-    // Collect expired and inactive layers after active layers.
+    // Collect inactive layers after active layers. A layer that cannot be promoted is being
+    // destroyed, and is kept as inactive until it is deregistered.
     size_t i = 0;
     while (i < mActiveLayersEnd) {
         auto& [weak, info] = mLayerInfos[i];
-        if (const auto layer = weak.promote(); layer && isLayerActive(*layer, *info, threshold)) {
+        auto layer = weak.promote();
+        if (layer && isLayerActive(*layer, *info, threshold)) {
             i++;
             // Set layer vote if set
             const auto frameRate = layer->getFrameRateForLayerTree();
@@ -182,28 +213,20 @@ void LayerHistoryV2::partitionLayers(nsecs_t now) {
             } else {
                 info->resetLayerVote();
             }
+            outActiveLayers->push_back(std::move(layer));
             continue;
         }
 
-        if (CC_UNLIKELY(mTraceEnabled)) {
-            trace(weak, *info, LayerHistory::LayerVoteType::NoVote, 0);
+        if (CC_UNLIKELY(mTraceEnabled) && layer) {
+            trace(*layer, *info, LayerHistory::LayerVoteType::NoVote, 0);
         }
 
         info->onLayerInactive(now);
-        std::swap(mLayerInfos[i], mLayerInfos[--mActiveLayersEnd]);
-    }
-
-    // Collect expired layers after inactive layers.
-    size_t end = mLayerInfos.size();
-    while (i < end) {
-        if (mLayerInfos[i].first.promote()) {
-            i++;
-        } else {
-            std::swap(mLayerInfos[i], mLayerInfos[--end]);
+        if (layer) {
+            outInactiveLayers->push_back(std::move(layer));
         }
+        swapLayers(i, --mActiveLayersEnd);
     }
-
-    mLayerInfos.erase(mLayerInfos.begin() + static_cast<long>(end), mLayerInfos.end());
 }
 
 void LayerHistoryV2::clear() {
@@ -104,6 +104,10 @@ void MessageQueue::postMessage(sp<MessageHandler>&& handler) {
     mLooper->sendMessage(handler, Message());
 }
 
+void MessageQueue::postMessageDelayed(sp<MessageHandler>&& handler, nsecs_t delay) {
+    mLooper->sendMessageDelayed(delay, handler, Message());
+}
+
 void MessageQueue::invalidate() {
     mEvents->requestNextVsync();
 }
@@ -66,6 +66,7 @@ public:
     virtual void setEventConnection(const sp<EventThreadConnection>& connection) = 0;
     virtual void waitMessage() = 0;
     virtual void postMessage(sp<MessageHandler>&&) = 0;
+    virtual void postMessageDelayed(sp<MessageHandler>&&, nsecs_t delay) = 0;
     virtual void invalidate() = 0;
     virtual void refresh() = 0;
 };
@@ -106,6 +107,7 @@ public:
 
     void waitMessage() override;
     void postMessage(sp<MessageHandler>&&) override;
+    void postMessageDelayed(sp<MessageHandler>&&, nsecs_t delay) override;
 
     // sends INVALIDATE message at next VSYNC
     void invalidate() override;
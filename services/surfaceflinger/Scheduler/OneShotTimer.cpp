@@ -16,13 +16,110 @@
 
 #include "OneShotTimer.h"
 
+#include <android-base/thread_annotations.h>
+#include <pthread.h>
+
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <sstream>
 #include <thread>
+#include <vector>
 
 namespace android {
 namespace scheduler {
 
+// Runs the callbacks of every started timer on one thread, which sleeps until the earliest
+// deadline. Callbacks are run without the lock held, one at a time.
+class OneShotTimer::Dispatcher {
+public:
+    // Never destroyed, so that timers owned by static objects can be stopped at exit.
+    static Dispatcher& getInstance() {
+        static Dispatcher* const sInstance = new Dispatcher();
+        return *sInstance;
+    }
+
+    void add(OneShotTimer* timer) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTimers.push_back(timer);
+        mCondition.notify_one();
+    }
+
+    // Returns once the callbacks of the timer are no longer running, unless called from one.
+    void remove(OneShotTimer* timer) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mTimers.erase(std::remove(mTimers.begin(), mTimers.end(), timer), mTimers.end());
+        if (std::this_thread::get_id() == mThreadId) {
+            return;
+        }
+        while (mRunningTimer == timer) {
+            mCallbackDone.wait(lock);
+        }
+    }
+
+    // Called when a registered timer is reset from the IDLE state, or restarted. The lock orders the notification after the
+    // dispatcher has either seen the new state or started waiting.
+    void wake() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCondition.notify_one();
+    }
+
+private:
+    Dispatcher() {
+        std::thread thread(&Dispatcher::loop, this);
+        pthread_setname_np(thread.native_handle(), "OneShotTimer");
+        mThreadId = thread.get_id();
+        thread.detach();
+    }
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true) {
+            const auto now = Clock::now();
+            auto wakeupTime = Clock::time_point::max();
+
+            OneShotTimer* timer = nullptr;
+            std::optional<Event> event;
+            for (OneShotTimer* candidate : mTimers) {
+                if ((event = candidate->poll(now, &wakeupTime))) {
+                    timer = candidate;
+                    break;
+                }
+            }
+
+            if (timer) {
+                mRunningTimer = timer;
+                lock.unlock();
+                const auto& callback =
+                        *event == Event::Reset ? timer->mResetCallback : timer->mTimeoutCallback;
+                if (callback) {
+                    callback();
+                }
+                lock.lock();
+                mRunningTimer = nullptr;
+                mCallbackDone.notify_all();
+                continue;
+            }
+
+            if (wakeupTime == Clock::time_point::max()) {
+                mCondition.wait(lock);
+            } else {
+                mCondition.wait_until(lock, wakeupTime);
+            }
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::condition_variable mCallbackDone;
+
+    std::vector<OneShotTimer*> mTimers GUARDED_BY(mMutex);
+    const OneShotTimer* mRunningTimer GUARDED_BY(mMutex) = nullptr;
+
+    std::thread::id mThreadId;
+};
+
 OneShotTimer::OneShotTimer(const Interval& interval, const ResetCallback& resetCallback,
                            const TimeoutCallback& timeoutCallback)
       : mInterval(interval), mResetCallback(resetCallback), mTimeoutCallback(timeoutCallback) {}
@@ -32,83 +129,67 @@ OneShotTimer::~OneShotTimer() {
 }
 
 void OneShotTimer::start() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::RESET;
+    if (mState.exchange(TimerState::RESET) == TimerState::STOPPED) {
+        Dispatcher::getInstance().add(this);
+    } else {
+        Dispatcher::getInstance().wake();
     }
-    mThread = std::thread(&OneShotTimer::loop, this);
 }
 
 void OneShotTimer::stop() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::STOPPED;
-    }
-    mCondition.notify_all();
-    if (mThread.joinable()) {
-        mThread.join();
+    if (mState.exchange(TimerState::STOPPED) != TimerState::STOPPED) {
+        Dispatcher::getInstance().remove(this);
     }
 }
 
-void OneShotTimer::loop() {
-    while (true) {
-        bool triggerReset = false;
-        bool triggerTimeout = false;
-        {
-            std::lock_guard<std::mutex> lock(mMutex);
-            if (mState == TimerState::STOPPED) {
-                break;
+std::optional<OneShotTimer::Event> OneShotTimer::poll(Clock::time_point now,
+                                                      Clock::time_point* wakeupTime) {
+    // The state only leaves RESET and WAITING here or in stop(), so a failed exchange means the
+    // timer was stopped.
+    TimerState state = mState;
+    switch (state) {
+        case TimerState::RESET:
+            mDeadline = now + mInterval;
+            if (!mState.compare_exchange_strong(state, TimerState::WAITING)) {
+                return {};
             }
+            return Event::Reset;
 
-            if (mState == TimerState::IDLE) {
-                mCondition.wait(mMutex);
-                continue;
+        case TimerState::WAITING: {
+            const Clock::time_point deadline = mDeadline;
+            if (deadline > now) {
+                *wakeupTime = std::min(*wakeupTime, deadline);
+                return {};
             }
-
-            if (mState == TimerState::RESET) {
-                triggerReset = true;
+            if (!mState.compare_exchange_strong(state, TimerState::IDLE)) {
+                return {};
             }
-        }
-        if (triggerReset && mResetCallback) {
-            mResetCallback();
-        }
-
-        { // lock the mutex again. someone might have called stop meanwhile
-            std::lock_guard<std::mutex> lock(mMutex);
-            if (mState == TimerState::STOPPED) {
-                break;
-            }
-
-            auto triggerTime = std::chrono::steady_clock::now() + mInterval;
-            mState = TimerState::WAITING;
-            while (mState == TimerState::WAITING) {
-                constexpr auto zero = std::chrono::steady_clock::duration::zero();
-                auto waitTime = triggerTime - std::chrono::steady_clock::now();
-                if (waitTime > zero) mCondition.wait_for(mMutex, waitTime);
-                if (mState == TimerState::RESET) {
-                    triggerTime = std::chrono::steady_clock::now() + mInterval;
-                    mState = TimerState::WAITING;
-                } else if (mState == TimerState::WAITING &&
-                           (triggerTime - std::chrono::steady_clock::now()) <= zero) {
-                    triggerTimeout = true;
-                    mState = TimerState::IDLE;
-                }
+            // A reset() that moved the deadline before the exchange saw WAITING, so it is up to
+            // this thread to resume waiting. If it then saw IDLE, the timer is already RESET.
+            if (mDeadline.load() != deadline) {
+                state = TimerState::IDLE;
+                mState.compare_exchange_strong(state, TimerState::WAITING);
+                *wakeupTime = now;
+                return {};
             }
+            return Event::Timeout;
         }
-        if (triggerTimeout && mTimeoutCallback) {
-            mTimeoutCallback();
-        }
+
+        case TimerState::STOPPED:
+        case TimerState::IDLE:
+            break;
     }
+    return {};
 }
 
 void OneShotTimer::reset() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::RESET;
+    mDeadline = Clock::now() + mInterval;
+
+    TimerState state = TimerState::IDLE;
+    if (mState.compare_exchange_strong(state, TimerState::RESET)) {
+        Dispatcher::getInstance().wake();
     }
-    mCondition.notify_all();
 }
-
 std::string OneShotTimer::dump() const {
     std::ostringstream stream;
     stream << mInterval.count() << " ms";
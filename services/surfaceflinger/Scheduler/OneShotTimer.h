@@ -16,11 +16,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
-#include <thread>
-
-#include <android-base/thread_annotations.h>
+#include <functional>
+#include <optional>
+#include <string>
 
 namespace android {
 namespace scheduler {
@@ -28,6 +28,9 @@ namespace scheduler {
 /*
  * Class that sets off a timer for a given interval, and fires a callback when the
  * interval expires.
+ *
+ * All timers are serviced by a single dispatcher thread. Resetting a timer that has not expired
+ * yet only moves its deadline forward, without taking a lock or waking the dispatcher.
  */
 class OneShotTimer {
 public:
@@ -43,7 +46,7 @@ public:
     void start();
     // Stops the idle timer and any held resources.
     void stop();
-    // Resets the wakeup time and fires the reset callback.
+    // Resets the wakeup time, and fires the reset callback if the timer had expired.
     void reset();
 
     std::string dump() const;
@@ -51,7 +54,7 @@ public:
 private:
     // Enum to track in what state is the timer.
     enum class TimerState {
-        // The internal timer thread has been destroyed, and no state is
+        // The timer is not registered with the dispatcher, and no state is
         // tracked.
         // Possible state transitions: RESET
         STOPPED = 0,
@@ -59,28 +62,30 @@ private:
         // If there is a reset callback, then that callback is fired.
         // Possible state transitions: STOPPED, WAITING
         RESET = 1,
-        // This timer is waiting for the timeout interval to expire.
-        // Possible state transaitions: STOPPED, RESET, IDLE
+        // This timer is waiting for the timeout interval to expire. Resetting the timer in
+        // this state only moves mDeadline.
+        // Possible state transaitions: STOPPED, IDLE
         WAITING = 2,
         // The timeout interval has expired, so we are sleeping now.
         // Possible state transaitions: STOPPED, RESET
         IDLE = 3
     };
 
-    // Function that loops until the condition for stopping is met.
-    void loop();
+    class Dispatcher;
+    using Clock = std::chrono::steady_clock;
 
-    // Thread waiting for timer to expire.
-    std::thread mThread;
+    // Callback to be run by the dispatcher thread on behalf of this timer.
+    enum class Event { Reset, Timeout };
 
-    // Condition used to notify mThread.
-    std::condition_variable_any mCondition;
+    // Called by the dispatcher, with its lock held, to advance the state machine. Returns the
+    // callback to run, if any, otherwise lowers wakeupTime to the deadline of this timer.
+    std::optional<Event> poll(Clock::time_point now, Clock::time_point* wakeupTime);
 
-    // Lock used for synchronizing the waiting thread with the application thread.
-    std::mutex mMutex;
+    // Current timer state.
+    std::atomic<TimerState> mState = TimerState::STOPPED;
 
-    // Current timer state
-    TimerState mState GUARDED_BY(mMutex) = TimerState::RESET;
+    // Time at which the timer expires while WAITING. Updated by reset() without a lock.
+    std::atomic<Clock::time_point> mDeadline = Clock::time_point();
 
     // Interval after which timer expires.
     const Interval mInterval;
@@ -114,10 +114,70 @@ std::pair<nsecs_t, nsecs_t> RefreshRateConfigs::getDisplayFrames(nsecs_t layerPe
     return {displayFramesQuot, displayFramesRem};
 }
 
+size_t RefreshRateConfigs::hashBestRefreshRateInputs(const std::vector<LayerRequirement>& layers,
+                                                     const GlobalSignals& globalSignals) {
+    const auto combine = [](size_t seed, size_t value) {
+        return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+    };
+    size_t hash = combine(globalSignals.touch, globalSignals.idle);
+    for (const auto& layer : layers) {
+        hash = combine(hash, static_cast<size_t>(layer.vote));
+        hash = combine(hash, std::hash<float>{}(layer.desiredRefreshRate));
+        hash = combine(hash, std::hash<float>{}(layer.weight));
+        hash = combine(hash, layer.focused);
+    }
+    return hash;
+}
+
+bool RefreshRateConfigs::BestRefreshRateCacheEntry::matches(
+        size_t otherHash, const std::vector<LayerRequirement>& otherLayers,
+        const GlobalSignals& otherGlobalSignals) const {
+    if (hash != otherHash || layers.size() != otherLayers.size() ||
+        globalSignals.touch != otherGlobalSignals.touch ||
+        globalSignals.idle != otherGlobalSignals.idle) {
+        return false;
+    }
+    return std::equal(layers.begin(), layers.end(), otherLayers.begin(),
+                      [](const LayerRequirement& lhs, const LayerRequirement& rhs) {
+                          return lhs.vote == rhs.vote &&
+                                  lhs.desiredRefreshRate == rhs.desiredRefreshRate &&
+                                  lhs.weight == rhs.weight && lhs.focused == rhs.focused;
+                      });
+}
+
 const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
         const std::vector<LayerRequirement>& layers, const GlobalSignals& globalSignals,
         GlobalSignals* outSignalsConsidered) const {
     ATRACE_CALL();
+    std::lock_guard lock(mLock);
+
+    const size_t hash = hashBestRefreshRateInputs(layers, globalSignals);
+    for (const auto& entry : mBestRefreshRateCache) {
+        if (entry.matches(hash, layers, globalSignals)) {
+            if (outSignalsConsidered) *outSignalsConsidered = entry.signalsConsidered;
+            return *entry.refreshRate;
+        }
+    }
+
+    GlobalSignals signalsConsidered;
+    const RefreshRate& refreshRate =
+            getBestRefreshRateLocked(layers, globalSignals, &signalsConsidered);
+    if (outSignalsConsidered) *outSignalsConsidered = signalsConsidered;
+
+    BestRefreshRateCacheEntry entry{hash, layers, globalSignals, &refreshRate, signalsConsidered};
+    if (mBestRefreshRateCache.size() < MAX_CACHED_BEST_REFRESH_RATES) {
+        mBestRefreshRateCache.push_back(std::move(entry));
+    } else {
+        mBestRefreshRateCache[mNextBestRefreshRateCacheEntry] = std::move(entry);
+        mNextBestRefreshRateCacheEntry =
+                (mNextBestRefreshRateCacheEntry + 1) % MAX_CACHED_BEST_REFRESH_RATES;
+    }
+    return refreshRate;
+}
+
+const RefreshRate& RefreshRateConfigs::getBestRefreshRateLocked(
+        const std::vector<LayerRequirement>& layers, const GlobalSignals& globalSignals,
+        GlobalSignals* outSignalsConsidered) const {
     ALOGV("getRefreshRateForContent %zu layers", layers.size());
 
     if (outSignalsConsidered) *outSignalsConsidered = {};
@@ -133,8 +193,6 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
         }
     };
 
-    std::lock_guard lock(mLock);
-
     int noVoteLayers = 0;
     int minVoteLayers = 0;
     int maxVoteLayers = 0;
@@ -199,6 +257,13 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
         scores.emplace_back(refreshRate, 0.0f);
     }
 
+    // Which of the refresh rates are in the primary range does not depend on the layer.
+    std::vector<bool> inPrimaryRange(scores.size());
+    for (auto i = 0u; i < scores.size(); i++) {
+        inPrimaryRange[i] =
+                scores[i].first->inPolicy(policy->primaryRange.min, policy->primaryRange.max);
+    }
+
     for (const auto& layer : layers) {
         ALOGV("Calculating score for %s (%s, weight %.2f)", layer.name.c_str(),
               layerVoteTypeString(layer.vote).c_str(), layer.weight);
@@ -207,11 +272,12 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
         }
 
         auto weight = layer.weight;
+        const auto layerPeriod = layer.vote == LayerVoteType::Max
+                ? 0
+                : round<nsecs_t>(1e9f / layer.desiredRefreshRate);
 
         for (auto i = 0u; i < scores.size(); i++) {
-            bool inPrimaryRange =
-                    scores[i].first->inPolicy(policy->primaryRange.min, policy->primaryRange.max);
-            if ((primaryRangeIsSingleRate || !inPrimaryRange) &&
+            if ((primaryRangeIsSingleRate || !inPrimaryRange[i]) &&
                 !(layer.focused && layer.vote == LayerVoteType::ExplicitDefault)) {
                 // Only focused layers with ExplicitDefault frame rate settings are allowed to score
                 // refresh rates outside the primary range.
@@ -230,17 +296,16 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
             }
 
             const auto displayPeriod = scores[i].first->hwcConfig->getVsyncPeriod();
-            const auto layerPeriod = round<nsecs_t>(1e9f / layer.desiredRefreshRate);
             if (layer.vote == LayerVoteType::ExplicitDefault) {
                 const auto layerScore = [&]() {
                     // Find the actual rate the layer will render, assuming
-                    // that layerPeriod is the minimal time to render a frame
-                    auto actualLayerPeriod = displayPeriod;
-                    int multiplier = 1;
-                    while (layerPeriod > actualLayerPeriod + MARGIN_FOR_PERIOD_CALCULATION) {
-                        multiplier++;
-                        actualLayerPeriod = displayPeriod * multiplier;
-                    }
+                    // that layerPeriod is the minimal time to render a frame: the smallest
+                    // multiple of displayPeriod within the margin of layerPeriod.
+                    const auto minLayerPeriod = layerPeriod - MARGIN_FOR_PERIOD_CALCULATION;
+                    const nsecs_t multiplier = minLayerPeriod > displayPeriod
+                            ? (minLayerPeriod + displayPeriod - 1) / displayPeriod
+                            : 1;
+                    const auto actualLayerPeriod = displayPeriod * multiplier;
                     return std::min(1.0f,
                                     static_cast<float>(layerPeriod) /
                                             static_cast<float>(actualLayerPeriod));
@@ -556,6 +621,9 @@ void RefreshRateConfigs::constructAvailableRefreshRates() {
                        &mPrimaryRefreshRates);
     filterRefreshRates(policy->appRequestRange.min, policy->appRequestRange.max, "app request",
                        &mAppRequestRefreshRates);
+
+    mBestRefreshRateCache.clear();
+    mNextBestRefreshRateCacheEntry = 0;
 }
 
 std::vector<float> RefreshRateConfigs::constructKnownFrameRates(
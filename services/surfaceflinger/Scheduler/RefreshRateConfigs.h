@@ -206,11 +206,13 @@ public:
         float weight = 0.0f;
         // Whether layer is in focus or not based on WindowManager's state
         bool focused = false;
+        // The uid of the process that created the layer.
+        uid_t ownerUid = 0;
 
         bool operator==(const LayerRequirement& other) const {
             return name == other.name && vote == other.vote &&
                     desiredRefreshRate == other.desiredRefreshRate && weight == other.weight &&
-                    focused == other.focused;
+                    focused == other.focused && ownerUid == other.ownerUid;
         }
 
         bool operator!=(const LayerRequirement& other) const { return !(*this == other); }
@@ -228,7 +230,8 @@ public:
         bool idle = false;
     };
 
-    // Returns the refresh rate that fits best to the given layers.
+    // Returns the refresh rate that fits best to the given layers. The last few results are
+    // remembered until the policy changes, so calling again with the same layers is cheap.
     //   layers - The layer requirements to consider.
     //   globalSignals - global state of touch and idle
     //   outSignalsConsidered - An output param that tells the caller whether the refresh rate was
@@ -302,6 +305,11 @@ private:
             const std::function<bool(const RefreshRate&)>& shouldAddRefreshRate,
             std::vector<const RefreshRate*>* outRefreshRates);
 
+    const RefreshRate& getBestRefreshRateLocked(const std::vector<LayerRequirement>& layers,
+                                                const GlobalSignals& globalSignals,
+                                                GlobalSignals* outSignalsConsidered) const
+            REQUIRES(mLock);
+
     // Returns the refresh rate with the highest score in the collection specified from begin
     // to end. If there are more than one with the same highest refresh rate, the first one is
     // returned.
@@ -348,6 +356,26 @@ private:
     Policy mDisplayManagerPolicy GUARDED_BY(mLock);
     std::optional<Policy> mOverridePolicy GUARDED_BY(mLock);
 
+    // The inputs and the result of a recent getBestRefreshRate() call. Layer names are only
+    // used for logging, so they are not compared.
+    struct BestRefreshRateCacheEntry {
+        size_t hash = 0;
+        std::vector<LayerRequirement> layers;
+        GlobalSignals globalSignals;
+        const RefreshRate* refreshRate = nullptr;
+        GlobalSignals signalsConsidered;
+
+        bool matches(size_t otherHash, const std::vector<LayerRequirement>& otherLayers,
+                     const GlobalSignals& otherGlobalSignals) const;
+    };
+    static size_t hashBestRefreshRateInputs(const std::vector<LayerRequirement>& layers,
+                                            const GlobalSignals& globalSignals);
+
+    // Cleared whenever the refresh rates allowed by the policy change.
+    static constexpr size_t MAX_CACHED_BEST_REFRESH_RATES = 4;
+    mutable std::vector<BestRefreshRateCacheEntry> mBestRefreshRateCache GUARDED_BY(mLock);
+    mutable size_t mNextBestRefreshRateCacheEntry GUARDED_BY(mLock) = 0;
+
     // The min and max refresh rates supported by the device.
     // This will not change at runtime.
     const RefreshRate* mMinSupportedRefreshRate;
@@ -33,6 +33,7 @@
 
 #include <algorithm>
 #include <cinttypes>
+#include <cmath>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -107,7 +108,10 @@ Scheduler::Scheduler(impl::EventControlThread::SetVSyncEnabledFunction function,
         mSchedulerCallback(schedulerCallback),
         mRefreshRateConfigs(refreshRateConfig),
         mUseContentDetection(useContentDetection),
-        mUseContentDetectionV2(useContentDetectionV2) {
+        mUseContentDetectionV2(useContentDetectionV2),
+        mThrottleVsyncByFrameRate(
+                property_get_bool("debug.sf.throttle_vsync_by_frame_rate", false)),
+        mDelayVSyncDispatch(property_get_bool("debug.sf.vsync_dispatch_delays", false)) {
     using namespace sysprop;
 
     if (mUseContentDetectionV2) {
@@ -157,7 +161,9 @@ Scheduler::Scheduler(std::unique_ptr<DispSync> primaryDispSync,
         mSchedulerCallback(schedulerCallback),
         mRefreshRateConfigs(configs),
         mUseContentDetection(useContentDetection),
-        mUseContentDetectionV2(useContentDetectionV2) {}
+        mUseContentDetectionV2(useContentDetectionV2),
+        mThrottleVsyncByFrameRate(false),
+        mDelayVSyncDispatch(false) {}
 
 Scheduler::~Scheduler() {
     // Ensure the OneShotTimer threads are joined before we start destroying state.
@@ -445,11 +451,25 @@ void Scheduler::registerLayer(Layer* layer) {
     }
 }
 
+void Scheduler::deregisterLayer(Layer* layer) {
+    if (mLayerHistory) {
+        mLayerHistory->deregisterLayer(layer);
+    }
+}
+
 void Scheduler::recordLayerHistory(Layer* layer, nsecs_t presentTime,
                                    LayerHistory::LayerUpdateType updateType) {
     if (mLayerHistory) {
         mLayerHistory->record(layer, presentTime, systemTime(), updateType);
     }
+
+    if (mDelayVSyncDispatch && updateType == LayerHistory::LayerUpdateType::Buffer) {
+        const nsecs_t now = systemTime();
+        std::lock_guard<std::mutex> lock(mFrameTimesLock);
+        auto& times = mFrameTimes[layer->getOwnerUid()];
+        times.queueTimes.push_back(now);
+        times.lastQueueTime = now;
+    }
 }
 
 void Scheduler::setConfigChangePending(bool pending) {
@@ -492,6 +512,147 @@ void Scheduler::chooseRefreshRateForContent() {
     }
 }
 
+void Scheduler::updateFrameRateDividers(ConnectionHandle handle) {
+    if (!mThrottleVsyncByFrameRate) return;
+    RETURN_IF_INVALID_HANDLE(handle);
+
+    EventThread::FrameRateDividers dividers;
+    {
+        std::lock_guard<std::mutex> lock(mFeatureStateLock);
+        if (mFeatures.configId) {
+            const float refreshRate =
+                    mRefreshRateConfigs.getRefreshRateFromConfigId(*mFeatures.configId).getFps();
+            dividers = calculateFrameRateDividers(mFeatures.contentRequirements, refreshRate);
+        }
+        if (mFeatures.frameRateDividers == dividers) {
+            return;
+        }
+        mFeatures.frameRateDividers = dividers;
+    }
+    mConnections[handle].thread->setFrameRateDividers(std::move(dividers));
+}
+
+void Scheduler::updateVSyncDispatchDelays(ConnectionHandle handle, nsecs_t appOffset,
+                                          nsecs_t sfOffset) {
+    if (!mDelayVSyncDispatch) return;
+    RETURN_IF_INVALID_HANDLE(handle);
+    EventThread& thread = *mConnections[handle].thread;
+
+    const nsecs_t vsyncPeriod = mPrimaryDispSync->getPeriod();
+    if (vsyncPeriod <= 0) return;
+
+    // Match the buffers queued since the last update to the VSYNC events that started them.
+    const nsecs_t now = systemTime();
+    std::unordered_map<uid_t, nsecs_t> frameDurations;
+    {
+        std::lock_guard<std::mutex> lock(mFrameTimesLock);
+        for (auto it = mFrameTimes.begin(); it != mFrameTimes.end();) {
+            auto& [uid, times] = *it;
+            if (now - times.lastQueueTime > MAX_FRAME_TIMES_AGE.count()) {
+                it = mFrameTimes.erase(it);
+                continue;
+            }
+            for (const nsecs_t queueTime : times.queueTimes) {
+                if (const nsecs_t dispatchTime = thread.getLastVSyncDispatchTime(uid, queueTime)) {
+                    times.durations.push_back(queueTime - dispatchTime);
+                    if (times.durations.size() > MAX_FRAME_DURATIONS) {
+                        times.durations.pop_front();
+                    }
+                }
+            }
+            times.queueTimes.clear();
+            if (!times.durations.empty()) {
+                frameDurations.emplace(uid,
+                                       *std::max_element(times.durations.begin(),
+                                                         times.durations.end()));
+            }
+            ++it;
+        }
+    }
+
+    const nsecs_t phase = ((sfOffset - appOffset) % vsyncPeriod + vsyncPeriod) % vsyncPeriod;
+    const nsecs_t budget = phase > 0 ? phase : vsyncPeriod;
+
+    EventThread::DispatchDelays delays;
+    {
+        std::lock_guard<std::mutex> lock(mFeatureStateLock);
+        delays = calculateVSyncDispatchDelays(frameDurations, mFeatures.frameRateDividers, budget,
+                                              vsyncPeriod);
+        if (mFeatures.vsyncDispatchDelays == delays) {
+            return;
+        }
+        mFeatures.vsyncDispatchDelays = delays;
+    }
+    thread.setDispatchDelays(std::move(delays));
+}
+
+EventThread::DispatchDelays Scheduler::calculateVSyncDispatchDelays(
+        const std::unordered_map<uid_t, nsecs_t>& frameDurations,
+        const EventThread::FrameRateDividers& dividers, nsecs_t budget, nsecs_t vsyncPeriod) {
+    // Leave room for scheduling jitter, and bound the delay so that a frame that suddenly takes
+    // longer is at most half a frame late. Delays are rounded down to whole milliseconds, so that
+    // they only change when the frame durations do by a fair amount.
+    constexpr nsecs_t MARGIN = std::chrono::nanoseconds(2ms).count();
+    constexpr nsecs_t QUANTUM = std::chrono::nanoseconds(1ms).count();
+    const auto delayOf = [&](nsecs_t frameDuration) {
+        const nsecs_t delay = std::clamp(budget - frameDuration - MARGIN, nsecs_t(0),
+                                         vsyncPeriod / 2);
+        return delay - delay % QUANTUM;
+    };
+
+    // Apps in a frame rate group get the delay of the slowest one, so that the EventThread wakes
+    // up once per group.
+    const auto groupOf = [&](uid_t uid) {
+        const auto divider = dividers.find(uid);
+        return divider != dividers.end() ? divider->second : 1u;
+    };
+    std::unordered_map<uint32_t, nsecs_t> groupDelays;
+    for (const auto& [uid, frameDuration] : frameDurations) {
+        const nsecs_t delay = delayOf(frameDuration);
+        if (const auto [it, inserted] = groupDelays.emplace(groupOf(uid), delay); !inserted) {
+            it->second = std::min(it->second, delay);
+        }
+    }
+
+    EventThread::DispatchDelays delays;
+    for (const auto& [uid, frameDuration] : frameDurations) {
+        if (const nsecs_t delay = groupDelays[groupOf(uid)]; delay > 0) {
+            delays.emplace(uid, delay);
+        }
+    }
+    return delays;
+}
+
+EventThread::FrameRateDividers Scheduler::calculateFrameRateDividers(
+        const LayerHistory::Summary& summary, float refreshRate) {
+    // The frame rate of each uid, or 0 if one of its layers did not vote for a frame rate.
+    std::unordered_map<uid_t, float> frameRates;
+    for (const auto& layer : summary) {
+        const bool explicitVote = (layer.vote == LayerHistory::LayerVoteType::ExplicitDefault ||
+                                   layer.vote ==
+                                           LayerHistory::LayerVoteType::ExplicitExactOrMultiple) &&
+                layer.desiredRefreshRate > 0.0f;
+        const float frameRate = explicitVote ? layer.desiredRefreshRate : 0.0f;
+        if (const auto [it, inserted] = frameRates.emplace(layer.ownerUid, frameRate); !inserted) {
+            it->second = it->second > 0.0f && frameRate > 0.0f ? std::max(it->second, frameRate)
+                                                               : 0.0f;
+        }
+    }
+
+    // Only throttle to frame rates the refresh rate is a multiple of, so that frames stay paced.
+    constexpr float MARGIN = 0.05f;
+    EventThread::FrameRateDividers dividers;
+    for (const auto& [uid, frameRate] : frameRates) {
+        if (frameRate <= 0.0f) continue;
+        const float ratio = refreshRate / frameRate;
+        const auto divider = static_cast<uint32_t>(std::round(ratio));
+        if (divider > 1 && std::abs(ratio - static_cast<float>(divider)) < MARGIN) {
+            dividers.emplace(uid, divider);
+        }
+    }
+    return dividers;
+}
+
 void Scheduler::resetIdleTimer() {
     if (mIdleTimer) {
         mIdleTimer->reset();
@@ -583,8 +744,11 @@ void Scheduler::dump(std::string& result) const {
                   mIdleTimer ? mIdleTimer->dump().c_str() : states[0]);
     StringAppendF(&result, "+  Touch timer: %s\n",
                   mTouchTimer ? mTouchTimer->dump().c_str() : states[0]);
-    StringAppendF(&result, "+  Use content detection: %s\n\n",
+    StringAppendF(&result, "+  Use content detection: %s\n",
                   sysprop::use_content_detection_for_refresh_rate(false) ? "on" : "off");
+    StringAppendF(&result, "+  Throttle VSYNC by frame rate: %s\n",
+                  mThrottleVsyncByFrameRate ? "on" : "off");
+    StringAppendF(&result, "+  Delay VSYNC dispatch: %s\n\n", mDelayVSyncDispatch ? "on" : "off");
 }
 
 template <class T>
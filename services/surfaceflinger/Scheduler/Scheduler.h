@@ -17,11 +17,13 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic push
@@ -130,14 +132,25 @@ public:
     void setIgnorePresentFences(bool ignore);
     nsecs_t getDispSyncExpectedPresentTime(nsecs_t now);
 
-    // Layers are registered on creation, and unregistered when the weak reference expires.
+    // Layers are registered on creation, and deregistered when they are destroyed.
     void registerLayer(Layer*);
+    void deregisterLayer(Layer*);
     void recordLayerHistory(Layer*, nsecs_t presentTime, LayerHistory::LayerUpdateType updateType);
     void setConfigChangePending(bool pending);
 
     // Detects content using layer history, and selects a matching refresh rate.
     void chooseRefreshRateForContent();
 
+    // Throttles the VSYNC events of apps whose layers all voted for a frame rate that divides the
+    // selected refresh rate, as last chosen by chooseRefreshRateForContent.
+    void updateFrameRateDividers(ConnectionHandle) EXCLUDES(mFeatureStateLock);
+
+    // Delays the VSYNC events of apps that queue their buffers well before SurfaceFlinger wakes up
+    // at the given offsets, by how early their recent frames were, so that they start them later
+    // and their frames show more recent input. Apps in a frame rate group share a delay.
+    void updateVSyncDispatchDelays(ConnectionHandle, nsecs_t appOffset, nsecs_t sfOffset)
+            EXCLUDES(mFrameTimesLock, mFeatureStateLock);
+
     bool isIdleTimerEnabled() const { return mIdleTimer.has_value(); }
     void resetIdleTimer();
 
@@ -205,6 +218,15 @@ private:
 
     void dispatchCachedReportedConfig() REQUIRES(mFeatureStateLock);
 
+    static EventThread::FrameRateDividers calculateFrameRateDividers(
+            const LayerHistory::Summary&, float refreshRate);
+
+    // Keyed by uid. Takes the longest recent time from VSYNC dispatch to buffer queue of each app,
+    // and the time from app VSYNC to SurfaceFlinger VSYNC.
+    static EventThread::DispatchDelays calculateVSyncDispatchDelays(
+            const std::unordered_map<uid_t, nsecs_t>& frameDurations,
+            const EventThread::FrameRateDividers&, nsecs_t budget, nsecs_t vsyncPeriod);
+
     // Stores EventThread associated with a given VSyncSource, and an initial EventThreadConnection.
     struct Connection {
         sp<EventThreadConnection> connection;
@@ -240,6 +262,19 @@ private:
     // Timer used to monitor display power mode.
     std::optional<scheduler::OneShotTimer> mDisplayPowerTimer;
 
+    // Buffer queue times of each app, which updateVSyncDispatchDelays turns into frame durations.
+    struct FrameTimes {
+        std::vector<nsecs_t> queueTimes;
+        std::deque<nsecs_t> durations;
+        nsecs_t lastQueueTime = 0;
+    };
+
+    static constexpr size_t MAX_FRAME_DURATIONS = 16;
+    static constexpr std::chrono::nanoseconds MAX_FRAME_TIMES_AGE = 1s;
+
+    std::mutex mFrameTimesLock;
+    std::unordered_map<uid_t, FrameTimes> mFrameTimes GUARDED_BY(mFrameTimesLock);
+
     ISchedulerCallback& mSchedulerCallback;
 
     // In order to make sure that the features don't override themselves, we need a state machine
@@ -266,6 +301,12 @@ private:
         };
 
         std::optional<ConfigChangedParams> cachedConfigChangedParams;
+
+        // Last dividers sent by updateFrameRateDividers.
+        EventThread::FrameRateDividers frameRateDividers;
+
+        // Last delays sent by updateVSyncDispatchDelays.
+        EventThread::DispatchDelays vsyncDispatchDelays;
     } mFeatures GUARDED_BY(mFeatureStateLock);
 
     const scheduler::RefreshRateConfigs& mRefreshRateConfigs;
@@ -279,6 +320,10 @@ private:
     const bool mUseContentDetection;
     // This variable indicates whether to use V2 version of the content detection.
     const bool mUseContentDetectionV2;
+    // Whether apps that vote for a lower frame rate receive fewer VSYNC events.
+    const bool mThrottleVsyncByFrameRate;
+    // Whether apps that finish their frames early receive their VSYNC events later.
+    const bool mDelayVSyncDispatch;
 };
 
 } // namespace android
@@ -187,6 +187,25 @@ void VSyncDispatchTimerQueue::setTimer(nsecs_t targetTime, nsecs_t now) {
     mLastTimerSchedule = mTimeKeeper->now();
 }
 
+void VSyncDispatchTimerQueue::untrackWakeup(CallbackMap::iterator const& it) {
+    auto const wakeupTime = it->second->wakeupTime();
+    if (wakeupTime) {
+        mArmedCallbacks.erase({*wakeupTime, it->first});
+    }
+}
+
+void VSyncDispatchTimerQueue::trackWakeup(CallbackMap::iterator const& it) {
+    auto const wakeupTime = it->second->wakeupTime();
+    if (wakeupTime) {
+        mArmedCallbacks.emplace(*wakeupTime, it->first);
+    }
+    if (it->second->hasPendingWorkloadUpdate()) {
+        mPendingUpdateCallbacks.insert(it->first);
+    } else {
+        mPendingUpdateCallbacks.erase(it->first);
+    }
+}
+
 void VSyncDispatchTimerQueue::rearmTimer(nsecs_t now) {
     rearmTimerSkippingUpdateFor(now, mCallbacks.end());
 }
@@ -203,31 +222,36 @@ void VSyncDispatchTimerQueue::TraceBuffer::note(std::string_view name, nsecs_t a
 
 void VSyncDispatchTimerQueue::rearmTimerSkippingUpdateFor(
         nsecs_t now, CallbackMap::iterator const& skipUpdateIt) {
-    std::optional<nsecs_t> min;
-    std::optional<nsecs_t> targetVsync;
-    std::optional<std::string_view> nextWakeupName;
-    for (auto it = mCallbacks.begin(); it != mCallbacks.end(); it++) {
-        auto& callback = it->second;
-        if (!callback->wakeupTime() && !callback->hasPendingWorkloadUpdate()) {
-            continue;
-        }
-
-        if (it != skipUpdateIt) {
-            callback->update(mTracker, now);
+    // Only the armed callbacks and the ones with a pending update can wake up the timer, and
+    // they are brought up to date with the tracker before the earliest one is picked.
+    mRearmTokens.clear();
+    for (auto const& [wakeupTime, token] : mArmedCallbacks) {
+        mRearmTokens.push_back(token);
+    }
+    for (auto const& token : mPendingUpdateCallbacks) {
+        auto const it = mCallbacks.find(token);
+        if (it != mCallbacks.end() && !it->second->wakeupTime()) {
+            mRearmTokens.push_back(token);
         }
-        auto const wakeupTime = *callback->wakeupTime();
-        if (!min || (min && *min > wakeupTime)) {
-            nextWakeupName = callback->name();
-            min = wakeupTime;
-            targetVsync = callback->targetVsync();
+    }
+    for (auto const& token : mRearmTokens) {
+        auto const it = mCallbacks.find(token);
+        if (it == mCallbacks.end() || it == skipUpdateIt) {
+            continue;
         }
+        untrackWakeup(it);
+        it->second->update(mTracker, now);
+        trackWakeup(it);
     }
 
-    if (min && (min < mIntendedWakeupTime)) {
-        if (targetVsync && nextWakeupName) {
-            mTraceBuffer.note(*nextWakeupName, *min - now, *targetVsync - now);
+    if (!mArmedCallbacks.empty() && mArmedCallbacks.begin()->first < mIntendedWakeupTime) {
+        auto const& [min, token] = *mArmedCallbacks.begin();
+        auto const& callback = mCallbacks.find(token)->second;
+        auto const targetVsync = callback->targetVsync();
+        if (targetVsync) {
+            mTraceBuffer.note(callback->name(), min - now, *targetVsync - now);
         }
-        setTimer(*min, now);
+        setTimer(min, now);
     } else {
         ATRACE_NAME("cancel timer");
         cancelTimer();
@@ -245,19 +269,18 @@ void VSyncDispatchTimerQueue::timerCallback() {
         std::lock_guard<decltype(mMutex)> lk(mMutex);
         auto const now = mTimeKeeper->now();
         mLastTimerCallback = now;
-        for (auto it = mCallbacks.begin(); it != mCallbacks.end(); it++) {
-            auto& callback = it->second;
-            auto const wakeupTime = callback->wakeupTime();
-            if (!wakeupTime) {
-                continue;
-            }
-
-            auto const lagAllowance = std::max(now - mIntendedWakeupTime, static_cast<nsecs_t>(0));
-            if (*wakeupTime < mIntendedWakeupTime + mTimerSlack + lagAllowance) {
-                callback->executing();
-                invocations.emplace_back(
-                        Invocation{callback, *callback->lastExecutedVsyncTarget(), *wakeupTime});
-            }
+        auto const lagAllowance = std::max(now - mIntendedWakeupTime, static_cast<nsecs_t>(0));
+        auto const threshold = mIntendedWakeupTime + mTimerSlack + lagAllowance;
+        // Every callback that wakes up within the slack of this one runs now.
+        auto armedIt = mArmedCallbacks.begin();
+        while (armedIt != mArmedCallbacks.end() && armedIt->first < threshold) {
+            auto const wakeupTime = armedIt->first;
+            auto& callback = mCallbacks.find(armedIt->second)->second;
+            armedIt = mArmedCallbacks.erase(armedIt);
+
+            callback->executing();
+            invocations.emplace_back(
+                    Invocation{callback, *callback->lastExecutedVsyncTarget(), wakeupTime});
         }
 
         mIntendedWakeupTime = kInvalidTime;
@@ -288,6 +311,8 @@ void VSyncDispatchTimerQueue::unregisterCallback(CallbackToken token) {
         auto it = mCallbacks.find(token);
         if (it != mCallbacks.end()) {
             entry = it->second;
+            untrackWakeup(it);
+            mPendingUpdateCallbacks.erase(token);
             mCallbacks.erase(it);
         }
     }
@@ -315,10 +340,13 @@ ScheduleResult VSyncDispatchTimerQueue::schedule(CallbackToken token, nsecs_t wo
         auto const rearmImminent = now > mIntendedWakeupTime;
         if (CC_UNLIKELY(rearmImminent)) {
             callback->addPendingWorkloadUpdate(workDuration, earliestVsync);
+            mPendingUpdateCallbacks.insert(token);
             return ScheduleResult::Scheduled;
         }
 
+        untrackWakeup(it);
         result = callback->schedule(workDuration, earliestVsync, mTracker, now);
+        trackWakeup(it);
         if (result == ScheduleResult::CannotSchedule) {
             return result;
         }
@@ -342,7 +370,9 @@ CancelResult VSyncDispatchTimerQueue::cancel(CallbackToken token) {
 
     auto const wakeupTime = callback->wakeupTime();
     if (wakeupTime) {
+        untrackWakeup(it);
         callback->disarm();
+        trackWakeup(it);
 
         if (*wakeupTime == mIntendedWakeupTime) {
             mIntendedWakeupTime = kInvalidTime;
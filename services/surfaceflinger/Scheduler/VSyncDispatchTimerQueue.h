@@ -21,9 +21,12 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "SchedulerUtils.h"
 #include "VSyncDispatch.h"
@@ -142,6 +145,8 @@ private:
     void rearmTimerSkippingUpdateFor(nsecs_t now, CallbackMap::iterator const& skipUpdate)
             REQUIRES(mMutex);
     void cancelTimer() REQUIRES(mMutex);
+    void untrackWakeup(CallbackMap::iterator const& it) REQUIRES(mMutex);
+    void trackWakeup(CallbackMap::iterator const& it) REQUIRES(mMutex);
 
     static constexpr nsecs_t kInvalidTime = std::numeric_limits<int64_t>::max();
     std::unique_ptr<TimeKeeper> const mTimeKeeper;
@@ -155,6 +160,13 @@ private:
     CallbackMap mCallbacks GUARDED_BY(mMutex);
     nsecs_t mIntendedWakeupTime GUARDED_BY(mMutex) = kInvalidTime;
 
+    // The armed callbacks ordered by wakeup time, and the callbacks with a pending workload
+    // update, so that the timer never has to look at callbacks that are not waiting for it.
+    std::set<std::pair<nsecs_t, CallbackToken>> mArmedCallbacks GUARDED_BY(mMutex);
+    std::unordered_set<CallbackToken> mPendingUpdateCallbacks GUARDED_BY(mMutex);
+    // Scratch space for rearming, kept to avoid an allocation each time.
+    std::vector<CallbackToken> mRearmTokens GUARDED_BY(mMutex);
+
     struct TraceBuffer {
         static constexpr char const kTraceNamePrefix[] = "-alarm in:";
         static constexpr char const kTraceNameSeparator[] = " for vs:";
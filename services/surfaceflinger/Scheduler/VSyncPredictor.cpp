@@ -35,6 +35,17 @@ namespace android::scheduler {
 using base::StringAppendF;
 
 static auto constexpr kMaxPercent = 100u;
+// TODO (b/144707443): its important that there's some precision in the mean of the ordinals
+//                     for the intercept calculation, so scale the ordinals by 1000 to continue
+//                     fixed point calculation. Explore expanding
+//                     scheduler::utils::calculate_mean to have a fixed point fractional part.
+static constexpr int64_t kScalingFactor = 1000;
+
+// Rounds numerator / denominator to the nearest integer, for a positive denominator.
+static int64_t roundedDivide(int64_t numerator, int64_t denominator) {
+    auto const shifted = numerator + denominator / 2;
+    return shifted >= 0 ? shifted / denominator : -((denominator - 1 - shifted) / denominator);
+}
 
 VSyncPredictor::~VSyncPredictor() = default;
 
@@ -69,35 +80,122 @@ bool VSyncPredictor::validate(nsecs_t timestamp) const {
 }
 
 nsecs_t VSyncPredictor::currentPeriod() const {
-    std::lock_guard<std::mutex> lk(mMutex);
-    return std::get<0>(mRateMap.find(mIdealPeriod)->second);
+    return readModel().slope;
+}
+
+nsecs_t VSyncPredictor::latestTimestamp() const {
+    if (mNumOutOfOrder == 0) {
+        return mTimestamps[mLastTimestampIndex];
+    }
+    return *std::max_element(mTimestamps.begin(), mTimestamps.end());
+}
+
+void VSyncPredictor::rebaseSums(size_t earliestIndex) {
+    // Shifting the origin of all the samples by (a, b) only takes the counts to correct the sums.
+    auto const a = (mOrdinals[earliestIndex] - mOrdinals[mEarliestTimestampIndex]) * kScalingFactor;
+    auto const b = mTimestamps[earliestIndex] - mTimestamps[mEarliestTimestampIndex];
+    auto const n = mSums.count;
+    mSums.xy += n * a * b - a * mSums.y - b * mSums.x;
+    mSums.xx += n * a * a - 2 * a * mSums.x;
+    mSums.x -= n * a;
+    mSums.y -= n * b;
+    mEarliestTimestampIndex = earliestIndex;
+}
+
+void VSyncPredictor::evictTimestamp(size_t index) {
+    auto const following = next(index);
+    if (mTimestamps[following] < mTimestamps[index]) {
+        mNumOutOfOrder--;
+    }
+
+    mSums.count--;
+    auto const x = (mOrdinals[index] - mOrdinals[mEarliestTimestampIndex]) * kScalingFactor;
+    auto const y = mTimestamps[index] - mTimestamps[mEarliestTimestampIndex];
+    mSums.x -= x;
+    mSums.y -= y;
+    mSums.xx -= x * x;
+    mSums.xy -= x * y;
+
+    if (index != mEarliestTimestampIndex || mSums.count == 0) {
+        return;
+    }
+    auto earliest = following;
+    if (mNumOutOfOrder != 0) {
+        for (size_t i = 0; i < mTimestamps.size(); i++) {
+            if (i != index && mTimestamps[i] < mTimestamps[earliest]) {
+                earliest = i;
+            }
+        }
+    }
+    rebaseSums(earliest);
+}
+
+void VSyncPredictor::insertTimestamp(nsecs_t timestamp, nsecs_t period) {
+    size_t index;
+    if (mTimestamps.size() != kHistorySize) {
+        mTimestamps.push_back(timestamp);
+        mOrdinals.push_back(0);
+        index = mTimestamps.size() - 1;
+    } else {
+        // Overwrite the oldest timestamp.
+        index = next(mLastTimestampIndex);
+        evictTimestamp(index);
+    }
+
+    if (mSums.count == 0) {
+        mOrdinals[index] = 0;
+        mTimestamps[index] = timestamp;
+        mEarliestTimestampIndex = index;
+        mNumOutOfOrder = 0;
+    } else {
+        auto const earliest = mTimestamps[mEarliestTimestampIndex];
+        mOrdinals[index] =
+                mOrdinals[mEarliestTimestampIndex] + roundedDivide(timestamp - earliest, period);
+        if (timestamp < mTimestamps[mLastTimestampIndex]) {
+            mNumOutOfOrder++;
+        }
+        mTimestamps[index] = timestamp;
+        if (timestamp < earliest) {
+            rebaseSums(index);
+        }
+    }
+    mLastTimestampIndex = index;
+
+    mSums.count++;
+    auto const x = (mOrdinals[index] - mOrdinals[mEarliestTimestampIndex]) * kScalingFactor;
+    auto const y = timestamp - mTimestamps[mEarliestTimestampIndex];
+    mSums.x += x;
+    mSums.y += y;
+    mSums.xx += x * x;
+    mSums.xy += x * y;
 }
 
 bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     std::lock_guard<std::mutex> lk(mMutex);
+    auto const added = addVsyncTimestampLocked(timestamp);
+    publishModel();
+    return added;
+}
 
+bool VSyncPredictor::addVsyncTimestampLocked(nsecs_t timestamp) {
     if (!validate(timestamp)) {
         // VSR could elect to ignore the incongruent timestamp or resetModel(). If ts is ignored,
         // don't insert this ts into mTimestamps ringbuffer.
         if (!mTimestamps.empty()) {
-            mKnownTimestamp =
-                    std::max(timestamp, *std::max_element(mTimestamps.begin(), mTimestamps.end()));
+            mKnownTimestamp = std::max(timestamp, latestTimestamp());
         } else {
             mKnownTimestamp = timestamp;
         }
         return false;
     }
 
-    if (mTimestamps.size() != kHistorySize) {
-        mTimestamps.push_back(timestamp);
-        mLastTimestampIndex = next(mLastTimestampIndex);
-    } else {
-        mLastTimestampIndex = next(mLastTimestampIndex);
-        mTimestamps[mLastTimestampIndex] = timestamp;
-    }
+    auto it = mRateMap.find(mIdealPeriod);
+    auto const currentPeriod = std::get<0>(it->second);
+    insertTimestamp(timestamp, currentPeriod);
+    traceInt64If("VSP-ts", timestamp);
 
     if (mTimestamps.size() < kMinimumSamplesForPrediction) {
-        mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
+        it->second = {mIdealPeriod, 0};
         return true;
     }
 
@@ -116,39 +214,14 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     //
     // intercept = mean(Y) - slope * mean(X)
     //
-    std::vector<nsecs_t> vsyncTS(mTimestamps.size());
-    std::vector<nsecs_t> ordinals(mTimestamps.size());
-
-    // normalizing to the oldest timestamp cuts down on error in calculating the intercept.
-    auto const oldest_ts = *std::min_element(mTimestamps.begin(), mTimestamps.end());
-    auto it = mRateMap.find(mIdealPeriod);
-    auto const currentPeriod = std::get<0>(it->second);
-    // TODO (b/144707443): its important that there's some precision in the mean of the ordinals
-    //                     for the intercept calculation, so scale the ordinals by 1000 to continue
-    //                     fixed point calculation. Explore expanding
-    //                     scheduler::utils::calculate_mean to have a fixed point fractional part.
-    static constexpr int64_t kScalingFactor = 1000;
-
-    for (auto i = 0u; i < mTimestamps.size(); i++) {
-        traceInt64If("VSP-ts", mTimestamps[i]);
-
-        vsyncTS[i] = mTimestamps[i] - oldest_ts;
-        ordinals[i] = ((vsyncTS[i] + (currentPeriod / 2)) / currentPeriod) * kScalingFactor;
-    }
-
-    auto meanTS = scheduler::calculate_mean(vsyncTS);
-    auto meanOrdinal = scheduler::calculate_mean(ordinals);
-    for (auto i = 0; i < vsyncTS.size(); i++) {
-        vsyncTS[i] -= meanTS;
-        ordinals[i] -= meanOrdinal;
-    }
-
-    auto top = 0ll;
-    auto bottom = 0ll;
-    for (auto i = 0; i < vsyncTS.size(); i++) {
-        top += vsyncTS[i] * ordinals[i];
-        bottom += ordinals[i] * ordinals[i];
-    }
+    // Both sums are expanded into the running sums of X, Y, X * X and X * Y, which are kept
+    // as the timestamps come and go. X and Y are measured from the earliest timestamp, which
+    // cuts down on error in calculating the intercept.
+    auto const n = mSums.count;
+    auto const meanTS = mSums.y / n;
+    auto const meanOrdinal = mSums.x / n;
+    auto const top = mSums.xy - meanOrdinal * mSums.y - meanTS * mSums.x + n * meanOrdinal * meanTS;
+    auto const bottom = mSums.xx - 2 * meanOrdinal * mSums.x + n * meanOrdinal * meanOrdinal;
 
     if (CC_UNLIKELY(bottom == 0)) {
         it->second = {mIdealPeriod, 0};
@@ -176,19 +249,65 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     return true;
 }
 
-nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
-    std::lock_guard<std::mutex> lk(mMutex);
+void VSyncPredictor::publishModel() {
+    auto const [slope, intercept] = mRateMap.find(mIdealPeriod)->second;
+    auto const sequence = mModelSequence.load(std::memory_order_relaxed);
+    mModelSequence.store(sequence + 1, std::memory_order_relaxed);
+    // Readers that see any of the new fields must also see the odd sequence number.
+    std::atomic_thread_fence(std::memory_order_release);
+    mModelSlope.store(slope, std::memory_order_relaxed);
+    mModelIntercept.store(intercept, std::memory_order_relaxed);
+    mModelIdealPeriod.store(mIdealPeriod, std::memory_order_relaxed);
+    mModelHasEarliestTimestamp.store(!mTimestamps.empty(), std::memory_order_relaxed);
+    if (!mTimestamps.empty()) {
+        mModelEarliestTimestamp.store(mTimestamps[mEarliestTimestampIndex],
+                                      std::memory_order_relaxed);
+    }
+    mModelHasKnownTimestamp.store(mKnownTimestamp.has_value(), std::memory_order_relaxed);
+    if (mKnownTimestamp) {
+        mModelKnownTimestamp.store(*mKnownTimestamp, std::memory_order_relaxed);
+    }
+    mModelSequence.store(sequence + 2, std::memory_order_release);
+}
+
+VSyncPredictor::Model VSyncPredictor::readModel() const {
+    Model model;
+    while (true) {
+        auto const sequence = mModelSequence.load(std::memory_order_acquire);
+        if (sequence % 2 == 0) {
+            model.slope = mModelSlope.load(std::memory_order_relaxed);
+            model.intercept = mModelIntercept.load(std::memory_order_relaxed);
+            model.idealPeriod = mModelIdealPeriod.load(std::memory_order_relaxed);
+            model.earliestTimestamp.reset();
+            if (mModelHasEarliestTimestamp.load(std::memory_order_relaxed)) {
+                model.earliestTimestamp = mModelEarliestTimestamp.load(std::memory_order_relaxed);
+            }
+            model.knownTimestamp.reset();
+            if (mModelHasKnownTimestamp.load(std::memory_order_relaxed)) {
+                model.knownTimestamp = mModelKnownTimestamp.load(std::memory_order_relaxed);
+            }
+            // The fields must be read before the sequence number is checked again.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (mModelSequence.load(std::memory_order_relaxed) == sequence) {
+                return model;
+            }
+        }
+    }
+}
 
-    auto const [slope, intercept] = getVSyncPredictionModel(lk);
+nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
+    auto const model = readModel();
+    auto const slope = model.slope;
+    auto const intercept = model.intercept;
 
-    if (mTimestamps.empty()) {
+    if (!model.earliestTimestamp) {
         traceInt64If("VSP-mode", 1);
-        auto const knownTimestamp = mKnownTimestamp ? *mKnownTimestamp : timePoint;
-        auto const numPeriodsOut = ((timePoint - knownTimestamp) / mIdealPeriod) + 1;
-        return knownTimestamp + numPeriodsOut * mIdealPeriod;
+        auto const knownTimestamp = model.knownTimestamp ? *model.knownTimestamp : timePoint;
+        auto const numPeriodsOut = ((timePoint - knownTimestamp) / model.idealPeriod) + 1;
+        return knownTimestamp + numPeriodsOut * model.idealPeriod;
     }
 
-    auto const oldest = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+    auto const oldest = *model.earliestTimestamp;
 
     // See b/145667109, the ordinal calculation must take into account the intercept.
     auto const zeroPoint = oldest + intercept;
@@ -199,7 +318,7 @@ nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
     traceInt64If("VSP-timePoint", timePoint);
     traceInt64If("VSP-prediction", prediction);
 
-    auto const printer = [&, slope = slope, intercept = intercept] {
+    auto const printer = [&] {
         std::stringstream str;
         str << "prediction made from: " << timePoint << "prediction: " << prediction << " (+"
             << prediction - timePoint << ") slope: " << slope << " intercept: " << intercept
@@ -239,11 +358,12 @@ void VSyncPredictor::setPeriod(nsecs_t period) {
     }
 
     clearTimestamps();
+    publishModel();
 }
 
 void VSyncPredictor::clearTimestamps() {
     if (!mTimestamps.empty()) {
-        auto const maxRb = *std::max_element(mTimestamps.begin(), mTimestamps.end());
+        auto const maxRb = latestTimestamp();
         if (mKnownTimestamp) {
             mKnownTimestamp = std::max(*mKnownTimestamp, maxRb);
         } else {
@@ -251,7 +371,11 @@ void VSyncPredictor::clearTimestamps() {
         }
 
         mTimestamps.clear();
+        mOrdinals.clear();
         mLastTimestampIndex = 0;
+        mEarliestTimestampIndex = 0;
+        mNumOutOfOrder = 0;
+        mSums = {};
     }
 }
 
@@ -264,6 +388,7 @@ void VSyncPredictor::resetModel() {
     std::lock_guard<std::mutex> lk(mMutex);
     mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
     clearTimestamps();
+    publishModel();
 }
 
 void VSyncPredictor::dump(std::string& result) const {
@@ -17,7 +17,9 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <atomic>
 #include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 #include "SchedulerUtils.h"
@@ -65,6 +67,11 @@ private:
     VSyncPredictor(VSyncPredictor const&) = delete;
     VSyncPredictor& operator=(VSyncPredictor const&) = delete;
     void clearTimestamps() REQUIRES(mMutex);
+    bool addVsyncTimestampLocked(nsecs_t timestamp) REQUIRES(mMutex);
+    void insertTimestamp(nsecs_t timestamp, nsecs_t period) REQUIRES(mMutex);
+    void evictTimestamp(size_t index) REQUIRES(mMutex);
+    void rebaseSums(size_t earliestIndex) REQUIRES(mMutex);
+    nsecs_t latestTimestamp() const REQUIRES(mMutex);
 
     inline void traceInt64If(const char* name, int64_t value) const;
     bool const mTraceOn;
@@ -86,6 +93,46 @@ private:
 
     int mLastTimestampIndex GUARDED_BY(mMutex) = 0;
     std::vector<nsecs_t> mTimestamps GUARDED_BY(mMutex);
+    // The ordinal of each timestamp, in periods from an arbitrary origin.
+    std::vector<int64_t> mOrdinals GUARDED_BY(mMutex);
+    size_t mEarliestTimestampIndex GUARDED_BY(mMutex) = 0;
+    // The number of timestamps earlier than the one added right before them. While 0, the oldest
+    // timestamp in the ring buffer is the earliest, and the newest is the latest.
+    size_t mNumOutOfOrder GUARDED_BY(mMutex) = 0;
+
+    // Running sums for the regression, with each timestamp measured from the earliest one and
+    // each ordinal scaled by kScalingFactor, so that a new timestamp updates the model in O(1).
+    struct Sums {
+        int64_t count = 0;
+        int64_t x = 0;
+        int64_t y = 0;
+        int64_t xx = 0;
+        int64_t xy = 0;
+    };
+    Sums mSums GUARDED_BY(mMutex);
+
+    // What nextAnticipatedVSyncTimeFrom() and currentPeriod() need, published each time the model
+    // changes, so that they do not wait for mMutex. The fields are written under mMutex with an
+    // odd mModelSequence, and a reader keeps what it read only if the sequence number was the
+    // same even number before and after.
+    struct Model {
+        nsecs_t slope = 0;
+        nsecs_t intercept = 0;
+        nsecs_t idealPeriod = 0;
+        std::optional<nsecs_t> earliestTimestamp;
+        std::optional<nsecs_t> knownTimestamp;
+    };
+    void publishModel() REQUIRES(mMutex);
+    Model readModel() const;
+
+    std::atomic<uint32_t> mModelSequence = 0;
+    std::atomic<nsecs_t> mModelSlope = 0;
+    std::atomic<nsecs_t> mModelIntercept = 0;
+    std::atomic<nsecs_t> mModelIdealPeriod = 0;
+    std::atomic<nsecs_t> mModelEarliestTimestamp = 0;
+    std::atomic<bool> mModelHasEarliestTimestamp = false;
+    std::atomic<nsecs_t> mModelKnownTimestamp = 0;
+    std::atomic<bool> mModelHasKnownTimestamp = false;
 };
 
 } // namespace android::scheduler
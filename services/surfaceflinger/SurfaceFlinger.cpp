@@ -86,6 +86,7 @@
 #include <cmath>
 #include <cstdint>
 #include <functional>
+#include <limits>
 #include <mutex>
 #include <optional>
 #include <unordered_map>
@@ -438,6 +439,30 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     property_get("debug.sf.disable_client_composition_cache", value, "0");
     mDisableClientCompositionCache = atoi(value);
 
+    mFlattenStaticLayersFrameThreshold = static_cast<uint32_t>(
+            std::max(property_get_int32("debug.sf.flatten_static_layers_frames", 0), 0));
+
+    property_get("debug.sf.parallel_output_prepare", value, "0");
+    mPrepareOutputsInParallel = atoi(value);
+
+    property_get("debug.sf.incremental_visibility", value, "0");
+    mCacheLayerVisibility = atoi(value);
+
+    const int32_t bufferPoolKb = property_get_int32("debug.sf.buffer_pool_kb", 0);
+    if (bufferPoolKb > 0) {
+        // Long enough to cover a rotation, or the sampled area of a resized window settling.
+        constexpr nsecs_t kBufferPoolMaxIdleTime = 5'000'000'000;
+        mBufferPoolEnabled = true;
+        GraphicBufferAllocator::get().setPoolBudget(static_cast<size_t>(bufferPoolKb) * 1024,
+                                                    kBufferPoolMaxIdleTime);
+    }
+
+    const auto clientCacheProcessKb = static_cast<size_t>(
+            std::max(property_get_int32("debug.sf.client_cache_process_kb", 0), 0));
+    const auto clientCacheTotalKb = static_cast<size_t>(
+            std::max(property_get_int32("debug.sf.client_cache_total_kb", 0), 0));
+    ClientCache::getInstance().setBudget(clientCacheProcessKb * 1024, clientCacheTotalKb * 1024);
+
     // We should be reading 'persist.sys.sf.color_saturation' here
     // but since /data may be encrypted, we need to wait until after vold
     // comes online to attempt to read the property. The property is
@@ -687,6 +712,8 @@ void SurfaceFlinger::init() {
             renderengine::RenderEngineCreationArgs::Builder()
                 .setPixelFormat(static_cast<int32_t>(defaultCompositionPixelFormat))
                 .setImageCacheSize(maxFrameBufferAcquiredBuffers)
+                .setImageCacheBudget(static_cast<size_t>(std::max(
+                        property_get_int32("ro.sf.image_cache_budget_mb", 0), 0)) * 1024 * 1024)
                 .setUseColorManagerment(useColorManagement)
                 .setEnableProtectedContext(enable_protected_contents(false))
                 .setPrecacheToneMapperShaderOnly(false)
@@ -734,6 +761,7 @@ void SurfaceFlinger::init() {
 
     // initialize our drawing state
     mDrawingState = mCurrentState;
+    rebuildDrawingLayersInZOrder();
 
     // set initial conditions (e.g. unblank default device)
     initializeDisplays();
@@ -1466,9 +1494,9 @@ status_t SurfaceFlinger::getLayerDebugInfo(std::vector<LayerDebugInfo>* outLayer
     outLayers->clear();
     schedule([=] {
         const auto display = ON_MAIN_THREAD(getDefaultDisplayDeviceLocked());
-        mDrawingState.traverseInZOrder([&](Layer* layer) {
+        for (Layer* layer : mDrawingLayersInZOrder) {
             outLayers->push_back(layer->getLayerDebugInfo(display.get()));
-        });
+        }
     }).wait();
     return NO_ERROR;
 }
@@ -1899,6 +1927,7 @@ void SurfaceFlinger::onMessageInvalidate(nsecs_t expectedVSyncTime) {
     const TracedOrdinal<bool> gpuFrameMissed = {"PrevGpuFrameMissed",
                                                 mHadClientComposition && frameMissed};
 
+    mPreviousFrameMissed = frameMissed;
     if (frameMissed) {
         mFrameMissedCount++;
         mTimeStats->incrementMissedFrames();
@@ -2001,6 +2030,11 @@ void SurfaceFlinger::onMessageInvalidate(nsecs_t expectedVSyncTime) {
         Mutex::Autolock _l(mStateLock);
         mScheduler->chooseRefreshRateForContent();
     }
+    mScheduler->updateFrameRateDividers(mAppConnectionHandle);
+    {
+        const auto offsets = mVSyncModulator->getOffsets();
+        mScheduler->updateVSyncDispatchDelays(mAppConnectionHandle, offsets.app, offsets.sf);
+    }
 
     ON_MAIN_THREAD(performSetActiveConfig());
 
@@ -2056,13 +2090,23 @@ void SurfaceFlinger::onMessageRefresh() {
     compositionengine::CompositionRefreshArgs refreshArgs;
     const auto& displays = ON_MAIN_THREAD(mDisplays);
     refreshArgs.outputs.reserve(displays.size());
+    // Physical displays go first, so that virtual displays mirroring them can copy their client
+    // target rather than compose the same layers again.
     for (const auto& [_, display] : displays) {
-        refreshArgs.outputs.push_back(display->getCompositionDisplay());
+        if (!display->isVirtual()) {
+            refreshArgs.outputs.push_back(display->getCompositionDisplay());
+        }
+    }
+    for (const auto& [_, display] : displays) {
+        if (display->isVirtual()) {
+            refreshArgs.outputs.push_back(display->getCompositionDisplay());
+        }
     }
-    mDrawingState.traverseInZOrder([&refreshArgs](Layer* layer) {
+    refreshArgs.layers.reserve(mDrawingLayersInZOrder.size());
+    for (Layer* layer : mDrawingLayersInZOrder) {
         if (auto layerFE = layer->getCompositionEngineLayerFE())
             refreshArgs.layers.push_back(layerFE);
-    });
+    }
     refreshArgs.layersWithQueuedFrames.reserve(mLayersWithQueuedFrames.size());
     for (sp<Layer> layer : mLayersWithQueuedFrames) {
         if (auto layerFE = layer->getCompositionEngineLayerFE())
@@ -2093,14 +2137,35 @@ void SurfaceFlinger::onMessageRefresh() {
                 std::chrono::milliseconds(mDebugRegion > 1 ? mDebugRegion : 0);
     }
 
+    if (mPrepareOutputsInParallel && refreshArgs.outputs.size() > 1) {
+        if (!mOutputWorkers) {
+            mOutputWorkers = std::make_unique<WorkerPool>(kOutputWorkerCount, "sfOutputs");
+        }
+        refreshArgs.runInParallel = [this](size_t count, const WorkerPool::Work& work) {
+            mOutputWorkers->run(count, work);
+        };
+    }
+
     mGeometryInvalid = false;
 
+    mPowerAdvisor.notifyFrameWorkload({refreshArgs.layers.size(), mClientCompositionLayerCount,
+                                       mScheduler->getPrimaryDispSync().getPeriod(),
+                                       mPreviousFrameDuration, mPreviousFrameMissed});
+
+    // Write the cursor positions that changed since the invalidate, so that they are presented
+    // with this frame rather than the next one.
+    if (mCursorPositionsChanged) {
+        updateCursorAsync();
+    }
+
     // Store the present time just before calling to the composition engine so we could notify
     // the scheduler.
     const auto presentTime = systemTime();
 
     mCompositionEngine->present(refreshArgs);
-    mTimeStats->recordFrameDuration(mFrameStartTime, systemTime());
+    const nsecs_t frameEnd = systemTime();
+    mTimeStats->recordFrameDuration(mFrameStartTime, frameEnd);
+    mPreviousFrameDuration = mFrameStartTime > 0 ? frameEnd - mFrameStartTime : 0;
     // Reset the frame start time now that we've recorded this frame.
     mFrameStartTime = 0;
 
@@ -2124,6 +2189,15 @@ void SurfaceFlinger::onMessageRefresh() {
                 const auto& state = pair.second->getCompositionDisplay()->getState();
                 return state.reusedClientComposition;
             });
+    mClientCompositionLayerCount = 0;
+    if (mHadClientComposition) {
+        for (const auto& [_, display] : displays) {
+            for (const auto* outputLayer :
+                 display->getCompositionDisplay()->getOutputLayersOrderedByZ()) {
+                mClientCompositionLayerCount += outputLayer->requiresClientComposition() ? 1 : 0;
+            }
+        }
+    }
 
     // Only report a strategy change if we move in and out of composition with hw overlays
     if (prevFrameHadDeviceComposition != mHadDeviceComposition) {
@@ -2372,6 +2446,10 @@ void SurfaceFlinger::postComposition()
         mRegionSamplingThread->notifyNewContent();
     }
 
+    if (mBufferPoolEnabled) {
+        GraphicBufferAllocator::get().trimPool();
+    }
+
     // Even though ATRACE_INT64 already checks if tracing is enabled, it doesn't prevent the
     // side-effect of getTotalSize(), so we check that again here
     if (ATRACE_ENABLED()) {
@@ -2947,17 +3025,23 @@ void SurfaceFlinger::updateInputFlinger() {
 void SurfaceFlinger::updateInputWindowInfo() {
     std::vector<InputWindowInfo> inputHandles;
 
-    mDrawingState.traverseInReverseZOrder([&](Layer* layer) {
+    for (auto it = mDrawingLayersInZOrder.rbegin(); it != mDrawingLayersInZOrder.rend(); ++it) {
+        Layer* layer = *it;
         if (layer->needsInputInfo()) {
             // When calculating the screen bounds we ignore the transparent region since it may
             // result in an unwanted offset.
             inputHandles.push_back(layer->fillInputInfo());
         }
-    });
+    }
 
-    mInputFlinger->setInputWindows(inputHandles,
-                                   mInputWindowCommands.syncInputWindows ? mSetInputWindowsListener
-                                                                         : nullptr);
+    // Only send the windows that changed, so moving one window does not re-send all of them.
+    const InputWindowsUpdate update = mInputWindowsUpdateWriter.update(inputHandles);
+    const sp<ISetInputWindowsListener> listener =
+            mInputWindowCommands.syncInputWindows ? mSetInputWindowsListener : nullptr;
+    if (update.isEmpty() && listener == nullptr) {
+        return;
+    }
+    mInputFlinger->updateInputWindows(update, listener);
 }
 
 void SurfaceFlinger::commitInputWindowCommands() {
@@ -2966,6 +3050,8 @@ void SurfaceFlinger::commitInputWindowCommands() {
 }
 
 void SurfaceFlinger::updateCursorAsync() {
+    mCursorPositionsChanged = false;
+
     compositionengine::CompositionRefreshArgs refreshArgs;
     for (const auto& [_, display] : ON_MAIN_THREAD(mDisplays)) {
         if (display->getId()) {
@@ -2976,6 +3062,28 @@ void SurfaceFlinger::updateCursorAsync() {
     mCompositionEngine->updateCursorAsync(refreshArgs);
 }
 
+void SurfaceFlinger::updateCursorPositions(const Vector<ComposerState>& states) {
+    std::lock_guard<std::mutex> lock(mCursorLock);
+    if (mCursorLayersByLocalBinderToken.empty()) {
+        return;
+    }
+
+    for (const auto& state : states) {
+        const layer_state_t& s = state.state;
+        if (s.what != layer_state_t::ePositionChanged || !s.surface) {
+            continue;
+        }
+        const auto it = mCursorLayersByLocalBinderToken.find(s.surface->localBinder());
+        if (it == mCursorLayersByLocalBinderToken.end()) {
+            continue;
+        }
+        if (const auto layer = it->second.promote()) {
+            layer->setCursorPosition(s.x, s.y);
+            mCursorPositionsChanged = true;
+        }
+    }
+}
+
 void SurfaceFlinger::changeRefreshRate(const RefreshRate& refreshRate,
                                        Scheduler::ConfigEvent event) {
     // If this is called from the main thread mStateLock must be locked before
@@ -3088,6 +3196,13 @@ void SurfaceFlinger::commitTransactionLocked() {
 
     commitOffscreenLayers();
     mDrawingState.traverse([&](Layer* layer) { layer->updateMirrorInfo(); });
+    rebuildDrawingLayersInZOrder();
+}
+
+void SurfaceFlinger::rebuildDrawingLayersInZOrder() {
+    mDrawingLayersInZOrder.clear();
+    mDrawingState.traverseInZOrder(
+            [&](Layer* layer) { mDrawingLayersInZOrder.push_back(layer); });
 }
 
 void SurfaceFlinger::commitOffscreenLayers() {
@@ -3155,6 +3270,18 @@ bool SurfaceFlinger::handlePageFlip()
                                          [&](Layer* l) { l->latchAndReleaseBuffer(); });
     }
 
+    if (mLayersWithQueuedFrames.size() >= kMinLayersForLatchWorkers) {
+        // Checking a fence is a syscall, and independent of other layers, so the fences are
+        // checked in parallel first. The layers are still latched below, one at a time and in
+        // order, since latching updates state shared with the rest of SurfaceFlinger.
+        if (!mLatchWorkers) {
+            mLatchWorkers = std::make_unique<WorkerPool>(kLatchWorkerCount, "sfLatch");
+        }
+        mLatchWorkers->run(mLayersWithQueuedFrames.size(), [this](size_t index) {
+            mLayersWithQueuedFrames[index]->prefetchFenceStatus();
+        });
+    }
+
     if (!mLayersWithQueuedFrames.empty()) {
         // mStateLock is needed for latchBuffer as LayerRejecter::reject()
         // writes to Layer current state. See also b/119481871
@@ -3222,6 +3349,10 @@ status_t SurfaceFlinger::addClientLayer(const sp<Client>& client, const sp<IBind
         }
 
         mLayersByLocalBinderToken.emplace(handle->localBinder(), lbc);
+        if (lbc->isPotentialCursor()) {
+            std::lock_guard<std::mutex> cursorLock(mCursorLock);
+            mCursorLayersByLocalBinderToken.emplace(handle->localBinder(), lbc);
+        }
 
         if (parent == nullptr && addToCurrentState) {
             mCurrentState.layersSortedByZ.add(lbc);
@@ -3300,18 +3431,31 @@ bool SurfaceFlinger::flushTransactionQueues() {
     bool flushedATransaction = false;
     {
         Mutex::Autolock _l(mStateLock);
+        bool needsPolling = false;
+        int64_t earliestDeferredPresentTime = std::numeric_limits<int64_t>::max();
 
         auto it = mTransactionQueues.begin();
         while (it != mTransactionQueues.end()) {
             auto& [applyToken, transactionQueue] = *it;
 
             while (!transactionQueue.empty()) {
-                const auto& transaction = transactionQueue.front();
+                auto& transaction = transactionQueue.front();
+                if (transactionIsDeferred(transaction.desiredPresentTime)) {
+                    earliestDeferredPresentTime = std::min(earliestDeferredPresentTime,
+                                                           transaction.desiredPresentTime);
+                    break;
+                }
                 if (!transactionIsReadyToBeApplied(transaction.desiredPresentTime,
-                                                   transaction.states)) {
+                                                   transaction.states,
+                                                   &transaction.firstUnsignaledState)) {
+                    needsPolling = true;
                     setTransactionFlags(eTransactionFlushNeeded);
                     break;
                 }
+                const nsecs_t wait = systemTime() - transaction.postTime;
+                mTransactionQueueStats.applied++;
+                mTransactionQueueStats.totalWait += wait;
+                mTransactionQueueStats.maxWait = std::max(mTransactionQueueStats.maxWait, wait);
                 transactions.push_back(transaction);
                 applyTransactionState(transaction.states, transaction.displays, transaction.flags,
                                       mPendingInputWindowCommands, transaction.desiredPresentTime,
@@ -3329,35 +3473,87 @@ bool SurfaceFlinger::flushTransactionQueues() {
                 it = std::next(it, 1);
             }
         }
+
+        mTransactionQueuesNeedPolling = needsPolling;
+        if (!needsPolling && earliestDeferredPresentTime != std::numeric_limits<int64_t>::max()) {
+            scheduleDeferredTransactionFlush(earliestDeferredPresentTime);
+        }
     }
     return flushedATransaction;
 }
 
 bool SurfaceFlinger::transactionFlushNeeded() {
-    return !mTransactionQueues.empty();
+    return mTransactionQueuesNeedPolling;
+}
+
+bool SurfaceFlinger::transactionIsDeferred(int64_t desiredPresentTime) const {
+    const nsecs_t expectedPresentTime = mExpectedPresentTime.load();
+    // Do not present if the desiredPresentTime has not passed unless it is more than one second
+    // in the future. We ignore timestamps more than 1 second in the future for stability reasons.
+    return desiredPresentTime >= 0 && desiredPresentTime >= expectedPresentTime &&
+            desiredPresentTime < expectedPresentTime + s2ns(1);
+}
+
+void SurfaceFlinger::scheduleDeferredTransactionFlush(int64_t desiredPresentTime) {
+    DisplayStatInfo stats;
+    mScheduler->getDisplayStatInfo(&stats);
+    const nsecs_t vsyncPeriod = std::max<nsecs_t>(stats.vsyncPeriod, 1);
+
+    // Each frame presents one vsync period after the previous one, so the transaction becomes
+    // ready on the first frame whose expected present time is past desiredPresentTime. Wake up a
+    // frame ahead of it so that the invalidate for that frame is requested in time; waking up too
+    // early only means scheduling again.
+    const nsecs_t framesUntilDue = (desiredPresentTime - mExpectedPresentTime.load()) / vsyncPeriod;
+    const nsecs_t now = systemTime();
+    const nsecs_t wakeupTime = now + framesUntilDue * vsyncPeriod;
+    if (mDeferredTransactionWakeupTime > now && mDeferredTransactionWakeupTime <= wakeupTime) {
+        return;
+    }
+
+    ATRACE_INT64("DeferredTransactionWakeup", wakeupTime - now);
+    if (framesUntilDue == 0) {
+        mDeferredTransactionWakeupTime = 0;
+        setTransactionFlags(eTransactionFlushNeeded);
+        return;
+    }
+
+    mDeferredTransactionWakeupTime = wakeupTime;
+    auto [task, future] = makeTask([this, wakeupTime]() MAIN_THREAD {
+        Mutex::Autolock _l(mStateLock);
+        // A wakeup that was superseded by an earlier one has nothing left to do.
+        if (mDeferredTransactionWakeupTime == wakeupTime) {
+            mDeferredTransactionWakeupTime = 0;
+            setTransactionFlags(eTransactionFlushNeeded);
+        }
+    });
+    mEventQueue->postMessageDelayed(std::move(task), wakeupTime - now);
 }
 
 
 bool SurfaceFlinger::transactionIsReadyToBeApplied(int64_t desiredPresentTime,
                                                    const Vector<ComposerState>& states) {
+    size_t firstUnsignaledState = 0;
+    return transactionIsReadyToBeApplied(desiredPresentTime, states, &firstUnsignaledState);
+}
 
-    const nsecs_t expectedPresentTime = mExpectedPresentTime.load();
-    // Do not present if the desiredPresentTime has not passed unless it is more than one second
-    // in the future. We ignore timestamps more than 1 second in the future for stability reasons.
-    if (desiredPresentTime >= 0 && desiredPresentTime >= expectedPresentTime &&
-        desiredPresentTime < expectedPresentTime + s2ns(1)) {
+bool SurfaceFlinger::transactionIsReadyToBeApplied(int64_t desiredPresentTime,
+                                                   const Vector<ComposerState>& states,
+                                                   size_t* firstUnsignaledState) {
+    if (transactionIsDeferred(desiredPresentTime)) {
         return false;
     }
 
-    for (const ComposerState& state : states) {
-        const layer_state_t& s = state.state;
+    for (size_t i = *firstUnsignaledState; i < states.size(); i++) {
+        const layer_state_t& s = states[i].state;
         if (!(s.what & layer_state_t::eAcquireFenceChanged)) {
             continue;
         }
         if (s.acquireFence && s.acquireFence->getStatus() == Fence::Status::Unsignaled) {
+            *firstUnsignaledState = i;
             return false;
         }
     }
+    *firstUnsignaledState = states.size();
     return true;
 }
 
@@ -3372,6 +3568,8 @@ void SurfaceFlinger::setTransactionState(
 
     bool privileged = callingThreadHasUnscopedSurfaceFlingerAccess();
 
+    updateCursorPositions(states);
+
     Mutex::Autolock _l(mStateLock);
 
     // If its TransactionQueue already has a pending TransactionState or if it is pending
@@ -3397,10 +3595,16 @@ void SurfaceFlinger::setTransactionState(
         mExpectedPresentTime = calculateExpectedPresentTime(systemTime());
     }
 
-    if (pendingTransactions || !transactionIsReadyToBeApplied(desiredPresentTime, states)) {
-        mTransactionQueues[applyToken].emplace(states, displays, flags, desiredPresentTime,
-                                               uncacheBuffer, postTime, privileged,
-                                               hasListenerCallbacks, listenerCallbacks);
+    size_t firstUnsignaledState = 0;
+    if (pendingTransactions ||
+        !transactionIsReadyToBeApplied(desiredPresentTime, states, &firstUnsignaledState)) {
+        auto& transactionQueue = mTransactionQueues[applyToken];
+        transactionQueue.emplace(states, displays, flags, desiredPresentTime, uncacheBuffer,
+                                 postTime, privileged, hasListenerCallbacks, listenerCallbacks);
+        transactionQueue.back().firstUnsignaledState = firstUnsignaledState;
+        mTransactionQueueStats.queued++;
+        mTransactionQueueStats.maxDepth =
+                std::max(mTransactionQueueStats.maxDepth, transactionQueue.size());
         setTransactionFlags(eTransactionFlushNeeded);
         return;
     }
@@ -3966,12 +4170,16 @@ status_t SurfaceFlinger::mirrorLayer(const sp<Client>& client, const sp<IBinder>
         Mutex::Autolock _l(mStateLock);
         mirrorFrom = fromHandleLocked(mirrorFromHandle).promote();
         if (!mirrorFrom) {
+            mLayerNameRegistry.release(uniqueName);
             return NAME_NOT_FOUND;
         }
 
-        status_t result = createContainerLayer(client, std::move(uniqueName), -1, -1, 0,
-                                               LayerMetadata(), outHandle, &mirrorLayer);
+        status_t result = createContainerLayer(client, uniqueName, -1, -1, 0, LayerMetadata(),
+                                               outHandle, &mirrorLayer);
         if (result != NO_ERROR) {
+            if (mirrorLayer == nullptr) {
+                mLayerNameRegistry.release(uniqueName);
+            }
             return result;
         }
 
@@ -4018,12 +4226,12 @@ status_t SurfaceFlinger::createLayer(const String8& name, const sp<Client>& clie
 
     switch (flags & ISurfaceComposerClient::eFXSurfaceMask) {
         case ISurfaceComposerClient::eFXSurfaceBufferQueue:
-            result = createBufferQueueLayer(client, std::move(uniqueName), w, h, flags,
+            result = createBufferQueueLayer(client, uniqueName, w, h, flags,
                                             std::move(metadata), format, handle, gbp, &layer);
 
             break;
         case ISurfaceComposerClient::eFXSurfaceBufferState:
-            result = createBufferStateLayer(client, std::move(uniqueName), w, h, flags,
+            result = createBufferStateLayer(client, uniqueName, w, h, flags,
                                             std::move(metadata), handle, &layer);
             break;
         case ISurfaceComposerClient::eFXSurfaceEffect:
@@ -4031,10 +4239,11 @@ status_t SurfaceFlinger::createLayer(const String8& name, const sp<Client>& clie
             if (w > 0 || h > 0) {
                 ALOGE("createLayer() failed, w or h cannot be set for color layer (w=%d, h=%d)",
                       int(w), int(h));
-                return BAD_VALUE;
+                result = BAD_VALUE;
+                break;
             }
 
-            result = createEffectLayer(client, std::move(uniqueName), w, h, flags,
+            result = createEffectLayer(client, uniqueName, w, h, flags,
                                        std::move(metadata), handle, &layer);
             break;
         case ISurfaceComposerClient::eFXSurfaceContainer:
@@ -4042,9 +4251,10 @@ status_t SurfaceFlinger::createLayer(const String8& name, const sp<Client>& clie
             if (w > 0 || h > 0) {
                 ALOGE("createLayer() failed, w or h cannot be set for container layer (w=%d, h=%d)",
                       int(w), int(h));
-                return BAD_VALUE;
+                result = BAD_VALUE;
+                break;
             }
-            result = createContainerLayer(client, std::move(uniqueName), w, h, flags,
+            result = createContainerLayer(client, uniqueName, w, h, flags,
                                           std::move(metadata), handle, &layer);
             break;
         default:
@@ -4053,6 +4263,10 @@ status_t SurfaceFlinger::createLayer(const String8& name, const sp<Client>& clie
     }
 
     if (result != NO_ERROR) {
+        // A layer that was created releases its name when it is destroyed.
+        if (layer == nullptr) {
+            mLayerNameRegistry.release(uniqueName);
+        }
         return result;
     }
 
@@ -4073,28 +4287,7 @@ status_t SurfaceFlinger::createLayer(const String8& name, const sp<Client>& clie
 }
 
 std::string SurfaceFlinger::getUniqueLayerName(const char* name) {
-    unsigned dupeCounter = 0;
-
-    // Tack on our counter whether there is a hit or not, so everyone gets a tag
-    std::string uniqueName = base::StringPrintf("%s#%u", name, dupeCounter);
-
-    // Grab the state lock since we're accessing mCurrentState
-    Mutex::Autolock lock(mStateLock);
-
-    // Loop over layers until we're sure there is no matching name
-    bool matchFound = true;
-    while (matchFound) {
-        matchFound = false;
-        mCurrentState.traverse([&](Layer* layer) {
-            if (layer->getName() == uniqueName) {
-                matchFound = true;
-                uniqueName = base::StringPrintf("%s#%u", name, ++dupeCounter);
-            }
-        });
-    }
-
-    ALOGV_IF(dupeCounter > 0, "duplicate layer name: changing %s to %s", name, uniqueName.c_str());
-    return uniqueName;
+    return mLayerNameRegistry.acquire(name);
 }
 
 status_t SurfaceFlinger::createBufferQueueLayer(const sp<Client>& client, std::string name,
@@ -4195,6 +4388,18 @@ void SurfaceFlinger::onHandleDestroyed(sp<Layer>& layer)
         }
     }
 
+    if (layer->isPotentialCursor()) {
+        std::lock_guard<std::mutex> cursorLock(mCursorLock);
+        auto cursorIt = mCursorLayersByLocalBinderToken.begin();
+        while (cursorIt != mCursorLayersByLocalBinderToken.end()) {
+            if (cursorIt->second == layer) {
+                cursorIt = mCursorLayersByLocalBinderToken.erase(cursorIt);
+            } else {
+                cursorIt++;
+            }
+        }
+    }
+
     layer.clear();
 }
 
@@ -4351,7 +4556,6 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
                  dumper([this](std::string& s) { mScheduler->getPrimaryDispSync().dump(s); })},
                 {"--edid"s, argsDumper(&SurfaceFlinger::dumpRawDisplayIdentificationData)},
                 {"--frame-events"s, dumper(&SurfaceFlinger::dumpFrameEventsLocked)},
-                {"--latency"s, argsDumper(&SurfaceFlinger::dumpStatsLocked)},
                 {"--latency-clear"s, argsDumper(&SurfaceFlinger::clearStatsLocked)},
                 {"--list"s, dumper(&SurfaceFlinger::listLayersLocked)},
                 {"--static-screen"s, dumper(&SurfaceFlinger::dumpStaticScreenStats)},
@@ -4362,6 +4566,20 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
 
         const auto flag = args.empty() ? ""s : std::string(String8(args[0]));
 
+        if (args.empty()) {
+            if (auto cachedDump = getCachedDump(asProto)) {
+                write(fd, cachedDump->c_str(), cachedDump->size());
+                return NO_ERROR;
+            }
+        }
+
+        if (flag == "--latency"s) {
+            // Polled frequently, so it must not hold mStateLock while formatting.
+            dumpStats(args, result);
+            write(fd, result.c_str(), result.size());
+            return NO_ERROR;
+        }
+
         bool dumpLayers = true;
         {
             TimedLock lock(mStateLock, s2ns(1), __FUNCTION__);
@@ -4390,11 +4608,25 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
                 dumpOffscreenLayers(result);
             }
         }
+
+        if (args.empty()) {
+            std::lock_guard lock(mDumpCacheMutex);
+            mCachedDump = {systemTime(), asProto, result};
+        }
     }
     write(fd, result.c_str(), result.size());
     return NO_ERROR;
 }
 
+std::optional<std::string> SurfaceFlinger::getCachedDump(bool asProto) {
+    std::lock_guard lock(mDumpCacheMutex);
+    if (mCachedDump.asProto != asProto || mCachedDump.dump.empty() ||
+        systemTime() - mCachedDump.time >= kDumpCacheDuration) {
+        return {};
+    }
+    return mCachedDump.dump;
+}
+
 status_t SurfaceFlinger::dumpCritical(int fd, const DumpArgs&, bool asProto) {
     if (asProto && mTracing.isEnabled()) {
         mTracing.writeToFileAsync();
@@ -4408,16 +4640,33 @@ void SurfaceFlinger::listLayersLocked(std::string& result) const {
             [&](Layer* layer) { StringAppendF(&result, "%s\n", layer->getDebugName()); });
 }
 
-void SurfaceFlinger::dumpStatsLocked(const DumpArgs& args, std::string& result) const {
-    StringAppendF(&result, "%" PRId64 "\n", getVsyncPeriodFromHWC());
+void SurfaceFlinger::dumpStats(const DumpArgs& args, std::string& result) const {
+    nsecs_t vsyncPeriod;
+    std::vector<sp<Layer>> layers;
+    {
+        TimedLock lock(mStateLock, s2ns(1), __FUNCTION__);
+        if (!lock.locked()) {
+            StringAppendF(&result, "Dumping without lock after timeout: %s (%d)\n",
+                          strerror(-lock.status), lock.status);
+        }
+
+        vsyncPeriod = getVsyncPeriodFromHWC();
+        if (args.size() > 1) {
+            const auto name = String8(args[1]);
+            mCurrentState.traverseInZOrder([&](Layer* layer) {
+                if (layer->getName() == name.string()) {
+                    layers.emplace_back(layer);
+                }
+            });
+        }
+    }
 
+    // The frame trackers have their own lock.
+    StringAppendF(&result, "%" PRId64 "\n", vsyncPeriod);
     if (args.size() > 1) {
-        const auto name = String8(args[1]);
-        mCurrentState.traverseInZOrder([&](Layer* layer) {
-            if (layer->getName() == name.string()) {
-                layer->dumpFrameStats(result);
-            }
-        });
+        for (const auto& layer : layers) {
+            layer->dumpFrameStats(result);
+        }
     } else {
         mAnimFrameTracker.dumpStats(result);
     }
@@ -4528,6 +4777,15 @@ void SurfaceFlinger::recordBufferingStats(const std::string& layerName,
         }
         ++stats.numSegments;
         stats.totalTime += segment.totalTime;
+
+        if (stats.occupancyTimes.size() < segment.occupancyTimes.size()) {
+            stats.occupancyTimes.resize(segment.occupancyTimes.size());
+        }
+        for (size_t depth = 0; depth < segment.occupancyTimes.size(); ++depth) {
+            stats.occupancyTimes[depth] += segment.occupancyTimes[depth];
+        }
+        stats.dequeueWait.merge(segment.dequeueWait);
+        stats.acquireWait.merge(segment.acquireWait);
     }
 }
 
@@ -4571,6 +4829,46 @@ void SurfaceFlinger::dumpBufferingStats(std::string& result) const {
                       activeTime, std::get<1>(values), std::get<2>(values), std::get<3>(values));
     }
     result.append("\n");
+
+    result.append("Queue depth and wait times:\n");
+    result.append("  [Layer name] <Time at depth 0..n> | <Dequeue wait> | <Acquire wait>\n");
+    result.append("  (waits are count, avg/max ms, then buckets of <1, <2, <4 .. ms)\n");
+    const auto appendWait = [&result](const OccupancyTracker::WaitHistogram& wait) {
+        StringAppendF(&result, " | %zu, %.3f/%.3f:", wait.count,
+                      wait.count ? wait.totalTime / 1e6 / wait.count : 0.0, wait.maxTime / 1e6);
+        for (uint32_t bucket : wait.buckets) {
+            StringAppendF(&result, " %u", bucket);
+        }
+    };
+    for (const auto& [name, stats] : getBE().mBufferingStats) {
+        if (stats.numSegments == 0) {
+            continue;
+        }
+        StringAppendF(&result, "  [%s]", name.c_str());
+        for (nsecs_t time : stats.occupancyTimes) {
+            StringAppendF(&result, " %.3f", static_cast<float>(time) / stats.totalTime);
+        }
+        appendWait(stats.dequeueWait);
+        appendWait(stats.acquireWait);
+        result.append("\n");
+    }
+    result.append("\n");
+}
+
+void SurfaceFlinger::dumpTransactionQueues(std::string& result) const {
+    size_t pending = 0;
+    for (const auto& [applyToken, transactionQueue] : mTransactionQueues) {
+        pending += transactionQueue.size();
+    }
+    const TransactionQueueStats& stats = mTransactionQueueStats;
+    StringAppendF(&result, "Transaction queues: %zu tokens, %zu pending, max depth %zu\n",
+                  mTransactionQueues.size(), pending, stats.maxDepth);
+    StringAppendF(&result,
+                  "  queued %" PRIu64 ", applied %" PRIu64 ", wait to apply avg %.3f ms, "
+                  "max %.3f ms\n\n",
+                  stats.queued, stats.applied,
+                  stats.applied ? stats.totalWait / 1e6 / stats.applied : 0.0,
+                  stats.maxWait / 1e6);
 }
 
 void SurfaceFlinger::dumpDisplayIdentificationData(std::string& result) const {
@@ -4743,6 +5041,12 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, std::string& result) co
     dumpVSync(result);
     result.append("\n");
 
+    colorizer.bold(result);
+    result.append("PowerAdvisor: ");
+    colorizer.reset(result);
+    mPowerAdvisor.dump(result);
+    result.append("\n");
+
     dumpStaticScreenStats(result);
     result.append("\n");
 
@@ -4750,8 +5054,13 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, std::string& result) co
     StringAppendF(&result, "HWC missed frame count: %u\n", mHwcFrameMissedCount.load());
     StringAppendF(&result, "GPU missed frame count: %u\n\n", mGpuFrameMissedCount.load());
 
+    dumpTransactionQueues(result);
+
     dumpBufferingStats(result);
 
+    ClientCache::getInstance().dump(result);
+    result.append("\n");
+
     /*
      * Dump the visible layer list
      */
@@ -4987,6 +5296,7 @@ status_t SurfaceFlinger::CheckTransactCodeCredentials(uint32_t code) {
         }
         case CAPTURE_LAYERS:
         case CAPTURE_SCREEN:
+        case CAPTURE_SCREEN_ASYNC:
         case ADD_REGION_SAMPLING_LISTENER:
         case REMOVE_REGION_SAMPLING_LISTENER: {
             // codes that require permission check
@@ -5452,6 +5762,34 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& displayToken,
                                        uint32_t reqHeight, bool useIdentityTransform,
                                        ui::Rotation rotation, bool captureSecureLayers) {
     ATRACE_CALL();
+    return captureScreenImpl(displayToken, outBuffer, /*outReadyFence=*/nullptr,
+                             outCapturedSecureLayers, reqDataspace, reqPixelFormat, sourceCrop,
+                             reqWidth, reqHeight, useIdentityTransform, rotation,
+                             captureSecureLayers);
+}
+
+status_t SurfaceFlinger::captureScreenAsync(const sp<IBinder>& displayToken,
+                                            sp<GraphicBuffer>* outBuffer, sp<Fence>* outReadyFence,
+                                            bool& outCapturedSecureLayers, Dataspace reqDataspace,
+                                            ui::PixelFormat reqPixelFormat,
+                                            const Rect& sourceCrop, uint32_t reqWidth,
+                                            uint32_t reqHeight, bool useIdentityTransform,
+                                            ui::Rotation rotation, bool captureSecureLayers) {
+    ATRACE_CALL();
+    if (!outReadyFence) return BAD_VALUE;
+
+    return captureScreenImpl(displayToken, outBuffer, outReadyFence, outCapturedSecureLayers,
+                             reqDataspace, reqPixelFormat, sourceCrop, reqWidth, reqHeight,
+                             useIdentityTransform, rotation, captureSecureLayers);
+}
+
+status_t SurfaceFlinger::captureScreenImpl(const sp<IBinder>& displayToken,
+                                           sp<GraphicBuffer>* outBuffer, sp<Fence>* outReadyFence,
+                                           bool& outCapturedSecureLayers, Dataspace reqDataspace,
+                                           ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
+                                           uint32_t reqWidth, uint32_t reqHeight,
+                                           bool useIdentityTransform, ui::Rotation rotation,
+                                           bool captureSecureLayers) {
 
     if (!displayToken) return BAD_VALUE;
 
@@ -5490,7 +5828,7 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& displayToken,
     auto traverseLayers = std::bind(&SurfaceFlinger::traverseLayersInDisplay, this, display,
                                     std::placeholders::_1);
     return captureScreenCommon(renderArea, traverseLayers, outBuffer, reqPixelFormat,
-                               useIdentityTransform, outCapturedSecureLayers);
+                               useIdentityTransform, outCapturedSecureLayers, outReadyFence);
 }
 
 static Dataspace pickDataspaceFromColorMode(const ColorMode colorMode) {
@@ -5807,26 +6145,41 @@ status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
                                              sp<GraphicBuffer>* outBuffer,
                                              const ui::PixelFormat reqPixelFormat,
                                              bool useIdentityTransform,
-                                             bool& outCapturedSecureLayers) {
+                                             bool& outCapturedSecureLayers,
+                                             sp<Fence>* outReadyFence) {
     ATRACE_CALL();
 
     // TODO(b/116112787) Make buffer usage a parameter.
     const uint32_t usage = GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN |
             GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE;
-    *outBuffer =
-            getFactory().createGraphicBuffer(renderArea.getReqWidth(), renderArea.getReqHeight(),
-                                             static_cast<android_pixel_format>(reqPixelFormat), 1,
-                                             usage, "screenshot");
+    const sp<GraphicBuffer>& buffer = *outBuffer;
+    const bool reuseBuffer = buffer &&
+            buffer->getWidth() == static_cast<uint32_t>(renderArea.getReqWidth()) &&
+            buffer->getHeight() == static_cast<uint32_t>(renderArea.getReqHeight()) &&
+            buffer->getPixelFormat() == static_cast<PixelFormat>(reqPixelFormat) &&
+            (buffer->getUsage() & GRALLOC_USAGE_HW_RENDER);
+    if (!reuseBuffer) {
+        *outBuffer = getFactory().createGraphicBuffer(renderArea.getReqWidth(),
+                                                      renderArea.getReqHeight(),
+                                                      static_cast<android_pixel_format>(
+                                                              reqPixelFormat),
+                                                      1, usage, "screenshot");
+        // Only buffers which end up not being sent to the client are recycled.
+        if (*outBuffer) {
+            (*outBuffer)->setRecyclable(true);
+        }
+    }
 
     return captureScreenCommon(renderArea, traverseLayers, *outBuffer, useIdentityTransform,
-                               false /* regionSampling */, outCapturedSecureLayers);
+                               false /* regionSampling */, outCapturedSecureLayers, outReadyFence);
 }
 
 status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
                                              TraverseLayersFunction traverseLayers,
                                              const sp<GraphicBuffer>& buffer,
                                              bool useIdentityTransform, bool regionSampling,
-                                             bool& outCapturedSecureLayers) {
+                                             bool& outCapturedSecureLayers,
+                                             sp<Fence>* outReadyFence) {
     const int uid = IPCThreadState::self()->getCallingUid();
     const bool forSystem = uid == AID_GRAPHICS || uid == AID_SYSTEM;
 
@@ -5856,8 +6209,12 @@ status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
     } while (result == EAGAIN);
 
     if (result == NO_ERROR) {
-        sync_wait(syncFd, -1);
-        close(syncFd);
+        if (outReadyFence) {
+            *outReadyFence = syncFd >= 0 ? new Fence(syncFd) : Fence::NO_FENCE;
+        } else {
+            sync_wait(syncFd, -1);
+            close(syncFd);
+        }
     }
 
     return result;
@@ -6252,7 +6609,14 @@ void SurfaceFlinger::onLayerFirstRef(Layer* layer) {
 
 void SurfaceFlinger::onLayerDestroyed(Layer* layer) {
     mNumLayers--;
+    // Clones share the name of the layer they were cloned from.
+    if (!layer->isClone()) {
+        mLayerNameRegistry.release(layer->getName());
+    }
     removeFromOffscreenLayers(layer);
+    if (mScheduler) {
+        mScheduler->deregisterLayer(layer);
+    }
 }
 
 // WARNING: ONLY CALL THIS FROM LAYER DTOR
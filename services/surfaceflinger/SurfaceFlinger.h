@@ -34,6 +34,7 @@
 #include <gui/LayerState.h>
 #include <gui/OccupancyTracker.h>
 #include <input/ISetInputWindowsListener.h>
+#include <input/InputWindowsUpdate.h>
 #include <layerproto/LayerProtoHeader.h>
 #include <math/mat4.h>
 #include <renderengine/LayerSettings.h>
@@ -55,6 +56,7 @@
 #include "DisplayHardware/PowerAdvisor.h"
 #include "Effects/Daltonizer.h"
 #include "FrameTracker.h"
+#include "LayerNameRegistry.h"
 #include "LayerVector.h"
 #include "Scheduler/RefreshRateConfigs.h"
 #include "Scheduler/RefreshRateStats.h"
@@ -64,6 +66,7 @@
 #include "SurfaceTracing.h"
 #include "TracedOrdinal.h"
 #include "TransactionCompletedThread.h"
+#include "WorkerPool.h"
 
 #include <atomic>
 #include <cstdint>
@@ -162,6 +165,12 @@ public:
         nsecs_t twoBufferTime = 0;
         nsecs_t doubleBufferedTime = 0;
         nsecs_t tripleBufferedTime = 0;
+
+        // Time spent at each queue depth, and wait times at either end of the
+        // queue, summed over all segments.
+        std::vector<nsecs_t> occupancyTimes;
+        OccupancyTracker::WaitHistogram dequeueWait;
+        OccupancyTracker::WaitHistogram acquireWait;
     };
     mutable Mutex mBufferingStatsMutex;
     std::unordered_map<std::string, BufferingStats> mBufferingStats;
@@ -336,6 +345,18 @@ public:
     // debug.sf.disable_client_composition_cache
     bool mDisableClientCompositionCache = false;
 
+    // If non-zero, layers that stayed unchanged for this many frames are flattened into a single
+    // buffer before being sent to HWC. This can be set by debug.sf.flatten_static_layers_frames
+    uint32_t mFlattenStaticLayersFrameThreshold = 0;
+
+    // If set, displays reuse the visibility of layers unaffected by a geometry change. This can
+    // be set by debug.sf.incremental_visibility
+    bool mCacheLayerVisibility = false;
+
+    // If set, buffers SurfaceFlinger allocates for screenshots and region sampling are recycled
+    // through the GraphicBufferAllocator pool. This can be set by debug.sf.buffer_pool_kb
+    bool mBufferPoolEnabled = false;
+
 private:
     friend class BufferLayer;
     friend class BufferQueueLayer;
@@ -433,6 +454,12 @@ private:
                            ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
                            uint32_t reqWidth, uint32_t reqHeight, bool useIdentityTransform,
                            ui::Rotation rotation, bool captureSecureLayers) override;
+    status_t captureScreenAsync(const sp<IBinder>& displayToken, sp<GraphicBuffer>* outBuffer,
+                                sp<Fence>* outReadyFence, bool& outCapturedSecureLayers,
+                                ui::Dataspace reqDataspace, ui::PixelFormat reqPixelFormat,
+                                const Rect& sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
+                                bool useIdentityTransform, ui::Rotation rotation,
+                                bool captureSecureLayers) override;
     status_t captureScreen(uint64_t displayOrLayerStack, ui::Dataspace* outDataspace,
                            sp<GraphicBuffer>* outBuffer) override;
     status_t captureLayers(
@@ -607,6 +634,9 @@ private:
     void commitInputWindowCommands() REQUIRES(mStateLock);
     void setInputWindowsFinished();
     void updateCursorAsync();
+    // Moves the cursor layers of position-only layer states ahead of the transaction, which may
+    // wait for mStateLock and is only committed on the next invalidate.
+    void updateCursorPositions(const Vector<ComposerState>& states) EXCLUDES(mCursorLock);
     void initScheduler(DisplayId primaryDisplayId);
 
     /* handlePageFlip - latch a new buffer if available and compute the dirty
@@ -643,8 +673,22 @@ private:
     uint32_t setTransactionFlags(uint32_t flags, Scheduler::TransactionStart transactionStart);
     void commitTransaction() REQUIRES(mStateLock);
     void commitOffscreenLayers();
+    // Flattens mDrawingState into mDrawingLayersInZOrder. Must be called whenever the drawing
+    // hierarchy or z-order changes, which only happens when a transaction is committed.
+    void rebuildDrawingLayersInZOrder();
+    // Whether a transaction is held back by a desiredPresentTime that has not yet come.
+    bool transactionIsDeferred(int64_t desiredPresentTime) const;
+    // Wakes up for the frame that may present a transaction deferred until desiredPresentTime,
+    // instead of rechecking the transaction queues on every frame until then.
+    void scheduleDeferredTransactionFlush(int64_t desiredPresentTime) REQUIRES(mStateLock);
     bool transactionIsReadyToBeApplied(int64_t desiredPresentTime,
                                        const Vector<ComposerState>& states);
+    // Same as above, but checks the acquire fences from *firstUnsignaledState on, and on return
+    // sets it to the first state whose fence has not signaled. Fences never unsignal, so a
+    // queued transaction checks each fence only until it is found signaled.
+    bool transactionIsReadyToBeApplied(int64_t desiredPresentTime,
+                                       const Vector<ComposerState>& states,
+                                       size_t* firstUnsignaledState);
     uint32_t setDisplayStateLocked(const DisplayState& s) REQUIRES(mStateLock);
     uint32_t addInputWindowCommands(const InputWindowCommands& inputWindowCommands)
             REQUIRES(mStateLock);
@@ -722,12 +766,24 @@ private:
     void renderScreenImplLocked(const RenderArea& renderArea, TraverseLayersFunction traverseLayers,
                                 ANativeWindowBuffer* buffer, bool useIdentityTransform,
                                 bool regionSampling, int* outSyncFd);
+    // Captures a display into *outBuffer. If outReadyFence is not null, the capture does not
+    // wait for the GPU and returns a fence that signals once the buffer is ready instead.
+    status_t captureScreenImpl(const sp<IBinder>& displayToken, sp<GraphicBuffer>* outBuffer,
+                               sp<Fence>* outReadyFence, bool& outCapturedSecureLayers,
+                               ui::Dataspace reqDataspace, ui::PixelFormat reqPixelFormat,
+                               const Rect& sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
+                               bool useIdentityTransform, ui::Rotation rotation,
+                               bool captureSecureLayers);
+    // Renders into *outBuffer if it already matches the requested size and format, or into a new
+    // buffer otherwise.
     status_t captureScreenCommon(RenderArea& renderArea, TraverseLayersFunction traverseLayers,
                                  sp<GraphicBuffer>* outBuffer, const ui::PixelFormat reqPixelFormat,
-                                 bool useIdentityTransform, bool& outCapturedSecureLayers);
+                                 bool useIdentityTransform, bool& outCapturedSecureLayers,
+                                 sp<Fence>* outReadyFence = nullptr);
     status_t captureScreenCommon(RenderArea& renderArea, TraverseLayersFunction traverseLayers,
                                  const sp<GraphicBuffer>& buffer, bool useIdentityTransform,
-                                 bool regionSampling, bool& outCapturedSecureLayers);
+                                 bool regionSampling, bool& outCapturedSecureLayers,
+                                 sp<Fence>* outReadyFence = nullptr);
     sp<DisplayDevice> getDisplayByIdOrLayerStack(uint64_t displayOrLayerStack) REQUIRES(mStateLock);
     sp<DisplayDevice> getDisplayByLayerStack(uint64_t layerStack) REQUIRES(mStateLock);
     status_t captureScreenImplLocked(const RenderArea& renderArea,
@@ -946,7 +1002,8 @@ private:
 
     void appendSfConfigString(std::string& result) const;
     void listLayersLocked(std::string& result) const;
-    void dumpStatsLocked(const DumpArgs& args, std::string& result) const REQUIRES(mStateLock);
+    // Only holds mStateLock to find the layers, and formats their stats without it.
+    void dumpStats(const DumpArgs& args, std::string& result) const EXCLUDES(mStateLock);
     void clearStatsLocked(const DumpArgs& args, std::string& result);
     void dumpTimeStats(const DumpArgs& args, bool asProto, std::string& result) const;
     void logFrameStats();
@@ -959,6 +1016,7 @@ private:
     void recordBufferingStats(const std::string& layerName,
                               std::vector<OccupancyTracker::Segment>&& history);
     void dumpBufferingStats(std::string& result) const;
+    void dumpTransactionQueues(std::string& result) const REQUIRES(mStateLock);
     void dumpDisplayIdentificationData(std::string& result) const REQUIRES(mStateLock);
     void dumpRawDisplayIdentificationData(const DumpArgs&, std::string& result) const;
     void dumpWideColorInfo(std::string& result) const REQUIRES(mStateLock);
@@ -976,6 +1034,8 @@ private:
     }
 
     status_t doDump(int fd, const DumpArgs& args, bool asProto);
+    // Returns the full dump if one was produced less than kDumpCacheDuration ago.
+    std::optional<std::string> getCachedDump(bool asProto) EXCLUDES(mDumpCacheMutex);
 
     status_t dumpCritical(int fd, const DumpArgs&, bool asProto);
 
@@ -1042,6 +1102,16 @@ private:
     bool mGeometryInvalid = false;
     bool mAnimCompositionPending = false;
     std::vector<sp<Layer>> mLayersWithQueuedFrames;
+    // Checks the acquire fences of mLayersWithQueuedFrames in parallel. Created the first time
+    // enough layers have queued frames.
+    std::unique_ptr<WorkerPool> mLatchWorkers;
+    static constexpr size_t kLatchWorkerCount = 2;
+    static constexpr size_t kMinLayersForLatchWorkers = 4;
+    // Prepares the outputs in parallel when their geometry changes, if set by
+    // debug.sf.parallel_output_prepare. Created on the first frame with more than one output.
+    bool mPrepareOutputsInParallel = false;
+    std::unique_ptr<WorkerPool> mOutputWorkers;
+    static constexpr size_t kOutputWorkerCount = 2;
     // Tracks layers that need to update a display's dirty region.
     std::vector<sp<Layer>> mLayersPendingRefresh;
     std::array<sp<Fence>, 2> mPreviousPresentFences = {Fence::NO_FENCE, Fence::NO_FENCE};
@@ -1055,6 +1125,11 @@ private:
     // used in a previous composition. This can happed if the client composition requests
     // did not change.
     bool mReusedClientComposition = false;
+    // Number of layers composed via the GPU in the previous frame, how long that frame took to
+    // compose, and whether it missed its present time. Used for power hints.
+    size_t mClientCompositionLayerCount = 0;
+    nsecs_t mPreviousFrameDuration = 0;
+    bool mPreviousFrameMissed = false;
 
     enum class BootStage {
         BOOTLOADER,
@@ -1076,6 +1151,12 @@ private:
 
     std::unordered_map<BBinder*, wp<Layer>> mLayersByLocalBinderToken GUARDED_BY(mStateLock);
 
+    // The layers that can be a cursor, for updateCursorPositions. Set if one of them was moved
+    // since the last refresh.
+    std::mutex mCursorLock;
+    std::unordered_map<BBinder*, wp<Layer>> mCursorLayersByLocalBinderToken GUARDED_BY(mCursorLock);
+    std::atomic<bool> mCursorPositionsChanged = false;
+
     // don't use a lock for these, we don't care
     int mDebugRegion = 0;
     bool mDebugDisableHWC = false;
@@ -1154,9 +1235,38 @@ private:
         bool privileged;
         bool hasListenerCallbacks;
         std::vector<ListenerCallbacks> listenerCallbacks;
+        // States before this one have signaled acquire fences.
+        size_t firstUnsignaledState = 0;
     };
     std::unordered_map<sp<IBinder>, std::queue<TransactionState>, IListenerHash> mTransactionQueues;
 
+    // For dumpsys, about the transactions that had to wait in mTransactionQueues.
+    struct TransactionQueueStats {
+        uint64_t queued = 0;
+        uint64_t applied = 0;
+        size_t maxDepth = 0;
+        nsecs_t totalWait = 0;
+        nsecs_t maxWait = 0;
+    };
+    TransactionQueueStats mTransactionQueueStats GUARDED_BY(mStateLock);
+
+    // Whether a transaction queue is waiting on an acquire fence, which has to be polled every
+    // frame. Queues that are only waiting on a desiredPresentTime schedule a wakeup instead.
+    std::atomic<bool> mTransactionQueuesNeedPolling = false;
+    // When the pending wakeup for a deferred transaction fires, or 0 if there is none.
+    nsecs_t mDeferredTransactionWakeupTime GUARDED_BY(mStateLock) = 0;
+
+    // The last full dump, served again to dumpsys callers polling more often than
+    // kDumpCacheDuration, rather than blocking the main thread for each of them.
+    static constexpr nsecs_t kDumpCacheDuration = ms2ns(500);
+    struct CachedDump {
+        nsecs_t time = 0;
+        bool asProto = false;
+        std::string dump;
+    };
+    std::mutex mDumpCacheMutex;
+    CachedDump mCachedDump GUARDED_BY(mDumpCacheMutex);
+
     /* ------------------------------------------------------------------------
      * Feature prototyping
      */
@@ -1166,6 +1276,9 @@ private:
 
     std::atomic<size_t> mNumLayers = 0;
 
+    // Unique names of live layers, released when the layer is destroyed.
+    LayerNameRegistry mLayerNameRegistry;
+
     // Verify that transaction is being called by an approved process:
     // either AID_GRAPHICS or AID_SYSTEM.
     status_t CheckTransactCodeCredentials(uint32_t code);
@@ -1255,6 +1368,9 @@ private:
     const float mEmulatedDisplayDensity;
 
     sp<IInputFlinger> mInputFlinger;
+    // Turns the input window list into the changes since the last one sent to mInputFlinger.
+    // Should only be accessed by the main thread.
+    InputWindowsUpdateWriter mInputWindowsUpdateWriter;
     InputWindowCommands mPendingInputWindowCommands GUARDED_BY(mStateLock);
     // Should only be accessed by the main thread.
     InputWindowCommands mInputWindowCommands;
@@ -1288,6 +1404,11 @@ private:
     // be any issues with a raw pointer referencing an invalid object.
     std::unordered_set<Layer*> mOffscreenLayers;
 
+    // mDrawingState flattened in z-order, including relative layers, so that the per-frame passes
+    // do not each walk the tree. Only written and read on the main thread. The layers are kept
+    // alive by mDrawingState, which only changes in commitTransactionLocked, where this is rebuilt.
+    std::vector<Layer*> mDrawingLayersInZOrder;
+
     // Fields tracking the current jank event: when it started and how many
     // janky frames there are.
     nsecs_t mMissedFrameJankStart = 0;
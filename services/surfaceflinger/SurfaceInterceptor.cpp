@@ -25,7 +25,9 @@
 #include "SurfaceFlinger.h"
 #include "SurfaceInterceptor.h"
 
+#include <algorithm>
 #include <fstream>
+#include <thread>
 
 #include <android-base/file.h>
 #include <log/log.h>
@@ -40,6 +42,14 @@ SurfaceInterceptor::~SurfaceInterceptor() = default;
 
 namespace impl {
 
+namespace {
+
+// Unique across interceptors, so that a thread never mistakes the buffer it kept for the current
+// one.
+std::atomic<uint64_t> sNextGeneration{1};
+
+} // namespace
+
 SurfaceInterceptor::SurfaceInterceptor(SurfaceFlinger* flinger)
     :   mFlinger(flinger)
 {
@@ -52,6 +62,11 @@ void SurfaceInterceptor::enable(const SortedVector<sp<Layer>>& layers,
         return;
     }
     ATRACE_CALL();
+    {
+        std::lock_guard<std::mutex> buffersGuard(mRecordBuffersMutex);
+        mRecordBuffers.clear();
+        mGeneration = sNextGeneration++;
+    }
     mEnabled = true;
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     saveExistingDisplaysLocked(displays);
@@ -65,16 +80,102 @@ void SurfaceInterceptor::disable() {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     mEnabled = false;
+    // A writer that saw mEnabled set is at most one record away from done.
+    while (mActiveWriters != 0) {
+        std::this_thread::yield();
+    }
+    addRecordsLocked();
     status_t err(writeProtoFileLocked());
     ALOGE_IF(err == PERMISSION_DENIED, "Could not save the proto file! Permission denied");
     ALOGE_IF(err == NOT_ENOUGH_DATA, "Could not save the proto file! There are missing fields");
     mTrace.Clear();
+    std::lock_guard<std::mutex> buffersGuard(mRecordBuffersMutex);
+    mRecordBuffers.clear();
 }
 
 bool SurfaceInterceptor::isEnabled() {
     return mEnabled;
 }
 
+void SurfaceInterceptor::addRecord(const Record& record) {
+    // Both are sequentially consistent, so that disable() either sees this writer or this
+    // writer sees mEnabled cleared.
+    mActiveWriters++;
+    if (mEnabled) {
+        RecordBuffer* buffer = getRecordBuffer();
+        const size_t chunk = buffer->count / RecordChunk::kCapacity;
+        if (chunk == buffer->chunks.size()) {
+            buffer->chunks.push_back(std::make_unique<RecordChunk>());
+        }
+        buffer->chunks[chunk]->records[buffer->count % RecordChunk::kCapacity] = record;
+        buffer->count++;
+    }
+    mActiveWriters--;
+}
+
+SurfaceInterceptor::RecordBuffer* SurfaceInterceptor::getRecordBuffer() {
+    thread_local uint64_t tGeneration = 0;
+    thread_local RecordBuffer* tBuffer = nullptr;
+
+    const uint64_t generation = mGeneration;
+    if (tGeneration != generation) {
+        auto buffer = std::make_unique<RecordBuffer>();
+        buffer->chunks.push_back(std::make_unique<RecordChunk>());
+        tGeneration = generation;
+        tBuffer = buffer.get();
+
+        std::lock_guard<std::mutex> buffersGuard(mRecordBuffersMutex);
+        mRecordBuffers.push_back(std::move(buffer));
+    }
+    return tBuffer;
+}
+
+void SurfaceInterceptor::addRecordsLocked() {
+    ATRACE_CALL();
+    std::vector<Record> records;
+    {
+        std::lock_guard<std::mutex> buffersGuard(mRecordBuffersMutex);
+        for (const auto& buffer : mRecordBuffers) {
+            for (size_t i = 0; i < buffer->count; i++) {
+                records.push_back(buffer->chunks[i / RecordChunk::kCapacity]
+                                          ->records[i % RecordChunk::kCapacity]);
+            }
+        }
+    }
+    if (records.empty()) {
+        return;
+    }
+    std::stable_sort(records.begin(), records.end(), [](const Record& lhs, const Record& rhs) {
+        return lhs.timeStamp < rhs.timeStamp;
+    });
+
+    // The increments already in the trace are in time order, so the two are merged.
+    Trace merged;
+    auto* increments = mTrace.mutable_increment();
+    int next = 0;
+    for (const Record& record : records) {
+        while (next < increments->size() &&
+               increments->Get(next).time_stamp() <= record.timeStamp) {
+            merged.add_increment()->Swap(increments->Mutable(next++));
+        }
+        Increment* increment(merged.add_increment());
+        increment->set_time_stamp(record.timeStamp);
+        switch (record.type) {
+            case Record::Type::BufferUpdate:
+                addBufferUpdateLocked(increment, record.layerId, record.width, record.height,
+                                      record.frameNumber);
+                break;
+            case Record::Type::VSync:
+                addVSyncUpdateLocked(increment, record.vsyncTime);
+                break;
+        }
+    }
+    while (next < increments->size()) {
+        merged.add_increment()->Swap(increments->Mutable(next++));
+    }
+    mTrace.Swap(&merged);
+}
+
 void SurfaceInterceptor::saveExistingDisplaysLocked(
         const DefaultKeyedVector< wp<IBinder>, DisplayDeviceState>& displays)
 {
@@ -657,17 +758,15 @@ void SurfaceInterceptor::saveBufferUpdate(int32_t layerId, uint32_t width,
     if (!mEnabled) {
         return;
     }
-    ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addBufferUpdateLocked(createTraceIncrementLocked(), layerId, width, height, frameNumber);
+    addRecord({Record::Type::BufferUpdate, layerId, width, height, frameNumber,
+               elapsedRealtimeNano(), 0});
 }
 
 void SurfaceInterceptor::saveVSyncEvent(nsecs_t timestamp) {
     if (!mEnabled) {
         return;
     }
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addVSyncUpdateLocked(createTraceIncrementLocked(), timestamp);
+    addRecord({Record::Type::VSync, -1, 0, 0, 0, elapsedRealtimeNano(), timestamp});
 }
 
 void SurfaceInterceptor::saveDisplayCreation(const DisplayDeviceState& info) {
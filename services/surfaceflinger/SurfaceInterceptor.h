@@ -19,7 +19,10 @@
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include <gui/LayerState.h>
 
@@ -112,6 +115,36 @@ public:
     void saveVSyncEvent(nsecs_t timestamp) override;
 
 private:
+    // Buffer updates and vsync events come every frame, so they are recorded in this form into a
+    // buffer per thread, without taking mTraceMutex, and only turned into increments on save.
+    struct Record {
+        enum class Type : uint32_t { BufferUpdate, VSync };
+
+        Type type;
+        int32_t layerId;
+        uint32_t width;
+        uint32_t height;
+        uint64_t frameNumber;
+        nsecs_t timeStamp;
+        nsecs_t vsyncTime;
+    };
+
+    struct RecordChunk {
+        static constexpr size_t kCapacity = 2048;
+        Record records[kCapacity];
+    };
+
+    // Written by a single thread while enabled, read on save once all writers are done.
+    struct RecordBuffer {
+        std::vector<std::unique_ptr<RecordChunk>> chunks;
+        size_t count = 0;
+    };
+
+    void addRecord(const Record& record);
+    RecordBuffer* getRecordBuffer();
+    // Turns the records into increments, in time order with the others.
+    void addRecordsLocked();
+
     // The creation increments of Surfaces and Displays do not contain enough information to capture
     // the initial state of each object, so a transaction with all of the missing properties is
     // performed at the initial snapshot for each display and surface.
@@ -183,11 +216,18 @@ private:
             const DisplayState& state, int32_t sequenceId);
 
 
-    bool mEnabled {false};
+    std::atomic<bool> mEnabled {false};
     std::string mOutputFileName {DEFAULT_FILENAME};
     std::mutex mTraceMutex {};
     Trace mTrace {};
     SurfaceFlinger* const mFlinger;
+
+    // Threads recording into a RecordBuffer. disable() waits for them before saving.
+    std::atomic<int32_t> mActiveWriters {0};
+    // Changes on each enable(), so that threads drop the buffers of the previous trace.
+    std::atomic<uint64_t> mGeneration {0};
+    std::mutex mRecordBuffersMutex {};
+    std::vector<std::unique_ptr<RecordBuffer>> mRecordBuffers {};
 };
 
 } // namespace impl
@@ -30,12 +30,68 @@
 #include <utils/SystemClock.h>
 #include <utils/Trace.h>
 
+#include <unordered_set>
+
 namespace android {
 
+namespace {
+
+// Field numbers of the messages written by hand in LayersTraceBuffer::flush().
+constexpr uint32_t kFileEntryField = 2;   // LayersTraceFileProto.entry
+constexpr uint32_t kEntryLayersField = 3; // LayersTraceProto.layers
+constexpr uint32_t kLayersLayerField = 1; // LayersProto.layers
+
+size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+void appendVarint(std::string* output, uint64_t value) {
+    while (value >= 0x80) {
+        output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    output->push_back(static_cast<char>(value));
+}
+
+// The size of a length delimited field holding the given number of bytes.
+size_t fieldSize(uint32_t field, size_t length) {
+    return varintSize(field << 3) + varintSize(length) + length;
+}
+
+void appendFieldHeader(std::string* output, uint32_t field, size_t length) {
+    constexpr uint32_t kLengthDelimited = 2;
+    appendVarint(output, (field << 3) | kLengthDelimited);
+    appendVarint(output, length);
+}
+
+// Returns the bytes of the layers in entry that it shares with previous.
+size_t sharedBytes(const std::vector<std::shared_ptr<const std::string>>& previous,
+                   const std::vector<std::shared_ptr<const std::string>>& entry) {
+    std::unordered_set<const std::string*> previousLayers;
+    for (const auto& layer : previous) {
+        previousLayers.insert(layer.get());
+    }
+    size_t bytes = 0;
+    for (const auto& layer : entry) {
+        if (previousLayers.count(layer.get()) != 0) {
+            bytes += layer->size();
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
 SurfaceTracing::SurfaceTracing(SurfaceFlinger& flinger)
       : mFlinger(flinger), mSfLock(flinger.mTracingLock) {}
 
 void SurfaceTracing::mainLoop() {
+    mPreviousLayers.clear();
     bool enabled = addFirstEntry();
     while (enabled) {
         LayersTraceProto entry = traceWhenNotified();
@@ -63,9 +119,32 @@ LayersTraceProto SurfaceTracing::traceWhenNotified() {
     return entry;
 }
 
+SurfaceTracing::SerializedEntry SurfaceTracing::serialize(LayersTraceProto& entry) {
+    ATRACE_CALL();
+    SerializedEntry serialized;
+    std::unordered_map<int32_t, std::shared_ptr<const std::string>> layers;
+    serialized.layers.reserve(entry.layers().layers_size());
+    for (const LayerProto& layerProto : entry.layers().layers()) {
+        std::shared_ptr<const std::string> layer =
+                std::make_shared<const std::string>(layerProto.SerializeAsString());
+        auto previous = mPreviousLayers.find(layerProto.id());
+        if (previous != mPreviousLayers.end() && *previous->second == *layer) {
+            layer = previous->second;
+        }
+        layers[layerProto.id()] = layer;
+        serialized.layers.push_back(std::move(layer));
+    }
+    mPreviousLayers = std::move(layers);
+
+    entry.clear_layers();
+    entry.SerializeToString(&serialized.header);
+    return serialized;
+}
+
 bool SurfaceTracing::addTraceToBuffer(LayersTraceProto& entry) {
+    SerializedEntry serialized = serialize(entry);
     std::scoped_lock lock(mTraceLock);
-    mBuffer.emplace(std::move(entry));
+    mBuffer.emplace(std::move(serialized));
     if (mWriteToFile) {
         writeProtoFileLocked();
         mWriteToFile = false;
@@ -95,33 +174,67 @@ void SurfaceTracing::writeToFileAsync() {
 
 void SurfaceTracing::LayersTraceBuffer::reset(size_t newSize) {
     // use the swap trick to make sure memory is released
-    std::queue<LayersTraceProto>().swap(mStorage);
+    std::deque<SerializedEntry>().swap(mStorage);
     mSizeInBytes = newSize;
     mUsedInBytes = 0U;
 }
 
-void SurfaceTracing::LayersTraceBuffer::emplace(LayersTraceProto&& proto) {
-    auto protoSize = proto.ByteSize();
-    while (mUsedInBytes + protoSize > mSizeInBytes) {
+void SurfaceTracing::LayersTraceBuffer::emplace(SerializedEntry&& entry) {
+    size_t fullSize = entry.header.size();
+    for (const auto& layer : entry.layers) {
+        fullSize += layer->size();
+    }
+    entry.sizeInBytes = fullSize;
+    if (!mStorage.empty()) {
+        entry.sizeInBytes -= sharedBytes(mStorage.back().layers, entry.layers);
+    }
+
+    while (mUsedInBytes + entry.sizeInBytes > mSizeInBytes) {
         if (mStorage.empty()) {
             return;
         }
-        mUsedInBytes -= mStorage.front().ByteSize();
-        mStorage.pop();
+        pop();
+        if (mStorage.empty()) {
+            // The entry it shared layers with was just dropped.
+            entry.sizeInBytes = fullSize;
+        }
     }
-    mUsedInBytes += protoSize;
-    mStorage.emplace();
-    mStorage.back().Swap(&proto);
+    mUsedInBytes += entry.sizeInBytes;
+    mStorage.push_back(std::move(entry));
 }
 
-void SurfaceTracing::LayersTraceBuffer::flush(LayersTraceFileProto* fileProto) {
-    fileProto->mutable_entry()->Reserve(mStorage.size());
+void SurfaceTracing::LayersTraceBuffer::pop() {
+    SerializedEntry& front = mStorage.front();
+    mUsedInBytes -= front.sizeInBytes;
+    if (mStorage.size() > 1) {
+        // The layers the next entry shared with this one are now accounted to it.
+        SerializedEntry& next = mStorage[1];
+        const size_t shared = sharedBytes(front.layers, next.layers);
+        next.sizeInBytes += shared;
+        mUsedInBytes += shared;
+    }
+    mStorage.pop_front();
+}
 
+void SurfaceTracing::LayersTraceBuffer::flush(std::string* output) {
     while (!mStorage.empty()) {
-        auto entry = fileProto->add_entry();
-        entry->Swap(&mStorage.front());
-        mStorage.pop();
+        const SerializedEntry& entry = mStorage.front();
+        size_t layersSize = 0;
+        for (const auto& layer : entry.layers) {
+            layersSize += fieldSize(kLayersLayerField, layer->size());
+        }
+        const size_t entrySize = entry.header.size() + fieldSize(kEntryLayersField, layersSize);
+
+        appendFieldHeader(output, kFileEntryField, entrySize);
+        output->append(entry.header);
+        appendFieldHeader(output, kEntryLayersField, layersSize);
+        for (const auto& layer : entry.layers) {
+            appendFieldHeader(output, kLayersLayerField, layer->size());
+            output->append(*layer);
+        }
+        mStorage.pop_front();
     }
+    mUsedInBytes = 0U;
 }
 
 bool SurfaceTracing::enable() {
@@ -210,13 +323,13 @@ void SurfaceTracing::writeProtoFileLocked() {
 
     fileProto.set_magic_number(uint64_t(LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_H) << 32 |
                                LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_L);
-    mBuffer.flush(&fileProto);
-    mBuffer.reset(mBufferSize);
-
     if (!fileProto.SerializeToString(&output)) {
         ALOGE("Could not save the proto file! Permission denied");
         mLastErr = PERMISSION_DENIED;
     }
+    // The entries are already serialized, and are appended to the magic number as is.
+    mBuffer.flush(&output);
+    mBuffer.reset(mBufferSize);
 
     // -rw-r--r--
     const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
@@ -22,10 +22,13 @@
 #include <utils/StrongPointer.h>
 
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 using namespace android::surfaceflinger;
 
@@ -70,6 +73,17 @@ private:
     static constexpr auto kDefaultBufferCapInByte = 5_MB;
     static constexpr auto kDefaultFileName = "/data/misc/wmtrace/layers_trace.pb";
 
+    // A trace entry in its wire format. Each layer is serialized on its own, and a layer that
+    // did not change since the previous entry shares the bytes of that entry.
+    struct SerializedEntry {
+        // The LayersTraceProto without its layers.
+        std::string header;
+        std::vector<std::shared_ptr<const std::string>> layers;
+        // The bytes this entry adds to the buffer: the header and the layers not shared with the
+        // entry before it.
+        size_t sizeInBytes = 0;
+    };
+
     class LayersTraceBuffer { // ring buffer
     public:
         size_t size() const { return mSizeInBytes; }
@@ -78,13 +92,16 @@ private:
 
         void setSize(size_t newSize) { mSizeInBytes = newSize; }
         void reset(size_t newSize);
-        void emplace(LayersTraceProto&& proto);
-        void flush(LayersTraceFileProto* fileProto);
+        void emplace(SerializedEntry&& entry);
+        // Appends the entries to output as the entry field of a LayersTraceFileProto.
+        void flush(std::string* output);
 
     private:
+        void pop();
+
         size_t mUsedInBytes = 0U;
         size_t mSizeInBytes = 0U;
-        std::queue<LayersTraceProto> mStorage;
+        std::deque<SerializedEntry> mStorage;
     };
 
     void mainLoop();
@@ -92,6 +109,10 @@ private:
     LayersTraceProto traceWhenNotified();
     LayersTraceProto traceLayersLocked(const char* where) REQUIRES(mSfLock);
 
+    // Serializes entry, reusing the layers of the previous entry that did not change. Only
+    // called by the tracing thread.
+    SerializedEntry serialize(LayersTraceProto& entry);
+
     // Returns true if trace is enabled.
     bool addTraceToBuffer(LayersTraceProto& entry);
     void writeProtoFileLocked() REQUIRES(mTraceLock);
@@ -100,6 +121,8 @@ private:
     status_t mLastErr = NO_ERROR;
     std::thread mThread;
     std::condition_variable mCanStartTrace;
+    // The layers of the last entry serialized, by id. Only used by the tracing thread.
+    std::unordered_map<int32_t, std::shared_ptr<const std::string>> mPreviousLayers;
 
     std::mutex& mSfLock;
     uint32_t mTraceFlags GUARDED_BY(mSfLock) = TRACE_CRITICAL | TRACE_INPUT;
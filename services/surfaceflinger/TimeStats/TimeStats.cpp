@@ -62,10 +62,10 @@ const std::array<std::string, 6> kHistogramNames = {
         "latch2present",   "desired2present", "post2acquire",
 };
 
-std::string histogramToProtoByteString(const std::unordered_map<int32_t, int32_t>& histogram,
+std::string histogramToProtoByteString(const TimeStatsHelper::Histogram& histogram,
                                        size_t maxPulledHistogramBuckets) {
-    auto buckets = std::vector<std::pair<int32_t, int32_t>>(histogram.begin(), histogram.end());
-    std::sort(buckets.begin(), buckets.end(),
+    auto buckets = histogram.buckets();
+    std::stable_sort(buckets.begin(), buckets.end(),
               [](std::pair<int32_t, int32_t>& left, std::pair<int32_t, int32_t>& right) {
                   return left.second > right.second;
               });
@@ -107,11 +107,11 @@ AStatsManager_PullAtomCallbackReturn TimeStats::populateGlobalAtom(AStatsEventLi
     mStatsDelegate->statsEventWriteInt64(event, mTimeStats.presentToPresent.totalTime());
     mStatsDelegate->statsEventWriteInt32(event, mTimeStats.displayEventConnectionsCount);
     std::string frameDurationBytes =
-            histogramToProtoByteString(mTimeStats.frameDuration.hist, mMaxPulledHistogramBuckets);
+            histogramToProtoByteString(mTimeStats.frameDuration, mMaxPulledHistogramBuckets);
     mStatsDelegate->statsEventWriteByteArray(event, (const uint8_t*)frameDurationBytes.c_str(),
                                              frameDurationBytes.size());
     std::string renderEngineTimingBytes =
-            histogramToProtoByteString(mTimeStats.renderEngineTiming.hist,
+            histogramToProtoByteString(mTimeStats.renderEngineTiming,
                                        mMaxPulledHistogramBuckets);
     mStatsDelegate->statsEventWriteByteArray(event, (const uint8_t*)renderEngineTimingBytes.c_str(),
                                              renderEngineTimingBytes.size());
@@ -122,7 +122,8 @@ AStatsManager_PullAtomCallbackReturn TimeStats::populateGlobalAtom(AStatsEventLi
 }
 
 AStatsManager_PullAtomCallbackReturn TimeStats::populateLayerAtom(AStatsEventList* data) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    flushAllAvailableRecordsToStats();
+    std::unique_lock<std::mutex> lock(mMutex);
 
     std::vector<TimeStatsHelper::TimeStatsLayer const*> dumpStats;
     for (const auto& ele : mTimeStats.stats) {
@@ -151,7 +152,7 @@ AStatsManager_PullAtomCallbackReturn TimeStats::populateLayerAtom(AStatsEventLis
             if (histogram == layer->deltas.cend()) {
                 mStatsDelegate->statsEventWriteByteArray(event, nullptr, 0);
             } else {
-                std::string bytes = histogramToProtoByteString(histogram->second.hist,
+                std::string bytes = histogramToProtoByteString(histogram->second,
                                                                mMaxPulledHistogramBuckets);
                 mStatsDelegate->statsEventWriteByteArray(event, (const uint8_t*)bytes.c_str(),
                                                          bytes.size());
@@ -164,6 +165,8 @@ AStatsManager_PullAtomCallbackReturn TimeStats::populateLayerAtom(AStatsEventLis
         mStatsDelegate->statsEventBuild(event);
     }
     clearLayersLocked();
+    lock.unlock();
+    clearLayerRecords();
 
     return AStatsManager_PULL_SUCCESS;
 }
@@ -239,7 +242,7 @@ std::string TimeStats::miniDump() {
     std::string result = "TimeStats miniDump:\n";
     std::lock_guard<std::mutex> lock(mMutex);
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
-                                 mTimeStatsTracker.size());
+                                 mNumLayerRecords.load());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
                                  mTimeStats.stats.size());
     return result;
@@ -309,6 +312,15 @@ void TimeStats::recordDisplayEventConnectionCount(int32_t count) {
             std::max(mTimeStats.displayEventConnectionsCount, count);
 }
 
+void TimeStats::recordParallelComposition(nsecs_t serialDuration, nsecs_t parallelDuration) {
+    if (!mEnabled.load()) return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTimeStats.parallelCompositionFrames++;
+    mTimeStats.parallelCompositionTimeSaved +=
+            std::max(serialDuration - parallelDuration, nsecs_t(0));
+}
+
 static int32_t msBetween(nsecs_t start, nsecs_t end) {
     int64_t delta = std::chrono::duration_cast<std::chrono::milliseconds>(
                             std::chrono::nanoseconds(end - start))
@@ -349,19 +361,21 @@ void TimeStats::recordRenderEngineDuration(nsecs_t startTime,
     mGlobalRecord.renderEngineDurations.push_back({startTime, endTime});
 }
 
-bool TimeStats::recordReadyLocked(int32_t layerId, TimeRecord* timeRecord) {
+bool TimeStats::recordReady(int32_t layerId, TimeRecord* timeRecord) {
     if (!timeRecord->ready) {
         ALOGV("[%d]-[%" PRIu64 "]-presentFence is still not received", layerId,
               timeRecord->frameTime.frameNumber);
         return false;
     }
 
+    // The signal times were updated by flushAvailableRecordsToStats.
     if (timeRecord->acquireFence != nullptr) {
-        if (timeRecord->acquireFence->getSignalTime() == Fence::SIGNAL_TIME_PENDING) {
+        const nsecs_t acquireTime = timeRecord->acquireFence->getCachedSignalTime();
+        if (acquireTime == Fence::SIGNAL_TIME_PENDING) {
             return false;
         }
-        if (timeRecord->acquireFence->getSignalTime() != Fence::SIGNAL_TIME_INVALID) {
-            timeRecord->frameTime.acquireTime = timeRecord->acquireFence->getSignalTime();
+        if (acquireTime != Fence::SIGNAL_TIME_INVALID) {
+            timeRecord->frameTime.acquireTime = acquireTime;
             timeRecord->acquireFence = nullptr;
         } else {
             ALOGV("[%d]-[%" PRIu64 "]-acquireFence signal time is invalid", layerId,
@@ -370,11 +384,12 @@ bool TimeStats::recordReadyLocked(int32_t layerId, TimeRecord* timeRecord) {
     }
 
     if (timeRecord->presentFence != nullptr) {
-        if (timeRecord->presentFence->getSignalTime() == Fence::SIGNAL_TIME_PENDING) {
+        const nsecs_t presentTime = timeRecord->presentFence->getCachedSignalTime();
+        if (presentTime == Fence::SIGNAL_TIME_PENDING) {
             return false;
         }
-        if (timeRecord->presentFence->getSignalTime() != Fence::SIGNAL_TIME_INVALID) {
-            timeRecord->frameTime.presentTime = timeRecord->presentFence->getSignalTime();
+        if (presentTime != Fence::SIGNAL_TIME_INVALID) {
+            timeRecord->frameTime.presentTime = presentTime;
             timeRecord->presentFence = nullptr;
         } else {
             ALOGV("[%d]-[%" PRIu64 "]-presentFence signal time invalid", layerId,
@@ -385,20 +400,47 @@ bool TimeStats::recordReadyLocked(int32_t layerId, TimeRecord* timeRecord) {
     return true;
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId) {
+void TimeStats::flushAvailableRecordsToStats(int32_t layerId, LayerRecord& layerRecord) {
     ATRACE_CALL();
 
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    // Only taken once there is something to add to the stats.
+    std::unique_lock<std::mutex> lock(mMutex, std::defer_lock);
     TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
     std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
+
+    // Poll the fences of all the pending records at once.
+    std::vector<std::shared_ptr<FenceTime>> fences;
+    fences.reserve(timeRecords.size() * 2);
+    for (const TimeRecord& timeRecord : timeRecords) {
+        if (!timeRecord.ready) {
+            break;
+        }
+        if (timeRecord.acquireFence) {
+            fences.push_back(timeRecord.acquireFence);
+        }
+        if (timeRecord.presentFence) {
+            fences.push_back(timeRecord.presentFence);
+        }
+    }
+    FenceTime::updateSignalTimes(fences);
+
     while (!timeRecords.empty()) {
-        if (!recordReadyLocked(layerId, &timeRecords[0])) break;
+        if (!recordReady(layerId, &timeRecords[0])) break;
         ALOGV("[%d]-[%" PRIu64 "]-presentFenceTime[%" PRId64 "]", layerId,
               timeRecords[0].frameTime.frameNumber, timeRecords[0].frameTime.presentTime);
 
         if (prevTimeRecord.ready) {
+            if (!lock.owns_lock()) {
+                lock.lock();
+            }
             const std::string& layerName = layerRecord.layerName;
             if (!mTimeStats.stats.count(layerName)) {
+                if (mTimeStats.stats.size() >= MAX_NUM_LAYER_STATS) {
+                    prevTimeRecord = timeRecords[0];
+                    timeRecords.pop_front();
+                    layerRecord.waitData--;
+                    continue;
+                }
                 mTimeStats.stats[layerName].layerName = layerName;
             }
             TimeStatsHelper::TimeStatsLayer& timeStatsLayer = mTimeStats.stats[layerName];
@@ -453,6 +495,15 @@ void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId) {
     }
 }
 
+void TimeStats::flushAllAvailableRecordsToStats() {
+    for (LayerShard& shard : mLayerShards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto& [layerId, layerRecord] : shard.records) {
+            flushAvailableRecordsToStats(layerId, layerRecord);
+        }
+    }
+}
+
 static constexpr const char* kPopupWindowPrefix = "PopupWindow";
 static const size_t kMinLenLayerName = std::strlen(kPopupWindowPrefix);
 
@@ -470,20 +521,32 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStats.stats.count(layerName) && mTimeStats.stats.size() >= MAX_NUM_LAYER_STATS) {
-        return;
-    }
-    if (!mTimeStatsTracker.count(layerId) && mTimeStatsTracker.size() < MAX_NUM_LAYER_RECORDS &&
-        layerNameIsValid(layerName)) {
-        mTimeStatsTracker[layerId].layerName = layerName;
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) {
+        if (mNumLayerRecords.load() >= MAX_NUM_LAYER_RECORDS || !layerNameIsValid(layerName)) {
+            return;
+        }
+        {
+            // Only checked for new layers. The stats of a layer that is already tracked are
+            // only dropped when they are flushed into a full pool.
+            std::lock_guard<std::mutex> statsLock(mMutex);
+            if (!mTimeStats.stats.count(layerName) &&
+                mTimeStats.stats.size() >= MAX_NUM_LAYER_STATS) {
+                return;
+            }
+        }
+        it = shard.records.emplace(layerId, LayerRecord()).first;
+        it->second.layerName = layerName;
+        mNumLayerRecords++;
     }
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("[%d]-[%s]-timeRecords is at its maximum size[%zu]. Ignore this when unittesting.",
               layerId, layerRecord.layerName.c_str(), MAX_NUM_TIME_RECORDS);
-        mTimeStatsTracker.erase(layerId);
+        shard.records.erase(it);
+        mNumLayerRecords--;
         return;
     }
     // For most media content, the acquireFence is invalid because the buffer is
@@ -511,9 +574,11 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -530,9 +595,11 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
 
     switch (reason) {
         case LatchSkipReason::LateAcquire:
@@ -547,9 +614,11 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     layerRecord.badDesiredPresentFrames++;
 }
 
@@ -559,9 +628,11 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -577,9 +648,11 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -597,9 +670,11 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -615,9 +690,11 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -628,7 +705,9 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
         layerRecord.waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerId);
+    if (layerRecord.waitData >= FLUSH_THRESHOLD) {
+        flushAvailableRecordsToStats(layerId, layerRecord);
+    }
 }
 
 void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
@@ -639,9 +718,11 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -652,14 +733,22 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
         layerRecord.waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerId);
+    if (layerRecord.waitData >= FLUSH_THRESHOLD) {
+        flushAvailableRecordsToStats(layerId, layerRecord);
+    }
 }
 
 void TimeStats::onDestroy(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStatsTracker.erase(layerId);
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    // Keep the frames that were presented before the layer went away.
+    flushAvailableRecordsToStats(layerId, it->second);
+    shard.records.erase(it);
+    mNumLayerRecords--;
 }
 
 void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
@@ -668,9 +757,13 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(layerId);
+    if (it == shard.records.end()) return;
+    LayerRecord& layerRecord = it->second;
+    // Frames that already made it into the stats are not removed.
+    flushAvailableRecordsToStats(layerId, layerRecord);
     size_t removeAt = 0;
     for (const TimeRecord& record : layerRecord.timeRecords) {
         if (record.frameTime.frameNumber == frameNumber) break;
@@ -839,9 +932,12 @@ void TimeStats::disable() {
 }
 
 void TimeStats::clearAll() {
-    std::lock_guard<std::mutex> lock(mMutex);
-    clearGlobalLocked();
-    clearLayersLocked();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        clearGlobalLocked();
+        clearLayersLocked();
+    }
+    clearLayerRecords();
 }
 
 void TimeStats::clearGlobalLocked() {
@@ -856,10 +952,12 @@ void TimeStats::clearGlobalLocked() {
     mTimeStats.refreshRateSwitches = 0;
     mTimeStats.compositionStrategyChanges = 0;
     mTimeStats.displayEventConnectionsCount = 0;
+    mTimeStats.parallelCompositionFrames = 0;
+    mTimeStats.parallelCompositionTimeSaved = 0;
     mTimeStats.displayOnTime = 0;
-    mTimeStats.presentToPresent.hist.clear();
-    mTimeStats.frameDuration.hist.clear();
-    mTimeStats.renderEngineTiming.hist.clear();
+    mTimeStats.presentToPresent.clear();
+    mTimeStats.frameDuration.clear();
+    mTimeStats.renderEngineTiming.clear();
     mTimeStats.refreshRateStats.clear();
     mPowerTime.prevTime = systemTime();
     mGlobalRecord.prevPresentTime = 0;
@@ -870,11 +968,18 @@ void TimeStats::clearGlobalLocked() {
 void TimeStats::clearLayersLocked() {
     ATRACE_CALL();
 
-    mTimeStatsTracker.clear();
     mTimeStats.stats.clear();
     ALOGD("Cleared layer stats");
 }
 
+void TimeStats::clearLayerRecords() {
+    for (LayerShard& shard : mLayerShards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        mNumLayerRecords -= shard.records.size();
+        shard.records.clear();
+    }
+}
+
 bool TimeStats::isEnabled() {
     return mEnabled.load();
 }
@@ -882,6 +987,7 @@ bool TimeStats::isEnabled() {
 void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::string& result) {
     ATRACE_CALL();
 
+    flushAllAvailableRecordsToStats();
     std::lock_guard<std::mutex> lock(mMutex);
     if (mTimeStats.statsStart == 0) {
         return;
@@ -34,6 +34,8 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <array>
+#include <atomic>
 #include <deque>
 #include <mutex>
 #include <optional>
@@ -69,6 +71,9 @@ public:
     // Records the most up-to-date count of display event connections.
     // The stored count will be the maximum ever recoded.
     virtual void recordDisplayEventConnectionCount(int32_t count) = 0;
+    // Records a frame whose outputs were prepared concurrently. serialDuration is the sum of
+    // the time spent preparing each output, and parallelDuration is the wall time it took.
+    virtual void recordParallelComposition(nsecs_t serialDuration, nsecs_t parallelDuration) = 0;
 
     // Records the start and end times for a frame.
     // The start time is the same as the beginning of a SurfaceFlinger
@@ -154,6 +159,13 @@ class TimeStats : public android::TimeStats {
         std::deque<TimeRecord> timeRecords;
     };
 
+    // The layer records are split by layer id, each part with its own lock, so that threads
+    // recording different layers do not wait on each other or on the global stats.
+    struct LayerShard {
+        std::mutex mutex;
+        std::unordered_map<int32_t, LayerRecord> records;
+    };
+
     struct PowerTime {
         PowerMode powerMode = PowerMode::OFF;
         nsecs_t prevTime = 0;
@@ -235,6 +247,7 @@ public:
     void incrementRefreshRateSwitches() override;
     void incrementCompositionStrategyChanges() override;
     void recordDisplayEventConnectionCount(int32_t count) override;
+    void recordParallelComposition(nsecs_t serialDuration, nsecs_t parallelDuration) override;
 
     void recordFrameDuration(nsecs_t startTime, nsecs_t endTime) override;
     void recordRenderEngineDuration(nsecs_t startTime, nsecs_t endTime) override;
@@ -272,8 +285,16 @@ private:
                                                                  void* cookie);
     AStatsManager_PullAtomCallbackReturn populateGlobalAtom(AStatsEventList* data);
     AStatsManager_PullAtomCallbackReturn populateLayerAtom(AStatsEventList* data);
-    bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(int32_t layerId);
+    bool recordReady(int32_t layerId, TimeRecord* timeRecord);
+    // Moves the records of the layer whose fences have signaled into the stats. Requires the
+    // lock of the layer's shard, and takes mMutex.
+    void flushAvailableRecordsToStats(int32_t layerId, LayerRecord& layerRecord);
+    // Same, for every layer. Called before the stats are read. Requires neither lock.
+    void flushAllAvailableRecordsToStats();
+    LayerShard& getShard(int32_t layerId) {
+        return mLayerShards[static_cast<uint32_t>(layerId) % NUM_LAYER_SHARDS];
+    }
+    void clearLayerRecords();
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
 
@@ -287,13 +308,19 @@ private:
     std::atomic<bool> mEnabled = false;
     std::mutex mMutex;
     TimeStatsHelper::TimeStatsGlobal mTimeStats;
-    // Hashmap for LayerRecord with layerId as the hash key
-    std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
 
+    static const size_t NUM_LAYER_SHARDS = 8;
+    // Records always take the lock of their shard first, and mMutex inside it if needed.
+    std::array<LayerShard, NUM_LAYER_SHARDS> mLayerShards;
+    std::atomic<size_t> mNumLayerRecords = 0;
+
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
     static const size_t MAX_NUM_LAYER_STATS = 200;
+    // Fences are only checked once a layer has this many presented frames waiting, or when the
+    // stats are read.
+    static const int32_t FLUSH_THRESHOLD = 8;
     std::unique_ptr<StatsEventDelegate> mStatsDelegate = std::make_unique<StatsEventDelegate>();
     size_t mMaxPulledLayers = 8;
     size_t mMaxPulledHistogramBuckets = 6;
@@ -20,8 +20,6 @@
 
 #include <array>
 
-#define HISTOGRAM_SIZE 85
-
 using android::base::StringAppendF;
 using android::base::StringPrintf;
 
@@ -30,7 +28,7 @@ namespace surfaceflinger {
 
 // Time buckets for histogram, the calculated time deltas will be lower bounded
 // to the buckets in this array.
-static const std::array<int32_t, HISTOGRAM_SIZE> histogramConfig =
+static const std::array<int32_t, TimeStatsHelper::Histogram::kNumBuckets> histogramConfig =
         {0,   1,   2,   3,   4,   5,   6,   7,   8,   9,   10,  11,  12,  13,  14,  15,  16,
          17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,  28,  29,  30,  31,  32,  33,
          34,  36,  38,  40,  42,  44,  46,  48,  50,  54,  58,  62,  66,  70,  74,  78,  82,
@@ -40,18 +38,28 @@ static const std::array<int32_t, HISTOGRAM_SIZE> histogramConfig =
 void TimeStatsHelper::Histogram::insert(int32_t delta) {
     if (delta < 0) return;
     // std::lower_bound won't work on out of range values
-    if (delta > histogramConfig[HISTOGRAM_SIZE - 1]) {
-        hist[histogramConfig[HISTOGRAM_SIZE - 1]] += delta / histogramConfig[HISTOGRAM_SIZE - 1];
+    if (delta > histogramConfig[kNumBuckets - 1]) {
+        counts[kNumBuckets - 1] += delta / histogramConfig[kNumBuckets - 1];
         return;
     }
     auto iter = std::lower_bound(histogramConfig.begin(), histogramConfig.end(), delta);
-    hist[*iter]++;
+    counts[iter - histogramConfig.begin()]++;
+}
+
+std::vector<std::pair<int32_t, int32_t>> TimeStatsHelper::Histogram::buckets() const {
+    std::vector<std::pair<int32_t, int32_t>> result;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+        if (counts[i] != 0) {
+            result.emplace_back(histogramConfig[i], counts[i]);
+        }
+    }
+    return result;
 }
 
 int64_t TimeStatsHelper::Histogram::totalTime() const {
     int64_t ret = 0;
-    for (const auto& ele : hist) {
-        ret += ele.first * ele.second;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+        ret += static_cast<int64_t>(histogramConfig[i]) * counts[i];
     }
     return ret;
 }
@@ -59,19 +67,17 @@ int64_t TimeStatsHelper::Histogram::totalTime() const {
 float TimeStatsHelper::Histogram::averageTime() const {
     int64_t ret = 0;
     int64_t count = 0;
-    for (const auto& ele : hist) {
-        count += ele.second;
-        ret += ele.first * ele.second;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+        count += counts[i];
+        ret += static_cast<int64_t>(histogramConfig[i]) * counts[i];
     }
     return static_cast<float>(ret) / count;
 }
 
 std::string TimeStatsHelper::Histogram::toString() const {
     std::string result;
-    for (int32_t i = 0; i < HISTOGRAM_SIZE; ++i) {
-        int32_t bucket = histogramConfig[i];
-        int32_t count = (hist.count(bucket) == 0) ? 0 : hist.at(bucket);
-        StringAppendF(&result, "%dms=%d ", bucket, count);
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+        StringAppendF(&result, "%dms=%d ", histogramConfig[i], counts[i]);
     }
     result.back() = '\n';
     return result;
@@ -109,6 +115,9 @@ std::string TimeStatsHelper::TimeStatsGlobal::toString(std::optional<uint32_t> m
     StringAppendF(&result, "clientCompositionReusedFrames = %d\n", clientCompositionReusedFrames);
     StringAppendF(&result, "refreshRateSwitches = %d\n", refreshRateSwitches);
     StringAppendF(&result, "compositionStrategyChanges = %d\n", compositionStrategyChanges);
+    StringAppendF(&result, "parallelCompositionFrames = %d\n", parallelCompositionFrames);
+    StringAppendF(&result, "parallelCompositionTimeSaved = %" PRId64 " ms\n",
+                  ns2ms(parallelCompositionTimeSaved));
     StringAppendF(&result, "displayOnTime = %" PRId64 " ms\n", displayOnTime);
     StringAppendF(&result, "displayConfigStats is as below:\n");
     for (const auto& [fps, duration] : refreshRateStats) {
@@ -145,7 +154,7 @@ SFTimeStatsLayerProto TimeStatsHelper::TimeStatsLayer::toProto() const {
     for (const auto& ele : deltas) {
         SFTimeStatsDeltaProto* deltaProto = layerProto.add_deltas();
         deltaProto->set_delta_name(ele.first);
-        for (const auto& histEle : ele.second.hist) {
+        for (const auto& histEle : ele.second.buckets()) {
             SFTimeStatsHistogramBucketProto* histProto = deltaProto->add_histograms();
             histProto->set_time_millis(histEle.first);
             histProto->set_frame_count(histEle.second);
@@ -170,17 +179,17 @@ SFTimeStatsGlobalProto TimeStatsHelper::TimeStatsGlobal::toProto(
         configProto->set_fps(ele.first);
         configBucketProto->set_duration_millis(ns2ms(ele.second));
     }
-    for (const auto& histEle : presentToPresent.hist) {
+    for (const auto& histEle : presentToPresent.buckets()) {
         SFTimeStatsHistogramBucketProto* histProto = globalProto.add_present_to_present();
         histProto->set_time_millis(histEle.first);
         histProto->set_frame_count(histEle.second);
     }
-    for (const auto& histEle : frameDuration.hist) {
+    for (const auto& histEle : frameDuration.buckets()) {
         SFTimeStatsHistogramBucketProto* histProto = globalProto.add_frame_duration();
         histProto->set_time_millis(histEle.first);
         histProto->set_frame_count(histEle.second);
     }
-    for (const auto& histEle : renderEngineTiming.hist) {
+    for (const auto& histEle : renderEngineTiming.buckets()) {
         SFTimeStatsHistogramBucketProto* histProto = globalProto.add_render_engine_timing();
         histProto->set_time_millis(histEle.first);
         histProto->set_frame_count(histEle.second);
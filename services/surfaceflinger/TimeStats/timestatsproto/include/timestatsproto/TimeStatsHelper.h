@@ -18,9 +18,11 @@
 #include <timestatsproto/TimeStatsProtoHeader.h>
 #include <utils/Timers.h>
 
+#include <array>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace android {
@@ -30,11 +32,15 @@ class TimeStatsHelper {
 public:
     class Histogram {
     public:
-        // Key is the delta time between timestamps
-        // Value is the number of appearances of that delta
-        std::unordered_map<int32_t, int32_t> hist;
+        static constexpr size_t kNumBuckets = 85;
+
+        // Number of appearances of the delta times rounded up to each bucket, in ms order
+        std::array<int32_t, kNumBuckets> counts{};
 
         void insert(int32_t delta);
+        void clear() { counts.fill(0); }
+        // Returns the (bucket in ms, count) pairs of the buckets that are not empty
+        std::vector<std::pair<int32_t, int32_t>> buckets() const;
         int64_t totalTime() const;
         float averageTime() const;
         std::string toString() const;
@@ -65,6 +71,8 @@ public:
         int32_t refreshRateSwitches = 0;
         int32_t compositionStrategyChanges = 0;
         int32_t displayEventConnectionsCount = 0;
+        int32_t parallelCompositionFrames = 0;
+        int64_t parallelCompositionTimeSaved = 0;
         int64_t displayOnTime = 0;
         Histogram presentToPresent;
         Histogram frameDuration;
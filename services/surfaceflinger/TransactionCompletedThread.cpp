@@ -131,6 +131,13 @@ bool TransactionCompletedThread::isRegisteringTransaction(
     return itr != mRegisteringTransactions.end();
 }
 
+bool TransactionCompletedThread::isPendingTransaction(const sp<IBinder>& transactionListener,
+                                                      const std::vector<CallbackId>& callbackIds) {
+    auto pendingTransactions = mPendingTransactions.find(transactionListener);
+    return pendingTransactions != mPendingTransactions.end() &&
+            pendingTransactions->second.count(callbackIds) != 0;
+}
+
 status_t TransactionCompletedThread::registerPendingCallbackHandle(
         const sp<CallbackHandle>& handle) {
     std::lock_guard lock(mMutex);
@@ -240,10 +247,16 @@ status_t TransactionCompletedThread::addCallbackHandle(const sp<CallbackHandle>&
     // destroyed the client side is dead and there won't be anyone to send the callback to.
     sp<IBinder> surfaceControl = handle->surfaceControl.promote();
     if (surfaceControl) {
-        FrameEventHistoryStats eventStats(handle->frameNumber,
-                                          handle->gpuCompositionDoneFence->getSnapshot().fence,
-                                          handle->compositorTiming, handle->refreshStartTime,
-                                          handle->dequeueReadyTime);
+        // The frame event stats only describe a buffer latched for this transaction. Without
+        // one they are left empty, and are not parceled.
+        FrameEventHistoryStats eventStats;
+        if (handle->frameNumber != 0) {
+            const auto& gpuCompositionDoneFence = handle->gpuCompositionDoneFence;
+            eventStats = FrameEventHistoryStats(handle->frameNumber,
+                                                gpuCompositionDoneFence->getSnapshot().fence,
+                                                handle->compositorTiming, handle->refreshStartTime,
+                                                handle->dequeueReadyTime);
+        }
         transactionStats->surfaceStats.emplace_back(surfaceControl, handle->acquireTime,
                                                     handle->previousReleaseFence,
                                                     handle->transformHint, eventStats);
@@ -253,12 +266,23 @@ status_t TransactionCompletedThread::addCallbackHandle(const sp<CallbackHandle>&
 
 void TransactionCompletedThread::addPresentFence(const sp<Fence>& presentFence) {
     std::lock_guard<std::mutex> lock(mMutex);
-    mPresentFence = presentFence;
+    for (auto& [listener, transactionStatsDeque] : mCompletedTransactions) {
+        for (auto& transactionStats : transactionStatsDeque) {
+            // A transaction still waiting on callback handles is presented in a later frame.
+            if (transactionStats.latchTime < 0 || transactionStats.presentFence ||
+                isRegisteringTransaction(listener, transactionStats.callbackIds) ||
+                isPendingTransaction(listener, transactionStats.callbackIds)) {
+                continue;
+            }
+            transactionStats.presentFence = presentFence;
+        }
+    }
 }
 
 void TransactionCompletedThread::sendCallbacks() {
     std::lock_guard lock(mMutex);
     if (mRunning) {
+        mCallbacksRequested = true;
         mConditionVariable.notify_all();
     }
 }
@@ -267,7 +291,10 @@ void TransactionCompletedThread::threadMain() {
     std::lock_guard lock(mMutex);
 
     while (mKeepRunning) {
-        mConditionVariable.wait(mMutex);
+        mConditionVariable.wait(mMutex, [&]() REQUIRES(mMutex) {
+            return mCallbacksRequested || !mKeepRunning;
+        });
+        mCallbacksRequested = false;
         std::vector<ListenerStats> completedListenerStats;
 
         // For each listener
@@ -291,18 +318,13 @@ void TransactionCompletedThread::threadMain() {
 
                 // If we are still waiting on the callback handles for this transaction, stop
                 // here because all transaction callbacks for the same listener must come in order
-                auto pendingTransactions = mPendingTransactions.find(listener);
-                if (pendingTransactions != mPendingTransactions.end() &&
-                    pendingTransactions->second.count(transactionStats.callbackIds) != 0) {
+                if (isPendingTransaction(listener, transactionStats.callbackIds)) {
                     break;
                 }
 
-                // If the transaction has been latched
-                if (transactionStats.latchTime >= 0) {
-                    if (!mPresentFence) {
-                        break;
-                    }
-                    transactionStats.presentFence = mPresentFence;
+                // If the transaction has been latched but not presented yet
+                if (transactionStats.latchTime >= 0 && !transactionStats.presentFence) {
+                    break;
                 }
 
                 // Remove the transaction from completed to the callback
@@ -339,10 +361,6 @@ void TransactionCompletedThread::threadMain() {
             completedListenerStats.push_back(std::move(listenerStats));
         }
 
-        if (mPresentFence) {
-            mPresentFence.clear();
-        }
-
         // If everyone else has dropped their reference to a layer and its listener is dead,
         // we are about to cause the layer to be deleted. If this happens at the wrong time and
         // we are holding mMutex, we will cause a deadlock.
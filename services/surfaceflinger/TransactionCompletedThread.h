@@ -79,8 +79,13 @@ public:
     // presented this frame.
     status_t registerUnpresentedCallbackHandle(const sp<CallbackHandle>& handle);
 
+    // Attaches the present fence to every completed transaction that was latched and has no
+    // present fence yet, so that a transaction keeps the fence of the frame it was presented in
+    // even if its callback goes out after later frames.
     void addPresentFence(const sp<Fence>& presentFence);
 
+    // Asks the thread to send the completed callbacks. Requests made while the thread is still
+    // sending are merged, and the next pass sends one callback per listener for all of them.
     void sendCallbacks();
 
 private:
@@ -95,6 +100,9 @@ private:
 
     status_t addCallbackHandle(const sp<CallbackHandle>& handle) REQUIRES(mMutex);
 
+    bool isPendingTransaction(const sp<IBinder>& transactionListener,
+                              const std::vector<CallbackId>& callbackIds) REQUIRES(mMutex);
+
     class ThreadDeathRecipient : public IBinder::DeathRecipient {
     public:
         // This function is a no-op. isBinderAlive needs a linked DeathRecipient to work.
@@ -129,7 +137,7 @@ private:
     bool mRunning GUARDED_BY(mMutex) = false;
     bool mKeepRunning GUARDED_BY(mMutex) = true;
 
-    sp<Fence> mPresentFence GUARDED_BY(mMutex);
+    bool mCallbacksRequested GUARDED_BY(mMutex) = false;
 };
 
 } // namespace android
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "WorkerPool"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "WorkerPool.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+namespace android {
+
+WorkerPool::WorkerPool(size_t threadCount, const char* name) {
+    int policy;
+    struct sched_param param;
+    const int err = pthread_getschedparam(pthread_self(), &policy, &param);
+
+    mThreads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        mThreads.emplace_back(&WorkerPool::threadMain, this);
+        pthread_setname_np(mThreads.back().native_handle(), name);
+        if (err != 0) {
+            continue;
+        }
+        const int result = pthread_setschedparam(mThreads.back().native_handle(), policy, &param);
+        if (result != 0) {
+            ALOGW("Couldn't set the priority of %s: %s", name, strerror(result));
+        }
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard lock(mMutex);
+        mRunning = false;
+    }
+    mWorkCondition.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run(size_t count, const Work& work) {
+    ATRACE_CALL();
+    if (count == 0) {
+        return;
+    }
+    {
+        std::lock_guard lock(mMutex);
+        mWork = &work;
+        mCount = count;
+        mNext = 0;
+        mDone = 0;
+    }
+    mWorkCondition.notify_all();
+
+    // Work alongside the workers rather than waiting for them to wake up.
+    while (true) {
+        size_t index;
+        {
+            std::lock_guard lock(mMutex);
+            if (mNext >= mCount) {
+                break;
+            }
+            index = mNext++;
+        }
+        work(index);
+        finish();
+    }
+
+    std::lock_guard lock(mMutex);
+    mDoneCondition.wait(mMutex, [this]() REQUIRES(mMutex) { return mDone == mCount; });
+    // Workers woken too late find no item left, and never see this batch.
+    mWork = nullptr;
+    mCount = 0;
+    mNext = 0;
+}
+
+void WorkerPool::threadMain() {
+    while (true) {
+        const Work* work;
+        size_t index;
+        {
+            std::lock_guard lock(mMutex);
+            mWorkCondition.wait(mMutex,
+                                [this]() REQUIRES(mMutex) { return !mRunning || mNext < mCount; });
+            if (!mRunning) {
+                return;
+            }
+            work = mWork;
+            index = mNext++;
+        }
+        (*work)(index);
+        finish();
+    }
+}
+
+void WorkerPool::finish() {
+    std::lock_guard lock(mMutex);
+    if (++mDone == mCount) {
+        mDoneCondition.notify_all();
+    }
+}
+
+} // namespace android
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+
+namespace android {
+
+// A few threads that help the calling thread through a batch of independent items, for main
+// thread work that is a syscall or two per layer, such as checking acquire fences. The threads
+// run at the priority of the thread that creates the pool, so the main thread never waits on a
+// worker that it preempts.
+class WorkerPool {
+public:
+    using Work = std::function<void(size_t index)>;
+
+    WorkerPool(size_t threadCount, const char* name);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Calls work once for each index in [0, count), on the workers and on the calling thread, in
+    // no particular order. Returns once every call has returned. Only one thread may call run().
+    void run(size_t count, const Work& work) EXCLUDES(mMutex);
+
+private:
+    void threadMain() EXCLUDES(mMutex);
+    void finish() EXCLUDES(mMutex);
+
+    std::mutex mMutex;
+    // Wakes the workers when a batch starts or the pool is destroyed.
+    std::condition_variable_any mWorkCondition;
+    // Wakes run() when the last item of the batch is done.
+    std::condition_variable_any mDoneCondition;
+    const Work* mWork GUARDED_BY(mMutex) = nullptr;
+    size_t mCount GUARDED_BY(mMutex) = 0;
+    // Index of the next item to claim, and number of items done.
+    size_t mNext GUARDED_BY(mMutex) = 0;
+    size_t mDone GUARDED_BY(mMutex) = 0;
+    bool mRunning GUARDED_BY(mMutex) = true;
+
+    std::vector<std::thread> mThreads;
+};
+
+} // namespace android
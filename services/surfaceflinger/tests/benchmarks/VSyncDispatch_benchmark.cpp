@@ -0,0 +1,144 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "Scheduler/TimeKeeper.h"
+#include "Scheduler/VSyncDispatchTimerQueue.h"
+#include "Scheduler/VSyncTracker.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace android::scheduler {
+
+static constexpr nsecs_t PERIOD = 16'666'667;
+static constexpr nsecs_t TIMER_SLACK = 500'000;
+static constexpr nsecs_t MIN_VSYNC_DISTANCE = 3'000'000;
+
+// A tracker with a perfect model of a fixed period.
+class FixedPeriodTracker : public VSyncTracker {
+public:
+    bool addVsyncTimestamp(nsecs_t) override { return true; }
+    nsecs_t nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const override {
+        return (timePoint + PERIOD - 1) / PERIOD * PERIOD;
+    }
+    nsecs_t currentPeriod() const override { return PERIOD; }
+    void setPeriod(nsecs_t) override {}
+    void resetModel() override {}
+    bool needsMoreSamples() const override { return false; }
+    void dump(std::string&) const override {}
+};
+
+// A timer that only fires when told to, at the time it was armed for.
+class ManualTimeKeeper : public TimeKeeper {
+public:
+    nsecs_t now() const override { return mNow; }
+    void alarmIn(std::function<void()> const& callback, nsecs_t time) override {
+        mCallback = callback;
+        mAlarmTime = mNow + time;
+    }
+    void alarmCancel() override { mCallback = nullptr; }
+    void dump(std::string&) const override {}
+
+    // Advances to the armed alarm and runs it. Returns false if no alarm is armed.
+    bool fire() {
+        if (!mCallback) {
+            return false;
+        }
+        auto callback = std::move(mCallback);
+        mCallback = nullptr;
+        mNow = std::max(mNow, mAlarmTime);
+        callback();
+        return true;
+    }
+
+private:
+    nsecs_t mNow = 0;
+    nsecs_t mAlarmTime = 0;
+    std::function<void()> mCallback;
+};
+
+/**
+ * Schedules the given number of callbacks with staggered work durations, as with one
+ * choreographer-style client each, and fires the timer until all of them have run: one frame.
+ */
+static void BM_ScheduleAndFireCallbacks(benchmark::State& state) {
+    auto const count = static_cast<size_t>(state.range(0));
+    auto timeKeeperPtr = std::make_unique<ManualTimeKeeper>();
+    auto& timeKeeper = *timeKeeperPtr;
+    FixedPeriodTracker tracker;
+    VSyncDispatchTimerQueue dispatch(std::move(timeKeeperPtr), tracker, TIMER_SLACK,
+                                     MIN_VSYNC_DISTANCE);
+
+    size_t fired = 0;
+    std::vector<VSyncDispatch::CallbackToken> tokens;
+    for (size_t i = 0; i < count; i++) {
+        tokens.push_back(dispatch.registerCallback([&](nsecs_t, nsecs_t) { fired++; },
+                                                   "benchmark"));
+    }
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; i++) {
+            // Spread over most of a period, so some wakeups merge within the slack.
+            auto const workDuration = 1'000'000 + static_cast<nsecs_t>(i % 32) * 400'000;
+            dispatch.schedule(tokens[i], workDuration, timeKeeper.now());
+        }
+        while (timeKeeper.fire()) {
+        }
+    }
+    state.counters["fired"] = benchmark::Counter(static_cast<double>(fired),
+                                                 benchmark::Counter::kAvgIterations);
+
+    for (auto const& token : tokens) {
+        dispatch.unregisterCallback(token);
+    }
+}
+BENCHMARK(BM_ScheduleAndFireCallbacks)->Arg(1)->Arg(10)->Arg(100);
+
+/**
+ * Schedules and fires a single callback while the given number of callbacks are registered but
+ * idle, which should cost the same whatever the number.
+ */
+static void BM_ScheduleOneOfRegisteredCallbacks(benchmark::State& state) {
+    auto const count = static_cast<size_t>(state.range(0));
+    auto timeKeeperPtr = std::make_unique<ManualTimeKeeper>();
+    auto& timeKeeper = *timeKeeperPtr;
+    FixedPeriodTracker tracker;
+    VSyncDispatchTimerQueue dispatch(std::move(timeKeeperPtr), tracker, TIMER_SLACK,
+                                     MIN_VSYNC_DISTANCE);
+
+    std::vector<VSyncDispatch::CallbackToken> tokens;
+    for (size_t i = 0; i < count; i++) {
+        tokens.push_back(dispatch.registerCallback([](nsecs_t, nsecs_t) {}, "benchmark"));
+    }
+
+    for (auto _ : state) {
+        dispatch.schedule(tokens[0], 4'000'000, timeKeeper.now());
+        while (timeKeeper.fire()) {
+        }
+    }
+
+    for (auto const& token : tokens) {
+        dispatch.unregisterCallback(token);
+    }
+}
+BENCHMARK(BM_ScheduleOneOfRegisteredCallbacks)->Arg(1)->Arg(10)->Arg(100);
+
+} // namespace android::scheduler
+
+BENCHMARK_MAIN();
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "CopyOnWriteTest"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "CopyOnWrite.h"
+
+namespace android {
+namespace {
+
+TEST(CopyOnWriteTest, CopiesShareValue) {
+    CopyOnWrite<std::string> a(std::string("value"));
+    CopyOnWrite<std::string> b = a;
+    EXPECT_TRUE(a.isSharedWith(b));
+    EXPECT_EQ(&a.get(), &b.get());
+}
+
+TEST(CopyOnWriteTest, EditDetachesSharedValue) {
+    CopyOnWrite<std::string> a(std::string("value"));
+    CopyOnWrite<std::string> b = a;
+    b.edit().append("2");
+    EXPECT_FALSE(a.isSharedWith(b));
+    EXPECT_EQ("value", *a);
+    EXPECT_EQ("value2", *b);
+}
+
+TEST(CopyOnWriteTest, EditKeepsUnsharedValue) {
+    CopyOnWrite<std::string> a(std::string("value"));
+    const std::string* value = &a.get();
+    a.edit().append("2");
+    EXPECT_EQ(value, &a.get());
+    EXPECT_EQ("value2", *a);
+}
+
+TEST(CopyOnWriteTest, AssignDoesNotAffectCopies) {
+    CopyOnWrite<std::string> a(std::string("value"));
+    CopyOnWrite<std::string> b = a;
+    b = std::string("other");
+    EXPECT_EQ("value", *a);
+    EXPECT_EQ("other", *b);
+    EXPECT_EQ(5u, a->size());
+}
+
+} // namespace
+} // namespace android
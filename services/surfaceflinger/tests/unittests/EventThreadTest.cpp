@@ -59,8 +59,19 @@ protected:
     public:
         MockEventThreadConnection(impl::EventThread* eventThread, ResyncCallback&& resyncCallback,
                                   ISurfaceComposer::ConfigChanged configChanged)
-              : EventThreadConnection(eventThread, std::move(resyncCallback), configChanged) {}
+              : EventThreadConnection(eventThread, /*callingUid=*/0, std::move(resyncCallback),
+                                      configChanged) {}
         MOCK_METHOD1(postEvent, status_t(const DisplayEventReceiver::Event& event));
+
+        // Records each event of a batch separately.
+        status_t postEvents(const std::vector<DisplayEventReceiver::Event>& events) override {
+            for (const auto& event : events) {
+                if (const status_t status = postEvent(event); status != NO_ERROR) {
+                    return status;
+                }
+            }
+            return NO_ERROR;
+        }
     };
 
     using ConnectionEventRecorder =
@@ -356,6 +367,60 @@ TEST_F(EventThreadTest, setVsyncRateTwoPostsEveryOtherEventToThatConnection) {
     expectVsyncEventReceivedByConnection(101112, 4u);
 }
 
+TEST_F(EventThreadTest, frameRateDividerThrottlesVsyncRequestsOfThatUid) {
+    mThread->setFrameRateDividers({{mConnection->mOwnerUid, 2}});
+    mThread->requestNextVsync(mConnection);
+
+    // EventThread should immediately request a resync.
+    EXPECT_TRUE(mResyncCallRecorder.waitForCall().has_value());
+
+    // EventThread should enable vsync callbacks.
+    expectVSyncSetEnabledCallReceived(true);
+
+    // The first event is held back, and the request kept for the next one.
+    mCallback->onVSyncEvent(123, 456);
+    expectInterceptCallReceived(123);
+    EXPECT_FALSE(mConnectionEventCallRecorder.waitForUnexpectedCall().has_value());
+
+    // The second event is delivered.
+    mCallback->onVSyncEvent(456, 789);
+    expectInterceptCallReceived(456);
+    expectVsyncEventReceivedByConnection(456, 2u);
+
+    // Without a divider, every requested event is delivered again.
+    mThread->setFrameRateDividers({});
+    mThread->requestNextVsync(mConnection);
+    EXPECT_TRUE(mResyncCallRecorder.waitForCall().has_value());
+    mCallback->onVSyncEvent(789, 101112);
+    expectInterceptCallReceived(789);
+    expectVsyncEventReceivedByConnection(789, 3u);
+}
+
+TEST_F(EventThreadTest, dispatchDelayHoldsBackVsyncEventsOfThatUid) {
+    constexpr nsecs_t kDelay = std::chrono::nanoseconds(20ms).count();
+    const uid_t uid = mConnection->mOwnerUid;
+    mThread->setDispatchDelays({{uid, kDelay}});
+    mThread->requestNextVsync(mConnection);
+
+    // EventThread should immediately request a resync.
+    EXPECT_TRUE(mResyncCallRecorder.waitForCall().has_value());
+
+    // EventThread should enable vsync callbacks.
+    expectVSyncSetEnabledCallReceived(true);
+
+    // The event is sent once the delay elapses, with its timestamp unchanged.
+    const nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    mCallback->onVSyncEvent(123, 456);
+    expectInterceptCallReceived(123);
+    EXPECT_FALSE(mConnectionEventCallRecorder.waitForUnexpectedCall().has_value());
+    expectVsyncEventReceivedByConnection(123, 1u);
+
+    const nsecs_t dispatchTime =
+            mThread->getLastVSyncDispatchTime(uid, systemTime(SYSTEM_TIME_MONOTONIC));
+    EXPECT_GE(dispatchTime, start + kDelay);
+    EXPECT_EQ(0, mThread->getLastVSyncDispatchTime(uid, start));
+}
+
 TEST_F(EventThreadTest, connectionsRemovedIfInstanceDestroyed) {
     mThread->setVsyncRate(1, mConnection);
 
@@ -122,7 +122,8 @@ struct HWComposerLayerTest : public testing::Test {
 
     std::unique_ptr<Hwc2::mock::Composer> mHal{new StrictMock<Hwc2::mock::Composer>()};
     const std::unordered_set<hal::Capability> mCapabilies;
-    HWC2::impl::Layer mLayer{*mHal, mCapabilies, kDisplayId, kLayerId};
+    HWC2::LayerCommandCounts mCommandCounts;
+    HWC2::impl::Layer mLayer{*mHal, mCapabilies, kDisplayId, kLayerId, mCommandCounts};
 };
 
 struct HWComposerLayerGenericMetadataTest : public HWComposerLayerTest {
@@ -171,5 +172,40 @@ TEST_F(HWComposerLayerGenericMetadataTest, forwardsSupportedMetadata) {
     EXPECT_EQ(hal::Error::UNSUPPORTED, result);
 }
 
+struct HWComposerLayerRedundantCommandTest : public HWComposerLayerTest {
+    HWComposerLayerRedundantCommandTest() : HWComposerLayerTest({}) {}
+};
+
+TEST_F(HWComposerLayerRedundantCommandTest, elidesUnchangedGeometry) {
+    const Rect frame(1, 2, 3, 4);
+    EXPECT_CALL(*mHal, setLayerDisplayFrame(kDisplayId, kLayerId, _))
+            .WillOnce(Return(hardware::graphics::composer::V2_1::Error::NONE));
+    EXPECT_CALL(*mHal, setLayerZOrder(kDisplayId, kLayerId, 5u))
+            .WillOnce(Return(hardware::graphics::composer::V2_1::Error::NONE));
+
+    EXPECT_EQ(hal::Error::NONE, mLayer.setDisplayFrame(frame));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(5u));
+    EXPECT_EQ(2u, mCommandCounts.sent);
+    EXPECT_EQ(0u, mCommandCounts.elided);
+
+    // Setting the same values again does not send anything to the composer.
+    EXPECT_EQ(hal::Error::NONE, mLayer.setDisplayFrame(frame));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setZOrder(5u));
+    EXPECT_EQ(2u, mCommandCounts.sent);
+    EXPECT_EQ(2u, mCommandCounts.elided);
+}
+
+TEST_F(HWComposerLayerRedundantCommandTest, resendsValueAfterError) {
+    EXPECT_CALL(*mHal, setLayerPlaneAlpha(kDisplayId, kLayerId, 0.5f))
+            .WillOnce(Return(hardware::graphics::composer::V2_1::Error::BAD_LAYER))
+            .WillOnce(Return(hardware::graphics::composer::V2_1::Error::NONE));
+
+    EXPECT_EQ(hal::Error::BAD_LAYER, mLayer.setPlaneAlpha(0.5f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+    EXPECT_EQ(hal::Error::NONE, mLayer.setPlaneAlpha(0.5f));
+    EXPECT_EQ(2u, mCommandCounts.sent);
+    EXPECT_EQ(1u, mCommandCounts.elided);
+}
+
 } // namespace
 } // namespace android
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+
+#undef LOG_TAG
+#define LOG_TAG "LibSurfaceFlingerUnittests"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <gui/LayerMetadata.h>
+
+#include "EffectLayer.h"
+#include "Layer.h"
+#include "TestableSurfaceFlinger.h"
+#include "mock/DisplayHardware/MockComposer.h"
+#include "mock/MockDispSync.h"
+#include "mock/MockEventControlThread.h"
+#include "mock/MockEventThread.h"
+
+namespace android {
+
+using testing::_;
+using testing::Mock;
+using testing::Return;
+
+using FakeHwcDisplayInjector = TestableSurfaceFlinger::FakeHwcDisplayInjector;
+
+/**
+ * This class covers the incremental computation of layer bounds.
+ */
+class LayerBoundsTest : public testing::Test {
+public:
+    LayerBoundsTest();
+    ~LayerBoundsTest() override;
+
+protected:
+    static constexpr uint32_t WIDTH = 100;
+    static constexpr uint32_t HEIGHT = 100;
+    static constexpr uint32_t LAYER_FLAGS = 0;
+    static const FloatRect DISPLAY_BOUNDS;
+
+    void setupScheduler();
+    void setupComposer(int virtualDisplayCount);
+    sp<EffectLayer> createEffectLayer();
+
+    void reparent(const sp<Layer>& child, const sp<Layer>& oldParent, const sp<Layer>& newParent);
+    void commitTransaction(Layer* layer);
+    void computeBounds(const FloatRect& displayBounds = DISPLAY_BOUNDS);
+    // Changes the crop of the drawing state without marking the geometry as dirty.
+    void setDrawingCropSilently(Layer* layer, const Rect& crop);
+
+    static FloatRect getBounds(const sp<Layer>& layer) { return layer->mBounds; }
+
+    TestableSurfaceFlinger mFlinger;
+    Hwc2::mock::Composer* mComposer = nullptr;
+
+    sp<Layer> mParent;
+    sp<Layer> mChild;
+    sp<Layer> mGrandChild;
+};
+
+const FloatRect LayerBoundsTest::DISPLAY_BOUNDS(0, 0, 1000, 1000);
+
+LayerBoundsTest::LayerBoundsTest() {
+    const ::testing::TestInfo* const test_info =
+            ::testing::UnitTest::GetInstance()->current_test_info();
+    ALOGD("**** Setting up for %s.%s\n", test_info->test_case_name(), test_info->name());
+
+    setupScheduler();
+    setupComposer(0);
+
+    mParent = createEffectLayer();
+    mChild = createEffectLayer();
+    mParent->addChild(mChild);
+    mGrandChild = createEffectLayer();
+    mChild->addChild(mGrandChild);
+    mParent->commitChildList();
+}
+
+LayerBoundsTest::~LayerBoundsTest() {
+    const ::testing::TestInfo* const test_info =
+            ::testing::UnitTest::GetInstance()->current_test_info();
+    ALOGD("**** Tearing down after %s.%s\n", test_info->test_case_name(), test_info->name());
+}
+
+sp<EffectLayer> LayerBoundsTest::createEffectLayer() {
+    sp<Client> client;
+    LayerCreationArgs args(mFlinger.flinger(), client, "color-layer", WIDTH, HEIGHT, LAYER_FLAGS,
+                           LayerMetadata());
+    return new EffectLayer(args);
+}
+
+void LayerBoundsTest::reparent(const sp<Layer>& child, const sp<Layer>& oldParent,
+                               const sp<Layer>& newParent) {
+    oldParent->removeChild(child);
+    newParent->addChild(child);
+    mParent->commitChildList();
+}
+
+void LayerBoundsTest::commitTransaction(Layer* layer) {
+    layer->commitTransaction(layer->getCurrentState());
+}
+
+void LayerBoundsTest::computeBounds(const FloatRect& displayBounds) {
+    mParent->computeBounds(displayBounds, ui::Transform(), 0.f /* shadowRadius */);
+}
+
+void LayerBoundsTest::setDrawingCropSilently(Layer* layer, const Rect& crop) {
+    layer->mDrawingState.crop_legacy = crop;
+}
+
+void LayerBoundsTest::setupScheduler() {
+    auto eventThread = std::make_unique<mock::EventThread>();
+    auto sfEventThread = std::make_unique<mock::EventThread>();
+
+    EXPECT_CALL(*eventThread, registerDisplayEventConnection(_));
+    EXPECT_CALL(*eventThread, createEventConnection(_, _))
+            .WillOnce(Return(new EventThreadConnection(eventThread.get(), /*callingUid=*/0,
+                                                       ResyncCallback(),
+                                                       ISurfaceComposer::eConfigChangedSuppress)));
+
+    EXPECT_CALL(*sfEventThread, registerDisplayEventConnection(_));
+    EXPECT_CALL(*sfEventThread, createEventConnection(_, _))
+            .WillOnce(Return(new EventThreadConnection(sfEventThread.get(), /*callingUid=*/0,
+                                                       ResyncCallback(),
+                                                       ISurfaceComposer::eConfigChangedSuppress)));
+
+    auto primaryDispSync = std::make_unique<mock::DispSync>();
+
+    EXPECT_CALL(*primaryDispSync, computeNextRefresh(0, _)).WillRepeatedly(Return(0));
+    EXPECT_CALL(*primaryDispSync, getPeriod())
+            .WillRepeatedly(Return(FakeHwcDisplayInjector::DEFAULT_REFRESH_RATE));
+    EXPECT_CALL(*primaryDispSync, expectedPresentTime(_)).WillRepeatedly(Return(0));
+    mFlinger.setupScheduler(std::move(primaryDispSync),
+                            std::make_unique<mock::EventControlThread>(), std::move(eventThread),
+                            std::move(sfEventThread));
+}
+
+void LayerBoundsTest::setupComposer(int virtualDisplayCount) {
+    mComposer = new Hwc2::mock::Composer();
+    EXPECT_CALL(*mComposer, getMaxVirtualDisplayCount()).WillOnce(Return(virtualDisplayCount));
+    mFlinger.setupComposer(std::unique_ptr<Hwc2::Composer>(mComposer));
+
+    Mock::VerifyAndClear(mComposer);
+}
+
+namespace {
+/* ------------------------------------------------------------------------
+ * Test cases
+ */
+TEST_F(LayerBoundsTest, committedCropReachesDescendants) {
+    computeBounds();
+    EXPECT_EQ(DISPLAY_BOUNDS, getBounds(mGrandChild));
+
+    mParent->setCrop_legacy(Rect(0, 0, 200, 300));
+    commitTransaction(mParent.get());
+    computeBounds();
+    EXPECT_EQ(FloatRect(0, 0, 200, 300), getBounds(mParent));
+    EXPECT_EQ(FloatRect(0, 0, 200, 300), getBounds(mChild));
+    EXPECT_EQ(FloatRect(0, 0, 200, 300), getBounds(mGrandChild));
+}
+
+TEST_F(LayerBoundsTest, unchangedSubtreesAreSkipped) {
+    computeBounds();
+
+    // Not marked dirty, so the cached bounds are kept.
+    setDrawingCropSilently(mChild.get(), Rect(0, 0, 10, 10));
+    computeBounds();
+    EXPECT_EQ(DISPLAY_BOUNDS, getBounds(mChild));
+    EXPECT_EQ(DISPLAY_BOUNDS, getBounds(mGrandChild));
+
+    // A dirty grandchild alone does not recompute its ancestors.
+    mGrandChild->setGeometryDirty();
+    computeBounds();
+    EXPECT_EQ(DISPLAY_BOUNDS, getBounds(mChild));
+    EXPECT_EQ(DISPLAY_BOUNDS, getBounds(mGrandChild));
+
+    mChild->setGeometryDirty();
+    computeBounds();
+    EXPECT_EQ(FloatRect(0, 0, 10, 10), getBounds(mChild));
+    EXPECT_EQ(FloatRect(0, 0, 10, 10), getBounds(mGrandChild));
+}
+
+TEST_F(LayerBoundsTest, displayBoundsChangeRecomputesTree) {
+    computeBounds();
+    EXPECT_EQ(DISPLAY_BOUNDS, getBounds(mGrandChild));
+
+    const FloatRect smallerBounds(0, 0, 500, 400);
+    computeBounds(smallerBounds);
+    EXPECT_EQ(smallerBounds, getBounds(mParent));
+    EXPECT_EQ(smallerBounds, getBounds(mGrandChild));
+}
+
+TEST_F(LayerBoundsTest, reparentedLayerIsRecomputed) {
+    mChild->setCrop_legacy(Rect(0, 0, 50, 50));
+    commitTransaction(mChild.get());
+    computeBounds();
+    EXPECT_EQ(FloatRect(0, 0, 50, 50), getBounds(mGrandChild));
+
+    reparent(mGrandChild, mChild, mParent);
+    computeBounds();
+    EXPECT_EQ(DISPLAY_BOUNDS, getBounds(mGrandChild));
+}
+
+} // namespace
+} // namespace android
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic pop // ignored "-Wconversion"
@@ -499,6 +499,40 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
     EXPECT_EQ(0, frequentLayerCount(time));
 }
 
+TEST_F(LayerHistoryTestV2, destroyedLayerIsDeregistered) {
+    auto layer1 = createLayer();
+    auto layer2 = createLayer();
+    auto layer3 = createLayer();
+
+    EXPECT_CALL(*layer1, isVisible()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*layer1, getFrameRateForLayerTree()).WillRepeatedly(Return(Layer::FrameRate()));
+    EXPECT_CALL(*layer2, isVisible()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*layer2, getFrameRateForLayerTree()).WillRepeatedly(Return(Layer::FrameRate()));
+    EXPECT_CALL(*layer3, isVisible()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*layer3, getFrameRateForLayerTree()).WillRepeatedly(Return(Layer::FrameRate()));
+
+    nsecs_t time = systemTime();
+    history().record(layer1.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
+    history().record(layer2.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
+    EXPECT_EQ(3, layerCount());
+    EXPECT_EQ(2, activeLayerCount());
+
+    // The layer is removed without waiting for the next summary.
+    layer1.clear();
+    EXPECT_EQ(2, layerCount());
+    EXPECT_EQ(1, activeLayerCount());
+
+    // The remaining layers are still found by record().
+    history().record(layer3.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
+    EXPECT_EQ(2, activeLayerCount());
+    ASSERT_EQ(2, history().summarize(time).size());
+
+    layer2.clear();
+    layer3.clear();
+    EXPECT_EQ(0, layerCount());
+    EXPECT_EQ(0, activeLayerCount());
+}
+
 TEST_F(LayerHistoryTestV2, inactiveLayers) {
     auto layer = createLayer();
 
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LayerNameRegistryTest"
+
+#include <gtest/gtest.h>
+
+#include "LayerNameRegistry.h"
+
+namespace android {
+namespace {
+
+TEST(LayerNameRegistryTest, TagsEveryName) {
+    LayerNameRegistry registry;
+    EXPECT_EQ("Layer#0", registry.acquire("Layer"));
+    EXPECT_EQ("Other#0", registry.acquire("Other"));
+    EXPECT_EQ("Layer#1", registry.acquire("Layer"));
+    EXPECT_EQ(2u, registry.size());
+}
+
+TEST(LayerNameRegistryTest, ReusesLowestReleasedCounter) {
+    LayerNameRegistry registry;
+    for (int i = 0; i < 4; i++) {
+        registry.acquire("Layer");
+    }
+    registry.release("Layer#2");
+    registry.release("Layer#1");
+    EXPECT_EQ("Layer#1", registry.acquire("Layer"));
+    EXPECT_EQ("Layer#2", registry.acquire("Layer"));
+    EXPECT_EQ("Layer#4", registry.acquire("Layer"));
+}
+
+TEST(LayerNameRegistryTest, ForgetsNamesWithoutLayers) {
+    LayerNameRegistry registry;
+    registry.acquire("Layer");
+    registry.acquire("Layer");
+    registry.release("Layer#0");
+    registry.release("Layer#1");
+    EXPECT_EQ(0u, registry.size());
+    EXPECT_EQ("Layer#0", registry.acquire("Layer"));
+}
+
+TEST(LayerNameRegistryTest, IgnoresUnknownNames) {
+    LayerNameRegistry registry;
+    registry.acquire("Layer");
+    registry.release("Layer");
+    registry.release("Layer#1");
+    registry.release("Layer#x");
+    registry.release("Other#0");
+    EXPECT_EQ(1u, registry.size());
+
+    // Releasing twice does not hand the name out twice.
+    registry.release("Layer#0");
+    registry.release("Layer#0");
+    EXPECT_EQ("Layer#0", registry.acquire("Layer"));
+    EXPECT_EQ("Layer#1", registry.acquire("Layer"));
+}
+
+TEST(LayerNameRegistryTest, NamesContainingSeparator) {
+    LayerNameRegistry registry;
+    EXPECT_EQ("Layer#0", registry.acquire("Layer"));
+    EXPECT_EQ("Layer#0#0", registry.acquire("Layer#0"));
+    registry.release("Layer#0#0");
+    EXPECT_EQ(1u, registry.size());
+    EXPECT_EQ("Layer#1", registry.acquire("Layer"));
+}
+
+} // namespace
+} // namespace android
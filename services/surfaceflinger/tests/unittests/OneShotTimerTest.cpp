@@ -206,6 +206,31 @@ TEST_F(OneShotTimerTest, noCallbacksAfterStopTest) {
     EXPECT_FALSE(mResetTimerCallback.waitForCall().has_value());
 }
 
+TEST_F(OneShotTimerTest, timersExpireIndependentlyTest) {
+    AsyncCallRecorder<void (*)()> otherResetCallback;
+    AsyncCallRecorder<void (*)()> otherExpiredCallback;
+
+    mIdleTimer = std::make_unique<scheduler::OneShotTimer>(3ms, mResetTimerCallback.getInvocable(),
+                                                           mExpiredTimerCallback.getInvocable());
+    auto otherTimer =
+            std::make_unique<scheduler::OneShotTimer>(100ms, otherResetCallback.getInvocable(),
+                                                      otherExpiredCallback.getInvocable());
+    otherTimer->start();
+    EXPECT_TRUE(otherResetCallback.waitForCall().has_value());
+    mIdleTimer->start();
+    EXPECT_TRUE(mResetTimerCallback.waitForCall().has_value());
+
+    // The shorter timer expires while the longer one is still waiting.
+    EXPECT_TRUE(mExpiredTimerCallback.waitForCall(waitTimeForExpected3msCallback).has_value());
+    EXPECT_FALSE(otherExpiredCallback.waitForCall(0ms).has_value());
+
+    // Stopping one timer leaves the other running.
+    mIdleTimer->stop();
+    EXPECT_TRUE(otherExpiredCallback.waitForCall(waitTimeForExpected3msCallback + 100ms)
+                        .has_value());
+    otherTimer->stop();
+}
+
 } // namespace
 } // namespace scheduler
 } // namespace android
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "DisplayHardware/PresentOrValidatePredictor.h"
+
+namespace android::Hwc2 {
+namespace {
+
+using Signature = PresentOrValidatePredictor::Signature;
+
+const Signature kVideoFrame{.layerCount = 3, .bufferUpdates = 1};
+const Signature kScrollingFrame{.layerCount = 3, .bufferUpdates = 1, .geometryChanged = true};
+
+TEST(PresentOrValidatePredictorTest, triesPresentOrValidateForNewFrames) {
+    PresentOrValidatePredictor predictor;
+    EXPECT_TRUE(predictor.shouldTryPresentOrValidate(kVideoFrame));
+    EXPECT_TRUE(predictor.shouldTryPresentOrValidate(kScrollingFrame));
+}
+
+TEST(PresentOrValidatePredictorTest, validatesFramesHwcDidNotPresent) {
+    PresentOrValidatePredictor predictor;
+    ASSERT_TRUE(predictor.shouldTryPresentOrValidate(kScrollingFrame));
+    predictor.recordPresentOrValidate(kScrollingFrame, /*presented=*/false, ms2ns(1));
+
+    EXPECT_FALSE(predictor.shouldTryPresentOrValidate(kScrollingFrame));
+    // Other frames are still presented without a validate.
+    EXPECT_TRUE(predictor.shouldTryPresentOrValidate(kVideoFrame));
+}
+
+TEST(PresentOrValidatePredictorTest, keepsTryingFramesHwcPresented) {
+    PresentOrValidatePredictor predictor;
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(predictor.shouldTryPresentOrValidate(kVideoFrame));
+        predictor.recordPresentOrValidate(kVideoFrame, /*presented=*/true, ms2ns(1));
+    }
+
+    // A single validate request does not stop skipping validates for those frames.
+    predictor.recordPresentOrValidate(kVideoFrame, /*presented=*/false, ms2ns(1));
+    EXPECT_TRUE(predictor.shouldTryPresentOrValidate(kVideoFrame));
+}
+
+TEST(PresentOrValidatePredictorTest, probesAgainAfterValidating) {
+    PresentOrValidatePredictor predictor;
+    ASSERT_TRUE(predictor.shouldTryPresentOrValidate(kScrollingFrame));
+    predictor.recordPresentOrValidate(kScrollingFrame, /*presented=*/false, ms2ns(1));
+
+    int validatedFrames = 0;
+    while (!predictor.shouldTryPresentOrValidate(kScrollingFrame) && validatedFrames < 1000) {
+        validatedFrames++;
+    }
+    EXPECT_GT(validatedFrames, 0);
+    EXPECT_LT(validatedFrames, 1000);
+}
+
+TEST(PresentOrValidatePredictorTest, dumpsStatistics) {
+    PresentOrValidatePredictor predictor;
+    predictor.recordValidate(ms2ns(2));
+    predictor.recordPresentOrValidate(kVideoFrame, /*presented=*/true, ms2ns(1));
+    predictor.recordPresentOrValidate(kScrollingFrame, /*presented=*/false, ms2ns(2));
+
+    std::string result;
+    predictor.dump(result);
+    EXPECT_NE(std::string::npos, result.find("2 tried, 1 presented, 50.0% mispredicted"));
+    EXPECT_NE(std::string::npos, result.find("estimated HAL time saved 2.000 ms"));
+}
+
+} // namespace
+} // namespace android::Hwc2
@@ -1319,6 +1319,42 @@ TEST_F(RefreshRateConfigsTest, primaryVsAppRequestPolicy) {
     EXPECT_EQ(HWC_CONFIG_ID_60, getFrameRate(LayerVoteType::ExplicitExactOrMultiple, 90.f));
 }
 
+TEST_F(RefreshRateConfigsTest, getBestRefreshRate_cachedResultFollowsPolicy) {
+    auto refreshRateConfigs =
+            std::make_unique<RefreshRateConfigs>(m60_90Device,
+                                                 /*currentConfigId=*/HWC_CONFIG_ID_60);
+
+    auto layers = std::vector<LayerRequirement>{LayerRequirement{.weight = 1.0f}};
+    layers[0].vote = LayerVoteType::Max;
+    layers[0].name = "Max";
+
+    RefreshRateConfigs::GlobalSignals consideredSignals;
+    EXPECT_EQ(mExpected90Config,
+              refreshRateConfigs->getBestRefreshRate(layers, {.touch = true, .idle = false},
+                                                     &consideredSignals));
+    EXPECT_TRUE(consideredSignals.touch);
+
+    // The same layers again, under another name, give the same answer.
+    layers[0].name = "Max again";
+    consideredSignals = {};
+    EXPECT_EQ(mExpected90Config,
+              refreshRateConfigs->getBestRefreshRate(layers, {.touch = true, .idle = false},
+                                                     &consideredSignals));
+    EXPECT_TRUE(consideredSignals.touch);
+
+    ASSERT_GE(refreshRateConfigs->setDisplayManagerPolicy({HWC_CONFIG_ID_60, {60.f, 60.f}}), 0);
+    EXPECT_EQ(mExpected60Config,
+              refreshRateConfigs->getBestRefreshRate(layers, {.touch = true, .idle = false},
+                                                     &consideredSignals));
+
+    ASSERT_GE(refreshRateConfigs->setOverridePolicy(
+                      RefreshRateConfigs::Policy{HWC_CONFIG_ID_90, {90.f, 90.f}}),
+              0);
+    EXPECT_EQ(mExpected90Config,
+              refreshRateConfigs->getBestRefreshRate(layers, {.touch = true, .idle = false},
+                                                     &consideredSignals));
+}
+
 TEST_F(RefreshRateConfigsTest, idle) {
     auto refreshRateConfigs =
             std::make_unique<RefreshRateConfigs>(m60_90Device,
@@ -329,6 +329,9 @@ public:
 
     auto onMessageReceived(int32_t what) { return mFlinger->onMessageReceived(what, systemTime()); }
 
+    // Must be called after editing mutableDrawingState() layers directly, as a commit would.
+    auto rebuildDrawingLayersInZOrder() { return mFlinger->rebuildDrawingLayersInZOrder(); }
+
     auto captureScreenImplLocked(const RenderArea& renderArea,
                                  SurfaceFlinger::TraverseLayersFunction traverseLayers,
                                  ANativeWindowBuffer* buffer, bool useIdentityTransform,
@@ -364,6 +367,7 @@ public:
     }
 
     auto flushTransactionQueues() { return mFlinger->flushTransactionQueues(); };
+    auto transactionFlushNeeded() { return mFlinger->transactionFlushNeeded(); };
 
     /* ------------------------------------------------------------------------
      * Read-only access to private data to assert post-conditions.
@@ -394,6 +394,19 @@ TEST_F(TimeStatsTest, canIncreaseCompositionStrategyChanges) {
     EXPECT_THAT(result, HasSubstr(expectedResult));
 }
 
+TEST_F(TimeStatsTest, canRecordParallelComposition) {
+    // this stat is not in the proto so verify by checking the string dump
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+    mTimeStats->recordParallelComposition(std::chrono::nanoseconds(6ms).count(),
+                                          std::chrono::nanoseconds(4ms).count());
+    mTimeStats->recordParallelComposition(std::chrono::nanoseconds(8ms).count(),
+                                          std::chrono::nanoseconds(5ms).count());
+
+    const std::string result(inputCommand(InputCommand::DUMP_ALL, FMT_STRING));
+    EXPECT_THAT(result, HasSubstr("parallelCompositionFrames = 2"));
+    EXPECT_THAT(result, HasSubstr("parallelCompositionTimeSaved = 5 ms"));
+}
+
 TEST_F(TimeStatsTest, canAverageFrameDuration) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
     mTimeStats->setPowerMode(PowerMode::ON);
@@ -585,6 +598,21 @@ TEST_F(TimeStatsTest, canInsertMultipleLayersTimeStats) {
     EXPECT_EQ(2, globalProto.stats_size());
 }
 
+TEST_F(TimeStatsTest, countsFramesPresentedBetweenFlushes) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    // Presented frames are added to the stats in batches, so leave some out of the last one.
+    for (uint64_t frameNumber = 1; frameNumber <= 21; frameNumber++) {
+        insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, frameNumber, frameNumber * 1000000);
+    }
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(1, globalProto.stats_size());
+    EXPECT_EQ(20, globalProto.stats(0).total_frames());
+}
+
 TEST_F(TimeStatsTest, canInsertUnorderedLayerTimeStats) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
 
@@ -67,13 +67,15 @@ public:
         EXPECT_CALL(*eventThread, registerDisplayEventConnection(_));
         EXPECT_CALL(*eventThread, createEventConnection(_, _))
                 .WillOnce(Return(
-                        new EventThreadConnection(eventThread.get(), ResyncCallback(),
+                        new EventThreadConnection(eventThread.get(), /*callingUid=*/0,
+                                                  ResyncCallback(),
                                                   ISurfaceComposer::eConfigChangedSuppress)));
 
         EXPECT_CALL(*sfEventThread, registerDisplayEventConnection(_));
         EXPECT_CALL(*sfEventThread, createEventConnection(_, _))
                 .WillOnce(Return(
-                        new EventThreadConnection(sfEventThread.get(), ResyncCallback(),
+                        new EventThreadConnection(sfEventThread.get(), /*callingUid=*/0,
+                                                  ResyncCallback(),
                                                   ISurfaceComposer::eConfigChangedSuppress)));
 
         EXPECT_CALL(*mPrimaryDispSync, computeNextRefresh(0, _)).WillRepeatedly(Return(0));
@@ -283,6 +285,33 @@ TEST_F(TransactionApplicationTest, Flush_RemovesFromQueue) {
     EXPECT_EQ(0, transactionQueue.size());
 }
 
+TEST_F(TransactionApplicationTest, Flush_SchedulesWakeupForDeferredTransaction) {
+    ASSERT_EQ(0, mFlinger.getTransactionQueue().size());
+    // called in SurfaceFlinger::signalTransaction
+    EXPECT_CALL(*mMessageQueue, invalidate()).Times(1);
+    EXPECT_CALL(*mPrimaryDispSync, expectedPresentTime(_)).WillRepeatedly(Return(nsecs_t(0)));
+
+    TransactionInfo transaction;
+    setupSingle(transaction, /*flags*/ 0, /*syncInputWindows*/ false,
+                /*desiredPresentTime*/ ms2ns(500));
+    mFlinger.setTransactionState(transaction.states, transaction.displays, transaction.flags,
+                                 transaction.applyToken, transaction.inputWindowCommands,
+                                 transaction.desiredPresentTime, transaction.uncacheBuffer,
+                                 mHasListenerCallbacks, mCallbacks);
+    ASSERT_EQ(1, mFlinger.getTransactionQueue().size());
+
+    // The transaction is only waiting for its desiredPresentTime, so rather than checking it
+    // again on every frame, the flush schedules a single wakeup for when it is due.
+    EXPECT_CALL(*mMessageQueue, postMessageDelayed(_, _)).Times(1);
+    mFlinger.flushTransactionQueues();
+    EXPECT_EQ(1, mFlinger.getTransactionQueue().size());
+    EXPECT_FALSE(mFlinger.transactionFlushNeeded());
+
+    // A second flush before the wakeup keeps the pending one.
+    mFlinger.flushTransactionQueues();
+    EXPECT_EQ(1, mFlinger.getTransactionQueue().size());
+}
+
 TEST_F(TransactionApplicationTest, NotPlacedOnTransactionQueue_Synchronous) {
     NotPlacedOnTransactionQueue(ISurfaceComposer::eSynchronous, /*syncInputWindows*/ false);
 }
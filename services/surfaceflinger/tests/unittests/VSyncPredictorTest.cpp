@@ -450,6 +450,38 @@ TEST_F(VSyncPredictorTest, aPhoneThatHasBeenAroundAWhileCanStillComputePeriod) {
     EXPECT_THAT(intercept, Eq(0));
 }
 
+TEST_F(VSyncPredictorTest, keepsModelAcrossManyEvictions) {
+    auto constexpr kNumVsyncs = 100 * kHistorySize;
+    auto constexpr bias = 10;
+    auto const simulatedVsyncs = generateVsyncTimestamps(kNumVsyncs, mPeriod, bias);
+
+    for (auto const& timestamp : simulatedVsyncs) {
+        EXPECT_TRUE(tracker.addVsyncTimestamp(timestamp));
+    }
+
+    auto [slope, intercept] = tracker.getVSyncPredictionModel();
+    EXPECT_THAT(slope, Eq(mPeriod));
+    EXPECT_THAT(intercept, Eq(0));
+    EXPECT_THAT(tracker.nextAnticipatedVSyncTimeFrom(simulatedVsyncs.back()),
+                Eq(simulatedVsyncs.back() + mPeriod));
+}
+
+TEST_F(VSyncPredictorTest, keepsModelAfterEvictingEarliestOutOfOrderTimestamp) {
+    auto const vsyncs = generateVsyncTimestamps(kHistorySize + 2, mPeriod, 5 * mPeriod);
+    // The second timestamp is the earliest, and is evicted after the first.
+    tracker.addVsyncTimestamp(vsyncs[1]);
+    tracker.addVsyncTimestamp(vsyncs[0]);
+    for (auto i = 2u; i < vsyncs.size(); i++) {
+        tracker.addVsyncTimestamp(vsyncs[i]);
+    }
+
+    auto [slope, intercept] = tracker.getVSyncPredictionModel();
+    EXPECT_THAT(slope, Eq(mPeriod));
+    EXPECT_THAT(intercept, Eq(0));
+    EXPECT_THAT(tracker.nextAnticipatedVSyncTimeFrom(vsyncs.back() + 1),
+                Eq(vsyncs.back() + mPeriod));
+}
+
 } // namespace android::scheduler
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
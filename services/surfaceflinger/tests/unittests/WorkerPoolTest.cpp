@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "WorkerPool.h"
+
+namespace android {
+namespace {
+
+TEST(WorkerPoolTest, runsEveryIndexOnce) {
+    WorkerPool pool(2, "WorkerPoolTest");
+    std::vector<std::atomic<int>> calls(100);
+
+    pool.run(calls.size(), [&](size_t index) { calls[index]++; });
+
+    for (const auto& count : calls) {
+        EXPECT_EQ(1, count);
+    }
+}
+
+TEST(WorkerPoolTest, runsBatchesOneAfterAnother) {
+    WorkerPool pool(3, "WorkerPoolTest");
+    for (size_t batch = 1; batch <= 50; batch++) {
+        std::atomic<size_t> sum = 0;
+        pool.run(batch, [&](size_t index) { sum += index + 1; });
+        EXPECT_EQ(batch * (batch + 1) / 2, sum);
+    }
+}
+
+TEST(WorkerPoolTest, emptyBatchReturns) {
+    WorkerPool pool(2, "WorkerPoolTest");
+    pool.run(0, [](size_t) { FAIL(); });
+}
+
+TEST(WorkerPoolTest, spreadsWorkOverThreads) {
+    WorkerPool pool(2, "WorkerPoolTest");
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<size_t> started = 0;
+
+    // Each item waits for all three to start, so each must run on its own thread.
+    pool.run(3, [&](size_t) {
+        {
+            std::lock_guard lock(mutex);
+            threads.insert(std::this_thread::get_id());
+        }
+        started++;
+        while (started < 3) {
+            std::this_thread::yield();
+        }
+    });
+
+    EXPECT_EQ(3u, threads.size());
+}
+
+} // namespace
+} // namespace android
@@ -96,6 +96,8 @@ public:
     MOCK_METHOD1(getClientTargetProperty, hal::Error(hal::ClientTargetProperty*));
     MOCK_CONST_METHOD1(getConnectionType, hal::Error(android::DisplayConnectionType*));
     MOCK_CONST_METHOD0(isVsyncPeriodSwitchSupported, bool());
+    MOCK_CONST_METHOD0(getLayerCommandCounts, HWC2::LayerCommandCounts());
+    MOCK_CONST_METHOD0(getLayerCount, size_t());
 };
 
 } // namespace mock
@@ -43,6 +43,9 @@ public:
     MOCK_METHOD1(requestLatestConfig, void(const sp<android::EventThreadConnection> &));
     MOCK_METHOD1(pauseVsyncCallback, void(bool));
     MOCK_METHOD0(getEventThreadConnectionCount, size_t());
+    MOCK_METHOD1(setFrameRateDividers, void(FrameRateDividers));
+    MOCK_METHOD1(setDispatchDelays, void(DispatchDelays));
+    MOCK_CONST_METHOD2(getLastVSyncDispatchTime, nsecs_t(uid_t, nsecs_t));
 };
 
 } // namespace mock
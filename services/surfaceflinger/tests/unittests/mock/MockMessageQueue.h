@@ -32,6 +32,7 @@ public:
     MOCK_METHOD1(setEventConnection, void(const sp<EventThreadConnection>& connection));
     MOCK_METHOD0(waitMessage, void());
     MOCK_METHOD1(postMessage, void(sp<MessageHandler>&&));
+    MOCK_METHOD2(postMessageDelayed, void(sp<MessageHandler>&&, nsecs_t));
     MOCK_METHOD0(invalidate, void());
     MOCK_METHOD0(refresh, void());
 };
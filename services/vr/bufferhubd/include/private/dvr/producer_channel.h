@@ -58,6 +58,11 @@ class ProducerChannel : public BufferHubChannel {
   pdx::Status<uint32_t> CreateConsumerStateMask();
   pdx::Status<RemoteChannelHandle> OnNewConsumer(Message& message);
 
+  // Also invoked by the producer queue for batched gains and posts, in which
+  // case |message| is the queue's impulse.
+  pdx::Status<void> OnProducerPost(Message& message, LocalFence acquire_fence);
+  pdx::Status<LocalFence> OnProducerGain(Message& message);
+
   pdx::Status<LocalFence> OnConsumerAcquire(Message& message);
   pdx::Status<void> OnConsumerRelease(Message& message,
                                       LocalFence release_fence);
@@ -105,8 +110,6 @@ class ProducerChannel : public BufferHubChannel {
 
   int InitializeBuffer();
   pdx::Status<BufferDescription<BorrowedHandle>> OnGetBuffer(Message& message);
-  pdx::Status<void> OnProducerPost(Message& message, LocalFence acquire_fence);
-  pdx::Status<LocalFence> OnProducerGain(Message& message);
 
   // Remove consumer from atomics in shared memory based on consumer_state_mask.
   // This function is used for clean up for failures in CreateConsumer method.
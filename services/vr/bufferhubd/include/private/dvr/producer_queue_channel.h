@@ -54,6 +54,10 @@ class ProducerQueueChannel : public BufferHubChannel {
                        const ProducerQueueConfig& config,
                        const UsagePolicy& usage_policy, int* error);
 
+  // Forwards a batched gain or post impulse to the producer channel of every
+  // slot set in the impulse's slot mask.
+  void OnProducerQueueBatch(pdx::Message& message);
+
   // Allocate one single producer buffer by |OnProducerQueueAllocateBuffers|.
   // Note that the newly created buffer's file handle will be pushed to client
   // and our return type is a RemoteChannelHandle.
@@ -1,4 +1,5 @@
 #include <inttypes.h>
+#include <string.h>
 
 #include <private/dvr/consumer_queue_channel.h>
 #include <private/dvr/producer_channel.h>
@@ -90,8 +91,14 @@ bool ProducerQueueChannel::HandleMessage(Message& message) {
   }
 }
 
-void ProducerQueueChannel::HandleImpulse(Message& /* message */) {
+void ProducerQueueChannel::HandleImpulse(Message& message) {
   ATRACE_NAME("ProducerQueueChannel::HandleImpulse");
+  switch (message.GetOp()) {
+    case BufferHubRPC::ProducerQueueGainBuffers::Opcode:
+    case BufferHubRPC::ProducerQueuePostBuffers::Opcode:
+      OnProducerQueueBatch(message);
+      break;
+  }
 }
 
 BufferHubChannel::BufferInfo ProducerQueueChannel::GetBufferInfo() const {
@@ -384,6 +391,36 @@ Status<void> ProducerQueueChannel::OnProducerQueueRemoveBuffer(
   return {};
 }
 
+void ProducerQueueChannel::OnProducerQueueBatch(Message& message) {
+  ATRACE_NAME("ProducerQueueChannel::OnProducerQueueBatch");
+  uint64_t slot_mask = 0;
+  memcpy(&slot_mask, message.ImpulseBegin(), sizeof(slot_mask));
+  const bool post =
+      message.GetOp() == BufferHubRPC::ProducerQueuePostBuffers::Opcode;
+  ALOGD_IF(TRACE,
+           "ProducerQueueChannel::OnProducerQueueBatch: queue_id=%d post=%d "
+           "slot_mask=%" PRIx64,
+           buffer_id(), post, slot_mask);
+
+  for (size_t slot = 0; slot < BufferHubRPC::kMaxQueueCapacity; slot++) {
+    if (!(slot_mask & (1ULL << slot)))
+      continue;
+
+    auto buffer = buffers_[slot].lock();
+    if (!buffer) {
+      ALOGW(
+          "ProducerQueueChannel::OnProducerQueueBatch: No buffer in slot=%zu, "
+          "queue_id=%d",
+          slot, buffer_id());
+      continue;
+    }
+    if (post)
+      buffer->OnProducerPost(message, {});
+    else
+      buffer->OnProducerGain(message);
+  }
+}
+
 void ProducerQueueChannel::AddConsumer(ConsumerQueueChannel* channel) {
   consumer_channels_.push_back(channel);
 }
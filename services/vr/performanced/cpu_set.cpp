@@ -88,8 +88,70 @@ std::unique_ptr<CpuSet> CpuSetManager::Create(base::unique_fd base_fd,
   return group;
 }
 
+void CpuSetManager::AddNewChildren(CpuSet* parent) {
+  // Open the directory afresh rather than dup'ing the group's fd: dup'ed fds
+  // share the directory offset, which the initial scan left at the end.
+  DirectoryReader directory(
+      base::unique_fd(openat(parent->cpuset_fd_.get(), ".", kDirectoryFlags)));
+  if (!directory) {
+    ALOGE("CpuSet::AddNewChildren: Failed to opendir %s cpuset: %s",
+          parent->path().c_str(), strerror(directory.GetError()));
+    return;
+  }
+
+  while (dirent* entry = directory.Next()) {
+    if (entry->d_type != DT_DIR)
+      continue;
+
+    std::string directory_name(entry->d_name);
+    if (directory_name == "." || directory_name == "..")
+      continue;
+
+    auto known = std::find_if(
+        parent->children_.begin(), parent->children_.end(),
+        [&directory_name](const std::unique_ptr<CpuSet>& child) {
+          return child->name() == directory_name;
+        });
+    if (known != parent->children_.end())
+      continue;
+
+    base::unique_fd entry_fd(openat(parent->cpuset_fd_.get(),
+                                    directory_name.c_str(), kDirectoryFlags));
+    if (entry_fd.get() < 0) {
+      ALOGE("CpuSet::AddNewChildren: Failed to openat \"%s\": %s",
+            entry->d_name, strerror(errno));
+      continue;
+    }
+
+    if (auto child = Create(std::move(entry_fd), directory_name, parent))
+      parent->AddChild(std::move(child));
+  }
+}
+
 CpuSet* CpuSetManager::Lookup(const std::string& path) {
   auto search = path_map_.find(path);
+  if (search != path_map_.end())
+    return search->second;
+  if (!root_set_ || path.empty() || path[0] != '/')
+    return nullptr;
+
+  // Find the closest ancestor already in the hierarchy and pick up any groups
+  // created under it since the last scan.
+  CpuSet* ancestor = nullptr;
+  std::string ancestor_path = path;
+  while (!ancestor) {
+    const size_t slash = ancestor_path.rfind('/');
+    ancestor_path = slash == 0 ? "/" : ancestor_path.substr(0, slash);
+    search = path_map_.find(ancestor_path);
+    if (search != path_map_.end())
+      ancestor = search->second;
+    else if (ancestor_path == "/")
+      return nullptr;
+  }
+
+  AddNewChildren(ancestor);
+
+  search = path_map_.find(path);
   if (search != path_map_.end())
     return search->second;
   else
@@ -282,6 +344,26 @@ std::string CpuSet::GetCpuList() const {
   return "";
 }
 
+size_t CpuSet::GetCpuCount() const {
+  // The cpu list is a comma separated list of cpus and inclusive cpu ranges,
+  // for example "0-3,6".
+  size_t count = 0;
+  std::istringstream list_stream(GetCpuList());
+  for (std::string item; std::getline(list_stream, item, ',');) {
+    char* end = nullptr;
+    const long first = std::strtol(item.c_str(), &end, 10);
+    if (end == item.c_str())
+      continue;
+
+    long last = first;
+    if (*end == '-')
+      last = std::strtol(end + 1, nullptr, 10);
+    if (last >= first)
+      count += last - first + 1;
+  }
+  return count;
+}
+
 void CpuSet::AddChild(std::unique_ptr<CpuSet> child) {
   children_.push_back(std::move(child));
 }
@@ -31,6 +31,9 @@ class CpuSet {
 
   std::string GetCpuList() const;
 
+  // Returns the number of CPUs in this group's cpu list.
+  size_t GetCpuCount() const;
+
   pdx::Status<void> AttachTask(pid_t task_id) const;
   std::vector<pid_t> GetTasks() const;
 
@@ -70,9 +73,10 @@ class CpuSetManager {
   // system, which is usually /dev/cpuset.
   void Load(const std::string& cpuset_root);
 
-  // Lookup and return a CpuSet from a cpuset path. Ownership of the pointer
-  // DOES NOT pass to the caller; the pointer remains valid as long as the
-  // CpuSet hierarchy is valid.
+  // Lookup and return a CpuSet from a cpuset path. Cpusets created after
+  // Load() are picked up by rescanning only the directory of the closest known
+  // ancestor of |path|. Ownership of the pointer DOES NOT pass to the caller;
+  // the pointer remains valid as long as the CpuSet hierarchy is valid.
   CpuSet* Lookup(const std::string& path);
 
   // Returns a vector of all the cpusets found at initializaiton. Ownership of
@@ -95,6 +99,10 @@ class CpuSetManager {
   std::unique_ptr<CpuSet> Create(base::unique_fd base_fd,
                                  const std::string& name, CpuSet* parent);
 
+  // Adds groups for directories under |parent| that are not in the hierarchy
+  // yet. Existing groups are left untouched.
+  void AddNewChildren(CpuSet* parent);
+
   std::unique_ptr<CpuSet> root_set_;
   std::unordered_map<std::string, CpuSet*> path_map_;
 
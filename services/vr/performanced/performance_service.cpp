@@ -1,9 +1,14 @@
 #include "performance_service.h"
 
+#include <inttypes.h>
+
+#include <algorithm>
+#include <iomanip>
 #include <sstream>
 
 #include <sched.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include <pdx/default_transport/service_endpoint.h>
@@ -19,6 +24,11 @@
 // This prctl is only available in Android kernels.
 #define PR_SET_TIMERSLACK_PID 41
 
+// SCHED_DEADLINE and sched_setattr() are not exposed by the C library.
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
 using android::dvr::IsTrustedUid;
 using android::dvr::Task;
 using android::pdx::ErrorStatus;
@@ -40,6 +50,43 @@ const bool kAllowAppsToRequestVrAppRenderPolicy = false;
 constexpr unsigned long kTimerSlackForegroundNs = 50000;
 constexpr unsigned long kTimerSlackBackgroundNs = 40000000;
 
+// Bandwidth, in CPUs, that deadline tasks on SCHED_FIFO may reserve in a
+// performance cpuset per CPU in it. Matches the kernel's default real-time
+// bandwidth limit, which also bounds SCHED_DEADLINE admission.
+constexpr double kMaxFifoDeadlineBandwidthPerCpu = 0.95;
+
+// Deadline tasks placed on SCHED_FIFO get deadline monotonic priorities: the
+// shorter the deadline the higher the priority, with an offset from the medium
+// FIFO priority that stays below audio:high.
+constexpr struct {
+  uint64_t max_deadline_ns;
+  int priority_offset;
+} kFifoDeadlinePriorities[] = {
+    {4000000, 2},
+    {12000000, 1},
+};
+
+// Minimum interval between deadline miss log messages for a single task.
+constexpr std::chrono::seconds kDeadlineMissLogInterval{1};
+
+constexpr uint64_t kSchedFlagResetOnFork = 0x01;
+
+// Mirrors struct sched_attr from the kernel's uapi headers.
+struct SchedulerAttributes {
+  uint32_t size;
+  uint32_t sched_policy;
+  uint64_t sched_flags;
+  int32_t sched_nice;
+  uint32_t sched_priority;
+  uint64_t sched_runtime;
+  uint64_t sched_deadline;
+  uint64_t sched_period;
+};
+
+int SetSchedulerAttributes(pid_t task_id, const SchedulerAttributes& attr) {
+  return syscall(__NR_sched_setattr, task_id, &attr, 0);
+}
+
 // Expands the given parameter pack expression using an initializer list to
 // guarantee ordering and a comma expression to guarantee even void expressions
 // are valid elements of the initializer list.
@@ -152,6 +199,12 @@ PerformanceService::PerformanceService()
 
   partition_permission_check_ = AllowRootSystemTrusted::Check;
 
+  // Deadline policies may start real-time threads, so they get the same
+  // callers as the real-time scheduler classes.
+  deadline_permission_check_ =
+      CheckOr<AllowRootSystemGraphics, AllowRootSystemAudio,
+              AllowRootSystemTrusted>::Check;
+
   // Setup the scheduler classes.
   // TODO(eieio): Replace this with a device-specific config file.
   scheduler_policies_ = {
@@ -235,6 +288,58 @@ std::string PerformanceService::DumpState(size_t /*max_length*/) {
   std::ostringstream stream;
   stream << "vr_app_render_thread: " << vr_app_render_thread_ << std::endl;
   cpuset_.DumpState(stream);
+
+  PruneDeadlineTasks();
+  stream << std::endl;
+  stream << std::left;
+  stream << std::setw(8) << "Task";
+  stream << " ";
+  stream << std::setw(8) << "Policy";
+  stream << " ";
+  stream << std::setw(26) << "Runtime/Deadline/Period";
+  stream << " ";
+  stream << std::setw(24) << "Cpuset";
+  stream << " ";
+  stream << std::setw(8) << "Misses";
+  stream << " ";
+  stream << std::setw(12) << "Max Late us";
+  stream << std::endl;
+
+  stream << std::string(8, '_');
+  stream << " ";
+  stream << std::string(8, '_');
+  stream << " ";
+  stream << std::string(26, '_');
+  stream << " ";
+  stream << std::string(24, '_');
+  stream << " ";
+  stream << std::string(8, '_');
+  stream << " ";
+  stream << std::string(12, '_');
+  stream << std::endl;
+
+  for (const auto& pair : deadline_tasks_) {
+    const DeadlineTask& entry = pair.second;
+    std::ostringstream parameters;
+    parameters << entry.runtime_ns / 1000 << "/" << entry.deadline_ns / 1000
+               << "/" << entry.period_ns / 1000 << "us";
+
+    stream << std::left;
+    stream << std::setw(8) << pair.first;
+    stream << " ";
+    stream << std::setw(8) << (entry.sched_deadline ? "deadline" : "fifo");
+    stream << " ";
+    stream << std::setw(26) << parameters.str();
+    stream << " ";
+    stream << std::setw(24) << entry.cpuset;
+    stream << " ";
+    stream << std::right;
+    stream << std::setw(8) << entry.miss_count;
+    stream << " ";
+    stream << std::setw(12) << entry.max_lateness_ns / 1000;
+    stream << std::endl;
+  }
+
   return stream.str();
 }
 
@@ -268,6 +373,9 @@ Status<void> PerformanceService::OnSetSchedulerPolicy(
       SetVrAppRenderThread(task_id);
     }
 
+    // The named policy replaces any deadline policy the task had.
+    deadline_tasks_.erase(task_id);
+
     // Get the thread group's cpu set. Policies that do not specify a cpuset
     // should default to this cpuset.
     std::string thread_group_cpuset;
@@ -367,6 +475,8 @@ Status<void> PerformanceService::OnSetSchedulerClass(
       SetVrAppRenderThread(task_id);
     }
 
+    deadline_tasks_.erase(task_id);
+
     struct sched_param param;
     param.sched_priority = config.priority;
 
@@ -396,6 +506,235 @@ Status<std::string> PerformanceService::OnGetCpuPartition(Message& message,
   return task.GetCpuSetPath();
 }
 
+Status<void> PerformanceService::OnSetDeadlinePolicy(Message& message,
+                                                     pid_t task_id,
+                                                     uint64_t runtime_ns,
+                                                     uint64_t deadline_ns,
+                                                     uint64_t period_ns) {
+  ALOGI(
+      "PerformanceService::OnSetDeadlinePolicy: task_id=%d runtime_ns=%" PRIu64
+      " deadline_ns=%" PRIu64 " period_ns=%" PRIu64,
+      task_id, runtime_ns, deadline_ns, period_ns);
+
+  Task task(task_id);
+  if (!task)
+    return ErrorStatus(EINVAL);
+  if (deadline_permission_check_ &&
+      !deadline_permission_check_(message, task)) {
+    return ErrorStatus(EPERM);
+  }
+
+  PruneDeadlineTasks();
+
+  if (runtime_ns == 0) {
+    ClearDeadlinePolicy(task_id);
+    return {};
+  }
+
+  if (period_ns == 0)
+    period_ns = deadline_ns;
+  if (runtime_ns > deadline_ns || deadline_ns > period_ns)
+    return ErrorStatus(EINVAL);
+
+  // Release the task's previous reservation before admitting the new one.
+  deadline_tasks_.erase(task_id);
+  if (task_id == vr_app_render_thread_)
+    vr_app_render_thread_ = -1;
+
+  DeadlineTask entry;
+  entry.thread_group_id = task.thread_group_id();
+  entry.runtime_ns = runtime_ns;
+  entry.deadline_ns = deadline_ns;
+  entry.period_ns = period_ns;
+  entry.bandwidth = static_cast<double>(runtime_ns) / period_ns;
+
+  // The kernel performs admission control for SCHED_DEADLINE and requires the
+  // task's affinity to span its root domain, so the task keeps its cpuset.
+  SchedulerAttributes attr = {};
+  attr.size = sizeof(attr);
+  attr.sched_policy = SCHED_DEADLINE;
+  attr.sched_flags = kSchedFlagResetOnFork;
+  attr.sched_runtime = runtime_ns;
+  attr.sched_deadline = deadline_ns;
+  attr.sched_period = period_ns;
+
+  if (SetSchedulerAttributes(task_id, attr) == 0) {
+    entry.sched_deadline = true;
+    entry.cpuset = task.GetCpuSetPath();
+  } else {
+    const int error = errno;
+    if (error != EBUSY && error != EPERM && error != EINVAL &&
+        error != ENOSYS) {
+      ALOGE(
+          "PerformanceService::OnSetDeadlinePolicy: Failed to set "
+          "SCHED_DEADLINE on task_id=%d: %s",
+          task_id, strerror(error));
+      return ErrorStatus(error);
+    }
+
+    ALOGI(
+        "PerformanceService::OnSetDeadlinePolicy: SCHED_DEADLINE unavailable "
+        "for task_id=%d (%s); falling back to SCHED_FIFO.",
+        task_id, strerror(error));
+    auto status = PlaceDeadlineTaskOnFifo(task, deadline_ns, entry.bandwidth);
+    if (!status)
+      return status.error_status();
+    entry.sched_deadline = false;
+    entry.cpuset = status.take();
+  }
+
+  prctl(PR_SET_TIMERSLACK_PID, kTimerSlackForegroundNs, task_id);
+  deadline_tasks_.emplace(task_id, std::move(entry));
+  return {};
+}
+
+Status<std::string> PerformanceService::PlaceDeadlineTaskOnFifo(
+    const Task& task, uint64_t deadline_ns, double bandwidth) {
+  std::string thread_group_cpuset;
+  Task thread_group{task.thread_group_id()};
+  if (thread_group)
+    thread_group_cpuset = thread_group.GetCpuSetPath();
+  else
+    thread_group_cpuset = kRootCpuSet;
+
+  // System processes get the system performance partition, everything else
+  // the application one.
+  const std::string performance_cpuset =
+      thread_group_cpuset.compare(0, 7, "/system") == 0
+          ? "/system/performance"
+          : "/application/performance";
+
+  std::string target_cpuset = thread_group_cpuset;
+  if (auto performance_set = cpuset_.Lookup(performance_cpuset)) {
+    double admitted_bandwidth = bandwidth;
+    for (const auto& pair : deadline_tasks_) {
+      if (!pair.second.sched_deadline &&
+          pair.second.cpuset == performance_cpuset) {
+        admitted_bandwidth += pair.second.bandwidth;
+      }
+    }
+
+    const double capacity =
+        performance_set->GetCpuCount() * kMaxFifoDeadlineBandwidthPerCpu;
+    if (admitted_bandwidth <= capacity) {
+      target_cpuset = performance_cpuset;
+    } else {
+      ALOGW(
+          "PerformanceService::PlaceDeadlineTaskOnFifo: cpuset=%s is full "
+          "(%.2f of %.2f CPUs); leaving task_id=%d in cpuset=%s.",
+          performance_cpuset.c_str(), admitted_bandwidth, capacity,
+          task.task_id(), thread_group_cpuset.c_str());
+    }
+  }
+
+  if (auto target_set = cpuset_.Lookup(target_cpuset)) {
+    auto attach_status = target_set->AttachTask(task.task_id());
+    ALOGW_IF(!attach_status,
+             "PerformanceService::PlaceDeadlineTaskOnFifo: Failed to attach "
+             "task=%d to cpuset=%s: %s",
+             task.task_id(), target_cpuset.c_str(),
+             attach_status.GetErrorMessage().c_str());
+  }
+
+  const int fifo_range = sched_fifo_max_priority_ - sched_fifo_min_priority_;
+  struct sched_param param;
+  param.sched_priority = sched_fifo_min_priority_ + fifo_range / 5;
+  for (const auto& level : kFifoDeadlinePriorities) {
+    if (deadline_ns <= level.max_deadline_ns) {
+      param.sched_priority += level.priority_offset;
+      break;
+    }
+  }
+
+  if (sched_setscheduler(task.task_id(), SCHED_FIFO | SCHED_RESET_ON_FORK,
+                         &param) < 0) {
+    const int error = errno;
+    ALOGE(
+        "PerformanceService::PlaceDeadlineTaskOnFifo: Failed to set "
+        "SCHED_FIFO on task_id=%d: %s",
+        task.task_id(), strerror(error));
+    return ErrorStatus(error);
+  }
+
+  return target_cpuset;
+}
+
+void PerformanceService::ClearDeadlinePolicy(pid_t task_id) {
+  auto search = deadline_tasks_.find(task_id);
+  if (search == deadline_tasks_.end())
+    return;
+
+  struct sched_param param;
+  param.sched_priority = 0;
+  if (sched_setscheduler(task_id, SCHED_NORMAL, &param) < 0) {
+    ALOGE(
+        "PerformanceService::ClearDeadlinePolicy: Failed to restore "
+        "SCHED_NORMAL on task_id=%d: %s",
+        task_id, strerror(errno));
+  }
+
+  // Threads moved into a performance cpuset go back to their thread group's.
+  if (!search->second.sched_deadline) {
+    Task thread_group{search->second.thread_group_id};
+    if (thread_group && search->second.cpuset != thread_group.GetCpuSetPath()) {
+      if (auto target_set = cpuset_.Lookup(thread_group.GetCpuSetPath()))
+        target_set->AttachTask(task_id);
+    }
+  }
+
+  deadline_tasks_.erase(search);
+}
+
+void PerformanceService::PruneDeadlineTasks() {
+  for (auto it = deadline_tasks_.begin(); it != deadline_tasks_.end();) {
+    // Thread ids are recycled, so check that the thread group still matches.
+    Task task(it->first);
+    if (!task || task.thread_group_id() != it->second.thread_group_id)
+      it = deadline_tasks_.erase(it);
+    else
+      ++it;
+  }
+}
+
+Status<void> PerformanceService::OnReportDeadlineMiss(Message& message,
+                                                      pid_t task_id,
+                                                      uint64_t lateness_ns) {
+  Task task(task_id);
+  if (!task)
+    return ErrorStatus(EINVAL);
+  if (task.thread_group_id() != message.GetProcessId())
+    return ErrorStatus(EPERM);
+
+  auto search = deadline_tasks_.find(task_id);
+  if (search == deadline_tasks_.end() ||
+      search->second.thread_group_id != task.thread_group_id()) {
+    return ErrorStatus(ENOENT);
+  }
+
+  DeadlineTask& entry = search->second;
+  entry.miss_count++;
+  entry.unlogged_miss_count++;
+  entry.max_lateness_ns = std::max(entry.max_lateness_ns, lateness_ns);
+
+  // Rate limit the log so that a thread that misses every period does not
+  // flood it.
+  const auto now = std::chrono::steady_clock::now();
+  if (now - entry.last_miss_log_time >= kDeadlineMissLogInterval) {
+    ALOGW(
+        "Deadline miss: task_id=%d name=%s lateness_us=%" PRIu64
+        " misses=%" PRIu64 " (%" PRIu64 " since last report) policy=%s "
+        "runtime_us=%" PRIu64 " deadline_us=%" PRIu64 " period_us=%" PRIu64,
+        task_id, task.name().c_str(), lateness_ns / 1000, entry.miss_count,
+        entry.unlogged_miss_count,
+        entry.sched_deadline ? "deadline" : "fifo", entry.runtime_ns / 1000,
+        entry.deadline_ns / 1000, entry.period_ns / 1000);
+    entry.unlogged_miss_count = 0;
+    entry.last_miss_log_time = now;
+  }
+
+  return {};
+}
+
 Status<void> PerformanceService::HandleMessage(Message& message) {
   ALOGD_IF(TRACE, "PerformanceService::HandleMessage: op=%d", message.GetOp());
   switch (message.GetOp()) {
@@ -419,6 +758,16 @@ Status<void> PerformanceService::HandleMessage(Message& message) {
           *this, &PerformanceService::OnGetCpuPartition, message);
       return {};
 
+    case PerformanceRPC::SetDeadlinePolicy::Opcode:
+      DispatchRemoteMethod<PerformanceRPC::SetDeadlinePolicy>(
+          *this, &PerformanceService::OnSetDeadlinePolicy, message);
+      return {};
+
+    case PerformanceRPC::ReportDeadlineMiss::Opcode:
+      DispatchRemoteMethod<PerformanceRPC::ReportDeadlineMiss>(
+          *this, &PerformanceService::OnReportDeadlineMiss, message);
+      return {};
+
     default:
       return Service::HandleMessage(message);
   }
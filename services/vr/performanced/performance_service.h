@@ -1,6 +1,7 @@
 #ifndef ANDROID_DVR_PERFORMANCED_PERFORMANCE_SERVICE_H_
 #define ANDROID_DVR_PERFORMANCED_PERFORMANCE_SERVICE_H_
 
+#include <chrono>
 #include <functional>
 #include <string>
 #include <unordered_map>
@@ -38,6 +39,26 @@ class PerformanceService : public pdx::ServiceBase<PerformanceService> {
                                         const std::string& scheduler_class);
   pdx::Status<std::string> OnGetCpuPartition(pdx::Message& message,
                                              pid_t task_id);
+  pdx::Status<void> OnSetDeadlinePolicy(pdx::Message& message, pid_t task_id,
+                                        uint64_t runtime_ns,
+                                        uint64_t deadline_ns,
+                                        uint64_t period_ns);
+  pdx::Status<void> OnReportDeadlineMiss(pdx::Message& message, pid_t task_id,
+                                         uint64_t lateness_ns);
+
+  // Places |task| on SCHED_FIFO at a priority ordered by deadline, in the
+  // performance cpuset for its thread group if the bandwidth already admitted
+  // there leaves room for |bandwidth|. Returns the cpuset used.
+  pdx::Status<std::string> PlaceDeadlineTaskOnFifo(const Task& task,
+                                                   uint64_t deadline_ns,
+                                                   double bandwidth);
+
+  // Restores the normal scheduler policy on a task with a deadline policy and
+  // forgets about it.
+  void ClearDeadlinePolicy(pid_t task_id);
+
+  // Drops deadline policies of tasks that have exited.
+  void PruneDeadlineTasks();
 
   // Set which thread gets the vr:app:render policy. Only one thread at a time
   // is allowed to have vr:app:render. If multiple threads are allowed
@@ -80,6 +101,31 @@ class PerformanceService : public pdx::ServiceBase<PerformanceService> {
 
   pid_t vr_app_render_thread_ = -1;
 
+  std::function<bool(const pdx::Message& message, const Task& task)>
+      deadline_permission_check_;
+
+  struct DeadlineTask {
+    pid_t thread_group_id;
+    uint64_t runtime_ns;
+    uint64_t deadline_ns;
+    uint64_t period_ns;
+
+    // Fraction of a CPU reserved by the task: runtime / period.
+    double bandwidth;
+
+    // Whether the kernel admitted the task to SCHED_DEADLINE. When false the
+    // task runs on SCHED_FIFO in |cpuset|.
+    bool sched_deadline;
+    std::string cpuset;
+
+    uint64_t miss_count = 0;
+    uint64_t max_lateness_ns = 0;
+    uint64_t unlogged_miss_count = 0;
+    std::chrono::steady_clock::time_point last_miss_log_time;
+  };
+
+  std::unordered_map<pid_t, DeadlineTask> deadline_tasks_;
+
   PerformanceService(const PerformanceService&) = delete;
   void operator=(const PerformanceService&) = delete;
 };
@@ -247,6 +247,41 @@ TEST(PerformanceTest, GetCpuPartition) {
   EXPECT_EQ(-EINVAL, error);
 }
 
+TEST(PerformanceTest, SetDeadlinePolicy) {
+  constexpr int kSchedDeadline = 6;
+
+  std::thread thread([]() {
+    int error;
+
+    // 2ms every 10ms.
+    error = dvrSetDeadlinePolicy(0, 2000000, 10000000, 10000000);
+    EXPECT_EQ(0, error);
+    const int scheduler = sched_getscheduler(0) & ~SCHED_RESET_ON_FORK;
+    EXPECT_TRUE(scheduler == kSchedDeadline || scheduler == SCHED_FIFO)
+        << "scheduler=" << scheduler;
+
+    error = dvrReportDeadlineMiss(0, 500000);
+    EXPECT_EQ(0, error);
+
+    // Runtime longer than the deadline.
+    error = dvrSetDeadlinePolicy(0, 20000000, 10000000, 10000000);
+    EXPECT_EQ(-EINVAL, error);
+
+    // Clear the policy.
+    error = dvrSetDeadlinePolicy(0, 0, 0, 0);
+    EXPECT_EQ(0, error);
+    EXPECT_EQ(SCHED_NORMAL, sched_getscheduler(0));
+
+    error = dvrReportDeadlineMiss(0, 500000);
+    EXPECT_EQ(-ENOENT, error);
+
+    // Test reporting a miss for a task that doesn't belong to us.
+    error = dvrReportDeadlineMiss(1, 500000);
+    EXPECT_EQ(-EPERM, error);
+  });
+  thread.join();
+}
+
 TEST(PerformanceTest, Permissions) {
   int error;
 
@@ -0,0 +1,422 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures libvulkan's own cost per call, with zero or more pass-through layers
+// from libVkLayer_benchmark_passthrough.so stacked on top of the driver.
+//
+// The numbers only reflect the loader when the driver does no work itself, so
+// run this on a build whose Vulkan HAL is the null driver (vulkan.default);
+// the driver in use is reported in each benchmark's label. The layer library
+// is looked for next to the benchmark binary, or in $VK_BENCHMARK_LAYER_PATH.
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+#include <graphicsenv/GraphicsEnv.h>
+#include <gui/BufferItemConsumer.h>
+#include <gui/BufferQueue.h>
+#include <gui/Surface.h>
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+
+#include <string>
+
+#include "passthrough_layer.h"
+
+namespace {
+
+using namespace android;
+
+constexpr uint32_t kSurfaceSize = 64;
+constexpr uint32_t kDrawsPerCommandBuffer = 64;
+
+// An instance and a device with the first |layer_count| pass-through layers
+// enabled, and optionally a swapchain presenting to a BufferQueue whose
+// consumer releases every buffer as soon as it is queued.
+class Vulkan {
+   public:
+    ~Vulkan() {
+        if (swapchain_ != VK_NULL_HANDLE)
+            vkDestroySwapchainKHR(device_, swapchain_, nullptr);
+        if (semaphore_ != VK_NULL_HANDLE)
+            vkDestroySemaphore(device_, semaphore_, nullptr);
+        if (surface_ != VK_NULL_HANDLE)
+            vkDestroySurfaceKHR(instance_, surface_, nullptr);
+        if (command_pool_ != VK_NULL_HANDLE)
+            vkDestroyCommandPool(device_, command_pool_, nullptr);
+        if (device_ != VK_NULL_HANDLE)
+            vkDestroyDevice(device_, nullptr);
+        if (instance_ != VK_NULL_HANDLE)
+            vkDestroyInstance(instance_, nullptr);
+    }
+
+    bool CreateInstance(uint32_t layer_count) {
+        const char* const extensions[] = {
+            VK_KHR_SURFACE_EXTENSION_NAME,
+            VK_KHR_ANDROID_SURFACE_EXTENSION_NAME,
+        };
+        const VkApplicationInfo app_info = {
+            VK_STRUCTURE_TYPE_APPLICATION_INFO,
+            nullptr,
+            "libvulkan_benchmark",
+            0,
+            nullptr,
+            0,
+            VK_API_VERSION_1_1,
+        };
+        const VkInstanceCreateInfo create_info = {
+            VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+            nullptr,
+            0,
+            &app_info,
+            layer_count,
+            kPassthroughLayerNames,
+            2,
+            extensions,
+        };
+        if (vkCreateInstance(&create_info, nullptr, &instance_) != VK_SUCCESS)
+            return false;
+
+        uint32_t count = 1;
+        VkResult result =
+            vkEnumeratePhysicalDevices(instance_, &count, &physical_device_);
+        return (result == VK_SUCCESS || result == VK_INCOMPLETE) && count;
+    }
+
+    bool CreateDevice() {
+        const float priority = 1.0f;
+        const VkDeviceQueueCreateInfo queue_info = {
+            VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            nullptr,
+            0,
+            0,
+            1,
+            &priority,
+        };
+        const char* const extensions[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        const VkDeviceCreateInfo create_info = {
+            VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+            nullptr,
+            0,
+            1,
+            &queue_info,
+            0,
+            nullptr,
+            1,
+            extensions,
+            nullptr,
+        };
+        if (vkCreateDevice(physical_device_, &create_info, nullptr,
+                           &device_) != VK_SUCCESS)
+            return false;
+        vkGetDeviceQueue(device_, 0, 0, &queue_);
+
+        const VkCommandPoolCreateInfo pool_info = {
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            nullptr,
+            VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            0,
+        };
+        if (vkCreateCommandPool(device_, &pool_info, nullptr,
+                                &command_pool_) != VK_SUCCESS)
+            return false;
+        const VkCommandBufferAllocateInfo alloc_info = {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            nullptr,
+            command_pool_,
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            1,
+        };
+        return vkAllocateCommandBuffers(device_, &alloc_info,
+                                        &command_buffer_) == VK_SUCCESS;
+    }
+
+    bool CreateSwapchain() {
+        sp<IGraphicBufferProducer> producer;
+        sp<IGraphicBufferConsumer> consumer;
+        BufferQueue::createBufferQueue(&producer, &consumer);
+        consumer_ = new BufferItemConsumer(consumer, 0);
+        consumer_->setDefaultBufferSize(kSurfaceSize, kSurfaceSize);
+        listener_ = new ReleasingListener(consumer_);
+        consumer_->setFrameAvailableListener(listener_);
+        window_ = new Surface(producer);
+
+        const VkAndroidSurfaceCreateInfoKHR surface_info = {
+            VK_STRUCTURE_TYPE_ANDROID_SURFACE_CREATE_INFO_KHR,
+            nullptr,
+            0,
+            window_.get(),
+        };
+        if (vkCreateAndroidSurfaceKHR(instance_, &surface_info, nullptr,
+                                      &surface_) != VK_SUCCESS)
+            return false;
+
+        VkSurfaceCapabilitiesKHR caps;
+        if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+                physical_device_, surface_, &caps) != VK_SUCCESS)
+            return false;
+        uint32_t count = 1;
+        VkSurfaceFormatKHR format;
+        VkResult result = vkGetPhysicalDeviceSurfaceFormatsKHR(
+            physical_device_, surface_, &count, &format);
+        if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || !count)
+            return false;
+
+        const VkSwapchainCreateInfoKHR swapchain_info = {
+            VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+            nullptr,
+            0,
+            surface_,
+            caps.minImageCount,
+            format.format,
+            format.colorSpace,
+            {kSurfaceSize, kSurfaceSize},
+            1,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            VK_SHARING_MODE_EXCLUSIVE,
+            0,
+            nullptr,
+            VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
+            VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR,
+            VK_PRESENT_MODE_FIFO_KHR,
+            VK_FALSE,
+            VK_NULL_HANDLE,
+        };
+        if (vkCreateSwapchainKHR(device_, &swapchain_info, nullptr,
+                                 &swapchain_) != VK_SUCCESS)
+            return false;
+
+        const VkSemaphoreCreateInfo semaphore_info = {
+            VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            nullptr,
+            0,
+        };
+        return vkCreateSemaphore(device_, &semaphore_info, nullptr,
+                                 &semaphore_) == VK_SUCCESS;
+    }
+
+    // Describes the driver, so that results from other drivers stand out.
+    std::string DriverLabel() const {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device_, &properties);
+        return properties.deviceName;
+    }
+
+    VkInstance instance() const { return instance_; }
+    VkDevice device() const { return device_; }
+    VkQueue queue() const { return queue_; }
+    VkCommandBuffer command_buffer() const { return command_buffer_; }
+    VkSwapchainKHR swapchain() const { return swapchain_; }
+    VkSemaphore semaphore() const { return semaphore_; }
+
+   private:
+    class ReleasingListener
+        : public BufferItemConsumer::FrameAvailableListener {
+       public:
+        explicit ReleasingListener(const sp<BufferItemConsumer>& consumer)
+            : consumer_(consumer) {}
+
+        void onFrameAvailable(const BufferItem&) override {
+            BufferItem item;
+            if (consumer_->acquireBuffer(&item, 0) == NO_ERROR)
+                consumer_->releaseBuffer(item);
+        }
+
+       private:
+        sp<BufferItemConsumer> consumer_;
+    };
+
+    VkInstance instance_ = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkQueue queue_ = VK_NULL_HANDLE;
+    VkCommandPool command_pool_ = VK_NULL_HANDLE;
+    VkCommandBuffer command_buffer_ = VK_NULL_HANDLE;
+    sp<BufferItemConsumer> consumer_;
+    sp<ReleasingListener> listener_;
+    sp<Surface> window_;
+    VkSurfaceKHR surface_ = VK_NULL_HANDLE;
+    VkSwapchainKHR swapchain_ = VK_NULL_HANDLE;
+    VkSemaphore semaphore_ = VK_NULL_HANDLE;
+};
+
+uint32_t LayerCount(const benchmark::State& state) {
+    return static_cast<uint32_t>(state.range(0));
+}
+
+void BM_CreateDestroyInstance(benchmark::State& state) {
+    for (auto _ : state) {
+        Vulkan vulkan;
+        if (!vulkan.CreateInstance(LayerCount(state))) {
+            state.SkipWithError("failed to create instance");
+            break;
+        }
+    }
+}
+
+void BM_CreateDestroyDevice(benchmark::State& state) {
+    Vulkan instance;
+    if (!instance.CreateInstance(LayerCount(state))) {
+        state.SkipWithError("failed to create instance");
+        return;
+    }
+    VkPhysicalDevice physical_device;
+    uint32_t count = 1;
+    vkEnumeratePhysicalDevices(instance.instance(), &count, &physical_device);
+    const float priority = 1.0f;
+    const VkDeviceQueueCreateInfo queue_info = {
+        VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO, nullptr, 0, 0, 1, &priority,
+    };
+    const VkDeviceCreateInfo create_info = {
+        VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        nullptr,
+        0,
+        1,
+        &queue_info,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        nullptr,
+    };
+    for (auto _ : state) {
+        VkDevice device;
+        if (vkCreateDevice(physical_device, &create_info, nullptr, &device) !=
+            VK_SUCCESS) {
+            state.SkipWithError("failed to create device");
+            break;
+        }
+        vkDestroyDevice(device, nullptr);
+    }
+    state.SetLabel(instance.DriverLabel());
+}
+
+// Through the trampoline that libvulkan exports.
+void BM_GetDeviceQueue(benchmark::State& state) {
+    Vulkan vulkan;
+    if (!vulkan.CreateInstance(LayerCount(state)) || !vulkan.CreateDevice()) {
+        state.SkipWithError("failed to create device");
+        return;
+    }
+    VkQueue queue;
+    for (auto _ : state) {
+        vkGetDeviceQueue(vulkan.device(), 0, 0, &queue);
+        benchmark::DoNotOptimize(queue);
+    }
+    state.SetLabel(vulkan.DriverLabel());
+}
+
+// Through the pointer from vkGetDeviceProcAddr, which skips the trampoline.
+void BM_GetDeviceQueueProcAddr(benchmark::State& state) {
+    Vulkan vulkan;
+    if (!vulkan.CreateInstance(LayerCount(state)) || !vulkan.CreateDevice()) {
+        state.SkipWithError("failed to create device");
+        return;
+    }
+    auto get_device_queue = reinterpret_cast<PFN_vkGetDeviceQueue>(
+        vkGetDeviceProcAddr(vulkan.device(), "vkGetDeviceQueue"));
+    VkQueue queue;
+    for (auto _ : state) {
+        get_device_queue(vulkan.device(), 0, 0, &queue);
+        benchmark::DoNotOptimize(queue);
+    }
+    state.SetLabel(vulkan.DriverLabel());
+}
+
+void BM_RecordCommandBuffer(benchmark::State& state) {
+    Vulkan vulkan;
+    if (!vulkan.CreateInstance(LayerCount(state)) || !vulkan.CreateDevice()) {
+        state.SkipWithError("failed to create device");
+        return;
+    }
+    const VkCommandBufferBeginInfo begin_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        nullptr,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        nullptr,
+    };
+    VkCommandBuffer command_buffer = vulkan.command_buffer();
+    for (auto _ : state) {
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        for (uint32_t i = 0; i < kDrawsPerCommandBuffer; i++)
+            vkCmdDraw(command_buffer, 3, 1, 0, 0);
+        vkEndCommandBuffer(command_buffer);
+    }
+    state.SetItemsProcessed(state.iterations() * kDrawsPerCommandBuffer);
+    state.SetLabel(vulkan.DriverLabel());
+}
+
+void BM_AcquirePresent(benchmark::State& state) {
+    Vulkan vulkan;
+    if (!vulkan.CreateInstance(LayerCount(state)) || !vulkan.CreateDevice() ||
+        !vulkan.CreateSwapchain()) {
+        state.SkipWithError("failed to create swapchain");
+        return;
+    }
+    VkSwapchainKHR swapchain = vulkan.swapchain();
+    VkSemaphore semaphore = vulkan.semaphore();
+    for (auto _ : state) {
+        uint32_t index;
+        if (vkAcquireNextImageKHR(vulkan.device(), swapchain, UINT64_MAX,
+                                  semaphore, VK_NULL_HANDLE,
+                                  &index) != VK_SUCCESS) {
+            state.SkipWithError("failed to acquire image");
+            break;
+        }
+        const VkPresentInfoKHR present_info = {
+            VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            nullptr,
+            1,
+            &semaphore,
+            1,
+            &swapchain,
+            &index,
+            nullptr,
+        };
+        if (vkQueuePresentKHR(vulkan.queue(), &present_info) != VK_SUCCESS) {
+            state.SkipWithError("failed to present image");
+            break;
+        }
+    }
+    state.SetLabel(vulkan.DriverLabel());
+}
+
+void LayerCounts(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgName("layers");
+    for (uint32_t count = 0; count <= kPassthroughLayerCount; count++)
+        benchmark->Arg(count);
+}
+
+BENCHMARK(BM_CreateDestroyInstance)->Apply(LayerCounts);
+BENCHMARK(BM_CreateDestroyDevice)->Apply(LayerCounts);
+BENCHMARK(BM_GetDeviceQueue)->Apply(LayerCounts);
+BENCHMARK(BM_GetDeviceQueueProcAddr)->Apply(LayerCounts);
+BENCHMARK(BM_RecordCommandBuffer)->Apply(LayerCounts);
+BENCHMARK(BM_AcquirePresent)->Apply(LayerCounts);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // Layers are only discovered once, so the path has to be set before the
+    // first Vulkan call.
+    const char* layer_path = getenv("VK_BENCHMARK_LAYER_PATH");
+    android::GraphicsEnv::getInstance().setLayerPaths(
+        nullptr,
+        layer_path ? layer_path : android::base::GetExecutableDirectory());
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
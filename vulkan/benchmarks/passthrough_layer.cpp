@@ -0,0 +1,332 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Layers that do nothing but look up the next function in the chain and call
+// it, for measuring what libvulkan costs with layers enabled. The library
+// exposes several identical layers so that a benchmark can stack them.
+
+#include <string.h>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+#include <vulkan/vk_layer_interface.h>
+#include <vulkan/vulkan.h>
+
+#include "passthrough_layer.h"
+
+namespace {
+
+// Dispatchable objects created from the same instance or device share the
+// loader's dispatch pointer, which layers use as the key for their state.
+void* GetKey(const void* dispatchable) {
+    return *reinterpret_cast<void* const*>(dispatchable);
+}
+
+struct InstanceDispatch {
+    VkInstance instance;
+    PFN_vkGetInstanceProcAddr GetInstanceProcAddr;
+    PFN_vkDestroyInstance DestroyInstance;
+};
+
+struct DeviceDispatch {
+    PFN_vkGetDeviceProcAddr GetDeviceProcAddr;
+    PFN_vkDestroyDevice DestroyDevice;
+    PFN_vkGetDeviceQueue GetDeviceQueue;
+    PFN_vkCmdDraw CmdDraw;
+    PFN_vkAcquireNextImageKHR AcquireNextImageKHR;
+    PFN_vkQueuePresentKHR QueuePresentKHR;
+};
+
+template <typename CreateInfo>
+CreateInfo* FindLinkInfo(const void* next, VkStructureType type) {
+    while (next) {
+        auto info =
+            const_cast<CreateInfo*>(static_cast<const CreateInfo*>(next));
+        if (info->sType == type && info->function == VK_LAYER_FUNCTION_LINK)
+            return info;
+        next = info->pNext;
+    }
+    return nullptr;
+}
+
+// One layer of the stack. Every intercepted call takes the lock and looks up
+// the next layer, the way simple real-world layers do.
+template <uint32_t Index>
+class PassthroughLayer {
+   public:
+    static VKAPI_ATTR PFN_vkVoidFunction
+    GetInstanceProcAddr(VkInstance instance, const char* name) {
+        if (PFN_vkVoidFunction proc = GetInterceptedProc(name))
+            return proc;
+        if (instance == VK_NULL_HANDLE)
+            return nullptr;
+        return GetInstanceDispatch(instance).GetInstanceProcAddr(instance,
+                                                                 name);
+    }
+
+    static VKAPI_ATTR PFN_vkVoidFunction GetDeviceProcAddr(VkDevice device,
+                                                           const char* name) {
+        if (PFN_vkVoidFunction proc = GetInterceptedProc(name))
+            return proc;
+        return GetDeviceDispatch(device).GetDeviceProcAddr(device, name);
+    }
+
+   private:
+    static PFN_vkVoidFunction GetInterceptedProc(const char* name) {
+        static const struct {
+            const char* name;
+            PFN_vkVoidFunction proc;
+        } kProcs[] = {
+            {"vkGetInstanceProcAddr",
+             reinterpret_cast<PFN_vkVoidFunction>(GetInstanceProcAddr)},
+            {"vkGetDeviceProcAddr",
+             reinterpret_cast<PFN_vkVoidFunction>(GetDeviceProcAddr)},
+            {"vkCreateInstance",
+             reinterpret_cast<PFN_vkVoidFunction>(CreateInstance)},
+            {"vkDestroyInstance",
+             reinterpret_cast<PFN_vkVoidFunction>(DestroyInstance)},
+            {"vkCreateDevice",
+             reinterpret_cast<PFN_vkVoidFunction>(CreateDevice)},
+            {"vkDestroyDevice",
+             reinterpret_cast<PFN_vkVoidFunction>(DestroyDevice)},
+            {"vkGetDeviceQueue",
+             reinterpret_cast<PFN_vkVoidFunction>(GetDeviceQueue)},
+            {"vkCmdDraw", reinterpret_cast<PFN_vkVoidFunction>(CmdDraw)},
+            {"vkAcquireNextImageKHR",
+             reinterpret_cast<PFN_vkVoidFunction>(AcquireNextImageKHR)},
+            {"vkQueuePresentKHR",
+             reinterpret_cast<PFN_vkVoidFunction>(QueuePresentKHR)},
+        };
+        for (const auto& entry : kProcs) {
+            if (strcmp(name, entry.name) == 0)
+                return entry.proc;
+        }
+        return nullptr;
+    }
+
+    static InstanceDispatch GetInstanceDispatch(const void* dispatchable) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return instances_.at(GetKey(dispatchable));
+    }
+
+    static DeviceDispatch GetDeviceDispatch(const void* dispatchable) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return devices_.at(GetKey(dispatchable));
+    }
+
+    static VKAPI_ATTR VkResult
+    CreateInstance(const VkInstanceCreateInfo* create_info,
+                   const VkAllocationCallbacks* allocator,
+                   VkInstance* instance) {
+        auto link = FindLinkInfo<VkLayerInstanceCreateInfo>(
+            create_info->pNext, VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO);
+        if (!link)
+            return VK_ERROR_INITIALIZATION_FAILED;
+        PFN_vkGetInstanceProcAddr next_gipa =
+            link->u.pLayerInfo->pfnNextGetInstanceProcAddr;
+        link->u.pLayerInfo = link->u.pLayerInfo->pNext;
+
+        auto create = reinterpret_cast<PFN_vkCreateInstance>(
+            next_gipa(VK_NULL_HANDLE, "vkCreateInstance"));
+        VkResult result = create(create_info, allocator, instance);
+        if (result != VK_SUCCESS)
+            return result;
+
+        InstanceDispatch dispatch = {
+            *instance, next_gipa,
+            reinterpret_cast<PFN_vkDestroyInstance>(
+                next_gipa(*instance, "vkDestroyInstance")),
+        };
+        std::lock_guard<std::mutex> lock(mutex_);
+        instances_[GetKey(*instance)] = dispatch;
+        return VK_SUCCESS;
+    }
+
+    static VKAPI_ATTR void DestroyInstance(
+        VkInstance instance,
+        const VkAllocationCallbacks* allocator) {
+        InstanceDispatch dispatch = GetInstanceDispatch(instance);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            instances_.erase(GetKey(instance));
+        }
+        dispatch.DestroyInstance(instance, allocator);
+    }
+
+    static VKAPI_ATTR VkResult CreateDevice(
+        VkPhysicalDevice physical_device,
+        const VkDeviceCreateInfo* create_info,
+        const VkAllocationCallbacks* allocator,
+        VkDevice* device) {
+        auto link = FindLinkInfo<VkLayerDeviceCreateInfo>(
+            create_info->pNext, VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO);
+        if (!link)
+            return VK_ERROR_INITIALIZATION_FAILED;
+        PFN_vkGetInstanceProcAddr next_gipa =
+            link->u.pLayerInfo->pfnNextGetInstanceProcAddr;
+        PFN_vkGetDeviceProcAddr next_gdpa =
+            link->u.pLayerInfo->pfnNextGetDeviceProcAddr;
+        link->u.pLayerInfo = link->u.pLayerInfo->pNext;
+
+        VkInstance instance = GetInstanceDispatch(physical_device).instance;
+        auto create = reinterpret_cast<PFN_vkCreateDevice>(
+            next_gipa(instance, "vkCreateDevice"));
+        VkResult result =
+            create(physical_device, create_info, allocator, device);
+        if (result != VK_SUCCESS)
+            return result;
+
+        DeviceDispatch dispatch = {
+            next_gdpa,
+            reinterpret_cast<PFN_vkDestroyDevice>(
+                next_gdpa(*device, "vkDestroyDevice")),
+            reinterpret_cast<PFN_vkGetDeviceQueue>(
+                next_gdpa(*device, "vkGetDeviceQueue")),
+            reinterpret_cast<PFN_vkCmdDraw>(next_gdpa(*device, "vkCmdDraw")),
+            reinterpret_cast<PFN_vkAcquireNextImageKHR>(
+                next_gdpa(*device, "vkAcquireNextImageKHR")),
+            reinterpret_cast<PFN_vkQueuePresentKHR>(
+                next_gdpa(*device, "vkQueuePresentKHR")),
+        };
+        std::lock_guard<std::mutex> lock(mutex_);
+        devices_[GetKey(*device)] = dispatch;
+        return VK_SUCCESS;
+    }
+
+    static VKAPI_ATTR void DestroyDevice(
+        VkDevice device,
+        const VkAllocationCallbacks* allocator) {
+        DeviceDispatch dispatch = GetDeviceDispatch(device);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            devices_.erase(GetKey(device));
+        }
+        dispatch.DestroyDevice(device, allocator);
+    }
+
+    static VKAPI_ATTR void GetDeviceQueue(VkDevice device,
+                                          uint32_t queue_family,
+                                          uint32_t queue_index,
+                                          VkQueue* queue) {
+        GetDeviceDispatch(device).GetDeviceQueue(device, queue_family,
+                                                 queue_index, queue);
+    }
+
+    static VKAPI_ATTR void CmdDraw(VkCommandBuffer command_buffer,
+                                   uint32_t vertex_count,
+                                   uint32_t instance_count,
+                                   uint32_t first_vertex,
+                                   uint32_t first_instance) {
+        GetDeviceDispatch(command_buffer)
+            .CmdDraw(command_buffer, vertex_count, instance_count,
+                     first_vertex, first_instance);
+    }
+
+    static VKAPI_ATTR VkResult AcquireNextImageKHR(VkDevice device,
+                                                   VkSwapchainKHR swapchain,
+                                                   uint64_t timeout,
+                                                   VkSemaphore semaphore,
+                                                   VkFence fence,
+                                                   uint32_t* image_index) {
+        return GetDeviceDispatch(device).AcquireNextImageKHR(
+            device, swapchain, timeout, semaphore, fence, image_index);
+    }
+
+    static VKAPI_ATTR VkResult
+    QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* present_info) {
+        return GetDeviceDispatch(queue).QueuePresentKHR(queue, present_info);
+    }
+
+    static inline std::mutex mutex_;
+    static inline std::unordered_map<void*, InstanceDispatch> instances_;
+    static inline std::unordered_map<void*, DeviceDispatch> devices_;
+};
+
+const VkLayerProperties kLayerProperties[] = {
+    {PASSTHROUGH_LAYER_NAME(0), VK_API_VERSION_1_1, 1, "pass-through layer"},
+    {PASSTHROUGH_LAYER_NAME(1), VK_API_VERSION_1_1, 1, "pass-through layer"},
+    {PASSTHROUGH_LAYER_NAME(2), VK_API_VERSION_1_1, 1, "pass-through layer"},
+};
+static_assert(sizeof(kLayerProperties) / sizeof(kLayerProperties[0]) ==
+                  kPassthroughLayerCount,
+              "every layer needs properties");
+
+VkResult GetLayerProperties(uint32_t* count, VkLayerProperties* properties) {
+    if (!properties) {
+        *count = kPassthroughLayerCount;
+        return VK_SUCCESS;
+    }
+    uint32_t copied = std::min(*count, kPassthroughLayerCount);
+    memcpy(properties, kLayerProperties, copied * sizeof(properties[0]));
+    *count = copied;
+    return copied < kPassthroughLayerCount ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+}  // namespace
+
+// The loader looks these up by name in every layer library.
+
+#define PASSTHROUGH_LAYER_ENTRY_POINTS(index)                                 \
+    extern "C" __attribute__((visibility("default")))                         \
+    VKAPI_ATTR PFN_vkVoidFunction                                             \
+        VK_LAYER_ANDROID_benchmark_passthrough_##index##GetInstanceProcAddr(  \
+            VkInstance instance, const char* name) {                          \
+        return PassthroughLayer<index>::GetInstanceProcAddr(instance, name);  \
+    }                                                                         \
+    extern "C" __attribute__((visibility("default")))                         \
+    VKAPI_ATTR PFN_vkVoidFunction                                             \
+        VK_LAYER_ANDROID_benchmark_passthrough_##index##GetDeviceProcAddr(    \
+            VkDevice device, const char* name) {                              \
+        return PassthroughLayer<index>::GetDeviceProcAddr(device, name);      \
+    }
+
+PASSTHROUGH_LAYER_ENTRY_POINTS(0)
+PASSTHROUGH_LAYER_ENTRY_POINTS(1)
+PASSTHROUGH_LAYER_ENTRY_POINTS(2)
+
+extern "C" __attribute__((visibility("default"))) VKAPI_ATTR VkResult
+vkEnumerateInstanceLayerProperties(uint32_t* count,
+                                   VkLayerProperties* properties) {
+    return GetLayerProperties(count, properties);
+}
+
+extern "C" __attribute__((visibility("default"))) VKAPI_ATTR VkResult
+vkEnumerateInstanceExtensionProperties(const char* /*layer_name*/,
+                                       uint32_t* count,
+                                       VkExtensionProperties* /*properties*/) {
+    *count = 0;
+    return VK_SUCCESS;
+}
+
+// Also enumerating the layers as device layers makes them global, so that
+// they are active on devices as well as instances.
+extern "C" __attribute__((visibility("default"))) VKAPI_ATTR VkResult
+vkEnumerateDeviceLayerProperties(VkPhysicalDevice /*physical_device*/,
+                                 uint32_t* count,
+                                 VkLayerProperties* properties) {
+    return GetLayerProperties(count, properties);
+}
+
+extern "C" __attribute__((visibility("default"))) VKAPI_ATTR VkResult
+vkEnumerateDeviceExtensionProperties(VkPhysicalDevice /*physical_device*/,
+                                     const char* /*layer_name*/,
+                                     uint32_t* count,
+                                     VkExtensionProperties* /*properties*/) {
+    *count = 0;
+    return VK_SUCCESS;
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define PASSTHROUGH_LAYER_NAME(index) \
+    "VK_LAYER_ANDROID_benchmark_passthrough_" #index
+
+// Layers provided by libVkLayer_benchmark_passthrough.so, outermost first.
+constexpr uint32_t kPassthroughLayerCount = 3;
+constexpr const char* kPassthroughLayerNames[kPassthroughLayerCount] = {
+    PASSTHROUGH_LAYER_NAME(0),
+    PASSTHROUGH_LAYER_NAME(1),
+    PASSTHROUGH_LAYER_NAME(2),
+};
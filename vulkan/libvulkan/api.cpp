@@ -1174,14 +1174,19 @@ const LayerChain::ActiveLayer* LayerChain::GetActiveLayers(
 // ----------------------------------------------------------------------------
 
 bool EnsureInitialized() {
-    static std::once_flag once_flag;
+    static std::mutex init_lock;
+    static bool opened;
     static bool initialized;
 
-    std::call_once(once_flag, []() {
-        if (driver::OpenHAL()) {
-            initialized = true;
+    {
+        // The HAL is normally opened once, but a builtin driver preloaded by
+        // zygote is reopened once the app has selected an updated driver.
+        std::lock_guard<std::mutex> lock(init_lock);
+        if (!opened || driver::ShouldReloadHAL()) {
+            initialized = driver::OpenHAL();
+            opened = true;
         }
-    });
+    }
 
     {
         static pid_t pid = getpid() + 1;
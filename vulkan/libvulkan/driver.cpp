@@ -38,6 +38,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <climits>
 #include <new>
 #include <string_view>
@@ -73,23 +74,46 @@ namespace {
 class Hal {
    public:
     static bool Open();
+    static bool ShouldReload() { return hal_.ShouldReloadDriver(); }
+    static void NoteInstanceCreated() { hal_.instance_created_ = true; }
 
     static const Hal& Get() { return hal_; }
     static const hwvulkan_device_t& Device() { return *Get().dev_; }
 
     int GetDebugReportIndex() const { return debug_report_index_; }
 
+    // Enumerates the HAL instance extensions from the list cached when the
+    // HAL was opened, falling back to querying the HAL device.
+    VkResult EnumerateInstanceExtensions(uint32_t* count,
+                                         VkExtensionProperties* props) const;
+
    private:
-    Hal() : dev_(nullptr), debug_report_index_(-1) {}
+    Hal()
+        : dev_(nullptr),
+          module_(nullptr),
+          builtin_(false),
+          instance_created_(false),
+          debug_report_index_(-1),
+          instance_extensions_(nullptr),
+          instance_extension_count_(0) {}
     Hal(const Hal&) = delete;
     Hal& operator=(const Hal&) = delete;
 
     bool InitDebugReportIndex();
+    bool ShouldReloadDriver() const;
+    void UnloadDriver();
 
     static Hal hal_;
 
     const hwvulkan_device_t* dev_;
+    const hwvulkan_module_t* module_;
+    // True when dev_ came from the sphal driver or the stub, as opposed to an
+    // updated driver selected through GraphicsEnv.
+    bool builtin_;
+    std::atomic<bool> instance_created_;
     int debug_report_index_;
+    VkExtensionProperties* instance_extensions_;
+    uint32_t instance_extension_count_;
 };
 
 class CreateInfoWrapper {
@@ -241,7 +265,14 @@ bool Hal::Open() {
 
     const nsecs_t openTime = systemTime();
 
-    ALOG_ASSERT(!hal_.dev_, "OpenHAL called more than once");
+    ALOG_ASSERT(!hal_.dev_ || hal_.ShouldReloadDriver(),
+                "OpenHAL called more than once");
+
+    // Zygote preloads the builtin driver before it knows whether the app will
+    // use an updated one. Drop the preloaded driver if an updated driver has
+    // been selected since and nothing has created an instance with it yet.
+    if (hal_.dev_)
+        hal_.UnloadDriver();
 
     // Use a stub device unless we successfully open a real HAL device.
     hal_.dev_ = &stubhal::kDevice;
@@ -250,9 +281,12 @@ bool Hal::Open() {
     const hwvulkan_module_t* module = nullptr;
 
     result = LoadUpdatedDriver(&module);
+    hal_.builtin_ = result == -ENOENT;
     if (result == -ENOENT) {
         result = LoadBuiltinDriver(&module);
     }
+    if (result == 0)
+        hal_.module_ = module;
     if (result != 0) {
         android::GraphicsEnv::getInstance().setDriverLoaded(
             android::GpuStatsInfo::Api::API_VK, false, systemTime() - openTime);
@@ -286,6 +320,28 @@ bool Hal::Open() {
     return true;
 }
 
+bool Hal::ShouldReloadDriver() const {
+    return dev_ && builtin_ && !instance_created_ &&
+           android::GraphicsEnv::getInstance().getDriverNamespace() != nullptr;
+}
+
+void Hal::UnloadDriver() {
+    ATRACE_CALL();
+
+    if (dev_ && dev_ != &stubhal::kDevice && dev_->common.close)
+        dev_->common.close(const_cast<hw_device_t*>(&dev_->common));
+    if (module_)
+        dlclose(module_->common.dso);
+
+    dev_ = nullptr;
+    module_ = nullptr;
+    builtin_ = false;
+    debug_report_index_ = -1;
+    free(instance_extensions_);
+    instance_extensions_ = nullptr;
+    instance_extension_count_ = 0;
+}
+
 bool Hal::InitDebugReportIndex() {
     ATRACE_CALL();
 
@@ -318,11 +374,30 @@ bool Hal::InitDebugReportIndex() {
         }
     }
 
-    free(exts);
+    // Keep the list around: the HAL instance extensions cannot change while
+    // the HAL is open, and every vkCreateInstance needs them.
+    instance_extensions_ = exts;
+    instance_extension_count_ = count;
 
     return true;
 }
 
+VkResult Hal::EnumerateInstanceExtensions(uint32_t* count,
+                                          VkExtensionProperties* props) const {
+    if (!instance_extensions_)
+        return dev_->EnumerateInstanceExtensionProperties(nullptr, count,
+                                                          props);
+
+    if (!props) {
+        *count = instance_extension_count_;
+        return VK_SUCCESS;
+    }
+    const uint32_t copied = std::min(*count, instance_extension_count_);
+    std::copy(instance_extensions_, instance_extensions_ + copied, props);
+    *count = copied;
+    return copied < instance_extension_count_ ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
 CreateInfoWrapper::CreateInfoWrapper(const VkInstanceCreateInfo& create_info,
                                      const VkAllocationCallbacks& allocator)
     : is_instance_(true),
@@ -455,8 +530,7 @@ VkResult CreateInfoWrapper::SanitizeExtensions() {
 
 VkResult CreateInfoWrapper::QueryExtensionCount(uint32_t& count) const {
     if (is_instance_) {
-        return Hal::Device().EnumerateInstanceExtensionProperties(
-            nullptr, &count, nullptr);
+        return Hal::Get().EnumerateInstanceExtensions(&count, nullptr);
     } else {
         const auto& driver = GetData(physical_dev_).driver;
         return driver.EnumerateDeviceExtensionProperties(physical_dev_, nullptr,
@@ -468,8 +542,7 @@ VkResult CreateInfoWrapper::EnumerateExtensions(
     uint32_t& count,
     VkExtensionProperties* props) const {
     if (is_instance_) {
-        return Hal::Device().EnumerateInstanceExtensionProperties(
-            nullptr, &count, props);
+        return Hal::Get().EnumerateInstanceExtensions(&count, props);
     } else {
         const auto& driver = GetData(physical_dev_).driver;
         return driver.EnumerateDeviceExtensionProperties(physical_dev_, nullptr,
@@ -757,6 +830,10 @@ bool OpenHAL() {
     return Hal::Open();
 }
 
+bool ShouldReloadHAL() {
+    return Hal::ShouldReload();
+}
+
 const VkAllocationCallbacks& GetDefaultAllocator() {
     static const VkAllocationCallbacks kDefaultAllocCallbacks = {
         .pUserData = nullptr,
@@ -1074,6 +1151,7 @@ VkResult CreateInstance(const VkInstanceCreateInfo* pCreateInfo,
     // call into the driver
     VkInstance instance;
     ATRACE_BEGIN("driver.CreateInstance");
+    Hal::NoteInstanceCreated();
     result = Hal::Device().CreateInstance(
         static_cast<const VkInstanceCreateInfo*>(wrapper), pAllocator,
         &instance);
@@ -101,6 +101,7 @@ struct DeviceData {
 };
 
 bool OpenHAL();
+bool ShouldReloadHAL();
 const VkAllocationCallbacks& GetDefaultAllocator();
 
 bool QueryPresentationProperties(
@@ -20,6 +20,8 @@
 #include <string.h>
 
 #include <algorithm>
+#include <string_view>
+#include <unordered_map>
 
 #include "driver.h"
 
@@ -480,13 +482,17 @@ const ProcHook g_proc_hooks[] = {
 }  // namespace
 
 const ProcHook* GetProcHook(const char* name) {
-    const auto& begin = g_proc_hooks;
-    const auto& end =
-        g_proc_hooks + sizeof(g_proc_hooks) / sizeof(g_proc_hooks[0]);
-    const auto hook = std::lower_bound(
-        begin, end, name,
-        [](const ProcHook& e, const char* n) { return strcmp(e.name, n) < 0; });
-    return (hook < end && strcmp(hook->name, name) == 0) ? hook : nullptr;
+    // Every vkGet*ProcAddr that reaches the driver looks up here, and device
+    // and instance creation do that once per command, so index the hooks by
+    // name instead of binary searching them.
+    static const auto* const hooks_by_name = [] {
+        auto* map = new std::unordered_map<std::string_view, const ProcHook*>;
+        for (const auto& hook : g_proc_hooks)
+            map->emplace(hook.name, &hook);
+        return map;
+    }();
+    const auto hook = hooks_by_name->find(name);
+    return hook != hooks_by_name->end() ? hook->second : nullptr;
 }
 
 ProcHook::Extension GetProcHookExtension(const char* name) {
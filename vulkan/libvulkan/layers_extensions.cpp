@@ -23,9 +23,12 @@
 #include <dlfcn.h>
 #include <string.h>
 #include <sys/prctl.h>
+#include <sys/stat.h>
 
+#include <atomic>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <android/dlext.h>
@@ -324,6 +327,21 @@ void* LayerLibrary::GetGPA(const Layer& layer, const std::string_view gpa_name)
 std::vector<LayerLibrary> g_layer_libraries;
 std::vector<Layer> g_instance_layers;
 
+// Layer libraries found by DiscoverLayers but not yet opened. Opening every
+// library to query its layers is expensive, so that is deferred until
+// something actually looks the layers up.
+struct LayerCandidate {
+    std::string path;
+    std::string filename;
+};
+std::mutex g_layer_candidates_mutex;
+std::vector<LayerCandidate> g_layer_candidates;
+std::atomic<bool> g_layer_candidates_pending(false);
+
+// Modification times of the layer paths that have already been scanned, so
+// that rediscovery only rescans paths whose contents may have changed.
+std::unordered_map<std::string, timespec> g_scanned_path_mtimes;
+
 void AddLayerLibrary(const std::string& path, const std::string& filename) {
     LayerLibrary library(path + "/" + filename, filename);
     if (!library.Open())
@@ -397,6 +415,23 @@ void ForEachFileInZip(const std::string& zipname,
     CloseArchive(zip);
 }
 
+bool PathChangedSinceLastScan(const std::string& path) {
+    // For layers inside an APK, the APK itself determines the contents.
+    const std::string stat_path = path.substr(0, path.find("!/"));
+    struct stat st;
+    if (stat(stat_path.c_str(), &st) != 0)
+        return true;
+
+    auto it = g_scanned_path_mtimes.find(path);
+    if (it != g_scanned_path_mtimes.end() &&
+        it->second.tv_sec == st.st_mtim.tv_sec &&
+        it->second.tv_nsec == st.st_mtim.tv_nsec) {
+        return false;
+    }
+    g_scanned_path_mtimes[path] = st.st_mtim;
+    return true;
+}
+
 template <typename Functor>
 void ForEachFileInPath(const std::string& path, Functor functor) {
     size_t zip_pos = path.find("!/");
@@ -411,33 +446,61 @@ void ForEachFileInPath(const std::string& path, Functor functor) {
 void DiscoverLayersInPathList(const std::string& pathstr) {
     ATRACE_CALL();
 
+    std::vector<LayerCandidate> candidates;
     std::vector<std::string> paths = android::base::Split(pathstr, ":");
     for (const auto& path : paths) {
+        if (!PathChangedSinceLastScan(path)) {
+            ALOGV("layer path '%s' unchanged since last scan", path.c_str());
+            continue;
+        }
         ForEachFileInPath(path, [&](const std::string& filename) {
             if (android::base::StartsWith(filename, "libVkLayer") &&
                 android::base::EndsWith(filename, ".so")) {
-
-                // Check to ensure we haven't seen this layer already
-                // Let the first instance of the shared object be enumerated
-                // We're searching for layers in following order:
-                // 1. system path
-                // 2. libraryPermittedPath (if enabled)
-                // 3. libraryPath
-
-                bool duplicate = false;
-                for (auto& layer : g_layer_libraries) {
-                    if (layer.GetFilename() == filename) {
-                        ALOGV("Skipping duplicate layer %s in %s",
-                              filename.c_str(), path.c_str());
-                        duplicate = true;
-                    }
-                }
-
-                if (!duplicate)
-                    AddLayerLibrary(path, filename);
+                candidates.push_back({path, filename});
             }
         });
     }
+    if (candidates.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(g_layer_candidates_mutex);
+    g_layer_candidates.insert(g_layer_candidates.end(),
+                              std::make_move_iterator(candidates.begin()),
+                              std::make_move_iterator(candidates.end()));
+    g_layer_candidates_pending = true;
+}
+
+void EnumeratePendingLayers() {
+    if (!g_layer_candidates_pending)
+        return;
+
+    std::lock_guard<std::mutex> lock(g_layer_candidates_mutex);
+    if (!g_layer_candidates_pending)
+        return;
+    ATRACE_CALL();
+
+    for (const auto& candidate : g_layer_candidates) {
+        // Check to ensure we haven't seen this layer already
+        // Let the first instance of the shared object be enumerated
+        // We're searching for layers in following order:
+        // 1. system path
+        // 2. libraryPermittedPath (if enabled)
+        // 3. libraryPath
+
+        bool duplicate = false;
+        for (auto& layer : g_layer_libraries) {
+            if (layer.GetFilename() == candidate.filename) {
+                ALOGV("Skipping duplicate layer %s in %s",
+                      candidate.filename.c_str(), candidate.path.c_str());
+                duplicate = true;
+            }
+        }
+
+        if (!duplicate)
+            AddLayerLibrary(candidate.path, candidate.filename);
+    }
+    g_layer_candidates.clear();
+    g_layer_candidates_pending = false;
 }
 
 const VkExtensionProperties* FindExtension(
@@ -469,14 +532,17 @@ void DiscoverLayers() {
 }
 
 uint32_t GetLayerCount() {
+    EnumeratePendingLayers();
     return static_cast<uint32_t>(g_instance_layers.size());
 }
 
 const Layer& GetLayer(uint32_t index) {
+    EnumeratePendingLayers();
     return g_instance_layers[index];
 }
 
 const Layer* FindLayer(const char* name) {
+    EnumeratePendingLayers();
     auto layer =
         std::find_if(g_instance_layers.cbegin(), g_instance_layers.cend(),
                      [=](const Layer& entry) {
@@ -16,6 +16,7 @@
 
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <android-base/properties.h>
 #include <android/hardware/graphics/common/1.0/types.h>
 #include <grallocusage/GrallocUsageConversion.h>
 #include <graphicsenv/GraphicsEnv.h>
@@ -27,7 +28,14 @@
 #include <utils/Timers.h>
 #include <utils/Trace.h>
 
+#include <pthread.h>
+
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -205,6 +213,112 @@ struct Surface {
     uint64_t consumer_usage;
 };
 
+// Dequeues the buffer for the next vkAcquireNextImageKHR on a dedicated thread
+// right after a present, so that BufferQueue back-pressure stalls that thread
+// instead of the application's render thread. Enabled with the
+// debug.vulkan.swapchain_predequeue property.
+class Predequeuer {
+   public:
+    enum class Result { NONE, READY, TIMED_OUT };
+
+    struct Dequeued {
+        int err;
+        ANativeWindowBuffer* buffer;
+        int fence_fd;
+    };
+
+    explicit Predequeuer(ANativeWindow* window)
+        : window_(window), thread_(&Predequeuer::Run, this) {}
+    ~Predequeuer() { Stop(); }
+
+    Predequeuer(const Predequeuer&) = delete;
+    Predequeuer& operator=(const Predequeuer&) = delete;
+
+    // Asks the thread to dequeue one more buffer.
+    void Request() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_++;
+        cond_.notify_all();
+    }
+
+    // Waits up to timeout (forever if negative) for a requested buffer.
+    // Returns NONE if nothing was requested or the dequeue failed; callers
+    // then dequeue directly so that errors are reported as usual.
+    Result Take(nsecs_t timeout, ANativeWindowBuffer** buffer, int* fence_fd) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (dequeued_.empty() && pending_ == 0 && !in_flight_)
+            return Result::NONE;
+        auto is_ready = [this] { return !dequeued_.empty(); };
+        if (timeout < 0) {
+            cond_.wait(lock, is_ready);
+        } else if (!cond_.wait_for(lock, std::chrono::nanoseconds(timeout),
+                                   is_ready)) {
+            return Result::TIMED_OUT;
+        }
+        Dequeued dequeued = dequeued_.front();
+        dequeued_.erase(dequeued_.begin());
+        if (dequeued.err != android::OK)
+            return Result::NONE;
+        *buffer = dequeued.buffer;
+        *fence_fd = dequeued.fence_fd;
+        return Result::READY;
+    }
+
+    // Stops the thread and returns the buffers it dequeued that were never
+    // taken. The caller owns them and their fences.
+    std::vector<Dequeued> Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            cond_.notify_all();
+        }
+        if (thread_.joinable())
+            thread_.join();
+
+        std::vector<Dequeued> untaken;
+        for (const auto& dequeued : dequeued_) {
+            if (dequeued.err == android::OK)
+                untaken.push_back(dequeued);
+        }
+        dequeued_.clear();
+        return untaken;
+    }
+
+   private:
+    void Run() {
+        pthread_setname_np(pthread_self(), "VkPredequeue");
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cond_.wait(lock, [this] { return stop_ || pending_ > 0; });
+            if (stop_)
+                return;
+            pending_--;
+            in_flight_ = true;
+
+            lock.unlock();
+            Dequeued dequeued = {android::OK, nullptr, -1};
+            ATRACE_BEGIN("predequeueBuffer");
+            dequeued.err = window_->dequeueBuffer(window_, &dequeued.buffer,
+                                                  &dequeued.fence_fd);
+            ATRACE_END();
+            lock.lock();
+
+            in_flight_ = false;
+            dequeued_.push_back(dequeued);
+            cond_.notify_all();
+        }
+    }
+
+    ANativeWindow* const window_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    uint32_t pending_ = 0;
+    bool in_flight_ = false;
+    bool stop_ = false;
+    std::vector<Dequeued> dequeued_;
+    std::thread thread_;
+};
+
 VkSurfaceKHR HandleFromSurface(Surface* surface) {
     return VkSurfaceKHR(reinterpret_cast<uint64_t>(surface));
 }
@@ -270,6 +384,7 @@ struct Swapchain {
     } images[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
 
     std::vector<TimingInfo> timing;
+    std::unique_ptr<Predequeuer> predequeuer;
 };
 
 VkSwapchainKHR HandleFromSwapchain(Swapchain* swapchain) {
@@ -333,9 +448,24 @@ void ReleaseSwapchainImage(VkDevice device,
     image.buffer.clear();
 }
 
+void StopPredequeue(ANativeWindow* window, Swapchain* swapchain) {
+    if (!swapchain->predequeuer)
+        return;
+
+    for (const auto& dequeued : swapchain->predequeuer->Stop()) {
+        if (window) {
+            window->cancelBuffer(window, dequeued.buffer, dequeued.fence_fd);
+        } else if (dequeued.fence_fd >= 0) {
+            close(dequeued.fence_fd);
+        }
+    }
+    swapchain->predequeuer.reset();
+}
+
 void OrphanSwapchain(VkDevice device, Swapchain* swapchain) {
     if (swapchain->surface.swapchain_handle != HandleFromSwapchain(swapchain))
         return;
+    StopPredequeue(swapchain->surface.window.get(), swapchain);
     for (uint32_t i = 0; i < swapchain->num_images; i++) {
         if (!swapchain->images[i].dequeued)
             ReleaseSwapchainImage(device, nullptr, -1, swapchain->images[i]);
@@ -997,6 +1127,8 @@ static void DestroySwapchainInternal(VkDevice device,
         native_window_enable_frame_timestamps(window, false);
     }
 
+    StopPredequeue(window, swapchain);
+
     for (uint32_t i = 0; i < swapchain->num_images; i++) {
         ReleaseSwapchainImage(device, window, -1, swapchain->images[i]);
     }
@@ -1392,6 +1524,12 @@ VkResult CreateSwapchainKHR(VkDevice device,
             android::GpuStatsInfo::Stats::FALSE_PREROTATION);
     }
 
+    if (!swapchain->shared &&
+        android::base::GetBoolProperty("debug.vulkan.swapchain_predequeue",
+                                       false)) {
+        swapchain->predequeuer = std::make_unique<Predequeuer>(window);
+    }
+
     surface.swapchain_handle = HandleFromSwapchain(swapchain);
     *swapchain_handle = surface.swapchain_handle;
     return VK_SUCCESS;
@@ -1477,13 +1615,22 @@ VkResult AcquireNextImageKHR(VkDevice device,
 
     ANativeWindowBuffer* buffer;
     int fence_fd;
-    err = window->dequeueBuffer(window, &buffer, &fence_fd);
-    if (err == android::TIMED_OUT || err == android::INVALID_OPERATION) {
-        ALOGW("dequeueBuffer timed out: %s (%d)", strerror(-err), err);
-        return timeout ? VK_TIMEOUT : VK_NOT_READY;
-    } else if (err != android::OK) {
-        ALOGE("dequeueBuffer failed: %s (%d)", strerror(-err), err);
-        return VK_ERROR_SURFACE_LOST_KHR;
+    Predequeuer::Result predequeued = Predequeuer::Result::NONE;
+    if (swapchain.predequeuer) {
+        predequeued = swapchain.predequeuer->Take(acquire_next_image_timeout,
+                                                  &buffer, &fence_fd);
+        if (predequeued == Predequeuer::Result::TIMED_OUT)
+            return timeout ? VK_TIMEOUT : VK_NOT_READY;
+    }
+    if (predequeued == Predequeuer::Result::NONE) {
+        err = window->dequeueBuffer(window, &buffer, &fence_fd);
+        if (err == android::TIMED_OUT || err == android::INVALID_OPERATION) {
+            ALOGW("dequeueBuffer timed out: %s (%d)", strerror(-err), err);
+            return timeout ? VK_TIMEOUT : VK_NOT_READY;
+        } else if (err != android::OK) {
+            ALOGE("dequeueBuffer failed: %s (%d)", strerror(-err), err);
+            return VK_ERROR_SURFACE_LOST_KHR;
+        }
     }
 
     uint32_t idx;
@@ -1722,6 +1869,8 @@ VkResult QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* present_info) {
                         img.dequeue_fence = -1;
                     }
                     img.dequeued = false;
+                    if (swapchain.predequeuer)
+                        swapchain.predequeuer->Request();
                 }
 
                 // If the swapchain is in shared mode, immediately dequeue the